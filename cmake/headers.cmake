@@ -1,6 +1,7 @@
 # DO NOT EDIT, GENERATED BY SCRIPT
 set(llfio_HEADERS
   "include/kvstore/kvstore.hpp"
+  "include/kvstore/single_file.hpp"
   "include/llfio.hpp"
   "include/llfio/llfio.hpp"
   "include/llfio/ntkernel-error-category/include/ntkernel-error-category/config.hpp"
@@ -8,35 +9,72 @@ set(llfio_HEADERS
   "include/llfio/ntkernel-error-category/include/ntkernel-error-category/detail/ntkernel_category_impl.ipp"
   "include/llfio/ntkernel-error-category/include/ntkernel-error-category/ntkernel_category.hpp"
   "include/llfio/revision.hpp"
+  "include/llfio/v2.0/algorithm/bulk_copy.hpp"
   "include/llfio/v2.0/algorithm/clone.hpp"
+  "include/llfio/v2.0/algorithm/deduplicate.hpp"
+  "include/llfio/v2.0/algorithm/durable_replace.hpp"
+  "include/llfio/v2.0/algorithm/external_sort.hpp"
+  "include/llfio/v2.0/algorithm/group_barrier.hpp"
   "include/llfio/v2.0/algorithm/handle_adapter/cached_parent.hpp"
+  "include/llfio/v2.0/algorithm/handle_adapter/cached_path.hpp"
+  "include/llfio/v2.0/algorithm/handle_adapter/checksumming.hpp"
+  "include/llfio/v2.0/algorithm/handle_adapter/coalescing.hpp"
   "include/llfio/v2.0/algorithm/handle_adapter/combining.hpp"
+  "include/llfio/v2.0/algorithm/handle_adapter/redundant.hpp"
   "include/llfio/v2.0/algorithm/handle_adapter/xor.hpp"
+  "include/llfio/v2.0/algorithm/incremental_traverse.hpp"
+  "include/llfio/v2.0/algorithm/io_tuner.hpp"
+  "include/llfio/v2.0/algorithm/mirrored_ring_buffer.hpp"
+  "include/llfio/v2.0/algorithm/page_in_ahead.hpp"
   "include/llfio/v2.0/algorithm/reduce.hpp"
+  "include/llfio/v2.0/algorithm/shared_append_log.hpp"
   "include/llfio/v2.0/algorithm/shared_fs_mutex/atomic_append.hpp"
   "include/llfio/v2.0/algorithm/shared_fs_mutex/base.hpp"
   "include/llfio/v2.0/algorithm/shared_fs_mutex/byte_ranges.hpp"
+  "include/llfio/v2.0/algorithm/shared_fs_mutex/leases.hpp"
   "include/llfio/v2.0/algorithm/shared_fs_mutex/lock_files.hpp"
   "include/llfio/v2.0/algorithm/shared_fs_mutex/memory_map.hpp"
+  "include/llfio/v2.0/algorithm/shared_fs_mutex/reader_biased.hpp"
   "include/llfio/v2.0/algorithm/shared_fs_mutex/safe_byte_ranges.hpp"
+  "include/llfio/v2.0/algorithm/shared_mpmc_queue.hpp"
+  "include/llfio/v2.0/algorithm/sorted_table.hpp"
+  "include/llfio/v2.0/algorithm/sparse_transfer.hpp"
   "include/llfio/v2.0/algorithm/summarize.hpp"
   "include/llfio/v2.0/algorithm/traverse.hpp"
+  "include/llfio/v2.0/algorithm/tree_hash.hpp"
+  "include/llfio/v2.0/algorithm/tree_snapshot.hpp"
   "include/llfio/v2.0/algorithm/trivial_vector.hpp"
+  "include/llfio/v2.0/algorithm/write_ahead_log.hpp"
+  "include/llfio/v2.0/buffer_cache.hpp"
+  "include/llfio/v2.0/byte_socket_handle.hpp"
   "include/llfio/v2.0/config.hpp"
   "include/llfio/v2.0/deadline.h"
+  "include/llfio/v2.0/detail/impl/buffer_cache.ipp"
+  "include/llfio/v2.0/detail/impl/bulk_copy.ipp"
+  "include/llfio/v2.0/detail/impl/byte_socket_handle.ipp"
   "include/llfio/v2.0/detail/impl/cached_parent_handle_adapter.ipp"
   "include/llfio/v2.0/detail/impl/clone.ipp"
+  "include/llfio/v2.0/detail/impl/deduplicate.ipp"
   "include/llfio/v2.0/detail/impl/config.ipp"
   "include/llfio/v2.0/detail/impl/fast_random_file_handle.ipp"
+  "include/llfio/v2.0/detail/impl/file_handle.ipp"
   "include/llfio/v2.0/detail/impl/io_multiplexer.ipp"
+  "include/llfio/v2.0/detail/impl/io_statistics.ipp"
+  "include/llfio/v2.0/detail/impl/map_handle.ipp"
   "include/llfio/v2.0/detail/impl/path_discovery.ipp"
   "include/llfio/v2.0/detail/impl/path_view.ipp"
+  "include/llfio/v2.0/detail/impl/posix/byte_socket_handle.ipp"
   "include/llfio/v2.0/detail/impl/posix/directory_handle.ipp"
+  "include/llfio/v2.0/detail/impl/posix/epoll_multiplexer.ipp"
+  "include/llfio/v2.0/detail/impl/posix/file_follower.ipp"
   "include/llfio/v2.0/detail/impl/posix/file_handle.ipp"
   "include/llfio/v2.0/detail/impl/posix/fs_handle.ipp"
   "include/llfio/v2.0/detail/impl/posix/handle.ipp"
   "include/llfio/v2.0/detail/impl/posix/import.hpp"
   "include/llfio/v2.0/detail/impl/posix/io_handle.ipp"
+  "include/llfio/v2.0/detail/impl/posix/io_uring_metadata_ring.ipp"
+  "include/llfio/v2.0/detail/impl/posix/io_uring_multiplexer.ipp"
+  "include/llfio/v2.0/detail/impl/posix/kqueue_multiplexer.ipp"
   "include/llfio/v2.0/detail/impl/posix/lockable_io_handle.ipp"
   "include/llfio/v2.0/detail/impl/posix/map_handle.ipp"
   "include/llfio/v2.0/detail/impl/posix/mapped_file_handle.ipp"
@@ -48,19 +86,25 @@ set(llfio_HEADERS
   "include/llfio/v2.0/detail/impl/posix/statfs.ipp"
   "include/llfio/v2.0/detail/impl/posix/storage_profile.ipp"
   "include/llfio/v2.0/detail/impl/posix/symlink_handle.ipp"
-  "include/llfio/v2.0/detail/impl/posix/test/io_uring_multiplexer.ipp"
   "include/llfio/v2.0/detail/impl/posix/utils.ipp"
   "include/llfio/v2.0/detail/impl/reduce.ipp"
+  "include/llfio/v2.0/detail/impl/redundant_handle_adapter.ipp"
   "include/llfio/v2.0/detail/impl/safe_byte_ranges.ipp"
+  "include/llfio/v2.0/detail/impl/sparse_transfer.ipp"
   "include/llfio/v2.0/detail/impl/storage_profile.ipp"
   "include/llfio/v2.0/detail/impl/test/null_multiplexer.ipp"
   "include/llfio/v2.0/detail/impl/traverse.ipp"
+  "include/llfio/v2.0/detail/impl/utils.ipp"
+  "include/llfio/v2.0/detail/impl/windows/byte_socket_handle.ipp"
   "include/llfio/v2.0/detail/impl/windows/directory_handle.ipp"
+  "include/llfio/v2.0/detail/impl/windows/file_follower.ipp"
   "include/llfio/v2.0/detail/impl/windows/file_handle.ipp"
   "include/llfio/v2.0/detail/impl/windows/fs_handle.ipp"
   "include/llfio/v2.0/detail/impl/windows/handle.ipp"
   "include/llfio/v2.0/detail/impl/windows/import.hpp"
   "include/llfio/v2.0/detail/impl/windows/io_handle.ipp"
+  "include/llfio/v2.0/detail/impl/windows/iocp_multiplexer.ipp"
+  "include/llfio/v2.0/detail/impl/windows/ioring_multiplexer.ipp"
   "include/llfio/v2.0/detail/impl/windows/lockable_io_handle.ipp"
   "include/llfio/v2.0/detail/impl/windows/map_handle.ipp"
   "include/llfio/v2.0/detail/impl/windows/mapped_file_handle.ipp"
@@ -72,15 +116,18 @@ set(llfio_HEADERS
   "include/llfio/v2.0/detail/impl/windows/statfs.ipp"
   "include/llfio/v2.0/detail/impl/windows/storage_profile.ipp"
   "include/llfio/v2.0/detail/impl/windows/symlink_handle.ipp"
-  "include/llfio/v2.0/detail/impl/windows/test/iocp_multiplexer.ipp"
   "include/llfio/v2.0/detail/impl/windows/utils.ipp"
+  "include/llfio/v2.0/detail/impl/write_ahead_log.ipp"
   "include/llfio/v2.0/directory_handle.hpp"
   "include/llfio/v2.0/fast_random_file_handle.hpp"
+  "include/llfio/v2.0/file_follower.hpp"
   "include/llfio/v2.0/file_handle.hpp"
   "include/llfio/v2.0/fs_handle.hpp"
   "include/llfio/v2.0/handle.hpp"
+  "include/llfio/v2.0/interned_path.hpp"
   "include/llfio/v2.0/io_handle.hpp"
   "include/llfio/v2.0/io_multiplexer.hpp"
+  "include/llfio/v2.0/io_sender.hpp"
   "include/llfio/v2.0/llfio.hpp"
   "include/llfio/v2.0/lockable_io_handle.hpp"
   "include/llfio/v2.0/logging.hpp"
@@ -94,7 +141,9 @@ set(llfio_HEADERS
   "include/llfio/v2.0/path_view.hpp"
   "include/llfio/v2.0/pipe_handle.hpp"
   "include/llfio/v2.0/process_handle.hpp"
+  "include/llfio/v2.0/registered_buffer_pool.hpp"
   "include/llfio/v2.0/stat.hpp"
+  "include/llfio/v2.0/static_io_handle.hpp"
   "include/llfio/v2.0/statfs.hpp"
   "include/llfio/v2.0/status_code.hpp"
   "include/llfio/v2.0/storage_profile.hpp"
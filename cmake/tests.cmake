@@ -1,36 +1,87 @@
 # DO NOT EDIT, GENERATED BY SCRIPT
 set(llfio_TESTS
   "test/test_kernel_decl.hpp"
+  "test/tests/buffer_cache.cpp"
+  "test/tests/bulk_copy.cpp"
+  "test/tests/byte_socket_handle.cpp"
+  "test/tests/cached_parent_handle_adapter.cpp"
+  "test/tests/cached_path_handle_adapter.cpp"
   "test/tests/clone_extents.cpp"
   "test/tests/current_path.cpp"
+  "test/tests/deduplicate.cpp"
   "test/tests/directory_handle_create_close/kernel_directory_handle.cpp.hpp"
   "test/tests/directory_handle_create_close/runner.cpp"
   "test/tests/directory_handle_enumerate/kernel_directory_handle_enumerate.cpp.hpp"
   "test/tests/directory_handle_enumerate/runner.cpp"
+  "test/tests/directory_handle_enumerate_metadata.cpp"
+  "test/tests/directory_handle_enumeration_cache.cpp"
+  "test/tests/durable_replace.cpp"
+  "test/tests/external_sort.cpp"
   "test/tests/fast_random_file_handle.cpp"
+  "test/tests/file_follower.cpp"
+  "test/tests/file_handle_advise.cpp"
+  "test/tests/file_handle_allocate.cpp"
+  "test/tests/file_handle_bounce_io.cpp"
   "test/tests/file_handle_create_close/kernel_file_handle.cpp.hpp"
   "test/tests/file_handle_create_close/runner.cpp"
+  "test/tests/file_handle_extents.cpp"
   "test/tests/file_handle_lock_unlock.cpp"
+  "test/tests/file_handle_many_buffers.cpp"
+  "test/tests/file_handle_pooled.cpp"
+  "test/tests/file_handle_resolve_flags.cpp"
+  "test/tests/file_handle_write_flags.cpp"
+  "test/tests/fs_handle_extended_attributes.cpp"
+  "test/tests/group_barrier.cpp"
+  "test/tests/handle_adapter_checksumming.cpp"
+  "test/tests/handle_adapter_coalescing.cpp"
+  "test/tests/handle_adapter_redundant.cpp"
   "test/tests/handle_adapter_xor.cpp"
+  "test/tests/interned_path.cpp"
+  "test/tests/io_statistics.cpp"
+  "test/tests/io_tuner.cpp"
   "test/tests/issue0027.cpp"
   "test/tests/issue0028.cpp"
+  "test/tests/kvstore_single_file.cpp"
   "test/tests/large_pages.cpp"
+  "test/tests/map_handle_cache.cpp"
   "test/tests/map_handle_create_close/kernel_map_handle.cpp.hpp"
   "test/tests/map_handle_create_close/runner.cpp"
+  "test/tests/map_handle_dirty_tracking.cpp"
+  "test/tests/map_handle_prefetch.cpp"
   "test/tests/mapped.cpp"
+  "test/tests/mapped_file_handle_records.cpp"
+  "test/tests/mapped_file_handle_reservation.cpp"
+  "test/tests/mirrored_ring_buffer.cpp"
+  "test/tests/multiplexed_file_handle.cpp"
+  "test/tests/numa_placement.cpp"
+  "test/tests/nvram_barrier.cpp"
   "test/tests/path_discovery.cpp"
   "test/tests/path_view.cpp"
   "test/tests/pipe_handle.cpp"
   "test/tests/process_handle.cpp"
   "test/tests/reduce.cpp"
+  "test/tests/registered_buffer_pool.cpp"
   "test/tests/section_handle_create_close/kernel_section_handle.cpp.hpp"
   "test/tests/section_handle_create_close/runner.cpp"
+  "test/tests/shared_append_log.cpp"
   "test/tests/shared_fs_mutex.cpp"
+  "test/tests/shared_mpmc_queue.cpp"
+  "test/tests/sorted_table.cpp"
+  "test/tests/sparse_transfer.cpp"
+  "test/tests/stat_fill_many.cpp"
+  "test/tests/static_io_handle.cpp"
+  "test/tests/statfs.cpp"
+  "test/tests/storage_profile_cache.cpp"
+  "test/tests/storage_profile_mapped_reads.cpp"
   "test/tests/symlink_handle_create_close/kernel_symlink_handle.cpp.hpp"
   "test/tests/symlink_handle_create_close/runner.cpp"
+  "test/tests/symlink_handle_many.cpp"
+  "test/tests/trace_log.cpp"
   "test/tests/traverse.cpp"
+  "test/tests/tree_hash.cpp"
   "test/tests/trivial_vector.cpp"
   "test/tests/utils.cpp"
+  "test/tests/write_ahead_log.cpp"
 )
 # DO NOT EDIT, GENERATED BY SCRIPT
 set(llfio_COMPILE_TESTS
@@ -29,6 +29,8 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "quickcpplib/memory_resource.hpp"
 
+#include <memory>  // for unique_ptr
+
 //! \file kvstore.hpp Provides the abstract interface for a key-value store.
 
 #if defined(LLFIO_UNSTABLE_VERSION) && !defined(LLFIO_DISABLE_ABI_PERMUTATION)
@@ -127,6 +129,9 @@ namespace traits
       };
     };
     template <template <class...> class T, class... Ts> using test_apply = impl::test_apply<T, impl::types<Ts...>>;
+    // Overloads for user types are found by ADL
+    template <class T> span<byte> in_place_attach(span<byte>) = delete;
+    template <class T> span<byte> in_place_detach(span<byte>) = delete;
     template <class T, class... Args> span<byte> _do_attach_object_instance(T &, span<byte> b) { return in_place_attach<T>(b); }
     template <class T, class... Args> span<byte> _do_detach_object_instance(T &, span<byte> b) { return in_place_detach<T>(b); }
 
@@ -198,6 +203,8 @@ enum class kvstore_errc
   transaction_aborted_collision,  //!< The transaction could not be committed due to dependent key update.
 };
 
+class basic_key_value_store;
+
 /*! \brief Information about an available key value store implementation.
 */
 struct basic_key_value_store_info
@@ -243,15 +250,16 @@ struct basic_key_value_store_info
   Higher positive scores outrank other positive scores.
   */
   int (*score)(const uri_type &uri, handle_type::mode, handle_type::creation creation);
-  /*! Construct a store implementation.
+  /*! Construct a store implementation. A key size of zero means the key size of an existing store.
   */
-  result<basic_key_value_store> (*create)(const basic_key_value_store::uri_type &uri, size_type key_size, features _features, mode _mode, creation _creation, caching _caching);
+  result<std::unique_ptr<basic_key_value_store>> (*create)(const uri_type &uri, size_type key_size, struct features _features, mode _mode, creation _creation, caching _caching);
 };
 
 /*! \class basic_key_value_store
 \brief A possibly hardware-implemented basic key-value store.
 
-\warning This class has not been implemented nor will be any time soon. It is here for various folk to study the API design.
+\warning Only the `single_file` reference implementation in `single_file.hpp` exists, and it implements
+none of the optional features. The API is mainly here for various folk to study its design.
 
 Reference document https://www.snia.org/sites/default/files/technical_work/PublicReview/KV%20Storage%20API%200.16.pdf
 */
@@ -305,6 +313,7 @@ protected:
   capacity_type _items_quota{0}, _bytes_quota{0};
   allocator_type _allocator{};
 
+  basic_key_value_store() = default;
   // Cannot be copied
   basic_key_value_store(const basic_key_value_store &) = delete;
   basic_key_value_store &operator=(const basic_key_value_store &) = delete;
@@ -445,7 +454,7 @@ public:
   If a store implementation does not implement `features::atomic_snapshot`, this function returns
   an error code comparing equal to `errc::operation_not_supported`.
   */
-  virtual result<basic_key_value_store> snapshot() noexcept = 0;
+  virtual result<std::unique_ptr<basic_key_value_store>> snapshot() noexcept = 0;
 
   class transaction;
   /*! Begin a transaction on this key value store.
@@ -459,7 +468,7 @@ public:
   If a store implementation does not implement `features::atomic_transactions`, this function returns
   an error code comparing equal to `errc::operation_not_supported`.
   */
-  virtual result<transaction> begin_transaction() noexcept = 0;
+  virtual result<std::unique_ptr<transaction>> begin_transaction() noexcept = 0;
 };
 
 class basic_key_value_store::transaction : public basic_key_value_store
@@ -496,31 +505,31 @@ a store at `uri` with the specified key size and features. Guaranteed built-in p
     `store/01234/5678/90ab/cdef/latest` is the count of the latest value, its size, and if deltas need to be
     applied.
 
-    - `single_file`: Initially all keys and values are kept in memory. Upon first URI fetch after first creation,
-    a single file is created comprising all the keys and values associatively mapped. This single file can be
-    then be mapped as shared memory into multiple processes, thus enabling multiple concurrent C++ programs to
-    collaborate on a shared store where only values are mutable (and not resizeable). Only one process may pin
-    a value at a time concurrently.
+    - `single_file`: A single memory mapped file comprising a hash index of all the keys, followed by their
+    values. Reads return buffers pointing directly into the mapped file. This is the only provider currently
+    implemented, see `single_file_key_value_store`. The original design intended for keys and values to be
+    kept in memory until first URI fetch, after which the file could be mapped as shared memory into multiple
+    processes where only values are mutable (and not resizeable).
 
 URIs may of course specify other sources of key value store than on the file system. Third parties may have
 registered system-wide implementations available to all programs. The local process may have registered
 additional implementations as well.
 */
-LLFIO_HEADERS_ONLY_FUNC_SPEC result<basic_key_value_store> create_kvstore(const basic_key_value_store::uri_type &uri,                                              //
-                                                                          basic_key_value_store::size_type key_size,                                               //
-                                                                          basic_key_value_store::features _features,                                               //
-                                                                          basic_key_value_store::mode _mode = basic_key_value_store::mode::write,                  //
-                                                                          basic_key_value_store::creation _creation = basic_key_value_store::creation::if_needed,  //
-                                                                          basic_key_value_store::caching _caching = basic_key_value_store::caching::all);
+inline result<std::unique_ptr<basic_key_value_store>> create_kvstore(const basic_key_value_store::uri_type &uri,                                              //
+                                                                     basic_key_value_store::size_type key_size,                                               //
+                                                                     basic_key_value_store::features _features,                                               //
+                                                                     basic_key_value_store::mode _mode = basic_key_value_store::mode::write,                  //
+                                                                     basic_key_value_store::creation _creation = basic_key_value_store::creation::if_needed,  //
+                                                                     basic_key_value_store::caching _caching = basic_key_value_store::caching::all);
 /*! \brief Open an existing key value store. A convenience overload for `create_kvstore()`.
 */
-LLFIO_HEADERS_ONLY_FUNC_SPEC result<basic_key_value_store> open_kvstore(const basic_key_value_store::uri_type &uri,                              //
-                                                                        basic_key_value_store::mode _mode = basic_key_value_store::mode::write,  //
-                                                                        basic_key_value_store::caching _caching = basic_key_value_store::caching::all);
+inline result<std::unique_ptr<basic_key_value_store>> open_kvstore(const basic_key_value_store::uri_type &uri,                              //
+                                                                   basic_key_value_store::mode _mode = basic_key_value_store::mode::write,  //
+                                                                   basic_key_value_store::caching _caching = basic_key_value_store::caching::all);
 
 /*! \brief Fill an array with information about all the key value stores available to this process.
 */
-LLFIO_HEADERS_ONLY_FUNC_SPEC result<span<basic_key_value_store_info>> enumerate_kvstores(span<basic_key_value_store_info> lst);
+inline result<span<basic_key_value_store_info>> enumerate_kvstores(span<basic_key_value_store_info> lst);
 
 #if 0
 /*! \brief A possibly hardware-implemented basic key-value store.
@@ -587,4 +596,6 @@ LLFIO_HEADERS_ONLY_FUNC_SPEC const key_value_store<void *, llfio::section_handle
 
 KVSTORE_V1_NAMESPACE_END
 
+#include "single_file.hpp"
+
 #endif
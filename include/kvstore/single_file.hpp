@@ -0,0 +1,549 @@
+/* Single file reference key-value store
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef KVSTORE_SINGLE_FILE_HPP
+#define KVSTORE_SINGLE_FILE_HPP
+
+#include "kvstore.hpp"
+
+#include "../llfio/v2.0/mapped.hpp"
+#include "../llfio/v2.0/mapped_file_handle.hpp"
+
+#include "quickcpplib/algorithm/hash.hpp"
+#include "quickcpplib/algorithm/open_hash_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+//! \file single_file.hpp Provides the `single_file` reference key-value store.
+
+KVSTORE_V1_NAMESPACE_BEGIN
+
+/*! \class single_file_key_value_store
+\brief A reference key value store kept in a single memory mapped file.
+
+The file begins with a page holding a header, followed by a mapped
+`basic_open_hash_index` as used by the key-value store in `programs`, whose
+slots map the 128 bit hash of each key to the offset, length and capacity of
+its value. Values follow the index, appended as they are written, each preceded
+by its capacity and key. All access is via a `llfio::mapped_file_handle`, so `read()`
+never copies anything, and instead returns buffers pointing directly into the
+mapped file, as `llfio::mapped_file_handle::read()` does.
+
+Writes fit into the existing capacity of a value where possible, otherwise the
+value is relocated to the end of the file. The space of relocated values is not
+reclaimed until `clear()`. The index has 65,536 slots unless `max_size()` is set
+to something else whilst the store is empty, and the store refuses new keys
+with `errc::no_buffer_space` once three quarters of the slots are in use, or if
+their hash is that of a different key already stored.
+
+This store implements none of the optional features. It is not safe for concurrent
+modification, whether from multiple threads or multiple processes, though readers
+may share the file with a single writer with the usual races upon values. As with
+the key-value store, a store opened read only maps its index copy on write, so each
+page of the index is seen as it was when first locked by a lookup.
+
+`match()` walks the values in the order they were appended, skipping those since
+relocated. It sets its state to one after the offset of the value's record matched,
+and `key()` returns the key matched for that state.
+*/
+class single_file_key_value_store final : public basic_key_value_store
+{
+  struct _header_type
+  {
+    uint64_t magic;  // _magic once initialised
+    uint64_t key_size;
+    uint64_t slots;
+    uint64_t items;
+    uint64_t heap_end;  // where the next value is appended
+    uint64_t bytes_stored;
+    uint64_t items_quota, bytes_quota;  // zero if none
+  };
+  // The value of each slot of the index, whose key is the hash of the store's key
+  struct _slot_type
+  {
+    uint64_t value_offset;  // preceded by the record's capacity and key
+    uint64_t value_length;
+    uint64_t value_capacity;
+  };
+  using _hash_type = QUICKCPPLIB_NAMESPACE::integers128::uint128;
+  using _index_type = QUICKCPPLIB_NAMESPACE::algorithm::open_hash_index::basic_open_hash_index<QUICKCPPLIB_NAMESPACE::algorithm::open_hash_index::atomic_linear_memory_policy<_hash_type, _slot_type, 0>, llfio::mapped>;
+  static constexpr uint64_t _magic = 0x32304653564b6c6cULL;  // "llKVSF02"
+  static constexpr uint64_t _default_slots = 65536;
+  static constexpr uint64_t _index_offset = 4096;
+  static constexpr uint64_t _value_alignment = 64;
+
+  llfio::mapped_file_handle _mh;
+  std::unique_ptr<_index_type> _index;
+  size_type _prefix_size{0};  // of each record, its capacity and key padded to the value alignment
+
+  _header_type *_header() const noexcept { return reinterpret_cast<_header_type *>(_mh.address()); }
+  static uint64_t _heap_begin(uint64_t slots) noexcept { return (_index_offset + slots * sizeof(_index_type::value_type) + 4095) & ~static_cast<uint64_t>(4095); }
+  static size_type _prefix_size_for(size_type key_size) noexcept { return (sizeof(uint64_t) + key_size + _value_alignment - 1) & ~static_cast<size_type>(_value_alignment - 1); }
+  // The capacity of the value of the record at an offset, which is followed by its key
+  uint64_t &_record_capacity(uint64_t offset) const noexcept { return *reinterpret_cast<uint64_t *>(_mh.address() + offset); }
+  byte *_record_key(uint64_t offset) const noexcept { return _mh.address() + offset + sizeof(uint64_t); }
+  static _hash_type _hash(key_type key) noexcept { return QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash(reinterpret_cast<const char *>(key.data()), key.size()); }
+  static capacity_type _to_capacity(uint64_t v) noexcept
+  {
+    capacity_type ret;
+    ret.as_longlongs[0] = v;
+    ret.as_longlongs[1] = 0;
+    return ret;
+  }
+  static uint64_t _from_capacity(capacity_type v) noexcept { return (v.as_longlongs[1] != 0) ? static_cast<uint64_t>(-1) : v.as_longlongs[0]; }
+  static llfio::path_view _path_from_uri(const uri_type &uri) noexcept { return llfio::path_view(uri.c_str() + 7, uri.size() - 7, true); }
+
+  // Returns the slot of the key, setting found to false if there is none or it holds a different key of the same hash
+  _index_type::const_iterator _find(key_type key, bool &found) const noexcept
+  {
+    auto it = _index->find_shared(_hash(key));
+    found = (it != _index->end() && 0 == memcmp(_record_key(it->second.value_offset - _prefix_size), key.data(), key.size()));
+    if(!found)
+    {
+      return {};
+    }
+    return it;
+  }
+  // True if the record at an offset holds the current value of its key, rather than one since relocated
+  bool _live(uint64_t offset) const noexcept
+  {
+    auto it = _index->find_shared(_hash({_record_key(offset), _key_size}));
+    return it != _index->end() && it->second.value_offset == offset + _prefix_size;
+  }
+
+  // Maps the index, whenever the number of slots is set
+  result<void> _map_index() noexcept
+  {
+    try
+    {
+      _index.reset();
+      const auto flag = _mh.is_writable() ? llfio::section_handle::flag::readwrite : (llfio::section_handle::flag::read | llfio::section_handle::flag::cow);
+      OUTCOME_TRY(auto &&sh, llfio::section_handle::section(_mh, 0, flag));
+      _index.reset(new _index_type(sh, static_cast<size_t>(_header()->slots), _index_offset, flag));
+      return llfio::success();
+    }
+    catch(...)
+    {
+      return llfio::error_from_exception();
+    }
+  }
+
+  // Formats an empty store with the given number of slots
+  result<void> _initialise(uint64_t slots) noexcept
+  {
+    // Truncating must not race the map of the index
+    _index.reset();
+    OUTCOME_TRY(_mh.truncate(0));
+    OUTCOME_TRY(_mh.truncate(_heap_begin(slots)));
+    _header_type *header = _header();
+    memset(header, 0, sizeof(_header_type));
+    header->key_size = _key_size;
+    header->slots = slots;
+    header->heap_end = _heap_begin(slots);
+    header->magic = _magic;
+    return _map_index();
+  }
+
+  explicit single_file_key_value_store(llfio::mapped_file_handle &&mh)
+      : _mh(std::move(mh))
+  {
+  }
+
+public:
+  single_file_key_value_store(single_file_key_value_store &&) = default;
+  single_file_key_value_store &operator=(single_file_key_value_store &&) = default;
+  ~single_file_key_value_store() override = default;
+
+  //! Returns the information about this store implementation, for registration in `enumerate_kvstores()`.
+  static basic_key_value_store_info info() noexcept
+  {
+    basic_key_value_store_info ret{};
+    ret.name = "single_file";
+    ret.min_key_size = 1;
+    ret.max_key_size = 4096 - sizeof(uint64_t);
+    ret.min_value_size = 0;
+    ret.max_value_size = static_cast<extent_type>(1) << 40U;
+    ret.features = features::none;
+    ret.score = &score;
+    ret.create = &create;
+    return ret;
+  }
+
+  /*! Scores a `file://` URI for suitability: two if it is an existing store, one if it
+  could be created, zero if something incompatible is already there, and negative otherwise.
+  */
+  static int score(const uri_type &uri, mode /*unused*/, creation _creation) noexcept
+  {
+    if(uri.compare(0, 7, "file://") != 0 || uri.size() == 7)
+    {
+      return -1;
+    }
+    auto fh = llfio::file_handle::file({}, _path_from_uri(uri));
+    if(!fh)
+    {
+      return (_creation != creation::open_existing && _creation != creation::truncate_existing) ? 1 : -1;
+    }
+    uint64_t magic = 0;
+    auto read = fh.value().read(0, {{reinterpret_cast<byte *>(&magic), sizeof(magic)}});
+    if(!read)
+    {
+      return 0;
+    }
+    if(read.value() == 0)
+    {
+      // An empty file can be formatted
+      return 1;
+    }
+    return (read.value() == sizeof(magic) && magic == _magic) ? 2 : 0;
+  }
+
+  /*! Creates or opens a store in the file at a `file://` URI. A key size of zero opens an
+  existing store with whatever key size it has.
+  */
+  static result<std::unique_ptr<basic_key_value_store>> create(const uri_type &uri, size_type key_size, features _features, mode _mode, creation _creation, caching _caching) noexcept
+  {
+    try
+    {
+      if(uri.compare(0, 7, "file://") != 0 || uri.size() == 7)
+      {
+        return llfio::errc::invalid_argument;
+      }
+      if(_features & ~features(features::none))
+      {
+        return llfio::errc::operation_not_supported;
+      }
+      if(key_size > info().max_key_size)
+      {
+        return llfio::errc::invalid_argument;
+      }
+      OUTCOME_TRY(auto &&mh, llfio::mapped_file_handle::mapped_file(0, {}, _path_from_uri(uri), _mode, _creation, _caching));
+      std::unique_ptr<single_file_key_value_store> ret(new single_file_key_value_store(std::move(mh)));
+      ret->_uri = uri;
+      OUTCOME_TRY(auto &&length, ret->_mh.maximum_extent());
+      if(length < sizeof(_header_type))
+      {
+        if(key_size == 0 || _mode != mode::write)
+        {
+          return llfio::errc::no_such_file_or_directory;
+        }
+        ret->_key_size = key_size;
+        ret->_prefix_size = _prefix_size_for(key_size);
+        OUTCOME_TRY(ret->_initialise(_default_slots));
+      }
+      else
+      {
+        const _header_type *header = ret->_header();
+        if(header->magic != _magic || header->slots == 0 || length < _heap_begin(header->slots) || length < header->heap_end)
+        {
+          return llfio::errc::illegal_byte_sequence;
+        }
+        if(key_size != 0 && key_size != header->key_size)
+        {
+          return llfio::errc::invalid_argument;
+        }
+        ret->_key_size = static_cast<size_type>(header->key_size);
+        ret->_prefix_size = _prefix_size_for(ret->_key_size);
+        OUTCOME_TRY(ret->_map_index());
+      }
+      return std::unique_ptr<basic_key_value_store>(std::move(ret));
+    }
+    catch(...)
+    {
+      return llfio::error_from_exception();
+    }
+  }
+
+  //! Returns the key matched by `match()`, which is valid until the store is next modified.
+  key_type key(filter_state_type state) const noexcept
+  {
+    if(state == 0 || state - 1 < _heap_begin(_header()->slots) || state - 1 >= _header()->heap_end || !_live(state - 1))
+    {
+      return {};
+    }
+    return {_record_key(state - 1), _key_size};
+  }
+
+  virtual result<uri_type> uri() noexcept override { return _uri; }
+  virtual bool empty() const noexcept override { return _header()->items == 0; }
+  virtual result<capacity_type> max_size() const noexcept override
+  {
+    const _header_type *header = _header();
+    const uint64_t limit = header->slots / 4 * 3;
+    return _to_capacity((header->items_quota != 0) ? (std::min)(limit, header->items_quota) : limit);
+  }
+  //! Sets an item quota, and resizes the index to suit if the store is empty.
+  virtual result<void> max_size(capacity_type quota) noexcept override
+  {
+    if(!_mh.is_writable())
+    {
+      return llfio::errc::permission_denied;
+    }
+    const uint64_t items = _from_capacity(quota);
+    if(empty() && items != 0 && items <= (static_cast<uint64_t>(1) << 32U))
+    {
+      uint64_t slots = 64;
+      while(slots / 4 * 3 < items)
+      {
+        slots <<= 1U;
+      }
+      OUTCOME_TRY(_initialise(slots));
+    }
+    _header()->items_quota = items;
+    return llfio::success();
+  }
+  virtual result<capacity_type> size() const noexcept override { return _to_capacity(_header()->items); }
+  virtual result<capacity_type> max_bytes_stored() const noexcept override
+  {
+    const uint64_t quota = _header()->bytes_quota;
+    return _to_capacity((quota != 0) ? quota : static_cast<uint64_t>(info().max_value_size));
+  }
+  virtual result<void> max_bytes_stored(capacity_type quota) noexcept override
+  {
+    if(!_mh.is_writable())
+    {
+      return llfio::errc::permission_denied;
+    }
+    _header()->bytes_quota = _from_capacity(quota);
+    return llfio::success();
+  }
+  virtual result<capacity_type> bytes_stored() const noexcept override { return _to_capacity(_header()->bytes_stored); }
+  virtual result<extent_type> max_value_size() const noexcept override { return info().max_value_size; }
+
+  //! Key indices are not implemented, filtering is always linear.
+  virtual result<void> key_index_size(size_type bytes) noexcept override
+  {
+    if(bytes != 0)
+    {
+      return llfio::errc::operation_not_supported;
+    }
+    return llfio::success();
+  }
+
+  virtual result<void> clear() noexcept override
+  {
+    if(!_mh.is_writable())
+    {
+      return llfio::errc::permission_denied;
+    }
+    return _initialise(_header()->slots);
+  }
+
+  virtual result<void> match(filter_state_type &state, key_type mask = {}, key_type bits = {}) noexcept override
+  {
+    const uint64_t heap_begin = _heap_begin(_header()->slots), heap_end = _header()->heap_end;
+    if(state != 0 && (state - 1 < heap_begin || state - 1 >= heap_end))
+    {
+      return llfio::errc::no_such_file_or_directory;
+    }
+    for(uint64_t offset = (state == 0) ? heap_begin : (state - 1 + _prefix_size + _record_capacity(state - 1)); offset < heap_end; offset += _prefix_size + _record_capacity(offset))
+    {
+      if(!_live(offset))
+      {
+        continue;
+      }
+      const byte *k = _record_key(offset);
+      bool matches = true;
+      for(size_t n = 0; matches && n < mask.size() && n < _key_size; n++)
+      {
+        const auto m = static_cast<uint8_t>(mask[n]);
+        const auto b = (n < bits.size()) ? static_cast<uint8_t>(bits[n]) : static_cast<uint8_t>(0);
+        matches = ((static_cast<uint8_t>(k[n]) & m) == (b & m));
+      }
+      if(matches)
+      {
+        state = offset + 1;
+        return llfio::success();
+      }
+    }
+    return llfio::errc::no_such_file_or_directory;
+  }
+
+  //! Not implemented, as synthetic handles to values are not available.
+  virtual result<handle_type> open(key_type /*unused*/, mode /*unused*/ = mode::read) noexcept override { return llfio::errc::operation_not_supported; }
+
+  //! Returns buffers pointing directly into the mapped file, without copying.
+  virtual io_result<buffers_type> read(io_request<buffers_type> reqs, key_type key, llfio::deadline /*unused*/ = llfio::deadline()) noexcept override
+  {
+    if(key.size() != _key_size)
+    {
+      return llfio::errc::invalid_argument;
+    }
+    bool found;
+    auto it = _find(key, found);
+    if(!found)
+    {
+      return llfio::errc::no_such_file_or_directory;
+    }
+    const _slot_type slot = it->second;
+    byte *addr = _mh.address() + slot.value_offset + reqs.offset;
+    size_type togo = reqs.offset < slot.value_length ? static_cast<size_type>(slot.value_length - reqs.offset) : 0;
+    for(size_t i = 0; i < reqs.buffers.size(); i++)
+    {
+      buffer_type &req = reqs.buffers[i];
+      req = {addr, req.size()};
+      if(req.size() > togo)
+      {
+        req = {req.data(), togo};
+        reqs.buffers = {reqs.buffers.data(), i + 1};
+        break;
+      }
+      addr += req.size();
+      togo -= req.size();
+    }
+    return reqs.buffers;
+  }
+
+  //! Writes into the value in place if it fits, otherwise relocates it to the end of the file first.
+  virtual io_result<const_buffers_type> write(key_type key, io_request<const_buffers_type> reqs, llfio::deadline /*unused*/ = llfio::deadline()) noexcept override
+  {
+    if(key.size() != _key_size)
+    {
+      return llfio::errc::invalid_argument;
+    }
+    if(!_mh.is_writable())
+    {
+      return llfio::errc::permission_denied;
+    }
+    const _hash_type hash = _hash(key);
+    auto it = _index->find_exclusive(hash);
+    const bool inserting = (it == _index->end());
+    if(!inserting && 0 != memcmp(_record_key(it->second.value_offset - _prefix_size), key.data(), key.size()))
+    {
+      // A different key has the same hash
+      return llfio::errc::no_buffer_space;
+    }
+    const _header_type *header = _header();
+    if(inserting && (header->items >= header->slots / 4 * 3 || (header->items_quota != 0 && header->items >= header->items_quota)))
+    {
+      return llfio::errc::no_buffer_space;
+    }
+    extent_type total = 0;
+    for(const auto &i : reqs.buffers)
+    {
+      total += i.size();
+    }
+    _slot_type slot{};
+    if(!inserting)
+    {
+      slot = it->second;
+    }
+    const uint64_t oldlength = slot.value_length;
+    const uint64_t newlength = (std::max)(oldlength, static_cast<uint64_t>(reqs.offset + total));
+    if(header->bytes_quota != 0 && header->bytes_stored - oldlength + newlength > header->bytes_quota)
+    {
+      return llfio::errc::no_buffer_space;
+    }
+    if(inserting || newlength > slot.value_capacity)
+    {
+      // Relocate to a new record at the end, which may move the map
+      const uint64_t capacity = (newlength + _value_alignment - 1) & ~(_value_alignment - 1);
+      const uint64_t offset = _header()->heap_end;
+      OUTCOME_TRY(_mh.truncate(offset + _prefix_size + capacity));
+      _record_capacity(offset) = capacity;
+      memcpy(_record_key(offset), key.data(), key.size());
+      if(oldlength > 0)
+      {
+        memcpy(_mh.address() + offset + _prefix_size, _mh.address() + slot.value_offset, static_cast<size_t>(oldlength));
+      }
+      slot.value_offset = offset + _prefix_size;
+      slot.value_capacity = capacity;
+      _header()->heap_end = offset + _prefix_size + capacity;
+    }
+    byte *addr = _mh.address() + slot.value_offset + reqs.offset;
+    for(const auto &i : reqs.buffers)
+    {
+      memcpy(addr, i.data(), i.size());
+      addr += i.size();
+    }
+    slot.value_length = newlength;
+    if(inserting)
+    {
+      if(_index->insert({hash, slot}).first == _index->end())
+      {
+        // The record written is dead space until clear()
+        return llfio::errc::no_buffer_space;
+      }
+      _header()->items++;
+    }
+    else
+    {
+      it->second = slot;
+    }
+    _header()->bytes_stored += newlength - oldlength;
+    return reqs.buffers;
+  }
+
+  //! Not implemented, as this store does not implement `features::atomic_snapshots`.
+  virtual result<std::unique_ptr<basic_key_value_store>> snapshot() noexcept override { return llfio::errc::operation_not_supported; }
+  //! Not implemented, as this store does not implement `features::atomic_transactions`.
+  virtual result<std::unique_ptr<transaction>> begin_transaction() noexcept override { return llfio::errc::operation_not_supported; }
+};
+
+inline result<span<basic_key_value_store_info>> enumerate_kvstores(span<basic_key_value_store_info> lst)
+{
+  if(lst.empty())
+  {
+    return lst;
+  }
+  lst[0] = single_file_key_value_store::info();
+  return span<basic_key_value_store_info>(lst.data(), 1);
+}
+
+inline result<std::unique_ptr<basic_key_value_store>> create_kvstore(const basic_key_value_store::uri_type &uri, basic_key_value_store::size_type key_size, basic_key_value_store::features _features, basic_key_value_store::mode _mode,
+                                                                     basic_key_value_store::creation _creation, basic_key_value_store::caching _caching)
+{
+  basic_key_value_store_info infos[1];
+  OUTCOME_TRY(auto &&available, enumerate_kvstores(infos));
+  const basic_key_value_store_info *best = nullptr;
+  int bestscore = 0;
+  for(const auto &i : available)
+  {
+    if((key_size != 0 && (key_size < i.min_key_size || key_size > i.max_key_size)) || (_features & ~i.features))
+    {
+      continue;
+    }
+    const int score = i.score(uri, _mode, _creation);
+    // Zero means something incompatible is there, which is only usable if it is to be replaced
+    if(score > bestscore || (best == nullptr && score == 0 && (_creation == basic_key_value_store::creation::truncate_existing || _creation == basic_key_value_store::creation::always_new)))
+    {
+      best = &i;
+      bestscore = score;
+    }
+  }
+  if(best == nullptr)
+  {
+    return llfio::errc::operation_not_supported;
+  }
+  return best->create(uri, key_size, _features, _mode, _creation, _caching);
+}
+
+inline result<std::unique_ptr<basic_key_value_store>> open_kvstore(const basic_key_value_store::uri_type &uri, basic_key_value_store::mode _mode, basic_key_value_store::caching _caching)
+{
+  return create_kvstore(uri, 0, basic_key_value_store::features::none, _mode, basic_key_value_store::creation::open_existing, _caching);
+}
+
+KVSTORE_V1_NAMESPACE_END
+
+#endif
@@ -0,0 +1,149 @@
+/* A pipelined bulk file copy engine
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_BULK_COPY_HPP
+#define LLFIO_ALGORITHM_BULK_COPY_HPP
+
+#include "../file_handle.hpp"
+
+//! \file bulk_copy.hpp Provides a pipelined copy engine for many files at once.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  //! \brief A source and destination for `bulk_copy()`.
+  struct bulk_copy_item
+  {
+    const path_handle *srcbase{nullptr};   //!< The base to lookup `srcleaf` within, or null if `srcleaf` is absolute.
+    path_view srcleaf;                     //!< The path of the file to copy.
+    const path_handle *destbase{nullptr};  //!< The base to lookup `destleaf` within, or null if `destleaf` is absolute.
+    path_view destleaf;                    //!< The path of the copy.
+  };
+
+  //! \brief The progress of a `bulk_copy()`.
+  struct bulk_copy_progress
+  {
+    size_t items_total{0};                     //!< The number of items to copy.
+    size_t items_completed{0};                 //!< The number of items copied.
+    size_t items_failed{0};                    //!< The number of items which failed, and were skipped.
+    size_t items_in_flight{0};                 //!< The number of items currently open.
+    file_handle::extent_type bytes_total{0};   //!< The number of bytes in the items opened so far.
+    file_handle::extent_type bytes_cloned{0};  //!< The number of bytes cloned or copied by the kernel.
+    file_handle::extent_type bytes_copied{0};  //!< The number of bytes read and written through buffers.
+  };
+
+  /*! \brief A visitor for `bulk_copy()`.
+
+  All member functions are called from the kernel thread which called `bulk_copy()`.
+  Returning a failure from any of them causes `bulk_copy()` to return that failure as soon as
+  the i/o in flight has completed, with the copies not yet completed removed.
+  */
+  struct LLFIO_DECL bulk_copy_visitor
+  {
+    virtual ~bulk_copy_visitor() = default;
+
+    //! Called whenever some i/o has completed.
+    virtual result<void> progress(const bulk_copy_progress &p) noexcept
+    {
+      (void) p;
+      return success();
+    }
+    //! Called when an item has been copied, and its copy closed.
+    virtual result<void> item_completed(size_t idx, const bulk_copy_item &item, file_handle::extent_type bytes) noexcept
+    {
+      (void) idx;
+      (void) item;
+      (void) bytes;
+      return success();
+    }
+    /*! \brief Called when an item failed, after its copy has been removed. The default implementation
+    returns the failure. If your reimplementation returns success, the item is skipped.
+    */
+    virtual result<void> item_failed(size_t idx, const bulk_copy_item &item, result<void>::error_type &&error) noexcept
+    {
+      (void) idx;
+      (void) item;
+      return std::move(error);
+    }
+  };
+
+  /*! \brief Copy many files at once, pipelining the stages of each copy so that the devices
+  are kept busy.
+
+  \return The final progress.
+  \param items The sources and destinations to copy.
+  \param visitor The visitor to use, if any.
+  \param multiplexer The i/o multiplexer to read and write with, if any.
+  \param max_per_device The maximum number of items to have open at once upon any one device.
+  \param preserve_timestamps Use `stat_t::stamp()` to preserve as much metadata from
+  each original to its copy as possible.
+  \param force_copy_now Never clone extents, always copy them now.
+  \param durable Wait for each copy to reach storage before closing it.
+  \param creation How to create each destination file handle.
+  \param d Deadline for each clone, barrier, and where there is no multiplexer, each i/o.
+
+  Each item proceeds through these stages, with the stages of up to `max_per_device` items
+  upon each device interleaved:
+
+  1. The source is opened, and its destination created using `creation` and sized to the length
+  of the source. The devices of an item are those of `srcbase` and `destbase`.
+
+  2. The valid extents of the source are enumerated, so holes remain holes in the copy.
+
+  3. Unless `force_copy_now` is true, the extents are cloned using `file_handle::clone_extents_to()`
+  with `emulate_if_unsupported = false`, in chunks of sixteen times `utils::file_buffer_default_size()`
+  so no one item stalls the others for long. On Linux this is `copy_file_range()`, which reflinks
+  where the filing system can, and otherwise copies within the kernel.
+
+  4. If the first clone failed, the extents are instead read and written in chunks of
+  `utils::file_buffer_default_size()` through two buffers per item from a `registered_buffer_pool`,
+  so the read of one chunk overlaps the write of the previous one. If `multiplexer` is supplied,
+  every handle is opened multiplexable and this i/o is asynchronous, so the reads and writes of
+  all the items in flight are in flight together. Otherwise each read and write blocks.
+
+  5. The copy is flushed with `barrier_kind::wait_all` if `durable`, else writeback of it is begun
+  with `barrier_kind::nowait_data_only`. If `preserve_timestamps`, it is restamped from the
+  source, and then both are closed.
+
+  If an item fails, its copy is removed and `bulk_copy_visitor::item_failed()` decides whether
+  to continue with the other items.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<bulk_copy_progress> bulk_copy(span<const bulk_copy_item> items, bulk_copy_visitor *visitor = nullptr,
+                                                                    io_multiplexer *multiplexer = nullptr, size_t max_per_device = 4,
+                                                                    bool preserve_timestamps = true, bool force_copy_now = false, bool durable = false,
+                                                                    file_handle::creation creation = file_handle::creation::always_new,
+                                                                    deadline d = {}) noexcept;
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/bulk_copy.ipp"
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#endif
@@ -47,14 +47,16 @@ namespace algorithm
   extents to be copied now, not copy-on-write lazily later.
   \param creation How to create the destination file handle.
   \param d Deadline by which to complete the operation.
+  \param threads The maximum number of kernel threads to copy with, with zero meaning
+  up to four.
 
   Firstly, a `file_handle` is constructed at the destination using `creation`,
   which defaults to always creating a new inode. The caching used for the
   destination handle is replicated from the source handle -- be aware that
   not caching metadata is expensive.
 
-  Next `file_handle::clone_extents()` with `emulate_if_unsupported = false` is
-  called on the whole file content. If extent cloning is supported, this will
+  Next, unless `force_copy_now` is true, `file_handle::clone_extents()` with
+  `emulate_if_unsupported = false` is called on the whole file content. If extent cloning is supported, this will
   be very fast and not consume new disk space (note: except on networked filesystems).
   If the source file is sparsely allocated, the destination will have identical
   sparse allocation.
@@ -67,6 +69,10 @@ namespace algorithm
   Next, `file_handle::clone_extents()` with `emulate_if_unsupported = true` is
   called on the whole file content. This copies only the allocated extents in
   blocks sized whatever is the large page size on this platform (2Mb on x64).
+  If the file is larger than sixty-four times `utils::file_buffer_default_size()`,
+  the destination is first extended to the source's length, and then chunks of
+  that size are copied concurrently by up to `threads` kernel threads, so a single
+  large file can reach the bandwidth of the storage rather than that of one thread.
 
   Finally, if `preserve_timestamps` is true, the destination file handle is
   restamped with the metadata from the source file handle just before the
@@ -75,7 +81,7 @@ namespace algorithm
   LLFIO_HEADERS_ONLY_FUNC_SPEC result<file_handle::extent_type> clone_or_copy(file_handle &src, const path_handle &destdir, path_view destleaf = {},
                                                                               bool preserve_timestamps = true, bool force_copy_now = false,
                                                                               file_handle::creation creation = file_handle::creation::always_new,
-                                                                              deadline d = {}) noexcept;
+                                                                              deadline d = {}, size_t threads = 0) noexcept;
 
 #if 0
 #ifdef _MSC_VER
@@ -0,0 +1,177 @@
+/* Content defined chunking and deduplication by extent cloning
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_DEDUPLICATE_HPP
+#define LLFIO_ALGORITHM_DEDUPLICATE_HPP
+
+#include "../file_handle.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+//! \file deduplicate.hpp Provides content defined chunking and deduplication by extent cloning.
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+namespace algorithm
+{
+  //! \brief Options for content defined chunking.
+  struct content_defined_chunking_options
+  {
+    size_t min_size{16384};      //!< The smallest chunk, which must be at least 64 bytes, except at the end of the file.
+    size_t average_size{65536};  //!< The size which chunks are normalised towards.
+    size_t max_size{262144};     //!< The largest chunk.
+    size_t alignment{4096};      //!< Chunks begin at a multiple of this, so they can be cloned.
+  };
+
+  //! \brief A chunk found by content defined chunking.
+  struct content_defined_chunk
+  {
+    file_handle::extent_type offset{0};  //!< The offset of the chunk within the file.
+    file_handle::extent_type length{0};  //!< The length of the chunk.
+    uint64_t hash[2]{0, 0};              //!< The 128 bit hash of the content of the chunk.
+  };
+
+  /*! \brief Splits the content of `h` into chunks whose boundaries depend upon the content,
+  so an insertion or deletion within a file changes only the chunks around it.
+
+  This is FastCDC: a gear hash is tested at each candidate boundary, with a stricter mask below
+  `opts.average_size` and a looser mask above it, and no boundary before `opts.min_size` nor
+  after `opts.max_size`. Unlike FastCDC, candidate boundaries lie only at multiples of
+  `opts.alignment`, because extents can only be cloned in whole filing system blocks. As a gear
+  hash shifts left by one bit per byte, its value at a boundary depends only upon the 64 bytes
+  before it, so only those bytes are hashed at each candidate, rather than every byte, and
+  candidates are independent of one another.
+
+  The file is read `8 * opts.max_size` bytes at a time.
+
+  \errors `errc::invalid_argument` if the options are inconsistent. Any of the values `read()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<std::vector<content_defined_chunk>> content_defined_chunks(file_handle &h, const content_defined_chunking_options &opts = {}) noexcept;
+
+  //! \brief What a `dedup_index::deduplicate()` did.
+  struct dedup_stats
+  {
+    size_t chunks{0};                             //!< The number of chunks in the file.
+    size_t duplicate_chunks{0};                   //!< The number of chunks whose content was found in the index.
+    file_handle::extent_type duplicate_bytes{0};  //!< The bytes of file in duplicate chunks.
+    size_t clones{0};                             //!< The number of extent clones performed.
+    file_handle::extent_type cloned_bytes{0};     //!< The bytes of file replaced with clones.
+    bool clone_supported{true};                   //!< False if the filing system refused to clone extents.
+  };
+
+  /*! \class dedup_index
+  \brief An index of the content defined chunks of files, used to replace duplicate regions of
+  other files with clones of the extents already storing that content.
+
+  `add()` indexes the chunks of a file. `deduplicate()` finds the chunks of a file whose
+  content is already in the index, and replaces them with clones of the indexed extents using
+  `file_handle::clone_extents_to()`, which on filing systems with copy on write extents
+  (XFS, btrfs, APFS, ReFS) makes both regions share storage. Runs of duplicate chunks whose
+  indexed extents are consecutive are cloned by a single call. As hashes can collide, the content
+  of each duplicate is compared byte for byte with the indexed extent before it is cloned.
+
+  Only whole multiples of `content_defined_chunking_options::alignment` are cloned, so the last
+  chunk of a file is cloned only in part. Where the filing system cannot clone extents, nothing
+  is modified, and `dedup_stats::clone_supported` is false, though the duplicates are still reported.
+
+  The index refers to the files added, which must remain open and unmodified whilst the index
+  is in use. This class is not threadsafe.
+  */
+  class LLFIO_DECL dedup_index
+  {
+    struct _key_hasher
+    {
+      size_t operator()(const std::pair<uint64_t, uint64_t> &k) const noexcept { return static_cast<size_t>(k.first ^ k.second); }
+    };
+    struct _location
+    {
+      file_handle *h{nullptr};
+      file_handle::extent_type offset{0}, length{0};
+    };
+    content_defined_chunking_options _opts;
+    std::unordered_map<std::pair<uint64_t, uint64_t>, _location, _key_hasher> _chunks;
+    std::vector<byte> _buffers[2];
+
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<bool> _equal(file_handle &a, file_handle::extent_type aoffset, file_handle &b, file_handle::extent_type boffset,
+                                                        file_handle::extent_type length) noexcept;
+
+  public:
+    //! Constructs an empty index, chunking files according to `opts`.
+    explicit dedup_index(content_defined_chunking_options opts = {})
+        : _opts(opts)
+    {
+    }
+    dedup_index(const dedup_index &) = delete;
+    dedup_index(dedup_index &&) = default;
+    dedup_index &operator=(const dedup_index &) = delete;
+    dedup_index &operator=(dedup_index &&) = default;
+    ~dedup_index() = default;
+
+    //! The chunking options
+    const content_defined_chunking_options &options() const noexcept { return _opts; }
+    //! The number of distinct chunks indexed
+    size_t size() const noexcept { return _chunks.size(); }
+
+    /*! \brief Indexes the chunks of `h` not already indexed, returning how many were added.
+    `h` must remain open whilst the index is in use, or until `remove()`.
+
+    \errors Any of the values `content_defined_chunks()` can return.
+    */
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> add(file_handle &h) noexcept;
+    //! Removes all the chunks of `h` from the index.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void remove(const file_handle &h) noexcept;
+
+    /*! \brief Replaces the chunks of `h` duplicating chunks in the index with clones of them,
+    then if `add_to_index` is true, indexes the chunks of `h` not already indexed.
+
+    A region of a file is never cloned onto an overlapping region of the same file.
+
+    \errors Any of the values `content_defined_chunks()`, `read()` and `clone_extents_to()`
+    can return, except for `errc::operation_not_supported` from `clone_extents_to()`, which
+    instead sets `dedup_stats::clone_supported` to false.
+    */
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<dedup_stats> deduplicate(file_handle &h, bool add_to_index = true) noexcept;
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/deduplicate.ipp"
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#endif
@@ -0,0 +1,455 @@
+/* A batched durable atomic file replacement helper
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_DURABLE_REPLACE_HPP
+#define LLFIO_ALGORITHM_DURABLE_REPLACE_HPP
+
+#include "../directory_handle.hpp"
+#include "../file_handle.hpp"
+#include "../utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//! \file durable_replace.hpp Provides a helper atomically and durably replacing many files at once.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class durable_replace
+  \brief Atomically and durably replaces the contents of many files, batching the barriers which
+  doing so one file at a time would issue.
+
+  The classic recipe for durably replacing a file is to write the new contents into a temporary
+  file in the same directory, flush it, rename it over the original, and then flush the
+  directory. Done one file at a time this costs two flushes per file, each of which waits upon
+  the storage device. With this, each replacement is staged into an inode created by
+  `file_handle::temp_inode()` in the destination directory, which has no name until it is
+  committed. `commit()` then starts writeback of every staged file before waiting upon any of
+  them, renames each over its destination, and finally flushes each distinct destination
+  directory once.
+
+  Anonymous inodes can be linked to a name, but not renamed over one. So on commit each is
+  first linked to a unique name ending in `leftover_suffix()`, which is then renamed over the
+  destination. Where anonymous inodes are not available, replacements are staged into files of
+  such a name from the outset. Replacements discarded, or which fail to commit, are removed,
+  but if the process dies whilst such a name exists, the file is left behind. Call
+  `remove_leftovers()` upon each destination directory during recovery, when no other process
+  can be committing replacements into it, to remove them.
+
+  On Linux, if at least `syncfs_threshold` files are committed, one `syncfs()` per filing system
+  replaces the wave of per-file flushes, and the wave of directory flushes, as with
+  `group_barrier`.
+
+  - Each replacement is atomic: after a crash the destination has either its old or its new
+  contents. The batch is not: after a crash some destinations may have been replaced and others not.
+  - As `file_handle::temp_inode()` creates inodes readable and writable only by their owner, the
+  permissions and any extended attributes of the files replaced are not preserved.
+  - The destination directory handles must outlive `commit()`.
+  - On Windows, NTFS journals the rename, so no directory flush is issued.
+  */
+  class durable_replace
+  {
+  public:
+    //! Statistics about a commit
+    struct statistics
+    {
+      size_t files{0};    //!< The number of files replaced.
+      size_t flushes{0};  //!< The number of flushes issued, which is the number of syncs the storage saw.
+    };
+
+  private:
+    struct _item
+    {
+      const directory_handle *dirh;
+      filesystem::path leaf;
+      file_handle fh;
+      bool renamed{false};
+    };
+
+    file_handle::flag _flags;
+    size_t _syncfs_threshold;
+    std::deque<_item> _items;
+
+#ifdef __linux__
+    // Issues one syncfs() per distinct filing system of the handles, returning the flushes issued
+    template <class F> static result<size_t> _syncfs(size_t count, F &&fd_of) noexcept
+    {
+      size_t flushes = 0;
+      try
+      {
+        std::vector<::dev_t> devs;
+        for(size_t n = 0; n < count; n++)
+        {
+          struct stat s;
+          memset(&s, 0, sizeof(s));
+          if(-1 == ::fstat(fd_of(n), &s))
+          {
+            return posix_error();
+          }
+          if(std::find(devs.begin(), devs.end(), s.st_dev) != devs.end())
+          {
+            continue;
+          }
+          devs.push_back(s.st_dev);
+          flushes++;
+          if(-1 == ::syncfs(fd_of(n)))
+          {
+            return posix_error();
+          }
+        }
+        return flushes;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+#endif
+
+    static std::string _leftover_name()
+    {
+      auto ret = utils::random_string(32);
+      ret.append(leftover_suffix());
+      return ret;
+    }
+
+    // Gives the staged inode its final name, atomically replacing anything there
+    static result<void> _rename(_item &i, deadline d) noexcept
+    {
+      if(!(i.fh.flags() & file_handle::flag::anonymous_inode))
+      {
+        return i.fh.relink(*i.dirh, i.leaf, true, d);
+      }
+      try
+      {
+        // An anonymous inode can be linked into a name, but not renamed over one. Linux also
+        // keeps reporting the handle as deleted once linked, so the newly linked name is opened
+        // to rename it.
+        const auto tempname = _leftover_name();
+        OUTCOME_TRY(i.fh.relink(*i.dirh, tempname, false, d));
+        auto named = file_handle::file(*i.dirh, tempname, file_handle::mode::attr_write, file_handle::creation::open_existing);
+        if(named)
+        {
+          auto r = named.value().relink(*i.dirh, i.leaf, true, d);
+          if(r)
+          {
+            return success();
+          }
+          (void) named.value().unlink(d);
+          return std::move(r).error();
+        }
+        return std::move(named).error();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+
+    // Removes the named files of replacements which were not renamed. Anonymous inodes go on close.
+    static void _discard(std::deque<_item> &items) noexcept
+    {
+      for(auto &i : items)
+      {
+        if(!i.renamed && i.fh.is_valid() && !(i.fh.flags() & file_handle::flag::anonymous_inode))
+        {
+          (void) i.fh.unlink();
+        }
+      }
+      items.clear();
+    }
+
+  public:
+    /*! \brief Constructs a helper.
+    \param flags Any additional flags with which to create the staged inodes.
+    \param syncfs_threshold On Linux, the number of files committed at and above which `syncfs()`
+    is used instead of a flush per file and per directory. Zero means never.
+    */
+    explicit durable_replace(file_handle::flag flags = file_handle::flag::none, size_t syncfs_threshold = 0) noexcept
+        : _flags(flags & ~file_handle::flag::unlink_on_first_close)
+        , _syncfs_threshold(syncfs_threshold)
+    {
+    }
+    //! No copy construction
+    durable_replace(const durable_replace &) = delete;
+    //! Move construction
+    durable_replace(durable_replace &&) = default;
+    //! No copy assignment
+    durable_replace &operator=(const durable_replace &) = delete;
+    //! Move assignment, discarding any replacements staged but not committed
+    durable_replace &operator=(durable_replace &&o) noexcept
+    {
+      if(this != &o)
+      {
+        _discard(_items);
+        _flags = o._flags;
+        _syncfs_threshold = o._syncfs_threshold;
+        _items = std::move(o._items);
+        o._items.clear();
+      }
+      return *this;
+    }
+    //! Discards any replacements staged but not committed.
+    ~durable_replace() { _discard(_items); }
+
+    //! The suffix of the names which staged replacements may have, see `remove_leftovers()`.
+    static constexpr const char *leftover_suffix() noexcept { return ".durable_replace"; }
+
+    /*! \brief Removes the files with names ending in `leftover_suffix()` in `dirh`, returning how
+    many were removed.
+
+    These can only be left behind by a process which died during `commit()`, or whilst replacements
+    were staged where anonymous inodes are not available. This must not be called whilst any other
+    process might be staging or committing replacements into `dirh`, as their files would be removed.
+
+    \errors Any of the values `directory_handle::read()` or `fs_handle::unlink()` can return.
+    */
+    static result<size_t> remove_leftovers(const directory_handle &dirh, deadline d = {}) noexcept
+    {
+      try
+      {
+        std::string glob("*");
+        glob.append(leftover_suffix());
+        std::vector<directory_handle::buffer_type> entries(16);
+        directory_handle::buffers_type buffers;
+        for(;;)
+        {
+          buffers = {entries, std::move(buffers)};
+          OUTCOME_TRY(buffers, dirh.read({std::move(buffers), glob, directory_handle::filter::none}));
+          if(buffers.done())
+          {
+            break;
+          }
+          entries.resize(entries.size() << 1);
+        }
+        size_t ret = 0;
+        for(const auto &entry : buffers)
+        {
+          auto fh = file_handle::file(dirh, entry.leafname, file_handle::mode::write, file_handle::creation::open_existing);
+          if(!fh)
+          {
+            if(fh.error() == errc::no_such_file_or_directory)
+            {
+              continue;
+            }
+            return std::move(fh).error();
+          }
+          OUTCOME_TRY(fh.value().unlink(d));
+          ret++;
+        }
+        return ret;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+
+    //! The number of replacements staged.
+    size_t size() const noexcept { return _items.size(); }
+    //! Discards any replacements staged but not committed.
+    void clear() noexcept { _discard(_items); }
+
+    /*! \brief Stages the replacement of `leaf` within `dirh`, returning a handle to an empty
+    inode on the same filing system into which to write the new contents. The handle remains
+    valid until `commit()` or `clear()`.
+
+    \errors Any of the values `file_handle::temp_inode()` can return.
+    */
+    result<file_handle *> stage(const directory_handle &dirh, path_view leaf) noexcept
+    {
+      try
+      {
+        OUTCOME_TRY(auto &&fh, file_handle::temp_inode(dirh, file_handle::mode::write, _flags));
+        if(!(fh.flags() & file_handle::flag::anonymous_inode))
+        {
+          // Without anonymous inodes, temp_inode() unlinks a named file, which cannot be relinked
+          // everywhere, so stage into a uniquely named file instead
+          OUTCOME_TRYV(fh.close());
+          for(;;)
+          {
+            auto named = file_handle::file(dirh, _leftover_name(), file_handle::mode::write, file_handle::creation::only_if_not_exist,
+                                           file_handle::caching::temporary, _flags);
+            if(named || named.error() != errc::file_exists)
+            {
+              OUTCOME_TRY(fh, std::move(named));
+              break;
+            }
+          }
+        }
+        _items.push_back(_item{&dirh, leaf.path(), std::move(fh)});
+        return &_items.back().fh;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    /*! \brief Stages the replacement of `leaf` within `dirh` with the contents `buffers`.
+
+    \errors Any of the values `file_handle::temp_inode()` or `file_handle::write()` can return.
+    */
+    result<void> stage(const directory_handle &dirh, path_view leaf, file_handle::const_buffers_type buffers) noexcept
+    {
+      OUTCOME_TRY(auto *fh, stage(dirh, leaf));
+      auto written = fh->write({buffers, 0});
+      if(!written)
+      {
+        if(!(fh->flags() & file_handle::flag::anonymous_inode))
+        {
+          (void) fh->unlink();
+        }
+        (void) fh->close();
+        _items.pop_back();
+        return std::move(written).error();
+      }
+      return success();
+    }
+
+    /*! \brief Durably commits all the staged replacements, returning once the new contents and each
+    rename are on storage.
+
+    Writeback of every staged file is started before waiting upon any of them. Only once every
+    staged file is on storage is any renamed over its destination, then each distinct destination
+    directory is flushed once. If a file fails to flush, nothing is renamed. If a rename fails, the
+    remaining renames are still attempted, and the first failure is returned after the directories
+    are flushed. Either way, nothing remains staged afterwards, and the files of replacements not renamed
+    are removed.
+
+    \errors Any of the values `io_handle::barrier()`, `fs_handle::relink()`, `fsync()` or `syncfs()`
+    can return.
+    */
+    result<statistics> commit(deadline d = {}) noexcept
+    {
+      auto items = std::move(_items);
+      _items.clear();
+      auto ret = _commit(items, d);
+      _discard(items);
+      return ret;
+    }
+
+  private:
+    result<statistics> _commit(std::deque<_item> &items, deadline d) noexcept
+    {
+      statistics ret;
+      if(items.empty())
+      {
+        return ret;
+      }
+      try
+      {
+        const bool use_syncfs =
+#ifdef __linux__
+        _syncfs_threshold != 0 && items.size() >= _syncfs_threshold;
+#else
+        false;
+#endif
+        // Start writeback of everything before waiting upon any of it
+        if(items.size() > 1)
+        {
+          for(auto &i : items)
+          {
+            (void) i.fh.barrier(file_handle::barrier_kind::nowait_data_only);
+          }
+        }
+        if(use_syncfs)
+        {
+#ifdef __linux__
+          OUTCOME_TRY(auto &&flushes, _syncfs(items.size(), [&](size_t n) { return items[n].fh.native_handle().fd; }));
+          ret.flushes += flushes;
+#endif
+        }
+        else
+        {
+          for(auto &i : items)
+          {
+            ret.flushes++;
+            OUTCOME_TRY(i.fh.barrier(file_handle::barrier_kind::wait_all, d));
+          }
+        }
+        // Everything is on storage, so give each its final name
+        result<void> renamed(success());
+        std::vector<const directory_handle *> dirs;
+        for(auto &i : items)
+        {
+          auto r = _rename(i, d);
+          if(!r)
+          {
+            if(renamed)
+            {
+              renamed = std::move(r).error();
+            }
+            continue;
+          }
+          i.renamed = true;
+          ret.files++;
+          if(std::find_if(dirs.begin(), dirs.end(), [&](const directory_handle *a) { return a->unique_id() == i.dirh->unique_id(); }) == dirs.end())
+          {
+            dirs.push_back(i.dirh);
+          }
+        }
+        // Flush each directory containing a rename once
+#ifndef _WIN32
+        if(use_syncfs)
+        {
+#ifdef __linux__
+          OUTCOME_TRY(auto &&flushes, _syncfs(dirs.size(), [&](size_t n) { return dirs[n]->native_handle().fd; }));
+          ret.flushes += flushes;
+#endif
+        }
+        else
+        {
+          for(auto *dirh : dirs)
+          {
+            ret.flushes++;
+            if(-1 == ::fsync(dirh->native_handle().fd))
+            {
+              return posix_error();
+            }
+          }
+        }
+#endif
+        OUTCOME_TRYV(std::move(renamed));
+        return ret;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
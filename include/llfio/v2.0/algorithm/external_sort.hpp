@@ -0,0 +1,421 @@
+/* An external merge sort of fixed size records
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_EXTERNAL_SORT_HPP
+#define LLFIO_ALGORITHM_EXTERNAL_SORT_HPP
+
+#include "../map_handle.hpp"
+#include "../path_discovery.hpp"
+#include "../utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//! \file external_sort.hpp Provides an external merge sort of fixed size records.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \brief The key of a `fixed_width_key`, comparing as unsigned bytes, as `memcmp()` does.
+  Big endian integers thus compare as unsigned integers.
+  */
+  template <size_t Length> struct fixed_width_key_value
+  {
+    unsigned char bytes[Length];
+
+    friend bool operator<(const fixed_width_key_value &a, const fixed_width_key_value &b) noexcept { return memcmp(a.bytes, b.bytes, Length) < 0; }
+  };
+  //! \brief A key extractor for `external_sort()` of the `Length` bytes at `Offset` into each record.
+  template <size_t Offset, size_t Length> struct fixed_width_key
+  {
+    using key_type = fixed_width_key_value<Length>;
+    key_type operator()(const byte *record) const noexcept
+    {
+      key_type ret;
+      memcpy(ret.bytes, record + Offset, Length);
+      return ret;
+    }
+  };
+  //! \brief A key extractor for `external_sort()` of a native endian integer or float `T` at `Offset` into each record.
+  template <class T, size_t Offset = 0> struct integer_key
+  {
+    static_assert(std::is_arithmetic<T>::value, "T must be an integer or floating point type");
+    using key_type = T;
+    key_type operator()(const byte *record) const noexcept
+    {
+      key_type ret;
+      memcpy(&ret, record + Offset, sizeof(ret));
+      return ret;
+    }
+  };
+
+  //! \brief Options for `external_sort()`.
+  struct external_sort_options
+  {
+    //! The memory to use for forming runs, shared between all threads.
+    size_t memory{256 * 1024 * 1024};
+    //! The number of threads forming runs, zero means the number of hardware threads.
+    size_t threads{0};
+    //! The bytes of each run to prefetch ahead of the merge.
+    size_t readahead{1024 * 1024};
+    //! The size of each write of the output.
+    size_t output_buffer{8 * 1024 * 1024};
+    //! The directory to keep runs within, null means `path_discovery::storage_backed_temporary_files_directory()`.
+    const path_handle *workdir{nullptr};
+  };
+
+  //! \brief What an `external_sort()` did.
+  struct external_sort_stats
+  {
+    file_handle::extent_type records{0};  //!< The number of records sorted.
+    size_t runs{0};                       //!< The number of sorted runs formed, and then merged.
+    bool direct{false};                   //!< True if the runs were written with `caching::none`.
+  };
+
+  namespace detail
+  {
+    inline size_t external_sort_gcd(size_t a, size_t b) noexcept
+    {
+      while(b != 0)
+      {
+        const size_t t = a % b;
+        a = b;
+        b = t;
+      }
+      return a;
+    }
+    // Fills `buffer` from `src` at `offset`, returning the bytes read which is short only at the end of `src`
+    inline result<size_t> external_sort_read(file_handle &src, file_handle::extent_type offset, byte *buffer, size_t bytes) noexcept
+    {
+      size_t done = 0;
+      while(done < bytes)
+      {
+        OUTCOME_TRY(auto &&read, src.read(offset + done, {{buffer + done, bytes - done}}));
+        if(read == 0)
+        {
+          break;
+        }
+        done += read;
+      }
+      return done;
+    }
+    inline result<void> external_sort_write(file_handle &dest, file_handle::extent_type offset, const byte *buffer, size_t bytes) noexcept
+    {
+      size_t done = 0;
+      while(done < bytes)
+      {
+        OUTCOME_TRY(auto &&written, dest.write(offset + done, {{buffer + done, bytes - done}}));
+        done += written;
+      }
+      return success();
+    }
+  }  // namespace detail
+
+  /*! \brief Sorts the records of `RecordSize` bytes in `src` into `dest`, by the key which
+  `KeyExtractor` extracts from each record ordered by `Compare`, using no more than about
+  `opts.memory` bytes of memory.
+
+  The sort is stable. It forms sorted runs in parallel, each of `opts.memory / opts.threads`
+  bytes or less, then merges all the runs in a single pass:
+
+  1. Each thread reads a run's worth of records from `src` into memory allocated with
+  `io_handle::allocate_registered_buffer()`, which uses large pages where the size of the buffer
+  permits. The key of each record is extracted alongside its index, and those pairs are sorted,
+  which touches far less memory than sorting the records, after which the records are gathered
+  into sorted order and written to a temporary inode in `opts.workdir`. The i/o is aligned, so
+  the run is written with `caching::none` where the filing system permits, keeping the page
+  cache free for the merge.
+  2. Each run is mapped, and a heap of the next key of each run is merged into `dest`
+  `opts.output_buffer` bytes at a time. `map_handle::prefetch()` reads ahead of the merge within
+  each run, so the merge is not stalled by page faults upon every run in turn.
+
+  As `KeyExtractor` and `Compare` are template parameters, comparisons inline. `fixed_width_key`
+  extracts a key of some bytes within each record comparing as `memcmp()` does, and `integer_key`
+  extracts a native endian number. Custom extractors need only define `key_type`, which must be
+  trivially copyable, and be callable with a `const byte *` to a record returning it.
+
+  `src` may use any caching, though `caching::none` is best for a file far larger than memory.
+  If `dest` requires aligned i/o, its final write is padded and then `dest` is truncated to the
+  length of `src`. The sort may need as much free storage in `opts.workdir` as `src` occupies.
+
+  \errors `errc::invalid_argument` if the length of `src` is not a multiple of `RecordSize`,
+  or the options permit no run to be formed. Otherwise any of the values `read()`, `write()`,
+  `truncate()`, `file_handle::temp_inode()` and `map_handle::map()` can return.
+  */
+  template <size_t RecordSize, class KeyExtractor, class Compare = std::less<typename KeyExtractor::key_type>>
+  inline result<external_sort_stats> external_sort(file_handle &dest, file_handle &src, external_sort_options opts = {}, KeyExtractor key = {},
+                                                   Compare comp = {}) noexcept
+  {
+    static_assert(RecordSize > 0, "RecordSize cannot be zero");
+    using key_type = typename KeyExtractor::key_type;
+    using extent_type = file_handle::extent_type;
+    static_assert(std::is_trivially_copyable<key_type>::value, "KeyExtractor::key_type must be trivially copyable");
+    struct sort_item
+    {
+      key_type key;
+      uint32_t index;  // the index of the record within its run, or of its run
+    };
+    // Ties order by index, so the sort is stable
+    auto item_less = [&comp](const sort_item &a, const sort_item &b) noexcept {
+      if(comp(a.key, b.key))
+      {
+        return true;
+      }
+      if(comp(b.key, a.key))
+      {
+        return false;
+      }
+      return a.index < b.index;
+    };
+    try
+    {
+      external_sort_stats ret;
+      const path_handle &workdir = (opts.workdir != nullptr) ? *opts.workdir : path_discovery::storage_backed_temporary_files_directory();
+      OUTCOME_TRY(auto &&length, src.maximum_extent());
+      if(length % RecordSize != 0)
+      {
+        return errc::invalid_argument;
+      }
+      ret.records = length / RecordSize;
+      if(ret.records == 0)
+      {
+        OUTCOME_TRYV(dest.truncate(0));
+        return ret;
+      }
+      size_t threads = (opts.threads != 0) ? opts.threads : (std::max)(1U, std::thread::hardware_concurrency());
+      // Runs must start upon a boundary suitable for uncached i/o, so are a multiple of this many records
+      static constexpr size_t alignment = 4096;
+      const size_t unit = alignment / detail::external_sort_gcd(RecordSize, alignment);
+      // Each thread needs its input, its sorted output, and a sort item per record
+      size_t run_records = opts.memory / threads / (2 * RecordSize + sizeof(sort_item)) / unit * unit;
+      run_records = (std::min)(run_records, (size_t)(UINT32_MAX / unit * unit));
+      if(run_records == 0)
+      {
+        return errc::invalid_argument;
+      }
+      if(run_records >= ret.records)
+      {
+        // Round up to whole units so the last read remains aligned
+        run_records = static_cast<size_t>((ret.records + unit - 1) / unit * unit);
+      }
+      const size_t run_bytes = run_records * RecordSize;
+      const size_t runs = static_cast<size_t>((ret.records + run_records - 1) / run_records);
+      threads = (std::min)(threads, runs);
+      ret.runs = runs;
+
+      // Form the runs
+      std::vector<file_handle> runfhs(runs);
+      std::atomic<size_t> next_run(0);
+      std::atomic<bool> direct(true), failed(false);
+      std::mutex lock;
+      result<void> failure = success();
+      auto fail = [&](result<void> r) {
+        std::lock_guard<std::mutex> g(lock);
+        if(!failed.exchange(true))
+        {
+          failure = std::move(r);
+        }
+      };
+      auto former = [&]() -> result<void> {
+        size_t bytes = run_bytes;
+        OUTCOME_TRY(auto &&inbuf, src.allocate_registered_buffer(bytes));
+        bytes = run_bytes;
+        OUTCOME_TRY(auto &&outbuf, src.allocate_registered_buffer(bytes));
+        std::vector<sort_item> items(run_records);
+        for(size_t run = next_run++; run < runs && !failed; run = next_run++)
+        {
+          const extent_type offset = static_cast<extent_type>(run) * run_bytes;
+          OUTCOME_TRY(auto &&read, detail::external_sort_read(src, offset, inbuf->data(), run_bytes));
+          const size_t records = (std::min)(read / RecordSize, static_cast<size_t>(ret.records - static_cast<extent_type>(run) * run_records));
+          for(size_t n = 0; n < records; n++)
+          {
+            items[n].key = key(inbuf->data() + n * RecordSize);
+            items[n].index = static_cast<uint32_t>(n);
+          }
+          std::sort(items.begin(), items.begin() + records, item_less);
+          for(size_t n = 0; n < records; n++)
+          {
+            memcpy(outbuf->data() + n * RecordSize, inbuf->data() + static_cast<size_t>(items[n].index) * RecordSize, RecordSize);
+          }
+          OUTCOME_TRY(auto &&fh, file_handle::temp_inode(workdir));
+          if(direct)
+          {
+            // Not every filing system permits uncached i/o
+            auto r = fh.reopen(file_handle::mode::unchanged, file_handle::caching::none);
+            if(r)
+            {
+              fh = std::move(r).value();
+            }
+            else
+            {
+              direct = false;
+            }
+          }
+          const size_t used = records * RecordSize;
+          const size_t padded = fh.requires_aligned_io() ? utils::round_up_to_page_size(used, alignment) : used;
+          memset(outbuf->data() + used, 0, padded - used);
+          OUTCOME_TRYV(detail::external_sort_write(fh, 0, outbuf->data(), padded));
+          if(padded != used)
+          {
+            OUTCOME_TRYV(fh.truncate(used));
+          }
+          runfhs[run] = std::move(fh);
+        }
+        return success();
+      };
+      {
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for(size_t n = 0; n < threads; n++)
+        {
+          workers.emplace_back([&] {
+            try
+            {
+              auto r = former();
+              if(!r)
+              {
+                fail(std::move(r));
+              }
+            }
+            catch(...)
+            {
+              fail(error_from_exception());
+            }
+          });
+        }
+        for(auto &t : workers)
+        {
+          t.join();
+        }
+      }
+      if(failed)
+      {
+        OUTCOME_TRYV(std::move(failure));
+      }
+      ret.direct = direct;
+
+      // Merge the runs
+      struct run_cursor
+      {
+        section_handle sh;
+        map_handle mh;
+        const byte *cur{nullptr}, *end{nullptr}, *prefetched{nullptr};
+      };
+      std::vector<run_cursor> cursors(runs);
+      std::vector<sort_item> heap;
+      heap.reserve(runs);
+      const size_t readahead = utils::round_up_to_page_size((std::max)(opts.readahead, utils::page_size()), utils::page_size());
+      auto prefetch = [&](run_cursor &c) {
+        if(c.prefetched < c.end && c.cur + readahead / 2 >= c.prefetched)
+        {
+          const size_t bytes = (std::min)(readahead, static_cast<size_t>(c.end - c.prefetched));
+          // Prefetching is only advice, so failure is ignored
+          (void) map_handle::prefetch(map_handle::buffer_type{const_cast<byte *>(c.prefetched), bytes});
+          c.prefetched += bytes;
+        }
+      };
+      // The heap front is the least key, with ties resolved in favour of the earliest run
+      auto heap_less = [&](const sort_item &a, const sort_item &b) noexcept { return item_less(b, a); };
+      for(size_t run = 0; run < runs; run++)
+      {
+        auto &c = cursors[run];
+        OUTCOME_TRY(auto &&runlength, runfhs[run].maximum_extent());
+        OUTCOME_TRY(c.sh, section_handle::section(runfhs[run], runlength, section_handle::flag::read));
+        OUTCOME_TRY(c.mh, map_handle::map(c.sh, static_cast<map_handle::size_type>(runlength), 0, section_handle::flag::read));
+        c.cur = c.prefetched = c.mh.address();
+        c.end = c.cur + runlength;
+        prefetch(c);
+        heap.push_back({key(c.cur), static_cast<uint32_t>(run)});
+      }
+      std::make_heap(heap.begin(), heap.end(), heap_less);
+      size_t outbytes = utils::round_up_to_page_size((std::max)(opts.output_buffer, RecordSize), alignment);
+      OUTCOME_TRY(auto &&outbuf, dest.allocate_registered_buffer(outbytes));
+      outbytes = outbytes / RecordSize * RecordSize;
+      if(dest.requires_aligned_io())
+      {
+        // Every write but the last must be aligned
+        outbytes = outbytes / (unit * RecordSize) * (unit * RecordSize);
+      }
+      byte *out = outbuf->data(), *const outend = out + outbytes;
+      extent_type written = 0;
+      auto flush = [&](bool last) -> result<void> {
+        size_t used = static_cast<size_t>(out - outbuf->data());
+        if(last && dest.requires_aligned_io())
+        {
+          const size_t padded = utils::round_up_to_page_size(used, alignment);
+          memset(out, 0, padded - used);
+          used = padded;
+        }
+        OUTCOME_TRYV(detail::external_sort_write(dest, written, outbuf->data(), used));
+        written += static_cast<size_t>(out - outbuf->data());
+        out = outbuf->data();
+        return success();
+      };
+      while(!heap.empty())
+      {
+        std::pop_heap(heap.begin(), heap.end(), heap_less);
+        auto &c = cursors[heap.back().index];
+        memcpy(out, c.cur, RecordSize);
+        out += RecordSize;
+        c.cur += RecordSize;
+        if(c.cur < c.end)
+        {
+          prefetch(c);
+          heap.back().key = key(c.cur);
+          std::push_heap(heap.begin(), heap.end(), heap_less);
+        }
+        else
+        {
+          heap.pop_back();
+          c.mh = {};
+          c.sh = {};
+          runfhs[&c - cursors.data()] = {};
+        }
+        if(out == outend)
+        {
+          OUTCOME_TRYV(flush(false));
+        }
+      }
+      OUTCOME_TRYV(flush(true));
+      OUTCOME_TRYV(dest.truncate(written));
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
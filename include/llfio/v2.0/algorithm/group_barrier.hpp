@@ -0,0 +1,308 @@
+/* Coalesces concurrent barriers into group commits
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_GROUP_BARRIER_HPP
+#define LLFIO_ALGORITHM_GROUP_BARRIER_HPP
+
+#include "../io_handle.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//! \file group_barrier.hpp Provides a coordinator coalescing concurrent barriers into group commits.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class group_barrier
+  \brief Coalesces the `barrier()`s of many threads arriving within a small window into a single
+  wave of flushes, completing all the waiters together.
+
+  Each `io_handle::barrier()` is an independent `fsync()`, so many concurrent writers each
+  committing issue as many flushes, each of which waits upon the storage device. With this, the
+  first thread to call `barrier()` becomes the leader of a batch, and waits for `window` for
+  others to join it. The leader then issues one barrier per distinct handle in the batch at the
+  strongest `barrier_kind` requested for that handle, and wakes every waiter with the outcome of
+  the barrier of its handle. Threads arriving whilst a batch is being flushed form the next batch.
+
+  On Linux, writeback of every handle in the batch is started using `sync_file_range()` before any
+  are waited upon, so the device sees all the writes of the batch at once. If the batch contains at
+  least `syncfs_threshold` distinct handles, one `syncfs()` per filing system replaces the wave of
+  per-handle flushes, which is much faster when there are very many handles, but flushes everything
+  else dirty upon that filing system too.
+
+  - Waiters are completed synchronously by the leader. There is no multiplexer integration.
+  - Any `io_handle` may be passed, including those with a multiplexer set.
+  */
+  class group_barrier
+  {
+  public:
+    //! The kind of barrier
+    using barrier_kind = io_handle::barrier_kind;
+
+    //! Statistics about the barriers coalesced
+    struct statistics
+    {
+      uint64_t barriers{0};  //!< The number of calls to `barrier()`.
+      uint64_t batches{0};   //!< The number of batches those calls were coalesced into.
+      uint64_t flushes{0};   //!< The number of flushes issued, which is the number of syncs the storage saw.
+    };
+
+  private:
+    struct _waiter
+    {
+      io_handle *h;
+      barrier_kind kind;
+      result<void> r{success()};
+      _waiter *next{nullptr};
+      bool done{false};
+    };
+
+    std::chrono::microseconds _window;
+    size_t _syncfs_threshold;
+    mutable std::mutex _lock;
+    std::condition_variable _cond;
+    _waiter *_pending{nullptr};
+    bool _leader_active{false};
+    statistics _stats;
+
+    // The strongest of two kinds of barrier, remembering that odd kinds wait
+    static barrier_kind _strongest(barrier_kind a, barrier_kind b) noexcept { return (barrier_kind)((((std::max)((uint8_t) a, (uint8_t) b) >> 1) << 1) | (((uint8_t) a | (uint8_t) b) & 1)); }
+
+    // Status code based errors are move only, and need cloning to be shared amongst waiters
+    template <class T> static auto _copy_error(const T &e, int /*unused*/) noexcept -> decltype(e.clone()) { return e.clone(); }
+    template <class T> static T _copy_error(const T &e, ... /*unused*/) noexcept { return e; }
+
+    uint64_t _flush(_waiter *batch) noexcept
+    {
+      uint64_t flushes = 0;
+      struct item
+      {
+        io_handle *h;
+        barrier_kind kind;
+        result<void> r;
+      };
+      std::vector<item> items;
+      std::vector<bool> flushed;
+#ifdef __linux__
+      std::vector<dev_t> devs;
+#endif
+      try
+      {
+        for(auto *w = batch; w != nullptr; w = w->next)
+        {
+          auto it = std::find_if(items.begin(), items.end(), [&](const item &i) { return i.h == w->h; });
+          if(it == items.end())
+          {
+            items.push_back(item{w->h, w->kind, success()});
+          }
+          else
+          {
+            it->kind = _strongest(it->kind, w->kind);
+          }
+        }
+        flushed.resize(items.size(), false);
+#ifdef __linux__
+        if(_syncfs_threshold != 0 && items.size() >= _syncfs_threshold)
+        {
+          devs.resize(items.size(), 0);
+        }
+#endif
+      }
+      catch(...)
+      {
+        auto e = error_from_exception();
+        for(auto *w = batch; w != nullptr; w = w->next)
+        {
+          w->r = _copy_error(e, 0);
+        }
+        return flushes;
+      }
+#ifdef __linux__
+      // Start writeback of everything before waiting upon any of it
+      if(items.size() > 1)
+      {
+        for(auto &i : items)
+        {
+          if(i.kind >= barrier_kind::nowait_data_only)
+          {
+            (void) i.h->barrier(barrier_kind::nowait_data_only);
+          }
+        }
+      }
+      if(_syncfs_threshold != 0 && items.size() >= _syncfs_threshold)
+      {
+        // One syncfs() per filing system, which also flushes metadata
+        for(size_t n = 0; n < items.size(); n++)
+        {
+          struct stat s;
+          memset(&s, 0, sizeof(s));
+          if(-1 == ::fstat(items[n].h->native_handle().fd, &s))
+          {
+            flushed[n] = true;
+            items[n].r = posix_error();
+            continue;
+          }
+          devs[n] = s.st_dev;
+        }
+        for(size_t n = 0; n < items.size(); n++)
+        {
+          if(flushed[n])
+          {
+            continue;
+          }
+          flushes++;
+          if(-1 == ::syncfs(items[n].h->native_handle().fd))
+          {
+            continue;  // fall back onto the per-handle barrier below
+          }
+          for(size_t m = n; m < items.size(); m++)
+          {
+            if(!flushed[m] && devs[m] == devs[n])
+            {
+              flushed[m] = true;
+            }
+          }
+        }
+      }
+#endif
+      for(size_t n = 0; n < items.size(); n++)
+      {
+        if(!flushed[n])
+        {
+          flushes++;
+          auto r = items[n].h->barrier(items[n].kind);
+          if(!r)
+          {
+            items[n].r = std::move(r).error();
+          }
+        }
+      }
+      for(auto *w = batch; w != nullptr; w = w->next)
+      {
+        const auto &r = std::find_if(items.begin(), items.end(), [&](const item &i) { return i.h == w->h; })->r;
+        if(!r)
+        {
+          w->r = _copy_error(r.error(), 0);
+        }
+      }
+      return flushes;
+    }
+
+  public:
+    /*! \brief Constructs a coordinator.
+    \param window How long the leader of a batch waits for others to join it. Longer windows coalesce
+    more barriers, at the cost of the latency of each.
+    \param syncfs_threshold On Linux, the number of distinct handles in a batch at and above which
+    `syncfs()` is used instead of a barrier per handle. Zero means never.
+    */
+    explicit group_barrier(std::chrono::microseconds window = std::chrono::microseconds(200), size_t syncfs_threshold = 0) noexcept
+        : _window(window)
+        , _syncfs_threshold(syncfs_threshold)
+    {
+    }
+    //! No copy construction
+    group_barrier(const group_barrier &) = delete;
+    //! No move construction
+    group_barrier(group_barrier &&) = delete;
+    //! No copy assignment
+    group_barrier &operator=(const group_barrier &) = delete;
+    //! No move assignment
+    group_barrier &operator=(group_barrier &&) = delete;
+    ~group_barrier() { assert(_pending == nullptr && !_leader_active); }
+
+    //! The statistics so far
+    statistics stats() const noexcept
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      return _stats;
+    }
+
+    /*! \brief Issues a barrier of kind `kind` on `h` as part of the next group commit, returning
+    when the batch containing it has been flushed.
+
+    \errors Any of the values `io_handle::barrier()` or `syncfs()` can return for this handle.
+    */
+    result<void> barrier(io_handle &h, barrier_kind kind = barrier_kind::wait_data_only) noexcept
+    {
+      _waiter w{&h, kind};
+      std::unique_lock<std::mutex> g(_lock);
+      _stats.barriers++;
+      w.next = _pending;
+      _pending = &w;
+      for(;;)
+      {
+        if(w.done)
+        {
+          return std::move(w.r);
+        }
+        if(!_leader_active)
+        {
+          break;
+        }
+        _cond.wait(g);
+      }
+      // Become the leader of the batch, and give others a chance to join it
+      _leader_active = true;
+      if(_window.count() > 0)
+      {
+        g.unlock();
+        std::this_thread::sleep_for(_window);
+        g.lock();
+      }
+      _waiter *batch = _pending;
+      _pending = nullptr;
+      g.unlock();
+      const auto flushes = _flush(batch);
+      g.lock();
+      _stats.batches++;
+      _stats.flushes += flushes;
+      for(auto *i = batch; i != nullptr;)
+      {
+        // Waiters may depart as soon as they are done
+        auto *next = i->next;
+        i->done = true;
+        i = next;
+      }
+      _leader_active = false;
+      _cond.notify_all();
+      return std::move(w.r);
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
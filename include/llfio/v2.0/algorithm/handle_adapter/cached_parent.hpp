@@ -39,28 +39,52 @@ namespace algorithm
 {
   namespace detail
   {
+    struct cached_path_handle_shard_;
     struct LLFIO_DECL cached_path_handle : public std::enable_shared_from_this<cached_path_handle>
     {
-      directory_handle h;
+      directory_handle h;  // closed whilst evicted from the pool of open parent handles
       filesystem::path _lastpath;
+      uint64_t _dev{0}, _ino{0};  // of the directory when first opened, against which reopens are verified
+      cached_path_handle_shard_ *_shard{nullptr};
+      cached_path_handle *_lru_prev{nullptr}, *_lru_next{nullptr};  // within the shard's list of open handles
       explicit cached_path_handle(directory_handle &&_h)
           : h(std::move(_h))
       {
       }
+      cached_path_handle(const cached_path_handle &) = delete;
+      cached_path_handle &operator=(const cached_path_handle &) = delete;
+      LLFIO_HEADERS_ONLY_MEMFUNC_SPEC ~cached_path_handle();
       LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<filesystem::path> current_path(const filesystem::path &append) noexcept;
+      // Reopens the directory if it was evicted
+      LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<path_handle> clone_to_path_handle() noexcept;
     };
     using cached_path_handle_ptr = std::shared_ptr<cached_path_handle>;
     // Passed the base and path of the adapted handle being created, returns a handle to the containing directory and the leafname
     LLFIO_HEADERS_ONLY_FUNC_SPEC std::pair<cached_path_handle_ptr, filesystem::path> get_cached_path_handle(const path_handle &base, path_view path);
   }  // namespace detail
 
+  /*! \brief Sets the maximum number of parent directory handles kept open by all
+  `cached_parent_handle_adapter<T>`, returning the previous maximum. Zero, the default, means no limit.
+
+  The cache is split into sixteen shards, each of which may keep open a sixteenth of the maximum,
+  and at least one. Beyond that, the least recently used handles in the shard are closed, and are
+  transparently reopened by their last known path when next needed. On reopening, the device and inode
+  of the directory are compared to those it had when first opened, and if they differ,
+  `parent_path_handle()` fails with `errc::no_such_file_or_directory`. Whilst a parent is
+  closed, `current_path()` returns its last known path without tracking renames of it.
+
+  Lowering the maximum closes any handles in excess of it immediately.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC size_t set_cached_parent_handle_limit(size_t max_open) noexcept;
+
   /*! \brief Adapts any `construct()`-able implementation to cache its parent directory handle in a process wide cache.
 
   For some use cases where one is calling `parent_path_handle()` or code which calls that function very frequently
   e.g. calling `relink()` or `unlink()` a lot on many files with the same parent directory, having to constantly
   fetch the current path, open the parent directory and verify inodes becomes unhelpfully inefficient. This
   adapter keeps a process-wide hash table of directory handles shared between all instances of this adapter,
-  thus making calling `parent_path_handle()` almost zero cost.
+  thus making calling `parent_path_handle()` almost zero cost. The number of directory handles kept open can
+  be bounded using `set_cached_parent_handle_limit()`.
 
   This adapter is of especial use on platforms which do not reliably implement per-fd path tracking for regular
   files (Apple MacOS, FreeBSD) as `current_path()` is reimplemented to use the current path of the shared parent
@@ -141,8 +165,7 @@ namespace algorithm
     LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<path_handle> parent_path_handle(deadline /* unused */ = std::chrono::seconds(30)) const noexcept override
     {
       LLFIO_LOG_FUNCTION_CALL(this);
-      OUTCOME_TRY(auto &&ret, _sph->h.clone_to_path_handle());
-      return {std::move(ret)};
+      return _sph->clone_to_path_handle();
     }
     LLFIO_HEADERS_ONLY_VIRTUAL_SPEC
     result<void> relink(const path_handle &base, path_view_type newpath, bool atomic_replace = true, deadline d = std::chrono::seconds(30)) noexcept override
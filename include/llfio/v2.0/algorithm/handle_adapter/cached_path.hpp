@@ -0,0 +1,243 @@
+/* A current path caching adapter
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_CACHED_PATH_HANDLE_ADAPTER_HPP
+#define LLFIO_CACHED_PATH_HANDLE_ADAPTER_HPP
+
+#include "../../path_handle.hpp"
+#include "../../stat.hpp"
+
+//! \file handle_adapter/cached_path.hpp Adapts any `handle` to cache its current path
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \brief Adapts any `construct()`-able implementation to cache its current path, revalidating it cheaply.
+
+  `handle::current_path()` asks the kernel for the path of the open handle on every call, which on
+  Linux is a `readlink()` of `/proc/self/fd/N` into a 32Kb buffer. Code which calls it repeatedly,
+  such as error handling and logging, can instead wrap its handles in this adapter, which on each call
+  to `current_path()` checks that the last path returned still leads to the same device and inode as
+  the open handle with a single `lstat()`, only asking the kernel for a fresh path if it does not.
+
+  If the handle was opened by an absolute path, or by a path relative to the working directory, that
+  path is remembered from the moment of opening, and the kernel is never asked for the path unless the
+  file is renamed. `relink()` also remembers the new path if it is absolute. Handles opened relative to
+  a base directory learn their path on the first call to `current_path()`.
+
+  `cached_path()` returns the last known path without any syscalls at all, which suits logging.
+
+  As with `current_path()`, the path returned is not guaranteed to be the one the handle was opened
+  with if the inode has multiple hard links, only that it reached the inode at the time of the check.
+
+  \todo I have been lazy and used public inheritance from that base i/o handle.
+  I should use protected inheritance to prevent slicing, and expose all the public functions by hand.
+  */
+  template <class T> LLFIO_REQUIRES(sizeof(construct<T>) > 0) class LLFIO_DECL cached_path_handle_adapter : public T
+  {
+    static_assert(sizeof(construct<T>) > 0, "Type T must be registered with the construct<T> framework so cached_path_handle_adapter<T> knows how to construct it");  // NOLINT
+
+  public:
+    //! The handle type being adapted
+    using adapted_handle_type = T;
+    using path_type = typename T::path_type;
+    using path_view_type = typename T::path_view_type;
+
+  protected:
+    mutable spinlock _lock;
+    mutable path_type _path;            // the last known path, or empty if unknown
+    mutable uint64_t _dev{0}, _ino{0};  // of the open handle, fetched on first need
+    mutable bool _have_identity{false};
+
+    void _remember(const path_handle &base, path_view path) noexcept
+    {
+      path_type newpath;
+      try
+      {
+        if(!base.is_valid() && !path.empty())
+        {
+          newpath = path.is_absolute() ? path.path() : filesystem::absolute(path.path());
+        }
+      }
+      catch(...)
+      {
+        newpath.clear();  // learn it from the kernel later instead
+      }
+      lock_guard<spinlock> g(_lock);
+      _path = std::move(newpath);
+    }
+    void _forget() noexcept
+    {
+      lock_guard<spinlock> g(_lock);
+      _path.clear();
+      _have_identity = false;
+    }
+
+  public:
+    cached_path_handle_adapter() = default;
+    cached_path_handle_adapter(const cached_path_handle_adapter &) = delete;
+    cached_path_handle_adapter(cached_path_handle_adapter &&o) noexcept
+        : adapted_handle_type(std::move(o))
+        , _path(std::move(o._path))
+        , _dev(o._dev)
+        , _ino(o._ino)
+        , _have_identity(o._have_identity)
+    {
+      o._have_identity = false;
+    }
+    cached_path_handle_adapter &operator=(const cached_path_handle_adapter &) = delete;
+    cached_path_handle_adapter &operator=(cached_path_handle_adapter &&o) noexcept
+    {
+      if(this == &o)
+      {
+        return *this;
+      }
+      this->~cached_path_handle_adapter();
+      new(this) cached_path_handle_adapter(std::move(o));
+      return *this;
+    }
+    cached_path_handle_adapter(adapted_handle_type &&o, const path_handle &base, path_view path)
+        : adapted_handle_type(std::move(o))
+    {
+      _remember(base, path);
+    }
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC ~cached_path_handle_adapter() override
+    {
+      if(this->_v)
+      {
+        (void) cached_path_handle_adapter::close();
+      }
+    }
+
+    //! Returns the last known path of the handle without revalidating it, or an empty path if none is known yet.
+    path_type cached_path() const
+    {
+      lock_guard<spinlock> g(_lock);
+      return _path;
+    }
+
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<path_type> current_path() const noexcept override
+    {
+      LLFIO_LOG_FUNCTION_CALL(this);
+      try
+      {
+        path_type lastpath;
+        uint64_t dev = 0, ino = 0;
+        bool have_identity = false;
+        {
+          lock_guard<spinlock> g(_lock);
+          lastpath = _path;
+          dev = _dev;
+          ino = _ino;
+          have_identity = _have_identity;
+        }
+        if(!have_identity)
+        {
+          stat_t s(nullptr);
+          OUTCOME_TRY(s.fill(*this, stat_t::want::dev | stat_t::want::ino));
+          dev = s.st_dev;
+          ino = s.st_ino;
+          lock_guard<spinlock> g(_lock);
+          _dev = dev;
+          _ino = ino;
+          _have_identity = true;
+        }
+        if(!lastpath.empty())
+        {
+          stat_t::fill_many_item item(lastpath, stat_t::want::dev | stat_t::want::ino);
+          OUTCOME_TRY(stat_t::fill_many(path_handle(), {&item, 1}));
+          if(item.filled && item.stat.st_dev == dev && item.stat.st_ino == ino)
+          {
+            return lastpath;
+          }
+        }
+        OUTCOME_TRY(auto &&currentpath, adapted_handle_type::current_path());
+        lock_guard<spinlock> g(_lock);
+        _path = currentpath;
+        return std::move(currentpath);
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override
+    {
+      LLFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRYV(adapted_handle_type::close());
+      _forget();
+      return success();
+    }
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC native_handle_type release() noexcept override
+    {
+      LLFIO_LOG_FUNCTION_CALL(this);
+      _forget();
+      return adapted_handle_type::release();
+    }
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC
+    result<void> relink(const path_handle &base, path_view_type newpath, bool atomic_replace = true, deadline d = std::chrono::seconds(30)) noexcept override
+    {
+      LLFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRYV(adapted_handle_type::relink(base, newpath, atomic_replace, d));
+      _remember(base, newpath);
+      return success();
+    }
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC
+    result<void> unlink(deadline d = std::chrono::seconds(30)) noexcept override
+    {
+      LLFIO_LOG_FUNCTION_CALL(this);
+      OUTCOME_TRYV(adapted_handle_type::unlink(d));
+      lock_guard<spinlock> g(_lock);
+      _path.clear();
+      return success();
+    }
+  };
+  /*! \brief Constructs a `T` adapted into a current path caching implementation.
+
+  This function works via the `construct<T>()` free function framework for which your `handle`
+  implementation must have registered its construction details.
+  */
+  template <class T, class... Args> inline result<cached_path_handle_adapter<T>> cache_path(Args &&... args) noexcept
+  {
+    construct<T> constructor{std::forward<Args>(args)...};
+    OUTCOME_TRY(auto &&h, constructor());
+    return cached_path_handle_adapter<T>(std::move(h), constructor.base, constructor._path);
+  }
+
+}  // namespace algorithm
+
+//! \brief Constructor for `algorithm::cached_path_handle_adapter<T>`
+template <class T> struct construct<algorithm::cached_path_handle_adapter<T>>
+{
+  construct<T> args;
+  result<algorithm::cached_path_handle_adapter<T>> operator()() const noexcept
+  {
+    OUTCOME_TRY(auto &&h, args());
+    return algorithm::cached_path_handle_adapter<T>(std::move(h), args.base, args._path);
+  }
+};
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
@@ -0,0 +1,593 @@
+/* A handle verifying a checksum of each block of content upon read
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_HANDLE_ADAPTER_CHECKSUMMING_H
+#define LLFIO_ALGORITHM_HANDLE_ADAPTER_CHECKSUMMING_H
+
+#include "combining.hpp"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+//! \file handle_adapter/checksumming.hpp Provides `checksumming_handle_adapter`.
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // Slicing-by-8 tables for CRC32C (the Castagnoli polynomial, reflected)
+    struct crc32c_tables
+    {
+      uint32_t t[8][256];
+      crc32c_tables() noexcept
+      {
+        for(uint32_t n = 0; n < 256; n++)
+        {
+          uint32_t c = n;
+          for(int k = 0; k < 8; k++)
+          {
+            c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : (c >> 1);
+          }
+          t[0][n] = c;
+        }
+        for(uint32_t n = 0; n < 256; n++)
+        {
+          for(int k = 1; k < 8; k++)
+          {
+            t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xff];
+          }
+        }
+      }
+    };
+    inline const crc32c_tables &crc32c_table() noexcept
+    {
+      static const crc32c_tables v;
+      return v;
+    }
+    // Continues a CRC32C whose state has not been inverted
+    inline uint32_t crc32c_update(uint32_t crc, const byte *p, size_t bytes) noexcept
+    {
+#if defined(__SSE4_2__) && (defined(__x86_64__) || defined(_M_X64))
+      uint64_t c = crc;
+      for(; bytes >= 8; bytes -= 8, p += 8)
+      {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+      }
+      crc = (uint32_t) c;
+      for(; bytes > 0; bytes--, p++)
+      {
+        crc = _mm_crc32_u8(crc, (uint8_t) *p);
+      }
+      return crc;
+#elif defined(__ARM_FEATURE_CRC32) && (defined(__aarch64__) || defined(_M_ARM64))
+      for(; bytes >= 8; bytes -= 8, p += 8)
+      {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+      }
+      for(; bytes > 0; bytes--, p++)
+      {
+        crc = __crc32cb(crc, (uint8_t) *p);
+      }
+      return crc;
+#else
+      const auto &t = crc32c_table().t;
+      for(; bytes >= 8; bytes -= 8, p += 8)
+      {
+        // Assumes little endian
+        uint32_t a, b;
+        memcpy(&a, p, 4);
+        memcpy(&b, p + 4, 4);
+        a ^= crc;
+        crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^ t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^ t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^ t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+      }
+      for(; bytes > 0; bytes--, p++)
+      {
+        crc = (crc >> 8) ^ t[0][(crc ^ (uint8_t) *p) & 0xff];
+      }
+      return crc;
+#endif
+    }
+    //! Returns the CRC32C of `bytes` at `p`
+    inline uint32_t crc32c(const byte *p, size_t bytes) noexcept { return ~crc32c_update(~(uint32_t) 0, p, bytes); }
+    /* Writes the CRC32C of each of `count` consecutive blocks of `blocksize` bytes at `p` into `out`.
+    The CRC instruction has a latency of three cycles but can issue every cycle, so three blocks
+    are computed at once to keep it busy.
+    */
+    inline void crc32c_blocks(uint32_t *out, const byte *p, size_t blocksize, size_t count) noexcept
+    {
+      size_t n = 0;
+#if defined(__SSE4_2__) && (defined(__x86_64__) || defined(_M_X64))
+      for(; count - n >= 3; n += 3, p += 3 * blocksize)
+      {
+        uint64_t c0 = 0xffffffff, c1 = 0xffffffff, c2 = 0xffffffff;
+        size_t idx = 0;
+        for(; blocksize - idx >= 8; idx += 8)
+        {
+          uint64_t v0, v1, v2;
+          memcpy(&v0, p + idx, 8);
+          memcpy(&v1, p + blocksize + idx, 8);
+          memcpy(&v2, p + 2 * blocksize + idx, 8);
+          c0 = _mm_crc32_u64(c0, v0);
+          c1 = _mm_crc32_u64(c1, v1);
+          c2 = _mm_crc32_u64(c2, v2);
+        }
+        out[n] = ~crc32c_update((uint32_t) c0, p + idx, blocksize - idx);
+        out[n + 1] = ~crc32c_update((uint32_t) c1, p + blocksize + idx, blocksize - idx);
+        out[n + 2] = ~crc32c_update((uint32_t) c2, p + 2 * blocksize + idx, blocksize - idx);
+      }
+#elif defined(__ARM_FEATURE_CRC32) && (defined(__aarch64__) || defined(_M_ARM64))
+      for(; count - n >= 3; n += 3, p += 3 * blocksize)
+      {
+        uint32_t c0 = 0xffffffff, c1 = 0xffffffff, c2 = 0xffffffff;
+        size_t idx = 0;
+        for(; blocksize - idx >= 8; idx += 8)
+        {
+          uint64_t v0, v1, v2;
+          memcpy(&v0, p + idx, 8);
+          memcpy(&v1, p + blocksize + idx, 8);
+          memcpy(&v2, p + 2 * blocksize + idx, 8);
+          c0 = __crc32cd(c0, v0);
+          c1 = __crc32cd(c1, v1);
+          c2 = __crc32cd(c2, v2);
+        }
+        out[n] = ~crc32c_update(c0, p + idx, blocksize - idx);
+        out[n + 1] = ~crc32c_update(c1, p + blocksize + idx, blocksize - idx);
+        out[n + 2] = ~crc32c_update(c2, p + 2 * blocksize + idx, blocksize - idx);
+      }
+#endif
+      for(; n < count; n++, p += blocksize)
+      {
+        out[n] = crc32c(p, blocksize);
+      }
+    }
+    /* Appends to `out` the CRC32C of each consecutive `blocksize` bytes of the gather buffers, the
+    last of which may be short. Blocks lying within a single buffer are computed in batches.
+    */
+    template <class BuffersType> inline void crc32c_gather(std::vector<uint32_t> &out, const BuffersType &bufs, size_t blocksize)
+    {
+      uint32_t crc = ~(uint32_t) 0;
+      size_t inblock = 0;
+      for(const auto &b : bufs)
+      {
+        const byte *p = b.data();
+        size_t bytes = b.size();
+        if(inblock > 0)
+        {
+          const size_t n = (std::min)(bytes, blocksize - inblock);
+          crc = crc32c_update(crc, p, n);
+          p += n;
+          bytes -= n;
+          inblock += n;
+          if(inblock == blocksize)
+          {
+            out.push_back(~crc);
+            crc = ~(uint32_t) 0;
+            inblock = 0;
+          }
+        }
+        if(inblock == 0 && bytes >= blocksize)
+        {
+          const size_t count = bytes / blocksize, was = out.size();
+          out.resize(was + count);
+          crc32c_blocks(out.data() + was, p, blocksize, count);
+          p += count * blocksize;
+          bytes -= count * blocksize;
+        }
+        if(bytes > 0)
+        {
+          crc = crc32c_update(crc, p, bytes);
+          inblock += bytes;
+        }
+      }
+      if(inblock > 0)
+      {
+        out.push_back(~crc);
+      }
+    }
+
+    template <class Target, class Source> struct checksumming_handle_adapter_op
+    {
+      static_assert(std::is_void<Source>::value, "A second input is not possible with checksumming_handle_adapter");
+      static_assert(std::is_base_of<file_handle, Target>::value, "checksumming_handle_adapter can only adapt file handles");
+
+      using buffer_type = typename Target::buffer_type;
+      using const_buffer_type = typename Target::const_buffer_type;
+      using const_buffers_type = typename Target::const_buffers_type;
+
+      // These are never called, as override_ replaces the reads and writes which would call them
+      static result<buffer_type> do_read(buffer_type out, buffer_type t, buffer_type /*unused*/) noexcept
+      {
+        if(t.size() < out.size())
+        {
+          out = buffer_type(out.data(), t.size());
+        }
+        memcpy(out.data(), t.data(), out.size());
+        return out;
+      }
+      static result<const_buffer_type> do_write(buffer_type t, buffer_type /*unused*/, const_buffer_type in) noexcept
+      {
+        memcpy(t.data(), in.data(), in.size());
+        return const_buffer_type{t.data(), in.size()};
+      }
+      static result<const_buffers_type> adjust_written_buffers(const_buffers_type out, const_buffer_type /*unused*/, const_buffer_type /*unused*/) noexcept { return out; }
+
+      template <class Base> struct override_ : public Base
+      {
+        using extent_type = io_handle::extent_type;
+        using size_type = io_handle::size_type;
+        using mode = io_handle::mode;
+        using flag = io_handle::flag;
+        using barrier_kind = io_handle::barrier_kind;
+        using buffer_type = io_handle::buffer_type;
+        using const_buffer_type = io_handle::const_buffer_type;
+        using buffers_type = io_handle::buffers_type;
+        using const_buffers_type = io_handle::const_buffers_type;
+        template <class T> using io_request = io_handle::io_request<T>;
+        template <class T> using io_result = io_handle::io_result<T>;
+
+      private:
+        file_handle *_checksums{nullptr};
+        size_type _block_size{4096};
+        byte *_scratch{nullptr};  // two blocks, for the content either side of unaligned i/o
+        std::vector<uint32_t> _computed, _stored;
+        std::vector<buffer_type> _gather;
+
+        byte *_scratch_blocks()
+        {
+          if(_scratch == nullptr)
+          {
+            _scratch = utils::page_allocator<byte>().allocate(2 * _block_size);
+          }
+          return _scratch;
+        }
+        // Writes the CRCs computed for consecutive blocks beginning with `block`
+        result<void> _write_checksums(extent_type block, deadline d) noexcept
+        {
+          const_buffer_type b(reinterpret_cast<const byte *>(_computed.data()), _computed.size() * sizeof(uint32_t));
+          OUTCOME_TRY(auto &&written, _checksums->write(io_request<const_buffers_type>({&b, 1}, block * sizeof(uint32_t)), d));
+          if(written.empty() || written[0].size() != b.size())
+          {
+            return errc::io_error;
+          }
+          return success();
+        }
+        // Recomputes the CRCs of all the blocks overlapping [from, to) from the content of the target
+        result<void> _rechecksum(extent_type from, extent_type to, deadline d) noexcept
+        {
+          if(to <= from)
+          {
+            return success();
+          }
+          try
+          {
+            // Whole blocks, short only at the end of the content
+            from -= from % _block_size;
+            to = (to + _block_size - 1) / _block_size * _block_size;
+            const size_type window = (std::max)((size_type) 1, (size_type) (1024 * 1024) / _block_size) * _block_size;
+            OUTCOME_TRY(auto &&temph, map_handle::map((size_type) (std::min)((extent_type) window, to - from)));
+            while(from < to)
+            {
+              buffer_type b(temph.address(), (size_type) (std::min)((extent_type) temph.length(), to - from));
+              OUTCOME_TRY(auto &&got, this->_target->read(io_request<buffers_type>({&b, 1}, from), d));
+              if(got.empty() || got[0].size() == 0)
+              {
+                break;
+              }
+              _computed.clear();
+              crc32c_gather(_computed, got, _block_size);
+              OUTCOME_TRY(_write_checksums(from / _block_size, d));
+              from += got[0].size();
+            }
+            return success();
+          }
+          catch(...)
+          {
+            return error_from_exception();
+          }
+        }
+
+      public:
+        override_() = default;
+        template <class A, class B>
+        override_(A *a, B *b, mode _mode, flag flags, io_multiplexer *ctx, file_handle *checksums, size_type block_size = 4096)
+            : Base(a, b, _mode, flags, ctx)
+            , _checksums(checksums)
+            , _block_size((block_size == 0) ? 4096 : block_size)
+        {
+        }
+        override_(const override_ &) = delete;
+        override_(override_ &&o) noexcept
+            : Base(std::move(o))
+            , _checksums(o._checksums)
+            , _block_size(o._block_size)
+            , _scratch(o._scratch)
+            , _computed(std::move(o._computed))
+            , _stored(std::move(o._stored))
+            , _gather(std::move(o._gather))
+        {
+          o._checksums = nullptr;
+          o._scratch = nullptr;
+        }
+        override_ &operator=(const override_ &) = delete;
+        override_ &operator=(override_ &&) = delete;
+        ~override_()
+        {
+          if(_scratch != nullptr)
+          {
+            utils::page_allocator<byte>().deallocate(_scratch, 2 * _block_size);
+          }
+        }
+
+        //! The handle to which the checksums are written.
+        file_handle *checksums() const noexcept { return _checksums; }
+        //! The bytes of content covered by each checksum.
+        size_type block_size() const noexcept { return _block_size; }
+
+        /*! \brief Recomputes the checksums of all the content from the content, making the checksums
+        consistent with content written without the adapter, or after a crash.
+        */
+        result<void> rechecksum(deadline d = deadline()) noexcept
+        {
+          OUTCOME_TRY(auto &&length, this->_target->maximum_extent());
+          OUTCOME_TRY(_checksums->truncate((length + _block_size - 1) / _block_size * sizeof(uint32_t)));
+          return _rechecksum(0, length, d);
+        }
+
+        //! \brief Closes the handle to which the checksums are written, then closes the attached handle.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override
+        {
+          if(_checksums != nullptr)
+          {
+            OUTCOME_TRY(_checksums->close());
+          }
+          return Base::close();
+        }
+        //! \brief Truncates the attached handle and its checksums, recomputing the checksum of any partial last block.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> truncate(extent_type newsize) noexcept override
+        {
+          OUTCOME_TRY(auto &&oldsize, this->_target->maximum_extent());
+          OUTCOME_TRY(auto &&ret, Base::truncate(newsize));
+          OUTCOME_TRY(_checksums->truncate((newsize + _block_size - 1) / _block_size * sizeof(uint32_t)));
+          if(newsize > oldsize)
+          {
+            OUTCOME_TRY(_rechecksum(oldsize, newsize, {}));
+          }
+          else if(newsize % _block_size != 0)
+          {
+            OUTCOME_TRY(_rechecksum(newsize - 1, newsize, {}));
+          }
+          return ret;
+        }
+        //! \brief Zeroes the attached handle, then recomputes the checksums of the blocks zeroed.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> zero(file_handle::extent_pair extent, deadline d = deadline()) noexcept override
+        {
+          OUTCOME_TRY(auto &&ret, Base::zero(extent, d));
+          OUTCOME_TRY(auto &&length, this->_target->maximum_extent());
+          OUTCOME_TRY(_rechecksum(extent.offset, (std::min)(extent.offset + extent.length, length), d));
+          return ret;
+        }
+
+      protected:
+        /*! \brief Reads the whole blocks covering the request, the parts outside it into scratch, then
+        verifies every block's checksum.
+        */
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> _do_read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override
+        {
+          size_type bytes = 0;
+          for(const auto &b : reqs.buffers)
+          {
+            bytes += b.size();
+          }
+          if(bytes == 0)
+          {
+            return std::move(reqs.buffers);
+          }
+          try
+          {
+            const extent_type first = reqs.offset / _block_size, last = (reqs.offset + bytes - 1) / _block_size;
+            const size_type headlen = (size_type) (reqs.offset - first * _block_size);
+            const size_type taillen = (size_type) ((last + 1) * _block_size - (reqs.offset + bytes));
+            byte *scratch = _scratch_blocks();
+            _gather.clear();
+            if(headlen > 0)
+            {
+              _gather.emplace_back(scratch, headlen);
+            }
+            _gather.insert(_gather.end(), reqs.buffers.begin(), reqs.buffers.end());
+            if(taillen > 0)
+            {
+              _gather.emplace_back(scratch + _block_size, taillen);
+            }
+            OUTCOME_TRY(auto &&got, this->_target->read(io_request<buffers_type>({_gather.data(), _gather.size()}, first * _block_size), d));
+            size_type gotbytes = 0;
+            for(const auto &b : got)
+            {
+              gotbytes += b.size();
+            }
+            if(gotbytes <= headlen)
+            {
+              return buffers_type(reqs.buffers.data(), 0);
+            }
+            _computed.clear();
+            crc32c_gather(_computed, got, _block_size);
+            _stored.resize(_computed.size());
+            buffer_type sb(reinterpret_cast<byte *>(_stored.data()), _stored.size() * sizeof(uint32_t));
+            OUTCOME_TRY(auto &&storedgot, _checksums->read(io_request<buffers_type>({&sb, 1}, first * sizeof(uint32_t)), d));
+            if(storedgot.empty() || storedgot[0].size() != sb.size())
+            {
+              return errc::illegal_byte_sequence;  // content without checksums
+            }
+            if(storedgot[0].data() != sb.data())
+            {
+              memcpy(sb.data(), storedgot[0].data(), sb.size());
+            }
+            if(memcmp(_stored.data(), _computed.data(), sb.size()) != 0)
+            {
+              return errc::illegal_byte_sequence;
+            }
+            // The attached handle may have returned other buffers than those supplied
+            size_type remaining = (std::min)(bytes, gotbytes - headlen);
+            const size_t skip = (headlen > 0) ? 1 : 0;
+            size_t n = 0;
+            for(; n < reqs.buffers.size() && remaining > 0 && n + skip < got.size(); n++)
+            {
+              const auto &b = got[n + skip];
+              reqs.buffers[n] = {b.data(), (std::min)(b.size(), remaining)};
+              remaining -= reqs.buffers[n].size();
+            }
+            return buffers_type(reqs.buffers.data(), n);
+          }
+          catch(...)
+          {
+            return error_from_exception();
+          }
+        }
+        /*! \brief Reads the content of any partially written blocks, writes the request, then writes
+        the checksums of all the blocks it covers.
+        */
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override
+        {
+          size_type bytes = 0;
+          for(const auto &b : reqs.buffers)
+          {
+            bytes += b.size();
+          }
+          if(bytes == 0)
+          {
+            return std::move(reqs.buffers);
+          }
+          try
+          {
+            // Blocks between the current end and the write become zeros, and need checksumming
+            OUTCOME_TRY(auto &&length, this->_target->maximum_extent());
+            if(reqs.offset > length)
+            {
+              OUTCOME_TRY(this->_target->truncate(reqs.offset));
+              OUTCOME_TRY(_rechecksum(length, reqs.offset, d));
+              length = reqs.offset;
+            }
+            const extent_type first = reqs.offset / _block_size, last = (reqs.offset + bytes - 1) / _block_size;
+            const size_type headlen = (size_type) (reqs.offset - first * _block_size);
+            const extent_type end = reqs.offset + bytes;
+            const size_type taillen = (end < length) ? (size_type) (std::min)((last + 1) * _block_size - end, length - end) : 0;
+            byte *scratch = _scratch_blocks();
+            std::vector<const_buffer_type> gather;
+            gather.reserve(reqs.buffers.size() + 2);
+            if(headlen > 0)
+            {
+              buffer_type b(scratch, headlen);
+              OUTCOME_TRY(auto &&got, this->_target->read(io_request<buffers_type>({&b, 1}, first * _block_size), d));
+              if(got.empty() || got[0].size() != headlen)
+              {
+                return errc::io_error;
+              }
+              gather.emplace_back(got[0].data(), headlen);
+            }
+            gather.insert(gather.end(), reqs.buffers.begin(), reqs.buffers.end());
+            if(taillen > 0)
+            {
+              buffer_type b(scratch + _block_size, taillen);
+              OUTCOME_TRY(auto &&got, this->_target->read(io_request<buffers_type>({&b, 1}, end), d));
+              if(got.empty() || got[0].size() != taillen)
+              {
+                return errc::io_error;
+              }
+              gather.emplace_back(got[0].data(), taillen);
+            }
+            _computed.clear();
+            crc32c_gather(_computed, gather, _block_size);
+            OUTCOME_TRY(auto &&written, this->_target->write(reqs, d));
+            size_type writtenbytes = 0;
+            for(const auto &b : written)
+            {
+              writtenbytes += b.size();
+            }
+            if(writtenbytes != bytes)
+            {
+              return errc::io_error;
+            }
+            OUTCOME_TRY(_write_checksums(first, d));
+            return std::move(written);
+          }
+          catch(...)
+          {
+            return error_from_exception();
+          }
+        }
+        //! \brief Issues the barrier on the attached handle, then a whole file barrier on the checksums.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_barrier(io_request<const_buffers_type> reqs, barrier_kind kind, deadline d) noexcept override
+        {
+          OUTCOME_TRY(auto &&ret, this->_target->barrier(reqs, kind, d));
+          OUTCOME_TRY(_checksums->barrier(io_request<const_buffers_type>(), kind, d));
+          return std::move(ret);
+        }
+      };
+    };
+  }  // namespace detail
+
+  /*! \brief A handle verifying a CRC32C checksum of each block of another file handle upon read.
+  \tparam Target The type of the file handle adapted.
+
+  Storage which silently corrupts data is not unknown, and checking with a hash in application
+  code means a second pass over the data. This adapter keeps a 32 bit CRC32C of each `block_size`
+  bytes of the attached handle in the `checksums` file, as an array of native endian integers
+  indexed by block, the last block's checksum covering only the bytes which exist. Writes compute
+  the checksums of the blocks they cover, reading the content of any blocks partially overwritten,
+  and reads are widened to whole blocks, the parts outside the request being read into scratch
+  within the same scatter read, and fail with `errc::illegal_byte_sequence` if any block's
+  checksum differs. The checksums are computed across all the gather buffers in one pass, using
+  the SSE4.2 or ARMv8 CRC instructions if the compiler is permitted them, three blocks at a time.
+
+  Construct with `checksumming_handle_adapter<file_handle>(&fh, nullptr, mode::write, flag::none, nullptr, &checksumsfh, block_size)`.
+
+  - Not thread safe, unlike the handle adapted.
+  - A crash between writing content and writing its checksums leaves blocks which fail to
+  verify. Call `rechecksum()` to recompute all the checksums from the content.
+  - Writes beyond the end, and `truncate()` and `zero()`, read back the content of the blocks
+  they extend or zero to checksum them.
+  - Closing the adapter closes both the attached handle and the checksums handle.
+  */
+  template <class Target> using checksumming_handle_adapter = combining_handle_adapter<detail::checksumming_handle_adapter_op, Target, void>;
+
+  // BEGIN make_free_functions.py
+
+  // END make_free_functions.py
+
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
@@ -0,0 +1,331 @@
+/* A handle coalescing small adjacent writes into large ones
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_HANDLE_ADAPTER_COALESCING_H
+#define LLFIO_ALGORITHM_HANDLE_ADAPTER_COALESCING_H
+
+#include "combining.hpp"
+
+#include <chrono>
+#include <cstring>
+
+//! \file handle_adapter/coalescing.hpp Provides `coalescing_handle_adapter`.
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    template <class Target, class Source> struct coalescing_handle_adapter_op
+    {
+      static_assert(std::is_void<Source>::value, "A second input is not possible with coalescing_handle_adapter");
+      static_assert(std::is_base_of<file_handle, Target>::value, "coalescing_handle_adapter can only adapt file handles");
+
+      using buffer_type = typename Target::buffer_type;
+      using const_buffer_type = typename Target::const_buffer_type;
+      using const_buffers_type = typename Target::const_buffers_type;
+
+      // These are never called, as override_ replaces the reads and writes which would call them
+      static result<buffer_type> do_read(buffer_type out, buffer_type t, buffer_type /*unused*/) noexcept
+      {
+        if(t.size() < out.size())
+        {
+          out = buffer_type(out.data(), t.size());
+        }
+        memcpy(out.data(), t.data(), out.size());
+        return out;
+      }
+      static result<const_buffer_type> do_write(buffer_type t, buffer_type /*unused*/, const_buffer_type in) noexcept
+      {
+        memcpy(t.data(), in.data(), in.size());
+        return const_buffer_type{t.data(), in.size()};
+      }
+      static result<const_buffers_type> adjust_written_buffers(const_buffers_type out, const_buffer_type /*unused*/, const_buffer_type /*unused*/) noexcept { return out; }
+
+      template <class Base> struct override_ : public Base
+      {
+        using extent_type = io_handle::extent_type;
+        using size_type = io_handle::size_type;
+        using mode = io_handle::mode;
+        using flag = io_handle::flag;
+        using barrier_kind = io_handle::barrier_kind;
+        using buffer_type = io_handle::buffer_type;
+        using const_buffer_type = io_handle::const_buffer_type;
+        using buffers_type = io_handle::buffers_type;
+        using const_buffers_type = io_handle::const_buffers_type;
+        template <class T> using io_request = io_handle::io_request<T>;
+        template <class T> using io_result = io_handle::io_result<T>;
+
+      private:
+        size_type _capacity{0};
+        std::chrono::steady_clock::duration _max_age{};
+        byte *_buffer{nullptr};
+        extent_type _buffer_offset{0};
+        size_type _buffer_length{0};
+        std::chrono::steady_clock::time_point _buffer_since;
+
+        // Writes out the buffer. Unless all is set, only up to the last page boundary is written, and
+        // the tail is kept so the write following it can be appended to it.
+        result<void> _flush(deadline d, bool all) noexcept
+        {
+          if(_buffer_length == 0)
+          {
+            return success();
+          }
+          size_type towrite = _buffer_length;
+          if(!all)
+          {
+            const extent_type end = (_buffer_offset + _buffer_length) & ~(extent_type)(utils::page_size() - 1);
+            if(end > _buffer_offset)
+            {
+              towrite = (size_type)(end - _buffer_offset);
+            }
+          }
+          for(size_type written = 0; written < towrite;)
+          {
+            const_buffer_type b(_buffer + written, towrite - written);
+            OUTCOME_TRY(auto &&_, this->_target->write(io_request<const_buffers_type>({&b, 1}, _buffer_offset + written), d));
+            if(_[0].size() == 0)
+            {
+              return errc::io_error;
+            }
+            written += _[0].size();
+          }
+          memmove(_buffer, _buffer + towrite, _buffer_length - towrite);
+          _buffer_offset += towrite;
+          _buffer_length -= towrite;
+          _buffer_since = std::chrono::steady_clock::now();
+          return success();
+        }
+
+      public:
+        override_() = default;
+        template <class A, class B>
+        override_(A *a, B *b, mode _mode, flag flags, io_multiplexer *ctx, size_type capacity = 1024 * 1024,
+                  std::chrono::steady_clock::duration max_age = std::chrono::milliseconds(100))
+            : Base(a, b, _mode, flags, ctx)
+            , _capacity(utils::round_up_to_page_size(capacity, utils::page_size()))
+            , _max_age(max_age)
+        {
+        }
+        override_(const override_ &) = delete;
+        override_(override_ &&o) noexcept
+            : Base(std::move(o))
+            , _capacity(o._capacity)
+            , _max_age(o._max_age)
+            , _buffer(o._buffer)
+            , _buffer_offset(o._buffer_offset)
+            , _buffer_length(o._buffer_length)
+            , _buffer_since(o._buffer_since)
+        {
+          o._buffer = nullptr;
+          o._buffer_length = 0;
+        }
+        override_ &operator=(const override_ &) = delete;
+        override_ &operator=(override_ &&) = delete;
+        //! Writes out any buffered writes, ignoring failure.
+        ~override_()
+        {
+          if(_buffer != nullptr)
+          {
+            (void) _flush({}, true);
+            utils::page_allocator<byte>().deallocate(_buffer, _capacity);
+          }
+        }
+
+        //! The maximum bytes of writes buffered before they are written out.
+        size_type capacity() const noexcept { return _capacity; }
+        //! The bytes of writes currently buffered.
+        size_type buffered() const noexcept { return _buffer_length; }
+        //! Writes out all buffered writes.
+        result<void> flush(deadline d = deadline()) noexcept { return _flush(d, true); }
+
+        //! \brief Writes out all buffered writes, then closes the attached handle.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override
+        {
+          OUTCOME_TRY(_flush({}, true));
+          return Base::close();
+        }
+        //! \brief Return the maximum extent of the attached handle, or the end of the buffered writes if greater.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> maximum_extent() const noexcept override
+        {
+          OUTCOME_TRY(auto &&r, Base::maximum_extent());
+          if(_buffer_length > 0 && _buffer_offset + _buffer_length > r)
+          {
+            r = _buffer_offset + _buffer_length;
+          }
+          return r;
+        }
+        //! \brief Writes out all buffered writes, then truncates the attached handle.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> truncate(extent_type newsize) noexcept override
+        {
+          OUTCOME_TRY(_flush({}, true));
+          return Base::truncate(newsize);
+        }
+        //! \brief Writes out all buffered writes, then zeroes the attached handle.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> zero(file_handle::extent_pair extent, deadline d = deadline()) noexcept override
+        {
+          OUTCOME_TRY(_flush(d, true));
+          return Base::zero(extent, d);
+        }
+
+      protected:
+        //! \brief Reads lying entirely within the buffered writes are served from the buffer, else any overlapping buffered writes are written out first.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> _do_read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override
+        {
+          if(_buffer_length > 0)
+          {
+            size_type bytes = 0;
+            for(const auto &b : reqs.buffers)
+            {
+              bytes += b.size();
+            }
+            const extent_type bufferend = _buffer_offset + _buffer_length;
+            if(reqs.offset >= _buffer_offset && reqs.offset + bytes <= bufferend)
+            {
+              const byte *p = _buffer + (size_type)(reqs.offset - _buffer_offset);
+              for(auto &b : reqs.buffers)
+              {
+                memcpy(b.data(), p, b.size());
+                p += b.size();
+              }
+              return std::move(reqs.buffers);
+            }
+            if(reqs.offset < bufferend && reqs.offset + bytes > _buffer_offset)
+            {
+              OUTCOME_TRY(_flush(d, true));
+            }
+          }
+          return this->_target->read(reqs, d);
+        }
+        //! \brief Small writes are appended to, or overwrite within, the buffered writes, else they are written through.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override
+        {
+          size_type bytes = 0;
+          for(const auto &b : reqs.buffers)
+          {
+            bytes += b.size();
+          }
+          // Large writes, and those with flags, need no coalescing
+          if(bytes >= _capacity || !!reqs.flags)
+          {
+            OUTCOME_TRY(_flush(d, true));
+            return this->_target->write(reqs, d);
+          }
+          if(_buffer == nullptr)
+          {
+            try
+            {
+              _buffer = utils::page_allocator<byte>().allocate(_capacity);
+            }
+            catch(...)
+            {
+              return error_from_exception();
+            }
+          }
+          // Writes neither overwriting nor appending to the buffer begin a new buffer
+          if(_buffer_length > 0 && (reqs.offset < _buffer_offset || reqs.offset > _buffer_offset + _buffer_length))
+          {
+            OUTCOME_TRY(_flush(d, true));
+          }
+          if(_buffer_length == 0)
+          {
+            _buffer_offset = reqs.offset;
+            _buffer_since = std::chrono::steady_clock::now();
+          }
+          extent_type offset = reqs.offset;
+          for(const auto &b : reqs.buffers)
+          {
+            for(size_type done = 0; done < b.size();)
+            {
+              auto pos = (size_type)(offset - _buffer_offset);
+              if(pos == _capacity)
+              {
+                OUTCOME_TRY(_flush(d, false));
+                pos = (size_type)(offset - _buffer_offset);
+              }
+              const auto tocopy = (std::min)(b.size() - done, _capacity - pos);
+              memcpy(_buffer + pos, b.data() + done, tocopy);
+              done += tocopy;
+              offset += tocopy;
+              if(pos + tocopy > _buffer_length)
+              {
+                _buffer_length = pos + tocopy;
+              }
+            }
+          }
+          if(_buffer_length == _capacity || std::chrono::steady_clock::now() - _buffer_since >= _max_age)
+          {
+            OUTCOME_TRY(_flush(d, false));
+          }
+          return std::move(reqs.buffers);
+        }
+        //! \brief Writes out all buffered writes, then issues the barrier on the attached handle.
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_barrier(io_request<const_buffers_type> reqs, barrier_kind kind, deadline d) noexcept override
+        {
+          OUTCOME_TRY(_flush(d, true));
+          return this->_target->barrier(reqs, kind, d);
+        }
+      };
+    };
+  }  // namespace detail
+
+  /*! \brief A handle buffering small adjacent writes to another file handle into large aligned ones.
+  \tparam Target The type of the file handle written to.
+
+  Many writers emit small sequential writes, each of which costs a syscall and, for uncached
+  handles, a read-modify-write of the storage blocks covered. This adapter gathers writes which
+  overwrite or append to the writes already buffered into a buffer of `capacity` bytes, and writes
+  it out in one go when it fills, leaving any tail after the last page boundary in the buffer to
+  be appended to. So a stream of small sequential writes becomes a stream of large page aligned
+  writes, without the writing code needing any changes.
+
+  The buffer is written out:
+  - When it fills, or when a write finds the oldest buffered write is older than `max_age`. There is
+  no background thread, so idle buffers are not written out until the next i/o.
+  - Before any write neither overwriting nor appending to the buffer.
+  - Before any read partially overlapping it. Reads lying entirely within the buffer are served from it.
+  - Before `barrier()`, `truncate()`, `zero()` and `close()`, and by `flush()` and destruction.
+
+  Writes of at least `capacity` bytes, or which have any `write_flag` set, are written through.
+  `maximum_extent()` includes the buffered writes, but `extents()` and `clone_extents_to()` see
+  only what has been written out, so call `flush()` before those.
+
+  Construct with `coalescing_handle_adapter<file_handle>(&fh, nullptr, mode::write, flag::none, nullptr, capacity, max_age)`.
+
+  - Not thread safe, unlike the handle adapted.
+  - The buffer is allocated from `utils::page_allocator` upon first write.
+  */
+  template <class Target> using coalescing_handle_adapter = combining_handle_adapter<detail::coalescing_handle_adapter_op, Target, void>;
+
+  // BEGIN make_free_functions.py
+
+  // END make_free_functions.py
+
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
@@ -161,6 +161,59 @@ namespace algorithm
         }
         return (r == (size_t) -1) ? 1 : r;
       }
+      /*! Read `treq` from the target and `sreq` from the source if there is one, placing
+      the results into `filleds`.
+
+      If both attached handles share an i/o multiplexer, both reads are initiated together
+      and reaped together, so the latency is that of the slower rather than of both.
+      Otherwise, if OpenMP is available, the reads run concurrently upon two threads.
+      Only errors from the multiplexer itself are returned, errors from each read are placed
+      into `filleds`.
+      */
+      result<void> _read_both(optional<io_result<buffers_type>> (&filleds)[2], io_request<buffers_type> treq, io_request<buffers_type> sreq, deadline d) noexcept
+      {
+        io_multiplexer *ctx = _target->multiplexer();
+        if(_have_source && ctx != nullptr && ctx == _source->multiplexer())
+        {
+          LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+          const auto state_reqs = ctx->io_state_requirements();
+          const size_t stride = (state_reqs.first + state_reqs.second - 1) & ~(state_reqs.second - 1);
+          auto *storage = (byte *) alloca(2 * stride + state_reqs.second);
+          const auto diff = (uintptr_t) storage & (state_reqs.second - 1);
+          storage += state_reqs.second - diff;
+          io_multiplexer::io_operation_state *states[2] = {ctx->construct({storage, stride}, _target, nullptr, {}, d, std::move(treq)),
+                                           ctx->construct({storage + stride, stride}, _source, nullptr, {}, d, std::move(sreq))};
+          OUTCOME_TRY(ctx->init_io_operations(states));
+          while(!is_finished(ctx->check_io_operation(states[0])) || !is_finished(ctx->check_io_operation(states[1])))
+          {
+            deadline nd;
+            LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+            OUTCOME_TRY(ctx->check_for_any_completed_io(nd));
+          }
+          for(size_t n = 0; n < 2; n++)
+          {
+            filleds[n] = std::move(*states[n]).get_completed_read();
+            states[n]->~io_operation_state();
+          }
+          return success();
+        }
+#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
+#pragma omp parallel for if(_have_source && (this->_flags & flag::disable_parallelism) == 0)
+#endif
+        for(size_t n = 0; n < 2; n++)
+        {
+          if(n == 0)
+          {
+            filleds[n] = _target->read(treq, d);
+          }
+          else if(_have_source)
+          {
+            filleds[n] = _source->read(sreq, d);
+          }
+        }
+        return success();
+      }
+
       /*! Read from one or both of the attached handles into temporary buffers
       (stack allocated if below a page size), and perform the combining operation
       into the supplied buffers.
@@ -195,21 +248,7 @@ namespace algorithm
 
         // Fill the temporary buffers
         optional<io_result<buffers_type>> _filleds[2];
-#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
-#pragma omp parallel for if(_have_source && (this->_flags & flag::disable_parallelism) == 0)
-#endif
-        for(size_t n = 0; n < 2; n++)
-        {
-          io_request<buffers_type> req({&buffers[n], 1}, reqs.offset);
-          if(n == 0)
-          {
-            _filleds[n] = _target->read(req, d);
-          }
-          else if(_have_source)
-          {
-            _filleds[n] = _source->read(req, d);
-          }
-        }
+        OUTCOME_TRY(_read_both(_filleds, {{&buffers[0], 1}, reqs.offset}, {{&buffers[1], 1}, reqs.offset}, d));
         // Handle any errors
         buffer_type filleds[2];
         {
@@ -263,10 +302,10 @@ namespace algorithm
           auto _bytes = (bytes + 63) & ~63;
           OUTCOME_TRY(auto &&_, map_handle::map(_bytes * (1 + _have_source)));
           buffersh = std::move(_);
-          buffers[0] = buffer_type{buffers[0].data(), bytes};
+          buffers[0] = buffer_type{buffersh.address(), bytes};
           if(_have_source)
           {
-            buffers[1] = buffer_type{buffers[1].data() + _bytes, bytes};
+            buffers[1] = buffer_type{buffersh.address() + _bytes, bytes};
           }
         }
         buffer_type tempbuffers[2] = {buffers[0], buffers[1]};
@@ -434,8 +473,45 @@ namespace algorithm
         }
         return ret;
       }
+      //! \brief Allocate storage in one or both of the attached handles
+      LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<file_handle::extent_pair> allocate(file_handle::extent_pair extent, bool keep_size = false) noexcept override
+      {
+        optional<result<file_handle::extent_pair>> r[2];
+#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
+#pragma omp parallel for if(_have_source && (this->_flags & flag::disable_parallelism) == 0)
+#endif
+        for(size_t n = 0; n < 2; n++)
+        {
+          if(n == 0)
+          {
+            r[n] = this->_target->allocate(extent, keep_size);
+          }
+          else if(_have_source)
+          {
+            r[n] = this->_source->allocate(extent, keep_size);
+          }
+        }
+        // Handle any errors
+        OUTCOME_TRYV(std::move(*r[0]));
+        if(_have_source)
+        {
+          OUTCOME_TRYV(std::move(*r[1]));
+        }
+        return extent;
+      }
+      //! \brief Always returns a failed matching `errc::operation_not_supported`.
+      LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<file_handle::extent_pair> advise(file_handle::extent_pair /*unused*/, file_handle::access_pattern /*unused*/) noexcept override
+      {
+        return errc::operation_not_supported;
+      }
       //! \brief Always returns a failed matching `errc::operation_not_supported` as the meaning of combined valid extents is hard to discern here.
       LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<std::vector<file_handle::extent_pair>> extents() const noexcept override { return errc::operation_not_supported; }
+      //! \brief Always returns a failed matching `errc::operation_not_supported` as the meaning of combined valid extents is hard to discern here.
+      LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<span<file_handle::extent_pair>> extents(span<file_handle::extent_pair> /*unused*/,
+                                                                                   file_handle::extent_pair /*unused*/ = {0, (extent_type) -1}) const noexcept override
+      {
+        return errc::operation_not_supported;
+      }
       //! \brief Punches a hole in one or both attached handles. Note that no combination operation is performed.
       LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> zero(file_handle::extent_pair extent, deadline d = deadline()) noexcept override
       {
@@ -513,9 +589,13 @@ namespace algorithm
   user of the combined handles. If each total request is below a page size, the stack
   is used, else `map_handle::map()` is used to get whole pages.
 
-  \note If OpenMP is available, `LLFIO_DISABLE_OPENMP` is not defined, and
-  `flag::disable_parallelism` is not set, the buffer fill from the two attached handles
-  will be done concurrently.
+  \note If both attached handles have been registered with the same i/o multiplexer, the
+  buffer fill from the two attached handles is initiated through it as a single batch, and
+  combining begins once both have completed, so adapters over two different devices have the
+  read latency of the slower device rather than the sum of both. Otherwise, if OpenMP is
+  available, `LLFIO_DISABLE_OPENMP` is not defined, and `flag::disable_parallelism` is not set,
+  the buffer fill from the two attached handles will be done concurrently. Writes cannot be
+  overlapped like this, as what is written to the target depends upon what is read from the source.
 
   Combined reads may read less than inputs, but note that offset and buffers fetched
   from inputs are those of the request. Combined writes may write less than inputs,
@@ -0,0 +1,245 @@
+/* A handle storing its content redundantly across many file handles
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_HANDLE_ADAPTER_REDUNDANT_H
+#define LLFIO_ALGORITHM_HANDLE_ADAPTER_REDUNDANT_H
+
+#include "../../map_handle.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//! \file handle_adapter/redundant.hpp Provides `redundant_handle_adapter`.
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+namespace algorithm
+{
+  /*! \brief A handle storing its content redundantly across many attached file handles, either
+  mirrored, or Reed-Solomon erasure coded into data and parity shards.
+
+  When mirrored, every attached handle holds a full copy of the content. Writes are issued to all
+  of them in parallel, and each read is served by whichever handle has the fewest reads in flight,
+  ties being broken by the lowest recent latency.
+
+  When erasure coded over `k + m` handles, the content is split into stripes of `k` chunks of
+  `chunk_size()` bytes, the first `k` handles holding the chunks of each stripe, and the last `m`
+  handles holding `m` parity chunks over them computed in GF(2^8) using a Cauchy matrix. Any `m`
+  of the handles can be lost without losing content. Chunk `n` of every stripe is stored
+  consecutively within handle `n`, so large reads and writes are issued to all handles in parallel,
+  aggregating their bandwidth. Reads are served from the data handles directly, with content lost
+  with a handle reconstructed from any `k` of the others. Writes of less than whole stripes read
+  the rest of the stripes written first, and then write whole stripes. The GF(2^8) kernels use
+  SSSE3, AVX2 or NEON as the compiler targets permit.
+
+  An attached handle failing any i/o other than with a timeout is marked as failed, after which
+  it is no longer read nor written until marked otherwise with `set_failed()`, usually after
+  `rebuild()`. Writes succeed so long as enough handles remain to reconstruct the content.
+
+  The maximum extent of an erasure coded adapter is always a whole number of stripes.
+
+  If OpenMP is available, `LLFIO_DISABLE_OPENMP` is not defined, and `flag::disable_parallelism`
+  is not set, i/o to the attached handles is issued concurrently.
+
+  Destroying the adapter does not destroy the attached handles. Closing the adapter does close
+  the attached handles.
+
+  - Concurrent reads are safe, but concurrent writes to the same stripes, and writes concurrent
+  with `rebuild()`, are not.
+  - Byte range locks, extents and cloning are not implemented.
+  */
+  class LLFIO_DECL redundant_handle_adapter : public file_handle
+  {
+  public:
+    using path_type = io_handle::path_type;
+    using extent_type = io_handle::extent_type;
+    using size_type = io_handle::size_type;
+    using mode = io_handle::mode;
+    using creation = io_handle::creation;
+    using caching = io_handle::caching;
+    using flag = io_handle::flag;
+    using buffer_type = io_handle::buffer_type;
+    using const_buffer_type = io_handle::const_buffer_type;
+    using buffers_type = io_handle::buffers_type;
+    using const_buffers_type = io_handle::const_buffers_type;
+    template <class T> using io_request = io_handle::io_request<T>;
+    template <class T> using io_result = io_handle::io_result<T>;
+
+  protected:
+    struct _shard_state
+    {
+      std::atomic<unsigned> inflight{0};
+      std::atomic<uint64_t> latency{0};  // exponentially weighted moving average, in nanoseconds
+      std::atomic<bool> failed{false};
+    };
+    std::vector<file_handle *> _handles;
+    std::unique_ptr<_shard_state[]> _shards;
+    bool _mirrored{true};
+    size_t _data_shards{1};
+    size_type _chunk_size{0};
+    std::vector<uint8_t> _encoding;  // rows of data_shards() coefficients, one per parity shard
+
+    static constexpr native_handle_type _native_handle(mode _mode)
+    {
+      native_handle_type nativeh;
+      nativeh.behaviour |= native_handle_type::disposition::file;
+      nativeh.behaviour |= native_handle_type::disposition::seekable | native_handle_type::disposition::readable;
+      if(_mode == mode::write)
+      {
+        nativeh.behaviour |= native_handle_type::disposition::writable;
+      }
+      return nativeh;
+    }
+
+    redundant_handle_adapter(span<file_handle *const> handles, mode _mode, flag flags)
+        : file_handle(_native_handle(_mode), 0, 0, handles.front()->kernel_caching(), flags, nullptr)
+        , _handles(handles.begin(), handles.end())
+        , _shards(new _shard_state[handles.size()])
+    {
+    }
+
+    // Reads a shard into `bufs`, copying into them if the shard returns other buffers, returning the bytes read
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> _shard_read(size_t idx, span<buffer_type> bufs, extent_type offset, deadline d) noexcept;
+    // Writes all of `bufs` to a shard
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _shard_write(size_t idx, span<const_buffer_type> bufs, extent_type offset, deadline d) noexcept;
+    // Returns the healthy shards in the order in which they ought to be read
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC std::vector<size_t> _read_order(size_t exclude) const;
+    // Returns the coefficients generating shard `idx` from the data_shards() shards in `from`
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::vector<uint8_t>> _decoding(size_t idx, const std::vector<size_t> &from) const;
+    // Regenerates the content of shard `idx` from the other shards into `bufs`, returning the bytes regenerated
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> _reconstruct(size_t idx, span<buffer_type> bufs, extent_type offset, deadline d) noexcept;
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC io_result<buffers_type> _erasure_coded_read(io_request<buffers_type> reqs, deadline d) noexcept;
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC io_result<const_buffers_type> _erasure_coded_write(io_request<const_buffers_type> reqs, deadline d) noexcept;
+
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC size_t _do_max_buffers() const noexcept override { return 0; }
+    //! Reads from the fastest mirror, or from the data shards reconstructing the content of any failed.
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> _do_read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override;
+    //! Writes to all mirrors, or writes whole stripes to all shards.
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override;
+    //! Issues a whole file barrier to all healthy attached handles.
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_barrier(io_request<const_buffers_type> reqs, barrier_kind kind, deadline d) noexcept override;
+
+  public:
+    //! Default constructor
+    redundant_handle_adapter() = default;
+    //! Implicit move construction of redundant_handle_adapter permitted
+    redundant_handle_adapter(redundant_handle_adapter &&o) noexcept
+        : file_handle(std::move(o))
+        , _handles(std::move(o._handles))
+        , _shards(std::move(o._shards))
+        , _mirrored(o._mirrored)
+        , _data_shards(o._data_shards)
+        , _chunk_size(o._chunk_size)
+        , _encoding(std::move(o._encoding))
+    {
+    }
+    //! No copy construction
+    redundant_handle_adapter(const redundant_handle_adapter &) = delete;
+    //! Move assignment of redundant_handle_adapter permitted
+    redundant_handle_adapter &operator=(redundant_handle_adapter &&o) noexcept
+    {
+      if(this == &o)
+      {
+        return *this;
+      }
+      this->~redundant_handle_adapter();
+      new(this) redundant_handle_adapter(std::move(o));
+      return *this;
+    }
+    //! No copy assignment
+    redundant_handle_adapter &operator=(const redundant_handle_adapter &) = delete;
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC ~redundant_handle_adapter() override
+    {
+      // ignore
+    }
+
+    /*! \brief Creates an adapter mirroring its content across all of `handles`.
+    \errors `errc::invalid_argument` if `handles` is empty or contains a null handle.
+    */
+    static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter> mirrored(span<file_handle *const> handles, mode _mode = mode::write, flag flags = flag::none) noexcept;
+    /*! \brief Creates an adapter erasure coding its content across `handles`, the last `parity_shards`
+    of which hold parity.
+    \errors `errc::invalid_argument` if there is not at least one data shard and one parity
+    shard, there are more than 256 handles, any handle is null, or `chunk_size` is zero.
+    */
+    static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter> erasure_coded(span<file_handle *const> handles, size_t parity_shards, size_type chunk_size = 65536, mode _mode = mode::write,
+                                                                                         flag flags = flag::none) noexcept;
+
+    //! True if mirrored, false if erasure coded.
+    bool is_mirrored() const noexcept { return _mirrored; }
+    //! The attached handles.
+    span<file_handle *const> handles() const noexcept { return {_handles.data(), _handles.size()}; }
+    //! The number of attached handles holding data. Always one if mirrored.
+    size_t data_shards() const noexcept { return _data_shards; }
+    //! The number of attached handles holding parity, or the number of additional mirrors.
+    size_t parity_shards() const noexcept { return _handles.size() - _data_shards; }
+    //! The bytes of each chunk of each stripe, or zero if mirrored.
+    size_type chunk_size() const noexcept { return _chunk_size; }
+    //! True if the attached handle at `idx` has been marked as failed.
+    bool is_failed(size_t idx) const noexcept { return _shards[idx].failed.load(std::memory_order_relaxed); }
+    //! Marks the attached handle at `idx` as failed, or as healthy.
+    void set_failed(size_t idx, bool failed = true) noexcept { _shards[idx].failed.store(failed, std::memory_order_relaxed); }
+
+    /*! \brief Regenerates the entire content of the attached handle at `idx` from the other attached
+    handles, and marks it as healthy. Use after replacing a failed handle.
+    \errors `errc::io_error` if not enough healthy handles remain, else any of the values the i/o of the
+    attached handles can return.
+    */
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> rebuild(size_t idx, deadline d = deadline()) noexcept;
+
+    //! \brief Closes all of the attached handles.
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override;
+    //! \brief The least maximum extent of the healthy attached handles, in terms of the content.
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> maximum_extent() const noexcept override;
+    //! \brief Truncates all healthy attached handles. If erasure coded, rounds `newsize` up to a whole number of stripes.
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> truncate(extent_type newsize) noexcept override;
+    //! \brief Zeroes all healthy mirrors, or writes zeros if erasure coded.
+    LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> zero(extent_pair extent, deadline d = deadline()) noexcept override;
+  };
+
+  // BEGIN make_free_functions.py
+
+  // END make_free_functions.py
+
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#include "../../detail/impl/redundant_handle_adapter.ipp"
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
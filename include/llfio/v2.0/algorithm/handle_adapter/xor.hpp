@@ -27,6 +27,12 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "combining.hpp"
 
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
 //! \file handle_adapter/xor.hpp Provides `xor_handle_adapter`.
 
 LLFIO_V2_NAMESPACE_EXPORT_BEGIN
@@ -36,6 +42,53 @@ namespace algorithm
 
   namespace detail
   {
+    /* XOR `bytes` of `a` with `b` into `out`, which may be either of the inputs. No alignment
+    is required of any of them, as unaligned SIMD loads and stores cost the same as aligned ones
+    on all recent CPUs.
+    */
+    inline void xor_handle_adapter_xor(byte *out, const byte *a, const byte *b, size_t bytes) noexcept
+    {
+      size_t idx = 0;
+#if defined(__AVX512F__)
+      for(; bytes - idx >= 64; idx += 64)
+      {
+        const __m512i x = _mm512_loadu_si512((const void *) (a + idx)), y = _mm512_loadu_si512((const void *) (b + idx));
+        _mm512_storeu_si512((void *) (out + idx), _mm512_xor_si512(x, y));
+      }
+#endif
+#if defined(__AVX2__)
+      for(; bytes - idx >= 32; idx += 32)
+      {
+        const __m256i x = _mm256_loadu_si256((const __m256i *) (a + idx)), y = _mm256_loadu_si256((const __m256i *) (b + idx));
+        _mm256_storeu_si256((__m256i *) (out + idx), _mm256_xor_si256(x, y));
+      }
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+      for(; bytes - idx >= 16; idx += 16)
+      {
+        const __m128i x = _mm_loadu_si128((const __m128i *) (a + idx)), y = _mm_loadu_si128((const __m128i *) (b + idx));
+        _mm_storeu_si128((__m128i *) (out + idx), _mm_xor_si128(x, y));
+      }
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+      for(; bytes - idx >= 16; idx += 16)
+      {
+        vst1q_u8((uint8_t *) (out + idx), veorq_u8(vld1q_u8((const uint8_t *) (a + idx)), vld1q_u8((const uint8_t *) (b + idx))));
+      }
+#endif
+      for(; bytes - idx >= sizeof(uint64_t); idx += sizeof(uint64_t))
+      {
+        uint64_t x, y;
+        memcpy(&x, a + idx, sizeof(x));
+        memcpy(&y, b + idx, sizeof(y));
+        x ^= y;
+        memcpy(out + idx, &x, sizeof(x));
+      }
+      for(; idx < bytes; idx++)
+      {
+        out[idx] = a[idx] ^ b[idx];
+      }
+    }
+
     template <class Target, class Source> struct xor_handle_adapter_op
     {
       static_assert(!std::is_void<Source>::value, "Optional second input is not possible with xor_handle_adapter");
@@ -55,118 +108,14 @@ namespace algorithm
         {
           out = buffer_type(out.data(), s.size());
         }
-        for(size_t idx = 0; idx < out.size();)
-        {
-          {
-            // If addresses happen to align to SIMD, hint very strongly to use SIMD
-            uintptr_t remain1 = ((uintptr_t) out.data() + idx) & 63;
-            uintptr_t remain2 = ((uintptr_t) t.data() + idx) & 63;
-            uintptr_t remain3 = ((uintptr_t) s.data() + idx) & 63;
-            if(remain1 == 0 && remain2 == 0 && remain3 == 0)
-            {
-              while(out.size() - idx >= 64)
-              {
-                uint64_t *a = (uint64_t *) (out.data() + idx);
-                const uint64_t *b = (const uint64_t *) (t.data() + idx);
-                const uint64_t *c = (const uint64_t *) (s.data() + idx);
-                a[0] = b[0] ^ c[0];
-                a[1] = b[1] ^ c[1];
-                a[2] = b[2] ^ c[2];
-                a[3] = b[3] ^ c[3];
-                a[4] = b[4] ^ c[4];
-                a[5] = b[5] ^ c[5];
-                a[6] = b[6] ^ c[6];
-                a[7] = b[7] ^ c[7];
-                idx += 64;
-              }
-            }
-          }
-          {
-            // If addresses happen to align to registers, use that
-            uintptr_t remain1 = ((uintptr_t) out.data() + idx) & (sizeof(uintptr_t) - 1);
-            uintptr_t remain2 = ((uintptr_t) t.data() + idx) & (sizeof(uintptr_t) - 1);
-            uintptr_t remain3 = ((uintptr_t) s.data() + idx) & (sizeof(uintptr_t) - 1);
-            if(remain1 == 0 && remain2 == 0 && remain3 == 0)
-            {
-              while(out.size() - idx >= sizeof(uintptr_t))
-              {
-                uintptr_t *a = (uintptr_t *) (out.data() + idx);
-                const uintptr_t *b = (const uintptr_t *) (t.data() + idx);
-                const uintptr_t *c = (const uintptr_t *) (s.data() + idx);
-                a[0] = b[0] ^ c[0];
-                idx += sizeof(uintptr_t);
-              }
-            }
-          }
-          // Otherwise byte work
-          while(out.size() - idx > 0)
-          {
-            uint8_t *a = (uint8_t *) (out.data() + idx);
-            const uint8_t *b = (const uint8_t *) (t.data() + idx);
-            const uint8_t *c = (const uint8_t *) (s.data() + idx);
-            a[0] = b[0] ^ c[0];
-            idx += 1;
-          }
-        }
+        xor_handle_adapter_xor(out.data(), t.data(), s.data(), out.size());
         return out;
       }
 
       static result<const_buffer_type> do_write(buffer_type t, buffer_type s, const_buffer_type in) noexcept
       {
         // in is the constraint here
-        for(size_t idx = 0; idx < in.size();)
-        {
-          {
-            // If addresses happen to align to SIMD, hint very strongly to use SIMD
-            uintptr_t remain1 = ((uintptr_t) t.data() + idx) & 63;
-            uintptr_t remain2 = ((uintptr_t) s.data() + idx) & 63;
-            uintptr_t remain3 = ((uintptr_t) in.data() + idx) & 63;
-            if(remain1 == 0 && remain2 == 0 && remain3 == 0)
-            {
-              while(in.size() - idx >= 64)
-              {
-                uint64_t *a = (uint64_t *) (t.data() + idx);
-                const uint64_t *b = (const uint64_t *) (s.data() + idx);
-                const uint64_t *c = (const uint64_t *) (in.data() + idx);
-                a[0] = b[0] ^ c[0];
-                a[1] = b[1] ^ c[1];
-                a[2] = b[2] ^ c[2];
-                a[3] = b[3] ^ c[3];
-                a[4] = b[4] ^ c[4];
-                a[5] = b[5] ^ c[5];
-                a[6] = b[6] ^ c[6];
-                a[7] = b[7] ^ c[7];
-                idx += 64;
-              }
-            }
-          }
-          {
-            // If addresses happen to align to registers, use that
-            uintptr_t remain1 = ((uintptr_t) t.data() + idx) & (sizeof(uintptr_t) - 1);
-            uintptr_t remain2 = ((uintptr_t) s.data() + idx) & (sizeof(uintptr_t) - 1);
-            uintptr_t remain3 = ((uintptr_t) in.data() + idx) & (sizeof(uintptr_t) - 1);
-            if(remain1 == 0 && remain2 == 0 && remain3 == 0)
-            {
-              while(in.size() - idx >= sizeof(uintptr_t))
-              {
-                uintptr_t *a = (uintptr_t *) (t.data() + idx);
-                const uintptr_t *b = (const uintptr_t *) (s.data() + idx);
-                const uintptr_t *c = (const uintptr_t *) (in.data() + idx);
-                a[0] = b[0] ^ c[0];
-                idx += sizeof(uintptr_t);
-              }
-            }
-          }
-          // Otherwise byte work
-          while(in.size() - idx > 0)
-          {
-            uint8_t *a = (uint8_t *) (t.data() + idx);
-            const uint8_t *b = (const uint8_t *) (s.data() + idx);
-            const uint8_t *c = (const uint8_t *) (in.data() + idx);
-            a[0] = b[0] ^ c[0];
-            idx += 1;
-          }
-        }
+        xor_handle_adapter_xor(t.data(), s.data(), in.data(), in.size());
         // Adjust buffers returned to bytes read from in!
         t = {t.data(), in.size()};
         return t;
@@ -197,10 +146,192 @@ namespace algorithm
         return out;
       }
 
+      /* Replaces the default read and write, which gather both inputs into temporary buffers
+      as big as the request, with ones which work upon the caller's buffers in place, and which
+      stream the source through one temporary buffer of at most `_chunk_size` bytes.
+      */
       template <class Base> struct override_ : public Base
       {
+        using size_type = typename Base::size_type;
+        using buffer_type = typename Base::buffer_type;
+        using const_buffer_type = typename Base::const_buffer_type;
+        using buffers_type = typename Base::buffers_type;
+        using const_buffers_type = typename Base::const_buffers_type;
+        template <class T> using io_request = typename Base::template io_request<T>;
+        template <class T> using io_result = typename Base::template io_result<T>;
+
         override_() = default;
         using Base::Base;
+
+      protected:
+        static constexpr size_type _chunk_size = 1024 * 1024;
+
+        // Truncates `buffers` to total `bytes`
+        template <class Buffers> static Buffers _truncate(Buffers buffers, size_type bytes) noexcept
+        {
+          size_t n = 0;
+          for(; n < buffers.size() && bytes > 0; n++)
+          {
+            if(buffers[n].size() > bytes)
+            {
+              buffers[n] = {buffers[n].data(), bytes};
+            }
+            bytes -= buffers[n].size();
+          }
+          return {buffers.data(), n};
+        }
+
+        /*! Read the target directly into the supplied buffers, and XOR the source into them
+        in place a chunk at a time. Returns the lesser of the bytes available from each. The
+        target and the first chunk of the source are read concurrently where possible.
+        */
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> _do_read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override
+        {
+          size_type bytes = 0;
+          for(const auto &b : reqs.buffers)
+          {
+            bytes += b.size();
+          }
+          if(bytes == 0)
+          {
+            return std::move(reqs.buffers);
+          }
+          // The target may return buffers other than those supplied, so remember those supplied
+          auto *out = static_cast<buffer_type *>(alloca(sizeof(buffer_type) * reqs.buffers.size()));
+          for(size_t n = 0; n < reqs.buffers.size(); n++)
+          {
+            new(out + n) buffer_type(reqs.buffers[n]);
+          }
+
+          // If less than page size, use stack, else use free pages
+          const size_type chunk = (bytes < _chunk_size) ? bytes : _chunk_size;
+          map_handle temph;
+          byte *temp = (chunk <= utils::page_size()) ? static_cast<byte *>(alloca(chunk)) : nullptr;
+          if(temp == nullptr)
+          {
+            OUTCOME_TRY(auto &&_, map_handle::map(chunk));
+            temph = std::move(_);
+            temp = temph.address();
+          }
+
+          buffer_type sb{temp, chunk};
+          optional<io_result<buffers_type>> filleds[2];
+          OUTCOME_TRY(this->_read_both(filleds, reqs, {{&sb, 1}, reqs.offset}, d));
+          OUTCOME_TRY(auto &&filled, std::move(*filleds[0]));
+          bytes = 0;
+          for(const auto &b : filled)
+          {
+            bytes += b.size();
+          }
+
+          size_type done = 0;
+          size_t bi = 0, bpos = 0;  // position within the supplied buffers
+          while(done < bytes)
+          {
+            if(!filleds[1])
+            {
+              sb = {temp, (bytes - done < chunk) ? (bytes - done) : chunk};
+              filleds[1] = this->_source->read(io_request<buffers_type>({&sb, 1}, reqs.offset + done), d);
+            }
+            OUTCOME_TRY(auto &&s, std::move(*filleds[1]));
+            filleds[1].reset();
+            const byte *src = s.empty() ? temp : s[0].data();
+            size_type sbytes = s.empty() ? 0 : s[0].size();
+            const bool short_source = sbytes < sb.size();
+            if(sbytes > bytes - done)
+            {
+              sbytes = bytes - done;
+            }
+            for(size_type k = 0; k < sbytes;)
+            {
+              const size_type n = (filled[bi].size() - bpos < sbytes - k) ? (filled[bi].size() - bpos) : (sbytes - k);
+              xor_handle_adapter_xor(out[bi].data() + bpos, filled[bi].data() + bpos, src + k, n);
+              k += n;
+              bpos += n;
+              if(bpos == filled[bi].size())
+              {
+                bi++;
+                bpos = 0;
+              }
+            }
+            done += sbytes;
+            if(short_source)
+            {
+              // The source is shorter than the target
+              break;
+            }
+          }
+          for(size_t n = 0; n < filled.size(); n++)
+          {
+            reqs.buffers[n] = {out[n].data(), filled[n].size()};
+          }
+          return _truncate(buffers_type(reqs.buffers.data(), filled.size()), done);
+        }
+
+        /*! Read the source a chunk at a time, XOR the supplied buffers into it in place, and write
+        the result to the target. Bytes beyond the end of the source are written unchanged.
+
+        \todo Relative deadline is not being adjusted for source read time.
+        */
+        LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override
+        {
+          size_type bytes = 0;
+          for(const auto &b : reqs.buffers)
+          {
+            bytes += b.size();
+          }
+          if(bytes == 0)
+          {
+            return std::move(reqs.buffers);
+          }
+
+          // If less than page size, use stack, else use free pages
+          const size_type chunk = (bytes < _chunk_size) ? bytes : _chunk_size;
+          map_handle temph;
+          byte *temp = (chunk <= utils::page_size()) ? static_cast<byte *>(alloca(chunk)) : nullptr;
+          if(temp == nullptr)
+          {
+            OUTCOME_TRY(auto &&_, map_handle::map(chunk));
+            temph = std::move(_);
+            temp = temph.address();
+          }
+
+          size_type done = 0;
+          size_t bi = 0, bpos = 0;  // position within the supplied buffers
+          while(done < bytes)
+          {
+            const size_type thischunk = (bytes - done < chunk) ? (bytes - done) : chunk;
+            buffer_type sb{temp, thischunk};
+            OUTCOME_TRY(auto &&s, this->_source->read(io_request<buffers_type>({&sb, 1}, reqs.offset + done), d));
+            const size_type sbytes = s.empty() ? 0 : s[0].size();
+            if(sbytes > 0 && s[0].data() != temp)
+            {
+              memcpy(temp, s[0].data(), sbytes);
+            }
+            memset(temp + sbytes, 0, thischunk - sbytes);
+            for(size_type k = 0; k < thischunk;)
+            {
+              const size_type n = (reqs.buffers[bi].size() - bpos < thischunk - k) ? (reqs.buffers[bi].size() - bpos) : (thischunk - k);
+              xor_handle_adapter_xor(temp + k, temp + k, reqs.buffers[bi].data() + bpos, n);
+              k += n;
+              bpos += n;
+              if(bpos == reqs.buffers[bi].size())
+              {
+                bi++;
+                bpos = 0;
+              }
+            }
+            const_buffer_type tb{temp, thischunk};
+            OUTCOME_TRY(auto &&written, this->_target->write(io_request<const_buffers_type>({&tb, 1}, reqs.offset + done), d));
+            const size_type wbytes = written.empty() ? 0 : written[0].size();
+            done += wbytes;
+            if(wbytes < thischunk)
+            {
+              break;
+            }
+          }
+          return _truncate(std::move(reqs.buffers), done);
+        }
       };
     };
   }
@@ -210,6 +341,10 @@ namespace algorithm
   second handle are XORed together and written to the first handle.
   \tparam Source The type of the second handle with which to XOR the target handle.
 
+  Reads and writes work upon the caller's buffers in place using SIMD where available, streaming the
+  source through a single temporary buffer of at most a megabyte, so requests of any size never
+  allocate more than that.
+
   \warning This class is still in development, do not use.
   */
   template <class Target, class Source> using xor_handle_adapter = combining_handle_adapter<detail::xor_handle_adapter_op, Target, Source>;
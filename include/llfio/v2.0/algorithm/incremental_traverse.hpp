@@ -0,0 +1,331 @@
+/* An incremental directory tree traversal algorithm
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_INCREMENTAL_TRAVERSE_HPP
+#define LLFIO_ALGORITHM_INCREMENTAL_TRAVERSE_HPP
+
+#include "traverse.hpp"
+
+#include "../file_handle.hpp"
+#include "../stat.hpp"
+
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+
+//! \file incremental_traverse.hpp Provides a directory tree traversal algorithm which skips directories unchanged since a checkpoint.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \brief A record of the state of every directory seen by an `incremental_traverse()`, against
+  which the next incremental traversal is compared.
+
+  A directory is identified by its device and inode, so renaming or moving a directory does not
+  cause it to appear changed, though its parent will. Each directory's last modification time and
+  generation number (where the platform supports one) are recorded.
+
+  Checkpoints can be saved to, and loaded from, a file so they persist between runs of a program.
+  */
+  struct traverse_checkpoint
+  {
+    //! The recorded state of a directory
+    struct directory_state
+    {
+      int64_t mtime{0};  //!< Last modification time, in nanoseconds since the system clock's epoch
+      uint64_t gen{0};   //!< Generation number, or zero if the platform has none
+    };
+    //! The key identifying a directory
+    struct key_type
+    {
+      uint64_t dev{0};  //!< The device containing the directory
+      uint64_t ino{0};  //!< The inode of the directory
+      constexpr bool operator==(const key_type &o) const noexcept { return dev == o.dev && ino == o.ino; }
+    };
+    struct _key_hasher
+    {
+      size_t operator()(const key_type &k) const noexcept
+      {
+        auto x = k.ino ^ (k.dev * 0x9e3779b97f4a7c15ULL);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return (size_t) x;
+      }
+    };
+    using map_type = std::unordered_map<key_type, directory_state, _key_hasher>;
+
+    //! When the traversal which made this checkpoint began, in nanoseconds since the system clock's epoch
+    int64_t taken{0};
+    //! The state of every directory traversed
+    map_type directories;
+    //! The number of directories found changed, or not in the previous checkpoint
+    size_t directories_changed{0};
+    //! The number of directories found unchanged from the previous checkpoint
+    size_t directories_unchanged{0};
+
+    //! True if this checkpoint records no directories, as is the case for a default constructed checkpoint
+    bool empty() const noexcept { return directories.empty(); }
+
+    //! Returns the current time in the units of `taken` and `directory_state::mtime`
+    static int64_t now() noexcept { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count(); }
+
+  private:
+    static constexpr uint64_t _magic = 0x4b48435452564e49ULL;  // "INVRTCHK"
+    struct _file_header_t
+    {
+      uint64_t magic;
+      uint64_t count;
+      int64_t taken;
+      uint64_t reserved;
+    };
+    struct _file_record_t
+    {
+      uint64_t dev, ino;
+      int64_t mtime;
+      uint64_t gen;
+    };
+
+  public:
+    /*! \brief Replaces the contents of `fh` with this checkpoint.
+
+    The format is native endian, and so not portable between platforms.
+    */
+    result<void> save(file_handle &fh) const noexcept
+    {
+      try
+      {
+        std::vector<_file_record_t> records;
+        records.reserve(directories.size());
+        for(auto &i : directories)
+        {
+          records.push_back({i.first.dev, i.first.ino, i.second.mtime, i.second.gen});
+        }
+        _file_header_t header{_magic, records.size(), taken, 0};
+        OUTCOME_TRYV(fh.truncate(0));
+        OUTCOME_TRYV(fh.write(0, {{reinterpret_cast<const byte *>(&header), sizeof(header)},
+                                  {reinterpret_cast<const byte *>(records.data()), records.size() * sizeof(_file_record_t)}}));
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    /*! \brief Loads a checkpoint previously saved into `fh`. An empty file loads an empty checkpoint.
+
+    \errors `errc::illegal_byte_sequence` if the file does not contain a checkpoint, else any of the
+    values `file_handle::read()` can return.
+    */
+    static result<traverse_checkpoint> load(file_handle &fh) noexcept
+    {
+      try
+      {
+        result<traverse_checkpoint> ret(in_place_type<traverse_checkpoint>);
+        OUTCOME_TRY(auto &&length, fh.maximum_extent());
+        if(length == 0)
+        {
+          return ret;
+        }
+        _file_header_t header{};
+        OUTCOME_TRY(auto &&headerread, fh.read(0, {{reinterpret_cast<byte *>(&header), sizeof(header)}}));
+        if(headerread != sizeof(header) || header.magic != _magic ||
+           length != sizeof(header) + header.count * sizeof(_file_record_t))
+        {
+          return errc::illegal_byte_sequence;
+        }
+        std::vector<_file_record_t> records((size_t) header.count);
+        OUTCOME_TRY(auto &&recordsread, fh.read(sizeof(header), {{reinterpret_cast<byte *>(records.data()), records.size() * sizeof(_file_record_t)}}));
+        if(recordsread != records.size() * sizeof(_file_record_t))
+        {
+          return errc::illegal_byte_sequence;
+        }
+        auto &cp = ret.assume_value();
+        cp.taken = header.taken;
+        cp.directories.reserve(records.size());
+        for(auto &i : records)
+        {
+          cp.directories[{i.dev, i.ino}] = {i.mtime, i.gen};
+        }
+        return ret;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+  };
+
+  //! The state of an `incremental_traverse()`, which is the `data` passed to `traverse()`.
+  struct incremental_traversal_state
+  {
+    const traverse_checkpoint *previous{nullptr};  //!< The checkpoint being compared against
+    traverse_checkpoint current;                   //!< The checkpoint being built
+    void *data{nullptr};                           //!< The third party data pointer passed to `incremental_traverse()`
+    spinlock _lock;
+    std::atomic<size_t> _changed{0}, _unchanged{0};
+  };
+
+  /*! \brief A visitor for the incremental filesystem traversal algorithm.
+
+  Note that at any time, returning a failure causes `incremental_traverse()` to exit as soon
+  as possible with the same failure.
+
+  Override `changed_enumeration()` rather than `post_enumeration()`. The `data` pointer passed to
+  the members inherited from `traverse_visitor` is the `incremental_traversal_state`, whose `data`
+  member is the third party data pointer passed to `incremental_traverse()`.
+  */
+  struct incremental_traverse_visitor : public traverse_visitor
+  {
+    /*! \brief Called just after enumerating a directory which has changed since the previous
+    checkpoint, or which is not in it. As with `post_enumeration()`, you can modify the results
+    to affect the traversal.
+
+    The default does nothing.
+
+    \note May be called from multiple kernel threads concurrently.
+    */
+    virtual result<void> changed_enumeration(void *data, const directory_handle &dirh, directory_handle::buffers_type &contents, size_t depth) noexcept
+    {
+      (void) data;
+      (void) dirh;
+      (void) contents;
+      (void) depth;
+      return success();
+    }
+
+    /*! \brief Called just after enumerating a directory which has not changed since the previous
+    checkpoint.
+
+    The default causes every entry which is not a directory to be ignored, so that only the
+    subdirectories are traversed into.
+
+    \note May be called from multiple kernel threads concurrently.
+    */
+    virtual result<void> unchanged_enumeration(void *data, const directory_handle &dirh, directory_handle::buffers_type &contents, size_t depth) noexcept
+    {
+      (void) data;
+      (void) dirh;
+      (void) depth;
+      for(auto &entry : contents)
+      {
+        if(entry.stat.st_type != filesystem::file_type::directory)
+        {
+          entry.stat = stat_t(nullptr);
+        }
+      }
+      return success();
+    }
+
+    //! This override records the directory into the checkpoint being built, and calls `changed_enumeration()` or `unchanged_enumeration()`.
+    virtual result<void> post_enumeration(void *data, const directory_handle &dirh, directory_handle::buffers_type &contents, size_t depth) noexcept override
+    {
+      try
+      {
+        auto *state = (incremental_traversal_state *) data;
+        stat_t s(nullptr);
+        OUTCOME_TRY(s.fill(dirh, stat_t::want::dev | stat_t::want::ino | stat_t::want::mtim | stat_t::want::gen));
+        const traverse_checkpoint::key_type key{s.st_dev, s.st_ino};
+        const traverse_checkpoint::directory_state now{std::chrono::duration_cast<std::chrono::nanoseconds>(s.st_mtim.time_since_epoch()).count(), s.st_gen};
+        bool changed = true;
+        if(state->previous != nullptr)
+        {
+          auto it = state->previous->directories.find(key);
+          // Modifications within a second of the previous checkpoint being taken may share its timestamp, so are always rescanned
+          changed = (it == state->previous->directories.end() || it->second.mtime != now.mtime || it->second.gen != now.gen ||
+                     it->second.mtime + 1000000000LL > state->previous->taken);
+        }
+        {
+          lock_guard<spinlock> g(state->_lock);
+          state->current.directories[key] = now;
+        }
+        if(changed)
+        {
+          state->_changed.fetch_add(1, std::memory_order_relaxed);
+          return changed_enumeration(state->data, dirh, contents, depth);
+        }
+        state->_unchanged.fetch_add(1, std::memory_order_relaxed);
+        return unchanged_enumeration(state->data, dirh, contents, depth);
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+  };
+
+  /*! \brief Traverse everything within and under `dirh`, telling the visitor which directories
+  have had entries created, deleted or renamed since `previous` was taken, and returning a new
+  checkpoint for the next incremental traversal.
+
+  A directory's modification time changes only when its own entries change, so every subdirectory
+  of an unchanged directory must still be visited, but the entries of unchanged directories need no
+  further processing. For a backup of a tree of millions of files, that leaves the few thousand
+  directories which actually changed to be examined entry by entry. Note that a file modified in
+  place does not change its directory, so callers needing to detect content changes must still
+  compare file timestamps within unchanged directories, or override `unchanged_enumeration()`.
+
+  This is a trivial implementation on top of `algorithm::traverse()`, indeed it is implemented
+  entirely as header code. You should review the documentation for `algorithm::traverse()`, as
+  this algorithm is entirely implemented using that algorithm. It costs one `fstat()` per directory
+  more than a plain traversal. Passing a default constructed checkpoint treats every directory as
+  changed.
+
+  Change journals (the NTFS USN journal, or Linux `fanotify()` with `FAN_REPORT_DIR_FID`) could
+  avoid visiting unchanged subtrees entirely, however they need a privileged process continuously
+  recording changes since the previous checkpoint, and so are outside the scope of this algorithm.
+  */
+  inline result<traverse_checkpoint> incremental_traverse(const path_handle &dirh, const traverse_checkpoint &previous,
+                                                          incremental_traverse_visitor *visitor = nullptr, size_t threads = 0, void *data = nullptr,
+                                                          bool force_slow_path = false) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(&dirh);
+    incremental_traverse_visitor default_visitor;
+    if(visitor == nullptr)
+    {
+      visitor = &default_visitor;
+    }
+    try
+    {
+      incremental_traversal_state state;
+      state.previous = previous.empty() ? nullptr : &previous;
+      state.current.taken = traverse_checkpoint::now();
+      state.data = data;
+      OUTCOME_TRYV(traverse(dirh, visitor, threads, &state, force_slow_path));
+      state.current.directories_changed = state._changed.load(std::memory_order_relaxed);
+      state.current.directories_unchanged = state._unchanged.load(std::memory_order_relaxed);
+      return std::move(state.current);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
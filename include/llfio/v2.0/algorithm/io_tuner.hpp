@@ -0,0 +1,250 @@
+/* An adaptive i/o size and queue depth tuner driven by storage_profile
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_IO_TUNER_HPP
+#define LLFIO_ALGORITHM_IO_TUNER_HPP
+
+#include "../storage_profile.hpp"
+#include "../utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+//! \file io_tuner.hpp Provides an adaptive i/o size and queue depth tuner.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \brief Recommends an i/o chunk size and queue depth per kind of operation, initialised from
+  a `storage_profile` and adjusted online from the latencies observed to hold a latency target.
+
+  Bulk operations such as copying or compaction should issue i/o of `recommend().chunk_size`
+  bytes, with no more than `recommend().queue_depth` i/o in flight, and report the latency of
+  each completed i/o to `record()`. Adjustment is AIMD style: each completed i/o exceeding the
+  latency target halves the queue depth, or the chunk size once the queue depth is one, at most
+  once per queue depth's worth of completions. Once a queue depth's worth of consecutive
+  completions meet the target, the chunk size grows back towards its initial value by an eighth,
+  and then the queue depth grows by one towards its maximum. Foreground i/o sharing the
+  device is thus not starved by the bulk operation for longer than a few i/o.
+
+  If no latency target is supplied, the target is twice the lowest latency recently observed,
+  which holds the device near the knee of its latency versus throughput curve.
+
+  The initial chunk size is `utils::file_buffer_default_size()`, rounded up to the device's
+  minimum i/o size and, for writes, the atomic rewrite quantum, so rewrites are never seen torn,
+  and the device's optimal i/o size, so writes to RAID never straddle a stripe boundary.
+  The maximum queue depth is the shallowest multiplexed queue depth measured to achieve 90% of
+  the best throughput measured, as `fs-probe --recommend` reports, else it is estimated from the
+  threaded latency tests, else it is four.
+
+  All member functions are threadsafe.
+  */
+  class io_tuner
+  {
+  public:
+    //! The kind of operation
+    enum class operation : uint8_t
+    {
+      read,
+      write
+    };
+    //! A recommendation for an operation
+    struct recommendation
+    {
+      size_t chunk_size{0};   //!< The size of each i/o to issue.
+      size_t queue_depth{0};  //!< The maximum number of i/o to have in flight.
+    };
+
+  private:
+    struct _state_t
+    {
+      size_t chunk_size{0}, max_chunk_size{0}, granularity{1};
+      size_t queue_depth{0}, max_queue_depth{0};
+      size_t completions_since_decrease{0}, consecutive_good{0}, samples{0};
+      std::chrono::nanoseconds target{0}, lowest{std::chrono::nanoseconds::max()};
+    };
+    mutable spinlock _lock;
+    std::chrono::nanoseconds _latency_target{0};
+    _state_t _state[2];
+
+    static size_t _round_up(size_t v, size_t granularity) noexcept { return (v + granularity - 1) / granularity * granularity; }
+    template <class T> static bool _measured(const storage_profile::item<T> &i) noexcept { return i.value != storage_profile::default_value<T>() && i.value != 0; }
+
+    static size_t _max_queue_depth(const storage_profile::storage_profile &sp, operation op) noexcept
+    {
+      static constexpr size_t depths[] = {1, 4, 16, 64, 256};
+      const storage_profile::item<unsigned long long> *const iops[2][5] = {
+      {&sp.read_async_qd1_iops, &sp.read_async_qd4_iops, &sp.read_async_qd16_iops, &sp.read_async_qd64_iops, &sp.read_async_qd256_iops},
+      {&sp.write_async_qd1_iops, &sp.write_async_qd4_iops, &sp.write_async_qd16_iops, &sp.write_async_qd64_iops, &sp.write_async_qd256_iops}};
+      unsigned long long best = 0;
+      for(auto *i : iops[(size_t) op])
+      {
+        if(_measured(*i))
+        {
+          best = (std::max)(best, i->value);
+        }
+      }
+      if(best > 0)
+      {
+        for(size_t n = 0; n < 5; n++)
+        {
+          if(_measured(*iops[(size_t) op][n]) && iops[(size_t) op][n]->value >= best * 9 / 10)
+          {
+            return depths[n];
+          }
+        }
+      }
+      // Fall back onto the threaded queue depth tests
+      const auto &qd1 = (op == operation::read) ? sp.read_qd1_mean : sp.write_qd1_mean;
+      const auto &qd16 = (op == operation::read) ? sp.read_qd16_mean : sp.write_qd16_mean;
+      if(_measured(qd1) && _measured(qd16))
+      {
+        // Sixteen threads must complete at least one and a half times as many i/o per second as one thread
+        return (16.0 / (double) qd16.value >= 1.5 / (double) qd1.value) ? 16 : 1;
+      }
+      return 4;
+    }
+
+    void _adjust(_state_t &s, std::chrono::nanoseconds latency) noexcept
+    {
+      // Without a target the lowest latency observed forms the baseline, which rises slowly so
+      // the baseline follows the device if it permanently slows
+      if(_latency_target.count() == 0)
+      {
+        if(latency < s.lowest)
+        {
+          s.lowest = latency;
+        }
+        else if(++s.samples >= 1024)
+        {
+          s.samples = 0;
+          s.lowest += s.lowest / 8;
+        }
+        s.target = s.lowest * 2;
+      }
+      ++s.completions_since_decrease;
+      if(latency > s.target)
+      {
+        s.consecutive_good = 0;
+        // Decrease at most once per window of queue depth completions, as the i/o in flight
+        // when the first completion exceeded the target will also exceed it
+        if(s.completions_since_decrease >= s.queue_depth)
+        {
+          s.completions_since_decrease = 0;
+          if(s.queue_depth > 1)
+          {
+            s.queue_depth /= 2;
+          }
+          else if(s.chunk_size > s.granularity)
+          {
+            s.chunk_size = (std::max)(s.granularity, _round_up(s.chunk_size / 2, s.granularity));
+          }
+        }
+        return;
+      }
+      if(++s.consecutive_good >= s.queue_depth)
+      {
+        s.consecutive_good = 0;
+        if(s.chunk_size < s.max_chunk_size)
+        {
+          s.chunk_size = (std::min)(s.max_chunk_size, _round_up(s.chunk_size + s.max_chunk_size / 8, s.granularity));
+        }
+        else if(s.queue_depth < s.max_queue_depth)
+        {
+          ++s.queue_depth;
+        }
+      }
+    }
+
+  public:
+    //! Constructs an instance for an empty storage profile, with no latency target.
+    io_tuner()
+        : io_tuner(storage_profile::storage_profile())
+    {
+    }
+    /*! Constructs an instance from the measurements in `sp`, holding the latency of each i/o to
+    `latency_target`, or to twice the lowest latency recently observed if zero.
+    */
+    explicit io_tuner(const storage_profile::storage_profile &sp, std::chrono::nanoseconds latency_target = {})
+        : _latency_target(latency_target)
+    {
+      for(auto op : {operation::read, operation::write})
+      {
+        auto &s = _state[(size_t) op];
+        s.granularity = _measured(sp.device_min_io_size) ? sp.device_min_io_size.value : 512;
+        if(_measured(sp.device_minimum_io_size) && sp.device_minimum_io_size.value > s.granularity)
+        {
+          s.granularity = _round_up(sp.device_minimum_io_size.value, s.granularity);
+        }
+        if(op == operation::write && _measured(sp.atomic_rewrite_quantum) && sp.atomic_rewrite_quantum.value > s.granularity)
+        {
+          s.granularity = _round_up(static_cast<size_t>(sp.atomic_rewrite_quantum.value), s.granularity);
+        }
+        if(op == operation::write && _measured(sp.device_optimal_io_size) && sp.device_optimal_io_size.value > s.granularity)
+        {
+          s.granularity = _round_up(sp.device_optimal_io_size.value, s.granularity);
+        }
+        s.chunk_size = s.max_chunk_size = _round_up(utils::file_buffer_default_size(), s.granularity);
+        s.queue_depth = s.max_queue_depth = _max_queue_depth(sp, op);
+        s.target = latency_target;
+      }
+    }
+    io_tuner(const io_tuner &) = delete;
+    io_tuner(io_tuner &&) = delete;
+    io_tuner &operator=(const io_tuner &) = delete;
+    io_tuner &operator=(io_tuner &&) = delete;
+    ~io_tuner() = default;
+
+    //! The latency target, which is zero if it follows the lowest latency observed.
+    std::chrono::nanoseconds latency_target() const noexcept { return _latency_target; }
+
+    //! The current recommendation for an operation.
+    recommendation recommend(operation op) const noexcept
+    {
+      std::lock_guard<spinlock> g(_lock);
+      const auto &s = _state[(size_t) op];
+      return {s.chunk_size, s.queue_depth};
+    }
+    //! The largest recommendation which will be made for an operation.
+    recommendation maximum(operation op) const noexcept
+    {
+      std::lock_guard<spinlock> g(_lock);
+      const auto &s = _state[(size_t) op];
+      return {s.max_chunk_size, s.max_queue_depth};
+    }
+
+    //! Records the latency of a completed i/o of an operation, adjusting future recommendations.
+    void record(operation op, std::chrono::nanoseconds latency) noexcept
+    {
+      std::lock_guard<spinlock> g(_lock);
+      _adjust(_state[(size_t) op], latency);
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
@@ -0,0 +1,430 @@
+/* A lock free ring buffer mapped twice back to back
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_ALGORITHM_MIRRORED_RING_BUFFER_HPP
+#define LLFIO_ALGORITHM_MIRRORED_RING_BUFFER_HPP
+
+#include "../map_handle.hpp"
+#include "../path_discovery.hpp"
+#include "../utils.hpp"
+#include "shared_fs_mutex/memory_map.hpp"  // for detail::memory_map_wait() and detail::memory_map_wake()
+
+#include <atomic>
+#include <cstring>
+
+//! \file mirrored_ring_buffer.hpp Provides a lock free ring buffer whose reads and writes never wrap.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class mirrored_ring_buffer
+  \brief A single producer, single consumer lock free ring buffer of bytes, whose storage is mapped
+  twice back to back using `map_handle::map_mirrored()`, so every readable or writable extent is a
+  single contiguous span no matter where the wrap point lies.
+
+  This lets framed messages be written and parsed in place without splitting copies at the wrap
+  point. The producer calls `writable()` to obtain the free space, fills some or all of it, and
+  publishes what it filled with `commit_write()`. The consumer calls `readable()` to obtain the
+  published bytes, and releases what it has finished with using `commit_read()`. Neither ever blocks,
+  unless it chooses to wait for space or bytes using `wait_writable()` or `wait_readable()`, which
+  sleep upon a futex in the header. A commit only wakes the other party if it announced it is
+  sleeping, so commits make no syscall in the common case.
+
+  `write_message()` and `read_message()` frame variable length messages with their length, so
+  messages may be passed between processes and read in place.
+
+  `create()` makes a ring buffer for use within this process. `open()` makes or attaches to a ring
+  buffer kept within a file, such that a producer and consumer in different processes may share it.
+  Place the file on a memory backed filesystem (e.g. `path_discovery::memory_backed_temporary_files_directory()`)
+  to avoid the kernel writing the buffer to storage.
+
+  The cursors are kept in the first `utils::allocation_granularity()` bytes of the storage, each in
+  its own cache line. The buffer's capacity is always a multiple of `utils::allocation_granularity()`.
+
+  - Safe for exactly one producer thread and one consumer thread at a time, which may be in
+  different processes.
+  - Cursors are 64 bit byte counts, and so never overflow in practice.
+  - Futex sleeps are only implemented upon Linux; elsewhere waiting polls, as `WaitOnAddress()` cannot wake
+  other processes.
+  */
+  class mirrored_ring_buffer
+  {
+  public:
+    //! The size type
+    using size_type = map_handle::size_type;
+    //! The type of a span of bytes to write
+    using buffer_type = map_handle::buffer_type;
+    //! The type of a span of bytes to read
+    using const_buffer_type = map_handle::const_buffer_type;
+
+  private:
+    static constexpr uint64_t _magic = 0x4647554252524d4cULL;  // "LMRRBUFG"
+    struct _header_t
+    {
+      std::atomic<uint64_t> magic;
+      uint64_t capacity;
+      alignas(64) std::atomic<uint64_t> write_cursor;
+      alignas(64) std::atomic<uint64_t> read_cursor;
+      alignas(64) std::atomic<uint32_t> write_seq;  // Incremented upon each commit_write(), slept upon by the consumer
+      std::atomic<uint32_t> consumer_sleeping;
+      alignas(64) std::atomic<uint32_t> read_seq;  // Incremented upon each commit_read(), slept upon by the producer
+      std::atomic<uint32_t> producer_sleeping;
+    };
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "std::atomic<uint64_t> must be lock free to be placed into shared memory");
+
+    file_handle _backing;
+    section_handle _sh;
+    map_handle _headermap, _datamap;
+    size_type _capacity{0};
+
+    _header_t *_header() const noexcept { return reinterpret_cast<_header_t *>(_headermap.address()); }
+
+    mirrored_ring_buffer(file_handle &&backing, section_handle &&sh, map_handle &&headermap, map_handle &&datamap, size_type capacity) noexcept
+        : _backing(std::move(backing))
+        , _sh(std::move(sh))
+        , _headermap(std::move(headermap))
+        , _datamap(std::move(datamap))
+        , _capacity(capacity)
+    {
+      _fixup();
+    }
+    void _fixup() noexcept
+    {
+      if(_backing.is_valid())
+      {
+        _sh.set_backing(&_backing);
+      }
+      _headermap.set_section(&_sh);
+      _datamap.set_section(&_sh);
+    }
+    static result<mirrored_ring_buffer> _make(file_handle &&backing, section_handle &&sh, size_type capacity, bool initialise) noexcept
+    {
+      const auto granularity = utils::allocation_granularity();
+      OUTCOME_TRY(auto &&headermap, map_handle::map(sh, granularity, 0));
+      auto *header = reinterpret_cast<_header_t *>(headermap.address());
+      if(initialise)
+      {
+        header->capacity = capacity;
+        header->write_cursor.store(0, std::memory_order_relaxed);
+        header->read_cursor.store(0, std::memory_order_relaxed);
+        header->write_seq.store(0, std::memory_order_relaxed);
+        header->consumer_sleeping.store(0, std::memory_order_relaxed);
+        header->read_seq.store(0, std::memory_order_relaxed);
+        header->producer_sleeping.store(0, std::memory_order_relaxed);
+        header->magic.store(_magic, std::memory_order_release);
+      }
+      else
+      {
+        if(header->magic.load(std::memory_order_acquire) != _magic)
+        {
+          // Not yet initialised by its creator, or not a ring buffer
+          return errc::resource_unavailable_try_again;
+        }
+        capacity = static_cast<size_type>(header->capacity);
+        if(capacity == 0 || (capacity & (granularity - 1)) != 0)
+        {
+          return errc::invalid_argument;
+        }
+      }
+      OUTCOME_TRY(auto &&datamap, map_handle::map_mirrored(sh, capacity, granularity));
+      return mirrored_ring_buffer(std::move(backing), std::move(sh), std::move(headermap), std::move(datamap), capacity);
+    }
+
+    static void _notify(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &sleeping) noexcept
+    {
+      seq.fetch_add(1, std::memory_order_seq_cst);
+      if(sleeping.load(std::memory_order_seq_cst) != 0)
+      {
+        algorithm::shared_fs_mutex::detail::memory_map_wake(&seq);
+      }
+    }
+    // Waits until ready() is true. The sleep is announced before sampling seq, so a commit after
+    // the sample sees the sleeper and wakes it.
+    template <class F> static result<void> _wait(F &&ready, std::atomic<uint32_t> &seq, std::atomic<uint32_t> &sleeping, deadline d) noexcept
+    {
+      LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+      for(;;)
+      {
+        if(ready())
+        {
+          return success();
+        }
+        LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        std::chrono::nanoseconds remaining(-1);
+        if(d)
+        {
+          deadline nd;
+          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+          remaining = nd.steady ? std::chrono::nanoseconds(nd.nsecs) :
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(nd.to_time_point() - std::chrono::system_clock::now());
+          if(remaining.count() < 0)
+          {
+            remaining = std::chrono::nanoseconds(0);
+          }
+        }
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        const uint32_t sample = seq.load(std::memory_order_seq_cst);
+        if(!ready())
+        {
+          algorithm::shared_fs_mutex::detail::memory_map_wait(&seq, sample, remaining);
+        }
+        sleeping.fetch_sub(1, std::memory_order_seq_cst);
+      }
+    }
+
+  public:
+    //! Default constructor
+    mirrored_ring_buffer() = default;
+    //! No copy construction
+    mirrored_ring_buffer(const mirrored_ring_buffer &) = delete;
+    //! No copy assignment
+    mirrored_ring_buffer &operator=(const mirrored_ring_buffer &) = delete;
+    //! Move constructor
+    mirrored_ring_buffer(mirrored_ring_buffer &&o) noexcept
+        : _backing(std::move(o._backing))
+        , _sh(std::move(o._sh))
+        , _headermap(std::move(o._headermap))
+        , _datamap(std::move(o._datamap))
+        , _capacity(o._capacity)
+    {
+      o._capacity = 0;
+      _fixup();
+    }
+    //! Move assignment
+    mirrored_ring_buffer &operator=(mirrored_ring_buffer &&o) noexcept
+    {
+      if(this == &o)
+      {
+        return *this;
+      }
+      this->~mirrored_ring_buffer();
+      new(this) mirrored_ring_buffer(std::move(o));
+      return *this;
+    }
+    ~mirrored_ring_buffer() = default;
+
+    /*! \brief Creates a ring buffer for use within this process of at least `capacity` bytes.
+
+    \errors Any of the values `section_handle::section()` or `map_handle::map_mirrored()` can return.
+    */
+    static result<mirrored_ring_buffer> create(size_type capacity) noexcept
+    {
+      if(capacity == 0)
+      {
+        return errc::invalid_argument;
+      }
+      const auto granularity = utils::allocation_granularity();
+      capacity = utils::round_up_to_page_size(capacity, granularity);
+      OUTCOME_TRY(auto &&sh, section_handle::section(granularity + capacity, path_discovery::memory_backed_temporary_files_directory(), section_handle::flag::readwrite));
+      return _make(file_handle(), std::move(sh), capacity, true);
+    }
+
+    /*! \brief Creates or attaches to a ring buffer kept within a file, which may be shared with
+    another process.
+
+    \param backing A writable handle to the file, which the ring buffer takes ownership of.
+    \param capacity If non-zero, the file is (re)initialised as an empty ring buffer of at least
+    this many bytes. If zero, the ring buffer already in the file is attached to, and
+    `errc::resource_unavailable_try_again` is returned if its creator has not finished initialising it.
+
+    Exactly one party ought to create the ring buffer, usually the one which created the file, and
+    only after that may others attach.
+
+    \errors Any of the values `file_handle::truncate()`, `section_handle::section()` or
+    `map_handle::map_mirrored()` can return.
+    */
+    static result<mirrored_ring_buffer> open(file_handle &&backing, size_type capacity = 0) noexcept
+    {
+      const auto granularity = utils::allocation_granularity();
+      if(capacity != 0)
+      {
+        capacity = utils::round_up_to_page_size(capacity, granularity);
+        OUTCOME_TRYV(backing.truncate(granularity + capacity));
+      }
+      else
+      {
+        OUTCOME_TRY(auto &&length, backing.maximum_extent());
+        if(length < granularity)
+        {
+          return errc::resource_unavailable_try_again;
+        }
+      }
+      OUTCOME_TRY(auto &&sh, section_handle::section(backing, 0, section_handle::flag::readwrite));
+      return _make(std::move(backing), std::move(sh), capacity, capacity != 0);
+    }
+
+    //! True if this ring buffer is valid
+    bool is_valid() const noexcept { return _capacity != 0; }
+    //! The capacity of the ring buffer in bytes
+    size_type capacity() const noexcept { return _capacity; }
+    //! The file backing the ring buffer, which is invalid for ring buffers made by `create()`
+    const file_handle &backing() const noexcept { return _backing; }
+
+    //! The number of bytes published by the producer not yet released by the consumer
+    size_type size() const noexcept
+    {
+      auto *header = _header();
+      return static_cast<size_type>(header->write_cursor.load(std::memory_order_acquire) - header->read_cursor.load(std::memory_order_acquire));
+    }
+    //! True if there are no bytes to read
+    bool empty() const noexcept { return size() == 0; }
+
+    //! Producer only. Returns all the free space in the ring buffer as a single contiguous span.
+    buffer_type writable() const noexcept
+    {
+      auto *header = _header();
+      const auto write_cursor = header->write_cursor.load(std::memory_order_relaxed);
+      const auto used = static_cast<size_type>(write_cursor - header->read_cursor.load(std::memory_order_acquire));
+      return {_datamap.address() + static_cast<size_type>(write_cursor % _capacity), _capacity - used};
+    }
+    //! Producer only. Publishes `bytes` bytes at the front of the span last returned by `writable()` to the consumer.
+    void commit_write(size_type bytes) noexcept
+    {
+      auto *header = _header();
+      assert(bytes <= writable().size());
+      header->write_cursor.store(header->write_cursor.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+      _notify(header->write_seq, header->consumer_sleeping);
+    }
+    //! Producer only. Copies as much of `data` as fits into the ring buffer and publishes it, returning the bytes copied.
+    size_type write(const_buffer_type data) noexcept
+    {
+      auto space = writable();
+      const auto bytes = (std::min)(space.size(), data.size());
+      memcpy(space.data(), data.data(), bytes);
+      commit_write(bytes);
+      return bytes;
+    }
+
+    /*! \brief Producer only. Waits until at least `bytes` bytes are free, returning all the free space.
+
+    \errors `errc::value_too_large` if `bytes` exceeds the capacity, `errc::timed_out` if the deadline passes.
+    */
+    result<buffer_type> wait_writable(size_type bytes, deadline d = {}) const noexcept
+    {
+      if(bytes > _capacity)
+      {
+        return errc::value_too_large;
+      }
+      auto *header = _header();
+      OUTCOME_TRY(_wait([&] { return writable().size() >= bytes; }, header->read_seq, header->producer_sleeping, d));
+      return writable();
+    }
+
+    /*! \brief Producer only. Publishes `msg` prefixed by its length, for `read_message()`,
+    returning false if there is insufficient space.
+    */
+    bool write_message(const_buffer_type msg) noexcept
+    {
+      auto space = writable();
+      const uint64_t length = msg.size();
+      if(space.size() < sizeof(length) + msg.size())
+      {
+        return false;
+      }
+      memcpy(space.data(), &length, sizeof(length));
+      memcpy(space.data() + sizeof(length), msg.data(), msg.size());
+      commit_write(sizeof(length) + msg.size());
+      return true;
+    }
+    /*! \brief Producer only. Waits until there is space for `msg` prefixed by its length, then
+    publishes it.
+
+    \errors `errc::value_too_large` if the message can never fit, `errc::timed_out` if the deadline passes.
+    */
+    result<void> write_message(const_buffer_type msg, deadline d) noexcept
+    {
+      OUTCOME_TRY(wait_writable(sizeof(uint64_t) + msg.size(), d));
+      write_message(msg);
+      return success();
+    }
+
+    //! Consumer only. Returns all the bytes published by the producer as a single contiguous span.
+    const_buffer_type readable() const noexcept
+    {
+      auto *header = _header();
+      const auto read_cursor = header->read_cursor.load(std::memory_order_relaxed);
+      const auto avail = static_cast<size_type>(header->write_cursor.load(std::memory_order_acquire) - read_cursor);
+      return {_datamap.address() + static_cast<size_type>(read_cursor % _capacity), avail};
+    }
+    //! Consumer only. Releases `bytes` bytes at the front of the span last returned by `readable()` for reuse by the producer.
+    void commit_read(size_type bytes) noexcept
+    {
+      auto *header = _header();
+      assert(bytes <= readable().size());
+      header->read_cursor.store(header->read_cursor.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+      _notify(header->read_seq, header->producer_sleeping);
+    }
+    /*! \brief Consumer only. Waits until at least `bytes` bytes have been published, returning all those published.
+
+    \errors `errc::timed_out` if the deadline passes.
+    */
+    result<const_buffer_type> wait_readable(size_type bytes = 1, deadline d = {}) const noexcept
+    {
+      auto *header = _header();
+      OUTCOME_TRY(_wait([&] { return readable().size() >= bytes; }, header->write_seq, header->consumer_sleeping, d));
+      return readable();
+    }
+
+    /*! \brief Consumer only. Returns the next message published with `write_message()` in place,
+    if there is one, which is released using `commit_read(message_size(msg))`.
+    */
+    optional<const_buffer_type> read_message() const noexcept
+    {
+      auto avail = readable();
+      uint64_t length;
+      if(avail.size() < sizeof(length))
+      {
+        return {};
+      }
+      memcpy(&length, avail.data(), sizeof(length));
+      return const_buffer_type(avail.data() + sizeof(length), static_cast<size_type>(length));
+    }
+    /*! \brief Consumer only. Waits until a message is published, returning it in place as per `read_message()`.
+
+    \errors `errc::timed_out` if the deadline passes.
+    */
+    result<const_buffer_type> read_message(deadline d) const noexcept
+    {
+      OUTCOME_TRY(wait_readable(sizeof(uint64_t), d));
+      return *read_message();
+    }
+    //! The bytes of the ring buffer taken by a message, including its length prefix.
+    static size_type message_size(const_buffer_type msg) noexcept { return sizeof(uint64_t) + msg.size(); }
+
+    //! Consumer only. Copies as many bytes as fit into `data` out of the ring buffer and releases them, returning the bytes copied.
+    size_type read(buffer_type data) noexcept
+    {
+      auto avail = readable();
+      const auto bytes = (std::min)(avail.size(), data.size());
+      memcpy(data.data(), avail.data(), bytes);
+      commit_read(bytes);
+      return bytes;
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
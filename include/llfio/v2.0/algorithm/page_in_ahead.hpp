@@ -0,0 +1,278 @@
+/* Asynchronous population of a mapped prefetch plan ahead of use
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_PAGE_IN_AHEAD_HPP
+#define LLFIO_ALGORITHM_PAGE_IN_AHEAD_HPP
+
+#include "../mapped_file_handle.hpp"
+#include "../utils.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! \file page_in_ahead.hpp Provides asynchronous population of mapped memory ahead of use.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \brief Populates the regions of a map in the order of a prefetch plan from a worker thread,
+  keeping a window of the plan ahead of the consumer resident and mapped, so a scanner of cold
+  mapped data does not stall upon a synchronous page fault for every page it reads.
+
+  The plan is the sequence of regions of the map which the consumer will read, in the order it
+  will read them. The consumer reports its progress by calling `access()` with each address it
+  is about to read, which is cheap enough to call once per page or record. Should the address
+  not yet have been populated, which `misses()` counts, the consumer faults it in as usual, and
+  the worker skips ahead to the consumer, as populating behind the consumer is wasted work.
+
+  The worker populates the window a quarter of a window at a time using `map_handle::populate()`,
+  which on Linux 5.14 or later is `madvise(MADV_POPULATE_READ)`, having first issued
+  `map_handle::prefetch()` for the following quarter, so the kernel reads the following quarter
+  into the page cache whilst the page tables for this quarter are filled in. Elsewhere the worker
+  touches each page instead.
+
+  The map must not be closed, nor its address changed by `mapped_file_handle::reserve()`,
+  `mapped_file_handle::truncate()` or `mapped_file_handle::update_map()`, whilst a plan is running.
+  */
+  class page_in_ahead
+  {
+  public:
+    //! The buffer type
+    using buffer_type = map_handle::buffer_type;
+    //! The size type
+    using size_type = map_handle::size_type;
+
+  private:
+    const map_handle *_mh{nullptr};
+    std::vector<buffer_type> _plan;
+    std::vector<size_type> _ends;  // bytes of the plan up to the end of each region
+    size_type _window{0}, _chunk{0};
+    mutable std::mutex _lock;
+    std::condition_variable _changed;
+    size_type _cursor{0}, _frontier{0}, _misses{0}, _populated{0};
+    size_t _cursor_region{0};
+    bool _stop{false};
+    result<void> _error{success()};
+    std::thread _worker;
+
+    // The region of the plan containing the position
+    size_t _region_of(size_type pos) const noexcept { return static_cast<size_t>(std::upper_bound(_ends.begin(), _ends.end(), pos) - _ends.begin()); }
+    buffer_type _chunk_at(size_type pos) const noexcept
+    {
+      const size_t idx = _region_of(pos);
+      const size_type begin = (idx == 0) ? 0 : _ends[idx - 1];
+      return {_plan[idx].data() + (pos - begin), static_cast<size_t>((std::min)(_chunk, _ends[idx] - pos))};
+    }
+
+    void _run() noexcept
+    {
+      const size_t pagesize = utils::page_size();
+      std::unique_lock<std::mutex> g(_lock);
+      while(!_stop && _frontier < _ends.back())
+      {
+        if(_frontier < _cursor)
+        {
+          _frontier = _cursor;
+          continue;
+        }
+        if(_frontier >= _cursor + _window)
+        {
+          _changed.wait(g);
+          continue;
+        }
+        const auto chunk = _chunk_at(_frontier);
+        buffer_type next;
+        if(_frontier + chunk.size() < _ends.back())
+        {
+          next = utils::round_to_page_size_larger(_chunk_at(_frontier + chunk.size()), pagesize);
+        }
+        g.unlock();
+        if(next.data() != nullptr)
+        {
+          // Purely advisory, and may extend beyond the valid extent of the map
+          (void) map_handle::prefetch(next);
+        }
+        auto r = _mh->populate(chunk, 1);
+        g.lock();
+        if(!r)
+        {
+          _error = std::move(r);
+          return;
+        }
+        _frontier += chunk.size();
+        _populated += chunk.size();
+      }
+    }
+
+  public:
+    //! Default constructor
+    page_in_ahead() = default;
+    page_in_ahead(const page_in_ahead &) = delete;
+    page_in_ahead(page_in_ahead &&) = delete;
+    page_in_ahead &operator=(const page_in_ahead &) = delete;
+    page_in_ahead &operator=(page_in_ahead &&) = delete;
+    //! Stops any plan running.
+    ~page_in_ahead() { (void) stop(); }
+
+    /*! \brief Begins populating the regions of `plan`, which must lie within `mh`, in order
+    from a worker thread, keeping up to `window` bytes of the plan ahead of the consumer populated.
+
+    \param mh The map to populate, which must outlive the plan.
+    \param plan The regions of the map in the order in which they will be read. They are copied.
+    \param window The bytes of the plan to keep populated ahead of the consumer, where zero means
+    64Mb. It is rounded up to four pages.
+
+    \errors `errc::invalid_argument` if a plan is already running. Any error from launching a thread.
+    \mallocs The plan is copied, and a thread is launched.
+    */
+    result<void> start(const map_handle &mh, span<const buffer_type> plan, size_type window = 0) noexcept
+    {
+      if(_worker.joinable())
+      {
+        return errc::invalid_argument;
+      }
+      const size_t pagesize = utils::page_size();
+      if(window == 0)
+      {
+        window = 64 * 1024 * 1024;
+      }
+      _chunk = (std::max)(utils::round_up_to_page_size(window / 4, pagesize), (size_type) pagesize);
+      _window = _chunk * 4;
+      _mh = &mh;
+      _cursor = _frontier = _misses = _populated = 0;
+      _cursor_region = 0;
+      _stop = false;
+      _error = success();
+      try
+      {
+        _plan.assign(plan.begin(), plan.end());
+        _ends.resize(_plan.size());
+        size_type total = 0;
+        for(size_t n = 0; n < _plan.size(); n++)
+        {
+          total += _plan[n].size();
+          _ends[n] = total;
+        }
+        if(total > 0)
+        {
+          _worker = std::thread([this] { _run(); });
+        }
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    //! \overload
+    result<void> start(const mapped_file_handle &mh, span<const buffer_type> plan, size_type window = 0) noexcept { return start(mh.map(), plan, window); }
+
+    /*! \brief Reports that the consumer is about to read `addr`, returning true if it has already
+    been populated. Addresses not within the plan are ignored, and return false.
+
+    Calls with addresses later in the plan than the last call move the window forwards. Calls with
+    addresses earlier in the plan than the last call do not move the window backwards.
+    */
+    bool access(const byte *addr) noexcept
+    {
+      auto contains = [&](size_t idx) { return addr >= _plan[idx].data() && addr < _plan[idx].data() + _plan[idx].size(); };
+      std::lock_guard<std::mutex> g(_lock);
+      size_t idx = _cursor_region;
+      // Plans are read in order, so search forwards from the region last accessed first
+      if(idx >= _plan.size() || !contains(idx))
+      {
+        for(idx = _cursor_region + 1; idx < _plan.size() && !contains(idx); idx++)
+        {
+        }
+        if(idx >= _plan.size())
+        {
+          for(idx = 0; idx < _cursor_region && !contains(idx); idx++)
+          {
+          }
+          if(idx >= _cursor_region)
+          {
+            return false;
+          }
+        }
+      }
+      _cursor_region = idx;
+      const size_type pos = ((idx == 0) ? 0 : _ends[idx - 1]) + static_cast<size_type>(addr - _plan[idx].data());
+      const bool populated = pos < _frontier;
+      if(!populated)
+      {
+        ++_misses;
+      }
+      if(pos > _cursor)
+      {
+        _cursor = pos;
+        _changed.notify_one();
+      }
+      return populated;
+    }
+
+    //! The total bytes in the plan.
+    size_type bytes() const noexcept
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      return _ends.empty() ? 0 : _ends.back();
+    }
+    //! The bytes of the plan populated by the worker so far.
+    size_type bytes_populated() const noexcept
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      return _populated;
+    }
+    //! The number of calls to `access()` with an address not yet populated by the worker.
+    size_type misses() const noexcept
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      return _misses;
+    }
+
+    //! Stops any plan running, waiting for the worker to exit, and returns any error it encountered populating.
+    result<void> stop() noexcept
+    {
+      {
+        std::lock_guard<std::mutex> g(_lock);
+        _stop = true;
+      }
+      _changed.notify_all();
+      if(_worker.joinable())
+      {
+        _worker.join();
+      }
+      std::lock_guard<std::mutex> g(_lock);
+      return _error;
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
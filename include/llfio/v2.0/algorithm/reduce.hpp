@@ -27,6 +27,8 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "traverse.hpp"
 
+#include <future>
+
 //! \file reduce.hpp Provides a directory tree reduction algorithm.
 
 LLFIO_V2_NAMESPACE_BEGIN
@@ -157,10 +159,43 @@ namespace algorithm
   to the (likely renamed) directory you passed in. You might do something like try to rename
   it into `storage_backed_temporary_files_directory()`, or some other hail mary action.
 
+  If `ops_in_flight` exceeds one, it is passed to `traverse()` as `dirs_in_flight`, and on Linux
+  each kernel thread unlinks the entries of each enumerated directory using its own io_uring,
+  keeping up to `ops_in_flight` (to a maximum of 256) unlinks in flight at once. Kernels before
+  5.11 fall back to one blocking unlink per entry.
+
+  On Windows, each entry is removed by opening one `DELETE` only handle to it, and setting a delete
+  disposition with POSIX semantics which also ignores the read only attribute, so entries leave
+  their directory immediately, and read only entries need no renaming. If `ops_in_flight` exceeds
+  one, the entries of each enumerated directory are removed by up to `ops_in_flight` threads of
+  the Win32 thread pool at once.
+
   You should review the documentation for `algorithm::traverse()`, as this algorithm is
   entirely implemented using that algorithm.
   */
-  LLFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> reduce(directory_handle &&dirh, reduce_visitor *visitor = nullptr, size_t threads = 0, bool force_slow_path = false) noexcept;
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> reduce(directory_handle &&dirh, reduce_visitor *visitor = nullptr, size_t threads = 0, bool force_slow_path = false,
+                                                     size_t ops_in_flight = 1) noexcept;
+
+  /*! \brief Detach the directory identified `dirh` from the filesystem now, and reduce it to
+  the null set later using a background kernel thread.
+
+  `dirh` is atomically renamed to a uniquely named hidden directory with the prefix `.llfio-trash-`
+  within `trashdirh`, or within its parent directory if `trashdirh` is not valid. As soon as this
+  function returns, nobody else can see the tree at its former location, however the storage it
+  occupies is released by a detached kernel thread calling `reduce()` upon it. `trashdirh` must
+  be on the same filesystem as `dirh`, else the rename fails.
+
+  If the rename fails, its failure is returned and `dirh` is NOT moved into the function. Otherwise
+  `dirh` is moved into the function and the returned future becomes ready with the outcome of
+  `reduce()`. If `reduce()` fails, or the process exits before it completes, the partially reduced
+  tree remains in the trash location, from where it can be reduced later.
+
+  `visitor`, if supplied, must remain valid until the future becomes ready. If a background
+  kernel thread cannot be launched, the reduction occurs before this function returns.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<std::future<result<size_t>>> reduce_detached(directory_handle &&dirh, const path_handle &trashdirh = {},
+                                                                                  reduce_visitor *visitor = nullptr, size_t threads = 0,
+                                                                                  bool force_slow_path = false, size_t ops_in_flight = 1) noexcept;
 
 }  // namespace algorithm
 
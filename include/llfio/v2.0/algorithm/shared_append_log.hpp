@@ -0,0 +1,345 @@
+/* A lock free multi producer append only log in a memory mapped file
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_SHARED_APPEND_LOG_HPP
+#define LLFIO_ALGORITHM_SHARED_APPEND_LOG_HPP
+
+#include "../mapped_file_handle.hpp"
+#include "shared_fs_mutex/memory_map.hpp"  // for detail::memory_map_wait() and detail::memory_map_wake()
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+
+//! \file shared_append_log.hpp Provides a lock free multi producer append only log in a memory mapped file.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class shared_append_log
+  \brief A lock free append only log of records kept in a memory mapped file, appended to by
+  many producers and followed by many readers, in any number of processes.
+
+  A producer reserves space for a record with a single atomic fetch-add upon the tail kept in the
+  header of the file, writes the record directly into the map, and publishes it by setting the
+  committed flag in the record's frame. No syscall is made unless the reservation lies beyond the
+  map, in which case the file is grown under an exclusive byte range lock by `truncate()`
+  geometrically, or if another producer already grew it, the map is updated to match. Readers
+  follow the log in the order space was reserved, and when they reach a record not yet committed,
+  sleep upon a futex in the header which a producer wakes only if a reader is sleeping.
+
+  Records are framed by eight bytes and padded to eight bytes in the file. The header occupies
+  the first `utils::page_size()` bytes.
+
+  Give the `mapped_file_handle` a reservation at least as large as the log will become, so its
+  map never needs to relocate. Spans returned for a record remain valid only until the next call
+  upon the same instance which may grow the map.
+
+  - Each instance may be used by one thread at a time. Open an instance per thread, upon its
+  own `mapped_file_handle` of the same file.
+  - A producer which dies after reserving space but before committing its record leaves readers
+  forever waiting upon that record, so readers ought to supply a deadline.
+  - Futex sleeps are only implemented upon Linux; elsewhere readers poll.
+  */
+  class shared_append_log
+  {
+  public:
+    //! The size type
+    using size_type = mapped_file_handle::size_type;
+    //! The type of a span of bytes to write
+    using buffer_type = mapped_file_handle::buffer_type;
+    //! The type of a span of bytes to read
+    using const_buffer_type = mapped_file_handle::const_buffer_type;
+
+    //! Space reserved upon the log for a record, which must be committed using `commit()`
+    struct reservation
+    {
+      buffer_type record;     //!< The bytes of the record, to be filled.
+      size_type offset{0};    //!< The offset of the record's frame in the file.
+    };
+
+  private:
+    static constexpr uint64_t _magic = 0x474f4c5050414853ULL;  // "SHAPPLOG"
+    static constexpr uint32_t _committed = 0x80000000U;
+    static constexpr size_type _frame_header = 8;
+    static constexpr mapped_file_handle::extent_type _grow_lock_offset = (mapped_file_handle::extent_type) 1 << 62;
+    struct _header_t
+    {
+      std::atomic<uint64_t> magic;
+      uint64_t header_size;
+      alignas(64) std::atomic<uint64_t> tail;     // The end of the last reservation
+      alignas(64) std::atomic<uint64_t> extent;   // The length to which the file has been grown
+      alignas(64) std::atomic<uint32_t> commits;  // Incremented upon each commit, and slept upon by readers
+      std::atomic<uint32_t> sleepers;             // The readers sleeping upon commits
+    };
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "std::atomic<uint64_t> must be lock free to be placed into shared memory");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> is not usable as a futex word on this platform");
+
+    mapped_file_handle _mh;
+    size_type _mapped{0}, _growth{0};
+
+    _header_t *_header() const noexcept { return reinterpret_cast<_header_t *>(_mh.address()); }
+    std::atomic<uint32_t> *_frame(size_type offset) const noexcept { return reinterpret_cast<std::atomic<uint32_t> *>(_mh.address() + offset); }
+    static size_type _frame_size(size_type bytes) noexcept { return _frame_header + ((bytes + 7) & ~static_cast<size_type>(7)); }
+    // Serialises growth between instances within this process, as byte range locks may be per process
+    static std::mutex &_grow_lock() noexcept
+    {
+      static std::mutex v;
+      return v;
+    }
+
+    shared_append_log(mapped_file_handle &&mh, size_type mapped, size_type growth) noexcept
+        : _mh(std::move(mh))
+        , _mapped(mapped)
+        , _growth(growth)
+    {
+    }
+
+    // Maps at least `needed` bytes of the file, growing the file if no other has
+    result<void> _grow(size_type needed) noexcept
+    {
+      if(_header()->extent.load(std::memory_order_acquire) < needed)
+      {
+        try
+        {
+          std::lock_guard<std::mutex> g(_grow_lock());
+          OUTCOME_TRY(auto &&guard, _mh.lock_file_range(_grow_lock_offset, 1, lock_kind::exclusive));
+          const auto extent = static_cast<size_type>(_header()->extent.load(std::memory_order_acquire));
+          if(extent < needed)
+          {
+            // Grow geometrically, up to the growth increment per step
+            auto newextent = (std::max)(needed, extent + (std::min)(extent, _growth));
+            newextent = utils::round_up_to_page_size(newextent, utils::page_size());
+            OUTCOME_TRY(_mapped, _mh.truncate(newextent));
+            _header()->extent.store(newextent, std::memory_order_release);
+          }
+          guard.unlock();
+        }
+        catch(...)
+        {
+          return error_from_exception();
+        }
+      }
+      if(_mapped < needed)
+      {
+        // Another grew the file, so map its growth
+        OUTCOME_TRY(_mapped, _mh.update_map());
+        if(_mapped < needed)
+        {
+          return errc::io_error;
+        }
+      }
+      return success();
+    }
+
+  public:
+    //! Default constructor
+    shared_append_log() = default;
+    //! No copy construction
+    shared_append_log(const shared_append_log &) = delete;
+    //! No copy assignment
+    shared_append_log &operator=(const shared_append_log &) = delete;
+    //! Move constructor
+    shared_append_log(shared_append_log &&) = default;
+    //! Move assignment
+    shared_append_log &operator=(shared_append_log &&) = default;
+    ~shared_append_log() = default;
+
+    /*! \brief Creates or attaches to a log kept within a mapped file.
+
+    \param backing A writable mapped handle to the file, which the log takes ownership of.
+    \param create If true, the file is (re)initialised as an empty log. If false, the log already
+    in the file is attached to, and `errc::resource_unavailable_try_again` is returned if its
+    creator has not finished initialising it.
+    \param growth The most by which to grow the file at a time.
+
+    Exactly one party ought to create the log, usually the one which created the file, and
+    only after that may others attach.
+
+    \errors Any of the values `mapped_file_handle::truncate()` and `mapped_file_handle::update_map()` can return.
+    */
+    static result<shared_append_log> open(mapped_file_handle &&backing, bool create = false, size_type growth = 16 * 1024 * 1024) noexcept
+    {
+      const auto header_size = utils::page_size();
+      growth = utils::round_up_to_page_size((std::max)(growth, header_size), header_size);
+      if(create)
+      {
+        OUTCOME_TRY(backing.truncate(0));
+        OUTCOME_TRY(auto &&mapped, backing.truncate(header_size + growth));
+        auto *header = reinterpret_cast<_header_t *>(backing.address());
+        header->header_size = header_size;
+        header->tail.store(header_size, std::memory_order_relaxed);
+        header->extent.store(mapped, std::memory_order_relaxed);
+        header->commits.store(0, std::memory_order_relaxed);
+        header->sleepers.store(0, std::memory_order_relaxed);
+        header->magic.store(_magic, std::memory_order_release);
+        return shared_append_log(std::move(backing), static_cast<size_type>(mapped), growth);
+      }
+      OUTCOME_TRY(auto &&mapped, backing.update_map());
+      if(mapped < header_size)
+      {
+        return errc::resource_unavailable_try_again;
+      }
+      auto *header = reinterpret_cast<_header_t *>(backing.address());
+      if(header->magic.load(std::memory_order_acquire) != _magic)
+      {
+        // Not yet initialised by its creator, or not a log
+        return errc::resource_unavailable_try_again;
+      }
+      if(header->header_size != header_size)
+      {
+        return errc::invalid_argument;
+      }
+      return shared_append_log(std::move(backing), static_cast<size_type>(mapped), growth);
+    }
+
+    //! True if this log is valid
+    bool is_valid() const noexcept { return _mapped != 0; }
+    //! The mapped file backing the log
+    const mapped_file_handle &backing() const noexcept { return _mh; }
+    //! The offset of the first record, from which readers begin.
+    size_type begin() const noexcept { return static_cast<size_type>(_header()->header_size); }
+    //! The offset after the last reservation, which may not yet be committed.
+    size_type end() const noexcept { return static_cast<size_type>(_header()->tail.load(std::memory_order_acquire)); }
+
+    /*! \brief Reserves space for a record of `bytes` bytes, into which it is to be written in place
+    before being published with `commit()`.
+
+    \errors `errc::value_too_large` if `bytes` exceeds two Gb. Any of the values
+    `mapped_file_handle::truncate()` and `mapped_file_handle::update_map()` can return, when the
+    reserved space lies beyond the map, in which case the space reserved is never committed.
+    */
+    result<reservation> reserve(size_type bytes) noexcept
+    {
+      if(bytes >= _committed)
+      {
+        return errc::value_too_large;
+      }
+      const auto frame_size = _frame_size(bytes);
+      const auto offset = static_cast<size_type>(_header()->tail.fetch_add(frame_size, std::memory_order_relaxed));
+      if(offset + frame_size > _mapped)
+      {
+        OUTCOME_TRY(_grow(offset + frame_size));
+      }
+      return reservation{{_mh.address() + offset + _frame_header, bytes}, offset};
+    }
+
+    //! Publishes a record written into space reserved by `reserve()`, waking any readers sleeping.
+    void commit(const reservation &r) noexcept
+    {
+      _frame(r.offset)->store(_committed | static_cast<uint32_t>(r.record.size()), std::memory_order_seq_cst);
+      auto *header = _header();
+      header->commits.fetch_add(1, std::memory_order_seq_cst);
+      if(header->sleepers.load(std::memory_order_seq_cst) != 0)
+      {
+        algorithm::shared_fs_mutex::detail::memory_map_wake(&header->commits);
+      }
+    }
+
+    /*! \brief Appends a copy of `record`, returning the offset of its frame.
+
+    \errors Any of the values `reserve()` can return.
+    */
+    result<size_type> append(const_buffer_type record) noexcept
+    {
+      OUTCOME_TRY(auto &&r, reserve(record.size()));
+      memcpy(r.record.data(), record.data(), record.size());
+      commit(r);
+      return r.offset;
+    }
+
+    /*! \brief Returns the record at `cursor` once it has been committed, advancing `cursor` to
+    the next record. Begin with `cursor` at `begin()`.
+
+    \errors `errc::timed_out` if the record is not committed before the deadline. Any of the
+    values `mapped_file_handle::update_map()` can return.
+    */
+    result<const_buffer_type> read(size_type &cursor, deadline d = {}) noexcept
+    {
+      LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+      auto *header = _header();
+      // Returns the frame's word if its frame lies within the map, mapping the file's growth if needed
+      auto frame_word = [&]() -> result<uint32_t> {
+        if(cursor + _frame_header > _mapped)
+        {
+          if(header->extent.load(std::memory_order_acquire) < cursor + _frame_header)
+          {
+            return (uint32_t) 0;
+          }
+          OUTCOME_TRY(_grow(cursor + _frame_header));
+          header = _header();
+        }
+        return _frame(cursor)->load(std::memory_order_seq_cst);
+      };
+      for(;;)
+      {
+        OUTCOME_TRY(auto &&word, frame_word());
+        if(word != 0)
+        {
+          const size_type bytes = word & ~_committed;
+          if(cursor + _frame_size(bytes) > _mapped)
+          {
+            OUTCOME_TRY(_grow(cursor + _frame_size(bytes)));
+          }
+          const_buffer_type ret(_mh.address() + cursor + _frame_header, bytes);
+          cursor += _frame_size(bytes);
+          return ret;
+        }
+        LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        std::chrono::nanoseconds remaining(-1);
+        if(d)
+        {
+          deadline nd;
+          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+          remaining = nd.steady ? std::chrono::nanoseconds(nd.nsecs) :
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(nd.to_time_point() - std::chrono::system_clock::now());
+          if(remaining.count() < 0)
+          {
+            remaining = std::chrono::nanoseconds(0);
+          }
+        }
+        // Announce the sleep before sampling commits, so a producer committing after the sample
+        // sees the sleeper and wakes it
+        header->sleepers.fetch_add(1, std::memory_order_seq_cst);
+        const uint32_t commits = header->commits.load(std::memory_order_seq_cst);
+        auto recheck = frame_word();
+        if(recheck && recheck.value() == 0)
+        {
+          algorithm::shared_fs_mutex::detail::memory_map_wait(&header->commits, commits, remaining);
+        }
+        header->sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        if(!recheck)
+        {
+          return std::move(recheck).error();
+        }
+      }
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
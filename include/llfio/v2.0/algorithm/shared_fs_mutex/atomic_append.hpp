@@ -28,6 +28,7 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../file_handle.hpp"
 #include "base.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <thread>  // for yield()
 
@@ -125,6 +126,7 @@ namespace algorithm
       bool _skip_hashing;                    // Assume reads never can see torn writes
       uint64 _unique_id;                     // My (very random) unique id
       atomic_append_detail::header _header;  // Header as of the last time I read it
+      uint64 _known_clear_until{0};          // Every record before this offset has been seen completed by me
 
       atomic_append(file_handle &&h, file_handle::extent_guard &&guard, bool nfs_compatibility, bool skip_hashing)
           : _h(std::move(h))
@@ -167,6 +169,9 @@ namespace algorithm
         } while(_header.hash != QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash((reinterpret_cast<char *>(&_header)) + 16, sizeof(_header) - 16));
         return success();
       }
+      // Lock requests are only ever appended, then zeroed, so once seen completed a record stays completed.
+      // No scan need ever look below this.
+      uint64 _scan_floor() const noexcept { return (std::max)(_header.first_known_good, _known_clear_until); }
 
     public:
       //! The type of an entity id
@@ -180,7 +185,7 @@ namespace algorithm
       atomic_append &operator=(const atomic_append &) = delete;
       ~atomic_append() = default;
       //! Move constructor
-      atomic_append(atomic_append &&o) noexcept : _h(std::move(o._h)), _guard(std::move(o._guard)), _nfs_compatibility(o._nfs_compatibility), _skip_hashing(o._skip_hashing), _unique_id(o._unique_id), _header(o._header) { _guard.set_handle(&_h); }
+      atomic_append(atomic_append &&o) noexcept : shared_fs_mutex(std::move(o)), _h(std::move(o._h)), _guard(std::move(o._guard)), _nfs_compatibility(o._nfs_compatibility), _skip_hashing(o._skip_hashing), _unique_id(o._unique_id), _header(o._header), _known_clear_until(o._known_clear_until) { _guard.set_handle(&_h); }
       //! Move assign
       atomic_append &operator=(atomic_append &&o) noexcept
       {
@@ -302,33 +307,42 @@ namespace algorithm
           OUTCOME_TRYV(_h.write(0, {{reinterpret_cast<byte *>(&lock_request), sizeof(lock_request)}}));
         }
 
-        // Find the record I just wrote
+        // Find the record I just wrote. Reading back begins up to 4Kb before where my request can
+        // first appear, so the records preceding mine arrive in the same read as mine and the
+        // first batch of the scan below does not need to read them again.
         alignas(64) byte _buffer[4096 + 2048];  // 6Kb cache line aligned buffer
-        // Read onwards from length as reported before I wrote my lock request
-        // until I find my lock request. This loop should never actually iterate
-        // except under extreme load conditions.
-        //! \todo Read from header.last_known_good immediately if possible in order
-        //! to avoid a duplicate read later
+        auto readback_offset = my_lock_request_offset;
+        if(readback_offset > _scan_floor())
+        {
+          readback_offset -= (std::min)(readback_offset - _scan_floor(), (uint64) 4096);
+        }
+        const byte *cached = nullptr;  // records from readback_offset up to my lock request
+        // This loop should never actually iterate except under extreme load conditions.
         for(;;)
         {
           file_handle::buffer_type req{_buffer, sizeof(_buffer)};
-          file_handle::io_result<file_handle::buffers_type> readoutcome = _h.read({{&req, 1}, my_lock_request_offset});
+          file_handle::io_result<file_handle::buffers_type> readoutcome = _h.read({{&req, 1}, readback_offset});
           // Should never happen :)
           if(readoutcome.has_error())
           {
             LLFIO_LOG_FATAL(this, "atomic_append::lock() saw an error when searching for just written data");
             std::terminate();
           }
-          const atomic_append_detail::lock_request *record, *lastrecord;
-          for(record = reinterpret_cast<const atomic_append_detail::lock_request *>(readoutcome.value()[0].data()), lastrecord = reinterpret_cast<const atomic_append_detail::lock_request *>(readoutcome.value()[0].data() + readoutcome.value()[0].size()); record < lastrecord && record->hash != lock_request.hash;
-              ++record)
+          const auto *firstrecord = reinterpret_cast<const atomic_append_detail::lock_request *>(readoutcome.value()[0].data());
+          const auto *lastrecord = reinterpret_cast<const atomic_append_detail::lock_request *>(readoutcome.value()[0].data() + readoutcome.value()[0].size());
+          // Skip the records known to precede mine
+          const auto preceding = static_cast<size_t>((my_lock_request_offset - readback_offset) / sizeof(atomic_append_detail::lock_request));
+          const atomic_append_detail::lock_request *record = firstrecord + (std::min)(preceding, static_cast<size_t>(lastrecord - firstrecord));
+          for(; record < lastrecord && 0 != memcmp(record, &lock_request, sizeof(lock_request)); ++record)
           {
             my_lock_request_offset += sizeof(atomic_append_detail::lock_request);
           }
-          if(record->hash == lock_request.hash)
+          if(record < lastrecord)
           {
+            cached = readoutcome.value()[0].data();
             break;
           }
+          readback_offset = my_lock_request_offset;
         }
 
         // extent_guard is now valid and will be unlocked on error
@@ -346,16 +360,22 @@ namespace algorithm
           my_request_guard = std::move(my_request_guard_);
         }
 
-        // Read every record preceding mine until header.first_known_good inclusive
+        // Read every record preceding mine until the scan floor inclusive
         auto record_offset = my_lock_request_offset - sizeof(atomic_append_detail::lock_request);
+        auto lowest_outstanding = my_lock_request_offset;
         do
         {
         reload:
           // Refresh the header and load a snapshot of everything between record_offset
-          // and first_known_good or -6Kb, whichever the sooner
-          OUTCOME_TRYV(_read_header());
+          // and the scan floor or -6Kb, whichever the sooner. The first batch comes from
+          // the read back of my request, as first_known_good only ever rises and so a stale
+          // header merely scans more than is needed.
+          if(cached == nullptr)
+          {
+            OUTCOME_TRYV(_read_header());
+          }
           // If there are no preceding records, we're done
-          if(record_offset < _header.first_known_good)
+          if(record_offset < _scan_floor())
           {
             break;
           }
@@ -368,17 +388,33 @@ namespace algorithm
           {
             start_offset = sizeof(atomic_append_detail::lock_request);
           }
-          if(start_offset < _header.first_known_good)
+          if(start_offset < _scan_floor())
+          {
+            start_offset = _scan_floor();
+          }
+          const atomic_append_detail::lock_request *record, *firstrecord;
+          if(cached != nullptr && record_offset >= readback_offset)
+          {
+            // Use the records which arrived with the read back of my request
+            if(start_offset < readback_offset)
+            {
+              start_offset = readback_offset;
+            }
+            firstrecord = reinterpret_cast<const atomic_append_detail::lock_request *>(cached + (start_offset - readback_offset));
+            record = reinterpret_cast<const atomic_append_detail::lock_request *>(cached + (record_offset - readback_offset));
+            cached = nullptr;
+          }
+          else
           {
-            start_offset = _header.first_known_good;
+            cached = nullptr;
+            assert(record_offset >= start_offset);
+            assert(record_offset - start_offset <= sizeof(_buffer));
+            file_handle::buffer_type req{_buffer, (size_t)(record_offset - start_offset) + sizeof(atomic_append_detail::lock_request)};
+            OUTCOME_TRY(auto &&batchread, _h.read({{&req, 1}, start_offset}));
+            assert(batchread[0].size() == record_offset - start_offset + sizeof(atomic_append_detail::lock_request));
+            record = reinterpret_cast<const atomic_append_detail::lock_request *>(batchread[0].data() + batchread[0].size() - sizeof(atomic_append_detail::lock_request));
+            firstrecord = reinterpret_cast<const atomic_append_detail::lock_request *>(batchread[0].data());
           }
-          assert(record_offset >= start_offset);
-          assert(record_offset - start_offset <= sizeof(_buffer));
-          file_handle::buffer_type req{_buffer, (size_t)(record_offset - start_offset) + sizeof(atomic_append_detail::lock_request)};
-          OUTCOME_TRY(auto &&batchread, _h.read({{&req, 1}, start_offset}));
-          assert(batchread[0].size() == record_offset - start_offset + sizeof(atomic_append_detail::lock_request));
-          const atomic_append_detail::lock_request *record = reinterpret_cast<atomic_append_detail::lock_request *>(batchread[0].data() + batchread[0].size() - sizeof(atomic_append_detail::lock_request));
-          const atomic_append_detail::lock_request *firstrecord = reinterpret_cast<atomic_append_detail::lock_request *>(batchread[0].data());
 
           // Skip all completed lock requests or not mentioning any of my entities
           for(; record >= firstrecord; record_offset -= sizeof(atomic_append_detail::lock_request), --record)
@@ -408,11 +444,14 @@ namespace algorithm
                   // If so, need to block
                   if((record->entities[n].exclusive != 0u) || (entity.exclusive != 0u))
                   {
+                    this->_note_failed_attempt(entity.value);
                     goto beginwait;
                   }
                 }
               }
             }
+            // This record is outstanding but does not block me
+            lowest_outstanding = record_offset;
           }
           // None of this batch of records has anything to do with my request, so keep going
           continue;
@@ -425,8 +464,13 @@ namespace algorithm
           // so if our shared lock succeeds we need to immediately
           // unlock and retry based on the data.
           std::this_thread::yield();
-          if(!spin_not_sleep)
+          if(spin_not_sleep)
+          {
+            this->_note_spin();
+          }
+          else
           {
+            this->_note_sleep();
             deadline nd;
             if(d)
             {
@@ -470,7 +514,12 @@ namespace algorithm
               }
             }
           }
-        } while(record_offset >= _header.first_known_good);
+        } while(record_offset >= _scan_floor());
+        // Everything below the lowest outstanding record I saw has completed, so future scans can stop there
+        if(lowest_outstanding > _known_clear_until)
+        {
+          _known_clear_until = lowest_outstanding;
+        }
         return success();
       }
 
@@ -511,7 +560,9 @@ namespace algorithm
           //_read_header();
 
           // Forward scan records until first non-zero record is found
-          // and update header with new info
+          // and update header with new info. Records I have already seen
+          // completed need not be read again.
+          _header.first_known_good = _scan_floor();
           alignas(64) byte _buffer[4096 + 2048];
           bool done = false;
           while(!done)
@@ -29,6 +29,9 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "quickcpplib/algorithm/hash.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
 //! \file base.hpp Provides algorithm::shared_fs_mutex::shared_fs_mutex
 
@@ -101,7 +104,130 @@ namespace algorithm
       //! The type of a sequence of entities
       using entities_type = span<entity_type>;
 
+      /*! \brief Opt-in counters of lock contention, which may be placed in shared memory for an external monitor to read.
+
+      All members are zero when constructed, or if the storage is zero filled (e.g. a freshly truncated
+      file mapped into memory), so an external monitor can find this inside a mapped file at a known
+      offset and read it without any cooperation. Many instances, in many processes, may share the
+      same block. All updates are relaxed atomic increments, so readers see approximate, but never torn,
+      counts.
+
+      Implementations differ in what they count. All count acquisitions and their wait times, as these
+      are measured by `shared_fs_mutex::lock()`. Failed attempts are each time an implementation found an
+      entity, or a hashed bucket of entities, locked by somebody else. Spins are each time the thread
+      yielded before retrying, sleeps each time it slept or waited in the kernel. `safe_byte_ranges` on
+      POSIX only counts acquisitions and wait times.
+      */
+      struct contention_statistics
+      {
+        //! The number of wait time histogram buckets
+        static constexpr size_t wait_histogram_buckets = 32;
+        //! The number of sampled hot entities tracked
+        static constexpr size_t hot_entity_slots = 16;
+        //! One in this many failed attempts is sampled into the hot entities
+        static constexpr uint32_t hot_entity_sample_rate = 8;
+
+        std::atomic<uint64> acquisitions{0};         //!< Successful lock acquisitions
+        std::atomic<uint64> failed_acquisitions{0};  //!< Lock acquisitions which timed out or failed
+        std::atomic<uint64> failed_attempts{0};      //!< Attempts to lock an entity which found it locked
+        std::atomic<uint64> spins{0};                //!< Yields of the thread before retrying
+        std::atomic<uint64> sleeps{0};               //!< Sleeps of the thread before retrying
+        /*! Successful acquisitions by wait time. Bucket zero counts waits of under a microsecond,
+        bucket N waits of [2^(N-1), 2^N) microseconds, and the last bucket all longer waits.
+        */
+        std::atomic<uint64> wait_histogram[wait_histogram_buckets]{};
+        //! A sampled, approximately most contended, entity value (or bucket for hashed implementations)
+        struct hot_entity
+        {
+          std::atomic<uint64> value{0};  //!< The entity value
+          std::atomic<uint64> count{0};  //!< Approximately how many sampled failed attempts it had
+        } hot_entities[hot_entity_slots];
+        std::atomic<uint32_t> _sampler{0};
+
+        //! Zeroes all the counters
+        void reset() noexcept
+        {
+          acquisitions.store(0, std::memory_order_relaxed);
+          failed_acquisitions.store(0, std::memory_order_relaxed);
+          failed_attempts.store(0, std::memory_order_relaxed);
+          spins.store(0, std::memory_order_relaxed);
+          sleeps.store(0, std::memory_order_relaxed);
+          for(auto &i : wait_histogram)
+          {
+            i.store(0, std::memory_order_relaxed);
+          }
+          for(auto &i : hot_entities)
+          {
+            i.value.store(0, std::memory_order_relaxed);
+            i.count.store(0, std::memory_order_relaxed);
+          }
+        }
+
+        //! Records an acquisition after waiting for `wait`
+        void note_acquisition(std::chrono::steady_clock::duration wait) noexcept
+        {
+          acquisitions.fetch_add(1, std::memory_order_relaxed);
+          auto us = static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(wait).count());
+          size_t bucket = 0;
+          while(us != 0 && bucket < wait_histogram_buckets - 1)
+          {
+            us >>= 1;
+            ++bucket;
+          }
+          wait_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+        //! Records a failed attempt upon an entity, sampling it into the hot entities
+        void note_failed_attempt(uint64 value) noexcept
+        {
+          failed_attempts.fetch_add(1, std::memory_order_relaxed);
+          if(_sampler.fetch_add(1, std::memory_order_relaxed) % hot_entity_sample_rate != 0)
+          {
+            return;
+          }
+          // Space saving: bump the entity's slot if it has one, else replace the least counted slot
+          hot_entity *least = &hot_entities[0];
+          for(auto &i : hot_entities)
+          {
+            if(i.value.load(std::memory_order_relaxed) == value && i.count.load(std::memory_order_relaxed) != 0)
+            {
+              i.count.fetch_add(1, std::memory_order_relaxed);
+              return;
+            }
+            if(i.count.load(std::memory_order_relaxed) < least->count.load(std::memory_order_relaxed))
+            {
+              least = &i;
+            }
+          }
+          least->value.store(value, std::memory_order_relaxed);
+          least->count.fetch_add(1, std::memory_order_relaxed);
+        }
+      };
+
     protected:
+      contention_statistics *_statistics{nullptr};
+
+      void _note_failed_attempt(uint64 value) const noexcept
+      {
+        if(_statistics != nullptr)
+        {
+          _statistics->note_failed_attempt(value);
+        }
+      }
+      void _note_spin() const noexcept
+      {
+        if(_statistics != nullptr)
+        {
+          _statistics->spins.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      void _note_sleep() const noexcept
+      {
+        if(_statistics != nullptr)
+        {
+          _statistics->sleeps.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+
       constexpr shared_fs_mutex() {}  // NOLINT
       shared_fs_mutex(const shared_fs_mutex &) = default;
       shared_fs_mutex(shared_fs_mutex &&) = default;
@@ -140,6 +266,32 @@ namespace algorithm
         }
       }
 
+      /*! \brief Sorts a sequence of entities by value in place and merges duplicates, a merged entity
+      being exclusive if any of its duplicates were. Returns the distinct entities, which are a prefix
+      of the input.
+      */
+      static entities_type sort_and_merge_entities(entities_type entities) noexcept
+      {
+        if(entities.size() < 2)
+        {
+          return entities;
+        }
+        std::sort(entities.begin(), entities.end(), [](const entity_type &a, const entity_type &b) { return a.value < b.value; });
+        size_t last = 0;
+        for(size_t n = 1; n < entities.size(); n++)
+        {
+          if(entities[n].value == entities[last].value)
+          {
+            entities[last].exclusive = entities[last].exclusive | entities[n].exclusive;
+          }
+          else
+          {
+            entities[++last] = entities[n];
+          }
+        }
+        return entities_type(entities.data(), last + 1);
+      }
+
       //! RAII holder for a lock on a sequence of entities
       class entities_guard
       {
@@ -217,18 +369,51 @@ namespace algorithm
 
       virtual result<void> _lock(entities_guard &out, deadline d, bool spin_not_sleep) noexcept = 0;
 
-      //! Lock all of a sequence of entities for exclusive or shared access
+      result<void> _lock_instrumented(entities_guard &out, deadline d, bool spin_not_sleep) noexcept
+      {
+        if(_statistics == nullptr)
+        {
+          return _lock(out, d, spin_not_sleep);
+        }
+        const auto began = std::chrono::steady_clock::now();
+        auto r = _lock(out, d, spin_not_sleep);
+        if(r)
+        {
+          _statistics->note_acquisition(std::chrono::steady_clock::now() - began);
+        }
+        else
+        {
+          _statistics->failed_acquisitions.fetch_add(1, std::memory_order_relaxed);
+        }
+        return r;
+      }
+
+      /*! \brief Sets the contention statistics block which this instance updates, which may be in memory
+      shared with other processes. Null, the default, disables instrumentation. The block must outlive
+      its use by this instance.
+      */
+      void set_contention_statistics(contention_statistics *stats) noexcept { _statistics = stats; }
+      //! Returns the contention statistics block which this instance updates, if any.
+      contention_statistics *contention_statistics_block() const noexcept { return _statistics; }
+
+      /*! \brief Lock all of a sequence of entities for exclusive or shared access.
+
+      The sequence is first sorted and deduplicated in place by `sort_and_merge_entities()`, so
+      implementations see each entity only once, in ascending order, and may coalesce adjacent entities.
+      The returned guard refers to the distinct entities at the front of the sequence, and the
+      sequence may be reordered further by the implementation whilst locking.
+      */
       result<entities_guard> lock(entities_type entities, deadline d = deadline(), bool spin_not_sleep = false) noexcept
       {
-        entities_guard ret(this, entities);
-        OUTCOME_TRYV(_lock(ret, d, spin_not_sleep));
+        entities_guard ret(this, sort_and_merge_entities(entities));
+        OUTCOME_TRYV(_lock_instrumented(ret, d, spin_not_sleep));
         return {std::move(ret)};
       }
       //! Lock a single entity for exclusive or shared access
       result<entities_guard> lock(entity_type entity, deadline d = deadline(), bool spin_not_sleep = false) noexcept
       {
         entities_guard ret(this, entity);
-        OUTCOME_TRYV(_lock(ret, d, spin_not_sleep));
+        OUTCOME_TRYV(_lock_instrumented(ret, d, spin_not_sleep));
         return {std::move(ret)};
       }
       //! Try to lock all of a sequence of entities for exclusive or shared access
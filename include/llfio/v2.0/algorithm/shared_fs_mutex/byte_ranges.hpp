@@ -42,25 +42,26 @@ namespace algorithm
     \brief Many entity shared/exclusive file system based lock
 
     This is a simple many entity shared mutex. It works by locking in the same file the byte at the
-    offset of the entity id. If it fails to lock a byte, it backs out all preceding locks, randomises the order
-    and tries locking them again until success. Needless to say this algorithm puts a lot of strain on
-    your byte range locking implementation, some NFS implementations have been known to fail to cope.
+    offset of the entity id. Entities are locked in ascending order, with runs of consecutive entities
+    of the same kind locked as a single byte range, so a lock costs a syscall per distinct run rather
+    than per entity. As the order of acquisition is the same for everybody, without a deadline each
+    range is waited for in the kernel. With a deadline, if it fails to lock a range, it backs out all
+    preceding locks and tries again until success or the deadline. Needless to say this algorithm puts
+    a lot of strain on your byte range locking implementation, some NFS implementations have been known
+    to fail to cope.
 
     \note Most users will want to use `safe_byte_ranges` instead of this class directly.
 
     - Compatible with networked file systems, though be cautious with older NFS.
     - Linear complexity to number of concurrent users.
-    - Exponential complexity to number of entities being concurrently locked, though some OSs
-    provide linear complexity so long as total concurrent waiting processes is CPU core count or less.
-    - Does a reasonable job of trying to sleep the thread if any of the entities are locked.
+    - Linear complexity to number of distinct runs of entities being concurrently locked.
+    - Sleeps the thread in the kernel if any of the entities are locked and there is no deadline.
     - Sudden process exit with lock held is recovered from.
     - Sudden power loss during use is recovered from.
     - Safe for multithreaded usage of the same instance.
 
     Caveats:
-    - When entities being locked is more than one, the algorithm places the contending lock at the
-    front of the list during the randomisation after lock failure so we can sleep the thread until
-    it becomes free. However, under heavy churn the thread will generally spin, consuming 100% CPU.
+    - With a deadline, the thread spins with a yield between attempts, consuming 100% CPU.
     - Byte range locks need to work properly on your system. Misconfiguring NFS or Samba
     to cause byte range locks to not work right will produce bad outcomes.
     - If your OS doesn't have sane byte range locks (OS X, BSD, older Linuxes) and multiple
@@ -91,7 +92,7 @@ namespace algorithm
       byte_ranges &operator=(const byte_ranges &) = delete;
       ~byte_ranges() = default;
       //! Move constructor
-      byte_ranges(byte_ranges &&o) noexcept : _h(std::move(o._h)) {}
+      byte_ranges(byte_ranges &&o) noexcept : shared_fs_mutex(std::move(o)), _h(std::move(o._h)) {}
       //! Move assign
       byte_ranges &operator=(byte_ranges &&o) noexcept
       {
@@ -116,6 +117,26 @@ namespace algorithm
       const file_handle &handle() const noexcept { return _h; }
 
     protected:
+      // Returns the end of the run of consecutive entities of the same kind beginning at begin, in sorted distinct entities
+      static size_t _run_end(entities_type entities, size_t begin) noexcept
+      {
+        size_t end = begin + 1;
+        while(end < entities.size() && entities[end].exclusive == entities[begin].exclusive && entities[end].value == entities[end - 1].value + 1)
+        {
+          ++end;
+        }
+        return end;
+      }
+      // Unlocks exactly the ranges which _lock() locked for these sorted distinct entities, as Windows requires
+      void _unlock_runs(entities_type entities) noexcept
+      {
+        for(size_t n = 0; n < entities.size();)
+        {
+          const size_t end = _run_end(entities, n);
+          _h.unlock_file_range(entities[n].value, end - n);
+          n = end;
+        }
+      }
       LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> _lock(entities_guard &out, deadline d, bool spin_not_sleep) noexcept final
       {
         LLFIO_LOG_FUNCTION_CALL(this);
@@ -132,71 +153,41 @@ namespace algorithm
             end_utc = (d).to_time_point();
           }
         }
+        // Sorted order of acquisition cannot deadlock, so without a deadline I can wait in the kernel
+        // for every range. Otherwise try every range, and retry until the deadline.
+        const bool wait_in_kernel = !d && !spin_not_sleep;
         // Fire this if an error occurs
         auto disableunlock = make_scope_exit([&]() noexcept { out.release(); });
-        size_t n;
         for(;;)
         {
-          auto was_contended = static_cast<size_t>(-1);
+          size_t locked = 0;  // entities before this are locked
           {
-            auto undo = make_scope_exit([&]() noexcept {
-              // 0 to (n-1) need to be closed
-              if(n > 0)
-              {
-                --n;
-                // Now 0 to n needs to be closed
-                for(; n > 0; n--)
-                {
-                  _h.unlock_file_range(out.entities[n].value, 1);
-                }
-                _h.unlock_file_range(out.entities[0].value, 1);
-              }
-            });
-            for(n = 0; n < out.entities.size(); n++)
+            auto undo = make_scope_exit([&]() noexcept { _unlock_runs(entities_type(out.entities.data(), locked)); });
+            while(locked < out.entities.size())
             {
-              deadline nd;
-              // Only for very first entity will we sleep until its lock becomes available
-              if(n != 0u)
-              {
-                nd = deadline(std::chrono::seconds(0));
-              }
-              else
+              const size_t end = _run_end(out.entities, locked);
+              auto outcome = _h.lock_file_range(out.entities[locked].value, end - locked, (out.entities[locked].exclusive != 0u) ? lock_kind::exclusive : lock_kind::shared,
+                                                wait_in_kernel ? deadline() : deadline(std::chrono::seconds(0)));
+              if(!outcome)
               {
-                nd = deadline();
-                if(d)
+                if(outcome.error() != errc::timed_out)
                 {
-                  if((d).steady)
-                  {
-                    std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now());
-                    if(ns.count() < 0)
-                    {
-                      (nd).nsecs = 0;
-                    }
-                    else
-                    {
-                      (nd).nsecs = ns.count();
-                    }
-                  }
-                  else
-                  {
-                    (nd) = (d);
-                  }
+                  return std::move(outcome).error();
                 }
-              }
-              auto outcome = _h.lock_file_range(out.entities[n].value, 1, (out.entities[n].exclusive != 0u) ? lock_kind::exclusive : lock_kind::shared, nd);
-              if(!outcome)
-              {
-                was_contended = n;
-                goto failed;
+                this->_note_failed_attempt(out.entities[locked].value);
+                break;
               }
               outcome.value().release();
+              locked = end;
+            }
+            if(locked == out.entities.size())
+            {
+              // Everything is locked, exit
+              undo.release();
+              disableunlock.release();
+              return success();
             }
-            // Everything is locked, exit
-            undo.release();
-            disableunlock.release();
-            return success();
           }
-        failed:
           if(d)
           {
             if((d).steady)
@@ -214,13 +205,9 @@ namespace algorithm
               }
             }
           }
-          // Move was_contended to front and randomise rest of out.entities
-          std::swap(out.entities[was_contended], out.entities[0]);
-          auto front = out.entities.begin();
-          ++front;
-          QUICKCPPLIB_NAMESPACE::algorithm::small_prng::random_shuffle(front, out.entities.end());
           if(!spin_not_sleep)
           {
+            this->_note_spin();
             std::this_thread::yield();
           }
         }
@@ -231,10 +218,7 @@ namespace algorithm
       LLFIO_HEADERS_ONLY_VIRTUAL_SPEC void unlock(entities_type entities, unsigned long long /*hint*/) noexcept final
       {
         LLFIO_LOG_FUNCTION_CALL(this);
-        for(const auto &i : entities)
-        {
-          _h.unlock_file_range(i.value, 1);
-        }
+        _unlock_runs(sort_and_merge_entities(entities));
       }
     };
 
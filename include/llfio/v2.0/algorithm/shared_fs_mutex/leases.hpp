@@ -0,0 +1,519 @@
+/* Lease caching network filesystem lock
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_SHARED_FS_MUTEX_LEASES_HPP
+#define LLFIO_SHARED_FS_MUTEX_LEASES_HPP
+
+#include "../../file_handle.hpp"
+#include "../../utils.hpp"
+#include "base.hpp"
+
+#include "quickcpplib/algorithm/hash.hpp"
+#include "quickcpplib/algorithm/small_prng.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+
+//! \file leases.hpp Provides algorithm::shared_fs_mutex::leases
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace shared_fs_mutex
+  {
+    /*! \class leases
+    \brief Many entity shared/exclusive networked file system based lock which caches time bounded leases
+
+    On a networked filing system, every lock by `byte_ranges` or `lock_files` is at least one round
+    trip to the lock server. This implementation instead grants time bounded leases recorded in a shared
+    lock file, and remembers them locally, so relocking an entity whose lease this instance still holds
+    costs no network operations at all. This suits workloads which repeatedly lock the same few entities
+    from the same machine.
+
+    Entities are hashed into one of `HashIndexEntries` records in the lock file, each of which holds one
+    exclusive lease and up to `ReaderSlots` shared leases, each naming its holder and when it expires.
+    To acquire a lease not already held, a record is byte range locked, read, updated and written back,
+    then unlocked. A lease is granted if nobody else holds a conflicting unexpired lease, expired leases
+    being reclaimed. Unlocking an entity does not give up its lease, which remains cached until it
+    expires or `release_leases()` is called. A cached lease is only relied upon if at least half of the
+    lease duration remains, otherwise it is renewed.
+
+    - Compatible with networked file systems, as only brief byte range locks are ever taken.
+    - Linear complexity to number of concurrent users.
+    - Exponential complexity to number of contended entities being concurrently locked.
+    - Relocking an entity within its lease costs no syscalls.
+    - Sudden process exit with lock held is recovered from once the lease expires.
+    - Sudden power loss during use is recovered from once the lease expires.
+    - Safe for multithreaded usage of the same instance, with threads arbitrated locally.
+
+    Caveats:
+    - A lock must be released within half of the lease duration, otherwise its lease can expire
+    and be granted to somebody else whilst still locked.
+    - Lease expiries are absolute system clock times, so the clocks of all machines sharing the lock
+    file must agree to well within half of the lease duration.
+    - Other users wait until a lease cached by an idle holder expires, so the lease duration bounds
+    the latency of handing over an entity between machines. Call `release_leases()` to hand over
+    promptly.
+    - No ability to sleep until a lease becomes free, so CPUs are spun, albeit with backoff.
+    - Entities colliding in the hash index are locked together, and no more than `ReaderSlots`
+    instances may hold a shared lease on the same record at once.
+    - Lease acquisition by one thread serialises all other threads using the same instance.
+    - If your OS doesn't have sane byte range locks (OS X, BSD, older Linuxes) and multiple
+    objects in your process use the same lock file, misoperation will occur. Share a single
+    instance of this class per lock file in this case.
+    */
+    template <template <class> class Hasher = QUICKCPPLIB_NAMESPACE::algorithm::hash::fnv1a_hash, size_t HashIndexEntries = 4096, size_t ReaderSlots = 7> class leases : public shared_fs_mutex
+    {
+    public:
+      //! The type of an entity id
+      using entity_type = shared_fs_mutex::entity_type;
+      //! The type of a sequence of entities
+      using entities_type = shared_fs_mutex::entities_type;
+      //! The type of the hasher being used
+      using hasher_type = Hasher<entity_type::value_type>;
+
+    private:
+      static_assert(ReaderSlots > 0, "There must be at least one reader slot");
+      struct _lease_type
+      {
+        uint64 owner;    // zero if nobody
+        uint64 expires;  // microseconds since the system clock epoch
+      };
+      struct _record_type
+      {
+        _lease_type writer;
+        _lease_type readers[ReaderSlots];
+      };
+      struct _cached_type
+      {
+        bool exclusive{false};  // of the lease, not of the local lockers
+        uint64 expires{0};
+        bool writer{false};  // locked exclusively by this instance
+        size_t readers{0};   // times locked shared by this instance
+      };
+      struct _entity_idx
+      {
+        unsigned value : 31;
+        unsigned exclusive : 1;
+      };
+
+      file_handle _h;
+      uint64 _unique_id{0};
+      uint64 _lease_duration;  // in microseconds
+      std::mutex _cache_lock;
+      std::unordered_map<unsigned, _cached_type> _cache;
+
+      leases(file_handle &&h, std::chrono::microseconds lease_duration)
+          : _h(std::move(h))
+          , _lease_duration(static_cast<uint64>(lease_duration.count()))
+      {
+        while(_unique_id == 0)
+        {
+          utils::random_fill(reinterpret_cast<char *>(&_unique_id), sizeof(_unique_id));  // NOLINT crypto strong random
+        }
+      }
+
+      static uint64 _now() noexcept { return static_cast<uint64>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count()); }
+      static file_handle::extent_type _offset(unsigned idx) noexcept { return static_cast<file_handle::extent_type>(idx) * sizeof(_record_type); }
+
+      result<void> _read_record(_record_type &rec, unsigned idx) noexcept
+      {
+        // Records never written to read as zero, which is nobody holding anything
+        memset(&rec, 0, sizeof(rec));
+        file_handle::buffer_type req{reinterpret_cast<byte *>(&rec), sizeof(rec)};
+        OUTCOME_TRY(auto &&_, _h.read({{&req, 1}, _offset(idx)}));
+        if(!_.empty() && _[0].data() != reinterpret_cast<byte *>(&rec))
+        {
+          memcpy(&rec, _[0].data(), _[0].size());
+        }
+        return success();
+      }
+
+      // Takes or renews a lease in the lock file, returning false if somebody else holds a conflicting one
+      result<bool> _acquire_lease(unsigned idx, bool exclusive, _cached_type &cached) noexcept
+      {
+        OUTCOME_TRY(auto &&guard, _h.lock_file_range(_offset(idx), sizeof(_record_type), lock_kind::exclusive));
+        _record_type rec;
+        OUTCOME_TRY(_read_record(rec, idx));
+        const uint64 now = _now();
+        auto is_someone_elses = [&](const _lease_type &l) { return l.owner != 0 && l.owner != _unique_id && l.expires > now; };
+        if(is_someone_elses(rec.writer))
+        {
+          return false;
+        }
+        const uint64 expires = now + _lease_duration;
+        if(exclusive)
+        {
+          for(auto &i : rec.readers)
+          {
+            if(is_someone_elses(i))
+            {
+              return false;
+            }
+          }
+          for(auto &i : rec.readers)
+          {
+            if(i.owner == _unique_id)
+            {
+              i = {0, 0};
+            }
+          }
+          rec.writer = {_unique_id, expires};
+        }
+        else
+        {
+          _lease_type *slot = nullptr;
+          for(auto &i : rec.readers)
+          {
+            if(i.owner == _unique_id)
+            {
+              slot = &i;
+              break;
+            }
+          }
+          for(size_t n = 0; slot == nullptr && n < ReaderSlots; n++)
+          {
+            if(!is_someone_elses(rec.readers[n]))
+            {
+              slot = &rec.readers[n];
+            }
+          }
+          if(slot == nullptr)
+          {
+            return false;
+          }
+          *slot = {_unique_id, expires};
+          if(rec.writer.owner == _unique_id)
+          {
+            rec.writer = {0, 0};
+          }
+        }
+        OUTCOME_TRYV(_h.write(_offset(idx), {{reinterpret_cast<byte *>(&rec), sizeof(rec)}}));
+        cached.exclusive = exclusive;
+        cached.expires = expires;
+        return true;
+      }
+
+      // Gives up any lease held in the lock file
+      result<void> _release_lease(unsigned idx) noexcept
+      {
+        OUTCOME_TRY(auto &&guard, _h.lock_file_range(_offset(idx), sizeof(_record_type), lock_kind::exclusive));
+        _record_type rec;
+        OUTCOME_TRY(_read_record(rec, idx));
+        bool changed = false;
+        if(rec.writer.owner == _unique_id)
+        {
+          rec.writer = {0, 0};
+          changed = true;
+        }
+        for(auto &i : rec.readers)
+        {
+          if(i.owner == _unique_id)
+          {
+            i = {0, 0};
+            changed = true;
+          }
+        }
+        if(changed)
+        {
+          OUTCOME_TRYV(_h.write(_offset(idx), {{reinterpret_cast<byte *>(&rec), sizeof(rec)}}));
+        }
+        return success();
+      }
+
+      // Locks an index for this instance, using a cached lease if possible. Returns false if contended.
+      result<bool> _lock_entry(unsigned idx, bool exclusive) noexcept
+      {
+        try
+        {
+          std::lock_guard<std::mutex> g(_cache_lock);
+          auto &cached = _cache[idx];
+          if(cached.writer || (exclusive && cached.readers > 0))
+          {
+            // Contended by another thread using this instance, no need to ask anybody else
+            return false;
+          }
+          // Relocking within a lease of sufficient kind and remaining duration needs nobody else
+          if((!cached.exclusive && exclusive) || cached.expires < _now() + _lease_duration / 2)
+          {
+            // An upgrade, or renewal of a lease, keeps it exclusive if it already was
+            OUTCOME_TRY(auto &&granted, _acquire_lease(idx, exclusive || (cached.exclusive && cached.expires > _now()), cached));
+            if(!granted)
+            {
+              return false;
+            }
+          }
+          if(exclusive)
+          {
+            cached.writer = true;
+          }
+          else
+          {
+            cached.readers++;
+          }
+          return true;
+        }
+        catch(...)
+        {
+          return error_from_exception();
+        }
+      }
+
+      void _unlock_entry(unsigned idx, bool exclusive) noexcept
+      {
+        std::lock_guard<std::mutex> g(_cache_lock);
+        auto it = _cache.find(idx);
+        if(it != _cache.end())
+        {
+          if(exclusive)
+          {
+            it->second.writer = false;
+          }
+          else if(it->second.readers > 0)
+          {
+            it->second.readers--;
+          }
+        }
+      }
+
+    public:
+      //! No copy construction
+      leases(const leases &) = delete;
+      //! No copy assignment
+      leases &operator=(const leases &) = delete;
+      ~leases()
+      {
+        if(_h.is_valid())
+        {
+          (void) release_leases();
+        }
+      }
+      //! Move constructor
+      leases(leases &&o) noexcept : shared_fs_mutex(std::move(o)), _h(std::move(o._h)), _unique_id(o._unique_id), _lease_duration(o._lease_duration), _cache(std::move(o._cache)) {}
+      //! Move assign
+      leases &operator=(leases &&o) noexcept
+      {
+        if(this == &o)
+        {
+          return *this;
+        }
+        this->~leases();
+        new(this) leases(std::move(o));
+        return *this;
+      }
+
+      /*! Initialises a shared filing system mutex using the file at \em lockfile.
+      \param base Optional base for the path to the file.
+      \param lockfile The path to the file to use for storing leases.
+      \param lease_duration How long a lease lasts. Locks must be released within half of this.
+      */
+      LLFIO_MAKE_FREE_FUNCTION
+      static result<leases> fs_mutex_leases(const path_handle &base, path_view lockfile, std::chrono::microseconds lease_duration = std::chrono::seconds(10)) noexcept
+      {
+        LLFIO_LOG_FUNCTION_CALL(0);
+        if(lease_duration.count() <= 0)
+        {
+          return errc::invalid_argument;
+        }
+        // Writes are written through so a granted lease is visible to other machines before its record is unlocked
+        OUTCOME_TRY(auto &&ret, file_handle::file(base, lockfile, file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::reads));
+        return leases(std::move(ret), lease_duration);
+      }
+
+      //! Return the handle to file being used for this lock
+      const file_handle &handle() const noexcept { return _h; }
+
+      //! The duration of a lease
+      std::chrono::microseconds lease_duration() const noexcept { return std::chrono::microseconds(_lease_duration); }
+
+      //! Gives up all cached leases of entities not currently locked by this instance, so other users need not wait for them to expire
+      result<void> release_leases() noexcept
+      {
+        LLFIO_LOG_FUNCTION_CALL(this);
+        std::lock_guard<std::mutex> g(_cache_lock);
+        for(auto it = _cache.begin(); it != _cache.end();)
+        {
+          if(it->second.writer || it->second.readers > 0)
+          {
+            ++it;
+            continue;
+          }
+          OUTCOME_TRYV(_release_lease(it->first));
+          it = _cache.erase(it);
+        }
+        return success();
+      }
+
+    protected:
+      // Create a cache of entities to their indices, eliding collisions where necessary
+      static span<_entity_idx> _hash_entities(_entity_idx *entity_to_idx, entities_type &entities)
+      {
+        if(entities.empty())
+        {
+          return {};
+        }
+        for(size_t n = 0; n < entities.size(); n++)
+        {
+          entity_to_idx[n].value = hasher_type()(entities[n].value) % HashIndexEntries;
+          entity_to_idx[n].exclusive = entities[n].exclusive;
+        }
+        std::sort(entity_to_idx, entity_to_idx + entities.size(), [](const _entity_idx &a, const _entity_idx &b) { return a.value < b.value; });
+        size_t last = 0;
+        for(size_t n = 1; n < entities.size(); n++)
+        {
+          if(entity_to_idx[n].value == entity_to_idx[last].value)
+          {
+            entity_to_idx[last].exclusive = entity_to_idx[last].exclusive | entity_to_idx[n].exclusive;
+          }
+          else
+          {
+            entity_to_idx[++last] = entity_to_idx[n];
+          }
+        }
+        return span<_entity_idx>(entity_to_idx, last + 1);
+      }
+      LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> _lock(entities_guard &out, deadline d, bool spin_not_sleep) noexcept final
+      {
+        LLFIO_LOG_FUNCTION_CALL(this);
+        std::chrono::steady_clock::time_point began_steady;
+        std::chrono::system_clock::time_point end_utc;
+        if(d)
+        {
+          if((d).steady)
+          {
+            began_steady = std::chrono::steady_clock::now();
+          }
+          else
+          {
+            end_utc = (d).to_time_point();
+          }
+        }
+        // alloca() always returns 16 byte aligned addresses
+        span<_entity_idx> entity_to_idx(_hash_entities(reinterpret_cast<_entity_idx *>(alloca(sizeof(_entity_idx) * out.entities.size())), out.entities));
+        // Fire this if an error occurs
+        auto disableunlock = make_scope_exit([&]() noexcept { out.release(); });
+        QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand(static_cast<uint32_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count() ^ reinterpret_cast<uintptr_t>(this)));
+        const std::chrono::microseconds maximum_backoff(50000);
+        std::chrono::microseconds backoff(10);
+        size_t n;
+        for(;;)
+        {
+          auto was_contended = static_cast<size_t>(-1);
+          {
+            auto undo = make_scope_exit([&]() noexcept {
+              // 0 to (n-1) need to be unlocked, their leases remain cached
+              for(size_t m = 0; m < n; m++)
+              {
+                _unlock_entry(entity_to_idx[m].value, entity_to_idx[m].exclusive != 0u);
+              }
+            });
+            for(n = 0; n < entity_to_idx.size(); n++)
+            {
+              OUTCOME_TRY(auto &&locked, _lock_entry(entity_to_idx[n].value, entity_to_idx[n].exclusive != 0u));
+              if(!locked)
+              {
+                was_contended = n;
+                this->_note_failed_attempt(entity_to_idx[n].value);
+                break;
+              }
+            }
+            if(n == entity_to_idx.size())
+            {
+              // Everything is locked, exit
+              undo.release();
+              disableunlock.release();
+              return success();
+            }
+          }
+          if(d)
+          {
+            if((d).steady)
+            {
+              if(std::chrono::steady_clock::now() >= (began_steady + std::chrono::nanoseconds((d).nsecs)))
+              {
+                return errc::timed_out;
+              }
+            }
+            else
+            {
+              if(std::chrono::system_clock::now() >= end_utc)
+              {
+                return errc::timed_out;
+              }
+            }
+          }
+          // Move was_contended to front and randomise rest of out.entities
+          std::swap(entity_to_idx[was_contended], entity_to_idx[0]);
+          auto front = entity_to_idx.begin();
+          ++front;
+          QUICKCPPLIB_NAMESPACE::algorithm::small_prng::random_shuffle(front, entity_to_idx.end());
+          if(spin_not_sleep)
+          {
+            this->_note_spin();
+            std::this_thread::yield();
+          }
+          else
+          {
+            // Sleep for between half and all of the backoff, which doubles each time up to a maximum
+            auto sleep_for = backoff / 2 + std::chrono::microseconds(rand() % (backoff.count() / 2 + 1));
+            if(d)
+            {
+              const auto remaining = (d).steady ? std::chrono::duration_cast<std::chrono::microseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now()) :
+                                                  std::chrono::duration_cast<std::chrono::microseconds>(end_utc - std::chrono::system_clock::now());
+              if(sleep_for > remaining)
+              {
+                sleep_for = remaining;
+              }
+            }
+            this->_note_sleep();
+            std::this_thread::sleep_for(sleep_for);
+            backoff = (std::min)(backoff * 2, maximum_backoff);
+          }
+        }
+        // return success();
+      }
+
+    public:
+      LLFIO_HEADERS_ONLY_VIRTUAL_SPEC void unlock(entities_type entities, unsigned long long /*unused*/) noexcept final
+      {
+        LLFIO_LOG_FUNCTION_CALL(this);
+        span<_entity_idx> entity_to_idx(_hash_entities(reinterpret_cast<_entity_idx *>(alloca(sizeof(_entity_idx) * entities.size())), entities));
+        for(const auto &i : entity_to_idx)
+        {
+          _unlock_entry(i.value, i.exclusive != 0u);
+        }
+      }
+    };
+
+  }  // namespace shared_fs_mutex
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+
+#endif
@@ -25,11 +25,15 @@ Distributed under the Boost Software License, Version 1.0.
 #ifndef LLFIO_SHARED_FS_MUTEX_LOCK_FILES_HPP
 #define LLFIO_SHARED_FS_MUTEX_LOCK_FILES_HPP
 
+#include "../../directory_handle.hpp"
 #include "../../file_handle.hpp"
 #include "base.hpp"
 
 #include "quickcpplib/algorithm/small_prng.hpp"
 
+#include <algorithm>
+#include <cstdio>  // for snprintf
+
 
 //! \file lock_files.hpp Provides algorithm::shared_fs_mutex::lock_files
 
@@ -52,13 +56,22 @@ namespace algorithm
     - Linear complexity to number of concurrent users.
     - Exponential complexity to number of contended entities being concurrently locked.
     - Requests for shared locks are treated as if for exclusive locks.
+    - Retries after contention back off exponentially with random jitter, from a few microseconds
+    up to fifty milliseconds, so contending lockers do not retry in lockstep.
+    - Optionally fair: if constructed with `fair = true`, a locker which finds an entity contended
+    exclusively creates a ticket file named after the entity, the time and a random number, and
+    thereafter only retries when its ticket is the oldest for that entity in a listing of the lock
+    directory. Waiters thus take turns in order instead of all retrying at once, which prevents
+    starvation and create storms on networked filesystems, at the cost of a directory listing per
+    retry.
 
     Caveats:
-    - No ability to sleep until a lock becomes free, so CPUs are spun at 100%.
+    - No ability to sleep until a lock becomes free, so CPUs are spun, albeit with backoff.
     - On POSIX only sudden process exit with locks held will deadlock all other users by leaving stale
     files around.
     - Costs a file descriptor per entity locked.
     - Sudden power loss during use will deadlock first user after reboot, again due to stale files.
+    Stale ticket files similarly block a fair queue.
     - Currently this implementation does not permit more than one lock() per instance as the lock
     information is stored as member data. Creating multiple instances referring to the same path
     works fine. This could be fixed easily, but it would require a memory allocation per lock and
@@ -75,12 +88,47 @@ namespace algorithm
     {
       const path_handle &_path;
       std::vector<file_handle> _hs;
+      bool _fair{false};
 
-      explicit lock_files(const path_handle &o)
+      explicit lock_files(const path_handle &o, bool fair)
           : _path(o)
+          , _fair(fair)
       {
       }
 
+      // True if no ticket in the directory for the same entity is older than mine
+      static result<bool> _is_my_turn(const directory_handle &dirh, const std::string &glob, const std::string &myticket) noexcept
+      {
+        try
+        {
+          std::vector<directory_handle::buffer_type> entries(16);
+          directory_handle::buffers_type buffers;
+          for(;;)
+          {
+            buffers = {entries, std::move(buffers)};
+            OUTCOME_TRY(buffers, dirh.read({std::move(buffers), glob, directory_handle::filter::none}));
+            if(buffers.done())
+            {
+              break;
+            }
+            entries.resize(entries.size() << 1);
+          }
+          const filesystem::path mine(myticket);
+          for(const auto &entry : buffers)
+          {
+            if(entry.leafname.path() < mine)
+            {
+              return false;
+            }
+          }
+          return true;
+        }
+        catch(...)
+        {
+          return error_from_exception();
+        }
+      }
+
     public:
       //! The type of an entity id
       using entity_type = shared_fs_mutex::entity_type;
@@ -93,7 +141,7 @@ namespace algorithm
       lock_files &operator=(const lock_files &) = delete;
       ~lock_files() = default;
       //! Move constructor
-      lock_files(lock_files &&o) noexcept : _path(o._path), _hs(std::move(o._hs)) {}
+      lock_files(lock_files &&o) noexcept : shared_fs_mutex(std::move(o)), _path(o._path), _hs(std::move(o._hs)), _fair(o._fair) {}
       //! Move assign
       lock_files &operator=(lock_files &&o) noexcept
       {
@@ -106,14 +154,20 @@ namespace algorithm
         return *this;
       }
 
-      //! Initialises a shared filing system mutex using the directory at \em lockdir which MUST stay valid for the duration of this lock.
+      /*! Initialises a shared filing system mutex using the directory at \em lockdir which MUST stay valid for the duration of this lock.
+      \param lockdir The directory in which to create lock files.
+      \param fair Whether contended lockers queue in order using ticket files.
+      */
       LLFIO_MAKE_FREE_FUNCTION
-      static result<lock_files> fs_mutex_lock_files(const path_handle &lockdir) noexcept
+      static result<lock_files> fs_mutex_lock_files(const path_handle &lockdir, bool fair = false) noexcept
       {
         LLFIO_LOG_FUNCTION_CALL(0);
-        return lock_files(lockdir);
+        return lock_files(lockdir, fair);
       }
 
+      //! True if contended lockers queue in order
+      bool is_fair() const noexcept { return _fair; }
+
       //! Return the path to the directory being used for this lock
       const path_handle &path() const noexcept { return _path; }
 
@@ -143,9 +197,26 @@ namespace algorithm
           entity_paths[n] = QUICKCPPLIB_NAMESPACE::algorithm::string::to_hex_string(span<char>(reinterpret_cast<char *>(&v), 8));
         }
         _hs.resize(out.entities.size());
+        QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand(static_cast<uint32_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count() ^ reinterpret_cast<uintptr_t>(this)));
+        const std::chrono::microseconds maximum_backoff(50000);
+        std::chrono::microseconds backoff(10);
+        // If fair, my place in the queue for the entity I was first contended on
+        directory_handle dirh;
+        file_handle ticket;
+        std::string ticket_glob, ticket_name;
         do
         {
           auto was_contended = static_cast<size_t>(-1);
+          if(ticket.is_valid())
+          {
+            OUTCOME_TRY(auto &&myturn, _is_my_turn(dirh, ticket_glob, ticket_name));
+            if(!myturn)
+            {
+              n = 0;
+              was_contended = 0;
+              goto backoff;
+            }
+          }
           {
             auto undo = make_scope_exit([&]() noexcept {
               // 0 to (n-1) need to be closed
@@ -172,6 +243,7 @@ namespace algorithm
                 }
                 // Collided with another locker
                 was_contended = n;
+                this->_note_failed_attempt(out.entities[n].value);
                 break;
               }
               _hs[n] = std::move(ret.value());
@@ -181,6 +253,19 @@ namespace algorithm
               undo.release();
             }
           }
+          if(n != out.entities.size() && _fair && !ticket.is_valid())
+          {
+            // Join the queue for the contended entity
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), ".%016llx%08x", static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count()), static_cast<unsigned>(rand()));
+            ticket_glob = entity_paths[was_contended] + ".*";
+            ticket_name = entity_paths[was_contended] + buffer;
+            OUTCOME_TRY(auto &&dirh_, directory_handle::directory(_path, {}));
+            dirh = std::move(dirh_);
+            OUTCOME_TRY(auto &&ticket_, file_handle::file(_path, ticket_name, file_handle::mode::write, file_handle::creation::only_if_not_exist, file_handle::caching::temporary, file_handle::flag::unlink_on_first_close));
+            ticket = std::move(ticket_);
+          }
+        backoff:
           if(n != out.entities.size())
           {
             if(d)
@@ -205,13 +290,31 @@ namespace algorithm
             auto front = out.entities.begin();
             ++front;
             QUICKCPPLIB_NAMESPACE::algorithm::small_prng::random_shuffle(front, out.entities.end());
-            // Sleep for a very short time
-            if(!spin_not_sleep)
+            if(spin_not_sleep)
+            {
+              this->_note_spin();
+            }
+            else
             {
-              std::this_thread::yield();
+              // Sleep for between half and all of the backoff, which doubles each time up to a maximum
+              auto sleep_for = backoff / 2 + std::chrono::microseconds(rand() % (backoff.count() / 2 + 1));
+              if(d)
+              {
+                const auto remaining = (d).steady ? std::chrono::duration_cast<std::chrono::microseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now()) :
+                                                    std::chrono::duration_cast<std::chrono::microseconds>(end_utc - std::chrono::system_clock::now());
+                if(sleep_for > remaining)
+                {
+                  sleep_for = remaining;
+                }
+              }
+              this->_note_sleep();
+              std::this_thread::sleep_for(sleep_for);
+              backoff = (std::min)(backoff * 2, maximum_backoff);
             }
           }
         } while(n < out.entities.size());
+        // Leave the queue, letting the next in line take its turn
+        (void) ticket.close();
         return success();
       }
 
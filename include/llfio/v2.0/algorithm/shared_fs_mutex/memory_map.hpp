@@ -31,6 +31,16 @@ Distributed under the Boost Software License, Version 1.0.
 #include "quickcpplib/algorithm/hash.hpp"
 #include "quickcpplib/algorithm/small_prng.hpp"
 
+#include <atomic>
+
+#ifdef __linux__
+#include <climits>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 //! \file memory_map.hpp Provides algorithm::shared_fs_mutex::memory_map
 
 LLFIO_V2_NAMESPACE_BEGIN
@@ -39,6 +49,41 @@ namespace algorithm
 {
   namespace shared_fs_mutex
   {
+    namespace detail
+    {
+      // Sleeps until *addr is no longer expected, or timeout (negative means never) elapses. Works across processes.
+      inline void memory_map_wait(std::atomic<uint32_t> *addr, uint32_t expected, std::chrono::nanoseconds timeout) noexcept
+      {
+#ifdef __linux__
+        struct timespec ts
+        {
+          0, 0
+        };
+        if(timeout.count() >= 0)
+        {
+          ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000LL);
+          ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000LL);
+        }
+        // Not FUTEX_PRIVATE_FLAG, as the word is in memory shared between processes
+        (void) syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAIT, expected, (timeout.count() >= 0) ? &ts : nullptr, nullptr, 0);
+#else
+        (void) addr;
+        (void) expected;
+        (void) timeout;
+        std::this_thread::yield();
+#endif
+      }
+      // Wakes all sleeping in memory_map_wait() on addr
+      inline void memory_map_wake(std::atomic<uint32_t> *addr) noexcept
+      {
+#ifdef __linux__
+        (void) syscall(SYS_futex, reinterpret_cast<uint32_t *>(addr), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#else
+        (void) addr;
+#endif
+      }
+    }  // namespace detail
+
     /*! \class memory_map
     \brief Many entity memory mapped shared/exclusive file system based lock
     \tparam Hasher A STL compatible hash algorithm to use (defaults to `fnv1a_hash`)
@@ -55,6 +100,12 @@ namespace algorithm
     implementation is entirely implemented in userspace using shared memory without any kernel syscalls,
     performance is probably as fast as any many-arbitrary-entity shared locking system could be.
 
+    Following the hash index in the shared memory is a wait word per hash index entry. On Linux, if
+    not told to spin rather than sleep, after a bounded number of attempts to lock a contended entity
+    the waiter sleeps on the wait word of the contended entry using a shared memory futex. Unlocking an
+    entry bumps its wait word, and calls into the kernel to wake waiters only if there are any on that
+    entry, so the uncontended case remains free of syscalls.
+
     As it uses shared memory, this implementation of `shared_fs_mutex` cannot work over a networked
     drive. If you attempt to open this lock on a network drive and the first user of the lock is not
     on this local machine, `errc::no_lock_available` will be returned from the constructor.
@@ -66,7 +117,9 @@ namespace algorithm
     - In the lightly contended case, an order of magnitude faster than any other `shared_fs_mutex` algorithm.
 
     Caveats:
-    - No ability to sleep until a lock becomes free, so CPUs are spun at 100%.
+    - Only Linux can sleep until a lock becomes free. On other platforms, CPUs are spun at 100% with
+    a yield of the thread between attempts. (Microsoft Windows' `WaitOnAddress()` cannot wake
+    waiters in other processes.)
     - Sudden process exit with locks held will deadlock all other users.
     - Exponential complexity to number of entities being concurrently locked.
     - Exponential complexity to concurrency if entities hash to the same cache line. Most SMP and especially
@@ -100,6 +153,17 @@ namespace algorithm
     private:
       static constexpr size_t _container_entries = HashIndexSize / sizeof(spinlock_type);
       using _hash_index_type = std::array<spinlock_type, _container_entries>;
+      struct _wait_word_type
+      {
+        std::atomic<uint32_t> seq;      // incremented on every unlock of the entry
+        std::atomic<uint32_t> waiters;  // number sleeping, or about to sleep, on seq
+      };
+      static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> is not usable as a futex word on this platform");
+      using _wait_words_type = std::array<_wait_word_type, _container_entries>;
+      // The hash index, followed by a wait word per entry
+      static constexpr size_t _mapped_size = HashIndexSize + sizeof(_wait_words_type);
+      // Failed attempts at locking before sleeping
+      static constexpr size_t _spins_before_sleeping = 16;
       static constexpr file_handle::extent_type _initialisingoffset = static_cast<file_handle::extent_type>(1024) * 1024;
       static constexpr file_handle::extent_type _lockinuseoffset = static_cast<file_handle::extent_type>(1024) * 1024 + 1;
 
@@ -112,6 +176,21 @@ namespace algorithm
         auto *ret = reinterpret_cast<_hash_index_type *>(_temphmap.address());
         return *ret;
       }
+      _wait_words_type &_wait_words() const
+      {
+        auto *ret = reinterpret_cast<_wait_words_type *>(_temphmap.address() + HashIndexSize);
+        return *ret;
+      }
+      void _unlock_entry(_hash_index_type &index, unsigned idx, bool exclusive) const noexcept
+      {
+        exclusive ? index[idx].unlock() : index[idx].unlock_shared();
+        auto &w = _wait_words()[idx];
+        w.seq.fetch_add(1, std::memory_order_seq_cst);
+        if(w.waiters.load(std::memory_order_seq_cst) != 0)
+        {
+          detail::memory_map_wake(&w.seq);
+        }
+      }
 
       memory_map(file_handle &&h, file_handle &&temph, file_handle::extent_guard &&hlockinuse, map_handle &&hmap, map_handle &&temphmap)
           : _h(std::move(h))
@@ -129,7 +208,7 @@ namespace algorithm
       //! No copy assignment
       memory_map &operator=(const memory_map &) = delete;
       //! Move constructor
-      memory_map(memory_map &&o) noexcept : _h(std::move(o._h)), _temph(std::move(o._temph)), _hlockinuse(std::move(o._hlockinuse)), _hmap(std::move(o._hmap)), _temphmap(std::move(o._temphmap)) { _hlockinuse.set_handle(&_h); }
+      memory_map(memory_map &&o) noexcept : shared_fs_mutex(std::move(o)), _h(std::move(o._h)), _temph(std::move(o._temph)), _hlockinuse(std::move(o._hlockinuse)), _hmap(std::move(o._hmap)), _temphmap(std::move(o._temphmap)) { _hlockinuse.set_handle(&_h); }
       //! Move assign
       memory_map &operator=(memory_map &&o) noexcept
       {
@@ -227,8 +306,8 @@ namespace algorithm
             }
             temph = std::move(_temph.value());
             // Map the hash index file into memory for read/write access
-            OUTCOME_TRY(auto &&temphsection, section_handle::section(temph, HashIndexSize));
-            OUTCOME_TRY(auto &&temphmap, map_handle::map(temphsection, HashIndexSize));
+            OUTCOME_TRY(auto &&temphsection, section_handle::section(temph, _mapped_size));
+            OUTCOME_TRY(auto &&temphmap, map_handle::map(temphsection, _mapped_size));
             // Map the path file into memory with its maximum possible size, read only
             OUTCOME_TRY(auto &&hsection, section_handle::section(ret, 65536, section_handle::flag::read));
             OUTCOME_TRY(auto &&hmap, map_handle::map(hsection, 0, 0, section_handle::flag::read));
@@ -239,10 +318,10 @@ namespace algorithm
           auto &tempdirh = path_discovery::memory_backed_temporary_files_directory().is_valid() ? path_discovery::memory_backed_temporary_files_directory() : path_discovery::storage_backed_temporary_files_directory();
           OUTCOME_TRY(auto &&_temph, file_handle::uniquely_named_file(tempdirh));
           temph = std::move(_temph);
-          // Truncate it out to the hash index size, and map it into memory for read/write access
-          OUTCOME_TRYV(temph.truncate(HashIndexSize));
-          OUTCOME_TRY(auto &&temphsection, section_handle::section(temph, HashIndexSize));
-          OUTCOME_TRY(auto &&temphmap, map_handle::map(temphsection, HashIndexSize));
+          // Truncate it out to the hash index and wait words size, and map it into memory for read/write access
+          OUTCOME_TRYV(temph.truncate(_mapped_size));
+          OUTCOME_TRY(auto &&temphsection, section_handle::section(temph, _mapped_size));
+          OUTCOME_TRY(auto &&temphmap, map_handle::map(temphsection, _mapped_size));
           // Write the path of my new hash index file, padding zeros to the nearest page size
           // multiple to work around a race condition in the Linux kernel
           OUTCOME_TRY(auto &&temppath, temph.current_path());
@@ -281,29 +360,30 @@ namespace algorithm
       // Create a cache of entities to their indices, eliding collisions where necessary
       static span<_entity_idx> _hash_entities(_entity_idx *entity_to_idx, entities_type &entities)
       {
-        _entity_idx *ep = entity_to_idx;
+        if(entities.empty())
+        {
+          return {};
+        }
         for(size_t n = 0; n < entities.size(); n++)
         {
-          ep->value = hasher_type()(entities[n].value) % _container_entries;
-          ep->exclusive = entities[n].exclusive;
-          bool skip = false;
-          for(size_t m = 0; m < n; m++)
+          entity_to_idx[n].value = hasher_type()(entities[n].value) % _container_entries;
+          entity_to_idx[n].exclusive = entities[n].exclusive;
+        }
+        // Sort by index so colliding entities are adjacent and can be merged in linear time
+        std::sort(entity_to_idx, entity_to_idx + entities.size(), [](const _entity_idx &a, const _entity_idx &b) { return a.value < b.value; });
+        size_t last = 0;
+        for(size_t n = 1; n < entities.size(); n++)
+        {
+          if(entity_to_idx[n].value == entity_to_idx[last].value)
           {
-            if(entity_to_idx[m].value == ep->value)
-            {
-              if(ep->exclusive && !entity_to_idx[m].exclusive)
-              {
-                entity_to_idx[m].exclusive = true;
-              }
-              skip = true;
-            }
+            entity_to_idx[last].exclusive = entity_to_idx[last].exclusive | entity_to_idx[n].exclusive;
           }
-          if(!skip)
+          else
           {
-            ++ep;
+            entity_to_idx[++last] = entity_to_idx[n];
           }
         }
-        return span<_entity_idx>(entity_to_idx, ep - entity_to_idx);
+        return span<_entity_idx>(entity_to_idx, last + 1);
       }
       LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> _lock(entities_guard &out, deadline d, bool spin_not_sleep) noexcept final
       {
@@ -324,12 +404,22 @@ namespace algorithm
         // alloca() always returns 16 byte aligned addresses
         span<_entity_idx> entity_to_idx(_hash_entities(reinterpret_cast<_entity_idx *>(alloca(sizeof(_entity_idx) * out.entities.size())), out.entities));
         _hash_index_type &index = _index();
+        _wait_words_type &wait_words = _wait_words();
         // Fire this if an error occurs
         auto disableunlock = make_scope_exit([&]() noexcept { out.release(); });
-        size_t n;
+        size_t n, failures = 0;
+        // If sleeping, the wait word of entity_to_idx[0] is registered with before each attempt
+        bool sleeping = false;
+        uint32_t sleepseq = 0;
         for(;;)
         {
           auto was_contended = static_cast<size_t>(-1);
+          if(sleeping)
+          {
+            auto &w = wait_words[entity_to_idx[0].value];
+            w.waiters.fetch_add(1, std::memory_order_seq_cst);
+            sleepseq = w.seq.load(std::memory_order_seq_cst);
+          }
           {
             auto undo = make_scope_exit([&]() noexcept {
               // 0 to (n-1) need to be closed
@@ -339,9 +429,9 @@ namespace algorithm
                 // Now 0 to n needs to be closed
                 for(; n > 0; n--)
                 {
-                  entity_to_idx[n].exclusive ? index[entity_to_idx[n].value].unlock() : index[entity_to_idx[n].value].unlock_shared();
+                  _unlock_entry(index, entity_to_idx[n].value, entity_to_idx[n].exclusive);
                 }
-                entity_to_idx[0].exclusive ? index[entity_to_idx[0].value].unlock() : index[entity_to_idx[0].value].unlock_shared();
+                _unlock_entry(index, entity_to_idx[0].value, entity_to_idx[0].exclusive);
               }
             });
             for(n = 0; n < entity_to_idx.size(); n++)
@@ -349,15 +439,41 @@ namespace algorithm
               if(!(entity_to_idx[n].exclusive ? index[entity_to_idx[n].value].try_lock() : index[entity_to_idx[n].value].try_lock_shared()))
               {
                 was_contended = n;
+                this->_note_failed_attempt(entity_to_idx[n].value);
                 goto failed;
               }
             }
             // Everything is locked, exit
             undo.release();
             disableunlock.release();
+            if(sleeping)
+            {
+              wait_words[entity_to_idx[0].value].waiters.fetch_sub(1, std::memory_order_seq_cst);
+            }
             return success();
           }
         failed:
+          if(sleeping)
+          {
+            auto &w = wait_words[entity_to_idx[0].value];
+            if(was_contended == 0)
+            {
+              std::chrono::nanoseconds timeout(-1);
+              if(d)
+              {
+                timeout = (d).steady ? std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now()) :
+                                       std::chrono::duration_cast<std::chrono::nanoseconds>(end_utc - std::chrono::system_clock::now());
+                if(timeout.count() < 0)
+                {
+                  timeout = std::chrono::nanoseconds(0);
+                }
+              }
+              // Returns immediately if the entry was unlocked since sleepseq was sampled
+              this->_note_sleep();
+              detail::memory_map_wait(&w.seq, sleepseq, timeout);
+            }
+            w.waiters.fetch_sub(1, std::memory_order_seq_cst);
+          }
           if(d)
           {
             if((d).steady)
@@ -382,7 +498,12 @@ namespace algorithm
           QUICKCPPLIB_NAMESPACE::algorithm::small_prng::random_shuffle(front, entity_to_idx.end());
           if(!spin_not_sleep)
           {
-            std::this_thread::yield();
+            sleeping = (++failures >= _spins_before_sleeping);
+            if(!sleeping)
+            {
+              this->_note_spin();
+              std::this_thread::yield();
+            }
           }
         }
         // return success();
@@ -396,7 +517,7 @@ namespace algorithm
         _hash_index_type &index = _index();
         for(const auto &i : entity_to_idx)
         {
-          i.exclusive ? index[i.value].unlock() : index[i.value].unlock_shared();
+          _unlock_entry(index, i.value, i.exclusive);
         }
       }
     };
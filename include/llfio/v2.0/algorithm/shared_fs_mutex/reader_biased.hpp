@@ -0,0 +1,550 @@
+/* Reader biased shared memory read-write lock
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_SHARED_FS_MUTEX_READER_BIASED_HPP
+#define LLFIO_SHARED_FS_MUTEX_READER_BIASED_HPP
+
+#include "memory_map.hpp"  // for detail::memory_map_wait() and detail::memory_map_wake()
+
+#include "quickcpplib/algorithm/hash.hpp"
+#include "quickcpplib/algorithm/small_prng.hpp"
+
+#include <array>
+#include <atomic>
+
+//! \file reader_biased.hpp Provides algorithm::shared_fs_mutex::reader_biased
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace shared_fs_mutex
+  {
+    /*! \class reader_biased
+    \brief Many entity memory mapped shared/exclusive file system based lock heavily optimised for shared locking
+    \tparam Hasher A STL compatible hash algorithm to use (defaults to `fnv1a_hash`)
+    \tparam HashIndexEntries The number of entries in the hash index (defaults to 1024)
+    \tparam ReaderSlots The number of reader counter slots (defaults to 64)
+
+    `memory_map` implements shared locks with the same atomic compare and swap on the same cache line
+    as exclusive locks, so shared locking by many processes at once bounces that cache line between
+    CPUs and scales no better than exclusive locking. This implementation instead keeps `ReaderSlots`
+    separate blocks of reader counters in the shared memory, each instance of this class choosing one
+    block at random upon construction. A shared lock increments the entity's counter in that block,
+    then checks that no writer has announced itself on the entity. Shared locking and unlocking thus
+    only ever writes a cache line local to the instance, and merely reads the cache line of writer
+    announcements, which stays shared between all CPUs whilst there are no writers.
+
+    An exclusive lock announces itself on the entity, which turns away all new shared lockers, and then
+    waits for the entity's counter to drain to zero in every reader slot. For the first entity in a
+    multi-entity lock it waits until the deadline for this to happen, sleeping on Linux as `memory_map`
+    does; for subsequent entities it withdraws its announcement and retries, as with all the other
+    implementations. Exclusive locking is therefore `ReaderSlots` times more expensive than with
+    `memory_map`, which suits workloads which very rarely take exclusive locks.
+
+    The shared memory is set up and discovered in the same way as `memory_map`, so the same caveats apply:
+
+    - Cannot work over a networked drive. `errc::no_lock_available` will be returned from the constructor
+    if the first user of the lock is not on this local machine.
+    - Sudden process exit with locks held will deadlock all other users.
+    - Only Linux can sleep until a lock becomes free.
+    - Different entities may hash to the same entry and exclude one another.
+    - More instances than reader slots will share slots, which is correct but scales less well.
+    - Requires `handle::current_path()` to be working.
+    */
+    template <template <class> class Hasher = QUICKCPPLIB_NAMESPACE::algorithm::hash::fnv1a_hash, size_t HashIndexEntries = 1024, size_t ReaderSlots = 64> class reader_biased : public shared_fs_mutex
+    {
+    public:
+      //! The type of an entity id
+      using entity_type = shared_fs_mutex::entity_type;
+      //! The type of a sequence of entities
+      using entities_type = shared_fs_mutex::entities_type;
+      //! The type of the hasher being used
+      using hasher_type = Hasher<entity_type::value_type>;
+
+    private:
+      static_assert(HashIndexEntries % 16 == 0, "HashIndexEntries must be a multiple of sixteen so reader slots do not share cache lines");
+      static_assert(ReaderSlots > 0, "There must be at least one reader slot");
+      struct _wait_word_type
+      {
+        std::atomic<uint32_t> seq;      // incremented on every change a waiter could be waiting for
+        std::atomic<uint32_t> waiters;  // number sleeping, or about to sleep, on seq
+      };
+      static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> is not usable as a futex word on this platform");
+      using _writers_type = std::array<std::atomic<uint32_t>, HashIndexEntries>;  // nonzero if a writer has announced itself
+      using _wait_words_type = std::array<_wait_word_type, HashIndexEntries>;
+      using _reader_slot_type = std::array<std::atomic<uint32_t>, HashIndexEntries>;  // count of shared lock holders
+      using _reader_slots_type = std::array<_reader_slot_type, ReaderSlots>;
+      // The writer announcements, followed by a wait word per entry, followed by the reader slots
+      static constexpr size_t _wait_words_offset = sizeof(_writers_type);
+      static constexpr size_t _reader_slots_offset = _wait_words_offset + sizeof(_wait_words_type);
+      static constexpr size_t _mapped_size = _reader_slots_offset + sizeof(_reader_slots_type);
+      // Failed attempts at locking before sleeping
+      static constexpr size_t _spins_before_sleeping = 16;
+      static constexpr file_handle::extent_type _initialisingoffset = static_cast<file_handle::extent_type>(1024) * 1024;
+      static constexpr file_handle::extent_type _lockinuseoffset = static_cast<file_handle::extent_type>(1024) * 1024 + 1;
+
+      file_handle _h, _temph;
+      file_handle::extent_guard _hlockinuse;  // shared lock of last byte of _h marking if lock is in use
+      map_handle _hmap, _temphmap;
+      size_t _slot{0};  // my reader slot
+
+      _writers_type &_writers() const
+      {
+        auto *ret = reinterpret_cast<_writers_type *>(_temphmap.address());
+        return *ret;
+      }
+      _wait_words_type &_wait_words() const
+      {
+        auto *ret = reinterpret_cast<_wait_words_type *>(_temphmap.address() + _wait_words_offset);
+        return *ret;
+      }
+      _reader_slots_type &_reader_slots() const
+      {
+        auto *ret = reinterpret_cast<_reader_slots_type *>(_temphmap.address() + _reader_slots_offset);
+        return *ret;
+      }
+      void _wake(unsigned idx) const noexcept
+      {
+        auto &w = _wait_words()[idx];
+        w.seq.fetch_add(1, std::memory_order_seq_cst);
+        if(w.waiters.load(std::memory_order_seq_cst) != 0)
+        {
+          detail::memory_map_wake(&w.seq);
+        }
+      }
+      void _unlock_shared_entry(unsigned idx) const noexcept
+      {
+        _reader_slots()[_slot][idx].fetch_sub(1, std::memory_order_seq_cst);
+        // Only a draining writer needs to know
+        if(_writers()[idx].load(std::memory_order_seq_cst) != 0)
+        {
+          _wake(idx);
+        }
+      }
+      void _unlock_exclusive_entry(unsigned idx) const noexcept
+      {
+        _writers()[idx].store(0, std::memory_order_seq_cst);
+        _wake(idx);
+      }
+      void _unlock_entry(unsigned idx, bool exclusive) const noexcept { exclusive ? _unlock_exclusive_entry(idx) : _unlock_shared_entry(idx); }
+      bool _try_lock_shared_entry(unsigned idx) const noexcept
+      {
+        _reader_slots()[_slot][idx].fetch_add(1, std::memory_order_seq_cst);
+        if(_writers()[idx].load(std::memory_order_seq_cst) == 0)
+        {
+          return true;
+        }
+        _unlock_shared_entry(idx);
+        return false;
+      }
+      bool _readers_drained(unsigned idx) const noexcept
+      {
+        for(const auto &slot : _reader_slots())
+        {
+          if(slot[idx].load(std::memory_order_seq_cst) != 0)
+          {
+            return false;
+          }
+        }
+        return true;
+      }
+      // Timeout of zero means try once, negative means forever
+      bool _lock_exclusive_entry(unsigned idx, std::chrono::nanoseconds timeout, bool spin_not_sleep) const noexcept
+      {
+        uint32_t expected = 0;
+        if(!_writers()[idx].compare_exchange_strong(expected, 1, std::memory_order_seq_cst))
+        {
+          return false;
+        }
+        // New shared lockers are now turned away, so wait for the existing ones to leave
+        if(_readers_drained(idx))
+        {
+          return true;
+        }
+        if(timeout.count() != 0)
+        {
+          auto &w = _wait_words()[idx];
+          const auto end = std::chrono::steady_clock::now() + timeout;
+          for(size_t failures = 0;; failures++)
+          {
+            const bool sleeping = !spin_not_sleep && failures >= _spins_before_sleeping;
+            if(sleeping)
+            {
+              w.waiters.fetch_add(1, std::memory_order_seq_cst);
+            }
+            const uint32_t seq = w.seq.load(std::memory_order_seq_cst);
+            if(_readers_drained(idx))
+            {
+              if(sleeping)
+              {
+                w.waiters.fetch_sub(1, std::memory_order_seq_cst);
+              }
+              return true;
+            }
+            std::chrono::nanoseconds remaining(-1);
+            if(timeout.count() > 0)
+            {
+              remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(end - std::chrono::steady_clock::now());
+              if(remaining.count() <= 0)
+              {
+                if(sleeping)
+                {
+                  w.waiters.fetch_sub(1, std::memory_order_seq_cst);
+                }
+                break;
+              }
+            }
+            if(sleeping)
+            {
+              // Returns immediately if a reader left since seq was sampled
+              this->_note_sleep();
+              detail::memory_map_wait(&w.seq, seq, remaining);
+              w.waiters.fetch_sub(1, std::memory_order_seq_cst);
+            }
+            else
+            {
+              this->_note_spin();
+              std::this_thread::yield();
+            }
+          }
+        }
+        _unlock_exclusive_entry(idx);
+        return false;
+      }
+
+      reader_biased(file_handle &&h, file_handle &&temph, file_handle::extent_guard &&hlockinuse, map_handle &&hmap, map_handle &&temphmap)
+          : _h(std::move(h))
+          , _temph(std::move(temph))
+          , _hlockinuse(std::move(hlockinuse))
+          , _hmap(std::move(hmap))
+          , _temphmap(std::move(temphmap))
+      {
+        _hlockinuse.set_handle(&_h);
+        utils::random_fill(reinterpret_cast<char *>(&_slot), sizeof(_slot));  // NOLINT
+        _slot %= ReaderSlots;
+      }
+
+    public:
+      //! No copy construction
+      reader_biased(const reader_biased &) = delete;
+      //! No copy assignment
+      reader_biased &operator=(const reader_biased &) = delete;
+      //! Move constructor
+      reader_biased(reader_biased &&o) noexcept : shared_fs_mutex(std::move(o)), _h(std::move(o._h)), _temph(std::move(o._temph)), _hlockinuse(std::move(o._hlockinuse)), _hmap(std::move(o._hmap)), _temphmap(std::move(o._temphmap)), _slot(o._slot) { _hlockinuse.set_handle(&_h); }
+      //! Move assign
+      reader_biased &operator=(reader_biased &&o) noexcept
+      {
+        this->~reader_biased();
+        new(this) reader_biased(std::move(o));
+        return *this;
+      }
+      ~reader_biased() override
+      {
+        if(_h.is_valid())
+        {
+          // Release the maps
+          _hmap = {};
+          _temphmap = {};
+          // Release my shared locks and try locking inuse exclusively
+          _hlockinuse.unlock();
+          auto lockresult = _h.lock_file_range(_initialisingoffset, 2, lock_kind::exclusive, std::chrono::seconds(0));
+#ifndef NDEBUG
+          if(!lockresult && lockresult.error() != errc::timed_out)
+          {
+            LLFIO_LOG_FATAL(0, "reader_biased::~reader_biased() try_lock failed");
+            abort();
+          }
+#endif
+          if(lockresult)
+          {
+            // This means I am the last user, so zop the file contents as temp file is about to go away
+            auto o2 = _h.truncate(0);
+            if(!o2)
+            {
+              LLFIO_LOG_FATAL(0, "reader_biased::~reader_biased() truncate failed");
+              abort();
+            }
+            // Unlink the temp file. We don't trap any failure to unlink on FreeBSD it can forget current path.
+            auto o3 = _temph.unlink();
+#ifndef __FreeBSD__
+            if(!o3)
+            {
+              LLFIO_LOG_FATAL(0, "reader_biased::~reader_biased() unlink failed");
+              abort();
+            }
+#else
+            (void) o3;
+#endif
+          }
+        }
+      }
+
+      /*! Initialises a shared filing system mutex using the file at \em lockfile.
+      \errors As for `memory_map::fs_mutex_map()`, in particular `errc::no_lock_available` will be
+      returned if the lock is in use by another computer on a network.
+      */
+      LLFIO_MAKE_FREE_FUNCTION
+      static result<reader_biased> fs_mutex_reader_biased(const path_handle &base, path_view lockfile) noexcept
+      {
+        LLFIO_LOG_FUNCTION_CALL(0);
+        try
+        {
+          OUTCOME_TRY(auto &&ret, file_handle::file(base, lockfile, file_handle::mode::write, file_handle::creation::if_needed, file_handle::caching::reads));
+          file_handle temph;
+          // Am I the first person to this file? Lock everything exclusively
+          auto lockinuse = ret.lock_file_range(_initialisingoffset, 2, lock_kind::exclusive, std::chrono::seconds(0));
+          if(lockinuse.has_error())
+          {
+            if(lockinuse.error() != errc::timed_out)
+            {
+              return std::move(lockinuse).error();
+            }
+            // Somebody else is also using this file, so try to read the shared memory file I ought to use
+            lockinuse = ret.lock_file_range(_lockinuseoffset, 1, lock_kind::shared);  // inuse shared access, blocking
+            if(!lockinuse)
+            {
+              return std::move(lockinuse).error();
+            }
+            byte buffer[65536];
+            memset(buffer, 0, sizeof(buffer));
+            OUTCOME_TRYV(ret.read(0, {{buffer, 65535}}));
+            path_view temphpath(reinterpret_cast<filesystem::path::value_type *>(buffer));
+            result<file_handle> _temph(in_place_type<file_handle>);
+            _temph = file_handle::file({}, temphpath, file_handle::mode::write, file_handle::creation::open_existing, file_handle::caching::temporary);
+            // If temp file doesn't exist, I am on a different machine
+            if(!_temph)
+            {
+              // Release the exclusive lock and tell caller that this lock is not available
+              return errc::no_lock_available;
+            }
+            temph = std::move(_temph.value());
+            // Map the shared memory file into memory for read/write access
+            OUTCOME_TRY(auto &&temphsection, section_handle::section(temph, _mapped_size));
+            OUTCOME_TRY(auto &&temphmap, map_handle::map(temphsection, _mapped_size));
+            // Map the path file into memory with its maximum possible size, read only
+            OUTCOME_TRY(auto &&hsection, section_handle::section(ret, 65536, section_handle::flag::read));
+            OUTCOME_TRY(auto &&hmap, map_handle::map(hsection, 0, 0, section_handle::flag::read));
+            return reader_biased(std::move(ret), std::move(temph), std::move(lockinuse.value()), std::move(hmap), std::move(temphmap));
+          }
+
+          // I am the first person to be using this (stale?) file, so create a new shared memory file in /tmp
+          auto &tempdirh = path_discovery::memory_backed_temporary_files_directory().is_valid() ? path_discovery::memory_backed_temporary_files_directory() : path_discovery::storage_backed_temporary_files_directory();
+          OUTCOME_TRY(auto &&_temph, file_handle::uniquely_named_file(tempdirh));
+          temph = std::move(_temph);
+          // Truncate it out to the shared memory size, and map it into memory for read/write access
+          OUTCOME_TRYV(temph.truncate(_mapped_size));
+          OUTCOME_TRY(auto &&temphsection, section_handle::section(temph, _mapped_size));
+          OUTCOME_TRY(auto &&temphmap, map_handle::map(temphsection, _mapped_size));
+          // Write the path of my new shared memory file, padding zeros to the nearest page size
+          // multiple to work around a race condition in the Linux kernel
+          OUTCOME_TRY(auto &&temppath, temph.current_path());
+          char buffer[4096];
+          memset(buffer, 0, sizeof(buffer));
+          size_t bytes = temppath.native().size() * sizeof(*temppath.c_str());
+          file_handle::const_buffer_type buffers[] = {{reinterpret_cast<const byte *>(temppath.c_str()), bytes}, {reinterpret_cast<const byte *>(buffer), 4096 - (bytes % 4096)}};
+          OUTCOME_TRYV(ret.truncate(65536));
+          OUTCOME_TRYV(ret.write({buffers, 0}));
+          // Map for read the maximum possible path file size, again to avoid race problems
+          OUTCOME_TRY(auto &&hsection, section_handle::section(ret, 65536, section_handle::flag::read));
+          OUTCOME_TRY(auto &&hmap, map_handle::map(hsection, 0, 0, section_handle::flag::read));
+          // Take shared locks on inuse. The _initialisingoffset remains exclusive to prevent double entry into this init routine.
+          OUTCOME_TRY(auto &&lockinuse2, ret.lock_file_range(_lockinuseoffset, 1, lock_kind::shared));
+          lockinuse = std::move(lockinuse2);  // releases exclusive lock on all three offsets
+          return reader_biased(std::move(ret), std::move(temph), std::move(lockinuse.value()), std::move(hmap), std::move(temphmap));
+        }
+        catch(...)
+        {
+          return error_from_exception();
+        }
+      }
+
+      //! Return the handle to file being used for this lock
+      const file_handle &handle() const noexcept { return _h; }
+
+    protected:
+      struct _entity_idx
+      {
+        unsigned value : 31;
+        unsigned exclusive : 1;
+      };
+      // Create a cache of entities to their indices, eliding collisions where necessary
+      static span<_entity_idx> _hash_entities(_entity_idx *entity_to_idx, entities_type &entities)
+      {
+        if(entities.empty())
+        {
+          return {};
+        }
+        for(size_t n = 0; n < entities.size(); n++)
+        {
+          entity_to_idx[n].value = hasher_type()(entities[n].value) % HashIndexEntries;
+          entity_to_idx[n].exclusive = entities[n].exclusive;
+        }
+        // Sort by index so colliding entities are adjacent and can be merged in linear time
+        std::sort(entity_to_idx, entity_to_idx + entities.size(), [](const _entity_idx &a, const _entity_idx &b) { return a.value < b.value; });
+        size_t last = 0;
+        for(size_t n = 1; n < entities.size(); n++)
+        {
+          if(entity_to_idx[n].value == entity_to_idx[last].value)
+          {
+            entity_to_idx[last].exclusive = entity_to_idx[last].exclusive | entity_to_idx[n].exclusive;
+          }
+          else
+          {
+            entity_to_idx[++last] = entity_to_idx[n];
+          }
+        }
+        return span<_entity_idx>(entity_to_idx, last + 1);
+      }
+      LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> _lock(entities_guard &out, deadline d, bool spin_not_sleep) noexcept final
+      {
+        LLFIO_LOG_FUNCTION_CALL(this);
+        std::chrono::steady_clock::time_point began_steady;
+        std::chrono::system_clock::time_point end_utc;
+        if(d)
+        {
+          if((d).steady)
+          {
+            began_steady = std::chrono::steady_clock::now();
+          }
+          else
+          {
+            end_utc = (d).to_time_point();
+          }
+        }
+        auto remaining = [&]() -> std::chrono::nanoseconds {
+          if(!d)
+          {
+            return std::chrono::nanoseconds(-1);
+          }
+          auto ret = (d).steady ? std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now()) :
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(end_utc - std::chrono::system_clock::now());
+          // Zero means try once
+          return (ret.count() <= 0) ? std::chrono::nanoseconds(0) : ret;
+        };
+        // alloca() always returns 16 byte aligned addresses
+        span<_entity_idx> entity_to_idx(_hash_entities(reinterpret_cast<_entity_idx *>(alloca(sizeof(_entity_idx) * out.entities.size())), out.entities));
+        _wait_words_type &wait_words = _wait_words();
+        // Fire this if an error occurs
+        auto disableunlock = make_scope_exit([&]() noexcept { out.release(); });
+        size_t n, failures = 0;
+        // If sleeping, the wait word of entity_to_idx[0] is registered with before each attempt
+        bool sleeping = false;
+        uint32_t sleepseq = 0;
+        for(;;)
+        {
+          auto was_contended = static_cast<size_t>(-1);
+          if(sleeping)
+          {
+            auto &w = wait_words[entity_to_idx[0].value];
+            w.waiters.fetch_add(1, std::memory_order_seq_cst);
+            sleepseq = w.seq.load(std::memory_order_seq_cst);
+          }
+          {
+            auto undo = make_scope_exit([&]() noexcept {
+              // 0 to (n-1) need to be closed
+              if(n > 0)
+              {
+                --n;
+                // Now 0 to n needs to be closed
+                for(; n > 0; n--)
+                {
+                  _unlock_entry(entity_to_idx[n].value, entity_to_idx[n].exclusive);
+                }
+                _unlock_entry(entity_to_idx[0].value, entity_to_idx[0].exclusive);
+              }
+            });
+            for(n = 0; n < entity_to_idx.size(); n++)
+            {
+              // Only for the very first entity will a writer wait for readers to drain
+              if(!(entity_to_idx[n].exclusive ? _lock_exclusive_entry(entity_to_idx[n].value, (n == 0) ? remaining() : std::chrono::nanoseconds(0), spin_not_sleep) : _try_lock_shared_entry(entity_to_idx[n].value)))
+              {
+                was_contended = n;
+                this->_note_failed_attempt(entity_to_idx[n].value);
+                goto failed;
+              }
+            }
+            // Everything is locked, exit
+            undo.release();
+            disableunlock.release();
+            if(sleeping)
+            {
+              wait_words[entity_to_idx[0].value].waiters.fetch_sub(1, std::memory_order_seq_cst);
+            }
+            return success();
+          }
+        failed:
+          if(sleeping)
+          {
+            auto &w = wait_words[entity_to_idx[0].value];
+            if(was_contended == 0)
+            {
+              // Returns immediately if the entry changed since sleepseq was sampled
+              this->_note_sleep();
+              detail::memory_map_wait(&w.seq, sleepseq, remaining());
+            }
+            w.waiters.fetch_sub(1, std::memory_order_seq_cst);
+          }
+          if(d && remaining().count() == 0)
+          {
+            return errc::timed_out;
+          }
+          // Move was_contended to front and randomise rest of out.entities
+          std::swap(entity_to_idx[was_contended], entity_to_idx[0]);
+          auto front = entity_to_idx.begin();
+          ++front;
+          QUICKCPPLIB_NAMESPACE::algorithm::small_prng::random_shuffle(front, entity_to_idx.end());
+          if(!spin_not_sleep)
+          {
+            sleeping = (++failures >= _spins_before_sleeping);
+            if(!sleeping)
+            {
+              this->_note_spin();
+              std::this_thread::yield();
+            }
+          }
+        }
+        // return success();
+      }
+
+    public:
+      LLFIO_HEADERS_ONLY_VIRTUAL_SPEC void unlock(entities_type entities, unsigned long long /*unused*/) noexcept final
+      {
+        LLFIO_LOG_FUNCTION_CALL(this);
+        span<_entity_idx> entity_to_idx(_hash_entities(reinterpret_cast<_entity_idx *>(alloca(sizeof(_entity_idx) * entities.size())), entities));
+        for(const auto &i : entity_to_idx)
+        {
+          _unlock_entry(i.value, i.exclusive);
+        }
+      }
+    };
+
+  }  // namespace shared_fs_mutex
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+
+#endif
@@ -92,7 +92,9 @@ namespace algorithm
     - Keeps a process-wide store of reference counted fd's per lock in the process, thus
     preventing byte range locks ever being dropped unexpectedly.
     - A process-local thread aware layer, allowing byte range locks to be held by a thread
-    and excluding other threads as well as processes.
+    and excluding other threads as well as processes. Its table of thread locks is sharded
+    by entity, so threads locking disjoint entities scale, and unlocking only wakes sleeping
+    threads if there are any.
     - A thread may add an additional exclusive or shared lock on top of its existing
     exclusive or shared lock, but unlocks always unlock the exclusive lock first. This
     choice of behaviour is to match Microsoft Windows' behaviour to aid writing portable
@@ -140,7 +142,7 @@ namespace algorithm
       safe_byte_ranges &operator=(const safe_byte_ranges &) = delete;
       ~safe_byte_ranges() = default;
       //! Move constructor
-      safe_byte_ranges(safe_byte_ranges &&o) noexcept : _p(std::move(o._p)) {}
+      safe_byte_ranges(safe_byte_ranges &&o) noexcept : shared_fs_mutex(std::move(o)), _p(std::move(o._p)) {}
       //! Move assign
       safe_byte_ranges &operator=(safe_byte_ranges &&o) noexcept
       {
@@ -0,0 +1,416 @@
+/* A lock free bounded multi producer multi consumer queue in shared memory
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_SHARED_MPMC_QUEUE_HPP
+#define LLFIO_ALGORITHM_SHARED_MPMC_QUEUE_HPP
+
+#include "../map_handle.hpp"
+#include "../path_discovery.hpp"
+#include "../utils.hpp"
+#include "shared_fs_mutex/memory_map.hpp"  // for detail::memory_map_wait() and detail::memory_map_wake()
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+//! \file shared_mpmc_queue.hpp Provides a lock free bounded multi producer multi consumer queue in shared memory.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  /*! \class shared_mpmc_queue
+  \brief A lock free bounded queue of trivially copyable `T`, pushed and popped by any number
+  of threads in any number of processes sharing a section.
+
+  Each slot occupies whole cache lines, holding a sequence number and a `T`, so producers and
+  consumers working upon neighbouring slots never contend upon the same cache line. A push or pop
+  claims its slot with one compare and swap upon the enqueue or dequeue position, each in its own
+  cache line of the header, then publishes it by storing the slot's sequence number, which is the
+  bounded queue of Dmitry Vyukov. `try_push()` and `try_pop()` never block. `push()` and `pop()`
+  sleep upon a futex in the header whilst the queue is full or empty, which the other side only
+  wakes if it announced it is sleeping, so pushes and pops make no syscall in the common case.
+
+  `create()` makes a queue for use within this process or its children. `open()` makes or attaches
+  to a queue kept within a file, so processes may share it by path. Place the file on a memory
+  backed filesystem (e.g. `path_discovery::memory_backed_temporary_files_directory()`) to avoid
+  the kernel writing the queue to storage.
+
+  For variable length messages between one producer and one consumer, use the messages of
+  `mirrored_ring_buffer` instead.
+
+  - The capacity is always a power of two.
+  - A process which dies whilst between claiming a slot and publishing it stalls the queue at
+  that slot, so a timeout ought to be supplied to `push()` and `pop()`.
+  - Futex sleeps are only implemented upon Linux; elsewhere waiting polls, as `WaitOnAddress()`
+  cannot wake other processes.
+  */
+  template <class T> class shared_mpmc_queue
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable to be placed into shared memory");
+
+  public:
+    //! The type of the items
+    using value_type = T;
+    //! The size type
+    using size_type = map_handle::size_type;
+
+  private:
+    static constexpr uint64_t _magic = 0x45554555514d504dULL;  // "MPMQUEUE"
+    struct _header_t
+    {
+      std::atomic<uint64_t> magic;
+      uint64_t capacity;
+      uint64_t item_size;
+      alignas(64) std::atomic<uint64_t> enqueue_pos;
+      alignas(64) std::atomic<uint64_t> dequeue_pos;
+      alignas(64) std::atomic<uint32_t> pushes;  // Incremented upon each push, slept upon by consumers
+      std::atomic<uint32_t> consumers_sleeping;
+      alignas(64) std::atomic<uint32_t> pops;  // Incremented upon each pop, slept upon by producers
+      std::atomic<uint32_t> producers_sleeping;
+    };
+    struct alignas(64) _slot_t
+    {
+      std::atomic<uint64_t> seq;
+      T value;
+    };
+    static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "std::atomic<uint64_t> must be lock free to be placed into shared memory");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> is not usable as a futex word on this platform");
+
+    file_handle _backing;
+    section_handle _sh;
+    map_handle _map;
+    size_type _capacity{0};
+
+    _header_t *_header() const noexcept { return reinterpret_cast<_header_t *>(_map.address()); }
+    _slot_t *_slots() const noexcept { return reinterpret_cast<_slot_t *>(_map.address() + utils::allocation_granularity()); }
+    static size_type _bytes(size_type capacity) noexcept
+    {
+      return utils::round_up_to_page_size(utils::allocation_granularity() + capacity * sizeof(_slot_t), utils::allocation_granularity());
+    }
+
+    shared_mpmc_queue(file_handle &&backing, section_handle &&sh, map_handle &&map, size_type capacity) noexcept
+        : _backing(std::move(backing))
+        , _sh(std::move(sh))
+        , _map(std::move(map))
+        , _capacity(capacity)
+    {
+      _fixup();
+    }
+    void _fixup() noexcept
+    {
+      if(_backing.is_valid())
+      {
+        _sh.set_backing(&_backing);
+      }
+      _map.set_section(&_sh);
+    }
+    static result<shared_mpmc_queue> _make(file_handle &&backing, section_handle &&sh, size_type capacity, bool initialise) noexcept
+    {
+      const auto granularity = utils::allocation_granularity();
+      size_type bytes = granularity;
+      if(initialise)
+      {
+        bytes = _bytes(capacity);
+      }
+      else
+      {
+        OUTCOME_TRY(auto &&headermap, map_handle::map(sh, granularity, 0));
+        auto *header = reinterpret_cast<_header_t *>(headermap.address());
+        if(header->magic.load(std::memory_order_acquire) != _magic)
+        {
+          // Not yet initialised by its creator, or not a queue
+          return errc::resource_unavailable_try_again;
+        }
+        capacity = static_cast<size_type>(header->capacity);
+        if(capacity == 0 || (capacity & (capacity - 1)) != 0 || header->item_size != sizeof(T))
+        {
+          return errc::invalid_argument;
+        }
+        bytes = _bytes(capacity);
+      }
+      OUTCOME_TRY(auto &&map, map_handle::map(sh, bytes, 0));
+      if(initialise)
+      {
+        auto *header = reinterpret_cast<_header_t *>(map.address());
+        auto *slots = reinterpret_cast<_slot_t *>(map.address() + granularity);
+        header->capacity = capacity;
+        header->item_size = sizeof(T);
+        header->enqueue_pos.store(0, std::memory_order_relaxed);
+        header->dequeue_pos.store(0, std::memory_order_relaxed);
+        header->pushes.store(0, std::memory_order_relaxed);
+        header->consumers_sleeping.store(0, std::memory_order_relaxed);
+        header->pops.store(0, std::memory_order_relaxed);
+        header->producers_sleeping.store(0, std::memory_order_relaxed);
+        for(size_type n = 0; n < capacity; n++)
+        {
+          slots[n].seq.store(n, std::memory_order_relaxed);
+        }
+        header->magic.store(_magic, std::memory_order_release);
+      }
+      return shared_mpmc_queue(std::move(backing), std::move(sh), std::move(map), capacity);
+    }
+    static size_type _round_capacity(size_type capacity) noexcept
+    {
+      size_type ret = 1;
+      while(ret < capacity)
+      {
+        ret <<= 1;
+      }
+      return ret;
+    }
+    static void _notify(std::atomic<uint32_t> &seq, std::atomic<uint32_t> &sleeping) noexcept
+    {
+      seq.fetch_add(1, std::memory_order_seq_cst);
+      if(sleeping.load(std::memory_order_seq_cst) != 0)
+      {
+        algorithm::shared_fs_mutex::detail::memory_map_wake(&seq);
+      }
+    }
+    // Retries op() until it succeeds, sleeping upon seq between tries. The sleep is announced
+    // before sampling seq, so an operation by the other side after the sample wakes it.
+    template <class F> static result<void> _wait(F &&op, std::atomic<uint32_t> &seq, std::atomic<uint32_t> &sleeping, deadline d) noexcept
+    {
+      LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+      for(;;)
+      {
+        if(op())
+        {
+          return success();
+        }
+        LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        std::chrono::nanoseconds remaining(-1);
+        if(d)
+        {
+          deadline nd;
+          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+          remaining = nd.steady ? std::chrono::nanoseconds(nd.nsecs) :
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(nd.to_time_point() - std::chrono::system_clock::now());
+          if(remaining.count() < 0)
+          {
+            remaining = std::chrono::nanoseconds(0);
+          }
+        }
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        const uint32_t sample = seq.load(std::memory_order_seq_cst);
+        const bool done = op();
+        if(!done)
+        {
+          algorithm::shared_fs_mutex::detail::memory_map_wait(&seq, sample, remaining);
+        }
+        sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        if(done)
+        {
+          return success();
+        }
+      }
+    }
+
+  public:
+    //! Default constructor
+    shared_mpmc_queue() = default;
+    //! No copy construction
+    shared_mpmc_queue(const shared_mpmc_queue &) = delete;
+    //! No copy assignment
+    shared_mpmc_queue &operator=(const shared_mpmc_queue &) = delete;
+    //! Move constructor
+    shared_mpmc_queue(shared_mpmc_queue &&o) noexcept
+        : _backing(std::move(o._backing))
+        , _sh(std::move(o._sh))
+        , _map(std::move(o._map))
+        , _capacity(o._capacity)
+    {
+      o._capacity = 0;
+      _fixup();
+    }
+    //! Move assignment
+    shared_mpmc_queue &operator=(shared_mpmc_queue &&o) noexcept
+    {
+      if(this == &o)
+      {
+        return *this;
+      }
+      this->~shared_mpmc_queue();
+      new(this) shared_mpmc_queue(std::move(o));
+      return *this;
+    }
+    ~shared_mpmc_queue() = default;
+
+    /*! \brief Creates a queue of at least `capacity` items for use within this process, or any
+    children inheriting its section.
+
+    \errors Any of the values `section_handle::section()` or `map_handle::map()` can return.
+    */
+    static result<shared_mpmc_queue> create(size_type capacity) noexcept
+    {
+      if(capacity == 0)
+      {
+        return errc::invalid_argument;
+      }
+      capacity = _round_capacity(capacity);
+      OUTCOME_TRY(auto &&sh, section_handle::section(_bytes(capacity), path_discovery::memory_backed_temporary_files_directory(), section_handle::flag::readwrite));
+      return _make(file_handle(), std::move(sh), capacity, true);
+    }
+
+    /*! \brief Creates or attaches to a queue kept within a file, which may be shared with other processes.
+
+    \param backing A writable handle to the file, which the queue takes ownership of.
+    \param capacity If non-zero, the file is (re)initialised as an empty queue of at least
+    this many items. If zero, the queue already in the file is attached to, and
+    `errc::resource_unavailable_try_again` is returned if its creator has not finished initialising it.
+
+    Exactly one party ought to create the queue, usually the one which created the file, and
+    only after that may others attach.
+
+    \errors `errc::invalid_argument` if the queue in the file is not of `T`. Any of the values
+    `file_handle::truncate()`, `section_handle::section()` or `map_handle::map()` can return.
+    */
+    static result<shared_mpmc_queue> open(file_handle &&backing, size_type capacity = 0) noexcept
+    {
+      if(capacity != 0)
+      {
+        capacity = _round_capacity(capacity);
+        OUTCOME_TRYV(backing.truncate(_bytes(capacity)));
+      }
+      else
+      {
+        OUTCOME_TRY(auto &&length, backing.maximum_extent());
+        if(length < utils::allocation_granularity())
+        {
+          return errc::resource_unavailable_try_again;
+        }
+      }
+      OUTCOME_TRY(auto &&sh, section_handle::section(backing, 0, section_handle::flag::readwrite));
+      return _make(std::move(backing), std::move(sh), capacity, capacity != 0);
+    }
+
+    //! True if this queue is valid
+    bool is_valid() const noexcept { return _capacity != 0; }
+    //! The capacity of the queue in items
+    size_type capacity() const noexcept { return _capacity; }
+    //! The file backing the queue, which is invalid for queues made by `create()`
+    const file_handle &backing() const noexcept { return _backing; }
+    //! The number of items in the queue. This is a snapshot, and may be stale by the time it is returned.
+    size_type size() const noexcept
+    {
+      auto *header = _header();
+      const auto dequeue_pos = header->dequeue_pos.load(std::memory_order_acquire);
+      const auto enqueue_pos = header->enqueue_pos.load(std::memory_order_acquire);
+      return (enqueue_pos > dequeue_pos) ? static_cast<size_type>(enqueue_pos - dequeue_pos) : 0;
+    }
+    //! True if the queue is empty. This is a snapshot, and may be stale by the time it is returned.
+    bool empty() const noexcept { return size() == 0; }
+
+    //! Pushes `v`, returning false if the queue is full.
+    bool try_push(const T &v) noexcept
+    {
+      auto *header = _header();
+      const auto mask = _capacity - 1;
+      auto pos = header->enqueue_pos.load(std::memory_order_relaxed);
+      _slot_t *slot;
+      for(;;)
+      {
+        slot = &_slots()[pos & mask];
+        const auto seq = slot->seq.load(std::memory_order_acquire);
+        const auto diff = static_cast<int64_t>(seq - pos);
+        if(diff == 0)
+        {
+          if(header->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            break;
+          }
+        }
+        else if(diff < 0)
+        {
+          return false;
+        }
+        else
+        {
+          pos = header->enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+      memcpy(&slot->value, &v, sizeof(T));
+      slot->seq.store(pos + 1, std::memory_order_release);
+      _notify(header->pushes, header->consumers_sleeping);
+      return true;
+    }
+    //! Pops into `v`, returning false if the queue is empty.
+    bool try_pop(T &v) noexcept
+    {
+      auto *header = _header();
+      const auto mask = _capacity - 1;
+      auto pos = header->dequeue_pos.load(std::memory_order_relaxed);
+      _slot_t *slot;
+      for(;;)
+      {
+        slot = &_slots()[pos & mask];
+        const auto seq = slot->seq.load(std::memory_order_acquire);
+        const auto diff = static_cast<int64_t>(seq - (pos + 1));
+        if(diff == 0)
+        {
+          if(header->dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          {
+            break;
+          }
+        }
+        else if(diff < 0)
+        {
+          return false;
+        }
+        else
+        {
+          pos = header->dequeue_pos.load(std::memory_order_relaxed);
+        }
+      }
+      memcpy(&v, &slot->value, sizeof(T));
+      slot->seq.store(pos + mask + 1, std::memory_order_release);
+      _notify(header->pops, header->producers_sleeping);
+      return true;
+    }
+
+    /*! \brief Pushes `v`, sleeping whilst the queue is full.
+
+    \errors `errc::timed_out` if the deadline passes.
+    */
+    result<void> push(const T &v, deadline d = {}) noexcept
+    {
+      auto *header = _header();
+      return _wait([&] { return try_push(v); }, header->pops, header->producers_sleeping, d);
+    }
+    /*! \brief Pops into `v`, sleeping whilst the queue is empty.
+
+    \errors `errc::timed_out` if the deadline passes.
+    */
+    result<void> pop(T &v, deadline d = {}) noexcept
+    {
+      auto *header = _header();
+      return _wait([&] { return try_pop(v); }, header->pushes, header->consumers_sleeping, d);
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
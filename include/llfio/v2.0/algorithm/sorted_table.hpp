@@ -0,0 +1,468 @@
+/* An immutable memory mapped sorted table of keys and values
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_SORTED_TABLE_HPP
+#define LLFIO_ALGORITHM_SORTED_TABLE_HPP
+
+#include "../mapped.hpp"
+#include "../utils.hpp"
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//! \file sorted_table.hpp Provides an immutable memory mapped sorted table of keys and values.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    struct sorted_table_header
+    {
+      char magic[8];             // "LLFIOSST"
+      uint32_t endian;           // 0x01020304 in the byte order of the writer
+      uint32_t key_size;         // sizeof(Key)
+      uint64_t count;            // the number of keys
+      uint64_t blocks;           // the number of cache line sized blocks of keys
+      uint64_t keys_offset;      // blocks * (64 / key_size) keys
+      uint64_t index_offset;     // blocks + 1 keys in Eytzinger order, the first unused
+      uint64_t ranks_offset;     // blocks + 1 uint64_t, the block of each index entry
+      uint64_t values_offset;    // count + 1 uint64_t, the file offset of each value
+      uint64_t length;           // the length of the file
+    };
+    static constexpr uint32_t sorted_table_endian = 0x01020304;
+    static constexpr size_t sorted_table_block = 64;
+    static constexpr size_t sorted_table_data_offset = 4096;
+  }  // namespace detail
+
+  /*! \class sorted_table
+  \brief A read only view of an immutable table of unique unsigned integer keys in ascending
+  order, each with a value of bytes, searched directly within a map of the file.
+
+  The file is written by `sorted_table_builder`. It contains no pointers, only file offsets, so
+  it can be mapped at any address by any number of processes, which share the one copy in the
+  page cache, and opening it costs one map rather than any deserialisation.
+
+  The keys are stored in cache line sized blocks. Above them is an index of the first key of
+  every block, in Eytzinger (breadth first) order, so the index is searched top down with the
+  next level always at `2k` or `2k+1`, which is prefetched sixteen entries ahead and never
+  mispredicted as the next position is computed arithmetically. The block found is then searched
+  by counting the keys less than the key sought, a fixed length loop without branches which
+  compilers vectorise. A lookup thus touches at most one cache line of keys beyond the index.
+
+  The table is only readable by machines of the same byte order as the writer.
+  */
+  template <class Key> class sorted_table
+  {
+    static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value, "Key must be an unsigned integer type");
+
+  public:
+    //! The key type
+    using key_type = Key;
+    //! The value type
+    using value_type = span<const byte>;
+    //! The number of keys in each block
+    static constexpr size_t keys_per_block = detail::sorted_table_block / sizeof(Key);
+
+  private:
+    mapped<byte> _map;
+    const detail::sorted_table_header *_header{nullptr};
+    const Key *_keys{nullptr}, *_index{nullptr};
+    const uint64_t *_ranks{nullptr}, *_values{nullptr};
+
+    const byte *_base() const noexcept { return _map.data(); }
+
+    // The first block whose first key exceeds k, or blocks if none do
+    size_t _upper_block(Key k) const noexcept
+    {
+      const size_t n = static_cast<size_t>(_header->blocks);
+      size_t i = 1;
+      while(i <= n)
+      {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(_index + i * 16);
+#endif
+        i = 2 * i + (_index[i] <= k);
+      }
+      // Undo the right turns taken after the last left turn
+      while(i & 1)
+      {
+        i >>= 1;
+      }
+      i >>= 1;
+      return (i == 0) ? n : static_cast<size_t>(_ranks[i]);
+    }
+
+    explicit sorted_table(mapped<byte> &&map) noexcept
+        : _map(std::move(map))
+    {
+      _fixup();
+    }
+    void _fixup() noexcept
+    {
+      if(_map.empty())
+      {
+        return;
+      }
+      _header = reinterpret_cast<const detail::sorted_table_header *>(_base());
+      _keys = reinterpret_cast<const Key *>(_base() + _header->keys_offset);
+      _index = reinterpret_cast<const Key *>(_base() + _header->index_offset);
+      _ranks = reinterpret_cast<const uint64_t *>(_base() + _header->ranks_offset);
+      _values = reinterpret_cast<const uint64_t *>(_base() + _header->values_offset);
+    }
+
+  public:
+    //! Default constructor
+    sorted_table() = default;
+    //! Move constructor
+    sorted_table(sorted_table &&o) noexcept
+        : _map(std::move(o._map))
+    {
+      o._header = nullptr;
+      _fixup();
+    }
+    sorted_table(const sorted_table &) = delete;
+    sorted_table &operator=(const sorted_table &) = delete;
+    //! Move assignment
+    sorted_table &operator=(sorted_table &&o) noexcept
+    {
+      if(this == &o)
+      {
+        return *this;
+      }
+      this->~sorted_table();
+      new(this) sorted_table(std::move(o));
+      return *this;
+    }
+    ~sorted_table() = default;
+
+    /*! \brief Maps the table in `fh`, which need not remain open.
+
+    \errors `errc::illegal_byte_sequence` if `fh` does not contain a valid table of `Key`.
+    Any of the values `section_handle::section()` and `map_handle::map()` can return.
+    */
+    static result<sorted_table> open(file_handle &fh) noexcept
+    {
+      try
+      {
+        OUTCOME_TRY(auto &&length, fh.maximum_extent());
+        if(length < detail::sorted_table_data_offset)
+        {
+          return errc::illegal_byte_sequence;
+        }
+        mapped<byte> map(fh, (size_t) -1, 0, 0, section_handle::flag::read);
+        const auto *header = reinterpret_cast<const detail::sorted_table_header *>(map.data());
+        const auto count = header->count, blocks = header->blocks;
+        auto within = [&](uint64_t offset, uint64_t items, size_t size) {
+          return offset % size == 0 && offset <= length && items <= (length - offset) / size;
+        };
+        if(0 != memcmp(header->magic, "LLFIOSST", 8) || header->endian != detail::sorted_table_endian || header->key_size != sizeof(Key) ||
+           header->length != length || blocks != (count + keys_per_block - 1) / keys_per_block || !within(header->keys_offset, blocks * keys_per_block, sizeof(Key)) ||
+           !within(header->index_offset, blocks + 1, sizeof(Key)) || !within(header->ranks_offset, blocks + 1, sizeof(uint64_t)) ||
+           !within(header->values_offset, count + 1, sizeof(uint64_t)))
+        {
+          return errc::illegal_byte_sequence;
+        }
+        sorted_table ret(std::move(map));
+        for(uint64_t n = 1; n <= blocks; n++)
+        {
+          if(ret._ranks[n] >= blocks)
+          {
+            return errc::illegal_byte_sequence;
+          }
+        }
+        for(uint64_t n = 0; n < count; n++)
+        {
+          if(ret._values[n] > ret._values[n + 1] || ret._values[n + 1] > length)
+          {
+            return errc::illegal_byte_sequence;
+          }
+        }
+        return {std::move(ret)};
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+
+    //! True if this table is valid
+    bool is_valid() const noexcept { return _header != nullptr; }
+    //! The number of keys
+    size_t size() const noexcept { return (_header != nullptr) ? static_cast<size_t>(_header->count) : 0; }
+    //! True if there are no keys
+    bool empty() const noexcept { return size() == 0; }
+    //! The underlying map
+    const mapped<byte> &map() const noexcept { return _map; }
+
+    //! The key at index `idx`
+    Key key(size_t idx) const noexcept { return _keys[idx]; }
+    //! The value at index `idx`, referring to the map
+    value_type value(size_t idx) const noexcept { return {_base() + _values[idx], static_cast<size_t>(_values[idx + 1] - _values[idx])}; }
+
+    //! The index of the first key not less than `k`, or `size()` if there is none.
+    size_t lower_bound(Key k) const noexcept
+    {
+      if(empty())
+      {
+        return 0;
+      }
+      const size_t upper = _upper_block(k);
+      if(upper == 0)
+      {
+        return 0;
+      }
+      const size_t block = upper - 1;
+      const Key *b = _keys + block * keys_per_block;
+      size_t pos = 0;
+      for(size_t n = 0; n < keys_per_block; n++)
+      {
+        pos += (b[n] < k);
+      }
+      const size_t ret = block * keys_per_block + pos;
+      return (ret < size()) ? ret : size();
+    }
+    //! The index of `k`, if present.
+    optional<size_t> find(Key k) const noexcept
+    {
+      const size_t idx = lower_bound(k);
+      if(idx < size() && _keys[idx] == k)
+      {
+        return idx;
+      }
+      return {};
+    }
+    //! The value of `k`, if present, referring to the map.
+    optional<value_type> lookup(Key k) const noexcept
+    {
+      const auto idx = find(k);
+      if(idx)
+      {
+        return value(*idx);
+      }
+      return {};
+    }
+  };
+
+  /*! \class sorted_table_builder
+  \brief Writes a file readable by `sorted_table`, from keys and values added in ascending order of key.
+
+  Values are written as they are added, `buffer_size` bytes at a time, and the keys and index are
+  written by `finish()`, so the file is written sequentially in large writes. The builder retains
+  sixteen bytes per key in memory until `finish()`.
+  */
+  template <class Key> class sorted_table_builder
+  {
+    static_assert(std::is_integral<Key>::value && std::is_unsigned<Key>::value, "Key must be an unsigned integer type");
+    static constexpr size_t keys_per_block = sorted_table<Key>::keys_per_block;
+
+    file_handle *_fh{nullptr};
+    size_t _buffer_size{0};
+    std::vector<byte> _buffer;
+    std::vector<Key> _keys;
+    std::vector<uint64_t> _values;
+    uint64_t _written{0};  // bytes written before _buffer
+    bool _finished{false};
+
+    result<void> _write(const byte *p, size_t bytes) noexcept
+    {
+      while(bytes > 0)
+      {
+        OUTCOME_TRY(auto &&written, _fh->write(_written, {{p, bytes}}));
+        p += written;
+        bytes -= written;
+        _written += written;
+      }
+      return success();
+    }
+    result<void> _flush() noexcept
+    {
+      OUTCOME_TRYV(_write(_buffer.data(), _buffer.size()));
+      _buffer.clear();
+      return success();
+    }
+    result<void> _append(const byte *p, size_t bytes) noexcept
+    {
+      try
+      {
+        if(_buffer.size() + bytes > _buffer_size)
+        {
+          OUTCOME_TRYV(_flush());
+          if(bytes >= _buffer_size)
+          {
+            return _write(p, bytes);
+          }
+        }
+        _buffer.insert(_buffer.end(), p, p + bytes);
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    result<void> _pad(size_t alignment) noexcept
+    {
+      static const byte zeros[detail::sorted_table_block] = {};
+      const auto at = _written + _buffer.size();
+      const size_t pad = static_cast<size_t>((alignment - at % alignment) % alignment);
+      return _append(zeros, pad);
+    }
+    static void _eytzinger(const std::vector<Key> &firsts, std::vector<Key> &index, std::vector<uint64_t> &ranks, size_t &i, size_t k) noexcept
+    {
+      if(k < index.size())
+      {
+        _eytzinger(firsts, index, ranks, i, 2 * k);
+        index[k] = firsts[i];
+        ranks[k] = i++;
+        _eytzinger(firsts, index, ranks, i, 2 * k + 1);
+      }
+    }
+
+  public:
+    //! Begins writing a table into `fh`, replacing its contents. `fh` must remain open until `finish()`.
+    explicit sorted_table_builder(file_handle &fh, size_t buffer_size = 1024 * 1024)
+        : _fh(&fh)
+        , _buffer_size(buffer_size)
+        , _written(detail::sorted_table_data_offset)
+    {
+      _buffer.reserve(buffer_size);
+    }
+    sorted_table_builder(const sorted_table_builder &) = delete;
+    sorted_table_builder(sorted_table_builder &&) = default;
+    sorted_table_builder &operator=(const sorted_table_builder &) = delete;
+    sorted_table_builder &operator=(sorted_table_builder &&) = default;
+    ~sorted_table_builder() = default;
+
+    //! The number of keys added
+    size_t size() const noexcept { return _keys.size(); }
+
+    /*! \brief Adds `k` with value `v`.
+
+    \errors `errc::invalid_argument` if `k` is not greater than the key previously added, or
+    after `finish()`. Any of the values `write()` can return.
+    */
+    result<void> add(Key k, span<const byte> v) noexcept
+    {
+      if(_finished || (!_keys.empty() && k <= _keys.back()))
+      {
+        return errc::invalid_argument;
+      }
+      try
+      {
+        if(_keys.empty())
+        {
+          OUTCOME_TRYV(_fh->truncate(0));
+        }
+        _keys.push_back(k);
+        _values.push_back(_written + _buffer.size());
+        return _append(v.data(), v.size());
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+
+    /*! \brief Writes the keys, the index and the header, completing the table.
+
+    \errors Any of the values `write()` and `truncate()` can return.
+    */
+    result<void> finish() noexcept
+    {
+      if(_finished)
+      {
+        return errc::invalid_argument;
+      }
+      try
+      {
+        if(_keys.empty())
+        {
+          OUTCOME_TRYV(_fh->truncate(0));
+        }
+        detail::sorted_table_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "LLFIOSST", 8);
+        header.endian = detail::sorted_table_endian;
+        header.key_size = sizeof(Key);
+        header.count = _keys.size();
+        header.blocks = (_keys.size() + keys_per_block - 1) / keys_per_block;
+        _values.push_back(_written + _buffer.size());
+
+        // Keys, with the last block padded with the largest key
+        OUTCOME_TRYV(_pad(detail::sorted_table_block));
+        header.keys_offset = _written + _buffer.size();
+        std::vector<Key> firsts;
+        firsts.reserve(static_cast<size_t>(header.blocks));
+        for(size_t n = 0; n < _keys.size(); n += keys_per_block)
+        {
+          firsts.push_back(_keys[n]);
+        }
+        _keys.resize(static_cast<size_t>(header.blocks * keys_per_block), (Key) -1);
+        OUTCOME_TRYV(_append(reinterpret_cast<const byte *>(_keys.data()), _keys.size() * sizeof(Key)));
+
+        // The first key of each block in Eytzinger order, with the block of each
+        std::vector<Key> index(firsts.size() + 1);
+        std::vector<uint64_t> ranks(firsts.size() + 1);
+        size_t i = 0;
+        _eytzinger(firsts, index, ranks, i, 1);
+        OUTCOME_TRYV(_pad(detail::sorted_table_block));
+        header.index_offset = _written + _buffer.size();
+        OUTCOME_TRYV(_append(reinterpret_cast<const byte *>(index.data()), index.size() * sizeof(Key)));
+        OUTCOME_TRYV(_pad(sizeof(uint64_t)));
+        header.ranks_offset = _written + _buffer.size();
+        OUTCOME_TRYV(_append(reinterpret_cast<const byte *>(ranks.data()), ranks.size() * sizeof(uint64_t)));
+        header.values_offset = _written + _buffer.size();
+        OUTCOME_TRYV(_append(reinterpret_cast<const byte *>(_values.data()), _values.size() * sizeof(uint64_t)));
+        OUTCOME_TRYV(_flush());
+        header.length = _written;
+        OUTCOME_TRYV(_fh->truncate(_written));
+        // The header is written last, so a partially written table is never valid
+        byte first[detail::sorted_table_data_offset] = {};
+        memcpy(first, &header, sizeof(header));
+        OUTCOME_TRY(auto &&written, _fh->write(0, {{first, sizeof(first)}}));
+        if(written != sizeof(first))
+        {
+          return errc::no_space_on_device;
+        }
+        _finished = true;
+        _keys = {};
+        _values = {};
+        _buffer = {};
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
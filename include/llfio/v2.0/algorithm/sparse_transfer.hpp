@@ -0,0 +1,87 @@
+/* Sparse aware transfer of files through pipes and sockets
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_SPARSE_TRANSFER_HPP
+#define LLFIO_ALGORITHM_SPARSE_TRANSFER_HPP
+
+#include "../file_handle.hpp"
+
+//! \file sparse_transfer.hpp Provides sparse aware transfer of files through pipes and sockets.
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+namespace algorithm
+{
+  //! \brief What a `send_sparse()` or `receive_sparse()` did.
+  struct sparse_transfer_stats
+  {
+    file_handle::extent_type length{0};      //!< The length of the file.
+    file_handle::extent_type data_bytes{0};  //!< The bytes of file content transferred.
+    file_handle::extent_type hole_bytes{0};  //!< The bytes of file transferred as holes.
+    size_t frames{0};                        //!< The number of data frames transferred.
+  };
+
+  /*! \brief Writes `src` to the stream `dest` (a pipe, or any other `io_handle`) in a framed
+  format preserving holes, transmitting only the content of the valid extents of `src`.
+
+  `file_handle::clone_extents_to()` with a destination which is not a file uses `sendfile()`,
+  which transmits holes as zeros. This instead enumerates the valid extents of `src` with
+  `file_handle::extents()`, and transmits each as frames of its offset, its length and its
+  content, so the cost of a transfer is proportional to the bytes allocated, not the length of
+  the file. If `skip_zeros` is true, page sized blocks of zeros within valid extents are
+  transmitted as holes also, as many virtual machine images have allocated but zeroed extents.
+  `receive_sparse()` reverses the transfer.
+
+  The stream begins with the magic `LLFIOSPR` then the length of the file, then each frame is an
+  offset and a length followed by the content, ending with a frame of offset `(uint64_t) -1`. All
+  integers are 64 bit little endian.
+
+  \errors `errc::timed_out` if the deadline passes. Any of the values `read()`, `write()`,
+  `maximum_extent()` and `extents()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<sparse_transfer_stats> send_sparse(file_handle &src, io_handle &dest, bool skip_zeros = true, deadline d = {}) noexcept;
+
+  /*! \brief Reads a stream written by `send_sparse()` from `src` into `dest`, reproducing its holes.
+
+  `dest` is truncated to zero, then the content of each frame is written to it, then it is
+  truncated to the length of the file sent, so everything not written is a hole. If `dest`
+  cannot be truncated, as with a block device, the gaps between frames are deallocated with
+  `file_handle::zero()` instead.
+
+  \errors `errc::illegal_byte_sequence` if the stream is malformed or ends early, `errc::timed_out`
+  if the deadline passes. Any of the values `read()`, `write()`, `truncate()` and `zero()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<sparse_transfer_stats> receive_sparse(io_handle &src, file_handle &dest, deadline d = {}) noexcept;
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/sparse_transfer.ipp"
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#endif
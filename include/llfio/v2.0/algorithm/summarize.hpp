@@ -29,7 +29,13 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../stat.hpp"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 //! \file summarize.hpp Provides a directory tree summary algorithm.
 
@@ -37,6 +43,183 @@ LLFIO_V2_NAMESPACE_BEGIN
 
 namespace algorithm
 {
+  namespace detail
+  {
+    /* An open addressing hash map of counts, which unlike `std::unordered_map` does not
+    allocate per key. Accumulating per kernel thread, there are few distinct keys.
+    */
+    template <class T> class summary_counts_map
+    {
+      struct _item_t
+      {
+        T key{};
+        size_t count{0};
+        bool used{false};
+      };
+      std::vector<_item_t> _items;
+      size_t _size{0};
+
+      static size_t _hash(T key) noexcept
+      {
+        auto x = (uint64_t) key;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return (size_t) x;
+      }
+      _item_t &_find(T key) noexcept
+      {
+        const size_t mask = _items.size() - 1;
+        for(size_t n = _hash(key) & mask;; n = (n + 1) & mask)
+        {
+          auto &i = _items[n];
+          if(!i.used || i.key == key)
+          {
+            return i;
+          }
+        }
+      }
+
+    public:
+      //! Returns the count for `key`, inserting it if necessary
+      size_t &operator[](T key)
+      {
+        if((_size + 1) * 4 > _items.size() * 3)
+        {
+          std::vector<_item_t> old(std::max<size_t>(16, _items.size() * 2));
+          old.swap(_items);
+          for(auto &i : old)
+          {
+            if(i.used)
+            {
+              _find(i.key) = i;
+            }
+          }
+        }
+        auto &i = _find(key);
+        if(!i.used)
+        {
+          i.key = key;
+          i.used = true;
+          _size++;
+        }
+        return i.count;
+      }
+      //! Calls `f(key, count)` for each key
+      template <class F> void for_each(F &&f) const
+      {
+        for(auto &i : _items)
+        {
+          if(i.used)
+          {
+            f(i.key, i.count);
+          }
+        }
+      }
+    };
+  }  // namespace detail
+
+  /*! \brief A histogram of counts of values in power of two sized buckets, where bucket zero
+  counts zeros and bucket `n` counts values within `[2^(n-1), 2^n)`.
+  */
+  struct log2_histogram
+  {
+    //! The number of buckets
+    static constexpr size_t buckets = 65;
+    std::array<size_t, buckets> counts{};  //!< The count of values in each bucket
+
+    //! Returns the bucket counting `v`
+    static size_t bucket(uint64_t v) noexcept
+    {
+      size_t ret = 0;
+      for(unsigned shift = 32; shift > 0; shift >>= 1)
+      {
+        if((v >> shift) != 0)
+        {
+          v >>= shift;
+          ret += shift;
+        }
+      }
+      return ret + (v != 0);
+    }
+    //! Returns the smallest value counted by bucket `n`
+    static uint64_t lower_bound(size_t n) noexcept { return (n == 0) ? 0 : ((uint64_t) 1 << (n - 1)); }
+
+    //! Counts `v`, `count` times
+    void add(uint64_t v, size_t count = 1) noexcept { counts[bucket(v)] += count; }
+    //! The total of the counts
+    size_t total() const noexcept
+    {
+      size_t ret = 0;
+      for(auto c : counts)
+      {
+        ret += c;
+      }
+      return ret;
+    }
+    //! Returns the smallest value counted by the bucket containing the `fraction` quantile, such as 0.5 for the median.
+    uint64_t quantile(double fraction) const noexcept
+    {
+      const auto target = (size_t) std::ceil(fraction * (double) total());
+      size_t sum = 0;
+      for(size_t n = 0; n < buckets; n++)
+      {
+        sum += counts[n];
+        if(sum >= target && sum > 0)
+        {
+          return lower_bound(n);
+        }
+      }
+      return 0;
+    }
+    //! Adds another histogram to this
+    log2_histogram &operator+=(const log2_histogram &o) noexcept
+    {
+      for(size_t n = 0; n < buckets; n++)
+      {
+        counts[n] += o.counts[n];
+      }
+      return *this;
+    }
+  };
+
+  /*! \brief How `summarize()` samples a directory tree, rather than visiting all of it.
+
+  Of the subdirectories of each directory at `depth`, only `fraction` are descended into, and
+  everything found beneath those is weighted by `1 / fraction`, so the counts, sums and histograms
+  of the summary are unbiased estimates of those of the whole tree. Everything down to and
+  including the subdirectories at `depth` is visited and summarised exactly. Whether to descend
+  into a subdirectory is decided by a hash of its inode and `seed` where the inode is enumerated,
+  so summaries with the same seed sample the same subdirectories.
+
+  The estimates are as good as the sampled subtrees are representative, so `depth` is best chosen
+  where there are many subdirectories of similar character, such as users' home directories.
+  */
+  struct traversal_sampling
+  {
+    double fraction{1.0};  //!< The fraction of subdirectories at `depth` to descend into, where one is all of them.
+    size_t depth{0};       //!< The depth of the directories whose subdirectories are sampled, where zero is the directory summarised.
+    uint64_t seed{0};      //!< Varies which subdirectories are sampled.
+
+    /*! \brief Returns the fraction of `population` subdirectories to sample to estimate the
+    proportion of them having some characteristic within `margin` with the confidence of the
+    normal deviate `z`, which by default is 95%.
+
+    This is Cochran's sample size with the finite population correction, so for the default one
+    percent margin, about 9,600 subdirectories are sampled from populations much larger than that.
+    */
+    static double fraction_for(size_t population, double margin = 0.01, double z = 1.96) noexcept
+    {
+      if(population == 0)
+      {
+        return 1.0;
+      }
+      const double n0 = z * z * 0.25 / (margin * margin);
+      const double n = n0 / (1.0 + (n0 - 1.0) / (double) population);
+      return std::min(1.0, n / (double) population);
+    }
+  };
+
   /*! \brief A summary of a directory tree
    */
   struct traversal_summary
@@ -48,6 +231,42 @@ namespace algorithm
     }
     template <class T> using map_type = std::unordered_map<T, size_t>;
     spinlock _lock;
+    // What each kernel thread accumulates into during traversal, merged in by `summarize_visitor::finished()`
+    struct _partial_summary
+    {
+      bool sampled{false};  // beneath a sampled subdirectory, so to be weighted
+      size_t directory_opens_failed{0}, directories_not_sampled{0};
+      detail::summary_counts_map<uint64_t> devs;
+      detail::summary_counts_map<filesystem::file_type> types;
+      handle::extent_type size{0}, allocated{0}, file_blocks{0}, directory_blocks{0};
+      log2_histogram size_histogram, allocated_histogram, age_histogram, nlink_histogram;
+      size_t max_depth{0};
+
+      _partial_summary &operator+=(const _partial_summary &o)
+      {
+        directory_opens_failed += o.directory_opens_failed;
+        directories_not_sampled += o.directories_not_sampled;
+        o.devs.for_each([&](uint64_t k, size_t c) { devs[k] += c; });
+        o.types.for_each([&](filesystem::file_type k, size_t c) { types[k] += c; });
+        size += o.size;
+        allocated += o.allocated;
+        file_blocks += o.file_blocks;
+        directory_blocks += o.directory_blocks;
+        size_histogram += o.size_histogram;
+        allocated_histogram += o.allocated_histogram;
+        age_histogram += o.age_histogram;
+        nlink_histogram += o.nlink_histogram;
+        max_depth = std::max(max_depth, o.max_depth);
+        return *this;
+      }
+    };
+    static uint64_t _next_id() noexcept
+    {
+      static std::atomic<uint64_t> count(0);
+      return ++count;
+    }
+    uint64_t _id{_next_id()};  // distinguishes this summary in each thread's cache of its partial summary
+    std::vector<std::unique_ptr<_partial_summary>> _partials;
     size_t directory_opens_failed{0};  //!< The number of directories which could not be opened.
 
     stat_t::want want{stat_t::want::none};    //!< The summary items desired
@@ -59,6 +278,14 @@ namespace algorithm
     handle::extent_type directory_blocks{0};  //!< The sum of directory allocated blocks.
     size_t max_depth{0};                      //!< The maximum depth of the hierarchy
 
+    log2_histogram size_histogram;       //!< Maximum extents of everything but directories, if `want` includes `size`.
+    log2_histogram allocated_histogram;  //!< Allocated extents of everything but directories, if `want` includes `allocated`.
+    log2_histogram age_histogram;        //!< Seconds before `reference_time` of last modification of everything but directories, if `want` includes `mtim`.
+    log2_histogram nlink_histogram;      //!< Hard link counts of everything but directories, if `want` includes `nlink`.
+    std::chrono::system_clock::time_point reference_time;  //!< When the summary began, from which ages are measured.
+    traversal_sampling sampling;                           //!< How the directory tree was sampled.
+    size_t directories_not_sampled{0};                     //!< The number of subdirectories not descended into due to sampling.
+
     //! Adds another summary to this
     traversal_summary &operator+=(const traversal_summary &o)
     {
@@ -77,8 +304,102 @@ namespace algorithm
       file_blocks += o.file_blocks;
       directory_blocks += o.directory_blocks;
       max_depth = std::max(max_depth, o.max_depth);
+      size_histogram += o.size_histogram;
+      allocated_histogram += o.allocated_histogram;
+      age_histogram += o.age_histogram;
+      nlink_histogram += o.nlink_histogram;
+      directories_not_sampled += o.directories_not_sampled;
       return *this;
     }
+
+    //! Returns the partial summary for the calling kernel thread, of entries beneath a sampled subdirectory if `sampled`
+    _partial_summary &_thread_partial(bool sampled = false)
+    {
+      struct cache_t
+      {
+        uint64_t id{0};
+        _partial_summary *partial[2]{nullptr, nullptr};
+      };
+      static thread_local cache_t cache;
+      if(cache.id != _id)
+      {
+        cache.partial[0] = cache.partial[1] = nullptr;
+        cache.id = _id;
+      }
+      auto *&partial = cache.partial[sampled];
+      if(partial == nullptr)
+      {
+        std::unique_ptr<_partial_summary> p(new _partial_summary);
+        p->sampled = sampled;
+        lock_guard<spinlock> g(_lock);
+        _partials.push_back(std::move(p));
+        partial = _partials.back().get();
+      }
+      return *partial;
+    }
+    //! True if the subdirectory with inode `ino`, or zero if not known, is to be descended into
+    bool _sample(uint64_t ino) const noexcept
+    {
+      static thread_local uint64_t counter = (uint64_t)(uintptr_t) &counter;
+      // splitmix64
+      uint64_t x = sampling.seed ^ ((ino != 0) ? ino : ++counter);
+      x += 0x9e3779b97f4a7c15ULL;
+      x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+      x ^= x >> 31;
+      return (double) (x >> 11) / 9007199254740992.0 < sampling.fraction;
+    }
+    //! Adds a partial summary to this, with its counts and sums weighted by `weight`
+    void _add_partial(const _partial_summary &p, double weight)
+    {
+      auto scale = [weight](uint64_t v) -> uint64_t { return (weight == 1.0) ? v : (uint64_t) std::llround((double) v * weight); };
+      auto scale_histogram = [&](log2_histogram &h, const log2_histogram &o) {
+        for(size_t n = 0; n < log2_histogram::buckets; n++)
+        {
+          h.counts[n] += (size_t) scale(o.counts[n]);
+        }
+      };
+      directory_opens_failed += p.directory_opens_failed;
+      directories_not_sampled += p.directories_not_sampled;
+      p.devs.for_each([&](uint64_t k, size_t c) { devs[k] += (size_t) scale(c); });
+      p.types.for_each([&](filesystem::file_type k, size_t c) { types[k] += (size_t) scale(c); });
+      size += scale(p.size);
+      allocated += scale(p.allocated);
+      file_blocks += scale(p.file_blocks);
+      directory_blocks += scale(p.directory_blocks);
+      scale_histogram(size_histogram, p.size_histogram);
+      scale_histogram(allocated_histogram, p.allocated_histogram);
+      scale_histogram(age_histogram, p.age_histogram);
+      scale_histogram(nlink_histogram, p.nlink_histogram);
+      max_depth = std::max(max_depth, p.max_depth);
+    }
+    //! Merges all the per thread partial summaries into this
+    void _merge_partials()
+    {
+      lock_guard<spinlock> g(_lock);
+      // Sampled partials are summed before weighting, so rounding happens once
+      _partial_summary sampled;
+      bool have_sampled = false;
+      for(auto &p : _partials)
+      {
+        if(p->sampled)
+        {
+          sampled += *p;
+          have_sampled = true;
+        }
+        else
+        {
+          _add_partial(*p, 1.0);
+        }
+      }
+      if(have_sampled)
+      {
+        _add_partial(sampled, 1.0 / sampling.fraction);
+      }
+      _partials.clear();
+      // Threads still caching pointers to the partials just freed must not match
+      _id = _next_id();
+    }
   };
 
   /*! \brief A visitor for the filesystem traversal and summary algorithm.
@@ -92,8 +413,8 @@ namespace algorithm
   */
   struct summarize_visitor : public traverse_visitor
   {
-    static result<void> accumulate(traversal_summary &acc, traversal_summary *state, const directory_handle *dirh, directory_entry &entry,
-                                   stat_t::want already_have_metadata)
+    template <class Acc>
+    static result<void> accumulate(Acc &acc, traversal_summary *state, const directory_handle *dirh, directory_entry &entry, stat_t::want already_have_metadata)
     {
       if((state->want & already_have_metadata) != state->want)
       {
@@ -136,6 +457,27 @@ namespace algorithm
           acc.file_blocks += entry.stat.st_blocks;
         }
       }
+      if(entry.stat.st_type != filesystem::file_type::directory)
+      {
+        if(state->want & stat_t::want::size)
+        {
+          acc.size_histogram.add(entry.stat.st_size);
+        }
+        if(state->want & stat_t::want::allocated)
+        {
+          acc.allocated_histogram.add(entry.stat.st_allocated);
+        }
+        if(state->want & stat_t::want::mtim)
+        {
+          // Modifications after the summary began are of age zero
+          const auto age = std::chrono::duration_cast<std::chrono::seconds>(state->reference_time - entry.stat.st_mtim).count();
+          acc.age_histogram.add((age > 0) ? (uint64_t) age : 0);
+        }
+        if(state->want & stat_t::want::nlink)
+        {
+          acc.nlink_histogram.add((entry.stat.st_nlink > 0) ? (uint64_t) entry.stat.st_nlink : 0);
+        }
+      }
       return success();
     }
 
@@ -148,23 +490,38 @@ namespace algorithm
       (void) leaf;
       (void) depth;
       auto *state = (traversal_summary *) data;
-      lock_guard<spinlock> g(state->_lock);
-      state->directory_opens_failed++;
+      try
+      {
+        state->_thread_partial().directory_opens_failed++;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
       return success();  // ignore failure to enter
     }
-    //! This override implements the summary
+    /*! \brief This override implements the summary, accumulating into a partial summary per kernel
+    thread without locking. If sampling, subdirectories not sampled have their type set to unknown
+    so they are not traversed.
+    */
     virtual result<void> post_enumeration(void *data, const directory_handle &dirh, directory_handle::buffers_type &contents, size_t depth) noexcept override
     {
       try
       {
         auto *state = (traversal_summary *) data;
-        traversal_summary acc;
-        acc.max_depth = depth;
+        const bool sampling = state->sampling.fraction < 1.0;
+        auto &acc = state->_thread_partial(sampling && depth > state->sampling.depth);
+        acc.max_depth = std::max(acc.max_depth, depth);
+        const bool have_ino = !!(contents.metadata() & stat_t::want::ino);
         for(auto &entry : contents)
         {
           OUTCOME_TRY(accumulate(acc, state, &dirh, entry, contents.metadata()));
+          if(sampling && depth == state->sampling.depth && entry.stat.st_type == filesystem::file_type::directory && !state->_sample(have_ino ? entry.stat.st_ino : 0))
+          {
+            entry.stat.st_type = filesystem::file_type::unknown;
+            acc.directories_not_sampled++;
+          }
         }
-        state->operator+=(acc);
         return success();
       }
       catch(...)
@@ -172,6 +529,22 @@ namespace algorithm
         return error_from_exception();
       }
     }
+    //! This override merges the per kernel thread partial summaries into the summary
+    virtual result<size_t> finished(void *data, result<size_t> result) noexcept override
+    {
+      try
+      {
+        ((traversal_summary *) data)->_merge_partials();
+      }
+      catch(...)
+      {
+        if(result)
+        {
+          return error_from_exception();
+        }
+      }
+      return result;
+    }
   };
 
   /*! \brief Summarise the directory identified `dirh`, and everything therein.
@@ -182,14 +555,23 @@ namespace algorithm
   what metadata `directory_handle::read()` returns, performance will be considerably
   better. The default summarises all possible metadata.
 
+  Distributions of the sizes, allocated sizes, ages and hard link counts of everything but
+  directories are accumulated into log2 bucketed histograms, if `want` includes `size`,
+  `allocated`, `mtim` and `nlink` respectively. Like the other totals, these are accumulated
+  per kernel thread without locking, and merged when the traversal finishes.
+
   This is a trivial implementation on top of `algorithm::traverse()`, indeed it is
   implemented entirely as header code. You should review the documentation for
   `algorithm::traverse()`, as this algorithm is entirely implemented using that algorithm.
   */
-  inline result<traversal_summary> summarize(const path_handle &dirh, stat_t::want want = traversal_summary::default_metadata(),
-                                             summarize_visitor *visitor = nullptr, size_t threads = 0, bool force_slow_path = false) noexcept
+  inline result<traversal_summary> summarize(const path_handle &dirh, stat_t::want want, const traversal_sampling &sampling, summarize_visitor *visitor = nullptr,
+                                             size_t threads = 0, bool force_slow_path = false) noexcept
   {
     LLFIO_LOG_FUNCTION_CALL(&dirh);
+    if(!(sampling.fraction > 0.0 && sampling.fraction <= 1.0))
+    {
+      return errc::invalid_argument;
+    }
     summarize_visitor default_visitor;
     if(visitor == nullptr)
     {
@@ -197,12 +579,20 @@ namespace algorithm
     }
     result<traversal_summary> state(in_place_type<traversal_summary>);
     state.assume_value().want = want;
+    state.assume_value().sampling = sampling;
+    state.assume_value().reference_time = std::chrono::system_clock::now();
     directory_entry entry{{}, stat_t(nullptr)};
-    OUTCOME_TRY(entry.stat.fill(dirh, want));
+    OUTCOME_TRY(entry.stat.fill(dirh, want | stat_t::want::type));
     OUTCOME_TRY(summarize_visitor::accumulate(state.assume_value(), &state.assume_value(), nullptr, entry, want));
     OUTCOME_TRY(traverse(dirh, visitor, threads, &state.assume_value(), force_slow_path));
     return state;
   }
+  //! \overload Summarises everything, without sampling.
+  inline result<traversal_summary> summarize(const path_handle &dirh, stat_t::want want = traversal_summary::default_metadata(),
+                                             summarize_visitor *visitor = nullptr, size_t threads = 0, bool force_slow_path = false) noexcept
+  {
+    return summarize(dirh, want, traversal_sampling(), visitor, threads, force_slow_path);
+  }
 
 }  // namespace algorithm
 
@@ -97,6 +97,36 @@ namespace algorithm
       return success();
     }
 
+    /*! \brief Called after each `post_enumeration()` to decide whether to read the extended
+    attributes of the entries enumerated. The default returns `false`.
+
+    \note May be called from multiple kernel threads concurrently.
+    */
+    virtual bool want_extended_attributes(void *data) noexcept
+    {
+      (void) data;
+      return false;
+    }
+
+    /*! \brief Called with the extended attributes of each entry of `contents` left valid by
+    `post_enumeration()`, if `want_extended_attributes()` returned true. `read` is the outcome of
+    reading them, and `attrs` is reused for the next entry, so any attribute wanted must be copied.
+    The default ignores the entry.
+
+    \note May be called from multiple kernel threads concurrently.
+    */
+    virtual result<void> extended_attributes_read(void *data, const directory_handle &dirh, const directory_entry &entry, result<void> read, const fs_handle::extended_attributes &attrs,
+                                                  size_t depth) noexcept
+    {
+      (void) data;
+      (void) dirh;
+      (void) entry;
+      (void) read;
+      (void) attrs;
+      (void) depth;
+      return success();
+    }
+
     /*! \brief Called whenever the traversed stack of directory hierarchy is updated.
     This can act as an estimated progress indicator, or to give an
     accurate progress indicator by matching it against a previous
@@ -143,17 +173,25 @@ namespace algorithm
 
   3. Call `post_enumeration()` of the visitor on the contents just enumerated.
 
-  4. For each directory in the contents, append the directory handle and each directory
-  leafname to its hierarchy depth level in a stack of lists.
+  4. If `want_extended_attributes()` of the visitor returns true, call
+  `extended_attributes_read()` of the visitor with the extended attributes of each entry in
+  the contents, read using `fs_handle::read_extended_attributes()` relative to the directory,
+  so on Linux no handle is opened for each entry.
 
-  5. Loop, using the least deep available item in the stack, until the stack is empty.
+  5. For each directory in the contents, append the directory handle and each directory
+  leafname to the back of the current worker's queue.
 
-  If `known_dirs_remaining` exceeds four, a threadpool of not more than `threads` threads
-  is spun up in order to traverse the hierarchy more quickly.
+  6. Loop, taking the front item of the worker's queue, until no work remains anywhere.
 
-  This algorithm is therefore primarily a breadth-first algorithm, in that we proceed from
-  root, level by level, to the tips. The number returned is the total number of directories
-  traversed.
+  If work remains after the first four directories, a threadpool of not more than `threads`
+  threads is spun up in order to traverse the hierarchy more quickly. Each worker thread owns
+  its queue, so workers do not contend on a shared lock. A worker whose queue is empty steals
+  the shallowest half of another worker's queue, and if none has any, sleeps until more work
+  is published. Completion is detected using an atomic count of directories remaining.
+
+  This algorithm is therefore primarily a breadth-first algorithm, in that each worker proceeds
+  from root, level by level, to the tips, though with more than one thread levels will overlap.
+  The number returned is the total number of directories traversed.
 
   ## Notes
 
@@ -172,6 +210,29 @@ namespace algorithm
   sure that doing so will not break code in your program (e.g. `select()` fails spectacularly
   if file descriptors exceed 1024 on most POSIX).
 
+  On network and parallel filesystems each metadata operation may take hundreds of microseconds,
+  which more threads can only hide so far. If `dirs_in_flight` exceeds one, on Linux each worker
+  uses its own io_uring to open up to `dirs_in_flight` (to a maximum of 256) directories from its
+  queue at once, and to `statx()` enumerated entries in batches of that size if the filesystem
+  does not report their type. Enumeration itself remains synchronous, as io_uring has no
+  `getdents()`. Directory handles opened this way fetch their inode lazily, rather than upon open.
+  On Windows each worker instead opens and enumerates up to `dirs_in_flight` (to a maximum of 256)
+  directories from its queue at once using the Win32 thread pool, calling `pre_enumeration()` from
+  those threads. Each is enumerated into a 64Kb kernel buffer by a single `NtQueryDirectoryFile()`
+  where it fits, rather than first iterating the directory for names to size the buffer, saving a
+  round trip per directory on network shares. If io_uring is unavailable, or on other platforms,
+  `dirs_in_flight` is ignored.
+
+  Breadth first traversal queues a whole level of the hierarchy at a time, and on the fast path
+  every queued directory holds open its parent directory. For very wide trees, both memory and
+  file descriptors can therefore grow without limit. If `max_queued_dirs` is not zero, any worker
+  whose queue exceeds its share of `max_queued_dirs` takes the deepest work from its queue rather
+  than the shallowest, which stops its queue growing further, and workers release the buffers of
+  any unusually large directory once done with it. Memory and file descriptors consumed are then
+  bounded by roughly the depth of the hierarchy multiplied by the widest directory in it, rather
+  than by the widest level of it. Note that each directory is still enumerated whole, as
+  `directory_handle::read()` returns a snapshot of the entire directory.
+
   To give an idea of the difference slow path makes, for Linux ext4:
 
   - Slow path, 1 thread, traversed 131,915 directories and 8,254,162 entries in 3.10 seconds.
@@ -182,7 +243,8 @@ namespace algorithm
 
   - Fast path, 16 threads, traversed 131,915 directories and 8,254,162 entries in 0.525 seconds (+46%).
   */
-  LLFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> traverse(const path_handle &dirh, traverse_visitor *visitor, size_t threads = 0, void *data = nullptr, bool force_slow_path = false) noexcept;
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> traverse(const path_handle &dirh, traverse_visitor *visitor, size_t threads = 0, void *data = nullptr, bool force_slow_path = false,
+                                                       size_t dirs_in_flight = 1, size_t max_queued_dirs = 0) noexcept;
 
 }  // namespace algorithm
 
@@ -0,0 +1,293 @@
+/* Parallel tree hashing of files
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_TREE_HASH_HPP
+#define LLFIO_ALGORITHM_TREE_HASH_HPP
+
+#include "handle_adapter/checksumming.hpp"  // for detail::crc32c()
+
+#include "quickcpplib/algorithm/hash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+//! \file tree_hash.hpp Provides parallel tree hashing of files.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  //! \brief A hasher for `tree_hash()` producing a CRC32C, computed with the CPU's CRC instructions where available.
+  struct crc32c_hasher
+  {
+    using digest_type = uint32_t;
+    static digest_type hash(const byte *p, size_t bytes) noexcept { return detail::crc32c(p, bytes); }
+  };
+  //! \brief A hasher for `tree_hash()` producing the 128 bit SpookyHash of QuickCppLib's `fast_hash`.
+  struct fast_hash_hasher
+  {
+    using digest_type = QUICKCPPLIB_NAMESPACE::integers128::uint128;
+    static digest_type hash(const byte *p, size_t bytes) noexcept { return QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash(reinterpret_cast<const char *>(p), bytes); }
+  };
+
+  //! \brief Options for `tree_hash()`.
+  struct tree_hash_options
+  {
+    //! The bytes of file hashed into each leaf, rounded up to the page size.
+    size_t chunk_size{1024 * 1024};
+    //! The number of threads reading and hashing chunks, zero means the number of hardware threads.
+    size_t threads{0};
+  };
+
+  /*! \brief The tree hash of a file, being the digest of each chunk of the file, and the root
+  of a binary tree of digests above them.
+
+  Each parent digest is the hash of its two children's digests concatenated, with an unpaired
+  digest at the end of a level promoted unchanged to the next level, so the root depends only
+  upon the content, the chunk size and the hasher. Comparing the chunk digests of two tree
+  hashes with `differing_chunks()` finds which chunks differ, so replicas may be repaired
+  without copying the whole file.
+  */
+  template <class Hasher> struct tree_hash_result
+  {
+    using hasher_type = Hasher;
+    using digest_type = typename Hasher::digest_type;
+    static_assert(std::is_trivially_copyable<digest_type>::value, "Hasher::digest_type must be trivially copyable");
+
+    file_handle::extent_type length{0};  //!< The length of the file hashed.
+    size_t chunk_size{0};                //!< The bytes of file in each chunk
+    std::vector<digest_type> chunks;     //!< The digest of each chunk.
+    digest_type root{};                  //!< The digest of the whole tree.
+
+    //! Recalculates `root` from `chunks`.
+    void update_root()
+    {
+      if(chunks.empty())
+      {
+        root = Hasher::hash(nullptr, 0);
+        return;
+      }
+      std::vector<digest_type> level(chunks), next;
+      while(level.size() > 1)
+      {
+        next.clear();
+        next.reserve((level.size() + 1) / 2);
+        for(size_t n = 0; n + 1 < level.size(); n += 2)
+        {
+          byte pair[2 * sizeof(digest_type)];
+          memcpy(pair, &level[n], sizeof(digest_type));
+          memcpy(pair + sizeof(digest_type), &level[n + 1], sizeof(digest_type));
+          next.push_back(Hasher::hash(pair, sizeof(pair)));
+        }
+        if(level.size() % 2 != 0)
+        {
+          next.push_back(level.back());
+        }
+        level.swap(next);
+      }
+      root = level.front();
+    }
+    //! True if the roots of both tree hashes are equal.
+    bool root_equals(const tree_hash_result &o) const noexcept { return length == o.length && 0 == memcmp(&root, &o.root, sizeof(root)); }
+    /*! \brief Returns the indices of the chunks which differ from `o`, which must share the same
+    chunk size. Chunks present in only one of the two differ.
+    */
+    std::vector<size_t> differing_chunks(const tree_hash_result &o) const
+    {
+      std::vector<size_t> ret;
+      const size_t common = (std::min)(chunks.size(), o.chunks.size());
+      for(size_t n = 0; n < common; n++)
+      {
+        if(0 != memcmp(&chunks[n], &o.chunks[n], sizeof(digest_type)))
+        {
+          ret.push_back(n);
+        }
+      }
+      for(size_t n = common; n < (std::max)(chunks.size(), o.chunks.size()); n++)
+      {
+        ret.push_back(n);
+      }
+      return ret;
+    }
+  };
+
+  namespace detail
+  {
+    // Hashes chunks [first, last) of `h` into `out`, with each of `threads` threads reading one chunk at a time
+    template <class Hasher>
+    inline result<void> tree_hash_chunks(file_handle &h, size_t chunk_size, size_t first, size_t last, typename Hasher::digest_type *out, size_t threads) noexcept
+    {
+      try
+      {
+        if(first >= last)
+        {
+          return success();
+        }
+        threads = (std::min)(threads, last - first);
+        std::atomic<size_t> next(first);
+        std::atomic<bool> failed(false);
+        std::mutex lock;
+        result<void> failure = success();
+        auto worker = [&]() -> result<void> {
+          size_t bytes = chunk_size;
+          OUTCOME_TRY(auto &&buffer, h.allocate_registered_buffer(bytes));
+          for(size_t idx = next++; idx < last && !failed; idx = next++)
+          {
+            const auto offset = static_cast<file_handle::extent_type>(idx) * chunk_size;
+            size_t done = 0;
+            while(done < chunk_size)
+            {
+              OUTCOME_TRY(auto &&read, h.read(offset + done, {{buffer->data() + done, chunk_size - done}}));
+              if(read == 0)
+              {
+                break;
+              }
+              done += read;
+            }
+            out[idx - first] = Hasher::hash(buffer->data(), done);
+          }
+          return success();
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for(size_t n = 0; n < threads; n++)
+        {
+          workers.emplace_back([&] {
+            auto r = worker();
+            if(!r)
+            {
+              std::lock_guard<std::mutex> g(lock);
+              if(!failed.exchange(true))
+              {
+                failure = std::move(r);
+              }
+            }
+          });
+        }
+        for(auto &t : workers)
+        {
+          t.join();
+        }
+        return failure;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    inline size_t tree_hash_threads(size_t threads) noexcept { return (threads != 0) ? threads : (std::max)(1U, std::thread::hardware_concurrency()); }
+  }  // namespace detail
+
+  /*! \brief Hashes `h` in chunks of `opts.chunk_size` bytes in parallel, returning the digest of
+  each chunk and their tree hash.
+
+  Each of `opts.threads` threads reads a chunk at a time into a buffer allocated with
+  `io_handle::allocate_registered_buffer()`, and hashes it, so that many chunks are in flight.
+  All reads are page aligned, so `h` may use `caching::none`, which avoids the page cache for
+  files far larger than memory. With enough threads, hashing runs at the bandwidth of the
+  device rather than that of one CPU core.
+
+  \errors Any of the values `read()`, `maximum_extent()` and `allocate_registered_buffer()` can return.
+  */
+  template <class Hasher = fast_hash_hasher> inline result<tree_hash_result<Hasher>> tree_hash(file_handle &h, tree_hash_options opts = {}) noexcept
+  {
+    try
+    {
+      tree_hash_result<Hasher> ret;
+      ret.chunk_size = utils::round_up_to_page_size((std::max)(opts.chunk_size, (size_t) 1), utils::page_size());
+      OUTCOME_TRY(ret.length, h.maximum_extent());
+      ret.chunks.resize(static_cast<size_t>((ret.length + ret.chunk_size - 1) / ret.chunk_size));
+      OUTCOME_TRYV(detail::tree_hash_chunks<Hasher>(h, ret.chunk_size, 0, ret.chunks.size(), ret.chunks.data(), detail::tree_hash_threads(opts.threads)));
+      ret.update_root();
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  /*! \brief Updates `hash` of `h` after `bytes` bytes at `offset` have been modified, rehashing
+  only the chunks they overlap, and any chunks added or removed by a change in length.
+
+  Performing this for each extent written since `hash` was calculated is much cheaper than
+  rehashing the whole file.
+
+  \errors Any of the values `read()`, `maximum_extent()` and `allocate_registered_buffer()` can return.
+  */
+  template <class Hasher>
+  inline result<void> tree_hash_update(file_handle &h, tree_hash_result<Hasher> &hash, file_handle::extent_type offset, file_handle::extent_type bytes,
+                                       tree_hash_options opts = {}) noexcept
+  {
+    try
+    {
+      OUTCOME_TRY(auto &&length, h.maximum_extent());
+      const size_t chunk_size = hash.chunk_size;
+      const size_t newcount = static_cast<size_t>((length + chunk_size - 1) / chunk_size);
+      // The chunks modified, and those from the shorter length's last chunk onwards if the length changed
+      size_t ranges[2][2] = {{0, 0}, {0, 0}};
+      if(bytes > 0 && offset < length)
+      {
+        const auto end = (std::min)(length, offset + bytes);
+        ranges[0][0] = static_cast<size_t>(offset / chunk_size);
+        ranges[0][1] = static_cast<size_t>((end + chunk_size - 1) / chunk_size);
+      }
+      if(length != hash.length)
+      {
+        ranges[1][0] = static_cast<size_t>((std::min)(length, hash.length) / chunk_size);
+        ranges[1][1] = newcount;
+      }
+      hash.chunks.resize(newcount);
+      hash.length = length;
+      const auto threads = detail::tree_hash_threads(opts.threads);
+      if(ranges[0][0] < ranges[0][1] && ranges[1][0] < ranges[1][1] && ranges[0][1] >= ranges[1][0] && ranges[1][1] >= ranges[0][0])
+      {
+        // Overlapping, so merge them
+        ranges[0][0] = (std::min)(ranges[0][0], ranges[1][0]);
+        ranges[0][1] = (std::max)(ranges[0][1], ranges[1][1]);
+        ranges[1][0] = ranges[1][1] = 0;
+      }
+      for(auto &range : ranges)
+      {
+        OUTCOME_TRYV(detail::tree_hash_chunks<Hasher>(h, chunk_size, range[0], range[1], hash.chunks.data() + range[0], threads));
+      }
+      hash.update_root();
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
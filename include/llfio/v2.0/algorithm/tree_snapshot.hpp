@@ -0,0 +1,647 @@
+/* Compact metadata snapshots of directory trees, and their differences
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_TREE_SNAPSHOT_HPP
+#define LLFIO_ALGORITHM_TREE_SNAPSHOT_HPP
+
+#include "traverse.hpp"
+
+#include "../mapped_file_handle.hpp"
+#include "../stat.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//! \file tree_snapshot.hpp Provides compact metadata snapshots of directory trees, and the differences between them.
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // FNV-1a over the bytes of the native encoding, as `interned_path_hash()`, but continuing from `h`
+    inline uint64_t tree_snapshot_hash(uint64_t h, const void *s, size_t bytes) noexcept
+    {
+      auto *p = static_cast<const unsigned char *>(s);
+      for(size_t n = 0; n < bytes; n++)
+      {
+        h = (h ^ p[n]) * 0x100000001b3ULL;
+      }
+      return h;
+    }
+  }  // namespace detail
+
+  /*! \brief The metadata of an item in a `tree_snapshot`.
+
+  Items are identified by a 64 bit hash of their path relative to the root of the snapshot, so
+  two paths colliding in hash is possible, though in practice very unlikely.
+  */
+  struct tree_snapshot_entry
+  {
+    uint64_t path_hash{0};    //!< The hash of the path relative to the root of the snapshot.
+    uint64_t parent_hash{0};  //!< The `path_hash` of the parent directory, `tree_snapshot::root_hash` for items in the root.
+    uint64_t ino{0};          //!< The inode of the item.
+    uint64_t size{0};         //!< The maximum extent of the item.
+    int64_t mtime{0};         //!< Last modification time, in nanoseconds since the system clock's epoch.
+    int64_t ctime{0};         //!< Last status change time, in nanoseconds since the system clock's epoch.
+    uint64_t name_offset{0};  //!< The offset of the leafname within `tree_snapshot::names()`.
+    uint32_t gen{0};          //!< Generation number, or zero if the platform has none.
+    uint16_t name_length{0};  //!< The length of the leafname.
+    uint8_t type{0};          //!< The `filesystem::file_type` of the item.
+    uint8_t _reserved{0};
+
+    //! The type of the item.
+    filesystem::file_type file_type() const noexcept { return static_cast<filesystem::file_type>(type); }
+    //! True if all the metadata recorded, apart from the name, equals another.
+    bool metadata_equals(const tree_snapshot_entry &o) const noexcept
+    {
+      return ino == o.ino && size == o.size && mtime == o.mtime && ctime == o.ctime && gen == o.gen && type == o.type;
+    }
+  };
+  static_assert(sizeof(tree_snapshot_entry) == 64, "tree_snapshot_entry is not packed as expected");
+
+  //! \brief A difference between two `tree_snapshot`s found by `tree_snapshot_diff()`.
+  struct tree_snapshot_difference
+  {
+    //! The kind of difference
+    enum class kind : uint8_t
+    {
+      added,    //!< The item is only in the later snapshot.
+      removed,  //!< The item is only in the earlier snapshot.
+      modified  //!< The item is in both snapshots, with differing metadata.
+    } what{kind::added};
+    const tree_snapshot_entry *before{nullptr};  //!< The item in the earlier snapshot, null if added.
+    const tree_snapshot_entry *after{nullptr};   //!< The item in the later snapshot, null if removed.
+  };
+
+  /*! \brief A compact snapshot of the metadata of every item within and under a directory, as
+  taken by `snapshot_tree()`.
+
+  Each item is recorded as a 64 byte `tree_snapshot_entry`, ordered by its path hash, with its
+  leafname stored separately in `names()`. A snapshot of a million items therefore occupies a
+  little over 64Mb. Snapshots saved to a file with `save()` can be mapped back into memory in
+  place with `map()`, so comparing a fresh snapshot against the previous one does not require
+  reading the previous one into memory first.
+
+  A renamed or moved item appears as the removal of its old path, and the addition of its new
+  path with the same inode.
+  */
+  class tree_snapshot
+  {
+  public:
+    //! The character type of leafnames
+    using char_type = filesystem::path::value_type;
+    //! The path hash of the root of the snapshot
+    static constexpr uint64_t root_hash = 0xcbf29ce484222325ULL;
+
+    //! When the snapshot began, in nanoseconds since the system clock's epoch
+    int64_t taken{0};
+
+    std::vector<tree_snapshot_entry> _entries_storage;
+    std::vector<char_type> _names_storage;
+    mapped_file_handle _mfh;
+    span<const tree_snapshot_entry> _entries;
+    span<const char_type> _names;
+
+  private:
+    static constexpr uint64_t _magic = 0x5453505348525454ULL;  // "TTRHSPST"
+    struct _file_header_t
+    {
+      uint64_t magic;
+      uint64_t count;
+      uint64_t names_length;
+      int64_t taken;
+      uint32_t char_size;
+      uint32_t reserved[3];
+    };
+
+  public:
+    //! Returns the current time in the units of `taken` and `tree_snapshot_entry::mtime`
+    static int64_t now() noexcept { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count(); }
+    //! Returns the path hash of `leaf` within the directory whose path hash is `parent_hash`.
+    static uint64_t hash_leafname(uint64_t parent_hash, path_view leaf) noexcept
+    {
+      return visit(leaf, [parent_hash](auto sv) -> uint64_t {
+        uint64_t h = parent_hash;
+        if(h != root_hash)
+        {
+          const char_type sep = filesystem::path::preferred_separator;
+          h = detail::tree_snapshot_hash(h, &sep, sizeof(sep));
+        }
+        return detail::tree_snapshot_hash(h, sv.data(), sv.size() * sizeof(*sv.data()));
+      });
+    }
+
+    //! True if the snapshot has no items
+    bool empty() const noexcept { return _entries.empty(); }
+    //! The number of items in the snapshot
+    size_t size() const noexcept { return _entries.size(); }
+    //! The items in the snapshot, ordered by path hash
+    span<const tree_snapshot_entry> entries() const noexcept { return _entries; }
+    //! The leafnames of the items in the snapshot, which are not zero terminated
+    span<const char_type> names() const noexcept { return _names; }
+
+    //! Returns the item with path hash `path_hash`, or null if there is none.
+    const tree_snapshot_entry *find(uint64_t path_hash) const noexcept
+    {
+      auto it = std::lower_bound(_entries.begin(), _entries.end(), path_hash, [](const tree_snapshot_entry &e, uint64_t h) { return e.path_hash < h; });
+      return (it != _entries.end() && it->path_hash == path_hash) ? &*it : nullptr;
+    }
+    //! Returns the leafname of an item.
+    filesystem::path leafname(const tree_snapshot_entry &e) const
+    {
+      if(e.name_offset + e.name_length > _names.size())
+      {
+        return {};
+      }
+      return filesystem::path::string_type(_names.data() + e.name_offset, e.name_length);
+    }
+    /*! \brief Returns the path of an item relative to the root of the snapshot, by looking up
+    each of its parent directories. Empty if any parent is missing from the snapshot.
+    */
+    filesystem::path path(const tree_snapshot_entry &e) const
+    {
+      std::vector<const tree_snapshot_entry *> chain{&e};
+      while(chain.back()->parent_hash != root_hash)
+      {
+        const auto *parent = find(chain.back()->parent_hash);
+        if(parent == nullptr || chain.size() > 65536)
+        {
+          return {};
+        }
+        chain.push_back(parent);
+      }
+      filesystem::path ret;
+      for(auto it = chain.rbegin(); it != chain.rend(); ++it)
+      {
+        ret /= leafname(**it);
+      }
+      return ret;
+    }
+
+    //! Orders the items built into storage by path hash, and views them.
+    void _finalise()
+    {
+      std::sort(_entries_storage.begin(), _entries_storage.end(), [](const tree_snapshot_entry &a, const tree_snapshot_entry &b) { return a.path_hash < b.path_hash; });
+      _entries = {_entries_storage.data(), _entries_storage.size()};
+      _names = {_names_storage.data(), _names_storage.size()};
+    }
+
+    /*! \brief Replaces the contents of `fh` with this snapshot.
+
+    The format is native endian, and so not portable between platforms.
+    */
+    result<void> save(file_handle &fh) const noexcept
+    {
+      _file_header_t header{_magic, _entries.size(), _names.size(), taken, sizeof(char_type), {0, 0, 0}};
+      OUTCOME_TRYV(fh.truncate(0));
+      OUTCOME_TRYV(fh.write(0, {{reinterpret_cast<const byte *>(&header), sizeof(header)},
+                                {reinterpret_cast<const byte *>(_entries.data()), _entries.size() * sizeof(tree_snapshot_entry)},
+                                {reinterpret_cast<const byte *>(_names.data()), _names.size() * sizeof(char_type)}}));
+      return success();
+    }
+    /*! \brief Maps a snapshot previously saved to `path` relative to `base` into memory, viewing
+    its items in place. An empty file maps an empty snapshot.
+
+    \errors `errc::illegal_byte_sequence` if the file does not contain a snapshot, else any of the
+    values `mapped_file_handle::mapped_file()` can return.
+    */
+    static result<tree_snapshot> map(const path_handle &base, mapped_file_handle::path_view_type path) noexcept
+    {
+      try
+      {
+        result<tree_snapshot> ret(in_place_type<tree_snapshot>);
+        auto &s = ret.assume_value();
+        OUTCOME_TRY(s._mfh, mapped_file_handle::mapped_file(base, path, mapped_file_handle::mode::read, mapped_file_handle::creation::open_existing));
+        OUTCOME_TRY(auto &&length, s._mfh.maximum_extent());
+        if(length == 0)
+        {
+          return ret;
+        }
+        _file_header_t header{};
+        if(length < sizeof(header))
+        {
+          return errc::illegal_byte_sequence;
+        }
+        memcpy(&header, s._mfh.address(), sizeof(header));
+        if(header.magic != _magic || header.char_size != sizeof(char_type) ||
+           length != sizeof(header) + header.count * sizeof(tree_snapshot_entry) + header.names_length * sizeof(char_type))
+        {
+          return errc::illegal_byte_sequence;
+        }
+        s.taken = header.taken;
+        const byte *entries = s._mfh.address() + sizeof(header);
+        s._entries = {reinterpret_cast<const tree_snapshot_entry *>(entries), static_cast<size_t>(header.count)};
+        s._names = {reinterpret_cast<const char_type *>(entries + header.count * sizeof(tree_snapshot_entry)), static_cast<size_t>(header.names_length)};
+        return ret;
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+  };
+
+  //! The state of a `snapshot_tree()`, which is the `data` passed to `traverse()`.
+  struct tree_snapshot_state
+  {
+    struct _key_type
+    {
+      uint64_t dev{0}, ino{0};
+      constexpr bool operator==(const _key_type &o) const noexcept { return dev == o.dev && ino == o.ino; }
+    };
+    struct _key_hasher
+    {
+      size_t operator()(const _key_type &k) const noexcept
+      {
+        auto x = k.ino ^ (k.dev * 0x9e3779b97f4a7c15ULL);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return (size_t) x;
+      }
+    };
+    // What each kernel thread accumulates into during traversal, merged in by `tree_snapshot_visitor::finished()`
+    struct _partial_snapshot
+    {
+      std::vector<tree_snapshot_entry> entries;
+      std::vector<tree_snapshot::char_type> names;
+      std::vector<stat_t::fill_many_item> items;
+      std::vector<std::pair<_key_type, uint64_t>> directories;
+    };
+    static uint64_t _next_id() noexcept
+    {
+      static std::atomic<uint64_t> count(0);
+      return ++count;
+    }
+
+    tree_snapshot *snapshot{nullptr};  //!< The snapshot being built
+    void *data{nullptr};               //!< The third party data pointer passed to `snapshot_tree()`
+    filesystem::path root_path;        //!< The path of the root of the snapshot when it began
+    uint64_t _id{_next_id()};
+    spinlock _lock;
+    std::unordered_map<_key_type, uint64_t, _key_hasher> _directories;  // the path hash of each directory seen
+    std::vector<std::unique_ptr<_partial_snapshot>> _partials;
+
+    //! Returns the partial snapshot for the calling kernel thread
+    _partial_snapshot &_thread_partial()
+    {
+      struct cache_t
+      {
+        uint64_t id{0};
+        _partial_snapshot *partial{nullptr};
+      };
+      static thread_local cache_t cache;
+      if(cache.id != _id)
+      {
+        std::unique_ptr<_partial_snapshot> p(new _partial_snapshot);
+        lock_guard<spinlock> g(_lock);
+        _partials.push_back(std::move(p));
+        cache.partial = _partials.back().get();
+        cache.id = _id;
+      }
+      return *cache.partial;
+    }
+    //! Merges all the per thread partial snapshots into the snapshot
+    void _merge_partials()
+    {
+      lock_guard<spinlock> g(_lock);
+      size_t entries = 0, names = 0;
+      for(auto &p : _partials)
+      {
+        entries += p->entries.size();
+        names += p->names.size();
+      }
+      auto &s = *snapshot;
+      s._entries_storage.reserve(s._entries_storage.size() + entries);
+      s._names_storage.reserve(s._names_storage.size() + names);
+      for(auto &p : _partials)
+      {
+        const uint64_t base = s._names_storage.size();
+        for(auto &e : p->entries)
+        {
+          s._entries_storage.push_back(e);
+          s._entries_storage.back().name_offset += base;
+        }
+        s._names_storage.insert(s._names_storage.end(), p->names.begin(), p->names.end());
+      }
+      _partials.clear();
+      // Threads still caching pointers to the partials just freed must not match
+      _id = _next_id();
+      s._finalise();
+    }
+  };
+
+  /*! \brief A visitor for the tree snapshot algorithm.
+
+  Note that at any time, returning a failure causes `snapshot_tree()` to exit as soon
+  as possible with the same failure.
+
+  You can override the members here inherited from `traverse_visitor`, however note
+  that `snapshot_tree()` is entirely implemented using `traverse()`, so not calling the
+  implementations here will affect operation. The `data` pointer passed to the members
+  inherited from `traverse_visitor` is the `tree_snapshot_state`.
+  */
+  struct tree_snapshot_visitor : public traverse_visitor
+  {
+    //! The metadata recorded for each item
+    static constexpr stat_t::want metadata() { return stat_t::want::ino | stat_t::want::type | stat_t::want::size | stat_t::want::mtim | stat_t::want::ctim | stat_t::want::gen; }
+
+    /*! \brief Called for each item enumerated, to decide whether to record it. Directories not
+    recorded are not traversed into.
+
+    `data` is the third party data pointer passed to `snapshot_tree()`. The default records
+    every item.
+
+    \note May be called from multiple kernel threads concurrently.
+    */
+    virtual bool include(void *data, const directory_handle &dirh, const directory_entry &entry, size_t depth) noexcept
+    {
+      (void) data;
+      (void) dirh;
+      (void) entry;
+      (void) depth;
+      return true;
+    }
+
+    //! This override records each item of the directory into a partial snapshot per kernel thread.
+    virtual result<void> post_enumeration(void *data, const directory_handle &dirh, directory_handle::buffers_type &contents, size_t depth) noexcept override
+    {
+      try
+      {
+        auto *state = (tree_snapshot_state *) data;
+        auto &acc = state->_thread_partial();
+        stat_t s(nullptr);
+        OUTCOME_TRY(s.fill(dirh, stat_t::want::dev | stat_t::want::ino));
+        uint64_t dirhash = 0;
+        bool found = false;
+        {
+          lock_guard<spinlock> g(state->_lock);
+          auto it = state->_directories.find({s.st_dev, s.st_ino});
+          if(it != state->_directories.end())
+          {
+            dirhash = it->second;
+            found = true;
+          }
+        }
+        if(!found)
+        {
+          // A mount point, whose inode differs from that enumerated in its parent, so hash its path instead
+          OUTCOME_TRY(auto &&path, dirh.current_path());
+          const auto &native = path.native();
+          const auto &root = state->root_path.native();
+          const size_t skip = root.size() + ((!root.empty() && root.back() == filesystem::path::preferred_separator) ? 0 : 1);
+          if(native.size() <= skip || 0 != native.compare(0, root.size(), root))
+          {
+            return errc::no_such_file_or_directory;  // renamed out of the tree during the snapshot
+          }
+          dirhash = detail::tree_snapshot_hash(tree_snapshot::root_hash, native.data() + skip, (native.size() - skip) * sizeof(tree_snapshot::char_type));
+        }
+        // Directory enumeration on Windows supplies everything but the generation number, which it
+        // does not have, so only fetch metadata if anything else is missing
+        if(((contents.metadata() | stat_t::want::gen) & metadata()) != metadata())
+        {
+          acc.items.clear();
+          acc.items.reserve(contents.size());
+          for(auto &entry : contents)
+          {
+            acc.items.emplace_back(entry.leafname, metadata());
+          }
+          OUTCOME_TRYV(stat_t::fill_many(dirh, {acc.items.data(), acc.items.size()}));
+          for(size_t n = 0; n < contents.size(); n++)
+          {
+            // Items which vanished since enumeration are not recorded
+            contents[n].stat = acc.items[n].filled ? acc.items[n].stat : stat_t(nullptr);
+          }
+        }
+        acc.directories.clear();
+        for(auto &entry : contents)
+        {
+          if(entry.stat.st_type == filesystem::file_type::unknown)
+          {
+            continue;
+          }
+          if(!include(state->data, dirh, entry, depth))
+          {
+            entry.stat = stat_t(nullptr);
+            continue;
+          }
+          tree_snapshot_entry e;
+          e.path_hash = tree_snapshot::hash_leafname(dirhash, entry.leafname);
+          e.parent_hash = dirhash;
+          e.ino = entry.stat.st_ino;
+          e.size = entry.stat.st_size;
+          e.mtime = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.stat.st_mtim.time_since_epoch()).count();
+          e.ctime = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.stat.st_ctim.time_since_epoch()).count();
+          e.gen = entry.stat.st_gen;
+          e.type = static_cast<uint8_t>(entry.stat.st_type);
+          e.name_offset = acc.names.size();
+          visit(entry.leafname, [&](auto sv) {
+            // Enumerated leafnames are always in the native encoding
+            auto *p = reinterpret_cast<const tree_snapshot::char_type *>(sv.data());
+            const size_t length = sv.size() * sizeof(*sv.data()) / sizeof(tree_snapshot::char_type);
+            acc.names.insert(acc.names.end(), p, p + length);
+            e.name_length = static_cast<uint16_t>(length);
+          });
+          acc.entries.push_back(e);
+          if(entry.stat.st_type == filesystem::file_type::directory)
+          {
+            acc.directories.push_back({{s.st_dev, e.ino}, e.path_hash});
+          }
+        }
+        if(!acc.directories.empty())
+        {
+          lock_guard<spinlock> g(state->_lock);
+          for(auto &i : acc.directories)
+          {
+            state->_directories[i.first] = i.second;
+          }
+        }
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+    //! This override merges the per kernel thread partial snapshots into the snapshot
+    virtual result<size_t> finished(void *data, result<size_t> result) noexcept override
+    {
+      try
+      {
+        ((tree_snapshot_state *) data)->_merge_partials();
+      }
+      catch(...)
+      {
+        if(result)
+        {
+          return error_from_exception();
+        }
+      }
+      return result;
+    }
+  };
+
+  /*! \brief Snapshot the metadata of everything within and under `dirh`, for comparison against
+  a later snapshot with `tree_snapshot_diff()`.
+
+  Each item's inode, maximum extent, modification and status change times, type and, where the
+  platform has one, generation number are recorded, which is no more than `directory_handle::read()`
+  returns on Windows, or a `statx()` per item on Linux, batched by `stat_t::fill_many()`. No item's
+  contents are ever read, so a sync agent comparing file trees is limited by the speed of metadata
+  enumeration. As status change time changes upon any write or change of metadata, items whose
+  recorded metadata is unchanged can be assumed to have unchanged contents.
+
+  This is a trivial implementation on top of `algorithm::traverse()`, indeed it is implemented
+  entirely as header code. You should review the documentation for `algorithm::traverse()`, as
+  this algorithm is entirely implemented using that algorithm. It costs one `fstat()` per directory
+  more than a plain traversal.
+
+  \errors Any of the values `traverse()` and `stat_t::fill_many()` can return.
+  */
+  inline result<tree_snapshot> snapshot_tree(const path_handle &dirh, tree_snapshot_visitor *visitor = nullptr, size_t threads = 0, void *data = nullptr,
+                                             bool force_slow_path = false) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(&dirh);
+    tree_snapshot_visitor default_visitor;
+    if(visitor == nullptr)
+    {
+      visitor = &default_visitor;
+    }
+    try
+    {
+      result<tree_snapshot> ret(in_place_type<tree_snapshot>);
+      tree_snapshot_state state;
+      state.snapshot = &ret.assume_value();
+      state.data = data;
+      ret.assume_value().taken = tree_snapshot::now();
+      stat_t s(nullptr);
+      OUTCOME_TRY(s.fill(dirh, stat_t::want::dev | stat_t::want::ino));
+      state._directories[{s.st_dev, s.st_ino}] = tree_snapshot::root_hash;
+      OUTCOME_TRY(state.root_path, dirh.current_path());
+      OUTCOME_TRYV(traverse(dirh, visitor, threads, &state, force_slow_path));
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  /*! \brief Returns the items added, removed and modified between `before` and `after`, ordered
+  by path hash.
+
+  As both snapshots are ordered by path hash, the range of hashes is split between `threads`
+  threads, each merging its own portion of both snapshots. Zero means the number of hardware
+  threads. Small snapshots are compared by the calling thread alone.
+
+  The differences refer to entries in both snapshots, so both must outlive the differences.
+  */
+  inline result<std::vector<tree_snapshot_difference>> tree_snapshot_diff(const tree_snapshot &before, const tree_snapshot &after, size_t threads = 0) noexcept
+  {
+    try
+    {
+      using kind = tree_snapshot_difference::kind;
+      auto a = before.entries(), b = after.entries();
+      auto merge = [](const tree_snapshot_entry *ia, const tree_snapshot_entry *ea, const tree_snapshot_entry *ib, const tree_snapshot_entry *eb,
+                      std::vector<tree_snapshot_difference> &out) {
+        while(ia != ea || ib != eb)
+        {
+          if(ib == eb || (ia != ea && ia->path_hash < ib->path_hash))
+          {
+            out.push_back({kind::removed, ia++, nullptr});
+          }
+          else if(ia == ea || ib->path_hash < ia->path_hash)
+          {
+            out.push_back({kind::added, nullptr, ib++});
+          }
+          else
+          {
+            if(!ia->metadata_equals(*ib))
+            {
+              out.push_back({kind::modified, ia, ib});
+            }
+            ++ia;
+            ++ib;
+          }
+        }
+      };
+      std::vector<tree_snapshot_difference> ret;
+      if(threads == 0)
+      {
+        threads = (std::max)(1U, std::thread::hardware_concurrency());
+      }
+      if(threads == 1 || a.size() + b.size() < 65536)
+      {
+        merge(a.data(), a.data() + a.size(), b.data(), b.data() + b.size(), ret);
+        return ret;
+      }
+      // Path hashes are evenly distributed, so split the range of hashes evenly
+      auto split = [](span<const tree_snapshot_entry> s, uint64_t h) {
+        return std::lower_bound(s.data(), s.data() + s.size(), h, [](const tree_snapshot_entry &e, uint64_t v) { return e.path_hash < v; });
+      };
+      std::vector<std::vector<tree_snapshot_difference>> outs(threads);
+      std::vector<std::thread> workers;
+      workers.reserve(threads);
+      const uint64_t step = ~uint64_t(0) / threads;
+      for(size_t n = 0; n < threads; n++)
+      {
+        const auto *ia = split(a, n * step), *ib = split(b, n * step);
+        const auto *ea = (n + 1 == threads) ? a.data() + a.size() : split(a, (n + 1) * step);
+        const auto *eb = (n + 1 == threads) ? b.data() + b.size() : split(b, (n + 1) * step);
+        workers.emplace_back([&, n, ia, ea, ib, eb] { merge(ia, ea, ib, eb, outs[n]); });
+      }
+      for(auto &t : workers)
+      {
+        t.join();
+      }
+      size_t total = 0;
+      for(auto &o : outs)
+      {
+        total += o.size();
+      }
+      ret.reserve(total);
+      for(auto &o : outs)
+      {
+        ret.insert(ret.end(), o.begin(), o.end());
+      }
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
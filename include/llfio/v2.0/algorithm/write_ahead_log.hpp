@@ -0,0 +1,204 @@
+/* A write ahead log with group commit and preallocated segments
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_ALGORITHM_WRITE_AHEAD_LOG_HPP
+#define LLFIO_ALGORITHM_WRITE_AHEAD_LOG_HPP
+
+#include "../directory_handle.hpp"
+#include "../file_handle.hpp"
+#include "../utils.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//! \file write_ahead_log.hpp Provides a write ahead log with group commit.
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+namespace algorithm
+{
+  /*! \class write_ahead_log
+  \brief A durable append only log of records, kept in a directory of preallocated segment files.
+
+  `append()` returns once its record has reached storage. Appenders arriving whilst a write is
+  in progress have their records gathered into the next write, so many concurrent appenders share
+  each write and flush rather than paying for one each. Each record is framed with its length,
+  its log sequence number, and a CRC32C of both and its content. The appender computes the checksum
+  before taking the lock, so the lock is held only to copy the framed record into the next write.
+
+  Segments are opened with `caching::none` where the filing system permits it, and written with
+  `write_flag::data_sync`, which on Linux is `pwritev2(RWF_DSYNC)` and often becomes a single
+  FUA write to the device, rather than a write followed by a flush. Each write is padded to a
+  4Kb boundary so no write ever rewrites a block holding a record already durable, which a power
+  loss could tear. New segments are allocated to their full size using `file_handle::allocate()`.
+  `checkpoint()` retires segments holding only records no longer needed, keeping up to
+  `max_free_segments` of them to be renamed and reused in place of allocating new ones.
+
+  `open()` recovers by scanning the segments forwards from the oldest, calling a callback for
+  each valid record in order, and stopping at the first record which does not validate. Appending
+  then begins a new segment. Log sequence numbers increase monotonically, but are not contiguous
+  across a reopen, as the first after a reopen is chosen to exceed any which could remain in
+  a recycled segment.
+
+  All member functions are threadsafe.
+  */
+  class LLFIO_DECL write_ahead_log
+  {
+  public:
+    //! The log sequence number type
+    using lsn_type = uint64_t;
+    //! The file extent type
+    using extent_type = file_handle::extent_type;
+    //! The callback for each record recovered by `open()`
+    using recovery_callback = function_ptr<result<void>(lsn_type lsn, span<const byte> record)>;
+
+  private:
+    struct _segment_type
+    {
+      uint64_t seq;
+      lsn_type first_lsn;
+    };
+    using _buffer_type = std::vector<byte, utils::page_allocator<byte>>;
+    static constexpr extent_type _block_size = 4096;
+
+    directory_handle _dirh;
+    extent_type _segment_size{0};
+    size_t _max_free_segments{0};
+    bool _direct{true};
+
+    // Protected by _lock
+    mutable std::mutex _lock;
+    std::condition_variable _cv;
+    _buffer_type _pending;
+    lsn_type _next_lsn{1}, _durable_lsn{0};
+    bool _writing{false};
+    optional<result<void>::error_type> _failure;
+
+    // Protected by _segments_lock, which the appender writing holds
+    std::mutex _segments_lock;
+    _buffer_type _batch;
+    file_handle _current;
+    extent_type _current_offset{0};
+    uint64_t _next_seq{0};
+    std::deque<_segment_type> _live;
+    std::vector<uint64_t> _free;
+
+    struct _private_tag
+    {
+    };
+
+    static size_t _frame_size(size_t length) noexcept { return 16 + ((length + 7) & ~static_cast<size_t>(7)); }
+    static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC std::string _leafname(uint64_t seq, bool free);
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _sync_directory() noexcept;
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<file_handle> _open_segment(uint64_t seq, bool free, file_handle::creation creation) noexcept;
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _retire(file_handle &fh, uint64_t seq) noexcept;
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _begin_segment(lsn_type first_lsn) noexcept;
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _write_batch() noexcept;
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _recover(recovery_callback &callback) noexcept;
+
+  public:
+    //! Use `open()` instead.
+    write_ahead_log(_private_tag /*unused*/, directory_handle &&dirh, extent_type segment_size, size_t max_free_segments)
+        : _dirh(std::move(dirh))
+        , _segment_size(segment_size)
+        , _max_free_segments(max_free_segments)
+    {
+    }
+    write_ahead_log(const write_ahead_log &) = delete;
+    write_ahead_log(write_ahead_log &&) = delete;
+    write_ahead_log &operator=(const write_ahead_log &) = delete;
+    write_ahead_log &operator=(write_ahead_log &&) = delete;
+    ~write_ahead_log() = default;
+
+    /*! \brief Opens the log in the directory `path` relative to `base`, creating it if needed, and
+    recovers the records within it.
+
+    \param base The base to lookup `path` within.
+    \param path The directory holding the segments.
+    \param callback If set, called with each valid record, in order. Returning a failure stops
+    the recovery, and `open()` returns that failure.
+    \param segment_size The size of new segments, which is rounded up to a multiple of 4Kb. A log
+    whose segments already exist keeps the size they have.
+    \param max_free_segments The most retired segments to keep for reuse.
+
+    \errors Any of the values `directory_handle::directory()`, `file_handle::file()`, `read()`
+    and `write()` can return, or `errc::illegal_byte_sequence` if a segment is not of this log.
+    */
+    static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::unique_ptr<write_ahead_log>> open(const path_handle &base, path_view path, recovery_callback callback = {},
+                                                                                        extent_type segment_size = 64 * 1024 * 1024,
+                                                                                        size_t max_free_segments = 4) noexcept;
+
+    //! The size of each segment.
+    extent_type segment_size() const noexcept { return _segment_size; }
+    //! The largest record which can be appended.
+    size_t max_record_size() const noexcept
+    {
+      const auto ret = static_cast<size_t>(_segment_size - _block_size - 16);
+      return (ret > 0xffffffffU) ? 0xffffffffU : ret;
+    }
+    //! The log sequence number of the last record to have reached storage.
+    lsn_type durable_lsn() const noexcept
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      return _durable_lsn;
+    }
+
+    /*! \brief Appends a record, returning its log sequence number once it has reached storage.
+
+    \errors `errc::value_too_large` if the record exceeds `max_record_size()`. Any of the values
+    `write()` can return, after which every append fails with the same failure.
+    */
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<lsn_type> append(span<const byte> record) noexcept;
+
+    /*! \brief Declares the records before `lsn` to be no longer needed, retiring the segments
+    holding only those. The current segment is never retired.
+
+    \errors Any of the values `relink()` and `unlink()` can return.
+    */
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> checkpoint(lsn_type lsn) noexcept;
+  };
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#include "../detail/impl/write_ahead_log.ipp"
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#endif
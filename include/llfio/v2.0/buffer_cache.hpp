@@ -0,0 +1,396 @@
+/* A user space page cache for handles bypassing the kernel page cache
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_BUFFER_CACHE_HPP
+#define LLFIO_BUFFER_CACHE_HPP
+
+#include "registered_buffer_pool.hpp"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//! \file buffer_cache.hpp Provides a user space page cache for handles bypassing the kernel page cache
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+/*! \class buffer_cache
+\brief A fixed size cache of pages of handles, held in registered buffers, for handles opened
+with `caching::none` which bypass the kernel page cache.
+
+Pages are the size set on creation, and are held in buffers from a `registered_buffer_pool`
+registered with the i/o multiplexer of the handle the cache was created with, so i/o upon
+pages of handles using that multiplexer need neither copying nor registering each time. The
+pool is allocated as a whole, so if its size is a multiple of a larger page size of
+`utils::page_sizes()` it is allocated with large pages, which avoids TLB misses. The number of
+pages is rounded up to achieve this where the pool would exceed one large page.
+
+`pin()` pins a page into the cache, reading it upon a miss, and `pin_async()` does the same,
+but upon a miss initiates the read through the multiplexer, and calls its completion from
+`poll()` once the read completes. Pins of a page being read each receive the page once it
+completes. Pages referenced by a `pinned_page` are never evicted. Writing to a page and
+calling `pinned_page::mark_dirty()` causes it to be written back by `flush()`, or when evicted.
+`flush()` initiates all the write backs at once through the multiplexer, and then issues
+a barrier of the kind requested to each handle.
+
+Eviction is 2Q: pages referenced once enter a FIFO queue of a quarter of the cache, and are
+evicted from it first, with their identity remembered in a ghost queue of half the size of the
+cache. Pages referenced again whilst cached, or referenced again after eviction whilst still
+remembered, enter an LRU queue for the remainder of the cache. Scans of many pages referenced
+once therefore never evict the pages which are repeatedly referenced.
+
+Pages are keyed by the address of their handle and their offset, so a handle must be detached
+using `detach()` before it is closed, moved or destroyed.
+
+This class is not threadsafe. As with the multiplexer it uses, use an instance per thread, or
+serialise access to it.
+*/
+class LLFIO_DECL buffer_cache
+{
+public:
+  using extent_type = io_handle::extent_type;
+  using barrier_kind = io_handle::barrier_kind;
+  using registered_buffer_type = io_handle::registered_buffer_type;
+  class pinned_page;
+  //! The callback for `pin_async()`
+  using completion_type = function_ptr<void(result<pinned_page> &&)>;
+
+  //! Statistics about the use of the cache
+  struct statistics
+  {
+    uint64_t hits{0};          //!< Pins which found the page cached.
+    uint64_t misses{0};        //!< Pins which needed to read the page.
+    uint64_t ghost_hits{0};    //!< Misses of pages remembered as recently evicted.
+    uint64_t evictions{0};     //!< Pages evicted to make room for others.
+    uint64_t write_backs{0};   //!< Dirty pages written back.
+  };
+
+private:
+  struct _key_type
+  {
+    const io_handle *h;
+    extent_type page;
+    bool operator==(const _key_type &o) const noexcept { return h == o.h && page == o.page; }
+  };
+  struct _key_hash
+  {
+    size_t operator()(const _key_type &k) const noexcept { return std::hash<const void *>()(k.h) ^ std::hash<extent_type>()(k.page * 0x9e3779b97f4a7c15ULL); }
+  };
+  enum class _state_type : uint8_t
+  {
+    free,
+    loading,
+    clean,
+    dirty,
+    writing
+  };
+  enum class _queue_type : uint8_t
+  {
+    none,
+    a1in,
+    am
+  };
+  struct _frame_type final : public io_multiplexer::io_operation_state_visitor
+  {
+    buffer_cache *parent{nullptr};
+    size_t index{0};
+    io_handle *h{nullptr};
+    extent_type page{0};
+    registered_buffer_type buffer;
+    size_t length{0}, pins{0};
+    _state_type state{_state_type::free};
+    _queue_type queue{_queue_type::none};
+    std::list<size_t>::iterator queue_it;
+    std::vector<completion_type> waiters;
+
+    // The i/o in flight through the multiplexer, which is finished once `finished` is set
+    span<byte> io_state_storage;
+    io_multiplexer::io_operation_state *io_state{nullptr};
+    io_multiplexer::buffer_type rbuffer;
+    io_multiplexer::const_buffer_type wbuffer;
+    result<size_t> transferred{0};
+    bool finished{false};
+
+    _frame_type() = default;
+    _frame_type(const _frame_type &) = delete;
+    _frame_type(_frame_type &&) = delete;
+    _frame_type &operator=(const _frame_type &) = delete;
+    _frame_type &operator=(_frame_type &&) = delete;
+    ~_frame_type()
+    {
+      reset();
+      if(!io_state_storage.empty())
+      {
+        parent->_multiplexer->deallocate_io_operation_state_storage(io_state_storage);
+      }
+    }
+    void reset() noexcept
+    {
+      if(io_state != nullptr)
+      {
+        io_state->~io_operation_state();
+        io_state = nullptr;
+      }
+    }
+    template <class T> void completed(T &&res) noexcept
+    {
+      if(!res)
+      {
+        transferred = std::move(res).error();
+        return;
+      }
+      size_t bytes = 0;
+      for(auto &b : res.value())
+      {
+        bytes += b.size();
+      }
+      transferred = bytes;
+    }
+    virtual bool read_completed(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/, io_multiplexer::io_result<io_multiplexer::buffers_type> &&res) override
+    {
+      completed(std::move(res));
+      return true;
+    }
+    virtual bool write_completed(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/, io_multiplexer::io_result<io_multiplexer::const_buffers_type> &&res) override
+    {
+      completed(std::move(res));
+      return true;
+    }
+    virtual void read_finished(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/) override { finished = true; }
+    virtual void write_or_barrier_finished(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/) override { finished = true; }
+  };
+
+  io_multiplexer *_multiplexer{nullptr};
+  std::shared_ptr<registered_buffer_pool> _pool;
+  size_t _page_size{0}, _count{0}, _a1in_max{0}, _a1out_max{0};
+  std::unique_ptr<_frame_type[]> _frames;
+  std::unordered_map<_key_type, size_t, _key_hash> _table;
+  std::vector<size_t> _free, _inflight;
+  // Every frame has one node, which splices between the lists without allocating
+  std::list<size_t> _idle, _a1in, _am;
+  std::list<_key_type> _a1out;
+  std::unordered_map<_key_type, std::list<_key_type>::iterator, _key_hash> _a1out_table;
+  statistics _stats;
+
+  struct _private_tag
+  {
+  };
+
+  bool _async(const io_handle &h) const noexcept { return _multiplexer != nullptr && h.multiplexer() == _multiplexer; }
+  std::list<size_t> &_list(_queue_type queue) noexcept { return (queue == _queue_type::a1in) ? _a1in : ((queue == _queue_type::am) ? _am : _idle); }
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _enqueue(_frame_type &f, _queue_type queue) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _dequeue(_frame_type &f) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _release(_frame_type &f) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> _reclaim() noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> _insert(io_handle &h, extent_type page) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _promote(_frame_type &f) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _loaded(_frame_type &f, size_t bytes) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _begin_io(_frame_type &f, bool write) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _write_back(_frame_type &f, deadline d) noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _reap() noexcept;
+
+public:
+  /*! \class pinned_page
+  \brief A reference to a page pinned into a `buffer_cache`, which unpins it upon destruction.
+  */
+  class pinned_page
+  {
+    friend class buffer_cache;
+    _frame_type *_frame{nullptr};
+
+    explicit pinned_page(_frame_type *frame) noexcept
+        : _frame(frame)
+    {
+      ++_frame->pins;
+    }
+
+  public:
+    //! Default constructor
+    pinned_page() = default;
+    pinned_page(const pinned_page &) = delete;
+    //! Move constructor
+    pinned_page(pinned_page &&o) noexcept
+        : _frame(o._frame)
+    {
+      o._frame = nullptr;
+    }
+    pinned_page &operator=(const pinned_page &) = delete;
+    //! Move assignment
+    pinned_page &operator=(pinned_page &&o) noexcept
+    {
+      if(this != &o)
+      {
+        unpin();
+        _frame = o._frame;
+        o._frame = nullptr;
+      }
+      return *this;
+    }
+    ~pinned_page() { unpin(); }
+
+    //! True if a page is pinned
+    explicit operator bool() const noexcept { return _frame != nullptr; }
+    //! The offset of the page within its handle
+    extent_type offset() const noexcept { return _frame->page * _frame->parent->_page_size; }
+    //! The whole of the page. Bytes beyond `length()` are zero.
+    span<byte> data() const noexcept { return {_frame->buffer->data(), _frame->parent->_page_size}; }
+    //! The bytes of the page which are valid, which is less than the page size at the end of its handle.
+    size_t length() const noexcept { return _frame->length; }
+    //! True if the page has been modified since it was last written back.
+    bool dirty() const noexcept { return _frame->state == _state_type::dirty; }
+    /*! \brief Marks the page as needing writing back, extending the valid bytes to `length`
+    if greater.
+
+    The valid bytes are those written back. With `caching::none` these must be a multiple of
+    the device's block size, so a page at the end of a handle must be extended to a block.
+    */
+    void mark_dirty(size_t length = 0) noexcept
+    {
+      if(length > _frame->length)
+      {
+        _frame->length = (length > _frame->parent->_page_size) ? _frame->parent->_page_size : length;
+      }
+      _frame->state = _state_type::dirty;
+    }
+    //! Unpins the page, after which it may be evicted.
+    void unpin() noexcept
+    {
+      if(_frame != nullptr)
+      {
+        --_frame->pins;
+        _frame = nullptr;
+      }
+    }
+  };
+
+  //! Use `create()` instead.
+  buffer_cache(_private_tag /*unused*/, io_multiplexer *multiplexer, std::shared_ptr<registered_buffer_pool> pool)
+      : _multiplexer(multiplexer)
+      , _pool(std::move(pool))
+      , _page_size(_pool->buffer_size())
+      , _count(_pool->size())
+      , _a1in_max((std::max)(_count / 4, (size_t) 1))
+      , _a1out_max((std::max)(_count / 2, (size_t) 1))
+      , _frames(new _frame_type[_count])
+  {
+    _table.reserve(_count);
+    _a1out_table.reserve(_a1out_max + 1);
+    _free.reserve(_count);
+    _inflight.reserve(_count);
+    for(size_t n = _count; n > 0; n--)
+    {
+      _frames[n - 1].parent = this;
+      _frames[n - 1].index = n - 1;
+      _frames[n - 1].queue_it = _idle.insert(_idle.end(), n - 1);
+      _free.push_back(n - 1);
+    }
+  }
+  buffer_cache(const buffer_cache &) = delete;
+  buffer_cache(buffer_cache &&) = delete;
+  buffer_cache &operator=(const buffer_cache &) = delete;
+  buffer_cache &operator=(buffer_cache &&) = delete;
+  //! Destroying the cache whilst any page is pinned or any i/o is in flight is undefined behaviour. Dirty pages are not written back.
+  ~buffer_cache() = default;
+
+  /*! \brief Creates a cache of `pages` pages of `page_size` bytes, held in buffers registered
+  with the multiplexer of `h` if it has one.
+
+  `page_size` is rounded up to the system page size.
+
+  \errors Any of the values `registered_buffer_pool::create()` can return.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::unique_ptr<buffer_cache>> create(io_handle &h, size_t page_size, size_t pages) noexcept;
+
+  //! The size of each page.
+  size_t page_size() const noexcept { return _page_size; }
+  //! The number of pages in the cache.
+  size_t size() const noexcept { return _count; }
+  //! The statistics about the use of the cache.
+  const statistics &stats() const noexcept { return _stats; }
+  //! The pool holding the pages.
+  const registered_buffer_pool &pool() const noexcept { return *_pool; }
+
+  /*! \brief Pins the page of `h` holding `offset`, reading it if not cached.
+
+  \errors `errc::no_buffer_space` if every page is pinned or has i/o in flight. Any of the
+  values `read()` and `write()` can return.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<pinned_page> pin(io_handle &h, extent_type offset, deadline d = {}) noexcept;
+
+  /*! \brief Pins the page of `h` holding `offset`, calling `completion` with it immediately if
+  cached, else from `poll()` once read.
+
+  The completion is called with a failure if the read fails. If `h` does not use the
+  multiplexer of the cache, the completion is called immediately with the result of `pin()`.
+
+  \errors `errc::no_buffer_space` if every page is pinned or has i/o in flight. Any of the
+  values the multiplexer can return upon initiating i/o.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> pin_async(io_handle &h, extent_type offset, completion_type completion) noexcept;
+
+  /*! \brief Completes any i/o finished by the multiplexer, waiting until `d` for some if none
+  has finished, and calls the completions of the pages read.
+
+  \errors Any of the values `io_multiplexer::check_for_any_completed_io()` can return.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> poll(deadline d = std::chrono::seconds(0)) noexcept;
+
+  /*! \brief Writes back the dirty pages of `h`, or of every handle if null, then issues a barrier
+  of `kind` to each handle written to.
+
+  Write backs of handles using the multiplexer of the cache are all initiated at once. A page
+  which fails to be written back stays dirty.
+
+  \errors Any of the values `write()` and `barrier()` can return, the first failure being returned.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> flush(io_handle *h = nullptr, barrier_kind kind = barrier_kind::nowait_data_only, deadline d = {}) noexcept;
+
+  /*! \brief Writes back the dirty pages of `h`, then removes all its pages from the cache.
+
+  \errors `errc::device_or_resource_busy` if any page of `h` is pinned or being read. Any of
+  the values `flush()` can return.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> detach(io_handle &h, deadline d = {}) noexcept;
+};
+
+LLFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#include "detail/impl/buffer_cache.ipp"
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#endif
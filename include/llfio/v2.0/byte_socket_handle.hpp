@@ -0,0 +1,389 @@
+/* A handle to a byte-orientated socket
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_BYTE_SOCKET_HANDLE_H
+#define LLFIO_BYTE_SOCKET_HANDLE_H
+
+#include "io_handle.hpp"
+
+//! \file byte_socket_handle.hpp Provides `byte_socket_handle` and `listening_byte_socket_handle`
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+//! Inspired by ASIO's `ip` namespace
+namespace ip
+{
+  //! The family of IP
+  enum class family
+  {
+    unknown,
+    v4,  //!< IP version 4
+    v6   //!< IP version 6
+  };
+
+  /*! \brief A version independent IP address and port.
+
+  This is a thin wrapper around a `sockaddr_in` or `sockaddr_in6`, so it can be
+  passed to the socket APIs without conversion.
+  */
+  class LLFIO_DECL address
+  {
+  protected:
+    union
+    {
+      alignas(8) byte _storage[32];  // sockaddr_in6 is 28 bytes
+      uint64_t _align;
+    };
+
+  public:
+    //! Constructs an address of unknown family.
+    constexpr address() noexcept
+        : _storage{}
+    {
+    }
+    //! Constructs an address from a `sockaddr` of `len` bytes.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC address(const void *sockaddr, size_t len) noexcept;
+    address(const address &) = default;
+    address(address &&) = default;
+    address &operator=(const address &) = default;
+    address &operator=(address &&) = default;
+    ~address() = default;
+
+    //! True if the addresses and ports are equal.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool operator==(const address &o) const noexcept;
+    //! True if the addresses or ports are unequal.
+    bool operator!=(const address &o) const noexcept { return !(*this == o); }
+
+    //! The family of this address.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC ip::family family() const noexcept;
+    //! True if this is an IP version 4 address.
+    bool is_v4() const noexcept { return family() == ip::family::v4; }
+    //! True if this is an IP version 6 address.
+    bool is_v6() const noexcept { return family() == ip::family::v6; }
+    //! True if this is a loopback address.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool is_loopback() const noexcept;
+    //! True if this is the unspecified i.e. any address.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool is_any() const noexcept;
+    //! The port, in host byte order.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC uint16_t port() const noexcept;
+    //! Sets the port.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void set_port(uint16_t port) noexcept;
+
+    //! The `sockaddr` for this address.
+    const void *to_sockaddr() const noexcept { return _storage; }
+    //! The size of the `sockaddr` for this address, which is zero if of unknown family.
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC int sockaddrlen() const noexcept;
+  };
+  //! Prints the address as `1.2.3.4:80` or `[::1]:80`.
+  LLFIO_HEADERS_ONLY_FUNC_SPEC std::ostream &operator<<(std::ostream &s, const address &v);
+
+  /*! \brief Parses an address in the form `1.2.3.4`, `1.2.3.4:80`, `::1` or `[::1]:80`.
+  No name resolution is performed.
+
+  \errors `errc::invalid_argument` if the string is not a numeric address.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<address> make_address(string_view str) noexcept;
+  //! Returns the loopback address of `family`, with `port`.
+  LLFIO_HEADERS_ONLY_FUNC_SPEC address make_address_loopback(ip::family family, uint16_t port = 0) noexcept;
+  //! Returns the unspecified i.e. any address of `family`, with `port`.
+  LLFIO_HEADERS_ONLY_FUNC_SPEC address make_address_any(ip::family family, uint16_t port = 0) noexcept;
+}  // namespace ip
+
+/*! \class byte_socket_handle
+\brief A handle to a connected byte-orientated i.e. TCP socket.
+
+Being an `io_handle`, reads and writes take the same `io_request`, return the same
+`io_result`, accept registered buffers, and honour deadlines exactly as for pipes and files.
+If `flag::multiplexable` is specified, the socket is created non-blocking, and may be set
+to use any `io_multiplexer` which can serve pipes, so socket and storage i/o can share
+a single event loop and a single `registered_buffer_pool`. Sockets are not seekable, so the
+offset of i/o requests is ignored.
+
+A read of zero bytes means that the peer has shut down its side of the connection.
+
+\note On POSIX other than Linux, `SO_NOSIGPIPE` is set. On Linux, writing to a socket
+whose peer has closed raises `SIGPIPE`, which most programs using sockets ignore.
+*/
+class LLFIO_DECL byte_socket_handle : public io_handle
+{
+  friend class listening_byte_socket_handle;
+
+public:
+  using path_type = io_handle::path_type;
+  using extent_type = io_handle::extent_type;
+  using size_type = io_handle::size_type;
+  using mode = io_handle::mode;
+  using creation = io_handle::creation;
+  using caching = io_handle::caching;
+  using flag = io_handle::flag;
+  using buffer_type = io_handle::buffer_type;
+  using const_buffer_type = io_handle::const_buffer_type;
+  using buffers_type = io_handle::buffers_type;
+  using const_buffers_type = io_handle::const_buffers_type;
+  template <class T> using io_request = io_handle::io_request<T>;
+  template <class T> using io_result = io_handle::io_result<T>;
+
+  //! Which directions of the connection to shut down
+  enum class shutdown_kind
+  {
+    read,   //!< No more reads
+    write,  //!< No more writes, which the peer reads as end of stream
+    both    //!< Neither
+  };
+
+public:
+  //! Default constructor
+  constexpr byte_socket_handle() {}  // NOLINT
+  //! Construct a handle from a supplied native handle
+  constexpr byte_socket_handle(native_handle_type h, caching caching, flag flags, io_multiplexer *ctx)
+      : io_handle(std::move(h), caching, flags, ctx)
+  {
+  }
+  //! No copy construction (use clone())
+  byte_socket_handle(const byte_socket_handle &) = delete;
+  //! No copy assignment
+  byte_socket_handle &operator=(const byte_socket_handle &) = delete;
+  //! Implicit move construction of `byte_socket_handle` permitted
+  constexpr byte_socket_handle(byte_socket_handle &&o) noexcept
+      : io_handle(std::move(o))
+  {
+  }
+  //! Explicit conversion from handle permitted
+  explicit constexpr byte_socket_handle(handle &&o, io_multiplexer *ctx) noexcept
+      : io_handle(std::move(o), ctx)
+  {
+  }
+  //! Explicit conversion from io_handle permitted
+  explicit constexpr byte_socket_handle(io_handle &&o) noexcept
+      : io_handle(std::move(o))
+  {
+  }
+  //! Move assignment of `byte_socket_handle` permitted
+  byte_socket_handle &operator=(byte_socket_handle &&o) noexcept
+  {
+    if(this == &o)
+    {
+      return *this;
+    }
+    this->~byte_socket_handle();
+    new(this) byte_socket_handle(std::move(o));
+    return *this;
+  }
+  //! Swap with another instance
+  LLFIO_MAKE_FREE_FUNCTION
+  void swap(byte_socket_handle &o) noexcept
+  {
+    byte_socket_handle temp(std::move(*this));
+    *this = std::move(o);
+    o = std::move(temp);
+  }
+
+  /*! Create an unconnected socket handle, for use with `connect()`.
+  \param family Which IP family to create the socket in.
+  \param _mode How to open the socket. `mode::read` forbids writes, `mode::append` forbids reads.
+  \param _caching Ignored.
+  \param flags Any additional custom behaviours, of which `flag::multiplexable` makes the socket non-blocking.
+
+  \errors Any of the values POSIX `socket()` or `WSASocketW()` can return.
+  */
+  LLFIO_MAKE_FREE_FUNCTION
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<byte_socket_handle> byte_socket(ip::family family, mode _mode = mode::write, caching _caching = caching::all, flag flags = flag::none) noexcept;
+  //! Convenience overload creating a socket handle of the same family as `addr`, and connecting it to `addr`.
+  LLFIO_MAKE_FREE_FUNCTION
+  static inline result<byte_socket_handle> connected(const ip::address &addr, mode _mode = mode::write, caching _caching = caching::all, flag flags = flag::none, deadline d = {}) noexcept
+  {
+    OUTCOME_TRY(auto &&ret, byte_socket(addr.family(), _mode, _caching, flags));
+    OUTCOME_TRY(ret.connect(addr, d));
+    return {std::move(ret)};
+  }
+
+  /*! Connects this socket to `addr`.
+
+  \errors Any of the values POSIX `connect()`, `poll()` or `select()` can return. `errc::timed_out`
+  if the deadline passes before the connection is established.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> connect(const ip::address &addr, deadline d = {}) noexcept;
+  //! The local endpoint of this socket.
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<ip::address> local_endpoint() const noexcept;
+  //! The remote endpoint of this socket.
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<ip::address> remote_endpoint() const noexcept;
+  //! Shuts down one or both directions of the connection, without closing the handle.
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> shutdown(shutdown_kind kind = shutdown_kind::write) noexcept;
+  /*! Gracefully closes the connection, by shutting down writes and discarding reads until the
+  peer shuts down its side, or the deadline passes, before closing the handle. A plain `close()`
+  of a socket with unread data may make the peer see a reset connection rather than the end of
+  the stream.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> shutdown_and_close(deadline d = std::chrono::seconds(30)) noexcept;
+  /*! \brief Sends up to `bytes` bytes of the file `src` from `offset` through this socket, without
+  copying them through user space where possible, returning the number of bytes sent.
+
+  The file pointer of `src` is not changed. Fewer bytes than requested may be sent, as with a
+  partial write, and zero is returned if `src` has no bytes at `offset`.
+
+  On Linux, FreeBSD and Mac OS this is `sendfile()`, and on Windows it is `TransmitFile()`, so the
+  bytes go straight from the page cache to the network stack. If `src` is not seekable, or the kernel
+  cannot send from it, up to 64Kb is read into a buffer and written into this socket, and if the
+  deadline expires during the write, the bytes read will be lost. To send from a pipe without copying,
+  use `pipe_handle::splice_to()`.
+
+  \errors Any of the values POSIX `sendfile()`, `read()` and `write()`, or `TransmitFile()` can return.
+  `errc::not_supported` if a deadline is specified and this socket is not non-blocking.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> splice_from(io_handle &src, extent_type offset, size_t bytes, deadline d = deadline()) noexcept;
+
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC ~byte_socket_handle() override
+  {
+    if(_v)
+    {
+      (void) byte_socket_handle::close();
+    }
+  }
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override;
+};
+
+/*! \class listening_byte_socket_handle
+\brief A handle to a socket listening for incoming byte-orientated i.e. TCP connections.
+
+If `flag::multiplexable` is specified, the sockets accepted are non-blocking, and may be set
+to use an `io_multiplexer`.
+*/
+class LLFIO_DECL listening_byte_socket_handle : public handle
+{
+public:
+  using path_type = handle::path_type;
+  using mode = handle::mode;
+  using creation = handle::creation;
+  using caching = handle::caching;
+  using flag = handle::flag;
+
+public:
+  //! Default constructor
+  constexpr listening_byte_socket_handle() {}  // NOLINT
+  //! Construct a handle from a supplied native handle
+  constexpr listening_byte_socket_handle(native_handle_type h, caching caching, flag flags)
+      : handle(std::move(h), caching, flags)
+  {
+  }
+  //! No copy construction (use clone())
+  listening_byte_socket_handle(const listening_byte_socket_handle &) = delete;
+  //! No copy assignment
+  listening_byte_socket_handle &operator=(const listening_byte_socket_handle &) = delete;
+  //! Implicit move construction of `listening_byte_socket_handle` permitted
+  constexpr listening_byte_socket_handle(listening_byte_socket_handle &&o) noexcept
+      : handle(std::move(o))
+  {
+  }
+  //! Explicit conversion from handle permitted
+  explicit constexpr listening_byte_socket_handle(handle &&o) noexcept
+      : handle(std::move(o))
+  {
+  }
+  //! Move assignment of `listening_byte_socket_handle` permitted
+  listening_byte_socket_handle &operator=(listening_byte_socket_handle &&o) noexcept
+  {
+    if(this == &o)
+    {
+      return *this;
+    }
+    this->~listening_byte_socket_handle();
+    new(this) listening_byte_socket_handle(std::move(o));
+    return *this;
+  }
+  //! Swap with another instance
+  LLFIO_MAKE_FREE_FUNCTION
+  void swap(listening_byte_socket_handle &o) noexcept
+  {
+    listening_byte_socket_handle temp(std::move(*this));
+    *this = std::move(o);
+    o = std::move(temp);
+  }
+
+  /*! Create an unbound listening socket handle, for use with `bind()`.
+  \param family Which IP family to create the socket in.
+  \param _mode The mode with which sockets accepted are opened.
+  \param _caching Ignored.
+  \param flags Any additional custom behaviours, of which `flag::multiplexable` makes the
+  sockets accepted non-blocking.
+
+  \errors Any of the values POSIX `socket()` or `WSASocketW()` can return.
+  */
+  LLFIO_MAKE_FREE_FUNCTION
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<listening_byte_socket_handle> listening_byte_socket(ip::family family, mode _mode = mode::write, caching _caching = caching::all, flag flags = flag::none) noexcept;
+
+  /*! Binds this socket to `addr`, and starts listening for connections. A port of zero
+  chooses an unused port, which `local_endpoint()` returns.
+  \param addr The address to listen on.
+  \param backlog The number of connections to queue, with -1 meaning the system maximum.
+
+  \errors Any of the values POSIX `bind()` and `listen()` can return.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> bind(const ip::address &addr, int backlog = -1) noexcept;
+  //! The local endpoint of this socket.
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<ip::address> local_endpoint() const noexcept;
+  /*! Accepts a connection, returning the connected socket and the address of its peer. The socket
+  returned uses multiplexer `ctx`, if not null.
+
+  \errors Any of the values POSIX `accept()`, `poll()` or `WSAPoll()` can return. `errc::timed_out`
+  if the deadline passes before a connection arrives.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::pair<byte_socket_handle, ip::address>> accept(io_multiplexer *ctx = nullptr, deadline d = {}) noexcept;
+
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC ~listening_byte_socket_handle() override
+  {
+    if(_v)
+    {
+      (void) listening_byte_socket_handle::close();
+    }
+  }
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> close() noexcept override;
+};
+
+// BEGIN make_free_functions.py
+// END make_free_functions.py
+
+LLFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#include "detail/impl/byte_socket_handle.ipp"
+#ifdef _WIN32
+#include "detail/impl/windows/byte_socket_handle.ipp"
+#else
+#include "detail/impl/posix/byte_socket_handle.ipp"
+#endif
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#endif
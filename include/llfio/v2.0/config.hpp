@@ -55,6 +55,13 @@ Distributed under the Boost Software License, Version 1.0.
 #endif
 #endif
 
+//! \def LLFIO_ENABLE_IO_STATISTICS
+//! \brief Define to 1 to have `io_handle::read()`, `io_handle::write()` and `io_handle::barrier()`
+//! record per-handle statistics, retrievable using `io_handle::statistics()`. Defaults to 0. \ingroup config
+#if !defined(LLFIO_ENABLE_IO_STATISTICS)
+#define LLFIO_ENABLE_IO_STATISTICS 0
+#endif
+
 #ifndef LLFIO_LOG_TO_OSTREAM
 #if !defined(NDEBUG) && !defined(LLFIO_DISABLE_LOG_TO_OSTREAM)
 #include <iostream>  // for std::cerr
@@ -80,6 +87,18 @@ Distributed under the Boost Software License, Version 1.0.
 #endif
 #endif
 
+#if !defined(LLFIO_TRACE_EVENTS)
+//! \brief How many typed syscall timing events `trace_log()` retains, which must be a power of two.
+//! Defaults to 0, which compiles out syscall timing tracing entirely. \ingroup config
+#define LLFIO_TRACE_EVENTS 0
+#endif
+
+#if !defined(LLFIO_THREAD_LOG_EVENTS)
+//! \brief How many warn and more detailed log entries each thread's buffer in `thread_log()` retains,
+//! which must be a power of two. Defaults to 0, which sends all log levels to `log()`. \ingroup config
+#define LLFIO_THREAD_LOG_EVENTS 0
+#endif
+
 #if !defined(LLFIO_EXPERIMENTAL_STATUS_CODE)
 //! \brief Whether to use SG14 experimental `status_code` instead of `std::error_code`
 #define LLFIO_EXPERIMENTAL_STATUS_CODE 0
@@ -0,0 +1,497 @@
+/* A user space page cache for handles bypassing the kernel page cache
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../buffer_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::unique_ptr<buffer_cache>> buffer_cache::create(io_handle &h, size_t page_size, size_t pages) noexcept
+{
+  if(page_size == 0 || pages == 0)
+  {
+    return errc::invalid_argument;
+  }
+  try
+  {
+    page_size = utils::round_up_to_page_size(page_size, utils::page_size());
+    // Round up the pool to a whole number of large pages if it exceeds one, so it is allocated with them
+    const auto &page_sizes = utils::page_sizes(true);
+    if(page_sizes.size() > 1 && (page_sizes[1] % page_size) == 0 && page_size * pages > page_sizes[1])
+    {
+      const size_t per_large_page = page_sizes[1] / page_size;
+      pages = (pages + per_large_page - 1) / per_large_page * per_large_page;
+    }
+    OUTCOME_TRY(auto &&pool, registered_buffer_pool::create(h, page_size, pages));
+    auto ret = std::make_unique<buffer_cache>(_private_tag(), h.multiplexer(), pool);
+    for(size_t n = 0; n < ret->_count; n++)
+    {
+      OUTCOME_TRY(ret->_frames[n].buffer, pool->acquire());
+    }
+    return {std::move(ret)};
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void buffer_cache::_enqueue(_frame_type &f, _queue_type queue) noexcept
+{
+  // A1in is oldest first, Am is most recently used first
+  auto &to = _list(queue);
+  to.splice((queue == _queue_type::am) ? to.begin() : to.end(), _list(f.queue), f.queue_it);
+  f.queue = queue;
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void buffer_cache::_dequeue(_frame_type &f) noexcept { _enqueue(f, _queue_type::none); }
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void buffer_cache::_promote(_frame_type &f) noexcept
+{
+  if(f.queue != _queue_type::none)
+  {
+    _enqueue(f, _queue_type::am);
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void buffer_cache::_release(_frame_type &f) noexcept
+{
+  _table.erase(_key_type{f.h, f.page});
+  _dequeue(f);
+  f.h = nullptr;
+  f.state = _state_type::free;
+  _free.push_back(f.index);
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void buffer_cache::_loaded(_frame_type &f, size_t bytes) noexcept
+{
+  f.length = bytes;
+  if(bytes < _page_size)
+  {
+    memset(f.buffer->data() + bytes, 0, _page_size - bytes);
+  }
+  f.state = _state_type::clean;
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> buffer_cache::_write_back(_frame_type &f, deadline d) noexcept
+{
+  f.wbuffer = {f.buffer->data(), f.length};
+  f.completed(f.h->write(registered_buffer_type(f.buffer), {{&f.wbuffer, 1}, f.page * _page_size}, d));
+  if(f.transferred && f.transferred.value() != f.length)
+  {
+    f.transferred = errc::io_error;
+  }
+  if(!f.transferred)
+  {
+    return std::move(f.transferred).error();
+  }
+  f.state = _state_type::clean;
+  ++_stats.write_backs;
+  return success();
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> buffer_cache::_reclaim() noexcept
+{
+  if(!_free.empty())
+  {
+    const size_t ret = _free.back();
+    _free.pop_back();
+    return ret;
+  }
+  static constexpr size_t npos = (size_t) -1;
+  auto evictable = [&](size_t idx) {
+    const auto &f = _frames[idx];
+    return f.pins == 0 && (f.state == _state_type::clean || f.state == _state_type::dirty);
+  };
+  auto oldest_a1in = [&]() -> size_t {
+    auto it = std::find_if(_a1in.begin(), _a1in.end(), evictable);
+    return (it == _a1in.end()) ? npos : *it;
+  };
+  auto least_recent_am = [&]() -> size_t {
+    auto it = std::find_if(_am.rbegin(), _am.rend(), evictable);
+    return (it == _am.rend()) ? npos : *it;
+  };
+  // Evict from A1in whilst it exceeds its share, else from Am
+  size_t idx = (_a1in.size() > _a1in_max || _am.empty()) ? oldest_a1in() : npos;
+  if(idx == npos)
+  {
+    idx = least_recent_am();
+  }
+  if(idx == npos)
+  {
+    idx = oldest_a1in();
+  }
+  if(idx == npos)
+  {
+    return errc::no_buffer_space;
+  }
+  auto &f = _frames[idx];
+  if(f.state == _state_type::dirty)
+  {
+    OUTCOME_TRY(_write_back(f, {}));
+  }
+  if(f.queue == _queue_type::a1in)
+  {
+    // Remember the page in case it is referenced again soon. Failing to remember it only loses
+    // its promotion to Am upon its next reference.
+    try
+    {
+      const _key_type key{f.h, f.page};
+      auto it = _a1out.insert(_a1out.end(), key);
+      try
+      {
+        _a1out_table.emplace(key, it);
+      }
+      catch(...)
+      {
+        _a1out.erase(it);
+      }
+      while(_a1out.size() > _a1out_max)
+      {
+        _a1out_table.erase(_a1out.front());
+        _a1out.pop_front();
+      }
+    }
+    catch(...)
+    {
+    }
+  }
+  ++_stats.evictions;
+  _table.erase(_key_type{f.h, f.page});
+  _dequeue(f);
+  f.h = nullptr;
+  f.state = _state_type::free;
+  return idx;
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> buffer_cache::_insert(io_handle &h, extent_type page) noexcept
+{
+  OUTCOME_TRY(auto &&idx, _reclaim());
+  auto &f = _frames[idx];
+  const _key_type key{&h, page};
+  try
+  {
+    _table.emplace(key, idx);
+  }
+  catch(...)
+  {
+    _free.push_back(idx);
+    return error_from_exception();
+  }
+  f.h = &h;
+  f.page = page;
+  f.length = 0;
+  f.state = _state_type::loading;
+  ++_stats.misses;
+  auto it = _a1out_table.find(key);
+  if(it != _a1out_table.end())
+  {
+    ++_stats.ghost_hits;
+    _a1out.erase(it->second);
+    _a1out_table.erase(it);
+    _enqueue(f, _queue_type::am);
+  }
+  else
+  {
+    _enqueue(f, _queue_type::a1in);
+  }
+  return idx;
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> buffer_cache::_begin_io(_frame_type &f, bool write) noexcept
+{
+  f.reset();
+  f.finished = false;
+  f.transferred = 0;
+  if(f.io_state_storage.empty())
+  {
+    OUTCOME_TRY(f.io_state_storage, _multiplexer->allocate_io_operation_state_storage());
+  }
+  if(write)
+  {
+    f.wbuffer = {f.buffer->data(), f.length};
+    f.io_state = _multiplexer->construct_and_init_io_operation(f.io_state_storage, f.h, &f, registered_buffer_type(f.buffer), {},
+                                                               io_multiplexer::io_request<io_multiplexer::const_buffers_type>({&f.wbuffer, 1}, f.page * _page_size));
+  }
+  else
+  {
+    f.rbuffer = {f.buffer->data(), _page_size};
+    f.io_state = _multiplexer->construct_and_init_io_operation(f.io_state_storage, f.h, &f, registered_buffer_type(f.buffer), {},
+                                                               io_multiplexer::io_request<io_multiplexer::buffers_type>({&f.rbuffer, 1}, f.page * _page_size));
+  }
+  _inflight.push_back(f.index);
+  return success();
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void buffer_cache::_reap() noexcept
+{
+  for(size_t n = 0; n < _inflight.size();)
+  {
+    auto &f = _frames[_inflight[n]];
+    if(!f.finished)
+    {
+      ++n;
+      continue;
+    }
+    _inflight[n] = _inflight.back();
+    _inflight.pop_back();
+    f.reset();
+    if(f.state == _state_type::writing)
+    {
+      if(f.transferred && f.transferred.value() != f.length)
+      {
+        f.transferred = errc::io_error;
+      }
+      f.state = f.transferred ? _state_type::clean : _state_type::dirty;
+      if(f.transferred)
+      {
+        ++_stats.write_backs;
+      }
+      continue;
+    }
+    // The completions may pin further pages, including this one
+    std::vector<completion_type> waiters;
+    waiters.swap(f.waiters);
+    if(f.transferred)
+    {
+      _loaded(f, f.transferred.value());
+      for(auto &waiter : waiters)
+      {
+        waiter(pinned_page(&f));
+      }
+    }
+    else
+    {
+      auto error = std::move(f.transferred).error();
+      _release(f);
+      for(auto &waiter : waiters)
+      {
+        waiter(result<pinned_page>(error));
+      }
+    }
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<buffer_cache::pinned_page> buffer_cache::pin(io_handle &h, extent_type offset, deadline d) noexcept
+{
+  const _key_type key{&h, offset / _page_size};
+  for(;;)
+  {
+    auto it = _table.find(key);
+    if(it == _table.end())
+    {
+      break;
+    }
+    auto &f = _frames[it->second];
+    if(f.state == _state_type::loading)
+    {
+      // Wait for the read in flight, after which the page may have been released if it failed
+      OUTCOME_TRY(poll(std::chrono::seconds(1)));
+      continue;
+    }
+    ++_stats.hits;
+    _promote(f);
+    return pinned_page(&f);
+  }
+  OUTCOME_TRY(auto &&idx, _insert(h, key.page));
+  auto &f = _frames[idx];
+  f.rbuffer = {f.buffer->data(), _page_size};
+  f.completed(h.read(registered_buffer_type(f.buffer), {{&f.rbuffer, 1}, key.page * _page_size}, d));
+  if(!f.transferred)
+  {
+    auto error = std::move(f.transferred).error();
+    _release(f);
+    return error;
+  }
+  _loaded(f, f.transferred.value());
+  return pinned_page(&f);
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> buffer_cache::pin_async(io_handle &h, extent_type offset, completion_type completion) noexcept
+{
+  if(!_async(h))
+  {
+    completion(pin(h, offset));
+    return success();
+  }
+  try
+  {
+    const _key_type key{&h, offset / _page_size};
+    auto it = _table.find(key);
+    if(it != _table.end())
+    {
+      auto &f = _frames[it->second];
+      if(f.state == _state_type::loading)
+      {
+        f.waiters.push_back(std::move(completion));
+        return success();
+      }
+      ++_stats.hits;
+      _promote(f);
+      completion(pinned_page(&f));
+      return success();
+    }
+    OUTCOME_TRY(auto &&idx, _insert(h, key.page));
+    auto &f = _frames[idx];
+    auto r = [&]() -> result<void> {
+      f.waiters.push_back(std::move(completion));
+      return _begin_io(f, false);
+    }();
+    if(!r)
+    {
+      f.waiters.clear();
+      _release(f);
+      return r;
+    }
+    return success();
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> buffer_cache::poll(deadline d) noexcept
+{
+  if(_multiplexer != nullptr && !_inflight.empty())
+  {
+    OUTCOME_TRY(_multiplexer->flush_inited_io_operations());
+    // Some i/o may have completed upon initiation
+    if(std::none_of(_inflight.begin(), _inflight.end(), [&](size_t idx) { return _frames[idx].finished; }))
+    {
+      OUTCOME_TRY(_multiplexer->check_for_any_completed_io(d));
+    }
+  }
+  _reap();
+  return success();
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> buffer_cache::flush(io_handle *h, barrier_kind kind, deadline d) noexcept
+{
+  try
+  {
+    optional<result<void>::error_type> failure;
+    std::vector<io_handle *> written;
+    std::vector<size_t> issued;
+    for(size_t n = 0; n < _count; n++)
+    {
+      auto &f = _frames[n];
+      if(f.state != _state_type::dirty || (h != nullptr && f.h != h))
+      {
+        continue;
+      }
+      if(std::find(written.begin(), written.end(), f.h) == written.end())
+      {
+        written.push_back(f.h);
+      }
+      if(_async(*f.h))
+      {
+        f.state = _state_type::writing;
+        auto r = _begin_io(f, true);
+        if(!r)
+        {
+          f.state = _state_type::dirty;
+          if(!failure)
+          {
+            failure = std::move(r).error();
+          }
+          continue;
+        }
+        issued.push_back(n);
+      }
+      else
+      {
+        auto r = _write_back(f, d);
+        if(!r && !failure)
+        {
+          failure = std::move(r).error();
+        }
+      }
+    }
+    while(std::any_of(issued.begin(), issued.end(), [&](size_t idx) { return _frames[idx].state == _state_type::writing; }))
+    {
+      OUTCOME_TRY(poll(std::chrono::seconds(1)));
+    }
+    for(auto idx : issued)
+    {
+      if(!_frames[idx].transferred && !failure)
+      {
+        failure = _frames[idx].transferred.error();
+      }
+    }
+    if(failure)
+    {
+      return std::move(*failure);
+    }
+    for(auto *i : written)
+    {
+      OUTCOME_TRY(i->barrier(kind, d));
+    }
+    return success();
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> buffer_cache::detach(io_handle &h, deadline d) noexcept
+{
+  for(size_t n = 0; n < _count; n++)
+  {
+    const auto &f = _frames[n];
+    if(f.h == &h && (f.pins > 0 || f.state == _state_type::loading))
+    {
+      return errc::device_or_resource_busy;
+    }
+  }
+  OUTCOME_TRY(flush(&h, barrier_kind::nowait_data_only, d));
+  for(size_t n = 0; n < _count; n++)
+  {
+    auto &f = _frames[n];
+    if(f.h == &h)
+    {
+      _release(f);
+    }
+  }
+  // The address of the handle may be reused by another
+  for(auto it = _a1out.begin(); it != _a1out.end();)
+  {
+    if(it->h == &h)
+    {
+      _a1out_table.erase(*it);
+      it = _a1out.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+  return success();
+}
+
+LLFIO_V2_NAMESPACE_END
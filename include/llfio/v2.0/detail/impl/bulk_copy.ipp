@@ -0,0 +1,552 @@
+/* A pipelined bulk file copy engine
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../algorithm/bulk_copy.hpp"
+#include "../../registered_buffer_pool.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // One of the two buffers of an item being copied through buffers
+    struct bulk_copy_slot final : public io_multiplexer::io_operation_state_visitor
+    {
+      enum class stage_type
+      {
+        idle,
+        reading,
+        writing
+      };
+      io_multiplexer *multiplexer{nullptr};
+      span<byte> io_state_storage;
+      io_multiplexer::io_operation_state *io_state{nullptr};
+      io_multiplexer::registered_buffer_type buffer;
+      io_multiplexer::buffer_type rbuffer;
+      io_multiplexer::const_buffer_type wbuffer;
+      file_handle::extent_type offset{0};
+      size_t length{0}, done{0};
+      stage_type stage{stage_type::idle};
+      bool finished{false};
+      result<size_t> transferred{0};
+
+      bulk_copy_slot() = default;
+      bulk_copy_slot(const bulk_copy_slot &) = delete;
+      bulk_copy_slot(bulk_copy_slot &&) = delete;
+      bulk_copy_slot &operator=(const bulk_copy_slot &) = delete;
+      bulk_copy_slot &operator=(bulk_copy_slot &&) = delete;
+      ~bulk_copy_slot()
+      {
+        reset();
+        if(!io_state_storage.empty())
+        {
+          multiplexer->deallocate_io_operation_state_storage(io_state_storage);
+        }
+      }
+      void reset() noexcept
+      {
+        if(io_state != nullptr)
+        {
+          io_state->~io_operation_state();
+          io_state = nullptr;
+        }
+      }
+      // Whether i/o has been begun whose completion has not yet been processed
+      bool busy() const noexcept { return stage != stage_type::idle; }
+
+      template <class T> void completed(T &&res) noexcept
+      {
+        if(!res)
+        {
+          transferred = std::move(res).error();
+          return;
+        }
+        size_t bytes = 0;
+        for(auto &b : res.value())
+        {
+          bytes += b.size();
+        }
+        transferred = bytes;
+      }
+      result<void> begin_read(file_handle &src, file_handle::extent_type _offset, size_t _length, deadline d) noexcept
+      {
+        reset();
+        offset = _offset;
+        length = _length;
+        done = 0;
+        stage = stage_type::reading;
+        finished = false;
+        rbuffer = {buffer->data(), length};
+        if(multiplexer == nullptr)
+        {
+          completed(src.read(io_multiplexer::registered_buffer_type(buffer), {{&rbuffer, 1}, offset}, d));
+          finished = true;
+          return success();
+        }
+        if(io_state_storage.empty())
+        {
+          OUTCOME_TRY(io_state_storage, multiplexer->allocate_io_operation_state_storage());
+        }
+        io_state = multiplexer->construct_and_init_io_operation(io_state_storage, &src, this, io_multiplexer::registered_buffer_type(buffer), {},
+                                                                io_multiplexer::io_request<io_multiplexer::buffers_type>({&rbuffer, 1}, offset));
+        return success();
+      }
+      // Writes what remains of what was read
+      result<void> begin_write(file_handle &dest, deadline d) noexcept
+      {
+        reset();
+        stage = stage_type::writing;
+        finished = false;
+        wbuffer = {buffer->data() + done, length - done};
+        if(multiplexer == nullptr)
+        {
+          completed(dest.write(io_multiplexer::registered_buffer_type(buffer), {{&wbuffer, 1}, offset + done}, d));
+          finished = true;
+          return success();
+        }
+        io_state = multiplexer->construct_and_init_io_operation(io_state_storage, &dest, this, io_multiplexer::registered_buffer_type(buffer), {},
+                                                                io_multiplexer::io_request<io_multiplexer::const_buffers_type>({&wbuffer, 1}, offset + done));
+        return success();
+      }
+
+      virtual bool read_completed(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/, io_multiplexer::io_result<io_multiplexer::buffers_type> &&res) override
+      {
+        completed(std::move(res));
+        return true;
+      }
+      virtual bool write_completed(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/, io_multiplexer::io_result<io_multiplexer::const_buffers_type> &&res) override
+      {
+        completed(std::move(res));
+        return true;
+      }
+      // May be called during initiation if the i/o completes immediately, so
+      // the state is destroyed by the next begin_*() rather than here
+      virtual void read_finished(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/) override { finished = true; }
+      virtual void write_or_barrier_finished(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/) override { finished = true; }
+    };
+
+    // An item being copied
+    struct bulk_copy_file
+    {
+      size_t idx{0};
+      uint64_t srcdev{0}, destdev{0};
+      file_handle src, dest;
+      stat_t stat{nullptr};
+      std::vector<file_handle::extent_pair> extents;
+      size_t extent_idx{0};
+      file_handle::extent_type extent_offset{0}, bytes{0};
+      bool cloning{true}, cloned_any{false};
+      bulk_copy_slot slots[2];
+      optional<result<void>::error_type> error;
+
+      // Whether any of the valid extents remain to be copied
+      bool more() const noexcept
+      {
+        for(size_t n = extent_idx; n < extents.size(); n++)
+        {
+          if(extents[n].length > ((n == extent_idx) ? extent_offset : 0))
+          {
+            return true;
+          }
+        }
+        return false;
+      }
+      // The next no more than maxlen bytes of the valid extents to copy
+      bool next_chunk(file_handle::extent_type maxlen, file_handle::extent_pair &out) noexcept
+      {
+        while(extent_idx < extents.size() && extent_offset >= extents[extent_idx].length)
+        {
+          extent_idx++;
+          extent_offset = 0;
+        }
+        if(extent_idx == extents.size())
+        {
+          return false;
+        }
+        out.offset = extents[extent_idx].offset + extent_offset;
+        out.length = (std::min)(maxlen, extents[extent_idx].length - extent_offset);
+        extent_offset += out.length;
+        return true;
+      }
+      bool busy() const noexcept { return slots[0].busy() || slots[1].busy(); }
+    };
+  }  // namespace detail
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<bulk_copy_progress> bulk_copy(span<const bulk_copy_item> items, bulk_copy_visitor *visitor, io_multiplexer *multiplexer,
+                                                                    size_t max_per_device, bool preserve_timestamps, bool force_copy_now, bool durable,
+                                                                    file_handle::creation creation, deadline d) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(0);
+    if(max_per_device == 0)
+    {
+      return errc::invalid_argument;
+    }
+    bulk_copy_visitor default_visitor;
+    if(visitor == nullptr)
+    {
+      visitor = &default_visitor;
+    }
+    try
+    {
+      using detail::bulk_copy_file;
+      using detail::bulk_copy_slot;
+      const path_handle nobase;
+      const auto clone_chunk = (file_handle::extent_type) utils::file_buffer_default_size() * 16;
+      const size_t buffer_size = utils::file_buffer_default_size();
+      bulk_copy_progress p;
+      p.items_total = items.size();
+
+      // Queue the items by the devices of their bases, so every device has its own depth
+      struct queue_type
+      {
+        uint64_t srcdev, destdev;
+        std::deque<size_t> pending;
+      };
+      std::vector<queue_type> queues;
+      std::map<const path_handle *, uint64_t> devices;
+      std::map<uint64_t, size_t> open_per_device;
+      auto device = [&](const path_handle *base) -> uint64_t {
+        if(base == nullptr)
+        {
+          return 0;
+        }
+        auto it = devices.find(base);
+        if(it == devices.end())
+        {
+          stat_t s(nullptr);
+          it = devices.emplace(base, s.fill(*base, stat_t::want::dev) ? s.st_dev : 0).first;
+          open_per_device[it->second] = 0;
+        }
+        return it->second;
+      };
+      open_per_device[0] = 0;
+      for(size_t n = 0; n < items.size(); n++)
+      {
+        const auto srcdev = device(items[n].srcbase), destdev = device(items[n].destbase);
+        auto it = std::find_if(queues.begin(), queues.end(), [&](const queue_type &q) { return q.srcdev == srcdev && q.destdev == destdev; });
+        if(it == queues.end())
+        {
+          queues.push_back({srcdev, destdev, {}});
+          it = queues.end() - 1;
+        }
+        it->pending.push_back(n);
+      }
+      auto charge = [&](uint64_t srcdev, uint64_t destdev, bool opened) {
+        for(auto dev : {srcdev, destdev})
+        {
+          auto &count = open_per_device[dev];
+          count = opened ? count + 1 : count - 1;
+          if(destdev == srcdev)
+          {
+            break;
+          }
+        }
+      };
+      // Every open item holds at most two buffers and counts against at least one device
+      std::shared_ptr<registered_buffer_pool> pool;
+      const size_t pool_size = 2 * max_per_device * open_per_device.size();
+
+      std::vector<std::unique_ptr<bulk_copy_file>> active;
+      optional<result<void>::error_type> aborted;
+      auto abort_if_failed = [&](result<void> r) {
+        if(!r && !aborted)
+        {
+          aborted = std::move(r).error();
+        }
+      };
+      auto open = [&](bulk_copy_file &f) -> result<void> {
+        const auto &item = items[f.idx];
+        const auto flags = (multiplexer != nullptr) ? file_handle::flag::multiplexable : file_handle::flag::none;
+        OUTCOME_TRY(f.src, file_handle::file((item.srcbase != nullptr) ? *item.srcbase : nobase, item.srcleaf, file_handle::mode::read,
+                                             file_handle::creation::open_existing, file_handle::caching::all, flags));
+        OUTCOME_TRY(f.stat.fill(f.src));
+        OUTCOME_TRY(f.dest, file_handle::file((item.destbase != nullptr) ? *item.destbase : nobase, item.destleaf, file_handle::mode::write, creation,
+                                              file_handle::caching::all, flags));
+        OUTCOME_TRY(f.dest.truncate(f.stat.st_size));
+        OUTCOME_TRY(f.extents, f.src.extents());
+        if(multiplexer != nullptr)
+        {
+          OUTCOME_TRY(f.src.set_multiplexer(multiplexer));
+          OUTCOME_TRY(f.dest.set_multiplexer(multiplexer));
+        }
+        for(auto &slot : f.slots)
+        {
+          slot.multiplexer = multiplexer;
+        }
+        f.cloning = !force_copy_now;
+        p.bytes_total += f.stat.st_size;
+        return success();
+      };
+      // Closes an item whose i/o has all completed, removing its copy if it failed
+      auto finish = [&](bulk_copy_file &f) -> result<void> {
+        for(auto &slot : f.slots)
+        {
+          slot.reset();
+          slot.buffer.reset();
+        }
+        charge(f.srcdev, f.destdev, false);
+        p.items_in_flight--;
+        if(!f.error && !aborted)
+        {
+          auto r = [&]() -> result<void> {
+            if(multiplexer != nullptr)
+            {
+              OUTCOME_TRY(f.src.set_multiplexer(nullptr));
+              OUTCOME_TRY(f.dest.set_multiplexer(nullptr));
+            }
+            OUTCOME_TRY(f.dest.barrier(durable ? file_handle::barrier_kind::wait_all : file_handle::barrier_kind::nowait_data_only, d));
+            if(preserve_timestamps)
+            {
+              (void) f.stat.stamp(f.dest);
+            }
+            OUTCOME_TRY(f.dest.close());
+            OUTCOME_TRY(f.src.close());
+            return success();
+          }();
+          if(r)
+          {
+            p.items_completed++;
+            return visitor->item_completed(f.idx, items[f.idx], f.bytes);
+          }
+          f.error = std::move(r).error();
+        }
+        if(f.dest.is_valid())
+        {
+          (void) f.dest.unlink(d);
+          (void) f.dest.close();
+        }
+        (void) f.src.close();
+        if(aborted)
+        {
+          return success();
+        }
+        p.items_failed++;
+        return visitor->item_failed(f.idx, items[f.idx], std::move(*f.error));
+      };
+      // Opens as many pending items as the depth of their devices permits
+      auto admit = [&]() {
+        for(auto &q : queues)
+        {
+          while(!aborted && !q.pending.empty() && open_per_device[q.srcdev] < max_per_device && open_per_device[q.destdev] < max_per_device)
+          {
+            auto f = std::make_unique<bulk_copy_file>();
+            f->idx = q.pending.front();
+            f->srcdev = q.srcdev;
+            f->destdev = q.destdev;
+            q.pending.pop_front();
+            charge(f->srcdev, f->destdev, true);
+            p.items_in_flight++;
+            auto r = open(*f);
+            if(!r)
+            {
+              f->error = std::move(r).error();
+              abort_if_failed(finish(*f));
+              continue;
+            }
+            active.push_back(std::move(f));
+          }
+        }
+      };
+      // Processes the completed i/o of an item, and begins more of its i/o if any remains
+      auto service = [&](bulk_copy_file &f) -> result<bool> {
+        bool progressed = false;
+        for(auto &slot : f.slots)
+        {
+          if(slot.busy() && slot.finished)
+          {
+            progressed = true;
+            if(!slot.transferred)
+            {
+              if(!f.error)
+              {
+                f.error = std::move(slot.transferred).error();
+              }
+              slot.stage = bulk_copy_slot::stage_type::idle;
+            }
+            else if(slot.stage == bulk_copy_slot::stage_type::reading)
+            {
+              // A short read means the source shrank during the copy
+              slot.stage = bulk_copy_slot::stage_type::idle;
+              slot.length = slot.transferred.value();
+              if(slot.length > 0 && !f.error && !aborted)
+              {
+                OUTCOME_TRY(slot.begin_write(f.dest, d));
+              }
+            }
+            else
+            {
+              slot.stage = bulk_copy_slot::stage_type::idle;
+              if(slot.transferred.value() == 0)
+              {
+                if(!f.error)
+                {
+                  f.error = generic_error(errc::io_error);
+                }
+              }
+              else
+              {
+                slot.done += slot.transferred.value();
+                if(slot.done < slot.length)
+                {
+                  if(!f.error && !aborted)
+                  {
+                    OUTCOME_TRY(slot.begin_write(f.dest, d));
+                  }
+                }
+                else
+                {
+                  f.bytes += slot.length;
+                  p.bytes_copied += slot.length;
+                }
+              }
+            }
+          }
+          if(!slot.busy() && !f.error && !aborted && f.more())
+          {
+            if(!slot.buffer)
+            {
+              if(!pool)
+              {
+                OUTCOME_TRY(pool, registered_buffer_pool::create(f.src, buffer_size, pool_size));
+              }
+              auto b = pool->acquire();
+              if(!b)
+              {
+                // Wait for another item to release its buffers
+                continue;
+              }
+              slot.buffer = std::move(b).value();
+            }
+            file_handle::extent_pair chunk;
+            f.next_chunk(buffer_size, chunk);
+            OUTCOME_TRY(slot.begin_read(f.src, chunk.offset, static_cast<size_t>(chunk.length), d));
+            progressed = true;
+          }
+        }
+        return progressed;
+      };
+
+      admit();
+      while(!active.empty())
+      {
+        bool progressed = false, cloning = false;
+        for(auto &f : active)
+        {
+          if(f->cloning && !f->error && !aborted)
+          {
+            file_handle::extent_pair chunk;
+            if(!f->next_chunk(clone_chunk, chunk))
+            {
+              f->cloning = false;
+              continue;
+            }
+            cloning = true;
+            log_level_guard g(log_level::fatal);
+            auto r = f->src.clone_extents_to(chunk, f->dest, chunk.offset, d, false, false);
+            if(r)
+            {
+              f->cloned_any = true;
+              f->bytes += r.assume_value().length;
+              p.bytes_cloned += r.assume_value().length;
+              progressed = true;
+            }
+            else if(!f->cloned_any)
+            {
+              // Extents cannot be cloned, so copy them through buffers from the beginning
+              f->cloning = false;
+              f->extent_idx = 0;
+              f->extent_offset = 0;
+            }
+            else
+            {
+              f->error = std::move(r).error();
+            }
+            continue;
+          }
+          auto r = service(*f);
+          if(!r)
+          {
+            if(!f->error)
+            {
+              f->error = std::move(r).error();
+            }
+            progressed = true;
+          }
+          else if(r.value())
+          {
+            progressed = true;
+          }
+        }
+        // Close the items which are done, and open more in their place
+        for(size_t n = 0; n < active.size();)
+        {
+          auto &f = *active[n];
+          if(!f.busy() && (f.error || aborted || (!f.cloning && !f.more())))
+          {
+            abort_if_failed(finish(f));
+            active.erase(active.begin() + n);
+            progressed = true;
+          }
+          else
+          {
+            n++;
+          }
+        }
+        if(!aborted)
+        {
+          admit();
+        }
+        if(progressed && !aborted)
+        {
+          abort_if_failed(visitor->progress(p));
+        }
+        if(multiplexer != nullptr && !active.empty())
+        {
+          OUTCOME_TRY(multiplexer->flush_inited_io_operations());
+          // Only sleep if nothing else is able to make progress
+          OUTCOME_TRY(multiplexer->check_for_any_completed_io((progressed || cloning) ? std::chrono::seconds(0) : std::chrono::seconds(1)));
+        }
+      }
+      if(aborted)
+      {
+        return std::move(*aborted);
+      }
+      return p;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
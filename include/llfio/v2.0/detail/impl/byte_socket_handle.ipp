@@ -0,0 +1,324 @@
+/* IP addresses for byte socket handles
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../byte_socket_handle.hpp"
+
+#ifdef _WIN32
+#include "windows/import.hpp"
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <climits>
+#include <ostream>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // The milliseconds until the deadline for poll(), or -1 if there is no deadline
+  inline int byte_socket_timeout_ms(const deadline &d) noexcept
+  {
+    if(!d)
+    {
+      return -1;
+    }
+    const std::chrono::nanoseconds ns =
+    d.steady ? std::chrono::nanoseconds(d.nsecs) : std::chrono::duration_cast<std::chrono::nanoseconds>(d.to_time_point() - std::chrono::system_clock::now());
+    if(ns.count() <= 0)
+    {
+      return 0;
+    }
+    return (int) (std::min)((ns.count() + 999999) / 1000000, (decltype(ns.count())) INT_MAX);
+  }
+}  // namespace detail
+
+namespace ip
+{
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC address::address(const void *sockaddr, size_t len) noexcept
+      : _storage{}
+  {
+    memcpy(_storage, sockaddr, (std::min)(len, sizeof(_storage)));
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool address::operator==(const address &o) const noexcept
+  {
+    const int len = sockaddrlen();
+    if(len != o.sockaddrlen() || port() != o.port())
+    {
+      return false;
+    }
+    switch(family())
+    {
+    case ip::family::v4:
+      return 0 == memcmp(&reinterpret_cast<const sockaddr_in *>(_storage)->sin_addr, &reinterpret_cast<const sockaddr_in *>(o._storage)->sin_addr, sizeof(in_addr));
+    case ip::family::v6:
+      return 0 == memcmp(&reinterpret_cast<const sockaddr_in6 *>(_storage)->sin6_addr, &reinterpret_cast<const sockaddr_in6 *>(o._storage)->sin6_addr, sizeof(in6_addr));
+    default:
+      return true;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC ip::family address::family() const noexcept
+  {
+    switch(reinterpret_cast<const sockaddr *>(_storage)->sa_family)
+    {
+    case AF_INET:
+      return ip::family::v4;
+    case AF_INET6:
+      return ip::family::v6;
+    default:
+      return ip::family::unknown;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool address::is_loopback() const noexcept
+  {
+    switch(family())
+    {
+    case ip::family::v4:
+      return (ntohl(reinterpret_cast<const sockaddr_in *>(_storage)->sin_addr.s_addr) >> 24) == 127;
+    case ip::family::v6:
+      return 0 != IN6_IS_ADDR_LOOPBACK(&reinterpret_cast<const sockaddr_in6 *>(_storage)->sin6_addr);
+    default:
+      return false;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool address::is_any() const noexcept
+  {
+    switch(family())
+    {
+    case ip::family::v4:
+      return reinterpret_cast<const sockaddr_in *>(_storage)->sin_addr.s_addr == htonl(INADDR_ANY);
+    case ip::family::v6:
+      return 0 != IN6_IS_ADDR_UNSPECIFIED(&reinterpret_cast<const sockaddr_in6 *>(_storage)->sin6_addr);
+    default:
+      return false;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC uint16_t address::port() const noexcept
+  {
+    switch(family())
+    {
+    case ip::family::v4:
+      return ntohs(reinterpret_cast<const sockaddr_in *>(_storage)->sin_port);
+    case ip::family::v6:
+      return ntohs(reinterpret_cast<const sockaddr_in6 *>(_storage)->sin6_port);
+    default:
+      return 0;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void address::set_port(uint16_t port) noexcept
+  {
+    switch(family())
+    {
+    case ip::family::v4:
+      reinterpret_cast<sockaddr_in *>(_storage)->sin_port = htons(port);
+      break;
+    case ip::family::v6:
+      reinterpret_cast<sockaddr_in6 *>(_storage)->sin6_port = htons(port);
+      break;
+    default:
+      break;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC int address::sockaddrlen() const noexcept
+  {
+    switch(family())
+    {
+    case ip::family::v4:
+      return sizeof(sockaddr_in);
+    case ip::family::v6:
+      return sizeof(sockaddr_in6);
+    default:
+      return 0;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC std::ostream &operator<<(std::ostream &s, const address &v)
+  {
+    char buffer[INET6_ADDRSTRLEN + 1];
+    switch(v.family())
+    {
+    case ip::family::v4:
+      if(inet_ntop(AF_INET, const_cast<in_addr *>(&reinterpret_cast<const sockaddr_in *>(v.to_sockaddr())->sin_addr), buffer, sizeof(buffer)) == nullptr)
+      {
+        return s << "unknown";
+      }
+      return s << buffer << ":" << v.port();
+    case ip::family::v6:
+      if(inet_ntop(AF_INET6, const_cast<in6_addr *>(&reinterpret_cast<const sockaddr_in6 *>(v.to_sockaddr())->sin6_addr), buffer, sizeof(buffer)) == nullptr)
+      {
+        return s << "unknown";
+      }
+      return s << "[" << buffer << "]:" << v.port();
+    default:
+      return s << "unknown";
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<address> make_address(string_view str) noexcept
+  {
+    string_view host(str), port;
+    bool v6 = false;
+    if(!str.empty() && str.front() == '[')
+    {
+      const auto idx = str.find(']');
+      if(idx == string_view::npos)
+      {
+        return errc::invalid_argument;
+      }
+      host = str.substr(1, idx - 1);
+      if(idx + 1 < str.size())
+      {
+        if(str[idx + 1] != ':')
+        {
+          return errc::invalid_argument;
+        }
+        port = str.substr(idx + 2);
+      }
+      v6 = true;
+    }
+    else
+    {
+      const auto idx = str.find(':');
+      if(idx != string_view::npos)
+      {
+        if(str.find(':', idx + 1) != string_view::npos)
+        {
+          // More than one colon can only be a bare IPv6 address
+          v6 = true;
+        }
+        else
+        {
+          host = str.substr(0, idx);
+          port = str.substr(idx + 1);
+        }
+      }
+    }
+    char zhost[INET6_ADDRSTRLEN + 1];
+    if(host.empty() || host.size() >= sizeof(zhost))
+    {
+      return errc::invalid_argument;
+    }
+    memcpy(zhost, host.data(), host.size());
+    zhost[host.size()] = 0;
+    unsigned portnum = 0;
+    if(!str.empty() && str.back() == ':')
+    {
+      return errc::invalid_argument;
+    }
+    for(char c : port)
+    {
+      if(c < '0' || c > '9')
+      {
+        return errc::invalid_argument;
+      }
+      portnum = portnum * 10 + (unsigned) (c - '0');
+      if(portnum > 65535)
+      {
+        return errc::invalid_argument;
+      }
+    }
+    if(v6)
+    {
+      sockaddr_in6 sa;
+      memset(&sa, 0, sizeof(sa));
+      if(inet_pton(AF_INET6, zhost, &sa.sin6_addr) != 1)
+      {
+        return errc::invalid_argument;
+      }
+      sa.sin6_family = AF_INET6;
+      sa.sin6_port = htons((uint16_t) portnum);
+      return address(&sa, sizeof(sa));
+    }
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    if(inet_pton(AF_INET, zhost, &sa.sin_addr) != 1)
+    {
+      return errc::invalid_argument;
+    }
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((uint16_t) portnum);
+    return address(&sa, sizeof(sa));
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC address make_address_loopback(ip::family family, uint16_t port) noexcept
+  {
+    if(family == ip::family::v4)
+    {
+      sockaddr_in sa;
+      memset(&sa, 0, sizeof(sa));
+      sa.sin_family = AF_INET;
+      sa.sin_port = htons(port);
+      sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      return address(&sa, sizeof(sa));
+    }
+    if(family == ip::family::v6)
+    {
+      sockaddr_in6 sa;
+      memset(&sa, 0, sizeof(sa));
+      sa.sin6_family = AF_INET6;
+      sa.sin6_port = htons(port);
+      sa.sin6_addr = in6addr_loopback;
+      return address(&sa, sizeof(sa));
+    }
+    return address();
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC address make_address_any(ip::family family, uint16_t port) noexcept
+  {
+    if(family == ip::family::v4)
+    {
+      sockaddr_in sa;
+      memset(&sa, 0, sizeof(sa));
+      sa.sin_family = AF_INET;
+      sa.sin_port = htons(port);
+      sa.sin_addr.s_addr = htonl(INADDR_ANY);
+      return address(&sa, sizeof(sa));
+    }
+    if(family == ip::family::v6)
+    {
+      sockaddr_in6 sa;
+      memset(&sa, 0, sizeof(sa));
+      sa.sin6_family = AF_INET6;
+      sa.sin6_port = htons(port);
+      sa.sin6_addr = in6addr_any;
+      return address(&sa, sizeof(sa));
+    }
+    return address();
+  }
+}  // namespace ip
+
+LLFIO_V2_NAMESPACE_END
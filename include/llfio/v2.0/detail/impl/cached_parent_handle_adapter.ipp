@@ -24,6 +24,7 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../algorithm/handle_adapter/cached_parent.hpp"
 
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 
@@ -33,24 +34,91 @@ namespace algorithm
 {
   namespace detail
   {
-    struct cached_path_handle_map_
+    struct cached_path_handle_shard_
     {
       std::mutex lock;
       size_t gc_count{0};
       std::unordered_map<filesystem::path, std::weak_ptr<cached_path_handle>, path_hasher> by_path;
+      // Those with open handles, most recently used first
+      cached_path_handle *lru_head{nullptr}, *lru_tail{nullptr};
+      size_t open_count{0};
+
+      void lru_remove(cached_path_handle *p) noexcept
+      {
+        (p->_lru_prev != nullptr ? p->_lru_prev->_lru_next : lru_head) = p->_lru_next;
+        (p->_lru_next != nullptr ? p->_lru_next->_lru_prev : lru_tail) = p->_lru_prev;
+        p->_lru_prev = p->_lru_next = nullptr;
+        --open_count;
+      }
+      void lru_push_front(cached_path_handle *p) noexcept
+      {
+        p->_lru_prev = nullptr;
+        p->_lru_next = lru_head;
+        (lru_head != nullptr ? lru_head->_lru_prev : lru_tail) = p;
+        lru_head = p;
+        ++open_count;
+      }
+      void lru_touch(cached_path_handle *p) noexcept
+      {
+        if(p != lru_head)
+        {
+          lru_remove(p);
+          lru_push_front(p);
+        }
+      }
+      // Closes the least recently used handles until no more than max_open remain open
+      void lru_trim(size_t max_open) noexcept
+      {
+        while(open_count > max_open && lru_tail != nullptr)
+        {
+          auto *victim = lru_tail;
+          lru_remove(victim);
+          (void) victim->h.close();
+        }
+      }
+    };
+    struct cached_path_handle_map_
+    {
+      static constexpr size_t shards_count = 16;
+      std::atomic<size_t> max_open{0};
+      cached_path_handle_shard_ shards[shards_count];
+
+      cached_path_handle_shard_ &shard_for(const filesystem::path &p) noexcept { return shards[path_hasher()(p) % shards_count]; }
+      size_t max_open_per_shard() const noexcept
+      {
+        const size_t v = max_open.load(std::memory_order_relaxed);
+        return (v == 0) ? (size_t) -1 : (std::max)(v / shards_count, (size_t) 1);
+      }
     };
     inline cached_path_handle_map_ &cached_path_handle_map()
     {
       static cached_path_handle_map_ map;
       return map;
     }
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC cached_path_handle::~cached_path_handle()
+    {
+      if(_shard != nullptr)
+      {
+        std::lock_guard<std::mutex> g(_shard->lock);
+        if(h.is_valid())
+        {
+          _shard->lru_remove(this);
+        }
+      }
+    }
     LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<filesystem::path> cached_path_handle::current_path(const filesystem::path &append) noexcept
     {
       try
       {
-        auto ret = h.current_path();
         auto &map = cached_path_handle_map();
-        std::lock_guard<std::mutex> g(map.lock);
+        std::lock_guard<std::mutex> g(_shard->lock);
+        if(!h.is_valid())
+        {
+          // Evicted, so the last known path is all there is
+          return _lastpath / append;
+        }
+        _shard->lru_touch(this);
+        auto ret = h.current_path();
         if(!ret)
         {
           std::string msg("cached_path_handle::current_path() failed to retrieve current path of cached handle due to ");
@@ -59,9 +127,13 @@ namespace algorithm
         }
         else if(!ret.value().empty() && ret.value() != _lastpath)
         {
-          map.by_path.erase(_lastpath);
+          _shard->by_path.erase(_lastpath);
           _lastpath = std::move(ret).value();
-          map.by_path.emplace(_lastpath, shared_from_this());
+          // Each shard finds only the paths which hash to it
+          if(&map.shard_for(_lastpath) == _shard)
+          {
+            _shard->by_path.emplace(_lastpath, shared_from_this());
+          }
         }
         return _lastpath / append;
       }
@@ -70,6 +142,38 @@ namespace algorithm
         return error_from_exception();
       }
     }
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<path_handle> cached_path_handle::clone_to_path_handle() noexcept
+    {
+      try
+      {
+        auto &map = cached_path_handle_map();
+        std::lock_guard<std::mutex> g(_shard->lock);
+        if(h.is_valid())
+        {
+          _shard->lru_touch(this);
+        }
+        else
+        {
+          _shard->lru_trim(map.max_open_per_shard() - 1);
+          OUTCOME_TRY(auto &&newh, directory_handle::directory({}, _lastpath));
+          stat_t s(nullptr);
+          OUTCOME_TRY(s.fill(newh, stat_t::want::dev | stat_t::want::ino));
+          if(s.st_dev != _dev || s.st_ino != _ino)
+          {
+            // Somebody else has replaced the directory since it was evicted
+            return errc::no_such_file_or_directory;
+          }
+          h = std::move(newh);
+          _shard->lru_push_front(this);
+        }
+        OUTCOME_TRY(auto &&ret, h.clone_to_path_handle());
+        return {std::move(ret)};
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
     LLFIO_HEADERS_ONLY_FUNC_SPEC std::pair<cached_path_handle_ptr, filesystem::path> get_cached_path_handle(const path_handle &base, path_view path)
     {
       path_view leaf(path.filename());
@@ -96,27 +200,28 @@ namespace algorithm
         }
       }
       auto &map = cached_path_handle_map();
-      std::lock_guard<std::mutex> g(map.lock);
-      auto rungc = make_scope_exit([&map]() noexcept {
-        if(map.gc_count++ >= 1024)
+      auto &shard = map.shard_for(dirpath);
+      std::lock_guard<std::mutex> g(shard.lock);
+      auto rungc = make_scope_exit([&shard]() noexcept {
+        if(shard.gc_count++ >= 1024)
         {
-          for(auto it = map.by_path.begin(); it != map.by_path.end();)
+          for(auto it = shard.by_path.begin(); it != shard.by_path.end();)
           {
             if(it->second.expired())
             {
-              it = map.by_path.erase(it);
+              it = shard.by_path.erase(it);
             }
             else
             {
               ++it;
             }
           }
-          map.gc_count = 0;
+          shard.gc_count = 0;
         }
       });
       (void) rungc;
-      auto it = map.by_path.find(dirpath);
-      if(it != map.by_path.end())
+      auto it = shard.by_path.find(dirpath);
+      if(it != shard.by_path.end())
       {
         cached_path_handle_ptr ret = it->second.lock();
         if(ret)
@@ -124,28 +229,50 @@ namespace algorithm
           return {ret, leaf.path()};
         }
       }
+      shard.lru_trim(map.max_open_per_shard() - 1);
       cached_path_handle_ptr ret = std::make_shared<cached_path_handle>(directory_handle::directory(base, path).value());
+      stat_t s(nullptr);
+      s.fill(ret->h, stat_t::want::dev | stat_t::want::ino).value();
+      ret->_dev = s.st_dev;
+      ret->_ino = s.st_ino;
       auto _currentpath = ret->h.current_path();
-      if(_currentpath)
+      if(_currentpath && !_currentpath.value().empty())
       {
         ret->_lastpath = std::move(_currentpath).value();
       }
       else
       {
-        ret->_lastpath = std::move(dirpath);
+        ret->_lastpath = dirpath;
       }
-      it = map.by_path.find(ret->_lastpath);
-      if(it != map.by_path.end())
+      // Each shard finds only the paths which hash to it
+      const filesystem::path &key = (&map.shard_for(ret->_lastpath) == &shard) ? ret->_lastpath : dirpath;
+      it = shard.by_path.find(key);
+      if(it != shard.by_path.end())
       {
         it->second = ret;
       }
       else
       {
-        map.by_path.emplace(ret->_lastpath, ret);
+        shard.by_path.emplace(key, ret);
       }
+      ret->_shard = &shard;
+      shard.lru_push_front(ret.get());
       return {ret, leaf.path()};
     }
   }  // namespace detail
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC size_t set_cached_parent_handle_limit(size_t max_open) noexcept
+  {
+    auto &map = detail::cached_path_handle_map();
+    const size_t ret = map.max_open.exchange(max_open, std::memory_order_relaxed);
+    const size_t per_shard = map.max_open_per_shard();
+    for(auto &shard : map.shards)
+    {
+      std::lock_guard<std::mutex> g(shard.lock);
+      shard.lru_trim(per_shard);
+    }
+    return ret;
+  }
 }  // namespace algorithm
 
 LLFIO_V2_NAMESPACE_END
@@ -24,13 +24,18 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../algorithm/clone.hpp"
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 LLFIO_V2_NAMESPACE_BEGIN
 
 namespace algorithm
 {
   LLFIO_HEADERS_ONLY_FUNC_SPEC result<file_handle::extent_type> clone_or_copy(file_handle &src, const path_handle &destdir, path_view destleaf,
                                                                               bool preserve_timestamps, bool force_copy_now, file_handle::creation creation,
-                                                                              deadline d) noexcept
+                                                                              deadline d, size_t threads) noexcept
   {
     LLFIO_LOG_FUNCTION_CALL(&src);
     filesystem::path destleaf_;
@@ -61,9 +66,11 @@ namespace algorithm
       (void) dest.close();
     });
     (void) undest;
+    if(!force_copy_now)
     {
+      // Try cloning extents first, which is always the fastest if supported
       log_level_guard g(log_level::fatal);
-      auto r = src.clone_extents_to(dest, d, force_copy_now, false);
+      auto r = src.clone_extents_to(dest, d, false, false);
       if(r)
       {
         failed = false;
@@ -76,9 +83,77 @@ namespace algorithm
     {
       return errc::no_space_on_device;
     }
-    OUTCOME_TRY(auto &&copied, src.clone_extents_to(dest, d, force_copy_now, true));
+    // Copy in chunks across more than one kernel thread if the file is big enough
+    const auto chunk = (file_handle::extent_type) utils::file_buffer_default_size() * 16;
+    const auto chunks = (size_t) ((stat.st_size + chunk - 1) / chunk);
+    if(threads == 0)
+    {
+      threads = std::thread::hardware_concurrency();
+      if(threads > 4)
+      {
+        threads = 4;
+      }
+    }
+    if(threads > chunks)
+    {
+      threads = chunks;
+    }
+    if(threads <= 1)
+    {
+      OUTCOME_TRY(auto &&copied, src.clone_extents_to(dest, d, force_copy_now, true));
+      failed = false;
+      return copied.length;
+    }
+    // Size the destination up front, so concurrent chunks never race one another to extend it
+    OUTCOME_TRYV(dest.truncate(stat.st_size));
+    std::atomic<size_t> next{0};
+    std::atomic<file_handle::extent_type> copied{0};
+    std::mutex errorlock;
+    optional<result<void>::error_type> error;
+    std::atomic<bool> errored{false};
+    auto copy_chunks = [&]() noexcept {
+      for(size_t n = next.fetch_add(1, std::memory_order_relaxed); n < chunks && !errored.load(std::memory_order_relaxed);
+          n = next.fetch_add(1, std::memory_order_relaxed))
+      {
+        const file_handle::extent_type offset = n * chunk;
+        auto r = src.clone_extents_to({offset, (std::min)(chunk, stat.st_size - offset)}, dest, offset, d, force_copy_now, true);
+        if(!r)
+        {
+          std::lock_guard<std::mutex> g(errorlock);
+          if(!error)
+          {
+            error = std::move(r).error();
+          }
+          errored.store(true, std::memory_order_relaxed);
+          return;
+        }
+        copied.fetch_add(r.assume_value().length, std::memory_order_relaxed);
+      }
+    };
+    std::vector<std::thread> workers;
+    try
+    {
+      workers.reserve(threads - 1);
+      for(size_t n = 1; n < threads; n++)
+      {
+        workers.emplace_back(copy_chunks);
+      }
+    }
+    catch(...)
+    {
+      // Unable to launch more threads, so make do with those we have
+    }
+    copy_chunks();
+    for(auto &i : workers)
+    {
+      i.join();
+    }
+    if(error)
+    {
+      return std::move(*error);
+    }
     failed = false;
-    return copied.length;
+    return copied.load(std::memory_order_relaxed);
   }
 
 }  // namespace algorithm
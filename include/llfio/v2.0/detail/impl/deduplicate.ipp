@@ -0,0 +1,298 @@
+/* Content defined chunking and deduplication by extent cloning
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../algorithm/deduplicate.hpp"
+
+#include "quickcpplib/algorithm/hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    struct gear_table
+    {
+      uint64_t t[256];
+      gear_table() noexcept
+      {
+        // splitmix64, so the table and thus the chunking is the same everywhere
+        uint64_t x = 0x9e3779b97f4a7c15ULL;
+        for(auto &i : t)
+        {
+          uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+          z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+          z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+          i = z ^ (z >> 31);
+        }
+      }
+    };
+    inline const gear_table &gear() noexcept
+    {
+      static const gear_table v;
+      return v;
+    }
+    // The gear hash of the 64 bytes before p, which is all a gear hash at p depends upon
+    inline uint64_t gear_hash64(const byte *p) noexcept
+    {
+      const auto &t = gear().t;
+      p -= 64;
+      uint64_t h = 0;
+      for(size_t n = 0; n < 64; n++)
+      {
+        h = (h << 1) + t[(uint8_t) p[n]];
+      }
+      return h;
+    }
+    // Returns the length of the chunk at p, of which bytes are available
+    inline size_t content_defined_cut(const byte *p, size_t bytes, const content_defined_chunking_options &opts, uint64_t mask_small, uint64_t mask_large) noexcept
+    {
+      if(bytes <= opts.min_size)
+      {
+        return bytes;
+      }
+      const size_t stop = (std::min)(bytes, opts.max_size);
+      for(size_t pos = (opts.min_size + opts.alignment - 1) / opts.alignment * opts.alignment; pos < stop; pos += opts.alignment)
+      {
+        const uint64_t mask = (pos < opts.average_size) ? mask_small : mask_large;
+        if((gear_hash64(p + pos) & mask) == 0)
+        {
+          return pos;
+        }
+      }
+      return stop;
+    }
+  }  // namespace detail
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<std::vector<content_defined_chunk>> content_defined_chunks(file_handle &h, const content_defined_chunking_options &opts) noexcept
+  {
+    if(opts.alignment == 0 || opts.min_size < 64 || opts.min_size > opts.average_size || opts.average_size > opts.max_size || opts.max_size < opts.alignment)
+    {
+      return errc::invalid_argument;
+    }
+    try
+    {
+      // One candidate boundary in every average_size / alignment ought to be taken
+      unsigned bits = 0;
+      while(((size_t) 2 << bits) * opts.alignment <= opts.average_size)
+      {
+        ++bits;
+      }
+      // The top bits of a gear hash depend upon all 64 bytes hashed
+      auto topbits = [](unsigned n) -> uint64_t { return (n == 0) ? 0 : (n >= 64) ? ~(uint64_t) 0 : ~(~(uint64_t) 0 >> n); };
+      const uint64_t mask_small = topbits(bits + 1), mask_large = topbits((bits > 0) ? bits - 1 : 0);
+
+      std::vector<content_defined_chunk> ret;
+      std::vector<byte> buffer(8 * opts.max_size);
+      file_handle::extent_type base = 0;  // the offset of buffer[0]
+      size_t filled = 0, pos = 0;
+      bool eof = false;
+      for(;;)
+      {
+        if(!eof && filled - pos < opts.max_size)
+        {
+          memmove(buffer.data(), buffer.data() + pos, filled - pos);
+          base += pos;
+          filled -= pos;
+          pos = 0;
+          while(!eof && filled < buffer.size())
+          {
+            OUTCOME_TRY(auto &&read, h.read(base + filled, {{buffer.data() + filled, buffer.size() - filled}}));
+            if(read == 0)
+            {
+              eof = true;
+            }
+            filled += read;
+          }
+        }
+        if(pos == filled)
+        {
+          return ret;
+        }
+        const size_t length = detail::content_defined_cut(buffer.data() + pos, filled - pos, opts, mask_small, mask_large);
+        content_defined_chunk c;
+        c.offset = base + pos;
+        c.length = length;
+        const auto hash = QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash(reinterpret_cast<const char *>(buffer.data() + pos), length);
+        c.hash[0] = hash.as_longlongs[0];
+        c.hash[1] = hash.as_longlongs[1];
+        ret.push_back(c);
+        pos += length;
+      }
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<bool> dedup_index::_equal(file_handle &a, file_handle::extent_type aoffset, file_handle &b,
+                                                                   file_handle::extent_type boffset, file_handle::extent_type length) noexcept
+  {
+    try
+    {
+      for(auto &i : _buffers)
+      {
+        i.resize(_opts.max_size);
+      }
+      while(length > 0)
+      {
+        const size_t bytes = static_cast<size_t>((std::min)(length, (file_handle::extent_type) _opts.max_size));
+        OUTCOME_TRY(auto &&reada, a.read(aoffset, {{_buffers[0].data(), bytes}}));
+        OUTCOME_TRY(auto &&readb, b.read(boffset, {{_buffers[1].data(), bytes}}));
+        if(reada != bytes || readb != bytes || 0 != memcmp(_buffers[0].data(), _buffers[1].data(), bytes))
+        {
+          return false;
+        }
+        aoffset += bytes;
+        boffset += bytes;
+        length -= bytes;
+      }
+      return true;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> dedup_index::add(file_handle &h) noexcept
+  {
+    try
+    {
+      OUTCOME_TRY(auto &&chunks, content_defined_chunks(h, _opts));
+      size_t ret = 0;
+      for(auto &c : chunks)
+      {
+        if(_chunks.emplace(std::make_pair(c.hash[0], c.hash[1]), _location{&h, c.offset, c.length}).second)
+        {
+          ++ret;
+        }
+      }
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void dedup_index::remove(const file_handle &h) noexcept
+  {
+    for(auto it = _chunks.begin(); it != _chunks.end();)
+    {
+      if(it->second.h == &h)
+      {
+        it = _chunks.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<dedup_stats> dedup_index::deduplicate(file_handle &h, bool add_to_index) noexcept
+  {
+    try
+    {
+      dedup_stats ret;
+      OUTCOME_TRY(auto &&chunks, content_defined_chunks(h, _opts));
+      ret.chunks = chunks.size();
+      // Consecutive duplicates whose sources are consecutive in the same file are cloned together
+      struct
+      {
+        file_handle *src{nullptr};
+        file_handle::extent_type srcoffset{0}, destoffset{0}, length{0};
+      } run;
+      auto flush = [&]() -> result<void> {
+        const auto length = run.length / _opts.alignment * _opts.alignment;
+        run.length = 0;
+        if(length == 0 || !ret.clone_supported)
+        {
+          return success();
+        }
+        auto r = run.src->clone_extents_to({run.srcoffset, length}, h, run.destoffset, {}, false, false);
+        if(!r)
+        {
+          if(r.error() == errc::operation_not_supported)
+          {
+            ret.clone_supported = false;
+            return success();
+          }
+          return std::move(r).error();
+        }
+        ++ret.clones;
+        ret.cloned_bytes += length;
+        return success();
+      };
+      for(auto &c : chunks)
+      {
+        auto it = _chunks.find(std::make_pair(c.hash[0], c.hash[1]));
+        if(it != _chunks.end() && it->second.length == c.length)
+        {
+          const auto &l = it->second;
+          const bool overlaps = (l.h == &h) && l.offset < c.offset + c.length && c.offset < l.offset + l.length;
+          if(!overlaps && (l.h != &h || l.offset != c.offset))
+          {
+            OUTCOME_TRY(auto &&equal, _equal(*l.h, l.offset, h, c.offset, c.length));
+            if(equal)
+            {
+              ++ret.duplicate_chunks;
+              ret.duplicate_bytes += c.length;
+              const bool extends = run.length > 0 && run.src == l.h && run.srcoffset + run.length == l.offset && run.destoffset + run.length == c.offset &&
+                                   (l.h != &h || run.srcoffset + run.length + c.length <= run.destoffset || run.destoffset + run.length + c.length <= run.srcoffset);
+              if(!extends)
+              {
+                OUTCOME_TRYV(flush());
+                run.src = l.h;
+                run.srcoffset = l.offset;
+                run.destoffset = c.offset;
+              }
+              run.length += c.length;
+              continue;
+            }
+          }
+        }
+        OUTCOME_TRYV(flush());
+        if(add_to_index && it == _chunks.end())
+        {
+          _chunks.emplace(std::make_pair(c.hash[0], c.hash[1]), _location{&h, c.offset, c.length});
+        }
+      }
+      OUTCOME_TRYV(flush());
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
@@ -24,6 +24,26 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../fast_random_file_handle.hpp"
 
+#include <memory>
+
+#ifdef __linux__
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/userfaultfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#endif
+
 LLFIO_V2_NAMESPACE_EXPORT_BEGIN
 
 fast_random_file_handle::io_result<fast_random_file_handle::buffers_type> fast_random_file_handle::_do_read(io_request<buffers_type> reqs, deadline /* unused */) noexcept
@@ -49,81 +69,41 @@ fast_random_file_handle::io_result<fast_random_file_handle::buffers_type> fast_r
     {
       for(size_type i = 0; i < buffer.size();)
       {
-        // How much can we do at once?
         auto hashoffset = reqs.offset >> 2;                      // place this offset into the state
         auto thisblockoffset = reqs.offset - (hashoffset << 2);  // offset into our buffer due to request offset misalignment
-        extent_type thisblocklen = 64;                           // maximum possible block this iteration
-        if(thisblocklen > buffer.size() - i)
-        {
-          thisblocklen = buffer.size() - i;
-        }
+        extent_type thisblocklen = buffer.size() - i;            // maximum possible block this iteration
         if(thisblocklen > togo)
         {
           thisblocklen = togo;
         }
-
-        struct _p
-        {
-          uint32_t hash[16];
-        } blk, *p = &blk;
-        // If not copying partial buffers
-        if(thisblockoffset == 0)
-        {
-          // If destination is on 4 byte multiple, we can write direct
-          if((((uintptr_t) buffer.data() + i) & 3) == 0)
-            p = (_p *) (buffer.data() + i);
-        }
-        if(thisblocklen == 64)
+        if(thisblockoffset == 0 && thisblocklen >= 4)
         {
-          auto &hash = p->hash;
-          prng __prngs[16] = {_prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng, _prng};
-          hash[0] = __prngs[0](hashoffset + 0);
-          hash[1] = __prngs[1](hashoffset + 1);
-          hash[2] = __prngs[2](hashoffset + 2);
-          hash[3] = __prngs[3](hashoffset + 3);
-          hash[4] = __prngs[4](hashoffset + 4);
-          hash[5] = __prngs[5](hashoffset + 5);
-          hash[6] = __prngs[6](hashoffset + 6);
-          hash[7] = __prngs[7](hashoffset + 7);
-          hash[8] = __prngs[8](hashoffset + 8);
-          hash[9] = __prngs[9](hashoffset + 9);
-          hash[10] = __prngs[10](hashoffset + 10);
-          hash[11] = __prngs[11](hashoffset + 11);
-          hash[12] = __prngs[12](hashoffset + 12);
-          hash[13] = __prngs[13](hashoffset + 13);
-          hash[14] = __prngs[14](hashoffset + 14);
-          hash[15] = __prngs[15](hashoffset + 15);
-          if(thisblocklen > 64 - thisblockoffset)
+          // Whole words, in a run which does not cross a change in the high 32 bits of the counter
+          extent_type words = thisblocklen >> 2;
+          const extent_type tonexthi = (static_cast<extent_type>(1) << 32) - (hashoffset & 0xffffffff);
+          if(words > tonexthi)
           {
-            thisblocklen = 64 - thisblockoffset;
+            words = tonexthi;
           }
-        }
-        else if(thisblocklen == 16)
-        {
-          auto &hash = p->hash;
-          prng __prngs[4] = {_prng, _prng, _prng, _prng};
-          hash[0] = __prngs[0](hashoffset + 0);
-          hash[1] = __prngs[1](hashoffset + 1);
-          hash[2] = __prngs[2](hashoffset + 2);
-          hash[3] = __prngs[3](hashoffset + 3);
-          if(thisblocklen > 16 - thisblockoffset)
+          const uint32_t first = static_cast<uint32_t>(hashoffset) + _prng.constant_for(static_cast<uint32_t>(hashoffset >> 32));
+          byte *out = buffer.data() + i;
+          for(size_t n = 0; n < words; n++)
           {
-            thisblocklen = 16 - thisblockoffset;
+            const uint32_t hash = first + static_cast<uint32_t>(n);
+            memcpy(out + n * 4, &hash, 4);
           }
+          thisblocklen = words << 2;
         }
         else
         {
-          auto &hash = p->hash;
+          // Part of a word
           auto __prng(_prng);
-          hash[0] = __prng(hashoffset);
+          const uint32_t hash = __prng(hashoffset);
           if(thisblocklen > 4 - thisblockoffset)
           {
             thisblocklen = 4 - thisblockoffset;
           }
-        }
-        if(p == &blk)
-        {
-          memcpy(buffer.data() + i, ((const char *) p) + thisblockoffset, thisblocklen);
+          memcpy(buffer.data() + i, ((const char *) &hash) + thisblockoffset, thisblocklen);
         }
         reqs.offset += thisblocklen;
         i += thisblocklen;
@@ -139,4 +119,262 @@ fast_random_file_handle::io_result<fast_random_file_handle::buffers_type> fast_r
   return std::move(reqs.buffers);
 }
 
+#if defined(__linux__) && defined(SYS_userfaultfd)
+namespace detail
+{
+  // Generates the pages of maps of random content upon first access
+  struct fast_random_fault_service
+  {
+    struct range_t
+    {
+      uintptr_t begin{0}, end{0};
+      fast_random_file_handle::extent_type offset{0};
+      size_t max_resident{1};          // in pages
+      fast_random_file_handle content;
+      std::deque<uintptr_t> resident;  // in order of generation
+    };
+    int fd{-1};
+    size_t pagesize{utils::page_size()};
+    std::mutex lock;
+    std::vector<std::unique_ptr<range_t>> ranges;
+    std::unique_ptr<byte[]> page;
+
+    fast_random_fault_service() noexcept
+    {
+      // Handling kernel faults needs privileges, so fall back to handling user space faults only
+      fd = (int) syscall(SYS_userfaultfd, O_CLOEXEC);
+      if(fd == -1)
+      {
+        fd = (int) syscall(SYS_userfaultfd, O_CLOEXEC | UFFD_USER_MODE_ONLY);
+      }
+      if(fd == -1)
+      {
+        return;
+      }
+      // Not UFFD_FEATURE_EVENT_REMOVE, as then our own MADV_DONTNEED would wait upon us
+      uffdio_api api{};
+      api.api = UFFD_API;
+      api.features = UFFD_FEATURE_EVENT_UNMAP;
+      if(-1 == ioctl(fd, UFFDIO_API, &api))
+      {
+        _fail();
+        return;
+      }
+      try
+      {
+        page.reset(new byte[pagesize * 2]);
+        std::thread([this] { _run(); }).detach();
+      }
+      catch(...)
+      {
+        _fail();
+      }
+    }
+    void _fail() noexcept
+    {
+      ::close(fd);
+      fd = -1;
+    }
+    byte *_buffer() const noexcept { return reinterpret_cast<byte *>((reinterpret_cast<uintptr_t>(page.get()) + pagesize - 1) & ~(uintptr_t)(pagesize - 1)); }
+    range_t *_find(uintptr_t addr) noexcept
+    {
+      std::lock_guard<std::mutex> g(lock);
+      for(auto &r : ranges)
+      {
+        if(addr >= r->begin && addr < r->end)
+        {
+          return r.get();
+        }
+      }
+      return nullptr;
+    }
+
+    result<void> add(std::unique_ptr<range_t> r) noexcept
+    {
+      range_t *const _r = r.get();
+      try
+      {
+        std::lock_guard<std::mutex> g(lock);
+        ranges.push_back(std::move(r));
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+      uffdio_register reg{};
+      reg.range.start = _r->begin;
+      reg.range.len = _r->end - _r->begin;
+      reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+      if(-1 == ioctl(fd, UFFDIO_REGISTER, &reg))
+      {
+        const int errcode = errno;
+        std::lock_guard<std::mutex> g(lock);
+        for(auto it = ranges.begin(); it != ranges.end(); ++it)
+        {
+          if(it->get() == _r)
+          {
+            ranges.erase(it);
+            break;
+          }
+        }
+        return posix_error(errcode);
+      }
+      return success();
+    }
+
+    void _fault(uintptr_t addr) noexcept
+    {
+      addr &= ~(uintptr_t)(pagesize - 1);
+      // Only this thread removes ranges, so the range found cannot go away beneath us
+      range_t *r = _find(addr);
+      if(r == nullptr)
+      {
+        uffdio_zeropage zp{};
+        zp.range.start = addr;
+        zp.range.len = pagesize;
+        (void) ioctl(fd, UFFDIO_ZEROPAGE, &zp);
+        return;
+      }
+      byte *buffer = _buffer();
+      auto read = r->content.read(r->offset + (addr - r->begin), {{buffer, pagesize}});
+      const size_t bytes = read ? read.value() : 0;
+      memset(buffer + bytes, 0, pagesize - bytes);
+      while(r->resident.size() >= r->max_resident)
+      {
+        (void) ::madvise(reinterpret_cast<void *>(r->resident.front()), pagesize, MADV_DONTNEED);
+        r->resident.pop_front();
+      }
+      uffdio_copy copy{};
+      copy.dst = addr;
+      copy.src = reinterpret_cast<uintptr_t>(buffer);
+      copy.len = pagesize;
+      if(-1 != ioctl(fd, UFFDIO_COPY, &copy))
+      {
+        try
+        {
+          r->resident.push_back(addr);
+        }
+        catch(...)
+        {
+          // The page simply stays resident until unmapped
+        }
+      }
+    }
+
+    void _unmap(uintptr_t start, uintptr_t end) noexcept
+    {
+      std::lock_guard<std::mutex> g(lock);
+      for(auto it = ranges.begin(); it != ranges.end();)
+      {
+        range_t &r = **it;
+        if(r.begin >= start && r.end <= end)
+        {
+          it = ranges.erase(it);
+          continue;
+        }
+        if(r.begin < end && r.end > start)
+        {
+          for(auto rit = r.resident.begin(); rit != r.resident.end();)
+          {
+            if(*rit >= start && *rit < end)
+            {
+              rit = r.resident.erase(rit);
+            }
+            else
+            {
+              ++rit;
+            }
+          }
+        }
+        ++it;
+      }
+    }
+
+    void _run() noexcept
+    {
+      for(;;)
+      {
+        uffd_msg msg;
+        const ssize_t bytes = ::read(fd, &msg, sizeof(msg));
+        if(bytes != sizeof(msg))
+        {
+          if(bytes == -1 && (errno == EINTR || errno == EAGAIN))
+          {
+            continue;
+          }
+          return;
+        }
+        switch(msg.event)
+        {
+        case UFFD_EVENT_PAGEFAULT:
+          _fault(static_cast<uintptr_t>(msg.arg.pagefault.address));
+          break;
+        case UFFD_EVENT_UNMAP:
+          _unmap(static_cast<uintptr_t>(msg.arg.remove.start), static_cast<uintptr_t>(msg.arg.remove.end));
+          break;
+        default:
+          break;
+        }
+      }
+    }
+  };
+  inline fast_random_fault_service *fast_random_fault_service_instance() noexcept
+  {
+    // Deliberately leaked, as its thread services maps until process exit
+    static fast_random_fault_service *v = [] {
+      auto *ret = new(std::nothrow) fast_random_fault_service;
+      if(ret != nullptr && ret->fd == -1)
+      {
+        delete ret;
+        ret = nullptr;
+      }
+      return ret;
+    }();
+    return v;
+  }
+}  // namespace detail
+#endif
+
+result<map_handle> fast_random_file_handle::map(size_type bytes, extent_type offset, size_type max_resident) const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(bytes == 0)
+  {
+    return errc::argument_out_of_domain;
+  }
+  const size_type pagesize = utils::page_size();
+  bytes = utils::round_up_to_page_size(bytes, pagesize);
+#if defined(__linux__) && defined(SYS_userfaultfd)
+  if(auto *service = detail::fast_random_fault_service_instance())
+  {
+    std::unique_ptr<detail::fast_random_fault_service::range_t> r(new(std::nothrow) detail::fast_random_fault_service::range_t);
+    if(!r)
+    {
+      return errc::not_enough_memory;
+    }
+    // Read-only maps are never recycled by the map handle cache, so its registration dies with it
+    OUTCOME_TRY(auto &&mh, map_handle::map(bytes, true, section_handle::flag::read | section_handle::flag::nocommit));
+    r->begin = reinterpret_cast<uintptr_t>(mh.address());
+    r->end = r->begin + bytes;
+    r->offset = offset;
+    r->max_resident = (std::max)(max_resident / pagesize, (size_type) 1);
+    r->content._prng = _prng;
+    r->content._length = _length;
+    if(service->add(std::move(r)))
+    {
+      return {std::move(mh)};
+    }
+    // Otherwise fall back to generating everything up front
+  }
+#endif
+  (void) max_resident;
+  OUTCOME_TRY(auto &&mh, map_handle::map(bytes));
+  fast_random_file_handle content;
+  content._prng = _prng;
+  content._length = _length;
+  OUTCOME_TRY(auto &&read, content.read(offset, {{mh.address(), bytes}}));
+  memset(mh.address() + read, 0, bytes - read);
+  return {std::move(mh)};
+}
+
 LLFIO_V2_NAMESPACE_END
@@ -0,0 +1,688 @@
+/* A handle to a file
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../file_handle.hpp"
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // A pool of page aligned buffers used to bounce unaligned i/o on handles which require aligned i/o
+  struct file_handle_bounce_buffers
+  {
+    static constexpr size_t chunk_size = 65536;
+    static constexpr size_t max_retained = 16;
+
+    std::mutex lock;
+    std::vector<byte *> free;
+
+    file_handle_bounce_buffers() = default;
+    file_handle_bounce_buffers(const file_handle_bounce_buffers &) = delete;
+    file_handle_bounce_buffers &operator=(const file_handle_bounce_buffers &) = delete;
+    ~file_handle_bounce_buffers()
+    {
+      for(auto *p : free)
+      {
+        utils::detail::deallocate_large_pages(p, chunk_size);
+      }
+    }
+
+    byte *acquire() noexcept
+    {
+      {
+        std::lock_guard<std::mutex> g(lock);
+        if(!free.empty())
+        {
+          auto *ret = free.back();
+          free.pop_back();
+          return ret;
+        }
+      }
+      return reinterpret_cast<byte *>(utils::detail::allocate_large_pages(chunk_size).p);
+    }
+    void release(byte *p) noexcept
+    {
+      {
+        std::lock_guard<std::mutex> g(lock);
+        if(free.size() < max_retained)
+        {
+#ifdef __cpp_exceptions
+          try
+          {
+#endif
+            free.push_back(p);
+            return;
+#ifdef __cpp_exceptions
+          }
+          catch(...)
+          {
+          }
+#endif
+        }
+      }
+      utils::detail::deallocate_large_pages(p, chunk_size);
+    }
+
+    static file_handle_bounce_buffers &instance() noexcept
+    {
+      static file_handle_bounce_buffers v;
+      return v;
+    }
+
+    struct lease
+    {
+      byte *p{nullptr};
+      lease() noexcept
+          : p(instance().acquire())
+      {
+      }
+      lease(const lease &) = delete;
+      lease &operator=(const lease &) = delete;
+      ~lease()
+      {
+        if(p != nullptr)
+        {
+          instance().release(p);
+        }
+      }
+    };
+  };
+
+  inline bool file_handle_io_is_aligned(uintptr_t v, size_t alignment) noexcept { return (v & (alignment - 1)) == 0; }
+
+  /* Copies [offset, offset + length) of src to dest at offset + destoffsetdiff through user space
+  buffers, used by clone_extents_to() when the kernel cannot copy for us. If elide_zeros is true,
+  runs of zero bytes of at least 1Kb are not written, as the destination extents are new. If
+  parallel is true and there is no deadline, the blocks are split amongst a few threads, as a
+  single thread's memcpy rate is well below what modern storage can sustain.
+  */
+  inline result<void> file_handle_copy_bytes(file_handle &src, file_handle &dest, file_handle::extent_type offset, file_handle::extent_type length,
+                                             file_handle::extent_type destoffsetdiff, bool elide_zeros, bool parallel, deadline d) noexcept
+  {
+    using extent_type = file_handle::extent_type;
+    const size_t blocksize = utils::file_buffer_default_size();
+    auto copy_block = [&](byte *buffer, extent_type blockoffset, size_t blocklength, deadline nd) -> result<void> {
+      file_handle::buffer_type b(buffer, blocklength);
+      OUTCOME_TRY(auto &&readed, src.read({{&b, 1}, blockoffset}, nd));
+      if(readed.front().size() != blocklength)
+      {
+        return errc::resource_unavailable_try_again;  // something is wrong
+      }
+      const char *ds = (const char *) buffer, *e = (const char *) buffer + blocklength, *zs = nullptr, *ze = nullptr;
+      while(ds < e)
+      {
+        zs = e;
+        if(elide_zeros)
+        {
+          // Take zs to the start of the next run of zero bytes of at least 1Kb, or the end
+          for(zs = ds; zs < e; zs = ze + 1)
+          {
+            for(; zs < e && *zs != 0; ++zs)
+            {
+            }
+            for(ze = zs; ze < e && *ze == 0; ++ze)
+            {
+            }
+            if(ze - zs >= 1024 || ze == e)
+            {
+              break;
+            }
+          }
+        }
+        if(zs != ds)
+        {
+          file_handle::const_buffer_type cb((const byte *) ds, (size_t)(zs - ds));
+          OUTCOME_TRY(auto &&written, dest.write({{&cb, 1}, blockoffset + (ds - (const char *) buffer) + destoffsetdiff}, nd));
+          if(written.front().size() != cb.size())
+          {
+            return errc::resource_unavailable_try_again;  // something is wrong
+          }
+        }
+        // Skip the run of zero bytes
+        for(ds = zs; ds < e && *ds == 0; ++ds)
+        {
+        }
+      }
+      return success();
+    };
+    const auto blocks = static_cast<size_t>((length + blocksize - 1) / blocksize);
+    size_t threads = 1;
+    if(parallel && !d && blocks > 1)
+    {
+      threads = (std::min)({(size_t) std::thread::hardware_concurrency(), blocks, (size_t) 4});
+    }
+#ifdef __cpp_exceptions
+    try
+    {
+#endif
+      if(threads <= 1)
+      {
+        LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+        byte *buffer = utils::page_allocator<byte>().allocate(blocksize);
+        auto unbufferh = make_scope_exit([buffer, blocksize]() noexcept { utils::page_allocator<byte>().deallocate(buffer, blocksize); });
+        (void) unbufferh;
+        for(extent_type done = 0; done < length;)
+        {
+          deadline nd;
+          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+          const auto thisblock = (size_t) (std::min)((extent_type) blocksize, length - done);
+          OUTCOME_TRY(copy_block(buffer, offset + done, thisblock, nd));
+          done += thisblock;
+          LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        }
+        return success();
+      }
+      std::atomic<size_t> next{0};
+      std::mutex lock;
+      result<void> ret(success());
+      auto worker = [&]() noexcept {
+        byte *buffer = nullptr;
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+          buffer = utils::page_allocator<byte>().allocate(blocksize);
+#ifdef __cpp_exceptions
+        }
+        catch(...)
+        {
+          std::lock_guard<std::mutex> g(lock);
+          ret = error_from_exception();
+          next = blocks;
+          return;
+        }
+#endif
+        for(size_t block; (block = next.fetch_add(1, std::memory_order_relaxed)) < blocks;)
+        {
+          const extent_type blockoffset = (extent_type) block * blocksize;
+          auto r = copy_block(buffer, offset + blockoffset, (size_t) (std::min)((extent_type) blocksize, length - blockoffset), {});
+          if(!r)
+          {
+            std::lock_guard<std::mutex> g(lock);
+            if(ret)
+            {
+              ret = std::move(r);
+            }
+            next = blocks;
+          }
+        }
+        utils::page_allocator<byte>().deallocate(buffer, blocksize);
+      };
+      std::vector<std::thread> pool;
+      pool.reserve(threads - 1);
+      for(size_t n = 1; n < threads; n++)
+      {
+#ifdef __cpp_exceptions
+        try
+        {
+#endif
+          pool.emplace_back(worker);
+#ifdef __cpp_exceptions
+        }
+        catch(...)
+        {
+          break;  // make do with the threads we have
+        }
+#endif
+      }
+      worker();
+      for(auto &t : pool)
+      {
+        t.join();
+      }
+      return ret;
+#ifdef __cpp_exceptions
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+#endif
+  }
+}  // namespace detail
+
+file_handle::io_result<file_handle::buffers_type> file_handle::_do_read(io_request<buffers_type> reqs, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(!_v.requires_aligned_io() || !(_flags & flag::bounce_unaligned_io))
+  {
+    return io_handle::_do_read(reqs, d);
+  }
+  const size_t alignment = utils::page_size();
+  bool aligned = detail::file_handle_io_is_aligned(static_cast<uintptr_t>(reqs.offset), alignment);
+  for(size_t n = 0; aligned && n < reqs.buffers.size(); n++)
+  {
+    aligned = detail::file_handle_io_is_aligned(reinterpret_cast<uintptr_t>(reqs.buffers[n].data()), alignment) &&
+              detail::file_handle_io_is_aligned(reqs.buffers[n].size(), alignment);
+  }
+  if(aligned)
+  {
+    return io_handle::_do_read(reqs, d);
+  }
+  detail::file_handle_bounce_buffers::lease bounce;
+  // Reads [offset, offset + length) through the bounce buffer, returning the bytes read
+  auto bounce_read = [&](byte *data, size_type length, extent_type offset) -> result<size_type> {
+    if(bounce.p == nullptr)
+    {
+      return errc::not_enough_memory;
+    }
+    size_type done = 0;
+    while(length > 0)
+    {
+      const extent_type block = offset & ~static_cast<extent_type>(alignment - 1);
+      const auto skip = static_cast<size_type>(offset - block);
+      const auto amount = (std::min)(size_t(detail::file_handle_bounce_buffers::chunk_size), utils::round_up_to_page_size(skip + length, alignment));
+      buffer_type b(bounce.p, amount);
+      OUTCOME_TRY(auto &&read, io_handle::_do_read(io_request<buffers_type>(buffers_type(&b, 1), block), d));
+      const size_type got = read.empty() ? 0 : read[0].size();
+      if(got <= skip)
+      {
+        break;
+      }
+      const auto bytes = (std::min)(got - skip, length);
+      memcpy(data, bounce.p + skip, bytes);
+      data += bytes;
+      length -= bytes;
+      offset += bytes;
+      done += bytes;
+      if(got < amount)
+      {
+        break;
+      }
+    }
+    return done;
+  };
+  extent_type offset = reqs.offset;
+  for(size_t n = 0; n < reqs.buffers.size(); n++)
+  {
+    auto &buffer = reqs.buffers[n];
+    size_type filled = 0;
+    const auto mask = static_cast<extent_type>(alignment - 1);
+    const extent_type core_begin = (offset + mask) & ~mask;
+    const extent_type core_end = (offset + buffer.size()) & ~mask;
+    if(core_end > core_begin && detail::file_handle_io_is_aligned(reinterpret_cast<uintptr_t>(buffer.data() + (core_begin - offset)), alignment))
+    {
+      // Read the aligned core directly into the caller's buffer, bouncing only the edges
+      const auto head = static_cast<size_type>(core_begin - offset);
+      OUTCOME_TRY(auto &&headread, bounce_read(buffer.data(), head, offset));
+      filled = headread;
+      if(filled == head)
+      {
+        buffer_type b(buffer.data() + head, static_cast<size_type>(core_end - core_begin));
+        OUTCOME_TRY(auto &&read, io_handle::_do_read(io_request<buffers_type>(buffers_type(&b, 1), core_begin), d));
+        const size_type got = read.empty() ? 0 : read[0].size();
+        filled += got;
+        if(got == b.size())
+        {
+          const auto tail = static_cast<size_type>(offset + buffer.size() - core_end);
+          OUTCOME_TRY(auto &&tailread, bounce_read(buffer.data() + filled, tail, core_end));
+          filled += tailread;
+        }
+      }
+    }
+    else
+    {
+      OUTCOME_TRY(auto &&read, bounce_read(buffer.data(), buffer.size(), offset));
+      filled = read;
+    }
+    offset += filled;
+    if(filled < buffer.size())
+    {
+      buffer = {buffer.data(), filled};
+      reqs.buffers = {reqs.buffers.data(), n + 1};
+      break;
+    }
+  }
+  return {reqs.buffers};
+}
+
+file_handle::io_result<file_handle::const_buffers_type> file_handle::_do_write(io_request<const_buffers_type> reqs, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(!_v.requires_aligned_io() || !(_flags & flag::bounce_unaligned_io))
+  {
+    return io_handle::_do_write(reqs, d);
+  }
+  const size_t alignment = utils::page_size();
+  bool aligned = detail::file_handle_io_is_aligned(static_cast<uintptr_t>(reqs.offset), alignment);
+  for(size_t n = 0; aligned && n < reqs.buffers.size(); n++)
+  {
+    aligned = detail::file_handle_io_is_aligned(reinterpret_cast<uintptr_t>(reqs.buffers[n].data()), alignment) &&
+              detail::file_handle_io_is_aligned(reqs.buffers[n].size(), alignment);
+  }
+  if(aligned)
+  {
+    return io_handle::_do_write(reqs, d);
+  }
+  detail::file_handle_bounce_buffers::lease bounce;
+  /* Writes [offset, offset + length) through the bounce buffer, reading in any partially
+  overwritten blocks first. Blocks which straddled the end of the file are written whole,
+  so the file is truncated back to its proper length afterwards.
+  */
+  auto bounce_write = [&](const byte *data, size_type length, extent_type offset) -> result<size_type> {
+    if(bounce.p == nullptr)
+    {
+      return errc::not_enough_memory;
+    }
+    size_type done = 0;
+    extent_type end_of_file = (extent_type) -1, written_end = 0;
+    while(length > 0)
+    {
+      const extent_type block = offset & ~static_cast<extent_type>(alignment - 1);
+      const auto skip = static_cast<size_type>(offset - block);
+      const auto amount = (std::min)(size_t(detail::file_handle_bounce_buffers::chunk_size), utils::round_up_to_page_size(skip + length, alignment));
+      const auto bytes = (std::min)(amount - skip, length);
+      if(skip != 0 || bytes != amount)
+      {
+        buffer_type b(bounce.p, amount);
+        OUTCOME_TRY(auto &&read, io_handle::_do_read(io_request<buffers_type>(buffers_type(&b, 1), block), d));
+        const size_type got = read.empty() ? 0 : read[0].size();
+        if(got < amount)
+        {
+          memset(bounce.p + got, 0, amount - got);
+          end_of_file = (std::min)(end_of_file, block + got);
+        }
+      }
+      memcpy(bounce.p + skip, data, bytes);
+      const_buffer_type b(bounce.p, amount);
+      OUTCOME_TRY(auto &&written, io_handle::_do_write(io_request<const_buffers_type>(const_buffers_type(&b, 1), block), d));
+      const size_type put = written.empty() ? 0 : written[0].size();
+      written_end = (std::max)(written_end, block + put);
+      if(put < skip + bytes)
+      {
+        done += (put > skip) ? (put - skip) : 0;
+        break;
+      }
+      data += bytes;
+      length -= bytes;
+      offset += bytes;
+      done += bytes;
+    }
+    if(end_of_file != (extent_type) -1)
+    {
+      const auto newlength = (std::max)(end_of_file, offset);
+      if(newlength < written_end)
+      {
+        OUTCOME_TRYV(file_handle::truncate(newlength));
+      }
+    }
+    return done;
+  };
+  extent_type offset = reqs.offset;
+  for(size_t n = 0; n < reqs.buffers.size(); n++)
+  {
+    auto &buffer = reqs.buffers[n];
+    size_type put = 0;
+    const auto mask = static_cast<extent_type>(alignment - 1);
+    const extent_type core_begin = (offset + mask) & ~mask;
+    const extent_type core_end = (offset + buffer.size()) & ~mask;
+    if(core_end > core_begin && detail::file_handle_io_is_aligned(reinterpret_cast<uintptr_t>(buffer.data() + (core_begin - offset)), alignment))
+    {
+      // Write the aligned core directly from the caller's buffer, read-modify-writing only the edges
+      const auto head = static_cast<size_type>(core_begin - offset);
+      OUTCOME_TRY(auto &&headwritten, bounce_write(buffer.data(), head, offset));
+      put = headwritten;
+      if(put == head)
+      {
+        const_buffer_type b(buffer.data() + head, static_cast<size_type>(core_end - core_begin));
+        OUTCOME_TRY(auto &&written, io_handle::_do_write(io_request<const_buffers_type>(const_buffers_type(&b, 1), core_begin), d));
+        const size_type got = written.empty() ? 0 : written[0].size();
+        put += got;
+        if(got == b.size())
+        {
+          const auto tail = static_cast<size_type>(offset + buffer.size() - core_end);
+          OUTCOME_TRY(auto &&tailwritten, bounce_write(buffer.data() + put, tail, core_end));
+          put += tailwritten;
+        }
+      }
+    }
+    else
+    {
+      OUTCOME_TRY(auto &&written, bounce_write(buffer.data(), buffer.size(), offset));
+      put = written;
+    }
+    offset += put;
+    if(put < buffer.size())
+    {
+      buffer = {buffer.data(), put};
+      reqs.buffers = {reqs.buffers.data(), n + 1};
+      break;
+    }
+  }
+  return {reqs.buffers};
+}
+
+namespace detail
+{
+  struct file_handle_pool_key_
+  {
+    uint64_t dev{0}, ino{0};
+    file_handle::caching caching{file_handle::caching::unchanged};
+    bool operator==(const file_handle_pool_key_ &o) const noexcept { return dev == o.dev && ino == o.ino && caching == o.caching; }
+  };
+  struct file_handle_pool_key_hasher_
+  {
+    size_t operator()(const file_handle_pool_key_ &k) const noexcept
+    {
+      return static_cast<size_t>((k.ino * 0x9E3779B97F4A7C15ULL) ^ k.dev ^ (static_cast<uint64_t>(k.caching) << 56U));
+    }
+  };
+  struct file_handle_pool_entry_
+  {
+    file_handle h;
+    file_handle_pool_key_ key;
+    size_t users{0};
+    file_handle_pool_entry_ *idle_prev{nullptr}, *idle_next{nullptr};  // within the shard's list of idle handles
+  };
+  struct file_handle_pool_shard_
+  {
+    std::mutex lock;
+    std::unordered_map<file_handle_pool_key_, std::unique_ptr<file_handle_pool_entry_>, file_handle_pool_key_hasher_> entries;
+    // Those with no users, most recently released first
+    file_handle_pool_entry_ *idle_head{nullptr}, *idle_tail{nullptr};
+    size_t idle_count{0};
+
+    void idle_remove(file_handle_pool_entry_ *p) noexcept
+    {
+      (p->idle_prev != nullptr ? p->idle_prev->idle_next : idle_head) = p->idle_next;
+      (p->idle_next != nullptr ? p->idle_next->idle_prev : idle_tail) = p->idle_prev;
+      p->idle_prev = p->idle_next = nullptr;
+      --idle_count;
+    }
+    void idle_push_front(file_handle_pool_entry_ *p) noexcept
+    {
+      p->idle_prev = nullptr;
+      p->idle_next = idle_head;
+      (idle_head != nullptr ? idle_head->idle_prev : idle_tail) = p;
+      idle_head = p;
+      ++idle_count;
+    }
+    // Closes the least recently released idle handles until no more than max_idle remain
+    void idle_trim(size_t max_idle) noexcept
+    {
+      while(idle_count > max_idle && idle_tail != nullptr)
+      {
+        auto *victim = idle_tail;
+        idle_remove(victim);
+        (void) victim->h.close();
+        entries.erase(victim->key);
+      }
+    }
+    // Returns the entry for `key` with a new user, or null
+    file_handle_pool_entry_ *find(const file_handle_pool_key_ &key) noexcept
+    {
+      std::lock_guard<std::mutex> g(lock);
+      auto it = entries.find(key);
+      if(it == entries.end())
+      {
+        return nullptr;
+      }
+      auto *e = it->second.get();
+      if(e->users++ == 0)
+      {
+        idle_remove(e);
+      }
+      return e;
+    }
+  };
+  struct file_handle_pool_
+  {
+    static constexpr size_t shards_count = 16;
+    std::atomic<size_t> max_idle{64};
+    file_handle_pool_shard_ shards[shards_count];
+
+    file_handle_pool_shard_ &shard_for(const file_handle_pool_key_ &k) noexcept { return shards[file_handle_pool_key_hasher_()(k) % shards_count]; }
+    size_t max_idle_per_shard() const noexcept
+    {
+      const size_t v = max_idle.load(std::memory_order_relaxed);
+      return (v == 0) ? 0 : (std::max)(v / shards_count, (size_t) 1);
+    }
+  };
+  inline file_handle_pool_ &file_handle_pool()
+  {
+    // Never destroyed, as pooled handles may be released during static deinitialisation
+    static file_handle_pool_ *v = new file_handle_pool_;
+    return *v;
+  }
+  inline void file_handle_pool_release(file_handle_pool_shard_ &shard, file_handle_pool_entry_ *e) noexcept
+  {
+    auto &pool = file_handle_pool();
+    std::lock_guard<std::mutex> g(shard.lock);
+    if(--e->users == 0)
+    {
+      shard.idle_push_front(e);
+      shard.idle_trim(pool.max_idle_per_shard());
+    }
+  }
+  // Adds `h` to the pool as `key` unless another thread raced us to, returning the entry with a new user
+  inline result<file_handle_pool_entry_ *> file_handle_pool_insert(file_handle_pool_shard_ &shard, const file_handle_pool_key_ &key, file_handle &&h) noexcept
+  {
+    try
+    {
+      auto n = std::make_unique<file_handle_pool_entry_>();
+      n->h = std::move(h);
+      n->key = key;
+      n->users = 1;
+      std::lock_guard<std::mutex> g(shard.lock);
+      auto it = shard.entries.find(key);
+      if(it != shard.entries.end())
+      {
+        auto *e = it->second.get();
+        if(e->users++ == 0)
+        {
+          shard.idle_remove(e);
+        }
+        return e;
+      }
+      auto *e = n.get();
+      shard.entries.emplace(key, std::move(n));
+      return e;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  // Hands out the new user of `e`
+  inline result<file_handle::pooled_handle> file_handle_pool_share(file_handle_pool_shard_ &shard, file_handle_pool_entry_ *e) noexcept
+  {
+    try
+    {
+      return file_handle::pooled_handle(&e->h, [&shard, e](file_handle * /*unused*/) { file_handle_pool_release(shard, e); });
+    }
+    catch(...)
+    {
+      // The deleter has already released the user
+      return error_from_exception();
+    }
+  }
+}  // namespace detail
+
+size_t set_file_handle_pool_idle_limit(size_t max_idle) noexcept
+{
+  auto &pool = detail::file_handle_pool();
+  const size_t ret = pool.max_idle.exchange(max_idle, std::memory_order_relaxed);
+  const size_t per_shard = pool.max_idle_per_shard();
+  for(auto &shard : pool.shards)
+  {
+    std::lock_guard<std::mutex> g(shard.lock);
+    shard.idle_trim(per_shard);
+  }
+  return ret;
+}
+
+result<file_handle::pooled_handle> file_handle::reopen_pooled(caching caching_) const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(caching_ == caching::unchanged)
+  {
+    caching_ = kernel_caching();
+  }
+  const detail::file_handle_pool_key_ key{st_dev(), st_ino(), caching_};
+  auto &shard = detail::file_handle_pool().shard_for(key);
+  auto *e = shard.find(key);
+  if(e == nullptr)
+  {
+    OUTCOME_TRY(auto &&h, reopen(mode::read, caching_));
+    OUTCOME_TRY(auto *inserted, detail::file_handle_pool_insert(shard, key, std::move(h)));
+    e = inserted;
+  }
+  return detail::file_handle_pool_share(shard, e);
+}
+
+result<file_handle::pooled_handle> file_handle::pooled(const path_handle &base, path_view_type path, caching _caching) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  if(_caching == caching::unchanged)
+  {
+    _caching = caching::all;
+  }
+  stat_t::fill_many_item item(path, stat_t::want::dev | stat_t::want::ino);
+  OUTCOME_TRYV(stat_t::fill_many(base, {&item, 1}));
+  OUTCOME_TRYV(item.filled);
+  const detail::file_handle_pool_key_ key{item.stat.st_dev, item.stat.st_ino, _caching};
+  auto &shard = detail::file_handle_pool().shard_for(key);
+  auto *e = shard.find(key);
+  if(e == nullptr)
+  {
+    OUTCOME_TRY(auto &&h, file(base, path, mode::read, creation::open_existing, _caching));
+    // If the path was replaced since the stat, key by what was actually opened
+    const detail::file_handle_pool_key_ opened{h.st_dev(), h.st_ino(), _caching};
+    auto &openedshard = detail::file_handle_pool().shard_for(opened);
+    OUTCOME_TRY(auto *inserted, detail::file_handle_pool_insert(openedshard, opened, std::move(h)));
+    return detail::file_handle_pool_share(openedshard, inserted);
+  }
+  return detail::file_handle_pool_share(shard, e);
+}
+
+LLFIO_V2_NAMESPACE_END
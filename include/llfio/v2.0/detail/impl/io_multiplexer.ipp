@@ -24,17 +24,420 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../io_multiplexer.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>  // for malloc
 #include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>  // for _BitScanForward
+#endif
 
 LLFIO_V2_NAMESPACE_BEGIN
 
 namespace this_thread
 {
   static LLFIO_THREAD_LOCAL io_multiplexer *_thread_multiplexer;
-  LLFIO_HEADERS_ONLY_FUNC_SPEC io_multiplexer *multiplexer() noexcept { return _thread_multiplexer; }
+  struct _automatic_multiplexer_policy_t
+  {
+    std::atomic<bool> enabled{false};
+    std::mutex lock;
+    automatic_multiplexer_config config;
+  };
+  inline _automatic_multiplexer_policy_t &_automatic_multiplexer_policy() noexcept
+  {
+    static _automatic_multiplexer_policy_t v;
+    return v;
+  }
+  // The multiplexer automatically created for this thread, destroyed when this thread exits
+  struct _automatic_multiplexer_t
+  {
+    io_multiplexer_ptr ptr;
+    bool tried{false};
+  };
+  inline io_multiplexer *_create_automatic_multiplexer() noexcept
+  {
+    static thread_local _automatic_multiplexer_t mine;
+    if(!mine.tried)
+    {
+      mine.tried = true;
+      automatic_multiplexer_config config;
+      {
+        auto &policy = _automatic_multiplexer_policy();
+        std::lock_guard<std::mutex> g(policy.lock);
+        config = policy.config;
+      }
+      result<io_multiplexer_ptr> r(errc::operation_not_supported);
+#if defined(__linux__)
+      r = multiplexer_linux_io_uring(1, config.io_uring_flags);
+      if(!r)
+      {
+        r = multiplexer_linux_epoll(1);
+      }
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+      r = multiplexer_bsd_kqueue(1, config.max_workers_per_device);
+#elif defined(_WIN32)
+      if(config.prefer_ioring)
+      {
+        r = multiplexer_win_ioring(1, config.disable_immediate_completions);
+      }
+      if(!r)
+      {
+        r = multiplexer_win_iocp(1, config.disable_immediate_completions);
+      }
+#endif
+      if(r)
+      {
+        mine.ptr = std::move(r).value();
+      }
+      else
+      {
+        (void) config;
+        LLFIO_LOG_WARN(nullptr, "this_thread::multiplexer() could not automatically create a multiplexer for this thread");
+      }
+    }
+    return mine.ptr.get();
+  }
+  LLFIO_HEADERS_ONLY_FUNC_SPEC io_multiplexer *multiplexer() noexcept
+  {
+    if(_thread_multiplexer == nullptr && _automatic_multiplexer_policy().enabled.load(std::memory_order_relaxed))
+    {
+      _thread_multiplexer = _create_automatic_multiplexer();
+    }
+    return _thread_multiplexer;
+  }
   LLFIO_HEADERS_ONLY_FUNC_SPEC void set_multiplexer(io_multiplexer *ctx) noexcept { _thread_multiplexer = ctx; }
+  LLFIO_HEADERS_ONLY_FUNC_SPEC automatic_multiplexer_config set_automatic_multiplexer(automatic_multiplexer_config config) noexcept
+  {
+    auto &policy = _automatic_multiplexer_policy();
+    std::lock_guard<std::mutex> g(policy.lock);
+    auto ret = policy.config;
+    policy.config = config;
+    policy.enabled.store(config.enabled, std::memory_order_relaxed);
+    return ret;
+  }
 }  // namespace this_thread
 
+/* Bookkeeping for the fields of check_for_any_completed_io_statistics which outlive
+any single call. The counters are atomic as some multiplexers complete i/o during
+initiation without holding their lock.
+*/
+struct io_multiplexer_completion_statistics
+{
+  using check_for_any_completed_io_statistics = io_multiplexer::check_for_any_completed_io_statistics;
+
+  std::atomic<size_t> in_flight{0};
+  std::atomic<size_t> immediate_completions{0};
+
+  static uint64_t now() noexcept { return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+
+  // An i/o was initiated and must now wait upon the system. Returns its initiation timestamp.
+  uint64_t initiated() noexcept
+  {
+    in_flight.fetch_add(1, std::memory_order_relaxed);
+    return now();
+  }
+  // An i/o completed during its initiation
+  void completed_immediately() noexcept { immediate_completions.fetch_add(1, std::memory_order_relaxed); }
+  // An in flight i/o was cancelled before the system ever saw it
+  void cancelled() noexcept { in_flight.fetch_sub(1, std::memory_order_relaxed); }
+  // An in flight i/o initiated at initiated_ns has been reaped from the system
+  void completed(check_for_any_completed_io_statistics &stats, uint64_t initiated_ns) noexcept
+  {
+    in_flight.fetch_sub(1, std::memory_order_relaxed);
+    const std::chrono::nanoseconds latency((int64_t)(now() - initiated_ns));
+    stats.submit_to_complete_latency_sum += latency;
+    if(latency > stats.submit_to_complete_latency_max)
+    {
+      stats.submit_to_complete_latency_max = latency;
+    }
+  }
+  // A batch of count completions was reaped from the system
+  static void reaped(check_for_any_completed_io_statistics &stats, size_t count) noexcept
+  {
+    if(count > 0)
+    {
+      ++stats.reaps;
+      if(count > stats.largest_reap)
+      {
+        stats.largest_reap = count;
+      }
+    }
+  }
+  // Adds the cross call fields to stats before they are returned to the caller
+  void report(check_for_any_completed_io_statistics &stats) noexcept
+  {
+    stats.initiated_ios_in_flight += in_flight.load(std::memory_order_relaxed);
+    stats.immediate_completions += immediate_completions.exchange(0, std::memory_order_relaxed);
+  }
+};
+
+/* A hierarchical timer wheel of the deadlines of in flight i/o, of four levels of 256 slots
+at millisecond resolution. Deadlines due within 256 ticks lie in the slot of the bottom
+level for their tick. Those further away lie in the slot of the lowest level whose slots
+cover them, and are cascaded down into the levels below when the wheel reaches the start
+of their slot. Deadlines beyond the reach of the top level, some 49 days, lie in its
+furthest slot and are cascaded again when reached.
+
+Arming and disarming a deadline are constant time list operations. Each level keeps a
+bitmap of its occupied slots, so advancing the wheel skips empty slots in constant time,
+and finding the next deadline to sleep until is constant time. Expired deadlines are
+popped one at a time so the caller may release its lock to complete each.
+
+The multiplexer lock must be held for all but `empty()`.
+*/
+struct io_multiplexer_timer_wheel
+{
+  using clock = std::chrono::steady_clock;
+  using resolution = std::chrono::milliseconds;
+
+  static constexpr unsigned level_bits = 8;
+  static constexpr unsigned levels = 4;
+  static constexpr unsigned slots = 1U << level_bits;
+
+  // Inherit from this to be armable. Fields are private to the wheel.
+  struct node
+  {
+    node *_wheel_prev{nullptr}, *_wheel_next{nullptr};
+    uint64_t _wheel_tick{0};
+    uint16_t _wheel_slot{0};  // level * slots + slot
+    bool _wheel_armed{false};
+  };
+
+private:
+  static constexpr unsigned _mask = slots - 1;
+  static constexpr unsigned _words = slots / 64;
+
+  clock::time_point _epoch{clock::now()};
+  // The current tick. All ticks before it have expired, and its cascade has been done.
+  uint64_t _now{0};
+  std::atomic<size_t> _count{0};
+  node *_heads[levels * slots]{};
+  uint64_t _occupied[levels][_words]{};
+
+  static unsigned _ctz(uint64_t v) noexcept
+  {
+#ifdef _MSC_VER
+    unsigned long ret;
+    if(_BitScanForward(&ret, (unsigned long) v))
+    {
+      return (unsigned) ret;
+    }
+    _BitScanForward(&ret, (unsigned long) (v >> 32));
+    return (unsigned) ret + 32;
+#else
+    return (unsigned) __builtin_ctzll(v);
+#endif
+  }
+  // The distance from slot `from` to the first occupied slot of `level` at or after it, wrapping around, else `slots`
+  unsigned _distance_to_occupied(unsigned level, unsigned from) const noexcept
+  {
+    unsigned w = from / 64;
+    for(unsigned i = 0; i <= _words; i++, w = (w + 1) % _words)
+    {
+      uint64_t bits = _occupied[level][w];
+      if(i == 0)
+      {
+        bits &= ~(uint64_t) 0 << (from % 64);
+      }
+      else if(i == _words)
+      {
+        // The part of the first word before from
+        bits &= ~(~(uint64_t) 0 << (from % 64));
+      }
+      if(bits != 0)
+      {
+        return (w * 64 + _ctz(bits) - from) & _mask;
+      }
+    }
+    return slots;
+  }
+  // The first tick after the current tick at which a deadline is due, or something is to be cascaded
+  uint64_t _next_event() const noexcept
+  {
+    uint64_t ret = (uint64_t) -1;
+    const unsigned idx0 = (unsigned) _now & _mask;
+    const unsigned d0 = _distance_to_occupied(0, (idx0 + 1) & _mask);
+    if(d0 < slots)
+    {
+      ret = _now + 1 + d0;
+    }
+    for(unsigned level = 1; level < levels; level++)
+    {
+      const unsigned shift = level_bits * level;
+      const unsigned idx = (unsigned) (_now >> shift) & _mask;
+      const unsigned d = _distance_to_occupied(level, (idx + 1) & _mask);
+      if(d < slots)
+      {
+        const uint64_t tick = ((_now >> shift) + 1 + d) << shift;
+        if(tick < ret)
+        {
+          ret = tick;
+        }
+      }
+    }
+    return ret;
+  }
+  void _insert(node *n) noexcept
+  {
+    uint64_t tick = (std::max)(n->_wheel_tick, _now);
+    const uint64_t delta = tick - _now;
+    unsigned level = 0;
+    while(level + 1 < levels && delta >= ((uint64_t) 1 << (level_bits * (level + 1))))
+    {
+      ++level;
+    }
+    if(delta >= ((uint64_t) 1 << (level_bits * levels)))
+    {
+      tick = _now + ((uint64_t) 1 << (level_bits * levels)) - 1;
+    }
+    const unsigned slot = (unsigned) (tick >> (level_bits * level)) & _mask;
+    const unsigned idx = level * slots + slot;
+    n->_wheel_slot = (uint16_t) idx;
+    n->_wheel_prev = nullptr;
+    n->_wheel_next = _heads[idx];
+    if(n->_wheel_next != nullptr)
+    {
+      n->_wheel_next->_wheel_prev = n;
+    }
+    _heads[idx] = n;
+    _occupied[level][slot / 64] |= (uint64_t) 1 << (slot % 64);
+  }
+  void _remove(node *n) noexcept
+  {
+    const unsigned idx = n->_wheel_slot;
+    if(n->_wheel_prev != nullptr)
+    {
+      n->_wheel_prev->_wheel_next = n->_wheel_next;
+    }
+    else
+    {
+      _heads[idx] = n->_wheel_next;
+      if(_heads[idx] == nullptr)
+      {
+        const unsigned slot = idx & _mask;
+        _occupied[idx / slots][slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+      }
+    }
+    if(n->_wheel_next != nullptr)
+    {
+      n->_wheel_next->_wheel_prev = n->_wheel_prev;
+    }
+    n->_wheel_prev = n->_wheel_next = nullptr;
+  }
+  // Moves the slots of the higher levels beginning at the current tick down into the levels below
+  void _cascade() noexcept
+  {
+    for(unsigned level = 1; level < levels; level++)
+    {
+      const unsigned slot = (unsigned) (_now >> (level_bits * level)) & _mask;
+      node *n = _heads[level * slots + slot];
+      _heads[level * slots + slot] = nullptr;
+      _occupied[level][slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+      while(n != nullptr)
+      {
+        node *next = n->_wheel_next;
+        _insert(n);
+        n = next;
+      }
+      if(slot != 0)
+      {
+        break;
+      }
+    }
+  }
+  uint64_t _ceil_tick(clock::time_point tp) const noexcept
+  {
+    if(tp <= _epoch)
+    {
+      return 0;
+    }
+    const auto d = tp - _epoch;
+    const auto ticks = std::chrono::duration_cast<resolution>(d);
+    return (uint64_t) ticks.count() + ((ticks < d) ? 1 : 0);
+  }
+  uint64_t _floor_tick(clock::time_point tp) const noexcept { return (tp <= _epoch) ? 0 : (uint64_t) std::chrono::duration_cast<resolution>(tp - _epoch).count(); }
+
+public:
+  // The steady clock time at which a deadline for i/o initiated now expires
+  static clock::time_point expiry(const deadline &d) noexcept
+  {
+    const auto now = clock::now();
+    if(d.steady)
+    {
+      return now + std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(d.nsecs));
+    }
+    return now + std::chrono::duration_cast<clock::duration>(d.to_time_point() - std::chrono::system_clock::now());
+  }
+
+  // May be called without the lock, in which case the answer may be stale
+  bool empty() const noexcept { return _count.load(std::memory_order_relaxed) == 0; }
+  static bool is_armed(const node *n) noexcept { return n->_wheel_armed; }
+
+  // Arms `n` to expire at `expires`. `n` must not be armed.
+  void arm(node *n, clock::time_point expires) noexcept
+  {
+    assert(!n->_wheel_armed);
+    n->_wheel_tick = _ceil_tick(expires);
+    _insert(n);
+    n->_wheel_armed = true;
+    _count.fetch_add(1, std::memory_order_relaxed);
+  }
+  // Disarms `n` if it is armed
+  void disarm(node *n) noexcept
+  {
+    if(!n->_wheel_armed)
+    {
+      return;
+    }
+    _remove(n);
+    n->_wheel_armed = false;
+    _count.fetch_sub(1, std::memory_order_relaxed);
+  }
+  // Disarms and returns an armed node whose deadline is at or before `now`, else null
+  node *pop_expired(clock::time_point now) noexcept
+  {
+    if(empty())
+    {
+      return nullptr;
+    }
+    const uint64_t target = _floor_tick(now);
+    for(;;)
+    {
+      node *n = _heads[_now & _mask];
+      if(n != nullptr && _now <= target)
+      {
+        _remove(n);
+        n->_wheel_armed = false;
+        _count.fetch_sub(1, std::memory_order_relaxed);
+        return n;
+      }
+      const uint64_t next = _next_event();
+      if(next > target)
+      {
+        return nullptr;
+      }
+      _now = next;
+      if((_now & _mask) == 0)
+      {
+        _cascade();
+      }
+    }
+  }
+  // When the wheel next needs advancing, which is no later than the next deadline to expire
+  clock::time_point next_expiry() const noexcept
+  {
+    if(empty())
+    {
+      return (clock::time_point::max)();
+    }
+    const uint64_t tick = (_heads[_now & _mask] != nullptr) ? _now : _next_event();
+    return _epoch + std::chrono::duration_cast<clock::duration>(resolution((resolution::rep) tick));
+  }
+};
+
 template <bool is_threadsafe> struct io_multiplexer_impl : io_multiplexer
 {
   struct _lock_impl_type
@@ -44,12 +447,241 @@ template <bool is_threadsafe> struct io_multiplexer_impl : io_multiplexer
   };
   _lock_impl_type _lock;
   using _lock_guard = std::unique_lock<_lock_impl_type>;
+  io_multiplexer_completion_statistics _completion_stats;
 };
 template <> struct io_multiplexer_impl<true> : io_multiplexer
 {
   using _lock_impl_type = std::mutex;
   _lock_impl_type _lock;
   using _lock_guard = std::unique_lock<_lock_impl_type>;
+  io_multiplexer_completion_statistics _completion_stats;
 };
 
+/* Storage for i/o operation states is carved from slabs of equally sized blocks. Each
+block begins with a cache line sized header recording the thread free list which owns it,
+so the storage handed out is cache line aligned, and blocks never share cache lines.
+
+Each thread using the pool gets its own free list. A thread pops from and pushes to its
+own list without atomics. Blocks freed by threads other than their owner are pushed onto
+the owner's remote list, which is a lock-free stack which is only ever pushed to, or
+taken whole by the owner when its own list runs dry. As nothing is ever popped singly
+from the remote list, there is no ABA problem. Only growing the pool takes the lock.
+*/
+struct io_multiplexer::_io_operation_state_pool
+{
+  static constexpr size_t _cache_line = 64;
+  static constexpr size_t _slab_bytes = 65536;
+
+  struct _list;
+  struct _block_header
+  {
+    _list *owner;
+    _block_header *next;
+  };
+  struct _list
+  {
+    _block_header *local{nullptr};                  // only touched by the owning thread
+    char _pad1[_cache_line - sizeof(_block_header *)];
+    std::atomic<_block_header *> remote{nullptr};  // pushed to by any other thread
+    char _pad2[_cache_line - sizeof(std::atomic<_block_header *>)];
+    std::thread::id thread;
+  };
+
+  // Distinguishes pools allocated at the same address across time, for the thread local caches
+  static uint64_t _next_generation() noexcept
+  {
+    static std::atomic<uint64_t> v{1};
+    return v.fetch_add(1, std::memory_order_relaxed);
+  }
+  struct _thread_cache_t
+  {
+    const _io_operation_state_pool *pool;
+    uint64_t generation;
+    _list *list;
+  };
+  static _thread_cache_t &_thread_cache() noexcept
+  {
+    static LLFIO_THREAD_LOCAL _thread_cache_t v;
+    return v;
+  }
+
+  const uint64_t generation{_next_generation()};
+  const size_t header_size, block_size, storage_size;
+  std::mutex lock;
+  std::vector<void *> allocations;  // every malloc made by the pool
+  std::vector<_list *> lists;
+
+  _io_operation_state_pool(std::pair<size_t, size_t> reqs)
+      : header_size((reqs.second > _cache_line) ? reqs.second : _cache_line)
+      , block_size(header_size + ((reqs.first + header_size - 1) & ~(header_size - 1)))
+      , storage_size(block_size - header_size)
+  {
+  }
+  _io_operation_state_pool(const _io_operation_state_pool &) = delete;
+  _io_operation_state_pool(_io_operation_state_pool &&) = delete;
+  _io_operation_state_pool &operator=(const _io_operation_state_pool &) = delete;
+  _io_operation_state_pool &operator=(_io_operation_state_pool &&) = delete;
+  ~_io_operation_state_pool()
+  {
+    for(auto *i : allocations)
+    {
+      ::free(i);
+    }
+  }
+
+  // Must be called with the lock held. Returns null if out of memory.
+  void *_aligned_malloc(size_t bytes, size_t align) noexcept
+  {
+    try
+    {
+      allocations.reserve(allocations.size() + 1);
+    }
+    catch(...)
+    {
+      return nullptr;
+    }
+    auto *raw = ::malloc(bytes + align);
+    if(raw == nullptr)
+    {
+      return nullptr;
+    }
+    allocations.push_back(raw);
+    return (void *) (((uintptr_t) raw + align - 1) & ~(uintptr_t)(align - 1));
+  }
+
+  // The calling thread's list, if it already has one
+  _list *_this_thread_list_if_cached() const noexcept
+  {
+    auto &c = _thread_cache();
+    return (c.pool == this && c.generation == generation) ? c.list : nullptr;
+  }
+  _list *_this_thread_list() noexcept
+  {
+    if(auto *l = _this_thread_list_if_cached())
+    {
+      return l;
+    }
+    const auto id = std::this_thread::get_id();
+    std::lock_guard<std::mutex> g(lock);
+    _list *l = nullptr;
+    for(auto *i : lists)
+    {
+      // A new thread with the id of an exited thread adopts its free blocks
+      if(i->thread == id)
+      {
+        l = i;
+        break;
+      }
+    }
+    if(l == nullptr)
+    {
+      try
+      {
+        lists.reserve(lists.size() + 1);
+      }
+      catch(...)
+      {
+        return nullptr;
+      }
+      auto *mem = _aligned_malloc(sizeof(_list), _cache_line);
+      if(mem == nullptr)
+      {
+        return nullptr;
+      }
+      l = new(mem) _list;
+      l->thread = id;
+      lists.push_back(l);
+    }
+    _thread_cache() = {this, generation, l};
+    return l;
+  }
+
+  result<span<byte>> allocate() noexcept
+  {
+    _list *l = _this_thread_list();
+    if(l == nullptr)
+    {
+      return errc::not_enough_memory;
+    }
+    if(l->local == nullptr)
+    {
+      l->local = l->remote.exchange(nullptr, std::memory_order_acquire);
+      if(l->local == nullptr)
+      {
+        std::lock_guard<std::mutex> g(lock);
+        const size_t count = (_slab_bytes > block_size * 4) ? (_slab_bytes / block_size) : 4;
+        auto *slab = (byte *) _aligned_malloc(block_size * count, header_size);
+        if(slab == nullptr)
+        {
+          return errc::not_enough_memory;
+        }
+        for(size_t n = count; n > 0; n--)
+        {
+          auto *h = reinterpret_cast<_block_header *>(slab + (n - 1) * block_size);
+          h->owner = l;
+          h->next = l->local;
+          l->local = h;
+        }
+      }
+    }
+    _block_header *h = l->local;
+    l->local = h->next;
+    return span<byte>(reinterpret_cast<byte *>(h) + header_size, storage_size);
+  }
+
+  void deallocate(span<byte> storage) noexcept
+  {
+    auto *h = reinterpret_cast<_block_header *>(storage.data() - header_size);
+    _list *l = h->owner;
+    if(l == _this_thread_list_if_cached())
+    {
+      h->next = l->local;
+      l->local = h;
+      return;
+    }
+    h->next = l->remote.load(std::memory_order_relaxed);
+    while(!l->remote.compare_exchange_weak(h->next, h, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+  }
+};
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC io_multiplexer::_io_operation_state_pool_ptr::~_io_operation_state_pool_ptr()
+{
+  delete v.load(std::memory_order_acquire);
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<span<byte>> io_multiplexer::allocate_io_operation_state_storage() noexcept
+{
+  auto *pool = _state_pool.v.load(std::memory_order_acquire);
+  if(pool == nullptr)
+  {
+    try
+    {
+      auto *newpool = new _io_operation_state_pool(io_state_requirements());
+      if(_state_pool.v.compare_exchange_strong(pool, newpool, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        pool = newpool;
+      }
+      else
+      {
+        // Another thread installed one first
+        delete newpool;
+      }
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  return pool->allocate();
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void io_multiplexer::deallocate_io_operation_state_storage(span<byte> storage) noexcept
+{
+  auto *pool = _state_pool.v.load(std::memory_order_acquire);
+  assert(pool != nullptr);
+  pool->deallocate(storage);
+}
+
 LLFIO_V2_NAMESPACE_END
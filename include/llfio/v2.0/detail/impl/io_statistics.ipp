@@ -0,0 +1,172 @@
+/* Per-handle i/o statistics
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../io_handle.hpp"
+
+#if LLFIO_ENABLE_IO_STATISTICS
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+#if LLFIO_ENABLE_IO_STATISTICS
+namespace detail
+{
+  /* Each thread records statistics into its own shard, whose lock is only ever
+  contended by threads retrieving or resetting statistics. Shards are never freed,
+  so the statistics recorded by exited threads are retained.
+  */
+  struct io_statistics_shard
+  {
+    std::mutex lock;
+    std::unordered_map<const io_handle *, io_handle::io_statistics> handles;
+  };
+  struct io_statistics_shards
+  {
+    std::mutex lock;
+    std::vector<std::unique_ptr<io_statistics_shard>> shards;
+  };
+  inline io_statistics_shards &all_io_statistics_shards() noexcept
+  {
+    static io_statistics_shards v;
+    return v;
+  }
+  // Returns null if out of memory
+  inline io_statistics_shard *this_thread_io_statistics_shard() noexcept
+  {
+    static LLFIO_THREAD_LOCAL io_statistics_shard *v;
+    if(v == nullptr)
+    {
+      try
+      {
+        auto &all = all_io_statistics_shards();
+        auto shard = std::make_unique<io_statistics_shard>();
+        std::lock_guard<std::mutex> g(all.lock);
+        all.shards.push_back(std::move(shard));
+        v = all.shards.back().get();
+      }
+      catch(...)
+      {
+        return nullptr;
+      }
+    }
+    return v;
+  }
+}  // namespace detail
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void io_handle::_record_statistics(io_statistics::counters io_statistics::*which, bool failed, size_type requested,
+                                                                   size_type transferred, std::chrono::steady_clock::duration took) const noexcept
+{
+  auto *shard = detail::this_thread_io_statistics_shard();
+  if(shard == nullptr)
+  {
+    return;
+  }
+  size_t bucket = 0;
+  for(auto ns = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(took).count(); ns > 1 && bucket < 31; ns >>= 1)
+  {
+    bucket++;
+  }
+  try
+  {
+    std::lock_guard<std::mutex> g(shard->lock);
+    auto &c = shard->handles[this].*which;
+    c.ops++;
+    c.latency_histogram[bucket]++;
+    if(failed)
+    {
+      c.failures++;
+    }
+    else if(which != &io_statistics::barriers)
+    {
+      c.bytes += transferred;
+      if(transferred < requested)
+      {
+        c.short_transfers++;
+      }
+    }
+  }
+  catch(...)
+  {
+    // Statistics are best effort
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void io_handle::_forget_statistics() const noexcept
+{
+  auto &all = detail::all_io_statistics_shards();
+  std::lock_guard<std::mutex> g(all.lock);
+  for(auto &shard : all.shards)
+  {
+    std::lock_guard<std::mutex> g2(shard->lock);
+    shard->handles.erase(this);
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC io_handle::io_statistics io_handle::statistics() const noexcept
+{
+  io_statistics ret;
+  auto accumulate = [](io_statistics::counters &to, const io_statistics::counters &from) {
+    to.ops += from.ops;
+    to.failures += from.failures;
+    to.bytes += from.bytes;
+    to.short_transfers += from.short_transfers;
+    for(size_t n = 0; n < 32; n++)
+    {
+      to.latency_histogram[n] += from.latency_histogram[n];
+    }
+  };
+  auto &all = detail::all_io_statistics_shards();
+  std::lock_guard<std::mutex> g(all.lock);
+  for(auto &shard : all.shards)
+  {
+    std::lock_guard<std::mutex> g2(shard->lock);
+    auto it = shard->handles.find(this);
+    if(it != shard->handles.end())
+    {
+      accumulate(ret.reads, it->second.reads);
+      accumulate(ret.writes, it->second.writes);
+      accumulate(ret.barriers, it->second.barriers);
+    }
+  }
+  return ret;
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void io_handle::reset_statistics() noexcept
+{
+  _forget_statistics();
+}
+#else
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC io_handle::io_statistics io_handle::statistics() const noexcept
+{
+  return {};
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void io_handle::reset_statistics() noexcept {}
+#endif
+
+LLFIO_V2_NAMESPACE_END
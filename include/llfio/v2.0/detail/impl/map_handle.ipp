@@ -0,0 +1,680 @@
+/* A handle to a source of mapped memory
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../map_handle.hpp"
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace this_thread
+{
+  static LLFIO_THREAD_LOCAL numa_placement _thread_numa_placement;
+  LLFIO_HEADERS_ONLY_FUNC_SPEC numa_placement current_numa_placement() noexcept { return _thread_numa_placement; }
+  LLFIO_HEADERS_ONLY_FUNC_SPEC numa_placement set_numa_placement(numa_placement placement) noexcept
+  {
+    const auto ret = _thread_numa_placement;
+    _thread_numa_placement = placement;
+    return ret;
+  }
+}  // namespace this_thread
+
+namespace detail
+{
+  // Copies a buffer into a map by map_handle::write(). Copies of the common record sizes are of a
+  // size fixed at compile time, so they become a few register moves rather than a call to memcpy()
+  inline void map_handle_copy_in(byte *dest, const byte *src, size_t bytes, bool nontemporal) noexcept
+  {
+    switch(bytes)
+    {
+    case 8:
+      memcpy(dest, src, 8);
+      return;
+    case 16:
+      memcpy(dest, src, 16);
+      return;
+    case 32:
+      memcpy(dest, src, 32);
+      return;
+    case 64:
+      memcpy(dest, src, 64);
+      return;
+    default:
+      break;
+    }
+    if(nontemporal && bytes >= utils::page_size())
+    {
+      utils::memcpy_nontemporal(dest, src, bytes);
+      return;
+    }
+    memcpy(dest, src, bytes);
+  }
+
+  // The cache line flush instructions which the running CPU supports, chosen once
+  struct nvram_flush_instructions
+  {
+    enum class instruction
+    {
+      none,
+      clflush,
+      clflushopt,
+      clwb,
+      dc_cvac,
+      dc_cvap
+    };
+    instruction retain{instruction::none}, evict{instruction::none};
+    size_t cache_line_size{64};
+
+    nvram_flush_instructions() noexcept
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+      unsigned leaf1[4] = {0, 0, 0, 0}, leaf7[4] = {0, 0, 0, 0};
+#ifdef _MSC_VER
+      int regs[4];
+      __cpuid(regs, 0);
+      const unsigned maxleaf = (unsigned) regs[0];
+      __cpuid(regs, 1);
+      for(size_t n = 0; n < 4; n++)
+      {
+        leaf1[n] = (unsigned) regs[n];
+      }
+      if(maxleaf >= 7)
+      {
+        __cpuidex(regs, 7, 0);
+        for(size_t n = 0; n < 4; n++)
+        {
+          leaf7[n] = (unsigned) regs[n];
+        }
+      }
+#else
+      const unsigned maxleaf = __get_cpuid_max(0, nullptr);
+      __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+      if(maxleaf >= 7)
+      {
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+      }
+#endif
+      if((leaf1[3] >> 19) & 1)  // CLFSH
+      {
+        retain = evict = instruction::clflush;
+        cache_line_size = ((leaf1[1] >> 8) & 0xff) * 8;
+        if(cache_line_size == 0)
+        {
+          cache_line_size = 64;
+        }
+      }
+      if((leaf7[1] >> 23) & 1)  // CLFLUSHOPT
+      {
+        retain = evict = instruction::clflushopt;
+      }
+      if((leaf7[1] >> 24) & 1)  // CLWB
+      {
+        retain = instruction::clwb;
+      }
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+      uint64_t ctr;
+      __asm__ __volatile__("mrs %0, ctr_el0" : "=r"(ctr));
+      cache_line_size = size_t(4) << ((ctr >> 16) & 15);
+      retain = evict = instruction::dc_cvac;
+#ifdef __linux__
+      if((getauxval(AT_HWCAP) >> 16) & 1)  // HWCAP_DCPOP
+      {
+        retain = evict = instruction::dc_cvap;
+      }
+#endif
+#endif
+    }
+
+    static void flush(instruction i, const byte *addr, size_t bytes, size_t cache_line_size) noexcept
+    {
+      const byte *end = addr + bytes;
+      switch(i)
+      {
+      case instruction::none:
+        break;
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+      case instruction::clflush:
+        for(; addr < end; addr += cache_line_size)
+        {
+          _mm_clflush(addr);
+        }
+        break;
+      case instruction::clflushopt:
+        for(; addr < end; addr += cache_line_size)
+        {
+          _mm_clflushopt((void *) addr);
+        }
+        break;
+      case instruction::clwb:
+        for(; addr < end; addr += cache_line_size)
+        {
+          _mm_clwb((void *) addr);
+        }
+        break;
+#else
+      // Encoded by hand so no particular -march is needed to compile them
+      case instruction::clflush:
+        for(; addr < end; addr += cache_line_size)
+        {
+          __asm__ __volatile__("clflush %0" : "+m"(*(volatile char *) addr));
+        }
+        break;
+      case instruction::clflushopt:
+        for(; addr < end; addr += cache_line_size)
+        {
+          __asm__ __volatile__(".byte 0x66; clflush %0" : "+m"(*(volatile char *) addr));
+        }
+        break;
+      case instruction::clwb:
+        for(; addr < end; addr += cache_line_size)
+        {
+          __asm__ __volatile__(".byte 0x66; xsaveopt %0" : "+m"(*(volatile char *) addr));
+        }
+        break;
+#endif
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+      case instruction::dc_cvac:
+        for(; addr < end; addr += cache_line_size)
+        {
+          __asm__ __volatile__("dc cvac, %0" : : "r"(addr) : "memory");
+        }
+        break;
+      case instruction::dc_cvap:
+        for(; addr < end; addr += cache_line_size)
+        {
+          __asm__ __volatile__("sys #3, c7, c12, #1, %0" : : "r"(addr) : "memory");  // DC CVAP
+        }
+        break;
+#endif
+      default:
+        break;
+      }
+    }
+
+    static void fence() noexcept
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#ifdef _MSC_VER
+      _mm_sfence();
+#else
+      __asm__ __volatile__("sfence" : : : "memory");
+#endif
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+      __asm__ __volatile__("dsb ish" : : : "memory");
+#endif
+    }
+  };
+  inline const nvram_flush_instructions &nvram_flush_instructions_available() noexcept
+  {
+    static const nvram_flush_instructions v;
+    return v;
+  }
+
+  /* The extents of a section modified since they were last flushed, as a set of
+  non-overlapping, non-adjacent [begin, end) offsets.
+  */
+  struct section_handle_dirty_ranges
+  {
+    using extent_type = handle::extent_type;
+
+    std::mutex lock;
+    std::map<extent_type, extent_type> ranges;
+    bool overflowed{false};  // tracking failed, so everything must be flushed
+
+    void add(extent_type begin, extent_type end) noexcept
+    {
+      std::lock_guard<std::mutex> g(lock);
+      if(overflowed || begin >= end)
+      {
+        return;
+      }
+      // Coalesce with any overlapping or adjacent ranges
+      auto it = ranges.upper_bound(begin);
+      if(it != ranges.begin() && std::prev(it)->second >= begin)
+      {
+        --it;
+        begin = it->first;
+      }
+      while(it != ranges.end() && it->first <= end)
+      {
+        end = std::max(end, it->second);
+        it = ranges.erase(it);
+      }
+      try
+      {
+        ranges.emplace_hint(it, begin, end);
+      }
+      catch(...)
+      {
+        overflowed = true;
+        ranges.clear();
+      }
+    }
+
+    /* Removes the ranges intersecting [begin, end), and calls f(begin, end) on each clipped
+    to [begin, end). Ranges not successfully flushed are restored.
+    */
+    template <class F> result<void> flush(extent_type begin, extent_type end, F &&f) noexcept
+    {
+      std::vector<std::pair<extent_type, extent_type>> taken;
+      {
+        std::lock_guard<std::mutex> g(lock);
+        if(overflowed)
+        {
+          return f(begin, end);
+        }
+        try
+        {
+          auto it = ranges.upper_bound(begin);
+          if(it != ranges.begin() && std::prev(it)->second > begin)
+          {
+            --it;
+          }
+          while(it != ranges.end() && it->first < end)
+          {
+            const auto rbegin = it->first, rend = it->second;
+            taken.emplace_back(std::max(rbegin, begin), std::min(rend, end));
+            it = ranges.erase(it);
+            // Keep the parts outside [begin, end) dirty
+            if(rbegin < begin)
+            {
+              ranges.emplace(rbegin, begin);
+            }
+            if(rend > end)
+            {
+              it = std::next(ranges.emplace(end, rend).first);
+            }
+          }
+        }
+        catch(...)
+        {
+          overflowed = true;
+          ranges.clear();
+          return f(begin, end);
+        }
+      }
+      for(size_t n = 0; n < taken.size(); n++)
+      {
+        auto r = f(taken[n].first, taken[n].second);
+        if(!r)
+        {
+          for(; n < taken.size(); n++)
+          {
+            add(taken[n].first, taken[n].second);
+          }
+          return r;
+        }
+      }
+      return success();
+    }
+  };
+
+  // Implemented by the platform specific map_handle.ipp, returns memory allocated by map_handle::map(bytes) to the system
+  inline void map_handle_cache_release(byte *addr, size_t bytes) noexcept;
+  // Implemented by the platform specific map_handle.ipp, begins prefetching the sorted, page aligned and non-overlapping regions
+  inline result<void> map_handle_prefetch_batch(span<map_handle::buffer_type> regions) noexcept;
+
+  // Implemented by the platform specific map_handle.ipp, returns true if the kernel populated the region, false if it must be touched
+  inline result<bool> map_handle_populate_native(byte *addr, size_t bytes, bool write) noexcept;
+
+  // Rounds regions out to page boundaries, sorts them by address, and coalesces overlapping or adjacent regions, in place
+  inline span<map_handle::buffer_type> map_handle_merge_regions(span<map_handle::buffer_type> regions) noexcept
+  {
+    const size_t pagesize = utils::page_size();
+    size_t count = 0;
+    for(auto &region : regions)
+    {
+      if(region.data() != nullptr && region.size() > 0)
+      {
+        regions[count++] = utils::round_to_page_size_larger(region, pagesize);
+      }
+    }
+    regions = regions.subspan(0, count);
+    std::sort(regions.begin(), regions.end(), [](const map_handle::buffer_type &a, const map_handle::buffer_type &b) { return a.data() < b.data(); });
+    count = 0;
+    for(size_t n = 1; n < regions.size(); n++)
+    {
+      auto &last = regions[count];
+      if(regions[n].data() <= last.data() + last.size())
+      {
+        byte *end = std::max(last.data() + last.size(), regions[n].data() + regions[n].size());
+        last = {last.data(), static_cast<size_t>(end - last.data())};
+      }
+      else
+      {
+        regions[++count] = regions[n];
+      }
+    }
+    return regions.empty() ? regions : regions.subspan(0, count + 1);
+  }
+
+  /* Process-wide cache of closed anonymous maps, bucketed by the power of two
+  of their size. Within a bucket, maps are ordered by when they were closed, so
+  the most recently closed (and most likely to still be in the TLB and CPU caches)
+  are reused first, and the least recently closed are trimmed first.
+  */
+  struct map_handle_cache_t
+  {
+    struct item_t
+    {
+      byte *addr;
+      size_t bytes;
+      size_t pagesize;
+      section_handle::flag flag;
+      std::chrono::steady_clock::time_point when_added;
+    };
+    std::atomic<bool> enabled{false};
+    std::mutex lock;
+    std::vector<item_t> buckets[sizeof(size_t) * 8];
+    size_t max_bytes{64 * 1024 * 1024};
+    std::chrono::steady_clock::duration max_age{std::chrono::seconds(1)};
+    size_t items{0}, bytes{0}, hits{0}, misses{0};
+
+    // Whether maps with these flags may be retained
+    static bool cacheable(section_handle::flag flag) noexcept { return (flag & section_handle::flag::write) && !(flag & section_handle::flag::nocommit); }
+
+    static size_t bucket(size_t bytes) noexcept
+    {
+      size_t ret = 0;
+      while(bytes > 1)
+      {
+        bytes >>= 1;
+        ++ret;
+      }
+      return ret;
+    }
+
+    // Returns a retained map exactly matching, or nullptr
+    byte *get(size_t bytes_, size_t pagesize, section_handle::flag flag) noexcept
+    {
+      std::lock_guard<std::mutex> g(lock);
+      auto &b = buckets[bucket(bytes_)];
+      for(size_t n = b.size(); n > 0; n--)
+      {
+        auto &i = b[n - 1];
+        if(i.bytes == bytes_ && i.pagesize == pagesize && i.flag == flag)
+        {
+          byte *ret = i.addr;
+          b.erase(b.begin() + (n - 1));
+          --items;
+          bytes -= bytes_;
+          ++hits;
+          return ret;
+        }
+      }
+      ++misses;
+      return nullptr;
+    }
+
+    // Returns true if the cache has taken ownership of the map
+    bool add(byte *addr, size_t bytes_, size_t pagesize, section_handle::flag flag) noexcept
+    {
+      const auto now = std::chrono::steady_clock::now();
+      std::lock_guard<std::mutex> g(lock);
+      if(bytes_ > max_bytes)
+      {
+        return false;
+      }
+      try
+      {
+        buckets[bucket(bytes_)].push_back(item_t{addr, bytes_, pagesize, flag, now});
+      }
+      catch(...)
+      {
+        return false;
+      }
+      ++items;
+      bytes += bytes_;
+      _trim_locked(now - max_age, max_bytes);
+      return true;
+    }
+
+    // Releases maps added before older_than, then the oldest maps until no more than max_remaining bytes are retained
+    std::pair<size_t, size_t> _trim_locked(std::chrono::steady_clock::time_point older_than, size_t max_remaining) noexcept
+    {
+      size_t trimmed_items = 0, trimmed_bytes = 0;
+      auto release_front = [&](std::vector<item_t> &b) {
+        map_handle_cache_release(b.front().addr, b.front().bytes);
+        ++trimmed_items;
+        trimmed_bytes += b.front().bytes;
+        --items;
+        bytes -= b.front().bytes;
+        b.erase(b.begin());
+      };
+      for(auto &b : buckets)
+      {
+        while(!b.empty() && b.front().when_added < older_than)
+        {
+          release_front(b);
+        }
+      }
+      while(bytes > max_remaining)
+      {
+        std::vector<item_t> *oldest = nullptr;
+        for(auto &b : buckets)
+        {
+          if(!b.empty() && (oldest == nullptr || b.front().when_added < oldest->front().when_added))
+          {
+            oldest = &b;
+          }
+        }
+        if(oldest == nullptr)
+        {
+          break;
+        }
+        release_front(*oldest);
+      }
+      return {trimmed_items, trimmed_bytes};
+    }
+  };
+  inline map_handle_cache_t &map_handle_cache() noexcept
+  {
+    // Deliberately leaked so maps closed during static deinitialisation remain safe
+    static map_handle_cache_t *v = [] {
+      auto *ret = new map_handle_cache_t;
+      (void) utils::register_memory_pressure_callback(
+      [](void *data, utils::memory_pressure level) noexcept {
+        auto *cache = static_cast<map_handle_cache_t *>(data);
+        std::lock_guard<std::mutex> g(cache->lock);
+        cache->_trim_locked(std::chrono::steady_clock::time_point::min(), (level == utils::memory_pressure::critical) ? 0 : cache->bytes / 2);
+      },
+      ret);
+      return ret;
+    }();
+    return *v;
+  }
+}  // namespace detail
+
+LLFIO_HEADERS_ONLY_FUNC_SPEC span<io_handle::const_buffer_type> nvram_barrier(span<io_handle::const_buffer_type> reqs, bool evict) noexcept
+{
+  const auto &available = detail::nvram_flush_instructions_available();
+  const auto instruction = evict ? available.evict : available.retain;
+  const auto mask = static_cast<uintptr_t>(available.cache_line_size - 1);
+  for(auto &req : reqs)
+  {
+    auto *tp = (io_handle::const_buffer_type::pointer)(((uintptr_t) req.data()) & ~mask);
+    if(instruction == detail::nvram_flush_instructions::instruction::none)
+    {
+      req = {tp, 0};
+      continue;
+    }
+    req = {tp, (size_t)(req.data() + mask + req.size() - tp) & ~mask};
+    detail::nvram_flush_instructions::flush(instruction, req.data(), req.size(), available.cache_line_size);
+  }
+  if(instruction != detail::nvram_flush_instructions::instruction::none)
+  {
+    detail::nvram_flush_instructions::fence();
+  }
+  return reqs;
+}
+
+void map_handle::mark_dirty(const_buffer_type region) noexcept
+{
+  if(_section == nullptr || _section->_dirty == nullptr || region.empty())
+  {
+    return;
+  }
+  const extent_type begin = _offset + (region.data() - _addr);
+  _section->_dirty->add(begin, begin + region.size());
+}
+
+result<void> map_handle::populate(buffer_type region, size_t threads) const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(_addr == nullptr || !(_flag & (section_handle::flag::read | section_handle::flag::write | section_handle::flag::cow)))
+  {
+    return success();
+  }
+  if(region.data() == nullptr)
+  {
+    region = {_addr, (size_t) _length};
+  }
+  // Never touch beyond the valid extent
+  byte *begin = utils::round_down_to_page_size(std::max(region.data(), _addr), _pagesize);
+  byte *end = std::min(region.data() + region.size(), _addr + _length);
+  if(end <= begin)
+  {
+    return success();
+  }
+  // Populating shared or file backed memory for write would needlessly dirty it
+  const bool write = (_section == nullptr) && !!(_flag & section_handle::flag::write);
+  const size_t pagesize = _pagesize;
+  auto populate_portion = [write, pagesize](byte *addr, size_t bytes) -> result<void> {
+    OUTCOME_TRY(auto &&done, detail::map_handle_populate_native(addr, bytes, write));
+    if(!done)
+    {
+      volatile byte *a = addr;
+      for(size_t n = 0; n < bytes; n += pagesize)
+      {
+        (void) a[n];
+      }
+    }
+    return success();
+  };
+  static constexpr size_t min_bytes_per_thread = 16 * 1024 * 1024;
+  const size_t bytes = static_cast<size_t>(end - begin);
+  if(threads == 0)
+  {
+    threads = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+  threads = std::max(std::min(threads, bytes / min_bytes_per_thread), (size_t) 1);
+  const size_t portion = utils::round_up_to_page_size((bytes + threads - 1) / threads, pagesize);
+  std::vector<std::thread> workers;
+  std::vector<result<void>> results;
+  byte *addr = begin;
+  try
+  {
+    results.resize(threads, result<void>(success()));
+    for(size_t n = 1; n < threads && addr + portion < end; n++, addr += portion)
+    {
+      workers.emplace_back([&populate_portion, &results, n, addr, portion] { results[n] = populate_portion(addr, portion); });
+    }
+  }
+  catch(...)
+  {
+    // Populate whatever no thread could be launched for from this thread
+  }
+  auto ret = populate_portion(addr, static_cast<size_t>(end - addr));
+  for(auto &worker : workers)
+  {
+    worker.join();
+  }
+  for(auto &r : results)
+  {
+    if(!r)
+    {
+      return std::move(r).error();
+    }
+  }
+  return ret;
+}
+
+result<map_handle::prefetch_state> map_handle::prefetch_async(span<buffer_type> regions) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(0);
+  prefetch_state ret;
+  ret._regions = detail::map_handle_merge_regions(regions);
+  for(auto &region : ret._regions)
+  {
+    ret._bytes += region.size();
+  }
+  OUTCOME_TRYV(detail::map_handle_prefetch_batch(ret._regions));
+  return ret;
+}
+
+bool map_handle::set_cache_enabled(bool enabled) noexcept
+{
+  auto &cache = detail::map_handle_cache();
+  const bool ret = cache.enabled.exchange(enabled, std::memory_order_acq_rel);
+  if(!enabled)
+  {
+    std::lock_guard<std::mutex> g(cache.lock);
+    cache._trim_locked(std::chrono::steady_clock::time_point::max(), 0);
+  }
+  return ret;
+}
+
+void map_handle::set_cache_limits(size_t max_bytes, std::chrono::steady_clock::duration max_age) noexcept
+{
+  auto &cache = detail::map_handle_cache();
+  std::lock_guard<std::mutex> g(cache.lock);
+  cache.max_bytes = max_bytes;
+  cache.max_age = max_age;
+  cache._trim_locked(std::chrono::steady_clock::now() - max_age, max_bytes);
+}
+
+map_handle::cache_statistics map_handle::trim_cache(std::chrono::steady_clock::time_point older_than) noexcept
+{
+  auto &cache = detail::map_handle_cache();
+  std::lock_guard<std::mutex> g(cache.lock);
+  cache_statistics ret;
+  auto trimmed = cache._trim_locked(older_than, (size_t) -1);
+  ret.items_just_trimmed = trimmed.first;
+  ret.bytes_just_trimmed = trimmed.second;
+  ret.items_in_cache = cache.items;
+  ret.bytes_in_cache = cache.bytes;
+  ret.hits = cache.hits;
+  ret.misses = cache.misses;
+  return ret;
+}
+
+LLFIO_V2_NAMESPACE_END
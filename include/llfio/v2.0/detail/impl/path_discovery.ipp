@@ -29,8 +29,13 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include <mutex>
 #include <regex>
+#include <string>
 #include <vector>
 
+#ifndef _WIN32
+#include <unistd.h>  // for geteuid()
+#endif
+
 LLFIO_V2_NAMESPACE_EXPORT_BEGIN
 
 namespace path_discovery
@@ -53,6 +58,7 @@ namespace path_discovery
     };
     std::vector<_discovered_path> _all;
     directory_handle storage_backed, memory_backed;
+    filesystem::path cache_path;
   };
   inline _store &path_store()
   {
@@ -124,6 +130,189 @@ namespace path_discovery
     return ps.all;
   }
 
+  void set_verified_temporary_directories_cache(filesystem::path path) noexcept
+  {
+    auto &ps = path_store();
+    std::lock_guard<std::mutex> g(ps.lock);
+    ps.cache_path = std::move(path);
+  }
+
+  // The first line of a verification cache, which includes the user for whom it was written
+  inline std::string _verification_cache_header()
+  {
+    std::string ret("llfio path_discovery verified_temporary_directories 1 ");
+#ifndef _WIN32
+    ret.append(std::to_string(::geteuid()));
+#endif
+    return ret;
+  }
+  // The stat of a verified directory which a verification cache records and compares
+  inline std::string _verification_cache_key(const stat_t &s)
+  {
+    std::string ret(std::to_string(s.st_dev));
+    ret.push_back(' ');
+    ret.append(std::to_string(s.st_ino));
+#ifndef _WIN32
+    ret.push_back(' ');
+    ret.append(std::to_string(s.st_perms));
+    ret.push_back(' ');
+    ret.append(std::to_string(s.st_uid));
+    ret.push_back(' ');
+    ret.append(std::to_string(s.st_gid));
+#endif
+    return ret;
+  }
+  /* Fills in the stats, handles and filing system names of the directories which verified last time,
+  if the verification cache was written for the same candidates and they are still the same
+  directories. Returns false, having filled in nothing, if the cache cannot be used.
+  */
+  inline bool _load_verification_cache(_store &ps) noexcept
+  {
+    auto reset = [&ps]() noexcept {
+      for(size_t n = 0; n < ps.all.size(); n++)
+      {
+        ps.all[n].stat = {};
+        ps._all[n].h = {};
+        ps._all[n].fstypename.clear();
+      }
+    };
+    try
+    {
+      log_level_guard logg(log_level::fatal);  // suppress log printing of failure
+      (void) logg;
+      std::string contents;
+      {
+        auto fh = file_handle::file({}, ps.cache_path, file_handle::mode::read);
+        if(!fh)
+        {
+          return false;
+        }
+        auto length = fh.value().maximum_extent();
+        if(!length || length.value() == 0 || length.value() > 1024 * 1024)
+        {
+          return false;
+        }
+        contents.resize(static_cast<size_t>(length.value()));
+        auto read = fh.value().read(0, {{reinterpret_cast<byte *>(&contents[0]), contents.size()}});
+        if(!read || read.value() != contents.size())
+        {
+          return false;
+        }
+      }
+      std::vector<std::string> lines;
+      for(size_t begin = 0, end; begin < contents.size(); begin = end + 1)
+      {
+        end = contents.find('\n', begin);
+        if(end == std::string::npos)
+        {
+          return false;  // torn or truncated
+        }
+        lines.push_back(contents.substr(begin, end - begin));
+      }
+      if(lines.size() != ps.all.size() + 2 || lines.front() != _verification_cache_header() || lines.back() != "end")
+      {
+        return false;
+      }
+      struct cached_t
+      {
+        bool verified;
+        std::string fstypename, key;
+      };
+      std::vector<cached_t> cached;
+      cached.reserve(ps.all.size());
+      bool any_verified = false;
+      for(size_t n = 0; n < ps.all.size(); n++)
+      {
+        const std::string &line = lines[n + 1];
+        const auto tab = line.find('\t');
+        const auto sp1 = line.find(' ');
+        const auto sp2 = (sp1 == std::string::npos) ? sp1 : line.find(' ', sp1 + 1);
+        if(tab == std::string::npos || sp2 == std::string::npos || sp2 > tab || line.compare(tab + 1, std::string::npos, ps._all[n].path.string()) != 0)
+        {
+          return false;
+        }
+        cached.push_back({line[0] == '1', line.substr(sp1 + 1, sp2 - sp1 - 1), line.substr(sp2 + 1, tab - sp2 - 1)});
+        any_verified = any_verified || cached.back().verified;
+      }
+      if(!any_verified)
+      {
+        return false;
+      }
+      for(size_t n = 0; n < ps.all.size(); n++)
+      {
+        if(!cached[n].verified)
+        {
+          continue;
+        }
+        auto _h = directory_handle::directory({}, ps.all[n].path);
+        stat_t s(nullptr);
+        if(!_h || !s.fill(_h.value()) || _verification_cache_key(s) != cached[n].key)
+        {
+          reset();
+          return false;
+        }
+        ps._all[n].h = std::move(_h).value();
+        ps._all[n].fstypename = std::move(cached[n].fstypename);
+        ps.all[n].stat = s;
+      }
+      return true;
+    }
+    catch(...)
+    {
+      reset();
+      return false;
+    }
+  }
+  // Atomically replaces the verification cache with what the probe just found
+  inline void _save_verification_cache(const _store &ps) noexcept
+  {
+    try
+    {
+      log_level_guard logg(log_level::fatal);  // suppress log printing of failure
+      (void) logg;
+      std::string contents(_verification_cache_header());
+      contents.push_back('\n');
+      for(size_t n = 0; n < ps.all.size(); n++)
+      {
+        if(ps._all[n].h.is_valid() && ps.all[n].stat)
+        {
+          contents.append("1 ");
+          contents.append(ps._all[n].fstypename.empty() ? std::string("-") : ps._all[n].fstypename);
+          contents.push_back(' ');
+          contents.append(_verification_cache_key(*ps.all[n].stat));
+        }
+        else
+        {
+          contents.append("0 - -");
+        }
+        contents.push_back('\t');
+        contents.append(ps._all[n].path.string());
+        contents.push_back('\n');
+      }
+      contents.append("end\n");
+      const auto parent = ps.cache_path.parent_path();
+      auto dirh = path_handle::path(parent.empty() ? filesystem::path(".") : parent);
+      if(!dirh)
+      {
+        return;
+      }
+      // Write to a uniquely named file and rename it over the cache, so readers never see a partial cache
+      auto fh = file_handle::uniquely_named_file(dirh.value(), file_handle::mode::write, file_handle::caching::all);
+      if(!fh)
+      {
+        return;
+      }
+      auto written = fh.value().write(0, {{reinterpret_cast<const byte *>(contents.data()), contents.size()}});
+      if(!written || written.value() != contents.size() || !fh.value().relink(dirh.value(), ps.cache_path.filename()))
+      {
+        (void) fh.value().unlink();
+      }
+    }
+    catch(...)
+    {
+    }
+  }
+
   span<discovered_path> verified_temporary_directories() noexcept
   {
     auto &ps = path_store();
@@ -139,8 +328,9 @@ namespace path_discovery
     }
     try
     {
-      // Firstly go try to open and stat all items
-      for(size_t n = 0; n < ps.all.size(); n++)
+      // Firstly go try to open and stat all items, unless the verification cache says what will happen
+      const bool cached = !ps.cache_path.empty() && _load_verification_cache(ps);
+      for(size_t n = 0; !cached && n < ps.all.size(); n++)
       {
         {
           log_level_guard logg(log_level::fatal);  // suppress log printing of failure
@@ -195,6 +385,10 @@ namespace path_discovery
           continue;
         }
       }
+      if(!cached && !ps.cache_path.empty())
+      {
+        _save_verification_cache(ps);
+      }
       // Now partition into those with valid stat directories and those without
       std::stable_partition(ps._all.begin(), ps._all.end(), [](const _store::_discovered_path &a) { return a.h.is_valid(); });
       auto it = std::stable_partition(ps.all.begin(), ps.all.end(), [](const discovered_path &a) { return a.stat; });
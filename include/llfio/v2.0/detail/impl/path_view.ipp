@@ -123,6 +123,45 @@ namespace detail
 #pragma warning(pop)
 #endif
 
+  /* Almost all paths are entirely ASCII, which is identical in every encoding, and so can be
+  reencoded by just widening or narrowing each code unit. Both loops are simple enough that
+  compilers vectorise them. Returns nullptr if the source is not entirely ASCII, else as `reencode_path_to()`.
+  */
+  template <class DestT, class SrcT> inline DestT *_reencode_ascii_path_to(size_t &toallocate, DestT *dest_buffer, size_t dest_buffer_length, const SrcT *src_buffer, size_t src_buffer_length) noexcept
+  {
+    using unit_type = typename std::conditional<sizeof(SrcT) == 1, uint8_t, typename std::conditional<sizeof(SrcT) == 2, uint16_t, uint32_t>::type>::type;
+    unit_type seen = 0;
+    for(size_t n = 0; n < src_buffer_length; n++)
+    {
+      unit_type u;
+      memcpy(&u, src_buffer + n, sizeof(u));
+      seen |= u;
+    }
+    if(seen >= 0x80)
+    {
+      return nullptr;
+    }
+    if(dest_buffer_length <= src_buffer_length)
+    {
+      toallocate = src_buffer_length + 1;
+      return dest_buffer;
+    }
+    for(size_t n = 0; n < src_buffer_length; n++)
+    {
+      unit_type u;
+      memcpy(&u, src_buffer + n, sizeof(u));
+      dest_buffer[n] = static_cast<DestT>(u);
+    }
+    dest_buffer[src_buffer_length] = 0;
+    toallocate = 0;
+    return dest_buffer + src_buffer_length;
+  }
+#define LLFIO_REENCODE_ASCII_PATH_TO                                                                                                                           \
+  if(auto *ascii_end = _reencode_ascii_path_to(toallocate, dest_buffer, dest_buffer_length, src_buffer, src_buffer_length))                                    \
+  {                                                                                                                                                            \
+    return ascii_end;                                                                                                                                          \
+  }
+
   char *reencode_path_to(size_t & /*unused*/, char * /*unused*/, size_t /*unused*/, const LLFIO_V2_NAMESPACE::byte * /*unused*/, size_t /*unused*/)
   {
     LLFIO_LOG_FATAL(nullptr, "path_view_component::c_str reencoding function should never see passthrough.");
@@ -133,9 +172,14 @@ namespace detail
     LLFIO_LOG_FATAL(nullptr, "path_view_component::c_str reencoding function should never see identity.");
     abort();
   }
-  char *reencode_path_to(size_t &toallocate, char *dest_buffer, size_t dest_buffer_length, const wchar_t *src_buffer, size_t src_buffer_length) { return _reencode_path_to(toallocate, dest_buffer, dest_buffer_length, src_buffer, src_buffer_length); }
+  char *reencode_path_to(size_t &toallocate, char *dest_buffer, size_t dest_buffer_length, const wchar_t *src_buffer, size_t src_buffer_length)
+  {
+    LLFIO_REENCODE_ASCII_PATH_TO
+    return _reencode_path_to(toallocate, dest_buffer, dest_buffer_length, src_buffer, src_buffer_length);
+  }
   char *reencode_path_to(size_t &toallocate, char *dest_buffer, size_t dest_buffer_length, const char8_t *src_buffer, size_t src_buffer_length)
   {
+    LLFIO_REENCODE_ASCII_PATH_TO
 #ifdef _WIN32
     if(dest_buffer_length * sizeof(wchar_t) > 65535)
     {
@@ -245,6 +289,7 @@ namespace detail
   }
   char *reencode_path_to(size_t &toallocate, char *dest_buffer, size_t dest_buffer_length, const char16_t *src_buffer, size_t src_buffer_length)
   {
+    LLFIO_REENCODE_ASCII_PATH_TO
 #if (__cplusplus >= 202000 || _HAS_CXX20) && !defined(_LIBCPP_VERSION)
     return (char *) _reencode_path_to(toallocate, (char8_t *) dest_buffer, dest_buffer_length, src_buffer, src_buffer_length);
 #else
@@ -259,6 +304,7 @@ namespace detail
   }
   wchar_t *reencode_path_to(size_t &toallocate, wchar_t *dest_buffer, size_t dest_buffer_length, const char *src_buffer, size_t src_buffer_length)
   {
+    LLFIO_REENCODE_ASCII_PATH_TO
 #ifdef _WIN32
     if(dest_buffer_length * sizeof(wchar_t) > 65535)
     {
@@ -370,6 +416,7 @@ namespace detail
   }
   wchar_t *reencode_path_to(size_t &toallocate, wchar_t *dest_buffer, size_t dest_buffer_length, const char8_t *src_buffer, size_t src_buffer_length)
   {
+    LLFIO_REENCODE_ASCII_PATH_TO
 #if LLFIO_PATH_VIEW_CHAR8_TYPE_EMULATED
 #if defined(_LIBCPP_VERSION)
     (void) toallocate;
@@ -407,6 +454,7 @@ namespace detail
   }
   wchar_t *reencode_path_to(size_t &toallocate, wchar_t *dest_buffer, size_t dest_buffer_length, const char16_t *src_buffer, size_t src_buffer_length)
   {
+    LLFIO_REENCODE_ASCII_PATH_TO
 #ifdef _WIN32
     (void) toallocate;
     (void) dest_buffer;
@@ -436,6 +484,98 @@ namespace detail
 #endif
   }
 
+#undef LLFIO_REENCODE_ASCII_PATH_TO
+
+  /* Each kernel thread keeps a few of the most recently released buffers for reuse, so
+  repeatedly converting long paths does not call malloc(). Each buffer is preceded by its
+  capacity in bytes. Buffers released by a thread other than the one allocating them are
+  simply retained by the releasing thread instead.
+  */
+  struct path_buffer_thread_cache_t
+  {
+    static constexpr size_t max_items = 4;
+    static constexpr size_t header_bytes = 16;  // preserves the alignment of operator new
+    void *items[max_items]{};
+    size_t count{0};
+    ~path_buffer_thread_cache_t()
+    {
+      for(size_t n = 0; n < count; n++)
+      {
+        ::operator delete(items[n]);
+      }
+    }
+    static size_t capacity(void *item) noexcept { return *static_cast<size_t *>(item); }
+  };
+  inline path_buffer_thread_cache_t &path_buffer_thread_cache() noexcept
+  {
+    static thread_local path_buffer_thread_cache_t v;
+    return v;
+  }
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void *path_buffer_thread_cache_allocate(size_t bytes) noexcept
+  {
+    auto &cache = path_buffer_thread_cache();
+    // Take the smallest retained buffer big enough
+    size_t best = cache.count;
+    for(size_t n = 0; n < cache.count; n++)
+    {
+      if(path_buffer_thread_cache_t::capacity(cache.items[n]) >= bytes &&
+         (best == cache.count || path_buffer_thread_cache_t::capacity(cache.items[n]) < path_buffer_thread_cache_t::capacity(cache.items[best])))
+      {
+        best = n;
+      }
+    }
+    void *item;
+    if(best != cache.count)
+    {
+      item = cache.items[best];
+      cache.items[best] = cache.items[--cache.count];
+    }
+    else
+    {
+      // Round up so buffers are reusable by paths of similar length
+      size_t capacity = 4096;
+      while(capacity < bytes)
+      {
+        capacity <<= 1;
+      }
+      item = ::operator new(path_buffer_thread_cache_t::header_bytes + capacity, std::nothrow);
+      if(item == nullptr)
+      {
+        return nullptr;
+      }
+      *static_cast<size_t *>(item) = capacity;
+    }
+    return static_cast<char *>(item) + path_buffer_thread_cache_t::header_bytes;
+  }
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void path_buffer_thread_cache_release(void *p) noexcept
+  {
+    if(p == nullptr)
+    {
+      return;
+    }
+    void *item = static_cast<char *>(p) - path_buffer_thread_cache_t::header_bytes;
+    auto &cache = path_buffer_thread_cache();
+    if(cache.count < path_buffer_thread_cache_t::max_items)
+    {
+      cache.items[cache.count++] = item;
+      return;
+    }
+    // Evict the smallest retained buffer in favour of the larger
+    size_t smallest = 0;
+    for(size_t n = 1; n < cache.count; n++)
+    {
+      if(path_buffer_thread_cache_t::capacity(cache.items[n]) < path_buffer_thread_cache_t::capacity(cache.items[smallest]))
+      {
+        smallest = n;
+      }
+    }
+    if(path_buffer_thread_cache_t::capacity(cache.items[smallest]) < path_buffer_thread_cache_t::capacity(item))
+    {
+      std::swap(cache.items[smallest], item);
+    }
+    ::operator delete(item);
+  }
+
 }  // namespace detail
 
 LLFIO_V2_NAMESPACE_END
@@ -0,0 +1,430 @@
+/* A handle to a byte-orientated socket
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../../byte_socket_handle.hpp"
+#include "../../../pipe_handle.hpp"
+#include "import.hpp"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+#include <sys/uio.h>
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  // Waits until the socket is ready for `events`, or the deadline passes
+  inline result<void> byte_socket_wait(int fd, short events, const deadline &d) noexcept
+  {
+    for(;;)
+    {
+      pollfd p;
+      memset(&p, 0, sizeof(p));
+      p.fd = fd;
+      p.events = events;
+      const int ret = ::poll(&p, 1, byte_socket_timeout_ms(d));
+      if(ret > 0)
+      {
+        return success();
+      }
+      if(ret == 0)
+      {
+        return errc::timed_out;
+      }
+      if(errno != EINTR)
+      {
+        return posix_error();
+      }
+    }
+  }
+  // Creates a TCP socket, close on exec, and non-blocking if `nonblocking`
+  inline result<int> byte_socket_create(ip::family family, bool nonblocking) noexcept
+  {
+    if(family != ip::family::v4 && family != ip::family::v6)
+    {
+      return errc::invalid_argument;
+    }
+    int type = SOCK_STREAM;
+#ifdef SOCK_CLOEXEC
+    type |= SOCK_CLOEXEC;
+    if(nonblocking)
+    {
+      type |= SOCK_NONBLOCK;
+    }
+#endif
+    const int fd = ::socket((family == ip::family::v6) ? AF_INET6 : AF_INET, type, IPPROTO_TCP);
+    if(fd == -1)
+    {
+      return posix_error();
+    }
+    auto unfd = make_scope_exit([fd]() noexcept { ::close(fd); });
+#ifndef SOCK_CLOEXEC
+    if(-1 == ::fcntl(fd, F_SETFD, FD_CLOEXEC))
+    {
+      return posix_error();
+    }
+    if(nonblocking && -1 == ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK))
+    {
+      return posix_error();
+    }
+#endif
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    if(-1 == ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one)))
+    {
+      return posix_error();
+    }
+#endif
+    unfd.release();
+    return fd;
+  }
+  inline result<ip::address> byte_socket_name(int fd, bool peer) noexcept
+  {
+    sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    socklen_t len = sizeof(ss);
+    if(-1 == (peer ? ::getpeername(fd, reinterpret_cast<sockaddr *>(&ss), &len) : ::getsockname(fd, reinterpret_cast<sockaddr *>(&ss), &len)))
+    {
+      return posix_error();
+    }
+    return ip::address(&ss, len);
+  }
+}  // namespace detail
+
+result<byte_socket_handle> byte_socket_handle::byte_socket(ip::family family, mode _mode, caching _caching, flag flags) noexcept
+{
+  result<byte_socket_handle> ret(byte_socket_handle(native_handle_type(), _caching, flags, nullptr));
+  native_handle_type &nativeh = ret.value()._v;
+  LLFIO_LOG_FUNCTION_CALL(&ret);
+  nativeh.behaviour |= native_handle_type::disposition::socket;
+  OUTCOME_TRY(auto &&attribs, attribs_from_handle_mode_caching_and_flags(nativeh, _mode, creation::open_existing, caching::all, flags));
+  nativeh.behaviour &= ~(native_handle_type::disposition::seekable | native_handle_type::disposition::append_only);  // not seekable
+  OUTCOME_TRY(nativeh.fd, detail::byte_socket_create(family, (attribs & O_NONBLOCK) != 0));
+  return ret;
+}
+
+result<void> byte_socket_handle::connect(const ip::address &addr, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(d && !_v.is_nonblocking())
+  {
+    return errc::not_supported;
+  }
+  LLFIO_TRACE_SYSCALL(this, "connect");
+  if(-1 != ::connect(_v.fd, static_cast<const sockaddr *>(addr.to_sockaddr()), addr.sockaddrlen()))
+  {
+    return success();
+  }
+  if(errno != EINPROGRESS && errno != EINTR)
+  {
+    return posix_error();
+  }
+  // The connection completes asynchronously, after which writing becomes possible
+  OUTCOME_TRY(detail::byte_socket_wait(_v.fd, POLLOUT, d));
+  int error = 0;
+  socklen_t len = sizeof(error);
+  if(-1 == ::getsockopt(_v.fd, SOL_SOCKET, SO_ERROR, &error, &len))
+  {
+    return posix_error();
+  }
+  if(error != 0)
+  {
+    return posix_error(error);
+  }
+  return success();
+}
+
+result<ip::address> byte_socket_handle::local_endpoint() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::byte_socket_name(_v.fd, false);
+}
+
+result<ip::address> byte_socket_handle::remote_endpoint() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::byte_socket_name(_v.fd, true);
+}
+
+result<void> byte_socket_handle::shutdown(shutdown_kind kind) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const int how = (kind == shutdown_kind::read) ? SHUT_RD : (kind == shutdown_kind::write) ? SHUT_WR : SHUT_RDWR;
+  if(-1 == ::shutdown(_v.fd, how))
+  {
+    return posix_error();
+  }
+  return success();
+}
+
+result<void> byte_socket_handle::shutdown_and_close(deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(is_writable())
+  {
+    OUTCOME_TRY(shutdown(shutdown_kind::write));
+  }
+  if(is_readable())
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    byte buffer[4096];
+    for(;;)
+    {
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      if(d || _v.is_nonblocking())
+      {
+        auto r = detail::byte_socket_wait(_v.fd, POLLIN, nd);
+        if(!r)
+        {
+          if(r.error() == errc::timed_out)
+          {
+            break;
+          }
+          return std::move(r).error();
+        }
+      }
+      const ssize_t bytesread = ::recv(_v.fd, buffer, sizeof(buffer), 0);
+      if(bytesread == 0)
+      {
+        break;
+      }
+      if(bytesread < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      {
+        // The peer may have reset the connection, which is as good as closed
+        break;
+      }
+    }
+  }
+  return close();
+}
+
+result<size_t> byte_socket_handle::splice_from(io_handle &src, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(d && !_v.is_nonblocking())
+  {
+    return errc::not_supported;
+  }
+  if(bytes == 0)
+  {
+    return 0;
+  }
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+  if(src.is_seekable())
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    for(;;)
+    {
+      ssize_t sent = -1;
+      LLFIO_TRACE_SYSCALL(this, "sendfile");
+#ifdef __linux__
+      off_t off = static_cast<off_t>(offset);
+      sent = ::sendfile(_v.fd, src.native_handle().fd, &off, bytes);
+#elif defined(__FreeBSD__)
+      // A partial send on a non-blocking socket fails with EAGAIN, but still reports what was sent
+      off_t sbytes = 0;
+      if(-1 != ::sendfile(src.native_handle().fd, _v.fd, static_cast<off_t>(offset), bytes, nullptr, &sbytes, 0) || sbytes > 0)
+      {
+        sent = static_cast<ssize_t>(sbytes);
+      }
+#else
+      off_t len = static_cast<off_t>(bytes);
+      if(-1 != ::sendfile(src.native_handle().fd, _v.fd, static_cast<off_t>(offset), &len, nullptr, 0) || len > 0)
+      {
+        sent = static_cast<ssize_t>(len);
+      }
+#endif
+      if(sent >= 0)
+      {
+        return static_cast<size_t>(sent);
+      }
+      const int errcode = errno;
+      if(errcode == EINVAL || errcode == ENOSYS || errcode == EOPNOTSUPP || errcode == ENOTSUP)
+      {
+        // The kernel cannot send from this kind of file, so copy instead
+        break;
+      }
+      if(errcode != EAGAIN && errcode != EWOULDBLOCK && errcode != EINTR)
+      {
+        return posix_error(errcode);
+      }
+      if(errcode != EINTR)
+      {
+        deadline nd;
+        LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+        OUTCOME_TRY(detail::byte_socket_wait(_v.fd, POLLOUT, nd));
+      }
+      LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+    }
+  }
+#endif
+  return detail::pipe_handle_splice_copy(*this, 0, src, offset, bytes, d);
+}
+
+result<void> byte_socket_handle::close() noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#ifndef NDEBUG
+  if(_v)
+  {
+    // Tell handle::close() that we have correctly executed
+    _v.behaviour |= native_handle_type::disposition::_child_close_executed;
+  }
+#endif
+  return io_handle::close();
+}
+
+result<listening_byte_socket_handle> listening_byte_socket_handle::listening_byte_socket(ip::family family, mode _mode, caching _caching, flag flags) noexcept
+{
+  result<listening_byte_socket_handle> ret(listening_byte_socket_handle(native_handle_type(), _caching, flags));
+  native_handle_type &nativeh = ret.value()._v;
+  LLFIO_LOG_FUNCTION_CALL(&ret);
+  nativeh.behaviour |= native_handle_type::disposition::socket;
+  OUTCOME_TRY(auto &&attribs, attribs_from_handle_mode_caching_and_flags(nativeh, _mode, creation::open_existing, caching::all, flags));
+  nativeh.behaviour &= ~(native_handle_type::disposition::seekable | native_handle_type::disposition::append_only);  // not seekable
+  OUTCOME_TRY(nativeh.fd, detail::byte_socket_create(family, (attribs & O_NONBLOCK) != 0));
+  if(family == ip::family::v6)
+  {
+    // Be consistent with Windows, which never accepts IPv4 connections on an IPv6 socket
+    int one = 1;
+    if(-1 == ::setsockopt(nativeh.fd, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one)))
+    {
+      return posix_error();
+    }
+  }
+  return ret;
+}
+
+result<void> listening_byte_socket_handle::bind(const ip::address &addr, int backlog) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  // Permit rebinding a port still in TIME_WAIT from an earlier listener
+  int one = 1;
+  if(-1 == ::setsockopt(_v.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+  {
+    return posix_error();
+  }
+  if(-1 == ::bind(_v.fd, static_cast<const sockaddr *>(addr.to_sockaddr()), addr.sockaddrlen()))
+  {
+    return posix_error();
+  }
+  if(-1 == ::listen(_v.fd, (backlog < 0) ? SOMAXCONN : backlog))
+  {
+    return posix_error();
+  }
+  return success();
+}
+
+result<ip::address> listening_byte_socket_handle::local_endpoint() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::byte_socket_name(_v.fd, false);
+}
+
+result<std::pair<byte_socket_handle, ip::address>> listening_byte_socket_handle::accept(io_multiplexer *ctx, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  result<std::pair<byte_socket_handle, ip::address>> ret(byte_socket_handle(native_handle_type(), caching::all, _flags & ~flag::unlink_on_first_close, nullptr), ip::address());
+  native_handle_type &nativeh = ret.value().first._v;
+  OUTCOME_TRY(auto &&attribs, attribs_from_handle_mode_caching_and_flags(nativeh, (_v.behaviour & native_handle_type::disposition::writable) ? mode::write : mode::read,
+                                                                         creation::open_existing, caching::all, _flags));
+  nativeh.behaviour |= native_handle_type::disposition::socket;
+  nativeh.behaviour &= ~(native_handle_type::disposition::seekable | native_handle_type::disposition::append_only);  // not seekable
+  LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+  for(;;)
+  {
+    if(d || _v.is_nonblocking())
+    {
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      OUTCOME_TRY(detail::byte_socket_wait(_v.fd, POLLIN, nd));
+    }
+    sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    socklen_t len = sizeof(ss);
+    LLFIO_TRACE_SYSCALL(this, "accept");
+#if defined(__linux__) || defined(__FreeBSD__)
+    nativeh.fd = ::accept4(_v.fd, reinterpret_cast<sockaddr *>(&ss), &len, SOCK_CLOEXEC | (((attribs & O_NONBLOCK) != 0) ? SOCK_NONBLOCK : 0));
+#else
+    nativeh.fd = ::accept(_v.fd, reinterpret_cast<sockaddr *>(&ss), &len);
+#endif
+    if(nativeh.fd != -1)
+    {
+      ret.value().second = ip::address(&ss, len);
+      break;
+    }
+    // Another thread may have accepted the connection, or the connection may have been aborted
+    if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+    {
+      return posix_error();
+    }
+    LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+  }
+#if !defined(__linux__) && !defined(__FreeBSD__)
+  // Accepted sockets inherit non-blocking from the listening socket on BSD, but not everywhere else
+  if(-1 == ::fcntl(nativeh.fd, F_SETFD, FD_CLOEXEC))
+  {
+    return posix_error();
+  }
+  if(-1 == ::fcntl(nativeh.fd, F_SETFL, (((attribs & O_NONBLOCK) != 0) ? (::fcntl(nativeh.fd, F_GETFL) | O_NONBLOCK) : (::fcntl(nativeh.fd, F_GETFL) & ~O_NONBLOCK))))
+  {
+    return posix_error();
+  }
+#endif
+#ifdef SO_NOSIGPIPE
+  int one = 1;
+  if(-1 == ::setsockopt(nativeh.fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one)))
+  {
+    return posix_error();
+  }
+#endif
+  if(ctx != nullptr)
+  {
+    OUTCOME_TRY(ret.value().first.set_multiplexer(ctx));
+  }
+  return ret;
+}
+
+result<void> listening_byte_socket_handle::close() noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#ifndef NDEBUG
+  if(_v)
+  {
+    // Tell handle::close() that we have correctly executed
+    _v.behaviour |= native_handle_type::disposition::_child_close_executed;
+  }
+#endif
+  return handle::close();
+}
+
+LLFIO_V2_NAMESPACE_END
@@ -37,6 +37,9 @@ http://www.boost.org/LICENSE_1_0.txt)
 #include <sys/stat.h>
 #include <sys/syscall.h>
 
+#include <mutex>
+#include <unordered_map>
+
 LLFIO_V2_NAMESPACE_BEGIN
 
 result<directory_handle> directory_handle::directory(const path_handle &base, path_view_type path, mode _mode, creation _creation, caching _caching, flag flags) noexcept
@@ -63,6 +66,21 @@ result<directory_handle> directory_handle::directory(const path_handle &base, pa
   {
     return errc::is_a_directory;
   }
+  if(_creation != creation::open_existing)
+  {
+    if(flags & flag::resolve_cached_only)
+    {
+      // Creating a directory may block
+      return errc::resource_unavailable_try_again;
+    }
+    if((flags & (flag::resolve_beneath | flag::resolve_no_symlinks)) && !path.parent_path().empty())
+    {
+      // mkdirat() knows nothing of the resolve flags, so open the parent with them, and create the leaf within it
+      OUTCOME_TRY(auto &&parenth, directory_handle::directory(base, path.parent_path(), mode::read, creation::open_existing, caching::all,
+                                                               flags & (flag::resolve_beneath | flag::resolve_no_symlinks)));
+      return directory_handle::directory(parenth, path.filename(), _mode, _creation, _caching, flags);
+    }
+  }
   OUTCOME_TRY(auto &&attribs, attribs_from_handle_mode_caching_and_flags(nativeh, _mode, _creation, _caching, flags));
   attribs &= ~O_NONBLOCK;
   nativeh.behaviour &= ~native_handle_type::disposition::nonblocking;
@@ -79,7 +97,7 @@ result<directory_handle> directory_handle::directory(const path_handle &base, pa
     // really ought to be cloning the handle. But let's humour him.
     path = ".";
   }
-  path_view::c_str<> zpath(path);
+  path_view::recycling_c_str<> zpath(path);
   auto rename_random_dir_over_existing_dir = [_mode, _caching, flags](const path_handle &base, path_view_type path) -> result<directory_handle> {
     // Take a path handle to the directory containing the file
     auto path_parent = path.parent_path();
@@ -128,7 +146,7 @@ result<directory_handle> directory_handle::directory(const path_handle &base, pa
       }
       attribs &= ~(O_CREAT | O_EXCL);
     }
-    nativeh.fd = ::openat(base.native_handle().fd, zpath.buffer, attribs);
+    nativeh.fd = openat_with_resolve_flags(base.native_handle().fd, zpath.buffer, attribs, 0, flags);
   }
   else
   {
@@ -153,7 +171,7 @@ result<directory_handle> directory_handle::directory(const path_handle &base, pa
       }
       attribs &= ~(O_CREAT | O_EXCL);
     }
-    nativeh.fd = ::open(zpath.buffer, attribs);
+    nativeh.fd = openat_with_resolve_flags(AT_FDCWD, zpath.buffer, attribs, 0, flags);
   }
   if(-1 == nativeh.fd)
   {
@@ -258,6 +276,221 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<path_handle> directory_handle::clone_to_p
   return ret;
 }
 
+namespace detail
+{
+  /* Most globs are of the form `prefix*suffix`, which can be matched by comparing the literal
+  prefix and suffix against the leafname without calling fnmatch() at all. For any other glob,
+  the literal prefix and suffix still reject most leafnames before fnmatch() is called.
+  */
+  class posix_glob_matcher
+  {
+    const char *_glob{nullptr};
+    size_t _globlen{0}, _prefixlen{0}, _suffixlen{0};
+    bool _simple{false};
+
+    static bool _is_meta(char c) noexcept { return c == '*' || c == '?' || c == '[' || c == ']' || c == '\\'; }
+
+  public:
+    explicit posix_glob_matcher(const char *glob) noexcept
+        : _glob(glob)
+        , _globlen(strlen(glob))
+    {
+      const size_t length = _globlen;
+      while(_prefixlen < length && !_is_meta(glob[_prefixlen]))
+      {
+        _prefixlen++;
+      }
+      while(_suffixlen < length - _prefixlen && !_is_meta(glob[length - 1 - _suffixlen]))
+      {
+        _suffixlen++;
+      }
+      _simple = (_prefixlen + _suffixlen + 1 == length && glob[_prefixlen] == '*');
+    }
+
+    // `name` must be zero terminated at `length`
+    bool operator()(const char *name, size_t length) const noexcept
+    {
+      if(length < _prefixlen + _suffixlen)
+      {
+        return false;
+      }
+      if(_prefixlen > 0 && memcmp(name, _glob, _prefixlen) != 0)
+      {
+        return false;
+      }
+      if(_suffixlen > 0 && memcmp(name + length - _suffixlen, _glob + _globlen - _suffixlen, _suffixlen) != 0)
+      {
+        return false;
+      }
+      return _simple || fnmatch(_glob, name, 0) == 0;
+    }
+  };
+
+  /* Process-wide cache of complete directory enumerations, keyed by the device and inode of the
+  directory. Each is kept in a single allocation of fixed size records for the entries, followed
+  by their zero terminated leafnames.
+  */
+  struct directory_enumeration_cache_t
+  {
+    struct key_t
+    {
+      uint64_t dev, ino;
+      bool operator==(const key_t &o) const noexcept { return dev == o.dev && ino == o.ino; }
+    };
+    struct key_hasher
+    {
+      size_t operator()(const key_t &k) const noexcept
+      {
+        auto x = k.ino ^ (k.dev * 0x9e3779b97f4a7c15ULL);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        return (size_t) x;
+      }
+    };
+    struct validity_t
+    {
+      int64_t mtim_sec, mtim_nsec, ctim_sec, ctim_nsec;
+      bool operator==(const validity_t &o) const noexcept
+      {
+        return mtim_sec == o.mtim_sec && mtim_nsec == o.mtim_nsec && ctim_sec == o.ctim_sec && ctim_nsec == o.ctim_nsec;
+      }
+    };
+    struct entry_t
+    {
+      uint64_t ino;
+      uint32_t leafname_offset;
+      uint16_t leafname_length;
+      filesystem::file_type type;
+    };
+    struct item_t
+    {
+      validity_t validity;
+      stat_t::want metadata;
+      std::unique_ptr<char[]> arena;
+      size_t count;          // entries at the front of the arena
+      size_t leafnames;      // bytes of leafnames after the entries
+      size_t bytes() const noexcept { return count * sizeof(entry_t) + leafnames; }
+      const entry_t *entries() const noexcept { return reinterpret_cast<const entry_t *>(arena.get()); }
+      const char *leafname_storage() const noexcept { return arena.get() + count * sizeof(entry_t); }
+      std::chrono::steady_clock::time_point last_used;
+    };
+    std::atomic<bool> enabled{false};
+    std::mutex lock;
+    std::unordered_map<key_t, item_t, key_hasher> items;
+    size_t max_bytes{16 * 1024 * 1024};
+    size_t bytes{0}, hits{0}, misses{0};
+
+    static validity_t validity(const struct stat &s) noexcept
+    {
+#ifdef __ANDROID__
+      const auto &mtim = *((struct timespec *) &s.st_mtime);
+      const auto &ctim = *((struct timespec *) &s.st_ctime);
+#elif defined(__APPLE__)
+      const auto &mtim = s.st_mtimespec;
+      const auto &ctim = s.st_ctimespec;
+#else  // Linux and BSD
+      const auto &mtim = s.st_mtim;
+      const auto &ctim = s.st_ctim;
+#endif
+      return {(int64_t) mtim.tv_sec, (int64_t) mtim.tv_nsec, (int64_t) ctim.tv_sec, (int64_t) ctim.tv_nsec};
+    }
+
+    // Retains a complete enumeration, replacing any previous one for that directory
+    void add(key_t key, validity_t v, stat_t::want metadata, const directory_handle::buffers_type &buffers) noexcept
+    {
+      // Timestamps are coarse, so a directory modified in the last second could be modified again without changing them
+      const auto now = std::chrono::system_clock::now().time_since_epoch();
+      if((int64_t) std::chrono::duration_cast<std::chrono::seconds>(now).count() <= std::max(v.mtim_sec, v.ctim_sec) + 1)
+      {
+        return;
+      }
+      size_t leafnames = 0;
+      for(auto &i : buffers)
+      {
+        leafnames += i.leafname.native_size() + 1;
+      }
+      item_t item{v, metadata, {}, buffers.size(), leafnames, std::chrono::steady_clock::now()};
+      if(item.bytes() > max_bytes || leafnames > (uint32_t) -1)
+      {
+        return;
+      }
+      item.arena.reset(new(std::nothrow) char[item.bytes()]);
+      if(!item.arena)
+      {
+        return;
+      }
+      auto *entries = reinterpret_cast<entry_t *>(item.arena.get());
+      char *leafname = item.arena.get() + item.count * sizeof(entry_t);
+      uint32_t offset = 0;
+      for(size_t n = 0; n < buffers.size(); n++)
+      {
+        const auto &i = buffers[n];
+        const auto length = i.leafname.native_size();
+        entries[n] = {i.stat.st_ino, offset, (uint16_t) length, i.stat.st_type};
+        memcpy(leafname + offset, i.leafname._raw_data(), length);
+        leafname[offset + length] = 0;
+        offset += (uint32_t)(length + 1);
+      }
+      std::lock_guard<std::mutex> g(lock);
+      try
+      {
+        auto it = items.find(key);
+        if(it != items.end())
+        {
+          bytes -= it->second.bytes();
+          it->second = std::move(item);
+          bytes += it->second.bytes();
+        }
+        else
+        {
+          bytes += item.bytes();
+          items.emplace(key, std::move(item));
+        }
+      }
+      catch(...)
+      {
+        return;
+      }
+      _trim_locked({}, max_bytes);
+    }
+
+    // Releases enumerations last used before older_than, then the least recently used until no more than max_remaining bytes are retained
+    std::pair<size_t, size_t> _trim_locked(std::chrono::steady_clock::time_point older_than, size_t max_remaining) noexcept
+    {
+      size_t trimmed_items = 0, trimmed_bytes = 0;
+      auto release = [&](decltype(items)::iterator it) {
+        ++trimmed_items;
+        trimmed_bytes += it->second.bytes();
+        bytes -= it->second.bytes();
+        return items.erase(it);
+      };
+      for(auto it = items.begin(); it != items.end();)
+      {
+        it = (it->second.last_used < older_than) ? release(it) : std::next(it);
+      }
+      while(bytes > max_remaining && !items.empty())
+      {
+        auto oldest = items.begin();
+        for(auto it = items.begin(); it != items.end(); ++it)
+        {
+          if(it->second.last_used < oldest->second.last_used)
+          {
+            oldest = it;
+          }
+        }
+        release(oldest);
+      }
+      return {trimmed_items, trimmed_bytes};
+    }
+  };
+  inline directory_enumeration_cache_t &directory_enumeration_cache() noexcept
+  {
+    static directory_enumeration_cache_t v;
+    return v;
+  }
+}  // namespace detail
+
 result<directory_handle::buffers_type> directory_handle::read(io_request<buffers_type> req, deadline /*unused*/) const noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
@@ -346,6 +579,77 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
     return syscall(SYS_getdirentries64, fd, buf, count, &foo);
   });
 #endif
+  optional<detail::posix_glob_matcher> globmatcher;
+  if(!req.glob.empty())
+  {
+    globmatcher.emplace(zglob.buffer);
+  }
+  auto &cache = detail::directory_enumeration_cache();
+  const bool cacheable = req.kernelbuffer.empty() && cache.enabled.load(std::memory_order_relaxed);
+  detail::directory_enumeration_cache_t::key_t cachekey{0, 0};
+  detail::directory_enumeration_cache_t::validity_t cachevalidity{0, 0, 0, 0};
+  if(cacheable)
+  {
+    struct stat s
+    {
+    };
+    if(-1 == ::fstat(_v.fd, &s))
+    {
+      return posix_error();
+    }
+    cachekey = {(uint64_t) s.st_dev, (uint64_t) s.st_ino};
+    cachevalidity = detail::directory_enumeration_cache_t::validity(s);
+    std::unique_lock<std::mutex> g(cache.lock);
+    auto it = cache.items.find(cachekey);
+    if(it != cache.items.end() && it->second.validity == cachevalidity)
+    {
+      // Serve from the cache, copying its leafnames into the kernel buffer so they outlive any trim
+      auto &item = it->second;
+      item.last_used = std::chrono::steady_clock::now();
+      ++cache.hits;
+      if(req.buffers._kernel_buffer_size < item.leafnames)
+      {
+        auto *mem = (char *) operator new[](item.leafnames, std::nothrow);  // don't initialise
+        if(mem == nullptr)
+        {
+          return errc::not_enough_memory;
+        }
+        req.buffers._kernel_buffer.reset();
+        req.buffers._kernel_buffer = std::unique_ptr<char[]>(mem);
+        req.buffers._kernel_buffer_size = item.leafnames;
+      }
+      memcpy(req.buffers._kernel_buffer.get(), item.leafname_storage(), item.leafnames);
+      size_t n = 0;
+      bool done = true;
+      for(size_t idx = 0; idx < item.count; idx++)
+      {
+        const auto &entry = item.entries()[idx];
+        const char *leafname = req.buffers._kernel_buffer.get() + entry.leafname_offset;
+        if(globmatcher && !(*globmatcher)(leafname, entry.leafname_length))
+        {
+          continue;
+        }
+        if(n >= req.buffers.size())
+        {
+          done = false;
+          break;
+        }
+        directory_entry &out = req.buffers[n++];
+        out.leafname = path_view(leafname, entry.leafname_length, true);
+        out.stat = stat_t(nullptr);
+        out.stat.st_ino = entry.ino;
+        out.stat.st_type = entry.type;
+      }
+      const auto metadata = item.metadata;
+      g.unlock();
+      req.buffers._resize(n);
+      OUTCOME_TRY(_fill_wanted_metadata(req.buffers, req.want));
+      req.buffers._metadata = metadata | req.want;
+      req.buffers._done = done;
+      return std::move(req.buffers);
+    }
+    ++cache.misses;
+  }
   if(!req.buffers._kernel_buffer && req.kernelbuffer.empty())
   {
     // Let's assume the average leafname will be 64 characters long.
@@ -426,7 +730,7 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
           goto cont;
         }
       }
-      if(!req.glob.empty() && fnmatch(zglob.buffer, dent->d_name, 0) != 0)
+      if(globmatcher && !(*globmatcher)(dent->d_name, length))
       {
         goto cont;
       }
@@ -470,18 +774,116 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
     {
       // Fill is complete
       req.buffers._resize(n);
-      req.buffers._metadata = default_stat_contents;
+      if(cacheable && req.glob.empty())
+      {
+        cache.add(cachekey, cachevalidity, default_stat_contents, req.buffers);
+      }
+      OUTCOME_TRY(_fill_wanted_metadata(req.buffers, req.want));
+      req.buffers._metadata = default_stat_contents | req.want;
       req.buffers._done = true;
       return std::move(req.buffers);
     }
     if(n >= req.buffers.size())
     {
       // Fill is incomplete
-      req.buffers._metadata = default_stat_contents;
+      OUTCOME_TRY(_fill_wanted_metadata(req.buffers, req.want));
+      req.buffers._metadata = default_stat_contents | req.want;
       req.buffers._done = false;
       return std::move(req.buffers);
     }
   }
 }
 
+result<void> directory_handle::_fill_wanted_metadata(buffers_type &buffers, stat_t::want wanted) const noexcept
+{
+  if(!wanted || buffers.empty())
+  {
+    return success();
+  }
+  // Entries deleted since being enumerated keep only the metadata enumeration returned
+  auto fill = [&](size_t begin, size_t end) -> int {
+    for(size_t n = begin; n < end; n++)
+    {
+      auto &item = buffers[n];
+      auto r = detail::stat_fill_at(item.stat, nullptr, _v.fd, reinterpret_cast<const char *>(item.leafname._raw_data()), wanted, true);
+      if(!r && r.error() != errc::no_such_file_or_directory)
+      {
+        return errno;
+      }
+    }
+    return 0;
+  };
+  // statx() of cold inodes waits upon storage, so large enumerations go faster in parallel
+  const size_t threads = (buffers.size() < 256 || (_flags & flag::disable_parallelism)) ? 1 : 4;
+  const size_t perthread = (buffers.size() + threads - 1) / threads;
+  std::vector<std::thread> workers;
+  std::vector<int> errcodes;
+  try
+  {
+    errcodes.resize(threads - 1, 0);
+    workers.reserve(threads - 1);
+    for(size_t t = 1; t < threads; t++)
+    {
+      workers.emplace_back([&, t] { errcodes[t - 1] = fill((std::min)(t * perthread, buffers.size()), (std::min)((t + 1) * perthread, buffers.size())); });
+    }
+  }
+  catch(...)
+  {
+    // Do the work of any threads which couldn't be launched
+  }
+  int errcode = fill(0, (std::min)(perthread, buffers.size()));
+  if(errcode == 0)
+  {
+    errcode = fill((std::min)((1 + workers.size()) * perthread, buffers.size()), buffers.size());
+  }
+  for(size_t t = 0; t < workers.size(); t++)
+  {
+    workers[t].join();
+    if(errcode == 0)
+    {
+      errcode = errcodes[t];
+    }
+  }
+  if(errcode != 0)
+  {
+    return posix_error(errcode);
+  }
+  return success();
+}
+
+bool directory_handle::set_enumeration_cache_enabled(bool enabled) noexcept
+{
+  auto &cache = detail::directory_enumeration_cache();
+  const bool ret = cache.enabled.exchange(enabled, std::memory_order_acq_rel);
+  if(!enabled)
+  {
+    std::lock_guard<std::mutex> g(cache.lock);
+    cache._trim_locked(std::chrono::steady_clock::time_point::max(), 0);
+  }
+  return ret;
+}
+
+void directory_handle::set_enumeration_cache_limits(size_t max_bytes) noexcept
+{
+  auto &cache = detail::directory_enumeration_cache();
+  std::lock_guard<std::mutex> g(cache.lock);
+  cache.max_bytes = max_bytes;
+  cache._trim_locked({}, max_bytes);
+}
+
+directory_handle::enumeration_cache_statistics directory_handle::trim_enumeration_cache(std::chrono::steady_clock::time_point older_than) noexcept
+{
+  auto &cache = detail::directory_enumeration_cache();
+  std::lock_guard<std::mutex> g(cache.lock);
+  enumeration_cache_statistics ret;
+  auto trimmed = cache._trim_locked(older_than, (size_t) -1);
+  ret.items_just_trimmed = trimmed.first;
+  ret.bytes_just_trimmed = trimmed.second;
+  ret.items_in_cache = cache.items.size();
+  ret.bytes_in_cache = cache.bytes;
+  ret.hits = cache.hits;
+  ret.misses = cache.misses;
+  return ret;
+}
+
 LLFIO_V2_NAMESPACE_END
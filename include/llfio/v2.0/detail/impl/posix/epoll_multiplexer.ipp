@@ -0,0 +1,818 @@
+/* Multiplex file i/o
+(C) 2020 Niall Douglas <http://www.nedproductions.biz/> (9 commits)
+File Created: May 2019
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../../io_handle.hpp"
+
+#if !LLFIO_INCLUDED_BY_HEADER || !defined(LLFIO_IO_HANDLE_H)
+#error This file should never be included directly
+#endif
+
+#ifndef __linux__
+#error This implementation file is for Linux only
+#endif
+
+#include <algorithm>
+#include <climits>  // for IOV_MAX
+#include <memory>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "quickcpplib/signal_guard.hpp"
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+/* epoll is a readiness, not a completion, notification mechanism, so this i/o
+multiplexer is a reactor:
+
+- i/o initiated upon a handle with no i/o already queued is attempted immediately
+using non-blocking `readv()`/`writev()`. If it succeeds, the i/o completes and finishes
+immediately without ever being initiated.
+
+- Otherwise the i/o is queued per handle, reads and writes separately, in the order
+initiated. Each handle is registered edge triggered with the epoll instance, so when
+the kernel says the handle has become readable or writable, queued i/o is retried
+until the kernel returns `EAGAIN`, or the queue empties.
+
+- As each edge is reported only once, a handle whose queued i/o may still be ready when
+`max_completions` runs out is remembered in a list of ready handles, which the next
+`check_for_any_completed_io()` retries before waiting upon the kernel.
+
+- Queued i/o with a deadline is armed in a timer wheel whilst queued. epoll_wait() sleeps
+no later than the wheel next needs advancing, and queued i/o whose deadline has passed
+is dequeued and completed with `ETIMEDOUT`.
+
+- epoll cannot poll regular files, so only pollable handles (pipes, sockets, character
+devices etc) can be registered. Barriers upon those are a no-op.
+
+- An eventfd is registered with the epoll instance so `wake_check_for_any_completed_io()`
+can interrupt another thread blocked in `check_for_any_completed_io()`.
+*/
+template <bool is_threadsafe> class linux_epoll_multiplexer final : public io_multiplexer_impl<is_threadsafe>
+{
+  using _base = io_multiplexer_impl<is_threadsafe>;
+  using _multiplexer_lock_guard = typename _base::_lock_guard;
+
+  using path_type = typename _base::path_type;
+  using extent_type = typename _base::extent_type;
+  using size_type = typename _base::size_type;
+  using mode = typename _base::mode;
+  using creation = typename _base::creation;
+  using caching = typename _base::caching;
+  using flag = typename _base::flag;
+  using barrier_kind = typename _base::barrier_kind;
+  using const_buffers_type = typename _base::const_buffers_type;
+  using buffers_type = typename _base::buffers_type;
+  using registered_buffer_type = typename _base::registered_buffer_type;
+  template <class T> using io_request = typename _base::template io_request<T>;
+  template <class T> using io_result = typename _base::template io_result<T>;
+  using io_operation_state = typename _base::io_operation_state;
+  using io_operation_state_visitor = typename _base::io_operation_state_visitor;
+  using check_for_any_completed_io_statistics = typename _base::check_for_any_completed_io_statistics;
+
+  struct _epoll_operation_state final
+      : public std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>,
+        public io_multiplexer_timer_wheel::node  // armed whilst queued if it has a deadline
+  {
+    using _impl = std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>;
+
+    _epoll_operation_state *prev{nullptr}, *next{nullptr};
+    // Cached here from the handle for performance
+    int fd{-1};
+    bool is_queued{false};
+    uint64_t initiated_ns{0};  // when initiated, for check_for_any_completed_io_statistics
+
+    _epoll_operation_state() = default;
+    // Construct implicitly from the base implementation, see relocate_to()
+    explicit _epoll_operation_state(_impl &&o) noexcept
+        : _impl(std::move(o))
+    {
+    }
+    using _impl::_impl;
+
+    // You will need to reimplement this to relocate any custom state defined
+    // here, and to restamp to vptr with this finalised dynamic type. It is
+    // important to do this, as final-based optimisations compare the vptr
+    // to the finalised vptr and do non-indirect dispatch if they match.
+    virtual io_operation_state *relocate_to(byte *to_) noexcept override
+    {
+      assert(!is_queued);
+      auto *to = _impl::relocate_to(to_);
+      // restamp the vptr with my own
+      auto _to = new(to) _epoll_operation_state(std::move(*static_cast<_impl *>(to)));
+      _to->fd = fd;
+      return _to;
+    }
+  };
+
+  struct _queue_t
+  {
+    _epoll_operation_state *first{nullptr}, *last{nullptr};
+
+    bool empty() const noexcept { return first == nullptr; }
+    void push_back(_epoll_operation_state *state) noexcept
+    {
+      assert(state->prev == nullptr);
+      assert(state->next == nullptr);
+      assert(first != state);
+      assert(last != state);
+      if(first == nullptr)
+      {
+        first = last = state;
+      }
+      else
+      {
+        assert(last->next == nullptr);
+        state->prev = last;
+        last->next = state;
+        last = state;
+      }
+      state->is_queued = true;
+    }
+    void remove(_epoll_operation_state *state) noexcept
+    {
+      if(state->prev == nullptr)
+      {
+        assert(first == state);
+        first = state->next;
+      }
+      else
+      {
+        state->prev->next = state->next;
+      }
+      if(state->next == nullptr)
+      {
+        assert(last == state);
+        last = state->prev;
+      }
+      else
+      {
+        state->next->prev = state->prev;
+      }
+      state->next = state->prev = nullptr;
+      state->is_queued = false;
+    }
+  };
+
+  struct _registered_fd
+  {
+    int fd{-1};
+    // Initiated i/o waiting for the handle to become ready
+    _queue_t queued_reads, queued_writes;
+    // Set if an edge was seen whose queued i/o was not retried until EAGAIN, and if in _ready_fds
+    bool read_ready{false}, write_ready{false}, in_ready_fds{false};
+
+    constexpr _registered_fd() {}
+    explicit _registered_fd(int _fd)
+        : fd(_fd)
+    {
+    }
+    bool operator<(int o) const noexcept { return fd < o; }
+  };
+
+  int _eventfd{-1};
+  int _wakecount{0};
+  // Kept sorted by fd. epoll reports the fd, not a pointer, as the entry may be
+  // deregistered by another thread between epoll_wait() returning and us taking the lock.
+  std::vector<_registered_fd> _registered_fds;
+  // Handles with queued i/o known to be ready, oldest first. Capacity is reserved for every
+  // registered handle, so appending never allocates.
+  std::vector<int> _ready_fds;
+  io_multiplexer_timer_wheel _deadlines;
+
+  typename std::vector<_registered_fd>::iterator _find_fd(int fd) noexcept
+  {
+    auto it = std::lower_bound(_registered_fds.begin(), _registered_fds.end(), fd);
+    if(it == _registered_fds.end() || it->fd != fd)
+    {
+      return _registered_fds.end();
+    }
+    return it;
+  }
+
+  // Performs one non-blocking attempt at the i/o, returning bytes transferred or -errno
+  static ssize_t _attempt(_epoll_operation_state *state, bool is_read) noexcept
+  {
+    ssize_t ret;
+    if(is_read)
+    {
+      auto &reqs = state->payload.noncompleted.params.read.reqs;
+      ret = ::readv(state->fd, reinterpret_cast<struct iovec *>(reqs.buffers.data()), (int) reqs.buffers.size());
+    }
+    else
+    {
+      auto &reqs = state->payload.noncompleted.params.write.reqs;
+      auto *iov = reinterpret_cast<struct iovec *>(const_cast<typename const_buffers_type::value_type *>(reqs.buffers.data()));
+      // Can't guarantee that user code hasn't enabled SIGPIPE
+      ret = QUICKCPPLIB_NAMESPACE::signal_guard::signal_guard(
+      QUICKCPPLIB_NAMESPACE::signal_guard::signalc_set::broken_pipe, [&] { return ::writev(state->fd, iov, (int) reqs.buffers.size()); },
+      [&](const QUICKCPPLIB_NAMESPACE::signal_guard::raised_signal_info * /*unused*/) {
+        errno = EPIPE;
+        return (ssize_t) -1;
+      });
+    }
+    if(ret < 0)
+    {
+      return (EWOULDBLOCK == errno) ? -EAGAIN : -errno;
+    }
+    return ret;
+  }
+
+  template <class BuffersType> static BuffersType _trim_buffers(BuffersType buffers, size_t bytes) noexcept
+  {
+    for(size_t i = 0; i < buffers.size(); i++)
+    {
+      auto &buffer = buffers[i];
+      if(buffer.size() <= bytes)
+      {
+        bytes -= buffer.size();
+      }
+      else
+      {
+        buffer = {buffer.data(), (size_type) bytes};
+        buffers = {buffers.data(), i + 1};
+        break;
+      }
+    }
+    return buffers;
+  }
+  // Completes and then immediately finishes an i/o. Must be called WITHOUT the multiplexer
+  // lock held, as the visitor may initiate new i/o. The state may be destroyed on return.
+  static void _complete_and_finish(_epoll_operation_state *state, ssize_t res) noexcept
+  {
+    switch(state->current_state())
+    {
+    case io_operation_state_type::read_initialised:
+    case io_operation_state_type::read_initiated:
+    {
+      if(res < 0)
+      {
+        state->read_completed(io_result<buffers_type>(posix_error((int) -res)));
+      }
+      else
+      {
+        state->read_completed(io_result<buffers_type>(_trim_buffers(state->payload.noncompleted.params.read.reqs.buffers, (size_t) res)));
+      }
+      state->read_finished();
+      break;
+    }
+    case io_operation_state_type::write_initialised:
+    case io_operation_state_type::write_initiated:
+    {
+      if(res < 0)
+      {
+        state->write_completed(io_result<const_buffers_type>(posix_error((int) -res)));
+      }
+      else
+      {
+        state->write_completed(io_result<const_buffers_type>(_trim_buffers(state->payload.noncompleted.params.write.reqs.buffers, (size_t) res)));
+      }
+      state->write_or_barrier_finished();
+      break;
+    }
+    default:
+      abort();
+    }
+  }
+
+  // Retries queued i/o upon a handle which has become ready, until the kernel says it would
+  // block. Must be called with the multiplexer lock held, which is released whilst visitors are invoked.
+  // Returns true if queued i/o remains which may still be ready, as max_completions ran out first.
+  bool _process(int fd, bool is_read, _multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    for(;;)
+    {
+      // Look up afresh each time, as the lock is released during completion
+      auto it = _find_fd(fd);
+      if(it == _registered_fds.end())
+      {
+        return false;
+      }
+      auto &queue = is_read ? it->queued_reads : it->queued_writes;
+      auto *state = queue.first;
+      if(state == nullptr)
+      {
+        return false;
+      }
+      if(max_completions == 0)
+      {
+        return true;
+      }
+      const ssize_t res = _attempt(state, is_read);
+      if(-EAGAIN == res)
+      {
+        return false;  // wait for the next edge
+      }
+      queue.remove(state);
+      _deadlines.disarm(state);
+      this->_completion_stats.completed(stats, state->initiated_ns);
+      g.unlock();
+      _complete_and_finish(state, res);
+      g.lock();
+      ++stats.initiated_ios_finished;
+      --max_completions;
+    }
+  }
+  // Remembers that a handle's queued i/o may still be ready, as its edge will not be reported again
+  void _mark_ready(int fd, bool is_read) noexcept
+  {
+    auto it = _find_fd(fd);
+    if(it == _registered_fds.end())
+    {
+      return;
+    }
+    (is_read ? it->read_ready : it->write_ready) = true;
+    if(!it->in_ready_fds)
+    {
+      assert(_ready_fds.size() < _ready_fds.capacity());
+      it->in_ready_fds = true;
+      _ready_fds.push_back(fd);
+    }
+  }
+  // Retries queued i/o upon handles remembered as ready, oldest first. Must be called with
+  // the multiplexer lock held, which is released whilst visitors are invoked.
+  void _process_ready(_multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    // Handles still ready afterwards are appended, so visit each handle present on entry once
+    for(size_t togo = _ready_fds.size(); togo > 0 && max_completions > 0 && !_ready_fds.empty(); togo--)
+    {
+      const int fd = _ready_fds.front();
+      _ready_fds.erase(_ready_fds.begin());
+      auto it = _find_fd(fd);
+      if(it == _registered_fds.end())
+      {
+        continue;
+      }
+      const bool read_ready = it->read_ready, write_ready = it->write_ready;
+      it->read_ready = it->write_ready = it->in_ready_fds = false;
+      if(read_ready && _process(fd, true, g, max_completions, stats))
+      {
+        _mark_ready(fd, true);
+      }
+      if(write_ready && _process(fd, false, g, max_completions, stats))
+      {
+        _mark_ready(fd, false);
+      }
+    }
+  }
+
+  // Completes queued i/o whose deadline has passed. Must be called with the multiplexer lock
+  // held, which is released whilst visitors are invoked.
+  void _expire(_multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    const auto now = std::chrono::steady_clock::now();
+    while(max_completions > 0)
+    {
+      auto *state = static_cast<_epoll_operation_state *>(_deadlines.pop_expired(now));
+      if(state == nullptr)
+      {
+        return;
+      }
+      auto it = _find_fd(state->fd);
+      assert(it != _registered_fds.end());
+      const bool is_read = (state->current_state() == io_operation_state_type::read_initiated);
+      (is_read ? it->queued_reads : it->queued_writes).remove(state);
+      this->_completion_stats.completed(stats, state->initiated_ns);
+      g.unlock();
+      _complete_and_finish(state, -ETIMEDOUT);
+      g.lock();
+      ++stats.initiated_ios_finished;
+      --max_completions;
+    }
+  }
+
+public:
+  constexpr linux_epoll_multiplexer() {}
+  linux_epoll_multiplexer(const linux_epoll_multiplexer &) = delete;
+  linux_epoll_multiplexer(linux_epoll_multiplexer &&) = delete;
+  linux_epoll_multiplexer &operator=(const linux_epoll_multiplexer &) = delete;
+  linux_epoll_multiplexer &operator=(linux_epoll_multiplexer &&) = delete;
+  virtual ~linux_epoll_multiplexer()
+  {
+    if(this->_v)
+    {
+      (void) linux_epoll_multiplexer::close();
+    }
+    else if(-1 != _eventfd)
+    {
+      // init() failed part way through
+      (void) ::close(_eventfd);
+    }
+  }
+  result<void> init(size_t threads)
+  {
+    (void) threads;
+    _eventfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(-1 == _eventfd)
+    {
+      return posix_error();
+    }
+    this->_v.fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if(-1 == this->_v.fd)
+    {
+      return posix_error();
+    }
+    this->_v.behaviour |= native_handle_type::disposition::multiplexer;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = _eventfd;
+    if(-1 == ::epoll_ctl(this->_v.fd, EPOLL_CTL_ADD, _eventfd, &ev))
+    {
+      return posix_error();
+    }
+    return success();
+  }
+
+  // These functions are inherited from handle
+  virtual result<path_type> current_path() const noexcept override
+  {
+    // epoll file descriptors have no path
+    return success();
+  }
+  virtual result<void> close() noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    if(-1 != _eventfd)
+    {
+      if(-1 == ::close(_eventfd))
+      {
+        return posix_error();
+      }
+      _eventfd = -1;
+    }
+    _registered_fds.clear();
+    _ready_fds.clear();
+#ifndef NDEBUG
+    if(this->_v)
+    {
+      // Tell handle::close() that we have correctly executed
+      this->_v.behaviour |= native_handle_type::disposition::_child_close_executed;
+    }
+#endif
+    return _base::close();
+  }
+
+  virtual result<uint8_t> do_io_handle_register(io_handle *h) noexcept override  // linear complexity to total handles registered
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    try
+    {
+      _multiplexer_lock_guard g(this->_lock);
+      const int fd = h->native_handle().fd;
+      auto it = std::lower_bound(_registered_fds.begin(), _registered_fds.end(), fd);
+      if(it != _registered_fds.end() && it->fd == fd)
+      {
+        return errc::device_or_resource_busy;
+      }
+      _ready_fds.reserve(_registered_fds.size() + 1);
+      it = _registered_fds.insert(it, _registered_fd(fd));
+      struct epoll_event ev;
+      memset(&ev, 0, sizeof(ev));
+      ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+      ev.data.fd = fd;
+      if(-1 == ::epoll_ctl(this->_v.fd, EPOLL_CTL_ADD, fd, &ev))
+      {
+        const int e = errno;
+        _registered_fds.erase(it);
+        if(EPERM == e)
+        {
+          return errc::operation_not_supported;  // regular files and directories cannot be polled
+        }
+        return posix_error(e);
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  virtual result<void> do_io_handle_deregister(io_handle *h) noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    _multiplexer_lock_guard g(this->_lock);
+    auto it = _find_fd(h->native_handle().fd);
+    if(it == _registered_fds.end())
+    {
+      return errc::invalid_argument;
+    }
+    if(!it->queued_reads.empty() || !it->queued_writes.empty())
+    {
+      return errc::operation_in_progress;
+    }
+    if(-1 == ::epoll_ctl(this->_v.fd, EPOLL_CTL_DEL, it->fd, nullptr))
+    {
+      return posix_error();
+    }
+    if(it->in_ready_fds)
+    {
+      _ready_fds.erase(std::find(_ready_fds.begin(), _ready_fds.end(), it->fd));
+    }
+    _registered_fds.erase(it);
+    return success();
+  }
+
+  virtual size_t do_io_handle_max_buffers(const io_handle * /*unused*/) const noexcept override { return IOV_MAX; }
+
+  virtual std::pair<size_t, size_t> io_state_requirements() noexcept override { return {sizeof(_epoll_operation_state), alignof(_epoll_operation_state)}; }
+
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_epoll_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_epoll_operation_state)) == 0);
+    if(storage.size() < sizeof(_epoll_operation_state) || ((uintptr_t) storage.data() % alignof(_epoll_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _epoll_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_epoll_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_epoll_operation_state)) == 0);
+    if(storage.size() < sizeof(_epoll_operation_state) || ((uintptr_t) storage.data() % alignof(_epoll_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _epoll_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs, barrier_kind kind) noexcept override
+  {
+    assert(storage.size() >= sizeof(_epoll_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_epoll_operation_state)) == 0);
+    if(storage.size() < sizeof(_epoll_operation_state) || ((uintptr_t) storage.data() % alignof(_epoll_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _epoll_operation_state(_h, _visitor, std::move(b), d, std::move(reqs), kind);
+  }
+
+  virtual io_operation_state_type init_io_operation(io_operation_state *_op) noexcept override
+  {
+    auto *state = static_cast<_epoll_operation_state *>(_op);
+    state->fd = state->h->native_handle().fd;
+    bool is_read = false;
+    switch(state->current_state())
+    {
+    case io_operation_state_type::read_initialised:
+      is_read = true;
+      break;
+    case io_operation_state_type::write_initialised:
+      break;
+    case io_operation_state_type::barrier_initialised:
+      // Only pollable handles can be registered, and barriers on those are a no-op
+      this->_completion_stats.completed_immediately();
+      state->barrier_completed(io_result<const_buffers_type>(const_buffers_type()));
+      state->write_or_barrier_finished();
+      return io_operation_state_type::write_or_barrier_finished;
+    default:
+      assert(false);
+      return state->current_state();
+    }
+    _multiplexer_lock_guard g(this->_lock);
+    auto it = _find_fd(state->fd);
+    if(it == _registered_fds.end())
+    {
+      abort();  // i/o upon a handle not registered with this multiplexer
+    }
+    auto &queue = is_read ? it->queued_reads : it->queued_writes;
+    if(queue.empty())
+    {
+      // Try to eagerly complete the i/o now
+      const ssize_t res = _attempt(state, is_read);
+      if(-EAGAIN != res)
+      {
+        g.unlock();
+        this->_completion_stats.completed_immediately();
+        _complete_and_finish(state, res);
+        // state may have been destroyed by the finish
+        return is_read ? io_operation_state_type::read_finished : io_operation_state_type::write_or_barrier_finished;
+      }
+    }
+    // Otherwise the i/o has been initiated and will complete when the handle becomes ready.
+    // The multiplexer lock must be held until queued, else the readiness edge could be missed.
+    if(is_read)
+    {
+      state->read_initiated();
+    }
+    else
+    {
+      state->write_initiated();
+    }
+    state->initiated_ns = this->_completion_stats.initiated();
+    queue.push_back(state);
+    if(state->payload.noncompleted.d)
+    {
+      _deadlines.arm(state, io_multiplexer_timer_wheel::expiry(state->payload.noncompleted.d));
+    }
+    return state->current_state();
+  }
+
+  virtual io_operation_state_type check_io_operation(io_operation_state *_op) noexcept override
+  {
+    auto s = _op->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    (void) check_for_any_completed_io(std::chrono::seconds(0));
+    return _op->current_state();
+  }
+
+  virtual result<io_operation_state_type> cancel_io_operation(io_operation_state *_op, deadline /*unused*/ = {}) noexcept override
+  {
+    auto *state = static_cast<_epoll_operation_state *>(_op);
+    _multiplexer_lock_guard g(this->_lock);
+    const auto s = state->current_state();
+    if(!is_initiated(s) || !state->is_queued)
+    {
+      return s;
+    }
+    // Queued i/o has not touched the kernel yet, so cancellation is always immediate
+    auto it = _find_fd(state->fd);
+    assert(it != _registered_fds.end());
+    const bool is_read = (s == io_operation_state_type::read_initiated);
+    (is_read ? it->queued_reads : it->queued_writes).remove(state);
+    _deadlines.disarm(state);
+    this->_completion_stats.cancelled();
+    g.unlock();
+    _complete_and_finish(state, -ECANCELED);
+    // state may have been destroyed by the finish
+    return is_read ? io_operation_state_type::read_finished : io_operation_state_type::write_or_barrier_finished;
+  }
+
+  virtual result<check_for_any_completed_io_statistics> check_for_any_completed_io(deadline d = std::chrono::seconds(0), size_t max_completions = (size_t) -1) noexcept override
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    check_for_any_completed_io_statistics ret;
+    while(max_completions > 0)
+    {
+      // Firstly retry handles known to be ready from before, whose edges will not be reported again
+      bool ready_processed = false;
+      {
+        _multiplexer_lock_guard g(this->_lock);
+        if(!_ready_fds.empty())
+        {
+          const size_t finished_before = ret.initiated_ios_finished;
+          _process_ready(g, max_completions, ret);
+          this->_completion_stats.reaped(ret, ret.initiated_ios_finished - finished_before);
+          ready_processed = (ret.initiated_ios_finished != finished_before);
+        }
+      }
+      if(max_completions == 0)
+      {
+        break;
+      }
+      int mstimeout = -1;
+      if(d)
+      {
+        std::chrono::nanoseconds ns(0);
+        if(d.steady)
+        {
+          if(d.nsecs != 0)
+          {
+            ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds(d.nsecs)) - std::chrono::steady_clock::now());
+          }
+        }
+        else
+        {
+          ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d.to_time_point() - std::chrono::system_clock::now());
+        }
+        // Round up, so we don't spin on sub-millisecond timeouts
+        mstimeout = (ns.count() <= 0) ? 0 : (int) std::min<long long>((ns.count() + 999999) / 1000000, INT_MAX);
+      }
+      // Sleep no later than the next deadline of queued i/o
+      const int caller_mstimeout = mstimeout;
+      if(ready_processed)
+      {
+        mstimeout = 0;  // only collect whatever else is ready
+      }
+      if(!_deadlines.empty())
+      {
+        _multiplexer_lock_guard g(this->_lock);
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_deadlines.next_expiry() - std::chrono::steady_clock::now()).count();
+        const int ms = (ns <= 0) ? 0 : (int) std::min<long long>((ns + 999999) / 1000000, INT_MAX);
+        if(mstimeout < 0 || ms < mstimeout)
+        {
+          mstimeout = ms;
+        }
+      }
+      struct epoll_event events[64];
+      // Multiple threads may wait here concurrently
+      int count;
+      {
+        LLFIO_TRACE_SYSCALL(this, "epoll_wait");
+        count = ::epoll_wait(this->_v.fd, events, (int) std::min<size_t>(64, max_completions), mstimeout);
+      }
+      if(count < 0 && EINTR != errno)
+      {
+        return posix_error();
+      }
+      _multiplexer_lock_guard g(this->_lock);
+      const size_t finished_before = ret.initiated_ios_finished;
+      for(int n = 0; n < count; n++)
+      {
+        const int fd = events[n].data.fd;
+        if(fd == _eventfd)
+        {
+          uint64_t v;
+          (void) ::read(_eventfd, &v, sizeof(v));
+          continue;
+        }
+        // The edges of events beyond max_completions are remembered, else they would be lost
+        const uint32_t e = events[n].events;
+        if((e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0 && _process(fd, true, g, max_completions, ret))
+        {
+          _mark_ready(fd, true);
+        }
+        if((e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) != 0 && _process(fd, false, g, max_completions, ret))
+        {
+          _mark_ready(fd, false);
+        }
+      }
+      if(!_deadlines.empty())
+      {
+        _expire(g, max_completions, ret);
+      }
+      this->_completion_stats.reaped(ret, ret.initiated_ios_finished - finished_before);
+      if(ret.initiated_ios_completed + ret.initiated_ios_finished > 0)
+      {
+        break;
+      }
+      // If another kernel thread woke me, exit the loop
+      if(_wakecount > 0)
+      {
+        --_wakecount;
+        break;
+      }
+      if(caller_mstimeout == 0)
+      {
+        break;
+      }
+    }
+    this->_completion_stats.report(ret);
+    return ret;
+  }
+
+  virtual result<void> wake_check_for_any_completed_io() noexcept override
+  {
+    _multiplexer_lock_guard g(this->_lock);
+    ++_wakecount;
+    uint64_t v = 1;
+    if(-1 == ::write(_eventfd, &v, sizeof(v)) && EAGAIN != errno)
+    {
+      return posix_error();
+    }
+    return success();
+  }
+};
+
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_linux_epoll(size_t threads) noexcept
+{
+  try
+  {
+    if(1 == threads)
+    {
+      auto ret = std::make_unique<linux_epoll_multiplexer<false>>();
+      OUTCOME_TRY(ret->init(1));
+      return io_multiplexer_ptr(ret.release());
+    }
+    auto ret = std::make_unique<linux_epoll_multiplexer<true>>();
+    OUTCOME_TRY(ret->init(threads));
+    return io_multiplexer_ptr(ret.release());
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_V2_NAMESPACE_END
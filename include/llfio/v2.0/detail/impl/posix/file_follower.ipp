@@ -0,0 +1,144 @@
+/* Follows a file being appended to by a third party (POSIX)
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../../file_follower.hpp"
+#include "import.hpp"
+
+#include <climits>  // for INT_MAX
+#include <poll.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#else
+#include <sys/event.h>
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+result<file_follower> file_follower::follow(mapped_file_handle &mfh, extent_type offset) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&mfh);
+  result<file_follower> ret(in_place_type<file_follower>);
+  auto &f = ret.assume_value();
+  f._mfh = &mfh;
+  f._offset = offset;
+#ifdef __linux__
+  f._fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(-1 == f._fd)
+  {
+    return posix_error();
+  }
+  // inotify watches paths, but the magic link names the inode open even if renamed or unlinked
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", mfh.native_handle().fd);
+  if(-1 == ::inotify_add_watch(f._fd, path, IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE))
+  {
+    return posix_error();
+  }
+#else
+  f._fd = ::kqueue();
+  if(-1 == f._fd)
+  {
+    return posix_error();
+  }
+  struct kevent ev;
+  EV_SET(&ev, mfh.native_handle().fd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB, 0, nullptr);
+  if(-1 == ::kevent(f._fd, &ev, 1, nullptr, 0, nullptr))
+  {
+    return posix_error();
+  }
+#endif
+  return ret;
+}
+
+result<void> file_follower::_wait(deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(_mfh);
+  std::chrono::nanoseconds ns(-1);
+  if(d)
+  {
+    ns = d.steady ? std::chrono::nanoseconds(d.nsecs) : std::chrono::duration_cast<std::chrono::nanoseconds>(d.to_time_point() - std::chrono::system_clock::now());
+    if(ns.count() < 0)
+    {
+      ns = std::chrono::nanoseconds(0);
+    }
+  }
+  for(;;)
+  {
+#ifdef __linux__
+    pollfd p;
+    memset(&p, 0, sizeof(p));
+    p.fd = _fd;
+    p.events = POLLIN;
+    const int mstimeout = (ns.count() < 0) ? -1 : (int) (std::min)((ns.count() + 999999) / 1000000, (decltype(ns.count())) INT_MAX);
+    const int ret = ::poll(&p, 1, mstimeout);
+    if(ret > 0)
+    {
+      // Discard the events, as they are only a hint to recheck the length
+      alignas(struct inotify_event) char buffer[4096];
+      while(::read(_fd, buffer, sizeof(buffer)) > 0)
+      {
+      }
+      return success();
+    }
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t) (ns.count() / 1000000000LL);
+    ts.tv_nsec = (long) (ns.count() % 1000000000LL);
+    struct kevent ev;
+    const int ret = ::kevent(_fd, nullptr, 0, &ev, 1, (ns.count() < 0) ? nullptr : &ts);
+    if(ret > 0)
+    {
+      return success();
+    }
+#endif
+    if(ret == 0)
+    {
+      return errc::timed_out;
+    }
+    if(errno != EINTR)
+    {
+      return posix_error();
+    }
+  }
+}
+
+result<void> file_follower::close() noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(_mfh);
+  _mfh = nullptr;
+  _offset = 0;
+  if(_fd != -1)
+  {
+    if(-1 == ::close(_fd))
+    {
+      _fd = -1;
+      return posix_error();
+    }
+    _fd = -1;
+  }
+  return success();
+}
+
+LLFIO_V2_NAMESPACE_END
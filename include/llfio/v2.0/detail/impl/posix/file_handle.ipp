@@ -23,14 +23,27 @@ Distributed under the Boost Software License, Version 1.0.
 */
 
 #include "../../../file_handle.hpp"
+#include "../file_handle.ipp"
 
 #include "import.hpp"
 
+#include <climits>  // for INT_MAX
+#include <mutex>
+
 #if defined(__FreeBSD__) || defined(__APPLE__)
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/uio.h>
 #endif
+#ifdef __linux__
+#include <linux/blkzoned.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/vfs.h>
+#endif
 
 LLFIO_V2_NAMESPACE_BEGIN
 
@@ -44,15 +57,8 @@ result<file_handle> file_handle::file(const path_handle &base, file_handle::path
   OUTCOME_TRY(auto &&attribs, attribs_from_handle_mode_caching_and_flags(nativeh, _mode, _creation, _caching, flags));
   attribs &= ~O_NONBLOCK;
   nativeh.behaviour &= ~native_handle_type::disposition::nonblocking;
-  path_view::c_str<> zpath(path);
-  if(base.is_valid())
-  {
-    nativeh.fd = ::openat(base.native_handle().fd, zpath.buffer, attribs, 0x1b0 /*660*/);
-  }
-  else
-  {
-    nativeh.fd = ::open(zpath.buffer, attribs, 0x1b0 /*660*/);
-  }
+  path_view::recycling_c_str<> zpath(path);
+  nativeh.fd = openat_with_resolve_flags(base.is_valid() ? base.native_handle().fd : AT_FDCWD, zpath.buffer, attribs, 0x1b0 /*660*/, flags);
   if(-1 == nativeh.fd)
   {
     if((mode::write == _mode || mode::append == _mode) && creation::always_new == _creation && EEXIST == errno)
@@ -426,6 +432,272 @@ result<std::vector<file_handle::extent_pair>> file_handle::extents() const noexc
   }
 }
 
+result<span<file_handle::extent_pair>> file_handle::extents(span<extent_pair> out, extent_pair range) const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(auto &&size, file_handle::maximum_extent());
+  extent_type rangeend = (range.offset + range.length < range.offset) ? (extent_type) -1 : range.offset + range.length;
+  if(rangeend > size)
+  {
+    rangeend = size;
+  }
+  size_t count = 0;
+  // Appends an extent clamped to range, coalescing it with the previous extent if contiguous.
+  // Returns false if there is no more room in out.
+  auto append = [&](extent_type start, extent_type end) -> bool {
+    start = (std::max)(start, range.offset);
+    end = (std::min)(end, rangeend);
+    if(end <= start)
+    {
+      return true;
+    }
+    if(count > 0 && out[count - 1].offset + out[count - 1].length == start)
+    {
+      out[count - 1].length += end - start;
+      return true;
+    }
+    if(count == out.size())
+    {
+      return false;
+    }
+    out[count++] = extent_pair(start, end - start);
+    return true;
+  };
+  if(out.empty() || rangeend <= range.offset)
+  {
+    return out.subspan(0, 0);
+  }
+#ifdef __linux__
+  {
+    // FIEMAP returns many extents per syscall, and doesn't need to walk the page cache like SEEK_DATA
+    alignas(struct fiemap) char buffer[sizeof(struct fiemap) + 64 * sizeof(struct fiemap_extent)];
+    auto *fm = reinterpret_cast<struct fiemap *>(buffer);
+    extent_type pos = range.offset;
+    bool first = true;
+    for(;;)
+    {
+      memset(fm, 0, sizeof(struct fiemap));
+      fm->fm_start = pos;
+      fm->fm_length = rangeend - pos;
+      fm->fm_extent_count = 64;
+      if(-1 == ::ioctl(_v.fd, FS_IOC_FIEMAP, fm))
+      {
+        if(first && (EOPNOTSUPP == errno || ENOTTY == errno || EINVAL == errno))
+        {
+          break;  // this filing system doesn't support FIEMAP
+        }
+        return posix_error();
+      }
+      first = false;
+      if(fm->fm_mapped_extents == 0)
+      {
+        return out.subspan(0, count);
+      }
+      for(uint32_t n = 0; n < fm->fm_mapped_extents; n++)
+      {
+        const auto &fe = fm->fm_extents[n];
+        if(!append(fe.fe_logical, fe.fe_logical + fe.fe_length))
+        {
+          return out.subspan(0, count);
+        }
+        pos = fe.fe_logical + fe.fe_length;
+        if((fe.fe_flags & FIEMAP_EXTENT_LAST) != 0 || pos >= rangeend)
+        {
+          return out.subspan(0, count);
+        }
+      }
+    }
+  }
+#endif
+  extent_type start = 0, end = range.offset;
+  for(;;)
+  {
+#ifdef __linux__
+#ifndef SEEK_DATA
+    errno = EINVAL;
+    break;
+#else
+    start = lseek64(_v.fd, end, SEEK_DATA);
+    if(static_cast<extent_type>(-1) == start)
+    {
+      break;
+    }
+    end = lseek64(_v.fd, start, SEEK_HOLE);
+    if(static_cast<extent_type>(-1) == end)
+    {
+      break;
+    }
+#endif
+#elif defined(__APPLE__)
+    // Can't find any support for extent enumeration in OS X
+    errno = EINVAL;
+    break;
+#elif defined(__FreeBSD__)
+    start = lseek(_v.fd, end, SEEK_DATA);
+    if((extent_type) -1 == start)
+      break;
+    end = lseek(_v.fd, start, SEEK_HOLE);
+    if((extent_type) -1 == end)
+      break;
+#else
+#error Unknown system
+#endif
+    if(start >= rangeend || !append(start, end) || end >= rangeend)
+    {
+      return out.subspan(0, count);
+    }
+  }
+  if(ENXIO == errno)
+  {
+    return out.subspan(0, count);
+  }
+  if(EINVAL == errno && count == 0)
+  {
+    // If it failed with no output, probably this filing system doesn't support extents
+    append(range.offset, rangeend);
+    return out.subspan(0, count);
+  }
+  return posix_error();
+}
+
+result<file_handle::extent_pair> file_handle::advise(file_handle::extent_pair extent, file_handle::access_pattern pattern) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#ifdef POSIX_FADV_SEQUENTIAL
+  int advice = POSIX_FADV_NORMAL;
+  switch(pattern)
+  {
+  case access_pattern::normal:
+    break;
+  case access_pattern::sequential:
+    advice = POSIX_FADV_SEQUENTIAL;
+    break;
+  case access_pattern::random:
+    advice = POSIX_FADV_RANDOM;
+    break;
+  case access_pattern::will_need:
+    advice = POSIX_FADV_WILLNEED;
+    break;
+  case access_pattern::dont_need:
+    advice = POSIX_FADV_DONTNEED;
+    break;
+  }
+  // A length of zero means to the end of the file
+  const off_t length = (extent.length == (extent_type) -1) ? 0 : (off_t) extent.length;
+  // posix_fadvise() returns the error rather than setting errno
+  int errcode = ::posix_fadvise(_v.fd, (off_t) extent.offset, length, advice);
+  if(errcode != 0)
+  {
+    return posix_error(errcode);
+  }
+#elif __APPLE__
+  switch(pattern)
+  {
+  case access_pattern::normal:
+  case access_pattern::sequential:
+  case access_pattern::random:
+    if(-1 == ::fcntl(_v.fd, F_RDAHEAD, (pattern == access_pattern::random) ? 0 : 1))
+    {
+      return posix_error();
+    }
+    break;
+  case access_pattern::will_need:
+  {
+    OUTCOME_TRY(auto &&size, file_handle::maximum_extent());
+    if(extent.offset < size)
+    {
+      struct radvisory ra;
+      ra.ra_offset = (off_t) extent.offset;
+      ra.ra_count = (int) (std::min)((extent_type) INT_MAX, (std::min)(extent.length, size - extent.offset));
+      if(-1 == ::fcntl(_v.fd, F_RDADVISE, &ra))
+      {
+        return posix_error();
+      }
+    }
+    break;
+  }
+  case access_pattern::dont_need:
+    // No means of evicting a region of the unified buffer cache
+    break;
+  }
+#else
+  (void) pattern;
+#endif
+  return extent;
+}
+
+result<file_handle::extent_pair> file_handle::evict_cache(file_handle::extent_pair extent) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#if defined(__APPLE__) || !defined(POSIX_FADV_DONTNEED)
+  (void) extent;
+  return errc::operation_not_supported;
+#else
+  // A length of zero means to the end of the file
+  const off_t length = (extent.length == (extent_type) -1) ? 0 : (off_t) extent.length;
+  // Dirty pages are not evicted, so write them back and wait for them first
+  bool synced = false;
+#ifdef __linux__
+  LLFIO_TRACE_SYSCALL(this, "sync_file_range");
+  synced = (-1 != ::sync_file_range(_v.fd, (off_t) extent.offset, length, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER));
+#endif
+  if(!synced && is_writable() && -1 == ::fsync(_v.fd))
+  {
+    return posix_error();
+  }
+  int errcode = ::posix_fadvise(_v.fd, (off_t) extent.offset, length, POSIX_FADV_DONTNEED);
+  if(errcode != 0)
+  {
+    return posix_error(errcode);
+  }
+  return extent;
+#endif
+}
+
+result<file_handle::atomic_write_limits_type> file_handle::atomic_write_limits() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  atomic_write_limits_type ret;
+#if defined(__linux__) && defined(SYS_statx)
+  // From Linux 6.11 onwards
+  struct
+  {
+    uint32_t stx_mask;
+    uint32_t stx_blksize;
+    uint64_t stx_attributes;
+    uint32_t stx_nlink, stx_uid, stx_gid;
+    uint16_t stx_mode, __spare0;
+    uint64_t stx_ino, stx_size, stx_blocks;
+    uint64_t stx_attributes_mask;
+    uint64_t stx_timestamps[8];
+    uint32_t stx_rdev_major, stx_rdev_minor, stx_dev_major, stx_dev_minor;
+    uint64_t stx_mnt_id;
+    uint32_t stx_dio_mem_align, stx_dio_offset_align;
+    uint64_t stx_subvol;
+    uint32_t stx_atomic_write_unit_min, stx_atomic_write_unit_max, stx_atomic_write_segments_max;
+    uint32_t __spare1[3];
+    uint64_t __spare3[8];
+  } s;
+  static_assert(sizeof(s) == 256, "");
+  memset(&s, 0, sizeof(s));
+  static constexpr unsigned _STATX_WRITE_ATOMIC = 0x00010000U;
+  static constexpr uint64_t _STATX_ATTR_WRITE_ATOMIC = 0x00400000;
+  LLFIO_TRACE_SYSCALL(this, "statx");
+  if(-1 == ::syscall(SYS_statx, _v.fd, "", 0x1000 /*AT_EMPTY_PATH*/, _STATX_WRITE_ATOMIC, &s))
+  {
+    return posix_error();
+  }
+  // Kernels before 6.11 do not fill the mask bit
+  if((s.stx_mask & _STATX_WRITE_ATOMIC) != 0 && (s.stx_attributes & _STATX_ATTR_WRITE_ATOMIC) != 0)
+  {
+    ret.unit_min = s.stx_atomic_write_unit_min;
+    ret.unit_max = s.stx_atomic_write_unit_max;
+    ret.segments_max = s.stx_atomic_write_segments_max;
+  }
+#endif
+  return ret;
+}
+
 result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::extent_pair extent, io_handle &dest_, io_handle::extent_type destoffset, deadline d,
                                                                bool force_copy_now, bool emulate_if_unsupported) noexcept
 {
@@ -683,6 +955,9 @@ result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::exte
       }
     }
     bool duplicate_extents = !force_copy_now, zero_extents = true, buffer_dirty = true;
+    // Copying within the same file in parallel could overwrite source not yet copied
+    const bool parallel_copy = !(flags() & flag::disable_parallelism) && dest.unique_id() != unique_id();
+    extent_type thisblock = 0;
     bool truncate_back_on_failure = false;
     if(dest_length < destoffset + extent.length)
     {
@@ -751,10 +1026,10 @@ result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::exte
     };
     for(const workitem &item : todo)
     {
-      for(extent_type thisoffset = 0; thisoffset < item.src.length; thisoffset += blocksize)
+      for(extent_type thisoffset = 0; thisoffset < item.src.length; thisoffset += thisblock)
       {
         bool done = false;
-        const auto thisblock = std::min(blocksize, item.src.length - thisoffset);
+        thisblock = std::min(blocksize, item.src.length - thisoffset);
         if(duplicate_extents && item.op == workitem::clone_extents)
         {
           off_t off_in = item.src.offset + thisoffset, off_out = item.src.offset + thisoffset + destoffsetdiff;
@@ -773,66 +1048,11 @@ result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::exte
         }
         if(!done && (item.op == workitem::copy_bytes || (!duplicate_extents && item.op == workitem::clone_extents)))
         {
-          if(buffer == nullptr)
-          {
-            buffer = utils::page_allocator<byte>().allocate(blocksize);
-          }
-          deadline nd;
-          buffer_type b(buffer, thisblock);
-          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
-          OUTCOME_TRY(auto readed, read({{&b, 1}, item.src.offset + thisoffset}, nd));
+          // Copy the remainder of this item in one go, so it can be parallelised
+          thisblock = item.src.length - thisoffset;
+          OUTCOME_TRY(detail::file_handle_copy_bytes(*this, dest, item.src.offset + thisoffset, thisblock, destoffsetdiff, item.destination_extents_are_new,
+                                                      parallel_copy, d));
           buffer_dirty = true;
-          if(readed.front().size() != thisblock)
-          {
-            return errc::resource_unavailable_try_again;  // something is wrong
-          }
-          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
-          const_buffer_type cb(readed.front());
-          if(item.destination_extents_are_new)
-          {
-            // If we don't need to reset the bytes in the destination, try to elide
-            // regions of zero bytes before writing to save on extents newly allocated
-            const char *ds = (const char *) readed.front().data(), *e = (const char *) readed.front().data() + readed.front().size(), *zs, *ze;
-            while(ds < e)
-            {
-              // Take zs to end of non-zero data
-              for(zs = ds; zs < e && *zs != 0; ++zs)
-              {
-              }
-            zero_block_too_small:
-              // Take ze to end of zero data
-              for(ze = zs; ze < e && *ze == 0; ++ze)
-              {
-              }
-              if(ze - zs < 1024 && ze < e)
-              {
-                zs = ze + 1;
-                goto zero_block_too_small;
-              }
-              if(zs != ds)
-              {
-                // Write portion from ds to zs
-                cb = {(const byte *) ds, (size_t)(zs - ds)};
-                auto localoffset = cb.data() - readed.front().data();
-                // std::cout << "*** " << (item.src.offset + thisoffset + localoffset) << " - " << cb.size() << std::endl;
-                OUTCOME_TRY(auto written, dest.write({{&cb, 1}, item.src.offset + thisoffset + localoffset + destoffsetdiff}, nd));
-                if(written.front().size() != (size_t)(zs - ds))
-                {
-                  return errc::resource_unavailable_try_again;  // something is wrong
-                }
-              }
-              ds = ze;
-            }
-          }
-          else
-          {
-            // Straight write
-            OUTCOME_TRY(auto written, dest.write({{&cb, 1}, item.src.offset + thisoffset + destoffsetdiff}, nd));
-            if(written.front().size() != thisblock)
-            {
-              return errc::resource_unavailable_try_again;  // something is wrong
-            }
-          }
           done = true;
         }
         if(!done && !item.destination_extents_are_new && (zero_extents && item.op == workitem::delete_extents))
@@ -886,6 +1106,113 @@ result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::exte
   }
 }
 
+result<file_handle::extent_pair> file_handle::allocate(file_handle::extent_pair extent, bool keep_size) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(extent.offset + extent.length < extent.offset)
+  {
+    return errc::value_too_large;
+  }
+  if(extent.length == 0)
+  {
+    return extent;
+  }
+#if defined(__linux__)
+  if(-1 == fallocate(_v.fd, keep_size ? 0x01 /*FALLOC_FL_KEEP_SIZE*/ : 0, extent.offset, extent.length))
+  {
+    if(EOPNOTSUPP == errno)
+    {
+      return errc::operation_not_supported;
+    }
+    return posix_error();
+  }
+#elif defined(__APPLE__)
+  {
+    // F_PREALLOCATE allocates from the physical end of the file, so work out how much is missing
+    struct stat s;
+    memset(&s, 0, sizeof(s));
+    if(-1 == ::fstat(_v.fd, &s))
+    {
+      return posix_error();
+    }
+    const extent_type end = extent.offset + extent.length, allocated = (extent_type) s.st_blocks * 512;
+    if(end > allocated)
+    {
+      fstore_t fst;
+      memset(&fst, 0, sizeof(fst));
+      fst.fst_flags = F_ALLOCATECONTIG | F_ALLOCATEALL;
+      fst.fst_posmode = F_PEOFPOSMODE;
+      fst.fst_offset = 0;
+      fst.fst_length = (off_t) (end - allocated);
+      if(-1 == ::fcntl(_v.fd, F_PREALLOCATE, &fst))
+      {
+        // Try again without insisting on contiguity
+        fst.fst_flags = F_ALLOCATEALL;
+        if(-1 == ::fcntl(_v.fd, F_PREALLOCATE, &fst))
+        {
+          if(ENOTSUP == errno)
+          {
+            return errc::operation_not_supported;
+          }
+          return posix_error();
+        }
+      }
+    }
+    if(!keep_size && end > (extent_type) s.st_size)
+    {
+      if(-1 == ::ftruncate(_v.fd, (off_t) end))
+      {
+        return posix_error();
+      }
+    }
+  }
+#elif defined(__FreeBSD__)
+  if(keep_size)
+  {
+    return errc::operation_not_supported;
+  }
+  // posix_fallocate() returns the error rather than setting errno
+  int errcode = ::posix_fallocate(_v.fd, (off_t) extent.offset, (off_t) extent.length);
+  if(errcode != 0)
+  {
+    if(EINVAL == errcode || EOPNOTSUPP == errcode)
+    {
+      return errc::operation_not_supported;
+    }
+    return posix_error(errcode);
+  }
+#else
+  (void) keep_size;
+  return errc::operation_not_supported;
+#endif
+  if(are_safety_barriers_issued() && !keep_size)
+  {
+    fsync(_v.fd);
+  }
+  return extent;
+}
+
+result<file_handle::extent_type> file_handle::extend_valid_data(file_handle::extent_type newsize) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(auto &&length, file_handle::maximum_extent());
+  if(newsize <= length)
+  {
+    return file_handle::truncate(newsize);
+  }
+  // Extents based filing systems allocate unwritten extents, which are never zero filled upon write
+  auto r = file_handle::allocate({length, newsize - length}, false);
+  if(!r)
+  {
+    if(r.error() == errc::operation_not_supported)
+    {
+      return file_handle::truncate(newsize);
+    }
+    return std::move(r).error();
+  }
+  return newsize;
+}
+
 result<file_handle::extent_type> file_handle::zero(file_handle::extent_pair extent, deadline d) noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
@@ -894,6 +1221,43 @@ result<file_handle::extent_type> file_handle::zero(file_handle::extent_pair exte
     return errc::value_too_large;
   }
 #if defined(__linux__)
+  {
+    // Zoned storage cannot be overwritten, but whole zones can be reset
+    struct statfs s;
+    if(-1 != ::fstatfs(_v.fd, &s))
+    {
+      if(0x5a4f4653 /*ZONEFS_MAGIC*/ == (unsigned) s.f_type && extent.offset == 0)
+      {
+        OUTCOME_TRY(auto &&length, maximum_extent());
+        // Truncating a conventional zone's file fails, and it can be zeroed as usual
+        if(extent.length >= length && -1 != ::ftruncate(_v.fd, 0))
+        {
+          return extent.length;
+        }
+      }
+#ifdef BLKRESETZONE
+      else if(0x62646576 /*BDEVFS_MAGIC*/ == (unsigned) s.f_type)
+      {
+        unsigned zonesectors = 0;
+        if(-1 != ::ioctl(_v.fd, BLKGETZONESZ, &zonesectors) && zonesectors != 0)
+        {
+          const extent_type zonebytes = (extent_type) zonesectors << 9U;
+          if((extent.offset % zonebytes) == 0 && (extent.length % zonebytes) == 0)
+          {
+            struct blk_zone_range range;
+            range.sector = extent.offset >> 9U;
+            range.nr_sectors = extent.length >> 9U;
+            if(-1 == ::ioctl(_v.fd, BLKRESETZONE, &range))
+            {
+              return posix_error();
+            }
+            return extent.length;
+          }
+        }
+      }
+#endif
+    }
+  }
   if(-1 == fallocate(_v.fd, 0x02 /*FALLOC_FL_PUNCH_HOLE*/ | 0x01 /*FALLOC_FL_KEEP_SIZE*/, extent.offset, extent.length))
   {
     // The filing system may not support trim
@@ -934,4 +1298,67 @@ result<file_handle::extent_type> file_handle::zero(file_handle::extent_pair exte
   }
 }
 
+namespace detail
+{
+  // Serialises zone appends through the same file descriptor, as each reads the file position its write left
+  inline std::mutex &zone_append_lock(int fd) noexcept
+  {
+    static std::mutex locks[64];
+    return locks[(unsigned) fd % 64];
+  }
+}  // namespace detail
+
+result<file_handle::extent_type> file_handle::zone_append(const_buffers_type buffers, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(d)
+  {
+    return errc::not_supported;
+  }
+  if(buffers.size() > IOV_MAX)
+  {
+    return errc::argument_list_too_long;
+  }
+  auto *iov = reinterpret_cast<struct iovec *>(const_cast<const_buffer_type *>(buffers.data()));
+  size_type total = 0;
+  for(auto &b : buffers)
+  {
+    total += b.size();
+  }
+  std::lock_guard<std::mutex> g(detail::zone_append_lock(_v.fd));
+  ssize_t written = -1;
+#if defined(__linux__) && defined(__NR_pwritev2)
+  // An offset of -1 writes at, and advances, the file position, which RWF_APPEND sets to the end
+  LLFIO_TRACE_SYSCALL(this, "pwritev2");
+  written = (ssize_t) syscall(__NR_pwritev2, _v.fd, iov, (int) buffers.size(), (unsigned long) -1, (unsigned long) -1, 0x00000010 /*RWF_APPEND*/);
+  if(written < 0 && ENOSYS != errno && EOPNOTSUPP != errno)  // kernels before 4.16 don't have RWF_APPEND
+  {
+    return posix_error();
+  }
+#endif
+  if(written < 0)
+  {
+    if(!is_append_only())
+    {
+      return errc::operation_not_supported;
+    }
+    LLFIO_TRACE_SYSCALL(this, "writev");
+    written = ::writev(_v.fd, iov, (int) buffers.size());
+    if(written < 0)
+    {
+      return posix_error();
+    }
+  }
+  const off_t end = ::lseek(_v.fd, 0, SEEK_CUR);
+  if(end < 0)
+  {
+    return posix_error();
+  }
+  if((size_type) written < total)
+  {
+    return errc::no_space_on_device;
+  }
+  return (extent_type) end - (extent_type) written;
+}
+
 LLFIO_V2_NAMESPACE_END
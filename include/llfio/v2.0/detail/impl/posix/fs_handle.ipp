@@ -29,6 +29,11 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include <climits>  // for PATH_MAX
 
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/xattr.h>
+#endif
+
 LLFIO_V2_NAMESPACE_BEGIN
 
 result<void> fs_handle::_fetch_inode() const noexcept
@@ -90,7 +95,7 @@ namespace detail
           return success(std::move(currentdirh));
         }
         // stat the same file name, and compare dev and inode
-        path_view::c_str<> zpath(filename);
+        path_view::recycling_c_str<> zpath(filename);
         struct stat s
         {
         };
@@ -150,7 +155,7 @@ result<void> fs_handle::relink(const path_handle &base, path_view_type path, boo
 {
   LLFIO_LOG_FUNCTION_CALL(this);
   auto &h = const_cast<handle &>(_get_handle());
-  path_view::c_str<> zpath(path);
+  path_view::recycling_c_str<> zpath(path);
 #ifdef O_TMPFILE
   // If the handle was created with O_TMPFILE, we need a different approach
   if(h.flags() & handle::flag::anonymous_inode)
@@ -202,7 +207,7 @@ result<void> fs_handle::link(const path_handle &base, path_view_type path, deadl
 {
   LLFIO_LOG_FUNCTION_CALL(this);
   auto &h = const_cast<handle &>(_get_handle());
-  path_view::c_str<> zpath(path);
+  path_view::recycling_c_str<> zpath(path);
 #ifdef AT_EMPTY_PATH
   // Try to use the fd linking syscall
   if(-1 != ::linkat(h.native_handle().fd, "", base.is_valid() ? base.native_handle().fd : AT_FDCWD, zpath.buffer, AT_EMPTY_PATH))
@@ -242,4 +247,237 @@ result<void> fs_handle::unlink(deadline d) noexcept
   return success();
 }
 
+#if defined(__linux__) || defined(__APPLE__)
+namespace detail
+{
+#ifdef ENOATTR
+  static constexpr int xattr_not_present = ENOATTR;
+#else
+  static constexpr int xattr_not_present = ENODATA;
+#endif
+  // Copies an extended attribute name into a zero terminated buffer
+  inline result<void> xattr_zname(char (&zname)[256], string_view name) noexcept
+  {
+    if(name.size() >= sizeof(zname))
+    {
+      return errc::invalid_argument;
+    }
+    memcpy(zname, name.data(), name.size());
+    zname[name.size()] = 0;
+    return success();
+  }
+  /* Fills `out` with the extended attributes given by `list(char *, size_t)` and
+  `get(const char *, void *, size_t)`, which are the listxattr() and getxattr() family.
+  */
+  template <class List, class Get> inline result<void> read_extended_attributes(fs_handle::extended_attributes &out, span<const string_view> names, List &&list, Get &&get) noexcept
+  {
+    try
+    {
+      out.clear();
+      auto get_one = [&](string_view name, const char *zname) -> result<void> {
+        // Read the value into whatever storage remains allocated, if enough
+        const size_t spare = out._spare();
+        size_t capacity = (std::max)((size_t) 256, (spare > name.size() + 1) ? (spare - name.size() - 1) : (size_t) 0);
+        byte *dest = out._append(name, capacity);
+        for(;;)
+        {
+          ssize_t len = get(zname, dest, capacity);
+          if(len < 0 && ERANGE == errno)
+          {
+            // Value is bigger than the storage, so ask for its size
+            len = get(zname, nullptr, 0);
+            if(len >= 0)
+            {
+              capacity = (size_t) len + 64;
+              dest = out._resize_last(capacity);
+              continue;
+            }
+          }
+          if(len < 0)
+          {
+            const int code = errno;
+            out._remove_last();
+            if(xattr_not_present == code)
+            {
+              // Removed since listed, or not present if named
+              return success();
+            }
+            return posix_error(code);
+          }
+          out._resize_last((size_t) len);
+          return success();
+        }
+      };
+      if(!names.empty())
+      {
+        for(const auto &name : names)
+        {
+          char zname[256];
+          OUTCOME_TRYV(xattr_zname(zname, name));
+          OUTCOME_TRYV(get_one(name, zname));
+        }
+        out._publish();
+        return success();
+      }
+      static thread_local std::vector<char> listed(4096);
+      ssize_t len;
+      for(;;)
+      {
+        len = list(listed.data(), listed.size());
+        if(len >= 0)
+        {
+          break;
+        }
+        if(ERANGE != errno)
+        {
+          return posix_error();
+        }
+        len = list(nullptr, 0);
+        if(len < 0)
+        {
+          return posix_error();
+        }
+        listed.resize((size_t) len + 256);
+      }
+      for(const char *zname = listed.data(), *end = listed.data() + len; zname < end;)
+      {
+        const size_t length = strlen(zname);
+        if(length > 0)
+        {
+          OUTCOME_TRYV(get_one(string_view(zname, length), zname));
+        }
+        zname += length + 1;
+      }
+      out._publish();
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+}  // namespace detail
+#endif
+
+result<void> fs_handle::read_extended_attributes(extended_attributes &out, span<const string_view> names) const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#if defined(__linux__) || defined(__APPLE__)
+  const int fd = _get_handle().native_handle().fd;
+  return detail::read_extended_attributes(
+  out, names,
+#ifdef __APPLE__
+  [fd](char *buffer, size_t bytes) { return ::flistxattr(fd, buffer, bytes, 0); },
+  [fd](const char *name, void *buffer, size_t bytes) { return ::fgetxattr(fd, name, buffer, bytes, 0, 0); }
+#else
+  [fd](char *buffer, size_t bytes) { return ::flistxattr(fd, buffer, bytes); },
+  [fd](const char *name, void *buffer, size_t bytes) { return ::fgetxattr(fd, name, buffer, bytes); }
+#endif
+  );
+#else
+  (void) out;
+  (void) names;
+  return errc::operation_not_supported;
+#endif
+}
+
+result<void> fs_handle::read_extended_attributes(const path_handle &base, path_view_type leafname, extended_attributes &out, span<const string_view> names) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+#if defined(__linux__) || defined(__APPLE__)
+  path_view::recycling_c_str<> zleaf(leafname);
+  char path[PATH_MAX];
+  if(!base.is_valid())
+  {
+    if(zleaf.length >= PATH_MAX)
+    {
+      return errc::filename_too_long;
+    }
+    memcpy(path, zleaf.buffer, zleaf.length + 1);
+  }
+  else
+  {
+#ifdef __APPLE__
+    if(-1 == ::fcntl(base.native_handle().fd, F_GETPATH, path))
+    {
+      return posix_error();
+    }
+    const size_t baselength = strlen(path);
+    if(baselength + 1 + zleaf.length >= PATH_MAX)
+    {
+      return errc::filename_too_long;
+    }
+    path[baselength] = '/';
+    memcpy(path + baselength + 1, zleaf.buffer, zleaf.length + 1);
+#else
+    // Linux can traverse from the magic symlink of the base's fd without opening anything
+    const int written = snprintf(path, PATH_MAX, "/proc/self/fd/%d/%s", base.native_handle().fd, zleaf.buffer);
+    if(written < 0 || written >= PATH_MAX)
+    {
+      return errc::filename_too_long;
+    }
+#endif
+  }
+  return detail::read_extended_attributes(
+  out, names,
+#ifdef __APPLE__
+  [&path](char *buffer, size_t bytes) { return ::listxattr(path, buffer, bytes, XATTR_NOFOLLOW); },
+  [&path](const char *name, void *buffer, size_t bytes) { return ::getxattr(path, name, buffer, bytes, 0, XATTR_NOFOLLOW); }
+#else
+  [&path](char *buffer, size_t bytes) { return ::llistxattr(path, buffer, bytes); },
+  [&path](const char *name, void *buffer, size_t bytes) { return ::lgetxattr(path, name, buffer, bytes); }
+#endif
+  );
+#else
+  (void) base;
+  (void) leafname;
+  (void) out;
+  (void) names;
+  return errc::operation_not_supported;
+#endif
+}
+
+result<void> fs_handle::write_extended_attribute(string_view name, span<const byte> value) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#if defined(__linux__) || defined(__APPLE__)
+  char zname[256];
+  OUTCOME_TRYV(detail::xattr_zname(zname, name));
+#ifdef __APPLE__
+  if(-1 == ::fsetxattr(_get_handle().native_handle().fd, zname, value.data(), value.size(), 0, 0))
+#else
+  if(-1 == ::fsetxattr(_get_handle().native_handle().fd, zname, value.data(), value.size(), 0))
+#endif
+  {
+    return posix_error();
+  }
+  return success();
+#else
+  (void) name;
+  (void) value;
+  return errc::operation_not_supported;
+#endif
+}
+
+result<void> fs_handle::remove_extended_attribute(string_view name) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#if defined(__linux__) || defined(__APPLE__)
+  char zname[256];
+  OUTCOME_TRYV(detail::xattr_zname(zname, name));
+#ifdef __APPLE__
+  if(-1 == ::fremovexattr(_get_handle().native_handle().fd, zname, 0))
+#else
+  if(-1 == ::fremovexattr(_get_handle().native_handle().fd, zname))
+#endif
+  {
+    return posix_error();
+  }
+  return success();
+#else
+  (void) name;
+  return errc::operation_not_supported;
+#endif
+}
+
 LLFIO_V2_NAMESPACE_END
@@ -223,4 +223,21 @@ result<void> handle::set_append_only(bool enable) noexcept
   return success();
 }
 
+namespace utils
+{
+  result<void> flush_modified_data(const handle &h) noexcept
+  {
+#ifdef __linux__
+    if(-1 == ::syncfs(h.native_handle().fd))
+    {
+      return posix_error();
+    }
+    return success();
+#else
+    (void) h;
+    return flush_modified_data();
+#endif
+  }
+}  // namespace utils
+
 LLFIO_V2_NAMESPACE_END
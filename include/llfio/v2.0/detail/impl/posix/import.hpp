@@ -34,6 +34,12 @@ Distributed under the Boost Software License, Version 1.0.
 #include <fcntl.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <atomic>
+
+#include <sys/syscall.h>
+#endif
+
 LLFIO_V2_NAMESPACE_BEGIN
 
 inline result<int> attribs_from_handle_mode_caching_and_flags(native_handle_type &nativeh, handle::mode _mode, handle::creation _creation, handle::caching _caching, handle::flag flags) noexcept
@@ -119,6 +125,100 @@ inline result<int> attribs_from_handle_mode_caching_and_flags(native_handle_type
   return attribs;
 }
 
+/* Opens path relative to dirfd (which may be AT_FDCWD) as openat() does, honouring the
+resolve_* flags using openat2() where the kernel has it. Returns -1 and sets errno on failure.
+*/
+inline int openat_with_resolve_flags(int dirfd, const char *path, int attribs, mode_t mode, handle::flag flags) noexcept
+{
+  if(!(flags & (handle::flag::resolve_beneath | handle::flag::resolve_no_symlinks | handle::flag::resolve_cached_only)))
+  {
+    return ::openat(dirfd, path, attribs, mode);
+  }
+#ifdef __linux__
+  // -1 = unknown, 0 = no openat2(), 1 = openat2() without RESOLVE_CACHED, 2 = everything
+  static std::atomic<int> openat2_support(-1);
+  struct open_how_t
+  {
+    uint64_t flags, mode, resolve;
+  };
+  auto openat2 = [](int _dirfd, const char *_path, const open_how_t &_how) -> int {
+#if defined(__NR_openat2)
+    return (int) syscall(__NR_openat2, _dirfd, _path, &_how, sizeof(_how));
+#elif defined(__alpha__)
+    return (int) syscall(547 /*__NR_openat2*/, _dirfd, _path, &_how, sizeof(_how));
+#else
+    return (int) syscall(437 /*__NR_openat2*/, _dirfd, _path, &_how, sizeof(_how));
+#endif
+  };
+  const bool want_cached = !!(flags & handle::flag::resolve_cached_only);
+  int support = openat2_support.load(std::memory_order_relaxed);
+  if(support == 0 || (support == 1 && want_cached))
+  {
+    errno = want_cached ? EAGAIN : EOPNOTSUPP;
+    return -1;
+  }
+  // openat2() refuses a mode if it would not be used
+  bool takes_mode = !!(attribs & O_CREAT);
+#ifdef O_TMPFILE
+  takes_mode |= ((attribs & O_TMPFILE) == O_TMPFILE);  // O_TMPFILE includes O_DIRECTORY
+#endif
+  open_how_t how{(uint64_t)(unsigned) attribs, takes_mode ? (uint64_t) mode : 0, 0};
+  if(flags & handle::flag::resolve_beneath)
+  {
+    how.resolve |= 0x08 /*RESOLVE_BENEATH*/;
+  }
+  if(flags & handle::flag::resolve_no_symlinks)
+  {
+    how.resolve |= 0x04 /*RESOLVE_NO_SYMLINKS*/;
+  }
+  if(want_cached)
+  {
+    how.resolve |= 0x20 /*RESOLVE_CACHED*/;
+  }
+  int fd = openat2(dirfd, path, how);
+  if(fd == -1 && support == -1)
+  {
+    if(ENOSYS == errno)
+    {
+      openat2_support.store(0, std::memory_order_relaxed);
+      errno = want_cached ? EAGAIN : EOPNOTSUPP;
+      return -1;
+    }
+    if(EINVAL == errno && want_cached)
+    {
+      // Linux 5.6 to 5.11 have openat2(), but not RESOLVE_CACHED
+      const open_how_t probe{O_RDONLY | O_CLOEXEC, 0, 0x20 /*RESOLVE_CACHED*/};
+      int testfd = openat2(AT_FDCWD, ".", probe);
+      if(testfd != -1)
+      {
+        ::close(testfd);
+      }
+      if(testfd != -1 || EAGAIN == errno)
+      {
+        openat2_support.store(2, std::memory_order_relaxed);
+        errno = EINVAL;
+        return -1;
+      }
+      openat2_support.store(1, std::memory_order_relaxed);
+      errno = EAGAIN;
+      return -1;
+    }
+  }
+  else if(fd != -1 && want_cached)
+  {
+    openat2_support.store(2, std::memory_order_relaxed);
+  }
+  return fd;
+#else
+  (void) dirfd;
+  (void) path;
+  (void) attribs;
+  (void) mode;
+  errno = (flags & handle::flag::resolve_cached_only) ? EAGAIN : EOPNOTSUPP;
+  return -1;
+#endif
+}
+
 /*! Defines a number of variables into its scope:
 - began_steady: Set to the steady clock at the beginning of a sleep
 - end_utc: Set to the system clock when the sleep must end
@@ -75,7 +75,7 @@ io_handle::io_result<io_handle::buffers_type> io_handle::_do_read(io_handle::io_
   }
   if(reqs.buffers.size() > IOV_MAX)
   {
-    return errc::argument_list_too_long;
+    return _do_split_request(reqs, IOV_MAX, d, [this](io_request<buffers_type> thisreq, deadline nd) { return io_handle::_do_read(thisreq, nd); });
   }
   LLFIO_POSIX_DEADLINE_TO_SLEEP_INIT(d);
 #if 0
@@ -106,10 +106,12 @@ io_handle::io_result<io_handle::buffers_type> io_handle::_do_read(io_handle::io_
     off_t offset = reqs.offset;
     for(size_t n = 0; n < reqs.buffers.size(); n++)
     {
+      LLFIO_TRACE_SYSCALL(this, "pread");
       bytesread += ::pread(_v.fd, iov[n].iov_base, iov[n].iov_len, offset);
       offset += iov[n].iov_len;
     }
 #else
+    LLFIO_TRACE_SYSCALL(this, "preadv");
     bytesread = ::preadv(_v.fd, iov, reqs.buffers.size(), reqs.offset);
 #endif
     if(bytesread < 0)
@@ -121,7 +123,15 @@ io_handle::io_result<io_handle::buffers_type> io_handle::_do_read(io_handle::io_
   {
     do
     {
-      bytesread = ::readv(_v.fd, iov, reqs.buffers.size());
+      {
+        LLFIO_TRACE_SYSCALL(this, "readv");
+        bytesread = ::readv(_v.fd, iov, reqs.buffers.size());
+      }
+      if(bytesread == 0 && _v.is_socket())
+      {
+        // The peer has shut down its side of the connection
+        break;
+      }
       if(bytesread <= 0)
       {
         if(bytesread < 0 && EWOULDBLOCK != errno && EAGAIN != errno)
@@ -136,6 +146,7 @@ io_handle::io_result<io_handle::buffers_type> io_handle::_do_read(io_handle::io_
           memset(&p, 0, sizeof(p));
           p.fd = _v.fd;
           p.events = POLLIN | POLLERR;
+          LLFIO_TRACE_SYSCALL(this, "poll");
           if(-1 == ::poll(&p, 1, mstimeout))
           {
             return posix_error();
@@ -171,7 +182,7 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_write(io_hand
   }
   if(reqs.buffers.size() > IOV_MAX)
   {
-    return errc::argument_list_too_long;
+    return _do_split_request(reqs, IOV_MAX, d, [this](io_request<const_buffers_type> thisreq, deadline nd) { return io_handle::_do_write(thisreq, nd); });
   }
   LLFIO_POSIX_DEADLINE_TO_SLEEP_INIT(d);
 #if 0
@@ -198,19 +209,94 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_write(io_hand
   ssize_t byteswritten = 0;
   if(is_seekable())
   {
-#if LLFIO_MISSING_PIOV
-    off_t offset = reqs.offset;
-    for(size_t n = 0; n < reqs.buffers.size(); n++)
+    bool emulate_flags = !!reqs.flags, done = false;
+#if defined(__linux__) && defined(__NR_pwritev2)
+    if(emulate_flags)
     {
-      byteswritten += ::pwrite(_v.fd, iov[n].iov_base, iov[n].iov_len, offset);
-      offset += iov[n].iov_len;
+      int rwf = 0;
+      if(reqs.flags & write_flag::data_sync)
+      {
+        rwf |= 0x00000002 /*RWF_DSYNC*/;
+      }
+      if(reqs.flags & write_flag::sync)
+      {
+        rwf |= 0x00000004 /*RWF_SYNC*/;
+      }
+      if(reqs.flags & write_flag::append)
+      {
+        rwf |= 0x00000010 /*RWF_APPEND*/;
+      }
+      if(reqs.flags & write_flag::uncached)
+      {
+        rwf |= 0x00000080 /*RWF_DONTCACHE*/;
+      }
+      if(reqs.flags & write_flag::atomic)
+      {
+        rwf |= 0x00000040 /*RWF_ATOMIC*/;
+      }
+      // The kernel takes the offset as two longs, the high half of which is ignored on 64 bit
+      const auto offset = static_cast<uint64_t>(reqs.offset);
+      const auto lo = static_cast<unsigned long>(offset);
+      const auto hi = (sizeof(unsigned long) < sizeof(uint64_t)) ? static_cast<unsigned long>(offset >> 32U) : 0UL;
+      LLFIO_TRACE_SYSCALL(this, "pwritev2");
+      byteswritten = (ssize_t) syscall(__NR_pwritev2, _v.fd, iov, (int) reqs.buffers.size(), lo, hi, rwf);
+      bool advise_uncached = false;
+      if(byteswritten < 0 && (EOPNOTSUPP == errno || EINVAL == errno) && (rwf & 0x00000080) != 0)
+      {
+        // Kernels before 6.14, and many filing systems, refuse RWF_DONTCACHE, so advise afterwards instead
+        LLFIO_TRACE_SYSCALL(this, "pwritev2");
+        byteswritten = (ssize_t) syscall(__NR_pwritev2, _v.fd, iov, (int) reqs.buffers.size(), lo, hi, rwf & ~0x00000080);
+        advise_uncached = true;
+      }
+      if(byteswritten >= 0)
+      {
+        done = true;
+        if(advise_uncached)
+        {
+          ::posix_fadvise(_v.fd, (off_t) reqs.offset, (off_t) byteswritten, POSIX_FADV_DONTNEED);
+        }
+      }
+      else if(ENOSYS != errno)  // kernels before 4.7 don't have pwritev2()
+      {
+        return posix_error();
+      }
     }
-#else
-    byteswritten = ::pwritev(_v.fd, iov, reqs.buffers.size(), reqs.offset);
 #endif
-    if(byteswritten < 0)
+    if(!done)
     {
-      return posix_error();
+      if(emulate_flags && (reqs.flags & (write_flag::append | write_flag::atomic)))
+      {
+        return errc::not_supported;
+      }
+#if LLFIO_MISSING_PIOV
+      off_t offset = reqs.offset;
+      for(size_t n = 0; n < reqs.buffers.size(); n++)
+      {
+        LLFIO_TRACE_SYSCALL(this, "pwrite");
+        byteswritten += ::pwrite(_v.fd, iov[n].iov_base, iov[n].iov_len, offset);
+        offset += iov[n].iov_len;
+      }
+#else
+      LLFIO_TRACE_SYSCALL(this, "pwritev");
+      byteswritten = ::pwritev(_v.fd, iov, reqs.buffers.size(), reqs.offset);
+#endif
+      if(byteswritten < 0)
+      {
+        return posix_error();
+      }
+      if(emulate_flags)
+      {
+        if(reqs.flags & (write_flag::data_sync | write_flag::sync))
+        {
+          OUTCOME_TRYV(io_handle::_do_barrier({}, (reqs.flags & write_flag::sync) ? barrier_kind::wait_all : barrier_kind::wait_data_only, {}));
+        }
+#if defined(POSIX_FADV_DONTNEED)
+        if(reqs.flags & write_flag::uncached)
+        {
+          ::posix_fadvise(_v.fd, (off_t) reqs.offset, (off_t) byteswritten, POSIX_FADV_DONTNEED);
+        }
+#endif
+      }
     }
   }
   else
@@ -219,7 +305,11 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_write(io_hand
     {
       // Can't guarantee that user code hasn't enabled SIGPIPE
       byteswritten = QUICKCPPLIB_NAMESPACE::signal_guard::signal_guard(
-      QUICKCPPLIB_NAMESPACE::signal_guard::signalc_set::broken_pipe, [&] { return ::writev(_v.fd, iov, reqs.buffers.size()); },
+      QUICKCPPLIB_NAMESPACE::signal_guard::signalc_set::broken_pipe,
+      [&] {
+        LLFIO_TRACE_SYSCALL(this, "writev");
+        return ::writev(_v.fd, iov, reqs.buffers.size());
+      },
       [&](const QUICKCPPLIB_NAMESPACE::signal_guard::raised_signal_info * /*unused*/) {
         errno = EPIPE;
         return -1;
@@ -238,6 +328,7 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_write(io_hand
           memset(&p, 0, sizeof(p));
           p.fd = _v.fd;
           p.events = POLLOUT | POLLERR;
+          LLFIO_TRACE_SYSCALL(this, "poll");
           if(-1 == ::poll(&p, 1, mstimeout))
           {
             return posix_error();
@@ -291,6 +382,7 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_barrier(io_ha
     {
       flags |= SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WAIT_AFTER;  // block until they're on storage
     }
+    LLFIO_TRACE_SYSCALL(this, "sync_file_range");
     if(-1 != ::sync_file_range(_v.fd, offset, bytes, flags))
     {
       return {reqs.buffers};
@@ -300,6 +392,7 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_barrier(io_ha
 #if !defined(__FreeBSD__) && !defined(__APPLE__)  // neither of these have fdatasync()
   if(kind <= barrier_kind::wait_data_only)
   {
+    LLFIO_TRACE_SYSCALL(this, "fdatasync");
     if(-1 == ::fdatasync(_v.fd))
     {
       return posix_error();
@@ -311,14 +404,17 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_barrier(io_ha
   if(((uint8_t) kind & 1) == 0)
   {
     // OS X fsync doesn't wait for the device to flush its buffers
+    LLFIO_TRACE_SYSCALL(this, "fsync");
     if(-1 == ::fsync(_v.fd))
       return posix_error();
     return {std::move(reqs.buffers)};
   }
   // This is the fsync as on every other OS
+  LLFIO_TRACE_SYSCALL(this, "fcntl(F_FULLFSYNC)");
   if(-1 == ::fcntl(_v.fd, F_FULLFSYNC))
     return posix_error();
 #else
+  LLFIO_TRACE_SYSCALL(this, "fsync");
   if(-1 == ::fsync(_v.fd))
   {
     return posix_error();
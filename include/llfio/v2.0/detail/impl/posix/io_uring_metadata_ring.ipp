@@ -0,0 +1,327 @@
+/* A minimal io_uring for batching metadata syscalls
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_DETAIL_IMPL_POSIX_IO_URING_METADATA_RING_IPP
+#define LLFIO_DETAIL_IMPL_POSIX_IO_URING_METADATA_RING_IPP
+
+#include "../../../config.hpp"
+
+#ifndef __linux__
+#error This implementation file is for Linux only
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  /* A single threaded io_uring which does nothing but submit a batch of `openat()`,
+  `statx()`, `unlinkat()` and `symlinkat()` operations and wait for all of them to complete.
+  Unlike the io_uring multiplexer this knows nothing of handles or i/o states, which is all that
+  `traverse()` and `reduce()` need to keep many metadata operations in flight per kernel thread.
+
+  Kernels before 5.6 (5.11 for `unlinkat()`, 5.15 for `symlinkat()`) accept the ring but fail
+  these opcodes with `EINVAL`, so callers ought to retry any operation failing with `EINVAL`
+  synchronously.
+  */
+  class io_uring_metadata_ring
+  {
+    struct _sqe_t
+    {
+      uint8_t opcode;
+      uint8_t flags;
+      uint16_t ioprio;
+      int32_t fd;
+      uint64_t off;  // statx buffer or symlink path
+      uint64_t addr;  // path or symlink target
+      uint32_t len;  // open mode or statx mask
+      uint32_t op_flags;  // open, statx or unlink flags
+      uint64_t user_data;
+      uint64_t __pad2[3];
+    };
+    static_assert(sizeof(_sqe_t) == 64, "_sqe_t is not the size the kernel expects");
+    struct _cqe_t
+    {
+      uint64_t user_data;
+      int32_t res;
+      uint32_t flags;
+    };
+    struct _sqring_offsets_t
+    {
+      uint32_t head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+      uint64_t resv2;
+    };
+    struct _cqring_offsets_t
+    {
+      uint32_t head, tail, ring_mask, ring_entries, overflow, cqes;
+      uint64_t resv[2];
+    };
+    struct _params_t
+    {
+      uint32_t sq_entries, cq_entries, flags, sq_thread_cpu, sq_thread_idle, features, wq_fd, resv[3];
+      _sqring_offsets_t sq_off;
+      _cqring_offsets_t cq_off;
+    };
+    static constexpr uint8_t _IORING_OP_OPENAT = 18;
+    static constexpr uint8_t _IORING_OP_STATX = 21;
+    static constexpr uint8_t _IORING_OP_UNLINKAT = 36;
+    static constexpr uint8_t _IORING_OP_SYMLINKAT = 38;
+    static constexpr uint32_t _IORING_ENTER_GETEVENTS = (1U << 0);
+    static constexpr off_t _IORING_OFF_SQ_RING = (off_t) 0;
+    static constexpr off_t _IORING_OFF_CQ_RING = (off_t) 0x8000000;
+    static constexpr off_t _IORING_OFF_SQES = (off_t) 0x10000000;
+
+    int _fd{-1};
+    unsigned _entries{0}, _queued{0};
+    void *_sqring{nullptr}, *_cqring{nullptr};
+    size_t _sqring_bytes{0}, _cqring_bytes{0}, _sqes_bytes{0};
+    _sqe_t *_sqes{nullptr};
+    uint32_t *_sq_tail{nullptr}, *_sq_mask{nullptr}, *_sq_array{nullptr};
+    uint32_t *_cq_head{nullptr}, *_cq_tail{nullptr}, *_cq_mask{nullptr};
+    _cqe_t *_cqes{nullptr};
+
+    static int _io_uring_setup(unsigned entries, _params_t *p) noexcept
+    {
+#if defined(__NR_io_uring_setup)
+      return (int) syscall(__NR_io_uring_setup, entries, p);
+#elif defined(__alpha__)
+      return (int) syscall(535 /*__NR_io_uring_setup*/, entries, p);
+#else
+      return (int) syscall(425 /*__NR_io_uring_setup*/, entries, p);
+#endif
+    }
+    static int _io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept
+    {
+#if defined(__NR_io_uring_enter)
+      return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+#elif defined(__alpha__)
+      return (int) syscall(536 /*__NR_io_uring_enter*/, fd, to_submit, min_complete, flags, nullptr, 0);
+#else
+      return (int) syscall(426 /*__NR_io_uring_enter*/, fd, to_submit, min_complete, flags, nullptr, 0);
+#endif
+    }
+    _sqe_t *_next_sqe(uint64_t user_data) noexcept
+    {
+      assert(_queued < _entries);
+      const uint32_t tail = *_sq_tail + _queued++;
+      const uint32_t idx = tail & *_sq_mask;
+      _sqe_t *sqe = _sqes + idx;
+      memset(sqe, 0, sizeof(_sqe_t));
+      sqe->user_data = user_data;
+      _sq_array[idx] = idx;
+      return sqe;
+    }
+
+  public:
+    //! The layout of `struct statx` as far as `stx_mode`
+    struct statx_t
+    {
+      uint32_t stx_mask;
+      uint32_t stx_blksize;
+      uint64_t stx_attributes;
+      uint32_t stx_nlink;
+      uint32_t stx_uid;
+      uint32_t stx_gid;
+      uint16_t stx_mode;
+      uint16_t __spare0;
+      uint64_t __spare1[28];
+    };
+    static_assert(sizeof(statx_t) == 256, "statx_t is not the size the kernel expects");
+
+    io_uring_metadata_ring() = default;
+    io_uring_metadata_ring(const io_uring_metadata_ring &) = delete;
+    io_uring_metadata_ring &operator=(const io_uring_metadata_ring &) = delete;
+    ~io_uring_metadata_ring()
+    {
+      if(_sqes != nullptr)
+      {
+        ::munmap(_sqes, _sqes_bytes);
+      }
+      if(_cqring != nullptr && _cqring != _sqring)
+      {
+        ::munmap(_cqring, _cqring_bytes);
+      }
+      if(_sqring != nullptr)
+      {
+        ::munmap(_sqring, _sqring_bytes);
+      }
+      if(_fd != -1)
+      {
+        ::close(_fd);
+      }
+    }
+
+    //! Sets up the ring with at least `entries` submission entries
+    result<void> init(unsigned entries) noexcept
+    {
+      _params_t params;
+      memset(&params, 0, sizeof(params));
+      _fd = _io_uring_setup(entries, &params);
+      if(_fd < 0)
+      {
+        _fd = -1;
+        return posix_error();
+      }
+      _entries = params.sq_entries;
+      _sqring_bytes = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+      _cqring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(_cqe_t);
+      _sqes_bytes = params.sq_entries * sizeof(_sqe_t);
+      if(params.features & (1U << 0) /*IORING_FEAT_SINGLE_MMAP*/)
+      {
+        _sqring_bytes = _cqring_bytes = (std::max)(_sqring_bytes, _cqring_bytes);
+      }
+      _sqring = ::mmap(nullptr, _sqring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, _IORING_OFF_SQ_RING);
+      if(MAP_FAILED == _sqring)
+      {
+        _sqring = nullptr;
+        return posix_error();
+      }
+      if(params.features & (1U << 0) /*IORING_FEAT_SINGLE_MMAP*/)
+      {
+        _cqring = _sqring;
+      }
+      else
+      {
+        _cqring = ::mmap(nullptr, _cqring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, _IORING_OFF_CQ_RING);
+        if(MAP_FAILED == _cqring)
+        {
+          _cqring = nullptr;
+          return posix_error();
+        }
+      }
+      auto *sqes = ::mmap(nullptr, _sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, _IORING_OFF_SQES);
+      if(MAP_FAILED == sqes)
+      {
+        return posix_error();
+      }
+      _sqes = (_sqe_t *) sqes;
+      auto *sq = (char *) _sqring, *cq = (char *) _cqring;
+      _sq_tail = (uint32_t *) (sq + params.sq_off.tail);
+      _sq_mask = (uint32_t *) (sq + params.sq_off.ring_mask);
+      _sq_array = (uint32_t *) (sq + params.sq_off.array);
+      _cq_head = (uint32_t *) (cq + params.cq_off.head);
+      _cq_tail = (uint32_t *) (cq + params.cq_off.tail);
+      _cq_mask = (uint32_t *) (cq + params.cq_off.ring_mask);
+      _cqes = (_cqe_t *) (cq + params.cq_off.cqes);
+      return success();
+    }
+
+    //! The maximum number of operations which may be queued before `submit_and_wait()`
+    unsigned capacity() const noexcept { return _entries; }
+    //! The number of operations queued
+    unsigned queued() const noexcept { return _queued; }
+
+    //! Queues an `openat()`. `path` must remain valid until `submit_and_wait()` returns.
+    void openat(uint64_t user_data, int dirfd, const char *path, int flags, mode_t mode = 0) noexcept
+    {
+      auto *sqe = _next_sqe(user_data);
+      sqe->opcode = _IORING_OP_OPENAT;
+      sqe->fd = dirfd;
+      sqe->addr = (uint64_t) (uintptr_t) path;
+      sqe->len = (uint32_t) mode;
+      sqe->op_flags = (uint32_t) flags;
+    }
+    /*! Queues a `statx()`. `path` and `buf` must remain valid until `submit_and_wait()` returns.
+    `buf` is usually a `statx_t`, but may be any 256 byte `struct statx`.
+    */
+    void statx(uint64_t user_data, int dirfd, const char *path, int flags, unsigned mask, void *buf) noexcept
+    {
+      auto *sqe = _next_sqe(user_data);
+      sqe->opcode = _IORING_OP_STATX;
+      sqe->fd = dirfd;
+      sqe->addr = (uint64_t) (uintptr_t) path;
+      sqe->len = mask;
+      sqe->off = (uint64_t) (uintptr_t) buf;
+      sqe->op_flags = (uint32_t) flags;
+    }
+
+    //! Queues an `unlinkat()`. `path` must remain valid until `submit_and_wait()` returns.
+    void unlinkat(uint64_t user_data, int dirfd, const char *path, int flags) noexcept
+    {
+      auto *sqe = _next_sqe(user_data);
+      sqe->opcode = _IORING_OP_UNLINKAT;
+      sqe->fd = dirfd;
+      sqe->addr = (uint64_t) (uintptr_t) path;
+      sqe->op_flags = (uint32_t) flags;
+    }
+
+    //! Queues a `symlinkat()`. `target` and `path` must remain valid until `submit_and_wait()` returns.
+    void symlinkat(uint64_t user_data, const char *target, int newdirfd, const char *path) noexcept
+    {
+      auto *sqe = _next_sqe(user_data);
+      sqe->opcode = _IORING_OP_SYMLINKAT;
+      sqe->fd = newdirfd;
+      sqe->addr = (uint64_t) (uintptr_t) target;
+      sqe->off = (uint64_t) (uintptr_t) path;
+    }
+
+    /*! Submits all queued operations and waits for all of them to complete, calling
+    `f(user_data, res)` for each completion where `res` is the syscall's return value, or
+    minus its `errno`.
+    */
+    template <class F> result<void> submit_and_wait(F &&f) noexcept
+    {
+      const unsigned count = _queued;
+      std::atomic_thread_fence(std::memory_order_release);
+      reinterpret_cast<std::atomic<uint32_t> *>(_sq_tail)->store(*_sq_tail + count, std::memory_order_release);
+      _queued = 0;
+      unsigned to_submit = count, completed = 0;
+      while(completed < count)
+      {
+        const int ret = _io_uring_enter(_fd, to_submit, 1, _IORING_ENTER_GETEVENTS);
+        if(ret < 0)
+        {
+          if(EINTR == errno)
+          {
+            continue;
+          }
+          return posix_error();
+        }
+        to_submit -= (std::min)(to_submit, (unsigned) ret);
+        uint32_t head = *_cq_head;
+        const uint32_t tail = reinterpret_cast<std::atomic<uint32_t> *>(_cq_tail)->load(std::memory_order_acquire);
+        for(; head != tail; head++)
+        {
+          const _cqe_t &cqe = _cqes[head & *_cq_mask];
+          f(cqe.user_data, cqe.res);
+          completed++;
+        }
+        reinterpret_cast<std::atomic<uint32_t> *>(_cq_head)->store(head, std::memory_order_release);
+      }
+      return success();
+    }
+  };
+}  // namespace detail
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
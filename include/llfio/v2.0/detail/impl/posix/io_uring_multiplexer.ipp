@@ -0,0 +1,2444 @@
+/* Multiplex file i/o
+(C) 2020 Niall Douglas <http://www.nedproductions.biz/> (9 commits)
+File Created: May 2019
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../../io_handle.hpp"
+
+#if !LLFIO_INCLUDED_BY_HEADER || !defined(LLFIO_IO_HANDLE_H)
+#error This file should never be included directly
+#endif
+
+#ifndef __linux__
+#error This implementation file is for Linux only
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <climits>  // for IOV_MAX
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <linux/types.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+/* io_uring is a bit of an interesting design, so we've ended up with a rather
+unusual i/o multiplexer design, which wasn't anticipated when we began this.
+
+POSIX provides strong read/write concurrency guarantees which are valuable, and
+more importantly, lots of file i/o code hard-assumes (often unintentionally) that
+there is an implicit sequencing of all i/o issued against each inode. This arose,
+historically speaking, because each inode has a read-write mutex, and i/o upon
+that inode therefore was serialised by that mutex in the kernel.
+
+Just to be clear, POSIX's guarantees are weaker than this - i/o upon non-overlapping
+regions can parallelise embarrassingly. However, if concurrent i/o upon the same
+inode overlaps a region, each i/o must complete as an atomic operation with
+respect to other i/o operations. And given how fast i/o can be, spending CPU on
+figuring out if regions overlap is usually more expensive than just using a per-inode
+read-write mutex.
+
+Conformance to POSIX read/write concurrency guarantees is excellent on Windows and
+all POSIX, except for Linux ext4 without O_DIRECT. However, io_uring doesn't
+expose any of this for file i/o - i/o submitted is immediately initiated, and no
+ordering is implemented at all. i.e. it's on you, the io_uring user, to not submit
+i/o the concurrency of which would be problematic. This even extends to IORING_OP_FSYNC,
+which will complete without reordering constraints to any i/o initiated beforehand
+or afterwards.
+
+io_uring *does* provide completion ordering *per-queue* via the IOSQE_IO_DRAIN and
+the IOSQE_IO_LINK flags. The former allows reordering of all i/o before the drain,
+but all that i/o must complete before the IOSQE_IO_DRAIN flagged submission can
+begin (this equals fence semantics). The latter imposes sequentially consistent
+ordering in that each item in the chain must complete before the next item,
+however individual chains can be reordered against one another.
+
+If one wishes to implement POSIX read/write concurrency guarantees,
+then one needs to enforce an ordering per-inode, which because io_uring only offers
+ordering at a per-queue level, implies that there must be either a queue per inode,
+or all file i/o must be sequentially orderered to all other file i/o i.e. you use
+a fully sequentially ordered queue for file i/o, and a separate freely reordered
+queue for non-file i/o.
+
+What we've thus done for this i/o multiplexer is this:
+
+- If the handle type is seekable, we keep a per-inode record of the byte range of every
+i/o initiated and not yet completed. An i/o whose range overlaps that of an earlier
+incomplete i/o upon the same inode, where at least one of the two is a write, waits in
+a per-inode queue until the earlier i/o completes. Barriers overlap everything upon
+their inode. Non-overlapping i/o, and all i/o upon different inodes, is submitted
+immediately without any ordering flags, so the queue depth is never
+reduced by unrelated i/o. This is cheaper than it sounds, as the number of i/o in
+flight per inode is usually small, and it is far cheaper than IOSQE_IO_DRAIN, which
+fences the entire ring.
+
+- If the handle type is not seekable, only one read and one write may be submitted
+to io_uring per handle at a time. All other initiated i/o enters a queue per handle,
+and as each i/o completes, the next i/o from the queue is submitted. Each non-seekable
+i/o is submitted as an IORING_OP_POLL_ADD linked to the IORING_OP_READV/IORING_OP_WRITEV,
+so the kernel never parks a worker thread on a blocking pipe or socket.
+
+- Two io_uring instances are used, one for seekable i/o, the other for non-seekable
+i/o. This prevents writes to seekable handles blocking until non-seekable i/o completes.
+
+- Both io_uring instances signal the same eventfd when a completion is posted, so a
+thread can sleep in `check_for_any_completed_io()` until either ring has work.
+
+- Buffers returned by `allocate_registered_buffer()` are registered with the seekable
+ring as io_uring fixed buffers, if the kernel supports sparse buffer tables (Linux 5.19
+onwards). Single buffer i/o upon seekable handles lying within such a buffer is then
+issued as IORING_OP_READ_FIXED/IORING_OP_WRITE_FIXED, which saves the kernel pinning
+and unpinning the pages for every i/o. Registered buffers can outlive the multiplexer,
+so the table of slots is reference counted and shared with each buffer.
+
+- `io_uring_multiplexer_flag::sqpoll` creates the seekable ring with IORING_SETUP_SQPOLL,
+so a kernel thread consumes submissions and no syscall is needed to submit. The non-seekable
+ring is never kernel polled, as pipes and sockets are not where the IOPS are.
+
+- `io_uring_multiplexer_flag::iopoll` creates a third ring with IORING_SETUP_IOPOLL, to which
+reads and writes upon seekable handles opened `O_DIRECT` (`caching::none` and
+`caching::only_metadata`) are sent. Polled rings cannot do anything else, so barriers
+upon those handles still go to the seekable ring, and the per-inode tracking above
+ensures they are not submitted until preceding polled i/o has completed. Polled completions are never signalled, so whilst
+any polled i/o is in flight `check_for_any_completed_io()` busy polls rather than sleeps.
+
+- `io_uring_multiplexer_flag::per_thread_rings` creates one complete set of the above per
+thread, see `linux_io_uring_per_thread_multiplexer` below.
+
+- Reads upon seekable handles which use the kernel page cache, and which do not overlap
+incomplete writes, are first attempted with `preadv2(RWF_NOWAIT)`. If that reads everything
+requested, the data was already in the page cache and the read completes immediately, without
+being submitted to io_uring and thus without the kernel handing it to a worker thread. Anything
+short of that, including short reads at the end of the file, goes to io_uring as normal. If the
+kernel or filing system does not support `RWF_NOWAIT`, the attempt is not made again.
+
+- i/o with a deadline is armed in a timer wheel from initiation until it completes. Sleeps in
+`check_for_any_completed_io()` end no later than the wheel next needs advancing. i/o whose
+deadline has passed, and which has not yet reached the kernel, is dequeued and completed with
+`ETIMEDOUT`. i/o already with the kernel is cancelled with IORING_OP_ASYNC_CANCEL, and its
+cancelled completion is reported as `ETIMEDOUT`. Polled rings cannot cancel, so i/o upon them
+runs to completion.
+*/
+class linux_io_uring_per_thread_multiplexer;
+template <bool is_threadsafe> class linux_io_uring_multiplexer final : public io_multiplexer_impl<is_threadsafe>
+{
+  friend class linux_io_uring_per_thread_multiplexer;
+
+  using _base = io_multiplexer_impl<is_threadsafe>;
+  using _multiplexer_lock_guard = typename _base::_lock_guard;
+
+  using path_type = typename _base::path_type;
+  using extent_type = typename _base::extent_type;
+  using size_type = typename _base::size_type;
+  using mode = typename _base::mode;
+  using creation = typename _base::creation;
+  using caching = typename _base::caching;
+  using flag = typename _base::flag;
+  using barrier_kind = typename _base::barrier_kind;
+  using const_buffers_type = typename _base::const_buffers_type;
+  using buffers_type = typename _base::buffers_type;
+  using registered_buffer_type = typename _base::registered_buffer_type;
+  template <class T> using io_request = typename _base::template io_request<T>;
+  template <class T> using io_result = typename _base::template io_result<T>;
+  using io_operation_state = typename _base::io_operation_state;
+  using io_operation_state_visitor = typename _base::io_operation_state_visitor;
+  using check_for_any_completed_io_statistics = typename _base::check_for_any_completed_io_statistics;
+
+  // The io_uring kernel submission structure
+  struct _io_uring_sqe
+  {
+    uint8_t opcode;  /* type of operation for this sqe */
+    uint8_t flags;   /* IOSQE_ flags */
+    uint16_t ioprio; /* ioprio for the request */
+    int32_t fd;      /* file descriptor to do IO on */
+    union {
+      uint64_t off; /* offset into file */
+      uint64_t addr2;
+    };
+    union {
+      uint64_t addr; /* pointer to buffer or iovecs */
+      uint64_t splice_off_in;
+    };
+    uint32_t len; /* buffer size or number of iovecs */
+    union {
+      __kernel_rwf_t rw_flags;
+      uint32_t fsync_flags;
+      uint16_t poll_events;
+      uint32_t sync_range_flags;
+      uint32_t msg_flags;
+      uint32_t timeout_flags;
+      uint32_t accept_flags;
+      uint32_t cancel_flags;
+      uint32_t open_flags;
+      uint32_t statx_flags;
+      uint32_t fadvise_advice;
+      uint32_t splice_flags;
+    };
+    uint64_t user_data; /* data to be passed back at completion time */
+    union {
+      struct
+      {
+        /* pack this to avoid bogus arm OABI complaints */
+        union {
+          /* index into fixed buffers, if used */
+          uint16_t buf_index;
+          /* for grouped buffer selection */
+          uint16_t buf_group;
+        } __attribute__((packed));
+        /* personality to use, if used */
+        uint16_t personality;
+        int32_t splice_fd_in;
+      };
+      uint64_t __pad2[3];
+    };
+  };
+  static_assert(sizeof(_io_uring_sqe) == 64, "_io_uring_sqe is not the size the kernel expects");
+
+  // sqe->flags
+  /* use fixed fileset */
+  static constexpr uint32_t _IOSQE_FIXED_FILE = (1U << 0);
+  /* issue after inflight IO */
+  static constexpr uint32_t _IOSQE_IO_DRAIN = (1U << 1);
+  /* links next sqe */
+  static constexpr uint32_t _IOSQE_IO_LINK = (1U << 2);
+  /* like LINK, but stronger */
+  static constexpr uint32_t _IOSQE_IO_HARDLINK = (1U << 3);
+  /* always go async */
+  static constexpr uint32_t _IOSQE_ASYNC = (1U << 4);
+  /* select buffer from sqe->buf_group */
+  static constexpr uint32_t _IOSQE_BUFFER_SELECT = (1U << 5);
+
+  // io_uring_setup() flags
+  static constexpr uint32_t _IORING_SETUP_IOPOLL = (1U << 0);    /* io_context is polled */
+  static constexpr uint32_t _IORING_SETUP_SQPOLL = (1U << 1);    /* SQ poll thread */
+  static constexpr uint32_t _IORING_SETUP_SQ_AFF = (1U << 2);    /* sq_thread_cpu is valid */
+  static constexpr uint32_t _IORING_SETUP_CQSIZE = (1U << 3);    /* app defines CQ size */
+  static constexpr uint32_t _IORING_SETUP_CLAMP = (1U << 4);     /* clamp SQ/CQ ring sizes */
+  static constexpr uint32_t _IORING_SETUP_ATTACH_WQ = (1U << 5); /* attach to existing wq */
+
+  // io_uring_enter() flags
+  static constexpr uint32_t _IORING_ENTER_GETEVENTS = (1U << 0);
+  static constexpr uint32_t _IORING_ENTER_SQ_WAKEUP = (1U << 1);
+
+  // sq_ring->flags
+  static constexpr uint32_t _IORING_SQ_NEED_WAKEUP = (1U << 0); /* needs io_uring_enter wakeup */
+
+  // sqe->opcode
+  enum
+  {
+    _IORING_OP_NOP,
+    _IORING_OP_READV,
+    _IORING_OP_WRITEV,
+    _IORING_OP_FSYNC,
+    _IORING_OP_READ_FIXED,
+    _IORING_OP_WRITE_FIXED,
+    _IORING_OP_POLL_ADD,
+    _IORING_OP_POLL_REMOVE,
+    _IORING_OP_SYNC_FILE_RANGE,
+    _IORING_OP_SENDMSG,
+    _IORING_OP_RECVMSG,
+    _IORING_OP_TIMEOUT,
+    _IORING_OP_TIMEOUT_REMOVE,
+    _IORING_OP_ACCEPT,
+    _IORING_OP_ASYNC_CANCEL,
+    _IORING_OP_LINK_TIMEOUT,
+    _IORING_OP_CONNECT,
+    _IORING_OP_FALLOCATE,
+    _IORING_OP_OPENAT,
+    _IORING_OP_CLOSE,
+    _IORING_OP_FILES_UPDATE,
+    _IORING_OP_STATX,
+    _IORING_OP_READ,
+    _IORING_OP_WRITE,
+    _IORING_OP_FADVISE,
+    _IORING_OP_MADVISE,
+    _IORING_OP_SEND,
+    _IORING_OP_RECV,
+    _IORING_OP_OPENAT2,
+    _IORING_OP_EPOLL_CTL,
+    _IORING_OP_SPLICE,
+    _IORING_OP_PROVIDE_BUFFERS,
+    _IORING_OP_REMOVE_BUFFERS,
+
+    /* this goes last, obviously */
+    _IORING_OP_LAST,
+  };
+
+  // sqe->fsync_flags
+  static constexpr uint32_t _IORING_FSYNC_DATASYNC = (1U << 0);
+
+  // sqe->timeout_flags
+  static constexpr uint32_t _IORING_TIMEOUT_ABS = (1U << 0);
+
+  // The io_uring kernel completion structure
+  struct _io_uring_cqe
+  {
+    uint64_t user_data; /* sqe->data submission passed back */
+    int32_t res;        /* result code for this event */
+    uint32_t flags;
+  };
+
+  // Magic offsets for the application to mmap the data it needs
+  static constexpr off_t _IORING_OFF_SQ_RING = (off_t) 0;
+  static constexpr off_t _IORING_OFF_CQ_RING = (off_t) 0x8000000;
+  static constexpr off_t _IORING_OFF_SQES = (off_t) 0x10000000;
+
+  // Filled with the offset for mmap(2)
+  struct _io_sqring_offsets
+  {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t array;
+    uint32_t resv1;
+    uint64_t resv2;
+  };
+
+  struct _io_cqring_offsets
+  {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t overflow;
+    uint32_t cqes;
+    uint64_t resv[2];
+  };
+
+  // Passed in for io_uring_setup(2). Copied back with updated info on success
+  struct _io_uring_params
+  {
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t flags;
+    uint32_t sq_thread_cpu;
+    uint32_t sq_thread_idle;
+    uint32_t features;
+    uint32_t wq_fd;
+    uint32_t resv[3];
+    struct _io_sqring_offsets sq_off;
+    struct _io_cqring_offsets cq_off;
+  };
+
+  // io_uring_params->features flags
+  static constexpr uint32_t _IORING_FEAT_SINGLE_MMAP = (1U << 0);
+  static constexpr uint32_t _IORING_FEAT_NODROP = (1U << 1);
+  static constexpr uint32_t _IORING_FEAT_SUBMIT_STABLE = (1U << 2);
+  static constexpr uint32_t _IORING_FEAT_SQPOLL_NONFIXED = (1U << 7);
+
+  // io_uring_register(2) opcodes and arguments
+  enum
+  {
+    _IORING_REGISTER_BUFFERS,
+    _IORING_UNREGISTER_BUFFERS,
+    _IORING_REGISTER_FILES,
+    _IORING_UNREGISTER_FILES,
+    _IORING_REGISTER_EVENTFD,
+    _IORING_UNREGISTER_EVENTFD,
+    _IORING_REGISTER_FILES_UPDATE,
+    _IORING_REGISTER_EVENTFD_ASYNC,
+    _IORING_REGISTER_PROBE,
+    _IORING_REGISTER_PERSONALITY,
+    _IORING_UNREGISTER_PERSONALITY,
+    _IORING_REGISTER_RESTRICTIONS,
+    _IORING_REGISTER_ENABLE_RINGS,
+    _IORING_REGISTER_FILES2,
+    _IORING_REGISTER_FILES_UPDATE2,
+    _IORING_REGISTER_BUFFERS2,
+    _IORING_REGISTER_BUFFERS_UPDATE
+  };
+
+  // io_uring_rsrc_register->flags
+  static constexpr uint32_t _IORING_RSRC_REGISTER_SPARSE = (1U << 0);
+
+  // Argument for _IORING_REGISTER_BUFFERS2
+  struct _io_uring_rsrc_register
+  {
+    uint32_t nr;
+    uint32_t flags;
+    uint64_t resv2;
+    uint64_t data;
+    uint64_t tags;
+  };
+  // Argument for _IORING_REGISTER_BUFFERS_UPDATE
+  struct _io_uring_rsrc_update2
+  {
+    uint32_t offset;
+    uint32_t resv;
+    uint64_t data;
+    uint64_t tags;
+    uint32_t nr;
+    uint32_t resv2;
+  };
+  static_assert(sizeof(_io_uring_rsrc_register) == 32, "_io_uring_rsrc_register is not the size the kernel expects");
+  static_assert(sizeof(_io_uring_rsrc_update2) == 32, "_io_uring_rsrc_update2 is not the size the kernel expects");
+
+  template <class T> static T _io_uring_smp_load_acquire(const T *_v) noexcept
+  {
+    auto *v = (const std::atomic<T> *) _v;
+    return v->load(std::memory_order_acquire);
+  }
+  template <class T> static void _io_uring_smp_store_release(T *_v, T x) noexcept
+  {
+    auto *v = (std::atomic<T> *) _v;
+    v->store(x, std::memory_order_release);
+  }
+  static int _io_uring_setup(unsigned entries, struct _io_uring_params *p) noexcept
+  {
+#if defined(__NR_io_uring_setup)
+    return (int) syscall(__NR_io_uring_setup, entries, p);
+#elif defined(__alpha__)
+    return (int) syscall(535 /*__NR_io_uring_setup*/, entries, p);
+#else
+    return (int) syscall(425 /*__NR_io_uring_setup*/, entries, p);
+#endif
+  }
+  static int _io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) noexcept
+  {
+#if defined(__NR_io_uring_register)
+    return (int) syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+#elif defined(__alpha__)
+    return (int) syscall(537 /*__NR_io_uring_register*/, fd, opcode, arg, nr_args);
+#else
+    return (int) syscall(427 /*__NR_io_uring_register*/, fd, opcode, arg, nr_args);
+#endif
+  }
+  static int _io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept
+  {
+#if defined(__NR_io_uring_enter)
+    return (int) syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+#elif defined(__alpha__)
+    return (int) syscall(536 /*__NR_io_uring_enter*/, fd, to_submit, min_complete, flags, nullptr, 0);
+#else
+    return (int) syscall(426 /*__NR_io_uring_enter*/, fd, to_submit, min_complete, flags, nullptr, 0);
+#endif
+  }
+
+  // Where an initiated i/o currently lives
+  enum class _where_t : uint8_t
+  {
+    nowhere,     // not initiated, or completed
+    fd_queue,    // waiting behind another i/o on the same non-seekable handle
+    inode_queue, // waiting for overlapping i/o upon the same inode to complete
+    ring_queue,  // waiting for space in the submission or completion ring
+    kernel       // submitted to io_uring
+  };
+
+  struct _inode_t;
+
+  struct _io_uring_operation_state final
+      : public std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>,
+        public io_multiplexer_timer_wheel::node  // armed whilst within the multiplexer if it has a deadline
+  {
+    using _impl = std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>;
+
+    _io_uring_operation_state *prev{nullptr}, *next{nullptr};
+    linux_io_uring_multiplexer *owner{nullptr};  // the multiplexer which initiated this i/o
+    uint64_t initiated_ns{0};                    // when initiated, for check_for_any_completed_io_statistics
+    // These are cached here from the handle for performance
+    int fd{-1};
+    bool is_seekable{false};
+    bool is_polled{false};      // handle is O_DIRECT and this multiplexer has a polled ring
+    bool is_poll_linked{false};
+    bool try_nowait{false};  // seekable read through the page cache, so worth trying preadv2(RWF_NOWAIT) first
+    bool cancel_requested{false};
+    bool timed_out{false};  // cancelled because its deadline passed
+    _where_t where{_where_t::nowhere};
+    // For seekable i/o, the byte range touched, and membership of the inode's list of incomplete i/o
+    bool is_write_or_barrier{false};
+    bool in_inode_incomplete{false};
+    extent_type range_begin{0}, range_end{0};
+    _inode_t *inode{nullptr};
+    _io_uring_operation_state *inode_prev{nullptr}, *inode_next{nullptr};
+
+    _io_uring_operation_state() = default;
+    // Construct implicitly from the base implementation, see relocate_to()
+    explicit _io_uring_operation_state(_impl &&o) noexcept
+        : _impl(std::move(o))
+    {
+    }
+    using _impl::_impl;
+
+    // You will need to reimplement this to relocate any custom state defined
+    // here, and to restamp to vptr with this finalised dynamic type. It is
+    // important to do this, as final-based optimisations compare the vptr
+    // to the finalised vptr and do non-indirect dispatch if they match.
+    virtual io_operation_state *relocate_to(byte *to_) noexcept override
+    {
+      // io_uring holds a pointer to this state until it completes
+      assert(where == _where_t::nowhere);
+      auto *to = _impl::relocate_to(to_);
+      // restamp the vptr with my own
+      auto _to = new(to) _io_uring_operation_state(std::move(*static_cast<_impl *>(to)));
+      _to->fd = fd;
+      _to->is_seekable = is_seekable;
+      _to->is_polled = is_polled;
+      return _to;
+    }
+  };
+
+  struct _queue_t
+  {
+    _io_uring_operation_state *first{nullptr}, *last{nullptr};
+
+    bool empty() const noexcept { return first == nullptr; }
+    void push_back(_io_uring_operation_state *state) noexcept
+    {
+      assert(state->prev == nullptr);
+      assert(state->next == nullptr);
+      assert(first != state);
+      assert(last != state);
+      if(first == nullptr)
+      {
+        first = last = state;
+      }
+      else
+      {
+        assert(last->next == nullptr);
+        state->prev = last;
+        last->next = state;
+        last = state;
+      }
+    }
+    void remove(_io_uring_operation_state *state) noexcept
+    {
+      if(state->prev == nullptr)
+      {
+        assert(first == state);
+        first = state->next;
+      }
+      else
+      {
+        state->prev->next = state->next;
+      }
+      if(state->next == nullptr)
+      {
+        assert(last == state);
+        last = state->prev;
+      }
+      else
+      {
+        state->next->prev = state->prev;
+      }
+      state->next = state->prev = nullptr;
+    }
+    _io_uring_operation_state *pop_front() noexcept
+    {
+      auto *ret = first;
+      if(ret != nullptr)
+      {
+        remove(ret);
+      }
+      return ret;
+    }
+  };
+
+  // One io_uring instance, with its submission and completion rings mapped into memory
+  struct _ring_t
+  {
+    int fd{-1};
+    void *sq_ring{MAP_FAILED}, *cq_ring{MAP_FAILED};
+    size_t sq_ring_bytes{0}, cq_ring_bytes{0};
+    _io_uring_sqe *sqes{static_cast<_io_uring_sqe *>(MAP_FAILED)};
+    size_t sqes_bytes{0};
+
+    uint32_t *sq_head{nullptr}, *sq_tail{nullptr}, *sq_array{nullptr}, *sq_flags{nullptr};
+    uint32_t sq_mask{0}, sq_entries{0};
+    uint32_t *cq_head{nullptr}, *cq_tail{nullptr};
+    uint32_t cq_mask{0}, cq_entries{0};
+    _io_uring_cqe *cqes{nullptr};
+
+    uint32_t sq_tail_local{0};  // the submission tail we have written up to
+    uint32_t to_submit{0};      // entries written but not yet consumed by io_uring_enter()
+    uint32_t inflight{0};       // entries which have not yet had their completion reaped
+    _queue_t unsubmitted;       // initiated i/o for which there was no room in the rings
+    bool is_sqpoll{false};      // a kernel thread consumes the submission ring
+    bool is_iopoll{false};      // completions must be polled for
+  };
+
+  // Tracks the incomplete i/o upon an inode, which may be open via many handles
+  struct _inode_t
+  {
+    std::pair<dev_t, ino_t> key;
+    size_t handles{0};
+    // Submitted or submittable i/o, unordered
+    _io_uring_operation_state *incomplete{nullptr};
+    // i/o waiting on overlapping incomplete i/o, in the order initiated
+    _queue_t waiting;
+
+    void add_incomplete(_io_uring_operation_state *state) noexcept
+    {
+      assert(!state->in_inode_incomplete);
+      state->inode_prev = nullptr;
+      state->inode_next = incomplete;
+      if(incomplete != nullptr)
+      {
+        incomplete->inode_prev = state;
+      }
+      incomplete = state;
+      state->in_inode_incomplete = true;
+    }
+    void remove_incomplete(_io_uring_operation_state *state) noexcept
+    {
+      assert(state->in_inode_incomplete);
+      if(state->inode_prev == nullptr)
+      {
+        incomplete = state->inode_next;
+      }
+      else
+      {
+        state->inode_prev->inode_next = state->inode_next;
+      }
+      if(state->inode_next != nullptr)
+      {
+        state->inode_next->inode_prev = state->inode_prev;
+      }
+      state->inode_prev = state->inode_next = nullptr;
+      state->in_inode_incomplete = false;
+    }
+    static bool overlaps(const _io_uring_operation_state *a, const _io_uring_operation_state *b) noexcept
+    {
+      // Concurrent reads never conflict
+      return (a->is_write_or_barrier || b->is_write_or_barrier) && a->range_begin < b->range_end && b->range_begin < a->range_end;
+    }
+    // True if state overlaps any incomplete i/o, or any waiting i/o before `until`
+    bool conflicts(const _io_uring_operation_state *state, const _io_uring_operation_state *until) const noexcept
+    {
+      for(auto *i = incomplete; i != nullptr; i = i->inode_next)
+      {
+        if(overlaps(state, i))
+        {
+          return true;
+        }
+      }
+      for(auto *i = waiting.first; i != until; i = i->next)
+      {
+        if(overlaps(state, i))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+  };
+
+  struct _registered_fd
+  {
+    int fd{-1};
+    bool is_seekable{false};
+    _inode_t *inode{nullptr};  // for seekable handles
+    // The number of i/o initiated upon this handle which have not completed yet
+    size_t outstanding{0};
+    // For non-seekable handles, the single read and single write/barrier submitted to io_uring
+    _io_uring_operation_state *active_read{nullptr}, *active_write_or_barrier{nullptr};
+    // For non-seekable handles, initiated i/o waiting for the active i/o to complete
+    _queue_t queued_reads, queued_writes_or_barriers;
+
+    constexpr _registered_fd() {}
+    _registered_fd(int _fd, bool _is_seekable)
+        : fd(_fd)
+        , is_seekable(_is_seekable)
+    {
+    }
+    bool operator<(int o) const noexcept { return fd < o; }
+  };
+
+  // The number of fixed buffer slots registered with the seekable ring
+  static constexpr uint32_t _fixed_buffer_slots = 1024;
+
+  // The slots in the seekable ring's fixed buffer table. Shared with every fixed buffer allocated.
+  struct _fixed_buffer_table
+  {
+    std::mutex lock;
+    int ring_fd{-1};         // -1 once the multiplexer has closed
+    int polled_ring_fd{-1};  // the polled ring shares the same table of slots, if it exists
+    std::vector<bool> used;
+
+    // Points a slot at a buffer, or at nothing if iov_base is null. Must be called with the lock held.
+    bool update(uint32_t index, struct iovec iov) noexcept
+    {
+      _io_uring_rsrc_update2 up;
+      memset(&up, 0, sizeof(up));
+      up.offset = index;
+      up.data = (uint64_t)(uintptr_t) &iov;
+      up.nr = 1;
+      if(_io_uring_register(ring_fd, _IORING_REGISTER_BUFFERS_UPDATE, &up, sizeof(up)) < 0)
+      {
+        return false;
+      }
+      if(-1 != polled_ring_fd && _io_uring_register(polled_ring_fd, _IORING_REGISTER_BUFFERS_UPDATE, &up, sizeof(up)) < 0)
+      {
+        struct iovec empty;
+        memset(&empty, 0, sizeof(empty));
+        up.data = (uint64_t)(uintptr_t) &empty;
+        (void) _io_uring_register(ring_fd, _IORING_REGISTER_BUFFERS_UPDATE, &up, sizeof(up));
+        return false;
+      }
+      return true;
+    }
+  };
+  // Deleter of fixed buffers, whose presence is also how we recognise them
+  struct _fixed_buffer_deleter
+  {
+    std::shared_ptr<_fixed_buffer_table> table;
+    registered_buffer_type backing;  // owns the pages
+    uint32_t index{0};
+
+    void operator()(io_multiplexer::_registered_buffer_type *p) noexcept
+    {
+      {
+        std::lock_guard<std::mutex> g(table->lock);
+        if(-1 != table->ring_fd)
+        {
+          // The kernel unpins the pages once any i/o still using them completes
+          struct iovec iov;
+          memset(&iov, 0, sizeof(iov));
+          (void) table->update(index, iov);
+        }
+        table->used[index] = false;
+      }
+      delete p;
+      backing.reset();
+    }
+  };
+
+  _ring_t _seekable, _nonseekable;  // _nonseekable.fd is kept in this->_v.fd
+  std::map<std::pair<dev_t, ino_t>, _inode_t> _inodes;  // node based, so _inode_t addresses are stable
+  _ring_t _polled;                  // fd is -1 unless io_uring_multiplexer_flag::iopoll
+  bool _has_polled_ring{false};     // immutable after init(), so readable without the lock
+  bool _nowait_unsupported{false};  // set if preadv2(RWF_NOWAIT) has ever been refused
+  std::shared_ptr<_fixed_buffer_table> _fixed_buffers;  // null if the kernel cannot do sparse buffer tables
+  int _eventfd{-1};
+  int _wakecount{0};
+  std::vector<_registered_fd> _registered_fds;
+  io_multiplexer_timer_wheel _deadlines;
+
+  typename std::vector<_registered_fd>::iterator _find_fd(int fd) noexcept
+  {
+    auto it = std::lower_bound(_registered_fds.begin(), _registered_fds.end(), fd);
+    if(it == _registered_fds.end() || it->fd != fd)
+    {
+      return _registered_fds.end();
+    }
+    return it;
+  }
+  _ring_t &_ring_for(const _io_uring_operation_state *state) noexcept
+  {
+    if(!state->is_seekable)
+    {
+      return _nonseekable;
+    }
+    // Polled rings can only do reads and writes
+    if(state->is_polled && state->current_state() != io_operation_state_type::barrier_initiated)
+    {
+      return _polled;
+    }
+    return _seekable;
+  }
+
+  static result<void> _init_ring(_ring_t &r, unsigned entries, uint32_t setup_flags = 0) noexcept
+  {
+    _io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = setup_flags;
+    r.fd = _io_uring_setup(entries, &params);
+    if(r.fd < 0)
+    {
+      r.fd = -1;
+      return posix_error();
+    }
+    r.is_sqpoll = (setup_flags & _IORING_SETUP_SQPOLL) != 0;
+    r.is_iopoll = (setup_flags & _IORING_SETUP_IOPOLL) != 0;
+    if(r.is_sqpoll && (params.features & _IORING_FEAT_SQPOLL_NONFIXED) == 0)
+    {
+      // Before Linux 5.11 kernel polled submission required registered files
+      return errc::function_not_supported;
+    }
+    r.sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    r.cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(_io_uring_cqe);
+    if((params.features & _IORING_FEAT_SINGLE_MMAP) != 0)
+    {
+      // Linux 5.4 onwards maps both rings with a single mmap
+      r.sq_ring_bytes = r.cq_ring_bytes = std::max(r.sq_ring_bytes, r.cq_ring_bytes);
+    }
+    r.sq_ring = ::mmap(nullptr, r.sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, _IORING_OFF_SQ_RING);
+    if(MAP_FAILED == r.sq_ring)
+    {
+      return posix_error();
+    }
+    if((params.features & _IORING_FEAT_SINGLE_MMAP) != 0)
+    {
+      r.cq_ring = r.sq_ring;
+    }
+    else
+    {
+      r.cq_ring = ::mmap(nullptr, r.cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, _IORING_OFF_CQ_RING);
+      if(MAP_FAILED == r.cq_ring)
+      {
+        return posix_error();
+      }
+    }
+    r.sqes_bytes = params.sq_entries * sizeof(_io_uring_sqe);
+    r.sqes = static_cast<_io_uring_sqe *>(::mmap(nullptr, r.sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r.fd, _IORING_OFF_SQES));
+    if(MAP_FAILED == r.sqes)
+    {
+      return posix_error();
+    }
+    auto *sq = static_cast<byte *>(r.sq_ring);
+    r.sq_head = reinterpret_cast<uint32_t *>(sq + params.sq_off.head);
+    r.sq_tail = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+    r.sq_array = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+    r.sq_flags = reinterpret_cast<uint32_t *>(sq + params.sq_off.flags);
+    r.sq_mask = *reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+    r.sq_entries = *reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_entries);
+    r.sq_tail_local = *r.sq_tail;
+    auto *cq = static_cast<byte *>(r.cq_ring);
+    r.cq_head = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+    r.cq_tail = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+    r.cq_mask = *reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+    r.cq_entries = *reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_entries);
+    r.cqes = reinterpret_cast<_io_uring_cqe *>(cq + params.cq_off.cqes);
+    return success();
+  }
+  static result<void> _close_ring(_ring_t &r, bool close_fd) noexcept
+  {
+    if(MAP_FAILED != static_cast<void *>(r.sqes))
+    {
+      if(-1 == ::munmap(r.sqes, r.sqes_bytes))
+      {
+        return posix_error();
+      }
+      r.sqes = static_cast<_io_uring_sqe *>(MAP_FAILED);
+    }
+    if(MAP_FAILED != r.cq_ring && r.cq_ring != r.sq_ring)
+    {
+      if(-1 == ::munmap(r.cq_ring, r.cq_ring_bytes))
+      {
+        return posix_error();
+      }
+    }
+    r.cq_ring = MAP_FAILED;
+    if(MAP_FAILED != r.sq_ring)
+    {
+      if(-1 == ::munmap(r.sq_ring, r.sq_ring_bytes))
+      {
+        return posix_error();
+      }
+      r.sq_ring = MAP_FAILED;
+    }
+    if(close_fd && -1 != r.fd)
+    {
+      if(-1 == ::close(r.fd))
+      {
+        return posix_error();
+      }
+    }
+    r.fd = -1;
+    return success();
+  }
+
+  // Submits all written submission entries to the kernel. Must be called with the multiplexer lock held.
+  // Being static, syscalls are traced as being of the ring.
+  static result<void> _enter(_ring_t &r) noexcept
+  {
+    if(r.is_sqpoll)
+    {
+      // The kernel thread consumes published submissions by itself, it only needs waking if it went idle
+      if(r.to_submit > 0 && (_io_uring_smp_load_acquire(r.sq_flags) & _IORING_SQ_NEED_WAKEUP) != 0)
+      {
+        LLFIO_TRACE_SYSCALL(&r, "io_uring_enter(SQ_WAKEUP)");
+        if(_io_uring_enter(r.fd, 0, 0, _IORING_ENTER_SQ_WAKEUP) < 0 && EINTR != errno)
+        {
+          return posix_error();
+        }
+      }
+      r.to_submit = 0;
+      return success();
+    }
+    while(r.to_submit > 0)
+    {
+      int ret;
+      {
+        LLFIO_TRACE_SYSCALL(&r, "io_uring_enter(submit)");
+        ret = _io_uring_enter(r.fd, r.to_submit, 0, 0);
+      }
+      if(ret < 0)
+      {
+        if(EINTR == errno)
+        {
+          continue;
+        }
+        if(EAGAIN == errno || EBUSY == errno)
+        {
+          // The kernel is out of resources or the completion ring is full, try again later
+          return success();
+        }
+        return posix_error();
+      }
+      if(ret == 0)
+      {
+        break;
+      }
+      r.to_submit -= (uint32_t) ret;
+    }
+    return success();
+  }
+  // True if `count` submission entries can be written without risking completion ring overflow
+  static bool _has_capacity(_ring_t &r, uint32_t count) noexcept
+  {
+    if(r.inflight + count > r.cq_entries)
+    {
+      return false;
+    }
+    if(r.sq_tail_local - _io_uring_smp_load_acquire(r.sq_head) + count > r.sq_entries)
+    {
+      (void) _enter(r);
+      if(r.sq_tail_local - _io_uring_smp_load_acquire(r.sq_head) + count > r.sq_entries)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+  // Maps per-request write flags onto RWF_* flags
+  static __kernel_rwf_t _rw_flags(io_multiplexer::write_flag flags) noexcept
+  {
+    __kernel_rwf_t ret = 0;
+    if(flags & io_multiplexer::write_flag::data_sync)
+    {
+      ret |= 0x00000002 /*RWF_DSYNC*/;
+    }
+    if(flags & io_multiplexer::write_flag::sync)
+    {
+      ret |= 0x00000004 /*RWF_SYNC*/;
+    }
+    if(flags & io_multiplexer::write_flag::append)
+    {
+      ret |= 0x00000010 /*RWF_APPEND*/;
+    }
+    if(flags & io_multiplexer::write_flag::uncached)
+    {
+      ret |= 0x00000080 /*RWF_DONTCACHE*/;
+    }
+    if(flags & io_multiplexer::write_flag::atomic)
+    {
+      ret |= 0x00000040 /*RWF_ATOMIC*/;
+    }
+    return ret;
+  }
+  static _io_uring_sqe *_next_sqe(_ring_t &r) noexcept
+  {
+    const uint32_t index = r.sq_tail_local & r.sq_mask;
+    _io_uring_sqe *sqe = &r.sqes[index];
+    memset(sqe, 0, sizeof(_io_uring_sqe));
+    r.sq_array[index] = index;
+    ++r.sq_tail_local;
+    ++r.to_submit;
+    ++r.inflight;
+    return sqe;
+  }
+  static void _publish(_ring_t &r) noexcept { _io_uring_smp_store_release(r.sq_tail, r.sq_tail_local); }
+
+  // Returns the fixed buffer slot to use for an i/o, or -1 if it cannot use one
+  template <class BuffersType> int _fixed_buffer_index(const _io_uring_operation_state *state, const BuffersType &buffers) const noexcept
+  {
+    if(!state->is_seekable || buffers.size() != 1 || !_fixed_buffers)
+    {
+      return -1;
+    }
+    const auto &base = state->payload.noncompleted.base;
+    if(!base)
+    {
+      return -1;
+    }
+    // Buffers from a registered_buffer_pool are registered as part of their parent
+    const auto *d = std::get_deleter<_fixed_buffer_deleter>(base->parent ? base->parent : base);
+    if(d == nullptr || d->table != _fixed_buffers)
+    {
+      return -1;
+    }
+    // READ_FIXED/WRITE_FIXED require the i/o to lie entirely within the registered buffer
+    const auto *p = reinterpret_cast<const byte *>(buffers[0].data());
+    if(p < base->data() || p + buffers[0].size() > base->data() + base->size() || buffers[0].size() > (uint32_t) -1)
+    {
+      return -1;
+    }
+    return (int) d->index;
+  }
+
+  // Writes the submission entries for an initiated i/o. Returns false if there is no room.
+  bool _write_sqes(_ring_t &r, _io_uring_operation_state *state) noexcept
+  {
+    if(!_has_capacity(r, state->is_poll_linked ? 2 : 1))
+    {
+      return false;
+    }
+    const auto s = state->current_state();
+    if(state->is_poll_linked)
+    {
+      // Wait for the non-seekable handle to become ready first, so the i/o never blocks a kernel worker
+      _io_uring_sqe *sqe = _next_sqe(r);
+      sqe->opcode = _IORING_OP_POLL_ADD;
+      sqe->flags = _IOSQE_IO_LINK;
+      sqe->fd = state->fd;
+      sqe->poll_events = (s == io_operation_state_type::read_initiated) ? (POLLIN | POLLERR) : (POLLOUT | POLLERR);
+      sqe->user_data = (uint64_t)(uintptr_t) state | 1;
+    }
+    _io_uring_sqe *sqe = _next_sqe(r);
+    sqe->fd = state->fd;
+    sqe->user_data = (uint64_t)(uintptr_t) state;
+    switch(s)
+    {
+    case io_operation_state_type::read_initiated:
+    {
+      auto &reqs = state->payload.noncompleted.params.read.reqs;
+      const int buf_index = _fixed_buffer_index(state, reqs.buffers);
+      if(buf_index >= 0)
+      {
+        sqe->opcode = _IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t) reqs.buffers[0].data();
+        sqe->len = (uint32_t) reqs.buffers[0].size();
+        sqe->buf_index = (uint16_t) buf_index;
+      }
+      else
+      {
+        sqe->opcode = _IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t) reqs.buffers.data();
+        sqe->len = (uint32_t) reqs.buffers.size();
+      }
+      sqe->off = state->is_seekable ? reqs.offset : 0;
+      break;
+    }
+    case io_operation_state_type::write_initiated:
+    {
+      auto &reqs = state->payload.noncompleted.params.write.reqs;
+      const int buf_index = _fixed_buffer_index(state, reqs.buffers);
+      if(buf_index >= 0)
+      {
+        sqe->opcode = _IORING_OP_WRITE_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t) reqs.buffers[0].data();
+        sqe->len = (uint32_t) reqs.buffers[0].size();
+        sqe->buf_index = (uint16_t) buf_index;
+      }
+      else
+      {
+        sqe->opcode = _IORING_OP_WRITEV;
+        sqe->addr = (uint64_t)(uintptr_t) reqs.buffers.data();
+        sqe->len = (uint32_t) reqs.buffers.size();
+      }
+      if(state->is_seekable)
+      {
+        sqe->off = reqs.offset;
+      }
+      sqe->rw_flags = _rw_flags(reqs.flags);
+      break;
+    }
+    case io_operation_state_type::barrier_initiated:
+    {
+      auto &reqs = state->payload.noncompleted.params.barrier.reqs;
+      const auto kind = state->payload.noncompleted.params.barrier.kind;
+      extent_type bytes = 0;
+      // empty buffers means bytes = 0 which means sync entire file
+      for(const auto &req : reqs.buffers)
+      {
+        bytes += req.size();
+      }
+      if(kind <= barrier_kind::wait_data_only && bytes <= (uint32_t) -1)
+      {
+        // Linux has a lovely dedicated syscall giving us exactly what we need here
+        sqe->opcode = _IORING_OP_SYNC_FILE_RANGE;
+        sqe->off = reqs.offset;
+        sqe->len = (uint32_t) bytes;
+        sqe->sync_range_flags = SYNC_FILE_RANGE_WRITE;  // start writing all dirty pages in range now
+        if(kind == barrier_kind::wait_data_only)
+        {
+          sqe->sync_range_flags |= SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WAIT_AFTER;  // block until they're on storage
+        }
+      }
+      else
+      {
+        sqe->opcode = _IORING_OP_FSYNC;
+        sqe->fsync_flags = (kind <= barrier_kind::wait_data_only) ? _IORING_FSYNC_DATASYNC : 0;
+      }
+      break;
+    }
+    default:
+      abort();
+    }
+    _publish(r);
+    state->where = _where_t::kernel;
+    return true;
+  }
+  // Submits an initiated i/o to its ring, or queues it if the ring is full. Must be called with the multiplexer lock held.
+  void _submit_or_queue(_io_uring_operation_state *state) noexcept
+  {
+    auto &r = _ring_for(state);
+    // Preserve submission order if i/o is already waiting for room
+    if(!r.unsubmitted.empty() || !_write_sqes(r, state))
+    {
+      r.unsubmitted.push_back(state);
+      state->where = _where_t::ring_queue;
+    }
+  }
+  // Writes as much queued i/o into the rings as will fit, and submits it to the kernel
+  result<void> _flush(_ring_t &r) noexcept
+  {
+    while(!r.unsubmitted.empty())
+    {
+      auto *state = r.unsubmitted.first;
+      if(!_write_sqes(r, state))
+      {
+        break;
+      }
+      r.unsubmitted.remove(state);
+    }
+    return _enter(r);
+  }
+  result<void> _flush() noexcept
+  {
+    if(-1 != _polled.fd)
+    {
+      OUTCOME_TRY(_flush(_polled));
+    }
+    OUTCOME_TRY(_flush(_seekable));
+    return _flush(_nonseekable);
+  }
+  // Reaps completions from all rings. Must be called with the multiplexer lock held,
+  // which is released whilst visitors are invoked.
+  void _drain_all(_multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    if(_polled.inflight > 0)
+    {
+      // Polled completions only appear when asked for
+      LLFIO_TRACE_SYSCALL(this, "io_uring_enter(GETEVENTS)");
+      (void) _io_uring_enter(_polled.fd, 0, 0, _IORING_ENTER_GETEVENTS);
+      _drain(_polled, g, max_completions, stats);
+    }
+    _drain(_seekable, g, max_completions, stats);
+    _drain(_nonseekable, g, max_completions, stats);
+  }
+
+  // Submits and reaps completions without waiting. If `steal` is true, gives up immediately
+  // should another thread hold the lock. Sets `busy_poll` if any polled i/o is in flight.
+  result<void> _poll_rings(bool steal, size_t &max_completions, check_for_any_completed_io_statistics &stats, bool &busy_poll) noexcept
+  {
+    _multiplexer_lock_guard g(this->_lock, std::defer_lock);
+    if(!steal)
+    {
+      g.lock();
+    }
+    else if(!g.try_lock())
+    {
+      return success();
+    }
+    OUTCOME_TRY(_flush());
+    _drain_all(g, max_completions, stats);
+    if(!_deadlines.empty())
+    {
+      _expire(g, max_completions, stats);
+    }
+    OUTCOME_TRY(_flush());
+    busy_poll = busy_poll || _polled.inflight > 0;
+    return success();
+  }
+
+  // An i/o is leaving the multiplexer, so update per-handle bookkeeping and
+  // submit the next queued i/o for the handle, if any. Must be called with the multiplexer lock held.
+  void _retire(_io_uring_operation_state *state, bool is_read) noexcept
+  {
+    state->where = _where_t::nowhere;
+    _deadlines.disarm(state);
+    auto it = _find_fd(state->fd);
+    assert(it != _registered_fds.end());
+    if(it == _registered_fds.end())
+    {
+      return;
+    }
+    --it->outstanding;
+    if(state->is_seekable)
+    {
+      auto *inode = state->inode;
+      if(state->in_inode_incomplete)
+      {
+        inode->remove_incomplete(state);
+      }
+      // Submit any waiting i/o which no longer overlaps anything before it
+      for(auto *w = inode->waiting.first; w != nullptr;)
+      {
+        auto *next = w->next;
+        if(!inode->conflicts(w, w))
+        {
+          inode->waiting.remove(w);
+          w->where = _where_t::nowhere;
+          inode->add_incomplete(w);
+          _submit_or_queue(w);
+        }
+        w = next;
+      }
+      return;
+    }
+    auto &active = is_read ? it->active_read : it->active_write_or_barrier;
+    auto &queued = is_read ? it->queued_reads : it->queued_writes_or_barriers;
+    if(active == state)
+    {
+      active = queued.pop_front();
+      if(active != nullptr)
+      {
+        _submit_or_queue(active);
+      }
+    }
+  }
+
+  template <class BuffersType> static BuffersType _trim_buffers(BuffersType buffers, size_t bytes) noexcept
+  {
+    for(size_t i = 0; i < buffers.size(); i++)
+    {
+      auto &buffer = buffers[i];
+      if(buffer.size() <= bytes)
+      {
+        bytes -= buffer.size();
+      }
+      else
+      {
+        buffer = {buffer.data(), (size_type) bytes};
+        buffers = {buffers.data(), i + 1};
+        break;
+      }
+    }
+    return buffers;
+  }
+  // Completes and then immediately finishes an i/o with the io_uring result. Must be called WITHOUT
+  // the multiplexer lock held, as the visitor may initiate new i/o. The state may be destroyed on return.
+  static void _complete_and_finish(_io_uring_operation_state *state, int res) noexcept
+  {
+    switch(state->current_state())
+    {
+    case io_operation_state_type::read_initiated:
+    {
+      if(res < 0)
+      {
+        state->read_completed(io_result<buffers_type>(posix_error(-res)));
+      }
+      else
+      {
+        state->read_completed(io_result<buffers_type>(_trim_buffers(state->payload.noncompleted.params.read.reqs.buffers, (size_t) res)));
+      }
+      state->read_finished();
+      break;
+    }
+    case io_operation_state_type::write_initiated:
+    {
+      if(res < 0)
+      {
+        state->write_completed(io_result<const_buffers_type>(posix_error(-res)));
+      }
+      else
+      {
+        state->write_completed(io_result<const_buffers_type>(_trim_buffers(state->payload.noncompleted.params.write.reqs.buffers, (size_t) res)));
+      }
+      state->write_or_barrier_finished();
+      break;
+    }
+    case io_operation_state_type::barrier_initiated:
+    {
+      if(res < 0)
+      {
+        state->barrier_completed(io_result<const_buffers_type>(posix_error(-res)));
+      }
+      else
+      {
+        state->barrier_completed(io_result<const_buffers_type>(state->payload.noncompleted.params.barrier.reqs.buffers));
+      }
+      state->write_or_barrier_finished();
+      break;
+    }
+    default:
+      abort();
+    }
+  }
+
+  // Reaps up to max_completions completions from a ring. Must be called with the multiplexer lock held,
+  // which is released whilst visitors are invoked.
+  void _drain(_ring_t &r, _multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    size_t reaped = 0;
+    while(max_completions > 0)
+    {
+      const uint32_t head = *r.cq_head;
+      if(head == _io_uring_smp_load_acquire(r.cq_tail))
+      {
+        break;
+      }
+      _io_uring_cqe cqe = r.cqes[head & r.cq_mask];
+      // Release the completion slot before invoking anything, as recursion into this function is possible
+      _io_uring_smp_store_release(r.cq_head, head + 1);
+      --r.inflight;
+      if(cqe.user_data == 0 || (cqe.user_data & 1) != 0)
+      {
+        // Cancellation requests, and the poll linked before non-seekable i/o. A failed
+        // poll cancels the linked i/o, whose completion reports the failure.
+        continue;
+      }
+      auto *state = (_io_uring_operation_state *) (uintptr_t) cqe.user_data;
+      assert(state->where == _where_t::kernel);
+      if(-EAGAIN == cqe.res && !state->is_seekable)
+      {
+        if(!state->cancel_requested)
+        {
+          // Some other process drained the pipe between the poll and the i/o, so rearm
+          state->where = _where_t::nowhere;
+          _submit_or_queue(state);
+          continue;
+        }
+        cqe.res = -ECANCELED;
+      }
+      if(state->timed_out && (-ECANCELED == cqe.res || -EINTR == cqe.res))
+      {
+        cqe.res = -ETIMEDOUT;
+      }
+      this->_completion_stats.completed(stats, state->initiated_ns);
+      ++reaped;
+      _retire(state, state->current_state() == io_operation_state_type::read_initiated);
+      g.unlock();
+      _complete_and_finish(state, cqe.res);
+      g.lock();
+      ++stats.initiated_ios_finished;
+      --max_completions;
+    }
+    this->_completion_stats.reaped(stats, reaped);
+  }
+
+  /* Asks the kernel to cancel i/o submitted to it, whose cancelled completion will be reaped
+  as normal. Returns false if the cancellation could not be submitted for lack of room in
+  the rings, or because polled rings cannot cancel. Must be called with the multiplexer lock held.
+  */
+  bool _request_cancel(_io_uring_operation_state *state) noexcept
+  {
+    assert(state->where == _where_t::kernel);
+    auto &r = _ring_for(state);
+    const uint32_t count = state->is_poll_linked ? 2 : 1;
+    if(&r == &_polled || !_has_capacity(r, count))
+    {
+      return false;
+    }
+    state->cancel_requested = true;
+    _io_uring_sqe *sqe = _next_sqe(r);
+    sqe->opcode = _IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t) state;
+    if(state->is_poll_linked)
+    {
+      // Cancelling the poll cancels the linked i/o
+      sqe = _next_sqe(r);
+      sqe->opcode = _IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = (uint64_t)(uintptr_t) state | 1;
+    }
+    _publish(r);
+    return true;
+  }
+  // Removes initiated i/o from whichever multiplexer queue it waits in
+  void _dequeue(_io_uring_operation_state *state, bool is_read) noexcept
+  {
+    switch(state->where)
+    {
+    case _where_t::fd_queue:
+    {
+      auto it = _find_fd(state->fd);
+      (is_read ? it->queued_reads : it->queued_writes_or_barriers).remove(state);
+      break;
+    }
+    case _where_t::inode_queue:
+      state->inode->waiting.remove(state);
+      break;
+    case _where_t::ring_queue:
+      _ring_for(state).unsubmitted.remove(state);
+      break;
+    default:
+      abort();
+    }
+  }
+  /* Times out i/o whose deadline has passed. i/o not yet with the kernel is completed now,
+  i/o with the kernel is cancelled and completes when its cancellation is reaped. Must be
+  called with the multiplexer lock held, which is released whilst visitors are invoked.
+  */
+  void _expire(_multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    const auto now = std::chrono::steady_clock::now();
+    while(max_completions > 0)
+    {
+      auto *state = static_cast<_io_uring_operation_state *>(_deadlines.pop_expired(now));
+      if(state == nullptr)
+      {
+        return;
+      }
+      const bool is_read = (state->current_state() == io_operation_state_type::read_initiated);
+      if(state->where == _where_t::kernel)
+      {
+        if(!state->cancel_requested)
+        {
+          if(_request_cancel(state))
+          {
+            state->timed_out = true;
+          }
+          else if(&_ring_for(state) != &_polled)
+          {
+            // No room in the rings right now, so try again on the next tick
+            _deadlines.arm(state, now + io_multiplexer_timer_wheel::resolution(1));
+          }
+        }
+        continue;
+      }
+      _dequeue(state, is_read);
+      _retire(state, is_read);
+      this->_completion_stats.completed(stats, state->initiated_ns);
+      g.unlock();
+      _complete_and_finish(state, -ETIMEDOUT);
+      g.lock();
+      ++stats.initiated_ios_finished;
+      --max_completions;
+    }
+  }
+  // Shortens a sleep of `*tsp`, where null means forever, to end no later than `expiry`
+  static void _bound_sleep(struct timespec &ts, struct timespec *&tsp, std::chrono::steady_clock::time_point expiry) noexcept
+  {
+    if(expiry == (std::chrono::steady_clock::time_point::max)())
+    {
+      return;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(expiry - std::chrono::steady_clock::now()).count();
+    if(ns < 0)
+    {
+      ns = 0;
+    }
+    if(tsp == nullptr || ns < (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec)
+    {
+      ts.tv_sec = ns / 1000000000LL;
+      ts.tv_nsec = ns % 1000000000LL;
+      tsp = &ts;
+    }
+  }
+  // When this multiplexer next needs to time out i/o
+  std::chrono::steady_clock::time_point _next_expiry() noexcept
+  {
+    if(_deadlines.empty())
+    {
+      return (std::chrono::steady_clock::time_point::max)();
+    }
+    _multiplexer_lock_guard g(this->_lock);
+    return _deadlines.next_expiry();
+  }
+
+public:
+  constexpr linux_io_uring_multiplexer() {}
+  linux_io_uring_multiplexer(const linux_io_uring_multiplexer &) = delete;
+  linux_io_uring_multiplexer(linux_io_uring_multiplexer &&) = delete;
+  linux_io_uring_multiplexer &operator=(const linux_io_uring_multiplexer &) = delete;
+  linux_io_uring_multiplexer &operator=(linux_io_uring_multiplexer &&) = delete;
+  virtual ~linux_io_uring_multiplexer()
+  {
+    if(this->_v)
+    {
+      (void) linux_io_uring_multiplexer::close();
+    }
+    else
+    {
+      // init() failed part way through
+      (void) _close_ring(_seekable, true);
+      (void) _close_ring(_nonseekable, true);
+      (void) _close_ring(_polled, true);
+      if(-1 != _eventfd)
+      {
+        (void) ::close(_eventfd);
+      }
+    }
+  }
+  result<void> init(size_t threads, io_uring_multiplexer_flag flags)
+  {
+    (void) threads;
+    const uint32_t sqpoll = (flags & io_uring_multiplexer_flag::sqpoll) ? _IORING_SETUP_SQPOLL : 0;
+    // 256 submission entries is 16Kb of sqes per ring, and io_uring gives us twice that in
+    // completion entries, which is plenty given the per-handle queueing above.
+    OUTCOME_TRY(_init_ring(_seekable, 256, sqpoll));
+    OUTCOME_TRY(_init_ring(_nonseekable, 256));
+    if(flags & io_uring_multiplexer_flag::iopoll)
+    {
+      OUTCOME_TRY(_init_ring(_polled, 256, _IORING_SETUP_IOPOLL | sqpoll));
+      _has_polled_ring = true;
+    }
+    _eventfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(-1 == _eventfd)
+    {
+      return posix_error();
+    }
+    if(_io_uring_register(_seekable.fd, _IORING_REGISTER_EVENTFD, &_eventfd, 1) < 0)
+    {
+      return posix_error();
+    }
+    if(_io_uring_register(_nonseekable.fd, _IORING_REGISTER_EVENTFD, &_eventfd, 1) < 0)
+    {
+      return posix_error();
+    }
+    this->_v.fd = _nonseekable.fd;
+    this->_v.behaviour |= native_handle_type::disposition::multiplexer;
+    {
+      // Fixed buffers are an optimisation, so if the kernel can't do sparse tables, do without
+      _io_uring_rsrc_register reg;
+      memset(&reg, 0, sizeof(reg));
+      reg.nr = _fixed_buffer_slots;
+      reg.flags = _IORING_RSRC_REGISTER_SPARSE;
+      if(_io_uring_register(_seekable.fd, _IORING_REGISTER_BUFFERS2, &reg, sizeof(reg)) >= 0 &&
+         (-1 == _polled.fd || _io_uring_register(_polled.fd, _IORING_REGISTER_BUFFERS2, &reg, sizeof(reg)) >= 0))
+      {
+        _fixed_buffers = std::make_shared<_fixed_buffer_table>();
+        _fixed_buffers->ring_fd = _seekable.fd;
+        _fixed_buffers->polled_ring_fd = _polled.fd;
+        _fixed_buffers->used.resize(_fixed_buffer_slots);
+      }
+    }
+    return success();
+  }
+
+  // These functions are inherited from handle
+  virtual result<path_type> current_path() const noexcept override
+  {
+    // io_uring file descriptors have no path
+    return success();
+  }
+  virtual result<void> close() noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    if(_fixed_buffers)
+    {
+      // Fixed buffers still alive must no longer touch the ring
+      std::lock_guard<std::mutex> g(_fixed_buffers->lock);
+      _fixed_buffers->ring_fd = -1;
+      _fixed_buffers->polled_ring_fd = -1;
+    }
+    _fixed_buffers.reset();
+    OUTCOME_TRY(_close_ring(_seekable, true));
+    OUTCOME_TRY(_close_ring(_polled, true));
+    OUTCOME_TRY(_close_ring(_nonseekable, false));  // handle::close() closes this->_v.fd
+    if(-1 != _eventfd)
+    {
+      if(-1 == ::close(_eventfd))
+      {
+        return posix_error();
+      }
+      _eventfd = -1;
+    }
+    _registered_fds.clear();
+    _inodes.clear();
+#ifndef NDEBUG
+    if(this->_v)
+    {
+      // Tell handle::close() that we have correctly executed
+      this->_v.behaviour |= native_handle_type::disposition::_child_close_executed;
+    }
+#endif
+    return _base::close();
+  }
+
+  virtual result<uint8_t> do_io_handle_register(io_handle *h) noexcept override  // linear complexity to total handles registered
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    try
+    {
+      _multiplexer_lock_guard g(this->_lock);
+      const int fd = h->native_handle().fd;
+      auto it = std::lower_bound(_registered_fds.begin(), _registered_fds.end(), fd);
+      if(it != _registered_fds.end() && it->fd == fd)
+      {
+        return errc::device_or_resource_busy;
+      }
+      _inode_t *inode = nullptr;
+      if(h->is_seekable())
+      {
+        struct stat st;
+        if(-1 == ::fstat(fd, &st))
+        {
+          return posix_error();
+        }
+        const std::pair<dev_t, ino_t> key(st.st_dev, st.st_ino);
+        inode = &_inodes[key];
+        inode->key = key;
+        ++inode->handles;
+      }
+      it = _registered_fds.insert(it, _registered_fd(fd, h->is_seekable()));
+      it->inode = inode;
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  virtual result<void> do_io_handle_deregister(io_handle *h) noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    _multiplexer_lock_guard g(this->_lock);
+    auto it = _find_fd(h->native_handle().fd);
+    if(it == _registered_fds.end())
+    {
+      return errc::invalid_argument;
+    }
+    if(it->outstanding > 0)
+    {
+      return errc::operation_in_progress;
+    }
+    if(it->inode != nullptr && 0 == --it->inode->handles)
+    {
+      _inodes.erase(it->inode->key);
+    }
+    _registered_fds.erase(it);
+    return success();
+  }
+
+  virtual size_t do_io_handle_max_buffers(const io_handle * /*unused*/) const noexcept override { return IOV_MAX; }
+
+  virtual result<registered_buffer_type> do_io_handle_allocate_registered_buffer(io_handle *h, size_t &bytes) noexcept override
+  {
+    OUTCOME_TRY(auto &&backing, io_multiplexer::do_io_handle_allocate_registered_buffer(h, bytes));
+    if(!_fixed_buffers || !h->is_seekable() || backing->size() > (uint32_t) -1)
+    {
+      return std::move(backing);
+    }
+    try
+    {
+      auto p = std::make_unique<io_multiplexer::_registered_buffer_type>(span<byte>(backing->data(), backing->size()));
+      uint32_t index = 0;
+      {
+        std::lock_guard<std::mutex> g(_fixed_buffers->lock);
+        auto it = std::find(_fixed_buffers->used.begin(), _fixed_buffers->used.end(), false);
+        if(it == _fixed_buffers->used.end())
+        {
+          return std::move(backing);  // all slots in use
+        }
+        index = (uint32_t)(it - _fixed_buffers->used.begin());
+        struct iovec iov;
+        iov.iov_base = backing->data();
+        iov.iov_len = backing->size();
+        if(!_fixed_buffers->update(index, iov))
+        {
+          return std::move(backing);  // probably RLIMIT_MEMLOCK exceeded
+        }
+        *it = true;
+      }
+      // The deleter releases the slot, including if this throws
+      return registered_buffer_type(p.release(), _fixed_buffer_deleter{_fixed_buffers, std::move(backing), index});
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  // io_uring has very minimal i/o state requirements
+  virtual std::pair<size_t, size_t> io_state_requirements() noexcept override { return {sizeof(_io_uring_operation_state), alignof(_io_uring_operation_state)}; }
+
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_io_uring_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_io_uring_operation_state)) == 0);
+    if(storage.size() < sizeof(_io_uring_operation_state) || ((uintptr_t) storage.data() % alignof(_io_uring_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _io_uring_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_io_uring_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_io_uring_operation_state)) == 0);
+    if(storage.size() < sizeof(_io_uring_operation_state) || ((uintptr_t) storage.data() % alignof(_io_uring_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _io_uring_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs, barrier_kind kind) noexcept override
+  {
+    assert(storage.size() >= sizeof(_io_uring_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_io_uring_operation_state)) == 0);
+    if(storage.size() < sizeof(_io_uring_operation_state) || ((uintptr_t) storage.data() % alignof(_io_uring_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _io_uring_operation_state(_h, _visitor, std::move(b), d, std::move(reqs), kind);
+  }
+
+  // Moves an initialised i/o to initiated. Returns false if it was completed immediately instead.
+  bool _initiate(_io_uring_operation_state *state) noexcept
+  {
+    state->owner = this;
+    state->fd = state->h->native_handle().fd;
+    state->is_seekable = state->h->is_seekable();
+    if(state->is_seekable)
+    {
+      const auto caching = state->h->kernel_caching();
+      const bool is_direct = (caching == io_handle::caching::none || caching == io_handle::caching::only_metadata);
+      state->is_polled = _has_polled_ring && is_direct;
+      state->try_nowait = !is_direct && state->current_state() == io_operation_state_type::read_initialised;
+    }
+    auto range_of = [state](const auto &reqs) {
+      extent_type bytes = 0;
+      for(const auto &b : reqs.buffers)
+      {
+        bytes += b.size();
+      }
+      state->range_begin = reqs.offset;
+      state->range_end = reqs.offset + bytes;
+    };
+    switch(state->current_state())
+    {
+    case io_operation_state_type::read_initialised:
+      range_of(state->payload.noncompleted.params.read.reqs);
+      state->read_initiated();
+      break;
+    case io_operation_state_type::write_initialised:
+      range_of(state->payload.noncompleted.params.write.reqs);
+      if(state->payload.noncompleted.params.write.reqs.flags & io_multiplexer::write_flag::append)
+      {
+        // Where an append lands is unknown until it completes
+        state->range_begin = 0;
+        state->range_end = (extent_type) -1;
+      }
+      state->is_write_or_barrier = true;
+      state->write_initiated();
+      break;
+    case io_operation_state_type::barrier_initialised:
+      // Barriers fence all i/o upon the inode
+      state->range_begin = 0;
+      state->range_end = (extent_type) -1;
+      state->is_write_or_barrier = true;
+      if(!state->is_seekable)
+      {
+        // Barriers on pipes and sockets are a no-op, so complete them immediately
+        this->_completion_stats.completed_immediately();
+        state->barrier_completed(io_result<const_buffers_type>(const_buffers_type()));
+        state->write_or_barrier_finished();
+        return false;
+      }
+      state->barrier_initiated();
+      break;
+    default:
+      assert(false);
+      return false;
+    }
+    state->is_poll_linked = !state->is_seekable;
+    state->initiated_ns = this->_completion_stats.initiated();
+    return true;
+  }
+  /* Attempts a read without blocking, returning the bytes read if all of them were already in
+  the page cache, else -1. Must be called with the multiplexer lock held.
+  */
+  ssize_t _try_read_nowait(_io_uring_operation_state *state) noexcept
+  {
+    static constexpr int _RWF_NOWAIT = 0x00000008;
+    auto &reqs = state->payload.noncompleted.params.read.reqs;
+    if(_nowait_unsupported || reqs.buffers.size() > IOV_MAX)
+    {
+      return -1;
+    }
+#if defined(__NR_preadv2)
+    // The kernel takes the offset as two longs, the high half of which is ignored on 64 bit
+    const auto offset = static_cast<uint64_t>(reqs.offset);
+    const auto lo = static_cast<unsigned long>(offset);
+    const auto hi = (sizeof(unsigned long) < sizeof(uint64_t)) ? static_cast<unsigned long>(offset >> 32U) : 0UL;
+    const auto bytes = (ssize_t) syscall(__NR_preadv2, state->fd, reinterpret_cast<struct iovec *>(reqs.buffers.data()), (int) reqs.buffers.size(), lo, hi, _RWF_NOWAIT);
+    if(bytes < 0)
+    {
+      if(errno == EOPNOTSUPP || errno == ENOSYS || errno == EINVAL)
+      {
+        _nowait_unsupported = true;
+      }
+      return -1;
+    }
+    if((extent_type) bytes == state->range_end - state->range_begin)
+    {
+      return bytes;
+    }
+#else
+    (void) _RWF_NOWAIT;
+    _nowait_unsupported = true;
+#endif
+    return -1;
+  }
+  /* Queues or submits an initiated i/o. Must be called with the multiplexer lock held. Returns
+  -1, unless the i/o was a read which was completed immediately from the page cache, in which
+  case the bytes read are returned and the caller must call `_complete_and_finish()` after
+  releasing the lock.
+  */
+  ssize_t _enqueue(_io_uring_operation_state *state) noexcept
+  {
+    const ssize_t ret = _enqueue_impl(state);
+    if(ret < 0 && state->payload.noncompleted.d)
+    {
+      _deadlines.arm(state, io_multiplexer_timer_wheel::expiry(state->payload.noncompleted.d));
+    }
+    return ret;
+  }
+  ssize_t _enqueue_impl(_io_uring_operation_state *state) noexcept
+  {
+    const bool is_read = (state->current_state() == io_operation_state_type::read_initiated);
+    auto it = _find_fd(state->fd);
+    if(it == _registered_fds.end())
+    {
+      abort();  // i/o upon a handle not registered with this multiplexer
+    }
+    ++it->outstanding;
+    if(!state->is_seekable)
+    {
+      auto &active = is_read ? it->active_read : it->active_write_or_barrier;
+      if(active != nullptr)
+      {
+        (is_read ? it->queued_reads : it->queued_writes_or_barriers).push_back(state);
+        state->where = _where_t::fd_queue;
+        return -1;
+      }
+      active = state;
+    }
+    else
+    {
+      auto *inode = state->inode = it->inode;
+      if(inode->conflicts(state, nullptr))
+      {
+        inode->waiting.push_back(state);
+        state->where = _where_t::inode_queue;
+        return -1;
+      }
+      if(state->try_nowait)
+      {
+        const auto bytes = _try_read_nowait(state);
+        if(bytes >= 0)
+        {
+          state->inode = nullptr;
+          --it->outstanding;
+          this->_completion_stats.completed_immediately();
+          return bytes;
+        }
+      }
+      inode->add_incomplete(state);
+    }
+    _submit_or_queue(state);
+    return -1;
+  }
+
+  virtual io_operation_state_type init_io_operation(io_operation_state *_op) noexcept override
+  {
+    auto *state = static_cast<_io_uring_operation_state *>(_op);
+    if(!_initiate(state))
+    {
+      return io_operation_state_type::write_or_barrier_finished;
+    }
+    ssize_t bytes;
+    {
+      _multiplexer_lock_guard g(this->_lock);
+      bytes = _enqueue(state);
+    }
+    if(bytes >= 0)
+    {
+      _complete_and_finish(state, (int) bytes);
+      return io_operation_state_type::read_finished;
+    }
+    return state->current_state();
+  }
+
+  // Takes the multiplexer lock once per chunk rather than once per i/o, and enters the kernel once
+  virtual result<void> init_io_operations(span<io_operation_state *> states) noexcept override
+  {
+    // Visitors are invoked by initiation, so the multiplexer lock cannot be held during it
+    _io_uring_operation_state *chunk[64];
+    for(size_t idx = 0; idx < states.size();)
+    {
+      size_t count = 0;
+      for(; idx < states.size() && count < 64; idx++)
+      {
+        auto *state = static_cast<_io_uring_operation_state *>(states[idx]);
+        if(_initiate(state))
+        {
+          chunk[count++] = state;
+        }
+      }
+      // Reads completed immediately must be finished without the lock held
+      ssize_t immediate[64];
+      {
+        _multiplexer_lock_guard g(this->_lock);
+        for(size_t n = 0; n < count; n++)
+        {
+          immediate[n] = _enqueue(chunk[n]);
+        }
+      }
+      for(size_t n = 0; n < count; n++)
+      {
+        if(immediate[n] >= 0)
+        {
+          _complete_and_finish(chunk[n], (int) immediate[n]);
+        }
+      }
+    }
+    _multiplexer_lock_guard g(this->_lock);
+    return _flush();
+  }
+
+  // i/o is written into the submission rings by init_io_operation(). This tells the kernel about it.
+  virtual result<void> flush_inited_io_operations() noexcept override
+  {
+    _multiplexer_lock_guard g(this->_lock);
+    return _flush();
+  }
+
+  virtual io_operation_state_type check_io_operation(io_operation_state *_op) noexcept override
+  {
+    auto *state = static_cast<_io_uring_operation_state *>(_op);
+    auto s = state->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    check_for_any_completed_io_statistics stats;
+    size_t max_completions = (size_t) -1;
+    _multiplexer_lock_guard g(this->_lock);
+    (void) _flush();
+    _drain_all(g, max_completions, stats);
+    (void) _flush();
+    g.unlock();
+    return state->current_state();
+  }
+
+  virtual result<io_operation_state_type> cancel_io_operation(io_operation_state *_op, deadline d = {}) noexcept override
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    auto *state = static_cast<_io_uring_operation_state *>(_op);
+    _multiplexer_lock_guard g(this->_lock);
+    const auto s = state->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    const bool is_read = (s == io_operation_state_type::read_initiated);
+    switch(state->where)
+    {
+    case _where_t::nowhere:
+      break;
+    case _where_t::fd_queue:
+    case _where_t::inode_queue:
+    case _where_t::ring_queue:
+    {
+      // Never reached the kernel, so cancel it ourselves
+      _dequeue(state, is_read);
+      _retire(state, is_read);
+      this->_completion_stats.cancelled();
+      g.unlock();
+      _complete_and_finish(state, -ECANCELED);
+      return state->current_state();
+    }
+    case _where_t::kernel:
+    {
+      // Polled rings cannot cancel, but polled i/o never takes long anyway
+      if(!state->cancel_requested)
+      {
+        (void) _request_cancel(state);
+      }
+      OUTCOME_TRY(_flush());
+      break;
+    }
+    }
+    g.unlock();
+    // Pump completions until the cancelled i/o finishes
+    while(!is_finished(state->current_state()))
+    {
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      OUTCOME_TRY(check_for_any_completed_io(nd));
+      LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+    }
+    return state->current_state();
+  }
+
+  virtual result<check_for_any_completed_io_statistics> check_for_any_completed_io(deadline d = std::chrono::seconds(0), size_t max_completions = (size_t) -1) noexcept override
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    check_for_any_completed_io_statistics ret;
+    _multiplexer_lock_guard g(this->_lock);
+    for(;;)
+    {
+      OUTCOME_TRY(_flush());
+      _drain_all(g, max_completions, ret);
+      if(!_deadlines.empty())
+      {
+        _expire(g, max_completions, ret);
+        // Submit any cancellations of timed out i/o
+        OUTCOME_TRY(_flush());
+      }
+      if(ret.initiated_ios_completed + ret.initiated_ios_finished > 0 || max_completions == 0)
+      {
+        // Submit anything the visitors initiated
+        OUTCOME_TRY(_flush());
+        break;
+      }
+      // If another kernel thread woke me, exit the loop
+      if(_wakecount > 0)
+      {
+        --_wakecount;
+        break;
+      }
+      struct timespec ts;
+      memset(&ts, 0, sizeof(ts));
+      struct timespec *tsp = nullptr;
+      if(d)
+      {
+        std::chrono::nanoseconds ns(0);
+        if(d.steady)
+        {
+          if(d.nsecs != 0)
+          {
+            ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds(d.nsecs)) - std::chrono::steady_clock::now());
+          }
+        }
+        else
+        {
+          ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d.to_time_point() - std::chrono::system_clock::now());
+        }
+        if(ns.count() <= 0)
+        {
+          break;
+        }
+        ts.tv_sec = ns.count() / 1000000000LL;
+        ts.tv_nsec = ns.count() % 1000000000LL;
+        tsp = &ts;
+      }
+      if(!_deadlines.empty())
+      {
+        // Sleep no later than the next deadline of in flight i/o
+        _bound_sleep(ts, tsp, _deadlines.next_expiry());
+      }
+      if(_polled.inflight > 0)
+      {
+        // Polled completions are never signalled, so busy poll
+        memset(&ts, 0, sizeof(ts));
+        tsp = &ts;
+      }
+      g.unlock();
+      // Both rings signal the eventfd when a completion is posted
+      pollfd p;
+      memset(&p, 0, sizeof(p));
+      p.fd = _eventfd;
+      p.events = POLLIN;
+      int r;
+      {
+        LLFIO_TRACE_SYSCALL(this, "ppoll");
+        r = ::ppoll(&p, 1, tsp, nullptr);
+      }
+      if(r < 0 && EINTR != errno)
+      {
+        return posix_error();
+      }
+      if(r > 0)
+      {
+        uint64_t v;
+        (void) ::read(_eventfd, &v, sizeof(v));
+      }
+      g.lock();
+    }
+    this->_completion_stats.report(ret);
+    return ret;
+  }
+
+  virtual result<void> wake_check_for_any_completed_io() noexcept override
+  {
+    _multiplexer_lock_guard g(this->_lock);
+    ++_wakecount;
+    uint64_t v = 1;
+    if(-1 == ::write(_eventfd, &v, sizeof(v)) && EAGAIN != errno)
+    {
+      return posix_error();
+    }
+    return success();
+  }
+};
+
+/* Gives each thread its own complete linux_io_uring_multiplexer, called a shard here,
+so threads initiating i/o never contend on a lock, nor share submission and completion
+rings. Each thread is assigned a shard, round robin, the first time it calls into the
+multiplexer. Each i/o remembers the shard which initiated it, so it can be checked and
+cancelled from any thread.
+
+`check_for_any_completed_io()` first reaps the calling thread's own shard. If that yields
+nothing, the thread steals: it reaps any other shard whose lock it can take without
+waiting, so completions for a thread busy doing other work are not left sitting in its
+ring. Only then does the thread sleep, upon the eventfds of all shards, so it is woken
+by a completion posted to any of them.
+
+Every handle is registered with every shard. Per-inode overlap ordering and per-handle
+queueing for non-seekable handles apply per shard, so i/o initiated by different threads
+is not ordered with respect to each other, exactly as with concurrent syscalls from different
+threads. Registered buffers are registered with the allocating thread's shard as io_uring
+fixed buffers, and are only issued as fixed buffer i/o when used from threads sharing that shard.
+*/
+class linux_io_uring_per_thread_multiplexer final : public io_multiplexer_impl<true>
+{
+  using _base = io_multiplexer_impl<true>;
+  using _multiplexer_lock_guard = typename _base::_lock_guard;
+  using _shard_type = linux_io_uring_multiplexer<true>;
+  using _shard_operation_state = typename _shard_type::_io_uring_operation_state;
+
+  std::vector<std::unique_ptr<_shard_type>> _shards;  // immutable after init(), so readable without the lock
+  std::atomic<size_t> _next_shard{0};
+  int _eventfd{-1};  // kept in this->_v.fd
+  int _wakecount{0};
+
+  // A single entry cache per thread is enough, as threads rarely use more than one multiplexer
+  static const linux_io_uring_per_thread_multiplexer *&_thread_cached_multiplexer() noexcept
+  {
+    static LLFIO_THREAD_LOCAL const linux_io_uring_per_thread_multiplexer *v;
+    return v;
+  }
+  static size_t &_thread_cached_shard() noexcept
+  {
+    static LLFIO_THREAD_LOCAL size_t v;
+    return v;
+  }
+  size_t _this_thread_shard_index() noexcept
+  {
+    if(_thread_cached_multiplexer() != this)
+    {
+      _thread_cached_shard() = _next_shard.fetch_add(1, std::memory_order_relaxed);
+      _thread_cached_multiplexer() = this;
+    }
+    // A previous multiplexer at the same address may have had more shards
+    return _thread_cached_shard() % _shards.size();
+  }
+  _shard_type &_this_thread_shard() noexcept { return *_shards[_this_thread_shard_index()]; }
+
+public:
+  constexpr linux_io_uring_per_thread_multiplexer() {}
+  linux_io_uring_per_thread_multiplexer(const linux_io_uring_per_thread_multiplexer &) = delete;
+  linux_io_uring_per_thread_multiplexer(linux_io_uring_per_thread_multiplexer &&) = delete;
+  linux_io_uring_per_thread_multiplexer &operator=(const linux_io_uring_per_thread_multiplexer &) = delete;
+  linux_io_uring_per_thread_multiplexer &operator=(linux_io_uring_per_thread_multiplexer &&) = delete;
+  virtual ~linux_io_uring_per_thread_multiplexer()
+  {
+    if(this->_v)
+    {
+      (void) linux_io_uring_per_thread_multiplexer::close();
+    }
+    else if(-1 != _eventfd)
+    {
+      // init() failed part way through, the shards clean up after themselves
+      (void) ::close(_eventfd);
+    }
+  }
+  result<void> init(size_t threads, io_uring_multiplexer_flag flags)
+  {
+    _eventfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(-1 == _eventfd)
+    {
+      return posix_error();
+    }
+    _shards.reserve(threads);
+    for(size_t n = 0; n < threads; n++)
+    {
+      auto shard = std::make_unique<_shard_type>();
+      OUTCOME_TRY(shard->init(threads, flags));
+      _shards.push_back(std::move(shard));
+    }
+    this->_v.fd = _eventfd;
+    this->_v.behaviour |= native_handle_type::disposition::multiplexer;
+    return success();
+  }
+
+  // These functions are inherited from handle
+  virtual result<path_type> current_path() const noexcept override
+  {
+    // io_uring file descriptors have no path
+    return success();
+  }
+  virtual result<void> close() noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    for(auto &shard : _shards)
+    {
+      OUTCOME_TRY(shard->close());
+    }
+    _shards.clear();
+    _eventfd = -1;  // handle::close() closes this->_v.fd
+#ifndef NDEBUG
+    if(this->_v)
+    {
+      // Tell handle::close() that we have correctly executed
+      this->_v.behaviour |= native_handle_type::disposition::_child_close_executed;
+    }
+#endif
+    return _base::close();
+  }
+
+  virtual result<uint8_t> do_io_handle_register(io_handle *h) noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    for(size_t n = 0; n < _shards.size(); n++)
+    {
+      auto r = _shards[n]->do_io_handle_register(h);
+      if(!r)
+      {
+        while(n > 0)
+        {
+          (void) _shards[--n]->do_io_handle_deregister(h);
+        }
+        return std::move(r).error();
+      }
+    }
+    return success();
+  }
+  virtual result<void> do_io_handle_deregister(io_handle *h) noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    for(size_t n = 0; n < _shards.size(); n++)
+    {
+      auto r = _shards[n]->do_io_handle_deregister(h);
+      if(!r)
+      {
+        // Most likely i/o is in progress in this shard, so leave the handle registered everywhere
+        while(n > 0)
+        {
+          (void) _shards[--n]->do_io_handle_register(h);
+        }
+        return std::move(r).error();
+      }
+    }
+    return success();
+  }
+
+  virtual size_t do_io_handle_max_buffers(const io_handle *h) const noexcept override { return _shards.front()->do_io_handle_max_buffers(h); }
+
+  virtual result<registered_buffer_type> do_io_handle_allocate_registered_buffer(io_handle *h, size_t &bytes) noexcept override
+  {
+    return _this_thread_shard().do_io_handle_allocate_registered_buffer(h, bytes);
+  }
+
+  // All shards construct the same state type, so any shard can construct
+  virtual std::pair<size_t, size_t> io_state_requirements() noexcept override { return _shards.front()->io_state_requirements(); }
+
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<buffers_type> reqs) noexcept override
+  {
+    return _shards.front()->construct(storage, _h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs) noexcept override
+  {
+    return _shards.front()->construct(storage, _h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs, barrier_kind kind) noexcept override
+  {
+    return _shards.front()->construct(storage, _h, _visitor, std::move(b), d, std::move(reqs), kind);
+  }
+
+  virtual io_operation_state_type init_io_operation(io_operation_state *op) noexcept override { return _this_thread_shard().init_io_operation(op); }
+
+  virtual result<void> init_io_operations(span<io_operation_state *> states) noexcept override { return _this_thread_shard().init_io_operations(states); }
+
+  virtual result<void> flush_inited_io_operations() noexcept override { return _this_thread_shard().flush_inited_io_operations(); }
+
+  virtual io_operation_state_type check_io_operation(io_operation_state *op) noexcept override
+  {
+    auto *state = static_cast<_shard_operation_state *>(op);
+    auto s = state->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    return state->owner->check_io_operation(op);
+  }
+
+  virtual result<io_operation_state_type> cancel_io_operation(io_operation_state *op, deadline d = {}) noexcept override
+  {
+    auto *state = static_cast<_shard_operation_state *>(op);
+    auto s = state->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    return state->owner->cancel_io_operation(op, d);
+  }
+
+  virtual result<check_for_any_completed_io_statistics> check_for_any_completed_io(deadline d = std::chrono::seconds(0), size_t max_completions = (size_t) -1) noexcept override
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    check_for_any_completed_io_statistics ret;
+    const size_t mine = _this_thread_shard_index();
+    auto *fds = (pollfd *) alloca((_shards.size() + 1) * sizeof(pollfd));
+    for(;;)
+    {
+      bool busy_poll = false;
+      for(size_t n = 0; n < _shards.size() && max_completions > 0; n++)
+      {
+        // Wait for my own shard's lock, but never for another's
+        OUTCOME_TRY(_shards[(mine + n) % _shards.size()]->_poll_rings(n != 0, max_completions, ret, busy_poll));
+        if(ret.initiated_ios_completed + ret.initiated_ios_finished > 0)
+        {
+          break;
+        }
+      }
+      if(ret.initiated_ios_completed + ret.initiated_ios_finished > 0 || max_completions == 0)
+      {
+        break;
+      }
+      {
+        // If another kernel thread woke me, exit the loop
+        _multiplexer_lock_guard g(this->_lock);
+        if(_wakecount > 0)
+        {
+          --_wakecount;
+          break;
+        }
+      }
+      struct timespec ts;
+      memset(&ts, 0, sizeof(ts));
+      struct timespec *tsp = nullptr;
+      if(d)
+      {
+        std::chrono::nanoseconds ns(0);
+        if(d.steady)
+        {
+          if(d.nsecs != 0)
+          {
+            ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds(d.nsecs)) - std::chrono::steady_clock::now());
+          }
+        }
+        else
+        {
+          ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d.to_time_point() - std::chrono::system_clock::now());
+        }
+        if(ns.count() <= 0)
+        {
+          break;
+        }
+        ts.tv_sec = ns.count() / 1000000000LL;
+        ts.tv_nsec = ns.count() % 1000000000LL;
+        tsp = &ts;
+      }
+      for(auto &shard : _shards)
+      {
+        // Sleep no later than the next deadline of in flight i/o in any shard
+        _shard_type::_bound_sleep(ts, tsp, shard->_next_expiry());
+      }
+      if(busy_poll)
+      {
+        // Polled completions are never signalled, so busy poll
+        memset(&ts, 0, sizeof(ts));
+        tsp = &ts;
+      }
+      // Sleep until a completion is posted to any shard, or I am woken
+      memset(fds, 0, (_shards.size() + 1) * sizeof(pollfd));
+      fds[0].fd = _eventfd;
+      fds[0].events = POLLIN;
+      for(size_t n = 0; n < _shards.size(); n++)
+      {
+        fds[n + 1].fd = _shards[n]->_eventfd;
+        fds[n + 1].events = POLLIN;
+      }
+      int r;
+      {
+        LLFIO_TRACE_SYSCALL(this, "ppoll");
+        r = ::ppoll(fds, _shards.size() + 1, tsp, nullptr);
+      }
+      if(r < 0 && EINTR != errno)
+      {
+        return posix_error();
+      }
+      for(size_t n = 0; r > 0 && n <= _shards.size(); n++)
+      {
+        if(fds[n].revents & POLLIN)
+        {
+          uint64_t v;
+          (void) ::read(fds[n].fd, &v, sizeof(v));
+        }
+      }
+    }
+    for(auto &shard : _shards)
+    {
+      shard->_completion_stats.report(ret);
+    }
+    return ret;
+  }
+
+  virtual result<void> wake_check_for_any_completed_io() noexcept override
+  {
+    _multiplexer_lock_guard g(this->_lock);
+    ++_wakecount;
+    uint64_t v = 1;
+    if(-1 == ::write(_eventfd, &v, sizeof(v)) && EAGAIN != errno)
+    {
+      return posix_error();
+    }
+    return success();
+  }
+};
+
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_linux_io_uring(size_t threads, io_uring_multiplexer_flag flags) noexcept
+{
+  try
+  {
+    if(threads > 1 && (flags & io_uring_multiplexer_flag::per_thread_rings))
+    {
+      auto ret = std::make_unique<linux_io_uring_per_thread_multiplexer>();
+      OUTCOME_TRY(ret->init(threads, flags));
+      return io_multiplexer_ptr(ret.release());
+    }
+    if(1 == threads)
+    {
+      auto ret = std::make_unique<linux_io_uring_multiplexer<false>>();
+      OUTCOME_TRY(ret->init(1, flags));
+      return io_multiplexer_ptr(ret.release());
+    }
+    auto ret = std::make_unique<linux_io_uring_multiplexer<true>>();
+    OUTCOME_TRY(ret->init(threads, flags));
+    return io_multiplexer_ptr(ret.release());
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_V2_NAMESPACE_END
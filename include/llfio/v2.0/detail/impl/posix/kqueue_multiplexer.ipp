@@ -0,0 +1,1369 @@
+/* Multiplex file i/o
+(C) 2020 Niall Douglas <http://www.nedproductions.biz/> (9 commits)
+File Created: May 2019
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../../io_handle.hpp"
+
+#if !LLFIO_INCLUDED_BY_HEADER || !defined(LLFIO_IO_HANDLE_H)
+#error This file should never be included directly
+#endif
+
+#if !defined(__FreeBSD__) && !defined(__APPLE__)
+#error This implementation file is for FreeBSD and Mac OS only
+#endif
+
+#include <algorithm>
+#include <climits>  // for IOV_MAX
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/event.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __FreeBSD__
+#include <aio.h>
+#endif
+
+#include "quickcpplib/signal_guard.hpp"
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+/* kqueue can report both readiness and completion, so this i/o multiplexer is a hybrid:
+
+- Non-seekable handles (pipes, sockets etc) are registered edge triggered with EVFILT_READ
+and EVFILT_WRITE. i/o upon them is attempted immediately using non-blocking `readv()`/`writev()`,
+and if the kernel would block, queued per handle in the order initiated until the handle
+becomes ready. Barriers upon them are a no-op. As each edge is reported only once, a handle
+whose queued i/o may still be ready when `max_completions` runs out is remembered in a list of
+ready handles, which the next `check_for_any_completed_io()` retries before waiting upon the kernel.
+
+- On FreeBSD, i/o upon seekable handles is submitted using POSIX AIO with `SIGEV_KEVENT`, so
+completions are reported via EVFILT_AIO. If AIO refuses the i/o (e.g. the `aio` module is
+not loaded, or the filing system is not AIO safe), the i/o is handed to a worker pool.
+
+- Mac OS cannot deliver AIO completions to a kqueue, so there i/o upon seekable
+handles is always handed to a worker pool.
+
+- Each device has its own elastic pool of worker threads, which perform the i/o using
+blocking syscalls, so a stalled device (e.g. an unreachable NFS server) cannot starve
+i/o to any other device of workers. A worker is started whenever i/o is handed to a
+pool with more i/o waiting than idle workers, up to the maximum, and a worker exits once
+it has been idle for `_worker_idle_timeout`. Workers queue their completions and trigger a
+second EVFILT_USER event, and the completions are then reaped by `check_for_any_completed_io()`
+like any other. If no worker can be started, the i/o is performed synchronously.
+
+- i/o with a deadline is armed in a timer wheel from initiation until it completes. kevent()
+sleeps no later than the wheel next needs advancing. i/o whose deadline has passed is dequeued
+and completed with `ETIMEDOUT` if it is queued for readiness, or waiting for a worker. AIO whose
+deadline has passed is cancelled using `aio_cancel()`, and if that succeeds its completion reports
+`ETIMEDOUT`. i/o which a worker has already begun cannot be interrupted, so runs to completion.
+
+- An EVFILT_USER event lets `wake_check_for_any_completed_io()` interrupt another
+thread blocked in `check_for_any_completed_io()`.
+*/
+template <bool is_threadsafe> class bsd_kqueue_multiplexer final : public io_multiplexer_impl<is_threadsafe>
+{
+  using _base = io_multiplexer_impl<is_threadsafe>;
+  using _multiplexer_lock_guard = typename _base::_lock_guard;
+
+  using path_type = typename _base::path_type;
+  using extent_type = typename _base::extent_type;
+  using size_type = typename _base::size_type;
+  using mode = typename _base::mode;
+  using creation = typename _base::creation;
+  using caching = typename _base::caching;
+  using flag = typename _base::flag;
+  using barrier_kind = typename _base::barrier_kind;
+  using const_buffers_type = typename _base::const_buffers_type;
+  using buffers_type = typename _base::buffers_type;
+  using registered_buffer_type = typename _base::registered_buffer_type;
+  template <class T> using io_request = typename _base::template io_request<T>;
+  template <class T> using io_result = typename _base::template io_result<T>;
+  using io_operation_state = typename _base::io_operation_state;
+  using io_operation_state_visitor = typename _base::io_operation_state_visitor;
+  using check_for_any_completed_io_statistics = typename _base::check_for_any_completed_io_statistics;
+
+  // The ident of the EVFILT_USER event used for waking
+  static constexpr uintptr_t _wake_ident = 0;
+  // The ident of the EVFILT_USER event triggered by workers when they have queued completions
+  static constexpr uintptr_t _workers_ident = 1;
+  // How long a worker stays idle before exiting
+  static constexpr std::chrono::seconds _worker_idle_timeout{5};
+
+  struct _worker_pool;
+
+  struct _kqueue_operation_state final
+      : public std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>,
+        public io_multiplexer_timer_wheel::node  // armed whilst initiated if it has a deadline, guarded by the multiplexer lock
+  {
+    using _impl = std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>;
+
+    _kqueue_operation_state *prev{nullptr}, *next{nullptr};
+    // Cached here from the handle for performance
+    int fd{-1};
+    bool is_seekable{false};
+    bool is_queued{false};
+    uint64_t initiated_ns{0};  // when initiated, for check_for_any_completed_io_statistics
+    // The pool whose workers have yet to take this i/o, guarded by _workers_lock
+    _worker_pool *pool{nullptr};
+    // Whether this i/o is with a worker pool, or awaiting being reaped from one
+    bool with_worker{false};
+    ssize_t worker_result{0};
+#ifdef __FreeBSD__
+    bool in_kernel{false};
+    bool timed_out{false};  // cancelled because its deadline passed
+    struct aiocb aiocb;
+#endif
+
+    _kqueue_operation_state() = default;
+    // Construct implicitly from the base implementation, see relocate_to()
+    explicit _kqueue_operation_state(_impl &&o) noexcept
+        : _impl(std::move(o))
+    {
+    }
+    using _impl::_impl;
+
+    // You will need to reimplement this to relocate any custom state defined
+    // here, and to restamp to vptr with this finalised dynamic type. It is
+    // important to do this, as final-based optimisations compare the vptr
+    // to the finalised vptr and do non-indirect dispatch if they match.
+    virtual io_operation_state *relocate_to(byte *to_) noexcept override
+    {
+      assert(!is_queued);
+      assert(!with_worker);  // a worker holds a pointer to the state
+#ifdef __FreeBSD__
+      assert(!in_kernel);  // the kernel holds a pointer to the aiocb
+#endif
+      auto *to = _impl::relocate_to(to_);
+      // restamp the vptr with my own
+      auto _to = new(to) _kqueue_operation_state(std::move(*static_cast<_impl *>(to)));
+      _to->fd = fd;
+      _to->is_seekable = is_seekable;
+      return _to;
+    }
+  };
+
+  struct _queue_t
+  {
+    _kqueue_operation_state *first{nullptr}, *last{nullptr};
+
+    bool empty() const noexcept { return first == nullptr; }
+    void push_back(_kqueue_operation_state *state) noexcept
+    {
+      assert(state->prev == nullptr);
+      assert(state->next == nullptr);
+      assert(first != state);
+      assert(last != state);
+      if(first == nullptr)
+      {
+        first = last = state;
+      }
+      else
+      {
+        assert(last->next == nullptr);
+        state->prev = last;
+        last->next = state;
+        last = state;
+      }
+      state->is_queued = true;
+    }
+    void remove(_kqueue_operation_state *state) noexcept
+    {
+      if(state->prev == nullptr)
+      {
+        assert(first == state);
+        first = state->next;
+      }
+      else
+      {
+        state->prev->next = state->next;
+      }
+      if(state->next == nullptr)
+      {
+        assert(last == state);
+        last = state->prev;
+      }
+      else
+      {
+        state->next->prev = state->prev;
+      }
+      state->next = state->prev = nullptr;
+      state->is_queued = false;
+    }
+  };
+
+  struct _worker_t
+  {
+    std::thread thread;
+    bool exited{false};  // guarded by _workers_lock
+  };
+  // Everything here except `device` is guarded by _workers_lock
+  struct _worker_pool
+  {
+    dev_t device;
+    // i/o waiting for a worker
+    _queue_t pending;
+    size_t pending_count{0}, idle{0}, running{0};
+    // Signalled when i/o is queued, or upon close
+    std::condition_variable cond;
+    std::list<_worker_t> workers;
+
+    explicit _worker_pool(dev_t _device)
+        : device(_device)
+    {
+    }
+  };
+
+  struct _registered_fd
+  {
+    int fd{-1};
+    bool is_seekable{false};
+    // The worker pool for the device of a seekable handle
+    _worker_pool *pool{nullptr};
+    // Seekable i/o currently with the kernel or a worker pool
+    size_t in_kernel{0};
+    // Non-seekable i/o waiting for the handle to become ready
+    _queue_t queued_reads, queued_writes;
+    // Set if an edge was seen whose queued i/o was not retried until EAGAIN, and if in _ready_fds
+    bool read_ready{false}, write_ready{false}, in_ready_fds{false};
+
+    constexpr _registered_fd() {}
+    _registered_fd(int _fd, bool _is_seekable)
+        : fd(_fd)
+        , is_seekable(_is_seekable)
+    {
+    }
+    bool operator<(int o) const noexcept { return fd < o; }
+  };
+
+  int _wakecount{0};
+  // Zero means seekable i/o which cannot be issued asynchronously is performed synchronously
+  size_t _max_workers_per_device{0};
+  /* Always locked, even by a non-threadsafe multiplexer, as workers run concurrently with
+  the multiplexer's users. Never taken before the multiplexer lock.
+  */
+  std::mutex _workers_lock;
+  bool _workers_stopping{false};
+  // Completions queued by workers for reaping
+  _queue_t _worker_completions;
+  // Guarded by the multiplexer lock, but never erased before close
+  std::vector<std::unique_ptr<_worker_pool>> _worker_pools;
+  // Kept sorted by fd. kqueue reports the fd for readiness, not a pointer, as the entry may be
+  // deregistered by another thread between kevent() returning and us taking the lock.
+  std::vector<_registered_fd> _registered_fds;
+  // Handles with queued i/o known to be ready, oldest first. Capacity is reserved for every
+  // registered handle, so appending never allocates.
+  std::vector<int> _ready_fds;
+  io_multiplexer_timer_wheel _deadlines;
+
+  typename std::vector<_registered_fd>::iterator _find_fd(int fd) noexcept
+  {
+    auto it = std::lower_bound(_registered_fds.begin(), _registered_fds.end(), fd);
+    if(it == _registered_fds.end() || it->fd != fd)
+    {
+      return _registered_fds.end();
+    }
+    return it;
+  }
+
+  // Performs one non-blocking attempt at non-seekable i/o, returning bytes transferred or -errno
+  static ssize_t _attempt(_kqueue_operation_state *state, bool is_read) noexcept
+  {
+    ssize_t ret;
+    if(is_read)
+    {
+      auto &reqs = state->payload.noncompleted.params.read.reqs;
+      ret = ::readv(state->fd, reinterpret_cast<struct iovec *>(reqs.buffers.data()), (int) reqs.buffers.size());
+    }
+    else
+    {
+      auto &reqs = state->payload.noncompleted.params.write.reqs;
+      auto *iov = reinterpret_cast<struct iovec *>(const_cast<typename const_buffers_type::value_type *>(reqs.buffers.data()));
+      // Can't guarantee that user code hasn't enabled SIGPIPE
+      ret = QUICKCPPLIB_NAMESPACE::signal_guard::signal_guard(
+      QUICKCPPLIB_NAMESPACE::signal_guard::signalc_set::broken_pipe, [&] { return ::writev(state->fd, iov, (int) reqs.buffers.size()); },
+      [&](const QUICKCPPLIB_NAMESPACE::signal_guard::raised_signal_info * /*unused*/) {
+        errno = EPIPE;
+        return (ssize_t) -1;
+      });
+    }
+    if(ret < 0)
+    {
+      return (EWOULDBLOCK == errno) ? -EAGAIN : -errno;
+    }
+    return ret;
+  }
+
+  // Performs seekable i/o synchronously, returning bytes transferred or -errno
+  static ssize_t _sync_io(_kqueue_operation_state *state) noexcept
+  {
+    ssize_t ret = 0;
+    switch(state->current_state())
+    {
+    case io_operation_state_type::read_initialised:
+    case io_operation_state_type::read_initiated:
+    {
+      auto &reqs = state->payload.noncompleted.params.read.reqs;
+      ret = ::preadv(state->fd, reinterpret_cast<struct iovec *>(reqs.buffers.data()), (int) reqs.buffers.size(), reqs.offset);
+      break;
+    }
+    case io_operation_state_type::write_initialised:
+    case io_operation_state_type::write_initiated:
+    {
+      auto &reqs = state->payload.noncompleted.params.write.reqs;
+      ret = ::pwritev(state->fd, reinterpret_cast<struct iovec *>(const_cast<typename const_buffers_type::value_type *>(reqs.buffers.data())),
+                      (int) reqs.buffers.size(), reqs.offset);
+      break;
+    }
+    case io_operation_state_type::barrier_initialised:
+    case io_operation_state_type::barrier_initiated:
+    {
+      const auto kind = state->payload.noncompleted.params.barrier.kind;
+#ifdef __APPLE__
+      // Mac OS fsync() does not flush the device's write cache, F_FULLFSYNC does
+      ret = (kind == barrier_kind::wait_all) ? ::fcntl(state->fd, F_FULLFSYNC) : ::fsync(state->fd);
+#else
+      ret = (kind <= barrier_kind::wait_data_only) ? ::fdatasync(state->fd) : ::fsync(state->fd);
+#endif
+      break;
+    }
+    default:
+      abort();
+    }
+    return (ret < 0) ? -errno : ret;
+  }
+
+#ifdef __FreeBSD__
+  // Submits seekable i/o to POSIX AIO. Returns zero on success, or -errno.
+  int _aio_submit(_kqueue_operation_state *state) noexcept
+  {
+    auto &cb = state->aiocb;
+    memset(&cb, 0, sizeof(cb));
+    cb.aio_fildes = state->fd;
+    cb.aio_sigevent.sigev_notify = SIGEV_KEVENT;
+    cb.aio_sigevent.sigev_notify_kqueue = this->_v.fd;
+    cb.aio_sigevent.sigev_value.sival_ptr = state;
+    int ret = -1;
+    switch(state->current_state())
+    {
+    case io_operation_state_type::read_initialised:
+    {
+      auto &reqs = state->payload.noncompleted.params.read.reqs;
+      cb.aio_offset = reqs.offset;
+      cb.aio_iov = reinterpret_cast<struct iovec *>(reqs.buffers.data());
+      cb.aio_iovcnt = (int) reqs.buffers.size();
+      ret = ::aio_readv(&cb);
+      break;
+    }
+    case io_operation_state_type::write_initialised:
+    {
+      auto &reqs = state->payload.noncompleted.params.write.reqs;
+      cb.aio_offset = reqs.offset;
+      cb.aio_iov = reinterpret_cast<struct iovec *>(const_cast<typename const_buffers_type::value_type *>(reqs.buffers.data()));
+      cb.aio_iovcnt = (int) reqs.buffers.size();
+      ret = ::aio_writev(&cb);
+      break;
+    }
+    case io_operation_state_type::barrier_initialised:
+    {
+      const auto kind = state->payload.noncompleted.params.barrier.kind;
+      ret = ::aio_fsync((kind <= barrier_kind::wait_data_only) ? O_DSYNC : O_SYNC, &cb);
+      break;
+    }
+    default:
+      abort();
+    }
+    return (ret < 0) ? -errno : 0;
+  }
+#endif
+
+  template <class BuffersType> static BuffersType _trim_buffers(BuffersType buffers, size_t bytes) noexcept
+  {
+    for(size_t i = 0; i < buffers.size(); i++)
+    {
+      auto &buffer = buffers[i];
+      if(buffer.size() <= bytes)
+      {
+        bytes -= buffer.size();
+      }
+      else
+      {
+        buffer = {buffer.data(), (size_type) bytes};
+        buffers = {buffers.data(), i + 1};
+        break;
+      }
+    }
+    return buffers;
+  }
+  // Completes and then immediately finishes an i/o. Must be called WITHOUT the multiplexer
+  // lock held, as the visitor may initiate new i/o. The state may be destroyed on return.
+  static void _complete_and_finish(_kqueue_operation_state *state, ssize_t res) noexcept
+  {
+    switch(state->current_state())
+    {
+    case io_operation_state_type::read_initialised:
+    case io_operation_state_type::read_initiated:
+    {
+      if(res < 0)
+      {
+        state->read_completed(io_result<buffers_type>(posix_error((int) -res)));
+      }
+      else
+      {
+        state->read_completed(io_result<buffers_type>(_trim_buffers(state->payload.noncompleted.params.read.reqs.buffers, (size_t) res)));
+      }
+      state->read_finished();
+      break;
+    }
+    case io_operation_state_type::write_initialised:
+    case io_operation_state_type::write_initiated:
+    {
+      if(res < 0)
+      {
+        state->write_completed(io_result<const_buffers_type>(posix_error((int) -res)));
+      }
+      else
+      {
+        state->write_completed(io_result<const_buffers_type>(_trim_buffers(state->payload.noncompleted.params.write.reqs.buffers, (size_t) res)));
+      }
+      state->write_or_barrier_finished();
+      break;
+    }
+    case io_operation_state_type::barrier_initialised:
+    case io_operation_state_type::barrier_initiated:
+    {
+      if(res < 0)
+      {
+        state->barrier_completed(io_result<const_buffers_type>(posix_error((int) -res)));
+      }
+      else
+      {
+        state->barrier_completed(io_result<const_buffers_type>(state->payload.noncompleted.params.barrier.reqs.buffers));
+      }
+      state->write_or_barrier_finished();
+      break;
+    }
+    default:
+      abort();
+    }
+  }
+
+  static io_operation_state_type _finished_state_for(io_operation_state_type s) noexcept
+  {
+    return (s == io_operation_state_type::read_initialised || s == io_operation_state_type::read_initiated) ? io_operation_state_type::read_finished :
+                                                                                                            io_operation_state_type::write_or_barrier_finished;
+  }
+
+  // Must be called with _workers_lock held
+  void _trigger_workers_event() noexcept
+  {
+    struct kevent ev;
+    EV_SET(&ev, _workers_ident, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+    (void) ::kevent(this->_v.fd, &ev, 1, nullptr, 0, nullptr);
+  }
+
+  void _worker_run(_worker_pool *pool, _worker_t *self) noexcept
+  {
+    std::unique_lock<std::mutex> g(_workers_lock);
+    for(;;)
+    {
+      auto *state = pool->pending.first;
+      if(state == nullptr)
+      {
+        if(_workers_stopping)
+        {
+          break;
+        }
+        ++pool->idle;
+        const auto status = pool->cond.wait_for(g, _worker_idle_timeout);
+        --pool->idle;
+        if(std::cv_status::timeout == status && pool->pending.empty())
+        {
+          break;
+        }
+        continue;
+      }
+      pool->pending.remove(state);
+      pool->pending_count--;
+      state->pool = nullptr;
+      g.unlock();
+      state->worker_result = _sync_io(state);
+      g.lock();
+      const bool was_empty = _worker_completions.empty();
+      _worker_completions.push_back(state);
+      if(was_empty)
+      {
+        _trigger_workers_event();
+      }
+    }
+    pool->running--;
+    self->exited = true;
+  }
+
+  /* Hands initiated seekable i/o to a worker pool, starting a worker if there is more i/o waiting
+  than idle workers. Returns false if there are no workers, and none could be started.
+  */
+  bool _worker_submit(_worker_pool *pool, _kqueue_operation_state *state) noexcept
+  {
+    std::unique_lock<std::mutex> g(_workers_lock);
+    for(auto it = pool->workers.begin(); it != pool->workers.end();)
+    {
+      if(it->exited)
+      {
+        // It has left _worker_run(), as we hold the lock it released
+        it->thread.join();
+        it = pool->workers.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+    if(pool->pending_count >= pool->idle && pool->running < _max_workers_per_device)
+    {
+      try
+      {
+        pool->workers.emplace_back();
+        auto *w = &pool->workers.back();
+        try
+        {
+          w->thread = std::thread([this, pool, w] { _worker_run(pool, w); });
+          pool->running++;
+        }
+        catch(...)
+        {
+          pool->workers.pop_back();
+        }
+      }
+      catch(...)
+      {
+      }
+    }
+    if(pool->running == 0)
+    {
+      return false;
+    }
+    state->with_worker = true;
+    state->pool = pool;
+    pool->pending.push_back(state);
+    pool->pending_count++;
+    pool->cond.notify_one();
+    return true;
+  }
+
+  // Sets workers to exit once they have drained their pools, and waits for them to do so
+  void _stop_workers() noexcept
+  {
+    {
+      std::lock_guard<std::mutex> g(_workers_lock);
+      _workers_stopping = true;
+      for(auto &pool : _worker_pools)
+      {
+        pool->cond.notify_all();
+      }
+    }
+    for(auto &pool : _worker_pools)
+    {
+      for(auto &w : pool->workers)
+      {
+        if(w.thread.joinable())
+        {
+          w.thread.join();
+        }
+      }
+    }
+    _worker_pools.clear();
+  }
+
+  // Completes i/o performed by workers. Must be called with the multiplexer lock held, which
+  // is released whilst visitors are invoked.
+  void _reap_workers(_multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    while(max_completions > 0)
+    {
+      std::unique_lock<std::mutex> g2(_workers_lock);
+      auto *state = _worker_completions.first;
+      if(state == nullptr)
+      {
+        return;
+      }
+      _worker_completions.remove(state);
+      g2.unlock();
+      state->with_worker = false;
+      _deadlines.disarm(state);
+      auto it = _find_fd(state->fd);
+      if(it != _registered_fds.end())
+      {
+        it->in_kernel--;
+      }
+      this->_completion_stats.completed(stats, state->initiated_ns);
+      g.unlock();
+      _complete_and_finish(state, state->worker_result);
+      g.lock();
+      ++stats.initiated_ios_finished;
+      --max_completions;
+    }
+    // The event is edge triggered, so completions left behind need it triggered again
+    std::lock_guard<std::mutex> g2(_workers_lock);
+    if(!_worker_completions.empty())
+    {
+      _trigger_workers_event();
+    }
+  }
+
+  // Retries queued i/o upon a handle which has become ready, until the kernel says it would
+  // block. Must be called with the multiplexer lock held, which is released whilst visitors are invoked.
+  // Returns true if queued i/o remains which may still be ready, as max_completions ran out first.
+  bool _process(int fd, bool is_read, _multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    for(;;)
+    {
+      // Look up afresh each time, as the lock is released during completion
+      auto it = _find_fd(fd);
+      if(it == _registered_fds.end())
+      {
+        return false;
+      }
+      auto &queue = is_read ? it->queued_reads : it->queued_writes;
+      auto *state = queue.first;
+      if(state == nullptr)
+      {
+        return false;
+      }
+      if(max_completions == 0)
+      {
+        return true;
+      }
+      const ssize_t res = _attempt(state, is_read);
+      if(-EAGAIN == res)
+      {
+        return false;  // wait for the next edge
+      }
+      queue.remove(state);
+      _deadlines.disarm(state);
+      this->_completion_stats.completed(stats, state->initiated_ns);
+      g.unlock();
+      _complete_and_finish(state, res);
+      g.lock();
+      ++stats.initiated_ios_finished;
+      --max_completions;
+    }
+  }
+  // Remembers that a handle's queued i/o may still be ready, as its edge will not be reported again
+  void _mark_ready(int fd, bool is_read) noexcept
+  {
+    auto it = _find_fd(fd);
+    if(it == _registered_fds.end())
+    {
+      return;
+    }
+    (is_read ? it->read_ready : it->write_ready) = true;
+    if(!it->in_ready_fds)
+    {
+      assert(_ready_fds.size() < _ready_fds.capacity());
+      it->in_ready_fds = true;
+      _ready_fds.push_back(fd);
+    }
+  }
+  // Retries queued i/o upon handles remembered as ready, oldest first. Must be called with
+  // the multiplexer lock held, which is released whilst visitors are invoked.
+  void _process_ready(_multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    // Handles still ready afterwards are appended, so visit each handle present on entry once
+    for(size_t togo = _ready_fds.size(); togo > 0 && max_completions > 0 && !_ready_fds.empty(); togo--)
+    {
+      const int fd = _ready_fds.front();
+      _ready_fds.erase(_ready_fds.begin());
+      auto it = _find_fd(fd);
+      if(it == _registered_fds.end())
+      {
+        continue;
+      }
+      const bool read_ready = it->read_ready, write_ready = it->write_ready;
+      it->read_ready = it->write_ready = it->in_ready_fds = false;
+      if(read_ready && _process(fd, true, g, max_completions, stats))
+      {
+        _mark_ready(fd, true);
+      }
+      if(write_ready && _process(fd, false, g, max_completions, stats))
+      {
+        _mark_ready(fd, false);
+      }
+    }
+  }
+
+  // Arms the deadline of i/o just initiated, if it has one. Must be called with the multiplexer lock held.
+  void _arm_deadline(_kqueue_operation_state *state) noexcept
+  {
+    if(state->payload.noncompleted.d)
+    {
+      _deadlines.arm(state, io_multiplexer_timer_wheel::expiry(state->payload.noncompleted.d));
+    }
+  }
+  // Times out i/o whose deadline has passed. Must be called with the multiplexer lock held,
+  // which is released whilst visitors are invoked.
+  void _expire(_multiplexer_lock_guard &g, size_t &max_completions, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    const auto now = std::chrono::steady_clock::now();
+    while(max_completions > 0)
+    {
+      auto *state = static_cast<_kqueue_operation_state *>(_deadlines.pop_expired(now));
+      if(state == nullptr)
+      {
+        return;
+      }
+      const auto s = state->current_state();
+      if(state->with_worker)
+      {
+        std::unique_lock<std::mutex> g2(_workers_lock);
+        if(state->pool == nullptr)
+        {
+          // A worker has begun the i/o, which cannot be interrupted
+          continue;
+        }
+        state->pool->pending.remove(state);
+        state->pool->pending_count--;
+        state->pool = nullptr;
+        g2.unlock();
+        state->with_worker = false;
+        auto it = _find_fd(state->fd);
+        assert(it != _registered_fds.end());
+        it->in_kernel--;
+      }
+      else if(state->is_queued)
+      {
+        auto it = _find_fd(state->fd);
+        assert(it != _registered_fds.end());
+        const bool is_read = (s == io_operation_state_type::read_initiated);
+        (is_read ? it->queued_reads : it->queued_writes).remove(state);
+      }
+      else
+      {
+#ifdef __FreeBSD__
+        if(state->in_kernel && AIO_CANCELED == ::aio_cancel(state->fd, &state->aiocb))
+        {
+          // Its completion is still posted to the kqueue
+          state->timed_out = true;
+        }
+#endif
+        continue;
+      }
+      this->_completion_stats.completed(stats, state->initiated_ns);
+      g.unlock();
+      _complete_and_finish(state, -ETIMEDOUT);
+      g.lock();
+      ++stats.initiated_ios_finished;
+      --max_completions;
+    }
+  }
+
+public:
+  constexpr bsd_kqueue_multiplexer() {}
+  bsd_kqueue_multiplexer(const bsd_kqueue_multiplexer &) = delete;
+  bsd_kqueue_multiplexer(bsd_kqueue_multiplexer &&) = delete;
+  bsd_kqueue_multiplexer &operator=(const bsd_kqueue_multiplexer &) = delete;
+  bsd_kqueue_multiplexer &operator=(bsd_kqueue_multiplexer &&) = delete;
+  virtual ~bsd_kqueue_multiplexer()
+  {
+    if(this->_v)
+    {
+      (void) bsd_kqueue_multiplexer::close();
+    }
+  }
+  result<void> init(size_t threads, size_t max_workers_per_device)
+  {
+    (void) threads;
+    _max_workers_per_device = max_workers_per_device;
+    this->_v.fd = ::kqueue();
+    if(-1 == this->_v.fd)
+    {
+      return posix_error();
+    }
+    if(-1 == ::fcntl(this->_v.fd, F_SETFD, FD_CLOEXEC))
+    {
+      return posix_error();
+    }
+    this->_v.behaviour |= native_handle_type::disposition::multiplexer;
+    struct kevent evs[2];
+    EV_SET(&evs[0], _wake_ident, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+    EV_SET(&evs[1], _workers_ident, EVFILT_USER, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+    if(-1 == ::kevent(this->_v.fd, evs, 2, nullptr, 0, nullptr))
+    {
+      return posix_error();
+    }
+    return success();
+  }
+
+  // These functions are inherited from handle
+  virtual result<path_type> current_path() const noexcept override
+  {
+    // kqueue file descriptors have no path
+    return success();
+  }
+  virtual result<void> close() noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    _stop_workers();
+    _registered_fds.clear();
+    _ready_fds.clear();
+#ifndef NDEBUG
+    if(this->_v)
+    {
+      // Tell handle::close() that we have correctly executed
+      this->_v.behaviour |= native_handle_type::disposition::_child_close_executed;
+    }
+#endif
+    return _base::close();
+  }
+
+  virtual result<uint8_t> do_io_handle_register(io_handle *h) noexcept override  // linear complexity to total handles registered
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    try
+    {
+      _multiplexer_lock_guard g(this->_lock);
+      const int fd = h->native_handle().fd;
+      auto it = std::lower_bound(_registered_fds.begin(), _registered_fds.end(), fd);
+      if(it != _registered_fds.end() && it->fd == fd)
+      {
+        return errc::device_or_resource_busy;
+      }
+      _worker_pool *pool = nullptr;
+      if(h->is_seekable() && _max_workers_per_device > 0)
+      {
+        struct stat st;
+        if(-1 == ::fstat(fd, &st))
+        {
+          return posix_error();
+        }
+        auto pit = std::find_if(_worker_pools.begin(), _worker_pools.end(), [&](const std::unique_ptr<_worker_pool> &i) { return i->device == st.st_dev; });
+        if(pit == _worker_pools.end())
+        {
+          _worker_pools.push_back(std::make_unique<_worker_pool>(st.st_dev));
+          pit = _worker_pools.end() - 1;
+        }
+        pool = pit->get();
+      }
+      _ready_fds.reserve(_registered_fds.size() + 1);
+      it = _registered_fds.insert(it, _registered_fd(fd, h->is_seekable()));
+      it->pool = pool;
+      if(!it->is_seekable)
+      {
+        struct kevent evs[2];
+        EV_SET(&evs[0], fd, EVFILT_READ, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+        EV_SET(&evs[1], fd, EVFILT_WRITE, EV_ADD | EV_CLEAR, 0, 0, nullptr);
+        if(-1 == ::kevent(this->_v.fd, evs, 2, nullptr, 0, nullptr))
+        {
+          const int e = errno;
+          _registered_fds.erase(it);
+          return posix_error(e);
+        }
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  virtual result<void> do_io_handle_deregister(io_handle *h) noexcept override
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    _multiplexer_lock_guard g(this->_lock);
+    auto it = _find_fd(h->native_handle().fd);
+    if(it == _registered_fds.end())
+    {
+      return errc::invalid_argument;
+    }
+    if(it->in_kernel > 0 || !it->queued_reads.empty() || !it->queued_writes.empty())
+    {
+      return errc::operation_in_progress;
+    }
+    if(!it->is_seekable)
+    {
+      struct kevent evs[2];
+      EV_SET(&evs[0], it->fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+      EV_SET(&evs[1], it->fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+      if(-1 == ::kevent(this->_v.fd, evs, 2, nullptr, 0, nullptr))
+      {
+        return posix_error();
+      }
+    }
+    if(it->in_ready_fds)
+    {
+      _ready_fds.erase(std::find(_ready_fds.begin(), _ready_fds.end(), it->fd));
+    }
+    _registered_fds.erase(it);
+    return success();
+  }
+
+  virtual size_t do_io_handle_max_buffers(const io_handle * /*unused*/) const noexcept override { return IOV_MAX; }
+
+  virtual std::pair<size_t, size_t> io_state_requirements() noexcept override { return {sizeof(_kqueue_operation_state), alignof(_kqueue_operation_state)}; }
+
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_kqueue_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_kqueue_operation_state)) == 0);
+    if(storage.size() < sizeof(_kqueue_operation_state) || ((uintptr_t) storage.data() % alignof(_kqueue_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _kqueue_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_kqueue_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_kqueue_operation_state)) == 0);
+    if(storage.size() < sizeof(_kqueue_operation_state) || ((uintptr_t) storage.data() % alignof(_kqueue_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _kqueue_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d,
+                                        io_request<const_buffers_type> reqs, barrier_kind kind) noexcept override
+  {
+    assert(storage.size() >= sizeof(_kqueue_operation_state));
+    assert(((uintptr_t) storage.data() % alignof(_kqueue_operation_state)) == 0);
+    if(storage.size() < sizeof(_kqueue_operation_state) || ((uintptr_t) storage.data() % alignof(_kqueue_operation_state)) != 0)
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _kqueue_operation_state(_h, _visitor, std::move(b), d, std::move(reqs), kind);
+  }
+
+  virtual io_operation_state_type init_io_operation(io_operation_state *_op) noexcept override
+  {
+    auto *state = static_cast<_kqueue_operation_state *>(_op);
+    state->fd = state->h->native_handle().fd;
+    state->is_seekable = state->h->is_seekable();
+    const auto s = state->current_state();
+    if(state->is_seekable)
+    {
+      _multiplexer_lock_guard g(this->_lock);
+      auto it = _find_fd(state->fd);
+      if(it == _registered_fds.end())
+      {
+        abort();  // i/o upon a handle not registered with this multiplexer
+      }
+#ifdef __FreeBSD__
+      const int res = _aio_submit(state);
+      if(0 == res)
+      {
+        it->in_kernel++;
+        state->in_kernel = true;
+        state->initiated_ns = this->_completion_stats.initiated();
+        switch(s)
+        {
+        case io_operation_state_type::read_initialised:
+          state->read_initiated();
+          break;
+        case io_operation_state_type::write_initialised:
+          state->write_initiated();
+          break;
+        default:
+          state->barrier_initiated();
+          break;
+        }
+        _arm_deadline(state);
+        return state->current_state();
+      }
+      if(-EAGAIN != res && -ENOSYS != res && -EOPNOTSUPP != res)
+      {
+        g.unlock();
+        this->_completion_stats.completed_immediately();
+        _complete_and_finish(state, res);
+        return _finished_state_for(s);
+      }
+      // AIO refused the i/o, so hand it to a worker
+#endif
+      if(it->pool != nullptr)
+      {
+        // The worker may complete the i/o at any time after submission, so initiate it first
+        state->initiated_ns = this->_completion_stats.initiated();
+        switch(s)
+        {
+        case io_operation_state_type::read_initialised:
+          state->read_initiated();
+          break;
+        case io_operation_state_type::write_initialised:
+          state->write_initiated();
+          break;
+        default:
+          state->barrier_initiated();
+          break;
+        }
+        if(_worker_submit(it->pool, state))
+        {
+          it->in_kernel++;
+          _arm_deadline(state);
+          return state->current_state();
+        }
+        this->_completion_stats.cancelled();
+      }
+      g.unlock();
+      // No worker could be started, so perform the i/o synchronously
+      this->_completion_stats.completed_immediately();
+      _complete_and_finish(state, _sync_io(state));
+      return _finished_state_for(s);
+    }
+    bool is_read = false;
+    switch(s)
+    {
+    case io_operation_state_type::read_initialised:
+      is_read = true;
+      break;
+    case io_operation_state_type::write_initialised:
+      break;
+    case io_operation_state_type::barrier_initialised:
+      // Barriers on non-seekable handles are a no-op
+      this->_completion_stats.completed_immediately();
+      state->barrier_completed(io_result<const_buffers_type>(const_buffers_type()));
+      state->write_or_barrier_finished();
+      return io_operation_state_type::write_or_barrier_finished;
+    default:
+      assert(false);
+      return s;
+    }
+    _multiplexer_lock_guard g(this->_lock);
+    auto it = _find_fd(state->fd);
+    if(it == _registered_fds.end())
+    {
+      abort();  // i/o upon a handle not registered with this multiplexer
+    }
+    auto &queue = is_read ? it->queued_reads : it->queued_writes;
+    if(queue.empty())
+    {
+      // Try to eagerly complete the i/o now
+      const ssize_t res = _attempt(state, is_read);
+      if(-EAGAIN != res)
+      {
+        g.unlock();
+        this->_completion_stats.completed_immediately();
+        _complete_and_finish(state, res);
+        return _finished_state_for(s);
+      }
+    }
+    // The multiplexer lock must be held until queued, else the readiness edge could be missed
+    if(is_read)
+    {
+      state->read_initiated();
+    }
+    else
+    {
+      state->write_initiated();
+    }
+    state->initiated_ns = this->_completion_stats.initiated();
+    queue.push_back(state);
+    _arm_deadline(state);
+    return state->current_state();
+  }
+
+  virtual io_operation_state_type check_io_operation(io_operation_state *_op) noexcept override
+  {
+    auto s = _op->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    (void) check_for_any_completed_io(std::chrono::seconds(0));
+    return _op->current_state();
+  }
+
+  virtual result<io_operation_state_type> cancel_io_operation(io_operation_state *_op, deadline d = {}) noexcept override
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    auto *state = static_cast<_kqueue_operation_state *>(_op);
+    _multiplexer_lock_guard g(this->_lock);
+    const auto s = state->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    if(state->with_worker)
+    {
+      std::unique_lock<std::mutex> g2(_workers_lock);
+      if(state->pool != nullptr)
+      {
+        // i/o no worker has yet taken has not touched the kernel yet, so cancellation is immediate
+        state->pool->pending.remove(state);
+        state->pool->pending_count--;
+        state->pool = nullptr;
+        g2.unlock();
+        state->with_worker = false;
+        _deadlines.disarm(state);
+        auto it = _find_fd(state->fd);
+        assert(it != _registered_fds.end());
+        it->in_kernel--;
+        this->_completion_stats.cancelled();
+        g.unlock();
+        _complete_and_finish(state, -ECANCELED);
+        return _finished_state_for(s);
+      }
+      // Otherwise wait for the worker to finish the i/o
+    }
+    else if(state->is_queued)
+    {
+      // Queued i/o has not touched the kernel yet, so cancellation is immediate
+      auto it = _find_fd(state->fd);
+      assert(it != _registered_fds.end());
+      const bool is_read = (s == io_operation_state_type::read_initiated);
+      (is_read ? it->queued_reads : it->queued_writes).remove(state);
+      _deadlines.disarm(state);
+      this->_completion_stats.cancelled();
+      g.unlock();
+      _complete_and_finish(state, -ECANCELED);
+      return _finished_state_for(s);
+    }
+#ifdef __FreeBSD__
+    if(state->in_kernel)
+    {
+      // Whether cancelled or not, the kernel posts a completion to the kqueue
+      (void) ::aio_cancel(state->fd, &state->aiocb);
+    }
+#endif
+    g.unlock();
+    // Pump completions until the cancelled i/o finishes
+    while(!is_finished(state->current_state()))
+    {
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      OUTCOME_TRY(check_for_any_completed_io(nd));
+      LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+    }
+    return state->current_state();
+  }
+
+  virtual result<check_for_any_completed_io_statistics> check_for_any_completed_io(deadline d = std::chrono::seconds(0), size_t max_completions = (size_t) -1) noexcept override
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    check_for_any_completed_io_statistics ret;
+    while(max_completions > 0)
+    {
+      // Firstly retry handles known to be ready from before, whose edges will not be reported again
+      bool ready_processed = false;
+      {
+        _multiplexer_lock_guard g(this->_lock);
+        if(!_ready_fds.empty())
+        {
+          const size_t finished_before = ret.initiated_ios_finished;
+          _process_ready(g, max_completions, ret);
+          this->_completion_stats.reaped(ret, ret.initiated_ios_finished - finished_before);
+          ready_processed = (ret.initiated_ios_finished != finished_before);
+        }
+      }
+      if(max_completions == 0)
+      {
+        break;
+      }
+      struct timespec ts;
+      memset(&ts, 0, sizeof(ts));
+      struct timespec *tsp = nullptr;
+      if(d)
+      {
+        std::chrono::nanoseconds ns(0);
+        if(d.steady)
+        {
+          if(d.nsecs != 0)
+          {
+            ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds(d.nsecs)) - std::chrono::steady_clock::now());
+          }
+        }
+        else
+        {
+          ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d.to_time_point() - std::chrono::system_clock::now());
+        }
+        if(ns.count() > 0)
+        {
+          ts.tv_sec = ns.count() / 1000000000LL;
+          ts.tv_nsec = ns.count() % 1000000000LL;
+        }
+        tsp = &ts;
+      }
+      struct timespec caller_ts = ts;
+      struct timespec *caller_tsp = tsp;
+      if(ready_processed)
+      {
+        // Only collect whatever else is ready
+        memset(&ts, 0, sizeof(ts));
+        tsp = &ts;
+      }
+      if(!_deadlines.empty())
+      {
+        // Sleep no later than the next deadline of initiated i/o
+        _multiplexer_lock_guard g(this->_lock);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_deadlines.next_expiry() - std::chrono::steady_clock::now()).count();
+        if(ns < 0)
+        {
+          ns = 0;
+        }
+        if(tsp == nullptr || ns < (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec)
+        {
+          ts.tv_sec = ns / 1000000000LL;
+          ts.tv_nsec = ns % 1000000000LL;
+          tsp = &ts;
+        }
+      }
+      struct kevent events[64];
+      // Multiple threads may wait here concurrently
+      int count;
+      {
+        LLFIO_TRACE_SYSCALL(this, "kevent");
+        count = ::kevent(this->_v.fd, nullptr, 0, events, (int) std::min<size_t>(64, max_completions), tsp);
+      }
+      if(count < 0 && EINTR != errno)
+      {
+        return posix_error();
+      }
+      _multiplexer_lock_guard g(this->_lock);
+      const size_t finished_before = ret.initiated_ios_finished;
+      for(int n = 0; n < count; n++)
+      {
+        const auto &ev = events[n];
+        switch(ev.filter)
+        {
+        case EVFILT_USER:
+          if(_workers_ident == ev.ident)
+          {
+            _reap_workers(g, max_completions, ret);
+          }
+          break;
+        // The edges of events beyond max_completions are remembered, else they would be lost
+        case EVFILT_READ:
+          if(_process((int) ev.ident, true, g, max_completions, ret))
+          {
+            _mark_ready((int) ev.ident, true);
+          }
+          break;
+        case EVFILT_WRITE:
+          if(_process((int) ev.ident, false, g, max_completions, ret))
+          {
+            _mark_ready((int) ev.ident, false);
+          }
+          break;
+#ifdef __FreeBSD__
+        case EVFILT_AIO:
+        {
+          auto *state = static_cast<_kqueue_operation_state *>(ev.udata);
+          ssize_t res = ::aio_return(&state->aiocb);
+          if(res < 0)
+          {
+            res = -errno;
+          }
+          if(state->timed_out && -ECANCELED == res)
+          {
+            res = -ETIMEDOUT;
+          }
+          state->in_kernel = false;
+          _deadlines.disarm(state);
+          auto it = _find_fd(state->fd);
+          if(it != _registered_fds.end())
+          {
+            it->in_kernel--;
+          }
+          this->_completion_stats.completed(ret, state->initiated_ns);
+          g.unlock();
+          _complete_and_finish(state, res);
+          g.lock();
+          ++ret.initiated_ios_finished;
+          // Completions are consumed when reported, so are finished even beyond max_completions
+          if(max_completions > 0)
+          {
+            --max_completions;
+          }
+          break;
+        }
+#endif
+        default:
+          break;
+        }
+      }
+      if(!_deadlines.empty())
+      {
+        _expire(g, max_completions, ret);
+      }
+      this->_completion_stats.reaped(ret, ret.initiated_ios_finished - finished_before);
+      if(ret.initiated_ios_completed + ret.initiated_ios_finished > 0)
+      {
+        break;
+      }
+      // If another kernel thread woke me, exit the loop
+      if(_wakecount > 0)
+      {
+        --_wakecount;
+        break;
+      }
+      if(caller_tsp != nullptr && caller_ts.tv_sec == 0 && caller_ts.tv_nsec == 0)
+      {
+        break;
+      }
+    }
+    this->_completion_stats.report(ret);
+    return ret;
+  }
+
+  virtual result<void> wake_check_for_any_completed_io() noexcept override
+  {
+    _multiplexer_lock_guard g(this->_lock);
+    ++_wakecount;
+    struct kevent ev;
+    EV_SET(&ev, _wake_ident, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+    if(-1 == ::kevent(this->_v.fd, &ev, 1, nullptr, 0, nullptr))
+    {
+      return posix_error();
+    }
+    return success();
+  }
+};
+
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_bsd_kqueue(size_t threads, size_t max_workers_per_device) noexcept
+{
+  try
+  {
+    if(1 == threads)
+    {
+      auto ret = std::make_unique<bsd_kqueue_multiplexer<false>>();
+      OUTCOME_TRY(ret->init(1, max_workers_per_device));
+      return io_multiplexer_ptr(ret.release());
+    }
+    auto ret = std::make_unique<bsd_kqueue_multiplexer<true>>();
+    OUTCOME_TRY(ret->init(threads, max_workers_per_device));
+    return io_multiplexer_ptr(ret.release());
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_V2_NAMESPACE_END
@@ -162,6 +162,16 @@ result<lockable_io_handle::extent_guard> lockable_io_handle::lock_file_range(io_
   return extent_guard(this, offset, bytes, kind);
 }
 
+result<void> lockable_io_handle::relock_file_range(io_handle::extent_type offset, io_handle::extent_type bytes, lock_kind from, lock_kind to, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  (void) from;
+  // POSIX byte range locks replace, so relocking the same range converts the lock atomically
+  OUTCOME_TRY(auto &&g, lock_file_range(offset, bytes, to, d));
+  g.release();
+  return success();
+}
+
 void lockable_io_handle::unlock_file_range(io_handle::extent_type offset, io_handle::extent_type bytes) noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
@@ -24,10 +24,16 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../../map_handle.hpp"
 #include "../../../utils.hpp"
+#include "../map_handle.ipp"
 
 #include "quickcpplib/signal_guard.hpp"
 
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 //#define LLFIO_DEBUG_LINUX_MUNMAP
 
@@ -52,6 +58,141 @@ static struct llfio_linux_munmap_debug_t
 
 LLFIO_V2_NAMESPACE_BEGIN
 
+namespace detail
+{
+  inline void map_handle_cache_release(byte *addr, size_t bytes) noexcept { (void) ::munmap(addr, bytes); }
+
+  // True if the file is on a DAX mount, so maps of it are of the persistent memory itself
+  inline bool section_handle_is_dax(int fd) noexcept
+  {
+#if defined(__linux__) && defined(SYS_statx)
+    // From Linux 5.8 onwards
+    struct
+    {
+      uint32_t stx_mask;
+      uint32_t stx_blksize;
+      uint64_t stx_attributes;
+      uint32_t stx_nlink, stx_uid, stx_gid;
+      uint16_t stx_mode, __spare0;
+      uint64_t stx_ino, stx_size, stx_blocks;
+      uint64_t stx_attributes_mask;
+      uint64_t __spare[26];
+    } s;
+    memset(&s, 0, sizeof(s));
+    static constexpr uint64_t _STATX_ATTR_DAX = 0x00200000;
+    if(-1 == ::syscall(SYS_statx, fd, "", 0x1000 /*AT_EMPTY_PATH*/, 0U, &s))
+    {
+      return false;
+    }
+    return (s.stx_attributes_mask & _STATX_ATTR_DAX) != 0 && (s.stx_attributes & _STATX_ATTR_DAX) != 0;
+#else
+    (void) fd;
+    return false;
+#endif
+  }
+
+  inline result<bool> map_handle_populate_native(byte *addr, size_t bytes, bool write) noexcept
+  {
+#ifdef __linux__
+    // From Linux 5.14 onwards
+    enum
+    {
+      llfio_MADV_POPULATE_READ = 22,
+      llfio_MADV_POPULATE_WRITE = 23
+    };
+    static std::atomic<bool> have_madv_populate{true};
+    if(have_madv_populate.load(std::memory_order_relaxed))
+    {
+      if(-1 != ::madvise(addr, bytes, write ? llfio_MADV_POPULATE_WRITE : llfio_MADV_POPULATE_READ))
+      {
+        return true;
+      }
+      if(errno != EINVAL)
+      {
+        return posix_error();
+      }
+      have_madv_populate.store(false, std::memory_order_relaxed);
+    }
+#else
+    (void) write;
+#endif
+    // Have readahead begin for the whole portion before we touch it page by page
+    (void) ::madvise(addr, bytes, MADV_WILLNEED);
+    return false;
+  }
+
+  inline result<void> map_handle_apply_numa_placement(void *addr, size_t bytes, numa_placement placement, bool move_existing) noexcept
+  {
+    using policy_type = numa_placement::policy_type;
+    const bool is_hint = (placement.policy == policy_type::first_touch || placement.policy == policy_type::local || placement.policy == policy_type::prefer);
+#ifdef __linux__
+    // From <numaif.h>, which is not always installed
+    enum
+    {
+      llfio_MPOL_DEFAULT = 0,
+      llfio_MPOL_PREFERRED = 1,
+      llfio_MPOL_BIND = 2,
+      llfio_MPOL_INTERLEAVE = 3,
+      llfio_MPOL_MF_MOVE = 1 << 1
+    };
+    int mode = llfio_MPOL_DEFAULT;
+    uint64_t nodemask = placement.nodes;
+    switch(placement.policy)
+    {
+    case policy_type::first_touch:
+      nodemask = 0;
+      break;
+    case policy_type::local:
+    {
+      unsigned cpu = 0, node = 0;
+      if(-1 == ::syscall(SYS_getcpu, &cpu, &node, nullptr) || node >= 64)
+      {
+        return success();  // only a hint
+      }
+      mode = llfio_MPOL_PREFERRED;
+      nodemask = (uint64_t) 1 << node;
+      break;
+    }
+    case policy_type::prefer:
+      mode = llfio_MPOL_PREFERRED;
+      nodemask &= ~nodemask + 1;  // lowest node only
+      break;
+    case policy_type::bind:
+      mode = llfio_MPOL_BIND;
+      break;
+    case policy_type::interleave:
+      mode = llfio_MPOL_INTERLEAVE;
+      break;
+    }
+    if(mode != llfio_MPOL_DEFAULT && nodemask == 0)
+    {
+      return errc::invalid_argument;
+    }
+    // The kernel ignores the last bit of maxnode
+    if(-1 == ::syscall(SYS_mbind, addr, bytes, mode, (mode != llfio_MPOL_DEFAULT) ? &nodemask : nullptr, (mode != llfio_MPOL_DEFAULT) ? sizeof(nodemask) * 8 + 1 : 0,
+                       move_existing ? llfio_MPOL_MF_MOVE : 0))
+    {
+      // Kernels built without NUMA support need not honour hints
+      if(errno == ENOSYS && is_hint)
+      {
+        return success();
+      }
+      return posix_error();
+    }
+    return success();
+#else
+    (void) addr;
+    (void) bytes;
+    (void) move_existing;
+    if(is_hint)
+    {
+      return success();
+    }
+    return errc::operation_not_supported;
+#endif
+  }
+}  // namespace detail
+
 section_handle::~section_handle()
 {
   if(_v)
@@ -63,6 +204,7 @@ section_handle::~section_handle()
       abort();
     }
   }
+  delete _dirty;
 }
 result<void> section_handle::close() noexcept
 {
@@ -73,6 +215,8 @@ result<void> section_handle::close() noexcept
     _v = native_handle_type();
     OUTCOME_TRYV(handle::close());
     OUTCOME_TRYV(_anonymous.close());
+    delete _dirty;
+    _dirty = nullptr;
     _flag = flag::none;
   }
   return success();
@@ -92,6 +236,18 @@ result<section_handle> section_handle::section(file_handle &backing, extent_type
     nativeh.behaviour |= native_handle_type::disposition::writable;
   }
   nativeh.behaviour |= native_handle_type::disposition::section;
+  if(!(_flag & flag::nvram) && detail::section_handle_is_dax(nativeh.fd))
+  {
+    ret.value()._flag |= flag::nvram;
+  }
+  if(_flag & flag::track_dirty)
+  {
+    ret.value()._dirty = new(std::nothrow) detail::section_handle_dirty_ranges;
+    if(ret.value()._dirty == nullptr)
+    {
+      return errc::not_enough_memory;
+    }
+  }
   LLFIO_LOG_FUNCTION_CALL(&ret);
   return ret;
 }
@@ -113,6 +269,18 @@ result<section_handle> section_handle::section(extent_type bytes, const path_han
     nativeh.behaviour |= native_handle_type::disposition::writable;
   }
   nativeh.behaviour |= native_handle_type::disposition::section;
+  if(!(_flag & flag::nvram) && detail::section_handle_is_dax(nativeh.fd))
+  {
+    ret.value()._flag |= flag::nvram;
+  }
+  if(_flag & flag::track_dirty)
+  {
+    ret.value()._dirty = new(std::nothrow) detail::section_handle_dirty_ranges;
+    if(ret.value()._dirty == nullptr)
+    {
+      return errc::not_enough_memory;
+    }
+  }
   LLFIO_LOG_FUNCTION_CALL(&ret);
   return ret;
 }
@@ -173,7 +341,11 @@ result<void> map_handle::close() noexcept
       OUTCOME_TRYV(map_handle::barrier(barrier_kind::wait_all));
     }
     // printf("%d munmap %p-%p\n", getpid(), _addr, _addr+_reservation);
-    if(-1 == ::munmap(_addr, _reservation))
+    if(_recyclable && detail::map_handle_cache().enabled.load(std::memory_order_relaxed) && detail::map_handle_cache().add(_addr, _reservation, _pagesize, _flag))
+    {
+      // Retained for reuse by map()
+    }
+    else if(-1 == ::munmap(_addr, _reservation))
     {
 #ifdef LLFIO_DEBUG_LINUX_MUNMAP
       int olderrno = errno;
@@ -200,6 +372,7 @@ result<void> map_handle::close() noexcept
   _v = native_handle_type();
   _addr = nullptr;
   _length = 0;
+  _recyclable = false;
   return success();
 }
 
@@ -227,24 +400,48 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_barrier(ma
     }
     bytes += req.size();
   }
-  // If empty, do the whole file
-  if(reqs.buffers.empty())
+  int flags = ((uint8_t) kind & 1) ? MS_SYNC : MS_ASYNC;
+  // If empty and the section tracks modified extents, flush only those
+  if(reqs.buffers.empty() && _section != nullptr && _section->_dirty != nullptr)
   {
-    bytes = _length;
+    OUTCOME_TRYV(_section->_dirty->flush(_offset + reqs.offset, _offset + _length, [&](extent_type begin, extent_type end) -> result<void> {
+      addr = _addr + ((begin - _offset) & ~static_cast<extent_type>(_pagesize - 1));
+      bytes = static_cast<size_type>(utils::round_up_to_page_size(end - _offset, _pagesize) - (addr - _addr));
+      if(kind <= barrier_kind::wait_data_only && is_nvram())
+      {
+        auto synced = nvram_barrier({addr, bytes});
+        if(synced.size() >= bytes)
+        {
+          return success();
+        }
+      }
+      if(-1 == ::msync(addr, bytes, flags))
+      {
+        return posix_error();
+      }
+      return success();
+    }));
   }
-  // If nvram and not syncing metadata, use lightweight barrier
-  if(kind <= barrier_kind::wait_data_only && is_nvram())
+  else
   {
-    auto synced = nvram_barrier({addr, bytes});
-    if(synced.size() >= bytes)
+    // If empty, do the whole file
+    if(reqs.buffers.empty())
     {
-      return {reqs.buffers};
+      bytes = _length;
+    }
+    // If nvram and not syncing metadata, use lightweight barrier
+    if(kind <= barrier_kind::wait_data_only && is_nvram())
+    {
+      auto synced = nvram_barrier({addr, bytes});
+      if(synced.size() >= bytes)
+      {
+        return {reqs.buffers};
+      }
+    }
+    if(-1 == ::msync(addr, bytes, flags))
+    {
+      return posix_error();
     }
-  }
-  int flags = ((uint8_t) kind & 1) ? MS_SYNC : MS_ASYNC;
-  if(-1 == ::msync(addr, bytes, flags))
-  {
-    return posix_error();
   }
   // Don't fsync temporary inodes
   if(_section != nullptr && (_section->backing() != nullptr) && kind >= barrier_kind::nowait_all)
@@ -255,8 +452,32 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_barrier(ma
   return {reqs.buffers};
 }
 
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+// The size of a transparent huge page, or zero if the kernel was built without transparent huge page support
+static inline size_t transparent_huge_page_size() noexcept
+{
+  static const size_t v = [] {
+    size_t ret = 0;
+    int fd = ::open("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", O_RDONLY | O_CLOEXEC);
+    if(-1 != fd)
+    {
+      char buffer[32];
+      auto bytesread = ::read(fd, buffer, sizeof(buffer) - 1);
+      ::close(fd);
+      if(bytesread > 0)
+      {
+        buffer[bytesread] = 0;
+        ret = (size_t) strtoull(buffer, nullptr, 10);
+      }
+    }
+    // Must be a power of two for the alignment arithmetic below
+    return (ret & (ret - 1)) == 0 ? ret : 0;
+  }();
+  return v;
+}
+#endif
 
-static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr, int extra_flags, section_handle *section, map_handle::size_type pagesize, map_handle::size_type &bytes, map_handle::extent_type offset, section_handle::flag _flag) noexcept
+static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr, int extra_flags, section_handle *section, map_handle::size_type pagesize, map_handle::size_type &bytes, map_handle::extent_type offset, section_handle::flag _flag, bool *map_sync_refused = nullptr) noexcept
 {
   bool have_backing = (section != nullptr);
   int prot = 0, flags = have_backing ? MAP_SHARED : (MAP_PRIVATE | MAP_ANONYMOUS);
@@ -318,17 +539,17 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
   {
     static const auto &pagesizes = utils::page_sizes();  // can't throw, as guaranteed called before now
 #ifdef __linux__
-    flags |= MAP_HUGETLB;  // gets me pagesizes[1]
-    if(pagesize > pagesizes[1])
-    {
+    flags |= MAP_HUGETLB;  // gets me the kernel's default huge page size
 #ifdef MAP_HUGE_SHIFT
-      // Ask for page size requested
-      size_t topbitset = (__CHAR_BIT__ * sizeof(unsigned long)) - __builtin_clzl((unsigned long) pagesize);
-      flags |= topbitset << MAP_HUGE_SHIFT;
+    // Ask for page size requested, which the kernel takes as log2 of the page size
+    flags |= static_cast<int>(__builtin_ctzl((unsigned long) pagesize)) << MAP_HUGE_SHIFT;
+    (void) pagesizes;
 #else
+    if(pagesize != pagesizes[1])
+    {
       return errc::invalid_argument;
-#endif
     }
+#endif
 #elif defined(__FreeBSD__)
     size_t topbitset = (__CHAR_BIT__ * sizeof(unsigned long)) - __builtin_clzl((unsigned long) pagesize);
     flags |= MAP_ALIGNED(topbitset);
@@ -344,6 +565,31 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
 #error Do not know how to specify large/huge/super pages on this platform
 #endif
   }
+#ifdef MAP_ALIGNED_SUPER
+  if((_flag & section_handle::flag::prefer_large_pages) && pagesize == utils::page_size())
+  {
+    flags |= MAP_ALIGNED_SUPER;
+  }
+#endif
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  /* Transparent huge pages, and DAX PMD mappings, are only used where the address and the file offset
+  share huge page alignment. So if we are placing the map, reserve enough slack to place it suitably.
+  */
+  const size_t thp_pagesize = ((_flag & section_handle::flag::prefer_large_pages) && pagesize == utils::page_size()) ? transparent_huge_page_size() : 0;
+  byte *thp_reservation = nullptr;
+  size_t thp_reservation_bytes = 0;
+  if(ataddr == nullptr && thp_pagesize > 0 && bytes >= thp_pagesize)
+  {
+    thp_reservation_bytes = bytes + thp_pagesize;
+    void *reservation = ::mmap(nullptr, thp_reservation_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(MAP_FAILED != reservation)
+    {
+      thp_reservation = static_cast<byte *>(reservation);
+      ataddr = thp_reservation + (((uintptr_t) offset - (uintptr_t) thp_reservation) & (thp_pagesize - 1));
+      flags |= MAP_FIXED;
+    }
+  }
+#endif
 // printf("mmap(%p, %u, %d, %d, %d, %u)\n", ataddr, (unsigned) bytes, prot, flags, have_backing ? section->native_handle().fd : -1, (unsigned) offset);
 #ifdef MAP_SYNC  // Linux kernel 4.15 or later only
   // If backed by a file into persistent shared memory, ask the kernel to use persistent memory safe semantics
@@ -352,6 +598,15 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
     int flagscopy = flags & ~MAP_SHARED;
     flagscopy |= MAP_SHARED_VALIDATE | MAP_SYNC;
     addr = ::mmap(ataddr, bytes, prot, flagscopy, fd_to_use, offset);
+    if(MAP_FAILED == addr && (errno == EOPNOTSUPP || errno == EINVAL))
+    {
+      // Not DAX, or the kernel or filing system does not implement MAP_SYNC
+      addr = nullptr;
+      if(map_sync_refused != nullptr)
+      {
+        *map_sync_refused = true;
+      }
+    }
   }
 #endif
   if(addr == nullptr)
@@ -361,8 +616,35 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
   // printf("%d mmap %p-%p\n", getpid(), addr, (char *) addr+bytes);
   if(MAP_FAILED == addr)  // NOLINT
   {
-    return posix_error();
+    auto ret = posix_error();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if(thp_reservation != nullptr)
+    {
+      ::munmap(thp_reservation, thp_reservation_bytes);
+    }
+#endif
+    return ret;
+  }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if(thp_reservation != nullptr)
+  {
+    // Release the slack either side of the placed map
+    byte *begin = static_cast<byte *>(addr), *end = begin + utils::round_up_to_page_size(bytes, pagesize);
+    if(begin > thp_reservation)
+    {
+      ::munmap(thp_reservation, begin - thp_reservation);
+    }
+    if(end < thp_reservation + thp_reservation_bytes)
+    {
+      ::munmap(end, thp_reservation + thp_reservation_bytes - end);
+    }
   }
+  if(thp_pagesize > 0)
+  {
+    // Only advisory, so failure (e.g. transparent huge pages are disabled) is not an error
+    (void) ::madvise(addr, bytes, MADV_HUGEPAGE);
+  }
+#endif
 #ifdef MADV_FREE_REUSABLE
   if((prot & PROT_WRITE) != 0 && (_flag & section_handle::flag::nocommit))
   {
@@ -387,9 +669,8 @@ static inline result<void *> do_mmap(native_handle_type &nativeh, void *ataddr,
   return addr;
 }
 
-result<map_handle> map_handle::map(size_type bytes, bool /*unused*/, section_handle::flag _flag) noexcept
+result<map_handle> map_handle::map(size_type bytes, bool zeroed, section_handle::flag _flag) noexcept
 {
-  // TODO: Keep a cache of MADV_FREE pages deallocated
   if(bytes == 0u)
   {
     return errc::argument_out_of_domain;
@@ -398,14 +679,35 @@ result<map_handle> map_handle::map(size_type bytes, bool /*unused*/, section_han
   result<map_handle> ret(map_handle(nullptr, _flag));
   native_handle_type &nativeh = ret.value()._v;
   OUTCOME_TRY(auto &&pagesize, detail::pagesize_from_flags(ret.value()._flag));
-  OUTCOME_TRY(auto &&addr, do_mmap(nativeh, nullptr, 0, nullptr, pagesize, bytes, 0, ret.value()._flag));
+  // Recycled maps may have been placed differently
+  const auto placement = this_thread::current_numa_placement();
+  const bool cacheable = detail::map_handle_cache_t::cacheable(ret.value()._flag) && placement == numa_placement();
+  void *addr = nullptr;
+  if(cacheable && !zeroed && detail::map_handle_cache().enabled.load(std::memory_order_relaxed))
+  {
+    addr = detail::map_handle_cache().get(bytes, pagesize, ret.value()._flag);
+    if(addr != nullptr)
+    {
+      nativeh.behaviour |= native_handle_type::disposition::seekable | native_handle_type::disposition::readable | native_handle_type::disposition::writable;
+    }
+  }
+  if(addr == nullptr)
+  {
+    OUTCOME_TRY(auto &&addr_, do_mmap(nativeh, nullptr, 0, nullptr, pagesize, bytes, 0, ret.value()._flag));
+    addr = addr_;
+  }
   ret.value()._addr = static_cast<byte *>(addr);
   ret.value()._reservation = bytes;
   ret.value()._length = bytes;
   ret.value()._pagesize = pagesize;
+  ret.value()._recyclable = cacheable;
   nativeh._init = -2;  // otherwise appears closed
   nativeh.behaviour |= native_handle_type::disposition::allocation;
   LLFIO_LOG_FUNCTION_CALL(&ret);
+  if(placement != numa_placement())
+  {
+    OUTCOME_TRYV(detail::map_handle_apply_numa_placement(addr, bytes, placement, false));
+  }
   return ret;
 }
 
@@ -419,7 +721,13 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   result<map_handle> ret{map_handle(&section, _flag)};
   native_handle_type &nativeh = ret.value()._v;
   OUTCOME_TRY(auto &&pagesize, detail::pagesize_from_flags(ret.value()._flag));
-  OUTCOME_TRY(auto &&addr, do_mmap(nativeh, nullptr, 0, &section, pagesize, bytes, offset, ret.value()._flag));
+  bool map_sync_refused = false;
+  OUTCOME_TRY(auto &&addr, do_mmap(nativeh, nullptr, 0, &section, pagesize, bytes, offset, ret.value()._flag, &map_sync_refused));
+  if(map_sync_refused)
+  {
+    // Without MAP_SYNC, CPU cache flushes are not enough to make writes durable
+    ret.value()._flag &= ~section_handle::flag::nvram;
+  }
   ret.value()._addr = static_cast<byte *>(addr);
   ret.value()._offset = offset;
   ret.value()._reservation = utils::round_up_to_page_size(bytes, pagesize);
@@ -429,6 +737,59 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   ret.value()._v.fd = section.native_handle().fd;
   nativeh.behaviour |= native_handle_type::disposition::allocation;
   LLFIO_LOG_FUNCTION_CALL(&ret);
+  const auto placement = this_thread::current_numa_placement();
+  if(placement != numa_placement())
+  {
+    OUTCOME_TRYV(detail::map_handle_apply_numa_placement(addr, ret.value()._reservation, placement, false));
+  }
+  return ret;
+}
+
+result<map_handle> map_handle::map_mirrored(section_handle &section, size_type bytes, extent_type offset, section_handle::flag _flag) noexcept
+{
+  const auto granularity = utils::allocation_granularity();
+  if(bytes == 0u || (bytes & (granularity - 1)) != 0 || (offset & (granularity - 1)) != 0 || (_flag & section_handle::flag::cow))
+  {
+    return errc::invalid_argument;
+  }
+  OUTCOME_TRY(auto &&length, section.length());  // length of the backing file
+  if(length < offset + bytes)
+  {
+    return errc::argument_out_of_domain;
+  }
+  result<map_handle> ret{map_handle(&section, _flag)};
+  native_handle_type &nativeh = ret.value()._v;
+  OUTCOME_TRY(auto &&pagesize, detail::pagesize_from_flags(ret.value()._flag));
+  if(pagesize != utils::page_size())
+  {
+    return errc::invalid_argument;
+  }
+  // Reserve address space for both views, then place each into it
+  void *reservation = ::mmap(nullptr, bytes * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if(MAP_FAILED == reservation)
+  {
+    return posix_error();
+  }
+  auto *addr = static_cast<byte *>(reservation);
+  for(size_t n = 0; n < 2; n++)
+  {
+    size_type _bytes = bytes;
+    auto placed = do_mmap(nativeh, addr + n * bytes, MAP_FIXED, &section, pagesize, _bytes, offset, ret.value()._flag & ~section_handle::flag::prefer_large_pages);
+    if(!placed)
+    {
+      ::munmap(reservation, bytes * 2);
+      return std::move(placed).error();
+    }
+  }
+  ret.value()._addr = addr;
+  ret.value()._offset = offset;
+  ret.value()._reservation = bytes * 2;
+  ret.value()._length = bytes * 2;
+  ret.value()._pagesize = pagesize;
+  // Make my handle borrow the native handle of my backing storage
+  ret.value()._v.fd = section.native_handle().fd;
+  nativeh.behaviour |= native_handle_type::disposition::allocation;
+  LLFIO_LOG_FUNCTION_CALL(&ret);
   return ret;
 }
 
@@ -527,9 +888,11 @@ result<map_handle::buffer_type> map_handle::commit(buffer_type region, section_h
   }
   // Set permissions on the pages
   region = utils::round_to_page_size_larger(region, _pagesize);
+  _recyclable = false;
   extent_type offset = _offset + (region.data() - _addr);
   size_type bytes = region.size();
-  OUTCOME_TRYV(do_mmap(_v, region.data(), MAP_FIXED, _section, _pagesize, bytes, offset, flag));
+  // Remapping loses any large page advice, so reapply it
+  OUTCOME_TRYV(do_mmap(_v, region.data(), MAP_FIXED, _section, _pagesize, bytes, offset, flag | (_flag & section_handle::flag::prefer_large_pages)));
   // Tell the kernel we will be using these pages soon
   if(-1 == ::madvise(region.data(), region.size(), MADV_WILLNEED))
   {
@@ -546,6 +909,7 @@ result<map_handle::buffer_type> map_handle::decommit(buffer_type region) noexcep
     return errc::invalid_argument;
   }
   region = utils::round_to_page_size_larger(region, _pagesize);
+  _recyclable = false;
   // If decommitting a mapped file, tell the kernel to kick these pages back to storage
   if(_section != nullptr && -1 == ::madvise(region.data(), region.size(), MADV_DONTNEED))
   {
@@ -606,6 +970,90 @@ result<span<map_handle::buffer_type>> map_handle::prefetch(span<buffer_type> reg
   return regions;
 }
 
+result<void> map_handle::set_numa_placement(buffer_type region, numa_placement placement) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(0);
+  region = utils::round_to_page_size_larger(region, utils::page_size());
+  if(region.data() == nullptr)
+  {
+    return errc::invalid_argument;
+  }
+  return detail::map_handle_apply_numa_placement(region.data(), region.size(), placement, true);
+}
+
+namespace detail
+{
+  inline result<void> map_handle_prefetch_batch(span<map_handle::buffer_type> regions) noexcept
+  {
+#if defined(__linux__) && defined(SYS_process_madvise) && defined(SYS_pidfd_open)
+    // Deliberately leaked. A forked child must not use its parent's pidfd.
+    static const pid_t mypid = ::getpid();
+    static const int mypidfd = (int) ::syscall(SYS_pidfd_open, mypid, 0);
+    static std::atomic<bool> have_process_madvise(mypidfd != -1);
+    if(have_process_madvise.load(std::memory_order_relaxed) && ::getpid() == mypid)
+    {
+      while(!regions.empty())
+      {
+        // buffer_type matches struct iovec, and a single call takes up to UIO_MAXIOV of them
+        const size_t batch = std::min(regions.size(), (size_t) 1024);
+        if(-1 == ::syscall(SYS_process_madvise, mypidfd, regions.data(), batch, MADV_WILLNEED, 0))
+        {
+          if(errno != ENOSYS && errno != EINVAL && errno != EPERM)
+          {
+            return posix_error();
+          }
+          // Kernels before 5.10 lack process_madvise(), and some disallow it by policy
+          have_process_madvise.store(false, std::memory_order_relaxed);
+          break;
+        }
+        regions = regions.subspan(batch);
+      }
+    }
+#endif
+    for(auto &region : regions)
+    {
+      if(-1 == ::madvise(region.data(), region.size(), MADV_WILLNEED))
+      {
+        return posix_error();
+      }
+    }
+    return success();
+  }
+}  // namespace detail
+
+result<map_handle::size_type> map_handle::prefetch_state::bytes_resident() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(0);
+#ifdef __linux__
+  using mincore_vec_type = unsigned char;
+#else
+  using mincore_vec_type = char;
+#endif
+  const size_t pagesize = utils::page_size();
+  size_type ret = 0;
+  for(auto &region : _regions)
+  {
+    for(size_t offset = 0; offset < region.size();)
+    {
+      mincore_vec_type vec[1024];
+      const size_t bytes = std::min(region.size() - offset, sizeof(vec) * pagesize);
+      if(-1 == ::mincore(region.data() + offset, bytes, vec))
+      {
+        return posix_error();
+      }
+      for(size_t n = 0; n < bytes / pagesize; n++)
+      {
+        if((vec[n] & 1) != 0)
+        {
+          ret += pagesize;
+        }
+      }
+      offset += bytes;
+    }
+  }
+  return ret;
+}
+
 result<map_handle::buffer_type> map_handle::do_not_store(buffer_type region) noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(0);
@@ -671,6 +1119,7 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_write(io_r
   }
   byte *addr = _addr + reqs.offset;
   size_type togo = reqs.offset < _length ? static_cast<size_type>(_length - reqs.offset) : 0;
+  const bool nontemporal = !!(_flag & section_handle::flag::nontemporal_writes);
   if(QUICKCPPLIB_NAMESPACE::signal_guard::signal_guard(
      QUICKCPPLIB_NAMESPACE::signal_guard::signalc_set::undefined_memory_access,
      [&] {
@@ -679,14 +1128,14 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_write(io_r
          const_buffer_type &req = reqs.buffers[i];
          if(req.size() > togo)
          {
-           memcpy(addr, req.data(), togo);
+           detail::map_handle_copy_in(addr, req.data(), togo, nontemporal);
            req = {addr, togo};
            reqs.buffers = {reqs.buffers.data(), i + 1};
            return false;
          }
          else
          {
-           memcpy(addr, req.data(), req.size());
+           detail::map_handle_copy_in(addr, req.data(), req.size(), nontemporal);
            req = {addr, req.size()};
            addr += req.size();
            togo -= req.size();
@@ -707,6 +1156,10 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_write(io_r
   {
     return errc::no_space_on_device;
   }
+  for(const auto &req : reqs.buffers)
+  {
+    mark_dirty(req);
+  }
   return reqs.buffers;
 }
 
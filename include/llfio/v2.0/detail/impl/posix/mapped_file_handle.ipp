@@ -58,9 +58,19 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
   {
     mapflags |= section_handle::flag::write;
   }
-  OUTCOME_TRYV(_mh.close());
+  if(_mh.is_valid() && _mh.address() != nullptr)
+  {
+    // Resizing the existing map in place keeps address() unchanged, and avoids tearing down the whole map.
+    // Relocating with mremap() would unmap the old address from under any readers with it pinned.
+    if(_mh.truncate(reservation, false))
+    {
+      _publish_length();
+      _reservation = reservation;
+      return _reservation;
+    }
+  }
   OUTCOME_TRY(auto &&mh, map_handle::map(_sh, reservation, 0, mapflags));
-  _mh = std::move(mh);
+  OUTCOME_TRYV(_publish_map(std::move(mh)));
   _reservation = reservation;
   return _reservation;
 }
@@ -68,6 +78,7 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
 result<void> mapped_file_handle::close() noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRYV(_close_epochs());
   if(_mh.is_valid())
   {
     OUTCOME_TRYV(_mh.close());
@@ -81,6 +92,7 @@ result<void> mapped_file_handle::close() noexcept
 native_handle_type mapped_file_handle::release() noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
+  (void) _close_epochs();
   if(_mh.is_valid())
   {
     (void) _mh.close();
@@ -99,6 +111,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
   if(newsize == 0)
   {
     OUTCOME_TRYV(_mh.close());
+    _publish_length();
     OUTCOME_TRYV(_sh.close());
     return file_handle::truncate(newsize);
   }
@@ -107,7 +120,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
     OUTCOME_TRY(auto &&ret, file_handle::truncate(newsize));
     if(newsize > _reservation)
     {
-      _reservation = newsize;
+      _reservation = _grown_reservation(newsize);
     }
     // Reserve now we have resized, it'll create a new section for the new size
     OUTCOME_TRYV(reserve(_reservation));
@@ -127,21 +140,23 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
     }
     // Resize the file, on unified page cache kernels it'll map any new pages into the reserved map
     OUTCOME_TRYV(file_handle::truncate(newsize));
-    // Have we exceeded the reservation? If so, reserve a new reservation which will recreate the map.
+    // Have we exceeded the reservation? If so, grow the reservation geometrically so appends rarely remap.
     if(newsize > _reservation)
     {
-      OUTCOME_TRY(auto &&ret, reserve(newsize));
-      return ret;
+      OUTCOME_TRYV(reserve(_grown_reservation(newsize)));
+      return newsize;
     }
     size = newsize;
   }
   // Adjust the map to reflect the new size of the section
   _mh._length = size;
+  _publish_length();
   return newsize;
 }
 
 result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcept
 {
+  OUTCOME_TRYV(_reclaim_retired_map());
   OUTCOME_TRY(auto &&length, underlying_file_maximum_extent());
   if(length > _reservation)
   {
@@ -151,6 +166,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
   if(length == 0)
   {
     OUTCOME_TRYV(_mh.close());
+    _publish_length();
     OUTCOME_TRYV(_sh.close());
     return length;
   }
@@ -161,6 +177,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
   }
   // Adjust the map to reflect the new size of the section
   _mh._length = length;
+  _publish_length();
   return length;
 }
 
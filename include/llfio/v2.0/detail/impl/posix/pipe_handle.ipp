@@ -25,9 +25,14 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../../pipe_handle.hpp"
 #include "import.hpp"
 
+#include <climits>  // for IOV_MAX
+#include <poll.h>
+#include <sys/ioctl.h>  // for FIONREAD
+#include <sys/uio.h>    // for vmsplice
+
 LLFIO_V2_NAMESPACE_BEGIN
 
-result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_handle::mode _mode, pipe_handle::creation _creation, pipe_handle::caching _caching, pipe_handle::flag flags, const path_handle &base) noexcept
+result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_handle::mode _mode, pipe_handle::creation _creation, pipe_handle::caching _caching, pipe_handle::flag flags, const path_handle &base, size_t buffer_size) noexcept
 {
   result<pipe_handle> ret(pipe_handle(native_handle_type(), 0, 0, _caching, flags, nullptr));
   native_handle_type &nativeh = ret.value()._v;
@@ -124,10 +129,18 @@ result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_han
   {
     return posix_error();
   }
+#ifdef __linux__
+  if(buffer_size != 0)
+  {
+    OUTCOME_TRY(ret.value().set_buffer_size(buffer_size));
+  }
+#else
+  (void) buffer_size;
+#endif
   return ret;
 }
 
-result<std::pair<pipe_handle, pipe_handle>> pipe_handle::anonymous_pipe(caching _caching, flag flags) noexcept
+result<std::pair<pipe_handle, pipe_handle>> pipe_handle::anonymous_pipe(caching _caching, flag flags, size_t buffer_size) noexcept
 {
   result<std::pair<pipe_handle, pipe_handle>> ret(pipe_handle(native_handle_type(), 0, 0, _caching, flags, nullptr), pipe_handle(native_handle_type(), 0, 0, _caching, flags, nullptr));
   native_handle_type &readnativeh = ret.value().first._v, &writenativeh = ret.value().second._v;
@@ -174,7 +187,181 @@ result<std::pair<pipe_handle, pipe_handle>> pipe_handle::anonymous_pipe(caching
 #endif
   readnativeh.fd = pipefds[0];
   writenativeh.fd = pipefds[1];
+#ifdef __linux__
+  if(buffer_size != 0)
+  {
+    OUTCOME_TRY(ret.value().first.set_buffer_size(buffer_size));
+  }
+#else
+  (void) buffer_size;
+#endif
+  return ret;
+}
+
+result<size_t> pipe_handle::buffer_size() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#ifdef __linux__
+  LLFIO_TRACE_SYSCALL(this, "fcntl");
+  const int ret = ::fcntl(_v.fd, F_GETPIPE_SZ);
+  if(-1 == ret)
+  {
+    return posix_error();
+  }
+  return static_cast<size_t>(ret);
+#else
+  return errc::operation_not_supported;
+#endif
+}
+
+result<size_t> pipe_handle::set_buffer_size(size_t bytes) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+#ifdef __linux__
+  if(bytes > static_cast<size_t>(INT_MAX))
+  {
+    return errc::invalid_argument;
+  }
+  LLFIO_TRACE_SYSCALL(this, "fcntl");
+  const int ret = ::fcntl(_v.fd, F_SETPIPE_SZ, static_cast<int>(bytes));
+  if(-1 == ret)
+  {
+    return posix_error();
+  }
+  return static_cast<size_t>(ret);
+#else
+  (void) bytes;
+  return errc::operation_not_supported;
+#endif
+}
+
+result<size_t> pipe_handle::bytes_available() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  int available = 0;
+  LLFIO_TRACE_SYSCALL(this, "ioctl");
+  if(-1 == ::ioctl(_v.fd, FIONREAD, &available))
+  {
+    return posix_error();
+  }
+  return static_cast<size_t>(available);
+}
+
+#ifdef __linux__
+namespace detail
+{
+  // Retries op whilst it would block, polling the pipe for events until the deadline
+  template <class F> inline result<size_t> pipe_handle_splice_loop(const pipe_handle &h, short events, deadline d, F &&op) noexcept
+  {
+    if(d && !h.is_nonblocking())
+    {
+      return errc::not_supported;
+    }
+    LLFIO_POSIX_DEADLINE_TO_SLEEP_INIT(d);
+    for(;;)
+    {
+      const ssize_t moved = op();
+      if(moved >= 0)
+      {
+        return static_cast<size_t>(moved);
+      }
+      if(EWOULDBLOCK != errno && EAGAIN != errno)
+      {
+        return posix_error();
+      }
+      if(!d || !d.steady || d.nsecs != 0)
+      {
+        LLFIO_POSIX_DEADLINE_TO_SLEEP_LOOP(d);
+        int mstimeout = (timeout == nullptr) ? -1 : (timeout->tv_sec * 1000 + timeout->tv_nsec / 1000000LL);
+        pollfd p;
+        memset(&p, 0, sizeof(p));
+        p.fd = h.native_handle().fd;
+        p.events = events | POLLERR;
+        LLFIO_TRACE_SYSCALL(&h, "poll");
+        if(-1 == ::poll(&p, 1, mstimeout))
+        {
+          return posix_error();
+        }
+      }
+      LLFIO_POSIX_DEADLINE_TO_TIMEOUT_LOOP(d);
+    }
+  }
+}  // namespace detail
+
+result<size_t> pipe_handle::splice_from(io_handle &src, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const unsigned flags = SPLICE_F_MOVE | (is_nonblocking() ? SPLICE_F_NONBLOCK : 0);
+  return detail::pipe_handle_splice_loop(*this, POLLOUT, d, [&]() -> ssize_t {
+    loff_t off_in = offset;
+    LLFIO_TRACE_SYSCALL(this, "splice");
+    return ::splice(src.native_handle().fd, src.is_seekable() ? &off_in : nullptr, _v.fd, nullptr, bytes, flags);
+  });
+}
+
+result<size_t> pipe_handle::splice_to(io_handle &dest, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const unsigned flags = SPLICE_F_MOVE | (is_nonblocking() ? SPLICE_F_NONBLOCK : 0);
+  const bool useoffset = dest.is_seekable() && !dest.native_handle().is_append_only();
+  return detail::pipe_handle_splice_loop(*this, POLLIN, d, [&]() -> ssize_t {
+    loff_t off_out = offset;
+    LLFIO_TRACE_SYSCALL(this, "splice");
+    return ::splice(_v.fd, nullptr, dest.native_handle().fd, useoffset ? &off_out : nullptr, bytes, flags);
+  });
+}
+
+result<size_t> pipe_handle::tee_to(pipe_handle &dest, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const unsigned flags = is_nonblocking() ? SPLICE_F_NONBLOCK : 0;
+  return detail::pipe_handle_splice_loop(*this, POLLIN, d, [&]() -> ssize_t {
+    LLFIO_TRACE_SYSCALL(this, "tee");
+    return ::tee(_v.fd, dest.native_handle().fd, bytes, flags);
+  });
+}
+
+result<size_t> pipe_handle::splice_from(const_buffers_type buffers, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const unsigned flags = is_nonblocking() ? SPLICE_F_NONBLOCK : 0;
+  // Any excess buffers are left for the caller to retry, as with a partial write
+  const size_t count = (std::min)(buffers.size(), static_cast<size_t>(IOV_MAX));
+  return detail::pipe_handle_splice_loop(*this, POLLOUT, d, [&]() -> ssize_t {
+    LLFIO_TRACE_SYSCALL(this, "vmsplice");
+    return ::vmsplice(_v.fd, reinterpret_cast<const struct iovec *>(buffers.data()), count, flags);
+  });
+}
+#else
+result<size_t> pipe_handle::splice_from(io_handle &src, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::pipe_handle_splice_copy(*this, 0, src, offset, bytes, d);
+}
+
+result<size_t> pipe_handle::splice_to(io_handle &dest, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::pipe_handle_splice_copy(dest, offset, *this, 0, bytes, d);
+}
+
+result<size_t> pipe_handle::tee_to(pipe_handle & /*unused*/, size_t /*unused*/, deadline /*unused*/) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return errc::operation_not_supported;
+}
+
+result<size_t> pipe_handle::splice_from(const_buffers_type buffers, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(auto &&written, write({buffers, 0}, d));
+  size_t ret = 0;
+  for(auto &i : written)
+  {
+    ret += i.size();
+  }
   return ret;
 }
+#endif
 
 LLFIO_V2_NAMESPACE_END
@@ -26,9 +26,13 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "import.hpp"
 
+#include <poll.h>
 #include <signal.h>  // for siginfo_t
 #include <spawn.h>
 #include <sys/wait.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #ifdef __FreeBSD__
 #include <sys/sysctl.h>
@@ -194,7 +198,158 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC const process_handle &process_handle::current()
   return self;
 }
 
+namespace detail
+{
+  // The environment as the array of pointers which posix_spawn() needs
+  struct posix_process_environment
+  {
+    using small_path_view_c_str = path_view::c_str<filesystem::path::value_type, std::default_delete<filesystem::path::value_type[]>, 1>;
+    std::vector<small_path_view_c_str> envs;
+    std::vector<const char *> ptrs;
+
+    explicit posix_process_environment(span<path_view_component> env)
+    {
+      envs.reserve(env.size());
+      ptrs.reserve(env.size() + 1);
+      for(const auto &i : env)
+      {
+        envs.emplace_back(i);
+        ptrs.push_back(envs.back().buffer);
+      }
+      ptrs.push_back(nullptr);
+    }
+  };
+}  // namespace detail
+
 LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> process_handle::launch_process(path_view path, span<path_view_component> args, span<path_view_component> env, flag flags) noexcept
+{
+  try
+  {
+    detail::posix_process_environment envp(env);
+    return _launch_process(path, args, envp.ptrs.data(), flags);
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::vector<process_handle>> process_handle::launch_processes(span<const launch_request> reqs, span<path_view_component> env) noexcept
+{
+  try
+  {
+    detail::posix_process_environment envp(env);
+    std::vector<process_handle> ret;
+    ret.reserve(reqs.size());
+    for(const auto &req : reqs)
+    {
+      OUTCOME_TRY(auto &&h, _launch_process(req.path, req.args, envp.ptrs.data(), req.flags));
+      ret.push_back(std::move(h));
+    }
+    return ret;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> process_handle::wait_all(span<const process_handle> processes, span<intptr_t> exitcodes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(0);
+  if(exitcodes.size() < processes.size())
+  {
+    return errc::invalid_argument;
+  }
+#ifdef __linux__
+  try
+  {
+    pollfd unopened;
+    memset(&unopened, 0, sizeof(unopened));
+    unopened.fd = -1;
+    std::vector<pollfd> fds(processes.size(), unopened);
+    auto closefds = make_scope_exit([&]() noexcept {
+      for(auto &i : fds)
+      {
+        if(i.fd >= 0)
+          ::close(i.fd);
+      }
+    });
+    (void) closefds;
+    bool have_pidfds = true;
+    for(size_t n = 0; n < processes.size(); n++)
+    {
+      fds[n].fd = static_cast<int>(::syscall(434 /*__NR_pidfd_open*/, processes[n].native_handle().pid, 0));
+      fds[n].events = POLLIN;
+      if(fds[n].fd < 0)
+      {
+        if(ENOSYS != errno)
+        {
+          return posix_error();
+        }
+        // Kernels before 5.3 must poll each process in turn
+        have_pidfds = false;
+        break;
+      }
+    }
+    if(have_pidfds)
+    {
+      LLFIO_POSIX_DEADLINE_TO_SLEEP_INIT(d);
+      size_t remaining = processes.size();
+      while(remaining > 0)
+      {
+        LLFIO_POSIX_DEADLINE_TO_SLEEP_LOOP(d);
+        int mstimeout = (timeout == nullptr) ? -1 : (timeout->tv_sec * 1000 + timeout->tv_nsec / 1000000LL);
+        if(-1 == ::poll(fds.data(), fds.size(), mstimeout))
+        {
+          if(EINTR == errno)
+            continue;
+          return posix_error();
+        }
+        for(size_t n = 0; n < fds.size(); n++)
+        {
+          if(fds[n].fd >= 0 && (fds[n].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+          {
+            siginfo_t info;
+            memset(&info, 0, sizeof(info));
+            if(-1 == ::waitid(P_PID, processes[n].native_handle().pid, &info, WEXITED))
+            {
+              return posix_error();
+            }
+            exitcodes[n] = info.si_status;
+            ::close(fds[n].fd);
+            fds[n].fd = -1;  // poll() ignores negative fds
+            --remaining;
+          }
+        }
+        if(remaining > 0)
+        {
+          LLFIO_POSIX_DEADLINE_TO_TIMEOUT_LOOP(d);
+        }
+      }
+      return success();
+    }
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+#endif
+  // Share the deadline amongst all the waits
+  deadline nd(d);
+  if(d && d.steady)
+  {
+    nd = deadline(std::chrono::system_clock::now() + std::chrono::nanoseconds(d.nsecs));
+  }
+  for(size_t n = 0; n < processes.size(); n++)
+  {
+    OUTCOME_TRY(auto &&exitcode, processes[n].wait(nd));
+    exitcodes[n] = exitcode;
+  }
+  return success();
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> process_handle::_launch_process(path_view path, span<path_view_component> args, const void *marshalled_env, flag flags) noexcept
 {
   try
   {
@@ -252,57 +407,25 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> process_handle::launch_pr
       _args.emplace_back(args[n]);
       argptrs[n + 1] = _args[n + 1].buffer;
     }
-    std::vector<small_path_view_c_str> _envs;
-    std::vector<const char *> envptrs;
-    _envs.reserve(env.size());
-    envptrs.reserve(env.size() + 1);
-    for(const auto &i : env)
-    {
-      _envs.emplace_back(i);
-      envptrs.push_back(_envs.back().buffer);
-    }
-    envptrs.push_back(nullptr);
-#if 0
-    ret._processh.fd = ::fork();
-    if(0 == ret._processh.fd)
-    {
-      // I am the child
-      if(-1 == ::dup2(childinpipe.native_handle().fd, STDIN_FILENO))
-      {
-        ::perror("dup2 readh");
-        ::exit(1);
-      }
-      ::close(childreadh.fd);
-      if(-1 == ::dup2(childwriteh.fd, STDOUT_FILENO))
-      {
-        ::perror("dup2 writeh");
-        ::exit(1);
-      }
-      ::close(childwriteh.fd);
-      if(!use_parent_errh)
-      {
-        if(-1 == ::dup2(childerrh.fd, STDERR_FILENO))
-        {
-          ::perror("dup2 errh");
-          ::exit(1);
-        }
-        ::close(childerrh.fd);
-      }
-      if(-1 == ::execve(ret._path.c_str(), (char **) argptrs.data(), (char **) envptrs.data()))
-      {
-        ::perror("execve");
-        ::exit(1);
-      }
-    }
-    if(-1 == ret._processh.fd)
-      return posix_error();
-#else
+    // posix_spawn() never copies the page tables of this process as fork() does, and so
+    // costs the same no matter how much memory this process has mapped
+    const bool redirecting = childinpipe.is_valid() || childoutpipe.is_valid() || childerrorpipe.is_valid();
     posix_spawn_file_actions_t child_fd_actions;
-    if(childinpipe.is_valid() || childoutpipe.is_valid() || childerrorpipe.is_valid())
+    posix_spawnattr_t child_attrs;
+    bool have_fd_actions = false, have_attrs = false;
+    auto destroy_spawn_args = make_scope_exit([&]() noexcept {
+      if(have_fd_actions)
+        ::posix_spawn_file_actions_destroy(&child_fd_actions);
+      if(have_attrs)
+        ::posix_spawnattr_destroy(&child_attrs);
+    });
+    (void) destroy_spawn_args;
+    if(redirecting)
     {
       int err = ::posix_spawn_file_actions_init(&child_fd_actions);
       if(err)
         return posix_error(err);
+      have_fd_actions = true;
       if(childinpipe.is_valid())
       {
         err = ::posix_spawn_file_actions_adddup2(&child_fd_actions, childinpipe.native_handle().fd, STDIN_FILENO);
@@ -331,14 +454,24 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> process_handle::launch_pr
           return posix_error(err);
       }
     }
-    int err = ::posix_spawn(&nativeh.pid, argptrs[0], (childinpipe.is_valid() || childoutpipe.is_valid() || childerrorpipe.is_valid()) ? &child_fd_actions : nullptr, nullptr, (char **) argptrs.data(), (char **) envptrs.data());
-    if(err)
-      return posix_error(err);
-    if(childinpipe.is_valid() || childoutpipe.is_valid() || childerrorpipe.is_valid())
+#if defined(__GLIBC__) && defined(POSIX_SPAWN_USEVFORK)
+#if !__GLIBC_PREREQ(2, 24)
+    // Before 2.24 glibc only uses vfork() if asked, or if no file actions nor attributes
+    // are supplied. Since 2.24, it always uses clone(CLONE_VM|CLONE_VFORK).
     {
-      ::posix_spawn_file_actions_destroy(&child_fd_actions);
+      int err = ::posix_spawnattr_init(&child_attrs);
+      if(err)
+        return posix_error(err);
+      have_attrs = true;
+      err = ::posix_spawnattr_setflags(&child_attrs, POSIX_SPAWN_USEVFORK);
+      if(err)
+        return posix_error(err);
     }
 #endif
+#endif
+    int err = ::posix_spawn(&nativeh.pid, argptrs[0], have_fd_actions ? &child_fd_actions : nullptr, have_attrs ? &child_attrs : nullptr, (char **) argptrs.data(), (char **) marshalled_env);
+    if(err)
+      return posix_error(err);
     return ret;
   }
   catch(...)
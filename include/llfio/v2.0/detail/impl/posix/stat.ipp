@@ -23,16 +23,21 @@ Distributed under the Boost Software License, Version 1.0.
 */
 
 #include "../../../handle.hpp"
+#include "../../../path_handle.hpp"
 #include "../../../stat.hpp"
 
+#include <fcntl.h>
 #include <sys/stat.h>
 
 #ifdef __linux__
-#include <fcntl.h>
+#include "io_uring_metadata_ring.ipp"
+
 #include <sys/syscall.h>
 #include <sys/sysmacros.h>
 #endif
 
+#include <vector>
+
 LLFIO_V2_NAMESPACE_BEGIN
 
 namespace detail
@@ -86,55 +91,57 @@ inline struct timespec from_timepoint(std::chrono::system_clock::time_point time
   return {static_cast<time_t>(duration.count() / STL_TICKS_PER_SEC), static_cast<long int>((duration.count() % STL_TICKS_PER_SEC) * divider / multiplier)};
 }
 
-LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> stat_t::fill(const handle &h, stat_t::want wanted) noexcept
+namespace detail
 {
-  LLFIO_LOG_FUNCTION_CALL(&h);
-  size_t ret = 0;
 #ifdef __linux__
+  struct linux_statx_timestamp_t
   {
-    struct statx_timestamp
-    {
-      int64_t tv_sec;   /* Seconds since the Epoch (UNIX time) */
-      uint32_t tv_nsec; /* Nanoseconds since tv_sec */
-      uint32_t __reserved;
-    };
-    struct statx
-    {
-      uint32_t stx_mask;       /* Mask of bits indicating
-                               filled fields */
-      uint32_t stx_blksize;    /* Block size for filesystem I/O */
-      uint64_t stx_attributes; /* Extra file attribute indicators */
-      uint32_t stx_nlink;      /* Number of hard links */
-      uint32_t stx_uid;        /* User ID of owner */
-      uint32_t stx_gid;        /* Group ID of owner */
-      uint16_t stx_mode;       /* File type and mode */
-      uint16_t __spare0[1];
-      uint64_t stx_ino;    /* Inode number */
-      uint64_t stx_size;   /* Total size in bytes */
-      uint64_t stx_blocks; /* Number of 512B blocks allocated */
-      uint64_t stx_attributes_mask;
-      /* Mask to show what's supported
-         in stx_attributes */
+    int64_t tv_sec;   /* Seconds since the Epoch (UNIX time) */
+    uint32_t tv_nsec; /* Nanoseconds since tv_sec */
+    uint32_t __reserved;
+  };
+  struct linux_statx_t
+  {
+    uint32_t stx_mask;       /* Mask of bits indicating
+                             filled fields */
+    uint32_t stx_blksize;    /* Block size for filesystem I/O */
+    uint64_t stx_attributes; /* Extra file attribute indicators */
+    uint32_t stx_nlink;      /* Number of hard links */
+    uint32_t stx_uid;        /* User ID of owner */
+    uint32_t stx_gid;        /* Group ID of owner */
+    uint16_t stx_mode;       /* File type and mode */
+    uint16_t __spare0[1];
+    uint64_t stx_ino;    /* Inode number */
+    uint64_t stx_size;   /* Total size in bytes */
+    uint64_t stx_blocks; /* Number of 512B blocks allocated */
+    uint64_t stx_attributes_mask;
+    /* Mask to show what's supported
+       in stx_attributes */
+
+    /* The following fields are file timestamps */
+    struct linux_statx_timestamp_t stx_atime; /* Last access */
+    struct linux_statx_timestamp_t stx_btime; /* Creation */
+    struct linux_statx_timestamp_t stx_ctime; /* Last status change */
+    struct linux_statx_timestamp_t stx_mtime; /* Last modification */
 
-      /* The following fields are file timestamps */
-      struct statx_timestamp stx_atime; /* Last access */
-      struct statx_timestamp stx_btime; /* Creation */
-      struct statx_timestamp stx_ctime; /* Last status change */
-      struct statx_timestamp stx_mtime; /* Last modification */
+    /* If this file represents a device, then the next two
+       fields contain the ID of the device */
+    uint32_t stx_rdev_major; /* Major ID */
+    uint32_t stx_rdev_minor; /* Minor ID */
 
-      /* If this file represents a device, then the next two
-         fields contain the ID of the device */
-      uint32_t stx_rdev_major; /* Major ID */
-      uint32_t stx_rdev_minor; /* Minor ID */
+    /* The next two fields contain the ID of the device
+       containing the filesystem where the file resides */
+    uint32_t stx_dev_major; /* Major ID */
+    uint32_t stx_dev_minor; /* Minor ID */
 
-      /* The next two fields contain the ID of the device
-         containing the filesystem where the file resides */
-      uint32_t stx_dev_major; /* Major ID */
-      uint32_t stx_dev_minor; /* Minor ID */
+    uint64_t __spare2[14];
+  };
+  static_assert(sizeof(linux_statx_t) == 256, "linux_statx_t is not the size the kernel expects");
 
-      uint64_t __spare2[14];
-    } s;
-    memset(&s, 0, sizeof(s));
+  // Returns the statx() mask needed for the wanted items
+  inline unsigned statx_mask_from_want(stat_t::want wanted) noexcept
+  {
+    using want = stat_t::want;
     unsigned mask = 0;
     if(wanted & want::dev)
     {
@@ -200,280 +207,421 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> stat_t::fill(const handle &h, sta
     {
       mask |= 0x0800U /*STATX_BTIME*/;
     }
-    int flags = AT_EMPTY_PATH | AT_NO_AUTOMOUNT | AT_SYMLINK_NOFOLLOW | 0x0000 /*AT_STATX_SYNC_AS_STAT*/;
-    int fd = h.native_handle().fd;
-    if(
+    return mask;
+  }
+
+  // Fills the wanted items of out from s, returning the number of items filled
+  inline size_t stat_fill_from_statx(stat_t &out, const linux_statx_t &s, stat_t::want wanted) noexcept
+  {
+    using want = stat_t::want;
+    size_t ret = 0;
+    if(wanted & want::dev)
+    {
+      out.st_dev = makedev(s.stx_dev_major, s.stx_dev_minor);
+      ++ret;
+    }
+    if(wanted & want::ino)
+    {
+      out.st_ino = s.stx_ino;
+      ++ret;
+    }
+    if(wanted & want::type)
+    {
+      out.st_type = to_st_type(s.stx_mode);
+      ++ret;
+    }
+    if(wanted & want::perms)
+    {
+      out.st_perms = s.stx_mode & 0xfff;
+      ++ret;
+    }
+    if(wanted & want::nlink)
+    {
+      out.st_nlink = s.stx_nlink;
+      ++ret;
+    }
+    if(wanted & want::uid)
+    {
+      out.st_uid = s.stx_uid;
+      ++ret;
+    }
+    if(wanted & want::gid)
+    {
+      out.st_gid = s.stx_gid;
+      ++ret;
+    }
+    if(wanted & want::rdev)
+    {
+      out.st_rdev = makedev(s.stx_rdev_major, s.stx_rdev_minor);
+      ++ret;
+    }
+    if(wanted & want::atim)
+    {
+      out.st_atim = to_timepoint(timespec{s.stx_atime.tv_sec, s.stx_atime.tv_nsec});
+      ++ret;
+    }
+    if(wanted & want::mtim)
+    {
+      out.st_mtim = to_timepoint(timespec{s.stx_mtime.tv_sec, s.stx_mtime.tv_nsec});
+      ++ret;
+    }
+    if(wanted & want::ctim)
+    {
+      out.st_ctim = to_timepoint(timespec{s.stx_ctime.tv_sec, s.stx_ctime.tv_nsec});
+      ++ret;
+    }
+    if(wanted & want::size)
+    {
+      out.st_size = s.stx_size;
+      ++ret;
+    }
+    if(wanted & want::allocated)
+    {
+      out.st_allocated = static_cast<handle::extent_type>(s.stx_blocks) * 512;
+      ++ret;
+    }
+    if(wanted & want::blocks)
+    {
+      out.st_blocks = s.stx_blocks;
+      ++ret;
+    }
+    if(wanted & want::blksize)
+    {
+      out.st_blksize = s.stx_blksize;
+      ++ret;
+    }
+    if(wanted & want::birthtim)
+    {
+      out.st_birthtim = to_timepoint(timespec{s.stx_btime.tv_sec, s.stx_btime.tv_nsec});
+      ++ret;
+    }
+    if(wanted & want::sparse)
+    {
+      out.st_sparse = static_cast<unsigned int>((static_cast<handle::extent_type>(s.stx_blocks) * 512) < static_cast<handle::extent_type>(s.stx_size));
+      ++ret;
+    }
+    if(wanted & want::compressed)
+    {
+      out.st_compressed = static_cast<unsigned int>(s.stx_attributes & 0x0004 /*STATX_ATTR_COMPRESSED*/);
+      ++ret;
+    }
+    return ret;
+  }
+#endif
+
+  /* Fills the wanted items of out for path relative to fd, or for fd itself if path is empty,
+  never following symlinks. If dont_sync is set, network filing systems may return cached
+  metadata rather than revalidating it.
+  */
+  inline result<size_t> stat_fill_at(stat_t &out, const handle *h, int fd, const char *path, stat_t::want wanted, bool dont_sync) noexcept
+  {
+    using want = stat_t::want;
+    size_t ret = 0;
+#ifdef __linux__
+    {
+      linux_statx_t s;
+      memset(&s, 0, sizeof(s));
+      const unsigned mask = statx_mask_from_want(wanted);
+      int flags = AT_NO_AUTOMOUNT | AT_SYMLINK_NOFOLLOW | (dont_sync ? 0x4000 /*AT_STATX_DONT_SYNC*/ : 0x0000 /*AT_STATX_SYNC_AS_STAT*/);
+      if(path[0] == 0)
+      {
+        flags |= AT_EMPTY_PATH;
+      }
+      if(
 #if defined __aarch64__
-    syscall(291 /*__NR_statx*/, fd, "", flags, mask, &s)
+      syscall(291 /*__NR_statx*/, fd, path, flags, mask, &s)
 #elif defined __arm__
-    syscall(397 /*__NR_statx*/, fd, "", flags, mask, &s)
+      syscall(397 /*__NR_statx*/, fd, path, flags, mask, &s)
 #elif defined __alpha__
-    syscall(522 /*__NR_statx*/, fd, "", flags, mask, &s)
+      syscall(522 /*__NR_statx*/, fd, path, flags, mask, &s)
 #elif defined __i386__ || defined __powerpc64__
-    syscall(383 /*__NR_statx*/, fd, "", flags, mask, &s)
+      syscall(383 /*__NR_statx*/, fd, path, flags, mask, &s)
 #elif defined __sparc__
-    syscall(360 /*__NR_statx*/, fd, "", flags, mask, &s)
+      syscall(360 /*__NR_statx*/, fd, path, flags, mask, &s)
 #elif defined __x86_64__
-    syscall(332 /*__NR_statx*/, fd, "", flags, mask, &s)
+      syscall(332 /*__NR_statx*/, fd, path, flags, mask, &s)
 #else
 #error Unknown Linux platform
 #endif
-    >= 0)
+      >= 0)
+      {
+        return stat_fill_from_statx(out, s, wanted);
+      }
+      // std::cerr << "statx failed with " << strerror(errno) << std::endl;
+    }
+#endif
     {
+      struct stat s
+      {
+      };
+      memset(&s, 0, sizeof(s));
+
+      if(path[0] != 0)
+      {
+        if(-1 == ::fstatat(fd, path, &s, AT_SYMLINK_NOFOLLOW))
+        {
+          return posix_error();
+        }
+      }
+      else if(-1 == ::fstat(fd, &s))
+      {
+        if(h == nullptr || !h->is_symlink() || EBADF != errno)
+        {
+          return posix_error();
+        }
+        // This is a hack, but symlink_handle includes this first so there is a chicken and egg dependency problem
+        OUTCOME_TRY(stat_from_symlink(s, *h));
+      }
       if(wanted & want::dev)
       {
-        st_dev = makedev(s.stx_dev_major, s.stx_dev_minor);
+        out.st_dev = s.st_dev;
         ++ret;
       }
       if(wanted & want::ino)
       {
-        st_ino = s.stx_ino;
+        out.st_ino = s.st_ino;
         ++ret;
       }
       if(wanted & want::type)
       {
-        st_type = to_st_type(s.stx_mode);
+        out.st_type = to_st_type(s.st_mode);
         ++ret;
       }
       if(wanted & want::perms)
       {
-        st_perms = s.stx_mode & 0xfff;
+        out.st_perms = s.st_mode & 0xfff;
         ++ret;
       }
       if(wanted & want::nlink)
       {
-        st_nlink = s.stx_nlink;
+        out.st_nlink = s.st_nlink;
         ++ret;
       }
       if(wanted & want::uid)
       {
-        st_uid = s.stx_uid;
+        out.st_uid = s.st_uid;
         ++ret;
       }
       if(wanted & want::gid)
       {
-        st_gid = s.stx_gid;
+        out.st_gid = s.st_gid;
         ++ret;
       }
       if(wanted & want::rdev)
       {
-        st_rdev = makedev(s.stx_rdev_major, s.stx_rdev_minor);
+        out.st_rdev = s.st_rdev;
+        ++ret;
+      }
+#ifdef __ANDROID__
+      if(wanted & want::atim)
+      {
+        out.st_atim = to_timepoint(*((struct timespec *) &s.st_atime));
+        ++ret;
+      }
+      if(wanted & want::mtim)
+      {
+        out.st_mtim = to_timepoint(*((struct timespec *) &s.st_mtime));
+        ++ret;
+      }
+      if(wanted & want::ctim)
+      {
+        out.st_ctim = to_timepoint(*((struct timespec *) &s.st_ctime));
+        ++ret;
+      }
+#elif defined(__APPLE__)
+      if(wanted & want::atim)
+      {
+        out.st_atim = to_timepoint(s.st_atimespec);
+        ++ret;
+      }
+      if(wanted & want::mtim)
+      {
+        out.st_mtim = to_timepoint(s.st_mtimespec);
+        ++ret;
+      }
+      if(wanted & want::ctim)
+      {
+        out.st_ctim = to_timepoint(s.st_ctimespec);
         ++ret;
       }
+#else  // Linux and BSD
       if(wanted & want::atim)
       {
-        st_atim = to_timepoint(timespec{s.stx_atime.tv_sec, s.stx_atime.tv_nsec});
+        out.st_atim = to_timepoint(s.st_atim);
         ++ret;
       }
       if(wanted & want::mtim)
       {
-        st_mtim = to_timepoint(timespec{s.stx_mtime.tv_sec, s.stx_mtime.tv_nsec});
+        out.st_mtim = to_timepoint(s.st_mtim);
         ++ret;
       }
       if(wanted & want::ctim)
       {
-        st_ctim = to_timepoint(timespec{s.stx_ctime.tv_sec, s.stx_ctime.tv_nsec});
+        out.st_ctim = to_timepoint(s.st_ctim);
         ++ret;
       }
+#endif
       if(wanted & want::size)
       {
-        st_size = s.stx_size;
+        out.st_size = s.st_size;
         ++ret;
       }
       if(wanted & want::allocated)
       {
-        st_allocated = static_cast<handle::extent_type>(s.stx_blocks) * 512;
+        out.st_allocated = static_cast<handle::extent_type>(s.st_blocks) * 512;
         ++ret;
       }
       if(wanted & want::blocks)
       {
-        st_blocks = s.stx_blocks;
+        out.st_blocks = s.st_blocks;
         ++ret;
       }
       if(wanted & want::blksize)
       {
-        st_blksize = s.stx_blksize;
+        out.st_blksize = s.st_blksize;
+        ++ret;
+      }
+#ifdef HAVE_STAT_FLAGS
+      if(wanted & want::flags)
+      {
+        out.st_flags = s.st_flags;
         ++ret;
       }
+#endif
+#ifdef HAVE_STAT_GEN
+      if(wanted & want::gen)
+      {
+        out.st_gen = s.st_gen;
+        ++ret;
+      }
+#endif
+#ifdef HAVE_BIRTHTIMESPEC
+#if defined(__APPLE__)
       if(wanted & want::birthtim)
       {
-        st_birthtim = to_timepoint(timespec{s.stx_btime.tv_sec, s.stx_btime.tv_nsec});
+        out.st_birthtim = to_timepoint(s.st_birthtimespec);
         ++ret;
       }
-      if(wanted & want::sparse)
+#else
+      if(wanted & want::birthtim)
       {
-        st_sparse = static_cast<unsigned int>((static_cast<handle::extent_type>(s.stx_blocks) * 512) < static_cast<handle::extent_type>(s.stx_size));
+        out.st_birthtim = to_timepoint(s.st_birthtim);
         ++ret;
       }
-      if(wanted & want::compressed)
+#endif
+#endif
+      if(wanted & want::sparse)
       {
-        st_compressed = static_cast<unsigned int>(s.stx_attributes & 0x0004 /*STATX_ATTR_COMPRESSED*/);
+        out.st_sparse = static_cast<unsigned int>((static_cast<handle::extent_type>(s.st_blocks) * 512) < static_cast<handle::extent_type>(s.st_size));
         ++ret;
       }
       return ret;
     }
-    // std::cerr << "statx failed with " << strerror(errno) << std::endl;
   }
-#endif
-  {
-    struct stat s
-    {
-    };
-    memset(&s, 0, sizeof(s));
+}  // namespace detail
 
-    if(-1 == ::fstat(h.native_handle().fd, &s))
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> stat_t::fill(const handle &h, stat_t::want wanted) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&h);
+  return detail::stat_fill_at(*this, &h, h.native_handle().fd, "", wanted, false);
+}
+
+#ifdef __linux__
+namespace detail
+{
+  // Each kernel thread's io_uring for batching statx(), with its scratch space
+  struct stat_fill_many_uring_t
+  {
+    std::unique_ptr<io_uring_metadata_ring> ring;
+    bool ring_failed{false};
+    std::vector<char> names;
+    std::vector<size_t> nameoffsets;
+    std::vector<linux_statx_t> buffers;
+  };
+  inline stat_fill_many_uring_t *stat_fill_many_uring() noexcept
+  {
+    static thread_local stat_fill_many_uring_t tls;
+    if(!tls.ring && !tls.ring_failed)
     {
-      if(!h.is_symlink() || EBADF != errno)
+      tls.ring.reset(new(std::nothrow) io_uring_metadata_ring);
+      if(!tls.ring || !tls.ring->init(256))
       {
-        return posix_error();
+        // Kernel too old, or io_uring is forbidden by seccomp etc.
+        tls.ring.reset();
+        tls.ring_failed = true;
       }
-      // This is a hack, but symlink_handle includes this first so there is a chicken and egg dependency problem
-      OUTCOME_TRY(detail::stat_from_symlink(s, h));
-    }
-    if(wanted & want::dev)
-    {
-      st_dev = s.st_dev;
-      ++ret;
-    }
-    if(wanted & want::ino)
-    {
-      st_ino = s.st_ino;
-      ++ret;
-    }
-    if(wanted & want::type)
-    {
-      st_type = to_st_type(s.st_mode);
-      ++ret;
-    }
-    if(wanted & want::perms)
-    {
-      st_perms = s.st_mode & 0xfff;
-      ++ret;
-    }
-    if(wanted & want::nlink)
-    {
-      st_nlink = s.st_nlink;
-      ++ret;
-    }
-    if(wanted & want::uid)
-    {
-      st_uid = s.st_uid;
-      ++ret;
-    }
-    if(wanted & want::gid)
-    {
-      st_gid = s.st_gid;
-      ++ret;
-    }
-    if(wanted & want::rdev)
-    {
-      st_rdev = s.st_rdev;
-      ++ret;
-    }
-#ifdef __ANDROID__
-    if(wanted & want::atim)
-    {
-      st_atim = to_timepoint(*((struct timespec *) &s.st_atime));
-      ++ret;
-    }
-    if(wanted & want::mtim)
-    {
-      st_mtim = to_timepoint(*((struct timespec *) &s.st_mtime));
-      ++ret;
-    }
-    if(wanted & want::ctim)
-    {
-      st_ctim = to_timepoint(*((struct timespec *) &s.st_ctime));
-      ++ret;
-    }
-#elif defined(__APPLE__)
-    if(wanted & want::atim)
-    {
-      st_atim = to_timepoint(s.st_atimespec);
-      ++ret;
-    }
-    if(wanted & want::mtim)
-    {
-      st_mtim = to_timepoint(s.st_mtimespec);
-      ++ret;
-    }
-    if(wanted & want::ctim)
-    {
-      st_ctim = to_timepoint(s.st_ctimespec);
-      ++ret;
-    }
-#else  // Linux and BSD
-    if(wanted & want::atim)
-    {
-      st_atim = to_timepoint(s.st_atim);
-      ++ret;
-    }
-    if(wanted & want::mtim)
-    {
-      st_mtim = to_timepoint(s.st_mtim);
-      ++ret;
-    }
-    if(wanted & want::ctim)
-    {
-      st_ctim = to_timepoint(s.st_ctim);
-      ++ret;
-    }
-#endif
-    if(wanted & want::size)
-    {
-      st_size = s.st_size;
-      ++ret;
-    }
-    if(wanted & want::allocated)
-    {
-      st_allocated = static_cast<handle::extent_type>(s.st_blocks) * 512;
-      ++ret;
-    }
-    if(wanted & want::blocks)
-    {
-      st_blocks = s.st_blocks;
-      ++ret;
-    }
-    if(wanted & want::blksize)
-    {
-      st_blksize = s.st_blksize;
-      ++ret;
-    }
-#ifdef HAVE_STAT_FLAGS
-    if(wanted & want::flags)
-    {
-      st_flags = s.st_flags;
-      ++ret;
-    }
-#endif
-#ifdef HAVE_STAT_GEN
-    if(wanted & want::gen)
-    {
-      st_gen = s.st_gen;
-      ++ret;
     }
+    return tls.ring ? &tls : nullptr;
+  }
+}  // namespace detail
 #endif
-#ifdef HAVE_BIRTHTIMESPEC
-#if defined(__APPLE__)
-    if(wanted & want::birthtim)
-    {
-      st_birthtim = to_timepoint(s.st_birthtimespec);
-      ++ret;
-    }
-#else
-    if(wanted & want::birthtim)
-    {
-      st_birthtim = to_timepoint(s.st_birthtim);
-      ++ret;
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> stat_t::fill_many(const path_handle &base, span<fill_many_item> items) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  try
+  {
+    const int dirfd = base.is_valid() ? base.native_handle().fd : AT_FDCWD;
+    auto fill_one = [dirfd](fill_many_item &item) {
+      path_view::recycling_c_str<> zpath(item.leafname);
+      item.stat = stat_t(nullptr);
+      item.filled = detail::stat_fill_at(item.stat, nullptr, dirfd, zpath.buffer, item.wanted, false);
+    };
+#ifdef __linux__
+    auto *u = (items.size() > 1) ? detail::stat_fill_many_uring() : nullptr;
+    if(u != nullptr)
+    {
+      auto &ring = *u->ring;
+      const size_t chunk = ring.capacity();
+      u->nameoffsets.resize(chunk);
+      u->buffers.resize(chunk);
+      for(size_t idx = 0; idx < items.size(); idx += chunk)
+      {
+        const size_t count = (std::min)(chunk, items.size() - idx);
+        u->names.clear();
+        for(size_t n = 0; n < count; n++)
+        {
+          path_view::recycling_c_str<> zpath(items[idx + n].leafname);
+          u->nameoffsets[n] = u->names.size();
+          u->names.insert(u->names.end(), zpath.buffer, zpath.buffer + zpath.length);
+          u->names.push_back(0);
+        }
+        for(size_t n = 0; n < count; n++)
+        {
+          const char *path = u->names.data() + u->nameoffsets[n];
+          memset(&u->buffers[n], 0, sizeof(detail::linux_statx_t));
+          ring.statx(n, dirfd, path, AT_NO_AUTOMOUNT | AT_SYMLINK_NOFOLLOW | ((path[0] == 0) ? AT_EMPTY_PATH : 0),
+                     detail::statx_mask_from_want(items[idx + n].wanted), &u->buffers[n]);
+        }
+        OUTCOME_TRY(ring.submit_and_wait([&](uint64_t n, int res) {
+          auto &item = items[idx + (size_t) n];
+          if(res == -EINVAL)
+          {
+            // Kernels before 5.6 do not implement STATX
+            fill_one(item);
+            return;
+          }
+          item.stat = stat_t(nullptr);
+          if(res < 0)
+          {
+            item.filled = posix_error(-res);
+            return;
+          }
+          item.filled = detail::stat_fill_from_statx(item.stat, u->buffers[(size_t) n], item.wanted);
+        }));
+      }
+      return success();
     }
 #endif
-#endif
-    if(wanted & want::sparse)
+    for(auto &item : items)
     {
-      st_sparse = static_cast<unsigned int>((static_cast<handle::extent_type>(s.st_blocks) * 512) < static_cast<handle::extent_type>(s.st_size));
-      ++ret;
+      fill_one(item);
     }
-    return ret;
+    return success();
+  }
+  catch(...)
+  {
+    return error_from_exception();
   }
 }
 
@@ -29,10 +29,149 @@ Distributed under the Boost Software License, Version 1.0.
 #ifdef __linux__
 #include <mntent.h>
 #include <sys/statfs.h>
+
+#include <map>
+#include <mutex>
 #endif
 
 LLFIO_V2_NAMESPACE_BEGIN
 
+#ifdef __linux__
+namespace detail
+{
+  struct statfs_mount_entry_t
+  {
+    std::string mnt_fsname, mnt_dir, mnt_type, mnt_opts;
+    statfs_mount_entry_t(const char *a, const char *b, const char *c, const char *d)
+        : mnt_fsname(a)
+        , mnt_dir(b)
+        , mnt_type(c)
+        , mnt_opts(d)
+    {
+    }
+  };
+  /* Finding a filing system in the mount table means a statfs() of every mount, so the entry
+  found is cached per filing system and mount flags for a while.
+  */
+  struct statfs_mount_cache_t
+  {
+    struct key_type
+    {
+      int64_t type;
+      uint64_t fsid;
+      uint64_t flags;
+      bool operator<(const key_type &o) const noexcept
+      {
+        return (type != o.type) ? (type < o.type) : ((fsid != o.fsid) ? (fsid < o.fsid) : (flags < o.flags));
+      }
+    };
+    struct value_type
+    {
+      statfs_mount_entry_t entry;
+      std::chrono::steady_clock::time_point found;
+    };
+    static constexpr std::chrono::seconds max_age() noexcept { return std::chrono::seconds(10); }
+
+    std::mutex lock;
+    std::map<key_type, value_type> entries;
+
+    static key_type key(const struct statfs64 &s) noexcept
+    {
+      key_type ret{(int64_t) s.f_type, 0, (uint64_t) s.f_flags};
+      memcpy(&ret.fsid, &s.f_fsid, (std::min)(sizeof(ret.fsid), sizeof(s.f_fsid)));
+      return ret;
+    }
+  };
+  inline statfs_mount_cache_t &statfs_mount_cache()
+  {
+    static statfs_mount_cache_t v;
+    return v;
+  }
+  // Returns the mount table entry for the filing system whose statfs is s
+  inline result<statfs_mount_entry_t> statfs_find_mount_entry(const struct statfs64 &s)
+  {
+    auto &cache = statfs_mount_cache();
+    const auto key = statfs_mount_cache_t::key(s);
+    const auto now = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> g(cache.lock);
+      auto it = cache.entries.find(key);
+      if(it != cache.entries.end() && now - it->second.found < statfs_mount_cache_t::max_age())
+      {
+        return it->second.entry;
+      }
+    }
+    std::vector<std::pair<statfs_mount_entry_t, struct statfs64>> mountentries;
+    {
+      // Need to parse mount options on Linux
+      FILE *mtab = setmntent("/etc/mtab", "r");
+      if(mtab == nullptr)
+      {
+        mtab = setmntent("/proc/mounts", "r");
+      }
+      if(mtab == nullptr)
+      {
+        return posix_error();
+      }
+      auto unmtab = make_scope_exit([mtab]() noexcept { endmntent(mtab); });
+      struct mntent m
+      {
+      };
+      char buffer[32768];
+      while(getmntent_r(mtab, &m, buffer, sizeof(buffer)) != nullptr)
+      {
+        struct statfs64 temp
+        {
+        };
+        memset(&temp, 0, sizeof(temp));
+        // std::cout << m.mnt_fsname << "," << m.mnt_dir << "," << m.mnt_type << "," << m.mnt_opts << std::endl;
+        if(0 == statfs64(m.mnt_dir, &temp))
+        {
+          // std::cout << "   " << temp.f_fsid.__val[0] << temp.f_fsid.__val[1] << " =? " << s.f_fsid.__val[0] << s.f_fsid.__val[1] << std::endl;
+          if(temp.f_type == s.f_type && (memcmp(&temp.f_fsid, &s.f_fsid, sizeof(s.f_fsid)) == 0))
+          {
+            mountentries.emplace_back(statfs_mount_entry_t(m.mnt_fsname, m.mnt_dir, m.mnt_type, m.mnt_opts), temp);
+          }
+        }
+      }
+    }
+#ifndef LLFIO_COMPILING_FOR_GCOV
+    if(mountentries.empty())
+    {
+      return errc::no_such_file_or_directory;
+    }
+    // Choose the mount entry with the most closely matching statfs. You can't choose
+    // exclusively based on mount point because of bind mounts
+    if(mountentries.size() > 1)
+    {
+      std::vector<std::pair<size_t, size_t>> scores(mountentries.size());
+      for(size_t n = 0; n < mountentries.size(); n++)
+      {
+        const auto *a = reinterpret_cast<const char *>(&mountentries[n].second);
+        const auto *b = reinterpret_cast<const char *>(&s);
+        scores[n].first = 0;
+        for(size_t x = 0; x < sizeof(struct statfs64); x++)
+        {
+          scores[n].first += abs(a[x] - b[x]);
+        }
+        scores[n].second = n;
+      }
+      std::sort(scores.begin(), scores.end());
+      auto temp(std::move(mountentries[scores.front().second]));
+      mountentries.clear();
+      mountentries.push_back(std::move(temp));
+    }
+#endif
+    {
+      std::lock_guard<std::mutex> g(cache.lock);
+      cache.entries.erase(key);
+      cache.entries.emplace(key, statfs_mount_cache_t::value_type{mountentries.front().first, now});
+    }
+    return std::move(mountentries.front().first);
+  }
+}  // namespace detail
+#endif
+
 LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> statfs_t::fill(const handle &h, statfs_t::want wanted) noexcept
 {
   size_t ret = 0;
@@ -96,103 +235,32 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> statfs_t::fill(const handle &h, s
   {
     try
     {
-      struct mountentry
-      {
-        std::string mnt_fsname, mnt_dir, mnt_type, mnt_opts;
-        mountentry(const char *a, const char *b, const char *c, const char *d)
-            : mnt_fsname(a)
-            , mnt_dir(b)
-            , mnt_type(c)
-            , mnt_opts(d)
-        {
-        }
-      };
-      std::vector<std::pair<mountentry, struct statfs64>> mountentries;
-      {
-        // Need to parse mount options on Linux
-        FILE *mtab = setmntent("/etc/mtab", "r");
-        if(mtab == nullptr)
-        {
-          mtab = setmntent("/proc/mounts", "r");
-        }
-        if(mtab == nullptr)
-        {
-          return posix_error();
-        }
-        auto unmtab = make_scope_exit([mtab]() noexcept { endmntent(mtab); });
-        struct mntent m
-        {
-        };
-        char buffer[32768];
-        while(getmntent_r(mtab, &m, buffer, sizeof(buffer)) != nullptr)
-        {
-          struct statfs64 temp
-          {
-          };
-          memset(&temp, 0, sizeof(temp));
-          // std::cout << m.mnt_fsname << "," << m.mnt_dir << "," << m.mnt_type << "," << m.mnt_opts << std::endl;
-          if(0 == statfs64(m.mnt_dir, &temp))
-          {
-            // std::cout << "   " << temp.f_fsid.__val[0] << temp.f_fsid.__val[1] << " =? " << s.f_fsid.__val[0] << s.f_fsid.__val[1] << std::endl;
-            if(temp.f_type == s.f_type && (memcmp(&temp.f_fsid, &s.f_fsid, sizeof(s.f_fsid)) == 0))
-            {
-              mountentries.emplace_back(mountentry(m.mnt_fsname, m.mnt_dir, m.mnt_type, m.mnt_opts), temp);
-            }
-          }
-        }
-      }
-#ifndef LLFIO_COMPILING_FOR_GCOV
-      if(mountentries.empty())
-      {
-        return errc::no_such_file_or_directory;
-      }
-      // Choose the mount entry with the most closely matching statfs. You can't choose
-      // exclusively based on mount point because of bind mounts
-      if(mountentries.size() > 1)
-      {
-        std::vector<std::pair<size_t, size_t>> scores(mountentries.size());
-        for(size_t n = 0; n < mountentries.size(); n++)
-        {
-          const auto *a = reinterpret_cast<const char *>(&mountentries[n].second);
-          const auto *b = reinterpret_cast<const char *>(&s);
-          scores[n].first = 0;
-          for(size_t x = 0; x < sizeof(struct statfs64); x++)
-          {
-            scores[n].first += abs(a[x] - b[x]);
-          }
-          scores[n].second = n;
-        }
-        std::sort(scores.begin(), scores.end());
-        auto temp(std::move(mountentries[scores.front().second]));
-        mountentries.clear();
-        mountentries.push_back(std::move(temp));
-      }
-#endif
+      OUTCOME_TRY(auto &&mountentry, detail::statfs_find_mount_entry(s));
       if(!!(wanted & want::flags))
       {
         f_flags.rdonly = static_cast<uint32_t>((s.f_flags & MS_RDONLY) != 0);
         f_flags.noexec = static_cast<uint32_t>((s.f_flags & MS_NOEXEC) != 0);
         f_flags.nosuid = static_cast<uint32_t>((s.f_flags & MS_NOSUID) != 0);
-        f_flags.acls = static_cast<uint32_t>(std::string::npos != mountentries.front().first.mnt_opts.find("acl") && std::string::npos == mountentries.front().first.mnt_opts.find("noacl"));
-        f_flags.xattr = static_cast<uint32_t>(std::string::npos != mountentries.front().first.mnt_opts.find("xattr") && std::string::npos == mountentries.front().first.mnt_opts.find("nouser_xattr"));
+        f_flags.acls = static_cast<uint32_t>(std::string::npos != mountentry.mnt_opts.find("acl") && std::string::npos == mountentry.mnt_opts.find("noacl"));
+        f_flags.xattr = static_cast<uint32_t>(std::string::npos != mountentry.mnt_opts.find("xattr") && std::string::npos == mountentry.mnt_opts.find("nouser_xattr"));
         //                out.f_flags.compression=0;
         // Those filing systems supporting FALLOC_FL_PUNCH_HOLE
-        f_flags.extents = static_cast<uint32_t>(mountentries.front().first.mnt_type == "btrfs" || mountentries.front().first.mnt_type == "ext4" || mountentries.front().first.mnt_type == "xfs" || mountentries.front().first.mnt_type == "tmpfs");
+        f_flags.extents = static_cast<uint32_t>(mountentry.mnt_type == "btrfs" || mountentry.mnt_type == "ext4" || mountentry.mnt_type == "xfs" || mountentry.mnt_type == "tmpfs");
         ++ret;
       }
       if(!!(wanted & want::fstypename))
       {
-        f_fstypename = mountentries.front().first.mnt_type;
+        f_fstypename = mountentry.mnt_type;
         ++ret;
       }
       if(!!(wanted & want::mntfromname))
       {
-        f_mntfromname = mountentries.front().first.mnt_fsname;
+        f_mntfromname = mountentry.mnt_fsname;
         ++ret;
       }
       if(!!(wanted & want::mntonname))
       {
-        f_mntonname = mountentries.front().first.mnt_dir;
+        f_mntonname = mountentry.mnt_dir;
         ++ret;
       }
     }
@@ -25,11 +25,14 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../../handle.hpp"
 #include "../../../storage_profile.hpp"
 
+#include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <sys/utsname.h>  // for uname()
 #include <unistd.h>
 #if defined(__linux__)
 #include <linux/fs.h>
+#include <sys/sysmacros.h>  // for major(), minor()
 #else
 #include <sys/disk.h>
 #include <sys/sysctl.h>
@@ -318,8 +321,190 @@ namespace storage_profile
         }
         return success();
       }
+
+      // The first of the attributes in sysfs of the block device the file is on which exists and is not empty, with whitespace trimmed
+      inline std::string _sysfs_block_attribute(file_handle &h, std::initializer_list<const char *> leafs)
+      {
+#ifdef __linux__
+        struct stat s
+        {
+        };
+        if(-1 == ::fstat(h.native_handle().fd, &s))
+        {
+          return {};
+        }
+        for(auto *leaf : leafs)
+        {
+          char path[256];
+          snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/%s", major(s.st_dev), minor(s.st_dev), leaf);
+          int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+          if(fd == -1)
+          {
+            continue;
+          }
+          char buffer[256];
+          auto bytes = ::read(fd, buffer, sizeof(buffer));
+          ::close(fd);
+          if(bytes <= 0)
+          {
+            continue;
+          }
+          std::string ret(buffer, bytes);
+          const auto first = ret.find_first_not_of(" \t\n");
+          if(first == std::string::npos)
+          {
+            continue;
+          }
+          return ret.substr(first, ret.find_last_not_of(" \t\n") + 1 - first);
+        }
+#else
+        (void) h;
+        (void) leafs;
+#endif
+        return {};
+      }
+
+      // Queue limits of the block device the file is on. A partition's queue limits are those of its parent device.
+      outcome<void> _device_queue_limits(storage_profile &sp, file_handle &h) noexcept
+      {
+        try
+        {
+          auto number = [&](const char *leaf, const char *parentleaf, unsigned &out) {
+            auto v = _sysfs_block_attribute(h, {leaf, parentleaf});
+            if(!v.empty())
+            {
+              out = static_cast<unsigned>(strtoul(v.c_str(), nullptr, 10));
+            }
+          };
+          number("queue/physical_block_size", "../queue/physical_block_size", sp.device_physical_block_size.value);
+          number("queue/minimum_io_size", "../queue/minimum_io_size", sp.device_minimum_io_size.value);
+          number("queue/optimal_io_size", "../queue/optimal_io_size", sp.device_optimal_io_size.value);
+          number("queue/rotational", "../queue/rotational", sp.device_rotational.value);
+          auto zoned = _sysfs_block_attribute(h, {"queue/zoned", "../queue/zoned"});
+          if(!zoned.empty())
+          {
+            sp.device_zoned.value = std::move(zoned);
+          }
+          if(!sp.device_zoned.value.empty() && sp.device_zoned.value != "none")
+          {
+            // Zones are chunk_sectors of 512 bytes each
+            unsigned zone_sectors = 0;
+            number("queue/chunk_sectors", "../queue/chunk_sectors", zone_sectors);
+            sp.device_zone_size.value = (io_handle::extent_type) zone_sectors * 512;
+            number("queue/nr_zones", "../queue/nr_zones", sp.device_zones.value);
+            number("queue/max_open_zones", "../queue/max_open_zones", sp.device_max_open_zones.value);
+            number("queue/max_active_zones", "../queue/max_active_zones", sp.device_max_active_zones.value);
+            number("queue/zone_append_max_bytes", "../queue/zone_append_max_bytes", sp.device_zone_append_max.value);
+          }
+        }
+        catch(...)
+        {
+          return std::current_exception();
+        }
+        return success();
+      }
+
+      // Serial number of the device the file is on, if obtainable
+      std::string _device_serial(file_handle &h) noexcept
+      {
+        try
+        {
+          // A partition's serial is that of its parent device. NVMe and SCSI may only have a WWID.
+          std::string ret = _sysfs_block_attribute(h, {"device/serial", "../device/serial", "device/wwid", "../device/wwid", "wwid", "../wwid"});
+          // Keys are whitespace delimited
+          for(auto &c : ret)
+          {
+            if(c == ' ' || c == '\t')
+            {
+              c = '_';
+            }
+          }
+          return ret;
+        }
+        catch(...)
+        {
+          return {};
+        }
+      }
+
+      // Maximum write the device guarantees is not torn by power loss, which Linux derives from the NVMe AWUPF or SCSI block limits
+      io_handle::extent_type _device_atomic_write_unit_max(file_handle &h) noexcept
+      {
+        try
+        {
+          auto v = _sysfs_block_attribute(h, {"queue/atomic_write_unit_max_bytes", "../queue/atomic_write_unit_max_bytes"});
+          return v.empty() ? 0 : strtoull(v.c_str(), nullptr, 10);
+        }
+        catch(...)
+        {
+          return 0;
+        }
+      }
+
+      // Bytes written to, and cache flushes issued to, the block device the file is on since boot.
+      // Partitions do not count flushes, which are issued to their parent device.
+      outcome<std::pair<unsigned long long, unsigned long long>> _device_write_counters(file_handle &h) noexcept
+      {
+        try
+        {
+          // Fields are reads, read merges, read sectors, read ticks, writes, write merges, write sectors, ...
+          // with discards in fields 12 to 15 and flushes in field 16 on Linux 5.5 onwards
+          auto field = [](const std::string &stat, size_t idx) -> unsigned long long {
+            char *p = const_cast<char *>(stat.c_str()), *e = nullptr;
+            for(size_t n = 0; n < idx; n++)
+            {
+              strtoull(p, &p, 10);
+            }
+            auto ret = strtoull(p, &e, 10);
+            return (e == p) ? static_cast<unsigned long long>(-1) : ret;
+          };
+          auto stat = _sysfs_block_attribute(h, {"stat"});
+          if(stat.empty())
+          {
+            return errc::not_supported;
+          }
+          std::pair<unsigned long long, unsigned long long> ret(field(stat, 6) * 512, static_cast<unsigned long long>(-1));
+          auto parentstat = _sysfs_block_attribute(h, {"partition"}).empty() ? stat : _sysfs_block_attribute(h, {"../stat"});
+          if(!parentstat.empty())
+          {
+            ret.second = field(parentstat, 15);
+          }
+          return ret;
+        }
+        catch(...)
+        {
+          return std::current_exception();
+        }
+      }
     }  // namespace posix
   }    // namespace storage
+
+  result<filesystem::path> cache_directory() noexcept
+  {
+    try
+    {
+      const char *env = getenv("LLFIO_STORAGE_PROFILE_CACHE");
+      if(env != nullptr && env[0] != 0)
+      {
+        return filesystem::path(env);
+      }
+      env = getenv("XDG_CACHE_HOME");
+      if(env != nullptr && env[0] != 0)
+      {
+        return filesystem::path(env) / "llfio" / "storage_profiles";
+      }
+      env = getenv("HOME");
+      if(env != nullptr && env[0] != 0)
+      {
+        return filesystem::path(env) / ".cache" / "llfio" / "storage_profiles";
+      }
+      return errc::no_such_file_or_directory;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
 }  // namespace storage_profile
 
 LLFIO_V2_NAMESPACE_END
@@ -25,6 +25,10 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../../symlink_handle.hpp"
 #include "import.hpp"
 
+#ifdef __linux__
+#include "io_uring_metadata_ring.ipp"
+#endif
+
 LLFIO_V2_NAMESPACE_BEGIN
 
 namespace detail
@@ -62,7 +66,7 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> symlink_handle::_create_symlink(con
       end_utc = d.to_time_point();
     }
   }
-  path_view::c_str<> zpath(target);
+  path_view::recycling_c_str<> zpath(target);
   try
   {
     if(atomic_replace)
@@ -379,11 +383,9 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<symlink_handle> symlink_handle::symlink(c
   return ret;
 }
 
-result<symlink_handle::buffers_type> symlink_handle::read(symlink_handle::io_request<symlink_handle::buffers_type> req) noexcept
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> symlink_handle::_read_link(int dirfd, const char *path, span<char> kernelbuffer, buffers_type &tofill) noexcept
 {
-  LLFIO_LOG_FUNCTION_CALL(this);
-  symlink_handle::buffers_type tofill;
-  if(req.kernelbuffer.empty())
+  if(kernelbuffer.empty() && !tofill._kernel_buffer)
   {
     // Let's assume the average symbolic link will be 256 characters long.
     size_t toallocate = 256;
@@ -397,21 +399,16 @@ result<symlink_handle::buffers_type> symlink_handle::read(symlink_handle::io_req
   }
   for(;;)
   {
-    char *buffer = req.kernelbuffer.empty() ? tofill._kernel_buffer.get() : req.kernelbuffer.data();
-    size_t bytes = req.kernelbuffer.empty() ? tofill._kernel_buffer_size : req.kernelbuffer.size();
-#if !LLFIO_SYMLINK_HANDLE_IS_FAKED
-    // Linux has the ability to read the link from a fd
-    ssize_t read = ::readlinkat(_v.fd, "", buffer, bytes);
-#else
-    ssize_t read = ::readlinkat(_dirh.native_handle().fd, _leafname.c_str(), buffer, bytes);
-#endif
+    char *buffer = kernelbuffer.empty() ? tofill._kernel_buffer.get() : kernelbuffer.data();
+    size_t bytes = kernelbuffer.empty() ? tofill._kernel_buffer_size : kernelbuffer.size();
+    ssize_t read = ::readlinkat(dirfd, path, buffer, bytes);
     if(read == -1)
     {
       return posix_error();
     }
     if((size_t) read == bytes)
     {
-      if(req.kernelbuffer.empty())
+      if(kernelbuffer.empty())
       {
         tofill._kernel_buffer.reset();
         size_t toallocate = tofill._kernel_buffer_size * 2;
@@ -430,7 +427,149 @@ result<symlink_handle::buffers_type> symlink_handle::read(symlink_handle::io_req
     buffer[read] = 0;
     tofill._link = path_view(buffer, read, true);
     tofill._type = symlink_type::symbolic;
-    return {std::move(tofill)};
+    return success();
+  }
+}
+
+result<symlink_handle::buffers_type> symlink_handle::read(symlink_handle::io_request<symlink_handle::buffers_type> req) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  symlink_handle::buffers_type tofill;
+#if !LLFIO_SYMLINK_HANDLE_IS_FAKED
+  // Linux has the ability to read the link from a fd
+  OUTCOME_TRYV(_read_link(_v.fd, "", req.kernelbuffer, tofill));
+#else
+  OUTCOME_TRYV(_read_link(_dirh.native_handle().fd, _leafname.c_str(), req.kernelbuffer, tofill));
+#endif
+  return {std::move(tofill)};
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> symlink_handle::read_many(const path_handle &base, span<read_many_item> items) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  const int dirfd = base.is_valid() ? base.native_handle().fd : AT_FDCWD;
+  for(auto &item : items)
+  {
+    path_view::recycling_c_str<> zpath(item.leafname);
+    item.read = _read_link(dirfd, zpath.buffer, item.kernelbuffer, item.buffers);
+  }
+  return success();
+}
+
+#ifdef __linux__
+namespace detail
+{
+  struct symlink_create_many_uring_t
+  {
+    std::unique_ptr<io_uring_metadata_ring> ring;
+    bool ring_failed{false};
+    std::vector<char> names;
+    std::vector<size_t> nameoffsets;
+    std::vector<size_t> itemidxs;
+  };
+  inline symlink_create_many_uring_t *symlink_create_many_uring() noexcept
+  {
+    static thread_local symlink_create_many_uring_t tls;
+    if(!tls.ring && !tls.ring_failed)
+    {
+      tls.ring.reset(new(std::nothrow) io_uring_metadata_ring);
+      if(!tls.ring || !tls.ring->init(256))
+      {
+        // Kernel too old, or io_uring is forbidden by seccomp etc.
+        tls.ring.reset();
+        tls.ring_failed = true;
+      }
+    }
+    return tls.ring ? &tls : nullptr;
+  }
+}  // namespace detail
+#endif
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> symlink_handle::create_many(const path_handle &base, span<create_many_item> items, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  try
+  {
+    const int dirfd = base.is_valid() ? base.native_handle().fd : AT_FDCWD;
+    auto create_one = [&](create_many_item &item) {
+      path_view::recycling_c_str<> zpath(item.leafname);
+      if(item.atomic_replace)
+      {
+        item.created = _create_symlink(base, zpath.buffer, item.target, d, true);
+        return;
+      }
+      path_view::recycling_c_str<> ztarget(item.target);
+      item.created = success();
+      if(-1 == ::symlinkat(ztarget.buffer, dirfd, zpath.buffer))
+      {
+        item.created = posix_error();
+      }
+    };
+#ifdef __linux__
+    auto *u = (items.size() > 1) ? detail::symlink_create_many_uring() : nullptr;
+    if(u != nullptr)
+    {
+      auto &ring = *u->ring;
+      const size_t chunk = ring.capacity();
+      u->nameoffsets.resize(chunk * 2);
+      u->itemidxs.resize(chunk);
+      for(size_t idx = 0; idx < items.size();)
+      {
+        // Replacing links needs a create and a rename, so those are done synchronously
+        u->names.clear();
+        size_t count = 0;
+        for(; idx < items.size() && count < chunk; idx++)
+        {
+          auto &item = items[idx];
+          if(item.atomic_replace)
+          {
+            create_one(item);
+            continue;
+          }
+          path_view::recycling_c_str<> zpath(item.leafname), ztarget(item.target);
+          u->nameoffsets[count * 2] = u->names.size();
+          u->names.insert(u->names.end(), zpath.buffer, zpath.buffer + zpath.length);
+          u->names.push_back(0);
+          u->nameoffsets[count * 2 + 1] = u->names.size();
+          u->names.insert(u->names.end(), ztarget.buffer, ztarget.buffer + ztarget.length);
+          u->names.push_back(0);
+          u->itemidxs[count++] = idx;
+        }
+        if(count == 0)
+        {
+          continue;
+        }
+        for(size_t n = 0; n < count; n++)
+        {
+          ring.symlinkat(n, u->names.data() + u->nameoffsets[n * 2 + 1], dirfd, u->names.data() + u->nameoffsets[n * 2]);
+        }
+        OUTCOME_TRY(ring.submit_and_wait([&](uint64_t n, int res) {
+          auto &item = items[u->itemidxs[(size_t) n]];
+          if(res == -EINVAL)
+          {
+            // Kernels before 5.15 do not implement SYMLINKAT
+            create_one(item);
+            return;
+          }
+          item.created = success();
+          if(res < 0)
+          {
+            item.created = posix_error(-res);
+          }
+        }));
+      }
+      return success();
+    }
+#endif
+    for(auto &item : items)
+    {
+      create_one(item);
+    }
+    return success();
+  }
+  catch(...)
+  {
+    return error_from_exception();
   }
 }
 
@@ -23,13 +23,19 @@ Distributed under the Boost Software License, Version 1.0.
 */
 
 #include "../../../utils.hpp"
+#include "../utils.ipp"
 
-#include <mutex>  // for lock_guard
+#include <algorithm>  // for sort
+#include <mutex>      // for lock_guard
 
 #include <sys/mman.h>
 
 #ifdef __linux__
+#include <dirent.h>  // for opendir
+#include <poll.h>
 #include <unistd.h>  // for preadv
+
+#include <thread>
 #endif
 #ifdef __APPLE__
 #include <mach/task.h>
@@ -49,6 +55,7 @@ namespace utils
     }
     return ret;
   }
+  size_t allocation_granularity() noexcept { return page_size(); }
   const std::vector<size_t> &page_sizes(bool only_actually_available)
   {
     static spinlock lock;
@@ -81,7 +88,38 @@ namespace utils
 #elif defined(__linux__)
       pagesizes.push_back(getpagesize());
       pagesizes_available.push_back(getpagesize());
-      int ih = ::open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+      // Each huge page size the kernel supports has its own pool in /sys/kernel/mm/hugepages
+      bool have_sysfs = false;
+      if(DIR *dh = ::opendir("/sys/kernel/mm/hugepages"))
+      {
+        while(struct dirent *de = ::readdir(dh))
+        {
+          unsigned long kb = 0;
+          if(1 != sscanf(de->d_name, "hugepages-%lukB", &kb) || kb == 0)  // NOLINT
+          {
+            continue;
+          }
+          have_sysfs = true;
+          pagesizes.push_back(static_cast<size_t>(kb) * 1024);
+          char path[320], buffer[32];
+          snprintf(path, sizeof(path), "/sys/kernel/mm/hugepages/%s/nr_hugepages", de->d_name);  // NOLINT
+          int ih = ::open(path, O_RDONLY | O_CLOEXEC);
+          if(-1 != ih)
+          {
+            auto bytesread = ::read(ih, buffer, sizeof(buffer) - 1);
+            ::close(ih);
+            buffer[(bytesread > 0) ? bytesread : 0] = 0;
+            if(strtoul(buffer, nullptr, 10) > 0)
+            {
+              pagesizes_available.push_back(static_cast<size_t>(kb) * 1024);
+            }
+          }
+        }
+        ::closedir(dh);
+        std::sort(pagesizes.begin(), pagesizes.end());
+        std::sort(pagesizes_available.begin(), pagesizes_available.end());
+      }
+      int ih = have_sysfs ? -1 : ::open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
       if(-1 != ih)
       {
         char buffer[4096], *hugepagesize, *hugepages;
@@ -132,22 +170,25 @@ namespace utils
 #pragma warning(pop)
 #endif
 
-  void random_fill(char *buffer, size_t bytes) noexcept
+  namespace detail
   {
-    static spinlock lock;
-    static std::atomic<int> randomfd(-1);
-    int fd = randomfd;
-    if(-1 == fd)
-    {
-      std::lock_guard<decltype(lock)> g(lock);
-      randomfd = fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
-    }
-    if(-1 == fd || ::read(fd, buffer, bytes) < static_cast<ssize_t>(bytes))
+    void kernel_random_fill(char *buffer, size_t bytes) noexcept
     {
-      LLFIO_LOG_FATAL(0, "llfio: Kernel crypto function failed");
-      std::terminate();
+      static spinlock lock;
+      static std::atomic<int> randomfd(-1);
+      int fd = randomfd;
+      if(-1 == fd)
+      {
+        std::lock_guard<decltype(lock)> g(lock);
+        randomfd = fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+      }
+      if(-1 == fd || ::read(fd, buffer, bytes) < static_cast<ssize_t>(bytes))
+      {
+        LLFIO_LOG_FATAL(0, "llfio: Kernel crypto function failed");
+        std::terminate();
+      }
     }
-  }
+  }  // namespace detail
 
   result<void> flush_modified_data() noexcept
   {
@@ -208,9 +249,44 @@ namespace utils
     return false;
   }
 
-  result<process_memory_usage> current_process_memory_usage() noexcept
+  result<process_memory_usage> current_process_memory_usage(process_memory_usage::want want) noexcept
   {
 #ifdef __linux__
+    if(!(want & process_memory_usage::want::private_committed))
+    {
+      /* /proc/[pid]/statm, all in pages:
+
+      total_address_space_in_use = size
+      total_address_space_paged_in = resident
+      private_committed = data (private writable mappings, including those never faulted in)
+      private_paged_in = resident - shared (i.e. RssAnon)
+      */
+      int ih = ::open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+      if(ih == -1)
+      {
+        return posix_error();
+      }
+      char buffer[256];
+      auto bytesread = ::read(ih, buffer, sizeof(buffer) - 1);
+      ::close(ih);
+      if(bytesread <= 0)
+      {
+        return posix_error();
+      }
+      buffer[bytesread] = 0;
+      size_t size = 0, resident = 0, shared = 0, text = 0, lib = 0, data = 0;
+      if(6 != sscanf(buffer, "%zu %zu %zu %zu %zu %zu", &size, &resident, &shared, &text, &lib, &data))  // NOLINT
+      {
+        return errc::illegal_byte_sequence;
+      }
+      const size_t pagesize = page_size();
+      process_memory_usage ret;
+      ret.total_address_space_in_use = size * pagesize;
+      ret.total_address_space_paged_in = resident * pagesize;
+      ret.private_committed = data * pagesize;
+      ret.private_paged_in = (resident - shared) * pagesize;
+      return ret;
+    }
     try
     {
       /* /proc/[pid]/status:
@@ -404,6 +480,7 @@ namespace utils
       return error_from_exception();
     }
 #elif defined(__APPLE__)
+  (void) want;
   kern_return_t error;
   mach_msg_type_number_t outCount;
   task_vm_info_data_t vmInfo;
@@ -434,46 +511,330 @@ namespace utils
 
   namespace detail
   {
-    large_page_allocation allocate_large_pages(size_t bytes)
+#ifdef __linux__
+    struct memory_pressure_monitor_t
+    {
+      std::mutex lock;
+      std::thread thread;
+      int wakefds[2]{-1, -1};
+      int some_fd{-1}, full_fd{-1}, events_fd{-1};
+      uint64_t events_high{0}, events_max{0};
+
+      void close_fds() noexcept
+      {
+        for(int *fd : {&wakefds[0], &wakefds[1], &some_fd, &full_fd, &events_fd})
+        {
+          if(*fd != -1)
+          {
+            ::close(*fd);
+            *fd = -1;
+          }
+        }
+      }
+
+      // Rereads memory.events, returning the pressure implied by any rise in its counts
+      int read_events() noexcept
+      {
+        char buffer[1024];
+        auto bytesread = ::pread(events_fd, buffer, sizeof(buffer) - 1, 0);
+        if(bytesread <= 0)
+        {
+          return 0;
+        }
+        buffer[bytesread] = 0;
+        uint64_t high = 0, max = 0, oom = 0;
+        auto find = [&](const char *what, uint64_t &v) {
+          for(const char *p = buffer; (p = strstr(p, what)) != nullptr; p += strlen(what))
+          {
+            if(p == buffer || p[-1] == '\n')
+            {
+              v = strtoull(p + strlen(what), nullptr, 10);
+              return;
+            }
+          }
+        };
+        find("high ", high);
+        find("max ", max);
+        find("oom ", oom);
+        int ret = 0;
+        if(max + oom > events_max)
+        {
+          ret = static_cast<int>(memory_pressure::critical);
+        }
+        else if(high > events_high)
+        {
+          ret = static_cast<int>(memory_pressure::low);
+        }
+        events_high = high;
+        events_max = max + oom;
+        return ret;
+      }
+
+      void run() noexcept
+      {
+        for(;;)
+        {
+          struct pollfd fds[4];
+          nfds_t count = 0;
+          fds[count++] = {wakefds[0], POLLIN, 0};
+          for(int fd : {full_fd, some_fd, events_fd})
+          {
+            if(fd != -1)
+            {
+              fds[count++] = {fd, POLLPRI, 0};
+            }
+          }
+          if(::poll(fds, count, -1) < 0)
+          {
+            if(EINTR == errno)
+            {
+              continue;
+            }
+            return;
+          }
+          if(fds[0].revents != 0)
+          {
+            return;
+          }
+          int level = 0;
+          for(nfds_t n = 1; n < count; n++)
+          {
+            if(fds[n].revents == 0)
+            {
+              continue;
+            }
+            if(fds[n].fd == events_fd)
+            {
+              // kernfs signals a modified file with both POLLPRI and POLLERR
+              level = std::max(level, read_events());
+            }
+            else if(fds[n].revents & POLLERR)
+            {
+              // The trigger is gone, probably because its cgroup was removed
+              int &fd = (fds[n].fd == full_fd) ? full_fd : some_fd;
+              ::close(fd);
+              fd = -1;
+            }
+            else if(fds[n].fd == full_fd)
+            {
+              level = std::max(level, static_cast<int>(memory_pressure::critical));
+            }
+            else
+            {
+              level = std::max(level, static_cast<int>(memory_pressure::low));
+            }
+          }
+          if(level != 0)
+          {
+            notify_memory_pressure(static_cast<memory_pressure>(level));
+          }
+        }
+      }
+    };
+    inline memory_pressure_monitor_t &memory_pressure_monitor() noexcept
+    {
+      // Deliberately leaked so a running monitor thread does not terminate the process on exit
+      static memory_pressure_monitor_t *v = new memory_pressure_monitor_t;
+      return *v;
+    }
+#endif
+  }  // namespace detail
+
+  result<void> start_memory_pressure_monitor() noexcept
+  {
+#ifdef __linux__
+    try
+    {
+      auto &monitor = detail::memory_pressure_monitor();
+      std::lock_guard<std::mutex> g(monitor.lock);
+      if(monitor.thread.joinable())
+      {
+        return success();
+      }
+      // For cgroups v2, /proc/self/cgroup contains "0::/path/of/cgroup"
+      std::string cgroup;
+      {
+        int ih = ::open("/proc/self/cgroup", O_RDONLY | O_CLOEXEC);
+        if(-1 != ih)
+        {
+          char buffer[4096];
+          auto bytesread = ::read(ih, buffer, sizeof(buffer) - 1);
+          ::close(ih);
+          buffer[(bytesread > 0) ? bytesread : 0] = 0;
+          const char *p = strstr(buffer, "0::");
+          if(p != nullptr && (p == buffer || p[-1] == '\n'))
+          {
+            const char *e = strchr(p, '\n');
+            cgroup.assign("/sys/fs/cgroup");
+            cgroup.append(p + 3, (e != nullptr) ? e : p + strlen(p));
+            if(cgroup.back() == '/')
+            {
+              cgroup.pop_back();
+            }
+          }
+        }
+      }
+      auto open_trigger = [](const std::string &path, const char *trigger) -> int {
+        int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if(-1 == fd)
+        {
+          return -1;
+        }
+        if(::write(fd, trigger, strlen(trigger) + 1) < 0)
+        {
+          ::close(fd);
+          return -1;
+        }
+        return fd;
+      };
+      // Unprivileged triggers need a window which is a multiple of two seconds
+      for(const std::string &path : {cgroup.empty() ? std::string() : cgroup + "/memory.pressure", std::string("/proc/pressure/memory")})
+      {
+        if(path.empty())
+        {
+          continue;
+        }
+        monitor.some_fd = open_trigger(path, "some 200000 2000000");
+        monitor.full_fd = open_trigger(path, "full 100000 2000000");
+        if(monitor.some_fd != -1 || monitor.full_fd != -1)
+        {
+          break;
+        }
+      }
+      if(!cgroup.empty())
+      {
+        monitor.events_fd = ::open((cgroup + "/memory.events").c_str(), O_RDONLY | O_CLOEXEC);
+        if(monitor.events_fd != -1)
+        {
+          (void) monitor.read_events();
+        }
+      }
+      if(monitor.some_fd == -1 && monitor.full_fd == -1 && monitor.events_fd == -1)
+      {
+        return errc::not_supported;
+      }
+      if(-1 == ::pipe2(monitor.wakefds, O_CLOEXEC))
+      {
+        auto ret = posix_error();
+        monitor.close_fds();
+        return ret;
+      }
+      try
+      {
+        monitor.thread = std::thread([&monitor] { monitor.run(); });
+      }
+      catch(...)
+      {
+        monitor.close_fds();
+        throw;
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+#else
+    return errc::not_supported;
+#endif
+  }
+
+  void stop_memory_pressure_monitor() noexcept
+  {
+#ifdef __linux__
+    auto &monitor = detail::memory_pressure_monitor();
+    std::lock_guard<std::mutex> g(monitor.lock);
+    if(!monitor.thread.joinable())
+    {
+      return;
+    }
+    char c = 0;
+    (void) ::write(monitor.wakefds[1], &c, 1);
+    monitor.thread.join();
+    monitor.close_fds();
+#endif
+  }
+
+  namespace detail
+  {
+    large_page_allocation allocate_large_pages(size_t bytes, size_t pagesize, bool permit_fallback)
     {
       large_page_allocation ret(calculate_large_page_allocation(bytes));
-      int flags = MAP_SHARED | MAP_ANON;
-      if(ret.page_size_used > 65536)
+      if(pagesize != 0)
+      {
+        ret.page_size_used = pagesize;
+        ret.actual_size = (bytes + pagesize - 1) & ~(pagesize - 1);
+      }
+      for(;;)
       {
+        int flags = MAP_SHARED | MAP_ANON;
+        if(ret.page_size_used > page_size())
+        {
 #ifdef MAP_HUGETLB
-        flags |= MAP_HUGETLB;
+          flags |= MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+          // Request the specific huge page size, otherwise the kernel uses its default size
+          flags |= static_cast<int>(__builtin_ctzll(ret.page_size_used)) << MAP_HUGE_SHIFT;
+#endif
 #endif
 #ifdef MAP_ALIGNED_SUPER
-        flags |= MAP_ALIGNED_SUPER;
+          flags |= MAP_ALIGNED_SUPER;
 #endif
 #ifdef VM_FLAGS_SUPERPAGE_SIZE_ANY
-        flags |= VM_FLAGS_SUPERPAGE_SIZE_ANY;
+          flags |= VM_FLAGS_SUPERPAGE_SIZE_ANY;
 #endif
-      }
-      if((ret.p = mmap(nullptr, ret.actual_size, PROT_WRITE, flags, -1, 0)) == nullptr)
-      {
-        if(ENOMEM == errno)
+        }
+        if((ret.p = mmap(nullptr, ret.actual_size, PROT_WRITE, flags, -1, 0)) != MAP_FAILED)
         {
-          if((ret.p = mmap(nullptr, ret.actual_size, PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0)) != nullptr)
+#ifndef NDEBUG
+          if(ret.page_size_used > 65536)
           {
-            return ret;
+            printf("llfio: Large page allocation successful\n");
           }
+#endif
+          return ret;
         }
+        ret.p = nullptr;
+        // ENOMEM means the pool for this size is exhausted, EINVAL that it has no pool at all
+        if(!permit_fallback || ret.page_size_used <= page_size() || (ENOMEM != errno && EINVAL != errno))
+        {
+          return ret;
+        }
+        // Fall back to the next smaller page size with a pool, or else to ordinary pages
+        size_t next = page_size();
+        for(auto i : page_sizes(true))
+        {
+          if(i < ret.page_size_used && i > next)
+          {
+            next = i;
+          }
+        }
+        ret.page_size_used = next;
+        ret.actual_size = (bytes + next - 1) & ~(next - 1);
       }
-#ifndef NDEBUG
-      else if(ret.page_size_used > 65536)
-      {
-        printf("llfio: Large page allocation successful\n");
-      }
-#endif
-      return ret;
     }
     void deallocate_large_pages(void *p, size_t bytes)
     {
       if(munmap(p, bytes) < 0)
       {
-        LLFIO_LOG_FATAL(p, "llfio: Freeing large pages failed");
-        std::terminate();
+        // Huge page mappings must be unmapped in whole pages of their size
+        bool done = false;
+        if(EINVAL == errno)
+        {
+          for(auto i : page_sizes(false))
+          {
+            if(i > page_size() && munmap(p, (bytes + i - 1) & ~(i - 1)) == 0)
+            {
+              done = true;
+              break;
+            }
+          }
+        }
+        if(!done)
+        {
+          LLFIO_LOG_FATAL(p, "llfio: Freeing large pages failed");
+          std::terminate();
+        }
       }
     }
   }  // namespace detail
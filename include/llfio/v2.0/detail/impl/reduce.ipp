@@ -29,6 +29,12 @@ Distributed under the Boost Software License, Version 1.0.
 #else
 #include "posix/import.hpp"
 #endif
+#ifdef __linux__
+#include "posix/io_uring_metadata_ring.ipp"
+#endif
+
+#include <future>
+#include <thread>
 
 LLFIO_V2_NAMESPACE_BEGIN
 
@@ -43,29 +49,24 @@ namespace algorithm
       using namespace windows_nt_kernel;
       /* We have a custom implementation for Microsoft Windows, because internally to Windows
       file entry removal works by opening a new HANDLE to the file entry, setting its
-      delete-on-close flag, and closing the HANDLE. As everybody knows, opening
+      delete disposition, and closing the HANDLE. As everybody knows, opening
       new HANDLEs is hideously slow on Windows, however it is less awful if you
-      open a HANDLE with only DELETE privileges and nothing else. In this situation,
-      Windows appears to have a less slow code path, resulting a noticeable
-      performance improvement for really large directory tree removals.
+      open a HANDLE with only DELETE privileges and nothing else, so we open exactly
+      one such HANDLE per entry, for files and directories alike.
 
-      Before anyone asks why we don't use FILE_DISPOSITION_POSIX_SEMANTICS and are
-      instead doing this "the old fashioned way", it's because opening handles with
-      delete on close semantics from the beginning has much better performance.
-      The NT kernel will delay actually removing the file entries until some point
-      later, which is normally problematic, hence FILE_DISPOSITION_POSIX_SEMANTICS
-      existing at all. However if you are removing all the entries in a directory
-      at once, the delay is beneficial, because NTFS can bulk remove all the entries
-      in a single operation.
+      The delete disposition is set with FILE_DISPOSITION_POSIX_SEMANTICS, which removes
+      the entry from its directory when the disposition is set, rather than when the
+      last HANDLE to it anywhere in the system is closed. Directories are therefore empty
+      as soon as their entries are removed, rather than only once every pending deletion
+      within them has completed. FILE_DISPOSITION_IGNORE_READONLY_ATTRIBUTE removes read
+      only entries too, which would otherwise fail to be removed and need renaming out of
+      the way. Filing systems without POSIX semantics (e.g. FAT), and Windows 10 before
+      1709, fall back to the legacy delete disposition.
       */
       const DWORD access = SYNCHRONIZE | DELETE;
       const DWORD fileshare = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
-      const DWORD deletefile_ntflags =
-      0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/ | 0x00200000 /*FILE_OPEN_REPARSE_POINT*/ | 0x00001000 /*FILE_DELETE_ON_CLOSE*/ | 0x040 /*FILE_NON_DIRECTORY_FILE*/;
-      const DWORD deletedir_ntflags =
-      0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/ | 0x00200000 /*FILE_OPEN_REPARSE_POINT*/ | 0x00001000 /*FILE_DELETE_ON_CLOSE*/ | 0x01 /*FILE_DIRECTORY_FILE*/;
-      const DWORD renamefile_ntflags = 0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/ | 0x00200000 /*FILE_OPEN_REPARSE_POINT*/ | 0x040 /*FILE_NON_DIRECTORY_FILE*/;
-      const DWORD renamedir_ntflags = 0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/ | 0x00200000 /*FILE_OPEN_REPARSE_POINT*/ | 0x01 /*FILE_DIRECTORY_FILE*/;
+      const DWORD ntflags = 0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/ | 0x00200000 /*FILE_OPEN_REPARSE_POINT*/ |
+                            (is_dir ? 0x01 /*FILE_DIRECTORY_FILE*/ : 0x040 /*FILE_NON_DIRECTORY_FILE*/);
       IO_STATUS_BLOCK isb = make_iostatus();
       path_view::c_str<> zpath(leafname, true);
       UNICODE_STRING _path{};
@@ -82,26 +83,25 @@ namespace algorithm
       //  oa.Attributes|=0x100/*OBJ_OPENLINK*/;
 
       HANDLE h = INVALID_HANDLE_VALUE;
-      NTSTATUS ntstat = 0;
-      if(!is_dir)
+      NTSTATUS ntstat = NtOpenFile(&h, access, &oa, &isb, fileshare, ntflags);
+      if(STATUS_PENDING == ntstat)
       {
-        ntstat = NtOpenFile(&h, access, &oa, &isb, fileshare, deletefile_ntflags);
-        if(STATUS_PENDING == ntstat)
-        {
-          ntstat = ntwait(h, isb, deadline());
-        }
+        ntstat = ntwait(h, isb, deadline());
       }
-      else
+      if(ntstat >= 0)
       {
+        FILE_DISPOSITION_INFORMATION_EX fdie{};
+        memset(&fdie, 0, sizeof(fdie));
+        fdie.Flags = 0x1 /*FILE_DISPOSITION_DELETE*/ | 0x2 /*FILE_DISPOSITION_POSIX_SEMANTICS*/ | 0x10 /*FILE_DISPOSITION_IGNORE_READONLY_ATTRIBUTE*/;
         isb = make_iostatus();
-        ntstat = NtOpenFile(&h, access, &oa, &isb, fileshare, deletedir_ntflags);
+        ntstat = NtSetInformationFile(h, &isb, &fdie, sizeof(fdie), FileDispositionInformationEx);
         if(STATUS_PENDING == ntstat)
         {
           ntstat = ntwait(h, isb, deadline());
         }
-        if(ntstat >= 0)
+        if(ntstat == (NTSTATUS) 0xC0000003 /*STATUS_INVALID_INFO_CLASS*/ || ntstat == (NTSTATUS) 0xC00000BB /*STATUS_NOT_SUPPORTED*/ ||
+           ntstat == (NTSTATUS) 0xC000000D /*STATUS_INVALID_PARAMETER*/)
         {
-          // FILE_DELETE_ON_CLOSE open flag only works on non-directories.
           FILE_DISPOSITION_INFORMATION fdi{};
           memset(&fdi, 0, sizeof(fdi));
           fdi._DeleteFile = 1u;
@@ -111,24 +111,14 @@ namespace algorithm
           {
             ntstat = ntwait(h, isb, deadline());
           }
-          if(ntstat < 0)
-          {
-            assert(ntstat == 0xC0000101 /*STATUS_DIRECTORY_NOT_EMPTY*/);
-            // If cannot set the delete-on-close flag, retry this later.
-            NtClose(h);
-            h = INVALID_HANDLE_VALUE;
-          }
-          else
-          {
-            // std::cout << "Removed quickly " << (dirh.current_path().value() / entry.leafname.path()) << std::endl;
-          }
         }
-      }
-      if(h != INVALID_HANDLE_VALUE)
-      {
-        NtClose(h);  // removes the entry
-        // std::cout << "Removed " << (dirh.current_path().value() / entry.leafname.path()) << std::endl;
-        return success();
+        // If the delete disposition could not be set, e.g. the directory is not empty, retry this later.
+        NtClose(h);
+        if(ntstat >= 0)
+        {
+          // std::cout << "Removed " << (dirh.current_path().value() / entry.leafname.path()) << std::endl;
+          return success();
+        }
       }
       return ntkernel_error(ntstat);
 #else
@@ -210,14 +200,21 @@ namespace algorithm
           auto randomname = utils::random_string(32);
           alignas(8) char buffer[sizeof(FILE_RENAME_INFORMATION) + 96];
           auto *fni = reinterpret_cast<FILE_RENAME_INFORMATION *>(buffer);
-          fni->Flags = 0;
+          // Rename with POSIX semantics, so the entry leaves its directory even if open elsewhere, and even if read only
+          fni->Flags = 0x2 /*FILE_RENAME_POSIX_SEMANTICS*/ | 0x40 /*FILE_RENAME_IGNORE_READONLY_ATTRIBUTE*/;
           fni->RootDirectory = topdirh.native_handle().h;
           fni->FileNameLength = 64;
           for(size_t n = 0; n < 32; n++)
           {
             fni->FileName[n] = randomname[n];
           }
-          ntstat = NtSetInformationFile(h, &isb, fni, sizeof(FILE_RENAME_INFORMATION) + fni->FileNameLength, FileRenameInformation);
+          ntstat = NtSetInformationFile(h, &isb, fni, sizeof(FILE_RENAME_INFORMATION) + fni->FileNameLength, FileRenameInformationEx);
+          if(ntstat == (NTSTATUS) 0xC0000003 /*STATUS_INVALID_INFO_CLASS*/ || ntstat == (NTSTATUS) 0xC00000BB /*STATUS_NOT_SUPPORTED*/ ||
+             ntstat == (NTSTATUS) 0xC000000D /*STATUS_INVALID_PARAMETER*/)
+          {
+            fni->Flags = 0;
+            ntstat = NtSetInformationFile(h, &isb, fni, sizeof(FILE_RENAME_INFORMATION) + fni->FileNameLength, FileRenameInformation);
+          }
           NtClose(h);
           if(ntstat >= 0)
           {
@@ -244,15 +241,146 @@ namespace algorithm
       return posix_error();
 #endif
     }
+#ifdef __linux__
+    // Each kernel thread's io_uring for batching unlinks, with its scratch space
+    struct reduce_uring_t
+    {
+      std::unique_ptr<LLFIO_V2_NAMESPACE::detail::io_uring_metadata_ring> ring;
+      bool ring_failed{false};
+      std::vector<char> names;
+      std::vector<size_t> nameoffsets;
+      std::vector<result<void>> results;
+    };
+    inline reduce_uring_t *reduce_uring(size_t ops_in_flight) noexcept
+    {
+      static thread_local reduce_uring_t tls;
+      if(!tls.ring && !tls.ring_failed)
+      {
+        tls.ring.reset(new(std::nothrow) LLFIO_V2_NAMESPACE::detail::io_uring_metadata_ring);
+        if(!tls.ring || !tls.ring->init((unsigned) (std::min)(ops_in_flight, (size_t) 256)))
+        {
+          // Kernel too old, or io_uring is forbidden by seccomp etc.
+          tls.ring.reset();
+          tls.ring_failed = true;
+        }
+      }
+      return tls.ring ? &tls : nullptr;
+    }
+    // Removes every entry in `contents` keeping many unlinks in flight, placing the outcome of each into `u.results`
+    inline result<void> remove_batch(reduce_uring_t &u, const directory_handle &dirh, directory_handle::buffers_type &contents) noexcept
+    {
+      try
+      {
+        auto &ring = *u.ring;
+        const size_t chunk = ring.capacity();
+        u.results.clear();
+        u.results.resize(contents.size(), success());
+        u.nameoffsets.resize(chunk);
+        for(size_t base = 0; base < contents.size(); base += chunk)
+        {
+          const size_t count = (std::min)(chunk, contents.size() - base);
+          u.names.clear();
+          for(size_t n = 0; n < count; n++)
+          {
+            path_view::c_str<> zpath(contents[base + n].leafname);
+            u.nameoffsets[n] = u.names.size();
+            u.names.insert(u.names.end(), zpath.buffer, zpath.buffer + zpath.length);
+            u.names.push_back(0);
+          }
+          for(size_t n = 0; n < count; n++)
+          {
+            const bool is_dir = contents[base + n].stat.st_type == filesystem::file_type::directory;
+            ring.unlinkat(n, dirh.native_handle().fd, u.names.data() + u.nameoffsets[n], is_dir ? AT_REMOVEDIR : 0);
+          }
+          OUTCOME_TRY(ring.submit_and_wait([&](uint64_t n, int res) {
+            auto &entry = contents[base + (size_t) n];
+            if(res == 0 || res == -ENOENT)
+            {
+              // Removed, or somebody else removed it
+              return;
+            }
+            if(res == -EINVAL || res == -EISDIR)
+            {
+              // Kernels before 5.11 do not implement UNLINKAT, and entries of unknown type may be directories
+              u.results[base + (size_t) n] = remove(dirh, entry.leafname, res == -EISDIR || entry.stat.st_type == filesystem::file_type::directory);
+              return;
+            }
+            u.results[base + (size_t) n] = posix_error(-res);
+          }));
+        }
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+#endif
+#ifdef _WIN32
+    // Each kernel thread's scratch space for removing the entries of a directory in parallel
+    struct reduce_batch_t
+    {
+      const directory_handle *dirh{nullptr};
+      directory_handle::buffers_type *contents{nullptr};
+      std::vector<result<void>> results;
+      std::atomic<size_t> next{0};
+
+      void run() noexcept
+      {
+        log_level_guard g(log_level::fatal);
+        for(size_t n = next.fetch_add(1, std::memory_order_relaxed); n < contents->size(); n = next.fetch_add(1, std::memory_order_relaxed))
+        {
+          auto &entry = (*contents)[n];
+          results[n] = remove(*dirh, entry.leafname, entry.stat.st_type == filesystem::file_type::directory);
+        }
+      }
+    };
+    /* Removes every entry in `contents` using this thread and up to `ops_in_flight - 1` threads of
+    the Win32 thread pool, placing the outcome of each into `b.results`. Most of the cost of removing
+    an entry on Windows is opening a HANDLE to it, which scales well across threads.
+    */
+    inline result<void> remove_batch(reduce_batch_t &b, const directory_handle &dirh, directory_handle::buffers_type &contents, size_t ops_in_flight) noexcept
+    {
+      try
+      {
+        b.dirh = &dirh;
+        b.contents = &contents;
+        b.results.clear();
+        b.results.resize(contents.size(), success());
+        b.next.store(0, std::memory_order_relaxed);
+        PTP_WORK work = CreateThreadpoolWork([](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) { static_cast<reduce_batch_t *>(context)->run(); }, &b, nullptr);
+        if(work != nullptr)
+        {
+          for(size_t n = (std::min)(ops_in_flight, contents.size()); n > 1; n--)
+          {
+            SubmitThreadpoolWork(work);
+          }
+        }
+        b.run();
+        if(work != nullptr)
+        {
+          WaitForThreadpoolWorkCallbacks(work, false);
+          CloseThreadpoolWork(work);
+        }
+        return success();
+      }
+      catch(...)
+      {
+        return error_from_exception();
+      }
+    }
+#endif
     struct reduction_state
     {
       const directory_handle &topdirh;
       reduce_visitor *visitor{nullptr};
+      size_t ops_in_flight{1};
       std::atomic<size_t> items_removed{0}, directory_open_failed{0}, failed_to_remove{0}, failed_to_rename{0};
 
-      reduction_state(const directory_handle &_topdirh, reduce_visitor *_visitor)
+      reduction_state(const directory_handle &_topdirh, reduce_visitor *_visitor, size_t _ops_in_flight)
           : topdirh(_topdirh)
           , visitor(_visitor)
+          , ops_in_flight(_ops_in_flight)
       {
       }
     };
@@ -278,14 +406,48 @@ namespace algorithm
   {
     auto *state = (detail::reduction_state *) data;
     bool removed_everything = true;
-    for(auto &entry : contents)
+#ifdef __linux__
+    detail::reduce_uring_t *uring = (state->ops_in_flight > 1) ? detail::reduce_uring(state->ops_in_flight) : nullptr;
+    if(uring != nullptr)
+    {
+      log_level_guard g(log_level::fatal);
+      OUTCOME_TRY(detail::remove_batch(*uring, dirh, contents));
+    }
+#endif
+#ifdef _WIN32
+    static thread_local detail::reduce_batch_t batch;
+    const bool batched = state->ops_in_flight > 1 && contents.size() > 1;
+    if(batched)
     {
+      OUTCOME_TRY(detail::remove_batch(batch, dirh, contents, state->ops_in_flight));
+    }
+#endif
+    auto remove_entry = [&](size_t n, bool is_dir) -> result<void> {
+#ifdef __linux__
+      if(uring != nullptr)
+      {
+        (void) is_dir;
+        return std::move(uring->results[n]);
+      }
+#endif
+#ifdef _WIN32
+      if(batched)
+      {
+        (void) is_dir;
+        return std::move(batch.results[n]);
+      }
+#endif
+      return detail::remove(dirh, contents[n].leafname, is_dir);
+    };
+    for(size_t n = 0; n < contents.size(); n++)
+    {
+      auto &entry = contents[n];
       switch(entry.stat.st_type)
       {
       case filesystem::file_type::directory:
       {
         log_level_guard g(log_level::fatal);
-        auto r = detail::remove(dirh, entry.leafname, true);
+        auto r = remove_entry(n, true);
         if(r)
         {
           state->items_removed.fetch_add(1, std::memory_order_relaxed);
@@ -300,7 +462,7 @@ namespace algorithm
       }
       default:
       {
-        auto r = detail::remove(dirh, entry.leafname, false);
+        auto r = remove_entry(n, false);
         if(!r)
         {
           OUTCOME_TRY(auto &&success, state->visitor->unlink_failed(data, std::move(r).error(), dirh, entry, depth));
@@ -348,7 +510,8 @@ namespace algorithm
     return false;
   }
 
-  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> reduce(directory_handle &&topdirh, reduce_visitor *visitor, size_t threads, bool force_slow_path) noexcept
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> reduce(directory_handle &&topdirh, reduce_visitor *visitor, size_t threads, bool force_slow_path,
+                                                         size_t ops_in_flight) noexcept
   {
     LLFIO_LOG_FUNCTION_CALL(&topdirh);
     reduce_visitor default_visitor;
@@ -376,8 +539,8 @@ namespace algorithm
       }
     }
     size_t round = 0;
-    detail::reduction_state state(topdirh, visitor);
-    OUTCOME_TRY(traverse(topdirh, visitor, threads, &state, force_slow_path));
+    detail::reduction_state state(topdirh, visitor, ops_in_flight);
+    OUTCOME_TRY(traverse(topdirh, visitor, threads, &state, force_slow_path, ops_in_flight));
     auto not_removed = state.directory_open_failed.load(std::memory_order_relaxed) + state.failed_to_remove.load(std::memory_order_relaxed) +
                        state.failed_to_rename.load(std::memory_order_relaxed);
     OUTCOME_TRY(visitor->reduction_round(&state, round++, state.items_removed.load(std::memory_order_relaxed), not_removed));
@@ -386,7 +549,7 @@ namespace algorithm
       state.directory_open_failed.store(0, std::memory_order_relaxed);
       state.failed_to_remove.store(0, std::memory_order_relaxed);
       state.failed_to_rename.store(0, std::memory_order_relaxed);
-      OUTCOME_TRY(traverse(topdirh, visitor, (round > 16) ? 1 : threads, &state, force_slow_path));
+      OUTCOME_TRY(traverse(topdirh, visitor, (round > 16) ? 1 : threads, &state, force_slow_path, ops_in_flight));
       not_removed = state.directory_open_failed.load(std::memory_order_relaxed) + state.failed_to_remove.load(std::memory_order_relaxed) +
                     state.failed_to_rename.load(std::memory_order_relaxed);
       OUTCOME_TRY(visitor->reduction_round(&state, round++, state.items_removed.load(std::memory_order_relaxed), not_removed));
@@ -399,6 +562,62 @@ namespace algorithm
     return state.items_removed;
   }
 
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::future<result<size_t>>> reduce_detached(directory_handle &&topdirh, const path_handle &trashdirh, reduce_visitor *visitor,
+                                                                                      size_t threads, bool force_slow_path, size_t ops_in_flight) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(&topdirh);
+    try
+    {
+      // Detach the tree from its location, so it vanishes for everybody else right now
+      optional<path_handle> parenth;
+      if(!trashdirh.is_valid())
+      {
+        OUTCOME_TRY(auto &&dirhparent, topdirh.parent_path_handle());
+        parenth.emplace(std::move(dirhparent));
+      }
+      const path_handle &base = parenth ? *parenth : trashdirh;
+      for(;;)
+      {
+        auto randomname = utils::random_string(32);
+        randomname.insert(0, ".llfio-trash-");
+        auto ret = topdirh.relink(base, randomname);
+        if(ret)
+        {
+          break;
+        }
+        if(ret.error() != errc::file_exists)
+        {
+          return std::move(ret).error();
+        }
+      }
+      struct detached_t
+      {
+        directory_handle dirh;
+        std::promise<result<size_t>> promise;
+      };
+      auto detached = std::make_shared<detached_t>();
+      detached->dirh = std::move(topdirh);
+      auto future = detached->promise.get_future();
+      auto task = [detached, visitor, threads, force_slow_path, ops_in_flight] {
+        detached->promise.set_value(reduce(std::move(detached->dirh), visitor, threads, force_slow_path, ops_in_flight));
+      };
+      try
+      {
+        std::thread(task).detach();
+      }
+      catch(const std::system_error &)
+      {
+        // Unable to launch the background thread, so reduce inline
+        task();
+      }
+      return {std::move(future)};
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
 }  // namespace algorithm
 
 LLFIO_V2_NAMESPACE_END
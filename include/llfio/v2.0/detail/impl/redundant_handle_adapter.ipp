@@ -0,0 +1,941 @@
+/* A handle storing its content redundantly across many file handles
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../algorithm/handle_adapter/redundant.hpp"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1, as used by most Reed-Solomon codes
+    struct gf256_tables
+    {
+      uint8_t exp[512];
+      uint8_t log[256];
+      gf256_tables() noexcept
+      {
+        unsigned x = 1;
+        for(unsigned i = 0; i < 255; i++)
+        {
+          exp[i] = (uint8_t) x;
+          log[x] = (uint8_t) i;
+          x <<= 1;
+          if(x & 0x100)
+          {
+            x ^= 0x11d;
+          }
+        }
+        for(unsigned i = 255; i < 512; i++)
+        {
+          exp[i] = exp[i - 255];
+        }
+        log[0] = 0;
+      }
+    };
+    inline const gf256_tables &gf256() noexcept
+    {
+      static const gf256_tables v;
+      return v;
+    }
+    inline uint8_t gf256_mul(uint8_t a, uint8_t b) noexcept
+    {
+      if(a == 0 || b == 0)
+      {
+        return 0;
+      }
+      const auto &t = gf256();
+      return t.exp[t.log[a] + t.log[b]];
+    }
+    inline uint8_t gf256_inv(uint8_t a) noexcept
+    {
+      const auto &t = gf256();
+      return t.exp[255 - t.log[a]];
+    }
+    /* dst ^= c * src over `bytes`. Each product is looked up as that of the low nibble
+    xor that of the high nibble, which SIMD byte shuffles do sixteen or thirty-two at a time.
+    */
+    inline void gf256_mul_add(uint8_t *dst, const uint8_t *src, uint8_t c, size_t bytes) noexcept
+    {
+      if(c == 0)
+      {
+        return;
+      }
+      alignas(16) uint8_t lo[16], hi[16];
+      for(unsigned x = 0; x < 16; x++)
+      {
+        lo[x] = gf256_mul(c, (uint8_t) x);
+        hi[x] = gf256_mul(c, (uint8_t) (x << 4));
+      }
+      size_t idx = 0;
+#if defined(__AVX2__)
+      {
+        const __m256i tlo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) lo));
+        const __m256i thi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) hi));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        for(; bytes - idx >= 32; idx += 32)
+        {
+          const __m256i v = _mm256_loadu_si256((const __m256i *) (src + idx));
+          const __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, _mm256_and_si256(v, mask)), _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi64(v, 4), mask)));
+          _mm256_storeu_si256((__m256i *) (dst + idx), _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (dst + idx)), p));
+        }
+      }
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+      {
+        const __m128i tlo = _mm_load_si128((const __m128i *) lo), thi = _mm_load_si128((const __m128i *) hi);
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        for(; bytes - idx >= 16; idx += 16)
+        {
+          const __m128i v = _mm_loadu_si128((const __m128i *) (src + idx));
+          const __m128i p = _mm_xor_si128(_mm_shuffle_epi8(tlo, _mm_and_si128(v, mask)), _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(v, 4), mask)));
+          _mm_storeu_si128((__m128i *) (dst + idx), _mm_xor_si128(_mm_loadu_si128((const __m128i *) (dst + idx)), p));
+        }
+      }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+      {
+        const uint8x16_t tlo = vld1q_u8(lo), thi = vld1q_u8(hi), mask = vdupq_n_u8(0x0f);
+        for(; bytes - idx >= 16; idx += 16)
+        {
+          const uint8x16_t v = vld1q_u8(src + idx);
+          const uint8x16_t p = veorq_u8(vqtbl1q_u8(tlo, vandq_u8(v, mask)), vqtbl1q_u8(thi, vshrq_n_u8(v, 4)));
+          vst1q_u8(dst + idx, veorq_u8(vld1q_u8(dst + idx), p));
+        }
+      }
+#endif
+      for(; idx < bytes; idx++)
+      {
+        dst[idx] ^= lo[src[idx] & 15] ^ hi[src[idx] >> 4];
+      }
+    }
+    // Copies `bytes` from `src` into `bufs` beginning `pos` bytes into them
+    inline void redundant_handle_adapter_scatter(span<io_handle::buffer_type> bufs, io_handle::size_type pos, const byte *src, io_handle::size_type bytes) noexcept
+    {
+      for(auto &b : bufs)
+      {
+        if(bytes == 0)
+        {
+          break;
+        }
+        if(pos >= b.size())
+        {
+          pos -= b.size();
+          continue;
+        }
+        const auto n = (std::min)(b.size() - pos, bytes);
+        memcpy(b.data() + pos, src, n);
+        src += n;
+        bytes -= n;
+        pos = 0;
+      }
+    }
+  }  // namespace detail
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter> redundant_handle_adapter::mirrored(span<file_handle *const> handles, mode _mode, flag flags) noexcept
+  {
+    if(handles.empty())
+    {
+      return errc::invalid_argument;
+    }
+    for(auto *h : handles)
+    {
+      if(h == nullptr)
+      {
+        return errc::invalid_argument;
+      }
+    }
+    try
+    {
+      result<redundant_handle_adapter> ret(redundant_handle_adapter(handles, _mode, flags));
+      LLFIO_LOG_FUNCTION_CALL(&ret.value());
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter> redundant_handle_adapter::erasure_coded(span<file_handle *const> handles, size_t parity_shards, size_type chunk_size, mode _mode,
+                                                                                                          flag flags) noexcept
+  {
+    if(parity_shards == 0 || handles.size() <= parity_shards || handles.size() > 256 || chunk_size == 0)
+    {
+      return errc::invalid_argument;
+    }
+    for(auto *h : handles)
+    {
+      if(h == nullptr)
+      {
+        return errc::invalid_argument;
+      }
+    }
+    try
+    {
+      result<redundant_handle_adapter> ret(redundant_handle_adapter(handles, _mode, flags));
+      auto &self = ret.value();
+      LLFIO_LOG_FUNCTION_CALL(&self);
+      self._mirrored = false;
+      self._data_shards = handles.size() - parity_shards;
+      self._chunk_size = chunk_size;
+      // A Cauchy matrix beneath the identity matrix, every square submatrix of which is invertible
+      const size_t k = self._data_shards;
+      self._encoding.resize(parity_shards * k);
+      for(size_t i = 0; i < parity_shards; i++)
+      {
+        for(size_t j = 0; j < k; j++)
+        {
+          self._encoding[i * k + j] = detail::gf256_inv((uint8_t) ((k + i) ^ j));
+        }
+      }
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter::size_type> redundant_handle_adapter::_shard_read(size_t idx, span<buffer_type> bufs, extent_type offset, deadline d) noexcept
+  {
+    auto &state = _shards[idx];
+    try
+    {
+      // The attached handle may return buffers other than those supplied
+      std::vector<buffer_type> reqbufs(bufs.begin(), bufs.end());
+      state.inflight.fetch_add(1, std::memory_order_relaxed);
+      const auto began = std::chrono::steady_clock::now();
+      auto r = _handles[idx]->read(io_request<buffers_type>({reqbufs.data(), reqbufs.size()}, offset), d);
+      const auto took = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - began).count();
+      state.inflight.fetch_sub(1, std::memory_order_relaxed);
+      const auto latency = state.latency.load(std::memory_order_relaxed);
+      state.latency.store(latency - latency / 8 + took / 8, std::memory_order_relaxed);
+      if(!r)
+      {
+        if(r.error() != errc::timed_out)
+        {
+          state.failed.store(true, std::memory_order_relaxed);
+        }
+        return std::move(r).error();
+      }
+      size_type bytes = 0;
+      for(size_t n = 0; n < r.value().size(); n++)
+      {
+        const auto &b = r.value()[n];
+        if(b.data() != bufs[n].data() && b.size() > 0)
+        {
+          memcpy(bufs[n].data(), b.data(), b.size());
+        }
+        bytes += b.size();
+      }
+      return bytes;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> redundant_handle_adapter::_shard_write(size_t idx, span<const_buffer_type> bufs, extent_type offset, deadline d) noexcept
+  {
+    auto &state = _shards[idx];
+    size_type bytes = 0;
+    for(const auto &b : bufs)
+    {
+      bytes += b.size();
+    }
+    auto r = _handles[idx]->write(io_request<const_buffers_type>(bufs, offset), d);
+    if(!r)
+    {
+      if(r.error() != errc::timed_out)
+      {
+        state.failed.store(true, std::memory_order_relaxed);
+      }
+      return std::move(r).error();
+    }
+    size_type written = 0;
+    for(const auto &b : r.value())
+    {
+      written += b.size();
+    }
+    if(written != bytes)
+    {
+      state.failed.store(true, std::memory_order_relaxed);
+      return errc::io_error;
+    }
+    return success();
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC std::vector<size_t> redundant_handle_adapter::_read_order(size_t exclude) const
+  {
+    std::vector<size_t> ret;
+    ret.reserve(_handles.size());
+    for(size_t n = 0; n < _handles.size(); n++)
+    {
+      if(n != exclude && !is_failed(n))
+      {
+        ret.push_back(n);
+      }
+    }
+    if(_mirrored)
+    {
+      // Fewest reads in flight first, then lowest recent latency
+      std::sort(ret.begin(), ret.end(), [this](size_t a, size_t b) {
+        const auto ia = _shards[a].inflight.load(std::memory_order_relaxed), ib = _shards[b].inflight.load(std::memory_order_relaxed);
+        if(ia != ib)
+        {
+          return ia < ib;
+        }
+        return _shards[a].latency.load(std::memory_order_relaxed) < _shards[b].latency.load(std::memory_order_relaxed);
+      });
+    }
+    return ret;
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::vector<uint8_t>> redundant_handle_adapter::_decoding(size_t idx, const std::vector<size_t> &from) const
+  {
+    const size_t k = _data_shards;
+    // The rows of the systematic encoding matrix for the shards in from, augmented with the identity matrix
+    std::vector<uint8_t> m(k * 2 * k, 0);
+    for(size_t t = 0; t < k; t++)
+    {
+      uint8_t *row = m.data() + t * 2 * k;
+      if(from[t] < k)
+      {
+        row[from[t]] = 1;
+      }
+      else
+      {
+        memcpy(row, _encoding.data() + (from[t] - k) * k, k);
+      }
+      row[k + t] = 1;
+    }
+    // Gauss-Jordan elimination, leaving the inverse in the right half
+    for(size_t col = 0; col < k; col++)
+    {
+      size_t pivot = col;
+      while(pivot < k && m[pivot * 2 * k + col] == 0)
+      {
+        pivot++;
+      }
+      if(pivot == k)
+      {
+        return errc::io_error;  // cannot happen with a Cauchy matrix
+      }
+      if(pivot != col)
+      {
+        for(size_t n = 0; n < 2 * k; n++)
+        {
+          std::swap(m[pivot * 2 * k + n], m[col * 2 * k + n]);
+        }
+      }
+      uint8_t *prow = m.data() + col * 2 * k;
+      const uint8_t inv = detail::gf256_inv(prow[col]);
+      for(size_t n = 0; n < 2 * k; n++)
+      {
+        prow[n] = detail::gf256_mul(prow[n], inv);
+      }
+      for(size_t r = 0; r < k; r++)
+      {
+        uint8_t *row = m.data() + r * 2 * k;
+        if(r != col && row[col] != 0)
+        {
+          const uint8_t c = row[col];
+          for(size_t n = 0; n < 2 * k; n++)
+          {
+            row[n] ^= detail::gf256_mul(c, prow[n]);
+          }
+        }
+      }
+    }
+    std::vector<uint8_t> ret(k, 0);
+    if(idx < k)
+    {
+      memcpy(ret.data(), m.data() + idx * 2 * k + k, k);
+    }
+    else
+    {
+      // Parity is its row of the encoding matrix applied to the decoded data
+      const uint8_t *erow = _encoding.data() + (idx - k) * k;
+      for(size_t j = 0; j < k; j++)
+      {
+        const uint8_t *drow = m.data() + j * 2 * k + k;
+        for(size_t t = 0; t < k; t++)
+        {
+          ret[t] ^= detail::gf256_mul(erow[j], drow[t]);
+        }
+      }
+    }
+    return ret;
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter::size_type> redundant_handle_adapter::_reconstruct(size_t idx, span<buffer_type> bufs, extent_type offset, deadline d) noexcept
+  {
+    try
+    {
+      size_type bytes = 0;
+      for(const auto &b : bufs)
+      {
+        bytes += b.size();
+      }
+      auto order = _read_order(idx);
+      if(_mirrored)
+      {
+        for(auto n : order)
+        {
+          auto r = _shard_read(n, bufs, offset, d);
+          if(r)
+          {
+            return r;
+          }
+        }
+        return errc::io_error;
+      }
+      const size_t k = _data_shards;
+      if(order.size() < k)
+      {
+        return errc::io_error;
+      }
+      order.resize(k);
+      OUTCOME_TRY(auto &&coefs, _decoding(idx, order));
+      // Reconstruct a window at a time
+      const size_type window = (std::min)(bytes, (size_type) 1024 * 1024);
+      OUTCOME_TRY(auto &&temph, map_handle::map(window * (k + 1)));
+      byte *out = temph.address() + window * k;
+      std::vector<optional<result<size_type>>> got(k);
+      size_type done = 0;
+      while(done < bytes)
+      {
+        const size_type thiswindow = (std::min)(window, bytes - done);
+#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
+#pragma omp parallel for if((this->_flags & flag::disable_parallelism) == 0)
+#endif
+        for(size_t t = 0; t < k; t++)
+        {
+          buffer_type b{temph.address() + t * window, thiswindow};
+          got[t] = _shard_read(order[t], {&b, 1}, offset + done, d);
+        }
+        size_type avail = thiswindow;
+        for(size_t t = 0; t < k; t++)
+        {
+          OUTCOME_TRY(auto &&n, std::move(*got[t]));
+          avail = (std::min)(avail, n);
+        }
+        memset(out, 0, avail);
+        for(size_t t = 0; t < k; t++)
+        {
+          detail::gf256_mul_add((uint8_t *) out, (const uint8_t *) temph.address() + t * window, coefs[t], avail);
+        }
+        detail::redundant_handle_adapter_scatter(bufs, done, out, avail);
+        done += avail;
+        if(avail < thiswindow)
+        {
+          break;
+        }
+      }
+      return done;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC redundant_handle_adapter::io_result<redundant_handle_adapter::buffers_type> redundant_handle_adapter::_do_read(io_request<buffers_type> reqs, deadline d) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    if(!_mirrored)
+    {
+      return _erasure_coded_read(std::move(reqs), d);
+    }
+    try
+    {
+      optional<result<size_type>> r;
+      for(auto n : _read_order((size_t) -1))
+      {
+        r = _shard_read(n, reqs.buffers, reqs.offset, d);
+        if(*r)
+        {
+          break;
+        }
+      }
+      if(!r)
+      {
+        return errc::io_error;
+      }
+      OUTCOME_TRY(auto &&bytes, std::move(*r));
+      size_t n = 0;
+      for(; n < reqs.buffers.size() && bytes > 0; n++)
+      {
+        if(reqs.buffers[n].size() > bytes)
+        {
+          reqs.buffers[n] = {reqs.buffers[n].data(), bytes};
+        }
+        bytes -= reqs.buffers[n].size();
+      }
+      return buffers_type(reqs.buffers.data(), n);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC redundant_handle_adapter::io_result<redundant_handle_adapter::buffers_type> redundant_handle_adapter::_erasure_coded_read(io_request<buffers_type> reqs, deadline d) noexcept
+  {
+    try
+    {
+      const size_t k = _data_shards;
+      const size_type stripe = _chunk_size * k;
+      // Split the request into pieces each lying within a chunk. Each data shard's pieces are
+      // physically consecutive within it, so become a single scatter read of that shard.
+      struct piece_t
+      {
+        size_t shard;
+        size_type length;
+      };
+      std::vector<piece_t> pieces;
+      std::vector<std::vector<buffer_type>> shardbufs(k);
+      std::vector<extent_type> shardoffsets(k, 0);
+      extent_type offset = reqs.offset;
+      for(auto &b : reqs.buffers)
+      {
+        for(size_type done = 0; done < b.size();)
+        {
+          const extent_type s = offset / stripe;
+          const size_type r = (size_type) (offset - s * stripe);
+          const size_t j = r / _chunk_size;
+          const size_type co = r - j * _chunk_size;
+          const size_type n = (std::min)(_chunk_size - co, b.size() - done);
+          if(shardbufs[j].empty())
+          {
+            shardoffsets[j] = s * _chunk_size + co;
+          }
+          shardbufs[j].push_back({b.data() + done, n});
+          pieces.push_back({j, n});
+          done += n;
+          offset += n;
+        }
+      }
+      std::vector<optional<result<size_type>>> got(k);
+#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
+#pragma omp parallel for if((this->_flags & flag::disable_parallelism) == 0)
+#endif
+      for(size_t j = 0; j < k; j++)
+      {
+        if(!shardbufs[j].empty())
+        {
+          span<buffer_type> bufs(shardbufs[j].data(), shardbufs[j].size());
+          if(!is_failed(j))
+          {
+            got[j] = _shard_read(j, bufs, shardoffsets[j], d);
+          }
+          if(!got[j] || !*got[j])
+          {
+            got[j] = _reconstruct(j, bufs, shardoffsets[j], d);
+          }
+        }
+      }
+      std::vector<size_type> available(k, 0);
+      for(size_t j = 0; j < k; j++)
+      {
+        if(got[j])
+        {
+          OUTCOME_TRY(auto &&n, std::move(*got[j]));
+          available[j] = n;
+        }
+      }
+      // The content read ends at the first piece not wholly read
+      size_type bytes = 0;
+      for(const auto &p : pieces)
+      {
+        const size_type n = (std::min)(p.length, available[p.shard]);
+        bytes += n;
+        available[p.shard] -= n;
+        if(n < p.length)
+        {
+          break;
+        }
+      }
+      size_t n = 0;
+      for(; n < reqs.buffers.size() && bytes > 0; n++)
+      {
+        if(reqs.buffers[n].size() > bytes)
+        {
+          reqs.buffers[n] = {reqs.buffers[n].data(), bytes};
+        }
+        bytes -= reqs.buffers[n].size();
+      }
+      return buffers_type(reqs.buffers.data(), n);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC redundant_handle_adapter::io_result<redundant_handle_adapter::const_buffers_type> redundant_handle_adapter::_do_write(io_request<const_buffers_type> reqs, deadline d) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    if(!_mirrored)
+    {
+      return _erasure_coded_write(std::move(reqs), d);
+    }
+    try
+    {
+      std::vector<optional<result<void>>> written(_handles.size());
+#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
+#pragma omp parallel for if((this->_flags & flag::disable_parallelism) == 0)
+#endif
+      for(size_t n = 0; n < _handles.size(); n++)
+      {
+        if(!is_failed(n))
+        {
+          written[n] = _shard_write(n, reqs.buffers, reqs.offset, d);
+        }
+      }
+      optional<result<void>> failure;
+      for(auto &w : written)
+      {
+        if(w)
+        {
+          if(*w)
+          {
+            return std::move(reqs.buffers);
+          }
+          failure = std::move(w);
+        }
+      }
+      if(failure)
+      {
+        return std::move(*failure).error();
+      }
+      return errc::io_error;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC redundant_handle_adapter::io_result<redundant_handle_adapter::const_buffers_type> redundant_handle_adapter::_erasure_coded_write(io_request<const_buffers_type> reqs, deadline d) noexcept
+  {
+    try
+    {
+      size_type bytes = 0;
+      for(const auto &b : reqs.buffers)
+      {
+        bytes += b.size();
+      }
+      if(bytes == 0)
+      {
+        return std::move(reqs.buffers);
+      }
+      const size_t k = _data_shards, m = _handles.size() - k;
+      const size_type stripe = _chunk_size * k;
+      const extent_type first = reqs.offset / stripe, last = (reqs.offset + bytes - 1) / stripe;
+      // Work upon up to 4Mb of stripes at a time, laid out in content order, followed by their parity
+      // laid out in shard order
+      const size_type window = (std::max)((size_type) 1, (std::min)((size_type) (last - first + 1), (size_type) (4 * 1024 * 1024) / stripe));
+      OUTCOME_TRY(auto &&temph, map_handle::map(window * (k + m) * _chunk_size));
+      byte *data = temph.address(), *parity = temph.address() + window * stripe;
+      std::vector<std::vector<const_buffer_type>> shardbufs(_handles.size());
+      std::vector<optional<result<void>>> written(_handles.size());
+      size_t bi = 0;
+      size_type bpos = 0;  // position within the supplied buffers
+      for(extent_type ws = first; ws <= last; ws += window)
+      {
+        const size_type stripes = (size_type) (std::min)((extent_type) window, last + 1 - ws);
+        const extent_type begin = ws * stripe, end = (ws + stripes) * stripe;
+        const extent_type from = (std::max)(begin, reqs.offset), to = (std::min)(end, reqs.offset + bytes);
+        // Read the remainder of any stripes only partially overwritten
+        auto readstripe = [&](size_type w) -> result<void> {
+          buffer_type b{data + w * stripe, stripe};
+          OUTCOME_TRY(auto &&r, _erasure_coded_read(io_request<buffers_type>({&b, 1}, begin + w * stripe), d));
+          const size_type got = r.empty() ? 0 : r[0].size();
+          memset(data + w * stripe + got, 0, stripe - got);
+          return success();
+        };
+        if(from > begin)
+        {
+          OUTCOME_TRY(readstripe(0));
+        }
+        if(to < end && (stripes > 1 || from == begin))
+        {
+          OUTCOME_TRY(readstripe(stripes - 1));
+        }
+        // Overlay the supplied buffers
+        for(size_type pos = (size_type) (from - begin); pos < (size_type) (to - begin);)
+        {
+          const size_type n = (std::min)(reqs.buffers[bi].size() - bpos, (size_type) (to - begin) - pos);
+          memcpy(data + pos, reqs.buffers[bi].data() + bpos, n);
+          pos += n;
+          bpos += n;
+          if(bpos == reqs.buffers[bi].size())
+          {
+            bi++;
+            bpos = 0;
+          }
+        }
+        // Compute the parity
+        memset(parity, 0, window * m * _chunk_size);
+#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
+#pragma omp parallel for if((this->_flags & flag::disable_parallelism) == 0)
+#endif
+        for(size_t i = 0; i < m; i++)
+        {
+          for(size_type w = 0; w < stripes; w++)
+          {
+            for(size_t j = 0; j < k; j++)
+            {
+              detail::gf256_mul_add((uint8_t *) parity + (i * window + w) * _chunk_size, (const uint8_t *) data + w * stripe + j * _chunk_size, _encoding[i * k + j], _chunk_size);
+            }
+          }
+        }
+        // Write every healthy shard's consecutive chunks
+        for(size_t n = 0; n < _handles.size(); n++)
+        {
+          shardbufs[n].clear();
+          if(n < k)
+          {
+            for(size_type w = 0; w < stripes; w++)
+            {
+              shardbufs[n].push_back({data + w * stripe + n * _chunk_size, _chunk_size});
+            }
+          }
+          else
+          {
+            shardbufs[n].push_back({parity + (n - k) * window * _chunk_size, stripes * _chunk_size});
+          }
+          written[n].reset();
+        }
+#if !defined(LLFIO_DISABLE_OPENMP) && defined(_OPENMP)
+#pragma omp parallel for if((this->_flags & flag::disable_parallelism) == 0)
+#endif
+        for(size_t n = 0; n < _handles.size(); n++)
+        {
+          if(!is_failed(n))
+          {
+            written[n] = _shard_write(n, {shardbufs[n].data(), shardbufs[n].size()}, ws * _chunk_size, d);
+          }
+        }
+        // The content survives so long as any k shards were written
+        size_t survivors = 0;
+        optional<result<void>> failure;
+        for(auto &w : written)
+        {
+          if(w)
+          {
+            if(*w)
+            {
+              survivors++;
+            }
+            else
+            {
+              failure = std::move(w);
+            }
+          }
+        }
+        if(survivors < k)
+        {
+          if(failure)
+          {
+            return std::move(*failure).error();
+          }
+          return errc::io_error;
+        }
+      }
+      return std::move(reqs.buffers);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC redundant_handle_adapter::io_result<redundant_handle_adapter::const_buffers_type> redundant_handle_adapter::_do_barrier(io_request<const_buffers_type> reqs, barrier_kind kind, deadline d) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    for(size_t n = 0; n < _handles.size(); n++)
+    {
+      if(!is_failed(n))
+      {
+        OUTCOME_TRY(_handles[n]->barrier(io_request<const_buffers_type>(), kind, d));
+      }
+    }
+    return std::move(reqs.buffers);
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> redundant_handle_adapter::rebuild(size_t idx, deadline d) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    if(idx >= _handles.size())
+    {
+      return errc::invalid_argument;
+    }
+    // Keep reads and writes away from the handle until it is rebuilt
+    set_failed(idx);
+    extent_type length = (extent_type) -1;
+    for(size_t n = 0; n < _handles.size(); n++)
+    {
+      if(n != idx && !is_failed(n))
+      {
+        OUTCOME_TRY(auto &&l, _handles[n]->maximum_extent());
+        length = (std::min)(length, l);
+      }
+    }
+    if(length == (extent_type) -1)
+    {
+      return errc::io_error;
+    }
+    OUTCOME_TRY(_handles[idx]->truncate(length));
+    const size_type window = (std::min)((extent_type) 1024 * 1024, (std::max)(length, (extent_type) 1));
+    OUTCOME_TRY(auto &&temph, map_handle::map(window));
+    for(extent_type offset = 0; offset < length;)
+    {
+      buffer_type b{temph.address(), (size_type) (std::min)((extent_type) window, length - offset)};
+      OUTCOME_TRY(auto &&got, _reconstruct(idx, {&b, 1}, offset, d));
+      if(got == 0)
+      {
+        return errc::io_error;
+      }
+      const_buffer_type cb{temph.address(), got};
+      auto r = _handles[idx]->write(io_request<const_buffers_type>({&cb, 1}, offset), d);
+      if(!r)
+      {
+        return std::move(r).error();
+      }
+      offset += got;
+    }
+    set_failed(idx, false);
+    return success();
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> redundant_handle_adapter::close() noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    optional<result<void>> failure;
+    for(auto *h : _handles)
+    {
+      auto r = h->close();
+      if(!r && !failure)
+      {
+        failure = std::move(r);
+      }
+    }
+    _handles.clear();
+    if(failure)
+    {
+      return std::move(*failure);
+    }
+    return success();
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter::extent_type> redundant_handle_adapter::maximum_extent() const noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    extent_type length = (extent_type) -1;
+    for(size_t n = 0; n < _handles.size(); n++)
+    {
+      if(!is_failed(n))
+      {
+        OUTCOME_TRY(auto &&l, _handles[n]->maximum_extent());
+        length = (std::min)(length, l);
+      }
+    }
+    if(length == (extent_type) -1)
+    {
+      return errc::io_error;
+    }
+    if(_mirrored)
+    {
+      return length;
+    }
+    return (length / _chunk_size) * _chunk_size * _data_shards;
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter::extent_type> redundant_handle_adapter::truncate(extent_type newsize) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    extent_type length = newsize;
+    if(!_mirrored)
+    {
+      const extent_type stripe = _chunk_size * _data_shards;
+      length = (newsize + stripe - 1) / stripe * _chunk_size;
+      newsize = length * _data_shards;
+    }
+    for(size_t n = 0; n < _handles.size(); n++)
+    {
+      if(!is_failed(n))
+      {
+        OUTCOME_TRY(_handles[n]->truncate(length));
+      }
+    }
+    return newsize;
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<redundant_handle_adapter::extent_type> redundant_handle_adapter::zero(extent_pair extent, deadline d) noexcept
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    if(_mirrored)
+    {
+      for(size_t n = 0; n < _handles.size(); n++)
+      {
+        if(!is_failed(n))
+        {
+          OUTCOME_TRY(_handles[n]->zero(extent, d));
+        }
+      }
+      return extent.length;
+    }
+    // Parity must be kept in step, so write zeros a megabyte at a time
+    static const byte zeros[65536] = {};
+    const_buffer_type bufs[16];
+    for(extent_type done = 0; done < extent.length;)
+    {
+      size_t n = 0;
+      size_type bytes = 0;
+      for(; n < 16 && done + bytes < extent.length; n++)
+      {
+        bufs[n] = {zeros, (size_type) (std::min)((extent_type) sizeof(zeros), extent.length - done - bytes)};
+        bytes += bufs[n].size();
+      }
+      OUTCOME_TRY(_do_write(io_request<const_buffers_type>({bufs, n}, extent.offset + done), d));
+      done += bytes;
+    }
+    return extent.length;
+  }
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
@@ -34,6 +34,7 @@ Distributed under the Boost Software License, Version 1.0.
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <unordered_map>
@@ -64,9 +65,7 @@ namespace algorithm
         using entities_type = shared_fs_mutex::entities_type;
 
       private:
-        std::mutex _m;
         file_handle _h;
-        std::condition_variable _changed;
         struct _entity_info
         {
           std::vector<unsigned> reader_tids;  // thread ids of all shared lock holders
@@ -83,13 +82,55 @@ namespace algorithm
             }
           }
         };
-        std::unordered_map<entity_type::value_type, _entity_info> _thread_locks;  // entity to thread lock
-        // _m mutex must be held on entry!
-        void _unlock(unsigned mythreadid, entity_type entity)
+        /* The thread locks are sharded by entity so threads locking disjoint entities do not
+        serialise upon one another.
+        */
+        static constexpr size_t _shard_count = 16;
+        struct _shard
+        {
+          std::mutex m;
+          std::condition_variable changed;
+          std::unordered_map<entity_type::value_type, _entity_info> thread_locks;  // entity to thread lock
+          uint64_t generation{0};                                                // incremented whenever an entity is unlocked
+          std::atomic<unsigned> waiters{0};                                      // threads sleeping on changed
+        } _shards[_shard_count];
+        _shard &_shard_for(entity_type::value_type v) noexcept
+        {
+          // Fibonacci hash, as entity values are frequently sequential
+          return _shards[(static_cast<uint64_t>(v) * 0x9E3779B97F4A7C15ULL) >> (64 - 4)];
+        }
+        static_assert(_shard_count == 16, "Fibonacci hash above assumes sixteen shards");
+        static deadline _remaining(deadline d, std::chrono::steady_clock::time_point began_steady) noexcept
         {
-          auto it = _thread_locks.find(entity.value);  // NOLINT
-          assert(it != _thread_locks.end());
+          deadline nd;
+          if(d)
+          {
+            if((d).steady)
+            {
+              std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now());
+              if(ns.count() < 0)
+              {
+                (nd).nsecs = 0;
+              }
+              else
+              {
+                (nd).nsecs = ns.count();
+              }
+            }
+            else
+            {
+              (nd) = (d);
+            }
+          }
+          return nd;
+        }
+        // shard mutex must be held on entry!
+        void _unlock(_shard &shard, unsigned mythreadid, entity_type entity)
+        {
+          auto it = shard.thread_locks.find(entity.value);  // NOLINT
+          assert(it != shard.thread_locks.end());
           assert(it->second.writer_tid == mythreadid || it->second.writer_tid == 0);
+          ++shard.generation;
           if(it->second.writer_tid == mythreadid)
           {
             if(!it->second.reader_tids.empty())
@@ -121,7 +162,20 @@ namespace algorithm
           {
             // Release the lock and delete this entity from the map
             _h.unlock_file_range(entity.value, 1);
-            _thread_locks.erase(it);
+            shard.thread_locks.erase(it);
+          }
+        }
+        void _unlock(unsigned mythreadid, entity_type entity)
+        {
+          auto &shard = _shard_for(entity.value);
+          {
+            std::lock_guard<decltype(shard.m)> guard(shard.m);
+            _unlock(shard, mythreadid, entity);
+          }
+          // Only pay for a wake if somebody is sleeping
+          if(shard.waiters.load(std::memory_order_acquire) != 0)
+          {
+            shard.changed.notify_all();
           }
         }
 
@@ -154,8 +208,8 @@ namespace algorithm
           for(;;)
           {
             auto was_contended = static_cast<size_t>(-1);
+            uint64_t was_contended_generation = 0;
             bool pls_sleep = true;
-            std::unique_lock<decltype(_m)> guard(_m);
             {
               auto undo = make_scope_exit([&]() noexcept {
                 // 0 to (n-1) need to be closed
@@ -172,40 +226,16 @@ namespace algorithm
               });
               for(n = 0; n < out.entities.size(); n++)
               {
-                auto it = _thread_locks.find(out.entities[n].value);
-                if(it == _thread_locks.end())
+                // Only this entity's shard is locked, and never more than one shard at a time
+                auto &shard = _shard_for(out.entities[n].value);
+                std::unique_lock<decltype(shard.m)> guard(shard.m);
+                auto it = shard.thread_locks.find(out.entities[n].value);
+                if(it == shard.thread_locks.end())
                 {
                   // This entity has not been locked before
-                  deadline nd;
                   // Only for very first entity will we sleep until its lock becomes available
-                  if(n != 0u)
-                  {
-                    nd = deadline(std::chrono::seconds(0));
-                  }
-                  else
-                  {
-                    nd = deadline();
-                    if(d)
-                    {
-                      if((d).steady)
-                      {
-                        std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now());
-                        if(ns.count() < 0)
-                        {
-                          (nd).nsecs = 0;
-                        }
-                        else
-                        {
-                          (nd).nsecs = ns.count();
-                        }
-                      }
-                      else
-                      {
-                        (nd) = (d);
-                      }
-                    }
-                  }
-                  // Allow other threads to use this threaded_byte_ranges
+                  deadline nd = (n != 0u) ? deadline(std::chrono::seconds(0)) : _remaining(d, began_steady);
+                  // Allow other threads to use this shard
                   guard.unlock();
                   auto outcome = _h.lock_file_range(out.entities[n].value, 1, (out.entities[n].exclusive != 0u) ? lock_kind::exclusive : lock_kind::shared, nd);
                   guard.lock();
@@ -216,10 +246,10 @@ namespace algorithm
                     goto failed;
                   }
                   // Did another thread already fill this in?
-                  it = _thread_locks.find(out.entities[n].value);
-                  if(it == _thread_locks.end())
+                  it = shard.thread_locks.find(out.entities[n].value);
+                  if(it == shard.thread_locks.end())
                   {
-                    it = _thread_locks.insert(std::make_pair(static_cast<entity_type::value_type>(out.entities[n].value), _entity_info(out.entities[n].exclusive != 0u, mythreadid, std::move(outcome).value()))).first;
+                    it = shard.thread_locks.insert(std::make_pair(static_cast<entity_type::value_type>(out.entities[n].value), _entity_info(out.entities[n].exclusive != 0u, mythreadid, std::move(outcome).value()))).first;
                     continue;
                   }
                   // Otherwise throw away the presumably shared superfluous byte range lock
@@ -245,6 +275,7 @@ namespace algorithm
                   }
                   // Some other thread holds the exclusive lock, so we cannot take it
                   was_contended = n;
+                  was_contended_generation = shard.generation;
                   pls_sleep = true;
                   goto failed;
                 }
@@ -263,45 +294,26 @@ namespace algorithm
                 }
                 // We are thus now upgrading shared to exclusive
                 assert(out.entities[n].exclusive);
-                deadline nd;
                 // Only for very first entity will we sleep until its lock becomes available
-                if(n != 0u)
-                {
-                  nd = deadline(std::chrono::seconds(0));
-                }
-                else
-                {
-                  nd = deadline();
-                  if(d)
-                  {
-                    if((d).steady)
-                    {
-                      std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now());
-                      if(ns.count() < 0)
-                      {
-                        (nd).nsecs = 0;
-                      }
-                      else
-                      {
-                        (nd).nsecs = ns.count();
-                      }
-                    }
-                    else
-                    {
-                      (nd) = (d);
-                    }
-                  }
-                }
-                // Allow other threads to use this threaded_byte_ranges
+                deadline nd = (n != 0u) ? deadline(std::chrono::seconds(0)) : _remaining(d, began_steady);
+                // Allow other threads to use this shard
                 guard.unlock();
                 auto outcome = _h.lock_file_range(out.entities[n].value, 1, lock_kind::exclusive, nd);
                 guard.lock();
                 if(!outcome)
                 {
+                  // Another process holds the lock, so there is nothing in this process to sleep upon
                   was_contended = n;
+                  pls_sleep = false;
                   goto failed;
                 }
-// unordered_map iterators do not invalidate, so no need to refresh
+                // The entity may have been unlocked by its readers whilst the shard was unlocked
+                it = shard.thread_locks.find(out.entities[n].value);
+                if(it == shard.thread_locks.end())
+                {
+                  shard.thread_locks.insert(std::make_pair(static_cast<entity_type::value_type>(out.entities[n].value), _entity_info(true, mythreadid, std::move(outcome).value())));
+                  continue;
+                }
 #ifndef _WIN32
                 // On POSIX byte range locks replace
                 it->second.filelock.release();
@@ -339,16 +351,25 @@ namespace algorithm
             QUICKCPPLIB_NAMESPACE::algorithm::small_prng::random_shuffle(front, out.entities.end());
             if(pls_sleep && !spin_not_sleep)
             {
-              // Sleep until the thread locks next change
-              if((d).steady)
+              // Sleep until the contended entity's shard changes
+              auto &shard = _shard_for(out.entities[0].value);
+              std::unique_lock<decltype(shard.m)> guard(shard.m);
+              auto changed = [&] { return shard.generation != was_contended_generation; };
+              shard.waiters.fetch_add(1, std::memory_order_acq_rel);
+              if(!d)
+              {
+                shard.changed.wait(guard, changed);
+              }
+              else if((d).steady)
               {
                 std::chrono::nanoseconds ns = std::chrono::duration_cast<std::chrono::nanoseconds>((began_steady + std::chrono::nanoseconds((d).nsecs)) - std::chrono::steady_clock::now());
-                _changed.wait_for(guard, ns);
+                shard.changed.wait_for(guard, ns, changed);
               }
               else
               {
-                _changed.wait_until(guard, d.to_time_point());
+                shard.changed.wait_until(guard, end_utc, changed);
               }
+              shard.waiters.fetch_sub(1, std::memory_order_acq_rel);
             }
           }
           // return success();
@@ -357,7 +378,6 @@ namespace algorithm
         {
           LLFIO_LOG_FUNCTION_CALL(this);
           unsigned mythreadid = QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id();
-          std::unique_lock<decltype(_m)> guard(_m);
           for(auto &entity : entities)
           {
             _unlock(mythreadid, entity);
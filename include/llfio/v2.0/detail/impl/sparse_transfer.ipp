@@ -0,0 +1,256 @@
+/* Sparse aware transfer of files through pipes and sockets
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../algorithm/sparse_transfer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    static constexpr char sparse_transfer_magic[8] = {'L', 'L', 'F', 'I', 'O', 'S', 'P', 'R'};
+    static constexpr uint64_t sparse_transfer_end = (uint64_t) -1;
+    static constexpr size_t sparse_transfer_chunk = 1024 * 1024;
+
+    inline void sparse_transfer_encode(byte *p, uint64_t v) noexcept
+    {
+      for(size_t n = 0; n < 8; n++)
+      {
+        p[n] = (byte)(v >> (n * 8));
+      }
+    }
+    inline uint64_t sparse_transfer_decode(const byte *p) noexcept
+    {
+      uint64_t v = 0;
+      for(size_t n = 0; n < 8; n++)
+      {
+        v |= (uint64_t) p[n] << (n * 8);
+      }
+      return v;
+    }
+    inline bool sparse_transfer_is_zero(const byte *p, size_t bytes) noexcept
+    {
+      static const byte zeros[4096] = {};
+      for(; bytes >= sizeof(zeros); bytes -= sizeof(zeros), p += sizeof(zeros))
+      {
+        if(0 != memcmp(p, zeros, sizeof(zeros)))
+        {
+          return false;
+        }
+      }
+      return bytes == 0 || 0 == memcmp(p, zeros, bytes);
+    }
+  }  // namespace detail
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<sparse_transfer_stats> send_sparse(file_handle &src, io_handle &dest, bool skip_zeros, deadline d) noexcept
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    sparse_transfer_stats ret;
+    auto write_all = [&](const byte *p, size_t bytes) -> result<void> {
+      while(bytes > 0)
+      {
+        deadline nd;
+        LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+        OUTCOME_TRY(auto &&written, dest.write(0, {{p, bytes}}, nd));
+        p += written;
+        bytes -= written;
+        if(bytes > 0)
+        {
+          LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        }
+      }
+      return success();
+    };
+    auto write_frame = [&](uint64_t offset, const byte *p, size_t bytes) -> result<void> {
+      byte header[16];
+      detail::sparse_transfer_encode(header, offset);
+      detail::sparse_transfer_encode(header + 8, bytes);
+      OUTCOME_TRYV(write_all(header, sizeof(header)));
+      OUTCOME_TRYV(write_all(p, bytes));
+      if(offset != detail::sparse_transfer_end)
+      {
+        ++ret.frames;
+        ret.data_bytes += bytes;
+      }
+      return success();
+    };
+    OUTCOME_TRY(ret.length, src.maximum_extent());
+    {
+      byte header[16];
+      memcpy(header, detail::sparse_transfer_magic, 8);
+      detail::sparse_transfer_encode(header + 8, ret.length);
+      OUTCOME_TRYV(write_all(header, sizeof(header)));
+    }
+    size_t bytes = detail::sparse_transfer_chunk;
+    OUTCOME_TRY(auto &&buffer, src.allocate_registered_buffer(bytes));
+    const size_t block = utils::page_size();
+    file_handle::extent_pair out[64];
+    for(file_handle::extent_type cursor = 0; cursor < ret.length;)
+    {
+      OUTCOME_TRY(auto &&extents, src.extents(out, {cursor, ret.length - cursor}));
+      if(extents.empty())
+      {
+        break;
+      }
+      for(auto &extent : extents)
+      {
+        const auto end = (std::min)(extent.offset + extent.length, ret.length);
+        for(auto offset = extent.offset; offset < end;)
+        {
+          const size_t toread = static_cast<size_t>((std::min)(end - offset, (file_handle::extent_type) buffer->size()));
+          deadline nd;
+          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+          OUTCOME_TRY(auto &&read, src.read(offset, {{buffer->data(), toread}}, nd));
+          if(read == 0)
+          {
+            // Truncated whilst being sent
+            break;
+          }
+          if(!skip_zeros)
+          {
+            OUTCOME_TRYV(write_frame(offset, buffer->data(), read));
+          }
+          else
+          {
+            // Send each run of blocks which are not all zero as a frame
+            size_t runstart = 0, idx = 0;
+            for(; idx < read; idx += block)
+            {
+              const size_t thisblock = (std::min)(block, read - idx);
+              if(detail::sparse_transfer_is_zero(buffer->data() + idx, thisblock))
+              {
+                if(idx > runstart)
+                {
+                  OUTCOME_TRYV(write_frame(offset + runstart, buffer->data() + runstart, idx - runstart));
+                }
+                runstart = idx + thisblock;
+              }
+            }
+            if(read > runstart)
+            {
+              OUTCOME_TRYV(write_frame(offset + runstart, buffer->data() + runstart, read - runstart));
+            }
+          }
+          offset += read;
+          LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        }
+        cursor = (std::max)(cursor, extent.offset + extent.length);
+      }
+    }
+    OUTCOME_TRYV(write_frame(detail::sparse_transfer_end, nullptr, 0));
+    ret.hole_bytes = ret.length - ret.data_bytes;
+    return ret;
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<sparse_transfer_stats> receive_sparse(io_handle &src, file_handle &dest, deadline d) noexcept
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    sparse_transfer_stats ret;
+    auto read_all = [&](byte *p, size_t bytes) -> result<void> {
+      while(bytes > 0)
+      {
+        deadline nd;
+        LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+        OUTCOME_TRY(auto &&read, src.read(0, {{p, bytes}}, nd));
+        if(read == 0)
+        {
+          return errc::illegal_byte_sequence;
+        }
+        p += read;
+        bytes -= read;
+        if(bytes > 0)
+        {
+          LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        }
+      }
+      return success();
+    };
+    byte header[16];
+    OUTCOME_TRYV(read_all(header, sizeof(header)));
+    if(0 != memcmp(header, detail::sparse_transfer_magic, 8))
+    {
+      return errc::illegal_byte_sequence;
+    }
+    ret.length = detail::sparse_transfer_decode(header + 8);
+    // Devices cannot be truncated, so their holes are deallocated instead
+    const bool use_zero = !dest.truncate(0);
+    size_t bytes = detail::sparse_transfer_chunk;
+    OUTCOME_TRY(auto &&buffer, dest.allocate_registered_buffer(bytes));
+    file_handle::extent_type filled = 0;  // the end of the last frame
+    auto hole = [&](file_handle::extent_type end) -> result<void> {
+      if(use_zero && end > filled)
+      {
+        OUTCOME_TRYV(dest.zero({filled, end - filled}));
+      }
+      return success();
+    };
+    for(;;)
+    {
+      OUTCOME_TRYV(read_all(header, sizeof(header)));
+      const uint64_t offset = detail::sparse_transfer_decode(header), length = detail::sparse_transfer_decode(header + 8);
+      if(offset == detail::sparse_transfer_end)
+      {
+        break;
+      }
+      if(offset < filled || offset > ret.length || length > ret.length - offset)
+      {
+        return errc::illegal_byte_sequence;
+      }
+      OUTCOME_TRYV(hole(offset));
+      for(uint64_t done = 0; done < length;)
+      {
+        const size_t towrite = static_cast<size_t>((std::min)(length - done, (uint64_t) buffer->size()));
+        OUTCOME_TRYV(read_all(buffer->data(), towrite));
+        deadline nd;
+        LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+        OUTCOME_TRY(auto &&written, dest.write(offset + done, {{buffer->data(), towrite}}, nd));
+        if(written != towrite)
+        {
+          return errc::no_space_on_device;
+        }
+        done += towrite;
+      }
+      filled = offset + length;
+      ++ret.frames;
+      ret.data_bytes += length;
+    }
+    if(use_zero)
+    {
+      OUTCOME_TRYV(hole(ret.length));
+    }
+    else
+    {
+      OUTCOME_TRYV(dest.truncate(ret.length));
+    }
+    ret.hole_bytes = ret.length - ret.data_bytes;
+    return ret;
+  }
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
@@ -24,16 +24,30 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../directory_handle.hpp"
 #include "../../file_handle.hpp"
+#include "../../map_handle.hpp"
+#include "../../mapped_file_handle.hpp"
+#include "../../stat.hpp"
 #include "../../statfs.hpp"
 #include "../../storage_profile.hpp"
 #include "../../utils.hpp"
 
+#include "quickcpplib/algorithm/hash.hpp"
 #include "quickcpplib/algorithm/small_prng.hpp"
 
+#include <array>
+#include <functional>
 #include <future>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
-#ifndef NDEBUG
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <emmintrin.h>
+#endif
 #include <fstream>
+#include <sstream>
+#ifndef NDEBUG
 #include <iostream>
 #endif
 
@@ -95,11 +109,14 @@ namespace storage_profile
           }
         }
         std::string name(s, e - s);
+        // Once a section differs from the last item's, all its subsections must be emitted anew
+        bool diverged = false;
         for(size_t n = 0; n < thissection.size(); n++)
         {
           indent += 4;
-          if(n >= lastsection.size() || thissection[n] != lastsection[n])
+          if(diverged || n >= lastsection.size() || thissection[n] != lastsection[n])
           {
+            diverged = true;
             out << std::string(indent - 4, ' ') << thissection[n] << ":\n";
           }
         }
@@ -154,8 +171,453 @@ namespace storage_profile
     }
   }
 
+  template <class T> inline void _parse_value(T &v, const std::string &text)
+  {
+    std::istringstream in(text);
+    in >> v;
+  }
+  inline void _parse_value(std::string &v, const std::string &text) { v = text; }
+
+  void storage_profile::read(std::istream &in, std::regex which)
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    // Parses only the indented subset of YAML which write() emits
+    std::vector<std::string> sections;
+    std::string line, name;
+    while(std::getline(in, line))
+    {
+      if(!line.empty() && line.back() == '\r')
+      {
+        line.pop_back();
+      }
+      const size_t indent = line.find_first_not_of(' ');
+      if(indent == std::string::npos || line[indent] == '#')
+      {
+        continue;
+      }
+      const size_t colon = line.find(':', indent);
+      if(colon == std::string::npos || indent / 4 > sections.size())
+      {
+        continue;
+      }
+      sections.resize(indent / 4);
+      if(colon + 1 >= line.size())
+      {
+        sections.emplace_back(line, indent, colon - indent);
+        continue;
+      }
+      name.clear();
+      for(auto &section : sections)
+      {
+        name.append(section);
+        name.push_back(':');
+      }
+      name.append(line, indent, colon - indent);
+      if(!std::regex_match(name, which))
+      {
+        continue;
+      }
+      const size_t valueidx = line.find_first_not_of(' ', colon + 1);
+      if(valueidx == std::string::npos)
+      {
+        continue;
+      }
+      const std::string value(line, valueidx);
+      for(item_erased &i : *this)
+      {
+        if(name == i.name)
+        {
+          i.invoke([&value](auto &item) { _parse_value(const_cast<std::decay_t<decltype(item)> &>(item).value, value); });
+          break;
+        }
+      }
+    }
+  }
+
+  inline uint64_t _binary_value(io_handle::extent_type v, std::string & /*unused*/) noexcept { return v; }
+  inline uint64_t _binary_value(unsigned v, std::string & /*unused*/) noexcept { return v; }
+  inline uint64_t _binary_value(float v, std::string & /*unused*/) noexcept
+  {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return bits;
+  }
+  // Strings are offset from the start of the names and strings, fixed up once their start is known
+  inline uint64_t _binary_value(const std::string &v, std::string &strings)
+  {
+    const uint64_t ret = (static_cast<uint64_t>(strings.size()) << 32) | v.size();
+    strings.append(v);
+    return ret;
+  }
+
+  void storage_profile::write_binary(std::ostream &out, string_view label, const std::regex &which, bool invert_match) const
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    std::vector<binary_profile::binary_item> items;
+    std::string strings;
+    auto add = [&items, &strings](auto &i) {
+      if(i.value != default_value<decltype(i.value)>())
+      {
+        binary_profile::binary_item bi{};
+        const size_t namelen = strlen(i.name);
+        bi.name_hash = binary_profile::hash_name({i.name, namelen});
+        bi.name_offset = static_cast<uint32_t>(strings.size());
+        bi.name_length = static_cast<uint16_t>(namelen);
+        bi.type = static_cast<uint8_t>(i.type);
+        strings.append(i.name, namelen);
+        bi.value = _binary_value(i.value, strings);
+        items.push_back(bi);
+      }
+    };
+    for(const item_erased &i : *this)
+    {
+      bool matches = std::regex_match(i.name, which);
+      if((matches && !invert_match) || (!matches && invert_match))
+      {
+        i.invoke(add);
+      }
+    }
+    std::sort(items.begin(), items.end(), [](const binary_profile::binary_item &a, const binary_profile::binary_item &b) { return a.name_hash < b.name_hash; });
+    const size_t base = sizeof(binary_profile::header) + items.size() * sizeof(binary_profile::binary_item) + label.size();
+    for(auto &bi : items)
+    {
+      bi.name_offset += static_cast<uint32_t>(base);
+      if(bi.type == static_cast<uint8_t>(storage_types::string))
+      {
+        bi.value += static_cast<uint64_t>(base) << 32;
+      }
+    }
+    // Pad to eight bytes, so binary profiles can be concatenated and still be viewed in place
+    const size_t padding = (8 - ((base + strings.size()) & 7)) & 7;
+    binary_profile::header h{};
+    memcpy(h.magic, "llfiospb", sizeof(h.magic));
+    h.byte_order = 0x01020304;
+    h.version = 1;
+    h.items = static_cast<uint32_t>(items.size());
+    h.label_length = static_cast<uint32_t>(label.size());
+    h.bytes = base + strings.size() + padding;
+    out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char *>(items.data()), static_cast<std::streamsize>(items.size() * sizeof(binary_profile::binary_item)));
+    out.write(label.data(), static_cast<std::streamsize>(label.size()));
+    out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    out.write("\0\0\0\0\0\0\0", static_cast<std::streamsize>(padding));
+  }
+
+  template <class T> inline void _read_binary_value(T &v, const binary_profile & /*unused*/, const binary_profile::binary_item &bi) { v = binary_profile::_decode<T>(bi); }
+  inline void _read_binary_value(std::string &v, const binary_profile &in, const binary_profile::binary_item &bi)
+  {
+    const auto s = in.string_value(bi);
+    v.assign(s.data(), s.size());
+  }
+
+  void storage_profile::read(const binary_profile &in)
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    for(item_erased &i : *this)
+    {
+      const auto *bi = in.find(i.name);
+      if(bi != nullptr && bi->type == static_cast<uint8_t>(i.type))
+      {
+        i.invoke([&in, bi](auto &item) { _read_binary_value(const_cast<std::decay_t<decltype(item)> &>(item).value, in, *bi); });
+      }
+    }
+  }
+
+  void storage_profile::read(const binary_profile &in, const std::regex &which)
+  {
+    LLFIO_LOG_FUNCTION_CALL(this);
+    for(item_erased &i : *this)
+    {
+      const auto *bi = in.find(i.name);
+      if(bi != nullptr && bi->type == static_cast<uint8_t>(i.type) && std::regex_match(i.name, which))
+      {
+        i.invoke([&in, bi](auto &item) { _read_binary_value(const_cast<std::decay_t<decltype(item)> &>(item).value, in, *bi); });
+      }
+    }
+  }
+
+  result<binary_profile> binary_profile::view(span<const byte> data) noexcept
+  {
+    if((reinterpret_cast<uintptr_t>(data.data()) & 7) != 0)
+    {
+      return errc::invalid_argument;
+    }
+    if(data.size() < sizeof(header))
+    {
+      return errc::illegal_byte_sequence;
+    }
+    const auto *h = reinterpret_cast<const header *>(data.data());
+    if(0 != memcmp(h->magic, "llfiospb", sizeof(h->magic)) || h->byte_order != 0x01020304 || h->version != 1 || h->bytes > data.size() ||
+       sizeof(header) + static_cast<uint64_t>(h->items) * sizeof(binary_item) + h->label_length > h->bytes)
+    {
+      return errc::illegal_byte_sequence;
+    }
+    const auto *items = reinterpret_cast<const binary_item *>(data.data() + sizeof(header));
+    for(uint32_t n = 0; n < h->items; n++)
+    {
+      const auto &i = items[n];
+      if(static_cast<uint64_t>(i.name_offset) + i.name_length > h->bytes || i.type == static_cast<uint8_t>(storage_types::unknown) ||
+         i.type > static_cast<uint8_t>(storage_types::string) || (n > 0 && i.name_hash < items[n - 1].name_hash))
+      {
+        return errc::illegal_byte_sequence;
+      }
+      if(i.type == static_cast<uint8_t>(storage_types::string) && (i.value >> 32) + (i.value & 0xffffffff) > h->bytes)
+      {
+        return errc::illegal_byte_sequence;
+      }
+    }
+    binary_profile ret;
+    ret._data = data.data();
+    return {std::move(ret)};
+  }
+
+  result<binary_profile> binary_profile::open(const path_handle &base, mapped_file_handle::path_view_type path) noexcept
+  {
+    OUTCOME_TRY(auto &&mh, mapped_file_handle::mapped_file(base, path));
+    OUTCOME_TRY(auto &&length, mh.maximum_extent());
+    OUTCOME_TRY(auto &&ret, view({mh.address(), static_cast<size_t>(length)}));
+    ret._mh = std::move(mh);
+    return {std::move(ret)};
+  }
+
+  result<std::string> device_key(file_handle &h) noexcept
+  {
+    try
+    {
+      statfs_t fsinfo;
+      OUTCOME_TRYV(fsinfo.fill(h, statfs_t::want::mntfromname | statfs_t::want::fstypename));
+      std::string ret(fsinfo.f_fstypename);
+      ret.push_back(' ');
+      ret.append(fsinfo.f_mntfromname);
+#ifdef WIN32
+      std::string serial(storage::windows::_device_serial(h));
+#else
+      std::string serial(storage::posix::_device_serial(h));
+#endif
+      if(!serial.empty())
+      {
+        ret.append(" serial=");
+        ret.append(serial);
+      }
+      ret.append(" caching=");
+      ret.append(std::to_string(static_cast<unsigned>(h.kernel_caching())));
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  // The cache file for a device, and the first line it must begin with
+  inline result<std::pair<filesystem::path, std::string>> _cache_file(file_handle &h) noexcept
+  {
+    try
+    {
+      OUTCOME_TRY(auto &&key, device_key(h));
+      OUTCOME_TRY(auto &&dir, cache_directory());
+      const auto hash = QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash(key.data(), key.size());
+      char leafname[40];
+      snprintf(leafname, sizeof(leafname), "%016llx%016llx.yaml", (unsigned long long) hash.as_longlongs[0], (unsigned long long) hash.as_longlongs[1]);
+      return std::pair<filesystem::path, std::string>(dir / leafname, "# device_key: " + key);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  result<void> load_cached(storage_profile &sp, file_handle &h, std::regex which) noexcept
+  {
+    try
+    {
+      OUTCOME_TRY(auto &&file, _cache_file(h));
+      std::ifstream in(file.first);
+      std::string line;
+      // A hash collision with a different device is treated as nothing cached
+      if(!in.is_open() || !std::getline(in, line) || line != file.second)
+      {
+        return errc::no_such_file_or_directory;
+      }
+      sp.read(in, std::move(which));
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  result<void> save_cached(const storage_profile &sp, file_handle &h) noexcept
+  {
+    try
+    {
+      OUTCOME_TRY(auto &&file, _cache_file(h));
+      filesystem::create_directories(file.first.parent_path());
+      // Write a uniquely named file, then rename it over the cached profile
+      filesystem::path temp(file.first);
+      temp += "." + utils::random_string(16);
+      auto untemp = make_scope_exit([&temp]() noexcept {
+        std::error_code ec;
+        filesystem::remove(temp, ec);
+      });
+      {
+        std::ofstream out(temp);
+        out << file.second << "\n";
+        sp.write(out);
+        out.flush();
+        if(!out)
+        {
+          return errc::io_error;
+        }
+      }
+      // The binary profile is labelled with the device key, as the cache file's first line is
+      filesystem::path bintemp(temp);
+      bintemp += ".bin";
+      auto unbintemp = make_scope_exit([&bintemp]() noexcept {
+        std::error_code ec;
+        filesystem::remove(bintemp, ec);
+      });
+      {
+        std::ofstream out(bintemp, std::ios::binary);
+        sp.write_binary(out, string_view(file.second).substr(sizeof("# device_key: ") - 1));
+        out.flush();
+        if(!out)
+        {
+          return errc::io_error;
+        }
+      }
+      filesystem::rename(temp, file.first);
+      untemp.release();
+      filesystem::rename(bintemp, filesystem::path(file.first).replace_extension(".bin"));
+      unbintemp.release();
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  result<binary_profile> map_cached(file_handle &h) noexcept
+  {
+    try
+    {
+      OUTCOME_TRY(auto &&file, _cache_file(h));
+      OUTCOME_TRY(auto &&dirh, path_handle::path(file.first.parent_path()));
+      auto ret = binary_profile::open(dirh, filesystem::path(file.first.filename()).replace_extension(".bin"));
+      if(!ret)
+      {
+        return std::move(ret).error();
+      }
+      // A hash collision with a different device is treated as nothing cached
+      if(ret.value().label() != string_view(file.second).substr(sizeof("# device_key: ") - 1))
+      {
+        return errc::no_such_file_or_directory;
+      }
+      return ret;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  inline void _write_csv_field(std::ostream &out, string_view v)
+  {
+    out << '"';
+    for(char c : v)
+    {
+      if(c == '"')
+      {
+        out << '"';
+      }
+      out << c;
+    }
+    out << '"';
+  }
+
+  void write_csv(std::ostream &out, span<const binary_profile> profiles)
+  {
+    LLFIO_LOG_FUNCTION_CALL(0);
+    std::vector<string_view> names;
+    for(auto &profile : profiles)
+    {
+      for(auto &i : profile.items())
+      {
+        names.push_back(profile.name(i));
+      }
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    out << "label";
+    for(auto &name : names)
+    {
+      out << ',';
+      _write_csv_field(out, name);
+    }
+    out << "\n";
+    for(auto &profile : profiles)
+    {
+      _write_csv_field(out, profile.label());
+      for(auto &name : names)
+      {
+        out << ',';
+        const auto *i = profile.find(name);
+        if(i == nullptr)
+        {
+          continue;
+        }
+        switch(static_cast<storage_types>(i->type))
+        {
+        case storage_types::extent_type:
+        case storage_types::unsigned_long_long:
+          out << binary_profile::_decode<unsigned long long>(*i);
+          break;
+        case storage_types::unsigned_int:
+          out << binary_profile::_decode<unsigned>(*i);
+          break;
+        case storage_types::float_:
+          out << binary_profile::_decode<float>(*i);
+          break;
+        case storage_types::string:
+          _write_csv_field(out, profile.string_value(*i));
+          break;
+        case storage_types::unknown:
+          break;
+        }
+      }
+      out << "\n";
+    }
+  }
+
+  result<std::unique_ptr<file_handle>> file_for_reads(const storage_profile &sp, const path_handle &base, file_handle::path_view_type path, size_t request_size, bool sequential,
+                                                      bool warm_cache, file_handle::mode _mode, file_handle::creation _creation, file_handle::caching _caching,
+                                                      file_handle::flag flags) noexcept
+  {
+    try
+    {
+      if(prefer_mapped_reads(sp, request_size, sequential, warm_cache))
+      {
+        OUTCOME_TRY(auto &&mfh, mapped_file_handle::mapped_file(base, path, _mode, _creation, _caching, flags));
+        return std::unique_ptr<file_handle>(new mapped_file_handle(std::move(mfh)));
+      }
+      OUTCOME_TRY(auto &&fh, file_handle::file(base, path, _mode, _creation, _caching, flags));
+      return std::unique_ptr<file_handle>(new file_handle(std::move(fh)));
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+
   namespace system
   {
+    inline double _seconds_since(std::chrono::high_resolution_clock::time_point begin) noexcept
+    {
+      return std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::high_resolution_clock::now() - begin).count();
+    }
     // System memory quantity, in use, max and min bandwidth
     outcome<void> mem(storage_profile &sp, file_handle &h) noexcept
     {
@@ -195,7 +657,7 @@ namespace storage_profile
           {
             memset(buffer, count & 0xff, chunksize);
           }
-          sp.mem_max_bandwidth.value = static_cast<unsigned long long>(static_cast<double>(count) * chunksize / 10);
+          sp.mem_max_bandwidth.value = static_cast<unsigned long long>(static_cast<double>(count) * chunksize / _seconds_since(begin));
 
           // Min bandwidth is randomised 4Kb copies of the same
           QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng ctx(78);
@@ -209,7 +671,7 @@ namespace storage_profile
               memset(buffer + offset, count & 0xff, 4096);
             }
           }
-          sp.mem_min_bandwidth.value = static_cast<unsigned long long>(static_cast<double>(count) * chunksize / 10);
+          sp.mem_min_bandwidth.value = static_cast<unsigned long long>(static_cast<double>(count) * chunksize / _seconds_since(begin));
         }
         catch(...)
         {
@@ -223,6 +685,144 @@ namespace storage_profile
       return success();
     }
 
+    // Fills with stores which bypass the CPU caches where the CPU has them
+    inline void _nontemporal_fill(byte *dest, size_t bytes, int value) noexcept
+    {
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__SSE2__) && (defined(__i386__) || defined(_M_IX86)))
+      const __m128i v = _mm_set1_epi8(static_cast<char>(value));
+      for(size_t n = 0; n < bytes; n += 64)
+      {
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dest + n), v);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dest + n + 16), v);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dest + n + 32), v);
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dest + n + 48), v);
+      }
+      _mm_sfence();
+#else
+      memset(dest, value, bytes);
+#endif
+    }
+    // memcpy and non-temporal store bandwidth, nvram_barrier() cost, page fault and map latency
+    outcome<void> mem_probes(storage_profile &sp, file_handle &h) noexcept
+    {
+      static storage_profile cached;
+      if(cached.mem_memcpy_bandwidth.value != static_cast<unsigned long long>(-1))
+      {
+        for(auto *i : {&storage_profile::mem_memcpy_bandwidth, &storage_profile::mem_memcpy_bandwidth_all_cores, &storage_profile::mem_nontemporal_bandwidth,
+                       &storage_profile::mem_nvram_barrier_64b, &storage_profile::mem_nvram_barrier_4Kb, &storage_profile::mem_nvram_barrier_64Kb,
+                       &storage_profile::mem_nvram_barrier_1Mb, &storage_profile::mem_page_fault, &storage_profile::mem_map_first_touch})
+        {
+          (sp.*i).value = (cached.*i).value;
+        }
+        return success();
+      }
+      try
+      {
+        OUTCOME_TRYV(mem(sp, h));
+        static constexpr int duration = 10 / LLFIO_STORAGE_PROFILE_TIME_DIVIDER;
+        // Buffers must be much larger than the CPU caches
+        size_t chunksize = 64 * 1024 * 1024;
+        if(sp.mem_quantity.value / 8 < chunksize)
+        {
+          chunksize = static_cast<size_t>(sp.mem_quantity.value / 8) & ~static_cast<size_t>(4095);
+        }
+        auto copy_bandwidth = [&](size_t bytes) {
+          std::vector<byte, utils::page_allocator<byte>> src(bytes, to_byte(1)), dest(bytes, to_byte(2));
+          auto begin = std::chrono::high_resolution_clock::now();
+          unsigned long long count = 0;
+          for(; std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - begin).count() < duration; count++)
+          {
+            memcpy(dest.data(), src.data(), bytes);
+          }
+          return static_cast<double>(count) * bytes / _seconds_since(begin);
+        };
+        sp.mem_memcpy_bandwidth.value = static_cast<unsigned long long>(copy_bandwidth(chunksize));
+        {
+          // Every core copies its own share concurrently
+          const size_t threads = (std::max)(1U, std::thread::hardware_concurrency());
+          const size_t share = (std::max)(static_cast<size_t>(4 * 1024 * 1024), (chunksize / threads) & ~static_cast<size_t>(4095));
+          std::vector<std::future<double>> bandwidths;
+          for(size_t n = 0; n < threads; n++)
+          {
+            bandwidths.push_back(std::async(std::launch::async, copy_bandwidth, share));
+          }
+          double total = 0;
+          for(auto &i : bandwidths)
+          {
+            total += i.get();
+          }
+          sp.mem_memcpy_bandwidth_all_cores.value = static_cast<unsigned long long>(total);
+        }
+        {
+          std::vector<byte, utils::page_allocator<byte>> dest(chunksize);
+          auto begin = std::chrono::high_resolution_clock::now();
+          unsigned long long count = 0;
+          for(; std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - begin).count() < duration; count++)
+          {
+            _nontemporal_fill(dest.data(), chunksize, static_cast<int>(count & 0xff));
+          }
+          sp.mem_nontemporal_bandwidth.value = static_cast<unsigned long long>(static_cast<double>(count) * chunksize / _seconds_since(begin));
+        }
+        {
+          // The barrier of freshly dirtied cache lines, which is what a persistent memory commit costs
+          std::vector<byte, utils::page_allocator<byte>> buffer(1024 * 1024);
+          std::pair<size_t, item<unsigned long long> *> sizes[] = {
+          {64, &sp.mem_nvram_barrier_64b}, {4096, &sp.mem_nvram_barrier_4Kb}, {65536, &sp.mem_nvram_barrier_64Kb}, {1024 * 1024, &sp.mem_nvram_barrier_1Mb}};
+          for(auto &size : sizes)
+          {
+            std::vector<unsigned long long> results;
+            for(size_t n = 0; n < 256; n++)
+            {
+              memset(buffer.data(), static_cast<int>(n & 0xff), size.first);
+              auto begin = std::chrono::high_resolution_clock::now();
+              nvram_barrier({buffer.data(), size.first});
+              auto end = std::chrono::high_resolution_clock::now();
+              results.push_back(static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+            }
+            std::sort(results.begin(), results.end());
+            size.second->value = results[results.size() / 2];
+          }
+        }
+        {
+          // The best of several first touches of a fresh 16Mb map, page by page
+          const size_t bytes = 16 * 1024 * 1024, pagesize = utils::page_size();
+          unsigned long long best = static_cast<unsigned long long>(-1);
+          for(size_t n = 0; n < 4; n++)
+          {
+            OUTCOME_TRY(auto &&mh, map_handle::map(bytes));
+            volatile byte *p = mh.address();
+            auto begin = std::chrono::high_resolution_clock::now();
+            for(size_t i = 0; i < bytes; i += pagesize)
+            {
+              p[i] = to_byte(1);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            best = (std::min)(best, static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / (bytes / pagesize));
+          }
+          sp.mem_page_fault.value = best;
+        }
+        {
+          std::vector<unsigned long long> results;
+          for(size_t n = 0; n < 256; n++)
+          {
+            auto begin = std::chrono::high_resolution_clock::now();
+            OUTCOME_TRY(auto &&mh, map_handle::map(65536));
+            *static_cast<volatile byte *>(mh.address()) = to_byte(1);
+            auto end = std::chrono::high_resolution_clock::now();
+            results.push_back(static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+          }
+          std::sort(results.begin(), results.end());
+          sp.mem_map_first_touch.value = results[results.size() / 2];
+        }
+      }
+      catch(...)
+      {
+        return std::current_exception();
+      }
+      cached = sp;
+      return success();
+    }
+
     // High resolution clock granularity
     struct clock_info_t
     {
@@ -352,8 +952,10 @@ namespace storage_profile
         OUTCOME_TRYV(fsinfo.fill(h, statfs_t::want::iosize | statfs_t::want::mntfromname | statfs_t::want::fstypename));
         sp.device_min_io_size.value = static_cast<unsigned>(fsinfo.f_iosize);
 #ifdef WIN32
+        OUTCOME_TRYV(windows::_device_queue_limits(sp, h));
         OUTCOME_TRYV(windows::_device(sp, h, fsinfo.f_mntfromname, fsinfo.f_fstypename));
 #else
+        OUTCOME_TRYV(posix::_device_queue_limits(sp, h));
         OUTCOME_TRYV(posix::_device(sp, h, fsinfo.f_mntfromname, fsinfo.f_fstypename));
 #endif
       }
@@ -381,6 +983,96 @@ namespace storage_profile
       }
       return success();
     }
+    /* Device bytes written and flushes issued per caching mode for a standard write mix of 8Mb
+    appended in 64Kb writes followed by 1024 random 4Kb rewrites, counted from just before the
+    file is created until the filing system has been flushed after it was closed, so the cost
+    of writing back what the kernel cached and of the filing system's metadata is included.
+    The device counters include any other activity on the device during the test.
+    */
+    outcome<void> write_amplification(storage_profile &sp, file_handle &srch) noexcept
+    {
+      if(sp.write_amplification_all.value != default_value<float>())
+      {
+        return success();
+      }
+      static constexpr size_t file_size = 8 * 1024 * 1024, chunk_size = 65536, rewrite_size = 4096, rewrites = 1024;
+      try
+      {
+        // The result is the same for every permutation of flags sharing the device
+        static std::mutex lock;
+        static std::map<std::string, storage_profile> cache;
+        statfs_t fsinfo;
+        OUTCOME_TRYV(fsinfo.fill(srch, statfs_t::want::mntfromname));
+        std::lock_guard<std::mutex> g(lock);
+        auto &cached = cache[fsinfo.f_mntfromname];
+        const struct
+        {
+          handle::caching caching;
+          item<float> storage_profile::*bytes;
+          item<unsigned long long> storage_profile::*flushes;
+        } modes[] = {{handle::caching::all, &storage_profile::write_amplification_all, &storage_profile::write_flushes_all},
+                     {handle::caching::only_metadata, &storage_profile::write_amplification_only_metadata, &storage_profile::write_flushes_only_metadata},
+                     {handle::caching::reads, &storage_profile::write_amplification_reads, &storage_profile::write_flushes_reads},
+                     {handle::caching::reads_and_metadata, &storage_profile::write_amplification_reads_and_metadata, &storage_profile::write_flushes_reads_and_metadata},
+                     {handle::caching::none, &storage_profile::write_amplification_none, &storage_profile::write_flushes_none},
+                     {handle::caching::safety_barriers, &storage_profile::write_amplification_safety_barriers, &storage_profile::write_flushes_safety_barriers},
+                     {handle::caching::temporary, &storage_profile::write_amplification_temporary, &storage_profile::write_flushes_temporary}};
+        if(cached.write_amplification_all.value == default_value<float>())
+        {
+          OUTCOME_TRY(auto &&base, srch.parent_path_handle());
+          auto *buffer = utils::page_allocator<byte>().allocate(chunk_size);
+          auto unbuffer = LLFIO_V2_NAMESPACE::make_scope_exit([buffer]() noexcept { utils::page_allocator<byte>().deallocate(buffer, chunk_size); });
+          memset(buffer, 78, chunk_size);
+          for(auto &mode : modes)
+          {
+            (void) utils::flush_modified_data(srch);
+#ifdef _WIN32
+            OUTCOME_TRY(auto &&before, storage::windows::_device_write_counters(srch));
+#else
+            OUTCOME_TRY(auto &&before, storage::posix::_device_write_counters(srch));
+#endif
+            {
+              OUTCOME_TRY(auto &&fh, file_handle::file(base, "write_amplification", file_handle::mode::write, file_handle::creation::if_needed, mode.caching));
+              OUTCOME_TRYV(fh.truncate(0));
+              for(size_t offset = 0; offset < file_size; offset += chunk_size)
+              {
+                OUTCOME_TRYV(fh.write(offset, {{buffer, chunk_size}}));
+              }
+              QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand(78);
+              for(size_t n = 0; n < rewrites; n++)
+              {
+                OUTCOME_TRYV(fh.write((rand() % (file_size / rewrite_size)) * rewrite_size, {{buffer, rewrite_size}}));
+              }
+              OUTCOME_TRYV(fh.close());
+            }
+            OUTCOME_TRYV(utils::flush_modified_data(srch));
+#ifdef _WIN32
+            OUTCOME_TRY(auto &&after, storage::windows::_device_write_counters(srch));
+#else
+            OUTCOME_TRY(auto &&after, storage::posix::_device_write_counters(srch));
+#endif
+            (cached.*mode.bytes).value = static_cast<float>(after.first - before.first) / static_cast<float>(file_size + rewrites * rewrite_size);
+            if(before.second != static_cast<unsigned long long>(-1) && after.second != static_cast<unsigned long long>(-1))
+            {
+              (cached.*mode.flushes).value = after.second - before.second;
+            }
+            // Unlinking before the flush would let the kernel discard what it had not yet written back
+            OUTCOME_TRY(auto &&fh, file_handle::file(base, "write_amplification", file_handle::mode::write));
+            OUTCOME_TRYV(fh.unlink());
+          }
+        }
+        for(auto &mode : modes)
+        {
+          (sp.*mode.bytes).value = (cached.*mode.bytes).value;
+          (sp.*mode.flushes).value = (cached.*mode.flushes).value;
+        }
+      }
+      catch(...)
+      {
+        return std::current_exception();
+      }
+      return success();
+    }
   }  // namespace storage
 
 #ifdef _MSC_VER
@@ -844,15 +1536,85 @@ namespace storage_profile
       }
       return success();
     }
+    // Unlike the tests above, these are the limits advertised by the kernel and device, which take no time to query
+    outcome<void> atomic_write_limits(storage_profile &sp, file_handle &srch) noexcept
+    {
+      OUTCOME_TRY(auto &&limits, srch.atomic_write_limits());
+      sp.kernel_atomic_write_unit_min.value = limits.unit_min;
+      sp.kernel_atomic_write_unit_max.value = limits.unit_max;
+      sp.kernel_atomic_write_segments_max.value = static_cast<unsigned>(limits.segments_max);
+#ifdef _WIN32
+      sp.device_atomic_write_unit_max.value = storage::windows::_device_atomic_write_unit_max(srch);
+#else
+      sp.device_atomic_write_unit_max.value = storage::posix::_device_atomic_write_unit_max(srch);
+#endif
+      return success();
+    }
   }  // namespace concurrency
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
   namespace latency
   {
+    // Evicts only the files under test from the page cache, unless the platform cannot
+    inline void _evict_cache(span<file_handle *const> fhs) noexcept
+    {
+      for(auto *fh : fhs)
+      {
+        if(!fh->evict_cache())
+        {
+          (void) utils::drop_filesystem_cache();
+          return;
+        }
+      }
+    }
+    inline void _evict_cache(file_handle &fh) noexcept
+    {
+      file_handle *fhp = &fh;
+      _evict_cache({&fhp, 1});
+    }
+    /* Sorted latencies as a log bucketed histogram, with four linear sub-buckets per power of
+    two so relative bucket width never exceeds 25%. Emitted as space separated pairs of bucket
+    lower bound:count, omitting empty buckets.
+    */
+    inline std::string _histogram(const std::vector<unsigned long long> &sorted)
+    {
+      auto bucket = [](unsigned long long v) {
+        if(v < 4)
+        {
+          return v;
+        }
+        unsigned log2 = 0;
+        while(log2 < 63 && (v >> (log2 + 1)) != 0)
+        {
+          ++log2;
+        }
+        const unsigned long long base = 1ULL << log2, step = base / 4;
+        return base + (v - base) / step * step;
+      };
+      std::string ret;
+      for(size_t n = 0; n < sorted.size();)
+      {
+        const auto lower = bucket(sorted[n]);
+        size_t count = 0;
+        for(; n < sorted.size() && bucket(sorted[n]) == lower; n++)
+        {
+          ++count;
+        }
+        if(!ret.empty())
+        {
+          ret.push_back(' ');
+        }
+        ret.append(std::to_string(lower));
+        ret.push_back(':');
+        ret.append(std::to_string(count));
+      }
+      return ret;
+    }
     struct stats
     {
-      unsigned long long min{0}, mean{0}, max{0}, _50{0}, _95{0}, _99{0}, _99999{0};
+      unsigned long long min{0}, mean{0}, max{0}, _50{0}, _95{0}, _99{0}, _999{0}, _99999{0};
+      std::string histogram;
     };
     inline outcome<stats> _latency_test(file_handle &srch, size_t noreaders, size_t nowriters, bool ownfiles)
     {
@@ -880,7 +1642,7 @@ namespace storage_profile
             workfiles[n] = &_workfiles.back();
           }
         }
-        (void) utils::drop_filesystem_cache();
+        _evict_cache(workfiles);
 
         std::vector<std::vector<unsigned long long>> results(noreaders + nowriters);
         // The excessive unique_ptr works around a bug in libc++'s thread implementation
@@ -1038,12 +1800,15 @@ namespace storage_profile
         s.mean = static_cast<unsigned long long>(static_cast<double>(sum) / totalresults.size());
         // Latency distributions are definitely not normally distributed, but here we have the
         // advantage of tons of sample points. So simply sort into order, and pluck out the values
-        // at 99.999%, 99% and 95%. It'll be accurate enough.
+        // at 99.999%, 99.9%, 99% and 95%. It'll be accurate enough. The histogram shows the shape
+        // of the tail, which is what distinguishes devices with similar means.
         std::sort(totalresults.begin(), totalresults.end());
         s._50 = totalresults[static_cast<size_t>(0.5 * totalresults.size())];
         s._95 = totalresults[static_cast<size_t>(0.95 * totalresults.size())];
         s._99 = totalresults[static_cast<size_t>(0.99 * totalresults.size())];
+        s._999 = totalresults[static_cast<size_t>(0.999 * totalresults.size())];
         s._99999 = totalresults[static_cast<size_t>(0.99999 * totalresults.size())];
+        s.histogram = _histogram(totalresults);
         return s;
       }
       catch(...)
@@ -1064,7 +1829,9 @@ namespace storage_profile
       sp.read_qd1_50.value = s._50;
       sp.read_qd1_95.value = s._95;
       sp.read_qd1_99.value = s._99;
+      sp.read_qd1_999.value = s._999;
       sp.read_qd1_99999.value = s._99999;
+      sp.read_qd1_histogram.value = std::move(s.histogram);
       return success();
     }
     outcome<void> write_qd1(storage_profile &sp, file_handle &srch) noexcept
@@ -1080,7 +1847,9 @@ namespace storage_profile
       sp.write_qd1_50.value = s._50;
       sp.write_qd1_95.value = s._95;
       sp.write_qd1_99.value = s._99;
+      sp.write_qd1_999.value = s._999;
       sp.write_qd1_99999.value = s._99999;
+      sp.write_qd1_histogram.value = std::move(s.histogram);
       return success();
     }
     outcome<void> read_qd16(storage_profile &sp, file_handle &srch) noexcept
@@ -1096,7 +1865,9 @@ namespace storage_profile
       sp.read_qd16_50.value = s._50;
       sp.read_qd16_95.value = s._95;
       sp.read_qd16_99.value = s._99;
+      sp.read_qd16_999.value = s._999;
       sp.read_qd16_99999.value = s._99999;
+      sp.read_qd16_histogram.value = std::move(s.histogram);
       return success();
     }
     outcome<void> write_qd16(storage_profile &sp, file_handle &srch) noexcept
@@ -1112,7 +1883,9 @@ namespace storage_profile
       sp.write_qd16_50.value = s._50;
       sp.write_qd16_95.value = s._95;
       sp.write_qd16_99.value = s._99;
+      sp.write_qd16_999.value = s._999;
       sp.write_qd16_99999.value = s._99999;
+      sp.write_qd16_histogram.value = std::move(s.histogram);
       return success();
     }
     outcome<void> readwrite_qd4(storage_profile &sp, file_handle &srch) noexcept
@@ -1128,9 +1901,420 @@ namespace storage_profile
       sp.readwrite_qd4_50.value = s._50;
       sp.readwrite_qd4_95.value = s._95;
       sp.readwrite_qd4_99.value = s._99;
+      sp.readwrite_qd4_999.value = s._999;
       sp.readwrite_qd4_99999.value = s._99999;
+      sp.readwrite_qd4_histogram.value = std::move(s.histogram);
       return success();
     }
+    struct async_stats
+    {
+      unsigned long long iops{0}, mean{0}, _50{0}, _95{0}, _99{0}, _999{0}, _99999{0};
+      std::string histogram;
+    };
+    // The queue depths probed by read_async() and write_async()
+    static constexpr size_t _async_queue_depths[5] = {1, 4, 16, 64, 256};
+    inline result<io_multiplexer_ptr> _async_multiplexer() noexcept
+    {
+#if defined(__linux__)
+      return multiplexer_linux_io_uring(1);
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+      return multiplexer_bsd_kqueue(1);
+#elif defined(_WIN32)
+      return multiplexer_win_iocp(1, false);
+#else
+      return errc::not_supported;
+#endif
+    }
+    /* Unlike _latency_test(), which emulates queue depth with threads each doing
+    blocking i/o, this keeps queue_depth random 4Kb i/o in flight from a single
+    thread using an i/o multiplexer, so it measures the device rather than the
+    scheduler. Latency is from initiation to completion.
+    */
+    inline outcome<async_stats> _async_latency_test(file_handle &srch, size_t queue_depth, bool writes)
+    {
+      static const unsigned clock_granularity = system::_clock_granularity_and_overhead().granularity;
+      try
+      {
+        OUTCOME_TRY(auto &&multiplexer, _async_multiplexer());
+        OUTCOME_TRY(auto &&path, srch.current_path());
+        OUTCOME_TRY(auto &&fh, file_handle::file({}, path, file_handle::mode::write, file_handle::creation::open_existing, srch.kernel_caching(), srch.flags() | file_handle::flag::multiplexable));
+        OUTCOME_TRY(fh.set_multiplexer(multiplexer.get()));
+        OUTCOME_TRY(auto &&maxsize, fh.maximum_extent());
+        if(maxsize < 4096)
+        {
+          return errc::invalid_argument;
+        }
+        struct slot_type final : public io_multiplexer::io_operation_state_visitor
+        {
+          io_multiplexer *multiplexer{nullptr};
+          span<byte> io_state_storage;
+          io_multiplexer::io_operation_state *io_state{nullptr};
+          io_multiplexer::registered_buffer_type registered_buffer;
+          io_multiplexer::buffer_type rbuffer;
+          io_multiplexer::const_buffer_type wbuffer;
+          std::chrono::high_resolution_clock::time_point initiated, completed;
+          bool failed{false}, finished{false};
+
+          slot_type() = default;
+          slot_type(const slot_type &) = delete;
+          slot_type &operator=(const slot_type &) = delete;
+          ~slot_type()
+          {
+            if(io_state != nullptr)
+            {
+              io_state->~io_operation_state();
+            }
+            if(!io_state_storage.empty())
+            {
+              multiplexer->deallocate_io_operation_state_storage(io_state_storage);
+            }
+          }
+          void begin_io(file_handle &fh, file_handle::extent_type offset, bool writes)
+          {
+            if(io_state != nullptr)
+            {
+              io_state->~io_operation_state();
+              io_state = nullptr;
+            }
+            finished = false;
+            initiated = std::chrono::high_resolution_clock::now();
+            if(writes)
+            {
+              wbuffer = {registered_buffer->data(), 4096};
+              io_state = multiplexer->construct_and_init_io_operation(io_state_storage, &fh, this, io_multiplexer::registered_buffer_type(registered_buffer), {},
+                                                                      io_multiplexer::io_request<io_multiplexer::const_buffers_type>({&wbuffer, 1}, offset));
+            }
+            else
+            {
+              rbuffer = {registered_buffer->data(), 4096};
+              io_state = multiplexer->construct_and_init_io_operation(io_state_storage, &fh, this, io_multiplexer::registered_buffer_type(registered_buffer), {},
+                                                                      io_multiplexer::io_request<io_multiplexer::buffers_type>({&rbuffer, 1}, offset));
+            }
+          }
+          virtual bool read_completed(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/, io_multiplexer::io_result<io_multiplexer::buffers_type> &&res) override
+          {
+            completed = std::chrono::high_resolution_clock::now();
+            failed = failed || !res;
+            return true;
+          }
+          virtual bool write_completed(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/, io_multiplexer::io_result<io_multiplexer::const_buffers_type> &&res) override
+          {
+            completed = std::chrono::high_resolution_clock::now();
+            failed = failed || !res;
+            return true;
+          }
+          // May be called during initiation if the i/o completes immediately, so
+          // the state is destroyed by the next begin_io() rather than here
+          virtual void read_finished(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/) override { finished = true; }
+          virtual void write_or_barrier_finished(io_multiplexer::io_operation_state::lock_guard & /*g*/, io_operation_state_type /*former*/) override { finished = true; }
+        };
+        std::vector<slot_type> slots(queue_depth);
+        for(auto &slot : slots)
+        {
+          slot.multiplexer = multiplexer.get();
+          OUTCOME_TRY(slot.io_state_storage, multiplexer->allocate_io_operation_state_storage());
+          size_t bytes = 4096;
+          OUTCOME_TRY(slot.registered_buffer, fh.allocate_registered_buffer(bytes));
+          memset(slot.registered_buffer->data(), 78, 4096);
+        }
+        QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand(static_cast<uint32_t>(queue_depth));
+        auto random_offset = [&] { return (rand() % maxsize) & ~4095ULL; };
+        std::vector<unsigned long long> results;
+        results.reserve(1024 * 1024);
+        auto record = [&](const slot_type &slot) {
+          auto ns = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(slot.completed - slot.initiated).count());
+          if(ns == 0)
+          {
+            ns = clock_granularity / 2;
+          }
+          results.push_back(ns);
+        };
+        _evict_cache(srch);
+        auto begin = std::chrono::high_resolution_clock::now();
+        for(auto &slot : slots)
+        {
+          slot.begin_io(fh, random_offset(), writes);
+        }
+        OUTCOME_TRY(multiplexer->flush_inited_io_operations());
+        while(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - begin).count() < (20 / LLFIO_STORAGE_PROFILE_TIME_DIVIDER))
+        {
+          OUTCOME_TRY(multiplexer->check_for_any_completed_io(std::chrono::seconds(1)));
+          bool initiated = false;
+          for(auto &slot : slots)
+          {
+            if(slot.finished)
+            {
+              record(slot);
+              slot.begin_io(fh, random_offset(), writes);
+              initiated = true;
+            }
+          }
+          if(initiated)
+          {
+            OUTCOME_TRY(multiplexer->flush_inited_io_operations());
+          }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        // Drain the i/o still in flight, which is not counted
+        for(auto &slot : slots)
+        {
+          while(!slot.finished)
+          {
+            OUTCOME_TRY(multiplexer->check_for_any_completed_io(std::chrono::seconds(1)));
+          }
+          if(slot.failed)
+          {
+            return errc::io_error;
+          }
+        }
+        slots.clear();
+        OUTCOME_TRY(fh.set_multiplexer(nullptr));
+        if(results.empty())
+        {
+          return errc::timed_out;
+        }
+
+        async_stats s;
+        s.iops = static_cast<unsigned long long>(static_cast<double>(results.size()) * 1000000000.0 / static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+        unsigned long long sum = 0;
+        for(const auto &i : results)
+        {
+          sum += i;
+        }
+        s.mean = static_cast<unsigned long long>(static_cast<double>(sum) / results.size());
+        std::sort(results.begin(), results.end());
+        s._50 = results[static_cast<size_t>(0.5 * results.size())];
+        s._95 = results[static_cast<size_t>(0.95 * results.size())];
+        s._99 = results[static_cast<size_t>(0.99 * results.size())];
+        s._999 = results[static_cast<size_t>(0.999 * results.size())];
+        s._99999 = results[static_cast<size_t>(0.99999 * results.size())];
+        s.histogram = _histogram(results);
+        return s;
+      }
+      catch(...)
+      {
+        return std::current_exception();
+      }
+    }
+    inline outcome<void> _async_latency_tests(file_handle &srch, bool writes, item<unsigned long long> *const (&items)[5][7], item<std::string> *const (&histograms)[5])
+    {
+      for(size_t n = 0; n < 5; n++)
+      {
+        OUTCOME_TRY(auto &&s, _async_latency_test(srch, _async_queue_depths[n], writes));
+        items[n][0]->value = s.iops;
+        items[n][1]->value = s.mean;
+        items[n][2]->value = s._50;
+        items[n][3]->value = s._95;
+        items[n][4]->value = s._99;
+        items[n][5]->value = s._999;
+        items[n][6]->value = s._99999;
+        histograms[n]->value = std::move(s.histogram);
+      }
+      return success();
+    }
+    outcome<void> read_async(storage_profile &sp, file_handle &srch) noexcept
+    {
+      if(sp.read_async_qd1_iops.value != static_cast<unsigned long long>(-1))
+      {
+        return success();
+      }
+      item<unsigned long long> *const items[5][7] = {
+      {&sp.read_async_qd1_iops, &sp.read_async_qd1_mean, &sp.read_async_qd1_50, &sp.read_async_qd1_95, &sp.read_async_qd1_99, &sp.read_async_qd1_999, &sp.read_async_qd1_99999},
+      {&sp.read_async_qd4_iops, &sp.read_async_qd4_mean, &sp.read_async_qd4_50, &sp.read_async_qd4_95, &sp.read_async_qd4_99, &sp.read_async_qd4_999, &sp.read_async_qd4_99999},
+      {&sp.read_async_qd16_iops, &sp.read_async_qd16_mean, &sp.read_async_qd16_50, &sp.read_async_qd16_95, &sp.read_async_qd16_99, &sp.read_async_qd16_999, &sp.read_async_qd16_99999},
+      {&sp.read_async_qd64_iops, &sp.read_async_qd64_mean, &sp.read_async_qd64_50, &sp.read_async_qd64_95, &sp.read_async_qd64_99, &sp.read_async_qd64_999, &sp.read_async_qd64_99999},
+      {&sp.read_async_qd256_iops, &sp.read_async_qd256_mean, &sp.read_async_qd256_50, &sp.read_async_qd256_95, &sp.read_async_qd256_99, &sp.read_async_qd256_999, &sp.read_async_qd256_99999}};
+      item<std::string> *const histograms[5] = {&sp.read_async_qd1_histogram, &sp.read_async_qd4_histogram, &sp.read_async_qd16_histogram, &sp.read_async_qd64_histogram, &sp.read_async_qd256_histogram};
+      return _async_latency_tests(srch, false, items, histograms);
+    }
+    outcome<void> write_async(storage_profile &sp, file_handle &srch) noexcept
+    {
+      if(sp.write_async_qd1_iops.value != static_cast<unsigned long long>(-1))
+      {
+        return success();
+      }
+      item<unsigned long long> *const items[5][7] = {
+      {&sp.write_async_qd1_iops, &sp.write_async_qd1_mean, &sp.write_async_qd1_50, &sp.write_async_qd1_95, &sp.write_async_qd1_99, &sp.write_async_qd1_999, &sp.write_async_qd1_99999},
+      {&sp.write_async_qd4_iops, &sp.write_async_qd4_mean, &sp.write_async_qd4_50, &sp.write_async_qd4_95, &sp.write_async_qd4_99, &sp.write_async_qd4_999, &sp.write_async_qd4_99999},
+      {&sp.write_async_qd16_iops, &sp.write_async_qd16_mean, &sp.write_async_qd16_50, &sp.write_async_qd16_95, &sp.write_async_qd16_99, &sp.write_async_qd16_999, &sp.write_async_qd16_99999},
+      {&sp.write_async_qd64_iops, &sp.write_async_qd64_mean, &sp.write_async_qd64_50, &sp.write_async_qd64_95, &sp.write_async_qd64_99, &sp.write_async_qd64_999, &sp.write_async_qd64_99999},
+      {&sp.write_async_qd256_iops, &sp.write_async_qd256_mean, &sp.write_async_qd256_50, &sp.write_async_qd256_95, &sp.write_async_qd256_99, &sp.write_async_qd256_999, &sp.write_async_qd256_99999}};
+      item<std::string> *const histograms[5] = {&sp.write_async_qd1_histogram, &sp.write_async_qd4_histogram, &sp.write_async_qd16_histogram, &sp.write_async_qd64_histogram, &sp.write_async_qd256_histogram};
+      return _async_latency_tests(srch, true, items, histograms);
+    }
+    outcome<void> read_mmap_qd1(storage_profile &sp, file_handle &srch) noexcept
+    {
+      if(sp.read_mmap_qd1_mean.value != static_cast<unsigned long long>(-1))
+      {
+        return success();
+      }
+      static const unsigned clock_granularity = system::_clock_granularity_and_overhead().granularity;
+      try
+      {
+        OUTCOME_TRY(auto &&maxsize, srch.maximum_extent());
+        if(maxsize < 4096)
+        {
+          return errc::invalid_argument;
+        }
+        // Windows cannot purge the cache of a file with a mapped section, so evict before mapping
+        _evict_cache(srch);
+        OUTCOME_TRY(auto &&sh, section_handle::section(srch, 0, section_handle::flag::read));
+        OUTCOME_TRY(auto &&mh, map_handle::map(sh, 0, 0, section_handle::flag::read));
+        alignas(4096) byte buffer[4096];
+        volatile unsigned sink = 0;
+        QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand;
+        std::vector<unsigned long long> results;
+        results.reserve(1024 * 1024);
+        auto begin = std::chrono::high_resolution_clock::now();
+        while(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - begin).count() < (20 / LLFIO_STORAGE_PROFILE_TIME_DIVIDER))
+        {
+          const auto offset = static_cast<size_t>((rand() % (maxsize - 4095)) & ~4095ULL);
+          auto b = std::chrono::high_resolution_clock::now();
+          memcpy(buffer, mh.address() + offset, 4096);
+          auto e = std::chrono::high_resolution_clock::now();
+          sink = sink + static_cast<unsigned>(buffer[0]);
+          auto ns = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(e - b).count());
+          if(ns == 0)
+          {
+            ns = clock_granularity / 2;
+          }
+          results.push_back(ns);
+        }
+        unsigned long long sum = 0;
+        for(const auto &i : results)
+        {
+          sum += i;
+        }
+        sp.read_mmap_qd1_mean.value = static_cast<unsigned long long>(static_cast<double>(sum) / results.size());
+        std::sort(results.begin(), results.end());
+        sp.read_mmap_qd1_50.value = results[static_cast<size_t>(0.5 * results.size())];
+        sp.read_mmap_qd1_95.value = results[static_cast<size_t>(0.95 * results.size())];
+        sp.read_mmap_qd1_99.value = results[static_cast<size_t>(0.99 * results.size())];
+        sp.read_mmap_qd1_999.value = results[static_cast<size_t>(0.999 * results.size())];
+        sp.read_mmap_qd1_99999.value = results[static_cast<size_t>(0.99999 * results.size())];
+        sp.read_mmap_qd1_histogram.value = _histogram(results);
+        return success();
+      }
+      catch(...)
+      {
+        return std::current_exception();
+      }
+    }
+    /* Returns the median nanoseconds per request to read `size` bytes at each of `offsets`,
+    either with read(), or by mapping the region requested, copying out of the map and unmapping
+    it again. If cold, the file is evicted from the cache beforehand, else the offsets are read
+    once before being timed.
+    */
+    inline outcome<unsigned long long> _mmap_crossover_run(file_handle &srch, section_handle &sh, const std::vector<io_handle::extent_type> &offsets, size_t size, bool mapped, bool cold, byte *buffer)
+    {
+      static const unsigned clock_granularity = system::_clock_granularity_and_overhead().granularity;
+      const auto granularity = static_cast<io_handle::extent_type>(utils::allocation_granularity());
+      auto once = [&](io_handle::extent_type offset) -> result<void> {
+        if(mapped)
+        {
+          // Maps must begin on an allocation granularity boundary
+          const auto delta = static_cast<size_t>(offset % granularity);
+          OUTCOME_TRY(auto &&mh, map_handle::map(sh, size + delta, offset - delta, section_handle::flag::read));
+          memcpy(buffer, mh.address() + delta, size);
+          return success();
+        }
+        OUTCOME_TRY(srch.read(offset, {{buffer, size}}));
+        return success();
+      };
+      if(cold)
+      {
+        _evict_cache(srch);
+      }
+      else
+      {
+        for(auto offset : offsets)
+        {
+          OUTCOME_TRY(once(offset));
+        }
+      }
+      std::vector<unsigned long long> results;
+      results.reserve(offsets.size());
+      for(auto offset : offsets)
+      {
+        auto b = std::chrono::high_resolution_clock::now();
+        OUTCOME_TRY(once(offset));
+        auto e = std::chrono::high_resolution_clock::now();
+        auto ns = static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(e - b).count());
+        results.push_back((ns == 0) ? clock_granularity / 2 : ns);
+      }
+      std::sort(results.begin(), results.end());
+      return results[results.size() / 2];
+    }
+    outcome<void> mmap_crossover(storage_profile &sp, file_handle &srch) noexcept
+    {
+      if(sp.mmap_crossover_random_warm.value != static_cast<io_handle::extent_type>(-1))
+      {
+        return success();
+      }
+      try
+      {
+        static constexpr size_t sizes[] = {4096, 16384, 65536, 262144, 1048576, 4194304};
+        static constexpr size_t nsizes = sizeof(sizes) / sizeof(sizes[0]);
+        OUTCOME_TRY(auto &&maxsize, srch.maximum_extent());
+        if(maxsize < 64 * sizes[nsizes - 1])
+        {
+          return errc::invalid_argument;
+        }
+        OUTCOME_TRY(auto &&sh, section_handle::section(srch, 0, section_handle::flag::read));
+        std::vector<byte, utils::page_allocator<byte>> buffer(sizes[nsizes - 1]);
+        QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand;
+        item<io_handle::extent_type> *const items[2][2] = {{&sp.mmap_crossover_random_warm, &sp.mmap_crossover_random_cold},
+                                                           {&sp.mmap_crossover_sequential_warm, &sp.mmap_crossover_sequential_cold}};
+        for(int sequential = 0; sequential < 2; sequential++)
+        {
+          for(int cold = 0; cold < 2; cold++)
+          {
+            bool mapped_faster[nsizes];
+            for(size_t n = 0; n < nsizes; n++)
+            {
+              // Every request is of a distinct region, so cold requests are never satisfied from the cache
+              const size_t size = sizes[n], slots = static_cast<size_t>(maxsize / size), count = std::min<size_t>(64, slots);
+              std::vector<io_handle::extent_type> offsets;
+              offsets.reserve(count);
+              if(sequential != 0)
+              {
+                const size_t first = rand() % (slots - count + 1);
+                for(size_t i = 0; i < count; i++)
+                {
+                  offsets.push_back(static_cast<io_handle::extent_type>(first + i) * size);
+                }
+              }
+              else
+              {
+                while(offsets.size() < count)
+                {
+                  const auto offset = static_cast<io_handle::extent_type>(rand() % slots) * size;
+                  if(std::find(offsets.begin(), offsets.end(), offset) == offsets.end())
+                  {
+                    offsets.push_back(offset);
+                  }
+                }
+              }
+              OUTCOME_TRY(auto &&readns, _mmap_crossover_run(srch, sh, offsets, size, false, cold != 0, buffer.data()));
+              OUTCOME_TRY(auto &&mappedns, _mmap_crossover_run(srch, sh, offsets, size, true, cold != 0, buffer.data()));
+              mapped_faster[n] = (mappedns <= readns);
+            }
+            // The crossover is the smallest size from which mapping is never slower
+            io_handle::extent_type crossover = 0;
+            for(size_t n = nsizes; n > 0 && mapped_faster[n - 1]; n--)
+            {
+              crossover = sizes[n - 1];
+            }
+            items[sequential][cold]->value = crossover;
+          }
+        }
+        return success();
+      }
+      catch(...)
+      {
+        return std::current_exception();
+      }
+    }
     outcome<void> read_nothing(storage_profile &sp, file_handle &srch) noexcept
     {
       if(sp.read_nothing.value != static_cast<unsigned>(-1))
@@ -1218,7 +2402,7 @@ namespace storage_profile
         }
         if(srch.kernel_caching() == file_handle::caching::reads || srch.kernel_caching() == file_handle::caching::none)
         {
-          (void) utils::flush_modified_data();
+          (void) utils::flush_modified_data(dirh);
         }
         end = std::chrono::high_resolution_clock::now();
         s.create = static_cast<unsigned long long>(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / no);
@@ -1250,7 +2434,7 @@ namespace storage_profile
           // For atime updating
           if(srch.kernel_caching() == file_handle::caching::reads || srch.kernel_caching() == file_handle::caching::none)
           {
-            (void) utils::flush_modified_data();
+            (void) utils::flush_modified_data(dirh);
           }
           end = std::chrono::high_resolution_clock::now();
           s.open_read = static_cast<unsigned long long>(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / no);
@@ -1268,7 +2452,7 @@ namespace storage_profile
           // For atime updating
           if(srch.kernel_caching() == file_handle::caching::reads || srch.kernel_caching() == file_handle::caching::none)
           {
-            (void) utils::flush_modified_data();
+            (void) utils::flush_modified_data(dirh);
           }
           end = std::chrono::high_resolution_clock::now();
           s.open_write = static_cast<unsigned long long>(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / no);
@@ -1287,7 +2471,7 @@ namespace storage_profile
         }
         if(srch.kernel_caching() == file_handle::caching::reads || srch.kernel_caching() == file_handle::caching::none)
         {
-          (void) utils::flush_modified_data();
+          (void) utils::flush_modified_data(dirh);
         }
         end = std::chrono::high_resolution_clock::now();
         s.destroy = static_cast<unsigned long long>(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()) / no);
@@ -1345,6 +2529,88 @@ namespace storage_profile
       sp.delete_file_cold_racefree_0b.value = s.destroy;
       return success();
     }
+    /* Returns the operations per second of creating, statting, renaming and unlinking `no` empty
+    files, distributed across `threads` threads all working within one directory. Every operation
+    other than create opens the file by name first, as LLFIO performs metadata operations upon
+    handles.
+    */
+    inline outcome<std::array<unsigned long long, 4>> _metadata_concurrency_N(file_handle &srch, size_t no, size_t threads)
+    {
+      std::array<unsigned long long, 4> ret{};
+      try
+      {
+        directory_handle dirh(directory_handle::directory(srch.parent_path_handle().value(), "testdir", directory_handle::mode::write, directory_handle::creation::if_needed).value());
+        const auto flags = srch.flags() | handle::flag::disable_safety_unlinks | handle::flag::win_disable_unlink_emulation;
+        const size_t share = no / threads;
+        auto name = [](size_t thread, size_t n, bool renamed) { return std::to_string(thread) + "_" + std::to_string(n) + (renamed ? "r" : ""); };
+        std::function<void(size_t, size_t)> ops[4] = {
+        [&](size_t thread, size_t n) { (void) file_handle::file(dirh, name(thread, n, false), file_handle::mode::write, file_handle::creation::if_needed, srch.kernel_caching(), flags).value(); },
+        [&](size_t thread, size_t n) {
+          file_handle fileh(file_handle::file(dirh, name(thread, n, false), file_handle::mode::attr_read, file_handle::creation::open_existing, srch.kernel_caching(), flags).value());
+          stat_t st(nullptr);
+          st.fill(fileh).value();
+        },
+        [&](size_t thread, size_t n) {
+          file_handle fileh(file_handle::file(dirh, name(thread, n, false), file_handle::mode::write, file_handle::creation::open_existing, srch.kernel_caching(), flags).value());
+          fileh.relink(dirh, name(thread, n, true)).value();
+        },
+        [&](size_t thread, size_t n) {
+          file_handle fileh(file_handle::file(dirh, name(thread, n, true), file_handle::mode::write, file_handle::creation::open_existing, srch.kernel_caching(), flags).value());
+          fileh.unlink().value();
+        }};
+        for(size_t op = 0; op < 4; op++)
+        {
+          auto begin = std::chrono::high_resolution_clock::now();
+          std::vector<std::future<void>> workers;
+          for(size_t thread = 0; thread < threads; thread++)
+          {
+            workers.push_back(std::async(std::launch::async, [&, thread] {
+              for(size_t n = 0; n < share; n++)
+              {
+                ops[op](thread, n);
+              }
+            }));
+          }
+          for(auto &worker : workers)
+          {
+            worker.get();
+          }
+          if(srch.kernel_caching() == file_handle::caching::reads || srch.kernel_caching() == file_handle::caching::none)
+          {
+            (void) utils::flush_modified_data(dirh);
+          }
+          ret[op] = static_cast<unsigned long long>(static_cast<double>(share * threads) / system::_seconds_since(begin));
+        }
+        dirh.unlink().value();
+        return ret;
+      }
+      catch(...)
+      {
+        return std::current_exception();
+      }
+    }
+    outcome<void> metadata_concurrency(storage_profile &sp, file_handle &srch) noexcept
+    {
+      if(sp.metadata_create_qd1.value != static_cast<unsigned long long>(-1))
+      {
+        return success();
+      }
+      const size_t items = srch.are_writes_durable() ? 256 : 4096;
+      item<unsigned long long> *const results[3][4] = {
+      {&sp.metadata_create_qd1, &sp.metadata_stat_qd1, &sp.metadata_rename_qd1, &sp.metadata_unlink_qd1},
+      {&sp.metadata_create_qd4, &sp.metadata_stat_qd4, &sp.metadata_rename_qd4, &sp.metadata_unlink_qd4},
+      {&sp.metadata_create_qd16, &sp.metadata_stat_qd16, &sp.metadata_rename_qd16, &sp.metadata_unlink_qd16}};
+      const size_t levels[3] = {1, 4, 16};
+      for(size_t n = 0; n < 3; n++)
+      {
+        OUTCOME_TRY(auto &&s, _metadata_concurrency_N(srch, items, levels[n]));
+        for(size_t op = 0; op < 4; op++)
+        {
+          results[n][op]->value = s[op];
+        }
+      }
+      return success();
+    }
     /*
     outcome<void> traversal_warm_nonracefree_1M(storage_profile &sp, file_handle &srch) noexcept
     {
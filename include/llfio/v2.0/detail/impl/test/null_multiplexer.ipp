@@ -546,6 +546,9 @@ namespace test
         }
         --max_completions;
       }
+      // Fill in the statistics which span calls. A real implementation would also call
+      // _completion_stats.initiated(), .completed() and .reaped() as i/o moves through it.
+      this->_completion_stats.report(ret);
       return ret;
     }
 
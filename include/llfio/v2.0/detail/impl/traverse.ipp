@@ -24,9 +24,11 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../algorithm/traverse.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <iostream>
-#include <list>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -35,13 +37,20 @@ Distributed under the Boost Software License, Version 1.0.
 #include <sys/resource.h>
 #include <sys/stat.h>
 #endif
+#ifdef _WIN32
+#include "windows/import.hpp"
+#endif
+#ifdef __linux__
+#include "posix/import.hpp"
+#include "posix/io_uring_metadata_ring.ipp"
+#endif
 
 LLFIO_V2_NAMESPACE_BEGIN
 
 namespace algorithm
 {
   LLFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> traverse(const path_handle &_topdirh, traverse_visitor *visitor, size_t threads, void *data,
-                                                       bool force_slow_path) noexcept
+                                                       bool force_slow_path, size_t dirs_in_flight, size_t max_queued_dirs) noexcept
   {
     return visitor->finished(data, [&]() -> result<size_t> {
       try
@@ -73,16 +82,17 @@ namespace algorithm
 #endif
         struct state_t
         {
-          std::mutex lock;
           traverse_visitor *visitor{nullptr};
 #if 0
         struct workitem
         {
           std::shared_ptr<directory_handle> dirh;
+          size_t level{0};
           filesystem::path _leaf;
           workitem() {}
-          workitem(std::shared_ptr<directory_handle> _dirh, path_view leaf)
+          workitem(std::shared_ptr<directory_handle> _dirh, path_view leaf, size_t _level)
               : dirh(std::move(_dirh))
+              , level(_level)
               , _leaf(leaf.path())
           {
           }
@@ -92,6 +102,7 @@ namespace algorithm
           struct workitem
           {
             std::shared_ptr<directory_handle> dirh;
+            size_t level{0};
             bool using_sso{true};
             uint8_t _sso_length{0};
             union {
@@ -99,8 +110,9 @@ namespace algorithm
               filesystem::path _alloc;
             };
             workitem() {}
-            workitem(std::shared_ptr<directory_handle> _dirh, path_view leaf)
+            workitem(std::shared_ptr<directory_handle> _dirh, path_view leaf, size_t _level)
                 : dirh(std::move(_dirh))
+                , level(_level)
             {
               if(!leaf.empty())
               {
@@ -128,18 +140,11 @@ namespace algorithm
                 using_sso = true;
               }
             }
-#ifdef _MSC_VER
-            // MSVC's list::splice() always copies :(
-            workitem(const workitem &o) noexcept
-                : workitem(const_cast<workitem &&>(std::move(o)))
-            {
-            }
-#else
             workitem(const workitem &) = delete;
-#endif
             workitem &operator=(const workitem &) = delete;
             workitem(workitem &&o) noexcept
                 : dirh(std::move(o.dirh))
+                , level(o.level)
                 , using_sso(o.using_sso)
                 , _sso_length(o._sso_length)
             {
@@ -168,56 +173,592 @@ namespace algorithm
             path_view leaf() const noexcept { return using_sso ? path_view(_sso, _sso_length, true) : path_view(_alloc); }
           };
 #endif
-          std::vector<std::list<workitem>> workqueue;
-          size_t workqueue_base{0};
-          size_t dirs_processed{0}, known_dirs_remaining{0}, depth_processed{0}, threads_sleeping{0};
+          // Each worker owns a queue of work, which it consumes from the front so traversal stays
+          // approximately breadth first. Idle workers steal the shallowest half of another's queue.
+          struct workqueue_t
+          {
+            spinlock lock;
+            std::deque<workitem> items;
+            std::atomic<size_t> count{0};  // read without the lock to skip empty queues when stealing
+          };
+          std::unique_ptr<workqueue_t[]> workqueues;
+          size_t threads{0}, dirs_in_flight{1};
+          size_t max_queued_per_worker{0};  // zero is unbounded
+#ifdef __linux__
+          // How to open a directory in the same way as `directory_handle::directory()`
+          native_handle_type dir_nativeh;
+          int dir_open_flags{0};
+#endif
+          std::atomic<size_t> dirs_processed{0}, known_dirs_remaining{0}, depth_processed{0}, known_depth_remaining{1}, threads_sleeping{0};
+          std::atomic<bool> done{false};
+          std::mutex sleeplock;
+          std::condition_variable sleepcond;
+          std::mutex errorlock;
+          optional<result<void>::error_type> run_error;
 
           explicit state_t(traverse_visitor *_visitor)
               : visitor(_visitor)
           {
           }
+
+          static void update_max(std::atomic<size_t> &v, size_t x) noexcept
+          {
+            size_t old = v.load(std::memory_order_relaxed);
+            while(old < x && !v.compare_exchange_weak(old, x, std::memory_order_relaxed))
+            {
+            }
+          }
+          void wake_sleepers()
+          {
+            if(threads_sleeping.load(std::memory_order_acquire) > 0)
+            {
+              std::lock_guard<std::mutex> g(sleeplock);
+              sleepcond.notify_all();
+            }
+          }
+          void fail(result<void>::error_type &&e)
+          {
+            {
+              std::lock_guard<std::mutex> g(errorlock);
+              if(!run_error)
+              {
+                run_error = std::move(e);
+              }
+            }
+            done.store(true, std::memory_order_release);
+            wake_sleepers();
+          }
         } state(visitor);
         struct worker
         {
           state_t *state{nullptr};
+          size_t idx{0};
           std::vector<directory_handle::buffer_type> entries{4096};
           directory_handle::buffers_type buffers;
+          std::vector<typename state_t::workitem> newwork, batch;
+          fs_handle::extended_attributes xattrs;
+#ifdef __linux__
+          std::unique_ptr<LLFIO_V2_NAMESPACE::detail::io_uring_metadata_ring> ring;
+          bool ring_failed{false};
+          std::vector<result<directory_handle>> opened;
+          std::vector<LLFIO_V2_NAMESPACE::detail::io_uring_metadata_ring::statx_t> statxbufs;
+          std::vector<char> names;
+          std::vector<size_t> nameoffsets;
+#endif
+#ifdef _WIN32
+          // A directory of `batch` opened, and enumerated if the visitor wants, by the Win32 thread pool
+          struct prefetched_t
+          {
+            const typename state_t::workitem *work{nullptr};
+            result<directory_handle> opened{directory_handle()};
+            result<bool> do_enumerate{false};
+            result<void> enumerated{success()};
+            std::vector<directory_handle::buffer_type> entries;
+            std::vector<char> kernelbuffer;
+            directory_handle::buffers_type buffers;
+          };
+          struct prefetch_t
+          {
+            state_t *state{nullptr};
+            void *data{nullptr};
+            std::vector<prefetched_t> items;
+            size_t count{0};
+            std::atomic<size_t> next{0};
 
-          explicit worker(state_t *_state)
+            void fill(prefetched_t &p) noexcept
+            {
+              try
+              {
+                const auto &work = *p.work;
+                const directory_handle *dirh = work.dirh.get();
+                if(!work.leaf().empty())
+                {
+                  p.opened = directory_handle::directory(*work.dirh, work.leaf());
+                  if(!p.opened)
+                  {
+                    return;
+                  }
+                  dirh = &p.opened.value();
+                }
+                if(!dirh->is_valid())
+                {
+                  return;
+                }
+                p.do_enumerate = state->visitor->pre_enumeration(data, *dirh, work.level);
+                if(!p.do_enumerate || !p.do_enumerate.value())
+                {
+                  return;
+                }
+                /* A caller supplied kernel buffer is filled by a single NtQueryDirectoryFile(),
+                rather than iterating the directory for names first to size the buffer. This
+                saves a round trip to the server per directory on network shares.
+                */
+                if(p.entries.empty())
+                {
+                  p.entries.resize(1024);
+                  p.kernelbuffer.resize(65536);
+                }
+                bool use_kernelbuffer = true;
+                for(;;)
+                {
+                  p.buffers = {p.entries, std::move(p.buffers)};
+                  auto r = dirh->read({std::move(p.buffers), {}, directory_handle::filter::none, use_kernelbuffer ? span<char>(p.kernelbuffer) : span<char>()});
+                  if(!r)
+                  {
+                    if(use_kernelbuffer && r.error() == errc::no_buffer_space)
+                    {
+                      use_kernelbuffer = false;
+                      continue;
+                    }
+                    p.enumerated = std::move(r).error();
+                    return;
+                  }
+                  p.buffers = std::move(r).value();
+                  if(p.buffers.done())
+                  {
+                    break;
+                  }
+                  p.entries.resize(p.entries.size() << 1);
+                }
+              }
+              catch(...)
+              {
+                p.enumerated = error_from_exception();
+              }
+            }
+            void run() noexcept
+            {
+              log_level_guard gg(log_level::fatal);
+              for(size_t n = next.fetch_add(1, std::memory_order_relaxed); n < count; n = next.fetch_add(1, std::memory_order_relaxed))
+              {
+                fill(items[n]);
+              }
+            }
+          };
+          std::unique_ptr<prefetch_t> prefetch;
+#endif
+
+          worker(state_t *_state, size_t _idx)
               : state(_state)
+              , idx(_idx)
+          {
+          }
+
+          static filesystem::file_type type_from_mode(uint16_t mode) noexcept
+          {
+#ifdef _WIN32
+            (void) mode;
+            return filesystem::file_type::unknown;
+#else
+            switch(mode & S_IFMT)
+            {
+            case S_IFBLK:
+              return filesystem::file_type::block;
+            case S_IFCHR:
+              return filesystem::file_type::character;
+            case S_IFDIR:
+              return filesystem::file_type::directory;
+            case S_IFIFO:
+              return filesystem::file_type::fifo;
+            case S_IFLNK:
+              return filesystem::file_type::symlink;
+            case S_IFREG:
+              return filesystem::file_type::regular;
+            case S_IFSOCK:
+              return filesystem::file_type::socket;
+            default:
+              return filesystem::file_type::unknown;
+            }
+#endif
+          }
+
+#ifdef __linux__
+          // The io_uring this worker keeps metadata operations in flight with, if available
+          LLFIO_V2_NAMESPACE::detail::io_uring_metadata_ring *uring() noexcept
+          {
+            if(!ring && !ring_failed && state->dirs_in_flight > 1)
+            {
+              ring.reset(new(std::nothrow) LLFIO_V2_NAMESPACE::detail::io_uring_metadata_ring);
+              if(!ring || !ring->init((unsigned) (std::min)(state->dirs_in_flight, (size_t) 256)))
+              {
+                // Kernel too old, or io_uring is forbidden by seccomp etc.
+                ring.reset();
+                ring_failed = true;
+              }
+            }
+            return ring.get();
+          }
+
+          void names_fill(size_t n, path_view leaf)
           {
+            path_view::c_str<> zpath(leaf);
+            nameoffsets[n] = names.size();
+            names.insert(names.end(), zpath.buffer, zpath.buffer + zpath.length);
+            names.push_back(0);
           }
 
-          result<void> run(std::unique_lock<std::mutex> &g, bool use_slow_path, std::shared_ptr<directory_handle> &topdirh, void *data)
+          // Open all the directories in `batch` at once, placing the results into `opened`
+          void open_batch()
           {
-            typename state_t::workitem mywork;
-            size_t mylevel = 0;
-            assert(g.owns_lock());
-            for(size_t n = state->workqueue_base; n < state->workqueue.size(); n++)
+            names.clear();
+            nameoffsets.resize(batch.size());
+            opened.clear();
+            opened.reserve(batch.size());
+            for(size_t n = 0; n < batch.size(); n++)
             {
-              if(!state->workqueue[n].empty())
+              opened.emplace_back(directory_handle());
+              if(!batch[n].leaf().empty())
+              {
+                names_fill(n, batch[n].leaf());
+              }
+            }
+            for(size_t n = 0; n < batch.size(); n++)
+            {
+              if(!batch[n].leaf().empty())
+              {
+                ring->openat(n, batch[n].dirh->native_handle().fd, names.data() + nameoffsets[n], state->dir_open_flags);
+              }
+            }
+            if(ring->queued() == 0)
+            {
+              opened.clear();
+              return;
+            }
+            log_level_guard gg(log_level::fatal);
+            auto r = ring->submit_and_wait([&](uint64_t n, int res) {
+              if(res >= 0)
               {
-                mywork = std::move(state->workqueue[n].front());
-                state->workqueue[n].pop_front();
-                mylevel = n;
-                if(mylevel != state->depth_processed)
+                native_handle_type nativeh = state->dir_nativeh;
+                nativeh.fd = res;
+                opened[n] = directory_handle(nativeh, 0, 0, directory_handle::caching::all, directory_handle::flag::none);
+              }
+              else if(-res == EINVAL)
+              {
+                // Kernels before 5.6 do not implement OPENAT
+                opened[n] = directory_handle::directory(*batch[n].dirh, batch[n].leaf());
+              }
+              else
+              {
+                opened[n] = posix_error(-res);
+              }
+            });
+            if(!r)
+            {
+              // Open the remainder individually
+              opened.clear();
+            }
+          }
+
+          // Fill the type of every entry in `buffers`, keeping many `statx()` in flight at once
+          result<void> stat_types_batch(const directory_handle &dirh)
+          {
+            const size_t chunk = ring->capacity();
+            statxbufs.resize(chunk);
+            nameoffsets.resize(chunk);
+            for(size_t base = 0; base < buffers.size(); base += chunk)
+            {
+              const size_t count = (std::min)(chunk, buffers.size() - base);
+              names.clear();
+              for(size_t n = 0; n < count; n++)
+              {
+                names_fill(n, buffers[base + n].leafname);
+              }
+              for(size_t n = 0; n < count; n++)
+              {
+                ring->statx(n, dirh.native_handle().fd, names.data() + nameoffsets[n], AT_SYMLINK_NOFOLLOW, 0x0001U /*STATX_TYPE*/, &statxbufs[n]);
+              }
+              int errcode = 0;
+              OUTCOME_TRY(ring->submit_and_wait([&](uint64_t n, int res) {
+                auto &entry = buffers[base + (size_t) n];
+                if(res >= 0)
                 {
-                  state->depth_processed = mylevel;
+                  entry.stat.st_type = type_from_mode(statxbufs[n].stx_mode);
+                  return;
                 }
-                break;
+                if(-res == EINVAL)
+                {
+                  // Kernels before 5.6 do not implement STATX
+                  struct ::stat stat;
+                  memset(&stat, 0, sizeof(stat));
+                  if(::fstatat(dirh.native_handle().fd, names.data() + nameoffsets[n], &stat, AT_SYMLINK_NOFOLLOW) >= 0)
+                  {
+                    entry.stat.st_type = type_from_mode(stat.st_mode);
+                    return;
+                  }
+                  res = -errno;
+                }
+                errcode = -res;
+              }));
+              if(errcode != 0)
+              {
+                return posix_error(errcode);
+              }
+            }
+            return success();
+          }
+#endif
+
+#ifdef _WIN32
+          /* Opens and enumerates all the directories in `batch` using this thread and up to
+          `dirs_in_flight - 1` threads of the Win32 thread pool. Enumeration over a network share
+          is dominated by round trips to the server, so having many directories in flight at once
+          bounds traversal by the depth of the tree rather than by the number of directories.
+          */
+          void prefetch_batch(void *data)
+          {
+            if(!prefetch)
+            {
+              prefetch.reset(new prefetch_t);
+              prefetch->state = state;
+            }
+            prefetch->data = data;
+            if(prefetch->items.size() < batch.size())
+            {
+              prefetch->items.resize(batch.size());
+            }
+            for(size_t n = 0; n < batch.size(); n++)
+            {
+              auto &p = prefetch->items[n];
+              p.work = &batch[n];
+              p.opened = directory_handle();
+              p.do_enumerate = false;
+              p.enumerated = success();
+            }
+            prefetch->count = batch.size();
+            prefetch->next.store(0, std::memory_order_relaxed);
+            PTP_WORK work = CreateThreadpoolWork([](PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) { static_cast<prefetch_t *>(context)->run(); }, prefetch.get(), nullptr);
+            if(work != nullptr)
+            {
+              for(size_t n = (std::min)(state->dirs_in_flight, batch.size()); n > 1; n--)
+              {
+                SubmitThreadpoolWork(work);
+              }
+            }
+            prefetch->run();
+            if(work != nullptr)
+            {
+              WaitForThreadpoolWorkCallbacks(work, false);
+              CloseThreadpoolWork(work);
+            }
+          }
+#endif
+
+          // Takes more work from our own queue into `batch`, up to `max_batch` items
+          void take_batch(size_t max_batch)
+          {
+            auto &mine = state->workqueues[idx];
+            if(mine.count.load(std::memory_order_relaxed) > 0)
+            {
+              lock_guard<spinlock> g(mine.lock);
+              while(batch.size() < max_batch && !mine.items.empty())
+              {
+                typename state_t::workitem mywork;
+                take_own(mine, mywork);
+                batch.push_back(std::move(mywork));
               }
+              mine.count.store(mine.items.size(), std::memory_order_relaxed);
             }
-            if(!mywork.dirh)
+          }
+
+          // Takes an item from our own queue, which must not be empty and must be locked. Breadth
+          // first unless the queue exceeds its bound, when going depth first stops it growing.
+          void take_own(typename state_t::workqueue_t &mine, typename state_t::workitem &out)
+          {
+            if(state->max_queued_per_worker != 0 && mine.items.size() > state->max_queued_per_worker)
             {
-              return success();
+              out = std::move(mine.items.back());
+              mine.items.pop_back();
             }
-            if(mylevel > state->workqueue_base)
+            else
             {
-              state->workqueue_base = mylevel;
+              out = std::move(mine.items.front());
+              mine.items.pop_front();
             }
-            state->dirs_processed++;
-            state->known_dirs_remaining--;
-            g.unlock();
+          }
+
+          bool pop(typename state_t::workitem &out)
+          {
+            auto &mine = state->workqueues[idx];
+            if(mine.count.load(std::memory_order_relaxed) > 0)
+            {
+              lock_guard<spinlock> g(mine.lock);
+              if(!mine.items.empty())
+              {
+                take_own(mine, out);
+                mine.count.store(mine.items.size(), std::memory_order_relaxed);
+                return true;
+              }
+            }
+            for(size_t n = 1; n < state->threads; n++)
+            {
+              auto &victim = state->workqueues[(idx + n) % state->threads];
+              if(victim.count.load(std::memory_order_relaxed) == 0)
+              {
+                continue;
+              }
+              {
+                lock_guard<spinlock> g(victim.lock);
+                if(victim.items.empty())
+                {
+                  continue;
+                }
+                size_t tosteal = victim.items.size() / 2;
+                out = std::move(victim.items.front());
+                victim.items.pop_front();
+                for(; tosteal > 0; tosteal--)
+                {
+                  newwork.push_back(std::move(victim.items.front()));
+                  victim.items.pop_front();
+                }
+                victim.count.store(victim.items.size(), std::memory_order_relaxed);
+              }
+              if(!newwork.empty())
+              {
+                // Only this worker ever adds to its own queue, so it is still empty
+                lock_guard<spinlock> g(mine.lock);
+                for(auto &i : newwork)
+                {
+                  mine.items.push_back(std::move(i));
+                }
+                mine.count.store(mine.items.size(), std::memory_order_relaxed);
+                newwork.clear();
+              }
+              return true;
+            }
+            return false;
+          }
+
+          // Returns false if there was no work to be found
+          bool step(bool use_slow_path, std::shared_ptr<directory_handle> &topdirh, void *data)
+          {
+            result<void> r = success();
+            size_t processed = 0;
+            try
+            {
+              {
+                typename state_t::workitem mywork;
+                if(!pop(mywork))
+                {
+                  return false;
+                }
+                batch.push_back(std::move(mywork));
+              }
+#ifdef __linux__
+              if(uring() != nullptr)
+              {
+                // Take more work from our queue, and open all of it at once
+                take_batch((std::min)(state->dirs_in_flight, (size_t) ring->capacity()));
+                open_batch();
+              }
+#endif
+#ifdef _WIN32
+              if(state->dirs_in_flight > 1)
+              {
+                // Take more work from our queue, and open and enumerate all of it at once
+                take_batch((std::min)(state->dirs_in_flight, (size_t) 256));
+                if(batch.size() > 1)
+                {
+                  prefetch_batch(data);
+                }
+              }
+#endif
+              for(; processed < batch.size(); processed++)
+              {
+                result<directory_handle> *preopened = nullptr;
+                void *prefetched = nullptr;
+#ifdef __linux__
+                if(!opened.empty())
+                {
+                  preopened = &opened[processed];
+                }
+#endif
+#ifdef _WIN32
+                if(prefetch && prefetch->count > 0)
+                {
+                  preopened = &prefetch->items[processed].opened;
+                  prefetched = &prefetch->items[processed];
+                }
+#endif
+                r = process(std::move(batch[processed]), preopened, prefetched, use_slow_path, topdirh, data);
+                if(!r)
+                {
+                  break;
+                }
+              }
+            }
+            catch(...)
+            {
+              r = error_from_exception();
+            }
+#ifdef _WIN32
+            if(prefetch)
+            {
+              // Close any directories not reached, but keep the buffers for the next batch
+              for(size_t n = 0; n < prefetch->count; n++)
+              {
+                prefetch->items[n].work = nullptr;
+                prefetch->items[n].opened = directory_handle();
+              }
+              prefetch->count = 0;
+            }
+#endif
+            batch.clear();
+#ifdef __linux__
+            opened.clear();
+#endif
+            if(!r)
+            {
+              newwork.clear();
+              state->fail(std::move(r).error());
+            }
+            else if(state->known_dirs_remaining.fetch_sub(processed, std::memory_order_acq_rel) == processed)
+            {
+              // That was the last directory anywhere, and no more can appear
+              state->done.store(true, std::memory_order_release);
+              state->wake_sleepers();
+            }
+            return true;
+          }
+
+          void loop(bool use_slow_path, std::shared_ptr<directory_handle> &topdirh, void *data)
+          {
+            unsigned idle = 0;
+            while(!state->done.load(std::memory_order_acquire))
+            {
+              if(step(use_slow_path, topdirh, data))
+              {
+                idle = 0;
+                continue;
+              }
+              if(++idle < 64)
+              {
+                std::this_thread::yield();
+                continue;
+              }
+              // Nothing to steal for a while, so sleep until some worker publishes new work. The
+              // timeout covers the race of work being published just before we went to sleep.
+              std::unique_lock<std::mutex> g(state->sleeplock);
+              state->threads_sleeping.fetch_add(1, std::memory_order_acq_rel);
+              if(!state->done.load(std::memory_order_acquire))
+              {
+                state->sleepcond.wait_for(g, std::chrono::milliseconds(1));
+              }
+              state->threads_sleeping.fetch_sub(1, std::memory_order_acq_rel);
+            }
+          }
+
+          // `prefetched` is the `prefetched_t` of this directory on Windows, else null
+          result<void> process(typename state_t::workitem &&mywork, result<directory_handle> *preopened, void *prefetched, bool use_slow_path,
+                               std::shared_ptr<directory_handle> &topdirh, void *data)
+          {
+#ifdef _WIN32
+            auto *pre = static_cast<prefetched_t *>(prefetched);
+#else
+            void *pre = prefetched;  // always null
+#endif
+            const size_t mylevel = mywork.level;
+            state_t::update_max(state->depth_processed, mylevel);
+            state->dirs_processed.fetch_add(1, std::memory_order_relaxed);
             std::shared_ptr<directory_handle> mydirh;
             if(mywork.leaf().empty())
             {
@@ -226,11 +767,13 @@ namespace algorithm
             else
             {
               log_level_guard gg(log_level::fatal);
-              auto r = directory_handle::directory(*mywork.dirh, mywork.leaf());
+              auto r = (preopened != nullptr) ? std::move(*preopened) : directory_handle::directory(*mywork.dirh, mywork.leaf());
               if(!r)
               {
                 OUTCOME_TRY(auto &&replacementh, state->visitor->directory_open_failed(data, std::move(r).error(), *mywork.dirh, mywork.leaf(), mylevel));
                 mydirh = std::make_shared<directory_handle>(std::move(replacementh));
+                // Nothing was prefetched for the replacement
+                pre = nullptr;
               }
               else
               {
@@ -239,63 +782,67 @@ namespace algorithm
             }
             if(mydirh->is_valid())
             {
+#ifdef _WIN32
+              OUTCOME_TRY(auto &&do_enumerate, (pre != nullptr) ? std::move(pre->do_enumerate) : state->visitor->pre_enumeration(data, *mydirh, mylevel));
+              auto &contents = (pre != nullptr) ? pre->buffers : buffers;
+#else
               OUTCOME_TRY(auto &&do_enumerate, state->visitor->pre_enumeration(data, *mydirh, mylevel));
+              auto &contents = buffers;
+#endif
               if(do_enumerate)
               {
-                for(;;)
+                if(pre != nullptr)
                 {
-                  buffers = {entries, std::move(buffers)};
-                  OUTCOME_TRY(buffers, mydirh->read({std::move(buffers), {}, directory_handle::filter::none}));
-                  if(buffers.done())
+#ifdef _WIN32
+                  OUTCOME_TRYV(std::move(pre->enumerated));
+#endif
+                }
+                else
+                {
+                  for(;;)
                   {
-                    break;
+                    buffers = {entries, std::move(buffers)};
+                    OUTCOME_TRY(buffers, mydirh->read({std::move(buffers), {}, directory_handle::filter::none}));
+                    if(buffers.done())
+                    {
+                      break;
+                    }
+                    entries.resize(entries.size() << 1);
                   }
-                  entries.resize(entries.size() << 1);
                 }
-                if(!(buffers.metadata() & stat_t::want::type))
+                if(!(contents.metadata() & stat_t::want::type))
                 {
 #ifdef _WIN32
                   abort();  // this should never occur on Windows
 #else
-                  for(auto &entry : buffers)
+#ifdef __linux__
+                  if(uring() != nullptr)
                   {
-                    struct ::stat stat;
-                    memset(&stat, 0, sizeof(stat));
-                    path_view::c_str<> zpath(entry.leafname);
-                    if(::fstatat(mydirh->native_handle().fd, zpath.buffer, &stat, AT_SYMLINK_NOFOLLOW) >= 0)
-                    {
-                      entry.stat.st_type = [](uint16_t mode) {
-                        switch(mode & S_IFMT)
-                        {
-                        case S_IFBLK:
-                          return filesystem::file_type::block;
-                        case S_IFCHR:
-                          return filesystem::file_type::character;
-                        case S_IFDIR:
-                          return filesystem::file_type::directory;
-                        case S_IFIFO:
-                          return filesystem::file_type::fifo;
-                        case S_IFLNK:
-                          return filesystem::file_type::symlink;
-                        case S_IFREG:
-                          return filesystem::file_type::regular;
-                        case S_IFSOCK:
-                          return filesystem::file_type::socket;
-                        default:
-                          return filesystem::file_type::unknown;
-                        }
-                      }(stat.st_mode);
-                    }
-                    else
+                    OUTCOME_TRY(stat_types_batch(*mydirh));
+                  }
+                  else
+#endif
+                  {
+                    for(auto &entry : buffers)
                     {
-                      return posix_error();
+                      struct ::stat stat;
+                      memset(&stat, 0, sizeof(stat));
+                      path_view::c_str<> zpath(entry.leafname);
+                      if(::fstatat(mydirh->native_handle().fd, zpath.buffer, &stat, AT_SYMLINK_NOFOLLOW) >= 0)
+                      {
+                        entry.stat.st_type = type_from_mode(stat.st_mode);
+                      }
+                      else
+                      {
+                        return posix_error();
+                      }
                     }
                   }
 #endif
                 }
-                OUTCOME_TRY(state->visitor->post_enumeration(data, *mydirh, buffers, mylevel));
-                std::list<state_t::workitem> newwork;
-                for(auto &entry : buffers)
+                OUTCOME_TRY(state->visitor->post_enumeration(data, *mydirh, contents, mylevel));
+                const bool want_xattrs = state->visitor->want_extended_attributes(data);
+                for(auto &entry : contents)
                 {
                   int entry_type = 0;  // 0 = unknown, 1 = file, 2 = directory
                   switch(entry.stat.st_type)
@@ -314,143 +861,134 @@ namespace algorithm
                   default:
                     break;
                   }
+                  if(0 != entry_type && want_xattrs)
+                  {
+                    auto read = fs_handle::read_extended_attributes(*mydirh, entry.leafname, xattrs);
+                    OUTCOME_TRY(state->visitor->extended_attributes_read(data, *mydirh, entry, std::move(read), xattrs, mylevel));
+                  }
                   if(2 == entry_type)
                   {
                     if(use_slow_path)
                     {
-                      newwork.push_back(state_t::workitem(topdirh, mywork.leaf().path() / entry.leafname.path()));
+                      newwork.push_back(state_t::workitem(topdirh, mywork.leaf().path() / entry.leafname.path(), mylevel + 1));
                     }
                     else
                     {
-                      newwork.push_back(state_t::workitem(mydirh, entry.leafname));
+                      newwork.push_back(state_t::workitem(mydirh, entry.leafname, mylevel + 1));
                     }
                   }
                 }
-                g.lock();
-                state->known_dirs_remaining += newwork.size();
-                if(state->workqueue.size() < mylevel + 2)
+                if(!newwork.empty())
                 {
-                  state->workqueue.emplace_back();
+                  // Count the new work before publishing it, so the total never transiently reaches zero
+                  state->known_dirs_remaining.fetch_add(newwork.size(), std::memory_order_acq_rel);
+                  state_t::update_max(state->known_depth_remaining, mylevel + 2);
+                  auto &mine = state->workqueues[idx];
+                  {
+                    lock_guard<spinlock> g(mine.lock);
+                    for(auto &i : newwork)
+                    {
+                      mine.items.push_back(std::move(i));
+                    }
+                    mine.count.store(mine.items.size(), std::memory_order_relaxed);
+                  }
+                  newwork.clear();
+                  state->wake_sleepers();
                 }
-                state->workqueue[mylevel + 1].splice(state->workqueue[mylevel + 1].end(), std::move(newwork));
-                if(mylevel + 1 < state->workqueue_base)
+                if(state->max_queued_per_worker != 0 && entries.size() > 4096)
                 {
-                  state->workqueue_base = mylevel + 1;
+                  // Don't keep the buffers an unusually large directory needed. Move assignment
+                  // would retain the larger kernel buffer, so destroy and reconstruct.
+                  using buffers_type = directory_handle::buffers_type;
+                  buffers.~buffers_type();
+                  new(&buffers) buffers_type;
+                  entries.resize(4096);
+                  entries.shrink_to_fit();
                 }
-                size_t dirs_processed = state->dirs_processed, known_dirs_remaining = state->known_dirs_remaining, depth_processed = state->depth_processed,
-                       known_depth_remaining = state->workqueue.size();
-                g.unlock();
-                OUTCOME_TRY(state->visitor->stack_updated(data, dirs_processed, known_dirs_remaining, depth_processed, known_depth_remaining));
+                // This directory is not yet subtracted from those remaining
+                OUTCOME_TRY(state->visitor->stack_updated(data, state->dirs_processed.load(std::memory_order_relaxed),
+                                                          state->known_dirs_remaining.load(std::memory_order_relaxed) - 1,
+                                                          state->depth_processed.load(std::memory_order_relaxed),
+                                                          state->known_depth_remaining.load(std::memory_order_relaxed)));
               }
             }
             return success();
           }
         };
-        state.workqueue.emplace_back();
-        state.workqueue.front().push_back(state_t::workitem(topdirh, {}));
-        state.known_dirs_remaining = 1;
-        worker firstworker(&state);
+        if(0 == threads)
         {
-          std::unique_lock<std::mutex> g(state.lock);
-          for(size_t n = 0; state.known_dirs_remaining > 0 && (threads == 1 || n < 4); n++)
+          // Filesystems are generally only concurrent to the real CPU count
+          threads = std::thread::hardware_concurrency() / 2;
+          if(threads < 4)
           {
-            if(!g.owns_lock())
-            {
-              g.lock();
-            }
-            OUTCOME_TRY(firstworker.run(g, use_slow_path, topdirh, data));
+            threads = 4;
           }
         }
-        if(state.known_dirs_remaining > 0)
+        state.threads = threads;
+        state.dirs_in_flight = (dirs_in_flight == 0) ? 1 : dirs_in_flight;
+        if(max_queued_dirs != 0)
         {
-          // Fire up the threadpool
-          if(0 == threads)
-          {
-            // Filesystems are generally only concurrent to the real CPU count
-            threads = std::thread::hardware_concurrency() / 2;
-            if(threads < 4)
-            {
-              threads = 4;
-            }
-          }
+          state.max_queued_per_worker = (std::max)(max_queued_dirs / threads, (size_t) 1);
+        }
+#ifdef __linux__
+        if(state.dirs_in_flight > 1)
+        {
+          state.dir_nativeh.behaviour |= native_handle_type::disposition::directory;
+          OUTCOME_TRY(auto &&attribs, attribs_from_handle_mode_caching_and_flags(state.dir_nativeh, handle::mode::read, handle::creation::open_existing,
+                                                                                 handle::caching::all, handle::flag::none));
+          attribs &= ~O_NONBLOCK;
+          state.dir_nativeh.behaviour &= ~native_handle_type::disposition::nonblocking;
+          state.dir_nativeh.behaviour &= ~native_handle_type::disposition::seekable;
+          state.dir_open_flags = attribs | O_DIRECTORY;
+        }
+#endif
+        state.workqueues.reset(new typename state_t::workqueue_t[threads]);
+        state.workqueues[0].items.push_back(state_t::workitem(topdirh, {}, 0));
+        state.workqueues[0].count = 1;
+        state.known_dirs_remaining = 1;
+        worker firstworker(&state, 0);
+        for(size_t n = 0; !state.done.load(std::memory_order_acquire) && (threads == 1 || n < 4); n++)
+        {
+          firstworker.step(use_slow_path, topdirh, data);
+        }
+        if(!state.done.load(std::memory_order_acquire))
+        {
+          // Fire up the threadpool, with this thread acting as the first worker
           std::vector<worker> workers;
-          workers.reserve(threads);
-          workers.push_back(std::move(firstworker));
+          workers.reserve(threads - 1);
           for(size_t n = 1; n < threads; n++)
           {
-            workers.push_back(worker(&state));
+            workers.push_back(worker(&state, n));
           }
           std::vector<std::thread> workerthreads;
-          workerthreads.reserve(threads);
-          std::condition_variable cond, maincond;
-          bool done = false;
-          optional<result<void>::error_type> run_error;
-          for(size_t n = 0; n < threads; n++)
-          {
-            workerthreads.push_back(std::thread(
-            [&](worker *w) {
-              std::unique_lock<std::mutex> g(state.lock);
-              while(!done)
-              {
-                if(state.known_dirs_remaining == 0)
-                {
-                  // sleep
-                  state.threads_sleeping++;
-                  maincond.notify_all();
-                  cond.wait(g);
-                  if(done)
-                  {
-                    break;
-                  }
-                  state.threads_sleeping--;
-                }
-                else
-                {
-                  // wake everybody
-                  cond.notify_all();
-                }
-                auto r = w->run(g, use_slow_path, topdirh, data);
-                if(!g.owns_lock())
-                {
-                  g.lock();
-                }
-                if(!r)
-                {
-                  done = true;
-                  if(!run_error)
-                  {
-                    run_error = std::move(r).error();
-                  }
-                  break;
-                }
-              }
-              state.threads_sleeping++;
-              maincond.notify_all();
-            },
-            &workers[n]));
-          }
+          workerthreads.reserve(threads - 1);
+          for(auto &i : workers)
           {
-            std::unique_lock<std::mutex> g(state.lock);
-            while(state.threads_sleeping < threads)
+            try
+            {
+              workerthreads.push_back(std::thread([&](worker *w) { w->loop(use_slow_path, topdirh, data); }, &i));
+            }
+            catch(...)
             {
-              maincond.wait(g);
+              // Unable to launch more threads, so make do with those we have. Workers who never
+              // started own no work, as only a worker adds to its own queue.
+              break;
             }
-            done = true;
-            cond.notify_all();
           }
+          firstworker.loop(use_slow_path, topdirh, data);
           for(auto &i : workerthreads)
           {
             i.join();
           }
-          if(run_error)
-          {
-            return std::move(*run_error);
-          }
+        }
+        if(state.run_error)
+        {
+          return std::move(*state.run_error);
         }
 #ifndef NDEBUG
-        for(auto &i : state.workqueue)
+        for(size_t n = 0; n < threads; n++)
         {
-          assert(i.empty());
+          assert(state.workqueues[n].items.empty());
         }
 #endif
         return state.dirs_processed;
@@ -0,0 +1,613 @@
+/* Misc utilities
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace utils
+{
+  namespace detail
+  {
+    struct memory_pressure_registry_t
+    {
+      struct item_t
+      {
+        size_t id;
+        memory_pressure_callback callback;
+        void *data;
+      };
+      std::mutex lock;
+      std::vector<item_t> callbacks;
+      size_t next_id{1};
+    };
+    inline memory_pressure_registry_t &memory_pressure_registry() noexcept
+    {
+      // Deliberately leaked so caches used during static deinitialisation remain safe
+      static memory_pressure_registry_t *v = new memory_pressure_registry_t;
+      return *v;
+    }
+
+    /* Process-wide cache of memory deallocated by page_allocator, bucketed by the power
+    of two of its size. Within a bucket, memory is ordered by when it was deallocated, so
+    the most recently deallocated (and most likely to still be in the TLB and CPU caches)
+    is reused first, and the least recently deallocated is released first.
+    */
+    struct page_allocator_cache_t
+    {
+      struct item_t
+      {
+        void *p;
+        size_t bytes;
+        uint64_t when_added;
+      };
+      std::mutex lock;
+      std::vector<item_t> buckets[sizeof(size_t) * 8];
+      std::atomic<size_t> max_thread_bytes{4 * 1024 * 1024}, max_bytes{64 * 1024 * 1024};
+      size_t bytes{0};
+      uint64_t added{0};
+
+      static size_t bucket(size_t bytes) noexcept
+      {
+        size_t ret = 0;
+        while(bytes > 1)
+        {
+          bytes >>= 1;
+          ++ret;
+        }
+        return ret;
+      }
+
+      void *get(size_t bytes_) noexcept
+      {
+        std::lock_guard<std::mutex> g(lock);
+        auto &b = buckets[bucket(bytes_)];
+        for(size_t n = b.size(); n > 0; n--)
+        {
+          if(b[n - 1].bytes == bytes_)
+          {
+            void *ret = b[n - 1].p;
+            b.erase(b.begin() + (n - 1));
+            bytes -= bytes_;
+            return ret;
+          }
+        }
+        return nullptr;
+      }
+
+      void add(void *p, size_t bytes_) noexcept
+      {
+        std::lock_guard<std::mutex> g(lock);
+        const size_t max = max_bytes.load(std::memory_order_relaxed);
+        if(bytes_ > max)
+        {
+          deallocate_large_pages(p, bytes_);
+          return;
+        }
+        try
+        {
+          buckets[bucket(bytes_)].push_back(item_t{p, bytes_, added++});
+        }
+        catch(...)
+        {
+          deallocate_large_pages(p, bytes_);
+          return;
+        }
+        bytes += bytes_;
+        if(bytes > max)
+        {
+          _trim_locked(max / 2);
+        }
+      }
+
+      // Releases the least recently added until no more than max_remaining bytes are retained
+      size_t _trim_locked(size_t max_remaining) noexcept
+      {
+        size_t trimmed = 0;
+        while(bytes > max_remaining)
+        {
+          std::vector<item_t> *oldest = nullptr;
+          for(auto &b : buckets)
+          {
+            if(!b.empty() && (oldest == nullptr || b.front().when_added < oldest->front().when_added))
+            {
+              oldest = &b;
+            }
+          }
+          if(oldest == nullptr)
+          {
+            break;
+          }
+          deallocate_large_pages(oldest->front().p, oldest->front().bytes);
+          trimmed += oldest->front().bytes;
+          bytes -= oldest->front().bytes;
+          oldest->erase(oldest->begin());
+        }
+        return trimmed;
+      }
+    };
+    inline page_allocator_cache_t &page_allocator_cache() noexcept
+    {
+      // Deliberately leaked so memory deallocated during static deinitialisation remains safe
+      static page_allocator_cache_t *v = [] {
+        auto *ret = new page_allocator_cache_t;
+        (void) register_memory_pressure_callback(
+        [](void *data, memory_pressure level) noexcept {
+          auto *cache = static_cast<page_allocator_cache_t *>(data);
+          std::lock_guard<std::mutex> g(cache->lock);
+          cache->_trim_locked((level == memory_pressure::critical) ? 0 : cache->bytes / 2);
+        },
+        ret);
+        return ret;
+      }();
+      return *v;
+    }
+
+    /* Each kernel thread keeps the most recently deallocated memory for reuse without locking,
+    ordered by when it was deallocated.
+    */
+    struct page_allocator_thread_cache_t
+    {
+      static constexpr size_t max_items = 16;
+      page_allocator_cache_t::item_t items[max_items]{};
+      size_t count{0}, bytes{0};
+      ~page_allocator_thread_cache_t() { flush(0); }
+
+      // Moves the least recently deallocated into the global cache until no more than max_remaining bytes and max_items - 1 items are kept
+      void flush(size_t max_remaining) noexcept
+      {
+        size_t n = 0;
+        for(; n < count && (bytes > max_remaining || count - n >= max_items); n++)
+        {
+          page_allocator_cache().add(items[n].p, items[n].bytes);
+          bytes -= items[n].bytes;
+        }
+        for(size_t m = n; m < count; m++)
+        {
+          items[m - n] = items[m];
+        }
+        count -= n;
+      }
+    };
+    inline page_allocator_thread_cache_t &page_allocator_thread_cache() noexcept
+    {
+      static thread_local page_allocator_thread_cache_t v;
+      return v;
+    }
+
+    LLFIO_HEADERS_ONLY_FUNC_SPEC void *allocate_cached_large_pages(size_t bytes) noexcept
+    {
+      bytes = round_up_to_page_size(bytes, page_size());
+      auto &cache = page_allocator_thread_cache();
+      for(size_t n = cache.count; n > 0; n--)
+      {
+        if(cache.items[n - 1].bytes == bytes)
+        {
+          void *ret = cache.items[n - 1].p;
+          for(size_t m = n; m < cache.count; m++)
+          {
+            cache.items[m - 1] = cache.items[m];
+          }
+          --cache.count;
+          cache.bytes -= bytes;
+          return ret;
+        }
+      }
+      if(void *ret = page_allocator_cache().get(bytes))
+      {
+        return ret;
+      }
+      try
+      {
+        return allocate_large_pages(bytes).p;
+      }
+      catch(...)
+      {
+        return nullptr;
+      }
+    }
+
+    LLFIO_HEADERS_ONLY_FUNC_SPEC void deallocate_cached_large_pages(void *p, size_t bytes) noexcept
+    {
+      bytes = round_up_to_page_size(bytes, page_size());
+      auto &global = page_allocator_cache();
+      const size_t max = global.max_thread_bytes.load(std::memory_order_relaxed);
+      if(bytes > max)
+      {
+        global.add(p, bytes);
+        return;
+      }
+      auto &cache = page_allocator_thread_cache();
+      if(cache.count == page_allocator_thread_cache_t::max_items || cache.bytes + bytes > max)
+      {
+        cache.flush(max / 2);
+      }
+      cache.items[cache.count++] = page_allocator_cache_t::item_t{p, bytes, 0};
+      cache.bytes += bytes;
+    }
+
+    struct large_page_policy_t
+    {
+      std::atomic<size_t> page_size{0};
+      std::atomic<bool> permit_fallback{true};
+      std::atomic<size_t> allocations{0}, fallbacks{0}, fallback_bytes{0}, failures{0};
+    };
+    inline large_page_policy_t &large_page_policy() noexcept
+    {
+      static large_page_policy_t v;
+      return v;
+    }
+
+    LLFIO_HEADERS_ONLY_FUNC_SPEC large_page_allocation allocate_large_pages(size_t bytes)
+    {
+      auto &policy = large_page_policy();
+      const size_t pagesize = policy.page_size.load(std::memory_order_relaxed);
+      const bool permit_fallback = policy.permit_fallback.load(std::memory_order_relaxed);
+      const size_t asked = (pagesize != 0) ? pagesize : calculate_large_page_allocation(bytes).page_size_used;
+      auto ret = allocate_large_pages(bytes, pagesize, permit_fallback);
+      if(asked > page_size())
+      {
+        policy.allocations.fetch_add(1, std::memory_order_relaxed);
+        if(ret.p == nullptr)
+        {
+          policy.failures.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if(ret.page_size_used < asked)
+        {
+          policy.fallbacks.fetch_add(1, std::memory_order_relaxed);
+          policy.fallback_bytes.fetch_add(ret.actual_size, std::memory_order_relaxed);
+        }
+      }
+      return ret;
+    }
+
+    /* ChaCha20 (RFC 7539, with words 12 and 13 being a 64 bit block counter) used to
+    expand a key from the kernel into an arbitrarily long stream of randomness.
+    */
+    struct chacha20_scalar_ops
+    {
+      static inline uint32_t rotl(uint32_t v, int n) noexcept { return (v << n) | (v >> (32 - n)); }
+      static inline void quarter_round(uint32_t &a, uint32_t &b, uint32_t &c, uint32_t &d) noexcept
+      {
+        a += b;
+        d = rotl(d ^ a, 16);
+        c += d;
+        b = rotl(b ^ c, 12);
+        a += b;
+        d = rotl(d ^ a, 8);
+        c += d;
+        b = rotl(b ^ c, 7);
+      }
+      // Writes one 64 byte block for the counter in state, and increments the counter
+      static inline void block(uint32_t *state, char *out) noexcept
+      {
+        uint32_t x[16];
+        memcpy(x, state, sizeof(x));
+        for(int i = 0; i < 10; i++)
+        {
+          quarter_round(x[0], x[4], x[8], x[12]);
+          quarter_round(x[1], x[5], x[9], x[13]);
+          quarter_round(x[2], x[6], x[10], x[14]);
+          quarter_round(x[3], x[7], x[11], x[15]);
+          quarter_round(x[0], x[5], x[10], x[15]);
+          quarter_round(x[1], x[6], x[11], x[12]);
+          quarter_round(x[2], x[7], x[8], x[13]);
+          quarter_round(x[3], x[4], x[9], x[14]);
+        }
+        for(int i = 0; i < 16; i++)
+        {
+          const uint32_t v = x[i] + state[i];
+          out[i * 4 + 0] = static_cast<char>(v & 0xff);
+          out[i * 4 + 1] = static_cast<char>((v >> 8) & 0xff);
+          out[i * 4 + 2] = static_cast<char>((v >> 16) & 0xff);
+          out[i * 4 + 3] = static_cast<char>((v >> 24) & 0xff);
+        }
+        if(++state[12] == 0)
+        {
+          ++state[13];
+        }
+      }
+    };
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__SSE2__) && (defined(__i386__) || defined(_M_IX86)))
+    struct chacha20_simd_ops
+    {
+      using vec = __m128i;
+      static inline vec set1(uint32_t v) noexcept { return _mm_set1_epi32(static_cast<int>(v)); }
+      static inline vec set(uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept
+      {
+        return _mm_setr_epi32(static_cast<int>(a), static_cast<int>(b), static_cast<int>(c), static_cast<int>(d));
+      }
+      static inline vec add(vec a, vec b) noexcept { return _mm_add_epi32(a, b); }
+      static inline vec xor_(vec a, vec b) noexcept { return _mm_xor_si128(a, b); }
+      template <int n> static inline vec rotl(vec v) noexcept { return _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - n)); }
+      static inline void transpose(vec &a, vec &b, vec &c, vec &d) noexcept
+      {
+        const vec t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d), t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d);
+        a = _mm_unpacklo_epi64(t0, t1);
+        b = _mm_unpackhi_epi64(t0, t1);
+        c = _mm_unpacklo_epi64(t2, t3);
+        d = _mm_unpackhi_epi64(t2, t3);
+      }
+      static inline void store(char *out, vec v) noexcept { _mm_storeu_si128(reinterpret_cast<__m128i *>(out), v); }
+    };
+#elif(defined(__aarch64__) || defined(_M_ARM64)) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    struct chacha20_simd_ops
+    {
+      using vec = uint32x4_t;
+      static inline vec set1(uint32_t v) noexcept { return vdupq_n_u32(v); }
+      static inline vec set(uint32_t a, uint32_t b, uint32_t c, uint32_t d) noexcept
+      {
+        const uint32_t v[4] = {a, b, c, d};
+        return vld1q_u32(v);
+      }
+      static inline vec add(vec a, vec b) noexcept { return vaddq_u32(a, b); }
+      static inline vec xor_(vec a, vec b) noexcept { return veorq_u32(a, b); }
+      template <int n> static inline vec rotl(vec v) noexcept { return vsriq_n_u32(vshlq_n_u32(v, n), v, 32 - n); }
+      static inline void transpose(vec &a, vec &b, vec &c, vec &d) noexcept
+      {
+        const uint32x4x2_t t0 = vtrnq_u32(a, b), t1 = vtrnq_u32(c, d);
+        a = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));
+        b = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));
+        c = vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0]));
+        d = vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1]));
+      }
+      static inline void store(char *out, vec v) noexcept { vst1q_u8(reinterpret_cast<uint8_t *>(out), vreinterpretq_u8_u32(v)); }
+    };
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__SSE2__) && (defined(__i386__) || defined(_M_IX86))) ||                                        \
+(defined(__aarch64__) || defined(_M_ARM64)) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    // Writes four 64 byte blocks, each lane of each vector being one block
+    template <class Ops> inline void chacha20_blocks4(uint32_t *state, char *out) noexcept
+    {
+      using vec = typename Ops::vec;
+      vec in[16], x[16];
+      for(int i = 0; i < 16; i++)
+      {
+        in[i] = Ops::set1(state[i]);
+      }
+      const uint64_t counter = state[12] | (static_cast<uint64_t>(state[13]) << 32);
+      in[12] = Ops::set(static_cast<uint32_t>(counter), static_cast<uint32_t>(counter + 1), static_cast<uint32_t>(counter + 2), static_cast<uint32_t>(counter + 3));
+      in[13] = Ops::set(static_cast<uint32_t>(counter >> 32), static_cast<uint32_t>((counter + 1) >> 32), static_cast<uint32_t>((counter + 2) >> 32),
+                        static_cast<uint32_t>((counter + 3) >> 32));
+      for(int i = 0; i < 16; i++)
+      {
+        x[i] = in[i];
+      }
+#define LLFIO_CHACHA20_QR(a, b, c, d)                                                                                                                          \
+  x[a] = Ops::add(x[a], x[b]);                                                                                                                                 \
+  x[d] = Ops::template rotl<16>(Ops::xor_(x[d], x[a]));                                                                                                        \
+  x[c] = Ops::add(x[c], x[d]);                                                                                                                                 \
+  x[b] = Ops::template rotl<12>(Ops::xor_(x[b], x[c]));                                                                                                        \
+  x[a] = Ops::add(x[a], x[b]);                                                                                                                                 \
+  x[d] = Ops::template rotl<8>(Ops::xor_(x[d], x[a]));                                                                                                         \
+  x[c] = Ops::add(x[c], x[d]);                                                                                                                                 \
+  x[b] = Ops::template rotl<7>(Ops::xor_(x[b], x[c]))
+      for(int i = 0; i < 10; i++)
+      {
+        LLFIO_CHACHA20_QR(0, 4, 8, 12);
+        LLFIO_CHACHA20_QR(1, 5, 9, 13);
+        LLFIO_CHACHA20_QR(2, 6, 10, 14);
+        LLFIO_CHACHA20_QR(3, 7, 11, 15);
+        LLFIO_CHACHA20_QR(0, 5, 10, 15);
+        LLFIO_CHACHA20_QR(1, 6, 11, 12);
+        LLFIO_CHACHA20_QR(2, 7, 8, 13);
+        LLFIO_CHACHA20_QR(3, 4, 9, 14);
+      }
+#undef LLFIO_CHACHA20_QR
+      for(int i = 0; i < 16; i += 4)
+      {
+        vec a = Ops::add(x[i], in[i]), b = Ops::add(x[i + 1], in[i + 1]), c = Ops::add(x[i + 2], in[i + 2]), d = Ops::add(x[i + 3], in[i + 3]);
+        Ops::transpose(a, b, c, d);
+        Ops::store(out + i * 4, a);
+        Ops::store(out + 64 + i * 4, b);
+        Ops::store(out + 128 + i * 4, c);
+        Ops::store(out + 192 + i * 4, d);
+      }
+      const uint64_t next = counter + 4;
+      state[12] = static_cast<uint32_t>(next);
+      state[13] = static_cast<uint32_t>(next >> 32);
+    }
+#define LLFIO_CHACHA20_HAVE_SIMD 1
+#endif
+    inline void chacha20_fill(uint32_t *state, char *buffer, size_t bytes) noexcept
+    {
+#ifdef LLFIO_CHACHA20_HAVE_SIMD
+      for(; bytes >= 256; buffer += 256, bytes -= 256)
+      {
+        chacha20_blocks4<chacha20_simd_ops>(state, buffer);
+      }
+#endif
+      for(; bytes >= 64; buffer += 64, bytes -= 64)
+      {
+        chacha20_scalar_ops::block(state, buffer);
+      }
+      if(bytes > 0)
+      {
+        char tail[64];
+        chacha20_scalar_ops::block(state, tail);
+        memcpy(buffer, tail, bytes);
+      }
+    }
+  }  // namespace detail
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> register_memory_pressure_callback(memory_pressure_callback callback, void *data) noexcept
+  {
+    try
+    {
+      auto &registry = detail::memory_pressure_registry();
+      std::lock_guard<std::mutex> g(registry.lock);
+      registry.callbacks.push_back({registry.next_id, callback, data});
+      return registry.next_id++;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void unregister_memory_pressure_callback(size_t id) noexcept
+  {
+    auto &registry = detail::memory_pressure_registry();
+    std::lock_guard<std::mutex> g(registry.lock);
+    for(auto it = registry.callbacks.begin(); it != registry.callbacks.end(); ++it)
+    {
+      if(it->id == id)
+      {
+        registry.callbacks.erase(it);
+        return;
+      }
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void notify_memory_pressure(memory_pressure level) noexcept
+  {
+    auto &registry = detail::memory_pressure_registry();
+    std::lock_guard<std::mutex> g(registry.lock);
+    for(auto &i : registry.callbacks)
+    {
+      i.callback(i.data, level);
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void random_fill(char *buffer, size_t bytes) noexcept
+  {
+    // The kernel is quick enough for short fills, such as random filenames
+    if(bytes <= 256)
+    {
+      detail::kernel_random_fill(buffer, bytes);
+      return;
+    }
+    uint32_t state[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+    // A fresh key and nonce for every fill means no state is shared between threads
+    detail::kernel_random_fill(reinterpret_cast<char *>(state + 4), 32);
+    detail::kernel_random_fill(reinterpret_cast<char *>(state + 14), 8);
+    detail::chacha20_fill(state, buffer, bytes);
+    volatile uint32_t *wipe = state;
+    for(size_t n = 0; n < 16; n++)
+    {
+      wipe[n] = 0;
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void memcpy_nontemporal(void *dest, const void *src, size_t bytes) noexcept
+  {
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__SSE2__) && (defined(__i386__) || defined(_M_IX86)))
+    auto *d = static_cast<char *>(dest);
+    const auto *s = static_cast<const char *>(src);
+    // Non-temporal stores must be aligned, so copy up to the first 16 byte boundary normally
+    const size_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+    if(bytes < head + 64)
+    {
+      memcpy(d, s, bytes);
+      return;
+    }
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    bytes -= head;
+    for(; bytes >= 64; bytes -= 64, d += 64, s += 64)
+    {
+      const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16));
+      const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 32));
+      const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 48));
+      _mm_stream_si128(reinterpret_cast<__m128i *>(d), a);
+      _mm_stream_si128(reinterpret_cast<__m128i *>(d + 16), b);
+      _mm_stream_si128(reinterpret_cast<__m128i *>(d + 32), c);
+      _mm_stream_si128(reinterpret_cast<__m128i *>(d + 48), e);
+    }
+    _mm_sfence();
+    memcpy(d, s, bytes);
+#else
+    memcpy(dest, src, bytes);
+#endif
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC large_page_statistics large_page_allocation_statistics() noexcept
+  {
+    auto &policy = detail::large_page_policy();
+    large_page_statistics ret;
+    ret.allocations = policy.allocations.load(std::memory_order_relaxed);
+    ret.fallbacks = policy.fallbacks.load(std::memory_order_relaxed);
+    ret.fallback_bytes = policy.fallback_bytes.load(std::memory_order_relaxed);
+    ret.failures = policy.failures.load(std::memory_order_relaxed);
+    return ret;
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<void> set_large_page_allocation_policy(size_t page_size, bool permit_fallback) noexcept
+  {
+    try
+    {
+      if(page_size != 0)
+      {
+        const auto &sizes = page_sizes(false);
+        if(std::find(sizes.begin(), sizes.end(), page_size) == sizes.end())
+        {
+          return errc::invalid_argument;
+        }
+      }
+      auto &policy = detail::large_page_policy();
+      policy.page_size.store(page_size, std::memory_order_relaxed);
+      policy.permit_fallback.store(permit_fallback, std::memory_order_relaxed);
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void set_page_allocator_cache_limits(size_t max_thread_bytes, size_t max_global_bytes) noexcept
+  {
+    auto &global = detail::page_allocator_cache();
+    global.max_thread_bytes.store(max_thread_bytes, std::memory_order_relaxed);
+    global.max_bytes.store(max_global_bytes, std::memory_order_relaxed);
+    // Other threads' caches shrink to the new limit upon their next deallocation
+    detail::page_allocator_thread_cache().flush(max_thread_bytes);
+    std::lock_guard<std::mutex> g(global.lock);
+    global._trim_locked(max_global_bytes);
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC size_t trim_page_allocator_cache() noexcept
+  {
+    auto &global = detail::page_allocator_cache();
+    detail::page_allocator_thread_cache().flush(0);
+    std::lock_guard<std::mutex> g(global.lock);
+    return global._trim_locked(0);
+  }
+}  // namespace utils
+
+LLFIO_V2_NAMESPACE_END
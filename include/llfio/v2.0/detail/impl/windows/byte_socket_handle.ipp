@@ -0,0 +1,421 @@
+/* A handle to a byte-orientated socket
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../../byte_socket_handle.hpp"
+#include "../../../pipe_handle.hpp"
+#include "import.hpp"
+
+#include <winsock2.h>
+#include <mswsock.h>
+#include <ws2tcpip.h>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  inline result<void> winsock_init() noexcept
+  {
+    static const int ret = [] {
+      WSADATA wsadata;
+      return WSAStartup(MAKEWORD(2, 2), &wsadata);
+    }();
+    if(ret != 0)
+    {
+      return win32_error((DWORD) ret);
+    }
+    return success();
+  }
+  // Waits until the socket is ready for writing if `write`, else for reading, or the deadline passes
+  inline result<void> byte_socket_wait(SOCKET s, bool write, const deadline &d) noexcept
+  {
+    fd_set fds, efds;
+    FD_ZERO(&fds);
+    FD_ZERO(&efds);
+    FD_SET(s, &fds);
+    FD_SET(s, &efds);
+    const int ms = byte_socket_timeout_ms(d);
+    timeval tv{ms / 1000, (ms % 1000) * 1000};
+    // A failed connect is reported in the exception set, not the write set
+    const int ret = ::select(0, write ? nullptr : &fds, write ? &fds : nullptr, &efds, (ms < 0) ? nullptr : &tv);
+    if(ret == SOCKET_ERROR)
+    {
+      return win32_error((DWORD) WSAGetLastError());
+    }
+    if(ret == 0)
+    {
+      return errc::timed_out;
+    }
+    return success();
+  }
+  // Creates a TCP socket, not inherited by child processes, and overlapped if `nonblocking`
+  inline result<SOCKET> byte_socket_create(ip::family family, bool nonblocking) noexcept
+  {
+    OUTCOME_TRY(winsock_init());
+    if(family != ip::family::v4 && family != ip::family::v6)
+    {
+      return errc::invalid_argument;
+    }
+    const SOCKET s = WSASocketW((family == ip::family::v6) ? AF_INET6 : AF_INET, SOCK_STREAM, IPPROTO_TCP, nullptr, 0,
+                                WSA_FLAG_NO_HANDLE_INHERIT | (nonblocking ? WSA_FLAG_OVERLAPPED : 0));
+    if(s == INVALID_SOCKET)
+    {
+      return win32_error((DWORD) WSAGetLastError());
+    }
+    return s;
+  }
+  inline result<ip::address> byte_socket_name(SOCKET s, bool peer) noexcept
+  {
+    sockaddr_storage ss;
+    memset(&ss, 0, sizeof(ss));
+    int len = sizeof(ss);
+    if(SOCKET_ERROR == (peer ? ::getpeername(s, reinterpret_cast<sockaddr *>(&ss), &len) : ::getsockname(s, reinterpret_cast<sockaddr *>(&ss), &len)))
+    {
+      return win32_error((DWORD) WSAGetLastError());
+    }
+    return ip::address(&ss, (size_t) len);
+  }
+  // Fetches TransmitFile() from the socket's provider, which saves linking to mswsock
+  inline result<LPFN_TRANSMITFILE> byte_socket_transmitfile(SOCKET s) noexcept
+  {
+    GUID guid = WSAID_TRANSMITFILE;
+    LPFN_TRANSMITFILE ret = nullptr;
+    DWORD bytes = 0;
+    if(SOCKET_ERROR == ::WSAIoctl(s, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid), &ret, sizeof(ret), &bytes, nullptr, nullptr))
+    {
+      return win32_error((DWORD) WSAGetLastError());
+    }
+    return ret;
+  }
+  inline result<void> byte_socket_close(native_handle_type &nativeh) noexcept
+  {
+    if(SOCKET_ERROR == ::closesocket(reinterpret_cast<SOCKET>(nativeh.h)))
+    {
+      return win32_error((DWORD) WSAGetLastError());
+    }
+    nativeh = native_handle_type();
+    return success();
+  }
+}  // namespace detail
+
+result<byte_socket_handle> byte_socket_handle::byte_socket(ip::family family, mode _mode, caching _caching, flag flags) noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  result<byte_socket_handle> ret(byte_socket_handle(native_handle_type(), _caching, flags, nullptr));
+  native_handle_type &nativeh = ret.value()._v;
+  LLFIO_LOG_FUNCTION_CALL(&ret);
+  nativeh.behaviour |= native_handle_type::disposition::socket;
+  OUTCOME_TRYV(access_mask_from_handle_mode(nativeh, _mode, flags));
+  OUTCOME_TRYV(attributes_from_handle_caching_and_flags(nativeh, caching::all, flags));
+  nativeh.behaviour &= ~(native_handle_type::disposition::seekable | native_handle_type::disposition::append_only);  // not seekable
+  OUTCOME_TRY(auto &&s, detail::byte_socket_create(family, nativeh.is_nonblocking()));
+  nativeh.h = reinterpret_cast<HANDLE>(s);
+  return ret;
+}
+
+result<void> byte_socket_handle::connect(const ip::address &addr, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(d && !_v.is_nonblocking())
+  {
+    return errc::not_supported;
+  }
+  const auto s = reinterpret_cast<SOCKET>(_v.h);
+  if(!d)
+  {
+    LLFIO_TRACE_SYSCALL(this, "connect");
+    if(SOCKET_ERROR == ::connect(s, static_cast<const sockaddr *>(addr.to_sockaddr()), addr.sockaddrlen()))
+    {
+      return win32_error((DWORD) WSAGetLastError());
+    }
+    return success();
+  }
+  // Overlapped sockets still connect synchronously unless non-blocking mode is set
+  u_long nonblocking = 1;
+  if(SOCKET_ERROR == ::ioctlsocket(s, FIONBIO, &nonblocking))
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  auto restore = make_scope_exit([s]() noexcept {
+    u_long blocking = 0;
+    ::ioctlsocket(s, FIONBIO, &blocking);
+  });
+  LLFIO_TRACE_SYSCALL(this, "connect");
+  if(SOCKET_ERROR != ::connect(s, static_cast<const sockaddr *>(addr.to_sockaddr()), addr.sockaddrlen()))
+  {
+    return success();
+  }
+  if(WSAGetLastError() != WSAEWOULDBLOCK)
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  OUTCOME_TRY(detail::byte_socket_wait(s, true, d));
+  int error = 0;
+  int len = sizeof(error);
+  if(SOCKET_ERROR == ::getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &len))
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  if(error != 0)
+  {
+    return win32_error((DWORD) error);
+  }
+  return success();
+}
+
+result<ip::address> byte_socket_handle::local_endpoint() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::byte_socket_name(reinterpret_cast<SOCKET>(_v.h), false);
+}
+
+result<ip::address> byte_socket_handle::remote_endpoint() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::byte_socket_name(reinterpret_cast<SOCKET>(_v.h), true);
+}
+
+result<void> byte_socket_handle::shutdown(shutdown_kind kind) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const int how = (kind == shutdown_kind::read) ? SD_RECEIVE : (kind == shutdown_kind::write) ? SD_SEND : SD_BOTH;
+  if(SOCKET_ERROR == ::shutdown(reinterpret_cast<SOCKET>(_v.h), how))
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  return success();
+}
+
+result<void> byte_socket_handle::shutdown_and_close(deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const auto s = reinterpret_cast<SOCKET>(_v.h);
+  if(is_writable())
+  {
+    OUTCOME_TRY(shutdown(shutdown_kind::write));
+  }
+  if(is_readable())
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    char buffer[4096];
+    for(;;)
+    {
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      if(d)
+      {
+        auto r = detail::byte_socket_wait(s, false, nd);
+        if(!r)
+        {
+          if(r.error() == errc::timed_out)
+          {
+            break;
+          }
+          return std::move(r).error();
+        }
+      }
+      const int bytesread = ::recv(s, buffer, sizeof(buffer), 0);
+      if(bytesread == 0 || bytesread == SOCKET_ERROR)
+      {
+        // Either the peer has shut down its side, or reset the connection which is as good as closed
+        break;
+      }
+    }
+  }
+  return close();
+}
+
+result<size_t> byte_socket_handle::splice_from(io_handle &src, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(d && !_v.is_nonblocking())
+  {
+    return errc::not_supported;
+  }
+  if(bytes == 0)
+  {
+    return 0;
+  }
+  if(!src.is_seekable())
+  {
+    return detail::pipe_handle_splice_copy(*this, 0, src, offset, bytes, d);
+  }
+  const auto s = reinterpret_cast<SOCKET>(_v.h);
+  OUTCOME_TRY(auto &&transmitfile, detail::byte_socket_transmitfile(s));
+  HANDLE event = CreateEventW(nullptr, true, false, nullptr);
+  if(event == nullptr)
+  {
+    return win32_error();
+  }
+  auto unevent = make_scope_exit([event]() noexcept { CloseHandle(event); });
+  OVERLAPPED ol;
+  memset(&ol, 0, sizeof(ol));
+  ol.Offset = static_cast<DWORD>(offset & 0xffffffff);
+  ol.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  // Setting the low bit stops the completion being posted to any IOCP this socket is associated with
+  ol.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(event) | 1);
+  // TransmitFile() sends at most INT_MAX - 1 bytes per call
+  const auto tosend = static_cast<DWORD>((std::min)(bytes, static_cast<size_t>(INT_MAX - 1)));
+  LLFIO_TRACE_SYSCALL(this, "TransmitFile");
+  if(!transmitfile(s, src.native_handle().h, tosend, 0, &ol, nullptr, 0))
+  {
+    const int errcode = WSAGetLastError();
+    if(errcode != WSA_IO_PENDING && errcode != ERROR_IO_PENDING)
+    {
+      return win32_error((DWORD) errcode);
+    }
+    const int ms = detail::byte_socket_timeout_ms(d);
+    if(WAIT_TIMEOUT == WaitForSingleObject(event, (ms < 0) ? INFINITE : static_cast<DWORD>(ms)))
+    {
+      CancelIoEx(_v.h, &ol);
+      DWORD sent = 0, flags = 0;
+      // Bytes sent before the cancellation are still sent
+      if(WSAGetOverlappedResult(s, &ol, &sent, true, &flags) || sent > 0)
+      {
+        return static_cast<size_t>(sent);
+      }
+      return errc::timed_out;
+    }
+  }
+  DWORD sent = 0, flags = 0;
+  if(!WSAGetOverlappedResult(s, &ol, &sent, true, &flags))
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  return static_cast<size_t>(sent);
+}
+
+result<void> byte_socket_handle::close() noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(_v)
+  {
+    if(_ctx != nullptr)
+    {
+      OUTCOME_TRY(set_multiplexer(nullptr));
+    }
+#if LLFIO_ENABLE_IO_STATISTICS
+    _forget_statistics();
+#endif
+    // Sockets must be closed with closesocket(), not CloseHandle()
+    OUTCOME_TRY(detail::byte_socket_close(_v));
+  }
+  return success();
+}
+
+result<listening_byte_socket_handle> listening_byte_socket_handle::listening_byte_socket(ip::family family, mode _mode, caching _caching, flag flags) noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  result<listening_byte_socket_handle> ret(listening_byte_socket_handle(native_handle_type(), _caching, flags));
+  native_handle_type &nativeh = ret.value()._v;
+  LLFIO_LOG_FUNCTION_CALL(&ret);
+  nativeh.behaviour |= native_handle_type::disposition::socket;
+  OUTCOME_TRYV(access_mask_from_handle_mode(nativeh, _mode, flags));
+  OUTCOME_TRYV(attributes_from_handle_caching_and_flags(nativeh, caching::all, flags));
+  nativeh.behaviour &= ~(native_handle_type::disposition::seekable | native_handle_type::disposition::append_only);  // not seekable
+  // Accepted sockets inherit overlapped from the listening socket
+  OUTCOME_TRY(auto &&s, detail::byte_socket_create(family, nativeh.is_nonblocking()));
+  nativeh.h = reinterpret_cast<HANDLE>(s);
+  return ret;
+}
+
+result<void> listening_byte_socket_handle::bind(const ip::address &addr, int backlog) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const auto s = reinterpret_cast<SOCKET>(_v.h);
+  // Unlike SO_REUSEADDR, which on Windows permits stealing a port in use, this forbids it
+  BOOL one = TRUE;
+  if(SOCKET_ERROR == ::setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, reinterpret_cast<const char *>(&one), sizeof(one)))
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  if(SOCKET_ERROR == ::bind(s, static_cast<const sockaddr *>(addr.to_sockaddr()), addr.sockaddrlen()))
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  if(SOCKET_ERROR == ::listen(s, (backlog < 0) ? SOMAXCONN : backlog))
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  return success();
+}
+
+result<ip::address> listening_byte_socket_handle::local_endpoint() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::byte_socket_name(reinterpret_cast<SOCKET>(_v.h), false);
+}
+
+result<std::pair<byte_socket_handle, ip::address>> listening_byte_socket_handle::accept(io_multiplexer *ctx, deadline d) noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  LLFIO_LOG_FUNCTION_CALL(this);
+  const auto s = reinterpret_cast<SOCKET>(_v.h);
+  result<std::pair<byte_socket_handle, ip::address>> ret(byte_socket_handle(native_handle_type(), caching::all, _flags & ~flag::unlink_on_first_close, nullptr), ip::address());
+  native_handle_type &nativeh = ret.value().first._v;
+  OUTCOME_TRYV(access_mask_from_handle_mode(nativeh, (_v.behaviour & native_handle_type::disposition::writable) ? mode::write : mode::read, _flags));
+  OUTCOME_TRYV(attributes_from_handle_caching_and_flags(nativeh, caching::all, _flags & ~flag::unlink_on_first_close));
+  nativeh.behaviour |= native_handle_type::disposition::socket;
+  nativeh.behaviour &= ~(native_handle_type::disposition::seekable | native_handle_type::disposition::append_only);  // not seekable
+  if(d)
+  {
+    OUTCOME_TRY(detail::byte_socket_wait(s, false, d));
+  }
+  sockaddr_storage ss;
+  memset(&ss, 0, sizeof(ss));
+  int len = sizeof(ss);
+  LLFIO_TRACE_SYSCALL(this, "accept");
+  const SOCKET accepted = ::accept(s, reinterpret_cast<sockaddr *>(&ss), &len);
+  if(accepted == INVALID_SOCKET)
+  {
+    return win32_error((DWORD) WSAGetLastError());
+  }
+  nativeh.h = reinterpret_cast<HANDLE>(accepted);
+  if(!SetHandleInformation(nativeh.h, HANDLE_FLAG_INHERIT, 0))
+  {
+    return win32_error();
+  }
+  ret.value().second = ip::address(&ss, (size_t) len);
+  if(ctx != nullptr)
+  {
+    OUTCOME_TRY(ret.value().first.set_multiplexer(ctx));
+  }
+  return ret;
+}
+
+result<void> listening_byte_socket_handle::close() noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(_v)
+  {
+    // Sockets must be closed with closesocket(), not CloseHandle()
+    OUTCOME_TRY(detail::byte_socket_close(_v));
+  }
+  return success();
+}
+
+LLFIO_V2_NAMESPACE_END
@@ -84,7 +84,7 @@ result<directory_handle> directory_handle::directory(const path_handle &base, pa
     ntflags |= 0x01 /*FILE_DIRECTORY_FILE*/;  // required to open a directory
     IO_STATUS_BLOCK isb = make_iostatus();
 
-    path_view::c_str<> zpath(path, true);
+    path_view::recycling_c_str<> zpath(path, true);
     UNICODE_STRING _path{};
     _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
     _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
@@ -159,7 +159,7 @@ result<directory_handle> directory_handle::directory(const path_handle &base, pa
       break;
     }
     attribs |= FILE_FLAG_BACKUP_SEMANTICS;  // required to open a directory
-    path_view::c_str<> zpath(path, false);
+    path_view::recycling_c_str<> zpath(path, false);
     if(INVALID_HANDLE_VALUE == (nativeh.h = CreateFileW_(zpath.buffer, access, fileshare, nullptr, creation, attribs, nullptr, true)))  // NOLINT
     {
       DWORD errcode = GetLastError();
@@ -276,6 +276,26 @@ result<void> directory_handle::unlink(deadline d) noexcept
   return h.unlink(d);
 }
 
+namespace detail
+{
+  // Fills the members of stat_t which differ between the directory information classes
+  inline void fill_stat_from_directory_information(stat_t &s, const windows_nt_kernel::FILE_DIRECTORY_INFORMATION *ffdi) noexcept
+  {
+    s.st_type = windows_nt_kernel::to_st_type(ffdi->FileAttributes, IO_REPARSE_TAG_SYMLINK /* not accurate, but best we can do */);
+  }
+  inline void fill_stat_from_directory_information(stat_t &s, const windows_nt_kernel::FILE_ID_FULL_DIR_INFORMATION *ffdi) noexcept
+  {
+    s.st_ino = ffdi->FileId.QuadPart;
+    s.st_type = windows_nt_kernel::to_st_type(ffdi->FileAttributes, ffdi->ReparsePointTag);
+  }
+  inline void fill_stat_from_directory_information(stat_t &s, const windows_nt_kernel::FILE_ID_EXTD_DIR_INFORMATION *ffdi) noexcept
+  {
+    // st_ino has room for only the bottom 64 bits of a 128 bit file id, which on NTFS is all of it
+    memcpy(&s.st_ino, ffdi->FileId, sizeof(s.st_ino));
+    s.st_type = windows_nt_kernel::to_st_type(ffdi->FileAttributes, ffdi->ReparsePointTag);
+  }
+}  // namespace detail
+
 result<directory_handle::buffers_type> directory_handle::read(io_request<buffers_type> req, deadline d) const noexcept
 {
   windows_nt_kernel::init();
@@ -283,11 +303,14 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
 //#define LLFIO_DIRECTORY_HANDLE_ENUMERATE_LESS_INFO 1
 #ifdef LLFIO_DIRECTORY_HANDLE_ENUMERATE_LESS_INFO
   using what_to_enumerate_type = FILE_DIRECTORY_INFORMATION;  // 68 bytes + filename
-  const auto what_to_enumerate = FileDirectoryInformation;
+  using fallback_what_to_enumerate_type = FILE_DIRECTORY_INFORMATION;
+  const auto what_to_enumerate = FileDirectoryInformation, fallback_what_to_enumerate = FileDirectoryInformation;
   static constexpr stat_t::want default_stat_contents = /*stat_t::want::ino |*/ stat_t::want::type | stat_t::want::atim | stat_t::want::mtim | stat_t::want::ctim | stat_t::want::size | stat_t::want::allocated | stat_t::want::birthtim | stat_t::want::sparse | stat_t::want::compressed | stat_t::want::reparse_point;
 #else
-  using what_to_enumerate_type = FILE_ID_FULL_DIR_INFORMATION;  // 80 bytes + filename
-  const auto what_to_enumerate = FileIdFullDirectoryInformation;
+  // Not every filing system implements FileIdExtdDirectoryInformation, FAT for example
+  using what_to_enumerate_type = FILE_ID_EXTD_DIR_INFORMATION;           // 96 bytes + filename
+  using fallback_what_to_enumerate_type = FILE_ID_FULL_DIR_INFORMATION;  // 80 bytes + filename
+  const auto what_to_enumerate = FileIdExtdDirectoryInformation, fallback_what_to_enumerate = FileIdFullDirectoryInformation;
   static constexpr stat_t::want default_stat_contents = stat_t::want::ino | stat_t::want::type | stat_t::want::atim | stat_t::want::mtim | stat_t::want::ctim | stat_t::want::size | stat_t::want::allocated | stat_t::want::birthtim | stat_t::want::sparse | stat_t::want::compressed | stat_t::want::reparse_point;
 #endif
   LLFIO_LOG_FUNCTION_CALL(this);
@@ -296,6 +319,24 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
   {
     return std::move(req.buffers);
   }
+  /* Every entry lives on the volume of this directory, so the metadata which comes from
+  the volume is fetched once here rather than by opening each entry. Mount points are
+  enumerated as the reparse points they are, which live on this volume too.
+  */
+  stat_t volume(nullptr);
+  stat_t::want stat_contents = default_stat_contents;
+  {
+    auto r = volume.fill(*this, stat_t::want::blksize);
+    if(r && r.value() == 1 && volume.st_blksize != 0)
+    {
+      stat_contents = stat_contents | stat_t::want::blocks | stat_t::want::blksize;
+    }
+    r = volume.fill(*this, stat_t::want::dev);
+    if(r && r.value() == 1)
+    {
+      stat_contents = stat_contents | stat_t::want::dev;
+    }
+  }
   UNICODE_STRING _glob{};
   memset(&_glob, 0, sizeof(_glob));
   path_view_type::c_str<> zglob(req.glob, true);
@@ -305,7 +346,8 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
     _glob.Length = (USHORT)(zglob.length * sizeof(wchar_t));
     _glob.MaximumLength = _glob.Length + sizeof(wchar_t);
   }
-  what_to_enumerate_type *buffer = nullptr;
+  void *buffer = nullptr;
+  bool use_fallback = false;
   {
     /* Recent editions of Windows call ProbeForWrite() on the buffer passed.
     This is a very slow call, in fact it is worth calling the syscall multiple
@@ -313,15 +355,19 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
     large buffer. We therefore iterate the directory twice, firstly just for names
     so we can calculate what buffer sizes we shall need. We then iterate the
     directory for all entries + stat structures as a single snapshot.
+
+    If the caller supplies the kernel buffer, they have chosen its size, so it is
+    filled in a single syscall without iterating for names first.
     */
   retry:
-    size_t total_items = 0, kernelbuffertoallocate = 0;
+    size_t kernelbuffertoallocate = 0;
     while(_lock.exchange(1, std::memory_order_relaxed) != 0)
     {
       std::this_thread::yield();
     }
     auto unlock = make_scope_exit([this]() noexcept { _lock.store(0, std::memory_order_release); });
     (void) unlock;
+    if(req.kernelbuffer.empty())
     {
       char _buffer[65536];
       auto *buffer_ = (FILE_NAMES_INFORMATION *) _buffer;
@@ -345,12 +391,8 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
           done = (fni->NextEntryOffset == 0);
           kernelbuffertoallocate += sizeof(what_to_enumerate_type);
           kernelbuffertoallocate += (fni->FileNameLength + 7) & ~7;
-          ++total_items;
         }
       }
-    }
-    if(req.kernelbuffer.empty())
-    {
       if(!req.buffers._kernel_buffer || req.buffers._kernel_buffer_size < kernelbuffertoallocate)
       {
         auto *mem = (char *) operator new[](kernelbuffertoallocate, std::nothrow);  // don't initialise
@@ -363,31 +405,47 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
         req.buffers._kernel_buffer_size = kernelbuffertoallocate;
       }
     }
-    else if(req.kernelbuffer.size() < kernelbuffertoallocate)
+    ULONG bytes;
+    if(req.kernelbuffer.empty())
     {
-      return errc::no_buffer_space;  // user needs to supply a bigger buffer
+      buffer = req.buffers._kernel_buffer.get();
+      bytes = (ULONG) std::min(req.buffers._kernel_buffer_size, kernelbuffertoallocate);
+    }
+    else
+    {
+      buffer = req.kernelbuffer.data();
+      bytes = (ULONG) std::min(req.kernelbuffer.size(), (size_t) (ULONG) -1);
     }
-    ULONG max_bytes, bytes;
-    buffer = req.kernelbuffer.empty() ? reinterpret_cast<what_to_enumerate_type *>(req.buffers._kernel_buffer.get()) : reinterpret_cast<what_to_enumerate_type *>(req.kernelbuffer.data());
-    max_bytes = req.kernelbuffer.empty() ? static_cast<ULONG>(req.buffers._kernel_buffer_size) : static_cast<ULONG>(req.kernelbuffer.size());
-    bytes = std::min(max_bytes, (ULONG) kernelbuffertoallocate);
     IO_STATUS_BLOCK isb = make_iostatus();
-    NTSTATUS ntstat = NtQueryDirectoryFile(_v.h, nullptr, nullptr, nullptr, &isb, buffer, bytes, what_to_enumerate, FALSE, req.glob.empty() ? nullptr : &_glob, TRUE);
+    NTSTATUS ntstat = NtQueryDirectoryFile(_v.h, nullptr, nullptr, nullptr, &isb, buffer, bytes, use_fallback ? fallback_what_to_enumerate : what_to_enumerate, FALSE, req.glob.empty() ? nullptr : &_glob, TRUE);
     if(STATUS_PENDING == ntstat)
     {
       ntstat = ntwait(_v.h, isb, deadline());
     }
+    if(!use_fallback && (ntstat == (NTSTATUS) 0xC0000003 /*STATUS_INVALID_INFO_CLASS*/ || ntstat == (NTSTATUS) 0xC00000BB /*STATUS_NOT_SUPPORTED*/ || ntstat == (NTSTATUS) 0xC000000D /*STATUS_INVALID_PARAMETER*/))
+    {
+      use_fallback = true;
+      isb = make_iostatus();
+      ntstat = NtQueryDirectoryFile(_v.h, nullptr, nullptr, nullptr, &isb, buffer, bytes, fallback_what_to_enumerate, FALSE, req.glob.empty() ? nullptr : &_glob, TRUE);
+      if(STATUS_PENDING == ntstat)
+      {
+        ntstat = ntwait(_v.h, isb, deadline());
+      }
+    }
     if(ntstat < 0)
     {
       return ntkernel_error(ntstat);
     }
     {
       alignas(8) char _buffer[4096];
-      auto *buffer_ = (what_to_enumerate_type *) _buffer;
       isb = make_iostatus();
-      ntstat = NtQueryDirectoryFile(_v.h, nullptr, nullptr, nullptr, &isb, buffer_, sizeof(_buffer), what_to_enumerate, TRUE, req.glob.empty() ? nullptr : &_glob, FALSE);
+      ntstat = NtQueryDirectoryFile(_v.h, nullptr, nullptr, nullptr, &isb, _buffer, sizeof(_buffer), use_fallback ? fallback_what_to_enumerate : what_to_enumerate, TRUE, req.glob.empty() ? nullptr : &_glob, FALSE);
       if(ntstat != 0x80000006 /*STATUS_NO_MORE_FILES*/)
       {
+        if(!req.kernelbuffer.empty())
+        {
+          return errc::no_buffer_space;  // user needs to supply a bigger buffer
+        }
         // The directory grew between first enumeration and second
         LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
         goto retry;
@@ -396,63 +454,90 @@ result<directory_handle::buffers_type> directory_handle::read(io_request<buffers
   }
 
   size_t n = 0;
-  bool done = false;
-  for(what_to_enumerate_type *ffdi = buffer; !done; ffdi = reinterpret_cast<what_to_enumerate_type *>(reinterpret_cast<uintptr_t>(ffdi) + ffdi->NextEntryOffset))
-  {
-    size_t length = ffdi->FileNameLength / sizeof(wchar_t);
-    done = (ffdi->NextEntryOffset == 0);
-    if(length <= 2 && '.' == ffdi->FileName[0])
+  // Returns true if the fill is complete
+  auto fill = [&](auto *first) -> bool {
+    using info_type = std::remove_pointer_t<decltype(first)>;
+    bool done = false;
+    for(info_type *ffdi = first; !done; ffdi = reinterpret_cast<info_type *>(reinterpret_cast<uintptr_t>(ffdi) + ffdi->NextEntryOffset))
     {
-      if(1 == length || '.' == ffdi->FileName[1])
+      size_t length = ffdi->FileNameLength / sizeof(wchar_t);
+      done = (ffdi->NextEntryOffset == 0);
+      if(length <= 2 && '.' == ffdi->FileName[0])
+      {
+        if(1 == length || '.' == ffdi->FileName[1])
+        {
+          continue;
+        }
+      }
+      directory_entry &item = req.buffers[n];
+      // Try to zero terminate leafnames where possible for later efficiency
+      if(reinterpret_cast<uintptr_t>(ffdi->FileName + length) + sizeof(wchar_t) <= reinterpret_cast<uintptr_t>(ffdi) + ffdi->NextEntryOffset)
+      {
+        ffdi->FileName[length] = 0;
+        item.leafname = path_view_type(ffdi->FileName, length, true);
+      }
+      else
+      {
+        item.leafname = path_view_type(ffdi->FileName, length, false);
+      }
+      if(req.filtering == filter::fastdeleted && item.leafname.is_llfio_deleted())
       {
         continue;
       }
+      item.stat = stat_t(nullptr);
+      detail::fill_stat_from_directory_information(item.stat, ffdi);
+      item.stat.st_atim = to_timepoint(ffdi->LastAccessTime);
+      item.stat.st_mtim = to_timepoint(ffdi->LastWriteTime);
+      item.stat.st_ctim = to_timepoint(ffdi->ChangeTime);
+      item.stat.st_size = ffdi->EndOfFile.QuadPart;
+      item.stat.st_allocated = ffdi->AllocationSize.QuadPart;
+      item.stat.st_birthtim = to_timepoint(ffdi->CreationTime);
+      item.stat.st_sparse = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) != 0u);
+      item.stat.st_compressed = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_COMPRESSED) != 0u);
+      item.stat.st_reparse_point = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0u);
+      if(stat_contents & stat_t::want::blocks)
+      {
+        item.stat.st_blocks = item.stat.st_allocated / volume.st_blksize;
+        item.stat.st_blksize = volume.st_blksize;
+      }
+      if(stat_contents & stat_t::want::dev)
+      {
+        item.stat.st_dev = volume.st_dev;
+      }
+      n++;
+      if(!done && n >= req.buffers.size())
+      {
+        return false;
+      }
     }
-    directory_entry &item = req.buffers[n];
-    // Try to zero terminate leafnames where possible for later efficiency
-    if(reinterpret_cast<uintptr_t>(ffdi->FileName + length) + sizeof(wchar_t) <= reinterpret_cast<uintptr_t>(ffdi) + ffdi->NextEntryOffset)
-    {
-      ffdi->FileName[length] = 0;
-      item.leafname = path_view_type(ffdi->FileName, length, true);
-    }
-    else
-    {
-      item.leafname = path_view_type(ffdi->FileName, length, false);
-    }
-    if(req.filtering == filter::fastdeleted && item.leafname.is_llfio_deleted())
-    {
-      continue;
-    }
-    item.stat = stat_t(nullptr);
-#ifndef LLFIO_DIRECTORY_HANDLE_ENUMERATE_LESS_INFO
-    item.stat.st_ino = ffdi->FileId.QuadPart;
-    item.stat.st_type = to_st_type(ffdi->FileAttributes, ffdi->ReparsePointTag);
-#else
-    item.stat.st_type = to_st_type(ffdi->FileAttributes, IO_REPARSE_TAG_SYMLINK /* not accurate, but best we can do */);
-#endif
-    item.stat.st_atim = to_timepoint(ffdi->LastAccessTime);
-    item.stat.st_mtim = to_timepoint(ffdi->LastWriteTime);
-    item.stat.st_ctim = to_timepoint(ffdi->ChangeTime);
-    item.stat.st_size = ffdi->EndOfFile.QuadPart;
-    item.stat.st_allocated = ffdi->AllocationSize.QuadPart;
-    item.stat.st_birthtim = to_timepoint(ffdi->CreationTime);
-    item.stat.st_sparse = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) != 0u);
-    item.stat.st_compressed = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_COMPRESSED) != 0u);
-    item.stat.st_reparse_point = static_cast<unsigned int>((ffdi->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0u);
-    n++;
-    if(!done && n >= req.buffers.size())
-    {
-      // Fill is incomplete
-      req.buffers._metadata = default_stat_contents;
-      req.buffers._done = false;
-      return std::move(req.buffers);
-    }
+    return true;
+  };
+  const bool complete = use_fallback ? fill(static_cast<fallback_what_to_enumerate_type *>(buffer)) : fill(static_cast<what_to_enumerate_type *>(buffer));
+  if(complete)
+  {
+    req.buffers._resize(n);
   }
-  // Fill is complete
-  req.buffers._resize(n);
-  req.buffers._metadata = default_stat_contents;
-  req.buffers._done = true;
+  req.buffers._metadata = stat_contents;
+  req.buffers._done = complete;
   return std::move(req.buffers);
 }
 
+// Enumeration on Windows is filtered kernel side, and there is not yet a cache of enumerations
+bool directory_handle::set_enumeration_cache_enabled(bool enabled) noexcept
+{
+  (void) enabled;
+  return false;
+}
+
+void directory_handle::set_enumeration_cache_limits(size_t max_bytes) noexcept
+{
+  (void) max_bytes;
+}
+
+directory_handle::enumeration_cache_statistics directory_handle::trim_enumeration_cache(std::chrono::steady_clock::time_point older_than) noexcept
+{
+  (void) older_than;
+  return {};
+}
+
 LLFIO_V2_NAMESPACE_END
@@ -0,0 +1,113 @@
+/* Follows a file being appended to by a third party (Windows)
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../../file_follower.hpp"
+#include "import.hpp"
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+result<file_follower> file_follower::follow(mapped_file_handle &mfh, extent_type offset) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&mfh);
+  try
+  {
+    result<file_follower> ret(in_place_type<file_follower>);
+    auto &f = ret.assume_value();
+    f._mfh = &mfh;
+    f._offset = offset;
+    OUTCOME_TRY(auto &&path, mfh.current_path());
+    if(path.empty())
+    {
+      return errc::no_such_file_or_directory;  // unlinked
+    }
+    // current_path() returns \!!\Device\..., which Win32 accepts as \\?\GLOBALROOT\Device\...
+    filesystem::path::string_type dir = path.parent_path().native();
+    if(0 == dir.compare(0, 3, L"\\!!"))
+    {
+      dir.replace(0, 3, L"\\\\?\\GLOBALROOT");
+    }
+    f._change = FindFirstChangeNotificationW(dir.c_str(), FALSE, FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE);
+    if(f._change == INVALID_HANDLE_VALUE)
+    {
+      f._change = nullptr;
+      return win32_error();
+    }
+    return ret;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+result<void> file_follower::_wait(deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(_mfh);
+  DWORD ms = INFINITE;
+  if(d)
+  {
+    auto ns = d.steady ? std::chrono::nanoseconds(d.nsecs) : std::chrono::duration_cast<std::chrono::nanoseconds>(d.to_time_point() - std::chrono::system_clock::now());
+    ms = (ns.count() <= 0) ? 0 : (DWORD) (std::min)((ns.count() + 999999) / 1000000, (decltype(ns.count())) INFINITE - 1);
+  }
+  // NTFS may not report growth of a file open elsewhere until that handle is closed, so the
+  // length is always rechecked at least every 100 milliseconds
+  const bool capped = ms > 100;
+  switch(WaitForSingleObject(_change, capped ? 100 : ms))
+  {
+  case WAIT_OBJECT_0:
+    if(!FindNextChangeNotification(_change))
+    {
+      return win32_error();
+    }
+    return success();
+  case WAIT_TIMEOUT:
+    if(capped)
+    {
+      return success();
+    }
+    return errc::timed_out;
+  default:
+    return win32_error();
+  }
+}
+
+result<void> file_follower::close() noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(_mfh);
+  _mfh = nullptr;
+  _offset = 0;
+  if(_change != nullptr)
+  {
+    if(!FindCloseChangeNotification(_change))
+    {
+      _change = nullptr;
+      return win32_error();
+    }
+    _change = nullptr;
+  }
+  return success();
+}
+
+LLFIO_V2_NAMESPACE_END
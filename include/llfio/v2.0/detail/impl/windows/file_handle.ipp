@@ -23,6 +23,7 @@ Distributed under the Boost Software License, Version 1.0.
 */
 
 #include "../../../file_handle.hpp"
+#include "../file_handle.ipp"
 #include "import.hpp"
 
 LLFIO_V2_NAMESPACE_BEGIN
@@ -66,7 +67,7 @@ result<file_handle> file_handle::file(const path_handle &base, file_handle::path
     ntflags |= 0x040 /*FILE_NON_DIRECTORY_FILE*/;  // do not open a directory
     IO_STATUS_BLOCK isb = make_iostatus();
 
-    path_view::c_str<> zpath(path, true);
+    path_view::recycling_c_str<> zpath(path, true);
     UNICODE_STRING _path{};
     _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
     _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
@@ -134,7 +135,7 @@ result<file_handle> file_handle::file(const path_handle &base, file_handle::path
       creation = CREATE_ALWAYS;
       break;
     }
-    path_view::c_str<> zpath(path, false);
+    path_view::recycling_c_str<> zpath(path, false);
     if(INVALID_HANDLE_VALUE == (nativeh.h = CreateFileW_(zpath.buffer, access, fileshare, nullptr, creation, attribs, nullptr)))  // NOLINT
     {
       DWORD errcode = GetLastError();
@@ -402,6 +403,221 @@ result<std::vector<file_handle::extent_pair>> file_handle::extents() const noexc
   }
 }
 
+result<span<file_handle::extent_pair>> file_handle::extents(span<extent_pair> out, extent_pair range) const noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  LLFIO_LOG_FUNCTION_CALL(this);
+  static_assert(sizeof(file_handle::extent_pair) == sizeof(FILE_ALLOCATED_RANGE_BUFFER),
+                "FILE_ALLOCATED_RANGE_BUFFER is not equivalent to pair<extent_type, extent_type>!");
+  OUTCOME_TRY(auto &&size, file_handle::maximum_extent());
+  extent_type rangeend = (range.offset + range.length < range.offset) ? (extent_type) -1 : range.offset + range.length;
+  if(rangeend > size)
+  {
+    rangeend = size;
+  }
+  if(out.empty() || rangeend <= range.offset)
+  {
+    return out.subspan(0, 0);
+  }
+  FILE_ALLOCATED_RANGE_BUFFER farb{};
+  farb.FileOffset.QuadPart = range.offset;
+  farb.Length.QuadPart = rangeend - range.offset;
+  DWORD bytesout = 0;
+  OVERLAPPED ol{};
+  memset(&ol, 0, sizeof(ol));
+  ol.Internal = static_cast<ULONG_PTR>(-1);
+  // The ranges are written straight into the caller's buffer. If it is too small, the kernel
+  // fills what it can and fails with ERROR_MORE_DATA, which is fine as the caller continues later.
+  if(DeviceIoControl(_v.h, FSCTL_QUERY_ALLOCATED_RANGES, &farb, sizeof(farb), out.data(),
+                     static_cast<DWORD>((std::min)(out.size(), (size_t) 0x7fffffff / sizeof(FILE_ALLOCATED_RANGE_BUFFER)) * sizeof(FILE_ALLOCATED_RANGE_BUFFER)),
+                     &bytesout, &ol) == 0)
+  {
+    if(ERROR_INVALID_FUNCTION == GetLastError() || ERROR_NOT_SUPPORTED == GetLastError())
+    {
+      // This filing system doesn't support extents
+      out[0] = extent_pair(range.offset, rangeend - range.offset);
+      return out.subspan(0, 1);
+    }
+    if(ERROR_MORE_DATA != GetLastError() && ERROR_SUCCESS != GetLastError())
+    {
+      return win32_error();
+    }
+  }
+  auto ret = out.subspan(0, bytesout / sizeof(FILE_ALLOCATED_RANGE_BUFFER));
+  // Allocated ranges are reported whole, so clamp the first and last to the range
+  if(!ret.empty())
+  {
+    if(ret.front().offset < range.offset)
+    {
+      ret.front().length -= range.offset - ret.front().offset;
+      ret.front().offset = range.offset;
+    }
+    if(ret.back().offset + ret.back().length > rangeend)
+    {
+      ret.back().length = rangeend - ret.back().offset;
+    }
+  }
+  return ret;
+}
+
+result<file_handle::extent_pair> file_handle::allocate(file_handle::extent_pair extent, bool keep_size) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(extent.offset + extent.length < extent.offset)
+  {
+    return errc::value_too_large;
+  }
+  if(extent.length == 0)
+  {
+    return extent;
+  }
+  const extent_type end = extent.offset + extent.length;
+  FILE_STANDARD_INFO fsi{};
+  if(GetFileInformationByHandleEx(_v.h, FileStandardInfo, &fsi, sizeof(fsi)) == 0)
+  {
+    return win32_error();
+  }
+  // Setting an allocation less than the maximum extent truncates the file, so only ever grow it
+  if((extent_type) fsi.AllocationSize.QuadPart < end)
+  {
+    FILE_ALLOCATION_INFO fai{};
+    fai.AllocationSize.QuadPart = end;
+    if(SetFileInformationByHandle(_v.h, FileAllocationInfo, &fai, sizeof(fai)) == 0)
+    {
+      if(ERROR_INVALID_PARAMETER == GetLastError() || ERROR_NOT_SUPPORTED == GetLastError())
+      {
+        return errc::operation_not_supported;
+      }
+      return win32_error();
+    }
+  }
+  if(!keep_size && (extent_type) fsi.EndOfFile.QuadPart < end)
+  {
+    FILE_END_OF_FILE_INFO feofi{};
+    feofi.EndOfFile.QuadPart = end;
+    if(SetFileInformationByHandle(_v.h, FileEndOfFileInfo, &feofi, sizeof(feofi)) == 0)
+    {
+      return win32_error();
+    }
+  }
+  if(are_safety_barriers_issued())
+  {
+    FlushFileBuffers(_v.h);
+  }
+  return extent;
+}
+
+result<file_handle::extent_type> file_handle::extend_valid_data(file_handle::extent_type newsize) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  FILE_STANDARD_INFO fsi{};
+  if(GetFileInformationByHandleEx(_v.h, FileStandardInfo, &fsi, sizeof(fsi)) == 0)
+  {
+    return win32_error();
+  }
+  if(newsize <= (extent_type) fsi.EndOfFile.QuadPart)
+  {
+    return file_handle::truncate(newsize);
+  }
+  static int obtained_privilege;
+  if(0 == obtained_privilege)
+  {
+    // Attempt to enable SeManageVolumePrivilege
+    obtained_privilege = 2;
+    HANDLE token;
+    if(OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token))
+    {
+      TOKEN_PRIVILEGES privs;
+      memset(&privs, 0, sizeof(privs));
+      privs.PrivilegeCount = 1;
+      if(LookupPrivilegeValueW(NULL, L"SeManageVolumePrivilege", &privs.Privileges[0].Luid))
+      {
+        privs.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if(AdjustTokenPrivileges(token, FALSE, &privs, 0, NULL, NULL) && GetLastError() == S_OK)
+        {
+          obtained_privilege = 1;
+        }
+      }
+      CloseHandle(token);
+    }
+  }
+  if(1 != obtained_privilege)
+  {
+    return errc::operation_not_permitted;
+  }
+  // SetFileValidData() requires the storage to be allocated and within the maximum extent
+  if((extent_type) fsi.AllocationSize.QuadPart < newsize)
+  {
+    FILE_ALLOCATION_INFO fai{};
+    fai.AllocationSize.QuadPart = newsize;
+    if(SetFileInformationByHandle(_v.h, FileAllocationInfo, &fai, sizeof(fai)) == 0)
+    {
+      if(ERROR_INVALID_PARAMETER == GetLastError() || ERROR_NOT_SUPPORTED == GetLastError())
+      {
+        return errc::operation_not_supported;
+      }
+      return win32_error();
+    }
+  }
+  FILE_END_OF_FILE_INFO feofi{};
+  feofi.EndOfFile.QuadPart = newsize;
+  if(SetFileInformationByHandle(_v.h, FileEndOfFileInfo, &feofi, sizeof(feofi)) == 0)
+  {
+    return win32_error();
+  }
+  if(SetFileValidData(_v.h, (LONGLONG) newsize) == 0)
+  {
+    const DWORD errcode = GetLastError();
+    // Put back the maximum extent, rather than leave an extension which will be zero filled
+    feofi.EndOfFile = fsi.EndOfFile;
+    (void) SetFileInformationByHandle(_v.h, FileEndOfFileInfo, &feofi, sizeof(feofi));
+    if(ERROR_INVALID_PARAMETER == errcode || ERROR_NOT_SUPPORTED == errcode)
+    {
+      // Sparse, compressed and encrypted files, and filing systems other than NTFS
+      return errc::operation_not_supported;
+    }
+    return win32_error(errcode);
+  }
+  if(are_safety_barriers_issued())
+  {
+    FlushFileBuffers(_v.h);
+  }
+  return newsize;
+}
+
+result<file_handle::extent_pair> file_handle::advise(file_handle::extent_pair extent, file_handle::access_pattern /*unused*/) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  // Windows has no per-region equivalent to posix_fadvise() for non-mapped i/o
+  return extent;
+}
+
+result<file_handle::extent_pair> file_handle::evict_cache(file_handle::extent_pair /*unused*/) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  // Only a writable handle can flush, and a read only handle cannot have dirtied anything
+  if(is_writable() && FlushFileBuffers(_v.h) == 0)
+  {
+    return win32_error();
+  }
+  // Opening a non-cached handle purges the cache for the file, if no section of it is mapped
+  HANDLE h = ReOpenFile(_v.h, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, FILE_FLAG_NO_BUFFERING);
+  if(h == INVALID_HANDLE_VALUE)
+  {
+    return win32_error();
+  }
+  CloseHandle(h);
+  return extent_pair(0, (extent_type) -1);
+}
+
+result<file_handle::atomic_write_limits_type> file_handle::atomic_write_limits() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  // NT has no means of issuing a write which is guaranteed to never tear
+  return atomic_write_limits_type();
+}
+
 result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::extent_pair extent, io_handle &dest_, io_handle::extent_type destoffset, deadline d,
                                                                bool force_copy_now, bool emulate_if_unsupported) noexcept
 {
@@ -616,6 +832,9 @@ result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::exte
       }
     }
     bool duplicate_extents = !force_copy_now, zero_extents = true, buffer_dirty = true;
+    // Copying within the same file in parallel could overwrite source not yet copied
+    const bool parallel_copy = !(flags() & flag::disable_parallelism) && dest.unique_id() != unique_id();
+    extent_type thisblock = 0;
     bool truncate_back_on_failure = false;
     if(dest_length < destoffset + extent.length)
     {
@@ -628,6 +847,145 @@ result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::exte
         (void) dest.truncate(dest_length);
       }
     });
+    typedef struct _DUPLICATE_EXTENTS_DATA
+    {
+      HANDLE FileHandle;
+      LARGE_INTEGER SourceFileOffset;
+      LARGE_INTEGER TargetFileOffset;
+      LARGE_INTEGER ByteCount;
+    } DUPLICATE_EXTENTS_DATA, *PDUPLICATE_EXTENTS_DATA;
+    /* ReFS duplicates less than 4Gb per call, in whole clusters except at the end of the file, and
+    each call takes a while, so between different files several whole cluster chunks are kept in
+    flight at once.
+    */
+    extent_type clonechunk = blocksize;
+    size_t clonedepth = 1;
+    if(duplicate_extents && parallel_copy)
+    {
+      FILE_FS_SIZE_INFORMATION ffssi{};
+      IO_STATUS_BLOCK isb = make_iostatus();
+      NTSTATUS ntstat = NtQueryVolumeInformationFile(dest.native_handle().h, &isb, &ffssi, sizeof(ffssi), FileFsSizeInformation);
+      if(STATUS_PENDING == ntstat)
+      {
+        ntstat = ntwait(dest.native_handle().h, isb, deadline());
+      }
+      const extent_type clustersize = (extent_type) ffssi.SectorsPerAllocationUnit * ffssi.BytesPerSector;
+      if(ntstat >= 0 && clustersize > 0)
+      {
+        clonechunk = (((extent_type) 1 << 32) - 1) / clustersize * clustersize;
+        clonedepth = 8;
+      }
+    }
+    // Duplicates the extents of a clone item. Chunks refused are copied instead if emulation is permitted.
+    auto duplicate_item_extents = [&](const workitem &item) -> result<void> {
+      if(item.src.length == 0)
+      {
+        return success();
+      }
+      struct clone_op
+      {
+        OVERLAPPED ol;
+        HANDLE event{nullptr};
+        extent_pair src{0, 0};  // zero length if not in flight
+      };
+      std::vector<clone_op> ops(static_cast<size_t>(std::min<extent_type>(clonedepth, (item.src.length + clonechunk - 1) / clonechunk)));
+      auto closeevents = make_scope_exit([&]() noexcept {
+        for(auto &op : ops)
+        {
+          if(op.event != nullptr)
+          {
+            if(op.src.length > 0)
+            {
+              (void) ntwait(op.event, op.ol, deadline());
+            }
+            CloseHandle(op.event);
+          }
+        }
+      });
+      for(auto &op : ops)
+      {
+        op.event = CreateEventW(nullptr, true, false, nullptr);
+        if(op.event == nullptr)
+        {
+          return win32_error();
+        }
+      }
+      result<void> failure = success();
+      std::vector<extent_pair> refused;
+      auto refuse = [&](extent_pair src, auto &&error) {
+        if(!emulate_if_unsupported)
+        {
+          if(failure)
+          {
+            failure = std::move(error);
+          }
+          return;
+        }
+        duplicate_extents = false;  // emulate using copy of bytes
+        refused.push_back(src);
+      };
+      extent_type issued = 0;
+      for(size_t next = 0;; next = (next + 1) % ops.size())
+      {
+        clone_op &op = ops[next];
+        if(op.src.length > 0)
+        {
+          NTSTATUS ntstat = ntwait(op.event, op.ol, deadline());
+          const auto src = op.src;
+          op.src.length = 0;
+          if(ntstat < 0)
+          {
+            refuse(src, ntkernel_error(ntstat));
+          }
+        }
+        if(!failure || !duplicate_extents || issued == item.src.length)
+        {
+          if(std::none_of(ops.begin(), ops.end(), [](const clone_op &o) { return o.src.length > 0; }))
+          {
+            break;
+          }
+          continue;
+        }
+        op.src = {item.src.offset + issued, std::min(clonechunk, item.src.length - issued)};
+        issued += op.src.length;
+        DUPLICATE_EXTENTS_DATA ded;
+        memset(&ded, 0, sizeof(ded));
+        ded.FileHandle = _v.h;
+        ded.SourceFileOffset.QuadPart = op.src.offset;
+        ded.TargetFileOffset.QuadPart = op.src.offset + destoffsetdiff;
+        ded.ByteCount.QuadPart = op.src.length;
+        memset(&op.ol, 0, sizeof(op.ol));
+        // Setting the low bit stops the completion being posted to any i/o completion port of the handle
+        op.ol.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(op.event) | 1);
+        DWORD bytesout = 0;
+        if(DeviceIoControl(dest.native_handle().h, CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_DATA) /*FSCTL_DUPLICATE_EXTENTS*/, &ded,
+                           sizeof(ded), nullptr, 0, &bytesout, &op.ol) == 0)
+        {
+          const DWORD errcode = GetLastError();
+          if(ERROR_IO_PENDING != errcode)
+          {
+            const auto src = op.src;
+            op.src.length = 0;
+            refuse(src, win32_error(errcode));
+          }
+        }
+        else
+        {
+          op.src.length = 0;
+        }
+      }
+      OUTCOME_TRYV(failure);
+      if(issued < item.src.length)
+      {
+        refused.push_back({item.src.offset + issued, item.src.length - issued});
+      }
+      for(const auto &src : refused)
+      {
+        OUTCOME_TRYV(detail::file_handle_copy_bytes(*this, dest, src.offset, src.length, destoffsetdiff, item.destination_extents_are_new, parallel_copy, d));
+        buffer_dirty = true;
+      }
+      return success();
+    };
 #if 0
     for(const workitem &item : todo)
     {
@@ -656,114 +1014,26 @@ result<file_handle::extent_pair> file_handle::clone_extents_to(file_handle::exte
 #endif
     for(const workitem &item : todo)
     {
-      for(extent_type thisoffset = 0; thisoffset < item.src.length; thisoffset += blocksize)
+      if(duplicate_extents && item.op == workitem::clone_extents)
+      {
+        OUTCOME_TRYV(duplicate_item_extents(item));
+        dest_length = destoffset + extent.length;
+        truncate_back_on_failure = false;
+        LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+        ret.length += item.src.length;
+        continue;
+      }
+      for(extent_type thisoffset = 0; thisoffset < item.src.length; thisoffset += thisblock)
       {
         bool done = false;
-        const auto thisblock = std::min(blocksize, item.src.length - thisoffset);
-        if(duplicate_extents && item.op == workitem::clone_extents)
+        thisblock = std::min(blocksize, item.src.length - thisoffset);
+        if(item.op == workitem::copy_bytes || item.op == workitem::clone_extents)
         {
-          typedef struct _DUPLICATE_EXTENTS_DATA
-          {
-            HANDLE FileHandle;
-            LARGE_INTEGER SourceFileOffset;
-            LARGE_INTEGER TargetFileOffset;
-            LARGE_INTEGER ByteCount;
-          } DUPLICATE_EXTENTS_DATA, *PDUPLICATE_EXTENTS_DATA;
-          DUPLICATE_EXTENTS_DATA ded;
-          memset(&ded, 0, sizeof(ded));
-          ded.FileHandle = _v.h;
-          ded.SourceFileOffset.QuadPart = item.src.offset + thisoffset;
-          ded.TargetFileOffset.QuadPart = item.src.offset + thisoffset + destoffsetdiff;
-          ded.ByteCount.QuadPart = thisblock;
-          DWORD bytesout = 0;
-          OVERLAPPED ol{};
-          memset(&ol, 0, sizeof(ol));
-          ol.Internal = static_cast<ULONG_PTR>(-1);
-          if(DeviceIoControl(dest.native_handle().h, CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_DATA) /*FSCTL_DUPLICATE_EXTENTS*/, &ded,
-                             sizeof(ded), nullptr, 0, &bytesout, &ol) == 0)
-          {
-            DWORD errcode = GetLastError();
-            if(ERROR_IO_PENDING == errcode)
-            {
-              NTSTATUS ntstat = ntwait(dest.native_handle().h, ol, deadline());
-              if(ntstat != 0)
-              {
-                return ntkernel_error(ntstat);
-              }
-            }
-            if(ERROR_SUCCESS != errcode && !emulate_if_unsupported)
-            {
-              return win32_error(errcode);
-            }
-            duplicate_extents = false;  // emulate using copy of bytes
-          }
-          else
-          {
-            done = true;
-          }
-        }
-        if(!done && (item.op == workitem::copy_bytes || (!duplicate_extents && item.op == workitem::clone_extents)))
-        {
-          if(buffer == nullptr)
-          {
-            buffer = utils::page_allocator<byte>().allocate(blocksize);
-          }
-          deadline nd;
-          buffer_type b(buffer, thisblock);
-          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
-          OUTCOME_TRY(auto readed, read({{&b, 1}, item.src.offset + thisoffset}, nd));
+          // Copy the remainder of this item in one go, so it can be parallelised
+          thisblock = item.src.length - thisoffset;
+          OUTCOME_TRY(detail::file_handle_copy_bytes(*this, dest, item.src.offset + thisoffset, thisblock, destoffsetdiff, item.destination_extents_are_new,
+                                                      parallel_copy, d));
           buffer_dirty = true;
-          if(readed.front().size() != thisblock)
-          {
-            return errc::resource_unavailable_try_again;  // something is wrong
-          }
-          LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
-          const_buffer_type cb(readed.front());
-          if(item.destination_extents_are_new)
-          {
-            // If we don't need to reset the bytes in the destination, try to elide
-            // regions of zero bytes before writing to save on extents newly allocated
-            const char *ds = (const char *) readed.front().data(), *e = (const char *) readed.front().data() + readed.front().size(), *zs, *ze;
-            while(ds < e)
-            {
-              // Take zs to end of non-zero data
-              for(zs = ds; zs < e && *zs != 0; ++zs)
-              {
-              }
-            zero_block_too_small:
-              // Take ze to end of zero data
-              for(ze = zs; ze < e && *ze == 0; ++ze)
-              {
-              }
-              if(ze - zs < 1024 && ze < e)
-              {
-                zs = ze + 1;
-                goto zero_block_too_small;
-              }
-              if(zs != ds)
-              {
-                // Write portion from ds to zs
-                cb = {(const byte *) ds, (size_t)(zs - ds)};
-                auto localoffset = cb.data() - readed.front().data();
-                // std::cout << "*** " << (item.src.offset + thisoffset + localoffset) << " - " << cb.size() << std::endl;
-                OUTCOME_TRY(auto written, dest.write({{&cb, 1}, item.src.offset + thisoffset + localoffset + destoffsetdiff}, nd));
-                if(written.front().size() != (size_t)(zs - ds))
-                {
-                  return errc::resource_unavailable_try_again;  // something is wrong
-                }
-              }
-              ds = ze;
-            }
-          }
-          else
-          {
-            // Straight write
-            OUTCOME_TRY(auto written, dest.write({{&cb, 1}, item.src.offset + thisoffset + destoffsetdiff}, nd));
-            if(written.front().size() != thisblock)
-            {
-              return errc::resource_unavailable_try_again;  // something is wrong
-            }
-          }
           done = true;
         }
         if(!done && !item.destination_extents_are_new && (zero_extents && item.op == workitem::delete_extents))
@@ -866,4 +1136,13 @@ result<file_handle::extent_type> file_handle::zero(file_handle::extent_pair exte
   return success();
 }
 
+result<file_handle::extent_type> file_handle::zone_append(const_buffers_type buffers, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  // NT cannot report where an append to the end of file was placed, and has no zoned storage for applications
+  (void) buffers;
+  (void) d;
+  return errc::operation_not_supported;
+}
+
 LLFIO_V2_NAMESPACE_END
@@ -83,7 +83,7 @@ result<path_handle> fs_handle::parent_path_handle(deadline d) const noexcept
 
       DWORD fileshare = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
       IO_STATUS_BLOCK isb = make_iostatus();
-      path_view::c_str<> zpath(filename, true);
+      path_view::recycling_c_str<> zpath(filename, true);
       UNICODE_STRING _path{};
       _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
       _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
@@ -139,7 +139,7 @@ result<void> fs_handle::relink(const path_handle &base, path_view_type path, boo
   // If the target is a win32 path, we need to convert to NT path and call ourselves
   if(!base.is_valid() && !path.is_ntpath())
   {
-    path_view::c_str<> zpath(path, false);
+    path_view::recycling_c_str<> zpath(path, false);
     UNICODE_STRING NtPath{};
     if(RtlDosPathNameToNtPathName_U(zpath.buffer, &NtPath, nullptr, nullptr) == 0u)
     {
@@ -188,7 +188,7 @@ result<void> fs_handle::relink(const path_handle &base, path_view_type path, boo
     duph = h.native_handle().h;
   }
 
-  path_view::c_str<> zpath(path, true);
+  path_view::recycling_c_str<> zpath(path, true);
   UNICODE_STRING _path{};
   _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
   _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
@@ -227,7 +227,7 @@ result<void> fs_handle::link(const path_handle &base, path_view_type path, deadl
   // If the target is a win32 path, we need to convert to NT path and call ourselves
   if(!base.is_valid() && !path.is_ntpath())
   {
-    path_view::c_str<> zpath(path, false);
+    path_view::recycling_c_str<> zpath(path, false);
     UNICODE_STRING NtPath{};
     if(RtlDosPathNameToNtPathName_U(zpath.buffer, &NtPath, nullptr, nullptr) == 0u)
     {
@@ -245,7 +245,7 @@ result<void> fs_handle::link(const path_handle &base, path_view_type path, deadl
 
   HANDLE duph = h.native_handle().h;
 
-  path_view::c_str<> zpath(path, true);
+  path_view::recycling_c_str<> zpath(path, true);
   UNICODE_STRING _path{};
   _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
   _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
@@ -391,4 +391,177 @@ result<void> fs_handle::unlink(deadline d) noexcept
   return success();
 }
 
+namespace detail
+{
+  // Fills `out` with the extended attributes of `h` named in `names`, or all of them
+  inline result<void> read_extended_attributes(HANDLE h, fs_handle::extended_attributes &out, span<const string_view> names) noexcept
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    try
+    {
+      out.clear();
+      // NTFS limits the extended attributes of an inode to 64Kb in total
+      static thread_local std::vector<byte> request, reply(65536 + 4096);
+      request.clear();
+      for(size_t n = 0, last = 0; n < names.size(); n++)
+      {
+        const auto &name = names[n];
+        if(name.size() > 254)
+        {
+          return errc::invalid_argument;
+        }
+        const size_t entry = (offsetof(FILE_GET_EA_INFORMATION, EaName) + name.size() + 1 + 3) & ~(size_t) 3;
+        last = request.size();
+        request.resize(last + entry);
+        auto *i = reinterpret_cast<FILE_GET_EA_INFORMATION *>(request.data() + last);
+        i->NextEntryOffset = (n + 1 < names.size()) ? (ULONG) entry : 0;
+        i->EaNameLength = (UCHAR) name.size();
+        memcpy(i->EaName, name.data(), name.size());
+        i->EaName[name.size()] = 0;
+      }
+      for(;;)
+      {
+        IO_STATUS_BLOCK isb = make_iostatus();
+        NTSTATUS ntstat = NtQueryEaFile(h, &isb, reply.data(), (ULONG) reply.size(), false, request.empty() ? nullptr : request.data(), (ULONG) request.size(), nullptr, true);
+        if(STATUS_PENDING == ntstat)
+        {
+          ntstat = ntwait(h, isb, deadline());
+        }
+        if((NTSTATUS) 0xC0000052 /*STATUS_NO_EAS_ON_FILE*/ == ntstat)
+        {
+          out._publish();
+          return success();
+        }
+        if((NTSTATUS) 0x80000005 /*STATUS_BUFFER_OVERFLOW*/ == ntstat || (NTSTATUS) 0xC0000023 /*STATUS_BUFFER_TOO_SMALL*/ == ntstat)
+        {
+          reply.resize(reply.size() * 2);
+          continue;
+        }
+        if(ntstat < 0)
+        {
+          return ntkernel_error(ntstat);
+        }
+        break;
+      }
+      for(size_t offset = 0;;)
+      {
+        const auto *i = reinterpret_cast<const FILE_FULL_EA_INFORMATION *>(reply.data() + offset);
+        // Named attributes not present are returned with an empty value
+        if(i->EaValueLength > 0)
+        {
+          byte *dest = out._append(string_view(i->EaName, i->EaNameLength), i->EaValueLength);
+          memcpy(dest, i->EaName + i->EaNameLength + 1, i->EaValueLength);
+        }
+        if(i->NextEntryOffset == 0)
+        {
+          break;
+        }
+        offset += i->NextEntryOffset;
+      }
+      out._publish();
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  // Sets the extended attribute `name` of `h` to `value`, removing it if `value` is empty
+  inline result<void> write_extended_attribute(HANDLE h, string_view name, span<const byte> value) noexcept
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    if(name.size() > 254 || value.size() > 65535)
+    {
+      return errc::invalid_argument;
+    }
+    try
+    {
+      static thread_local std::vector<byte> request;
+      request.resize(offsetof(FILE_FULL_EA_INFORMATION, EaName) + name.size() + 1 + value.size());
+      auto *i = reinterpret_cast<FILE_FULL_EA_INFORMATION *>(request.data());
+      i->NextEntryOffset = 0;
+      i->Flags = 0;
+      i->EaNameLength = (UCHAR) name.size();
+      i->EaValueLength = (USHORT) value.size();
+      memcpy(i->EaName, name.data(), name.size());
+      i->EaName[name.size()] = 0;
+      if(!value.empty())
+      {
+        memcpy(i->EaName + name.size() + 1, value.data(), value.size());
+      }
+      IO_STATUS_BLOCK isb = make_iostatus();
+      NTSTATUS ntstat = NtSetEaFile(h, &isb, request.data(), (ULONG) request.size());
+      if(STATUS_PENDING == ntstat)
+      {
+        ntstat = ntwait(h, isb, deadline());
+      }
+      if(ntstat < 0)
+      {
+        return ntkernel_error(ntstat);
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+}  // namespace detail
+
+result<void> fs_handle::read_extended_attributes(extended_attributes &out, span<const string_view> names) const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::read_extended_attributes(_get_handle().native_handle().h, out, names);
+}
+
+result<void> fs_handle::read_extended_attributes(const path_handle &base, path_view_type leafname, extended_attributes &out, span<const string_view> names) noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  path_view::recycling_c_str<> zpath(leafname, true);
+  UNICODE_STRING _path{};
+  _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
+  _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
+  OBJECT_ATTRIBUTES oa{};
+  memset(&oa, 0, sizeof(oa));
+  oa.Length = sizeof(OBJECT_ATTRIBUTES);
+  oa.ObjectName = &_path;
+  oa.RootDirectory = base.is_valid() ? base.native_handle().h : nullptr;
+  oa.Attributes = 0;  // 0x40 /*OBJ_CASE_INSENSITIVE*/;
+  IO_STATUS_BLOCK isb = make_iostatus();
+  HANDLE h = INVALID_HANDLE_VALUE;
+  NTSTATUS ntstat = NtOpenFile(&h, SYNCHRONIZE | FILE_READ_EA, &oa, &isb, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/ | 0x00200000 /*FILE_OPEN_REPARSE_POINT*/);
+  if(STATUS_PENDING == ntstat)
+  {
+    ntstat = ntwait(h, isb, deadline());
+  }
+  if(ntstat < 0)
+  {
+    return ntkernel_error(ntstat);
+  }
+  auto unh = make_scope_exit([&h]() noexcept { CloseHandle(h); });
+  return detail::read_extended_attributes(h, out, names);
+}
+
+result<void> fs_handle::write_extended_attribute(string_view name, span<const byte> value) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(value.empty())
+  {
+    // An empty value would remove the attribute
+    return errc::invalid_argument;
+  }
+  return detail::write_extended_attribute(_get_handle().native_handle().h, name, value);
+}
+
+result<void> fs_handle::remove_extended_attribute(string_view name) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::write_extended_attribute(_get_handle().native_handle().h, name, {});
+}
+
 LLFIO_V2_NAMESPACE_END
@@ -128,4 +128,36 @@ result<void> handle::set_append_only(bool enable) noexcept
   return success();
 }
 
+namespace utils
+{
+  result<void> flush_modified_data(const handle &h) noexcept
+  {
+    // Looks like \\?\Volume{GUID}\path\to\file, and the volume itself is \\?\Volume{GUID}
+    alignas(8) wchar_t buffer[32769];
+    DWORD len = GetFinalPathNameByHandleW(h.native_handle().h, buffer, sizeof(buffer) / sizeof(*buffer), FILE_NAME_OPENED | VOLUME_NAME_GUID);
+    if((len == 0u) || len >= sizeof(buffer) / sizeof(*buffer))
+    {
+      return win32_error();
+    }
+    buffer[len] = 0;
+    wchar_t *end = wcschr(buffer, L'}');
+    if(end == nullptr)
+    {
+      return errc::illegal_byte_sequence;
+    }
+    end[1] = 0;
+    HANDLE volh = CreateFileW(buffer, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+    if(volh == INVALID_HANDLE_VALUE)
+    {
+      return win32_error();
+    }
+    auto unvolh = make_scope_exit([&volh]() noexcept { CloseHandle(volh); });
+    if(FlushFileBuffers(volh) == 0)
+    {
+      return win32_error();
+    }
+    return success();
+  }
+}  // namespace utils
+
 LLFIO_V2_NAMESPACE_END
@@ -262,6 +262,12 @@ namespace windows_nt_kernel
     SIZE_T NumberOfBytes;
   } WIN32_MEMORY_RANGE_ENTRY, *PWIN32_MEMORY_RANGE_ENTRY;
 
+  typedef struct _PSAPI_WORKING_SET_EX_INFORMATION  // NOLINT
+  {
+    PVOID VirtualAddress;
+    ULONG_PTR VirtualAttributes;  // bit 0 is whether the page is valid i.e. resident
+  } PSAPI_WORKING_SET_EX_INFORMATION, *PPSAPI_WORKING_SET_EX_INFORMATION;
+
   typedef enum _SECTION_INFORMATION_CLASS
   {
     SectionBasicInformation,
@@ -299,11 +305,11 @@ namespace windows_nt_kernel
 
   using NtReadFile_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _In_opt_ HANDLE Event, _In_opt_ PIO_APC_ROUTINE ApcRoutine, _In_opt_ PVOID ApcContext, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _Out_ PVOID Buffer, _In_ ULONG Length, _In_opt_ PLARGE_INTEGER ByteOffset, _In_opt_ PULONG Key);
 
-  using NtReadFileScatter_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _In_opt_ HANDLE Event, _In_opt_ PIO_APC_ROUTINE ApcRoutine, _In_opt_ PVOID ApcContext, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _In_ FILE_SEGMENT_ELEMENT SegmentArray, _In_ ULONG Length, _In_opt_ PLARGE_INTEGER ByteOffset, _In_opt_ PULONG Key);
+  using NtReadFileScatter_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _In_opt_ HANDLE Event, _In_opt_ PIO_APC_ROUTINE ApcRoutine, _In_opt_ PVOID ApcContext, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _In_ PFILE_SEGMENT_ELEMENT SegmentArray, _In_ ULONG Length, _In_opt_ PLARGE_INTEGER ByteOffset, _In_opt_ PULONG Key);
 
   using NtWriteFile_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _In_opt_ HANDLE Event, _In_opt_ PIO_APC_ROUTINE ApcRoutine, _In_opt_ PVOID ApcContext, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _In_ PVOID Buffer, _In_ ULONG Length, _In_opt_ PLARGE_INTEGER ByteOffset, _In_opt_ PULONG Key);
 
-  using NtWriteFileGather_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _In_opt_ HANDLE Event, _In_opt_ PIO_APC_ROUTINE ApcRoutine, _In_opt_ PVOID ApcContext, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _In_ FILE_SEGMENT_ELEMENT SegmentArray, _In_ ULONG Length, _In_opt_ PLARGE_INTEGER ByteOffset, _In_opt_ PULONG Key);
+  using NtWriteFileGather_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _In_opt_ HANDLE Event, _In_opt_ PIO_APC_ROUTINE ApcRoutine, _In_opt_ PVOID ApcContext, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _In_ PFILE_SEGMENT_ELEMENT SegmentArray, _In_ ULONG Length, _In_opt_ PLARGE_INTEGER ByteOffset, _In_opt_ PULONG Key);
 
   using NtDeleteFile_t = NTSTATUS(NTAPI *)(_In_ POBJECT_ATTRIBUTES ObjectAttributes);
 
@@ -324,6 +330,13 @@ namespace windows_nt_kernel
   // and http://msdn.microsoft.com/en-us/library/windows/hardware/ff567096(v=vs.85).aspx
   using NtSetInformationFile_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _In_ PVOID FileInformation, _In_ ULONG Length, _In_ FILE_INFORMATION_CLASS FileInformationClass);
 
+  // From https://learn.microsoft.com/en-us/windows-hardware/drivers/ddi/ntifs/nf-ntifs-zwqueryeafile
+  using NtQueryEaFile_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _Out_ PVOID Buffer, _In_ ULONG Length, _In_ BOOLEAN ReturnSingleEntry, _In_opt_ PVOID EaList, _In_ ULONG EaListLength, _In_opt_ PULONG EaIndex,
+                                            _In_ BOOLEAN RestartScan);
+
+  // From https://learn.microsoft.com/en-us/windows-hardware/drivers/ddi/ntifs/nf-ntifs-zwseteafile
+  using NtSetEaFile_t = NTSTATUS(NTAPI *)(_In_ HANDLE FileHandle, _Out_ PIO_STATUS_BLOCK IoStatusBlock, _In_ PVOID Buffer, _In_ ULONG Length);
+
   // From http://msdn.microsoft.com/en-us/library/ms648412(v=vs.85).aspx
   using NtWaitForSingleObject_t = NTSTATUS(NTAPI *)(_In_ HANDLE Handle, _In_ BOOLEAN Alertable, _In_opt_ PLARGE_INTEGER Timeout);
 
@@ -489,6 +502,8 @@ namespace windows_nt_kernel
 
   using DiscardVirtualMemory_t = BOOL(NTAPI *)(_In_ PVOID VirtualAddress, _In_ SIZE_T Size);
 
+  using QueryWorkingSetEx_t = BOOL(NTAPI *)(_In_ HANDLE hProcess, _Inout_ PVOID pv, _In_ DWORD cb);
+
   using RtlCaptureStackBackTrace_t = USHORT(NTAPI *)(_In_ ULONG FramesToSkip, _In_ ULONG FramesToCapture, _Out_ PVOID *BackTrace, _Out_opt_ PULONG BackTraceHash);
 
   using SymInitialize_t = BOOL(NTAPI *)(_In_ HANDLE hProcess, _In_opt_ PCWSTR UserSearchPath, _In_ BOOL fInvadeProcess);
@@ -564,12 +579,42 @@ namespace windows_nt_kernel
     ULONG AlignmentRequirement;
   } FILE_ALIGNMENT_INFORMATION, *PFILE_ALIGNMENT_INFORMATION;
 
+  typedef struct _FILE_PIPE_LOCAL_INFORMATION  // NOLINT
+  {
+    ULONG NamedPipeType;
+    ULONG NamedPipeConfiguration;
+    ULONG MaximumInstances;
+    ULONG CurrentInstances;
+    ULONG InboundQuota;
+    ULONG ReadDataAvailable;
+    ULONG OutboundQuota;
+    ULONG WriteQuotaAvailable;
+    ULONG NamedPipeState;
+    ULONG NamedPipeEnd;
+  } FILE_PIPE_LOCAL_INFORMATION, *PFILE_PIPE_LOCAL_INFORMATION;
+
   typedef struct _FILE_NAME_INFORMATION  // NOLINT
   {
     ULONG FileNameLength;
     WCHAR FileName[1];
   } FILE_NAME_INFORMATION, *PFILE_NAME_INFORMATION;
 
+  typedef struct _FILE_FULL_EA_INFORMATION  // NOLINT
+  {
+    ULONG NextEntryOffset;
+    UCHAR Flags;
+    UCHAR EaNameLength;
+    USHORT EaValueLength;
+    CHAR EaName[1];
+  } FILE_FULL_EA_INFORMATION, *PFILE_FULL_EA_INFORMATION;
+
+  typedef struct _FILE_GET_EA_INFORMATION  // NOLINT
+  {
+    ULONG NextEntryOffset;
+    UCHAR EaNameLength;
+    CHAR EaName[1];
+  } FILE_GET_EA_INFORMATION, *PFILE_GET_EA_INFORMATION;
+
   typedef struct _FILE_RENAME_INFORMATION  // NOLINT
   {
     ULONG Flags;
@@ -703,6 +748,25 @@ namespace windows_nt_kernel
     WCHAR FileName[1];
   } FILE_ID_FULL_DIR_INFORMATION, *PFILE_ID_FULL_DIR_INFORMATION;
 
+  // From https://learn.microsoft.com/en-us/windows-hardware/drivers/ddi/ntifs/ns-ntifs-_file_id_extd_dir_information
+  typedef struct _FILE_ID_EXTD_DIR_INFORMATION  // NOLINT
+  {
+    ULONG NextEntryOffset;
+    ULONG FileIndex;
+    LARGE_INTEGER CreationTime;
+    LARGE_INTEGER LastAccessTime;
+    LARGE_INTEGER LastWriteTime;
+    LARGE_INTEGER ChangeTime;
+    LARGE_INTEGER EndOfFile;
+    LARGE_INTEGER AllocationSize;
+    ULONG FileAttributes;
+    ULONG FileNameLength;
+    ULONG EaSize;
+    ULONG ReparsePointTag;
+    UCHAR FileId[16];  // FILE_ID_128
+    WCHAR FileName[1];
+  } FILE_ID_EXTD_DIR_INFORMATION, *PFILE_ID_EXTD_DIR_INFORMATION;
+
   // From https://msdn.microsoft.com/en-us/library/windows/hardware/ff540354(v=vs.85).aspx
   typedef struct _FILE_REPARSE_POINT_INFORMATION  // NOLINT
   {
@@ -762,6 +826,8 @@ namespace windows_nt_kernel
   static NtCreateNamedPipeFile_t NtCreateNamedPipeFile;
   static NtQueryDirectoryFile_t NtQueryDirectoryFile;
   static NtSetInformationFile_t NtSetInformationFile;
+  static NtQueryEaFile_t NtQueryEaFile;
+  static NtSetEaFile_t NtSetEaFile;
   static NtWaitForSingleObject_t NtWaitForSingleObject;
   static NtWaitForMultipleObjects_t NtWaitForMultipleObjects;
   static NtDelayExecution_t NtDelayExecution;
@@ -787,6 +853,7 @@ namespace windows_nt_kernel
   static AdjustTokenPrivileges_t AdjustTokenPrivileges;
   static PrefetchVirtualMemory_t PrefetchVirtualMemory_;
   static DiscardVirtualMemory_t DiscardVirtualMemory_;
+  static QueryWorkingSetEx_t QueryWorkingSetEx_;
   static SymInitialize_t SymInitialize;
   static SymGetLineFromAddr64_t SymGetLineFromAddr64;
   static RtlCaptureStackBackTrace_t RtlCaptureStackBackTrace;
@@ -928,6 +995,20 @@ namespace windows_nt_kernel
         abort();
       }
     }
+    if(NtQueryEaFile == nullptr)
+    {
+      if((NtQueryEaFile = reinterpret_cast<NtQueryEaFile_t>(GetProcAddress(ntdllh, "NtQueryEaFile"))) == nullptr)
+      {
+        abort();
+      }
+    }
+    if(NtSetEaFile == nullptr)
+    {
+      if((NtSetEaFile = reinterpret_cast<NtSetEaFile_t>(GetProcAddress(ntdllh, "NtSetEaFile"))) == nullptr)
+      {
+        abort();
+      }
+    }
     if(NtWaitForSingleObject == nullptr)
     {
       if((NtWaitForSingleObject = reinterpret_cast<NtWaitForSingleObject_t>(GetProcAddress(ntdllh, "NtWaitForSingleObject"))) == nullptr)
@@ -1101,6 +1182,11 @@ namespace windows_nt_kernel
     {
       DiscardVirtualMemory_ = reinterpret_cast<DiscardVirtualMemory_t>(GetProcAddress(kernel32, "DiscardVirtualMemory"));
     }
+    // Only provided in kernel32 on Windows 7 and above
+    if(QueryWorkingSetEx_ == nullptr)
+    {
+      QueryWorkingSetEx_ = reinterpret_cast<QueryWorkingSetEx_t>(GetProcAddress(kernel32, "K32QueryWorkingSetEx"));
+    }
 #ifdef LLFIO_OP_STACKBACKTRACEDEPTH
     if(dbghelp)
     {
@@ -1510,6 +1596,14 @@ inline result<ACCESS_MASK> access_mask_from_handle_mode(native_handle_type &nati
 inline result<DWORD> attributes_from_handle_caching_and_flags(native_handle_type &nativeh, handle::caching _caching, handle::flag flags)
 {
   DWORD attribs = 0;
+  if(flags & handle::flag::resolve_cached_only)
+  {
+    return errc::resource_unavailable_try_again;
+  }
+  if(flags & (handle::flag::resolve_beneath | handle::flag::resolve_no_symlinks))
+  {
+    return errc::operation_not_supported;
+  }
   if(flags & handle::flag::multiplexable)
   {
     attribs |= FILE_FLAG_OVERLAPPED;
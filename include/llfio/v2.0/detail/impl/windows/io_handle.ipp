@@ -23,13 +23,15 @@ Distributed under the Boost Software License, Version 1.0.
 */
 
 #include "../../../io_handle.hpp"
+#include "../../../utils.hpp"
 #include "import.hpp"
 
 LLFIO_V2_NAMESPACE_BEGIN
 
 size_t io_handle::_do_max_buffers() const noexcept
 {
-  return 1;  // TODO FIXME support ReadFileScatter/WriteFileGather
+  // Scatter-gather is only possible for page aligned page multiple buffers on unbuffered handles, see do_scatter_gather()
+  return 1;
 }
 
 template <class BuffersType> inline bool do_cancel(const native_handle_type &nativeh, span<windows_nt_kernel::IO_STATUS_BLOCK> ols, io_handle::io_request<BuffersType> reqs) noexcept
@@ -94,9 +96,9 @@ inline bool do_read_write(io_handle::io_result<BuffersType> &ret, Syscall &&sysc
   {
     EIOSB &ol = *ol_it++;
     LARGE_INTEGER offset;
-    if(nativeh.is_append_only())
+    if(nativeh.is_append_only() || (std::is_same<BuffersType, io_handle::const_buffers_type>::value && (reqs.flags & io_multiplexer::write_flag::append)))
     {
-      offset.QuadPart = -1;
+      offset.QuadPart = -1;  // FILE_WRITE_TO_END_OF_FILE
     }
     else
     {
@@ -177,6 +179,85 @@ inline bool do_read_write(io_handle::io_result<BuffersType> &ret, Syscall &&sysc
   return true;
 }
 
+/* Returns false if the request is ineligible for NtReadFileScatter/NtWriteFileGather, which
+issue a list of buffers as a single i/o. These require an unbuffered overlapped handle, and
+a list of page aligned page sized segments, so each buffer must be page aligned and a whole
+number of pages long.
+*/
+template <class Syscall, class BuffersType>
+inline bool do_scatter_gather(io_handle::io_result<BuffersType> &ret, Syscall &&syscall, const native_handle_type &nativeh, io_handle::io_request<BuffersType> reqs, deadline d) noexcept
+{
+  using namespace windows_nt_kernel;
+  using EIOSB = windows_nt_kernel::IO_STATUS_BLOCK;
+  static constexpr size_t max_segments = 512;
+  if(reqs.buffers.size() < 2 || !nativeh.requires_aligned_io() || !nativeh.is_nonblocking() || nativeh.is_append_only() ||
+     (std::is_same<BuffersType, io_handle::const_buffers_type>::value && (reqs.flags & io_multiplexer::write_flag::append)))
+  {
+    return false;
+  }
+  const size_t pagesize = utils::page_size();
+  size_t bytes = 0;
+  for(auto &req : reqs.buffers)
+  {
+    if(req.size() == 0 || ((uintptr_t) req.data() & (pagesize - 1)) != 0 || (req.size() & (pagesize - 1)) != 0)
+    {
+      return false;
+    }
+    bytes += req.size();
+    if(bytes / pagesize > max_segments)
+    {
+      return false;
+    }
+  }
+  // One segment per page, terminated by a null segment
+  FILE_SEGMENT_ELEMENT segments[max_segments + 1];
+  size_t idx = 0;
+  for(auto &req : reqs.buffers)
+  {
+    for(size_t n = 0; n < req.size(); n += pagesize)
+    {
+      segments[idx++].Buffer = PtrToPtr64((void *) (req.data() + n));
+    }
+  }
+  segments[idx].Alignment = 0;
+  EIOSB ol{};
+  memset(&ol, 0, sizeof(ol));
+  LARGE_INTEGER offset;
+  offset.QuadPart = reqs.offset;
+  ol.Status = 0x103 /*STATUS_PENDING*/;
+  NTSTATUS ntstat = syscall(nativeh.h, nullptr, nullptr, nullptr, &ol, segments, static_cast<ULONG>(bytes), &offset, nullptr);
+  if(ntstat < 0 && ntstat != 0x103 /*STATUS_PENDING*/)
+  {
+    ret = ntkernel_error(ntstat);
+    return true;
+  }
+  ntstat = ntwait(nativeh.h, ol, d);
+  if(STATUS_TIMEOUT == ntstat)
+  {
+    ret = errc::timed_out;
+    return true;
+  }
+  if(ntstat < 0)
+  {
+    ret = ntkernel_error(ntstat);
+    return true;
+  }
+  // Distribute the bytes transferred across the buffers in order, as a short read would fill them
+  size_t transferred = ol.Information;
+  ret = {reqs.buffers.data(), 0};
+  for(size_t n = 0; n < reqs.buffers.size(); n++)
+  {
+    const size_t thisbytes = (std::min)(transferred, reqs.buffers[n].size());
+    transferred -= thisbytes;
+    reqs.buffers[n] = {reqs.buffers[n].data(), thisbytes};
+    if(thisbytes != 0)
+    {
+      ret = {reqs.buffers.data(), n + 1};
+    }
+  }
+  return true;
+}
+
 io_handle::io_result<io_handle::buffers_type> io_handle::_do_read(io_handle::io_request<io_handle::buffers_type> reqs, deadline d) noexcept
 {
   windows_nt_kernel::init();
@@ -186,9 +267,15 @@ io_handle::io_result<io_handle::buffers_type> io_handle::_do_read(io_handle::io_
   std::array<EIOSB, 64> _ols{};
   if(reqs.buffers.size() > 64)
   {
-    return errc::argument_list_too_long;
+    return _do_split_request(reqs, 64, d, [this](io_request<buffers_type> thisreq, deadline nd) { return io_handle::_do_read(thisreq, nd); });
   }
   io_handle::io_result<io_handle::buffers_type> ret(reqs.buffers);
+  LLFIO_TRACE_SYSCALL(this, "NtReadFileScatter");
+  if(do_scatter_gather(ret, NtReadFileScatter, _v, reqs, d))
+  {
+    return ret;
+  }
+  LLFIO_TRACE_SYSCALL(this, "NtReadFile");
   do_read_write<true>(ret, NtReadFile, _v, nullptr, {_ols.data(), _ols.size()}, reqs, d);
   return ret;
 }
@@ -200,12 +287,27 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_write(io_hand
   LLFIO_LOG_FUNCTION_CALL(this);
   using EIOSB = windows_nt_kernel::IO_STATUS_BLOCK;
   std::array<EIOSB, 64> _ols{};
+  if(reqs.flags & write_flag::atomic)
+  {
+    // NT has no means of issuing a write which is guaranteed to never tear
+    return errc::not_supported;
+  }
   if(reqs.buffers.size() > 64)
   {
-    return errc::argument_list_too_long;
+    return _do_split_request(reqs, 64, d, [this](io_request<const_buffers_type> thisreq, deadline nd) { return io_handle::_do_write(thisreq, nd); });
   }
   io_handle::io_result<io_handle::const_buffers_type> ret(reqs.buffers);
-  do_read_write<true>(ret, NtWriteFile, _v, nullptr, {_ols.data(), _ols.size()}, reqs, d);
+  LLFIO_TRACE_SYSCALL(this, "NtWriteFileGather");
+  if(!do_scatter_gather(ret, NtWriteFileGather, _v, reqs, d))
+  {
+    LLFIO_TRACE_SYSCALL(this, "NtWriteFile");
+    do_read_write<true>(ret, NtWriteFile, _v, nullptr, {_ols.data(), _ols.size()}, reqs, d);
+  }
+  if(ret && (reqs.flags & (write_flag::data_sync | write_flag::sync)))
+  {
+    // NT has no per-write equivalent of FILE_FLAG_WRITE_THROUGH, so flush after instead
+    OUTCOME_TRYV(io_handle::_do_barrier({}, (reqs.flags & write_flag::sync) ? barrier_kind::wait_all : barrier_kind::wait_data_only, d));
+  }
   return ret;
 }
 
@@ -242,6 +344,7 @@ io_handle::io_result<io_handle::const_buffers_type> io_handle::_do_barrier(io_ha
   {
     flags |= 2 /*FLUSH_FLAGS_NO_SYNC*/;
   }
+  LLFIO_TRACE_SYSCALL(this, "NtFlushBuffersFileEx");
   NTSTATUS ntstat = NtFlushBuffersFileEx(_v.h, flags, nullptr, 0, isb);
   if(STATUS_PENDING == ntstat)
   {
@@ -0,0 +1,724 @@
+/* Multiplex file i/o using Microsoft Windows IOCP
+(C) 2019-2026 Niall Douglas <http://www.nedproductions.biz/> (10 commits)
+File Created: Nov 2019
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../../../io_handle.hpp"
+#include "import.hpp"
+
+#if !LLFIO_INCLUDED_BY_HEADER || !defined(LLFIO_IO_HANDLE_H)
+#error This file should never be included directly
+#endif
+
+#ifndef _WIN32
+#error This implementation file is for Microsoft Windows only
+#endif
+
+#include <atomic>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+/* Every buffer of an i/o is issued as its own NtReadFile()/NtWriteFile(), with the i/o
+state as the APC context, so every completion packet dequeued from the port points at its
+i/o state. An i/o state counts the completion packets still to arrive for it, and whichever
+thread drives that count to zero has exclusive knowledge that the kernel has finished with
+the state, and finishes it. The multiplexer lock is therefore never taken to reap
+completions, and any number of threads can reap concurrently.
+
+The multiplexer lock guards only the timer wheel of in flight i/o with deadlines, which
+check_for_any_completed_io() advances to cancel those whose deadline has passed.
+
+win_ioring_multiplexer derives from this to issue some i/o by other means. Completion
+packets with a non-null key are not i/o completions, and are passed to _keyed_packet().
+*/
+template <bool is_threadsafe> class win_iocp_multiplexer : public io_multiplexer_impl<is_threadsafe>
+{
+protected:
+  using _base = io_multiplexer_impl<is_threadsafe>;
+  using _multiplexer_lock_guard = typename _base::_lock_guard;
+
+  using barrier_kind = typename _base::barrier_kind;
+  using const_buffers_type = typename _base::const_buffers_type;
+  using buffers_type = typename _base::buffers_type;
+  using registered_buffer_type = typename _base::registered_buffer_type;
+  template <class T> using io_request = typename _base::template io_request<T>;
+  template <class T> using io_result = typename _base::template io_result<T>;
+  using io_operation_state = typename _base::io_operation_state;
+  using io_operation_state_visitor = typename _base::io_operation_state_visitor;
+  using check_for_any_completed_io_statistics = typename _base::check_for_any_completed_io_statistics;
+
+  // Added to the count of completion packets to come until all buffers have been issued
+  static constexpr uint32_t _packets_bias = (uint32_t) 1 << 30;
+
+  struct _iocp_operation_state final : public std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>,
+                                       public io_multiplexer_timer_wheel::node  // armed in the timer wheel, guarded by the multiplexer lock
+  {
+    using _impl = std::conditional_t<is_threadsafe, typename _base::_synchronised_io_operation_state, typename _base::_unsynchronised_io_operation_state>;
+
+    windows_nt_kernel::IO_STATUS_BLOCK _ols[64];  // 1Kb just on its own
+    size_t nbuffers{0};                           // how many of _ols were issued
+    NTSTATUS failure{0};                          // set if issuing a buffer failed
+    uint64_t initiated_ns{0};                     // when initiated, for check_for_any_completed_io_statistics
+    std::atomic<uint32_t> packets{0};             // completion packets still to be dequeued
+    std::atomic<bool> submitted{false};           // all buffers have been issued
+    std::atomic<bool> timed_out{false};           // cancelled because its deadline passed
+    bool via_ring{false};                         // issued by win_ioring_multiplexer
+    bool has_deadline{false};                     // armed in the timer wheel at some point
+
+    _iocp_operation_state() = default;
+    _iocp_operation_state(_impl &&o) noexcept
+        : _impl(std::move(o))
+    {
+    }
+    using _impl::_impl;
+
+    virtual io_operation_state *relocate_to(byte *to_) noexcept override
+    {
+      auto *to = _impl::relocate_to(to_);
+      // restamp the vptr with my own
+      new(to) _iocp_operation_state(std::move(*static_cast<_impl *>(to)));
+      return to;
+    }
+  };
+
+  bool _disable_immediate_completions{false};
+  io_multiplexer_timer_wheel _deadlines;
+
+  static std::chrono::steady_clock::time_point _expiry(const deadline &d) noexcept { return io_multiplexer_timer_wheel::expiry(d); }
+
+  void _link_deadline(_iocp_operation_state *state) noexcept
+  {
+    state->has_deadline = true;
+    const auto expires = _expiry(state->payload.noncompleted.d);
+    _multiplexer_lock_guard g(this->_lock);
+    _deadlines.arm(state, expires);
+  }
+  void _unlink_deadline(_iocp_operation_state *state) noexcept
+  {
+    _multiplexer_lock_guard g(this->_lock);
+    _deadlines.disarm(state);
+  }
+  // Cancels any issued buffers still pending. The kernel still posts a completion packet for each.
+  virtual void _cancel(_iocp_operation_state *state, bool /*multiplexer_locked*/) noexcept
+  {
+    using namespace windows_nt_kernel;
+    for(size_t n = 0; n < state->nbuffers; n++)
+    {
+      if(state->_ols[n].Status == STATUS_PENDING)
+      {
+        // STATUS_NOT_FOUND means it completed in the meantime, which is fine
+        IO_STATUS_BLOCK isb = make_iostatus();
+        (void) NtCancelIoFileEx(state->h->native_handle().h, &state->_ols[n], &isb);
+      }
+    }
+  }
+  // Cancels the i/o whose deadlines have passed, returning when the next deadline expires
+  std::chrono::steady_clock::time_point _expire_deadlines() noexcept
+  {
+    if(_deadlines.empty())
+    {
+      return (std::chrono::steady_clock::time_point::max)();
+    }
+    const auto now = std::chrono::steady_clock::now();
+    _multiplexer_lock_guard g(this->_lock);
+    while(auto *n = _deadlines.pop_expired(now))
+    {
+      auto *state = static_cast<_iocp_operation_state *>(n);
+      if(!state->submitted.load(std::memory_order_acquire))
+      {
+        // Another thread is still issuing its buffers, so retry next tick
+        _deadlines.arm(state, now + io_multiplexer_timer_wheel::resolution(1));
+        continue;
+      }
+      state->timed_out.store(true, std::memory_order_relaxed);
+      _cancel(state, true);
+    }
+    return _deadlines.next_expiry();
+  }
+
+  // Issues every buffer, returning true if completion packets are still to arrive
+  template <class Syscall, class BuffersType> bool _submit(_iocp_operation_state *state, Syscall &&syscall, io_multiplexer::io_request<BuffersType> reqs) noexcept
+  {
+    using namespace windows_nt_kernel;
+    const native_handle_type &nativeh = state->h->native_handle();
+    // If SetFileCompletionNotificationModes() succeeded during registration, i/o completing
+    // immediately posts no completion packet. i/o failing immediately never does.
+    const bool skip_on_success = (nativeh.behaviour & native_handle_type::disposition::_multiplexer_state_bit0);
+    state->packets.store(_packets_bias, std::memory_order_relaxed);
+    if(reqs.buffers.size() > sizeof(state->_ols) / sizeof(state->_ols[0]))
+    {
+      state->failure = (NTSTATUS) 0xC000000D /*STATUS_INVALID_PARAMETER*/;
+      reqs.buffers = {};
+    }
+    state->nbuffers = reqs.buffers.size();
+    for(size_t n = 0; n < state->nbuffers; n++)
+    {
+      memset(&state->_ols[n], 0, sizeof(state->_ols[n]));
+      state->_ols[n].Status = -1;
+    }
+    if(state->payload.noncompleted.d)
+    {
+      _link_deadline(state);
+    }
+    uint32_t posted = 0;
+    for(size_t n = 0; n < reqs.buffers.size(); n++)
+    {
+      auto &req = reqs.buffers[n];
+      IO_STATUS_BLOCK &ol = state->_ols[n];
+      LARGE_INTEGER offset;
+      if(nativeh.is_append_only() || (std::is_same<BuffersType, const_buffers_type>::value && (reqs.flags & io_multiplexer::write_flag::append)))
+      {
+        offset.QuadPart = -1;  // FILE_WRITE_TO_END_OF_FILE
+      }
+      else
+      {
+#ifndef NDEBUG
+        if(nativeh.requires_aligned_io())
+        {
+          assert((reqs.offset & 511) == 0);
+          assert(((uintptr_t) req.data() & 511) == 0);
+          assert((req.size() & 511) == 0);
+        }
+#endif
+        offset.QuadPart = reqs.offset;
+      }
+      reqs.offset += req.size();
+      ol.Status = STATUS_PENDING;
+      NTSTATUS ntstat = syscall(nativeh.h, nullptr, nullptr, state, &ol, (PVOID) req.data(), static_cast<DWORD>(req.size()), &offset, nullptr);
+      if(ntstat == STATUS_PENDING || (ntstat >= 0 && !skip_on_success))
+      {
+        ++posted;
+      }
+      else if(ntstat < 0)
+      {
+        InterlockedCompareExchange(&ol.Status, ntstat, STATUS_PENDING);
+        state->failure = ntstat;
+        state->nbuffers = n + 1;
+        break;
+      }
+    }
+    state->submitted.store(true, std::memory_order_release);
+    if(state->failure < 0 && posted > 0)
+    {
+      _cancel(state, false);
+    }
+    const uint32_t remaining = state->packets.fetch_sub(_packets_bias - posted, std::memory_order_acq_rel) - (_packets_bias - posted);
+    if(remaining == 0 && state->has_deadline)
+    {
+      _unlink_deadline(state);
+    }
+    return remaining > 0;
+  }
+  // True if the kernel has written the final status of every issued buffer
+  static bool _all_done(const _iocp_operation_state *state) noexcept
+  {
+    for(size_t n = 0; n < state->nbuffers; n++)
+    {
+      if(state->_ols[n].Status == STATUS_PENDING)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+  template <class BuffersType> static io_multiplexer::io_result<BuffersType> _result(_iocp_operation_state *state, io_multiplexer::io_request<BuffersType> &reqs) noexcept
+  {
+    if(state->failure < 0)
+    {
+      return ntkernel_error(state->failure);
+    }
+    io_multiplexer::io_result<BuffersType> ret = {reqs.buffers.data(), 0};
+    for(size_t n = 0; n < state->nbuffers; n++)
+    {
+      assert(state->_ols[n].Status != -1);
+      if(state->_ols[n].Status < 0)
+      {
+        if(state->_ols[n].Status == (NTSTATUS) 0xC0000120 /*STATUS_CANCELLED*/ && state->timed_out.load(std::memory_order_relaxed))
+        {
+          return errc::timed_out;
+        }
+        return ntkernel_error(static_cast<NTSTATUS>(state->_ols[n].Status));
+      }
+      reqs.buffers[n] = {reqs.buffers[n].data(), state->_ols[n].Information};
+      if(reqs.buffers[n].size() != 0)
+      {
+        ret = {reqs.buffers.data(), n + 1};
+      }
+    }
+    return ret;
+  }
+  // Barriers have no asynchronous form on NT, so they are performed at initiation
+  static io_result<const_buffers_type> _barrier(_iocp_operation_state *state) noexcept
+  {
+    using namespace windows_nt_kernel;
+    auto &params = state->payload.noncompleted.params.barrier;
+    ULONG flags = 0;
+    switch(params.kind)
+    {
+    case barrier_kind::nowait_view_only:
+    case barrier_kind::wait_view_only:
+    case barrier_kind::nowait_data_only:
+    case barrier_kind::wait_data_only:
+      flags = 1 /*FLUSH_FLAGS_FILE_DATA_ONLY*/;
+      break;
+    case barrier_kind::nowait_all:
+    case barrier_kind::wait_all:
+      flags = 0;
+      break;
+    }
+    if(((uint8_t) params.kind & 1) == 0)
+    {
+      flags |= 2 /*FLUSH_FLAGS_NO_SYNC*/;
+    }
+    IO_STATUS_BLOCK &isb = state->_ols[0];
+    isb = make_iostatus();
+    NTSTATUS ntstat = NtFlushBuffersFileEx(state->h->native_handle().h, flags, nullptr, 0, &isb);
+    if(STATUS_PENDING == ntstat)
+    {
+      ntstat = ntwait(state->h->native_handle().h, isb, state->payload.noncompleted.d);
+      if(STATUS_TIMEOUT == ntstat)
+      {
+        return errc::timed_out;
+      }
+    }
+    if(ntstat < 0)
+    {
+      return ntkernel_error(ntstat);
+    }
+    return {params.reqs.buffers};
+  }
+  // Called by whichever thread dequeued the last completion packet of an i/o
+  io_operation_state_type _finish(_iocp_operation_state *state) noexcept
+  {
+    if(state->has_deadline)
+    {
+      _unlink_deadline(state);
+    }
+    typename io_operation_state::lock_guard g(state);
+    switch(state->state)
+    {
+    case io_operation_state_type::read_initialised:
+    case io_operation_state_type::read_initiated:
+      state->_read_completed(g, _result(state, state->payload.noncompleted.params.read.reqs));
+      state->_read_finished(g);
+      return io_operation_state_type::read_finished;
+    case io_operation_state_type::read_completed:
+      state->_read_finished(g);
+      return io_operation_state_type::read_finished;
+    case io_operation_state_type::write_initialised:
+    case io_operation_state_type::write_initiated:
+      state->_write_completed(g, _result(state, state->payload.noncompleted.params.write.reqs));
+      state->_write_or_barrier_finished(g);
+      return io_operation_state_type::write_or_barrier_finished;
+    case io_operation_state_type::write_or_barrier_completed:
+      state->_write_or_barrier_finished(g);
+      return io_operation_state_type::write_or_barrier_finished;
+    default:
+      break;
+    }
+    return state->state;
+  }
+  // Called for every completion packet of an i/o, finishing it upon the last
+  void _packet_dequeued(_iocp_operation_state *state, check_for_any_completed_io_statistics &stats) noexcept
+  {
+    if(state->packets.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+      // More completion packets are to come for this i/o
+      return;
+    }
+    if(state->initiated_ns != 0)
+    {
+      this->_completion_stats.completed(stats, state->initiated_ns);
+    }
+    auto s = _finish(state);
+    if(is_finished(s))
+    {
+      ++stats.initiated_ios_finished;
+    }
+    else if(is_completed(s))
+    {
+      ++stats.initiated_ios_completed;
+    }
+  }
+  virtual void _keyed_packet(void * /*key*/, check_for_any_completed_io_statistics & /*stats*/) noexcept {}
+
+public:
+  constexpr win_iocp_multiplexer() {}
+  win_iocp_multiplexer(const win_iocp_multiplexer &) = delete;
+  win_iocp_multiplexer(win_iocp_multiplexer &&) = delete;
+  win_iocp_multiplexer &operator=(const win_iocp_multiplexer &) = delete;
+  win_iocp_multiplexer &operator=(win_iocp_multiplexer &&) = delete;
+  virtual ~win_iocp_multiplexer()
+  {
+    if(this->_v)
+    {
+      (void) win_iocp_multiplexer::close();
+    }
+  }
+  result<void> init(size_t threads, bool disable_immediate_completions)
+  {
+    this->_v.h = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, (DWORD) threads);
+    if(nullptr == this->_v.h)
+    {
+      return win32_error();
+    }
+    _disable_immediate_completions = disable_immediate_completions;
+    this->_v.behaviour |= native_handle_type::disposition::multiplexer;
+    return success();
+  }
+
+  // virtual result<path_type> current_path() const noexcept override;
+  virtual result<void> close() noexcept override
+  {
+#ifndef NDEBUG
+    if(this->_v)
+    {
+      // Tell handle::close() that we have correctly executed
+      this->_v.behaviour |= native_handle_type::disposition::_child_close_executed;
+    }
+#endif
+    return _base::close();
+  }
+  // virtual native_handle_type release() noexcept override { return _base::release(); }
+
+  virtual result<uint8_t> do_io_handle_register(io_handle *h) noexcept override
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    LLFIO_LOG_FUNCTION_CALL(this);
+    IO_STATUS_BLOCK isb = make_iostatus();
+    FILE_COMPLETION_INFORMATION fci{};
+    memset(&fci, 0, sizeof(fci));
+    fci.Port = this->_v.h;
+    fci.Key = nullptr;
+    NTSTATUS ntstat = NtSetInformationFile(h->native_handle().h, &isb, &fci, sizeof(fci), FileCompletionInformation);
+    if(STATUS_PENDING == ntstat)
+    {
+      ntstat = ntwait(h->native_handle().h, isb, deadline());
+    }
+    if(ntstat < 0)
+    {
+      return ntkernel_error(ntstat);
+    }
+    if(_disable_immediate_completions)
+    {
+      return success();
+    }
+    // If this works, we can avoid IOCP entirely for immediately completing i/o
+    // It'll set native_handle_type::disposition::_multiplexer_state_bit0 if
+    // we successfully executed this
+    return SetFileCompletionNotificationModes(h->native_handle().h, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE) ? (uint8_t) 1 : (uint8_t) 0;
+  }
+  virtual result<void> do_io_handle_deregister(io_handle *h) noexcept override
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    LLFIO_LOG_FUNCTION_CALL(this);
+    IO_STATUS_BLOCK isb = make_iostatus();
+    FILE_COMPLETION_INFORMATION fci{};
+    memset(&fci, 0, sizeof(fci));
+    fci.Port = nullptr;
+    fci.Key = nullptr;
+    NTSTATUS ntstat = NtSetInformationFile(h->native_handle().h, &isb, &fci, sizeof(fci), FileReplaceCompletionInformation);
+    if(STATUS_PENDING == ntstat)
+    {
+      ntstat = ntwait(h->native_handle().h, isb, deadline());
+    }
+    if(ntstat < 0)
+    {
+      return ntkernel_error(ntstat);
+    }
+    return success();
+  }
+  virtual size_t do_io_handle_max_buffers(const io_handle * /*unused*/) const noexcept override { return sizeof(_iocp_operation_state::_ols) / sizeof(_iocp_operation_state::_ols[0]); }
+  // virtual result<registered_buffer_type> do_io_handle_allocate_registered_buffer(io_handle *h, size_t &bytes) noexcept override {}
+  virtual std::pair<size_t, size_t> io_state_requirements() noexcept override { return {sizeof(_iocp_operation_state), alignof(_iocp_operation_state)}; }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d, io_request<buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_iocp_operation_state));
+    if(storage.size() < sizeof(_iocp_operation_state))
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _iocp_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d, io_request<const_buffers_type> reqs) noexcept override
+  {
+    assert(storage.size() >= sizeof(_iocp_operation_state));
+    if(storage.size() < sizeof(_iocp_operation_state))
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _iocp_operation_state(_h, _visitor, std::move(b), d, std::move(reqs));
+  }
+  virtual io_operation_state *construct(span<byte> storage, io_handle *_h, io_operation_state_visitor *_visitor, registered_buffer_type &&b, deadline d, io_request<const_buffers_type> reqs, barrier_kind kind) noexcept override
+  {
+    assert(storage.size() >= sizeof(_iocp_operation_state));
+    if(storage.size() < sizeof(_iocp_operation_state))
+    {
+      return nullptr;
+    }
+    return new(storage.data()) _iocp_operation_state(_h, _visitor, std::move(b), d, std::move(reqs), kind);
+  }
+  virtual io_operation_state_type init_io_operation(io_operation_state *_op) noexcept override
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    LLFIO_LOG_FUNCTION_CALL(this);
+    auto *state = static_cast<_iocp_operation_state *>(_op);
+    // Hold the state lock until the state is initiated, else a thread dequeuing its completion
+    // packets could finish it first
+    typename io_operation_state::lock_guard g(state);
+    switch(state->state)
+    {
+    case io_operation_state_type::unknown:
+      abort();
+    case io_operation_state_type::read_initialised:
+    {
+      auto &reqs = state->payload.noncompleted.params.read.reqs;
+      if(!_submit(state, NtReadFile, reqs))
+      {
+        // Completed immediately without posting a completion packet, so we are done
+        this->_completion_stats.completed_immediately();
+        state->_read_completed(g, _result(state, reqs));
+        state->_read_finished(g);
+        return io_operation_state_type::read_finished;
+      }
+      if(_all_done(state))
+      {
+        // Completed immediately, but the completion packets must be dequeued before the state can be released
+        this->_completion_stats.completed_immediately();
+        state->_read_completed(g, _result(state, reqs));
+        return io_operation_state_type::read_completed;
+      }
+      state->initiated_ns = this->_completion_stats.initiated();
+      state->_read_initiated(g);
+      return io_operation_state_type::read_initiated;
+    }
+    case io_operation_state_type::write_initialised:
+    {
+      auto &reqs = state->payload.noncompleted.params.write.reqs;
+      if(!_submit(state, NtWriteFile, reqs))
+      {
+        // Completed immediately without posting a completion packet, so we are done
+        this->_completion_stats.completed_immediately();
+        state->_write_completed(g, _result(state, reqs));
+        state->_write_or_barrier_finished(g);
+        return io_operation_state_type::write_or_barrier_finished;
+      }
+      if(_all_done(state))
+      {
+        // Completed immediately, but the completion packets must be dequeued before the state can be released
+        this->_completion_stats.completed_immediately();
+        state->_write_completed(g, _result(state, reqs));
+        return io_operation_state_type::write_or_barrier_completed;
+      }
+      state->initiated_ns = this->_completion_stats.initiated();
+      state->_write_initiated(g);
+      return io_operation_state_type::write_initiated;
+    }
+    case io_operation_state_type::barrier_initialised:
+    {
+      this->_completion_stats.completed_immediately();
+      state->_barrier_completed(g, _barrier(state));
+      state->_write_or_barrier_finished(g);
+      return io_operation_state_type::write_or_barrier_finished;
+    }
+    case io_operation_state_type::read_initiated:
+    case io_operation_state_type::read_completed:
+    case io_operation_state_type::read_finished:
+    case io_operation_state_type::write_initiated:
+    case io_operation_state_type::barrier_initiated:
+    case io_operation_state_type::write_or_barrier_completed:
+    case io_operation_state_type::write_or_barrier_finished:
+      assert(false);
+      break;
+    }
+    return state->state;
+  }
+  // virtual result<void> flush_inited_io_operations() noexcept { return success(); }
+  virtual io_operation_state_type check_io_operation(io_operation_state *_op) noexcept override
+  {
+    windows_nt_kernel::init();
+    LLFIO_LOG_FUNCTION_CALL(this);
+    auto *state = static_cast<_iocp_operation_state *>(_op);
+    {
+      typename io_operation_state::lock_guard g(state);
+      // The result is available as soon as the kernel has written every status, but the
+      // state cannot be finished until its completion packets have been dequeued
+      if(is_initiated(state->state) && _all_done(state))
+      {
+        switch(state->state)
+        {
+        case io_operation_state_type::read_initiated:
+          state->_read_completed(g, _result(state, state->payload.noncompleted.params.read.reqs));
+          break;
+        case io_operation_state_type::write_initiated:
+          state->_write_completed(g, _result(state, state->payload.noncompleted.params.write.reqs));
+          break;
+        default:
+          break;
+        }
+      }
+      if(!is_initiated(state->state) && !is_completed(state->state))
+      {
+        return state->state;
+      }
+    }
+    // Poke IOCP in case this i/o's completion packets are waiting
+    (void) check_for_any_completed_io(std::chrono::seconds(0), 1);
+    return state->current_state();
+  }
+  virtual result<io_operation_state_type> cancel_io_operation(io_operation_state *_op, deadline d = {}) noexcept override
+  {
+    windows_nt_kernel::init();
+    LLFIO_LOG_FUNCTION_CALL(this);
+    auto *state = static_cast<_iocp_operation_state *>(_op);
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    const auto s = state->current_state();
+    if(!is_initiated(s))
+    {
+      return s;
+    }
+    // The equivalent of CancelIoEx() upon each pending buffer
+    _cancel(state, false);
+    // Pump completions until the cancelled i/o finishes
+    while(!is_finished(state->current_state()))
+    {
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      OUTCOME_TRY(check_for_any_completed_io(nd));
+      LLFIO_DEADLINE_TO_TIMEOUT_LOOP(d);
+    }
+    return state->current_state();
+  }
+  virtual result<check_for_any_completed_io_statistics> check_for_any_completed_io(deadline d = std::chrono::seconds(0), size_t max_completions = (size_t) -1) noexcept override
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    LLFIO_LOG_FUNCTION_CALL(this);
+    check_for_any_completed_io_statistics stats;
+    if(max_completions == 0)
+    {
+      return stats;
+    }
+    const auto until = d ? _expiry(d) : (std::chrono::steady_clock::time_point::max)();
+    FILE_IO_COMPLETION_INFORMATION entries[64];
+    const ULONG count = (max_completions < sizeof(entries) / sizeof(entries[0])) ? (ULONG) max_completions : (ULONG)(sizeof(entries) / sizeof(entries[0]));
+    for(;;)
+    {
+      // Cancel any i/o whose deadline has passed, and sleep no later than the next deadline
+      const auto next_expiry = _expire_deadlines();
+      const auto wake_at = (std::min)(until, next_expiry);
+      LARGE_INTEGER _timeout{}, *timeout = nullptr;
+      if(wake_at != (std::chrono::steady_clock::time_point::max)())
+      {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wake_at - std::chrono::steady_clock::now()).count();
+        // Negative timeouts are relative, in 100ns units
+        _timeout.QuadPart = (ns <= 0) ? 0 : -((ns + 99) / 100);
+        timeout = &_timeout;
+      }
+      ULONG filled = 0;
+      NTSTATUS ntstat;
+      if(count == 1)
+      {
+        // NtRemoveIoCompletion is markedly quicker than NtRemoveIoCompletionEx,
+        // so if it is just a single scheduled op don't pay the extra cost
+        ntstat = NtRemoveIoCompletion(this->_v.h, &entries[0].KeyContext, &entries[0].ApcContext, &entries[0].IoStatusBlock, timeout);
+        if(ntstat >= 0 && ntstat != STATUS_TIMEOUT)
+        {
+          filled = 1;
+        }
+      }
+      else
+      {
+        ntstat = NtRemoveIoCompletionEx(this->_v.h, entries, count, &filled, timeout, false);
+      }
+      if(ntstat < 0)
+      {
+        return ntkernel_error(ntstat);
+      }
+      if(ntstat == STATUS_TIMEOUT)
+      {
+        filled = 0;
+      }
+      for(ULONG n = 0; n < filled; n++)
+      {
+        if(entries[n].KeyContext != nullptr)
+        {
+          _keyed_packet(entries[n].KeyContext, stats);
+          continue;
+        }
+        // The context is the i/o state
+        auto *state = (_iocp_operation_state *) entries[n].ApcContext;
+        if(state == nullptr)
+        {
+          // wake_check_for_any_completed_io() poke
+          continue;
+        }
+        _packet_dequeued(state, stats);
+      }
+      // Loop only when woken to cancel i/o whose deadline passed before the caller's deadline
+      if(filled > 0 || until <= std::chrono::steady_clock::now() || next_expiry >= until)
+      {
+        break;
+      }
+    }
+    this->_completion_stats.reaped(stats, stats.initiated_ios_completed + stats.initiated_ios_finished);
+    this->_completion_stats.report(stats);
+    return stats;
+  }
+  virtual result<void> wake_check_for_any_completed_io() noexcept override
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    LLFIO_LOG_FUNCTION_CALL(this);
+    NTSTATUS ntstat = NtSetIoCompletion(this->_v.h, 0, nullptr, 0, 0);
+    if(ntstat < 0)
+    {
+      return ntkernel_error(ntstat);
+    }
+    return success();
+  }
+};
+
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_win_iocp(size_t threads, bool disable_immediate_completions) noexcept
+{
+  try
+  {
+    if(1 == threads)
+    {
+      auto ret = std::make_unique<win_iocp_multiplexer<false>>();
+      OUTCOME_TRY(ret->init(1, disable_immediate_completions));
+      return io_multiplexer_ptr(ret.release());
+    }
+    auto ret = std::make_unique<win_iocp_multiplexer<true>>();
+    OUTCOME_TRY(ret->init(threads, disable_immediate_completions));
+    return io_multiplexer_ptr(ret.release());
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_V2_NAMESPACE_END
@@ -0,0 +1,515 @@
+/* Multiplex file i/o using Microsoft Windows IoRing, falling back onto IOCP
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../../io_handle.hpp"
+#include "import.hpp"
+
+#if !LLFIO_INCLUDED_BY_HEADER || !defined(LLFIO_IO_HANDLE_H)
+#error This file should never be included directly
+#endif
+
+#ifndef _WIN32
+#error This implementation file is for Microsoft Windows only
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace windows_ioring
+{
+  // From ioringapi.h, which only the Windows 11 SDK and later provide
+  struct HIORING__;
+  using HIORING = HIORING__ *;
+  enum IORING_VERSION : int
+  {
+    IORING_VERSION_INVALID = 0,
+    IORING_VERSION_1 = 1
+  };
+  struct IORING_CREATE_FLAGS
+  {
+    int Required;
+    int Advisory;
+  };
+  enum IORING_REF_KIND : int
+  {
+    IORING_REF_RAW = 0,
+    IORING_REF_REGISTERED = 1
+  };
+  struct IORING_HANDLE_REF
+  {
+    IORING_REF_KIND Kind;
+    union
+    {
+      HANDLE Handle;
+      UINT32 Index;
+    } Handle;
+  };
+  struct IORING_REGISTERED_BUFFER
+  {
+    UINT32 BufferIndex;
+    UINT32 Offset;
+  };
+  struct IORING_BUFFER_REF
+  {
+    IORING_REF_KIND Kind;
+    union
+    {
+      void *Address;
+      IORING_REGISTERED_BUFFER IndexAndOffset;
+    } Buffer;
+  };
+  struct IORING_CQE
+  {
+    UINT_PTR UserData;
+    HRESULT ResultCode;
+    ULONG_PTR Information;
+  };
+  struct IORING_CAPABILITIES
+  {
+    IORING_VERSION MaxVersion;
+    UINT32 MaxSubmissionQueueSize;
+    UINT32 MaxCompletionQueueSize;
+    int FeatureFlags;
+  };
+
+  using QueryIoRingCapabilities_t = HRESULT(WINAPI *)(IORING_CAPABILITIES *capabilities);
+  using CreateIoRing_t = HRESULT(WINAPI *)(IORING_VERSION ioringVersion, IORING_CREATE_FLAGS flags, UINT32 submissionQueueSize, UINT32 completionQueueSize, HIORING *h);
+  using CloseIoRing_t = HRESULT(WINAPI *)(HIORING ioRing);
+  using SubmitIoRing_t = HRESULT(WINAPI *)(HIORING ioRing, UINT32 waitOperations, UINT32 milliseconds, UINT32 *submittedEntries);
+  using PopIoRingCompletion_t = HRESULT(WINAPI *)(HIORING ioRing, IORING_CQE *cqe);
+  using SetIoRingCompletionEvent_t = HRESULT(WINAPI *)(HIORING ioRing, HANDLE hEvent);
+  using BuildIoRingReadFile_t = HRESULT(WINAPI *)(HIORING ioRing, IORING_HANDLE_REF fileRef, IORING_BUFFER_REF dataRef, UINT32 numberOfBytesToRead, UINT64 fileOffset, UINT_PTR userData, int sqeFlags);
+  using BuildIoRingCancelRequest_t = HRESULT(WINAPI *)(HIORING ioRing, IORING_HANDLE_REF file, UINT_PTR opToCancel, UINT_PTR userData);
+  // From ntdll.dll since Windows 8, these post a completion packet to a port when an object is signalled
+  using NtCreateWaitCompletionPacket_t = NTSTATUS(NTAPI *)(PHANDLE WaitCompletionPacketHandle, ACCESS_MASK DesiredAccess, PVOID ObjectAttributes);
+  using NtAssociateWaitCompletionPacket_t = NTSTATUS(NTAPI *)(HANDLE WaitCompletionPacketHandle, HANDLE IoCompletionHandle, HANDLE TargetObjectHandle, PVOID KeyContext, PVOID ApcContext, NTSTATUS IoStatus, ULONG_PTR IoStatusInformation, PBOOLEAN AlreadySignaled);
+  using NtCancelWaitCompletionPacket_t = NTSTATUS(NTAPI *)(HANDLE WaitCompletionPacketHandle, BOOLEAN RemoveSignaledPacket);
+
+  struct api_t
+  {
+    QueryIoRingCapabilities_t QueryIoRingCapabilities{nullptr};
+    CreateIoRing_t CreateIoRing{nullptr};
+    CloseIoRing_t CloseIoRing{nullptr};
+    SubmitIoRing_t SubmitIoRing{nullptr};
+    PopIoRingCompletion_t PopIoRingCompletion{nullptr};
+    SetIoRingCompletionEvent_t SetIoRingCompletionEvent{nullptr};
+    BuildIoRingReadFile_t BuildIoRingReadFile{nullptr};
+    BuildIoRingCancelRequest_t BuildIoRingCancelRequest{nullptr};
+    NtCreateWaitCompletionPacket_t NtCreateWaitCompletionPacket{nullptr};
+    NtAssociateWaitCompletionPacket_t NtAssociateWaitCompletionPacket{nullptr};
+    NtCancelWaitCompletionPacket_t NtCancelWaitCompletionPacket{nullptr};
+
+    bool available() const noexcept
+    {
+      return QueryIoRingCapabilities != nullptr && CreateIoRing != nullptr && CloseIoRing != nullptr && SubmitIoRing != nullptr && PopIoRingCompletion != nullptr &&
+             SetIoRingCompletionEvent != nullptr && BuildIoRingReadFile != nullptr && BuildIoRingCancelRequest != nullptr && NtCreateWaitCompletionPacket != nullptr &&
+             NtAssociateWaitCompletionPacket != nullptr && NtCancelWaitCompletionPacket != nullptr;
+    }
+  };
+  // The IoRing API is only present on Windows 11 and Server 2022 onwards, so it is looked up at runtime
+  inline const api_t &api() noexcept
+  {
+    static const api_t ret = []() noexcept {
+      api_t r;
+      HMODULE kernelbaseh = GetModuleHandleW(L"kernelbase.dll");
+      if(kernelbaseh != nullptr)
+      {
+        r.QueryIoRingCapabilities = reinterpret_cast<QueryIoRingCapabilities_t>(GetProcAddress(kernelbaseh, "QueryIoRingCapabilities"));
+        r.CreateIoRing = reinterpret_cast<CreateIoRing_t>(GetProcAddress(kernelbaseh, "CreateIoRing"));
+        r.CloseIoRing = reinterpret_cast<CloseIoRing_t>(GetProcAddress(kernelbaseh, "CloseIoRing"));
+        r.SubmitIoRing = reinterpret_cast<SubmitIoRing_t>(GetProcAddress(kernelbaseh, "SubmitIoRing"));
+        r.PopIoRingCompletion = reinterpret_cast<PopIoRingCompletion_t>(GetProcAddress(kernelbaseh, "PopIoRingCompletion"));
+        r.SetIoRingCompletionEvent = reinterpret_cast<SetIoRingCompletionEvent_t>(GetProcAddress(kernelbaseh, "SetIoRingCompletionEvent"));
+        r.BuildIoRingReadFile = reinterpret_cast<BuildIoRingReadFile_t>(GetProcAddress(kernelbaseh, "BuildIoRingReadFile"));
+        r.BuildIoRingCancelRequest = reinterpret_cast<BuildIoRingCancelRequest_t>(GetProcAddress(kernelbaseh, "BuildIoRingCancelRequest"));
+      }
+      HMODULE ntdllh = GetModuleHandleW(L"ntdll.dll");
+      if(ntdllh != nullptr)
+      {
+        r.NtCreateWaitCompletionPacket = reinterpret_cast<NtCreateWaitCompletionPacket_t>(GetProcAddress(ntdllh, "NtCreateWaitCompletionPacket"));
+        r.NtAssociateWaitCompletionPacket = reinterpret_cast<NtAssociateWaitCompletionPacket_t>(GetProcAddress(ntdllh, "NtAssociateWaitCompletionPacket"));
+        r.NtCancelWaitCompletionPacket = reinterpret_cast<NtCancelWaitCompletionPacket_t>(GetProcAddress(ntdllh, "NtCancelWaitCompletionPacket"));
+      }
+      return r;
+    }();
+    return ret;
+  }
+}  // namespace windows_ioring
+
+/* Single buffer reads upon seekable handles are written into the submission queue of an
+IoRing with the i/o state as the user data, and everything else is issued via IOCP exactly
+as win_iocp_multiplexer does. Like io_uring, the submission queue is submitted to the
+kernel by flush_inited_io_operations() and check_for_any_completed_io(), so i/o initiated
+together is submitted with a single syscall.
+
+The IoRing signals an event when it posts completions, and a wait completion packet
+associated with that event posts a packet with _ring_key to the IOCP port. The thread
+dequeuing that packet drains the completion queue, writing each completion into the i/o
+state's IO_STATUS_BLOCK for the common IOCP code to finish, and then rearms the wait.
+There is thus still only one thing for check_for_any_completed_io() to sleep upon.
+
+The multiplexer lock additionally guards the submission and completion queues.
+*/
+template <bool is_threadsafe> class win_ioring_multiplexer final : public win_iocp_multiplexer<is_threadsafe>
+{
+  using _base = win_iocp_multiplexer<is_threadsafe>;
+  using _multiplexer_lock_guard = typename _base::_multiplexer_lock_guard;
+
+  using io_operation_state = typename _base::io_operation_state;
+  using check_for_any_completed_io_statistics = typename _base::check_for_any_completed_io_statistics;
+  using _iocp_operation_state = typename _base::_iocp_operation_state;
+
+  static constexpr uintptr_t _ring_key = 1;
+
+  windows_ioring::HIORING _ring{nullptr};
+  HANDLE _ring_event{nullptr}, _wait_packet{nullptr};
+  // Guarded by the multiplexer lock. Cancellations also occupy the completion queue, so
+  // no more i/o than half the completion queue is issued to the ring at a time.
+  size_t _ring_capacity{0}, _ring_in_flight{0}, _ring_unsubmitted{0};
+
+  static NTSTATUS _status(HRESULT hr) noexcept
+  {
+    if(SUCCEEDED(hr) || hr == HRESULT_FROM_WIN32(ERROR_HANDLE_EOF) || hr == (HRESULT)(0xC0000011 /*STATUS_END_OF_FILE*/ | 0x10000000 /*FACILITY_NT_BIT*/))
+    {
+      // Reads starting past the end of the file read nothing, as with any other handle
+      return 0;
+    }
+    if((hr & 0x10000000 /*FACILITY_NT_BIT*/) != 0)
+    {
+      return (NTSTATUS)(hr & ~0x10000000);
+    }
+    if(hr == HRESULT_FROM_WIN32(ERROR_OPERATION_ABORTED))
+    {
+      return (NTSTATUS) 0xC0000120 /*STATUS_CANCELLED*/;
+    }
+    return (NTSTATUS) 0xC0000001 /*STATUS_UNSUCCESSFUL*/;
+  }
+  static auto _hresult_error(HRESULT hr) noexcept -> decltype(win32_error(0))
+  {
+    if(HRESULT_FACILITY(hr) == FACILITY_WIN32)
+    {
+      return win32_error(HRESULT_CODE(hr));
+    }
+    return ntkernel_error(_status(hr));
+  }
+  static windows_ioring::IORING_HANDLE_REF _file_ref(const _iocp_operation_state *state) noexcept
+  {
+    windows_ioring::IORING_HANDLE_REF ret;
+    ret.Kind = windows_ioring::IORING_REF_RAW;
+    ret.Handle.Handle = state->h->native_handle().h;
+    return ret;
+  }
+
+  // Requires the multiplexer lock
+  HRESULT _ring_submit() noexcept
+  {
+    if(_ring_unsubmitted == 0)
+    {
+      return S_OK;
+    }
+    UINT32 submitted = 0;
+    HRESULT hr = windows_ioring::api().SubmitIoRing(_ring, 0, 0, &submitted);
+    if(SUCCEEDED(hr))
+    {
+      _ring_unsubmitted = 0;
+    }
+    return hr;
+  }
+  // Requires the multiplexer lock. If the submission queue is full, submits it and retries.
+  template <class F> HRESULT _ring_build(F &&build) noexcept
+  {
+    HRESULT hr = build();
+    if(FAILED(hr) && _ring_unsubmitted > 0 && SUCCEEDED(_ring_submit()))
+    {
+      hr = build();
+    }
+    if(SUCCEEDED(hr))
+    {
+      ++_ring_in_flight;
+      ++_ring_unsubmitted;
+    }
+    return hr;
+  }
+  bool _ring_eligible(const _iocp_operation_state *state) const noexcept
+  {
+    if(_ring == nullptr || state->state != io_operation_state_type::read_initialised)
+    {
+      return false;
+    }
+    const auto &reqs = state->payload.noncompleted.params.read.reqs;
+    return reqs.buffers.size() == 1 && reqs.buffers[0].size() <= (uint32_t) -1 && state->h->native_handle().is_seekable();
+  }
+  NTSTATUS _rearm(BOOLEAN *already_signalled) noexcept
+  {
+    return windows_ioring::api().NtAssociateWaitCompletionPacket(_wait_packet, this->_v.h, _ring_event, (PVOID) _ring_key, nullptr, 0, 0, already_signalled);
+  }
+  void _drain_ring(check_for_any_completed_io_statistics &stats) noexcept
+  {
+    const auto &api = windows_ioring::api();
+    windows_ioring::IORING_CQE cqes[64];
+    size_t count;
+    do
+    {
+      count = 0;
+      {
+        _multiplexer_lock_guard g(this->_lock);
+        while(count < sizeof(cqes) / sizeof(cqes[0]) && api.PopIoRingCompletion(_ring, &cqes[count]) == S_OK)
+        {
+          --_ring_in_flight;
+          // Cancellation requests have no user data
+          if(cqes[count].UserData != 0)
+          {
+            ++count;
+          }
+        }
+      }
+      for(size_t n = 0; n < count; n++)
+      {
+        auto *state = (_iocp_operation_state *) cqes[n].UserData;
+        state->_ols[0].Information = cqes[n].Information;
+        InterlockedExchange(&state->_ols[0].Status, _status(cqes[n].ResultCode));
+        this->_packet_dequeued(state, stats);
+      }
+    } while(count == sizeof(cqes) / sizeof(cqes[0]));
+  }
+  void _close_ring() noexcept
+  {
+    const auto &api = windows_ioring::api();
+    if(_wait_packet != nullptr)
+    {
+      (void) api.NtCancelWaitCompletionPacket(_wait_packet, true);
+      CloseHandle(_wait_packet);
+      _wait_packet = nullptr;
+    }
+    if(_ring != nullptr)
+    {
+      (void) api.CloseIoRing(_ring);
+      _ring = nullptr;
+    }
+    if(_ring_event != nullptr)
+    {
+      CloseHandle(_ring_event);
+      _ring_event = nullptr;
+    }
+  }
+
+  virtual void _cancel(_iocp_operation_state *state, bool multiplexer_locked) noexcept override
+  {
+    if(!state->via_ring)
+    {
+      _base::_cancel(state, multiplexer_locked);
+      return;
+    }
+    if(state->_ols[0].Status != 0x103 /*STATUS_PENDING*/)
+    {
+      return;
+    }
+    _multiplexer_lock_guard g(this->_lock, std::defer_lock);
+    if(!multiplexer_locked)
+    {
+      g.lock();
+    }
+    // The cancelled read still posts its completion, with ERROR_OPERATION_ABORTED
+    const auto file = _file_ref(state);
+    if(SUCCEEDED(_ring_build([&] { return windows_ioring::api().BuildIoRingCancelRequest(_ring, file, (UINT_PTR) state, 0); })))
+    {
+      (void) _ring_submit();
+    }
+  }
+  virtual void _keyed_packet(void *key, check_for_any_completed_io_statistics &stats) noexcept override
+  {
+    if(key != (void *) _ring_key)
+    {
+      return;
+    }
+    for(;;)
+    {
+      // Reset before draining, so completions posted after the drain signal the event anew
+      ResetEvent(_ring_event);
+      _drain_ring(stats);
+      BOOLEAN already_signalled = false;
+      if(_rearm(&already_signalled) < 0 || !already_signalled)
+      {
+        return;
+      }
+    }
+  }
+
+public:
+  constexpr win_ioring_multiplexer() {}
+  win_ioring_multiplexer(const win_ioring_multiplexer &) = delete;
+  win_ioring_multiplexer(win_ioring_multiplexer &&) = delete;
+  win_ioring_multiplexer &operator=(const win_ioring_multiplexer &) = delete;
+  win_ioring_multiplexer &operator=(win_ioring_multiplexer &&) = delete;
+  virtual ~win_ioring_multiplexer() { _close_ring(); }
+  result<void> init(size_t threads, bool disable_immediate_completions)
+  {
+    windows_nt_kernel::init();
+    const auto &api = windows_ioring::api();
+    if(!api.available())
+    {
+      return errc::function_not_supported;
+    }
+    OUTCOME_TRY(_base::init(threads, disable_immediate_completions));
+    windows_ioring::IORING_CAPABILITIES caps{};
+    HRESULT hr = api.QueryIoRingCapabilities(&caps);
+    if(FAILED(hr))
+    {
+      return _hresult_error(hr);
+    }
+    const UINT32 sqsize = (std::min)(caps.MaxSubmissionQueueSize, (UINT32) 1024);
+    const UINT32 cqsize = (std::min)(caps.MaxCompletionQueueSize, (UINT32) 2048);
+    hr = api.CreateIoRing(caps.MaxVersion, {0, 0}, sqsize, cqsize, &_ring);
+    if(FAILED(hr))
+    {
+      _ring = nullptr;
+      return _hresult_error(hr);
+    }
+    _ring_capacity = cqsize / 2;
+    _ring_event = CreateEventW(nullptr, true, false, nullptr);
+    if(nullptr == _ring_event)
+    {
+      return win32_error();
+    }
+    hr = api.SetIoRingCompletionEvent(_ring, _ring_event);
+    if(FAILED(hr))
+    {
+      return _hresult_error(hr);
+    }
+    NTSTATUS ntstat = api.NtCreateWaitCompletionPacket(&_wait_packet, GENERIC_ALL, nullptr);
+    if(ntstat < 0)
+    {
+      _wait_packet = nullptr;
+      return ntkernel_error(ntstat);
+    }
+    BOOLEAN already_signalled = false;
+    ntstat = _rearm(&already_signalled);
+    if(ntstat < 0)
+    {
+      return ntkernel_error(ntstat);
+    }
+    return success();
+  }
+
+  virtual result<void> close() noexcept override
+  {
+    _close_ring();
+    return _base::close();
+  }
+
+  virtual io_operation_state_type init_io_operation(io_operation_state *_op) noexcept override
+  {
+    auto *state = static_cast<_iocp_operation_state *>(_op);
+    if(!_ring_eligible(state))
+    {
+      return _base::init_io_operation(_op);
+    }
+    LLFIO_LOG_FUNCTION_CALL(this);
+    // As with IOCP, hold the state lock until the state is initiated
+    typename io_operation_state::lock_guard g(state);
+    auto &reqs = state->payload.noncompleted.params.read.reqs;
+    state->nbuffers = 1;
+    memset(&state->_ols[0], 0, sizeof(state->_ols[0]));
+    state->_ols[0].Status = 0x103 /*STATUS_PENDING*/;
+    state->packets.store(1, std::memory_order_relaxed);
+    state->via_ring = true;
+    if(state->payload.noncompleted.d)
+    {
+      this->_link_deadline(state);
+    }
+    HRESULT hr = E_FAIL;
+    {
+      _multiplexer_lock_guard mg(this->_lock);
+      if(_ring_in_flight < _ring_capacity)
+      {
+        windows_ioring::IORING_BUFFER_REF buffer;
+        buffer.Kind = windows_ioring::IORING_REF_RAW;
+        buffer.Buffer.Address = reqs.buffers[0].data();
+        const auto file = _file_ref(state);
+        hr = _ring_build([&] { return windows_ioring::api().BuildIoRingReadFile(_ring, file, buffer, (UINT32) reqs.buffers[0].size(), reqs.offset, (UINT_PTR) state, 0); });
+      }
+    }
+    if(FAILED(hr))
+    {
+      // The ring is full or refused the read, so issue it via IOCP instead
+      if(state->has_deadline)
+      {
+        this->_unlink_deadline(state);
+        state->has_deadline = false;
+      }
+      state->via_ring = false;
+      g.unlock();
+      return _base::init_io_operation(_op);
+    }
+    state->submitted.store(true, std::memory_order_release);
+    state->initiated_ns = this->_completion_stats.initiated();
+    state->_read_initiated(g);
+    return io_operation_state_type::read_initiated;
+  }
+  // Reads are written into the submission queue by init_io_operation(). This tells the kernel about them.
+  virtual result<void> flush_inited_io_operations() noexcept override
+  {
+    _multiplexer_lock_guard g(this->_lock);
+    HRESULT hr = _ring_submit();
+    if(FAILED(hr))
+    {
+      return _hresult_error(hr);
+    }
+    return success();
+  }
+  virtual result<check_for_any_completed_io_statistics> check_for_any_completed_io(deadline d = std::chrono::seconds(0), size_t max_completions = (size_t) -1) noexcept override
+  {
+    {
+      _multiplexer_lock_guard g(this->_lock);
+      HRESULT hr = _ring_submit();
+      if(FAILED(hr))
+      {
+        return _hresult_error(hr);
+      }
+    }
+    return _base::check_for_any_completed_io(d, max_completions);
+  }
+};
+
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_win_ioring(size_t threads, bool disable_immediate_completions) noexcept
+{
+  try
+  {
+    if(1 == threads)
+    {
+      auto ret = std::make_unique<win_ioring_multiplexer<false>>();
+      OUTCOME_TRY(ret->init(1, disable_immediate_completions));
+      return io_multiplexer_ptr(ret.release());
+    }
+    auto ret = std::make_unique<win_ioring_multiplexer<true>>();
+    OUTCOME_TRY(ret->init(threads, disable_immediate_completions));
+    return io_multiplexer_ptr(ret.release());
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_V2_NAMESPACE_END
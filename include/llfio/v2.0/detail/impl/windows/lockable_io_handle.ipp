@@ -71,6 +71,37 @@ result<lockable_io_handle::extent_guard> lockable_io_handle::lock_file_range(io_
   return extent_guard(this, offset, bytes, kind);
 }
 
+result<void> lockable_io_handle::relock_file_range(io_handle::extent_type offset, io_handle::extent_type bytes, lock_kind from, lock_kind to, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  if(from == to)
+  {
+    return success();
+  }
+  if(to == lock_kind::shared)
+  {
+    // A shared lock may overlay my exclusive lock, and unlocking releases the exclusive lock first
+    OUTCOME_TRY(auto &&g, lock_file_range(offset, bytes, lock_kind::shared, d));
+    g.release();
+    unlock_file_range(offset, bytes);
+    return success();
+  }
+  // Windows cannot upgrade atomically, as my own shared lock excludes an exclusive lock
+  unlock_file_range(offset, bytes);
+  auto r = lock_file_range(offset, bytes, lock_kind::exclusive, d);
+  if(!r)
+  {
+    auto r2 = lock_file_range(offset, bytes, lock_kind::shared);
+    if(r2)
+    {
+      r2.value().release();
+    }
+    return std::move(r).error();
+  }
+  r.value().release();
+  return success();
+}
+
 void lockable_io_handle::unlock_file_range(io_handle::extent_type offset, io_handle::extent_type bytes) noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
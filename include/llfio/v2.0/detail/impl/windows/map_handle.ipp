@@ -24,6 +24,7 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../../../map_handle.hpp"
 #include "../../../utils.hpp"
+#include "../map_handle.ipp"
 #include "import.hpp"
 
 #include "quickcpplib/algorithm/hash.hpp"
@@ -31,6 +32,17 @@ Distributed under the Boost Software License, Version 1.0.
 
 LLFIO_V2_NAMESPACE_BEGIN
 
+// True if the file is on a DAX volume, so maps of it are of the persistent memory itself
+static inline bool win32_is_dax_volume(HANDLE h) noexcept
+{
+  DWORD flags = 0;
+  if(GetVolumeInformationByHandleW(h, nullptr, 0, nullptr, nullptr, &flags, nullptr, 0) == 0)
+  {
+    return false;
+  }
+  return (flags & 0x20000000 /*FILE_DAX_VOLUME*/) != 0;
+}
+
 section_handle::~section_handle()
 {
   if(_v)
@@ -42,6 +54,7 @@ section_handle::~section_handle()
       abort();
     }
   }
+  delete _dirty;
 }
 result<void> section_handle::close() noexcept
 {
@@ -54,6 +67,8 @@ result<void> section_handle::close() noexcept
 #endif
     OUTCOME_TRYV(handle::close());
     OUTCOME_TRYV(_anonymous.close());
+    delete _dirty;
+    _dirty = nullptr;
     _flag = flag::none;
   }
   return success();
@@ -123,6 +138,18 @@ result<section_handle> section_handle::section(file_handle &backing, extent_type
     }
   }
   nativeh.behaviour |= native_handle_type::disposition::section;
+  if(!(_flag & flag::nvram) && win32_is_dax_volume(backing.native_handle().h))
+  {
+    ret.value()._flag |= flag::nvram;
+  }
+  if(_flag & flag::track_dirty)
+  {
+    ret.value()._dirty = new(std::nothrow) detail::section_handle_dirty_ranges;
+    if(ret.value()._dirty == nullptr)
+    {
+      return errc::not_enough_memory;
+    }
+  }
   OBJECT_ATTRIBUTES oa{}, *poa = nullptr;
   UNICODE_STRING _path{};
   if(_flag & flag::singleton)
@@ -181,8 +208,35 @@ result<section_handle> section_handle::section(extent_type bytes, const path_han
 {
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
-  OUTCOME_TRY(auto &&_anonh, file_handle::temp_inode(dirh));
-  OUTCOME_TRYV(_anonh.truncate(bytes));
+  /* Large pages are only available for sections backed by the paging file, which is also never
+  written to for them as large pages are never paged out. So for large pages, do not create an
+  anonymous inode, and size the section in whole large pages.
+  */
+  const bool pagefile_backed = !(_flag & flag::nvram) && (_flag & flag::page_sizes_3) == flag::page_sizes_1;
+  file_handle _anonh;
+  if(pagefile_backed)
+  {
+    try
+    {
+      // Enumerating the available page sizes enables SeLockMemoryPrivilege if possible
+      const auto &pagesizes = utils::page_sizes(true);
+      if(pagesizes.size() < 2)
+      {
+        return errc::operation_not_permitted;
+      }
+      bytes = utils::round_up_to_page_size(bytes, pagesizes[1]);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+  else
+  {
+    OUTCOME_TRY(auto &&anonh, file_handle::temp_inode(dirh));
+    OUTCOME_TRYV(anonh.truncate(bytes));
+    _anonh = std::move(anonh);
+  }
   result<section_handle> ret(section_handle(native_handle_type(), nullptr, std::move(_anonh), _flag));
   native_handle_type &nativeh = ret.value()._v;
   file_handle &anonh = ret.value()._anonymous;
@@ -252,11 +306,23 @@ result<section_handle> section_handle::section(extent_type bytes, const path_han
     }
   }
   nativeh.behaviour |= native_handle_type::disposition::section;
+  if(!pagefile_backed && !(_flag & flag::nvram) && win32_is_dax_volume(anonh.native_handle().h))
+  {
+    ret.value()._flag |= flag::nvram;
+  }
+  if(_flag & flag::track_dirty)
+  {
+    ret.value()._dirty = new(std::nothrow) detail::section_handle_dirty_ranges;
+    if(ret.value()._dirty == nullptr)
+    {
+      return errc::not_enough_memory;
+    }
+  }
   LARGE_INTEGER _maximum_size{}, *pmaximum_size = &_maximum_size;
   _maximum_size.QuadPart = bytes;
   LLFIO_LOG_FUNCTION_CALL(&ret);
   HANDLE h;
-  NTSTATUS ntstat = NtCreateSection(&h, SECTION_ALL_ACCESS, nullptr, pmaximum_size, prot, attribs, anonh.native_handle().h);
+  NTSTATUS ntstat = NtCreateSection(&h, SECTION_ALL_ACCESS, nullptr, pmaximum_size, prot, attribs, pagefile_backed ? nullptr : anonh.native_handle().h);
   if(ntstat < 0)
   {
     return ntkernel_error(ntstat);
@@ -447,6 +513,120 @@ static inline result<void> win32_release_allocations(byte *addr, size_t bytes, U
   return success();
 }
 
+#ifdef MEM_RESERVE_PLACEHOLDER
+/* Windows 10 1803 onwards can reserve address space as placeholders, which can be split, coalesced
+and replaced with views without the address space ever being released to other threads.
+*/
+struct win32_placeholder_api_t
+{
+  using VirtualAlloc2_t = PVOID(WINAPI *)(HANDLE, PVOID, SIZE_T, ULONG, ULONG, MEM_EXTENDED_PARAMETER *, ULONG);
+  using MapViewOfFile3_t = PVOID(WINAPI *)(HANDLE, HANDLE, PVOID, ULONG64, SIZE_T, ULONG, ULONG, MEM_EXTENDED_PARAMETER *, ULONG);
+  using UnmapViewOfFile2_t = BOOL(WINAPI *)(HANDLE, PVOID, ULONG);
+  VirtualAlloc2_t VirtualAlloc2{nullptr};
+  MapViewOfFile3_t MapViewOfFile3{nullptr};
+  UnmapViewOfFile2_t UnmapViewOfFile2{nullptr};
+
+  bool available() const noexcept { return VirtualAlloc2 != nullptr && MapViewOfFile3 != nullptr && UnmapViewOfFile2 != nullptr; }
+};
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 6387)  // MSVC sanitiser warns that GetModuleHandleW() might fail
+#endif
+static inline const win32_placeholder_api_t &win32_placeholder_api() noexcept
+{
+  static const win32_placeholder_api_t v = [] {
+    win32_placeholder_api_t ret;
+    HMODULE h = GetModuleHandleW(L"kernelbase.dll");
+    if(h != nullptr)
+    {
+      ret.VirtualAlloc2 = reinterpret_cast<win32_placeholder_api_t::VirtualAlloc2_t>(GetProcAddress(h, "VirtualAlloc2"));
+      ret.MapViewOfFile3 = reinterpret_cast<win32_placeholder_api_t::MapViewOfFile3_t>(GetProcAddress(h, "MapViewOfFile3"));
+      ret.UnmapViewOfFile2 = reinterpret_cast<win32_placeholder_api_t::UnmapViewOfFile2_t>(GetProcAddress(h, "UnmapViewOfFile2"));
+    }
+    return ret;
+  }();
+  return v;
+}
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+/* Coalesces the `pieces` adjacent placeholders spanning `held` bytes from `addr` into one, splits
+off its front `bytes`, and replaces that with a view. On failure, `addr` to `addr + held` is left
+as a single placeholder if it could be coalesced.
+*/
+static inline result<void> win32_map_into_placeholder(HANDLE sectionh, byte *addr, size_t bytes, size_t held, size_t pieces, ULONG64 offset, ULONG allocation, ULONG prot) noexcept
+{
+  if(pieces > 1 && VirtualFree(addr, held, MEM_RELEASE | MEM_COALESCE_PLACEHOLDERS) == 0)
+  {
+    return win32_error();
+  }
+  if(bytes < held && VirtualFree(addr, bytes, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER) == 0)
+  {
+    return win32_error();
+  }
+  if(win32_placeholder_api().MapViewOfFile3(sectionh, GetCurrentProcess(), addr, offset, bytes, allocation | MEM_REPLACE_PLACEHOLDER, prot, nullptr, 0) == nullptr)
+  {
+    auto ret = win32_error();
+    if(bytes < held)
+    {
+      (void) VirtualFree(addr, held, MEM_RELEASE | MEM_COALESCE_PLACEHOLDERS);
+    }
+    return ret;
+  }
+  return success();
+}
+#endif
+
+namespace detail
+{
+  inline void map_handle_cache_release(byte *addr, size_t bytes) noexcept { (void) win32_release_allocations(addr, bytes, MEM_RELEASE); }
+
+  inline result<bool> map_handle_populate_native(byte *addr, size_t bytes, bool /*unused*/) noexcept
+  {
+    // Have the portion prefetched as a single i/o before we touch it page by page
+    map_handle::buffer_type b{addr, bytes};
+    (void) map_handle::prefetch(span<map_handle::buffer_type>(&b, 1));
+    return false;
+  }
+
+  // Returns the preferred node for the placement, or -1 for no preference. Windows only has preferred nodes.
+  inline result<ULONG> win32_numa_node_from_placement(numa_placement placement) noexcept
+  {
+    switch(placement.policy)
+    {
+    case numa_placement::policy_type::first_touch:
+      return (ULONG) -1;
+    case numa_placement::policy_type::local:
+    {
+      PROCESSOR_NUMBER pn;
+      GetCurrentProcessorNumberEx(&pn);
+      USHORT node = 0;
+      if(!GetNumaProcessorNodeEx(&pn, &node))
+      {
+        return (ULONG) -1;  // only a hint
+      }
+      return (ULONG) node;
+    }
+    case numa_placement::policy_type::prefer:
+    case numa_placement::policy_type::bind:
+    {
+      if(placement.nodes == 0)
+      {
+        return errc::invalid_argument;
+      }
+      ULONG node = 0;
+      while(((placement.nodes >> node) & 1) == 0)
+      {
+        ++node;
+      }
+      return node;
+    }
+    default:
+      return errc::operation_not_supported;
+    }
+  }
+}  // namespace detail
+
 map_handle::~map_handle()
 {
   if(_addr != nullptr)
@@ -482,8 +662,16 @@ result<void> map_handle::close() noexcept
         }
         return success();
       }));
+      if(_placeholder && win32_round_up_to_allocation_size(_reservation) > _reservation)
+      {
+        // Release the placeholder holding the remainder of the last granule
+        if(VirtualFree(_addr + _reservation, 0, MEM_RELEASE) == 0)
+        {
+          return win32_error();
+        }
+      }
     }
-    else
+    else if(!_recyclable || !detail::map_handle_cache().enabled.load(std::memory_order_relaxed) || !detail::map_handle_cache().add(_addr, _reservation, _pagesize, _flag))
     {
       OUTCOME_TRYV(win32_release_allocations(_addr, _reservation, MEM_RELEASE));
     }
@@ -492,6 +680,8 @@ result<void> map_handle::close() noexcept
   _v = native_handle_type();
   _addr = nullptr;
   _length = 0;
+  _recyclable = false;
+  _placeholder = false;
   return success();
 }
 
@@ -502,6 +692,7 @@ native_handle_type map_handle::release() noexcept
   _v = native_handle_type();
   _addr = nullptr;
   _length = 0;
+  _placeholder = false;
   return {};
 }
 
@@ -519,27 +710,48 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_barrier(ma
     }
     bytes += req.size();
   }
-  // bytes = 0 means flush entire mapping
-  if(bytes == 0)
-  {
-    bytes = _reservation - reqs.offset;
+  auto flush_view = [](byte *addr, size_t bytes) -> result<void> {
+    if(FlushViewOfFile(addr, static_cast<SIZE_T>(bytes)) == 0)
+    {
+      return win32_error();
+    }
+    return success();
+  };
+  // bytes = 0 and the section tracks modified extents means flush only those
+  if(bytes == 0 && _section != nullptr && _section->_dirty != nullptr)
+  {
+    OUTCOME_TRYV(_section->_dirty->flush(_offset + reqs.offset, _offset + _length, [&](extent_type begin, extent_type end) -> result<void> {
+      addr = _addr + ((begin - _offset) & ~static_cast<extent_type>(_pagesize - 1));
+      bytes = utils::round_up_to_page_size(end - _offset, _pagesize) - (addr - _addr);
+      if(kind <= barrier_kind::wait_data_only && is_nvram())
+      {
+        auto synced = nvram_barrier({addr, static_cast<size_type>(bytes)});
+        if(synced.size() >= bytes)
+        {
+          return success();
+        }
+      }
+      return win32_maps_apply(addr, static_cast<size_type>(bytes), win32_map_sought::committed, flush_view);
+    }));
   }
-  // If nvram and not syncing metadata, use lightweight barrier
-  if(kind <= barrier_kind::wait_data_only && is_nvram())
+  else
   {
-    auto synced = nvram_barrier({addr, bytes});
-    if(synced.size() >= bytes)
+    // bytes = 0 means flush entire mapping
+    if(bytes == 0)
     {
-      return {reqs.buffers};
+      bytes = _reservation - reqs.offset;
     }
-  }
-  OUTCOME_TRYV(win32_maps_apply(addr, bytes, win32_map_sought::committed, [](byte *addr, size_t bytes) -> result<void> {
-    if(FlushViewOfFile(addr, static_cast<SIZE_T>(bytes)) == 0)
+    // If nvram and not syncing metadata, use lightweight barrier
+    if(kind <= barrier_kind::wait_data_only && is_nvram())
     {
-      return win32_error();
+      auto synced = nvram_barrier({addr, static_cast<size_type>(bytes)});
+      if(synced.size() >= bytes)
+      {
+        return {reqs.buffers};
+      }
     }
-    return success();
-  }));
+    OUTCOME_TRYV(win32_maps_apply(addr, static_cast<size_type>(bytes), win32_map_sought::committed, flush_view));
+  }
   if((_section != nullptr) && (_section->backing() != nullptr) && kind >= barrier_kind::nowait_all)
   {
     reqs.offset += _offset;
@@ -549,29 +761,56 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_barrier(ma
 }
 
 
-result<map_handle> map_handle::map(size_type bytes, bool /*unused*/, section_handle::flag _flag) noexcept
+result<map_handle> map_handle::map(size_type bytes, bool zeroed, section_handle::flag _flag) noexcept
 {
-  // TODO: Keep a cache of DiscardVirtualMemory()/MEM_RESET pages deallocated
   result<map_handle> ret(map_handle(nullptr, _flag));
   native_handle_type &nativeh = ret.value()._v;
   DWORD allocation = MEM_RESERVE | MEM_COMMIT, prot;
   PVOID addr = nullptr;
   OUTCOME_TRY(auto &&pagesize, detail::pagesize_from_flags(ret.value()._flag));
   bytes = utils::round_up_to_page_size(bytes, pagesize);
+  if(ret.value()._flag & section_handle::flag::nocommit)
+  {
+    // Reservations cost nothing, and one ending on a granule boundary can be extended in place by truncate()
+    bytes = win32_round_up_to_allocation_size(bytes);
+  }
   {
     size_t commitsize;
     OUTCOME_TRY(win32_map_flags(nativeh, allocation, prot, commitsize, true, ret.value()._flag));
   }
   LLFIO_LOG_FUNCTION_CALL(&ret);
-  addr = VirtualAlloc(nullptr, bytes, allocation, prot);
+  // Recycled maps may have been placed differently
+  const auto placement = this_thread::current_numa_placement();
+  const bool cacheable = detail::map_handle_cache_t::cacheable(ret.value()._flag) && placement == numa_placement();
+  if(cacheable && !zeroed && detail::map_handle_cache().enabled.load(std::memory_order_relaxed))
+  {
+    addr = detail::map_handle_cache().get(bytes, pagesize, ret.value()._flag);
+  }
+  if(addr == nullptr && placement != numa_placement())
+  {
+    OUTCOME_TRY(auto &&node, detail::win32_numa_node_from_placement(placement));
+    if(node != (ULONG) -1)
+    {
+      addr = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes, allocation, prot, node);
+      if(addr == nullptr)
+      {
+        return win32_error();
+      }
+    }
+  }
   if(addr == nullptr)
   {
-    return win32_error();
+    addr = VirtualAlloc(nullptr, bytes, allocation, prot);
+    if(addr == nullptr)
+    {
+      return win32_error();
+    }
   }
   ret.value()._addr = static_cast<byte *>(addr);
   ret.value()._reservation = bytes;
   ret.value()._length = bytes;
   ret.value()._pagesize = pagesize;
+  ret.value()._recyclable = cacheable;
   nativeh._init = -2;  // otherwise appears closed
   nativeh.behaviour |= native_handle_type::disposition::allocation;
 
@@ -605,11 +844,46 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   OUTCOME_TRY(auto &&pagesize, detail::pagesize_from_flags(ret.value()._flag));
   SIZE_T _bytes = bytes;
   OUTCOME_TRY(win32_map_flags(nativeh, allocation, prot, commitsize, section.backing() != nullptr, ret.value()._flag));
+  if(allocation & MEM_LARGE_PAGES)
+  {
+    // Views of large page sections cannot be reserved, and must be whole large pages
+    allocation &= ~MEM_RESERVE;
+    _bytes = commitsize = utils::round_up_to_page_size(bytes, pagesize);
+  }
   LLFIO_LOG_FUNCTION_CALL(&ret);
-  NTSTATUS ntstat = NtMapViewOfSection(section.native_handle().h, GetCurrentProcess(), &addr, 0, commitsize, &_offset, &_bytes, ViewUnmap, allocation, prot);
-  if(ntstat < 0)
+#ifdef MEM_RESERVE_PLACEHOLDER
+  OUTCOME_TRY(auto &&sectionlength, section.length());
+  if(win32_placeholder_api().available() && !(allocation & MEM_LARGE_PAGES) && (bytes != 0 || sectionlength > offset))
+  {
+    /* Map the view into a placeholder of whole granules, leaving the remainder of the last granule
+    held as a placeholder, so truncate() can later remap the last view larger in place.
+    */
+    const size_t viewsize = utils::round_up_to_page_size((bytes != 0) ? bytes : static_cast<size_t>(sectionlength - offset), pagesize);
+    const size_t held = win32_round_up_to_allocation_size(viewsize);
+    addr = win32_placeholder_api().VirtualAlloc2(GetCurrentProcess(), nullptr, held, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, nullptr, 0);
+    if(addr != nullptr)
+    {
+      if(win32_map_into_placeholder(section.native_handle().h, static_cast<byte *>(addr), viewsize, held, 1, offset, allocation, prot))
+      {
+        _bytes = viewsize;
+        ret.value()._placeholder = true;
+      }
+      else
+      {
+        // Not every kind of view can replace a placeholder, so fall back to an ordinary view
+        (void) VirtualFree(addr, 0, MEM_RELEASE);
+        addr = nullptr;
+      }
+    }
+  }
+  if(addr == nullptr)
+#endif
   {
-    return ntkernel_error(ntstat);
+    NTSTATUS ntstat = NtMapViewOfSection(section.native_handle().h, GetCurrentProcess(), &addr, 0, commitsize, &_offset, &_bytes, ViewUnmap, allocation, prot);
+    if(ntstat < 0)
+    {
+      return ntkernel_error(ntstat);
+    }
   }
   ret.value()._addr = static_cast<byte *>(addr);
   ret.value()._offset = offset;
@@ -635,6 +909,84 @@ result<map_handle> map_handle::map(section_handle &section, size_type bytes, ext
   return ret;
 }
 
+result<map_handle> map_handle::map_mirrored(section_handle &section, size_type bytes, extent_type offset, section_handle::flag _flag) noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  const auto granularity = utils::allocation_granularity();
+  if(bytes == 0u || (bytes & (granularity - 1)) != 0 || (offset & (granularity - 1)) != 0 || (_flag & section_handle::flag::cow))
+  {
+    return errc::invalid_argument;
+  }
+  OUTCOME_TRY(auto &&length, section.length());  // length of the backing file
+  if(length < offset + bytes)
+  {
+    return errc::argument_out_of_domain;
+  }
+  result<map_handle> ret{map_handle(&section, _flag)};
+  native_handle_type &nativeh = ret.value()._v;
+  ULONG allocation = 0, prot;
+  size_t commitsize = bytes;
+  OUTCOME_TRY(auto &&pagesize, detail::pagesize_from_flags(ret.value()._flag));
+  if(pagesize != utils::page_size())
+  {
+    return errc::invalid_argument;
+  }
+  OUTCOME_TRY(win32_map_flags(nativeh, allocation, prot, commitsize, false, ret.value()._flag));
+  LLFIO_LOG_FUNCTION_CALL(&ret);
+  /* Find address space free for both views, release it, and then place each view into it. Another
+  thread can take the address space in between, so retry a few times.
+  */
+  for(size_t attempt = 0; attempt < 16; attempt++)
+  {
+    auto *addr = static_cast<byte *>(VirtualAlloc(nullptr, bytes * 2, MEM_RESERVE, PAGE_NOACCESS));
+    if(addr == nullptr)
+    {
+      return win32_error();
+    }
+    VirtualFree(addr, 0, MEM_RELEASE);
+    size_t placed = 0;
+    for(; placed < 2; placed++)
+    {
+      PVOID viewaddr = addr + placed * bytes;
+      LARGE_INTEGER _offset{};
+      _offset.QuadPart = offset;
+      SIZE_T _bytes = bytes;
+      NTSTATUS ntstat = NtMapViewOfSection(section.native_handle().h, GetCurrentProcess(), &viewaddr, 0, commitsize, &_offset, &_bytes, ViewUnmap, allocation, prot);
+      if(ntstat < 0)
+      {
+        // STATUS_CONFLICTING_ADDRESSES means we lost a race for the address space
+        if((NTSTATUS) 0xc0000018 /*STATUS_CONFLICTING_ADDRESSES*/ != ntstat)
+        {
+          if(placed > 0)
+          {
+            NtUnmapViewOfSection(GetCurrentProcess(), addr);
+          }
+          return ntkernel_error(ntstat);
+        }
+        break;
+      }
+    }
+    if(placed == 2)
+    {
+      ret.value()._addr = addr;
+      ret.value()._offset = offset;
+      ret.value()._reservation = bytes * 2;
+      ret.value()._length = bytes * 2;
+      ret.value()._pagesize = pagesize;
+      // Make my handle borrow the native handle of my backing storage
+      ret.value()._v.h = section.backing_native_handle().h;
+      nativeh.behaviour |= native_handle_type::disposition::allocation;
+      return ret;
+    }
+    if(placed > 0)
+    {
+      NtUnmapViewOfSection(GetCurrentProcess(), addr);
+    }
+  }
+  return errc::not_enough_memory;
+}
+
 result<map_handle::size_type> map_handle::truncate(size_type newsize, bool /* unused */) noexcept
 {
   windows_nt_kernel::init();
@@ -664,6 +1016,11 @@ result<map_handle::size_type> map_handle::truncate(size_type newsize, bool /* un
       _reservation = _length = newsize;
       return _reservation;
     }
+    if(_flag & section_handle::flag::nocommit)
+    {
+      // Keep the reservation ending on a granule boundary, so it can be extended in place again
+      newsize = win32_round_up_to_allocation_size(newsize);
+    }
     // Try to allocate another region directly after this one
     native_handle_type nativeh;
     DWORD allocation = MEM_RESERVE | MEM_COMMIT, prot;
@@ -681,6 +1038,15 @@ result<map_handle::size_type> map_handle::truncate(size_type newsize, bool /* un
   OUTCOME_TRY(auto &&length, _section->length());  // length of the backing file
   if(newsize < _reservation)
   {
+    if(_placeholder)
+    {
+      // Shrinking unmaps whole views, so the remainder of the last granule is no longer worth holding
+      if(win32_round_up_to_allocation_size(_reservation) > _reservation && VirtualFree(_addr + _reservation, 0, MEM_RELEASE) == 0)
+      {
+        return win32_error();
+      }
+      _placeholder = false;
+    }
     // If newsize isn't exactly a previous extension, this will fail, same as for the VirtualAlloc case
     OUTCOME_TRYV(win32_maps_apply(_addr + newsize, _reservation - newsize, win32_map_sought::committed, [](byte *addr, size_t /* unused */) -> result<void> {
       NTSTATUS ntstat = NtUnmapViewOfSection(GetCurrentProcess(), addr);
@@ -694,6 +1060,73 @@ result<map_handle::size_type> map_handle::truncate(size_type newsize, bool /* un
     _length = (length - _offset < newsize) ? (length - _offset) : newsize;  // length of backing, not reservation
     return _reservation;
   }
+#ifdef MEM_RESERVE_PLACEHOLDER
+  if(_placeholder)
+  {
+    const auto &api = win32_placeholder_api();
+    ULONG allocation = 0, prot;
+    size_t commitsize;
+    native_handle_type nativeh;
+    OUTCOME_TRY(win32_map_flags(nativeh, allocation, prot, commitsize, _section->backing() != nullptr, _flag));
+    HANDLE sectionh = _section->native_handle().h;
+    const size_type held = win32_round_up_to_allocation_size(_reservation), newheld = win32_round_up_to_allocation_size(newsize);
+    size_t pieces = (held > _reservation) ? 1 : 0;
+    // Take the address space after the granules already held first, which fails if anything else is there
+    if(newheld > held)
+    {
+      if(api.VirtualAlloc2(GetCurrentProcess(), _addr + held, newheld - held, MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, nullptr, 0) == nullptr)
+      {
+        return win32_error();
+      }
+      ++pieces;
+    }
+    /* Views must begin on a granule boundary, so a last view ending mid granule is unmapped back into
+    a placeholder and remapped larger. Its contents are in the section, so nothing is lost.
+    */
+    byte *start = _addr + _reservation;
+    if(held > _reservation)
+    {
+      MEMORY_BASIC_INFORMATION mbi;
+      if(VirtualQuery(_addr + _reservation - 1, &mbi, sizeof(mbi)) == 0 || api.UnmapViewOfFile2(GetCurrentProcess(), mbi.AllocationBase, MEM_PRESERVE_PLACEHOLDER) == 0)
+      {
+        auto ret = win32_error();
+        if(newheld > held)
+        {
+          (void) VirtualFree(_addr + held, 0, MEM_RELEASE);
+        }
+        return ret;
+      }
+      start = static_cast<byte *>(mbi.AllocationBase);
+      ++pieces;
+    }
+    auto mapped = win32_map_into_placeholder(sectionh, start, _addr + newsize - start, _addr + newheld - start, pieces, _offset + (start - _addr), allocation, prot);
+    if(!mapped)
+    {
+      // Put the address space back as it was
+      if(newheld > held)
+      {
+        if(start < _addr + held)
+        {
+          (void) VirtualFree(start, _addr + held - start, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER);
+        }
+        (void) VirtualFree(_addr + held, 0, MEM_RELEASE);
+      }
+      if(start < _addr + _reservation)
+      {
+        (void) VirtualFree(start, _addr + held - start, MEM_RELEASE | MEM_COALESCE_PLACEHOLDERS);
+      }
+      if(start < _addr + _reservation && !win32_map_into_placeholder(sectionh, start, _addr + _reservation - start, _addr + held - start, 1, _offset + (start - _addr), allocation, prot))
+      {
+        LLFIO_LOG_FATAL(this, "map_handle::truncate() could not restore the last view after failing to extend it");
+        abort();
+      }
+      return std::move(mapped).error();
+    }
+    _reservation = newsize;
+    _length = (length - _offset < newsize) ? (length - _offset) : newsize;  // length of backing, not reservation
+    return _reservation;
+  }
+#endif
   // Try to map an additional part of the section directly after this map
   ULONG allocation = MEM_RESERVE, prot;
   PVOID addr = _addr + _reservation;
@@ -720,6 +1153,7 @@ result<map_handle::buffer_type> map_handle::commit(buffer_type region, section_h
   {
     return errc::invalid_argument;
   }
+  _recyclable = false;
   DWORD prot = 0;
   if(flag == section_handle::flag::none)
   {
@@ -768,6 +1202,7 @@ result<map_handle::buffer_type> map_handle::decommit(buffer_type region) noexcep
     return errc::invalid_argument;
   }
   region = utils::round_to_page_size_larger(region, _pagesize);
+  _recyclable = false;
 #if 1
   OUTCOME_TRYV(win32_release_allocations(region.data(), region.size(), MEM_DECOMMIT));
 #else
@@ -845,6 +1280,77 @@ result<span<map_handle::buffer_type>> map_handle::prefetch(span<buffer_type> reg
   return regions;
 }
 
+result<void> map_handle::set_numa_placement(buffer_type region, numa_placement placement) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(0);
+  (void) region;
+  // Windows cannot change the placement of existing memory
+  if(placement == numa_placement())
+  {
+    return success();
+  }
+  return errc::operation_not_supported;
+}
+
+namespace detail
+{
+  inline result<void> map_handle_prefetch_batch(span<map_handle::buffer_type> regions) noexcept
+  {
+    windows_nt_kernel::init();
+    using namespace windows_nt_kernel;
+    // Windows 7 or earlier cannot prefetch
+    if(PrefetchVirtualMemory_ == nullptr || regions.empty())
+    {
+      return success();
+    }
+    auto wmre = reinterpret_cast<PWIN32_MEMORY_RANGE_ENTRY>(regions.data());
+    if(PrefetchVirtualMemory_(GetCurrentProcess(), regions.size(), wmre, 0) == 0)
+    {
+      return win32_error();
+    }
+    return success();
+  }
+}  // namespace detail
+
+result<map_handle::size_type> map_handle::prefetch_state::bytes_resident() const noexcept
+{
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  LLFIO_LOG_FUNCTION_CALL(0);
+  if(QueryWorkingSetEx_ == nullptr)
+  {
+    return errc::operation_not_supported;
+  }
+  const size_t pagesize = utils::page_size();
+  size_type ret = 0;
+  PSAPI_WORKING_SET_EX_INFORMATION info[512];
+  for(auto &region : _regions)
+  {
+    for(size_t offset = 0; offset < region.size();)
+    {
+      const size_t pages = std::min((region.size() - offset) / pagesize, sizeof(info) / sizeof(info[0]));
+      for(size_t n = 0; n < pages; n++)
+      {
+        info[n].VirtualAddress = region.data() + offset + n * pagesize;
+        info[n].VirtualAttributes = 0;
+      }
+      if(!QueryWorkingSetEx_(GetCurrentProcess(), info, (DWORD)(pages * sizeof(info[0]))))
+      {
+        return win32_error();
+      }
+      for(size_t n = 0; n < pages; n++)
+      {
+        if((info[n].VirtualAttributes & 1) != 0)
+        {
+          ret += pagesize;
+        }
+      }
+      offset += pages * pagesize;
+    }
+  }
+  return ret;
+}
+
 result<map_handle::buffer_type> map_handle::do_not_store(buffer_type region) noexcept
 {
   windows_nt_kernel::init();
@@ -931,6 +1437,7 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_write(io_r
   }
   byte *addr = _addr + reqs.offset;
   size_type togo = reqs.offset < _length ? static_cast<size_type>(_length - reqs.offset) : 0;
+  const bool nontemporal = !!(_flag & section_handle::flag::nontemporal_writes);
   if(QUICKCPPLIB_NAMESPACE::signal_guard::signal_guard(
      QUICKCPPLIB_NAMESPACE::signal_guard::signalc_set::undefined_memory_access,
      [&] {
@@ -939,14 +1446,14 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_write(io_r
          const_buffer_type &req = reqs.buffers[i];
          if(req.size() > togo)
          {
-           memcpy(addr, req.data(), togo);
+           detail::map_handle_copy_in(addr, req.data(), togo, nontemporal);
            req = {addr, togo};
            reqs.buffers = {reqs.buffers.data(), i + 1};
            return false;
          }
          else
          {
-           memcpy(addr, req.data(), req.size());
+           detail::map_handle_copy_in(addr, req.data(), req.size(), nontemporal);
            req = {addr, req.size()};
            addr += req.size();
            togo -= req.size();
@@ -966,6 +1473,10 @@ map_handle::io_result<map_handle::const_buffers_type> map_handle::_do_write(io_r
   {
     return errc::no_space_on_device;
   }
+  for(const auto &req : reqs.buffers)
+  {
+    mark_dirty(req);
+  }
   return reqs.buffers;
 }
 
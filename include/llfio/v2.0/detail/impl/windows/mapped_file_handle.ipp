@@ -68,9 +68,17 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
   {
     map_size = length;
   }
-  OUTCOME_TRYV(_mh.close());
+  // Try to map the extra reservation directly after the existing map, which keeps address() unchanged.
+  // Windows cannot shrink a map other than by an exact previous extension, so that always recreates the map.
+  // Maps within placeholders extend in place even if the old reservation does not end on a 64Kb boundary.
+  if(_mh.is_valid() && _mh.address() != nullptr && map_size > _mh.capacity() && _mh.truncate(map_size))
+  {
+    _publish_length();
+    _reservation = reservation;
+    return _reservation;
+  }
   OUTCOME_TRY(auto &&mh, map_handle::map(_sh, map_size, 0, mapflags));
-  _mh = std::move(mh);
+  OUTCOME_TRYV(_publish_map(std::move(mh)));
   _reservation = reservation;
   return _reservation;
 }
@@ -78,6 +86,7 @@ result<mapped_file_handle::size_type> mapped_file_handle::reserve(size_type rese
 result<void> mapped_file_handle::close() noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRYV(_close_epochs());
   if(_mh.is_valid())
   {
     OUTCOME_TRYV(_mh.close());
@@ -91,6 +100,7 @@ result<void> mapped_file_handle::close() noexcept
 native_handle_type mapped_file_handle::release() noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
+  (void) _close_epochs();
   if(_mh.is_valid())
   {
     (void) _mh.close();
@@ -109,6 +119,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
   if(newsize == 0)
   {
     OUTCOME_TRYV(_mh.close());
+    _publish_length();
     OUTCOME_TRYV(_sh.close());
     return file_handle::truncate(newsize);
   }
@@ -117,7 +128,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
     OUTCOME_TRY(auto &&ret, file_handle::truncate(newsize));
     if(newsize > _reservation)
     {
-      _reservation = newsize;
+      _reservation = _grown_reservation(newsize);
     }
     // Reserve now we have resized, it'll create a new section for the new size
     OUTCOME_TRYV(reserve(_reservation));
@@ -134,6 +145,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
     if(newsize < size)
     {
       OUTCOME_TRYV(_mh.close());
+      _publish_length();
       OUTCOME_TRYV(_sh.close());
       // This will fail on Windows if any other processes are holding a section on this file
       OUTCOME_TRY(auto &&ret, file_handle::truncate(newsize));
@@ -146,21 +158,23 @@ result<mapped_file_handle::extent_type> mapped_file_handle::truncate(extent_type
     // On Windows, resizing the section upwards maps the added extents into memory in all
     // processes using this singleton section
     OUTCOME_TRYV(_sh.truncate(newsize));
-    // Have we exceeded the reservation? If so, reserve a new reservation which will recreate the map.
+    // Have we exceeded the reservation? If so, grow the reservation geometrically so appends rarely remap.
     if(newsize > _reservation)
     {
-      OUTCOME_TRY(auto &&ret, reserve(newsize));
-      return ret;
+      OUTCOME_TRYV(reserve(_grown_reservation(newsize)));
+      return newsize;
     }
     size = newsize;
   }
   // Adjust the map to reflect the new size of the section
   _mh._length = size;
+  _publish_length();
   return newsize;
 }
 
 result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcept
 {
+  OUTCOME_TRYV(_reclaim_retired_map());
   OUTCOME_TRY(auto &&length, underlying_file_maximum_extent());
   if(length > _reservation)
   {
@@ -170,6 +184,7 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
   if(length == 0)
   {
     OUTCOME_TRYV(_mh.close());
+    _publish_length();
     OUTCOME_TRYV(_sh.close());
     return length;
   }
@@ -184,12 +199,14 @@ result<mapped_file_handle::extent_type> mapped_file_handle::update_map() noexcep
   {
     // Section is already the same size as the file, or is as big as it can go
     _mh._length = length;
+    _publish_length();
     return length;
   }
   // Nobody appears to have extended the section to match the file yet
   OUTCOME_TRYV(_sh.truncate(length));
   // Adjust the map to reflect the new size of the section
   _mh._length = length;
+  _publish_length();
   return length;
 }
 
@@ -27,7 +27,7 @@ Distributed under the Boost Software License, Version 1.0.
 
 LLFIO_V2_NAMESPACE_BEGIN
 
-result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_handle::mode _mode, pipe_handle::creation _creation, pipe_handle::caching _caching, pipe_handle::flag flags, const path_handle &base) noexcept
+result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_handle::mode _mode, pipe_handle::creation _creation, pipe_handle::caching _caching, pipe_handle::flag flags, const path_handle &base, size_t buffer_size) noexcept
 {
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
@@ -72,7 +72,7 @@ result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_han
   ntflags &= ~0x00000008 /*FILE_NO_INTERMEDIATE_BUFFERING*/;  // pipes always buffer
   IO_STATUS_BLOCK isb = make_iostatus();
 
-  path_view::c_str<> zpath(path, true);
+  path_view::recycling_c_str<> zpath(path, true);
   UNICODE_STRING _path{};
   if(path.empty())
   {
@@ -138,7 +138,8 @@ result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_han
     LARGE_INTEGER default_timeout{};
     memset(&default_timeout, 0, sizeof(default_timeout));
     default_timeout.QuadPart = -500000;
-    NTSTATUS ntstat = NtCreateNamedPipeFile(&nativeh.h, access, &oa, &isb, fileshare, creatdisp, ntflags, 0 /*FILE_PIPE_BYTE_STREAM_TYPE*/, 0 /*FILE_PIPE_BYTE_STREAM_MODE*/, 0 /*FILE_PIPE_QUEUE_OPERATION*/, (unsigned long) -1 /*FILE_PIPE_UNLIMITED_INSTANCES*/, 65536, 65536, &default_timeout);
+    const ULONG quota = (buffer_size != 0) ? static_cast<ULONG>((std::min)(buffer_size, static_cast<size_t>(ULONG_MAX))) : 65536;
+    NTSTATUS ntstat = NtCreateNamedPipeFile(&nativeh.h, access, &oa, &isb, fileshare, creatdisp, ntflags, 0 /*FILE_PIPE_BYTE_STREAM_TYPE*/, 0 /*FILE_PIPE_BYTE_STREAM_MODE*/, 0 /*FILE_PIPE_QUEUE_OPERATION*/, (unsigned long) -1 /*FILE_PIPE_UNLIMITED_INSTANCES*/, quota, quota, &default_timeout);
     if(STATUS_PENDING == ntstat)
     {
       ntstat = ntwait(nativeh.h, isb, deadline());
@@ -162,14 +163,14 @@ result<pipe_handle> pipe_handle::pipe(pipe_handle::path_view_type path, pipe_han
   return ret;
 }
 
-result<std::pair<pipe_handle, pipe_handle>> pipe_handle::anonymous_pipe(caching _caching, flag flags) noexcept
+result<std::pair<pipe_handle, pipe_handle>> pipe_handle::anonymous_pipe(caching _caching, flag flags, size_t buffer_size) noexcept
 {
   // Uses true anonymous pipe creation technique from https://stackoverflow.com/questions/40844884/windows-named-pipe-access-control
   windows_nt_kernel::init();
   using namespace windows_nt_kernel;
   // Create an unnamed new pipe
   flags &= ~flag::unlink_on_first_close;
-  OUTCOME_TRY(auto &&anonpipe, pipe({}, mode::read, creation::only_if_not_exist, _caching, flags));
+  OUTCOME_TRY(auto &&anonpipe, pipe({}, mode::read, creation::only_if_not_exist, _caching, flags, path_discovery::temporary_named_pipes_directory(), buffer_size));
   std::pair<pipe_handle, pipe_handle> ret(std::move(anonpipe), pipe_handle(native_handle_type(), 0, 0, _caching, flags, nullptr));
   native_handle_type &readnativeh = ret.first._v, &writenativeh = ret.second._v;
   DWORD fileshare = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
@@ -206,6 +207,51 @@ result<std::pair<pipe_handle, pipe_handle>> pipe_handle::anonymous_pipe(caching
   return ret;
 }
 
+result<size_t> pipe_handle::buffer_size() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  IO_STATUS_BLOCK isb = make_iostatus();
+  FILE_PIPE_LOCAL_INFORMATION fpli{};
+  NTSTATUS ntstat = NtQueryInformationFile(_v.h, &isb, &fpli, sizeof(fpli), FilePipeLocalInformation);
+  if(STATUS_PENDING == ntstat)
+  {
+    ntstat = ntwait(_v.h, isb, deadline());
+  }
+  if(ntstat < 0)
+  {
+    return ntkernel_error(ntstat);
+  }
+  return static_cast<size_t>(fpli.InboundQuota);
+}
+
+result<size_t> pipe_handle::set_buffer_size(size_t /*unused*/) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  // Quotas are fixed by NtCreateNamedPipeFile()
+  return errc::operation_not_supported;
+}
+
+result<size_t> pipe_handle::bytes_available() const noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  IO_STATUS_BLOCK isb = make_iostatus();
+  FILE_PIPE_LOCAL_INFORMATION fpli{};
+  NTSTATUS ntstat = NtQueryInformationFile(_v.h, &isb, &fpli, sizeof(fpli), FilePipeLocalInformation);
+  if(STATUS_PENDING == ntstat)
+  {
+    ntstat = ntwait(_v.h, isb, deadline());
+  }
+  if(ntstat < 0)
+  {
+    return ntkernel_error(ntstat);
+  }
+  return static_cast<size_t>(fpli.ReadDataAvailable);
+}
+
 pipe_handle::io_result<pipe_handle::buffers_type> pipe_handle::_do_read(pipe_handle::io_request<pipe_handle::buffers_type> reqs, deadline d) noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(this);
@@ -254,4 +300,34 @@ pipe_handle::io_result<pipe_handle::const_buffers_type> pipe_handle::_do_write(p
   return io_handle::_do_write(reqs, d);
 }
 
+result<size_t> pipe_handle::splice_from(io_handle &src, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::pipe_handle_splice_copy(*this, 0, src, offset, bytes, d);
+}
+
+result<size_t> pipe_handle::splice_to(io_handle &dest, extent_type offset, size_t bytes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return detail::pipe_handle_splice_copy(dest, offset, *this, 0, bytes, d);
+}
+
+result<size_t> pipe_handle::tee_to(pipe_handle & /*unused*/, size_t /*unused*/, deadline /*unused*/) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  return errc::operation_not_supported;
+}
+
+result<size_t> pipe_handle::splice_from(const_buffers_type buffers, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(this);
+  OUTCOME_TRY(auto &&written, write({buffers, 0}, d));
+  size_t ret = 0;
+  for(auto &i : written)
+  {
+    ret += i.size();
+  }
+  return ret;
+}
+
 LLFIO_V2_NAMESPACE_END
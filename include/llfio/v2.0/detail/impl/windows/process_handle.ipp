@@ -161,7 +161,86 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC const process_handle &process_handle::current()
   return self;
 }
 
+namespace detail
+{
+  // The environment as the block of zero terminated strings which CreateProcessW() needs
+  inline result<void> windows_process_environment(wchar_t (&envbuffer)[32768], span<path_view_component> env) noexcept
+  {
+    wchar_t *envbuffere = envbuffer;
+    for(auto i : env)
+    {
+      OUTCOME_TRY(visit(i, [&](auto sv) -> result<void> {
+        for(auto c : sv)
+        {
+          if(envbuffere - envbuffer >= 32767)
+          {
+            return errc::value_too_large;
+          }
+          *envbuffere++ = c;
+        }
+        if(envbuffere - envbuffer >= 32767)
+        {
+          return errc::value_too_large;
+        }
+        *envbuffere++ = 0;
+        return success();
+      }));
+    }
+    *envbuffere = 0;
+    return success();
+  }
+}  // namespace detail
+
 LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> process_handle::launch_process(path_view path, span<path_view_component> args, span<path_view_component> env, flag flags) noexcept
+{
+  wchar_t envbuffer[32768];
+  OUTCOME_TRY(detail::windows_process_environment(envbuffer, env));
+  return _launch_process(path, args, envbuffer, flags);
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::vector<process_handle>> process_handle::launch_processes(span<const launch_request> reqs, span<path_view_component> env) noexcept
+{
+  try
+  {
+    wchar_t envbuffer[32768];
+    OUTCOME_TRY(detail::windows_process_environment(envbuffer, env));
+    std::vector<process_handle> ret;
+    ret.reserve(reqs.size());
+    for(const auto &req : reqs)
+    {
+      OUTCOME_TRY(auto &&h, _launch_process(req.path, req.args, envbuffer, req.flags));
+      ret.push_back(std::move(h));
+    }
+    return ret;
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> process_handle::wait_all(span<const process_handle> processes, span<intptr_t> exitcodes, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(0);
+  if(exitcodes.size() < processes.size())
+  {
+    return errc::invalid_argument;
+  }
+  // Share the deadline amongst all the waits, each of which sleeps in the kernel
+  deadline nd(d);
+  if(d && d.steady)
+  {
+    nd = deadline(std::chrono::system_clock::now() + std::chrono::nanoseconds(d.nsecs));
+  }
+  for(size_t n = 0; n < processes.size(); n++)
+  {
+    OUTCOME_TRY(auto &&exitcode, processes[n].wait(nd));
+    exitcodes[n] = exitcode;
+  }
+  return success();
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> process_handle::_launch_process(path_view path, span<path_view_component> args, const void *marshalled_env, flag flags) noexcept
 {
   result<process_handle> ret(in_place_type<process_handle>, native_handle_type(), flags);
   native_handle_type &nativeh = ret.value()._v;
@@ -247,30 +326,9 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> process_handle::launch_pr
     }));
   }
   *(--argsbuffere) = 0;
-  wchar_t envbuffer[32768], *envbuffere = envbuffer;
-  for(auto i : env)
-  {
-    OUTCOME_TRY(visit(i, [&](auto sv) -> result<void> {
-      for(auto c : sv)
-      {
-        if(envbuffere - envbuffer >= sizeof(envbuffer))
-        {
-          return errc::value_too_large;
-        }
-        *envbuffere++ = c;
-      }
-      if(envbuffere - envbuffer >= sizeof(argsbuffer))
-      {
-        return errc::value_too_large;
-      }
-      *envbuffere++ = 0;
-      return success();
-    }));
-  }
-  *envbuffere = 0;
-  path_view::c_str<> zpath(path);
+  path_view::recycling_c_str<> zpath(path);
   PROCESS_INFORMATION pi;
-  if(!CreateProcessW(zpath.buffer, argsbuffer, nullptr, nullptr, true, CREATE_UNICODE_ENVIRONMENT, envbuffer, nullptr, &si, &pi))
+  if(!CreateProcessW(zpath.buffer, argsbuffer, nullptr, nullptr, true, CREATE_UNICODE_ENVIRONMENT, const_cast<void *>(marshalled_env), nullptr, &si, &pi))
     return win32_error();
   nativeh.h = pi.hProcess;
   (void) CloseHandle(pi.hThread);
@@ -23,6 +23,7 @@ Distributed under the Boost Software License, Version 1.0.
 */
 
 #include "../../../handle.hpp"
+#include "../../../path_handle.hpp"
 #include "../../../stat.hpp"
 #include "import.hpp"
 
@@ -226,6 +227,72 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> stat_t::fill(const handle &h, sta
   return ret;
 }
 
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> stat_t::fill_many(const path_handle &base, span<fill_many_item> items) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  windows_nt_kernel::init();
+  using namespace windows_nt_kernel;
+  try
+  {
+    // Opening for attribute reading only, and sharing everything, neither blocks nor is blocked by anyone else
+    const DWORD fileshare = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    auto open_for_attributes = [&](path_view leafname) -> result<handle> {
+      HANDLE h = nullptr;
+      if(base.is_valid() || leafname.is_ntpath())
+      {
+        path_view::recycling_c_str<> zpath(leafname, true);
+        UNICODE_STRING _path{};
+        _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
+        _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
+        if(zpath.length >= 4 && _path.Buffer[0] == '\\' && _path.Buffer[1] == '!' && _path.Buffer[2] == '!' && _path.Buffer[3] == '\\')
+        {
+          _path.Buffer += 3;
+          _path.Length -= 3 * sizeof(wchar_t);
+          _path.MaximumLength -= 3 * sizeof(wchar_t);
+        }
+        OBJECT_ATTRIBUTES oa{};
+        memset(&oa, 0, sizeof(oa));
+        oa.Length = sizeof(OBJECT_ATTRIBUTES);
+        oa.ObjectName = &_path;
+        oa.RootDirectory = base.is_valid() ? base.native_handle().h : nullptr;
+        IO_STATUS_BLOCK isb = make_iostatus();
+        NTSTATUS ntstat = NtOpenFile(&h, FILE_READ_ATTRIBUTES | SYNCHRONIZE, &oa, &isb, fileshare,
+                                     0x20 /*FILE_SYNCHRONOUS_IO_NONALERT*/ | 0x4000 /*FILE_OPEN_FOR_BACKUP_INTENT*/ | 0x00200000 /*FILE_OPEN_REPARSE_POINT*/);
+        if(ntstat < 0)
+        {
+          return ntkernel_error(ntstat);
+        }
+      }
+      else
+      {
+        path_view::recycling_c_str<> zpath(leafname, false);
+        if(INVALID_HANDLE_VALUE == (h = CreateFileW_(zpath.buffer, FILE_READ_ATTRIBUTES, fileshare, nullptr, OPEN_EXISTING,
+                                                     FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT, nullptr)))  // NOLINT
+        {
+          return win32_error();
+        }
+      }
+      return handle(native_handle_type(native_handle_type::disposition::file, h));
+    };
+    for(auto &item : items)
+    {
+      item.stat = stat_t(nullptr);
+      auto fh = open_for_attributes(item.leafname);
+      if(!fh)
+      {
+        item.filled = std::move(fh).error();
+        continue;
+      }
+      item.filled = item.stat.fill(fh.value(), item.wanted);
+    }
+    return success();
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
 LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<stat_t::want> stat_t::stamp(handle &h, stat_t::want wanted) noexcept
 {
   LLFIO_LOG_FUNCTION_CALL(&h);
@@ -430,6 +430,36 @@ namespace storage_profile
               }
             }
             sp.device_size.value = dg->DiskSize.QuadPart;
+
+            // Get the physical sector size and seek penalty, which not all drivers implement
+            auto query = [&](STORAGE_PROPERTY_ID id) {
+              memset(&spq, 0, sizeof(spq));
+              spq.PropertyId = id;
+              spq.QueryType = PropertyStandardQuery;
+              ol.Internal = static_cast<ULONG_PTR>(-1);
+              if(DeviceIoControl(diskh.native_handle().h, IOCTL_STORAGE_QUERY_PROPERTY, &spq, sizeof(spq), buffer, sizeof(buffer), nullptr, &ol) == 0)
+              {
+                if(ERROR_IO_PENDING == GetLastError())
+                {
+                  return ntwait(diskh.native_handle().h, ol, deadline()) == 0;
+                }
+                return ERROR_SUCCESS == GetLastError();
+              }
+              return true;
+            };
+            if(query(StorageAccessAlignmentProperty))
+            {
+              auto *aad = reinterpret_cast<STORAGE_ACCESS_ALIGNMENT_DESCRIPTOR *>(buffer);
+              sp.device_physical_block_size.value = aad->BytesPerPhysicalSector;
+              // NT does not report RAID chunk sizes nor stripe widths
+              sp.device_minimum_io_size.value = aad->BytesPerPhysicalSector;
+              sp.device_optimal_io_size.value = 0;
+            }
+            if(query(StorageDeviceSeekPenaltyProperty))
+            {
+              auto *dsp = reinterpret_cast<DEVICE_SEEK_PENALTY_DESCRIPTOR *>(buffer);
+              sp.device_rotational.value = (dsp->IncursSeekPenalty != 0) ? 1 : 0;
+            }
           }
         }
         catch(...)
@@ -438,8 +468,93 @@ namespace storage_profile
         }
         return success();
       }
+
+      // The queue limits are queried from the physical disk by _device()
+      outcome<void> _device_queue_limits(storage_profile & /*unused*/, file_handle & /*unused*/) noexcept { return success(); }
+
+      // Volume serial number of the volume the file is on
+      std::string _device_serial(file_handle &h) noexcept
+      {
+        DWORD serial = 0;
+        if(GetVolumeInformationByHandleW(h.native_handle().h, nullptr, 0, &serial, nullptr, nullptr, nullptr, 0) == 0)
+        {
+          return {};
+        }
+        char buffer[16];
+        snprintf(buffer, sizeof(buffer), "%08lx", (unsigned long) serial);
+        return buffer;
+      }
+
+      // NT does not report the power fail atomic write size of the device
+      io_handle::extent_type _device_atomic_write_unit_max(file_handle & /*unused*/) noexcept { return 0; }
+
+      // Bytes written to the volume the file is on since the disk performance counters were enabled.
+      // NT does not count cache flushes.
+      outcome<std::pair<unsigned long long, unsigned long long>> _device_write_counters(file_handle &h) noexcept
+      {
+        try
+        {
+          statfs_t fsinfo;
+          OUTCOME_TRYV(fsinfo.fill(h, statfs_t::want::mntfromname));
+          OUTCOME_TRY(auto &&volumeh, file_handle::file({}, fsinfo.f_mntfromname, handle::mode::none, handle::creation::open_existing, handle::caching::only_metadata));
+          DISK_PERFORMANCE dp{};
+          OVERLAPPED ol{};
+          memset(&ol, 0, sizeof(ol));
+          ol.Internal = static_cast<ULONG_PTR>(-1);
+          if(DeviceIoControl(volumeh.native_handle().h, IOCTL_DISK_PERFORMANCE, nullptr, 0, &dp, sizeof(dp), nullptr, &ol) == 0)
+          {
+            if(ERROR_IO_PENDING == GetLastError())
+            {
+              NTSTATUS ntstat = ntwait(volumeh.native_handle().h, ol, deadline());
+              if(ntstat != 0)
+              {
+                return ntkernel_error(ntstat);
+              }
+            }
+            if(ERROR_SUCCESS != GetLastError())
+            {
+              return win32_error();
+            }
+          }
+          return std::pair<unsigned long long, unsigned long long>(static_cast<unsigned long long>(dp.BytesWritten.QuadPart), static_cast<unsigned long long>(-1));
+        }
+        catch(...)
+        {
+          return std::current_exception();
+        }
+      }
     }  // namespace windows
   }    // namespace storage
+
+  result<filesystem::path> cache_directory() noexcept
+  {
+    try
+    {
+      filesystem::path::string_type buffer(32768, 0);
+      auto get = [&buffer](const wchar_t *variable) {
+        DWORD len = GetEnvironmentVariableW(variable, const_cast<LPWSTR>(buffer.data()), static_cast<DWORD>(buffer.size()));
+        if(len == 0 || len >= buffer.size())
+        {
+          return false;
+        }
+        buffer.resize(len);
+        return true;
+      };
+      if(get(L"LLFIO_STORAGE_PROFILE_CACHE"))
+      {
+        return filesystem::path(buffer);
+      }
+      if(get(L"LOCALAPPDATA"))
+      {
+        return filesystem::path(buffer) / "llfio" / "storage_profiles";
+      }
+      return errc::no_such_file_or_directory;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
 }  // namespace storage_profile
 
 LLFIO_V2_NAMESPACE_END
@@ -107,7 +107,7 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<symlink_handle> symlink_handle::symlink(c
     ntflags |= 0x040 /*FILE_NON_DIRECTORY_FILE*/;  // do not open a directory
     IO_STATUS_BLOCK isb = make_iostatus();
 
-    path_view::c_str<> zpath(path, true);
+    path_view::recycling_c_str<> zpath(path, true);
     UNICODE_STRING _path{};
     _path.Buffer = const_cast<wchar_t *>(zpath.buffer);
     _path.MaximumLength = (_path.Length = static_cast<USHORT>(zpath.length * sizeof(wchar_t))) + sizeof(wchar_t);
@@ -161,7 +161,7 @@ LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<symlink_handle> symlink_handle::symlink(c
     }
     // required to open a symlink
     attribs |= FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT;
-    path_view::c_str<> zpath(path, false);
+    path_view::recycling_c_str<> zpath(path, false);
     if(INVALID_HANDLE_VALUE == (nativeh.h = CreateFileW_(zpath.buffer, access, fileshare, nullptr, creation, attribs, nullptr)))  // NOLINT
     {
       DWORD errcode = GetLastError();
@@ -247,7 +247,7 @@ result<symlink_handle::const_buffers_type> symlink_handle::write(symlink_handle:
   auto *buffer = req.kernelbuffer.empty() ? alloca(buffersize) : req.kernelbuffer.data();
   memset(buffer, 0, sizeof(REPARSE_DATA_BUFFER));
   auto *rpd = (REPARSE_DATA_BUFFER *) buffer;
-  path_view::c_str<> zpath(req.buffers.path(), true);
+  path_view::recycling_c_str<> zpath(req.buffers.path(), true);
   switch(req.buffers.type())
   {
   case symlink_type::none:
@@ -315,4 +315,32 @@ result<symlink_handle::const_buffers_type> symlink_handle::write(symlink_handle:
   return success(std::move(req.buffers));
 }
 
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> symlink_handle::read_many(const path_handle &base, span<read_many_item> items) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  for(auto &item : items)
+  {
+    item.read = [&]() -> result<void> {
+      OUTCOME_TRY(auto &&h, symlink(base, item.leafname));
+      OUTCOME_TRY(item.buffers, h.read(item.kernelbuffer));
+      return success();
+    }();
+  }
+  return success();
+}
+
+LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> symlink_handle::create_many(const path_handle &base, span<create_many_item> items, deadline d) noexcept
+{
+  LLFIO_LOG_FUNCTION_CALL(&base);
+  for(auto &item : items)
+  {
+    item.created = [&]() -> result<void> {
+      OUTCOME_TRY(auto &&h, symlink(base, item.leafname, mode::write, item.atomic_replace ? creation::if_needed : creation::only_if_not_exist));
+      OUTCOME_TRYV(h.write({const_buffers_type(item.target, item.type)}, d));
+      return success();
+    }();
+  }
+  return success();
+}
+
 LLFIO_V2_NAMESPACE_END
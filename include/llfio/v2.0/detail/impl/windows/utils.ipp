@@ -23,9 +23,12 @@ Distributed under the Boost Software License, Version 1.0.
 */
 
 #include "../../../utils.hpp"
+#include "../utils.ipp"
 
 #include "import.hpp"
 
+#include <thread>
+
 LLFIO_V2_NAMESPACE_BEGIN
 
 namespace utils
@@ -47,10 +50,34 @@ namespace utils
     }
     return ret;
   }
+  size_t allocation_granularity() noexcept
+  {
+    static size_t ret;
+    if(ret == 0u)
+    {
+      SYSTEM_INFO si{};
+      memset(&si, 0, sizeof(si));
+      GetSystemInfo(&si);
+      ret = si.dwAllocationGranularity;
+    }
+    return ret;
+  }
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable : 6387)  // MSVC sanitiser warns that GetModuleHandleA() might fail (hah!)
 #endif
+  namespace detail
+  {
+#ifdef MEM_EXTENDED_PARAMETER_NONPAGED_HUGE
+    using VirtualAlloc2_t = PVOID(WINAPI *)(HANDLE, PVOID, SIZE_T, ULONG, ULONG, MEM_EXTENDED_PARAMETER *, ULONG);
+    // 1Gb pages can only be allocated using VirtualAlloc2(), which is Windows 10 1803 onwards
+    inline VirtualAlloc2_t VirtualAlloc2_() noexcept
+    {
+      static VirtualAlloc2_t v = reinterpret_cast<VirtualAlloc2_t>(GetProcAddress(GetModuleHandleW(L"kernelbase.dll"), "VirtualAlloc2"));
+      return v;
+    }
+#endif
+  }  // namespace detail
   const std::vector<size_t> &page_sizes(bool only_actually_available)
   {
     static spinlock lock;
@@ -70,6 +97,13 @@ namespace utils
         windows_nt_kernel::init();
         using namespace windows_nt_kernel;
         pagesizes.push_back(GetLargePageMinimum_());
+#ifdef MEM_EXTENDED_PARAMETER_NONPAGED_HUGE
+        const bool have_huge = (detail::VirtualAlloc2_() != nullptr && GetLargePageMinimum_() < 1024 * 1024 * 1024);
+        if(have_huge)
+        {
+          pagesizes.push_back(1024 * 1024 * 1024);
+        }
+#endif
         /* Attempt to enable SeLockMemoryPrivilege */
         HANDLE token;
         if(OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token) != 0)
@@ -84,6 +118,12 @@ namespace utils
             if((AdjustTokenPrivileges(token, FALSE, &privs, 0, nullptr, nullptr) != 0) && GetLastError() == S_OK)
             {
               pagesizes_available.push_back(GetLargePageMinimum_());
+#ifdef MEM_EXTENDED_PARAMETER_NONPAGED_HUGE
+              if(have_huge)
+              {
+                pagesizes_available.push_back(1024 * 1024 * 1024);
+              }
+#endif
             }
           }
         }
@@ -95,16 +135,19 @@ namespace utils
 #pragma warning(pop)
 #endif
 
-  void random_fill(char *buffer, size_t bytes) noexcept
+  namespace detail
   {
-    windows_nt_kernel::init();
-    using namespace windows_nt_kernel;
-    if(RtlGenRandom(buffer, static_cast<ULONG>(bytes)) == 0u)
+    void kernel_random_fill(char *buffer, size_t bytes) noexcept
     {
-      LLFIO_LOG_FATAL(0, "llfio: Kernel crypto function failed");
-      std::terminate();
+      windows_nt_kernel::init();
+      using namespace windows_nt_kernel;
+      if(RtlGenRandom(buffer, static_cast<ULONG>(bytes)) == 0u)
+      {
+        LLFIO_LOG_FATAL(0, "llfio: Kernel crypto function failed");
+        std::terminate();
+      }
     }
-  }
+  }  // namespace detail
 
   result<void> flush_modified_data() noexcept
   {
@@ -205,7 +248,7 @@ namespace utils
     return success();
   }
 
-  result<process_memory_usage> current_process_memory_usage() noexcept {
+  result<process_memory_usage> current_process_memory_usage(process_memory_usage::want /*unused*/) noexcept {
     // Amazingly Win32 doesn't expose private working set, so to avoid having
     // to iterate all the pages in the process and calculate, use a hidden
     // NT kernel call
@@ -241,29 +284,171 @@ namespace utils
 
   namespace detail
   {
-    large_page_allocation allocate_large_pages(size_t bytes)
+    struct memory_pressure_monitor_t
     {
-      large_page_allocation ret(calculate_large_page_allocation(bytes));
-      DWORD type = MEM_COMMIT | MEM_RESERVE;
-      if(ret.page_size_used > 65536)
+      std::mutex lock;
+      std::thread thread;
+      HANDLE stop{nullptr}, low_memory{nullptr};
+
+      void close_handles() noexcept
       {
-        type |= MEM_LARGE_PAGES;
+        for(HANDLE *h : {&stop, &low_memory})
+        {
+          if(*h != nullptr)
+          {
+            CloseHandle(*h);
+            *h = nullptr;
+          }
+        }
       }
-      ret.p = VirtualAlloc(nullptr, ret.actual_size, type, PAGE_READWRITE);
-      if(ret.p == nullptr)
+
+      void run() noexcept
       {
-        if(ERROR_NOT_ENOUGH_MEMORY == GetLastError())
+        for(;;)
         {
-          ret.p = VirtualAlloc(nullptr, ret.actual_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+          HANDLE hs[2] = {stop, low_memory};
+          auto ret = WaitForMultipleObjects(2, hs, FALSE, 1000);
+          if(ret == WAIT_OBJECT_0 || ret == WAIT_FAILED)
+          {
+            return;
+          }
+          if(ret == WAIT_OBJECT_0 + 1)
+          {
+            notify_memory_pressure(memory_pressure::critical);
+            // The notification remains signalled until memory is no longer low, so don't spin
+            if(WaitForSingleObject(stop, 1000) != WAIT_TIMEOUT)
+            {
+              return;
+            }
+            continue;
+          }
+          MEMORYSTATUSEX ms{};
+          ms.dwLength = sizeof(ms);
+          if(GlobalMemoryStatusEx(&ms) != 0 && ms.dwMemoryLoad >= 90)
+          {
+            notify_memory_pressure(memory_pressure::low);
+          }
         }
       }
-#ifndef NDEBUG
-      else if(ret.page_size_used > 65536)
+    };
+    inline memory_pressure_monitor_t &memory_pressure_monitor() noexcept
+    {
+      // Deliberately leaked so a running monitor thread does not terminate the process on exit
+      static memory_pressure_monitor_t *v = new memory_pressure_monitor_t;
+      return *v;
+    }
+  }  // namespace detail
+
+  result<void> start_memory_pressure_monitor() noexcept
+  {
+    try
+    {
+      auto &monitor = detail::memory_pressure_monitor();
+      std::lock_guard<std::mutex> g(monitor.lock);
+      if(monitor.thread.joinable())
+      {
+        return success();
+      }
+      monitor.low_memory = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+      if(monitor.low_memory == nullptr)
+      {
+        return win32_error();
+      }
+      monitor.stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+      if(monitor.stop == nullptr)
+      {
+        auto ret = win32_error();
+        monitor.close_handles();
+        return ret;
+      }
+      try
+      {
+        monitor.thread = std::thread([&monitor] { monitor.run(); });
+      }
+      catch(...)
+      {
+        monitor.close_handles();
+        throw;
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  void stop_memory_pressure_monitor() noexcept
+  {
+    auto &monitor = detail::memory_pressure_monitor();
+    std::lock_guard<std::mutex> g(monitor.lock);
+    if(!monitor.thread.joinable())
+    {
+      return;
+    }
+    SetEvent(monitor.stop);
+    monitor.thread.join();
+    monitor.close_handles();
+  }
+
+  namespace detail
+  {
+    large_page_allocation allocate_large_pages(size_t bytes, size_t pagesize, bool permit_fallback)
+    {
+      large_page_allocation ret(calculate_large_page_allocation(bytes));
+      if(pagesize != 0)
       {
-        printf("llfio: Large page allocation successful\n");
+        ret.page_size_used = pagesize;
+        ret.actual_size = (bytes + pagesize - 1) & ~(pagesize - 1);
       }
+      for(;;)
+      {
+        DWORD type = MEM_COMMIT | MEM_RESERVE;
+        if(ret.page_size_used > 65536)
+        {
+          type |= MEM_LARGE_PAGES;
+        }
+        ret.p = nullptr;
+#ifdef MEM_EXTENDED_PARAMETER_NONPAGED_HUGE
+        if(ret.page_size_used >= 1024 * 1024 * 1024 && VirtualAlloc2_() != nullptr)
+        {
+          MEM_EXTENDED_PARAMETER param{};
+          memset(&param, 0, sizeof(param));
+          param.Type = MemExtendedParameterAttributeFlags;
+          param.ULong64 = MEM_EXTENDED_PARAMETER_NONPAGED_HUGE;
+          ret.p = VirtualAlloc2_()(GetCurrentProcess(), nullptr, ret.actual_size, type, PAGE_READWRITE, &param, 1);
+        }
+        else
+#endif
+        {
+          ret.p = VirtualAlloc(nullptr, ret.actual_size, type, PAGE_READWRITE);
+        }
+        if(ret.p != nullptr)
+        {
+#ifndef NDEBUG
+          if(ret.page_size_used > 65536)
+          {
+            printf("llfio: Large page allocation successful\n");
+          }
 #endif
-      return ret;
+          return ret;
+        }
+        if(!permit_fallback || ret.page_size_used <= page_size())
+        {
+          return ret;
+        }
+        // Fall back to the next smaller page size available, or else to ordinary pages
+        size_t next = page_size();
+        for(auto i : page_sizes(true))
+        {
+          if(i < ret.page_size_used && i > next)
+          {
+            next = i;
+          }
+        }
+        ret.page_size_used = next;
+        ret.actual_size = (bytes + next - 1) & ~(next - 1);
+      }
     }
     void deallocate_large_pages(void *p, size_t bytes)
     {
@@ -0,0 +1,501 @@
+/* A write ahead log with group commit and preallocated segments
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../../algorithm/write_ahead_log.hpp"
+#include "../../algorithm/handle_adapter/checksumming.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+namespace algorithm
+{
+  namespace detail
+  {
+    // The first block of every segment begins with this
+    struct write_ahead_log_segment_header
+    {
+      char magic[8];
+      uint64_t seq;
+      uint64_t first_lsn;
+      uint64_t segment_size;
+      uint32_t crc;  // CRC32C of the preceding members
+      uint32_t reserved;
+    };
+    static constexpr char write_ahead_log_magic[8] = {'L', 'L', 'F', 'I', 'O', 'W', 'A', 'L'};
+
+    // A record's frame is its CRC32C, its length, and its log sequence number, followed by the record
+    // padded to eight bytes. The CRC covers the record, then the length and log sequence number.
+    inline uint32_t write_ahead_log_frame_crc(uint32_t record_crc, const byte *frame) noexcept { return ~crc32c_update(record_crc, frame + 4, 12); }
+  }  // namespace detail
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC std::string write_ahead_log::_leafname(uint64_t seq, bool free)
+  {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), free ? "%016llx.free" : "%016llx.wal", (unsigned long long) seq);
+    return buffer;
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> write_ahead_log::_sync_directory() noexcept
+  {
+#ifndef _WIN32
+    // Make the creation, renaming and removal of segments durable
+    if(-1 == ::fsync(_dirh.native_handle().fd))
+    {
+      return posix_error();
+    }
+#endif
+    // Windows cannot flush a directory, but NTFS journals its metadata before returning
+    return success();
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<file_handle> write_ahead_log::_open_segment(uint64_t seq, bool free, file_handle::creation creation) noexcept
+  {
+    OUTCOME_TRY(auto &&fh, file_handle::file(_dirh, _leafname(seq, free), file_handle::mode::write, creation));
+    if(_direct)
+    {
+      // Not every filing system permits uncached i/o, in which case the durable writes go through the cache
+      auto r = fh.reopen(file_handle::mode::unchanged, file_handle::caching::none);
+      if(r)
+      {
+        return std::move(r).value();
+      }
+      _direct = false;
+    }
+    return std::move(fh);
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> write_ahead_log::_retire(file_handle &fh, uint64_t seq) noexcept
+  {
+    try
+    {
+      if(_free.size() < _max_free_segments)
+      {
+        _free.reserve(_free.size() + 1);
+        OUTCOME_TRY(fh.relink(_dirh, _leafname(seq, true)));
+        _free.push_back(seq);
+        return success();
+      }
+      return fh.unlink();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> write_ahead_log::_begin_segment(lsn_type first_lsn) noexcept
+  {
+    try
+    {
+      const uint64_t seq = _next_seq;
+      file_handle fh;
+      if(!_free.empty())
+      {
+        // Reuse a retired segment, which is already allocated. The records left within it have
+        // log sequence numbers below first_lsn, so recovery never mistakes them for new ones.
+        OUTCOME_TRY(fh, _open_segment(_free.back(), true, file_handle::creation::open_existing));
+        OUTCOME_TRY(fh.relink(_dirh, _leafname(seq, false)));
+        _free.pop_back();
+        OUTCOME_TRY(auto &&extent, fh.maximum_extent());
+        if(extent < _segment_size)
+        {
+          OUTCOME_TRY(fh.truncate(_segment_size));
+        }
+      }
+      else
+      {
+        OUTCOME_TRY(fh, _open_segment(seq, false, file_handle::creation::only_if_not_exist));
+        if(!fh.allocate({0, _segment_size}))
+        {
+          OUTCOME_TRY(fh.truncate(_segment_size));
+        }
+      }
+      _live.push_back({seq, first_lsn});
+      _next_seq = seq + 1;
+      _buffer_type block(_block_size);
+      detail::write_ahead_log_segment_header header{};
+      memcpy(header.magic, detail::write_ahead_log_magic, sizeof(header.magic));
+      header.seq = seq;
+      header.first_lsn = first_lsn;
+      header.segment_size = _segment_size;
+      header.crc = detail::crc32c(reinterpret_cast<const byte *>(&header), offsetof(detail::write_ahead_log_segment_header, crc));
+      memcpy(block.data(), &header, sizeof(header));
+      file_handle::const_buffer_type buffers[] = {{block.data(), block.size()}};
+      OUTCOME_TRY(fh.write({buffers, 0, file_handle::write_flag::data_sync}));
+      OUTCOME_TRY(_sync_directory());
+      _current = std::move(fh);
+      _current_offset = _block_size;
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> write_ahead_log::_write_batch() noexcept
+  {
+    try
+    {
+      while(!_batch.empty())
+      {
+        // Find the whole frames which fit within the current segment
+        const extent_type room = _segment_size - _current_offset;
+        size_t end = 0;
+        while(end < _batch.size())
+        {
+          uint32_t length;
+          memcpy(&length, _batch.data() + end + 4, sizeof(length));
+          const size_t frame_size = _frame_size(length);
+          if(end + frame_size > room)
+          {
+            break;
+          }
+          end += frame_size;
+        }
+        if(end == 0)
+        {
+          lsn_type first_lsn;
+          memcpy(&first_lsn, _batch.data() + 8, sizeof(first_lsn));
+          OUTCOME_TRY(_begin_segment(first_lsn));
+          continue;
+        }
+        // Pad with zeros to the next block, and defer the frames for the next segment
+        _buffer_type tail;
+        if(end < _batch.size())
+        {
+          tail.assign(_batch.begin() + end, _batch.end());
+        }
+        _batch.resize(end);
+        _batch.resize(static_cast<size_t>((end + _block_size - 1) & ~(_block_size - 1)));
+        file_handle::const_buffer_type buffers[] = {{_batch.data(), _batch.size()}};
+        OUTCOME_TRY(auto &&written, _current.write({buffers, _current_offset, file_handle::write_flag::data_sync}));
+        if(written.size() != 1 || written[0].size() != _batch.size())
+        {
+          return errc::io_error;
+        }
+        _current_offset += _batch.size();
+        _batch.assign(tail.begin(), tail.end());
+      }
+      return success();
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> write_ahead_log::_recover(recovery_callback &callback) noexcept
+  {
+    try
+    {
+      std::vector<uint64_t> live, free;
+      {
+        std::vector<directory_handle::buffer_type> entries(16);
+        directory_handle::buffers_type buffers;
+        for(;;)
+        {
+          buffers = {entries, std::move(buffers)};
+          OUTCOME_TRY(buffers, _dirh.read({std::move(buffers), {}, directory_handle::filter::fastdeleted}));
+          if(buffers.done())
+          {
+            break;
+          }
+          entries.resize(entries.size() << 1);
+        }
+        for(const auto &entry : buffers)
+        {
+          const auto leafname = entry.leafname.path().string();
+          if(leafname.size() < 17 || leafname.find_first_not_of("0123456789abcdef") != 16)
+          {
+            continue;
+          }
+          const uint64_t seq = strtoull(leafname.c_str(), nullptr, 16);
+          if(0 == leafname.compare(16, std::string::npos, ".wal"))
+          {
+            live.push_back(seq);
+          }
+          else if(0 == leafname.compare(16, std::string::npos, ".free"))
+          {
+            free.push_back(seq);
+          }
+        }
+      }
+      std::sort(live.begin(), live.end());
+      std::sort(free.begin(), free.end());
+      if(!live.empty())
+      {
+        _next_seq = live.back() + 1;
+      }
+      if(!free.empty())
+      {
+        _next_seq = (std::max)(_next_seq, free.back() + 1);
+      }
+
+      // Returns whether the segment header is valid, which it is not if the segment's creation was
+      // interrupted. Tracks the log sequence number beyond any which the segment could hold.
+      lsn_type next_lsn = 1;
+      auto read_header = [&](file_handle &fh, detail::write_ahead_log_segment_header &header) -> result<bool> {
+        OUTCOME_TRY(auto &&read, fh.read(0, {{reinterpret_cast<byte *>(&header), sizeof(header)}}));
+        if(read != sizeof(header) ||
+           header.crc != detail::crc32c(reinterpret_cast<const byte *>(&header), offsetof(detail::write_ahead_log_segment_header, crc)))
+        {
+          return false;
+        }
+        if(0 != memcmp(header.magic, detail::write_ahead_log_magic, sizeof(header.magic)) || header.segment_size < 2 * _block_size ||
+           (header.segment_size % _block_size) != 0)
+        {
+          return errc::illegal_byte_sequence;
+        }
+        next_lsn = (std::max)(next_lsn, header.first_lsn + header.segment_size / 16);
+        return true;
+      };
+      for(auto seq : free)
+      {
+        OUTCOME_TRY(auto &&fh, file_handle::file(_dirh, _leafname(seq, true), file_handle::mode::read));
+        detail::write_ahead_log_segment_header header;
+        OUTCOME_TRY(read_header(fh, header));
+      }
+      _free = std::move(free);
+
+      // Scan forwards through each segment following on from the previous, until a record does not validate
+      _buffer_type window;
+      bool broken = false;
+      lsn_type expected_lsn = 0;
+      for(size_t n = 0; n < live.size(); n++)
+      {
+        OUTCOME_TRY(auto &&fh, file_handle::file(_dirh, _leafname(live[n], false), file_handle::mode::write));
+        detail::write_ahead_log_segment_header header;
+        // Even a segment not recovered bounds the log sequence numbers which remain within it
+        OUTCOME_TRY(auto &&valid, read_header(fh, header));
+        if(!broken)
+        {
+          broken = !valid || header.seq != live[n];
+          if(!broken && !_live.empty())
+          {
+            broken = header.seq != _live.back().seq + 1 || header.first_lsn < expected_lsn || header.segment_size != _segment_size;
+          }
+        }
+        if(broken)
+        {
+          OUTCOME_TRY(_retire(fh, live[n]));
+          continue;
+        }
+        _segment_size = header.segment_size;
+        _live.push_back({header.seq, header.first_lsn});
+        expected_lsn = header.first_lsn;
+        extent_type window_offset = 0;
+        size_t window_valid = 0;
+        auto view = [&](extent_type offset, size_t length) -> result<const byte *> {
+          if(offset + length > _segment_size)
+          {
+            return static_cast<const byte *>(nullptr);
+          }
+          if(offset < window_offset || offset + length > window_offset + window_valid)
+          {
+            window_offset = offset & ~(_block_size - 1);
+            auto bytes = (std::max)(static_cast<extent_type>(length) + (offset - window_offset), static_cast<extent_type>(4 * 1024 * 1024));
+            bytes = (std::min)((bytes + _block_size - 1) & ~(_block_size - 1), _segment_size - window_offset);
+            window.resize(static_cast<size_t>(bytes));
+            OUTCOME_TRY(window_valid, fh.read(window_offset, {{window.data(), window.size()}}));
+            if(offset + length > window_offset + window_valid)
+            {
+              return static_cast<const byte *>(nullptr);
+            }
+          }
+          return window.data() + (offset - window_offset);
+        };
+        extent_type offset = _block_size;
+        for(;;)
+        {
+          OUTCOME_TRY(auto *frame, view(offset, 16));
+          if(frame == nullptr)
+          {
+            break;
+          }
+          uint32_t crc, length;
+          lsn_type lsn;
+          memcpy(&crc, frame, sizeof(crc));
+          memcpy(&length, frame + 4, sizeof(length));
+          memcpy(&lsn, frame + 8, sizeof(lsn));
+          if(crc == 0 && length == 0 && lsn == 0)
+          {
+            // Zeros at the start of a block are never written, else they pad a write to its end
+            if((offset % _block_size) == 0)
+            {
+              break;
+            }
+            offset = (offset + _block_size - 1) & ~(_block_size - 1);
+            continue;
+          }
+          if(lsn != expected_lsn || length > max_record_size())
+          {
+            break;
+          }
+          OUTCOME_TRY(frame, view(offset, _frame_size(length)));
+          if(frame == nullptr || crc != detail::write_ahead_log_frame_crc(detail::crc32c_update(~(uint32_t) 0, frame + 16, length), frame))
+          {
+            break;
+          }
+          if(callback)
+          {
+            OUTCOME_TRY(callback(lsn, {frame + 16, length}));
+          }
+          ++expected_lsn;
+          offset += _frame_size(length);
+        }
+      }
+
+      // Never append after recovered records, as anything beyond them may be frames of a torn
+      // write bearing the log sequence numbers which would follow
+      _next_lsn = next_lsn;
+      _durable_lsn = next_lsn - 1;
+      return _begin_segment(next_lsn);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::unique_ptr<write_ahead_log>> write_ahead_log::open(const path_handle &base, path_view path, recovery_callback callback,
+                                                                                                 extent_type segment_size, size_t max_free_segments) noexcept
+  {
+    segment_size = (segment_size + _block_size - 1) & ~(_block_size - 1);
+    if(segment_size < 2 * _block_size)
+    {
+      return errc::invalid_argument;
+    }
+    OUTCOME_TRY(auto &&dirh, directory_handle::directory(base, path, directory_handle::mode::write, directory_handle::creation::if_needed));
+    try
+    {
+      auto ret = std::make_unique<write_ahead_log>(_private_tag(), std::move(dirh), segment_size, max_free_segments);
+      OUTCOME_TRY(ret->_recover(callback));
+      return {std::move(ret)};
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<write_ahead_log::lsn_type> write_ahead_log::append(span<const byte> record) noexcept
+  {
+    if(record.size() > max_record_size())
+    {
+      return errc::value_too_large;
+    }
+    // Checksum the record before taking the lock
+    const uint32_t record_crc = detail::crc32c_update(~(uint32_t) 0, record.data(), record.size());
+    try
+    {
+      std::unique_lock<std::mutex> g(_lock);
+      if(_failure)
+      {
+        return *_failure;
+      }
+      const lsn_type lsn = _next_lsn++;
+      const size_t offset = _pending.size();
+      _pending.resize(offset + _frame_size(record.size()));
+      byte *frame = _pending.data() + offset;
+      const auto length = static_cast<uint32_t>(record.size());
+      memcpy(frame + 4, &length, sizeof(length));
+      memcpy(frame + 8, &lsn, sizeof(lsn));
+      const uint32_t crc = detail::write_ahead_log_frame_crc(record_crc, frame);
+      memcpy(frame, &crc, sizeof(crc));
+      memcpy(frame + 16, record.data(), record.size());
+      // The first appender to find no write in progress writes everything pending, whilst the
+      // others wait for a write which includes theirs
+      while(_durable_lsn < lsn)
+      {
+        if(_failure)
+        {
+          return *_failure;
+        }
+        if(_writing)
+        {
+          _cv.wait(g);
+          continue;
+        }
+        _writing = true;
+        _pending.swap(_batch);
+        const lsn_type last_lsn = _next_lsn - 1;
+        g.unlock();
+        result<void> r(success());
+        {
+          std::lock_guard<std::mutex> h(_segments_lock);
+          r = _write_batch();
+          _batch.clear();
+        }
+        g.lock();
+        _writing = false;
+        if(r)
+        {
+          _durable_lsn = last_lsn;
+        }
+        else
+        {
+          // What reached storage is unknown, so fail all which follow
+          _failure = std::move(r).error();
+        }
+        _cv.notify_all();
+      }
+      return lsn;
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> write_ahead_log::checkpoint(lsn_type lsn) noexcept
+  {
+    std::lock_guard<std::mutex> g(_segments_lock);
+    bool retired = false;
+    // The oldest segment holds only records before the first of the next segment
+    while(_live.size() > 1 && _live[1].first_lsn <= lsn)
+    {
+      OUTCOME_TRY(auto &&fh, file_handle::file(_dirh, _leafname(_live.front().seq, false), file_handle::mode::write));
+      OUTCOME_TRY(_retire(fh, _live.front().seq));
+      _live.pop_front();
+      retired = true;
+    }
+    if(retired)
+    {
+      OUTCOME_TRY(_sync_directory());
+    }
+    return success();
+  }
+}  // namespace algorithm
+
+LLFIO_V2_NAMESPACE_END
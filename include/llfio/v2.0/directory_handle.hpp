@@ -175,6 +175,7 @@ public:
     path_view_type glob{};
     filter filtering{filter::fastdeleted};
     span<char> kernelbuffer{};
+    stat_t::want want{stat_t::want::none};
 
     /*! Construct a request to enumerate a directory with optionally specified kernel buffer.
 
@@ -183,17 +184,31 @@ public:
     \param _filtering Whether to filter out fake-deleted files on Windows or not.
     \param _kernelbuffer A buffer to use for the kernel to fill. If left defaulted, a kernel buffer
     is allocated internally and returned in the buffers returned which needs to not be destructed until one
-    is no longer using any items within (leafnames are views onto the original kernel data).
+    is no longer using any items within (leafnames are views onto the original kernel data). Passing
+    the buffers returned back into the next enumeration reuses their kernel buffer. On Windows, a supplied
+    kernel buffer is filled by a single syscall without first sizing the enumeration, so it should be
+    large enough for the whole directory, else `errc::no_buffer_space` is returned.
+    \param _want Metadata to fill for each entry in addition to that which enumeration returns. On POSIX,
+    this is one `statx()` (or `fstatat()`) per entry, issued in parallel across a few threads for large
+    enumerations unless `flag::disable_parallelism` is set. On Windows enumeration already returns all
+    metadata bar `nlink`, `flags` and `gen`, and nothing extra is filled.
     */
-    /*constexpr*/ io_request(buffers_type _buffers, path_view_type _glob = {}, filter _filtering = filter::fastdeleted, span<char> _kernelbuffer = {})
+    /*constexpr*/ io_request(buffers_type _buffers, path_view_type _glob = {}, filter _filtering = filter::fastdeleted, span<char> _kernelbuffer = {},
+                             stat_t::want _want = stat_t::want::none)
         : buffers(std::move(_buffers))
         , glob(_glob)
         , filtering(_filtering)
         , kernelbuffer(_kernelbuffer)
+        , want(_want)
     {
     }
   };
 
+private:
+#ifndef _WIN32
+  // Fills the wanted metadata not returned by enumeration for each entry
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _fill_wanted_metadata(buffers_type &buffers, stat_t::want wanted) const noexcept;
+#endif
 
 public:
   //! Default constructor
@@ -354,6 +369,37 @@ public:
   */
   LLFIO_MAKE_FREE_FUNCTION
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<buffers_type> read(io_request<buffers_type> req, deadline d = std::chrono::seconds(30)) const noexcept;
+
+  //! Statistics about the directory enumeration cache
+  struct enumeration_cache_statistics
+  {
+    size_t items_in_cache{0};
+    size_t bytes_in_cache{0};
+    size_t items_just_trimmed{0};
+    size_t bytes_just_trimmed{0};
+    size_t hits{0};    //!< Total enumerations served from the cache
+    size_t misses{0};  //!< Total cacheable enumerations which had to ask the kernel
+  };
+  /*! \brief Enables or disables the process-wide cache of directory enumerations, returning the
+  previous setting. The cache is disabled by default, and is currently only implemented on POSIX.
+
+  When enabled, each enumeration by `read()` of a whole directory, without a glob and into an
+  internally allocated kernel buffer, is retained in a compact form keyed by the directory's
+  device, inode, modification time and change time. A later `read()` of a directory whose
+  `fstat()` still matches is served from the cache, filtered by any glob, without calling
+  `getdents()`. Directories modified within the last second are not retained, as a later
+  modification may not change their timestamps. Metadata additional to what enumeration returns
+  is always fetched afresh. Disabling the cache releases everything retained.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool set_enumeration_cache_enabled(bool enabled) noexcept;
+  /*! \brief Sets the limit of the directory enumeration cache, the least recently used
+  enumerations being released whenever more than `max_bytes` is retained. The default is 16Mb.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void set_enumeration_cache_limits(size_t max_bytes) noexcept;
+  /*! \brief Releases enumerations last used before `older_than`, returning statistics about the
+  directory enumeration cache. The default trims nothing, which simply returns statistics.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC enumeration_cache_statistics trim_enumeration_cache(std::chrono::steady_clock::time_point older_than = {}) noexcept;
 };
 inline std::ostream &operator<<(std::ostream &s, const directory_handle::filter &v)
 {
@@ -26,6 +26,7 @@ Distributed under the Boost Software License, Version 1.0.
 #define LLFIO_FAST_RANDOM_FILE_HANDLE_H
 
 #include "file_handle.hpp"
+#include "map_handle.hpp"
 
 #include "quickcpplib/algorithm/small_prng.hpp"
 
@@ -50,6 +51,11 @@ a fairly unique number. As there are eight bytes of randomness being mixed with
 bytes of counter, this will not be a particularly random stream, but it's probably not
 awful either.
 
+As one round with the counter overwriting half the state reduces to the counter plus a
+constant, reads of whole words generate runs of consecutive words in a loop without
+dependencies between iterations, which the compiler vectorises for whatever SIMD the
+target has. The output is identical to performing the round for each word.
+
 Note that writes to this handle are permitted if it was opened with write permission,
 but writes have no effect.
 
@@ -120,6 +126,15 @@ protected:
       b = (offset >> 32) & 0xffffffff;
       return _base::operator()();
     }
+    /* As the round above overwrites `a` and `b`, its result `(a - rot(b, 27)) + (b ^ rot(c, 17))`
+    is the low 32 bits of the offset plus a constant for each value of the high 32 bits.
+    This returns that constant, so many consecutive words can be generated at once.
+    */
+    uint32_t constant_for(uint32_t hi) const noexcept
+    {
+      const auto rot = [](uint32_t x, unsigned k) { return (x << k) | (x >> (32 - k)); };
+      return (hi ^ rot(c, 17)) - rot(hi, 27);
+    }
   } _prng;
   extent_type _length{0};
 
@@ -252,8 +267,66 @@ public:
     return extent.length;
   }
 
+  //! \brief Allocate a portion of the random file, extending it if `keep_size` is false.
+  LLFIO_MAKE_FREE_FUNCTION
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<file_handle::extent_pair> allocate(file_handle::extent_pair extent, bool keep_size = false) noexcept override
+  {
+    OUTCOME_TRY(_perms_check());
+    if(!keep_size && extent.offset + extent.length > _length)
+    {
+      _length = extent.offset + extent.length;
+    }
+    return extent;
+  }
+
   //! \brief Return a single extent of the maximum extent
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<std::vector<file_handle::extent_pair>> extents() const noexcept override { return std::vector<file_handle::extent_pair>{{0, _length}}; }
+  //! \brief Does nothing, as there is no cache to hint
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<file_handle::extent_pair> advise(file_handle::extent_pair extent, access_pattern /*unused*/) noexcept override
+  {
+    return extent;
+  }
+  //! \brief Does nothing, as there is no cache to evict
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<file_handle::extent_pair> evict_cache(file_handle::extent_pair extent = {0, (extent_type) -1}) noexcept override
+  {
+    return extent;
+  }
+  //! \brief Return the portion of a single extent of the maximum extent lying within `range`
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<span<file_handle::extent_pair>> extents(span<file_handle::extent_pair> out,
+                                                                               file_handle::extent_pair range = {0, (extent_type) -1}) const noexcept override
+  {
+    const extent_type end = (range.offset + range.length < range.offset) ? (extent_type) -1 : range.offset + range.length;
+    if(out.empty() || range.offset >= _length || end <= range.offset)
+    {
+      return out.subspan(0, 0);
+    }
+    out[0] = {range.offset, (std::min)(end, _length) - range.offset};
+    return out.subspan(0, 1);
+  }
+
+  /*! \brief Returns a read-only map of `bytes` of the random content starting from `offset`,
+  which can be used anywhere a `map_handle` is expected without first writing that content anywhere.
+
+  On Linux the map is registered with a process wide `userfaultfd`, whose background thread
+  generates each page of content upon its first access. Once more than `max_resident` bytes of
+  the map have been generated, the least recently generated pages are discarded, to be generated
+  again if accessed again, so a map of terabytes of content never occupies more memory than that.
+  If the process is not permitted to handle faults from the kernel, only faults from user space
+  are handled, and passing not yet accessed parts of the map to syscalls such as `write()` will
+  fail with `EFAULT`. Maps returned must not be `mremap()`ed.
+
+  Elsewhere, or if `userfaultfd` is unavailable, the content is generated up front into newly
+  allocated memory, which becomes the map, and `max_resident` is ignored. Writes to such a map
+  are possible, but only modify the memory.
+
+  \param bytes How many bytes to map, which is rounded up to the page size. Content beyond the
+  maximum extent is zeros.
+  \param offset The offset into the random content which begins the map.
+  \param max_resident The most bytes of generated content to keep resident at once.
+  \errors Any of the values `map_handle::map()` can return.
+  \mallocs One for the bookkeeping of each map.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map(size_type bytes, extent_type offset = 0, size_type max_resident = 64 * 1024 * 1024) const noexcept;
 
 #if 0
   /*! \brief Read data from the random file.
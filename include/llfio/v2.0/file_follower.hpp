@@ -0,0 +1,209 @@
+/* Follows a file being appended to by a third party
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_FILE_FOLLOWER_HPP
+#define LLFIO_FILE_FOLLOWER_HPP
+
+#include "mapped_file_handle.hpp"
+
+//! \file file_follower.hpp Provides a follower of a file being appended to by a third party.
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+/*! \class file_follower
+\brief Follows the end of a file being appended to by a third party, possibly another process,
+blocking efficiently until more data appears, and returning each newly appended extent as a view
+of the file's map.
+
+Readers following a file being appended to, such as a log shipper, would otherwise need to poll
+`maximum_extent()` and re-read. `next()` instead returns the data appended since the previous call
+as a view into the `mapped_file_handle`'s map, so no data is copied, and if none has been appended,
+sleeps in the kernel until notified of a modification of the file, or the deadline passes:
+
+- On Linux, an `inotify` watch for `IN_MODIFY` on the file.
+- On BSD and Mac OS, a `kqueue` `EVFILT_VNODE` filter for `NOTE_WRITE` and `NOTE_EXTEND` on the file.
+- On Windows, `FindFirstChangeNotificationW()` for `FILE_NOTIFY_CHANGE_SIZE` and `FILE_NOTIFY_CHANGE_LAST_WRITE`
+on the file's directory. As NTFS may defer updating the size of a file open elsewhere, sleeps are capped at 100
+milliseconds, so growth is never noticed later than that.
+
+If the file grows beyond the reservation of the `mapped_file_handle`, the reservation is doubled,
+which may relocate the map and so invalidate views previously returned. Give the mapped file handle a
+reservation much larger than the file is expected to grow to if views must remain valid. If the file
+shrinks below the current offset, as when a log is truncated, following restarts from the beginning.
+
+The mapped file handle must outlive the follower, and must not be used by other threads whilst
+`next()` is being called.
+*/
+class LLFIO_DECL file_follower
+{
+public:
+  //! The extent type
+  using extent_type = mapped_file_handle::extent_type;
+  //! The size type
+  using size_type = mapped_file_handle::size_type;
+
+private:
+  mapped_file_handle *_mfh{nullptr};
+  extent_type _offset{0};
+#ifdef _WIN32
+  void *_change{nullptr};  // FindFirstChangeNotificationW() handle
+#else
+  int _fd{-1};  // inotify fd on Linux, kqueue fd elsewhere
+#endif
+
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _wait(deadline d) noexcept;
+
+public:
+  //! Default constructor
+  constexpr file_follower() {}  // NOLINT
+  file_follower(const file_follower &) = delete;
+  file_follower &operator=(const file_follower &) = delete;
+  //! Move constructor
+  file_follower(file_follower &&o) noexcept
+      : _mfh(o._mfh)
+      , _offset(o._offset)
+#ifdef _WIN32
+      , _change(o._change)
+#else
+      , _fd(o._fd)
+#endif
+  {
+    o._mfh = nullptr;
+    o._offset = 0;
+#ifdef _WIN32
+    o._change = nullptr;
+#else
+    o._fd = -1;
+#endif
+  }
+  //! Move assignment
+  file_follower &operator=(file_follower &&o) noexcept
+  {
+    if(this == &o)
+    {
+      return *this;
+    }
+    this->~file_follower();
+    new(this) file_follower(std::move(o));
+    return *this;
+  }
+  ~file_follower()
+  {
+    if(is_valid())
+    {
+      (void) close();
+    }
+  }
+
+  /*! \brief Begins following `mfh` from `offset`, which is usually the current maximum extent of
+  the file so only data appended from now on is returned.
+
+  \errors Any of the values `inotify_add_watch()`, `kevent()` or `FindFirstChangeNotificationW()`
+  can return.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<file_follower> follow(mapped_file_handle &mfh, extent_type offset = 0) noexcept;
+
+  //! True if following a file
+  bool is_valid() const noexcept { return _mfh != nullptr; }
+  //! The mapped file handle being followed
+  mapped_file_handle *file() const noexcept { return _mfh; }
+  //! The offset into the file up to which data has been returned
+  extent_type offset() const noexcept { return _offset; }
+  //! Sets the offset into the file from which data is next returned
+  void offset(extent_type v) noexcept { _offset = v; }
+
+  /*! \brief Returns a view of the data appended since the previous call, of at most `max_bytes`
+  bytes if not zero, waiting until `d` for data to be appended if none has been.
+
+  \errors `errc::timed_out` if the deadline passed, else any of the values `update_map()`, `reserve()`,
+  or the platform's notification mechanism can return.
+  */
+  result<span<const byte>> next(size_type max_bytes = 0, deadline d = deadline()) noexcept
+  {
+    if(_mfh == nullptr)
+    {
+      return errc::bad_file_descriptor;
+    }
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    for(;;)
+    {
+      extent_type length = 0;
+      OUTCOME_TRY(length, _mfh->update_map());
+      if(length >= _mfh->capacity())
+      {
+        OUTCOME_TRY(auto &&underlying, _mfh->underlying_file_maximum_extent());
+        if(underlying > _mfh->capacity())
+        {
+          OUTCOME_TRY(_mfh->reserve((std::max)((size_type) underlying, (std::max)(2 * _mfh->capacity(), (size_type) 1 << 20U))));
+          OUTCOME_TRY(length, _mfh->update_map());
+        }
+      }
+      if(length < _offset)
+      {
+        _offset = 0;  // truncated, so follow from the beginning
+      }
+      if(length > _offset)
+      {
+        extent_type bytes = length - _offset;
+        if(max_bytes != 0 && bytes > max_bytes)
+        {
+          bytes = max_bytes;
+        }
+        span<const byte> ret(_mfh->address() + _offset, (size_t) bytes);
+        _offset += bytes;
+        return ret;
+      }
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      OUTCOME_TRY(_wait(nd));
+    }
+  }
+
+  //! Stops following the file
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> close() noexcept;
+};
+
+LLFIO_V2_NAMESPACE_END
+
+#if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
+#define LLFIO_INCLUDED_BY_HEADER 1
+#ifdef _WIN32
+#include "detail/impl/windows/file_follower.ipp"
+#else
+#include "detail/impl/posix/file_follower.ipp"
+#endif
+#undef LLFIO_INCLUDED_BY_HEADER
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -29,6 +29,8 @@ Distributed under the Boost Software License, Version 1.0.
 #include "path_discovery.hpp"
 #include "utils.hpp"
 
+#include <memory>  // for shared_ptr
+
 //! \file file_handle.hpp Provides file_handle
 
 #ifdef _MSC_VER
@@ -55,6 +57,14 @@ class LLFIO_DECL file_handle : public lockable_io_handle, public fs_handle
 {
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC const handle &_get_handle() const noexcept final { return *this; }
 
+protected:
+  using io_handle::_do_read;
+  using io_handle::_do_write;
+  //! Bounces unaligned reads if `flag::bounce_unaligned_io` is set and the handle requires aligned i/o
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> _do_read(io_request<buffers_type> reqs, deadline d) noexcept override;
+  //! Bounces unaligned writes if `flag::bounce_unaligned_io` is set and the handle requires aligned i/o
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_write(io_request<const_buffers_type> reqs, deadline d) noexcept override;
+
 public:
   using path_type = io_handle::path_type;
   using extent_type = io_handle::extent_type;
@@ -267,6 +277,40 @@ public:
                                                              deadline d = std::chrono::seconds(30)) const noexcept;
   LLFIO_DEADLINE_TRY_FOR_UNTIL(reopen)
 
+  /*! \brief A reference counted handle from the process wide pool of read only file handles.
+
+  The handle is shared with every other user of the same inode with the same caching, so it must
+  be used only for reading, and must not be closed, released, relinked nor unlinked.
+  Reads specify their offset, so concurrent reads by different users are threadsafe.
+  */
+  using pooled_handle = std::shared_ptr<file_handle>;
+
+  /*! \brief Returns a handle to the same inode as this handle from the process wide pool of read
+  only file handles, reopening this handle for reading only if the pool has none with that caching.
+
+  The pool is keyed by device, inode, mode (always `mode::read`) and caching. When the last user
+  of a pooled handle releases it, the handle is not closed, but kept idle in the pool, so repeatedly
+  reopening the same inode need do no more than a hash table lookup. Idle handles beyond
+  the limit set by `set_file_handle_pool_idle_limit()` are closed, least recently used first.
+
+  \errors Any of the values `reopen()` can return.
+  \mallocs One for each handle newly added to the pool, and one for each user of a pooled handle.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<pooled_handle> reopen_pooled(caching caching_ = caching::unchanged) const noexcept;
+
+  /*! \brief Returns a handle to the inode at `path` relative to `base` from the process wide pool
+  of read only file handles, opening one if the pool has none with that caching.
+
+  The device and inode at `path` are found by `stat_t::fill_many()`, which on POSIX does not
+  open a file descriptor, and so avoids the fd churn of opening and closing hot files per
+  request. On Windows the file is opened for attribute reading to find them. See
+  `reopen_pooled()` for how the pool works.
+
+  \errors Any of the values `stat_t::fill_many()` or `file()` can return.
+  \mallocs As for `reopen_pooled()`.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<pooled_handle> pooled(const path_handle &base, path_view_type path, caching _caching = caching::all) noexcept;
+
   /*! Return the current maximum permitted extent of the file.
 
   \errors Any of the values POSIX fstat() or GetFileInformationByHandleEx() can return.
@@ -310,6 +354,25 @@ public:
   LLFIO_MAKE_FREE_FUNCTION
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<std::vector<extent_pair>> extents() const noexcept;
 
+  /*! \brief Fills `out` with the currently valid extents for this open file which lie within
+  `range`, in ascending order, clamped to `range`. WARNING: racy!
+  \return The leading portion of `out` which was filled. If this is empty, there are no more valid
+  extents within `range`.
+  \param out The buffer to fill.
+  \param range The region of the file to enumerate. The default is the whole file.
+
+  Unlike `extents()`, this does not enumerate the whole file before returning, so the caller can
+  begin work upon the first extents immediately. To enumerate a region in pieces, call this
+  repeatedly with `range` starting from the end of the last extent returned. Adjacent extents
+  may be reported separately either side of a buffer boundary.
+
+  On Linux, this uses the `FIEMAP` ioctl, falling back onto `SEEK_DATA`/`SEEK_HOLE` if the filing
+  system does not support it. On Windows, this uses `FSCTL_QUERY_ALLOCATED_RANGES`. Filing systems
+  which do not support extents report the whole of `range` lying within the file as valid.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<span<extent_pair>> extents(span<extent_pair> out, extent_pair range = {0, (extent_type) -1}) const noexcept;
+
   /*! \brief Clones the extents referred to by `extent` to `dest` at `destoffset`. This
   is how you ought to copy file content, including within the same file. This is
   fundamentally a racy call with respect to concurrent modification of the files.
@@ -331,8 +394,11 @@ public:
   only clones extents which are reported as valid. It
   then iterates the platform specific syscall to cause the extents to be cloned in
   `utils::page_allocator<T>` sized chunks (i.e. the next large page greater or equal
-  to 1Mb). Generally speaking, if the dedicated syscalls fail, the implementation falls
-  back to a user space emulation, unless `emulate_if_unsupported` is false.
+  to 1Mb). On Windows, when cloning between different files, each `FSCTL_DUPLICATE_EXTENTS_TO_FILE`
+  instead covers the largest whole number of clusters less than 4Gb, and up to eight are kept in
+  flight at once unless `flag::disable_parallelism` is set. Generally speaking, if the dedicated
+  syscalls fail, the implementation falls back to a user space emulation, unless
+  `emulate_if_unsupported` is false.
 
   If the region being cloned does not exist in the source file, the region is truncated
   to what is available. If the destination file is not big enough to receive the cloned
@@ -370,6 +436,12 @@ public:
   bits zero. This call works on most Linux filing systems with a recent kernel, Microsoft Windows
   with NTFS, and FreeBSD with ZFS. On other systems it simply writes zeros.
 
+  On Linux, files in the sequential zones of zonefs, and zoned block devices, cannot be
+  overwritten, so zeroing resets their zones instead. For zonefs, an extent covering the file
+  from its start to at least its end truncates the file to zero length, which resets its zone.
+  For a zoned block device, an extent of whole zones resets them with `BLKRESETZONE`. Any other
+  extent is zeroed as for any other file, which fails for sequential zones.
+
   \return The bytes zeroed.
   \param extent The offset to start zeroing from and the number of bytes to zero.
   \param d An optional deadline by which the i/o must complete, else it is cancelled.
@@ -388,8 +460,164 @@ public:
   result<extent_type> zero(extent_type offset, extent_type bytes, deadline d = deadline()) noexcept { return zero({offset, bytes}, d); }
 
   LLFIO_DEADLINE_TRY_FOR_UNTIL(zero)
+
+  /*! \brief Writes `buffers` at the end of the file, returning the offset at which they were placed.
+
+  This is the zone append of zoned storage: the kernel places each append, so many appenders
+  need not agree on where the write pointer is. This suits log structured writers upon files
+  in the sequential zones of zonefs, which require writes at the write pointer, as well as upon
+  ordinary files. Appends by other processes, and by other handles, are never interleaved with
+  this append.
+
+  On Linux this is `pwritev2(RWF_APPEND)` at the file position, then reading the file position,
+  which for zonefs must be on a handle opened with `caching::none` or `caching::only_metadata`.
+  Elsewhere on POSIX the handle must be append only. These are serialised against other
+  appends through this handle, but handles duplicated by `reopen()` share the file position,
+  and so must not append concurrently with this handle.
+
+  \errors Any of the values POSIX `pwritev2()` or `writev()` can return, including
+  `errc::no_space_on_device` if the zone is full. If the kernel writes less than all the
+  buffers, as it may when the zone fills, `errc::no_space_on_device` is returned, and the file
+  will have been appended to. `errc::operation_not_supported` if this is not an
+  append only handle and the kernel cannot append per write, and always on Windows.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<extent_type> zone_append(const_buffers_type buffers, deadline d = deadline()) noexcept;
+
+  /*! \brief Allocate storage for a region of the file without writing to it.
+  \return The region allocated.
+  \param extent The region to allocate.
+  \param keep_size If false, the maximum extent of the file is extended to the end of `extent`
+  if it is currently less. If true, the maximum extent is not changed, so storage may be
+  allocated beyond the end of the file to be written into later.
+
+  Unlike `truncate()`, which makes sparse files, and `zero()`, which deallocates storage, this
+  allocates storage up front, typically contiguously, which avoids fragmentation and metadata
+  journal traffic when the region is written later. Allocated regions read as zero.
+
+  On Linux this is `fallocate()`, on Mac OS `fcntl(F_PREALLOCATE)`, and on FreeBSD
+  `posix_fallocate()`, which cannot keep the size. On Windows allocation is always from the start
+  of the file, so this sets `FileAllocationInfo` to the end of `extent` if the allocation is
+  currently less. `SetFileValidData()` is not used as it exposes stale storage content, and
+  requires a privilege not usually held, see `extend_valid_data()` for that.
+  \errors `errc::operation_not_supported` if the filing system cannot allocate storage without
+  writing to it. Any of the values `fallocate()`, `fcntl()`, `posix_fallocate()` or
+  `SetFileInformationByHandle()` can return.
+  \mallocs None.
+  */
+  LLFIO_MAKE_FREE_FUNCTION
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_pair> allocate(extent_pair extent, bool keep_size = false) noexcept;
+
+  /*! \brief Extend the maximum extent of the file, allocating storage for the extension which
+  will not be zero filled before the first write into it.
+  \return The bytes actually truncated to.
+  \param newsize The bytes to extend the file to. If not beyond the current maximum extent,
+  this is `truncate(newsize)`.
+
+  On NTFS, writing into a file beyond its valid data length first zero fills the storage from
+  the valid data length up to the write, so a preallocated file written once is written twice.
+  This allocates the extension and calls `SetFileValidData()`, after which the extension
+  reads as whatever the storage previously held, *including the content of deleted files
+  from any user*. It therefore needs `SE_MANAGE_VOLUME_NAME` (`SeManageVolumePrivilege`),
+  which is enabled in the process token upon first use if held. Only use this upon files
+  which are never readable by anybody who should not see stale storage content, and which
+  will be entirely written before being read.
+
+  On POSIX, extents based filing systems allocate unwritten extents which are never zero
+  filled upon write, so this is `allocate()` of the extension, falling back onto `truncate()`
+  if the filing system cannot allocate storage without writing to it.
+  \errors `errc::operation_not_permitted` if the privilege is not held.
+  `errc::operation_not_supported` if valid data cannot be set upon this file, for example
+  because it is sparse, compressed or not on NTFS. Any of the values `allocate()` and
+  `SetFileValidData()` can return.
+  \mallocs None.
+  */
+  LLFIO_MAKE_FREE_FUNCTION
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> extend_valid_data(extent_type newsize) noexcept;
+
+  //! The access pattern to hint to the kernel for a region of a file
+  enum class access_pattern : unsigned char
+  {
+    normal,      //!< Default read ahead behaviour.
+    sequential,  //!< The region will be accessed sequentially, so read ahead aggressively.
+    random,      //!< The region will be accessed randomly, so do not read ahead.
+    will_need,   //!< The region will be accessed soon, so start reading it into cache now.
+    dont_need    //!< The region will not be accessed again soon, so evict it from cache.
+  };
+
+  /*! \brief Hints to the kernel how a region of this file will be accessed, unlike
+  `flag::disable_prefetching` and `flag::maximum_prefetching` which apply to the whole file
+  at open time.
+  \return The region hinted, which may be a superset of that requested.
+  \param extent The region to hint. A length of `(extent_type) -1` means to the end of the file.
+  \param pattern The access pattern to hint.
+
+  Evicting already consumed regions of a streamed file with `access_pattern::dont_need` prevents
+  the scan evicting the working set of everything else on the system. Dirty pages cannot be
+  evicted until they have been written back to storage.
+
+  This issues `posix_fadvise()`, or `fcntl(F_RDADVISE)` and `fcntl(F_RDAHEAD)` on Mac OS.
+  Windows has no equivalent for non-mapped i/o, so this does nothing there, except that
+  `mapped_file_handle` prefetches the mapped region for `access_pattern::will_need` on all platforms.
+  \errors Any of the values `posix_fadvise()` or `fcntl()` can return.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_pair> advise(extent_pair extent, access_pattern pattern) noexcept;
+
+  /*! \brief Evicts a region of this file from the kernel page cache, without affecting the
+  cache of any other file, unlike `utils::drop_filesystem_cache()`.
+  \return The region evicted, which may be a superset of that requested.
+  \param extent The region to evict. A length of `(extent_type) -1` means to the end of the file.
+
+  Dirty pages in the region are first written to storage and waited upon, so cold cache reads
+  can be benchmarked without affecting co-tenants of the system. Pages currently mapped into
+  any process may not be evicted.
+
+  On Linux this is `sync_file_range()` followed by `posix_fadvise(POSIX_FADV_DONTNEED)`, and on
+  other POSIX `fsync()` followed by `posix_fadvise(POSIX_FADV_DONTNEED)`. On Windows the whole
+  file is always evicted, by `FlushFileBuffers()` followed by opening a non-cached handle to the
+  file with `ReOpenFile()`, which purges the cache of an unmapped file.
+  \errors `errc::operation_not_supported` on Mac OS, which has no means of evicting a region of
+  its unified buffer cache. Any of the values `sync_file_range()`, `fsync()`, `posix_fadvise()`,
+  `FlushFileBuffers()` or `ReOpenFile()` can return.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_pair> evict_cache(extent_pair extent = {0, (extent_type) -1}) noexcept;
+
+  //! The limits of writes which are never seen torn, as advertised by the kernel.
+  struct atomic_write_limits_type
+  {
+    size_t unit_min{0};      //!< The minimum length of an atomic write, or zero if atomic writes are not supported.
+    size_t unit_max{0};      //!< The maximum length of an atomic write, or zero if atomic writes are not supported.
+    size_t segments_max{0};  //!< The maximum number of buffers in an atomic write, or zero if atomic writes are not supported.
+  };
+  /*! \brief Returns the limits within which `io_multiplexer::write_flag::atomic` writes to this
+  file are never seen torn, even after sudden power loss.
+
+  Atomic writes must be a power of two in length between `unit_min` and `unit_max` inclusive, and
+  naturally aligned in offset to their length. The limits depend on the storage device (e.g. the
+  NVMe AWUPF), the filing system, and how the file was opened, as most filing systems support
+  atomic writes only for `caching::none` handles. A double-write buffer, as is commonly used by
+  write ahead logs to detect torn writes, is not needed for writes within these limits.
+
+  On Linux this is `statx(STATX_WRITE_ATOMIC)`, from Linux 6.11 onwards. Other platforms never
+  advertise support for atomic writes, and all values returned are zero.
+  \errors Any of the values `statx()` can return.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<atomic_write_limits_type> atomic_write_limits() const noexcept;
 };
 
+/*! \brief Sets the maximum number of idle handles kept open by the process wide pool of read
+only file handles (see `file_handle::reopen_pooled()`), returning the previous maximum. The
+default is 64, and zero closes each pooled handle as soon as its last user releases it.
+
+The pool is split into sixteen shards, each of which may keep idle a sixteenth of the maximum,
+and at least one if the maximum is not zero. Lowering the maximum closes any idle handles in
+excess of it immediately.
+*/
+LLFIO_HEADERS_ONLY_FUNC_SPEC size_t set_file_handle_pool_idle_limit(size_t max_idle) noexcept;
+
 //! \brief Constructor for `file_handle`
 template <> struct construct<file_handle>
 {
@@ -536,6 +764,21 @@ inline result<file_handle::extent_type> zero(file_handle &self, file_handle::ext
 {
   return self.zero(std::forward<decltype(offset)>(offset), std::forward<decltype(bytes)>(bytes), std::forward<decltype(d)>(d));
 }
+/*! \brief Allocate storage for a region of the file without writing to it.
+\return The region allocated.
+\param self The object whose member function to call.
+\param extent The region to allocate.
+\param keep_size If false, the maximum extent of the file is extended to the end of `extent`
+if it is currently less.
+\errors `errc::operation_not_supported` if the filing system cannot allocate storage without
+writing to it. Any of the values `fallocate()`, `fcntl()`, `posix_fallocate()` or
+`SetFileInformationByHandle()` can return.
+\mallocs None.
+*/
+inline result<file_handle::extent_pair> allocate(file_handle &self, file_handle::extent_pair extent, bool keep_size = false) noexcept
+{
+  return self.allocate(std::forward<decltype(extent)>(extent), std::forward<decltype(keep_size)>(keep_size));
+}
 // END make_free_functions.py
 
 LLFIO_V2_NAMESPACE_END
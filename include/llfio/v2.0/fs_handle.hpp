@@ -30,6 +30,8 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "quickcpplib/uint128.hpp"
 
+#include <vector>
+
 //! \file fs_handle.hpp Provides fs_handle
 
 #ifdef _MSC_VER
@@ -235,6 +237,159 @@ public:
   result<void> unlink(deadline d = std::chrono::seconds(30)) noexcept;
 
   LLFIO_DEADLINE_TRY_FOR_UNTIL(unlink)
+
+  //! An extended attribute of an inode, whose name and value are views of an `extended_attributes`
+  struct extended_attribute
+  {
+    string_view name;        //!< The name of the attribute, including any namespace prefix such as `user.`
+    span<const byte> value;  //!< The value of the attribute
+  };
+  /*! \brief A sequence of extended attributes filled by `read_extended_attributes()`, which owns
+  the storage their names and values view.
+
+  Reusing an instance across calls, including calls upon different inodes, reuses its storage,
+  so scanning many inodes allocates memory only when an inode has more or bigger attributes
+  than any before it.
+  */
+  class extended_attributes
+  {
+    struct _offsets_t
+    {
+      size_t name, name_length, value, value_length;
+    };
+    std::vector<byte> _storage;
+    std::vector<_offsets_t> _offsets;
+    std::vector<extended_attribute> _attributes;
+
+  public:
+    //! The value type
+    using value_type = extended_attribute;
+    //! The iterator type
+    using const_iterator = const extended_attribute *;
+    //! The iterator type
+    using iterator = const_iterator;
+
+    //! The number of attributes
+    size_t size() const noexcept { return _attributes.size(); }
+    //! True if there are no attributes
+    bool empty() const noexcept { return _attributes.empty(); }
+    //! Returns an iterator to the first attribute
+    const_iterator begin() const noexcept { return _attributes.data(); }
+    //! Returns an iterator to after the last attribute
+    const_iterator end() const noexcept { return _attributes.data() + _attributes.size(); }
+    //! Returns the attribute at index `idx`
+    const extended_attribute &operator[](size_t idx) const noexcept { return _attributes[idx]; }
+    //! Returns the attribute named `name`, or null if there is none
+    const extended_attribute *find(string_view name) const noexcept
+    {
+      for(const auto &i : _attributes)
+      {
+        if(i.name == name)
+        {
+          return &i;
+        }
+      }
+      return nullptr;
+    }
+    //! Removes all attributes, retaining the storage for reuse
+    void clear() noexcept
+    {
+      _storage.clear();
+      _offsets.clear();
+      _attributes.clear();
+    }
+
+    // Used by the implementation to discover how many bytes can be appended without allocation
+    size_t _spare() const noexcept { return _storage.capacity() - _storage.size(); }
+    // Used by the implementation to append an attribute, returning where to place up to
+    // `value_capacity` bytes of its value. May throw `std::bad_alloc`.
+    byte *_append(string_view name, size_t value_capacity)
+    {
+      _offsets_t o;
+      o.name = _storage.size();
+      o.name_length = name.size();
+      o.value = o.name + o.name_length + 1;
+      o.value_length = value_capacity;
+      _storage.resize(o.value + value_capacity);
+      memcpy(_storage.data() + o.name, name.data(), name.size());
+      _storage[o.value - 1] = to_byte(0);
+      _offsets.push_back(o);
+      return _storage.data() + o.value;
+    }
+    // Used by the implementation to resize the value of the last attribute appended. May throw
+    // `std::bad_alloc`.
+    byte *_resize_last(size_t value_length)
+    {
+      auto &o = _offsets.back();
+      o.value_length = value_length;
+      _storage.resize(o.value + value_length);
+      return _storage.data() + o.value;
+    }
+    // Used by the implementation to remove the last attribute appended
+    void _remove_last() noexcept
+    {
+      _storage.resize(_offsets.back().name);
+      _offsets.pop_back();
+    }
+    // Used by the implementation to make the attributes appended visible. May throw `std::bad_alloc`.
+    void _publish()
+    {
+      _attributes.resize(_offsets.size());
+      for(size_t n = 0; n < _offsets.size(); n++)
+      {
+        const auto &o = _offsets[n];
+        _attributes[n].name = string_view(reinterpret_cast<const char *>(_storage.data() + o.name), o.name_length);
+        _attributes[n].value = span<const byte>(_storage.data() + o.value, o.value_length);
+      }
+    }
+  };
+
+  /*! \brief Reads many extended attributes of this inode in a single call, replacing the contents
+  of `out`.
+
+  If `names` is empty, all the extended attributes are read, otherwise only those named, with any
+  named attribute not present being omitted.
+
+  On Linux and Mac OS, reading all attributes is one `flistxattr()` into a thread local buffer,
+  then one `fgetxattr()` per attribute into storage retained within `out`, which is
+  retried only for values bigger than the storage remaining. On Windows this is one
+  `NtQueryEaFile()` for all the attributes wanted. Windows forces extended attribute names to
+  upper case, and an attribute with an empty value is the same as one not present.
+
+  \errors Any of the values `flistxattr()`, `fgetxattr()` or `NtQueryEaFile()` can return,
+  such as `errc::operation_not_supported` if the filing system does not support extended
+  attributes. On POSIX other than Linux and Mac OS, always `errc::operation_not_supported`.
+  \mallocs None, unless the storage retained in `out` is insufficient.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> read_extended_attributes(extended_attributes &out, span<const string_view> names = {}) const noexcept;
+
+  /*! \brief As for `read_extended_attributes()`, but of the inode at `leafname` relative to
+  `base`, without following any symbolic link there.
+
+  On Linux this uses the `l*xattr()` syscalls upon `/proc/self/fd` for `base`, so no handle is
+  opened to the inode, which makes this suitable for scanning the entries of enumerated
+  directories. On Mac OS the path of `base` is retrieved, and on Windows a handle able only
+  to read extended attributes is opened and closed.
+
+  \mallocs As for `read_extended_attributes()`.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> read_extended_attributes(const path_handle &base, path_view_type leafname, extended_attributes &out, span<const string_view> names = {}) noexcept;
+
+  /*! \brief Sets the extended attribute `name` of this inode to `value`, creating it if needed.
+
+  \errors Any of the values `fsetxattr()` or `NtSetEaFile()` can return. On Windows an empty
+  `value` fails with `errc::invalid_argument`, as it would remove the attribute.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> write_extended_attribute(string_view name, span<const byte> value) noexcept;
+
+  /*! \brief Removes the extended attribute `name` of this inode.
+
+  \errors Any of the values `fremovexattr()` or `NtSetEaFile()` can return. Removing an
+  attribute not present fails on POSIX, but not on Windows.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> remove_extended_attribute(string_view name) noexcept;
 };
 
 namespace detail
@@ -146,6 +146,33 @@ public:
   into kernel cache. This can improve sequential i/o performance.
   */
   maximum_prefetching = 1U << 5U,
+  /*! Handles opened with `caching::none` usually require the offset, length and address of
+  every buffer of an i/o to be aligned, and fail it otherwise. If this flag is specified, `file_handle`
+  instead transparently splits any unaligned i/o into an aligned core, which is performed directly
+  upon the caller's buffer where its address permits, plus edges which are bounced through a
+  pooled page aligned buffer. Unaligned writes read-modify-write their edge blocks, so they are
+  not atomic with respect to concurrent writers to the same blocks. Aligned i/o is unaffected.
+  */
+  bounce_unaligned_io = 1U << 6U,
+  /*! When opening a file or directory, fail with `errc::cross_device_link` if resolving the
+  path would leave the directory tree beneath the base handle, whether by absolute path, `..`
+  or symbolic link. Implemented using `openat2(RESOLVE_BENEATH)` on Linux 5.6 or later, and fails
+  with `errc::operation_not_supported` elsewhere.
+  */
+  resolve_beneath = 1U << 7U,
+  /*! When opening a file or directory, fail with `errc::too_many_symbolic_link_levels` if any
+  component of the path is a symbolic link. Implemented using `openat2(RESOLVE_NO_SYMLINKS)`
+  on Linux 5.6 or later, and fails with `errc::operation_not_supported` elsewhere.
+  */
+  resolve_no_symlinks = 1U << 8U,
+  /*! When opening a file or directory, fail with `errc::resource_unavailable_try_again` rather
+  than block if resolving the path cannot be completed entirely from the kernel's cache of
+  directory entries, or if the open would need to create or truncate. Code running in an
+  asynchronous context can try an open with this flag first, and punt the open to a worker thread
+  without this flag only on failure. Implemented using `openat2(RESOLVE_CACHED)` on Linux 5.12
+  or later, and always fails elsewhere.
+  */
+  resolve_cached_only = 1U << 9U,
 
   win_disable_unlink_emulation = 1U << 24U,  //!< See the documentation for `unlink_on_first_close`
   /*! Microsoft Windows NTFS, having been created in the late 1980s, did not originally
@@ -478,6 +505,22 @@ inline std::ostream &operator<<(std::ostream &s, const handle::flag &v)
   {
     temp.append("maximum_prefetching|");
   }
+  if(!!(v & handle::flag::bounce_unaligned_io))
+  {
+    temp.append("bounce_unaligned_io|");
+  }
+  if(!!(v & handle::flag::resolve_beneath))
+  {
+    temp.append("resolve_beneath|");
+  }
+  if(!!(v & handle::flag::resolve_no_symlinks))
+  {
+    temp.append("resolve_no_symlinks|");
+  }
+  if(!!(v & handle::flag::resolve_cached_only))
+  {
+    temp.append("resolve_cached_only|");
+  }
   if(!!(v & handle::flag::win_disable_unlink_emulation))
   {
     temp.append("win_disable_unlink_emulation|");
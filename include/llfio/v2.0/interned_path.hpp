@@ -0,0 +1,312 @@
+/* Interned paths with precomputed hashes
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_INTERNED_PATH_HPP
+#define LLFIO_INTERNED_PATH_HPP
+
+#include "path_view.hpp"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+//! \file interned_path.hpp Provides interned paths with precomputed hashes, for use as hash map keys
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+class interned_path_arena;
+
+namespace detail
+{
+  struct interned_path_record
+  {
+    uint64_t hash;
+    size_t length;  // in filesystem::path::value_type, excluding the zero terminator which follows this record
+  };
+  // FNV-1a, over the bytes of the native encoding
+  inline uint64_t interned_path_hash(const filesystem::path::value_type *s, size_t length) noexcept
+  {
+    uint64_t ret = 0xcbf29ce484222325ULL;
+    auto *p = reinterpret_cast<const unsigned char *>(s);
+    for(size_t n = 0; n < length * sizeof(*s); n++)
+    {
+      ret = (ret ^ p[n]) * 0x100000001b3ULL;
+    }
+    return ret;
+  }
+}  // namespace detail
+
+/*! \class interned_path
+\brief A compact, immutable reference to a path stored in an `interned_path_arena`, with a precomputed hash.
+
+The path is stored in the native encoding of `filesystem::path::value_type`, so the same path
+interned from narrow, wide, UTF-8 or UTF-16 source yields the same `interned_path`. Because
+an arena stores each distinct path exactly once, comparing two `interned_path` from the same
+arena is a single pointer comparison, and hashing one returns the hash calculated when the
+path was interned. This makes `interned_path` well suited as the key of hash maps which
+are looked up on hot paths.
+
+An `interned_path` is the size of a pointer, and is valid only for as long as the arena it
+came from is neither destroyed nor cleared. A default constructed `interned_path` refers to
+no path, and is distinct from the interned empty path.
+*/
+class interned_path
+{
+  friend class interned_path_arena;
+  const detail::interned_path_record *_r{nullptr};
+
+  explicit constexpr interned_path(const detail::interned_path_record *r) noexcept
+      : _r(r)
+  {
+  }
+
+public:
+  //! The character type of the stored path
+  using value_type = filesystem::path::value_type;
+
+  //! Hashes an `interned_path` for use in unordered containers
+  struct hasher
+  {
+    size_t operator()(interned_path p) const noexcept { return (size_t) p.hash(); }
+  };
+
+  //! Default constructs an instance which refers to no path
+  constexpr interned_path() {}
+
+  //! True if this refers to a path
+  explicit constexpr operator bool() const noexcept { return _r != nullptr; }
+  //! The hash of the path, as calculated when it was interned
+  constexpr uint64_t hash() const noexcept { return (_r != nullptr) ? _r->hash : 0; }
+  //! The length of the path, in `value_type`
+  constexpr size_t size() const noexcept { return (_r != nullptr) ? _r->length : 0; }
+  //! True if this refers to no path, or to the empty path
+  constexpr bool empty() const noexcept { return size() == 0; }
+  //! A pointer to the zero terminated path
+  const value_type *data() const noexcept
+  {
+    static constexpr value_type _empty[1] = {0};
+    return (_r != nullptr) ? reinterpret_cast<const value_type *>(_r + 1) : _empty;
+  }
+  //! A view of the path. This is constant time, and never copies.
+  path_view path() const noexcept { return path_view(data(), size(), true); }
+  //! \overload
+  operator path_view() const noexcept { return path(); }
+
+  /*! Equality. Instances from the same arena compare by address. Instances from different
+  arenas compare by hash and length first, and by content only if those are the same.
+  */
+  friend inline bool operator==(interned_path a, interned_path b) noexcept
+  {
+    if(a._r == b._r)
+    {
+      return true;
+    }
+    if(a._r == nullptr || b._r == nullptr || a._r->hash != b._r->hash || a._r->length != b._r->length)
+    {
+      return false;
+    }
+    return 0 == memcmp(a.data(), b.data(), a.size() * sizeof(value_type));
+  }
+  //! Inequality
+  friend inline bool operator!=(interned_path a, interned_path b) noexcept { return !(a == b); }
+};
+static_assert(sizeof(interned_path) == sizeof(void *), "interned_path is not the size of a pointer!");
+
+/*! \class interned_path_arena
+\brief A thread safe arena of distinct paths, each stored once along with its hash.
+
+Paths are reencoded into `filesystem::path::value_type` and hashed once when interned, and are
+stored contiguously in large chunks of memory which are released only when the arena is
+cleared or destroyed. Looking up a `path_view` which is not in the native encoding costs a
+reencode, as with any other use of `path_view::c_str`, but no dynamic memory allocation for
+shorter paths.
+
+A typical use is an open file cache keyed by `interned_path`, where the path of each request
+is looked up with `find()` once, after which all further hashing and comparison of the key
+is constant time.
+*/
+class interned_path_arena
+{
+  using _record = detail::interned_path_record;
+  using _value_type = interned_path::value_type;
+
+  static constexpr size_t _chunk_size = 65536;
+  mutable std::mutex _lock;
+  std::vector<std::unique_ptr<_record[]>> _chunks;
+  size_t _chunk_used{0}, _chunk_capacity{0};  // in _record
+  std::vector<const _record *> _table;        // open addressed, power of two sized
+  size_t _count{0}, _bytes{0};
+
+  static bool _equal(const _record *r, uint64_t hash, const _value_type *s, size_t length) noexcept
+  {
+    return r->hash == hash && r->length == length && 0 == memcmp(r + 1, s, length * sizeof(_value_type));
+  }
+  // Returns the slot holding the matching record, or the empty slot where it would go
+  const _record **_slot(uint64_t hash, const _value_type *s, size_t length) const noexcept
+  {
+    const size_t mask = _table.size() - 1;
+    for(size_t idx = (size_t) hash & mask;; idx = (idx + 1) & mask)
+    {
+      auto *slot = const_cast<const _record **>(&_table[idx]);
+      if(*slot == nullptr || _equal(*slot, hash, s, length))
+      {
+        return slot;
+      }
+    }
+  }
+  void _grow_table()
+  {
+    std::vector<const _record *> table(_table.empty() ? 64 : _table.size() * 2);
+    const size_t mask = table.size() - 1;
+    for(auto *r : _table)
+    {
+      if(r != nullptr)
+      {
+        size_t idx = (size_t) r->hash & mask;
+        while(table[idx] != nullptr)
+        {
+          idx = (idx + 1) & mask;
+        }
+        table[idx] = r;
+      }
+    }
+    _table = std::move(table);
+  }
+  const _record *_store(uint64_t hash, const _value_type *s, size_t length)
+  {
+    const size_t records = 1 + ((length + 1) * sizeof(_value_type) + sizeof(_record) - 1) / sizeof(_record);
+    if(_chunk_capacity - _chunk_used < records)
+    {
+      const size_t capacity = std::max(records, _chunk_size / sizeof(_record));
+      _chunks.emplace_back(new _record[capacity]);
+      _chunk_used = 0;
+      _chunk_capacity = capacity;
+      _bytes += capacity * sizeof(_record);
+    }
+    auto *r = _chunks.back().get() + _chunk_used;
+    _chunk_used += records;
+    r->hash = hash;
+    r->length = length;
+    auto *d = reinterpret_cast<_value_type *>(r + 1);
+    memcpy(d, s, length * sizeof(_value_type));
+    d[length] = 0;
+    return r;
+  }
+
+public:
+  //! Default constructor
+  interned_path_arena() = default;
+  interned_path_arena(const interned_path_arena &) = delete;
+  interned_path_arena(interned_path_arena &&) = delete;
+  interned_path_arena &operator=(const interned_path_arena &) = delete;
+  interned_path_arena &operator=(interned_path_arena &&) = delete;
+  ~interned_path_arena() = default;
+
+  //! The number of distinct paths interned
+  size_t size() const noexcept
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    return _count;
+  }
+  //! The bytes of memory allocated for storing paths, excluding the lookup table
+  size_t bytes() const noexcept
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    return _bytes;
+  }
+  //! Releases all interned paths. All `interned_path` previously returned become invalid.
+  void clear() noexcept
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    _chunks.clear();
+    _table.clear();
+    _chunk_used = _chunk_capacity = _count = _bytes = 0;
+  }
+
+  /*! \brief Returns the interned instance of `p`, interning it if it has not been seen before.
+
+  \errors `errc::illegal_byte_sequence` if `p` is invalid UTF, else `errc::not_enough_memory`.
+  */
+  result<interned_path> intern(path_view p) noexcept
+  {
+    try
+    {
+      path_view::c_str<> zpath(p, false);
+      const uint64_t hash = detail::interned_path_hash(zpath.buffer, zpath.length);
+      std::lock_guard<std::mutex> g(_lock);
+      if((_count + 1) * 2 > _table.size())
+      {
+        _grow_table();
+      }
+      auto *slot = _slot(hash, zpath.buffer, zpath.length);
+      if(*slot == nullptr)
+      {
+        *slot = _store(hash, zpath.buffer, zpath.length);
+        ++_count;
+      }
+      return interned_path(*slot);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  /*! \brief Returns the interned instance of `p`, or a default constructed `interned_path` if
+  `p` has not been interned. Never allocates memory for shorter paths.
+
+  \errors `errc::illegal_byte_sequence` if `p` is invalid UTF.
+  */
+  result<interned_path> find(path_view p) const noexcept
+  {
+    try
+    {
+      path_view::c_str<> zpath(p, false);
+      const uint64_t hash = detail::interned_path_hash(zpath.buffer, zpath.length);
+      std::lock_guard<std::mutex> g(_lock);
+      if(_table.empty())
+      {
+        return interned_path();
+      }
+      return interned_path(*_slot(hash, zpath.buffer, zpath.length));
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+};
+
+LLFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
@@ -52,18 +52,55 @@ public:
   using caching = handle::caching;
   using flag = handle::flag;
   using barrier_kind = io_multiplexer::barrier_kind;
+  using write_flag = io_multiplexer::write_flag;
   using buffer_type = io_multiplexer::buffer_type;
   using const_buffer_type = io_multiplexer::const_buffer_type;
   using buffers_type = io_multiplexer::buffers_type;
   using const_buffers_type = io_multiplexer::const_buffers_type;
+  using buffers_list_type = io_multiplexer::buffers_list_type;
+  using const_buffers_list_type = io_multiplexer::const_buffers_list_type;
   using registered_buffer_type = io_multiplexer::registered_buffer_type;
   template <class T> using io_request = io_multiplexer::io_request<T>;
   template <class T> using io_result = io_multiplexer::io_result<T>;
   template <class T> using awaitable = io_multiplexer::awaitable<T>;
 
+  //! Statistics about the i/o performed by an i/o handle, recorded if `LLFIO_ENABLE_IO_STATISTICS` is enabled.
+  struct io_statistics
+  {
+    //! Statistics for one kind of i/o
+    struct counters
+    {
+      uint64_t ops{0};              //!< The number of i/o performed
+      uint64_t failures{0};         //!< How many of those failed
+      uint64_t bytes{0};            //!< Bytes transferred by successful i/o (not recorded for barriers)
+      uint64_t short_transfers{0};  //!< Successful i/o which transferred fewer bytes than requested (not recorded for barriers)
+      //! Bucket `n` counts i/o which took less than `2^(n+1)` nanoseconds, except that the last bucket counts all slower i/o.
+      uint64_t latency_histogram[32]{};
+    } reads, writes, barriers;
+  };
+
 protected:
   io_multiplexer *_ctx{nullptr};  // +4 or +8 bytes
 
+#if LLFIO_ENABLE_IO_STATISTICS
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _record_statistics(io_statistics::counters io_statistics::*which, bool failed, size_type requested, size_type transferred,
+                                                          std::chrono::steady_clock::duration took) const noexcept;
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void _forget_statistics() const noexcept;
+  template <class Reqs, class F> auto _with_statistics(io_statistics::counters io_statistics::*which, const Reqs &reqs, F &&f) noexcept -> decltype(f())
+  {
+    size_type requested = 0;
+    for(const auto &b : reqs.buffers)
+    {
+      requested += b.size();
+    }
+    const auto began = std::chrono::steady_clock::now();
+    auto ret = f();
+    const auto took = std::chrono::steady_clock::now() - began;
+    _record_statistics(which, !ret, requested, ret ? ret.bytes_transferred() : 0, took);
+    return ret;
+  }
+#endif
+
 public:
   //! Default constructor
   constexpr io_handle() {}  // NOLINT
@@ -96,9 +133,25 @@ public:
     {
       OUTCOME_TRY(set_multiplexer(nullptr));
     }
+#if LLFIO_ENABLE_IO_STATISTICS
+    _forget_statistics();
+#endif
     return handle::close();
   }
 
+  /*! \brief Returns the statistics recorded for i/o upon this handle since it was opened,
+  or since `reset_statistics()` was last called.
+
+  Statistics are only recorded if `LLFIO_ENABLE_IO_STATISTICS` is defined to 1, otherwise
+  all counters are always zero. Each thread records into its own shard, so recording
+  is uncontended, and this call sums all the shards. Statistics are keyed by the address
+  of the handle, so they do not follow the handle if it is moved, and they are discarded
+  when the handle is closed.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC io_statistics statistics() const noexcept;
+  //! Resets all the statistics recorded for this handle to zero.
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void reset_statistics() noexcept;
+
   /*! \brief The i/o multiplexer this handle will use to multiplex i/o. If this returns null,
   then this handle has not been registered with an i/o multiplexer yet.
   */
@@ -142,6 +195,40 @@ protected:
   //! The virtualised implementation of `barrier()` used if no multiplexer has been set.
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_barrier(io_request<const_buffers_type> reqs, barrier_kind kind, deadline d) noexcept;
 
+  /* Performs a request with more buffers than the syscall accepts as consecutive requests of
+  at most `batch` buffers each using `f`, stopping at the first short transfer.
+  */
+  template <class BuffersType, class F> static io_result<BuffersType> _do_split_request(io_request<BuffersType> reqs, size_t batch, deadline d, F &&f) noexcept
+  {
+    LLFIO_DEADLINE_TO_SLEEP_INIT(d);
+    io_request<BuffersType> thisreq(reqs);
+    for(size_t n = 0; n < reqs.buffers.size();)
+    {
+      deadline nd;
+      LLFIO_DEADLINE_TO_PARTIAL_DEADLINE(nd, d);
+      thisreq.buffers = reqs.buffers.subspan(n, (std::min)(batch, reqs.buffers.size() - n));
+      size_type requested = 0;
+      for(auto &b : thisreq.buffers)
+      {
+        requested += b.size();
+      }
+      OUTCOME_TRY(auto &&transferred, f(thisreq, nd));
+      size_type bytes = 0;
+      for(auto &b : transferred)
+      {
+        bytes += b.size();
+      }
+      n += transferred.size();
+      if(bytes < requested)
+      {
+        // The transferred buffers are views of our buffers, so their sizes are already updated
+        return {reqs.buffers.subspan(0, n)};
+      }
+      thisreq.offset += bytes;
+    }
+    return {reqs.buffers};
+  }
+
   io_result<buffers_type> _do_multiplexer_read(registered_buffer_type &&base, io_request<buffers_type> reqs, deadline d) noexcept
   {
     LLFIO_DEADLINE_TO_SLEEP_INIT(d);
@@ -209,15 +296,20 @@ public:
   lower than this system-defined limit, depending on available resources. The `read()` or `write()`
   call will return the buffers accepted at the time of invoking the syscall.
 
-  Note also that some OSs will error out if you supply more than this limit to `read()` or `write()`,
-  but other OSs do not. Some OSs guarantee that each i/o syscall has effects atomically visible or not
+  Note also that some OSs will error out if you supply more than this limit to a single i/o syscall,
+  but other OSs do not. If no multiplexer is set, `read()` and `write()` split requests with more
+  buffers than this limit into consecutive syscalls, stopping at the first short transfer, and
+  such requests are thus not atomic. Some OSs guarantee that each i/o syscall has effects atomically visible or not
   to other i/o, other OSs do not.
 
   OS X does not implement scatter-gather file i/o syscalls. Thus this function will always return
   `1` in that situation.
 
   Microsoft Windows *may* implement scatter-gather i/o under certain handle configurations.
-  Most of the time for non-socket handles this function will return `1`.
+  Most of the time for non-socket handles this function will return `1`. Lists of buffers
+  which are each page aligned and a whole number of pages long, upon a non-blocking
+  `caching::none` handle, are issued as a single i/o using `ReadFileScatter()`/`WriteFileGather()`,
+  but as this depends on the buffers, it is not reflected here.
 
   For handles which implement i/o entirely in user space, and thus syscalls are not involved,
   this function will return `0`.
@@ -281,10 +373,25 @@ public:
   The asynchronous implementation in async_file_handle performs one calloc and one free.
   */
   LLFIO_MAKE_FREE_FUNCTION
-  io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept { return (_ctx == nullptr) ? _do_read(reqs, d) : _do_multiplexer_read({}, reqs, d); }
+  io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept
+  {
+#if LLFIO_ENABLE_IO_STATISTICS
+    return _with_statistics(&io_statistics::reads, reqs, [&] { return (_ctx == nullptr) ? _do_read(reqs, d) : _do_multiplexer_read({}, reqs, d); });
+#else
+    return (_ctx == nullptr) ? _do_read(reqs, d) : _do_multiplexer_read({}, reqs, d);
+#endif
+  }
   //! \overload Registered buffer overload, scatter list **must** be wholly within the registered buffer
   LLFIO_MAKE_FREE_FUNCTION
-  io_result<buffers_type> read(registered_buffer_type base, io_request<buffers_type> reqs, deadline d = deadline()) noexcept { return (_ctx == nullptr) ? _do_read(std::move(base), reqs, d) : _do_multiplexer_read(std::move(base), reqs, d); }
+  io_result<buffers_type> read(registered_buffer_type base, io_request<buffers_type> reqs, deadline d = deadline()) noexcept
+  {
+#if LLFIO_ENABLE_IO_STATISTICS
+    return _with_statistics(&io_statistics::reads, reqs,
+                            [&] { return (_ctx == nullptr) ? _do_read(std::move(base), reqs, d) : _do_multiplexer_read(std::move(base), reqs, d); });
+#else
+    return (_ctx == nullptr) ? _do_read(std::move(base), reqs, d) : _do_multiplexer_read(std::move(base), reqs, d);
+#endif
+  }
   //! \overload Convenience initialiser list based overload for `read()`
   LLFIO_MAKE_FREE_FUNCTION
   io_result<size_type> read(extent_type offset, std::initializer_list<buffer_type> lst, deadline d = deadline()) noexcept
@@ -324,10 +431,26 @@ public:
   The asynchronous implementation in async_file_handle performs one calloc and one free.
   */
   LLFIO_MAKE_FREE_FUNCTION
-  io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept { return (_ctx == nullptr) ? _do_write(reqs, d) : _do_multiplexer_write({}, std::move(reqs), d); }
+  io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept
+  {
+#if LLFIO_ENABLE_IO_STATISTICS
+    return _with_statistics(&io_statistics::writes, reqs, [&] { return (_ctx == nullptr) ? _do_write(reqs, d) : _do_multiplexer_write({}, std::move(reqs), d); });
+#else
+    return (_ctx == nullptr) ? _do_write(reqs, d) : _do_multiplexer_write({}, std::move(reqs), d);
+#endif
+  }
   //! \overload Registered buffer overload, gather list **must** be wholly within the registered buffer
   LLFIO_MAKE_FREE_FUNCTION
-  io_result<const_buffers_type> write(registered_buffer_type base, io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept { return (_ctx == nullptr) ? _do_write(std::move(base), reqs, d) : _do_multiplexer_write(std::move(base), std::move(reqs), d); }
+  io_result<const_buffers_type> write(registered_buffer_type base, io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept
+  {
+#if LLFIO_ENABLE_IO_STATISTICS
+    return _with_statistics(&io_statistics::writes, reqs, [&] {
+      return (_ctx == nullptr) ? _do_write(std::move(base), reqs, d) : _do_multiplexer_write(std::move(base), std::move(reqs), d);
+    });
+#else
+    return (_ctx == nullptr) ? _do_write(std::move(base), reqs, d) : _do_multiplexer_write(std::move(base), std::move(reqs), d);
+#endif
+  }
   //! \overload Convenience initialiser list based overload for `write()`
   LLFIO_MAKE_FREE_FUNCTION
   io_result<size_type> write(extent_type offset, std::initializer_list<const_buffer_type> lst, deadline d = deadline()) noexcept
@@ -377,7 +500,12 @@ public:
   LLFIO_MAKE_FREE_FUNCTION
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> barrier(io_request<const_buffers_type> reqs = io_request<const_buffers_type>(), barrier_kind kind = barrier_kind::nowait_data_only, deadline d = deadline()) noexcept
   {
+#if LLFIO_ENABLE_IO_STATISTICS
+    return _with_statistics(&io_statistics::barriers, reqs,
+                            [&] { return (_ctx == nullptr) ? _do_barrier(reqs, kind, d) : _do_multiplexer_barrier({}, std::move(reqs), kind, d); });
+#else
     return (_ctx == nullptr) ? _do_barrier(reqs, kind, d) : _do_multiplexer_barrier({}, std::move(reqs), kind, d);
+#endif
   }
   //! \overload Convenience overload
   LLFIO_MAKE_FREE_FUNCTION
@@ -522,6 +650,18 @@ template <class T> inline bool io_multiplexer::awaitable<T>::await_ready() noexc
   }
   return is_finished(state);
 }
+#if LLFIO_ENABLE_COROUTINES
+template <class T> inline void io_multiplexer::awaitable<T>::_resume(coroutine_handle<> coro)
+{
+  io_multiplexer *m = _state->h->multiplexer();
+  if(m != nullptr && m->_coroutine_resume_hook != nullptr)
+  {
+    m->_coroutine_resume_hook(m->_coroutine_resume_hook_context, coro.address());
+    return;
+  }
+  coro.resume();
+}
+#endif
 template <class T> inline io_multiplexer::awaitable<T>::~awaitable()
 {
   if(_state != nullptr)
@@ -612,22 +752,24 @@ LLFIO_V2_NAMESPACE_END
 
 #if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
 #define LLFIO_INCLUDED_BY_HEADER 1
+#include "detail/impl/io_statistics.ipp"
 #if LLFIO_ENABLE_TEST_IO_MULTIPLEXERS
 #include "detail/impl/test/null_multiplexer.ipp"
 #endif
 
 #ifdef _WIN32
-#if LLFIO_ENABLE_TEST_IO_MULTIPLEXERS
-#include "detail/impl/windows/test/iocp_multiplexer.ipp"
-#else
 #include "detail/impl/windows/io_handle.ipp"
-#endif
-#else
-#if LLFIO_ENABLE_TEST_IO_MULTIPLEXERS
-//#include "detail/impl/posix/test/io_uring_multiplexer.ipp"
+#include "detail/impl/windows/iocp_multiplexer.ipp"
+#include "detail/impl/windows/ioring_multiplexer.ipp"
 #else
-#endif
 #include "detail/impl/posix/io_handle.ipp"
+#ifdef __linux__
+#include "detail/impl/posix/epoll_multiplexer.ipp"
+#include "detail/impl/posix/io_uring_multiplexer.ipp"
+#endif
+#if defined(__FreeBSD__) || defined(__APPLE__)
+#include "detail/impl/posix/kqueue_multiplexer.ipp"
+#endif
 #endif
 #undef LLFIO_INCLUDED_BY_HEADER
 #endif
@@ -30,6 +30,9 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "handle.hpp"
 
+#include <atomic>
+#include <cstring>  // for memcpy
+#include <initializer_list>
 #include <memory>  // for unique_ptr and shared_ptr
 
 #ifdef _MSC_VER
@@ -141,10 +144,272 @@ constexpr inline bool is_finished(io_operation_state_type s) noexcept
   return false;
 }
 
+namespace detail
+{
+  /* Per-thread cache of heap storage for buffer_list, bucketed by the power of two of its size,
+  so steady state gather lists longer than their inline capacity allocate nothing.
+  */
+  struct buffer_list_arena
+  {
+    static constexpr size_t max_items = 8;
+    struct bucket_t
+    {
+      void *items[max_items];
+      size_t count{0};
+    } buckets[sizeof(size_t) * 8];
+    ~buffer_list_arena()
+    {
+      for(auto &b : buckets)
+      {
+        while(b.count > 0)
+        {
+          ::operator delete(b.items[--b.count]);
+        }
+      }
+    }
+    static buffer_list_arena &thread() noexcept
+    {
+      static thread_local buffer_list_arena v;
+      return v;
+    }
+    static size_t bucket(size_t bytes) noexcept
+    {
+      size_t ret = 0;
+      while((size_t(1) << ret) < bytes)
+      {
+        ++ret;
+      }
+      return ret;
+    }
+    // Allocates (size_t(1) << idx) bytes
+    void *allocate(size_t idx)
+    {
+      auto &b = buckets[idx];
+      if(b.count > 0)
+      {
+        return b.items[--b.count];
+      }
+      return ::operator new(size_t(1) << idx);
+    }
+    void deallocate(void *p, size_t idx) noexcept
+    {
+      auto &b = buckets[idx];
+      if(b.count < max_items)
+      {
+        b.items[b.count++] = p;
+        return;
+      }
+      ::operator delete(p);
+    }
+  };
+}  // namespace detail
+
+/*! \class buffer_list
+\brief A list of scatter or gather buffers, with inline capacity for `InlineCapacity` buffers,
+and thereafter storage from a per-thread cache. Converts implicitly to the `span` used by
+`io_request`, so building buffer lists dynamically for every i/o allocates nothing in the steady state.
+
+Like the buffers themselves, the list must outlive any i/o, including asynchronous i/o via an
+i/o multiplexer, whose request refers to it. The multiplexer stores only the span, so nothing is
+copied. Moving a list whose buffers have spilled out of its inline capacity keeps the span valid,
+moving a list whose buffers are inline does not.
+*/
+template <class T, size_t InlineCapacity = 16> class buffer_list
+{
+  static_assert(std::is_trivially_copyable<T>::value, "buffer_list<T> requires T to be trivially copyable");
+  static_assert(InlineCapacity > 0, "buffer_list requires some inline capacity");
+
+  // Not zero initialised, as only the first _size buffers are ever read
+  union _inline_t
+  {
+    T items[InlineCapacity];
+    _inline_t() noexcept {}  // NOLINT
+  };
+
+  T *_begin{_inline.items};
+  size_t _size{0}, _capacity{InlineCapacity};
+  _inline_t _inline;
+
+  bool _is_inline() const noexcept { return _begin == _inline.items; }
+  void _release() noexcept
+  {
+    if(!_is_inline())
+    {
+      detail::buffer_list_arena::thread().deallocate(_begin, detail::buffer_list_arena::bucket(_capacity * sizeof(T)));
+    }
+    _begin = _inline.items;
+    _capacity = InlineCapacity;
+  }
+  void _grow(size_t n)
+  {
+    const size_t idx = detail::buffer_list_arena::bucket(n * sizeof(T));
+    auto *p = static_cast<T *>(detail::buffer_list_arena::thread().allocate(idx));
+    memcpy(p, _begin, _size * sizeof(T));
+    const size_t size = _size;
+    _release();
+    _begin = p;
+    _size = size;
+    _capacity = (size_t(1) << idx) / sizeof(T);
+  }
+
+public:
+  //! The buffer type
+  using value_type = T;
+  //! The size type
+  using size_type = size_t;
+  //! The iterator type
+  using iterator = T *;
+  //! The const iterator type
+  using const_iterator = const T *;
+  //! The span type this list converts into
+  using span_type = span<T>;
+
+  //! Default constructor
+  buffer_list() noexcept {}  // NOLINT
+  //! Constructs from a list of buffers
+  buffer_list(std::initializer_list<T> il)
+  {
+    reserve(il.size());
+    memcpy(_begin, il.begin(), il.size() * sizeof(T));
+    _size = il.size();
+  }
+  //! Copy constructor
+  buffer_list(const buffer_list &o)
+  {
+    reserve(o._size);
+    memcpy(_begin, o._begin, o._size * sizeof(T));
+    _size = o._size;
+  }
+  //! Move constructor, which steals any storage outside of the inline capacity
+  buffer_list(buffer_list &&o) noexcept
+  {
+    if(o._is_inline())
+    {
+      memcpy(_begin, o._begin, o._size * sizeof(T));
+      _size = o._size;
+    }
+    else
+    {
+      _begin = o._begin;
+      _size = o._size;
+      _capacity = o._capacity;
+      o._begin = o._inline.items;
+      o._capacity = InlineCapacity;
+    }
+    o._size = 0;
+  }
+  //! Copy assignment
+  buffer_list &operator=(const buffer_list &o)
+  {
+    if(this != &o)
+    {
+      clear();
+      reserve(o._size);
+      memcpy(_begin, o._begin, o._size * sizeof(T));
+      _size = o._size;
+    }
+    return *this;
+  }
+  //! Move assignment
+  buffer_list &operator=(buffer_list &&o) noexcept
+  {
+    if(this != &o)
+    {
+      _release();
+      if(o._is_inline())
+      {
+        memcpy(_begin, o._begin, o._size * sizeof(T));
+        _size = o._size;
+      }
+      else
+      {
+        _begin = o._begin;
+        _size = o._size;
+        _capacity = o._capacity;
+        o._begin = o._inline.items;
+        o._capacity = InlineCapacity;
+      }
+      o._size = 0;
+    }
+    return *this;
+  }
+  ~buffer_list() { _release(); }
+
+  //! The span of buffers
+  span_type as_span() noexcept { return span_type(_begin, _size); }
+  //! The span of buffers
+  operator span_type() noexcept { return as_span(); }  // NOLINT
+
+  //! Pointer to the buffers
+  T *data() noexcept { return _begin; }
+  //! Pointer to the buffers
+  const T *data() const noexcept { return _begin; }
+  //! The number of buffers
+  size_type size() const noexcept { return _size; }
+  //! True if there are no buffers
+  bool empty() const noexcept { return _size == 0; }
+  //! The number of buffers which can be held without allocating
+  size_type capacity() const noexcept { return _capacity; }
+  //! True if the buffers are held within the inline capacity
+  bool is_inline() const noexcept { return _is_inline(); }
+  iterator begin() noexcept { return _begin; }
+  const_iterator begin() const noexcept { return _begin; }
+  iterator end() noexcept { return _begin + _size; }
+  const_iterator end() const noexcept { return _begin + _size; }
+  T &operator[](size_type i) noexcept { return _begin[i]; }
+  const T &operator[](size_type i) const noexcept { return _begin[i]; }
+  T &back() noexcept { return _begin[_size - 1]; }
+  const T &back() const noexcept { return _begin[_size - 1]; }
+
+  //! Ensures capacity for at least `n` buffers
+  void reserve(size_type n)
+  {
+    if(n > _capacity)
+    {
+      _grow(n);
+    }
+  }
+  //! Appends a buffer
+  void push_back(const T &v)
+  {
+    if(_size == _capacity)
+    {
+      _grow(_capacity * 2);
+    }
+    _begin[_size++] = v;
+  }
+  //! Appends a buffer constructed from `args`
+  template <class... Args> T &emplace_back(Args &&... args)
+  {
+    push_back(T(std::forward<Args>(args)...));
+    return back();
+  }
+  //! Removes the last buffer
+  void pop_back() noexcept { --_size; }
+  //! Removes all buffers, retaining capacity
+  void clear() noexcept { _size = 0; }
+  //! Moves the buffers back into the inline capacity if they fit, releasing any other storage
+  void shrink_to_fit() noexcept
+  {
+    if(!_is_inline() && _size <= InlineCapacity)
+    {
+      T *old = _begin;
+      const size_t size = _size, capacity = _capacity;
+      memcpy(_inline.items, old, size * sizeof(T));
+      _begin = _inline.items;
+      _capacity = InlineCapacity;
+      _size = size;
+      detail::buffer_list_arena::thread().deallocate(old, detail::buffer_list_arena::bucket(capacity * sizeof(T)));
+    }
+  }
+};
+
 /*! \class io_multiplexer
 \brief A multiplexer of byte-orientated i/o.
 
-LLFIO does not provide out-of-the-box multiplexing of byte i/o, however it does provide the ability
+LLFIO does not provide out-of-the-box multiplexing of byte i/o, except on Linux via
+`multiplexer_linux_io_uring()` and `multiplexer_linux_epoll()`, on BSD via
+`multiplexer_bsd_kqueue()`, and on Windows via `multiplexer_win_iocp()`, however it does provide the ability
 to create `io_handle` instances with the `handle::flag::multiplexable` set. With that flag set, the
 following LLFIO classes change how they create handles with the kernel:
 
@@ -179,6 +444,31 @@ class LLFIO_DECL io_multiplexer : public handle
   {
   };
 
+  // Created on first use by allocate_io_operation_state_storage(), as io_state_requirements()
+  // cannot be called during construction
+  struct _io_operation_state_pool;
+  struct _io_operation_state_pool_ptr
+  {
+    std::atomic<_io_operation_state_pool *> v{nullptr};
+
+    constexpr _io_operation_state_pool_ptr() {}
+    _io_operation_state_pool_ptr(_io_operation_state_pool_ptr &&o) noexcept
+        : v(o.v.exchange(nullptr))
+    {
+    }
+    _io_operation_state_pool_ptr &operator=(_io_operation_state_pool_ptr &&o) noexcept
+    {
+      // Our old pool is destroyed with o
+      o.v = v.exchange(o.v.load());
+      return *this;
+    }
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC ~_io_operation_state_pool_ptr();
+  } _state_pool;
+
+  // Present whether or not coroutines are enabled, so the layout does not vary
+  void (*_coroutine_resume_hook)(void *context, void *coroutine_address){nullptr};
+  void *_coroutine_resume_hook_context{nullptr};
+
 public:
   using path_type = handle::path_type;
   using extent_type = handle::extent_type;
@@ -344,6 +634,9 @@ public:
 
   struct _registered_buffer_type : std::enable_shared_from_this<_registered_buffer_type>, span<byte>
   {
+    //! If not null, the registered buffer of which this buffer is a part e.g. from a `registered_buffer_pool`.
+    std::shared_ptr<_registered_buffer_type> parent;
+
     using span<byte>::span;
     explicit _registered_buffer_type(span<byte> o)
         : span<byte>(o)
@@ -363,6 +656,10 @@ public:
   using buffers_type = span<buffer_type>;
   //! The gather buffers type used by this handle. Guaranteed to be `TrivialType` apart from construction, and `StandardLayoutType`.
   using const_buffers_type = span<const_buffer_type>;
+  //! A list of scatter buffers with inline capacity, which converts implicitly into `buffers_type`.
+  using buffers_list_type = buffer_list<buffer_type>;
+  //! A list of gather buffers with inline capacity, which converts implicitly into `const_buffers_type`.
+  using const_buffers_list_type = buffer_list<const_buffer_type>;
 #ifndef NDEBUG
   // Is trivial in all ways, except default constructibility
   static_assert(std::is_trivially_copyable<buffers_type>::value, "buffers_type is not trivially copyable!");
@@ -377,17 +674,62 @@ public:
 #endif
 #endif
 
+  /*! \brief Per-request flags for writes, which let individual writes differ from the caching
+  the handle was opened with.
+
+  On Linux these map onto the `RWF_*` flags of `pwritev2()` and io_uring. Elsewhere, and upon
+  kernels too old for `pwritev2()`, the durability flags are emulated by a barrier after the write,
+  and `uncached` by advising the kernel to drop the written range from its cache. On Windows,
+  `append` writes are issued at `FILE_WRITE_TO_END_OF_FILE`. `append` cannot be emulated on
+  other POSIX, which fail it with `errc::not_supported`, as is `atomic` everywhere it is not
+  natively supported. Multiplexers pass the flags to the kernel,
+  which may fail the write if it does not support them. These flags are ignored for reads.
+  */
+  QUICKCPPLIB_BITFIELD_BEGIN(write_flag){
+  none = 0U,  //!< No flags
+  /*! The data written, and any metadata needed to retrieve it, reaches storage before the write
+  completes, as if the handle had been opened with `caching::reads` (`RWF_DSYNC`).
+  */
+  data_sync = 1U << 0U,
+  /*! The data written, and all metadata, reaches storage before the write completes, as if the
+  handle had been opened with `caching::reads_and_metadata` (`RWF_SYNC`).
+  */
+  sync = 1U << 1U,
+  /*! The buffers are appended atomically to the end of the file, and the offset is ignored
+  (`RWF_APPEND`).
+  */
+  append = 1U << 2U,
+  /*! The written pages are dropped from the kernel page cache once they reach storage, without
+  affecting the caching of the rest of the file (`RWF_DONTCACHE`, originally proposed as
+  `RWF_UNCACHED`, Linux 6.14 onwards).
+  */
+  uncached = 1U << 3U,
+  /*! The write is never seen torn, either by concurrent readers or after power loss, so long as it
+  is a single buffer whose length is a power of two within `file_handle::atomic_write_limits()`,
+  and whose offset is naturally aligned to that length (`RWF_ATOMIC`, Linux 6.11 onwards).
+  */
+  atomic = 1U << 4U
+  } QUICKCPPLIB_BITFIELD_END(write_flag);
+
   //! The i/o request type used by this handle. Guaranteed to be `TrivialType` apart from construction, and `StandardLayoutType`.
   template <class T> struct io_request
   {
     T buffers{};
     extent_type offset{0};
+    //! Flags for this request, if it is a write
+    write_flag flags{write_flag::none};
     constexpr io_request() {}  // NOLINT (defaulting this breaks clang and GCC, so don't do it!)
     constexpr io_request(T _buffers, extent_type _offset)
         : buffers(std::move(_buffers))
         , offset(_offset)
     {
     }
+    constexpr io_request(T _buffers, extent_type _offset, write_flag _flags)
+        : buffers(std::move(_buffers))
+        , offset(_offset)
+        , flags(_flags)
+    {
+    }
   };
 #ifndef NDEBUG
   // Is trivial in all ways, except default constructibility
@@ -1096,8 +1438,10 @@ protected:
 // Size of an awaitable
 #ifdef _WIN32
   static constexpr size_t _awaitable_size = 2048;  // IOCP implementation is unavoidably large
+#elif defined(__FreeBSD__)
+  static constexpr size_t _awaitable_size = 512;  // kqueue implementation embeds a struct aiocb
 #else
-  static constexpr size_t _awaitable_size = 128;
+  static constexpr size_t _awaitable_size = 256;  // io_uring implementation needs more than 128
 #endif
   static io_result<buffers_type> _result_type_from_io_operation_state(io_operation_state *state, buffers_type * /*unused*/) noexcept
   {
@@ -1109,6 +1453,9 @@ protected:
   }
 
 public:
+  //! The bytes of storage within which the i/o operation state of any multiplexer in this library can be constructed.
+  static constexpr size_t io_operation_state_storage_size = _awaitable_size - 2 * sizeof(void *) - sizeof(io_operation_state *);
+
   /*! \brief A convenience coroutine awaitable type returned by `.co_read()`, `.co_write()` and
   `.co_barrier()`. **Blocks execution** if no i/o multiplexer has been set on this handle!
 
@@ -1117,7 +1464,15 @@ public:
 
   If the i/o does not complete immediately, the coroutine is suspended. To cause resumption
   of execution, you will need to pump the associated i/o multiplexer for completions using
-  `io_multiplexer::check_for_any_completed_io()`.
+  `io_multiplexer::check_for_any_completed_io()`. By default the coroutine is resumed from
+  within completion processing, but if a hook has been set using
+  `io_multiplexer::set_coroutine_resume_hook()`, the coroutine is handed to that instead.
+
+  If the i/o completes between `.await_ready()` and `.await_suspend()`, suspension is
+  abandoned and the awaiting coroutine continues without a nested resumption, so long
+  chains of immediately completing i/o do not grow the stack.
+
+  No dynamic memory allocation is ever performed by this type.
   */
   template <class T> struct awaitable final : protected io_operation_state_visitor
   {
@@ -1198,23 +1553,30 @@ public:
     }
 
 #if LLFIO_ENABLE_COROUTINES
-    //! Suspends the coroutine for resumption after the i/o finishes
-    void await_suspend(coroutine_handle<> coro)
+    //! Suspends the coroutine for resumption after the i/o finishes, returning false if it already has
+    bool await_suspend(coroutine_handle<> coro)
     {
+      // Rather than resume the coroutine from within here, which nests a stack frame
+      // per immediately completing i/o, decline the suspension
+      bool suspended = false;
       _state->invoke(make_function_ptr<void *(io_operation_state_type)>([&](io_operation_state_type s) -> void * {
         if(is_finished(s))
         {
-          coro.resume();
           return nullptr;
         }
         // std::cout << "Coroutine " << _state << " suspends" << std::endl;
         _coro = coro;
+        suspended = true;
         return nullptr;
       }));
+      return suspended;
     }
 #endif
 
   private:
+#if LLFIO_ENABLE_COROUTINES
+    inline void _resume(coroutine_handle<> coro);  // defined in io_handle.hpp
+#endif
     const void *_identifying_address() const noexcept
     {
       switch(this->state)
@@ -1269,7 +1631,7 @@ public:
         auto coro = _coro;
         _coro = {};
         g.unlock();
-        coro.resume();
+        _resume(coro);
       }
 #endif
     }
@@ -1286,7 +1648,7 @@ public:
         auto coro = _coro;
         _coro = {};
         g.unlock();
-        coro.resume();
+        _resume(coro);
       }
 #endif
     }
@@ -1294,9 +1656,45 @@ public:
   static_assert(sizeof(awaitable<io_result<buffers_type>>) == _awaitable_size, "awaitable<io_result<buffers_type>> is not _awaitable_size bytes in length!");
 
 public:
+  /*! \brief Sets a hook to which coroutines suspended upon an `awaitable` are handed when
+  their i/o finishes, instead of being resumed from within completion processing.
+
+  The hook receives `context`, and the value of `coroutine_handle<>::address()` for the
+  coroutine to be resumed. It is called without any locks held, by whichever thread
+  finished the i/o. A typical hook appends the coroutine to a work queue, so resumptions
+  can be batched, and resumed upon a thread and executor of your choosing. Set a null
+  hook to restore resumption from within completion processing. The hook must not be
+  changed whilst any awaitable is suspended.
+  */
+  void set_coroutine_resume_hook(void (*hook)(void *context, void *coroutine_address), void *context = nullptr) noexcept
+  {
+    _coroutine_resume_hook = hook;
+    _coroutine_resume_hook_context = context;
+  }
+
   //! Returns the number of bytes, and alignment required, for an `io_operation_state` for this multiplexer
   virtual std::pair<size_t, size_t> io_state_requirements() noexcept = 0;
 
+  /*! \brief Returns storage meeting `io_state_requirements()` from a pool owned by this multiplexer.
+
+  Storage is handed out from slabs of cache line aligned blocks, and each block is cache line
+  aligned and padded, so i/o operation states in use by different threads never share
+  a cache line. Each thread has its own free list within the pool, so allocation and
+  deallocation take no locks and perform no dynamic memory allocation once the pool
+  has grown to the number of i/o operation states in use. Storage may be deallocated
+  by a different thread to the one which allocated it.
+
+  All storage must be returned using `deallocate_io_operation_state_storage()` before
+  the multiplexer is destroyed.
+
+  \errors `errc::not_enough_memory` if the pool needs to grow and cannot.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<span<byte>> allocate_io_operation_state_storage() noexcept;
+  /*! \brief Returns storage previously obtained from `allocate_io_operation_state_storage()` to the pool.
+  Any i/o operation state constructed in the storage must already have been destroyed.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void deallocate_io_operation_state_storage(span<byte> storage) noexcept;
+
   /*! \brief Constructs either a `unsynchronised_io_operation_state` or a `synchronised_io_operation_state`
   for a read operation into the storage provided. The i/o is not initiated. The storage must
   meet the requirements from `state_requirements()`.
@@ -1355,6 +1753,69 @@ public:
     return state;
   }
 
+  /*! \brief Initiates the i/o in many previously constructed states, and then flushes them.
+
+  The default implementation calls `.init_io_operation()` on each state in turn followed by
+  `.flush_inited_io_operations()`. Multiplexers override this to amortise locking and
+  submission across the batch, so that for example on Linux io_uring a single
+  `io_uring_enter()` submits the lot. The same rules regarding relocation apply
+  as for `.init_io_operation()`.
+  */
+  virtual result<void> init_io_operations(span<io_operation_state *> states) noexcept
+  {
+    for(auto *state : states)
+    {
+      init_io_operation(state);
+    }
+    return flush_inited_io_operations();
+  }
+
+  /*! \brief Constructs and initiates a batch of reads or writes upon a single handle.
+
+  \param storage Storage for the states, which must be aligned to `io_state_requirements().second`,
+  and be at least `reqs.size()` multiplied by `io_state_requirements().first` rounded up to its alignment.
+  \param states Filled with the states constructed, so must be at least `reqs.size()` long.
+  \param _h The handle upon which to perform the i/o.
+  \param _visitor The visitor for every i/o in the batch.
+  \param b The registered buffer for every i/o in the batch, if any.
+  \param d The deadline for every i/o in the batch.
+  \param reqs The i/o requests.
+
+  Each state is constructed into consecutive slots of `storage`, then the whole batch is initiated
+  and flushed using `.init_io_operations()`. Returns the span of `states` filled.
+
+  \errors `errc::invalid_argument` if `storage` or `states` are too small or misaligned.
+  Otherwise any of the values `.flush_inited_io_operations()` can return.
+  */
+  template <class BuffersType>
+  result<span<io_operation_state *>> construct_and_init_io_operations(span<byte> storage, span<io_operation_state *> states, io_handle *_h,
+                                                                      io_operation_state_visitor *_visitor, registered_buffer_type b, deadline d,
+                                                                      span<const io_request<BuffersType>> reqs) noexcept
+  {
+    static_assert(std::is_same<BuffersType, buffers_type>::value || std::is_same<BuffersType, const_buffers_type>::value, "BuffersType must be buffers_type or const_buffers_type");
+    const auto state_reqs = io_state_requirements();
+    const size_t stride = (state_reqs.first + state_reqs.second - 1) & ~(state_reqs.second - 1);
+    if(states.size() < reqs.size() || storage.size() < stride * reqs.size() || ((uintptr_t) storage.data() & (state_reqs.second - 1)) != 0)
+    {
+      return errc::invalid_argument;
+    }
+    for(size_t n = 0; n < reqs.size(); n++)
+    {
+      states[n] = construct({storage.data() + n * stride, stride}, _h, _visitor, registered_buffer_type(b), d, reqs[n]);
+      if(states[n] == nullptr)
+      {
+        for(size_t i = 0; i < n; i++)
+        {
+          states[i]->~io_operation_state();
+        }
+        return errc::invalid_argument;
+      }
+    }
+    span<io_operation_state *> ret(states.data(), reqs.size());
+    OUTCOME_TRY(init_io_operations(ret));
+    return ret;
+  }
+
   //! Flushes any previously initiated i/o, if necessary for this i/o multiplexer
   virtual result<void> flush_inited_io_operations() noexcept { return success(); }
 
@@ -1364,11 +1825,27 @@ public:
   //! Cancel an initiated i/o, returning its current state if successful.
   virtual result<io_operation_state_type> cancel_io_operation(io_operation_state *op, deadline d = {}) noexcept = 0;
 
-  //! Statistics about the just returned `wait_for_completed_io()` operation
+  /*! \brief Statistics about the just returned `check_for_any_completed_io()` operation.
+
+  These let you tell an under-fed multiplexer (low `initiated_ios_in_flight`, small reaps,
+  latency near the device's best) from a saturated device (high `initiated_ios_in_flight`,
+  large reaps, rising latency). The mean submit-to-complete latency is
+  `submit_to_complete_latency_sum` divided by the number of i/o completed and finished
+  by this call.
+  */
   struct check_for_any_completed_io_statistics
   {
     size_t initiated_ios_completed{0};  //!< The number of initiated i/o which were completed by this call
     size_t initiated_ios_finished{0};   //!< The number of initiated i/o which were finished by this call
+    size_t initiated_ios_in_flight{0};  //!< The number of initiated i/o not yet completed when this call returned
+    size_t reaps{0};                    //!< The number of batches of completions this call reaped from the system
+    size_t largest_reap{0};             //!< The most completions reaped from the system in any one batch by this call
+    //! The number of i/o initiated since the previous call which completed during initiation, and so never waited upon the system.
+    size_t immediate_completions{0};
+    //! The sum, over the i/o completed by this call, of the time between initiation and completion.
+    std::chrono::nanoseconds submit_to_complete_latency_sum{0};
+    //! The longest time between initiation and completion of any i/o completed by this call.
+    std::chrono::nanoseconds submit_to_complete_latency_max{0};
   };
 
   /*! \brief Checks all i/o initiated on this i/o multiplexer to see which
@@ -1393,6 +1870,181 @@ static_assert(OUTCOME_V2_NAMESPACE::concepts::basic_result<io_multiplexer::io_re
               "io_multiplexer::io_result<int> does not match the Outcome basic_result concept!");
 #endif
 
+#if defined(__linux__) || DOXYGEN_IS_IN_THE_HOUSE
+//! Flags for `multiplexer_linux_io_uring()`
+QUICKCPPLIB_BITFIELD_BEGIN(io_uring_multiplexer_flag){
+none = 0U,  //!< No flags
+/*! Create the ring for seekable handles with `IORING_SETUP_SQPOLL`, so a kernel thread
+consumes submissions without any syscall. Requires Linux 5.11 or later, and the kernel
+thread consumes CPU whilst busy.
+*/
+sqpoll = 1U << 0U,
+/*! Create an additional ring with `IORING_SETUP_IOPOLL`, to which reads and writes upon
+seekable handles opened with `caching::none` or `caching::only_metadata` are sent, so
+completions are busy polled from the device rather than interrupt driven. Whilst any
+such i/o is in flight, `.check_for_any_completed_io()` spins rather than sleeps.
+*/
+iopoll = 1U << 1U,
+/*! If `threads` exceeds one, give each thread its own complete set of rings rather than
+having all threads share one set under a lock. Each thread submits to, and reaps the
+completions of, its own rings. A thread with nothing to reap in its own rings reaps the
+rings of any other thread not currently reaping them, before sleeping. Ordering of i/o
+upon the same inode, or the same non-seekable handle, is only enforced between i/o
+initiated by threads sharing rings.
+*/
+per_thread_rings = 1U << 2U} QUICKCPPLIB_BITFIELD_END(io_uring_multiplexer_flag);
+
+/*! \brief Return an i/o multiplexer implemented using Linux io_uring.
+
+Two io_uring instances are created, one for seekable handles and one for non-seekable
+handles. i/o upon seekable handles is freely reordered, except that i/o overlapping
+a preceding incomplete write upon the same inode (or a read, for writes) waits for it
+to complete, and barriers are fenced against all preceding and succeeding i/o upon
+that inode.
+i/o upon non-seekable handles is queued per handle, so one read and one write
+per handle is in flight at a time, in the order initiated.
+
+i/o is submitted to the kernel by `.flush_inited_io_operations()`,
+`.check_io_operation()` and `.check_for_any_completed_io()`. Completed i/o is
+finished immediately.
+
+Buffers returned by `io_handle::allocate_registered_buffer()` for seekable handles are
+registered with io_uring as fixed buffers where the kernel supports it (Linux 5.19
+onwards), and single buffer i/o lying within them uses `IORING_OP_READ_FIXED`/`IORING_OP_WRITE_FIXED`,
+saving the kernel pinning the pages on every i/o.
+
+\param threads The number of kernel threads which will use the multiplexer. If
+one, no locking is performed.
+\param flags Opt-in kernel polling modes for latency critical use, and per-thread rings
+for many threads, see `io_uring_multiplexer_flag`.
+
+i/o with a deadline which has not yet been submitted to the kernel once its deadline passes
+is dequeued, and completes with `errc::timed_out`. i/o already submitted is cancelled using
+`IORING_OP_ASYNC_CANCEL`, and completes with `errc::timed_out` if the cancellation succeeds.
+Deadlines are checked during `.check_for_any_completed_io()`, which will not sleep past the
+earliest deadline of any i/o in flight. i/o upon a `io_uring_multiplexer_flag::iopoll` ring
+cannot be cancelled, so its deadline is not enforced.
+
+\errors Any of the values `io_uring_setup()`, `mmap()` and `eventfd()` can return,
+including `errc::function_not_supported` if the kernel lacks io_uring, or lacks
+unregistered file support for `io_uring_multiplexer_flag::sqpoll`.
+*/
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_linux_io_uring(size_t threads = 1, io_uring_multiplexer_flag flags = io_uring_multiplexer_flag::none) noexcept;
+
+/*! \brief Return an i/o multiplexer implemented using Linux epoll.
+
+epoll reports readiness, not completion, so this multiplexer attempts i/o
+immediately using non-blocking syscalls, and queues it per handle in the order
+initiated only if the kernel would block. Handles are registered edge triggered,
+and queued i/o is retried when they become ready during `.check_for_any_completed_io()`.
+
+Only pollable handles such as pipes and sockets can be registered, for regular files
+you want `multiplexer_linux_io_uring()`. Barriers upon pollable handles complete
+immediately.
+
+i/o with a deadline which is queued is dequeued once its deadline passes, and completes
+with `errc::timed_out`. Deadlines are checked during `.check_for_any_completed_io()`, which
+will not sleep past the earliest deadline of any queued i/o.
+
+\param threads The number of kernel threads which will use the multiplexer. If
+one, no locking is performed.
+
+\errors Any of the values `epoll_create1()` and `eventfd()` can return. Registering
+a handle which cannot be polled fails with `errc::operation_not_supported`.
+*/
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_linux_epoll(size_t threads = 1) noexcept;
+#endif
+
+#if(defined(__FreeBSD__) || defined(__APPLE__)) || DOXYGEN_IS_IN_THE_HOUSE
+/*! \brief Return an i/o multiplexer implemented using BSD kqueue.
+
+i/o upon non-seekable handles such as pipes and sockets is attempted immediately
+using non-blocking syscalls, and queued per handle in the order initiated only if
+the kernel would block. Handles are registered edge triggered with `EVFILT_READ` and
+`EVFILT_WRITE`, and queued i/o is retried when they become ready during
+`.check_for_any_completed_io()`. Barriers upon non-seekable handles complete immediately.
+
+On FreeBSD, i/o upon seekable handles is submitted using POSIX AIO, with completions
+reported via `EVFILT_AIO`. If AIO refuses the i/o, it is performed by a worker thread using
+blocking syscalls. Mac OS cannot report AIO completions via kqueue, so there i/o upon
+seekable handles is always performed by a worker thread.
+
+Each device has its own pool of worker threads, so a stalled device cannot starve i/o to
+any other device. A pool starts a worker whenever i/o is handed to it with more i/o waiting
+than idle workers, up to `max_workers_per_device`, and workers exit after being idle for
+five seconds. Workers are started and stopped by the multiplexer, so they exist even
+if `threads` is one. Cancelling i/o which a worker has already begun waits for it to complete.
+
+\param threads The number of kernel threads which will use the multiplexer. If
+one, no locking is performed.
+\param max_workers_per_device The maximum number of worker threads per device. If zero,
+i/o which cannot be issued asynchronously is performed synchronously during initiation.
+
+i/o with a deadline which is queued, or waiting for a worker, once its deadline passes
+is dequeued and completes with `errc::timed_out`. AIO is cancelled using `aio_cancel()`, and
+completes with `errc::timed_out` if the cancellation succeeds. i/o which a worker has begun
+cannot be interrupted, so runs to completion. Deadlines are checked during
+`.check_for_any_completed_io()`, which will not sleep past the earliest deadline of any i/o in flight.
+
+\errors Any of the values `kqueue()` and `kevent()` can return.
+*/
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_bsd_kqueue(size_t threads = 1, size_t max_workers_per_device = 16) noexcept;
+#endif
+
+#if defined(_WIN32) || DOXYGEN_IS_IN_THE_HOUSE
+/*! \brief Return an i/o multiplexer implemented using Microsoft Windows IOCP.
+
+Each buffer of an i/o is issued as its own overlapped `NtReadFile()`/`NtWriteFile()`,
+so up to 64 buffers may be supplied per i/o. Unless `disable_immediate_completions`
+is set, handles are registered with `FILE_SKIP_COMPLETION_PORT_ON_SUCCESS`, and i/o
+which completes immediately is finished during initiation without ever visiting the
+completion port.
+
+Any number of kernel threads may call `.check_for_any_completed_io()` concurrently,
+and completions are reaped without taking any lock shared between threads.
+
+i/o with a deadline is cancelled as if by `CancelIoEx()` once its deadline passes,
+and completes with `errc::timed_out`. Deadlines are checked during
+`.check_for_any_completed_io()`, which will not sleep past the earliest deadline
+of any i/o in flight.
+Deadlines are kept in a hierarchical timer wheel of millisecond resolution, so arming
+and disarming them is constant time however many i/o are in flight.
+
+Barriers are performed synchronously during initiation, as NT has no asynchronous
+form of `NtFlushBuffersFileEx()`.
+
+\param threads The number of kernel threads which will use the multiplexer. If
+one, no locking is performed.
+\param disable_immediate_completions If true, all i/o completes via the completion
+port, as it would with ASIO.
+
+\errors Any of the values `CreateIoCompletionPort()` can return.
+*/
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_win_iocp(size_t threads = 1, bool disable_immediate_completions = false) noexcept;
+/*! \brief Return an i/o multiplexer implemented using Microsoft Windows IoRing, falling
+back onto IOCP for i/o which IoRing cannot perform.
+
+Windows 11 and Server 2022 introduced IoRing, a submission and completion queue pair
+shared with the kernel in the style of io_uring, which at present can only read files.
+Single buffer reads upon seekable handles are therefore written into the IoRing's
+submission queue during initiation, and submitted to the kernel together by
+`.flush_inited_io_operations()` or `.check_for_any_completed_io()`, which is one syscall
+for the whole batch. All other i/o, and reads when the IoRing is full, are issued exactly
+as `multiplexer_win_iocp()` issues them.
+
+Completions of both kinds are reaped via the IOCP port, so all the remarks made for
+`multiplexer_win_iocp()` about threads, deadlines and barriers also apply here.
+
+\param threads The number of kernel threads which will use the multiplexer. If
+one, no locking is performed.
+\param disable_immediate_completions As for `multiplexer_win_iocp()`.
+
+\errors `errc::function_not_supported` if this version of Windows does not provide
+IoRing. Any of the values `CreateIoRing()` and `CreateIoCompletionPort()` can return.
+*/
+LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_win_ioring(size_t threads = 1, bool disable_immediate_completions = false) noexcept;
+#endif
+
 #if LLFIO_ENABLE_TEST_IO_MULTIPLEXERS
 //! Namespace containing functions useful for test code
 namespace test
@@ -1404,31 +2056,59 @@ namespace test
   */
   LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_null(size_t threads, bool disable_immediate_completions) noexcept;
 
+}  // namespace test
+#endif
+
+//! \brief Thread local settings
+namespace this_thread
+{
+  /*! \brief The process wide policy by which `multiplexer()` creates a multiplexer for each
+  thread which has not set one, see `set_automatic_multiplexer()`.
+  */
+  struct automatic_multiplexer_config
+  {
+    //! If false, the default, `multiplexer()` returns null for threads which have not set one.
+    bool enabled{false};
 #if defined(__linux__) || DOXYGEN_IS_IN_THE_HOUSE
-// LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_linux_epoll(size_t threads) noexcept;
-// LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_linux_io_uring() noexcept;
+    //! The flags to pass to `multiplexer_linux_io_uring()`.
+    io_uring_multiplexer_flag io_uring_flags{io_uring_multiplexer_flag::none};
 #endif
 #if(defined(__FreeBSD__) || defined(__APPLE__)) || DOXYGEN_IS_IN_THE_HOUSE
-// LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_bsd_kqueue(size_t threads) noexcept;
+    //! The maximum number of worker threads per device to pass to `multiplexer_bsd_kqueue()`.
+    size_t max_workers_per_device{16};
 #endif
 #if defined(_WIN32) || DOXYGEN_IS_IN_THE_HOUSE
-  /*! \brief Return a test i/o multiplexer implemented using Microsoft Windows IOCP.
-
-  The multiplexer returned by this function is only a partial implementation, used
-  only by the test suite. In particular it does not fully implement deadlined i/o.
-  */
-  LLFIO_HEADERS_ONLY_FUNC_SPEC result<io_multiplexer_ptr> multiplexer_win_iocp(size_t threads, bool disable_immediate_completions) noexcept;
-#endif
-}  // namespace test
+    //! If true, try `multiplexer_win_ioring()` before `multiplexer_win_iocp()`.
+    bool prefer_ioring{false};
+    //! Whether to disable immediate completions, as for `multiplexer_win_iocp()`.
+    bool disable_immediate_completions{false};
 #endif
+  };
 
-//! \brief Thread local settings
-namespace this_thread
-{
-  //! \brief Return the calling thread's current i/o multiplexer.
+  /*! \brief Return the calling thread's current i/o multiplexer.
+
+  If the calling thread has not set one, and `set_automatic_multiplexer()` has enabled it, the
+  best available multiplexer for this platform is created for the calling thread on first call,
+  and destroyed when the calling thread exits. Thus each thread gets its own multiplexer, and
+  none is accidentally shared between threads. The multiplexers tried in order are
+  `multiplexer_linux_io_uring()` then `multiplexer_linux_epoll()` on Linux,
+  `multiplexer_bsd_kqueue()` on BSD and Mac OS, and `multiplexer_win_ioring()` if preferred
+  then `multiplexer_win_iocp()` on Windows, each for a single thread. If none can be created,
+  null is returned for that thread from then on, and i/o is performed synchronously.
+
+  Note that `multiplexer_linux_epoll()` cannot multiplex i/o upon regular files, and that any
+  handle registered with an automatically created multiplexer must be deregistered before
+  its thread exits.
+  */
   LLFIO_HEADERS_ONLY_FUNC_SPEC io_multiplexer *multiplexer() noexcept;
   //! \brief Set the calling thread's current i/o multiplexer.
   LLFIO_HEADERS_ONLY_FUNC_SPEC void set_multiplexer(io_multiplexer *ctx) noexcept;
+  /*! \brief Sets the process wide policy by which `multiplexer()` creates a multiplexer for
+  each thread which has not set one, returning the previous policy.
+
+  Threads which already have an automatically created multiplexer keep it.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC automatic_multiplexer_config set_automatic_multiplexer(automatic_multiplexer_config config) noexcept;
 }  // namespace this_thread
 
 // BEGIN make_free_functions.py
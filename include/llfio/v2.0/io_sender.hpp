@@ -0,0 +1,370 @@
+/* P2300 sender adapters for io_handle i/o
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_IO_SENDER_HPP
+#define LLFIO_IO_SENDER_HPP
+
+#include "io_handle.hpp"
+
+#include <atomic>
+#include <optional>
+
+//! \file io_sender.hpp Provides P2300 sender adapters for `io_handle` i/o.
+
+/* Senders are enabled if stdexec, or a standard library implementing std::execution, is
+found. Define LLFIO_ENABLE_SENDERS to 1, LLFIO_SENDERS_NAMESPACE to the namespace of another
+P2300 implementation and LLFIO_SENDERS_STOP_TOKEN_NAMESPACE to the namespace of its stop
+tokens, having included it first, to use that instead.
+*/
+#ifndef LLFIO_ENABLE_SENDERS
+#if defined(__has_include)
+#if __has_include(<stdexec/execution.hpp>)
+#include <stdexec/execution.hpp>
+#define LLFIO_ENABLE_SENDERS 1
+#define LLFIO_SENDERS_NAMESPACE ::stdexec
+#define LLFIO_SENDERS_STOP_TOKEN_NAMESPACE ::stdexec
+#elif __has_include(<version>)
+#include <version>
+#if defined(__cpp_lib_senders)
+#include <execution>
+#define LLFIO_ENABLE_SENDERS 1
+#define LLFIO_SENDERS_NAMESPACE ::std::execution
+#define LLFIO_SENDERS_STOP_TOKEN_NAMESPACE ::std
+#endif
+#endif
+#endif
+#endif
+#ifndef LLFIO_ENABLE_SENDERS
+#define LLFIO_ENABLE_SENDERS 0
+#endif
+
+#if LLFIO_ENABLE_SENDERS
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+template <class BuffersType> class io_sender;
+
+namespace detail
+{
+  namespace senders = LLFIO_SENDERS_NAMESPACE;
+  namespace senders_stop = LLFIO_SENDERS_STOP_TOKEN_NAMESPACE;
+
+  /* The operation state of an io_sender connected to a receiver. The i/o operation state
+  is constructed within this object, so no memory is allocated.
+
+  Delivery to the receiver needs both the i/o to have finished, and start() to have finished
+  registering the stop callback, whichever happens last delivers. Delivery first unregisters
+  the stop callback, waiting for any concurrent invocation of it to return, so the i/o state
+  is never cancelled after the receiver has been told of its completion.
+  */
+  template <class BuffersType, class Receiver> class io_sender_operation final : protected io_multiplexer::io_operation_state_visitor
+  {
+    using _sender_type = io_sender<BuffersType>;
+    using _result_type = typename _sender_type::result_type;
+    using _lock_guard = io_multiplexer::io_operation_state::lock_guard;
+
+    struct _on_stop
+    {
+      io_sender_operation *self;
+      void operator()() noexcept
+      {
+        self->_stopped.store(true, std::memory_order_relaxed);
+        (void) self->_sender._h->multiplexer()->cancel_io_operation(self->_state);
+      }
+    };
+    using _stop_token_type = senders_stop::stop_token_of_t<senders::env_of_t<Receiver>>;
+    using _stop_callback_type = typename _stop_token_type::template callback_type<_on_stop>;
+
+    alignas(std::max_align_t) byte _state_storage[io_multiplexer::io_operation_state_storage_size];
+    io_multiplexer::io_operation_state *_state{nullptr};
+    _sender_type _sender;
+    Receiver _r;
+    std::atomic<int> _pending{2};
+    std::atomic<bool> _stopped{false};
+    std::optional<_stop_callback_type> _stop_callback;
+
+    io_multiplexer::io_operation_state *_construct(io_multiplexer *m) noexcept
+    {
+      const span<byte> storage(_state_storage, sizeof(_state_storage));
+      if constexpr(std::is_same<BuffersType, io_handle::const_buffers_type>::value)
+      {
+        if(_sender._is_barrier)
+        {
+          return m->construct(storage, _sender._h, this, std::move(_sender._base), _sender._d, std::move(_sender._reqs), _sender._kind);
+        }
+      }
+      return m->construct(storage, _sender._h, this, std::move(_sender._base), _sender._d, std::move(_sender._reqs));
+    }
+    _result_type _blocking_io() noexcept
+    {
+      if constexpr(std::is_same<BuffersType, io_handle::buffers_type>::value)
+      {
+        return _sender._h->read(std::move(_sender._base), std::move(_sender._reqs), _sender._d);
+      }
+      else
+      {
+        if(_sender._is_barrier)
+        {
+          return _sender._h->barrier(std::move(_sender._reqs), _sender._kind, _sender._d);
+        }
+        return _sender._h->write(std::move(_sender._base), std::move(_sender._reqs), _sender._d);
+      }
+    }
+    _result_type _completed_result() noexcept
+    {
+      if constexpr(std::is_same<BuffersType, io_handle::buffers_type>::value)
+      {
+        return std::move(*_state).get_completed_read();
+      }
+      else
+      {
+        return std::move(*_state).get_completed_write_or_barrier();
+      }
+    }
+    // This object may be destroyed by the receiver upon return
+    void _deliver(_result_type &&res) noexcept
+    {
+      if(res)
+      {
+        senders::set_value(std::move(_r), std::move(res).value());
+        return;
+      }
+      if(_stopped.load(std::memory_order_relaxed) && res.error() == errc::operation_canceled)
+      {
+        senders::set_stopped(std::move(_r));
+        return;
+      }
+      senders::set_error(std::move(_r), std::move(res).error());
+    }
+    void _release() noexcept
+    {
+      if(_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        _stop_callback.reset();
+        _deliver(_completed_result());
+      }
+    }
+
+  protected:
+    virtual void read_finished(_lock_guard &g, io_operation_state_type /*former*/) override
+    {
+      g.unlock();
+      _release();
+    }
+    virtual void write_or_barrier_finished(_lock_guard &g, io_operation_state_type /*former*/) override
+    {
+      g.unlock();
+      _release();
+    }
+
+  public:
+    using operation_state_concept = senders::operation_state_t;
+
+    template <class R>
+    io_sender_operation(_sender_type sender, R &&r) noexcept(std::is_nothrow_constructible<Receiver, R>::value)
+        : _sender(std::move(sender))
+        , _r(std::forward<R>(r))
+    {
+    }
+    io_sender_operation(const io_sender_operation &) = delete;
+    io_sender_operation(io_sender_operation &&) = delete;
+    io_sender_operation &operator=(const io_sender_operation &) = delete;
+    io_sender_operation &operator=(io_sender_operation &&) = delete;
+    ~io_sender_operation()
+    {
+      if(_state != nullptr)
+      {
+        _state->~io_operation_state();
+      }
+    }
+
+    //! Initiates the i/o, which if the handle has no multiplexer is performed immediately.
+    void start() & noexcept
+    {
+      auto token = senders_stop::get_stop_token(senders::get_env(_r));
+      if(token.stop_requested())
+      {
+        senders::set_stopped(std::move(_r));
+        return;
+      }
+      io_multiplexer *m = _sender._h->multiplexer();
+      if(m == nullptr)
+      {
+        _deliver(_blocking_io());
+        return;
+      }
+      _state = _construct(m);
+      if(_state == nullptr)
+      {
+        // The multiplexer needs more storage than any in this library
+        _deliver(_result_type(errc::no_buffer_space));
+        return;
+      }
+      (void) m->init_io_operation(_state);
+      // If the i/o has already finished, the callback's cancellation does nothing
+      if(token.stop_possible())
+      {
+        _stop_callback.emplace(token, _on_stop{this});
+      }
+      _release();
+    }
+  };
+}  // namespace detail
+
+/*! \class io_sender
+\brief A P2300 sender of the result of a read, write or barrier upon an `io_handle`.
+
+Connecting it to a receiver yields an operation state within which the i/o operation state
+is constructed, so no memory is allocated. Starting the operation state initiates the i/o
+upon the handle's multiplexer. As with `io_handle::co_read()` etc, completion occurs only
+when the multiplexer is pumped using `io_multiplexer::check_for_any_completed_io()`, and the
+receiver is completed from within that. If the handle has no multiplexer, the i/o is
+performed immediately in `start()`, blocking until done.
+
+The sender completes with `set_value(buffers_type)` upon success, `set_error(error_type)`
+upon failure, and `set_stopped()` if stop was requested of the receiver's stop token before
+the i/o started, or whilst it was in flight, in which case the i/o is cancelled using
+`io_multiplexer::cancel_io_operation()`. i/o which completes despite cancellation completes
+with its result.
+
+The sender may be connected many times, and each time all of it is copied into the
+operation state. The handle and buffers must outlive every operation state. Like the
+`io_handle` i/o functions, the buffers completed may not be the buffers supplied.
+
+Only available if `LLFIO_ENABLE_SENDERS` is true, which it is if stdexec, or a standard
+library implementing `std::execution`, was found.
+*/
+template <class BuffersType> class io_sender
+{
+  template <class, class> friend class detail::io_sender_operation;
+
+public:
+  //! The buffers type sent
+  using buffers_type = BuffersType;
+  //! The result type of the i/o
+  using result_type = io_handle::io_result<buffers_type>;
+  //! The error type sent
+  using error_type = typename result_type::error_type;
+
+  using sender_concept = detail::senders::sender_t;
+  using completion_signatures = detail::senders::completion_signatures<detail::senders::set_value_t(buffers_type), detail::senders::set_error_t(error_type),
+                                                                       detail::senders::set_stopped_t()>;
+
+private:
+  io_handle *_h{nullptr};
+  io_handle::registered_buffer_type _base;
+  deadline _d;
+  io_handle::io_request<buffers_type> _reqs;
+  bool _is_barrier{false};
+  io_handle::barrier_kind _kind{io_handle::barrier_kind::nowait_data_only};
+
+public:
+  //! Constructs a sender of a read or a write
+  io_sender(io_handle &h, io_handle::registered_buffer_type base, io_handle::io_request<buffers_type> reqs, deadline d) noexcept
+      : _h(&h)
+      , _base(std::move(base))
+      , _d(d)
+      , _reqs(std::move(reqs))
+  {
+  }
+  //! Constructs a sender of a barrier
+  io_sender(io_handle &h, io_handle::io_request<buffers_type> reqs, io_handle::barrier_kind kind, deadline d) noexcept
+      : _h(&h)
+      , _d(d)
+      , _reqs(std::move(reqs))
+      , _is_barrier(true)
+      , _kind(kind)
+  {
+    static_assert(std::is_same<buffers_type, io_handle::const_buffers_type>::value, "barriers send const buffers");
+  }
+
+  //! Connects this sender to a receiver, returning an operation state.
+  template <class Receiver> detail::io_sender_operation<buffers_type, std::decay_t<Receiver>> connect(Receiver &&r) const &
+  {
+    return detail::io_sender_operation<buffers_type, std::decay_t<Receiver>>(*this, std::forward<Receiver>(r));
+  }
+  //! \overload
+  template <class Receiver> detail::io_sender_operation<buffers_type, std::decay_t<Receiver>> connect(Receiver &&r) &&
+  {
+    return detail::io_sender_operation<buffers_type, std::decay_t<Receiver>>(std::move(*this), std::forward<Receiver>(r));
+  }
+};
+
+/*! \brief Returns a sender of a read from `h`, see `io_sender`.
+\param h The handle from which to read, which must outlive any operation state.
+\param reqs A scatter-gather and offset request.
+\param d An optional deadline by which the i/o must complete, else it is cancelled.
+*/
+inline io_sender<io_handle::buffers_type> async_read(io_handle &h, io_handle::io_request<io_handle::buffers_type> reqs, deadline d = deadline()) noexcept
+{
+  return {h, {}, std::move(reqs), d};
+}
+//! \overload Registered buffer overload, scatter list **must** be wholly within the registered buffer
+inline io_sender<io_handle::buffers_type> async_read(io_handle &h, io_handle::registered_buffer_type base, io_handle::io_request<io_handle::buffers_type> reqs,
+                                                     deadline d = deadline()) noexcept
+{
+  return {h, std::move(base), std::move(reqs), d};
+}
+/*! \brief Returns a sender of a write to `h`, see `io_sender`.
+\param h The handle to which to write, which must outlive any operation state.
+\param reqs A scatter-gather and offset request.
+\param d An optional deadline by which the i/o must complete, else it is cancelled.
+*/
+inline io_sender<io_handle::const_buffers_type> async_write(io_handle &h, io_handle::io_request<io_handle::const_buffers_type> reqs, deadline d = deadline()) noexcept
+{
+  return {h, {}, std::move(reqs), d};
+}
+//! \overload Registered buffer overload, gather list **must** be wholly within the registered buffer
+inline io_sender<io_handle::const_buffers_type> async_write(io_handle &h, io_handle::registered_buffer_type base,
+                                                            io_handle::io_request<io_handle::const_buffers_type> reqs, deadline d = deadline()) noexcept
+{
+  return {h, std::move(base), std::move(reqs), d};
+}
+/*! \brief Returns a sender of a barrier upon `h`, see `io_sender`.
+\param h The handle upon which to issue the barrier, which must outlive any operation state.
+\param reqs The range of bytes to barrier, or empty for the whole handle.
+\param kind Which kind of barrier to issue.
+\param d An optional deadline by which the i/o must complete, else it is cancelled.
+*/
+inline io_sender<io_handle::const_buffers_type> async_barrier(io_handle &h, io_handle::io_request<io_handle::const_buffers_type> reqs = io_handle::io_request<io_handle::const_buffers_type>(),
+                                                              io_handle::barrier_kind kind = io_handle::barrier_kind::nowait_data_only, deadline d = deadline()) noexcept
+{
+  return {h, std::move(reqs), kind, d};
+}
+
+LLFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif  // LLFIO_ENABLE_SENDERS
+
+#endif
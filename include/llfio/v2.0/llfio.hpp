@@ -70,22 +70,51 @@ import LLFIO_MODULE_NAME;
 #include "storage_profile.hpp"
 #endif
 #include "fast_random_file_handle.hpp"
+#include "interned_path.hpp"
+#include "registered_buffer_pool.hpp"
+#include "buffer_cache.hpp"
 #include "symlink_handle.hpp"
+#include "byte_socket_handle.hpp"
+#include "io_sender.hpp"
+#include "static_io_handle.hpp"
 
+#include "algorithm/bulk_copy.hpp"
 #include "algorithm/clone.hpp"
+#include "algorithm/deduplicate.hpp"
+#include "algorithm/durable_replace.hpp"
+#include "algorithm/group_barrier.hpp"
 #include "algorithm/handle_adapter/cached_parent.hpp"
+#include "algorithm/handle_adapter/cached_path.hpp"
+#include "algorithm/handle_adapter/redundant.hpp"
+#include "algorithm/incremental_traverse.hpp"
+#include "algorithm/io_tuner.hpp"
 #include "algorithm/reduce.hpp"
 #include "algorithm/shared_fs_mutex/atomic_append.hpp"
 #include "algorithm/shared_fs_mutex/byte_ranges.hpp"
+#include "algorithm/shared_fs_mutex/leases.hpp"
 #include "algorithm/shared_fs_mutex/lock_files.hpp"
 #include "algorithm/shared_fs_mutex/safe_byte_ranges.hpp"
+#include "algorithm/sparse_transfer.hpp"
 #include "algorithm/summarize.hpp"
 
 #ifndef LLFIO_EXCLUDE_MAPPED_FILE_HANDLE
+#include "file_follower.hpp"
 #include "mapped.hpp"
+#include "algorithm/external_sort.hpp"
+#include "algorithm/handle_adapter/checksumming.hpp"
+#include "algorithm/handle_adapter/coalescing.hpp"
 #include "algorithm/handle_adapter/xor.hpp"
+#include "algorithm/mirrored_ring_buffer.hpp"
+#include "algorithm/page_in_ahead.hpp"
+#include "algorithm/shared_append_log.hpp"
 #include "algorithm/shared_fs_mutex/memory_map.hpp"
+#include "algorithm/shared_fs_mutex/reader_biased.hpp"
+#include "algorithm/shared_mpmc_queue.hpp"
+#include "algorithm/sorted_table.hpp"
+#include "algorithm/tree_hash.hpp"
+#include "algorithm/tree_snapshot.hpp"
 #include "algorithm/trivial_vector.hpp"
+#include "algorithm/write_ahead_log.hpp"
 #endif
 
 #endif
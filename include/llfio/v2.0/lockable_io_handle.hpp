@@ -27,7 +27,10 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "io_handle.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <thread>
 
 //! \file lockable_io_handle.hpp Provides a lockable i/o handle
 
@@ -230,6 +233,37 @@ public:
       _length = 0;
       _kind = lock_kind::unlocked;
     }
+
+    /*! \brief Converts the locked extent to a shared or exclusive lock, atomically where the platform
+    permits. See `lockable_io_handle::relock_file_range()`. Relocking to `lock_kind::unlocked` unlocks.
+    */
+    result<void> relock(lock_kind kind, deadline d = deadline()) noexcept
+    {
+      if(_h == nullptr)
+      {
+        return errc::invalid_argument;
+      }
+      if(kind == _kind)
+      {
+        return success();
+      }
+      if(kind == lock_kind::unlocked)
+      {
+        unlock();
+        return success();
+      }
+      OUTCOME_TRY(_h->relock_file_range(_offset, _length, _kind, kind, d));
+      _kind = kind;
+      return success();
+    }
+  };
+
+  //! \brief EXTENSION: A request to lock a range of bytes, for `lock_file_ranges()`.
+  struct lock_file_range_request
+  {
+    extent_type offset{0};                 //!< The offset to lock
+    extent_type bytes{0};                  //!< The number of bytes to lock
+    lock_kind kind{lock_kind::exclusive};  //!< Whether the lock is to be shared or exclusive
   };
 
   /*! \brief EXTENSION: Tries to lock the range of bytes specified for shared or exclusive access.
@@ -253,7 +287,8 @@ public:
   after creating a new one over the same byte range, otherwise the old `extent_guard`'s destructor
   will simply unlock the range entirely. On Windows however upgrade/downgrade locks overlay, so on
   that platform you must *not* release the old `extent_guard`. Look into
-  `algorithm::shared_fs_mutex::safe_byte_ranges` for a portable solution.
+  `algorithm::shared_fs_mutex::safe_byte_ranges` for a portable solution, or use `relock_file_range()`
+  or `extent_guard::relock()` which handle this for you.
 
   \return An extent guard, the destruction of which will call unlock().
   \param offset The offset to lock. Note that on POSIX the top bit is always cleared before use
@@ -302,6 +337,273 @@ public:
 
   LLFIO_DEADLINE_TRY_FOR_UNTIL(lock_file_range)
 
+  /*! \class lock_file_range_awaitable
+  \brief EXTENSION: The awaitable returned by `co_lock_file_range()`.
+
+  Awaiting this first tries to lock the range without blocking. If the range is contended, a worker
+  thread is launched which waits for the lock in the kernel (`F_OFD_SETLKW` on POSIX, `LockFileEx()`
+  on Windows), and the awaiting coroutine is suspended until the worker obtains the lock or fails.
+  The coroutine is resumed by the worker thread. If there is a deadline, the worker instead retries
+  with an exponential backoff capped at ten milliseconds, as neither kernel API can time out a
+  lock wait on a synchronous handle.
+
+  Without coroutines, call `get()`, which blocks the calling thread until the lock is obtained.
+
+  The destructor blocks until any worker has finished. It cannot be moved once awaited.
+  */
+  class lock_file_range_awaitable
+  {
+    friend class lockable_io_handle;
+    enum _state_type : int
+    {
+      _unstarted,
+      _pending,
+      _suspended,
+      _finished
+    };
+    lockable_io_handle *_h{nullptr};
+    extent_type _offset{0}, _bytes{0};
+    lock_kind _kind{lock_kind::unlocked};
+    deadline _d;
+    std::atomic<int> _state{_unstarted};
+    result<extent_guard> _result{errc::resource_unavailable_try_again};
+    std::thread _worker;
+#if LLFIO_ENABLE_COROUTINES
+    coroutine_handle<> _coro;
+#endif
+
+    lock_file_range_awaitable(lockable_io_handle *h, extent_type offset, extent_type bytes, lock_kind kind, deadline d) noexcept
+        : _h(h)
+        , _offset(offset)
+        , _bytes(bytes)
+        , _kind(kind)
+        , _d(d)
+    {
+    }
+    static result<extent_guard> _acquire(lockable_io_handle *h, extent_type offset, extent_type bytes, lock_kind kind, bool has_deadline,
+                                         std::chrono::steady_clock::time_point end) noexcept
+    {
+      if(!has_deadline)
+      {
+        return h->lock_file_range(offset, bytes, kind);  // waits in the kernel
+      }
+      std::chrono::microseconds backoff(1);
+      for(;;)
+      {
+        auto r = h->lock_file_range(offset, bytes, kind, deadline(std::chrono::seconds(0)));
+        if(r || r.error() != errc::timed_out)
+        {
+          return r;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if(now >= end)
+        {
+          return errc::timed_out;
+        }
+        std::this_thread::sleep_for((std::min)(std::chrono::duration_cast<std::chrono::microseconds>(end - now) + std::chrono::microseconds(1), backoff));
+        backoff = (std::min)(backoff * 2, std::chrono::microseconds(10000));
+      }
+    }
+    void _join() noexcept
+    {
+      if(_worker.joinable())
+      {
+        // If resumed by the worker, the worker can only be detached, and it touches nothing of this after resumption
+        if(_worker.get_id() == std::this_thread::get_id())
+        {
+          _worker.detach();
+        }
+        else
+        {
+          _worker.join();
+        }
+      }
+    }
+
+  public:
+    lock_file_range_awaitable(const lock_file_range_awaitable &) = delete;
+    //! Move construction, terminates the process if the lock is being awaited
+    lock_file_range_awaitable(lock_file_range_awaitable &&o) noexcept
+        : _h(o._h)
+        , _offset(o._offset)
+        , _bytes(o._bytes)
+        , _kind(o._kind)
+        , _d(o._d)
+        , _state(o._state.load(std::memory_order_relaxed))
+        , _result(std::move(o._result))
+    {
+      if(_state.load(std::memory_order_relaxed) == _pending || _state.load(std::memory_order_relaxed) == _suspended || o._worker.joinable())
+      {
+        abort();  // attempt to relocate an awaitable currently in use
+      }
+      o._h = nullptr;
+      o._state.store(_finished, std::memory_order_relaxed);
+    }
+    lock_file_range_awaitable &operator=(const lock_file_range_awaitable &) = delete;
+    lock_file_range_awaitable &operator=(lock_file_range_awaitable &&) = delete;
+    //! Destructor, blocks if the lock is being awaited
+    ~lock_file_range_awaitable() { _join(); }
+
+    //! True if the lock has been obtained, or has failed. Begins the lock if it is not begun yet.
+    bool await_ready() noexcept
+    {
+      if(_state.load(std::memory_order_acquire) != _unstarted)
+      {
+        return _state.load(std::memory_order_acquire) == _finished;
+      }
+      auto r = _h->lock_file_range(_offset, _bytes, _kind, deadline(std::chrono::seconds(0)));
+      if(r || r.error() != errc::timed_out || (_d && _d.steady && _d.nsecs == 0))
+      {
+        _result = std::move(r);
+        _state.store(_finished, std::memory_order_release);
+        return true;
+      }
+      std::chrono::steady_clock::time_point end;
+      if(_d)
+      {
+        end = _d.steady ? (std::chrono::steady_clock::now() + std::chrono::nanoseconds(_d.nsecs)) :
+                          (std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(_d.to_time_point() - std::chrono::system_clock::now()));
+      }
+      _state.store(_pending, std::memory_order_release);
+      try
+      {
+        _worker = std::thread([this, has_deadline = !!_d, end] {
+          _result = _acquire(_h, _offset, _bytes, _kind, has_deadline, end);
+          if(_state.exchange(_finished, std::memory_order_acq_rel) == _suspended)
+          {
+#if LLFIO_ENABLE_COROUTINES
+            _coro.resume();
+#endif
+          }
+        });
+      }
+      catch(...)
+      {
+        _result = error_from_exception();
+        _state.store(_finished, std::memory_order_release);
+        return true;
+      }
+      return false;
+    }
+
+#if LLFIO_ENABLE_COROUTINES
+    //! Suspends the coroutine for resumption after the lock is obtained, returning false if it already has been
+    bool await_suspend(coroutine_handle<> coro) noexcept
+    {
+      _coro = coro;
+      int expected = _pending;
+      return _state.compare_exchange_strong(expected, _suspended, std::memory_order_acq_rel);
+    }
+#endif
+
+    //! Returns the result of the lock
+    result<extent_guard> await_resume() noexcept
+    {
+      _join();
+      return std::move(_result);
+    }
+
+    //! Blocks the calling thread until the lock is obtained or fails, returning the result
+    result<extent_guard> get() noexcept
+    {
+      (void) await_ready();
+      return await_resume();
+    }
+  };
+
+  /*! \brief EXTENSION: A coroutinised equivalent to `lock_file_range()` which suspends the
+  coroutine whilst the range is contended, rather than blocking the thread. See
+  `lock_file_range_awaitable` for how this is implemented.
+  */
+  lock_file_range_awaitable co_lock_file_range(extent_type offset, extent_type bytes, lock_kind kind, deadline d = deadline()) noexcept
+  {
+    return lock_file_range_awaitable(this, offset, bytes, kind, d);
+  }
+
+  /*! \brief EXTENSION: Converts a byte range previously locked from one kind of lock to the other.
+
+  On POSIX conversion is always atomic, as a byte range lock replaces any lock the same open file
+  description holds over the same range. On Windows, downgrade from exclusive to shared is atomic, as
+  a shared lock may overlay an exclusive lock held by the same handle, and unlocking then releases the
+  exclusive lock first. Windows cannot upgrade from shared to exclusive atomically, so the shared lock
+  is released and an exclusive lock acquired, and if that fails, the shared lock is reacquired before
+  the failure is returned. Another locker may acquire the range in between.
+
+  If you have an `extent_guard`, `extent_guard::relock()` is more convenient.
+
+  \param offset The offset of the locked range.
+  \param bytes The number of bytes in the locked range.
+  \param from The kind of lock currently held over the range.
+  \param to The kind of lock wanted over the range.
+  \param d An optional deadline by which an upgrade must complete.
+  \errors As for `lock_file_range()`.
+  \mallocs None.
+  */
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<void> relock_file_range(extent_type offset, extent_type bytes, lock_kind from, lock_kind to, deadline d = deadline()) noexcept;
+
+  /*! \brief EXTENSION: Locks many byte ranges at once, in offset order to avoid deadlock.
+
+  The requests are sorted by offset in place, and locked in that order, so any two callers of this
+  function locking intersecting sets of ranges cannot deadlock one another. On POSIX, where a lock
+  may be unlocked piecemeal, abutting ranges of the same kind are locked with a single syscall.
+  If any lock fails, every lock acquired by this call is unlocked, and the failure returned.
+
+  \param reqs The ranges to lock, which must not overlap and which are sorted by offset in place.
+  A bytes of zero, meaning the whole file, is only permitted if it is the only request.
+  \param out A guard per request in sorted order, which must be at least as long as `reqs`. Any
+  locks already held by these guards are unlocked.
+  \param d An optional deadline by which each lock must complete, with the same semantics as for
+  `lock_file_range()`.
+  \errors As for `lock_file_range()`, plus `errc::invalid_argument` if the requests overlap or there
+  are too few guards.
+  \mallocs None.
+  */
+  result<void> lock_file_ranges(span<lock_file_range_request> reqs, span<extent_guard> out, deadline d = deadline()) noexcept
+  {
+    if(out.size() < reqs.size())
+    {
+      return errc::invalid_argument;
+    }
+    std::sort(reqs.begin(), reqs.end(), [](const lock_file_range_request &a, const lock_file_range_request &b) { return a.offset < b.offset; });
+    for(size_t n = 1; n < reqs.size(); n++)
+    {
+      if(reqs[n - 1].bytes == 0 || reqs[n].bytes == 0 || reqs[n - 1].offset + reqs[n - 1].bytes > reqs[n].offset)
+      {
+        return errc::invalid_argument;
+      }
+    }
+    for(size_t n = 0; n < reqs.size(); n++)
+    {
+      out[n].unlock();
+    }
+    size_t done = 0;
+    auto undo = make_scope_exit([&]() noexcept {
+      for(size_t n = 0; n < done; n++)
+      {
+        out[n].unlock();
+      }
+    });
+    while(done < reqs.size())
+    {
+      size_t end = done + 1;
+#ifndef _WIN32
+      while(end < reqs.size() && reqs[end].kind == reqs[done].kind && reqs[end - 1].offset + reqs[end - 1].bytes == reqs[end].offset)
+      {
+        ++end;
+      }
+#endif
+      OUTCOME_TRY(auto &&g, lock_file_range(reqs[done].offset, reqs[end - 1].offset + reqs[end - 1].bytes - reqs[done].offset, reqs[done].kind, d));
+      // Each request's guard unlocks only its part of the range
+      g.release();
+      for(; done < end; done++)
+      {
+        out[done] = extent_guard(this, reqs[done].offset, reqs[done].bytes, reqs[done].kind);
+      }
+    }
+    undo.release();
+    return success();
+  }
+
   /*! \brief EXTENSION: Unlocks a byte range previously locked.
 
   \param offset The offset to unlock. This should be an offset previously locked.
@@ -29,6 +29,19 @@ Distributed under the Boost Software License, Version 1.0.
 
 #if LLFIO_LOGGING_LEVEL
 
+#if LLFIO_THREAD_LOG_EVENTS && LLFIO_LOGGING_LEVEL >= 3
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+#endif
+
 /*! \todo TODO FIXME Replace in-memory log with memory map file backed log.
  */
 LLFIO_V2_NAMESPACE_BEGIN
@@ -66,6 +79,331 @@ public:
   ~log_level_guard() { log().thread_log_level(_v); }
 };
 
+#if LLFIO_THREAD_LOG_EVENTS && LLFIO_LOGGING_LEVEL >= 3
+//! \brief A log entry recorded by `LLFIO_LOG_WARN()` and more detailed levels into `thread_log()`.
+struct thread_log_entry
+{
+  uint64_t timestamp_ns{0};        //!< Steady clock nanoseconds when the entry was recorded.
+  log_level level{log_level::none};  //!< The level of the entry.
+  uint32_t code1{0};               //!< The instance which logged it.
+  uint32_t thread_id{0};           //!< The thread which logged it.
+  const char *function{nullptr};   //!< The function which logged it. Always a string literal.
+  unsigned lineno{0};              //!< The line which logged it.
+  char message[64]{};              //!< The message, truncated to 63 characters.
+};
+
+/*! \class thread_log_ringbuffers
+\brief A set of per-thread, lock free ring buffers of the last `N` `thread_log_entry`s
+logged by each thread, which are drained on demand into a single timestamp ordered sequence.
+
+`log()` is a single ring buffer shared by all threads, so every log entry contends on it.
+With `LLFIO_THREAD_LOG_EVENTS` set, warn and more detailed log entries are instead recorded
+into a ring buffer owned by the logging thread, which costs a steady clock read and a
+handful of relaxed stores with no shared writes. Fatal and error entries still go to `log()`,
+as failure info in `result` refers to them by index. Stack backtraces are never taken for
+entries recorded here, irrespective of `LLFIO_LOG_BACKTRACE_LEVELS`.
+
+Each slot is a seqlock: `drain()` discards any slot being overwritten whilst it is read, so
+it never returns a torn entry. A thread's buffer is reused by a later thread once the thread
+exits, so memory consumption is bounded by the peak number of threads which have logged, but
+entries of exited threads not yet drained may be overwritten.
+*/
+template <size_t N> class thread_log_ringbuffers
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "LLFIO_THREAD_LOG_EVENTS must be a power of two");
+  struct _slot
+  {
+    std::atomic<uint64_t> seq{0};  // 0 = never written or being written, else index + 1
+    std::atomic<uint64_t> timestamp_ns{0};
+    std::atomic<log_level> level{log_level::none};
+    std::atomic<uint32_t> code1{0}, thread_id{0};
+    std::atomic<const char *> function{nullptr};
+    std::atomic<unsigned> lineno{0};
+    std::atomic<uint64_t> message[sizeof(thread_log_entry::message) / sizeof(uint64_t)]{};
+  };
+  struct _buffer
+  {
+    _buffer *next{nullptr};
+    bool in_use{true};              // guarded by _lock, released by the owning thread on exit
+    std::atomic<uint64_t> end{0};   // written only by the owning thread
+    uint64_t drained{0};            // guarded by _lock
+    _slot slots[N];
+  };
+  std::mutex _lock;
+  _buffer *_buffers{nullptr};
+  std::atomic<uint64_t> _lost{0};
+
+  _buffer *_acquire() noexcept
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    for(_buffer *b = _buffers; b != nullptr; b = b->next)
+    {
+      if(!b->in_use)
+      {
+        b->in_use = true;
+        return b;
+      }
+    }
+    auto *b = new(std::nothrow) _buffer;
+    if(b != nullptr)
+    {
+      b->next = _buffers;
+      _buffers = b;
+    }
+    return b;
+  }
+  void _release(_buffer *b) noexcept
+  {
+    std::lock_guard<std::mutex> g(_lock);
+    b->in_use = false;
+  }
+  _buffer *_this_thread() noexcept
+  {
+#if LLFIO_THREAD_LOCAL_IS_CXX11
+    struct holder_t
+    {
+      thread_log_ringbuffers *parent{nullptr};
+      _buffer *b{nullptr};
+      ~holder_t()
+      {
+        if(b != nullptr)
+        {
+          parent->_release(b);
+        }
+      }
+    };
+    static thread_local holder_t holder;
+    if(holder.b == nullptr)
+    {
+      holder.parent = this;
+      holder.b = _acquire();
+    }
+    return holder.b;
+#else
+    // Without destructible thread locals, a buffer is never reused
+    static LLFIO_THREAD_LOCAL _buffer *b;
+    if(b == nullptr)
+    {
+      b = _acquire();
+    }
+    return b;
+#endif
+  }
+
+public:
+  //! The maximum number of entries retained per thread.
+  static constexpr size_t max_size() noexcept { return N; }
+
+  //! The current steady clock time in nanoseconds, as used by entries.
+  static uint64_t now() noexcept { return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); }
+
+  //! Records an entry into the calling thread's buffer, overwriting its oldest if full.
+  void emplace_back(log_level level, const char *message, uint32_t code1, uint32_t thread_id, const char *function, unsigned lineno) noexcept
+  {
+    _buffer *b = _this_thread();
+    if(b == nullptr)
+    {
+      _lost.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    uint64_t words[sizeof(thread_log_entry::message) / sizeof(uint64_t)]{};
+    if(message != nullptr)
+    {
+      size_t len = 0;
+      while(len < sizeof(words) - 1 && message[len] != 0)
+      {
+        ++len;
+      }
+      memcpy(words, message, len);
+    }
+    const uint64_t idx = b->end.load(std::memory_order_relaxed);
+    _slot &s = b->slots[idx & (N - 1)];
+    s.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.timestamp_ns.store(now(), std::memory_order_relaxed);
+    s.level.store(level, std::memory_order_relaxed);
+    s.code1.store(code1, std::memory_order_relaxed);
+    s.thread_id.store(thread_id, std::memory_order_relaxed);
+    s.function.store(function, std::memory_order_relaxed);
+    s.lineno.store(lineno, std::memory_order_relaxed);
+    for(size_t n = 0; n < sizeof(words) / sizeof(words[0]); n++)
+    {
+      s.message[n].store(words[n], std::memory_order_relaxed);
+    }
+    s.seq.store(idx + 1, std::memory_order_release);
+    b->end.store(idx + 1, std::memory_order_release);
+  }
+
+  //! The number of entries overwritten or torn before they could be drained.
+  uint64_t lost() const noexcept { return _lost.load(std::memory_order_relaxed); }
+
+  /*! \brief Removes and returns every entry recorded by every thread since the last drain,
+  oldest first.
+
+  Each thread's entries are already in timestamp order, so they are merged rather than resorted.
+  */
+  std::vector<thread_log_entry> drain()
+  {
+    std::vector<thread_log_entry> ret;
+    std::vector<size_t> bounds{0};
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      for(_buffer *b = _buffers; b != nullptr; b = b->next)
+      {
+        const uint64_t end = b->end.load(std::memory_order_acquire);
+        uint64_t begin = b->drained;
+        if(end - begin > N)
+        {
+          _lost.fetch_add(end - begin - N, std::memory_order_relaxed);
+          begin = end - N;
+        }
+        for(uint64_t idx = begin; idx < end; idx++)
+        {
+          const _slot &s = b->slots[idx & (N - 1)];
+          const uint64_t seq1 = s.seq.load(std::memory_order_acquire);
+          thread_log_entry e;
+          e.timestamp_ns = s.timestamp_ns.load(std::memory_order_relaxed);
+          e.level = s.level.load(std::memory_order_relaxed);
+          e.code1 = s.code1.load(std::memory_order_relaxed);
+          e.thread_id = s.thread_id.load(std::memory_order_relaxed);
+          e.function = s.function.load(std::memory_order_relaxed);
+          e.lineno = s.lineno.load(std::memory_order_relaxed);
+          uint64_t words[sizeof(thread_log_entry::message) / sizeof(uint64_t)];
+          for(size_t n = 0; n < sizeof(words) / sizeof(words[0]); n++)
+          {
+            words[n] = s.message[n].load(std::memory_order_relaxed);
+          }
+          std::atomic_thread_fence(std::memory_order_acquire);
+          const uint64_t seq2 = s.seq.load(std::memory_order_relaxed);
+          if(seq1 == idx + 1 && seq2 == seq1)
+          {
+            memcpy(e.message, words, sizeof(e.message));
+            e.message[sizeof(e.message) - 1] = 0;
+            ret.push_back(e);
+          }
+          else
+          {
+            _lost.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+        b->drained = end;
+        bounds.push_back(ret.size());
+      }
+    }
+    // Merge adjacent pairs of runs until a single run remains
+    auto before = [](const thread_log_entry &a, const thread_log_entry &b) { return a.timestamp_ns < b.timestamp_ns; };
+    while(bounds.size() > 2)
+    {
+      std::vector<size_t> merged{0};
+      size_t n = 2;
+      for(; n < bounds.size(); n += 2)
+      {
+        std::inplace_merge(ret.begin() + bounds[n - 2], ret.begin() + bounds[n - 1], ret.begin() + bounds[n], before);
+        merged.push_back(bounds[n]);
+      }
+      if(n == bounds.size())
+      {
+        merged.push_back(bounds.back());
+      }
+      bounds = std::move(merged);
+    }
+    return ret;
+  }
+
+  /*! \brief Drains every entry into `log()`, oldest first, returning how many were drained.
+
+  Entries adopt the timestamp of when they were drained, so this should be called often if
+  `log()` is the primary record. If `LLFIO_LOG_TO_OSTREAM` is set, entries are printed now.
+  */
+  size_t drain_into_log()
+  {
+    const auto entries = drain();
+    for(const auto &e : entries)
+    {
+      log().emplace_back(e.level, e.message, e.code1, e.thread_id, e.function, e.lineno);
+    }
+    return entries.size();
+  }
+};
+
+//! The per-thread buffers of warn and more detailed log entries used by LLFIO
+inline LLFIO_DECL thread_log_ringbuffers<LLFIO_THREAD_LOG_EVENTS> &thread_log() noexcept
+{
+  // Leaked, so threads exiting after static destruction can still release their buffer
+  static auto *_log = new thread_log_ringbuffers<LLFIO_THREAD_LOG_EVENTS>;
+  return *_log;
+}
+
+/*! \class thread_log_drainer
+\brief RAII launcher of a background thread which drains `thread_log()` into a sink
+every `interval`, and once more upon destruction.
+
+The default sink is `thread_log().drain_into_log()`.
+*/
+class thread_log_drainer
+{
+public:
+  //! The type of the sink, which receives every drained entry oldest first.
+  using sink_type = std::function<void(const std::vector<thread_log_entry> &)>;
+
+private:
+  sink_type _sink;
+  std::chrono::milliseconds _interval;
+  std::mutex _lock;
+  std::condition_variable _cond;
+  bool _done{false};
+  std::thread _thread;
+
+  void _drain()
+  {
+    if(_sink)
+    {
+      _sink(thread_log().drain());
+    }
+    else
+    {
+      thread_log().drain_into_log();
+    }
+  }
+
+public:
+  //! Begins draining every `interval` into `sink`, or into `log()` if `sink` is empty.
+  explicit thread_log_drainer(std::chrono::milliseconds interval = std::chrono::milliseconds(100), sink_type sink = {})
+      : _sink(std::move(sink))
+      , _interval(interval)
+      , _thread([this] {
+        std::unique_lock<std::mutex> g(_lock);
+        for(;;)
+        {
+          _cond.wait_for(g, _interval, [this] { return _done; });
+          const bool done = _done;
+          g.unlock();
+          _drain();
+          if(done)
+          {
+            return;
+          }
+          g.lock();
+        }
+      })
+  {
+  }
+  thread_log_drainer(const thread_log_drainer &) = delete;
+  thread_log_drainer(thread_log_drainer &&) = delete;
+  thread_log_drainer &operator=(const thread_log_drainer &) = delete;
+  thread_log_drainer &operator=(thread_log_drainer &&) = delete;
+  ~thread_log_drainer()
+  {
+    {
+      std::lock_guard<std::mutex> g(_lock);
+      _done = true;
+    }
+    _cond.notify_all();
+    _thread.join();
+  }
+};
+#endif
+
 // Infrastructure for recording the current path for when failure occurs
 #ifndef LLFIO_DISABLE_PATHS_IN_FAILURE_INFO
 namespace detail
@@ -177,15 +515,27 @@ LLFIO_V2_NAMESPACE_END
 #else
 #define LLFIO_LOG_ERROR(inst, message)
 #endif
+#if LLFIO_THREAD_LOG_EVENTS && LLFIO_LOGGING_LEVEL >= 3
+#define LLFIO_LOG_TO_THREAD_LOG(lvl, inst, message)                                                                                                                                                                                                                                                                            \
+  ((::LLFIO_V2_NAMESPACE::log().log_level() >= (lvl)) ? ::LLFIO_V2_NAMESPACE::thread_log().emplace_back((lvl), (message), ::LLFIO_V2_NAMESPACE::detail::unsigned_integer_cast<unsigned>(inst), QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id(), __func__, __LINE__) : void())
+#endif
 #if LLFIO_LOGGING_LEVEL >= 3
+#if LLFIO_THREAD_LOG_EVENTS
+#define LLFIO_LOG_WARN(inst, message) LLFIO_LOG_TO_THREAD_LOG(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::warn, inst, message)
+#else
 #define LLFIO_LOG_WARN(inst, message)                                                                                                                                                                                                                                                                                          \
   ::LLFIO_V2_NAMESPACE::log().emplace_back(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::warn, (message), ::LLFIO_V2_NAMESPACE::detail::unsigned_integer_cast<unsigned>(inst), QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id(), (LLFIO_LOG_BACKTRACE_LEVELS & (1U << 3U)) ? nullptr : __func__, __LINE__)
+#endif
 #else
 #define LLFIO_LOG_WARN(inst, message)
 #endif
 #if LLFIO_LOGGING_LEVEL >= 4
+#if LLFIO_THREAD_LOG_EVENTS
+#define LLFIO_LOG_INFO(inst, message) LLFIO_LOG_TO_THREAD_LOG(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::info, inst, message)
+#else
 #define LLFIO_LOG_INFO(inst, message)                                                                                                                                                                                                                                                                                          \
   ::LLFIO_V2_NAMESPACE::log().emplace_back(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::info, (message), ::LLFIO_V2_NAMESPACE::detail::unsigned_integer_cast<unsigned>(inst), QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id(), (LLFIO_LOG_BACKTRACE_LEVELS & (1U << 4U)) ? nullptr : __func__, __LINE__)
+#endif
 
 // Need to expand out our namespace into a string
 #define LLFIO_LOG_STRINGIFY9(s) #s "::"
@@ -278,14 +628,22 @@ LLFIO_V2_NAMESPACE_END
 #define LLFIO_LOG_FUNCTION_CALL(inst) LLFIO_LOG_INST_TO_TLS(inst)
 #endif
 #if LLFIO_LOGGING_LEVEL >= 5
+#if LLFIO_THREAD_LOG_EVENTS
+#define LLFIO_LOG_DEBUG(inst, message) LLFIO_LOG_TO_THREAD_LOG(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::debug, inst, message)
+#else
 #define LLFIO_LOG_DEBUG(inst, message)                                                                                                                                                                                                                                                                                         \
   ::LLFIO_V2_NAMESPACE::log().emplace_back(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::debug, ::LLFIO_V2_NAMESPACE::detail::unsigned_integer_cast<unsigned>(inst), QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id(), (LLFIO_LOG_BACKTRACE_LEVELS & (1U << 5U)) ? nullptr : __func__, __LINE__)
+#endif
 #else
 #define LLFIO_LOG_DEBUG(inst, message)
 #endif
 #if LLFIO_LOGGING_LEVEL >= 6
+#if LLFIO_THREAD_LOG_EVENTS
+#define LLFIO_LOG_ALL(inst, message) LLFIO_LOG_TO_THREAD_LOG(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::all, inst, message)
+#else
 #define LLFIO_LOG_ALL(inst, message)                                                                                                                                                                                                                                                                                           \
   ::LLFIO_V2_NAMESPACE::log().emplace_back(QUICKCPPLIB_NAMESPACE::ringbuffer_log::level::all, (message), ::LLFIO_V2_NAMESPACE::detail::unsigned_integer_cast<unsigned>(inst), QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id(), (LLFIO_LOG_BACKTRACE_LEVELS & (1U << 6U)) ? nullptr : __func__, __LINE__)
+#endif
 #else
 #define LLFIO_LOG_ALL(inst, message)
 #endif
@@ -333,4 +691,185 @@ LLFIO_V2_NAMESPACE_END
 #endif
 #endif
 
+#if LLFIO_TRACE_EVENTS
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+LLFIO_V2_NAMESPACE_BEGIN
+
+//! \brief A typed timing event recorded by `LLFIO_TRACE_SYSCALL()` into `trace_log()`.
+struct trace_event
+{
+  const char *name{nullptr};  //!< The syscall issued. Always a string literal.
+  const void *inst{nullptr};  //!< The handle or multiplexer which issued it.
+  uint32_t thread_id{0};      //!< The thread which issued it.
+  uint64_t begin_ns{0};       //!< Steady clock nanoseconds when the syscall began.
+  uint64_t end_ns{0};         //!< Steady clock nanoseconds when the syscall returned.
+};
+
+/*! \class trace_ringbuffer
+\brief A fixed size, lock free ring buffer of the last `N` `trace_event`s.
+
+Unlike `log()`, recording an event costs two steady clock reads, an atomic
+increment and a handful of relaxed stores, so it can be left enabled under
+real load. Each slot is a seqlock: `events()` discards any slot being
+overwritten whilst it is read, so it never returns a torn event.
+*/
+template <size_t N> class trace_ringbuffer
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "LLFIO_TRACE_EVENTS must be a power of two");
+  struct _slot
+  {
+    std::atomic<uint64_t> seq{0};  // 0 = never written or being written, else index + 1
+    std::atomic<const char *> name{nullptr};
+    std::atomic<const void *> inst{nullptr};
+    std::atomic<uint32_t> thread_id{0};
+    std::atomic<uint64_t> begin_ns{0}, end_ns{0};
+  };
+  std::atomic<bool> _enabled{true};
+  std::atomic<uint64_t> _next{0};
+  _slot _slots[N];
+
+public:
+  //! True if events are being recorded.
+  bool enabled() const noexcept { return _enabled.load(std::memory_order_relaxed); }
+  //! Sets whether events are recorded.
+  void enabled(bool v) noexcept { _enabled.store(v, std::memory_order_relaxed); }
+  //! The maximum number of events retained.
+  static constexpr size_t max_size() noexcept { return N; }
+
+  //! The current steady clock time in nanoseconds, as used by events.
+  static uint64_t now() noexcept { return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()); }
+
+  //! Records an event, overwriting the oldest if full.
+  void push_back(const char *name, const void *inst, uint32_t thread_id, uint64_t begin_ns, uint64_t end_ns) noexcept
+  {
+    const uint64_t idx = _next.fetch_add(1, std::memory_order_relaxed);
+    _slot &s = _slots[idx & (N - 1)];
+    s.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.name.store(name, std::memory_order_relaxed);
+    s.inst.store(inst, std::memory_order_relaxed);
+    s.thread_id.store(thread_id, std::memory_order_relaxed);
+    s.begin_ns.store(begin_ns, std::memory_order_relaxed);
+    s.end_ns.store(end_ns, std::memory_order_relaxed);
+    s.seq.store(idx + 1, std::memory_order_release);
+  }
+
+  //! Discards all events.
+  void clear() noexcept
+  {
+    for(auto &s : _slots)
+    {
+      s.seq.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  //! Returns a consistent snapshot of the retained events, oldest first.
+  std::vector<trace_event> events() const
+  {
+    std::vector<trace_event> ret;
+    const uint64_t end = _next.load(std::memory_order_acquire);
+    const uint64_t begin = (end > N) ? (end - N) : 0;
+    ret.reserve(static_cast<size_t>(end - begin));
+    for(uint64_t idx = begin; idx < end; idx++)
+    {
+      const _slot &s = _slots[idx & (N - 1)];
+      const uint64_t seq1 = s.seq.load(std::memory_order_acquire);
+      trace_event e;
+      e.name = s.name.load(std::memory_order_relaxed);
+      e.inst = s.inst.load(std::memory_order_relaxed);
+      e.thread_id = s.thread_id.load(std::memory_order_relaxed);
+      e.begin_ns = s.begin_ns.load(std::memory_order_relaxed);
+      e.end_ns = s.end_ns.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      const uint64_t seq2 = s.seq.load(std::memory_order_relaxed);
+      if(seq1 == idx + 1 && seq2 == seq1)
+      {
+        ret.push_back(e);
+      }
+    }
+    return ret;
+  }
+};
+
+//! The syscall timing trace used by LLFIO
+inline LLFIO_DECL trace_ringbuffer<LLFIO_TRACE_EVENTS> &trace_log() noexcept
+{
+  static trace_ringbuffer<LLFIO_TRACE_EVENTS> _log;
+  return _log;
+}
+
+/*! \brief Writes the events currently in `trace_log()` as Chrome trace / Perfetto JSON
+suitable for loading into `chrome://tracing` or https://ui.perfetto.dev.
+
+Each event becomes a complete (`"ph":"X"`) event whose thread is the issuing thread,
+and whose `inst` argument is the address of the issuing handle or multiplexer.
+*/
+inline void write_chrome_trace(std::ostream &s)
+{
+  const auto events = trace_log().events();
+  // Chrome wants microseconds, but accepts fractions
+  auto write_us = [&](uint64_t ns) {
+    const unsigned frac = static_cast<unsigned>(ns % 1000);
+    s << (ns / 1000) << '.' << static_cast<char>('0' + frac / 100) << static_cast<char>('0' + (frac / 10) % 10) << static_cast<char>('0' + frac % 10);
+  };
+  s << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for(const auto &e : events)
+  {
+    if(!first)
+    {
+      s << ',';
+    }
+    first = false;
+    s << "\n{\"name\":\"" << e.name << "\",\"cat\":\"llfio\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread_id << ",\"ts\":";
+    write_us(e.begin_ns);
+    s << ",\"dur\":";
+    write_us(e.end_ns - e.begin_ns);
+    s << ",\"args\":{\"inst\":\"0x" << std::hex << reinterpret_cast<uintptr_t>(e.inst) << std::dec << "\"}}";
+  }
+  s << "\n]}\n";
+}
+
+namespace detail
+{
+  // RAII timer which records a trace event on scope exit
+  class trace_syscall_scope
+  {
+    const char *_name;
+    const void *_inst;
+    uint64_t _begin;
+
+  public:
+    trace_syscall_scope(const void *inst, const char *name) noexcept
+        : _name(trace_log().enabled() ? name : nullptr)
+        , _inst(inst)
+        , _begin((_name != nullptr) ? trace_log().now() : 0)
+    {
+    }
+    trace_syscall_scope(const trace_syscall_scope &) = delete;
+    trace_syscall_scope(trace_syscall_scope &&) = delete;
+    trace_syscall_scope &operator=(const trace_syscall_scope &) = delete;
+    trace_syscall_scope &operator=(trace_syscall_scope &&) = delete;
+    ~trace_syscall_scope()
+    {
+      if(_name != nullptr)
+      {
+        trace_log().push_back(_name, _inst, QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id(), _begin, trace_log().now());
+      }
+    }
+  };
+}  // namespace detail
+
+LLFIO_V2_NAMESPACE_END
+
+//! Records the time taken from here until end of scope to `trace_log()` as syscall `name` issued by `inst`
+#define LLFIO_TRACE_SYSCALL(inst, name) ::LLFIO_V2_NAMESPACE::detail::trace_syscall_scope LLFIO_UNIQUE_NAME((const void *) (inst), (name))
+#else
+#define LLFIO_TRACE_SYSCALL(inst, name)
+#endif
+
 #endif
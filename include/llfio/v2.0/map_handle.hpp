@@ -36,6 +36,11 @@ Distributed under the Boost Software License, Version 1.0.
 
 LLFIO_V2_NAMESPACE_EXPORT_BEGIN
 
+namespace detail
+{
+  struct section_handle_dirty_ranges;
+}
+
 /*! \class section_handle
 \brief A handle to a source of mapped memory.
 
@@ -62,13 +67,16 @@ public:
                                    execute = 1U << 3U,  //!< Memory views can execute code
 
                                    nocommit = 1U << 8U,     //!< Don't allocate space for this memory in the system immediately
-                                   prefault = 1U << 9U,     //!< Prefault, as if by reading every page, any views of memory upon creation.
+                                   prefault = 1U << 9U,     //!< Prefault, as if by reading every page, any views of memory upon creation. See `map_handle::populate()` for a multithreaded alternative.
                                    executable = 1U << 10U,  //!< The backing storage is in fact an executable program binary.
                                    singleton = 1U << 11U,   //!< A single instance of this section is to be shared by all processes using the same backing file.
 
                                    barrier_on_close = 1U << 16U,   //!< Maps of this section, if writable, issue a `barrier()` when destructed blocking until data (not metadata) reaches physical storage.
-                                   nvram = 1U << 17U,              //!< This section is of non-volatile RAM.
+                                   nvram = 1U << 17U,              //!< This section is of non-volatile RAM. Set automatically for files on DAX mounts on Linux and Windows.
                                    write_via_syscall = 1U << 18U,  //!< For file backed maps, `map_handle::write()` is implemented as a `write()` syscall to the file descriptor. This causes the map to be mapped read-only.
+                                   prefer_large_pages = 1U << 19U,  //!< Ask the kernel to transparently use large pages for maps of this section where it can, without failing if it cannot. See `map_handle` for per platform details.
+                                   track_dirty = 1U << 20U,  //!< Track which parts of this section are modified by `map_handle::write()` or `map_handle::mark_dirty()`, so barriers of whole maps flush only those.
+                                   nontemporal_writes = 1U << 21U,  //!< `map_handle::write()` copies buffers of a page or more using stores bypassing the CPU caches, for data which will not soon be read back.
 
                                    page_sizes_1 = 1U << 24U,  //!< Use `utils::page_sizes()[1]` sized pages, or fail.
                                    page_sizes_2 = 2U << 24U,  //!< Use `utils::page_sizes()[2]` sized pages, or fail.
@@ -79,10 +87,13 @@ public:
                                    readwrite = (read | write)};
   QUICKCPPLIB_BITFIELD_END(flag);
 
+  friend class map_handle;
+
 protected:
   file_handle *_backing{nullptr};
   file_handle _anonymous;
   flag _flag{flag::none};
+  detail::section_handle_dirty_ranges *_dirty{nullptr};  // if flag::track_dirty
 
 public:
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC ~section_handle() override;
@@ -108,9 +119,11 @@ public:
       , _backing(o._backing)
       , _anonymous(std::move(o._anonymous))
       , _flag(o._flag)
+      , _dirty(o._dirty)
   {
     o._backing = nullptr;
     o._flag = flag::none;
+    o._dirty = nullptr;
   }
   //! No copy construction (use `clone()`)
   section_handle(const section_handle &) = delete;
@@ -160,6 +173,12 @@ public:
   \param dirh Where to create the anonymous, managed file.
   \param _flag How to create the section.
 
+  On Windows, if `flag::page_sizes_1` is set, the section is instead backed by the paging file,
+  which is the only kind of section Windows permits to use large pages. `dirh` is then ignored,
+  `bytes` is rounded up to the large page size, and the section cannot be resized. The section
+  handle can be duplicated into other processes to share the memory using large pages. This
+  requires `SeLockMemoryPrivilege`, without which `errc::operation_not_permitted` is returned.
+
   \errors Any of the values POSIX dup(), open() or NtCreateSection() can return.
   */
   LLFIO_MAKE_FREE_FUNCTION
@@ -235,6 +254,18 @@ inline std::ostream &operator<<(std::ostream &s, const section_handle::flag &v)
   {
     temp.append("write_via_syscall|");
   }
+  if(!!(v & section_handle::flag::prefer_large_pages))
+  {
+    temp.append("prefer_large_pages|");
+  }
+  if(!!(v & section_handle::flag::track_dirty))
+  {
+    temp.append("track_dirty|");
+  }
+  if(!!(v & section_handle::flag::nontemporal_writes))
+  {
+    temp.append("nontemporal_writes|");
+  }
   if((v & section_handle::flag::page_sizes_3) == section_handle::flag::page_sizes_3)
   {
     temp.append("page_sizes_3|");
@@ -273,7 +304,20 @@ template <> struct construct<section_handle>
 
 class mapped_file_handle;
 
-/*! Lightweight inlined barrier which causes the CPU to write out all buffered writes and dirty cache lines
+/*! Barrier which causes the CPU to write out all buffered writes and dirty cache lines in each of the
+requests to main memory, issuing a single trailing fence for all of them.
+\return The requests, each adjusted to the cache lines actually barriered. These may be empty. This function does not return an error.
+\param reqs The ranges of cache lines to write barrier, which are modified in place.
+\param evict Whether to also evict the cache lines from CPU caches, useful if they will not be used again.
+
+The cache line flush instruction is chosen at runtime from those the CPU supports. On x64 this is the
+first of `CLWB`, `CLFLUSHOPT` and `CLFLUSH` available (`CLWB` is skipped if `evict` is true), followed by
+`SFENCE`. On AArch64 this is `DC CVAP` if the CPU implements it, otherwise `DC CVAC`, followed by
+`DSB ISH`. On other architectures, nothing is barriered.
+*/
+LLFIO_HEADERS_ONLY_FUNC_SPEC span<io_handle::const_buffer_type> nvram_barrier(span<io_handle::const_buffer_type> reqs, bool evict = false) noexcept;
+
+/*! Barrier which causes the CPU to write out all buffered writes and dirty cache lines
 in the request to main memory.
 \return The cache lines actually barriered. This may be empty. This function does not return an error.
 \param req The range of cache lines to write barrier.
@@ -285,14 +329,63 @@ support this operation). You may find the `is_nvram()` observer of particular us
 */
 inline io_handle::const_buffer_type nvram_barrier(io_handle::const_buffer_type req, bool evict = false) noexcept
 {
-  auto *tp = (io_handle::const_buffer_type::pointer)(((uintptr_t) req.data()) & ~63);
-  io_handle::const_buffer_type ret{tp, (size_t)(req.data() + 63 + req.size() - tp) & ~63};
-  if(memory_flush_none == mem_flush_stores(ret.data(), ret.size(), evict ? memory_flush_evict : memory_flush_retain))
+  nvram_barrier(span<io_handle::const_buffer_type>(&req, 1), evict);
+  return req;
+}
+
+/*! \struct numa_placement
+\brief A policy for which NUMA nodes the pages of new maps are placed upon.
+
+By default, the system places each page upon the node of the CPU which first touches it.
+If memory allocated by one thread is consumed by threads on another node, this policy is
+the wrong one, and a different one can be set per thread using `this_thread::set_numa_placement()`,
+which is applied by `map_handle::map()` to both anonymous and section backed maps, and thus
+also to `algorithm::trivial_vector` and to registered i/o buffers. `map_handle::set_numa_placement()`
+sets the policy for an existing region.
+
+On Linux, this is implemented using `mbind()`, and all policies are supported. On Windows, the
+policy can only be applied when allocating memory using `map_handle::map(bytes)`, via `VirtualAllocExNuma()`.
+Windows only has preferred nodes, so `bind` is implemented as `prefer`, and `interleave` is not supported.
+On other platforms, only the preference policies are accepted, and they are ignored.
+*/
+struct numa_placement
+{
+  //! The kinds of placement policy
+  enum class policy_type : uint8_t
+  {
+    first_touch = 0,  //!< The system default: pages are placed on the node of the CPU which first touches them.
+    local,            //!< Prefer the node of the CPU creating the map, rather than of the CPU first touching its pages.
+    prefer,           //!< Prefer the lowest node in `nodes`, falling back to other nodes if it has no free memory.
+    bind,             //!< Place pages only upon the nodes in `nodes`, failing if they have no free memory.
+    interleave        //!< Place pages round robin across the nodes in `nodes`.
+  };
+  //! The placement policy
+  policy_type policy{policy_type::first_touch};
+  //! A bitmask of NUMA nodes, where bit N is node N. Unused by `first_touch` and `local`.
+  uint64_t nodes{0};
+
+  //! Default constructor, the system default policy
+  constexpr numa_placement() {}  // NOLINT
+  //! Constructs the given policy for the given nodes
+  constexpr numa_placement(policy_type _policy, uint64_t _nodes = 0)  // NOLINT
+      : policy(_policy)
+      , nodes(_nodes)
   {
-    ret = {tp, 0};
   }
-  return ret;
-}
+  //! A policy binding pages to a single node
+  static constexpr numa_placement bind_to(unsigned node) noexcept { return {policy_type::bind, (uint64_t) 1 << node}; }
+
+  constexpr bool operator==(const numa_placement &o) const noexcept { return policy == o.policy && nodes == o.nodes; }
+  constexpr bool operator!=(const numa_placement &o) const noexcept { return !(*this == o); }
+};
+
+namespace this_thread
+{
+  //! \brief Return the calling thread's NUMA placement policy for new maps.
+  LLFIO_HEADERS_ONLY_FUNC_SPEC numa_placement current_numa_placement() noexcept;
+  //! \brief Set the calling thread's NUMA placement policy for new maps, returning the previous policy.
+  LLFIO_HEADERS_ONLY_FUNC_SPEC numa_placement set_numa_placement(numa_placement placement) noexcept;
+}  // namespace this_thread
 
 
 /*! \class map_handle
@@ -357,14 +450,20 @@ workarounds such as over commit and specialised OOM killers.
 to account for OS differences i.e. it calls `msync()`, and then the `barrier()` implementation for the backing file
 (probably `fsync()` or equivalent on most platforms, which synchronises the entire file).
 
-This is vast overkill if you are using non-volatile RAM, so a special *inlined* `nvram_barrier()` implementation
-taking a single buffer and no other arguments is also provided as a free function. This calls the appropriate architecture-specific
-instructions to cause the CPU to write all preceding writes out of the write buffers and CPU caches to main
-memory, so for Intel CPUs this would be `CLWB <each cache line>; SFENCE;`. As this is inlined, it ought to
-produce optimal code. If your CPU does not support the requisite instructions (or LLFIO has not added support),
+This is vast overkill if you are using non-volatile RAM, so a special `nvram_barrier()` implementation
+taking one or many buffers is also provided as a free function. This calls the best architecture-specific
+instructions the running CPU supports to cause it to write all preceding writes out of the write buffers and CPU caches to main
+memory, so for recent Intel CPUs this would be `CLWB <each cache line>; SFENCE;`. Many non-contiguous
+buffers share a single trailing fence. If your CPU does not support the requisite instructions (or LLFIO has not added support),
 and empty buffer will be returned to indicate that nothing was barriered, same as the normal `barrier()`
 function.
 
+Files on DAX mounts (persistent memory mapped directly, without the kernel page cache) are detected when
+their section is created, and `section_handle::flag::nvram` is set for them. On Linux, maps of such sections
+use `MAP_SYNC`, which guarantees that the file metadata needed to reach written data is durable, so
+barriers of `barrier_kind::wait_data_only` or weaker merely flush CPU caches, skipping `msync()`. If the kernel
+refuses `MAP_SYNC`, the map is not treated as `nvram`, and barriers revert to `msync()`.
+
 ## Large page support:
 
 Large, huge, massive and super page support is available via the `section_handle::flag::page_sizes_N` flags.
@@ -383,12 +482,14 @@ For allocating memory, large page allocation can randomly fail depending on what
 like, same as on all the other operating systems. It is not permitted to reserve address space using large pages.
 
 For mapping files, large page maps do not work as of Windows 10 1803 (curiously, ReactOS *does*
-implement this). There is a big exception to this, which is for DAX formatted NTFS volumes with a formatted
+implement this). Anonymous sections created with `section_handle::flag::page_sizes_1` are backed
+by the paging file instead of a temporary inode, so they and their maps do use large pages. There is a big exception to this, which is for DAX formatted NTFS volumes with a formatted
 cluster size of the large page size, where if
 you map in large page sized multiples, the Windows kernel uses large pages (and one need not hold
 `SeLockMemoryPrivilege` either). Therefore, if you specify `section_handle::flag::nvram` with a
 `section_handle::flag::page_sizes_N`, LLFIO does not ask for large pages which would fail, it merely
 rounds all requests up to the nearest large page multiple.
+Windows has no transparent large page support, so `section_handle::flag::prefer_large_pages` is ignored.
 
 ### Linux:
 
@@ -405,8 +506,12 @@ able to map files using large pages soon, and in theory LLFIO based should "just
 Note that some distributions enable transparent huge pages, whereby if you request allocations of large page multiples
 at large page offsets, the kernel uses large pages, without you needing to specify any `section_handle::flag::page_sizes_N`.
 Almost all distributions enable opt-in transparent huge pages, where you can explicitly request that pages
-within a region of memory transparently use huge pages as much as possible. LLFIO does not expose such
-facilities, you will need to manually invoke `madvise(MADV_HUGEPAGE)` on the region desired.
+within a region of memory transparently use huge pages as much as possible. `section_handle::flag::prefer_large_pages`
+exposes this: maps placed by LLFIO are aligned such that the address and file offset share large page alignment, and
+the map is marked with `madvise(MADV_HUGEPAGE)`. This works for anonymous memory, for `tmpfs` and `shmem` mounted with
+`huge=advise` or better, for read-only maps of files on kernels built with `CONFIG_READ_ONLY_THP_FOR_FS`, and for DAX
+mounted files, where the alignment alone suffices for the kernel to use PMD sized mappings. Failure to obtain large
+pages is never reported, as with all transparent huge page support.
 
 ### FreeBSD:
 
@@ -414,11 +519,14 @@ FreeBSD has no support for failing if large pages cannot be used for a specific
 large pages, and you may or may not get them depending on available system resources, filing system in use,
 etc. LLFIO does not check returned maps to discover if large
 pages were actually used, that is on end user code to check if it really needs to know.
+`section_handle::flag::prefer_large_pages` asks for superpage aligned placement via `MAP_ALIGNED_SUPER`,
+from which the kernel may promote the map to superpages.
 
 ### MacOS:
 
 MacOS only supports large pages for memory allocations, not for mapping files. It fails if large pages could
 not be used when a large page allocation was requested.
+`section_handle::flag::prefer_large_pages` is ignored.
 
 \sa `mapped_file_handle`, `algorithm::mapped_span`
 */
@@ -446,6 +554,8 @@ protected:
   extent_type _offset{0};
   size_type _reservation{0}, _length{0}, _pagesize{0};
   section_handle::flag _flag{section_handle::flag::none};
+  bool _recyclable{false};  // allocated by `map(bytes)`, and page protections since unchanged
+  bool _placeholder{false};  // Windows: views mapped into placeholders, with one holding the rest of the last granule
 
   explicit map_handle(section_handle *section, section_handle::flag flags)
       : _section(section)
@@ -485,6 +595,8 @@ public:
       , _length(o._length)
       , _pagesize(o._pagesize)
       , _flag(o._flag)
+      , _recyclable(o._recyclable)
+      , _placeholder(o._placeholder)
   {
     o._section = nullptr;
     o._addr = nullptr;
@@ -493,6 +605,8 @@ public:
     o._length = 0;
     o._pagesize = 0;
     o._flag = section_handle::flag::none;
+    o._recyclable = false;
+    o._placeholder = false;
   }
   //! No copy construction (use `clone()`)
   map_handle(const map_handle &) = delete;
@@ -547,6 +661,10 @@ public:
   the other constructor. This makes available all those very useful VM tricks Windows can do with
   section mapped memory which `VirtualAlloc()` memory cannot do.
 
+  \note If the map handle cache has been enabled using `set_cache_enabled()` and `zeroed` is false,
+  a recently closed map of the same size, page size and flags is reused if available, which
+  involves no syscalls.
+
   \errors Any of the values POSIX `mmap()` or `VirtualAlloc()` can return.
   */
   LLFIO_MAKE_FREE_FUNCTION
@@ -587,6 +705,25 @@ public:
   LLFIO_MAKE_FREE_FUNCTION
   static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map(section_handle &section, size_type bytes = 0, extent_type offset = 0, section_handle::flag _flag = section_handle::flag::readwrite) noexcept;
 
+  /*! Create a memory mapped view of a region of backing storage mapped twice back to back, such
+  that the byte at `address() + n + bytes` is the same byte as at `address() + n`. This lets a ring
+  buffer be read and written with contiguous spans regardless of where its wrap point lies.
+
+  \param section A memory section handle specifying the backing storage to use.
+  \param bytes How many bytes of the section to mirror, which must be a non-zero multiple of
+  `utils::allocation_granularity()`. The returned map's `length()` is twice this.
+  \param offset The offset into the backing storage to map from, which must be a multiple of
+  `utils::allocation_granularity()`. The section must be at least `offset + bytes` long.
+  \param _flag The permissions with which to map the view. Copy on write maps cannot be mirrored.
+
+  The map cannot be resized with `truncate()`. On Windows, placing the second view needs the
+  address space after the first to be free, which another thread may race to take, so placement
+  is retried a few times before `errc::not_enough_memory` is returned.
+
+  \errors Any of the values POSIX `mmap()` or `NtMapViewOfSection()` can return.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<map_handle> map_mirrored(section_handle &section, size_type bytes, extent_type offset = 0, section_handle::flag _flag = section_handle::flag::readwrite) noexcept;
+
   //! The memory section this handle is using
   section_handle *section() const noexcept { return _section; }
   //! Sets the memory section this handle is using
@@ -652,6 +789,13 @@ public:
   place the map elsewhere. In this situation, we delete the new map and return failure,
   which is inefficient, but there is nothing else we can do.
 
+  \note On Windows 10 1803 and later, maps of sections are made within placeholder reservations
+  (see `VirtualAlloc2()`), and hold the address space until the next 64Kb boundary after their
+  end. Expansion first takes the address space after that, and only then unmaps the last view
+  back into a placeholder and remaps it larger, so no other thread can claim the address space
+  in between, and a reservation need not end on a 64Kb boundary to be extended in place. Address
+  space reserved by `reserve()` is always a multiple of 64Kb on Windows for the same reason.
+
   \return The bytes actually reserved.
   \param newsize The bytes to truncate the map reservation to. Rounded up to the nearest page size (POSIX) or 64Kb on Windows.
   \param permit_relocation Permit the address to change (some OSs provide a syscall for resizing
@@ -718,6 +862,26 @@ public:
   */
   LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<buffer_type> do_not_store(buffer_type region) noexcept;
 
+  /*! \brief Synchronously makes the pages of the region resident in memory, using up to `threads` threads
+  in parallel, so first accesses to the map do not incur page faults.
+
+  \param region The region to populate. A default constructed region means the whole valid extent of the map.
+  The region is always clamped to the valid extent of the map, as touching beyond it would fault.
+  \param threads The number of threads to use, where zero means one per hardware thread. Fewer are used
+  if there is less than 16Mb per thread to populate.
+
+  `section_handle::flag::prefault` populates a map upon creation, but it is implemented by a single
+  thread (`MAP_POPULATE`), or not at all on some platforms. For maps of tens of Gb, this function
+  populates concurrently from many threads, which for both storage and kernel page table updates
+  can be many times quicker. On Linux 5.14 or later each thread uses `madvise(MADV_POPULATE_READ)`,
+  or `MADV_POPULATE_WRITE` for writable anonymous memory, which avoids returning to user space for
+  every page. Elsewhere, each thread prefetches its portion then reads a byte of every page.
+
+  \errors Any of the values `madvise()` can return.
+  \mallocs Up to `threads` threads are launched.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> populate(buffer_type region = {}, size_t threads = 0) const noexcept;
+
   //! Ask the system to begin to asynchronously prefetch the span of memory regions given, returning the regions actually prefetched. Note that on Windows 7 or earlier the system call to implement this was not available, and so you will see an empty span returned.
   static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<span<buffer_type>> prefetch(span<buffer_type> regions) noexcept;
   //! \overload
@@ -727,6 +891,97 @@ public:
     return *ret.data();
   }
 
+  /*! \brief Records that the region, which must lie within this map, has been modified by direct stores
+  to memory. Has no effect unless the section was created with `section_handle::flag::track_dirty`.
+
+  Writes performed using `write()` are tracked automatically. A barrier with an empty request of a map
+  of a section being tracked flushes only the regions modified since the last such barrier, which
+  for large maps with sparse modification is very much cheaper than flushing the whole map. If any
+  region cannot be tracked due to lack of memory, all barriers revert to flushing the whole map.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void mark_dirty(const_buffer_type region) noexcept;
+
+  /*! \brief Sets the NUMA placement policy of the region, moving any pages already present where the
+  system is able. New maps already receive the calling thread's `this_thread::current_numa_placement()`.
+
+  \errors Any of the values `mbind()` can return. `errc::operation_not_supported` on platforms unable to
+  change the placement of an existing region.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> set_numa_placement(buffer_type region, numa_placement placement) noexcept;
+
+  //! The state of a batch of prefetches begun by `prefetch_async()`
+  class prefetch_state
+  {
+    friend class map_handle;
+    span<buffer_type> _regions;
+    size_type _bytes{0};
+
+  public:
+    //! Default constructor
+    constexpr prefetch_state() {}  // NOLINT
+    //! The sorted and merged regions being prefetched
+    span<buffer_type> regions() const noexcept { return _regions; }
+    //! The total bytes being prefetched
+    size_type bytes() const noexcept { return _bytes; }
+    //! Returns how many of the bytes being prefetched are now resident in memory (`mincore()`, `QueryWorkingSetEx()`).
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> bytes_resident() const noexcept;
+    //! True if all the bytes being prefetched are now resident in memory.
+    result<bool> completed() const noexcept
+    {
+      OUTCOME_TRY(auto &&resident, bytes_resident());
+      return resident >= _bytes;
+    }
+  };
+  /*! \brief Ask the system to begin to asynchronously prefetch many memory regions as a single batch,
+  returning immediately with a state with which to poll for completion.
+
+  The regions are sorted by address, rounded out to page boundaries, and overlapping or adjacent regions
+  are coalesced, all in place, so `regions` is modified and the returned state refers to a prefix of it,
+  which must therefore outlive the state. The merged regions are then issued as few syscalls as possible:
+  on Linux 5.10 or later, a `process_madvise(MADV_WILLNEED)` per 1024 regions, falling back to one
+  `madvise(MADV_WILLNEED)` per region on older kernels and other POSIX; on Windows 8 or later, a single
+  `PrefetchVirtualMemory()`. On Windows 7 or earlier nothing is prefetched, but the state is still returned.
+
+  Prefetching is purely advisory, and there is no guarantee that the pages stay resident after they
+  are reported as such.
+
+  \errors Any of the values `process_madvise()`, `madvise()` or `PrefetchVirtualMemory()` can return.
+  \mallocs None.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<prefetch_state> prefetch_async(span<buffer_type> regions) noexcept;
+
+  //! Statistics about the map handle cache
+  struct cache_statistics
+  {
+    size_t items_in_cache{0};
+    size_t bytes_in_cache{0};
+    size_t items_just_trimmed{0};
+    size_t bytes_just_trimmed{0};
+    size_t hits{0};    //!< Total maps satisfied from the cache
+    size_t misses{0};  //!< Total cacheable maps which had to be allocated
+  };
+  /*! \brief Enables or disables the process-wide cache of closed anonymous maps, returning
+  the previous setting. The cache is disabled by default.
+
+  When enabled, closing a map allocated by `map(bytes)` does not return it to the system,
+  instead it is retained for reuse by a later `map(bytes)` of the same size, page size and
+  flags which did not request zeroed memory. Reused memory retains its previous contents.
+  Maps which have had pages committed or decommitted are never retained. Disabling the cache
+  releases all retained maps.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC bool set_cache_enabled(bool enabled) noexcept;
+  /*! \brief Sets the limits of the map handle cache. Retained maps closed longer ago than
+  `max_age` are released when maps are next closed, as are the oldest retained maps
+  whenever more than `max_bytes` is retained. Defaults are 64Mb and one second.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void set_cache_limits(size_t max_bytes, std::chrono::steady_clock::duration max_age) noexcept;
+  /*! \brief Releases retained maps closed before `older_than`, returning statistics about the
+  map handle cache. The default trims nothing, which simply returns statistics. Call this
+  with `std::chrono::steady_clock::now()` to release all retained maps e.g. in response to
+  system memory pressure.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC cache_statistics trim_cache(std::chrono::steady_clock::time_point older_than = {}) noexcept;
+
 #if 0
   /*! \brief Read data from the mapped view.
 
@@ -148,6 +148,11 @@ private:
     {
       static_cast<span<T> &>(*this) = detail::attach_or_reinterpret<T>::attach({addr, len});
     }
+    else
+    {
+      // Read only maps cannot be attached in place, but can still be viewed
+      static_cast<span<T> &>(*this) = {reinterpret_cast<T *>(addr), len / sizeof(T)};  // NOLINT
+    }
   }
 
 public:
@@ -189,6 +194,8 @@ public:
   const map_handle &map() const noexcept { return _maph; }
   //! Returns a span referring to this mapped region
   span<T> as_span() const noexcept { return *this; }
+  //! Makes this mapped region resident in memory using up to `threads` threads, see `map_handle::populate()`.
+  result<void> populate(size_t threads = 0) const noexcept { return _maph.populate({(byte *) this->data(), this->size_bytes()}, threads); }
 
   using span<T>::first;
   using span<T>::last;
@@ -24,6 +24,9 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "map_handle.hpp"
 
+#include <atomic>
+#include <thread>
+
 //! \file mapped_file_handle.hpp Provides mapped_file_handle
 
 #ifndef LLFIO_MAPPED_FILE_HANDLE_H
@@ -31,6 +34,56 @@ Distributed under the Boost Software License, Version 1.0.
 
 LLFIO_V2_NAMESPACE_EXPORT_BEGIN
 
+namespace detail
+{
+  /* The maps of a mapped_file_handle which concurrent readers may have pinned. Readers count
+  themselves into one of many cache line sized slots for the parity of the epoch they pinned,
+  so pinning does not contend across cores. When the map is replaced, the old map is retired
+  until no readers of its epoch remain.
+  */
+  struct mapped_file_handle_epochs
+  {
+    static constexpr size_t slots = 64;
+    struct alignas(64) slot_t
+    {
+      std::atomic<size_t> count[2];
+    };
+    std::atomic<uint64_t> epoch{0};
+    byte *address[2]{nullptr, nullptr};
+    std::atomic<size_t> length[2];
+    slot_t readers[slots];
+    map_handle retired;  // the map of the previous epoch
+
+    mapped_file_handle_epochs() noexcept
+    {
+      length[0].store(0, std::memory_order_relaxed);
+      length[1].store(0, std::memory_order_relaxed);
+      for(auto &slot : readers)
+      {
+        slot.count[0].store(0, std::memory_order_relaxed);
+        slot.count[1].store(0, std::memory_order_relaxed);
+      }
+    }
+    // The slot of the calling thread
+    static size_t slot() noexcept
+    {
+      static LLFIO_THREAD_LOCAL char marker;
+      return static_cast<size_t>(((uint64_t)(uintptr_t) &marker * 0x9e3779b97f4a7c15ULL) >> 58U);
+    }
+    // The number of readers pinning the epochs of the parity
+    size_t pinned(size_t parity) const noexcept
+    {
+      size_t ret = 0;
+      for(auto &slot : readers)
+      {
+        ret += slot.count[parity].load(std::memory_order_seq_cst);
+      }
+      return ret;
+    }
+  };
+  static_assert(mapped_file_handle_epochs::slots == 64, "slot() assumes 64 slots");
+}  // namespace detail
+
 /*! \class mapped_file_handle
 \brief A memory mapped regular file or device
 
@@ -83,7 +136,9 @@ file. This is why `read()` and `write()` only know about the reservation size, a
 and write memory up to that reservation size, without checking if the memory involved exists
 or not yet. You are guaranteed on POSIX only that `address()` will not return a new
 value unless you truncate from a bigger length to a smaller length, or you call `reserve()`
-with a new reservation or `truncate()` with a value bigger than the reservation.
+with a new reservation or `truncate()` with a value bigger than the reservation, and
+even then `reserve()` first tries to extend or shrink the existing map in place, so
+`address()` usually remains the same.
 
 `maximum_extent()` in mapped file handle is an alias for `update_map()`. `update_map()`
 fetches the maximum extent of the underlying file, and if it has changed from the map's
@@ -91,11 +146,18 @@ length, the map is updated to match the underlying file, up to the reservation l
 You can of course explicitly call `update_map()` whenever you need the map to reflect
 changes to the maximum extent of the underlying file.
 
-It is up to you to detect that the reservation has been exhausted, and to
-reserve a new reservation which will change the value returned by `address()`. This
-entirely manual system is a bit tedious and cumbersome to use, but as mapping files
-is an expensive operation given TLB shootdown, we leave it up to the end user to decide
-when to expend the cost of mapping.
+If `truncate()` grows the file past the reservation, the reservation is grown geometrically,
+doubling each time up to a growth of one Gb (16Mb on 32 bit) per step, so appending to a
+file through a mapped file handle only rarely needs to do more than extend the file. So
+long as the new length fits within the reservation, the only syscall `update_map()` makes
+is to fetch the length of the underlying file. If a third party grows the file past the
+reservation, it is up to you to detect that the reservation has been exhausted, and to
+reserve a new reservation, as mapping files is an expensive operation given TLB shootdown.
+
+Other threads may read the file whilst one thread grows it, without serialising on a mutex, by
+accessing it through `pin_map()`. This pins the current map so that it is not unmapped if the
+map is relocated, which happens when the reservation must grow and the map cannot be extended
+in place. The old map is retired, and unmapped once no pins of it remain.
 
 \warning You must be cautious when the file is being extended by third parties which are
 not using this `mapped_file_handle` to write the new data. With unified page cache kernels,
@@ -155,6 +217,80 @@ protected:
   size_type _reservation{0};
   section_handle _sh;  // Tracks the file (i.e. *this) somewhat lazily
   map_handle _mh;      // The current map with valid extent
+  std::atomic<detail::mapped_file_handle_epochs *> _epochs{nullptr};  // created with the first map
+
+  // Publishes a change in the length of the current map to readers
+  void _publish_length() noexcept
+  {
+    auto *e = _epochs.load(std::memory_order_relaxed);
+    if(e != nullptr)
+    {
+      e->length[e->epoch.load(std::memory_order_relaxed) & 1].store(_mh.length(), std::memory_order_release);
+    }
+  }
+  // Replaces the current map with newmap, retiring the current map until no readers have it pinned
+  result<void> _publish_map(map_handle &&newmap) noexcept
+  {
+    auto *e = _epochs.load(std::memory_order_relaxed);
+    if(e == nullptr)
+    {
+      e = new(std::nothrow) detail::mapped_file_handle_epochs;
+      if(e == nullptr)
+      {
+        return errc::not_enough_memory;
+      }
+      e->address[0] = newmap.address();
+      e->length[0].store(newmap.length(), std::memory_order_relaxed);
+      OUTCOME_TRYV(_mh.close());
+      _mh = std::move(newmap);
+      _epochs.store(e, std::memory_order_release);
+      return success();
+    }
+    const auto epoch = e->epoch.load(std::memory_order_relaxed);
+    const size_t next = (epoch + 1) & 1;
+    // The readers of the epoch before last must be gone before its parity can be reused
+    while(e->pinned(next) > 0)
+    {
+      std::this_thread::yield();
+    }
+    OUTCOME_TRYV(e->retired.close());
+    e->address[next] = newmap.address();
+    e->length[next].store(newmap.length(), std::memory_order_relaxed);
+    e->epoch.store(epoch + 1, std::memory_order_seq_cst);
+    e->retired = std::move(_mh);
+    _mh = std::move(newmap);
+    return success();
+  }
+  // Closes the retired map if no readers have it pinned
+  result<void> _reclaim_retired_map() noexcept
+  {
+    auto *e = _epochs.load(std::memory_order_relaxed);
+    if(e != nullptr && e->retired.is_valid() && e->pinned((e->epoch.load(std::memory_order_relaxed) + 1) & 1) == 0)
+    {
+      OUTCOME_TRYV(e->retired.close());
+    }
+    return success();
+  }
+  // Closes the retired map and releases the epochs
+  result<void> _close_epochs() noexcept
+  {
+    auto *e = _epochs.exchange(nullptr, std::memory_order_relaxed);
+    if(e != nullptr)
+    {
+      auto r = e->retired.close();
+      delete e;
+      return r;
+    }
+    return success();
+  }
+
+  // The reservation to grow to when the file is extended to newsize past the current reservation
+  size_type _grown_reservation(extent_type newsize) const noexcept
+  {
+    static constexpr size_type max_growth = (sizeof(void *) >= 8) ? ((size_type) 1 << 30U) : ((size_type) 1 << 24U);
+    const size_type ret = _reservation + std::min(_reservation, max_growth);
+    return (ret < _reservation || ret < newsize) ? (size_type) newsize : ret;
+  }
 
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC size_t _do_max_buffers() const noexcept override { return _mh.max_buffers(); }
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_barrier(io_request<const_buffers_type> reqs = io_request<const_buffers_type>(),
@@ -197,6 +333,15 @@ protected:
   }
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<buffers_type> _do_read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept override
   {
+    // Reading a single buffer is the common case, and needs no loop nor call into the map
+    if(reqs.buffers.size() == 1)
+    {
+      const extent_type length = _mh.length();
+      const size_type togo = reqs.offset < length ? static_cast<size_type>(length - reqs.offset) : 0;
+      buffer_type &req = reqs.buffers[0];
+      req = {_mh.address() + reqs.offset, (req.size() < togo) ? req.size() : togo};
+      return reqs.buffers;
+    }
     return _mh.read(reqs, d);
   }
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC io_result<const_buffers_type> _do_write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept override
@@ -242,9 +387,15 @@ public:
       , _reservation(o._reservation)
       , _sh(std::move(o._sh))
       , _mh(std::move(o._mh))
+      , _epochs(o._epochs.exchange(nullptr, std::memory_order_relaxed))
   {
     _sh.set_backing(this);
     _mh.set_section(&_sh);
+    auto *e = _epochs.load(std::memory_order_relaxed);
+    if(e != nullptr && e->retired.is_valid())
+    {
+      e->retired.set_section(&_sh);
+    }
   }
   //! No copy construction (use `clone()`)
   mapped_file_handle(const mapped_file_handle &) = delete;
@@ -431,6 +582,110 @@ public:
   //! The address in memory where this mapped file resides
   byte *address() const noexcept { return _mh.address(); }
 
+  /*! \class map_pin
+  \brief A pin of the map of a mapped file handle, which keeps the map's address valid until released.
+  */
+  class map_pin
+  {
+    friend class mapped_file_handle;
+    std::atomic<size_t> *_count{nullptr};
+    byte *_addr{nullptr};
+    size_type _length{0};
+
+    constexpr map_pin(std::atomic<size_t> *count, byte *addr, size_type length) noexcept
+        : _count(count)
+        , _addr(addr)
+        , _length(length)
+    {
+    }
+
+  public:
+    //! Default constructor
+    constexpr map_pin() {}  // NOLINT
+    //! No copy construction
+    map_pin(const map_pin &) = delete;
+    //! No copy assignment
+    map_pin &operator=(const map_pin &) = delete;
+    //! Move constructor
+    map_pin(map_pin &&o) noexcept
+        : _count(o._count)
+        , _addr(o._addr)
+        , _length(o._length)
+    {
+      o._count = nullptr;
+      o._addr = nullptr;
+      o._length = 0;
+    }
+    //! Move assignment
+    map_pin &operator=(map_pin &&o) noexcept
+    {
+      if(this == &o)
+      {
+        return *this;
+      }
+      this->~map_pin();
+      new(this) map_pin(std::move(o));
+      return *this;
+    }
+    ~map_pin() { unpin(); }
+
+    //! The address of the pinned map, which is null if the file was not mapped
+    byte *address() const noexcept { return _addr; }
+    //! The number of bytes of the pinned map valid to access when it was pinned
+    size_type length() const noexcept { return _length; }
+    //! The pinned map as a span of bytes
+    span<byte> as_span() const noexcept { return {_addr, _length}; }
+    //! Releases the pin, after which the map may be unmapped at any time
+    void unpin() noexcept
+    {
+      if(_count != nullptr)
+      {
+        _count->fetch_sub(1, std::memory_order_release);
+        _count = nullptr;
+      }
+      _addr = nullptr;
+      _length = 0;
+    }
+  };
+
+  /*! \brief Pins the current map so that, until the returned pin is released, it is not unmapped
+  even if another thread relocates the map to grow the file.
+
+  This is intended for reader threads accessing the file whilst a writer thread appends to it via
+  `truncate()`, `reserve()` or `update_map()`, without needing to serialise on a mutex. Pinning costs
+  an atomic increment of a counter shared with relatively few other threads and two atomic loads,
+  and releasing the pin an atomic decrement, so read throughput scales across cores. When the writer
+  relocates the map, the old map is retired, and is unmapped once no pins of it remain, the next
+  time the map is relocated or `update_map()` is called. A writer relocating the map twice whilst
+  pins of the original map remain waits for them to be released, so pins ought to be short lived.
+
+  Pins protect against the map being relocated, not against the file being shrunk: accessing
+  pages of a pinned map beyond the file's new length still faults. The length of the pin is the
+  length of the map when pinned, and does not reflect subsequent growth. Only one thread may
+  modify the mapped file handle at a time, as usual.
+  */
+  map_pin pin_map() const noexcept
+  {
+    auto *e = _epochs.load(std::memory_order_acquire);
+    if(e == nullptr)
+    {
+      return {};
+    }
+    auto &slot = e->readers[detail::mapped_file_handle_epochs::slot()];
+    for(;;)
+    {
+      const auto epoch = e->epoch.load(std::memory_order_acquire);
+      auto &count = slot.count[epoch & 1];
+      count.fetch_add(1, std::memory_order_seq_cst);
+      if(e->epoch.load(std::memory_order_seq_cst) == epoch)
+      {
+        return map_pin(&count, e->address[epoch & 1], e->length[epoch & 1].load(std::memory_order_acquire));
+      }
+      // The writer published a new map in between, so retry
+      count.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+
   //! The page size used by the map, in bytes.
   size_type page_size() const noexcept { return _mh.page_size(); }
 
@@ -447,7 +702,9 @@ public:
   \param reservation The number of bytes of virtual address space to reserve. Zero means reserve
   the current length of the underlying file.
 
-  Note that this is an expensive call, and `address()` may return a different value afterwards.
+  An attempt is first made to extend or shrink the existing map in place, which is cheap and
+  leaves `address()` unchanged. If that is not possible, the map is relocated or recreated,
+  which is an expensive call, and `address()` will return a different value afterwards.
   This call will fail if the underlying file has zero length.
   */
   LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_type> reserve(size_type reservation = 0) noexcept;
@@ -488,7 +745,8 @@ public:
   /*! \brief Resize the current maximum permitted extent of the mapped file to the given extent, avoiding any
   new allocation of physical storage where supported, and mapping or unmapping any new pages
   up to the reservation to reflect the new maximum extent. If the new size exceeds the reservation,
-  `reserve()` will be called to increase the reservation.
+  `reserve()` will be called to grow the reservation geometrically, so repeatedly extending a file
+  only occasionally needs to touch the map.
 
   Note that on extents based filing systems
   this will succeed even if there is insufficient free space on the storage medium. Only when
@@ -525,6 +783,42 @@ public:
     return extent.length;
   }
 
+  //! \brief Allocate storage for a region of the file, updating the map if the maximum extent was extended.
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_pair> allocate(extent_pair extent, bool keep_size = false) noexcept override
+  {
+    OUTCOME_TRY(auto &&ret, file_handle::allocate(extent, keep_size));
+    if(!keep_size)
+    {
+      OUTCOME_TRY(update_map());
+    }
+    return ret;
+  }
+
+  //! \brief Extend the file without zero filling the extension, updating the map.
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_type> extend_valid_data(extent_type newsize) noexcept override
+  {
+    OUTCOME_TRY(auto &&length, file_handle::maximum_extent());
+    if(newsize <= length)
+    {
+      return truncate(newsize);
+    }
+    OUTCOME_TRY(auto &&ret, file_handle::extend_valid_data(newsize));
+    OUTCOME_TRY(update_map());
+    return ret;
+  }
+
+  //! \brief Hints to the kernel how a region of this file will be accessed, additionally prefetching the mapped portion for `access_pattern::will_need`.
+  LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<extent_pair> advise(extent_pair extent, access_pattern pattern) noexcept override
+  {
+    OUTCOME_TRY(auto &&ret, file_handle::advise(extent, pattern));
+    if(pattern == access_pattern::will_need && _mh.is_valid() && extent.offset < _mh.length())
+    {
+      const auto bytes = (std::min)(extent.length, (extent_type) _mh.length() - extent.offset);
+      OUTCOME_TRYV(map_handle::prefetch(map_handle::buffer_type{_mh.address() + extent.offset, (size_type) bytes}));
+    }
+    return ret;
+  }
+
 
 #if 0
   /*! \brief Read data from the mapped file.
@@ -542,6 +836,26 @@ public:
   */
 #endif
   using file_handle::read;
+
+  /*! \brief Returns a copy of the `T` at `offset` into the mapped file. The copy is of a size fixed
+  at compile time, so this costs little more than dereferencing a pointer into the map.
+
+  \note As with `read()`, no attempt to trap signal raises is made.
+  \errors `errc::argument_out_of_domain` if the `T` does not lie wholly within the map.
+  \mallocs None.
+  */
+  template <class T> result<T> read_record(extent_type offset) const noexcept
+  {
+    static_assert(std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value, "T must be trivially copyable and default constructible");
+    const extent_type length = _mh.length();
+    if(offset > length || length - offset < sizeof(T))
+    {
+      return errc::argument_out_of_domain;
+    }
+    T ret;
+    memcpy(&ret, _mh.address() + offset, sizeof(T));
+    return ret;
+  }
 #if 0
   /*! \brief Write data to the mapped file.
 
@@ -568,6 +882,29 @@ public:
   */
 #endif
   using file_handle::write;
+
+  /*! \brief Writes a copy of `v` at `offset` into the mapped file using `write()`, which copies
+  records of 8, 16, 32 and 64 bytes using copies of a size fixed at compile time.
+
+  \errors `errc::argument_out_of_domain` if the `T` does not lie wholly within the map, else
+  as for `write()`.
+  \mallocs As for `write()`.
+  */
+  template <class T> result<void> write_record(extent_type offset, const T &v) noexcept
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+    const extent_type length = _mh.length();
+    if(offset > length || length - offset < sizeof(T))
+    {
+      return errc::argument_out_of_domain;
+    }
+    OUTCOME_TRY(auto &&written, write(offset, {{reinterpret_cast<const byte *>(&v), sizeof(T)}}));
+    if(written != sizeof(T))
+    {
+      return errc::argument_out_of_domain;
+    }
+    return success();
+  }
 };
 
 //! \brief Constructor for `mapped_file_handle`
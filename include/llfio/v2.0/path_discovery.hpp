@@ -93,6 +93,25 @@ namespace path_discovery
   */
   LLFIO_HEADERS_ONLY_FUNC_SPEC span<discovered_path> verified_temporary_directories() noexcept;
 
+  /*! \brief Sets a file in which `verified_temporary_directories()` persists the results of its
+  probing, so that later processes can skip most of it. Passing an empty path disables the cache,
+  which is the default.
+
+  When the file exists and was written for the same list of candidate directories and the same
+  effective user, each directory which previously verified is opened and its `st_dev` and `st_ino`
+  compared to those recorded, as are its `st_perms`, `st_uid` and `st_gid` on POSIX. If all match,
+  the recorded results are used and no test file is created, and no filing system is looked up in
+  the mount table. Otherwise the probe runs in full and the file is rewritten atomically. Directory
+  modification times are not compared, as temporary directories are modified constantly.
+
+  This must be called before the first call to `verified_temporary_directories()` for it to have
+  any effect. The file ought to be somewhere private to the user, such as a per-user cache
+  directory.
+  \mallocs Copies the path.
+  \errors This call never fails. Failure to read or write the file is treated as no cache.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void set_verified_temporary_directories_cache(filesystem::path path) noexcept;
+
   /*! \brief Returns a reference to an open handle to a verified temporary directory where files created are
   stored in a filesystem directory, usually under the current user's quota.
 
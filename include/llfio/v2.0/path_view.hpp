@@ -134,6 +134,99 @@ namespace detail
   LLFIO_HEADERS_ONLY_FUNC_SPEC wchar_t *reencode_path_to(size_t &toallocate, wchar_t *dest_buffer, size_t dest_buffer_length, const wchar_t *src_buffer, size_t src_buffer_length);
   LLFIO_HEADERS_ONLY_FUNC_SPEC wchar_t *reencode_path_to(size_t &toallocate, wchar_t *dest_buffer, size_t dest_buffer_length, const char8_t *src_buffer, size_t src_buffer_length);
   LLFIO_HEADERS_ONLY_FUNC_SPEC wchar_t *reencode_path_to(size_t &toallocate, wchar_t *dest_buffer, size_t dest_buffer_length, const char16_t *src_buffer, size_t src_buffer_length);
+
+  /* Path separator searches test eight bytes of code units per iteration using SWAR (SIMD within
+  a register), which unlike SIMD intrinsics remains usable in constant expressions. A lane is zero
+  after XORing with a separator exactly when that code unit matches, and `(x - ones) & ~x & highs`
+  is nonzero exactly when some lane is zero, so the lanes of a matching word are then tested one
+  by one to find which.
+  */
+  template <class T> struct path_separator_swar
+  {
+    static_assert(sizeof(T) <= 4, "code units must be no larger than 32 bits");
+    static constexpr size_t lanes = 8 / sizeof(T);
+    static constexpr uint64_t lane_mask = (1ULL << (8 * sizeof(T))) - 1;
+    static constexpr uint64_t ones = ~0ULL / lane_mask;
+    static constexpr uint64_t highs = ones << (8 * sizeof(T) - 1);
+    static constexpr uint64_t unit(T c) noexcept { return (uint64_t)(unsigned) (c - 0) & lane_mask; }
+    static constexpr uint64_t broadcast(uint64_t c) noexcept { return c * ones; }
+    static constexpr bool is_separator(uint64_t c) noexcept
+    {
+#ifdef _WIN32
+      return c == '/' || c == '\\';
+#else
+      return c == '/';
+#endif
+    }
+    static constexpr uint64_t load(const T *s) noexcept
+    {
+      uint64_t x = 0;
+      for(size_t n = 0; n < lanes; n++)
+      {
+        x |= unit(s[n]) << (8 * sizeof(T) * n);
+      }
+      return x;
+    }
+    static constexpr bool any_separator(uint64_t x) noexcept
+    {
+      const uint64_t a = x ^ broadcast('/');
+#ifdef _WIN32
+      const uint64_t b = x ^ broadcast('\\');
+      return 0 != ((((a - ones) & ~a) | ((b - ones) & ~b)) & highs);
+#else
+      return 0 != ((a - ones) & ~a & highs);
+#endif
+    }
+  };
+  //! Returns the index of the first path separator at or after `startidx`, or `npos`.
+  template <class T> constexpr inline size_t find_first_path_separator(const T *s, size_t length, size_t startidx) noexcept
+  {
+    using swar = path_separator_swar<T>;
+    size_t n = startidx;
+    for(; n + swar::lanes <= length; n += swar::lanes)
+    {
+      if(swar::any_separator(swar::load(s + n)))
+      {
+        break;
+      }
+    }
+    for(; n < length; n++)
+    {
+      if(swar::is_separator(swar::unit(s[n])))
+      {
+        return n;
+      }
+    }
+    return (size_t) -1;
+  }
+  //! Returns the index of the last path separator at or before `endidx`, or `npos`.
+  template <class T> constexpr inline size_t find_last_path_separator(const T *s, size_t length, size_t endidx) noexcept
+  {
+    using swar = path_separator_swar<T>;
+    if(length == 0)
+    {
+      return (size_t) -1;
+    }
+    size_t n = (endidx < length) ? (endidx + 1) : length;  // one past the last index to test
+    for(; n >= swar::lanes; n -= swar::lanes)
+    {
+      if(swar::any_separator(swar::load(s + n - swar::lanes)))
+      {
+        break;
+      }
+    }
+    for(; n > 0; n--)
+    {
+      if(swar::is_separator(swar::unit(s[n - 1])))
+      {
+        return n - 1;
+      }
+    }
+    return (size_t) -1;
+  }
+
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void *path_buffer_thread_cache_allocate(size_t bytes) noexcept;
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void path_buffer_thread_cache_release(void *p) noexcept;
   class path_view_iterator;
 }  // namespace detail
 
@@ -185,6 +278,20 @@ public:
   //! The default internal buffer size used by `c_str`.
   static constexpr size_t default_internal_buffer_size = 1024;  // 2Kb for wchar_t, 1Kb for char
 
+  /*! \brief A `c_str` deleter whose buffers are recycled by each kernel thread, so converting
+  paths too long for the internal buffer of `c_str` does not normally allocate memory.
+
+  The two argument constructor of `c_str` allocates using the static `allocate()` of its deleter
+  if it has one, so `c_str<T, recycling_deleter<T>>` needs no custom allocator. A few of the largest
+  recently released buffers are retained per kernel thread, at least 4Kb each.
+  `allocate()` returns a null pointer instead of throwing if memory is exhausted.
+  */
+  template <class T> struct recycling_deleter
+  {
+    static T *allocate(size_t length) noexcept { return static_cast<T *>(detail::path_buffer_thread_cache_allocate(length * sizeof(T))); }
+    void operator()(T *p) const noexcept { detail::path_buffer_thread_cache_release(p); }
+  };
+
 private:
   static constexpr auto _npos = string_view::npos;
   union {
@@ -293,47 +400,32 @@ private:
                                        :
                                        f(basic_string_view<char>((const char *) _bytestr, _length))));
   }
-  constexpr auto _find_first_sep(size_t startidx = 0) const noexcept
+  constexpr size_t _find_first_sep(size_t startidx = 0) const noexcept
   {
-    using LLFIO_V2_NAMESPACE::basic_string_view;
-#ifdef _WIN32
-    return _utf8 ? basic_string_view<char8_t>(_char8str, _length).find_first_of((const char8_t *) "/\\", startidx)  //
-                   :
-                   (_utf16 ? basic_string_view<char16_t>(_char16str, _length).find_first_of((const char16_t *) L"/\\", startidx)  //
-                             :
-                             (_wchar ? basic_string_view<wchar_t>(_wcharstr, _length).find_first_of(L"/\\", startidx)  //
-                                       :
-                                       basic_string_view<char>((const char *) _bytestr, _length).find_first_of((const char *) "/\\", startidx)));
-#else
-    return _utf8 ? basic_string_view<char8_t>(_char8str, _length).find(preferred_separator, startidx)  //
+#ifndef _WIN32
+    if(!_utf8 && !_utf16 && !_wchar)
+    {
+      // memchr() is already vectorised
+      return LLFIO_V2_NAMESPACE::basic_string_view<char>((const char *) _bytestr, _length).find(preferred_separator, startidx);
+    }
+#endif
+    return _utf8 ? detail::find_first_path_separator(_char8str, _length, startidx)  //
                    :
-                   (_utf16 ? basic_string_view<char16_t>(_char16str, _length).find(preferred_separator, startidx)  //
+                   (_utf16 ? detail::find_first_path_separator(_char16str, _length, startidx)  //
                              :
-                             (_wchar ? basic_string_view<wchar_t>(_wcharstr, _length).find(preferred_separator, startidx)  //
+                             (_wchar ? detail::find_first_path_separator(_wcharstr, _length, startidx)  //
                                        :
-                                       basic_string_view<char>((const char *) _bytestr, _length).find(preferred_separator, startidx)));
-#endif
+                                       detail::find_first_path_separator((const char *) _bytestr, _length, startidx)));
   }
-  constexpr auto _find_last_sep(size_t endidx = _npos) const noexcept
+  constexpr size_t _find_last_sep(size_t endidx = _npos) const noexcept
   {
-    using LLFIO_V2_NAMESPACE::basic_string_view;
-#ifdef _WIN32
-    return _utf8 ? basic_string_view<char8_t>(_char8str, _length).find_last_of((const char8_t *) "/\\", endidx)  //
+    return _utf8 ? detail::find_last_path_separator(_char8str, _length, endidx)  //
                    :
-                   (_utf16 ? basic_string_view<char16_t>(_char16str, _length).find_last_of((const char16_t *) L"/\\", endidx)  //
+                   (_utf16 ? detail::find_last_path_separator(_char16str, _length, endidx)  //
                              :
-                             (_wchar ? basic_string_view<wchar_t>(_wcharstr, _length).find_last_of(L"/\\", endidx)  //
+                             (_wchar ? detail::find_last_path_separator(_wcharstr, _length, endidx)  //
                                        :
-                                       basic_string_view<char>((const char *) _bytestr, _length).find_last_of("/\\", endidx)));
-#else
-    return _utf8 ? basic_string_view<char8_t>(_char8str, _length).rfind(preferred_separator, endidx)  //
-                   :
-                   (_utf16 ? basic_string_view<char16_t>(_char16str, _length).rfind(preferred_separator, endidx)  //
-                             :
-                             (_wchar ? basic_string_view<wchar_t>(_wcharstr, _length).rfind(preferred_separator, endidx)  //
-                                       :
-                                       basic_string_view<char>((const char *) _bytestr, _length).rfind(preferred_separator, endidx)));
-#endif
+                                       detail::find_last_path_separator((const char *) _bytestr, _length, endidx)));
   }
   LLFIO_PATH_VIEW_CONSTEXPR path_view_component _filename() const noexcept
   {
@@ -515,8 +607,9 @@ public:
 
   `c_str` contains a temporary buffer sized according to the template parameter. Output
   below that amount involves no dynamic memory allocation. Output above that amount calls
-  `operator new[]`. You can use an externally supplied larger temporary buffer to avoid
-  dynamic memory allocation in all situations.
+  `operator new[]`, unless the deleter supplies its own `allocate()`. You can use an externally
+  supplied larger temporary buffer to avoid dynamic memory allocation in all situations, or
+  `recycling_deleter` to reuse buffers per kernel thread.
   */
   LLFIO_TEMPLATE(class T = typename filesystem::path::value_type, class Deleter = std::default_delete<T[]>, size_t _internal_buffer_size = default_internal_buffer_size)
   LLFIO_TREQUIRES(LLFIO_TPRED(is_source_acceptable<T>))
@@ -745,7 +838,7 @@ public:
 #endif
     //! \overload
     c_str(path_view_component view, bool no_zero_terminate = false)
-        : c_str(view, no_zero_terminate, [](size_t length) { return new value_type[length]; })
+        : c_str(view, no_zero_terminate, [](size_t length) { return _default_allocate<Deleter>(length, 0); })
     {
     }
     ~c_str()
@@ -782,6 +875,10 @@ public:
     }
 
   private:
+    // Allocate using the deleter if it knows how, otherwise using operator new[]
+    template <class D> static auto _default_allocate(size_t length, int) -> decltype(D::allocate(length)) { return D::allocate(length); }
+    template <class D> static value_type *_default_allocate(size_t length, long) { return new value_type[length]; }
+
     bool _call_deleter{false};
     Deleter _deleter;
     // MAKE SURE this is the final item in storage, the compiler will elide the storage
@@ -1075,6 +1172,8 @@ public:
 
   //! The default internal buffer size used by `c_str`.
   static constexpr size_t default_internal_buffer_size = path_view_component::default_internal_buffer_size;  // 2Kb for wchar_t, 1Kb for char
+  //! A `c_str` deleter whose buffers are recycled by each kernel thread. See `path_view_component::recycling_deleter`.
+  template <class T> using recycling_deleter = path_view_component::recycling_deleter<T>;
 
 private:
   static constexpr auto _npos = string_view::npos;
@@ -1497,6 +1596,8 @@ public:
     {
     }
   };
+  //! A `c_str` whose buffers are recycled by each kernel thread, so converting long paths does not normally allocate memory.
+  template <class T = typename filesystem::path::value_type> using recycling_c_str = c_str<T, recycling_deleter<T>>;
 #ifdef __cpp_concepts
   template <class T, class Deleter, size_t _internal_buffer_size>
   requires(is_source_acceptable<T>)
@@ -83,6 +83,30 @@ So long as you use `path_discovery::temporary_named_pipes_directory()`
 as your base directory, you can write quite portable code between POSIX
 and Windows.
 */
+namespace detail
+{
+  // Moves data through a bounce buffer, for platforms without a splice syscall
+  inline result<size_t> pipe_handle_splice_copy(io_handle &dest, io_handle::extent_type destoffset, io_handle &src, io_handle::extent_type srcoffset, size_t bytes, deadline d) noexcept
+  {
+    byte buffer[65536];
+    io_handle::buffer_type b(buffer, (std::min)(bytes, sizeof(buffer)));
+    OUTCOME_TRY(auto &&read, src.read({{&b, 1}, srcoffset}, d));
+    size_t ret = 0;
+    for(auto &i : read)
+    {
+      io_handle::const_buffer_type cb(i.data(), i.size());
+      while(cb.size() > 0)
+      {
+        OUTCOME_TRY(auto &&written, dest.write({{&cb, 1}, destoffset + ret}, d));
+        const size_t thiswrite = written.empty() ? 0 : written[0].size();
+        cb = io_handle::const_buffer_type(cb.data() + thiswrite, cb.size() - thiswrite);
+        ret += thiswrite;
+      }
+    }
+    return ret;
+  }
+}  // namespace detail
+
 class LLFIO_DECL pipe_handle : public io_handle, public fs_handle
 {
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC const handle &_get_handle() const noexcept final { return *this; }
@@ -179,11 +203,14 @@ public:
   \param flags Any additional custom behaviours.
   \param base Handle to a base location on the filing system.
   Defaults to `path_discovery::temporary_named_pipes_directory()`.
+  \param buffer_size If not zero, the number of bytes the pipe should buffer, as per `set_buffer_size()`.
+  On Windows this only takes effect if the pipe is created, on Linux it always does, and elsewhere it is
+  ignored.
 
-  \errors Any of the values POSIX `open()`, `mkfifo()`, `NtCreateFile()` or `NtCreateNamedPipeFile()` can return.
+  \errors Any of the values POSIX `open()`, `mkfifo()`, `fcntl()`, `NtCreateFile()` or `NtCreateNamedPipeFile()` can return.
   */
   LLFIO_MAKE_FREE_FUNCTION
-  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<pipe_handle> pipe(path_view_type path, mode _mode, creation _creation, caching _caching = caching::all, flag flags = flag::none, const path_handle &base = path_discovery::temporary_named_pipes_directory()) noexcept;
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<pipe_handle> pipe(path_view_type path, mode _mode, creation _creation, caching _caching = caching::all, flag flags = flag::none, const path_handle &base = path_discovery::temporary_named_pipes_directory(), size_t buffer_size = 0) noexcept;
   /*! Convenience overload for `pipe()` creating a new named pipe if
   needed, and with read-only privileges. Unless `flag::multiplexable`
   is specified, this will block until the other end connects.
@@ -230,10 +257,110 @@ public:
   Unlike Windows' `CreatePipe()`, this function can create non-blocking
   anonymous pipes. These are truly anonymous, not just randomly named.
 
-  \errors Any of the values POSIX `pipe()` or `NtCreateNamedPipeFile()` can return.
+  If `buffer_size` is not zero, it is the number of bytes the pipe should buffer,
+  as per `set_buffer_size()`. It is ignored on platforms other than Linux and Windows.
+
+  \errors Any of the values POSIX `pipe()`, `fcntl()` or `NtCreateNamedPipeFile()` can return.
   */
   LLFIO_MAKE_FREE_FUNCTION
-  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::pair<pipe_handle, pipe_handle>> anonymous_pipe(caching _caching = caching::all, flag flags = flag::none) noexcept;
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::pair<pipe_handle, pipe_handle>> anonymous_pipe(caching _caching = caching::all, flag flags = flag::none, size_t buffer_size = 0) noexcept;
+
+  /*! Returns the number of bytes the pipe can buffer before writes block.
+
+  \errors Any of the values POSIX `fcntl()` or `NtQueryInformationFile()` can return.
+  `errc::operation_not_supported` on platforms other than Linux and Windows.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> buffer_size() const noexcept;
+  /*! Sets the number of bytes the pipe can buffer before writes block, returning the size the
+  kernel actually chose, which may be larger. A larger buffer means producers stall less often,
+  and each read can drain more at once. This is `F_SETPIPE_SZ`, which cannot exceed
+  `/proc/sys/fs/pipe-max-size` except if privileged.
+
+  \errors Any of the values POSIX `fcntl()` can return. `errc::operation_not_supported` if not
+  on Linux. On Windows the buffer size can only be chosen at pipe creation.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> set_buffer_size(size_t bytes) noexcept;
+  /*! Returns the number of bytes which can be read from the pipe right now without blocking.
+
+  \errors Any of the values POSIX `ioctl(FIONREAD)` or `NtQueryInformationFile()` can return.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> bytes_available() const noexcept;
+  /*! Reads as much as is available in the pipe right now into `buffers` with a single gather
+  read, never blocking. Buffers are trimmed to the bytes read, and any buffers beyond those
+  bytes are dropped, so the result is empty if the pipe is empty.
+
+  \errors Any of the values `bytes_available()` and `read()` can return.
+  */
+  io_result<buffers_type> drain(buffers_type buffers) noexcept
+  {
+    OUTCOME_TRY(auto &&available, bytes_available());
+    size_t n = 0;
+    for(; n < buffers.size() && available > 0; n++)
+    {
+      if(buffers[n].size() > available)
+      {
+        buffers[n] = {buffers[n].data(), available};
+      }
+      available -= buffers[n].size();
+    }
+    if(n == 0)
+    {
+      return buffers_type();
+    }
+    return read({buffers_type(buffers.data(), n), 0});
+  }
+
+  /*! \brief Moves up to `bytes` bytes from `src` into this pipe, without copying them through user space
+  where possible, returning the number of bytes moved.
+
+  `src` may be a file, socket or another pipe. If it is seekable, the bytes are read from `offset`,
+  and its file pointer is not changed. Zero is returned if `src` has reached its end.
+
+  On Linux this is `splice()`, which moves references to the page cache pages of a file into the pipe,
+  so nothing is copied. On other platforms up to 64Kb is read into a buffer and written into the pipe,
+  and if the deadline expires during the write, the bytes read will be lost.
+
+  \errors Any of the values POSIX `splice()`, `read()` and `write()` can return. `errc::not_supported`
+  if a deadline is specified and this pipe is not non-blocking.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> splice_from(io_handle &src, extent_type offset, size_t bytes, deadline d = deadline()) noexcept;
+  /*! \brief Moves up to `bytes` bytes from this pipe into `dest`, without copying them through user space
+  where possible, returning the number of bytes moved.
+
+  `dest` may be a file, socket or another pipe. If it is seekable and not append only, the bytes
+  are written at `offset`, and its file pointer is not changed. Zero is returned if the write end
+  of this pipe has been closed and no more bytes remain.
+
+  On Linux this is `splice()`. Pipe buffer pages are moved into the page cache of a file where
+  the kernel can, else copied within the kernel. On other platforms up to 64Kb is read into a buffer
+  and written into `dest`, and if the deadline expires during the write, the bytes read will be lost.
+
+  \errors Any of the values POSIX `splice()`, `read()` and `write()` can return. `errc::not_supported`
+  if a deadline is specified and this pipe is not non-blocking.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> splice_to(io_handle &dest, extent_type offset, size_t bytes, deadline d = deadline()) noexcept;
+  /*! \brief Duplicates up to `bytes` bytes from this pipe into the pipe `dest` without consuming them
+  from this pipe, returning the number of bytes duplicated.
+
+  This is `tee()` on Linux, which copies references to the pipe buffer pages, and the bytes may
+  then be moved out of this pipe with `splice_to()`. No other platform can do this.
+
+  \errors Any of the values POSIX `tee()` can return. `errc::operation_not_supported` if not on Linux.
+  `errc::not_supported` if a deadline is specified and this pipe is not non-blocking.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> tee_to(pipe_handle &dest, size_t bytes, deadline d = deadline()) noexcept;
+  /*! \brief Moves the contents of `buffers` into this pipe, without copying them through user space
+  where possible, returning the number of bytes moved.
+
+  On Linux this is `vmsplice()`, which places references to the pages of the buffers into the pipe.
+  \warning The pages are still shared with the pipe after this returns, so the buffers must not be
+  modified until the other end has consumed them, else the reader sees the modifications. On other platforms
+  this is the same as `write()`.
+
+  \errors Any of the values POSIX `vmsplice()` can return. `errc::not_supported`
+  if a deadline is specified and this pipe is not non-blocking.
+  */
+  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> splice_from(const_buffers_type buffers, deadline d = deadline()) noexcept;
 
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC ~pipe_handle() override
   {
@@ -291,7 +418,8 @@ template <> struct construct<pipe_handle>
   pipe_handle::caching _caching = pipe_handle::caching::all;
   pipe_handle::flag flags = pipe_handle::flag::none;
   const path_handle &base = path_discovery::temporary_named_pipes_directory();
-  result<pipe_handle> operator()() const noexcept { return pipe_handle::pipe(_path, _mode, _creation, _caching, flags, base); }
+  size_t buffer_size = 0;
+  result<pipe_handle> operator()() const noexcept { return pipe_handle::pipe(_path, _mode, _creation, _caching, flags, base, buffer_size); }
 };
 
 // BEGIN make_free_functions.py
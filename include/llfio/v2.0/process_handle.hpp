@@ -28,6 +28,8 @@ Distributed under the Boost Software License, Version 1.0.
 #include "path_view.hpp"
 #include "pipe_handle.hpp"
 
+#include <vector>
+
 //! \file process_handle.hpp Provides a handle to a process
 
 #ifdef _MSC_VER
@@ -69,6 +71,9 @@ protected:
     template <class T> void operator()(T *a) { delete[] reinterpret_cast<byte *>(a); }
   };
 
+  // Launches a process with an environment already marshalled for the platform's launch syscall
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> _launch_process(path_view path, span<path_view_component> args, const void *marshalled_env, flag flags) noexcept;
+
 public:
   //! Default constructor
   constexpr process_handle() {}  // NOLINT
@@ -224,12 +229,50 @@ public:
   launching child processes is always racy with respect to concurrent
   filesystem modification.
 
+  On POSIX the child is launched with `posix_spawn()`, never `fork()`, so the
+  page tables of this process are never copied, and launch costs the same no
+  matter how much memory this process has mapped. On glibc this is
+  `clone(CLONE_VM|CLONE_VFORK)`, with `POSIX_SPAWN_USEVFORK` requested on glibc
+  before 2.24, and on FreeBSD and Mac OS it is `vfork()` or a kernel primitive.
+
   \errors Any of the values POSIX `posix_spawn()` or `CreateProcess()` can return.
   */
   LLFIO_MAKE_FREE_FUNCTION
   static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<process_handle> launch_process(path_view path, span<path_view_component> args, span<path_view_component> env = *current().environment(), flag flags = flag::wait_on_close) noexcept;
   //! \overload
   static result<process_handle> launch_process(path_view path, span<path_view_component> args, flag flags = flag::wait_on_close) noexcept { return launch_process(path, args, *current().environment(), flags); }
+
+  //! A request to launch a process, as per `launch_process()`.
+  struct launch_request
+  {
+    path_view path;                   //!< The absolute path to the binary to launch.
+    span<path_view_component> args;   //!< An array of arguments to pass to the process.
+    flag flags{flag::wait_on_close};  //!< Any additional custom behaviours.
+  };
+  /*! Launches many processes which share the same environment, returning a handle
+  for each request in the same order.
+
+  The environment is fetched and marshalled once for the whole batch, rather than once
+  per process as with `launch_process()`. If any launch fails, the handles of the
+  processes already launched are closed as per their flags, and the error is returned.
+
+  \errors Any of the values `launch_process()` can return.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<std::vector<process_handle>> launch_processes(span<const launch_request> reqs, span<path_view_component> env = *current().environment()) noexcept;
+
+  /*! Waits until all of `processes` have exited, setting the corresponding item of `exitcodes`
+  to the exit code of each. `exitcodes` must be at least as long as `processes`.
+
+  On Linux a pidfd is opened for each process, and all are waited upon with a single `poll()`
+  until they have all exited, so no time is spent polling each process in turn. The same pidfds
+  could be registered with an i/o multiplexer. Elsewhere each process is waited upon in turn,
+  with the deadline shared amongst all of them.
+
+  \errors Any of the values `wait()` and POSIX `pidfd_open()` and `poll()` can return.
+  `errc::timed_out` if the deadline expires, in which case the exit codes of processes which
+  had not exited are unspecified.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> wait_all(span<const process_handle> processes, span<intptr_t> exitcodes, deadline d = {}) noexcept;
 };
 
 inline std::ostream &operator<<(std::ostream &s, const process_handle::flag &v)
@@ -0,0 +1,243 @@
+/* A pool of registered buffers shared by all handles of a multiplexer
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef LLFIO_REGISTERED_BUFFER_POOL_HPP
+#define LLFIO_REGISTERED_BUFFER_POOL_HPP
+
+#include "io_handle.hpp"
+
+#include <atomic>
+#include <memory>
+
+//! \file registered_buffer_pool.hpp Provides a pool of registered buffers shared by all handles of a multiplexer
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4251)  // dll interface
+#endif
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+/*! \class registered_buffer_pool
+\brief A pool of equally sized registered buffers, carved out of a single registered buffer
+which is registered with the i/o multiplexer only once.
+
+`io_handle::allocate_registered_buffer()` maps, and with io_uring registers, fresh memory upon
+every call. A pool instead allocates one registered buffer for all its buffers upon creation,
+after which `acquire()` is a lock-free pop from a free list which allocates no memory. The buffers
+it hands out may be used for i/o with any handle using the same multiplexer as the handle the pool
+was created with. A buffer returns to the pool when the last reference to it, including any
+`weak_ptr`, is released, and the pool lives until the last buffer acquired from it is released.
+
+With io_uring, i/o using a buffer from the pool is issued as `IORING_OP_READ_FIXED` and
+`IORING_OP_WRITE_FIXED`, using only one slot of the fixed buffer table for the whole pool.
+Other multiplexers, and handles without a multiplexer, have no concept of buffer registration,
+so the pool is then merely a cache of preallocated page aligned memory.
+*/
+class registered_buffer_pool : public std::enable_shared_from_this<registered_buffer_pool>
+{
+public:
+  using registered_buffer_type = io_handle::registered_buffer_type;
+
+private:
+  static constexpr uint32_t _npos = (uint32_t) -1;
+  struct _slot_t
+  {
+    std::atomic<uint32_t> next{_npos};
+    // Storage for the shared_ptr control block, which holds the buffer
+    alignas(std::max_align_t) byte storage[192];
+  };
+  // Allocates the control block from the slot, returning the slot to the pool upon deallocation
+  template <class T> struct _allocator
+  {
+    using value_type = T;
+    std::shared_ptr<registered_buffer_pool> pool;
+    uint32_t index;
+    _allocator(std::shared_ptr<registered_buffer_pool> _pool, uint32_t _index) noexcept
+        : pool(std::move(_pool))
+        , index(_index)
+    {
+    }
+    template <class U>
+    _allocator(const _allocator<U> &o) noexcept  // NOLINT
+        : pool(o.pool)
+        , index(o.index)
+    {
+    }
+    T *allocate(size_t n)
+    {
+      if(n * sizeof(T) <= sizeof(_slot_t::storage) && alignof(T) <= alignof(std::max_align_t))
+      {
+        return reinterpret_cast<T *>(pool->_slots[index].storage);
+      }
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t /*unused*/) noexcept
+    {
+      if(reinterpret_cast<byte *>(p) != pool->_slots[index].storage)
+      {
+        ::operator delete(p);
+      }
+      pool->_push(index);
+    }
+    template <class U> bool operator==(const _allocator<U> &o) const noexcept { return pool == o.pool && index == o.index; }
+    template <class U> bool operator!=(const _allocator<U> &o) const noexcept { return !(*this == o); }
+  };
+
+  registered_buffer_type _region;
+  size_t _buffer_size{0}, _count{0};
+  std::unique_ptr<_slot_t[]> _slots;
+  // Index of the first free slot in the bottom 32 bits, and an ABA counter in the top 32 bits
+  std::atomic<uint64_t> _head{_npos};
+  std::atomic<size_t> _available{0};
+
+  struct _private_tag
+  {
+  };
+
+  uint32_t _pop() noexcept
+  {
+    uint64_t head = _head.load(std::memory_order_acquire);
+    for(;;)
+    {
+      const auto index = static_cast<uint32_t>(head);
+      if(index == _npos)
+      {
+        return _npos;
+      }
+      const uint64_t next = ((head >> 32) + 1) << 32 | _slots[index].next.load(std::memory_order_relaxed);
+      if(_head.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        _available.fetch_sub(1, std::memory_order_relaxed);
+        return index;
+      }
+    }
+  }
+  void _push(uint32_t index) noexcept
+  {
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    for(;;)
+    {
+      _slots[index].next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+      const uint64_t next = ((head >> 32) + 1) << 32 | index;
+      if(_head.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed))
+      {
+        _available.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+public:
+  //! Use `create()` instead.
+  registered_buffer_pool(_private_tag /*unused*/, registered_buffer_type region, size_t buffer_size, size_t count)
+      : _region(std::move(region))
+      , _buffer_size(buffer_size)
+      , _count(count)
+      , _slots(new _slot_t[count])
+  {
+    for(size_t n = count; n > 0; n--)
+    {
+      _push(static_cast<uint32_t>(n - 1));
+    }
+  }
+  registered_buffer_pool(const registered_buffer_pool &) = delete;
+  registered_buffer_pool(registered_buffer_pool &&) = delete;
+  registered_buffer_pool &operator=(const registered_buffer_pool &) = delete;
+  registered_buffer_pool &operator=(registered_buffer_pool &&) = delete;
+  ~registered_buffer_pool() = default;
+
+  /*! \brief Creates a pool of `count` buffers of at least `buffer_size` bytes, registered with the
+  multiplexer of `h` if it has one.
+
+  `buffer_size` is rounded up to the page size, so every buffer is suitably aligned for
+  `caching::none` i/o.
+
+  \errors Any of the values `io_handle::allocate_registered_buffer()` can return.
+  */
+  static result<std::shared_ptr<registered_buffer_pool>> create(io_handle &h, size_t buffer_size, size_t count) noexcept
+  {
+    if(buffer_size == 0 || count == 0 || count >= _npos)
+    {
+      return errc::invalid_argument;
+    }
+    buffer_size = utils::round_up_to_page_size(buffer_size, utils::page_size());
+    size_t bytes = buffer_size * count;
+    if(bytes / count != buffer_size)
+    {
+      return errc::value_too_large;
+    }
+    OUTCOME_TRY(auto &&region, h.allocate_registered_buffer(bytes));
+    try
+    {
+      return std::make_shared<registered_buffer_pool>(_private_tag(), std::move(region), buffer_size, count);
+    }
+    catch(...)
+    {
+      return error_from_exception();
+    }
+  }
+
+  //! The size of each buffer in the pool.
+  size_t buffer_size() const noexcept { return _buffer_size; }
+  //! The number of buffers in the pool.
+  size_t size() const noexcept { return _count; }
+  //! The number of buffers currently available to `acquire()`. This is a snapshot, and may be stale by the time it is returned.
+  size_t available() const noexcept { return _available.load(std::memory_order_relaxed); }
+  //! The single registered buffer from which all buffers in the pool are carved.
+  const registered_buffer_type &region() const noexcept { return _region; }
+
+  /*! \brief Acquires a buffer from the pool, without allocating memory nor taking a lock.
+
+  \errors `errc::no_buffer_space` if every buffer in the pool is in use.
+  */
+  result<registered_buffer_type> acquire() noexcept
+  {
+    const uint32_t index = _pop();
+    if(index == _npos)
+    {
+      return errc::no_buffer_space;
+    }
+    try
+    {
+      auto ret = std::allocate_shared<io_multiplexer::_registered_buffer_type>(_allocator<byte>(shared_from_this(), index),
+                                                                               span<byte>(_region->data() + index * _buffer_size, _buffer_size));
+      ret->parent = _region;
+      return ret;
+    }
+    catch(...)
+    {
+      // If allocate_shared() threw after allocating, deallocation has already returned the slot
+      return error_from_exception();
+    }
+  }
+};
+
+LLFIO_V2_NAMESPACE_END
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#endif
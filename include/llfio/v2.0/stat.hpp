@@ -29,6 +29,7 @@ Distributed under the Boost Software License, Version 1.0.
 #error You must include the master llfio.hpp, not individual header files directly
 #endif
 #include "config.hpp"
+#include "path_view.hpp"
 
 //! \file stat.hpp Provides stat
 
@@ -40,6 +41,7 @@ Distributed under the Boost Software License, Version 1.0.
 LLFIO_V2_NAMESPACE_EXPORT_BEGIN
 
 class handle;
+class path_handle;
 
 /*! \struct stat_t
 \brief Metadata about a directory entry
@@ -109,6 +111,7 @@ struct LLFIO_DECL stat_t  // NOLINT
     compressed = 1 << 25, reparse_point = 1 << 26, all = static_cast<unsigned>(-1), none = 0
   }
   QUICKCPPLIB_BITFIELD_END(want)
+  struct fill_many_item;
   //! Constructs a UNINITIALIZED instance i.e. full of random garbage
   stat_t() {}  // NOLINT   CANNOT be constexpr because we are INTENTIONALLY not initialising the storage
   //! Constructs a zeroed instance
@@ -153,6 +156,22 @@ struct LLFIO_DECL stat_t  // NOLINT
   to detect which items were filled in, and which not (those not may be all bits zero).
   */
   LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> fill(const handle &h, want wanted = want::all) noexcept;
+  /*! \brief Fills the metadata of many leafnames relative to `base` as a single batch, without
+  opening any of them.
+
+  Each item's `stat` is filled with the metadata named by its `wanted`, and its `filled` is set to
+  the number of items filled, or to the failure to fill them (usually `errc::no_such_file_or_directory`).
+  Symbolic links are not followed. Each item's `stat` is zeroed before being filled.
+
+  On Linux, `statx()` is asked for only the fields each item wants, and with io_uring available, a
+  batch of up to 256 `statx()` are kept in flight at once, which overlaps the storage latency of
+  reading cold inodes. Elsewhere on POSIX this is a loop of `fstatat()`, and on Windows a loop of
+  opening each leafname for attribute reading and calling `fill()`.
+
+  \return An error only if the batch could not be attempted. Per item failures are placed into the
+  items.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> fill_many(const path_handle &base, span<fill_many_item> items) noexcept;
   /*! Stamps the handle with the metadata in the structure, returning the metadata written.
 
   The following want bits are always ignored, and are cleared in the want bits returned:
@@ -189,6 +208,23 @@ struct LLFIO_DECL stat_t  // NOLINT
   LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<want> stamp(handle &h, want wanted = want::all) noexcept;
 };
 
+//! An item in a batch of `stat_t::fill_many()`
+struct stat_t::fill_many_item
+{
+  path_view leafname;                                        //!< The leafname relative to the base whose metadata to fill
+  want wanted{want::all};                                    //!< The metadata wanted
+  stat_t stat{nullptr};                                      //!< The metadata filled
+  result<size_t> filled{in_place_type<size_t>, (size_t) 0};  //!< The number of items filled, or the failure to fill them
+
+  fill_many_item() = default;
+  //! Constructs an item for `_leafname` wanting `_wanted`
+  fill_many_item(path_view _leafname, want _wanted = want::all) noexcept
+      : leafname(_leafname)
+      , wanted(_wanted)
+  {
+  }
+};
+
 LLFIO_V2_NAMESPACE_END
 
 #if LLFIO_HEADERS_ONLY == 1 && !defined(DOXYGEN_SHOULD_SKIP_THIS)
@@ -74,6 +74,7 @@ struct LLFIO_DECL statfs_t
   std::string f_fstypename;                       /*!< filesystem type name               (Windows, POSIX) */
   std::string f_mntfromname;                      /*!< mounted filesystem                 (Windows, POSIX) */
   filesystem::path f_mntonname;                   /*!< directory on which mounted         (Windows, POSIX) */
+  std::chrono::steady_clock::time_point f_space_filled; /*!< when `f_bfree` and `f_bavail` were last filled by `bytes_available()` */
 
   //! Used to indicate what metadata should be filled in
   QUICKCPPLIB_BITFIELD_BEGIN(want) { flags = 1 << 0, bsize = 1 << 1, iosize = 1 << 2, blocks = 1 << 3, bfree = 1 << 4, bavail = 1 << 5, files = 1 << 6, ffree = 1 << 7, namemax = 1 << 8, owner = 1 << 9, fsid = 1 << 10, fstypename = 1 << 11, mntfromname = 1 << 12, mntonname = 1 << 13, all = static_cast<unsigned>(-1) }
@@ -92,8 +93,33 @@ struct LLFIO_DECL statfs_t
     }
   }
 #endif
-  //! Fills in the structure with metadata, returning number of items filled in
+  /*! \brief Fills in the structure with metadata, returning number of items filled in.
+
+  Items are fetched only if wanted. On Linux `flags`, `fstypename`, `mntfromname` and `mntonname`
+  require finding the filing system in the mount table, which is expensive, and so what is found
+  is cached per filing system for ten seconds. All the other items are a single `fstatfs()`.
+  */
   LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<size_t> fill(const handle &h, want wanted = want::all) noexcept;
+
+  /*! \brief Returns the bytes available to non-superusers on the filing system of `h`, refreshing
+  `f_bsize`, `f_bfree` and `f_bavail` only if they were filled by this function longer ago than
+  `max_staleness`.
+
+  A refresh is a single `fstatfs()` on POSIX, or `NtQueryVolumeInformationFile()` on Windows, so
+  this is suitable for checking free space before every large write. Passing a non-zero
+  `max_staleness` lets frequent checks reuse a recent value without any syscall at all.
+  */
+  result<uint64_t> bytes_available(const handle &h, std::chrono::steady_clock::duration max_staleness = {}) noexcept
+  {
+    const auto now = std::chrono::steady_clock::now();
+    if(max_staleness == std::chrono::steady_clock::duration() || f_space_filled == std::chrono::steady_clock::time_point() ||
+       now - f_space_filled > max_staleness)
+    {
+      OUTCOME_TRY(fill(h, want::bsize | want::bfree | want::bavail));
+      f_space_filled = now;
+    }
+    return f_bavail * f_bsize;
+  }
 };
 
 LLFIO_V2_NAMESPACE_END
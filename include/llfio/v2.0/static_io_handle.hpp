@@ -0,0 +1,181 @@
+/* Statically dispatched i/o upon a handle type
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#ifndef LLFIO_STATIC_IO_HANDLE_HPP
+#define LLFIO_STATIC_IO_HANDLE_HPP
+
+#include "io_handle.hpp"
+
+//! \file static_io_handle.hpp Provides `static_io_handle`.
+
+LLFIO_V2_NAMESPACE_EXPORT_BEGIN
+
+/*! \class static_io_handle
+\brief A handle of type `Impl` whose unmultiplexed `read()`, `write()` and `barrier()` call
+`Impl`'s implementation directly, rather than through the virtual `_do_read()`, `_do_write()`
+and `_do_barrier()`.
+
+`io_handle::read()` etc always dispatch virtually, so the compiler can never inline the
+implementation into the caller. Calling them upon a `static_io_handle<Impl>` instead binds
+to `Impl`'s implementation at compile time, which the compiler can inline. As the class is
+`final`, calls through its virtual functions upon a `static_io_handle<Impl>` reference or pointer
+can also be devirtualised. Call sites using an `io_handle` reference or pointer are unaffected,
+and still dispatch virtually to the same implementation.
+
+The combining handle adapters call their target and source handles through pointers of the
+type they were instantiated with, so instantiating them with `static_io_handle` types, and
+wrapping the adapter itself in a `static_io_handle`, statically dispatches through an entire
+stack of adapters:
+
+\code
+using target_type = static_io_handle<mapped_file_handle>;
+using source_type = static_io_handle<fast_random_file_handle>;
+target_type a(mapped_file_handle::mapped_temp_inode().value());
+source_type b(fast_random_file_handle::fast_random_file(1024).value());
+// No virtual dispatch from here down to the map of a and the generator of b
+static_io_handle<algorithm::xor_handle_adapter<target_type, source_type>> h(&a, &b);
+\endcode
+
+i/o upon a handle with an i/o multiplexer set goes via the multiplexer as usual, as does
+i/o using registered buffers, in which case `Impl`'s own `read()` etc are called. i/o
+statistics are recorded as usual if enabled.
+*/
+template <class Impl> class static_io_handle final : public Impl
+{
+  static_assert(std::is_base_of<io_handle, Impl>::value, "static_io_handle can only wrap i/o handles");
+
+public:
+  using extent_type = io_handle::extent_type;
+  using size_type = io_handle::size_type;
+  using barrier_kind = io_handle::barrier_kind;
+  using buffer_type = io_handle::buffer_type;
+  using const_buffer_type = io_handle::const_buffer_type;
+  using buffers_type = io_handle::buffers_type;
+  using const_buffers_type = io_handle::const_buffers_type;
+  template <class T> using io_request = io_handle::io_request<T>;
+  template <class T> using io_result = io_handle::io_result<T>;
+
+  //! The type whose implementation is statically dispatched to
+  using impl_type = Impl;
+
+  using Impl::Impl;
+  //! Default constructor
+  static_io_handle() = default;
+  //! Explicit conversion from the implementation, which is moved from
+  explicit static_io_handle(Impl &&o) noexcept
+      : Impl(std::move(o))
+  {
+  }
+  static_io_handle(static_io_handle &&) = default;
+  static_io_handle(const static_io_handle &) = delete;
+  static_io_handle &operator=(static_io_handle &&) = default;
+  static_io_handle &operator=(const static_io_handle &) = delete;
+  ~static_io_handle() = default;
+
+  using Impl::barrier;
+  using Impl::read;
+  using Impl::write;
+
+  //! Read data from the handle, statically dispatching to `Impl` if no multiplexer is set.
+  io_result<buffers_type> read(io_request<buffers_type> reqs, deadline d = deadline()) noexcept
+  {
+    if(this->_ctx != nullptr)
+    {
+      return Impl::read(std::move(reqs), d);
+    }
+#if LLFIO_ENABLE_IO_STATISTICS
+    return this->_with_statistics(&io_handle::io_statistics::reads, reqs, [&] { return this->Impl::_do_read(reqs, d); });
+#else
+    return this->Impl::_do_read(reqs, d);
+#endif
+  }
+  //! \overload Convenience initialiser list based overload for `read()`
+  io_result<size_type> read(extent_type offset, std::initializer_list<buffer_type> lst, deadline d = deadline()) noexcept
+  {
+    buffer_type *_reqs = reinterpret_cast<buffer_type *>(alloca(sizeof(buffer_type) * lst.size()));
+    memcpy(_reqs, lst.begin(), sizeof(buffer_type) * lst.size());
+    io_request<buffers_type> reqs(buffers_type(_reqs, lst.size()), offset);
+    auto ret = read(reqs, d);
+    if(ret)
+    {
+      return ret.bytes_transferred();
+    }
+    return std::move(ret).error();
+  }
+
+  LLFIO_DEADLINE_TRY_FOR_UNTIL(read)
+
+  //! Write data to the handle, statically dispatching to `Impl` if no multiplexer is set.
+  io_result<const_buffers_type> write(io_request<const_buffers_type> reqs, deadline d = deadline()) noexcept
+  {
+    if(this->_ctx != nullptr)
+    {
+      return Impl::write(std::move(reqs), d);
+    }
+#if LLFIO_ENABLE_IO_STATISTICS
+    return this->_with_statistics(&io_handle::io_statistics::writes, reqs, [&] { return this->Impl::_do_write(reqs, d); });
+#else
+    return this->Impl::_do_write(reqs, d);
+#endif
+  }
+  //! \overload Convenience initialiser list based overload for `write()`
+  io_result<size_type> write(extent_type offset, std::initializer_list<const_buffer_type> lst, deadline d = deadline()) noexcept
+  {
+    const_buffer_type *_reqs = reinterpret_cast<const_buffer_type *>(alloca(sizeof(const_buffer_type) * lst.size()));
+    memcpy(_reqs, lst.begin(), sizeof(const_buffer_type) * lst.size());
+    io_request<const_buffers_type> reqs(const_buffers_type(_reqs, lst.size()), offset);
+    auto ret = write(reqs, d);
+    if(ret)
+    {
+      return ret.bytes_transferred();
+    }
+    return std::move(ret).error();
+  }
+
+  LLFIO_DEADLINE_TRY_FOR_UNTIL(write)
+
+  //! Issue a write reordering barrier, statically dispatching to `Impl` if no multiplexer is set.
+  io_result<const_buffers_type> barrier(io_request<const_buffers_type> reqs = io_request<const_buffers_type>(), barrier_kind kind = barrier_kind::nowait_data_only,
+                                        deadline d = deadline()) noexcept
+  {
+    if(this->_ctx != nullptr)
+    {
+      return Impl::barrier(std::move(reqs), kind, d);
+    }
+#if LLFIO_ENABLE_IO_STATISTICS
+    return this->_with_statistics(&io_handle::io_statistics::barriers, reqs, [&] { return this->Impl::_do_barrier(reqs, kind, d); });
+#else
+    return this->Impl::_do_barrier(reqs, kind, d);
+#endif
+  }
+  //! \overload Convenience overload
+  io_result<const_buffers_type> barrier(barrier_kind kind, deadline d = deadline()) noexcept { return barrier(io_request<const_buffers_type>(), kind, d); }
+
+  LLFIO_DEADLINE_TRY_FOR_UNTIL(barrier)
+};
+
+LLFIO_V2_NAMESPACE_END
+
+#endif
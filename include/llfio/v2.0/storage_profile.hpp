@@ -26,6 +26,7 @@ Distributed under the Boost Software License, Version 1.0.
 #define LLFIO_STORAGE_PROFILE_H
 
 #include "io_handle.hpp"
+#include "mapped_file_handle.hpp"
 
 #if LLFIO_EXPERIMENTAL_STATUS_CODE
 #include "outcome/experimental/status_outcome.hpp"
@@ -39,6 +40,8 @@ template <class T> using outcome = OUTCOME_V2_NAMESPACE::outcome<T, error_info>;
 LLFIO_V2_NAMESPACE_END
 #endif
 
+#include <algorithm>
+#include <cstring>
 #include <regex>
 #include <utility>
 //! \file storage_profile.hpp Provides storage_profile
@@ -177,6 +180,8 @@ namespace storage_profile
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> cpu(storage_profile &sp, file_handle &h) noexcept;
     // System memory quantity, in use, max and min bandwidth
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> mem(storage_profile &sp, file_handle &h) noexcept;
+    // memcpy and non-temporal store bandwidth, nvram_barrier() cost, page fault and map latency
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> mem_probes(storage_profile &sp, file_handle &h) noexcept;
 #ifdef _WIN32
     namespace windows
     {
@@ -198,6 +203,8 @@ namespace storage_profile
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> device(storage_profile &sp, file_handle &h) noexcept;
     // FS name, config, size, in use
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> fs(storage_profile &sp, file_handle &h) noexcept;
+    // Device bytes written and flushes issued per caching mode for a standard write mix
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> write_amplification(storage_profile &sp, file_handle &srch) noexcept;
 #ifdef _WIN32
     namespace windows
     {
@@ -206,12 +213,17 @@ namespace storage_profile
     {
 #endif
       LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> _device(storage_profile &sp, file_handle &h, const std::string &_mntfromname, const std::string &fstypename) noexcept;
+      LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> _device_queue_limits(storage_profile &sp, file_handle &h) noexcept;
+      LLFIO_HEADERS_ONLY_FUNC_SPEC std::string _device_serial(file_handle &h) noexcept;
+      LLFIO_HEADERS_ONLY_FUNC_SPEC io_handle::extent_type _device_atomic_write_unit_max(file_handle &h) noexcept;
+      LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<std::pair<unsigned long long, unsigned long long>> _device_write_counters(file_handle &h) noexcept;
     }
   }  // namespace storage
   namespace concurrency
   {
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> atomic_rewrite_quantum(storage_profile &sp, file_handle &srch) noexcept;
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> atomic_rewrite_offset_boundary(storage_profile &sp, file_handle &srch) noexcept;
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> atomic_write_limits(storage_profile &sp, file_handle &srch) noexcept;
   }
   namespace latency
   {
@@ -222,6 +234,10 @@ namespace storage_profile
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> read_qd16(storage_profile &sp, file_handle &srch) noexcept;
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> write_qd16(storage_profile &sp, file_handle &srch) noexcept;
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> readwrite_qd4(storage_profile &sp, file_handle &srch) noexcept;
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> read_async(storage_profile &sp, file_handle &srch) noexcept;
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> write_async(storage_profile &sp, file_handle &srch) noexcept;
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> read_mmap_qd1(storage_profile &sp, file_handle &srch) noexcept;
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> mmap_crossover(storage_profile &sp, file_handle &srch) noexcept;
   }
   namespace response_time
   {
@@ -238,8 +254,157 @@ namespace storage_profile
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> traversal_cold_nonracefree_0b(storage_profile &sp, file_handle &h) noexcept;
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> traversal_cold_nonracefree_1b(storage_profile &sp, file_handle &h) noexcept;
     LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> traversal_cold_nonracefree_4k(storage_profile &sp, file_handle &h) noexcept;
+    LLFIO_HEADERS_ONLY_FUNC_SPEC outcome<void> metadata_concurrency(storage_profile &sp, file_handle &srch) noexcept;
   }  // namespace response_time
 
+  /*! \brief A storage profile in a compact binary format which is used directly from memory,
+  such as from a map of a file, without parsing, as written by `storage_profile::write_binary()`.
+
+  The format is a `header`, followed by `header::items` of `binary_item` sorted by the hash of their
+  names, followed by the label, item names and string values of the items. Finding an item by name
+  is a binary search of the hashes, so runtime tuners can read a profile at startup by mapping it,
+  with no parsing and no allocation. Only the items whose values are not default are written.
+
+  Values are in the byte order of the writer, and binary profiles of a different byte order are
+  rejected.
+  */
+  class LLFIO_DECL binary_profile
+  {
+  public:
+    //! The header of a binary profile
+    struct header
+    {
+      char magic[8];          //!< `llfiospb`
+      uint32_t byte_order;    //!< `0x01020304` in the byte order of the writer
+      uint32_t version;       //!< The format version, currently 1
+      uint32_t items;         //!< The number of items following the header
+      uint32_t label_length;  //!< The bytes of the label following the items
+      uint64_t bytes;         //!< The total bytes of the binary profile, including this header
+    };
+    //! An item in a binary profile
+    struct binary_item
+    {
+      uint64_t name_hash;     //!< The `hash_name()` of the name of the item
+      uint32_t name_offset;   //!< The offset of the name of the item from the start of the binary profile
+      uint16_t name_length;   //!< The bytes of the name of the item
+      uint8_t type;           //!< The `storage_types` of the value
+      uint8_t _reserved;      //!< Zero
+      uint64_t value;         //!< The value. Floats are in the low 32 bits. Strings are an offset in the high 32 bits and a length in the low 32 bits.
+    };
+    static_assert(sizeof(header) == 32, "");
+    static_assert(sizeof(binary_item) == 24, "");
+
+    //! The hash of an item name used to sort and find items, which is 64 bit FNV-1a.
+    static uint64_t hash_name(string_view name) noexcept
+    {
+      uint64_t ret = 0xcbf29ce484222325ULL;
+      for(char c : name)
+      {
+        ret = (ret ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+      }
+      return ret;
+    }
+    //! Returns the value of an item of type `T`, which must match the type of the item and be arithmetic.
+    template <class T> static T _decode(const binary_item &i) noexcept
+    {
+      if(std::is_floating_point<T>::value)
+      {
+        const auto bits = static_cast<uint32_t>(i.value);
+        float ret;
+        memcpy(&ret, &bits, sizeof(ret));
+        return static_cast<T>(ret);
+      }
+      return static_cast<T>(i.value);
+    }
+
+  private:
+    mapped_file_handle _mh;
+    const byte *_data{nullptr};
+
+  public:
+    //! Default constructor, an empty binary profile
+    binary_profile() = default;
+
+    /*! \brief Returns a binary profile viewing `data`, which must be eight byte aligned and
+    must outlive the binary profile, having validated it.
+
+    Validation checks the header, and that all the items refer to within `data`, so that no
+    later use of the binary profile can read out of bounds.
+    \errors `errc::invalid_argument` if `data` is not eight byte aligned. `errc::illegal_byte_sequence`
+    if `data` is not a binary profile, or is of a different byte order, version or size.
+    */
+    static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<binary_profile> view(span<const byte> data) noexcept;
+    /*! \brief Returns a binary profile viewing a read only map of the file `path` relative to `base`.
+    \errors Any of the values `mapped_file_handle::mapped_file()` or `view()` can return.
+    */
+    static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<binary_profile> open(const path_handle &base, mapped_file_handle::path_view_type path) noexcept;
+
+    //! True if the binary profile has no items
+    bool empty() const noexcept { return items().empty(); }
+    //! The items of the binary profile, sorted by the hash of their names
+    span<const binary_item> items() const noexcept
+    {
+      if(_data == nullptr)
+      {
+        return {};
+      }
+      return {reinterpret_cast<const binary_item *>(_data + sizeof(header)), reinterpret_cast<const header *>(_data)->items};
+    }
+    //! The label the binary profile was written with, such as a host or device name
+    string_view label() const noexcept
+    {
+      if(_data == nullptr)
+      {
+        return {};
+      }
+      const auto *h = reinterpret_cast<const header *>(_data);
+      return {reinterpret_cast<const char *>(_data + sizeof(header) + h->items * sizeof(binary_item)), h->label_length};
+    }
+    //! The name of an item
+    string_view name(const binary_item &i) const noexcept { return {reinterpret_cast<const char *>(_data + i.name_offset), i.name_length}; }
+    //! The value of a string item, which is empty if the item is not a string
+    string_view string_value(const binary_item &i) const noexcept
+    {
+      if(i.type != static_cast<uint8_t>(storage_types::string))
+      {
+        return {};
+      }
+      return {reinterpret_cast<const char *>(_data + (i.value >> 32)), static_cast<size_t>(i.value & 0xffffffff)};
+    }
+    //! Finds the item named `name`, returning null if there is none.
+    const binary_item *find(string_view name) const noexcept
+    {
+      const auto its = items();
+      const uint64_t hash = hash_name(name);
+      auto it = std::lower_bound(its.begin(), its.end(), hash, [](const binary_item &i, uint64_t h) { return i.name_hash < h; });
+      for(; it != its.end() && it->name_hash == hash; ++it)
+      {
+        if(this->name(*it) == name)
+        {
+          return &*it;
+        }
+      }
+      return nullptr;
+    }
+    //! Returns the value of the item named `name`, or `default_value<T>()` if there is none of type `T`.
+    template <class T> T value(string_view name) const noexcept
+    {
+      static_assert(std::is_arithmetic<T>::value, "Use string_value() for strings");
+      const auto *i = find(name);
+      if(i == nullptr || i->type != static_cast<uint8_t>(map_to_storage_type<T>()))
+      {
+        return default_value<T>();
+      }
+      return _decode<T>(*i);
+    }
+    //! Returns the value of the string item named `name`, which is empty if there is none.
+    string_view string_value(string_view name) const noexcept
+    {
+      const auto *i = find(name);
+      return (i == nullptr) ? string_view() : string_value(*i);
+    }
+  };
+
   //! A (possibly incomplet) profile of storage
   struct LLFIO_DECL storage_profile
   {
@@ -284,6 +449,12 @@ namespace storage_profile
     LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void read(std::istream &in, std::regex which = std::regex(".*"));
     //! Write the matching items from storage profile as YAML to out with the given indentation
     LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void write(std::ostream &out, const std::regex &which = std::regex(".*"), size_t _indent = 0, bool invert_match = false) const;
+    //! Read the items of the binary profile into the storage profile, ignoring any unknown
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void read(const binary_profile &in);
+    //! Read the matching items of the binary profile into the storage profile, ignoring any unknown
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void read(const binary_profile &in, const std::regex &which);
+    //! Write the matching items from storage profile in the format of `binary_profile` to out, labelled with `label`
+    LLFIO_HEADERS_ONLY_MEMFUNC_SPEC void write_binary(std::ostream &out, string_view label = {}, const std::regex &which = std::regex(".*"), bool invert_match = false) const;
 
     // System characteristics
     item<std::string> os_name = {"system:os:name", &system::os};                     // e.g. Microsoft Windows NT
@@ -295,6 +466,16 @@ namespace storage_profile
     item<unsigned long long> mem_min_bandwidth = {"system:mem:min_bandwidth", system::mem, "Main memory bandwidth when 4Kb pages are accessed randomly (1 CPU core)"};
     item<unsigned long long> mem_quantity = {"system:mem:quantity", &system::mem};
     item<float> mem_in_use = {"system:mem:in_use", &system::mem};  // not including caches etc.
+    item<unsigned long long> mem_memcpy_bandwidth = {"system:mem:memcpy_bandwidth", system::mem_probes, "Bytes per second copied by memcpy() between buffers much larger than the CPU caches (1 CPU core)"};
+    item<unsigned long long> mem_memcpy_bandwidth_all_cores = {"system:mem:memcpy_bandwidth_all_cores", system::mem_probes, "Bytes per second copied by memcpy() by all CPU cores concurrently, each with its own buffers"};
+    item<unsigned long long> mem_nontemporal_bandwidth = {"system:mem:nontemporal_bandwidth", system::mem_probes,
+                                                          "Bytes per second written by stores which bypass the CPU caches (1 CPU core), or by memset() on CPUs without them"};
+    item<unsigned long long> mem_nvram_barrier_64b = {"system:mem:nvram_barrier:64b", system::mem_probes, "Nanoseconds for nvram_barrier() of 64 freshly written bytes"};
+    item<unsigned long long> mem_nvram_barrier_4Kb = {"system:mem:nvram_barrier:4Kb", system::mem_probes, "Nanoseconds for nvram_barrier() of 4Kb of freshly written bytes"};
+    item<unsigned long long> mem_nvram_barrier_64Kb = {"system:mem:nvram_barrier:64Kb", system::mem_probes, "Nanoseconds for nvram_barrier() of 64Kb of freshly written bytes"};
+    item<unsigned long long> mem_nvram_barrier_1Mb = {"system:mem:nvram_barrier:1Mb", system::mem_probes, "Nanoseconds for nvram_barrier() of 1Mb of freshly written bytes"};
+    item<unsigned long long> mem_page_fault = {"system:mem:ns_page_fault", system::mem_probes, "Nanoseconds to fault in a page of freshly mapped memory upon first touch"};
+    item<unsigned long long> mem_map_first_touch = {"system:mem:ns_map_first_touch", system::mem_probes, "Nanoseconds to map_handle::map() 64Kb of memory and touch its first page"};
     item<unsigned> clock_granularity = {"system:timer:ns_per_tick", &system::clock_granularity};
     item<unsigned> clock_overhead = {"system:timer:ns_overhead", &system::clock_granularity};
     item<unsigned> yield_overhead = {"system:scheduler:ns_yield", &system::yield_overhead, "Nanoseconds to context switch a thread"};
@@ -310,6 +491,18 @@ namespace storage_profile
     item<std::string> device_name = {"storage:device:name", &storage::device};             // e.g. WDC WD30EFRX-68EUZN0
     item<unsigned> device_min_io_size = {"storage:device:min_io_size", &storage::device};  // e.g. 4096
     item<io_handle::extent_type> device_size = {"storage:device:size", &storage::device};
+    item<unsigned> device_physical_block_size = {"storage:device:physical_block_size", &storage::device, "The smallest unit the device can write without a read-modify-write"};
+    item<unsigned> device_minimum_io_size = {"storage:device:minimum_io_size", &storage::device,
+                                             "The preferred minimum i/o size of the device, which for RAID is the chunk size, and writes of less incur a read-modify-write"};
+    item<unsigned> device_optimal_io_size = {"storage:device:optimal_io_size", &storage::device,
+                                             "The preferred i/o size of the device if it reports one, which for RAID is the stripe width, so writes aligned to stripe boundaries avoid read-modify-write"};
+    item<unsigned> device_rotational = {"storage:device:rotational", &storage::device, "One if the device incurs a seek penalty, zero if not"};
+    item<std::string> device_zoned = {"storage:device:zoned", &storage::device, "The zoned model of the device, one of none, host-aware or host-managed"};
+    item<io_handle::extent_type> device_zone_size = {"storage:device:zone_size", &storage::device, "The bytes in each zone of a zoned device"};
+    item<unsigned> device_zones = {"storage:device:zones", &storage::device, "The number of zones of a zoned device"};
+    item<unsigned> device_max_open_zones = {"storage:device:max_open_zones", &storage::device, "The maximum zones of a zoned device which may be open for writing at once, zero if unlimited"};
+    item<unsigned> device_max_active_zones = {"storage:device:max_active_zones", &storage::device, "The maximum zones of a zoned device which may be open or closed but not full at once, zero if unlimited"};
+    item<unsigned> device_zone_append_max = {"storage:device:zone_append_max", &storage::device, "The maximum bytes of a single zone append to a zoned device"};
 
     // Filing system characteristics
     item<std::string> fs_name = {"storage:fs:name", &storage::fs};
@@ -318,6 +511,22 @@ namespace storage_profile
     item<io_handle::extent_type> fs_size = {"storage:fs:size", &storage::fs};
     item<float> fs_in_use = {"storage:fs:in_use", &storage::fs};
 
+    // Write amplification of each caching mode, measured by the block device's counters
+    item<float> write_amplification_all = {"storage:write_amplification:all:bytes", storage::write_amplification, "Bytes written to the device per byte written by the standard write mix with caching::all"};
+    item<unsigned long long> write_flushes_all = {"storage:write_amplification:all:flushes", storage::write_amplification, "Cache flushes issued to the device by the standard write mix with caching::all"};
+    item<float> write_amplification_only_metadata = {"storage:write_amplification:only_metadata:bytes", storage::write_amplification, "Bytes written to the device per byte written by the standard write mix with caching::only_metadata"};
+    item<unsigned long long> write_flushes_only_metadata = {"storage:write_amplification:only_metadata:flushes", storage::write_amplification, "Cache flushes issued to the device by the standard write mix with caching::only_metadata"};
+    item<float> write_amplification_reads = {"storage:write_amplification:reads:bytes", storage::write_amplification, "Bytes written to the device per byte written by the standard write mix with caching::reads"};
+    item<unsigned long long> write_flushes_reads = {"storage:write_amplification:reads:flushes", storage::write_amplification, "Cache flushes issued to the device by the standard write mix with caching::reads"};
+    item<float> write_amplification_reads_and_metadata = {"storage:write_amplification:reads_and_metadata:bytes", storage::write_amplification, "Bytes written to the device per byte written by the standard write mix with caching::reads_and_metadata"};
+    item<unsigned long long> write_flushes_reads_and_metadata = {"storage:write_amplification:reads_and_metadata:flushes", storage::write_amplification, "Cache flushes issued to the device by the standard write mix with caching::reads_and_metadata"};
+    item<float> write_amplification_none = {"storage:write_amplification:none:bytes", storage::write_amplification, "Bytes written to the device per byte written by the standard write mix with caching::none"};
+    item<unsigned long long> write_flushes_none = {"storage:write_amplification:none:flushes", storage::write_amplification, "Cache flushes issued to the device by the standard write mix with caching::none"};
+    item<float> write_amplification_safety_barriers = {"storage:write_amplification:safety_barriers:bytes", storage::write_amplification, "Bytes written to the device per byte written by the standard write mix with caching::safety_barriers"};
+    item<unsigned long long> write_flushes_safety_barriers = {"storage:write_amplification:safety_barriers:flushes", storage::write_amplification, "Cache flushes issued to the device by the standard write mix with caching::safety_barriers"};
+    item<float> write_amplification_temporary = {"storage:write_amplification:temporary:bytes", storage::write_amplification, "Bytes written to the device per byte written by the standard write mix with caching::temporary"};
+    item<unsigned long long> write_flushes_temporary = {"storage:write_amplification:temporary:flushes", storage::write_amplification, "Cache flushes issued to the device by the standard write mix with caching::temporary"};
+
     // Test results on this filing system, storage and system
     item<io_handle::extent_type> atomic_rewrite_quantum = {"concurrency:atomic_rewrite_quantum", concurrency::atomic_rewrite_quantum, "The i/o modify quantum guaranteed to be atomically visible to readers irrespective of rewrite quantity"};
     item<io_handle::extent_type> max_aligned_atomic_rewrite = {"concurrency:max_aligned_atomic_rewrite", concurrency::atomic_rewrite_quantum,
@@ -330,6 +539,14 @@ namespace storage_profile
                                                                                                                                                                "an i/o straddles a 4096 file offset multiple and DMA suddenly goes into many 64 byte cache lines :(, so if "
                                                                                                                                                                "this value is less than max_aligned_atomic_rewrite and some multiple of the CPU cache line size then this is "
                                                                                                                                                                "what has happened."};
+    item<io_handle::extent_type> kernel_atomic_write_unit_min = {"concurrency:kernel_atomic_write_unit_min", concurrency::atomic_write_limits,
+                                                                  "The minimum length of a write_flag::atomic write, which is never seen torn even after power loss, or zero if the kernel does not support atomic writes for this handle"};
+    item<io_handle::extent_type> kernel_atomic_write_unit_max = {"concurrency:kernel_atomic_write_unit_max", concurrency::atomic_write_limits,
+                                                                  "The maximum length of a write_flag::atomic write, which is never seen torn even after power loss, or zero if the kernel does not support atomic writes for this handle"};
+    item<unsigned> kernel_atomic_write_segments_max = {"concurrency:kernel_atomic_write_segments_max", concurrency::atomic_write_limits,
+                                                       "The maximum number of buffers in a write_flag::atomic write, or zero if the kernel does not support atomic writes for this handle"};
+    item<io_handle::extent_type> device_atomic_write_unit_max = {"concurrency:device_atomic_write_unit_max", concurrency::atomic_write_limits,
+                                                                  "The maximum length of a write which the device guarantees is never torn by power loss (e.g. the NVMe AWUPF), or zero if unknown"};
     item<unsigned> read_nothing = {"latency:read:nothing", latency::read_nothing, "The nanoseconds to read zero bytes"};
 
     item<unsigned long long> read_qd1_min = {"latency:read:qd1:min", latency::read_qd1, "The nanoseconds to read 4Kb at a queue depth of 1 (min)"};
@@ -338,7 +555,9 @@ namespace storage_profile
     item<unsigned long long> read_qd1_50 = {"latency:read:qd1:50%", latency::read_qd1, "The nanoseconds to read 4Kb at a queue depth of 1 (50% of the time)"};
     item<unsigned long long> read_qd1_95 = {"latency:read:qd1:95%", latency::read_qd1, "The nanoseconds to read 4Kb at a queue depth of 1 (95% of the time)"};
     item<unsigned long long> read_qd1_99 = {"latency:read:qd1:99%", latency::read_qd1, "The nanoseconds to read 4Kb at a queue depth of 1 (99% of the time)"};
+    item<unsigned long long> read_qd1_999 = {"latency:read:qd1:99.9%", latency::read_qd1, "The nanoseconds to read 4Kb at a queue depth of 1 (99.9% of the time)"};
     item<unsigned long long> read_qd1_99999 = {"latency:read:qd1:99.999%", latency::read_qd1, "The nanoseconds to read 4Kb at a queue depth of 1 (99.999% of the time)"};
+    item<std::string> read_qd1_histogram = {"latency:read:qd1:histogram", latency::read_qd1, "Histogram of the nanoseconds to read 4Kb at a queue depth of 1, as space separated pairs of log bucket lower bound:count"};
 
     item<unsigned long long> read_qd16_min = {"latency:read:qd16:min", latency::read_qd16, "The nanoseconds to read 4Kb at a queue depth of 16 (min)"};
     item<unsigned long long> read_qd16_mean = {"latency:read:qd16:mean", latency::read_qd16, "The nanoseconds to read 4Kb at a queue depth of 16 (arithmetic mean)"};
@@ -346,7 +565,9 @@ namespace storage_profile
     item<unsigned long long> read_qd16_50 = {"latency:read:qd16:50%", latency::read_qd16, "The nanoseconds to read 4Kb at a queue depth of 16 (50% of the time)"};
     item<unsigned long long> read_qd16_95 = {"latency:read:qd16:95%", latency::read_qd16, "The nanoseconds to read 4Kb at a queue depth of 16 (95% of the time)"};
     item<unsigned long long> read_qd16_99 = {"latency:read:qd16:99%", latency::read_qd16, "The nanoseconds to read 4Kb at a queue depth of 16 (99% of the time)"};
+    item<unsigned long long> read_qd16_999 = {"latency:read:qd16:99.9%", latency::read_qd16, "The nanoseconds to read 4Kb at a queue depth of 16 (99.9% of the time)"};
     item<unsigned long long> read_qd16_99999 = {"latency:read:qd16:99.999%", latency::read_qd16, "The nanoseconds to read 4Kb at a queue depth of 16 (99.999% of the time)"};
+    item<std::string> read_qd16_histogram = {"latency:read:qd16:histogram", latency::read_qd16, "Histogram of the nanoseconds to read 4Kb at a queue depth of 16, as space separated pairs of log bucket lower bound:count"};
 
     item<unsigned> write_nothing = {"latency:write:nothing", latency::write_nothing, "The nanoseconds to write zero bytes"};
 
@@ -356,7 +577,9 @@ namespace storage_profile
     item<unsigned long long> write_qd1_50 = {"latency:write:qd1:50%", latency::write_qd1, "The nanoseconds to write 4Kb at a queue depth of 1 (50% of the time)"};
     item<unsigned long long> write_qd1_95 = {"latency:write:qd1:95%", latency::write_qd1, "The nanoseconds to write 4Kb at a queue depth of 1 (95% of the time)"};
     item<unsigned long long> write_qd1_99 = {"latency:write:qd1:99%", latency::write_qd1, "The nanoseconds to write 4Kb at a queue depth of 1 (99% of the time)"};
+    item<unsigned long long> write_qd1_999 = {"latency:write:qd1:99.9%", latency::write_qd1, "The nanoseconds to write 4Kb at a queue depth of 1 (99.9% of the time)"};
     item<unsigned long long> write_qd1_99999 = {"latency:write:qd1:99.999%", latency::write_qd1, "The nanoseconds to write 4Kb at a queue depth of 1 (99.999% of the time)"};
+    item<std::string> write_qd1_histogram = {"latency:write:qd1:histogram", latency::write_qd1, "Histogram of the nanoseconds to write 4Kb at a queue depth of 1, as space separated pairs of log bucket lower bound:count"};
 
     item<unsigned long long> write_qd16_min = {"latency:write:qd16:min", latency::write_qd16, "The nanoseconds to write 4Kb at a queue depth of 16 (min)"};
     item<unsigned long long> write_qd16_mean = {"latency:write:qd16:mean", latency::write_qd16, "The nanoseconds to write 4Kb at a queue depth of 16 (arithmetic mean)"};
@@ -364,7 +587,9 @@ namespace storage_profile
     item<unsigned long long> write_qd16_50 = {"latency:write:qd16:50%", latency::write_qd16, "The nanoseconds to write 4Kb at a queue depth of 16 (50% of the time)"};
     item<unsigned long long> write_qd16_95 = {"latency:write:qd16:95%", latency::write_qd16, "The nanoseconds to write 4Kb at a queue depth of 16 (95% of the time)"};
     item<unsigned long long> write_qd16_99 = {"latency:write:qd16:99%", latency::write_qd16, "The nanoseconds to write 4Kb at a queue depth of 16 (99% of the time)"};
+    item<unsigned long long> write_qd16_999 = {"latency:write:qd16:99.9%", latency::write_qd16, "The nanoseconds to write 4Kb at a queue depth of 16 (99.9% of the time)"};
     item<unsigned long long> write_qd16_99999 = {"latency:write:qd16:99.999%", latency::write_qd16, "The nanoseconds to write 4Kb at a queue depth of 16 (99.999% of the time)"};
+    item<std::string> write_qd16_histogram = {"latency:write:qd16:histogram", latency::write_qd16, "Histogram of the nanoseconds to write 4Kb at a queue depth of 16, as space separated pairs of log bucket lower bound:count"};
 
     item<unsigned long long> readwrite_qd4_min = {"latency:readwrite:qd4:min", latency::readwrite_qd4, "The nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4 (min)"};
     item<unsigned long long> readwrite_qd4_mean = {"latency:readwrite:qd4:mean", latency::readwrite_qd4, "The nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4 (arithmetic mean)"};
@@ -372,7 +597,119 @@ namespace storage_profile
     item<unsigned long long> readwrite_qd4_50 = {"latency:readwrite:qd4:50%", latency::readwrite_qd4, "The nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4 (50% of the time)"};
     item<unsigned long long> readwrite_qd4_95 = {"latency:readwrite:qd4:95%", latency::readwrite_qd4, "The nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4 (95% of the time)"};
     item<unsigned long long> readwrite_qd4_99 = {"latency:readwrite:qd4:99%", latency::readwrite_qd4, "The nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4 (99% of the time)"};
+    item<unsigned long long> readwrite_qd4_999 = {"latency:readwrite:qd4:99.9%", latency::readwrite_qd4, "The nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4 (99.9% of the time)"};
     item<unsigned long long> readwrite_qd4_99999 = {"latency:readwrite:qd4:99.999%", latency::readwrite_qd4, "The nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4 (99.999% of the time)"};
+    item<std::string> readwrite_qd4_histogram = {"latency:readwrite:qd4:histogram", latency::readwrite_qd4, "Histogram of the nanoseconds to 75% read 25% write 4Kb at a total queue depth of 4, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> read_mmap_qd1_mean = {"latency:read:mmap:qd1:mean", latency::read_mmap_qd1, "The nanoseconds to copy 4Kb out of a memory map of the file at a queue depth of 1 (arithmetic mean)"};
+    item<unsigned long long> read_mmap_qd1_50 = {"latency:read:mmap:qd1:50%", latency::read_mmap_qd1, "The nanoseconds to copy 4Kb out of a memory map of the file at a queue depth of 1 (50% of the time)"};
+    item<unsigned long long> read_mmap_qd1_95 = {"latency:read:mmap:qd1:95%", latency::read_mmap_qd1, "The nanoseconds to copy 4Kb out of a memory map of the file at a queue depth of 1 (95% of the time)"};
+    item<unsigned long long> read_mmap_qd1_99 = {"latency:read:mmap:qd1:99%", latency::read_mmap_qd1, "The nanoseconds to copy 4Kb out of a memory map of the file at a queue depth of 1 (99% of the time)"};
+    item<unsigned long long> read_mmap_qd1_999 = {"latency:read:mmap:qd1:99.9%", latency::read_mmap_qd1, "The nanoseconds to copy 4Kb out of a memory map of the file at a queue depth of 1 (99.9% of the time)"};
+    item<unsigned long long> read_mmap_qd1_99999 = {"latency:read:mmap:qd1:99.999%", latency::read_mmap_qd1, "The nanoseconds to copy 4Kb out of a memory map of the file at a queue depth of 1 (99.999% of the time)"};
+    item<std::string> read_mmap_qd1_histogram = {"latency:read:mmap:qd1:histogram", latency::read_mmap_qd1, "Histogram of the nanoseconds to copy 4Kb out of a memory map of the file at a queue depth of 1, as space separated pairs of log bucket lower bound:count"};
+    item<io_handle::extent_type> mmap_crossover_random_warm = {"latency:read:mmap_crossover:random:warm", latency::mmap_crossover,
+                                                                  "The smallest request size from which mapping the region requested, copying out of the map and unmapping it is never slower than read() for random "
+                                                                  "requests on a warm cache, or zero if read() was faster at the largest size measured"};
+    item<io_handle::extent_type> mmap_crossover_random_cold = {"latency:read:mmap_crossover:random:cold", latency::mmap_crossover,
+                                                                  "The smallest request size from which mapping the region requested, copying out of the map and unmapping it is never slower than read() for random "
+                                                                  "requests on a cold cache, or zero if read() was faster at the largest size measured"};
+    item<io_handle::extent_type> mmap_crossover_sequential_warm = {"latency:read:mmap_crossover:sequential:warm", latency::mmap_crossover,
+                                                                  "The smallest request size from which mapping the region requested, copying out of the map and unmapping it is never slower than read() for sequential "
+                                                                  "requests on a warm cache, or zero if read() was faster at the largest size measured"};
+    item<io_handle::extent_type> mmap_crossover_sequential_cold = {"latency:read:mmap_crossover:sequential:cold", latency::mmap_crossover,
+                                                                  "The smallest request size from which mapping the region requested, copying out of the map and unmapping it is never slower than read() for sequential "
+                                                                  "requests on a cold cache, or zero if read() was faster at the largest size measured"};
+
+    item<unsigned long long> read_async_qd1_iops = {"latency:read:async:qd1:iops", latency::read_async, "The 4Kb reads per second completed at a queue depth of 1 using an i/o multiplexer"};
+    item<unsigned long long> read_async_qd1_mean = {"latency:read:async:qd1:mean", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 1 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> read_async_qd1_50 = {"latency:read:async:qd1:50%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 1 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> read_async_qd1_95 = {"latency:read:async:qd1:95%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 1 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> read_async_qd1_99 = {"latency:read:async:qd1:99%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 1 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> read_async_qd1_999 = {"latency:read:async:qd1:99.9%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 1 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> read_async_qd1_99999 = {"latency:read:async:qd1:99.999%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 1 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> read_async_qd1_histogram = {"latency:read:async:qd1:histogram", latency::read_async, "Histogram of the nanoseconds to read 4Kb at a queue depth of 1 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> read_async_qd4_iops = {"latency:read:async:qd4:iops", latency::read_async, "The 4Kb reads per second completed at a queue depth of 4 using an i/o multiplexer"};
+    item<unsigned long long> read_async_qd4_mean = {"latency:read:async:qd4:mean", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 4 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> read_async_qd4_50 = {"latency:read:async:qd4:50%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 4 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> read_async_qd4_95 = {"latency:read:async:qd4:95%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 4 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> read_async_qd4_99 = {"latency:read:async:qd4:99%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 4 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> read_async_qd4_999 = {"latency:read:async:qd4:99.9%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 4 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> read_async_qd4_99999 = {"latency:read:async:qd4:99.999%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 4 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> read_async_qd4_histogram = {"latency:read:async:qd4:histogram", latency::read_async, "Histogram of the nanoseconds to read 4Kb at a queue depth of 4 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> read_async_qd16_iops = {"latency:read:async:qd16:iops", latency::read_async, "The 4Kb reads per second completed at a queue depth of 16 using an i/o multiplexer"};
+    item<unsigned long long> read_async_qd16_mean = {"latency:read:async:qd16:mean", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 16 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> read_async_qd16_50 = {"latency:read:async:qd16:50%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 16 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> read_async_qd16_95 = {"latency:read:async:qd16:95%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 16 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> read_async_qd16_99 = {"latency:read:async:qd16:99%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 16 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> read_async_qd16_999 = {"latency:read:async:qd16:99.9%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 16 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> read_async_qd16_99999 = {"latency:read:async:qd16:99.999%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 16 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> read_async_qd16_histogram = {"latency:read:async:qd16:histogram", latency::read_async, "Histogram of the nanoseconds to read 4Kb at a queue depth of 16 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> read_async_qd64_iops = {"latency:read:async:qd64:iops", latency::read_async, "The 4Kb reads per second completed at a queue depth of 64 using an i/o multiplexer"};
+    item<unsigned long long> read_async_qd64_mean = {"latency:read:async:qd64:mean", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 64 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> read_async_qd64_50 = {"latency:read:async:qd64:50%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 64 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> read_async_qd64_95 = {"latency:read:async:qd64:95%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 64 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> read_async_qd64_99 = {"latency:read:async:qd64:99%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 64 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> read_async_qd64_999 = {"latency:read:async:qd64:99.9%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 64 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> read_async_qd64_99999 = {"latency:read:async:qd64:99.999%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 64 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> read_async_qd64_histogram = {"latency:read:async:qd64:histogram", latency::read_async, "Histogram of the nanoseconds to read 4Kb at a queue depth of 64 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> read_async_qd256_iops = {"latency:read:async:qd256:iops", latency::read_async, "The 4Kb reads per second completed at a queue depth of 256 using an i/o multiplexer"};
+    item<unsigned long long> read_async_qd256_mean = {"latency:read:async:qd256:mean", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 256 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> read_async_qd256_50 = {"latency:read:async:qd256:50%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 256 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> read_async_qd256_95 = {"latency:read:async:qd256:95%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 256 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> read_async_qd256_99 = {"latency:read:async:qd256:99%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 256 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> read_async_qd256_999 = {"latency:read:async:qd256:99.9%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 256 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> read_async_qd256_99999 = {"latency:read:async:qd256:99.999%", latency::read_async, "The nanoseconds to read 4Kb at a queue depth of 256 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> read_async_qd256_histogram = {"latency:read:async:qd256:histogram", latency::read_async, "Histogram of the nanoseconds to read 4Kb at a queue depth of 256 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> write_async_qd1_iops = {"latency:write:async:qd1:iops", latency::write_async, "The 4Kb writes per second completed at a queue depth of 1 using an i/o multiplexer"};
+    item<unsigned long long> write_async_qd1_mean = {"latency:write:async:qd1:mean", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 1 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> write_async_qd1_50 = {"latency:write:async:qd1:50%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 1 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> write_async_qd1_95 = {"latency:write:async:qd1:95%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 1 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> write_async_qd1_99 = {"latency:write:async:qd1:99%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 1 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> write_async_qd1_999 = {"latency:write:async:qd1:99.9%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 1 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> write_async_qd1_99999 = {"latency:write:async:qd1:99.999%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 1 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> write_async_qd1_histogram = {"latency:write:async:qd1:histogram", latency::write_async, "Histogram of the nanoseconds to write 4Kb at a queue depth of 1 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> write_async_qd4_iops = {"latency:write:async:qd4:iops", latency::write_async, "The 4Kb writes per second completed at a queue depth of 4 using an i/o multiplexer"};
+    item<unsigned long long> write_async_qd4_mean = {"latency:write:async:qd4:mean", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 4 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> write_async_qd4_50 = {"latency:write:async:qd4:50%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 4 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> write_async_qd4_95 = {"latency:write:async:qd4:95%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 4 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> write_async_qd4_99 = {"latency:write:async:qd4:99%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 4 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> write_async_qd4_999 = {"latency:write:async:qd4:99.9%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 4 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> write_async_qd4_99999 = {"latency:write:async:qd4:99.999%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 4 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> write_async_qd4_histogram = {"latency:write:async:qd4:histogram", latency::write_async, "Histogram of the nanoseconds to write 4Kb at a queue depth of 4 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> write_async_qd16_iops = {"latency:write:async:qd16:iops", latency::write_async, "The 4Kb writes per second completed at a queue depth of 16 using an i/o multiplexer"};
+    item<unsigned long long> write_async_qd16_mean = {"latency:write:async:qd16:mean", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 16 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> write_async_qd16_50 = {"latency:write:async:qd16:50%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 16 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> write_async_qd16_95 = {"latency:write:async:qd16:95%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 16 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> write_async_qd16_99 = {"latency:write:async:qd16:99%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 16 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> write_async_qd16_999 = {"latency:write:async:qd16:99.9%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 16 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> write_async_qd16_99999 = {"latency:write:async:qd16:99.999%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 16 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> write_async_qd16_histogram = {"latency:write:async:qd16:histogram", latency::write_async, "Histogram of the nanoseconds to write 4Kb at a queue depth of 16 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> write_async_qd64_iops = {"latency:write:async:qd64:iops", latency::write_async, "The 4Kb writes per second completed at a queue depth of 64 using an i/o multiplexer"};
+    item<unsigned long long> write_async_qd64_mean = {"latency:write:async:qd64:mean", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 64 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> write_async_qd64_50 = {"latency:write:async:qd64:50%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 64 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> write_async_qd64_95 = {"latency:write:async:qd64:95%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 64 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> write_async_qd64_99 = {"latency:write:async:qd64:99%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 64 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> write_async_qd64_999 = {"latency:write:async:qd64:99.9%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 64 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> write_async_qd64_99999 = {"latency:write:async:qd64:99.999%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 64 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> write_async_qd64_histogram = {"latency:write:async:qd64:histogram", latency::write_async, "Histogram of the nanoseconds to write 4Kb at a queue depth of 64 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
+
+    item<unsigned long long> write_async_qd256_iops = {"latency:write:async:qd256:iops", latency::write_async, "The 4Kb writes per second completed at a queue depth of 256 using an i/o multiplexer"};
+    item<unsigned long long> write_async_qd256_mean = {"latency:write:async:qd256:mean", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 256 using an i/o multiplexer (arithmetic mean)"};
+    item<unsigned long long> write_async_qd256_50 = {"latency:write:async:qd256:50%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 256 using an i/o multiplexer (50% of the time)"};
+    item<unsigned long long> write_async_qd256_95 = {"latency:write:async:qd256:95%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 256 using an i/o multiplexer (95% of the time)"};
+    item<unsigned long long> write_async_qd256_99 = {"latency:write:async:qd256:99%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 256 using an i/o multiplexer (99% of the time)"};
+    item<unsigned long long> write_async_qd256_999 = {"latency:write:async:qd256:99.9%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 256 using an i/o multiplexer (99.9% of the time)"};
+    item<unsigned long long> write_async_qd256_99999 = {"latency:write:async:qd256:99.999%", latency::write_async, "The nanoseconds to write 4Kb at a queue depth of 256 using an i/o multiplexer (99.999% of the time)"};
+    item<std::string> write_async_qd256_histogram = {"latency:write:async:qd256:histogram", latency::write_async, "Histogram of the nanoseconds to write 4Kb at a queue depth of 256 using an i/o multiplexer, as space separated pairs of log bucket lower bound:count"};
 
     item<unsigned long long> create_file_warm_racefree_0b = {"response_time:race_free:warm_cache:create_file:0b", response_time::traversal_warm_racefree_0b, "The average nanoseconds to create a 0 byte file (warm cache, race free)"};
     item<unsigned long long> enumerate_file_warm_racefree_0b = {"response_time:race_free:warm_cache:enumerate_file:0b", response_time::traversal_warm_racefree_0b, "The average nanoseconds to enumerate a 0 byte file (warm cache, race free)"};
@@ -392,12 +729,97 @@ namespace storage_profile
     item<unsigned long long> open_file_write_cold_racefree_0b = {"response_time:race_free:cold_cache:open_file_write:0b", response_time::traversal_cold_racefree_0b, "The average nanoseconds to open a 0 byte file for writing (cold cache, race free)"};
     item<unsigned long long> delete_file_cold_racefree_0b = {"response_time:race_free:cold_cache:delete_file:0b", response_time::traversal_cold_racefree_0b, "The average nanoseconds to delete a 0 byte file (cold cache, race free)"};
 
+    item<unsigned long long> metadata_create_qd1 = {"response_time:metadata:create:qd1", response_time::metadata_concurrency, "Operations per second to create an empty file with 1 thread working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_stat_qd1 = {"response_time:metadata:stat:qd1", response_time::metadata_concurrency, "Operations per second to open and stat a file with 1 thread working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_rename_qd1 = {"response_time:metadata:rename:qd1", response_time::metadata_concurrency, "Operations per second to open and rename a file with 1 thread working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_unlink_qd1 = {"response_time:metadata:unlink:qd1", response_time::metadata_concurrency, "Operations per second to open and unlink a file with 1 thread working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_create_qd4 = {"response_time:metadata:create:qd4", response_time::metadata_concurrency, "Operations per second to create an empty file with 4 threads working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_stat_qd4 = {"response_time:metadata:stat:qd4", response_time::metadata_concurrency, "Operations per second to open and stat a file with 4 threads working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_rename_qd4 = {"response_time:metadata:rename:qd4", response_time::metadata_concurrency, "Operations per second to open and rename a file with 4 threads working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_unlink_qd4 = {"response_time:metadata:unlink:qd4", response_time::metadata_concurrency, "Operations per second to open and unlink a file with 4 threads working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_create_qd16 = {"response_time:metadata:create:qd16", response_time::metadata_concurrency, "Operations per second to create an empty file with 16 threads working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_stat_qd16 = {"response_time:metadata:stat:qd16", response_time::metadata_concurrency, "Operations per second to open and stat a file with 16 threads working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_rename_qd16 = {"response_time:metadata:rename:qd16", response_time::metadata_concurrency, "Operations per second to open and rename a file with 16 threads working within one directory (warm cache, non race free)"};
+    item<unsigned long long> metadata_unlink_qd16 = {"response_time:metadata:unlink:qd16", response_time::metadata_concurrency, "Operations per second to open and unlink a file with 16 threads working within one directory (warm cache, non race free)"};
+
     /*
     item<unsigned> create_1M_files = {"response_time:create_1M_files_single_dir", response_time::traversal_warm_nonracefree_1M, "The milliseconds to create 1M empty files in a single directory"};
     item<unsigned> enumerate_1M_files = {"response_time:enumerate_1M_files_single_dir", response_time::traversal_warm_nonracefree_1M, "The milliseconds to enumerate 1M empty files in a single directory"};
     item<unsigned> delete_1M_files = {"response_time:delete_1M_files_single_dir", response_time::traversal_warm_nonracefree_1M, "The milliseconds to delete 1M files in a single directory"};
     */
   };
+
+  /*! \brief Returns a key identifying the filing system and storage device upon which `h`
+  resides, and the caching of `h`, for use with `load_cached()` and `save_cached()`.
+
+  The key is made of the filing system type, the mount source, the serial number of the device
+  where obtainable, and the kernel caching mode of `h` as the profile is specific to that.
+  Device serial numbers come from `/sys/dev/block` on Linux, and are the volume serial number on
+  Windows.
+  \errors Any of the values `statfs_t::fill()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<std::string> device_key(file_handle &h) noexcept;
+  /*! \brief Returns the directory in which storage profiles are cached.
+
+  This is `$LLFIO_STORAGE_PROFILE_CACHE` if set, otherwise `$XDG_CACHE_HOME/llfio/storage_profiles`
+  or `$HOME/.cache/llfio/storage_profiles` on POSIX, and `%LOCALAPPDATA%\\llfio\\storage_profiles`
+  on Windows. The directory may not exist yet.
+  \errors `errc::no_such_file_or_directory` if none of the environment variables are set.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<filesystem::path> cache_directory() noexcept;
+  /*! \brief Reads the matching items of the storage profile cached for the device upon which `h`
+  resides into `sp`, without running any tests.
+
+  This is intended to be called at startup, so tuned parameters are available immediately
+  rather than after minutes of running the tests.
+  \errors `errc::no_such_file_or_directory` if no profile is cached for the device. Any of the
+  values `device_key()` or `cache_directory()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<void> load_cached(storage_profile &sp, file_handle &h, std::regex which = std::regex(".*")) noexcept;
+  /*! \brief Writes `sp` as the storage profile cached for the device upon which `h` resides,
+  replacing any previously cached profile atomically.
+  \errors Any of the values `device_key()`, `cache_directory()`, `filesystem::create_directories()`
+  or `filesystem::rename()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<void> save_cached(const storage_profile &sp, file_handle &h) noexcept;
+  /*! \brief Maps the binary profile which `save_cached()` caches alongside the storage profile
+  for the device upon which `h` resides, whose items can then be used without parsing.
+  \errors `errc::no_such_file_or_directory` if no binary profile is cached for the device. Any of the
+  values `device_key()`, `cache_directory()` or `binary_profile::open()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<binary_profile> map_cached(file_handle &h) noexcept;
+  /*! \brief Writes the binary profiles to `out` as comma separated values, with a row per
+  profile and a column per item, for aggregating the profiles of many hosts.
+
+  The first column is the label of each profile. The remaining columns are the union of the
+  items of all the profiles, sorted by name, where an item a profile lacks is left empty.
+  Strings are quoted. Columns can thus be loaded directly by columnar analysis tools.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void write_csv(std::ostream &out, span<const binary_profile> profiles);
+
+  /*! \brief True if reads of `request_size` bytes were measured by the `latency:read:mmap_crossover`
+  tests to be no slower through a map than with `read()`, for the access pattern and cache state.
+
+  The crossover measured includes the cost of mapping and unmapping each region read, so it is
+  conservative for `mapped_file_handle`, which maps the file once. False if not measured.
+  */
+  inline bool prefer_mapped_reads(const storage_profile &sp, size_t request_size, bool sequential, bool warm_cache) noexcept
+  {
+    const auto &crossover = sequential ? (warm_cache ? sp.mmap_crossover_sequential_warm : sp.mmap_crossover_sequential_cold) :
+                                         (warm_cache ? sp.mmap_crossover_random_warm : sp.mmap_crossover_random_cold);
+    return crossover.value != default_value<io_handle::extent_type>() && crossover.value != 0 && request_size >= crossover.value;
+  }
+  /*! \brief Opens a file for reads of `request_size` bytes as a `mapped_file_handle` if
+  `prefer_mapped_reads()`, else as a plain `file_handle`.
+
+  Both are returned as a `file_handle`, whose `read()` is virtual, so code reading the file need
+  not care which was chosen.
+  \errors Any of the values `file_handle::file()` or `mapped_file_handle::mapped_file()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<std::unique_ptr<file_handle>> file_for_reads(const storage_profile &sp, const path_handle &base, file_handle::path_view_type path, size_t request_size,
+                                                                                   bool sequential, bool warm_cache = false, file_handle::mode _mode = file_handle::mode::read,
+                                                                                   file_handle::creation _creation = file_handle::creation::open_existing,
+                                                                                   file_handle::caching _caching = file_handle::caching::all, file_handle::flag flags = file_handle::flag::none) noexcept;
 }  // namespace storage_profile
 
 LLFIO_V2_NAMESPACE_END
@@ -25,6 +25,7 @@ Distributed under the Boost Software License, Version 1.0.
 #ifndef LLFIO_SYMLINK_HANDLE_H
 #define LLFIO_SYMLINK_HANDLE_H
 
+#include "directory_handle.hpp"
 #include "handle.hpp"
 #include "path_view.hpp"
 
@@ -89,7 +90,7 @@ class LLFIO_DECL symlink_handle : public handle, public fs_handle
 
 #ifndef _WIN32
   friend result<void> detail::stat_from_symlink(struct stat &s, const handle &h) noexcept;
-  LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _create_symlink(const path_handle &dirh, const handle::path_type &filename, path_view target, deadline d, bool atomic_replace) noexcept;
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _create_symlink(const path_handle &dirh, const handle::path_type &filename, path_view target, deadline d, bool atomic_replace) noexcept;
 #endif
 
 public:
@@ -297,7 +298,16 @@ public:
     LLFIO_TREQUIRES(LLFIO_TPRED(std::is_constructible<path_view, Args...>::value))
     constexpr io_request(symlink_type type, Args &&... args) noexcept : buffers(path_view(static_cast<Args &&>(args)...), type) {}
   };
+  struct read_many_item;
+  struct create_many_item;
 
+private:
+#ifndef _WIN32
+  // Reads the link at path relative to dirfd into tofill, growing any kernel buffer it owns
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> _read_link(int dirfd, const char *path, span<char> kernelbuffer, buffers_type &tofill) noexcept;
+#endif
+
+public:
 //! Default constructor
 #if !LLFIO_SYMLINK_HANDLE_IS_FAKED
   constexpr
@@ -479,8 +489,126 @@ public:
   */
   LLFIO_MAKE_FREE_FUNCTION
   LLFIO_HEADERS_ONLY_VIRTUAL_SPEC result<const_buffers_type> write(io_request<const_buffers_type> req, deadline d = deadline()) noexcept;
+
+  /*! \brief Reads the contents of many symbolic links relative to `base` as a single batch.
+
+  Each item's `buffers` is filled with the contents of the link at its `leafname`, and its `read`
+  is set to success, or to the failure to read it. Kernel buffers are as for `read()`.
+
+  On POSIX this is a loop of `readlinkat()` relative to `base`, so unlike `read()` no handle is
+  opened to any of the links. There is no io_uring operation for reading links. On Windows this
+  opens each link in turn and calls `read()`.
+
+  \return An error only if the batch could not be attempted. Per item failures are placed into
+  the items.
+  \mallocs One per item without a `kernelbuffer`, possibly more for long links.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> read_many(const path_handle &base, span<read_many_item> items) noexcept;
+
+  /*! \brief Creates many symbolic links relative to `base` as a single batch.
+
+  Each item's `created` is set to success, or to the failure to create its link. Items with
+  `atomic_replace` set atomically replace any existing link of the same name, as `write()` does,
+  otherwise creating a link whose name exists fails with `errc::file_exists`.
+
+  On Linux with io_uring available, a batch of up to 256 `symlinkat()` are kept in flight at
+  once for the items not replacing existing links. Elsewhere on POSIX this is a loop of
+  `symlinkat()` relative to `base`, and on Windows a loop of creating each link with `symlink()`
+  and calling `write()`.
+
+  \return An error only if the batch could not be attempted. Per item failures are placed into
+  the items.
+  \mallocs At least one per item replacing an existing link, otherwise none beyond the first
+  batch on a thread.
+  */
+  static LLFIO_HEADERS_ONLY_MEMFUNC_SPEC result<void> create_many(const path_handle &base, span<create_many_item> items, deadline d = deadline()) noexcept;
+
+  /*! \brief Enumerates the directory `dirh`, reading the contents of every symbolic link within
+  it using `read_many()`, and calling `f(const read_many_item &)` for each.
+
+  The items passed to `f` remain valid only for the duration of the call.
+
+  \return The first failure to enumerate the directory, or of `read_many()`. Failures to read
+  individual links are passed to `f` in the item.
+  \mallocs Several.
+  */
+  template <class F> static result<void> read_directory(const directory_handle &dirh, F &&f) noexcept;
+};
+
+//! An item in a batch of `symlink_handle::read_many()`
+struct symlink_handle::read_many_item
+{
+  path_view leafname;            //!< The leafname relative to the base of the link to read
+  span<char> kernelbuffer;       //!< An optional buffer to read the link into
+  buffers_type buffers;          //!< The contents of the link read
+  result<void> read{success()};  //!< Whether the link was read, or the failure to read it
+
+  read_many_item() = default;
+  //! Constructs an item reading the link at `_leafname`
+  explicit read_many_item(path_view _leafname, span<char> _kernelbuffer = {}) noexcept
+      : leafname(_leafname)
+      , kernelbuffer(_kernelbuffer)
+  {
+  }
 };
 
+//! An item in a batch of `symlink_handle::create_many()`
+struct symlink_handle::create_many_item
+{
+  path_view leafname;                         //!< The leafname relative to the base of the link to create
+  path_view target;                           //!< The contents of the link
+  symlink_type type{symlink_type::symbolic};  //!< The type of link to create
+  bool atomic_replace{false};                 //!< Whether to atomically replace any existing link of the same name
+  result<void> created{success()};            //!< Whether the link was created, or the failure to create it
+
+  create_many_item() = default;
+  //! Constructs an item creating the link at `_leafname` with contents `_target`
+  create_many_item(path_view _leafname, path_view _target, bool _atomic_replace = false, symlink_type _type = symlink_type::symbolic) noexcept
+      : leafname(_leafname)
+      , target(_target)
+      , type(_type)
+      , atomic_replace(_atomic_replace)
+  {
+  }
+};
+
+template <class F> inline result<void> symlink_handle::read_directory(const directory_handle &dirh, F &&f) noexcept
+{
+  try
+  {
+    std::vector<directory_entry> entries(256);
+    directory_handle::buffers_type buffers;
+    for(;;)
+    {
+      buffers = {entries, std::move(buffers)};
+      OUTCOME_TRY(buffers, dirh.read({std::move(buffers), {}, directory_handle::filter::fastdeleted, {}, stat_t::want::type}));
+      if(buffers.done())
+      {
+        break;
+      }
+      entries.resize(entries.size() << 1);
+    }
+    std::vector<read_many_item> items;
+    for(const auto &entry : buffers)
+    {
+      if(entry.stat.st_type == filesystem::file_type::symlink)
+      {
+        items.emplace_back(entry.leafname);
+      }
+    }
+    OUTCOME_TRYV(read_many(dirh, items));
+    for(const auto &item : items)
+    {
+      f(item);
+    }
+    return success();
+  }
+  catch(...)
+  {
+    return error_from_exception();
+  }
+}
+
 //! \brief Constructor for `symlink_handle`
 template <> struct construct<symlink_handle>
 {
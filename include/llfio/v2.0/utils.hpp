@@ -46,6 +46,14 @@ namespace utils
   */
   LLFIO_HEADERS_ONLY_FUNC_SPEC size_t page_size() noexcept;
 
+  /*! \brief Returns the granularity with which the system places maps of sections in the address space, and with
+  which offsets into sections must be aligned. This is the page size on POSIX, and typically 64Kb on Windows.
+
+  \ingroup utils
+  \complexity{Whatever the system API takes (one would hope constant time).}
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC size_t allocation_granularity() noexcept;
+
   /*! \brief Round a value to its next lowest page size multiple
    */
   template <class T> inline T round_down_to_page_size(T i, size_t pagesize) noexcept
@@ -148,16 +156,36 @@ namespace utils
     return size;
   }
 
+  namespace detail
+  {
+    // Fills the buffer using the OS kernel API
+    LLFIO_HEADERS_ONLY_FUNC_SPEC void kernel_random_fill(char *buffer, size_t bytes) noexcept;
+  }  // namespace detail
+
   /*! \brief Fills the buffer supplied with cryptographically strong randomness. Uses the OS kernel API.
 
+  Fills of more than a few hundred bytes use the kernel only for a fresh 256 bit key, which is
+  then expanded with ChaCha20 four blocks at a time using SSE2 or NEON where available. This
+  runs at close to memory bandwidth, whereas the kernel APIs typically do not.
+
   \param buffer A buffer to fill
   \param bytes How many bytes to fill
   \ingroup utils
-  \complexity{Whatever the system API takes.}
+  \complexity{Whatever the system API takes for short fills, linear to bytes otherwise.}
   \exceptionmodel{Any error from the operating system.}
   */
   LLFIO_HEADERS_ONLY_FUNC_SPEC void random_fill(char *buffer, size_t bytes) noexcept;
 
+  /*! \brief Copies `bytes` from `src` to `dest` using stores which bypass the CPU caches where
+  the CPU has them, so copying large amounts of data which will not soon be read again does not
+  evict more useful data from the caches. Uses SSE2 non-temporal stores on x86, and `memcpy()`
+  elsewhere. The stores are fenced before returning. The regions must not overlap.
+
+  \ingroup utils
+  \complexity{Linear to bytes.}
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void memcpy_nontemporal(void *dest, const void *src, size_t bytes) noexcept;
+
   /*! \brief Returns a cryptographically random string capable of being used as a filename. Essentially random_fill() + to_hex_string().
 
   \param randomlen The number of bytes of randomness to use for the string.
@@ -179,6 +207,17 @@ namespace utils
    */
   LLFIO_HEADERS_ONLY_FUNC_SPEC result<void> flush_modified_data() noexcept;
 
+  /*! \brief Tries to flush all modified data on the filing system containing `h` to the
+  physical device, without stalling on modified data for any other filing system.
+
+  On Linux this is `syncfs()`. On Windows the volume containing `h` is opened and flushed with
+  `FlushFileBuffers()`, which requires the calling process to be elevated. Other POSIX have no
+  per filing system flush, so this is a global `sync()` there.
+  \errors Any of the values `syncfs()`, `GetFinalPathNameByHandleW()`, `CreateFileW()` or
+  `FlushFileBuffers()` can return.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<void> flush_modified_data(const handle &h) noexcept;
+
   /*! \brief Tries to flush all modified data to the physical device, and then drop the OS filesystem cache,
   thus making all future reads come from the physical device. Currently only implemented for Microsoft Windows and Linux.
 
@@ -198,6 +237,22 @@ namespace utils
    */
   struct process_memory_usage
   {
+    //! Fields wanted
+    QUICKCPPLIB_BITFIELD_BEGIN(want){
+    total_address_space_in_use = 1U << 0U,
+    total_address_space_paged_in = 1U << 1U,
+    private_committed = 1U << 2U,
+    private_paged_in = 1U << 3U,
+    /*! Supply in `private_committed` an approximation which is cheap to obtain, rather than an
+    accurate figure which may be expensive to obtain. Implied if `private_committed` is not wanted.
+    */
+    private_committed_inaccurate = 1U << 8U,
+
+    all = 0xff,
+    //! Only fields which are cheap to obtain on all platforms, suitable for frequent sampling.
+    sample = total_address_space_in_use | total_address_space_paged_in | private_paged_in | private_committed_inaccurate}
+    QUICKCPPLIB_BITFIELD_END(want)
+
     //! The total virtual address space in use.
     size_t total_address_space_in_use{0};
     //! The total memory currently paged into the process. Always `<= total_address_space_in_use`. Also known as "working set", or "resident set size including shared".
@@ -210,9 +265,17 @@ namespace utils
   };
   /*! \brief Retrieve the current memory usage statistics for this process.
 
-   \note Mac OS provides no way of reading how much memory a process has committed. We therefore supply as `private_committed` the same value as `private_paged_in`.
+  On Linux an accurate `private_committed` requires walking every mapping in `/proc/self/smaps`,
+  which becomes expensive in processes with many mappings. If it is not wanted, the other fields
+  are read from `/proc/self/statm` instead, which costs about the same as a single syscall. In
+  this case `private_committed` is the private writable address space, which is an overestimate.
+  On other platforms all fields are always cheap to obtain.
+
+  \param want Which fields are wanted. `want::sample` is suitable for frequent sampling.
+
+  \note Mac OS provides no way of reading how much memory a process has committed. We therefore supply as `private_committed` the same value as `private_paged_in`.
   */
-  LLFIO_HEADERS_ONLY_FUNC_SPEC result<process_memory_usage> current_process_memory_usage() noexcept;
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<process_memory_usage> current_process_memory_usage(process_memory_usage::want want = process_memory_usage::want::all) noexcept;
 
   namespace detail
   {
@@ -241,10 +304,141 @@ namespace utils
       ret.actual_size = (bytes + ret.page_size_used - 1) & ~(ret.page_size_used - 1);
       return ret;
     }
+    // Allocates using the policy set by set_large_page_allocation_policy()
     LLFIO_HEADERS_ONLY_FUNC_SPEC large_page_allocation allocate_large_pages(size_t bytes);
+    /* Allocates using pages of pagesize, or the largest of page_sizes() no larger than bytes if zero.
+    If those cannot be had, uses the next smaller available page size if permit_fallback, else fails.
+    */
+    LLFIO_HEADERS_ONLY_FUNC_SPEC large_page_allocation allocate_large_pages(size_t bytes, size_t pagesize, bool permit_fallback);
     LLFIO_HEADERS_ONLY_FUNC_SPEC void deallocate_large_pages(void *p, size_t bytes);
+    // As above, but reusing memory previously deallocated if possible. Returns nullptr on failure.
+    LLFIO_HEADERS_ONLY_FUNC_SPEC void *allocate_cached_large_pages(size_t bytes) noexcept;
+    LLFIO_HEADERS_ONLY_FUNC_SPEC void deallocate_cached_large_pages(void *p, size_t bytes) noexcept;
   }  // namespace detail
 
+  /*! \brief Counts of allocations by `page_allocator` asking for large pages.
+  \ingroup utils
+  */
+  struct large_page_statistics
+  {
+    //! Allocations which asked for pages larger than `page_size()`.
+    size_t allocations{0};
+    //! Of those, how many were given smaller pages than asked for.
+    size_t fallbacks{0};
+    //! Of those, the bytes given smaller pages than asked for.
+    size_t fallback_bytes{0};
+    //! Of those, how many failed as falling back was not permitted.
+    size_t failures{0};
+  };
+  /*! \brief Returns counts of allocations by `page_allocator` asking for large pages since process start.
+  \ingroup utils
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC large_page_statistics large_page_allocation_statistics() noexcept;
+
+  /*! \brief Sets the page size used by `page_allocator`, and whether to fail rather than fall back
+  to smaller pages.
+  \ingroup utils
+
+  \param page_size One of `page_sizes(false)`, or zero for the default of the largest page size
+  available no larger than the allocation.
+  \param permit_fallback If false, allocations which cannot be had using `page_size` pages throw
+  `std::bad_alloc`. If true, the next smaller page size available is tried instead, down to
+  `page_size()`, and the fallback is counted in `large_page_allocation_statistics()`.
+
+  On Linux, pages of each size come from the hugetlbfs pool for that size, so 1Gb pages require
+  `/sys/kernel/mm/hugepages/hugepages-1048576kB/nr_hugepages` to be non-zero. On Windows, pages
+  larger than `GetLargePageMinimum()` are 1Gb huge pages allocated with `VirtualAlloc2()`, and all
+  large pages require the `SeLockMemoryPrivilege` privilege. Memory already kept for reuse by
+  `page_allocator` was allocated with the previous policy, so call `trim_page_allocator_cache()`
+  to be sure every allocation uses the new one.
+
+  \errors `errc::invalid_argument` if `page_size` is not one of `page_sizes(false)`.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<void> set_large_page_allocation_policy(size_t page_size, bool permit_fallback = true) noexcept;
+
+  /*! \brief Sets how many bytes of memory deallocated by `page_allocator` may be kept for reuse.
+  \ingroup utils
+
+  \param max_thread_bytes The bytes each thread may keep for itself, reusable without taking any lock.
+  \param max_global_bytes The bytes kept for reuse by any thread.
+
+  Deallocated memory is first kept by the deallocating thread. When a thread keeps more than
+  `max_thread_bytes`, the least recently deallocated of its memory is moved into the global cache
+  until it keeps no more than half. When the global cache keeps more than `max_global_bytes`, its
+  least recently deallocated memory is returned to the system until it keeps no more than half.
+  Memory kept by a thread is moved into the global cache when the thread exits. Allocations only
+  reuse memory of the exact same size in pages, and reused memory is not zeroed. The defaults are
+  4Mb and 64Mb. Setting both to zero disables reuse, returning all kept memory to the system.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void set_page_allocator_cache_limits(size_t max_thread_bytes, size_t max_global_bytes) noexcept;
+
+  /*! \brief Returns all memory kept by the calling thread and the global cache for reuse by
+  `page_allocator` to the system, returning the bytes returned.
+  \ingroup utils
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC size_t trim_page_allocator_cache() noexcept;
+
+  /*! \brief How much memory pressure the system, or the container of this process, is under.
+  \ingroup utils
+  */
+  enum class memory_pressure
+  {
+    low = 1,      //!< Memory is becoming scarce, so caches should shrink to what has recently been useful.
+    critical = 2  //!< Memory is about to run out, so caches should release everything they can.
+  };
+
+  /*! \brief A callback which shrinks some cache in response to memory pressure. It is called
+  with the registry lock held, so it must not register nor unregister callbacks.
+  \ingroup utils
+  */
+  using memory_pressure_callback = void (*)(void *data, memory_pressure level) noexcept;
+
+  /*! \brief Registers a callback to be called with `data` whenever memory pressure is
+  notified, returning an identifier for `unregister_memory_pressure_callback()`.
+  \ingroup utils
+
+  The process-wide caches within LLFIO, those of `page_allocator` and of `map_handle`, register
+  callbacks when first used. `low` pressure halves them, `critical` pressure empties them.
+  Pressure is notified by `notify_memory_pressure()`, and by the monitor which
+  `start_memory_pressure_monitor()` starts.
+
+  \errors Any error from the memory allocator.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<size_t> register_memory_pressure_callback(memory_pressure_callback callback, void *data) noexcept;
+
+  /*! \brief Unregisters a callback registered by `register_memory_pressure_callback()`. Upon return,
+  the callback is not being called, and will not be called again.
+  \ingroup utils
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void unregister_memory_pressure_callback(size_t id) noexcept;
+
+  /*! \brief Calls every registered memory pressure callback with `level`, in the order registered.
+  \ingroup utils
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void notify_memory_pressure(memory_pressure level) noexcept;
+
+  /*! \brief Starts a thread which calls `notify_memory_pressure()` when the system, or the
+  container of this process, comes under memory pressure. Does nothing if already started.
+  \ingroup utils
+
+  On Linux, this uses pressure stall information (PSI) triggers on the cgroup of this process, or if
+  unavailable on the whole system. A `some` stall of 200ms within two seconds is `low`, a `full`
+  stall of 100ms within two seconds is `critical`. If the cgroup has a `memory.events` file, rises
+  in its `high` count are additionally `low`, and rises in its `max` or `oom` counts are `critical`.
+
+  On Windows, this uses `CreateMemoryResourceNotification()`, whose low memory notification is
+  `critical`. Additionally physical memory load of 90% or more, sampled once per second, is `low`.
+
+  \errors `errc::not_supported` if no source of memory pressure is available, else any error from
+  the operating system.
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC result<void> start_memory_pressure_monitor() noexcept;
+
+  /*! \brief Stops the thread started by `start_memory_pressure_monitor()`, if it was started.
+  \ingroup utils
+  */
+  LLFIO_HEADERS_ONLY_FUNC_SPEC void stop_memory_pressure_monitor() noexcept;
+
   /*! \class page_allocator
   \brief An STL allocator which allocates large TLB page memory.
   \ingroup utils
@@ -267,6 +461,10 @@ namespace utils
   Be aware that as soon as the allocation exceeds a large page size, most
   systems allocate in multiples of the large page size, so if the large page
   size were 2Mb and you allocate 2Mb + 1 byte, 4Mb is actually consumed.
+
+  Deallocated memory is kept in per-thread and global free lists for reuse by
+  allocations of the same size, so churning buffers need not go to the kernel
+  each time. See `set_page_allocator_cache_limits()`.
   */
   template <typename T> class page_allocator
   {
@@ -302,12 +500,12 @@ namespace utils
       {
         throw std::bad_alloc();
       }
-      auto mem(detail::allocate_large_pages(n * sizeof(T)));
-      if(mem.p == nullptr)
+      void *mem = detail::allocate_cached_large_pages(n * sizeof(T));
+      if(mem == nullptr)
       {
         throw std::bad_alloc();
       }
-      return reinterpret_cast<pointer>(mem.p);
+      return reinterpret_cast<pointer>(mem);
     }
 
     void deallocate(pointer p, size_type n)
@@ -316,7 +514,7 @@ namespace utils
       {
         throw std::bad_alloc();
       }
-      detail::deallocate_large_pages(p, n * sizeof(T));
+      detail::deallocate_cached_large_pages(p, n * sizeof(T));
     }
 
     template <class U, class... Args> void construct(U *p, Args &&... args) { ::new(reinterpret_cast<void *>(p)) U(std::forward<Args>(args)...); }
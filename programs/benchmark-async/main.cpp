@@ -377,6 +377,10 @@ completion i/o min 1300 max 1.40714e+06 mean 23037 stddev 15035.4
 #include <typeinfo>
 #include <vector>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 #if __has_include("asio/asio/include/asio.hpp")
 #define ENABLE_ASIO 1
 #if defined(__clang__) && defined(_MSC_VER)
@@ -866,7 +870,8 @@ template <class HandleType = NoHandle> struct benchmark_llfio
   {
     benchmark_llfio *parent{nullptr};
     HandleType read_handle;
-    std::unique_ptr<llfio::byte[]> io_state_ptr;
+    llfio::io_multiplexer *multiplexer{nullptr};
+    llfio::span<llfio::byte> io_state_storage;
     llfio::byte _buffer[sizeof(size_t)];
     buffer_type buffer;
     llfio::io_multiplexer::io_operation_state *io_state{nullptr};
@@ -875,7 +880,8 @@ template <class HandleType = NoHandle> struct benchmark_llfio
     explicit receiver_type(benchmark_llfio *_parent, HandleType &&h)
         : parent(_parent)
         , read_handle(std::move(h))
-        , io_state_ptr(std::make_unique<llfio::byte[]>(read_handle.multiplexer()->io_state_requirements().first))
+        , multiplexer(read_handle.multiplexer())
+        , io_state_storage(multiplexer->allocate_io_operation_state_storage().value())
         , buffer(_buffer, sizeof(_buffer))
     {
       memset(_buffer, 0, sizeof(_buffer));
@@ -884,16 +890,18 @@ template <class HandleType = NoHandle> struct benchmark_llfio
     receiver_type(receiver_type &&o) noexcept
         : parent(o.parent)
         , read_handle(std::move(o.read_handle))
-        , io_state_ptr(std::move(o.io_state_ptr))
+        , multiplexer(o.multiplexer)
+        , io_state_storage(o.io_state_storage)
     {
       if(o.io_state != nullptr)
       {
         abort();
       }
       o.parent = nullptr;
+      o.io_state_storage = {};
     }
     receiver_type &operator=(const receiver_type &) = delete;
-    receiver_type &operator=(receiver_type &&) = default;
+    receiver_type &operator=(receiver_type &&) = delete;
     ~receiver_type()
     {
       if(io_state != nullptr)
@@ -905,6 +913,10 @@ template <class HandleType = NoHandle> struct benchmark_llfio
         io_state->~io_operation_state();
         io_state = nullptr;
       }
+      if(!io_state_storage.empty())
+      {
+        multiplexer->deallocate_io_operation_state_storage(io_state_storage);
+      }
     }
 
     // Initiate the read
@@ -918,7 +930,7 @@ template <class HandleType = NoHandle> struct benchmark_llfio
         }
       }
       buffer = {_buffer, sizeof(_buffer)};
-      io_state = read_handle.multiplexer()->construct_and_init_io_operation({io_state_ptr.get(), 4096 /*lies*/}, &read_handle, this, {}, {}, io_request<buffers_type>({&buffer, 1}, 0));
+      io_state = read_handle.multiplexer()->construct_and_init_io_operation(io_state_storage, &read_handle, this, {}, {}, io_request<buffers_type>({&buffer, 1}, 0));
     }
 
     // Called when the read completes
@@ -1016,6 +1028,138 @@ template <class HandleType = NoHandle> struct benchmark_llfio
   }
 };
 
+#ifdef _WIN32
+/* The raw Win32 API equivalent of benchmark_llfio<llfio::pipe_handle>, as the baseline which
+multiplexer_win_iocp() ought to match. The pipes are created and written to in the same way,
+only the reads and the reaping of their completions use the Win32 API directly.
+*/
+struct benchmark_win32_pipe
+{
+  static constexpr bool launch_writer_thread = true;
+
+  struct read_state
+  {
+    OVERLAPPED ol;
+    HANDLE read_handle{INVALID_HANDLE_VALUE};
+    char raw_buffer[1];
+    std::chrono::high_resolution_clock::time_point when_read_completed;
+    bool pending{false};
+  };
+
+  HANDLE iocp{nullptr};
+  bool skip_completion_port_on_success{false};
+  std::vector<llfio::pipe_handle> read_handles, write_handles;
+  std::unique_ptr<read_state[]> read_states;
+  size_t count{0};
+
+  explicit benchmark_win32_pipe(size_t _count, bool _skip_completion_port_on_success)
+      : iocp(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1))
+      , skip_completion_port_on_success(_skip_completion_port_on_success)
+      , read_states(new read_state[_count])
+      , count(_count)
+  {
+    // Construct read and write sides of the pipes
+    llfio::filesystem::path::value_type name[64] = {'l', 'l', 'f', 'i', 'o', '_'};
+    for(size_t n = 0; n < count; n++)
+    {
+      using mode = typename llfio::pipe_handle::mode;
+      using creation = typename llfio::pipe_handle::creation;
+      using caching = typename llfio::pipe_handle::caching;
+      using flag = typename llfio::pipe_handle::flag;
+
+      name[QUICKCPPLIB_NAMESPACE::algorithm::string::to_hex_string(name + 6, 58, (const char *) &n, sizeof(n))] = 0;
+      read_handles.push_back(llfio::construct<llfio::pipe_handle>{name, mode::read, creation::if_needed, caching::all, flag::multiplexable}().value());
+      write_handles.push_back(llfio::construct<llfio::pipe_handle>{name, mode::write, creation::open_existing, caching::all, flag::multiplexable}().value());
+      read_states[n].read_handle = read_handles.back().native_handle().h;
+      if(nullptr == CreateIoCompletionPort(read_states[n].read_handle, iocp, 0, 0))
+      {
+        abort();
+      }
+      if(skip_completion_port_on_success && !SetFileCompletionNotificationModes(read_states[n].read_handle, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE))
+      {
+        abort();
+      }
+    }
+  }
+  std::chrono::high_resolution_clock::time_point read(unsigned which)
+  {
+    auto &state = read_states[which];
+    auto ret = state.when_read_completed;
+    state.when_read_completed = {};
+    memset(&state.ol, 0, sizeof(state.ol));
+    if(ReadFile(state.read_handle, state.raw_buffer, 1, nullptr, &state.ol))
+    {
+      if(skip_completion_port_on_success)
+      {
+        state.when_read_completed = std::chrono::high_resolution_clock::now();
+        return ret;
+      }
+    }
+    else if(GetLastError() != ERROR_IO_PENDING)
+    {
+      abort();
+    }
+    state.pending = true;
+    return ret;
+  }
+  void check()
+  {
+    OVERLAPPED_ENTRY entries[64];
+    for(;;)
+    {
+      size_t pending = 0;
+      for(size_t n = 0; n < count; n++)
+      {
+        if(read_states[n].pending)
+        {
+          pending++;
+        }
+      }
+      if(pending == 0)
+      {
+        break;
+      }
+      ULONG filled = 0;
+      if(!GetQueuedCompletionStatusEx(iocp, entries, 64, &filled, INFINITE, false))
+      {
+        abort();
+      }
+      for(ULONG n = 0; n < filled; n++)
+      {
+        auto *state = CONTAINING_RECORD(entries[n].lpOverlapped, read_state, ol);
+        state->when_read_completed = std::chrono::high_resolution_clock::now();
+        state->pending = false;
+      }
+    }
+  }
+  void write(unsigned which)
+  {
+    llfio::byte c = llfio::to_byte(78);
+    llfio::pipe_handle::const_buffer_type b(&c, 1);
+    write_handles[which].write(llfio::pipe_handle::io_request<llfio::pipe_handle::const_buffers_type>({&b, 1}, 0)).value();
+  }
+  void cancel()
+  {
+    for(size_t n = 0; n < count; n++)
+    {
+      if(read_states[n].pending)
+      {
+        CancelIoEx(read_states[n].read_handle, &read_states[n].ol);
+      }
+    }
+    check();
+  }
+  void destroy()
+  {
+    read_handles.clear();
+    write_handles.clear();
+    read_states.reset();
+    CloseHandle(iocp);
+    iocp = nullptr;
+  }
+};
+#endif
+
 #if ENABLE_ASIO
 struct benchmark_asio_pipe
 {
@@ -1123,6 +1267,384 @@ struct benchmark_asio_pipe
 };
 #endif
 
+/* Real file i/o benchmark. Keeps `queue_depth` random 4Kb reads of an uncached
+(`caching::none`) file in flight for BENCHMARK_DURATION seconds, and records the
+latency of every read from initiation to completion.
+*/
+static constexpr size_t FILE_BENCHMARK_BYTES = 64 * 1024 * 1024;
+static constexpr size_t FILE_BENCHMARK_BLOCK = 4096;
+// Latencies are histogrammed into power of two buckets, from <= 2^7 ns to <= 2^26 ns, plus overflow
+static constexpr size_t FILE_BENCHMARK_HISTOGRAM_FIRST = 7, FILE_BENCHMARK_HISTOGRAM_BUCKETS = 21;
+
+struct file_test_results
+{
+  size_t queue_depth{0};
+  double iops{0};
+  double min{0}, mean{0}, max{0}, _50{0}, _99{0}, _999{0};
+  size_t histogram[FILE_BENCHMARK_HISTOGRAM_BUCKETS]{};
+  size_t total_readings{0};
+};
+
+inline file_test_results summarise_file_benchmark(size_t queue_depth, std::vector<double> &latencies, std::chrono::high_resolution_clock::duration elapsed)
+{
+  file_test_results ret;
+  ret.queue_depth = queue_depth;
+  ret.total_readings = latencies.size();
+  if(latencies.empty())
+  {
+    return ret;
+  }
+  ret.iops = (double) latencies.size() / ((double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / 1000000000.0);
+  std::sort(latencies.begin(), latencies.end());
+  ret.min = latencies.front();
+  ret.max = latencies.back();
+  ret._50 = latencies[(size_t)((latencies.size() - 1) * 0.5)];
+  ret._99 = latencies[(size_t)((latencies.size() - 1) * 0.99)];
+  ret._999 = latencies[(size_t)((latencies.size() - 1) * 0.999)];
+  for(double latency : latencies)
+  {
+    ret.mean += latency;
+    size_t bucket = 0;
+    while(bucket < FILE_BENCHMARK_HISTOGRAM_BUCKETS - 1 && latency > (double) (1ULL << (FILE_BENCHMARK_HISTOGRAM_FIRST + bucket)))
+    {
+      bucket++;
+    }
+    ret.histogram[bucket]++;
+  }
+  ret.mean /= latencies.size();
+  return ret;
+}
+
+inline file_test_results do_file_benchmark(size_t queue_depth, llfio::io_multiplexer_ptr (*make_multiplexer)())
+{
+  using llfio_buffer_type = llfio::io_multiplexer::buffer_type;
+  using llfio_buffers_type = llfio::io_multiplexer::buffers_type;
+  using llfio_io_request = llfio::io_multiplexer::io_request<llfio_buffers_type>;
+  using llfio_io_result = llfio::io_multiplexer::io_result<llfio_buffers_type>;
+
+  auto multiplexer = make_multiplexer();
+  auto fh = llfio::file_handle::temp_file({}, llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::none,
+                                          llfio::file_handle::flag::unlink_on_first_close | llfio::file_handle::flag::multiplexable)
+            .value();
+  {
+    // Fill the file with data, so reads actually go to the device
+    size_t bytes = 1024 * 1024;
+    auto buffer = fh.allocate_registered_buffer(bytes).value();
+    memset(buffer->data(), 78, buffer->size());
+    for(size_t offset = 0; offset < FILE_BENCHMARK_BYTES; offset += 1024 * 1024)
+    {
+      llfio::file_handle::const_buffer_type b{buffer->data(), 1024 * 1024};
+      fh.write({{&b, 1}, offset}).value();
+    }
+  }
+  fh.set_multiplexer(multiplexer.get()).value();
+
+  struct slot_type final : public llfio::io_multiplexer::io_operation_state_visitor
+  {
+    llfio::io_multiplexer *multiplexer{nullptr};
+    llfio::span<llfio::byte> io_state_storage;
+    llfio::io_multiplexer::io_operation_state *io_state{nullptr};
+    llfio::io_multiplexer::registered_buffer_type registered_buffer;
+    llfio_buffer_type buffer;
+    std::chrono::high_resolution_clock::time_point initiated, completed;
+    bool finished{false};
+
+    slot_type() = default;
+    slot_type(const slot_type &) = delete;
+    slot_type &operator=(const slot_type &) = delete;
+    ~slot_type()
+    {
+      if(io_state != nullptr)
+      {
+        io_state->~io_operation_state();
+      }
+      if(!io_state_storage.empty())
+      {
+        multiplexer->deallocate_io_operation_state_storage(io_state_storage);
+      }
+    }
+    void begin_io(llfio::file_handle &fh, llfio::file_handle::extent_type offset)
+    {
+      if(io_state != nullptr)
+      {
+        io_state->~io_operation_state();
+        io_state = nullptr;
+      }
+      buffer = {registered_buffer->data(), FILE_BENCHMARK_BLOCK};
+      finished = false;
+      initiated = std::chrono::high_resolution_clock::now();
+      io_state =
+      multiplexer->construct_and_init_io_operation(io_state_storage, &fh, this, llfio::io_multiplexer::registered_buffer_type(registered_buffer), {}, llfio_io_request({&buffer, 1}, offset));
+    }
+    virtual bool read_completed(llfio::io_multiplexer::io_operation_state::lock_guard & /*g*/, llfio::io_operation_state_type /*former*/, llfio_io_result &&res) override
+    {
+      completed = std::chrono::high_resolution_clock::now();
+      if(!res)
+      {
+        abort();
+      }
+      return true;
+    }
+    // May be called during initiation if the i/o completes immediately, so
+    // the state is destroyed by the next begin_io() rather than here
+    virtual void read_finished(llfio::io_multiplexer::io_operation_state::lock_guard & /*g*/, llfio::io_operation_state_type /*former*/) override
+    {
+      finished = true;
+    }
+  };
+  std::vector<slot_type> slots(queue_depth);
+  QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand;
+  auto random_offset = [&] { return (llfio::file_handle::extent_type)(rand() % (FILE_BENCHMARK_BYTES / FILE_BENCHMARK_BLOCK)) * FILE_BENCHMARK_BLOCK; };
+  for(auto &slot : slots)
+  {
+    slot.multiplexer = multiplexer.get();
+    slot.io_state_storage = multiplexer->allocate_io_operation_state_storage().value();
+    size_t bytes = FILE_BENCHMARK_BLOCK;
+    slot.registered_buffer = fh.allocate_registered_buffer(bytes).value();
+  }
+  std::vector<double> latencies;
+  latencies.reserve(1024 * 1024);
+  auto begin = std::chrono::high_resolution_clock::now();
+  for(auto &slot : slots)
+  {
+    slot.begin_io(fh, random_offset());
+  }
+  multiplexer->flush_inited_io_operations().value();
+  for(;;)
+  {
+    multiplexer->check_for_any_completed_io(std::chrono::seconds(1)).value();
+    bool initiated = false;
+    for(auto &slot : slots)
+    {
+      if(slot.finished)
+      {
+        latencies.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(slot.completed - slot.initiated).count());
+        slot.begin_io(fh, random_offset());
+        initiated = true;
+      }
+    }
+    if(initiated)
+    {
+      multiplexer->flush_inited_io_operations().value();
+    }
+    if(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - begin).count() >= BENCHMARK_DURATION)
+    {
+      break;
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  // Drain the i/o still in flight
+  for(auto &slot : slots)
+  {
+    while(!slot.finished)
+    {
+      multiplexer->check_for_any_completed_io(std::chrono::seconds(1)).value();
+    }
+  }
+  slots.clear();
+  fh.set_multiplexer(nullptr).value();
+  return summarise_file_benchmark(queue_depth, latencies, end - begin);
+}
+
+#ifdef _WIN32
+/* The raw Win32 API equivalent of do_file_benchmark() with multiplexer_win_iocp(), as the
+baseline which it ought to match.
+*/
+inline file_test_results do_win32_file_benchmark(size_t queue_depth)
+{
+  auto fh = llfio::file_handle::temp_file({}, llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::none,
+                                          llfio::file_handle::flag::unlink_on_first_close | llfio::file_handle::flag::multiplexable)
+            .value();
+  {
+    // Fill the file with data, so reads actually go to the device
+    size_t bytes = 1024 * 1024;
+    auto buffer = fh.allocate_registered_buffer(bytes).value();
+    memset(buffer->data(), 78, buffer->size());
+    for(size_t offset = 0; offset < FILE_BENCHMARK_BYTES; offset += 1024 * 1024)
+    {
+      llfio::file_handle::const_buffer_type b{buffer->data(), 1024 * 1024};
+      fh.write({{&b, 1}, offset}).value();
+    }
+  }
+  HANDLE iocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+  if(nullptr == iocp || nullptr == CreateIoCompletionPort(fh.native_handle().h, iocp, 0, 0))
+  {
+    abort();
+  }
+  const bool skip_completion_port_on_success = !!SetFileCompletionNotificationModes(fh.native_handle().h, FILE_SKIP_COMPLETION_PORT_ON_SUCCESS | FILE_SKIP_SET_EVENT_ON_HANDLE);
+
+  struct slot_type
+  {
+    OVERLAPPED ol;
+    void *buffer{nullptr};
+    std::chrono::high_resolution_clock::time_point initiated;
+  };
+  std::vector<slot_type> slots(queue_depth);
+  QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng rand;
+  std::vector<double> latencies;
+  latencies.reserve(1024 * 1024);
+  size_t in_flight = 0;
+  // Returns true if the read completed immediately
+  auto begin_io = [&](slot_type &slot) -> bool {
+    const auto offset = (uint64_t)(rand() % (FILE_BENCHMARK_BYTES / FILE_BENCHMARK_BLOCK)) * FILE_BENCHMARK_BLOCK;
+    memset(&slot.ol, 0, sizeof(slot.ol));
+    slot.ol.Offset = (DWORD)(offset & 0xffffffff);
+    slot.ol.OffsetHigh = (DWORD)(offset >> 32);
+    slot.initiated = std::chrono::high_resolution_clock::now();
+    if(ReadFile(fh.native_handle().h, slot.buffer, (DWORD) FILE_BENCHMARK_BLOCK, nullptr, &slot.ol))
+    {
+      if(skip_completion_port_on_success)
+      {
+        latencies.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - slot.initiated).count());
+        return true;
+      }
+    }
+    else if(GetLastError() != ERROR_IO_PENDING)
+    {
+      abort();
+    }
+    in_flight++;
+    return false;
+  };
+  for(auto &slot : slots)
+  {
+    slot.buffer = VirtualAlloc(nullptr, FILE_BENCHMARK_BLOCK, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if(slot.buffer == nullptr)
+    {
+      abort();
+    }
+  }
+  OVERLAPPED_ENTRY entries[64];
+  auto begin = std::chrono::high_resolution_clock::now();
+  for(auto &slot : slots)
+  {
+    while(begin_io(slot))
+    {
+    }
+  }
+  for(;;)
+  {
+    ULONG filled = 0;
+    if(!GetQueuedCompletionStatusEx(iocp, entries, 64, &filled, 1000, false))
+    {
+      abort();
+    }
+    const bool done = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - begin).count() >= BENCHMARK_DURATION;
+    for(ULONG n = 0; n < filled; n++)
+    {
+      auto *slot = CONTAINING_RECORD(entries[n].lpOverlapped, slot_type, ol);
+      in_flight--;
+      latencies.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - slot->initiated).count());
+      while(!done && begin_io(*slot))
+      {
+      }
+    }
+    if(done)
+    {
+      break;
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  // Drain the i/o still in flight
+  while(in_flight > 0)
+  {
+    ULONG filled = 0;
+    if(!GetQueuedCompletionStatusEx(iocp, entries, 64, &filled, 1000, false))
+    {
+      abort();
+    }
+    in_flight -= filled;
+  }
+  for(auto &slot : slots)
+  {
+    VirtualFree(slot.buffer, 0, MEM_RELEASE);
+  }
+  fh.close().value();
+  CloseHandle(iocp);
+  return summarise_file_benchmark(queue_depth, latencies, end - begin);
+}
+#endif
+
+template <class F> inline void file_benchmark_with(llfio::path_view csv, size_t max_queue_depth, const char *desc, F &&do_one)
+{
+  std::vector<file_test_results> results;
+  for(size_t n = 1; n <= max_queue_depth; n <<= 2)
+  {
+    std::cout << "\nBenchmarking " << desc << " with queue depth " << n << " ..." << std::endl;
+    auto res = do_one(n);
+    results.push_back(res);
+    std::cout << "   IOPS " << res.iops << " latency min " << res.min << " max " << res.max << " mean " << res.mean;
+    std::cout << "\n             @ 50% " << res._50 << " @ 99% " << res._99 << " @ 99.9% " << res._999;
+    std::cout << "\n   total results collected = " << res.total_readings << std::endl;
+  }
+  std::ofstream of(csv.path());
+  of << "\"Queue depth\"";
+  for(auto &i : results)
+  {
+    of << "," << i.queue_depth;
+  }
+  of << "\nIOPS";
+  for(auto &i : results)
+  {
+    of << "," << i.iops;
+  }
+  of << "\n";
+
+  of << "\nMins";
+  for(auto &i : results)
+  {
+    of << "," << i.min;
+  }
+  of << "\nMeans";
+  for(auto &i : results)
+  {
+    of << "," << i.mean;
+  }
+  of << "\n50%s";
+  for(auto &i : results)
+  {
+    of << "," << i._50;
+  }
+  of << "\n99%s";
+  for(auto &i : results)
+  {
+    of << "," << i._99;
+  }
+  of << "\n99.9%s";
+  for(auto &i : results)
+  {
+    of << "," << i._999;
+  }
+  of << "\nMaxs";
+  for(auto &i : results)
+  {
+    of << "," << i.max;
+  }
+  of << "\n";
+
+  for(size_t bucket = 0; bucket < FILE_BENCHMARK_HISTOGRAM_BUCKETS; bucket++)
+  {
+    if(bucket < FILE_BENCHMARK_HISTOGRAM_BUCKETS - 1)
+    {
+      of << "\n\"Histogram <= " << (1ULL << (FILE_BENCHMARK_HISTOGRAM_FIRST + bucket)) << "ns\"";
+    }
+    else
+    {
+      of << "\n\"Histogram > " << (1ULL << (FILE_BENCHMARK_HISTOGRAM_FIRST + bucket - 1)) << "ns\"";
+    }
+    for(auto &i : results)
+    {
+      of << "," << i.histogram[bucket];
+    }
+  }
+  of << "\n";
+}
+
+inline void file_benchmark(llfio::path_view csv, size_t max_queue_depth, const char *desc, llfio::io_multiplexer_ptr (*make_multiplexer)())
+{
+  file_benchmark_with(csv, max_queue_depth, desc, [&](size_t queue_depth) { return do_file_benchmark(queue_depth, make_multiplexer); });
+}
+
 int main(void)
 {
   std::cout << "Warming up ..." << std::endl;
@@ -1135,13 +1657,57 @@ int main(void)
 #ifdef _WIN32
   std::cout << "\nWarming up ..." << std::endl;
   do_benchmark<benchmark_llfio<llfio::pipe_handle>>(-1, //
-    []() -> llfio::io_multiplexer_ptr { return llfio::test::multiplexer_win_iocp(2, true).value(); });
+    []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_win_iocp(2, true).value(); });
   // No locking, enable IOCP immediate completions. ASIO can't compete with this.
   benchmark<benchmark_llfio<llfio::pipe_handle>>("llfio-pipe-handle-unsynchronised.csv", 64, "llfio::pipe_handle and IOCP unsynchronised", //
-    []() -> llfio::io_multiplexer_ptr { return llfio::test::multiplexer_win_iocp(1, false).value(); });
+    []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_win_iocp(1, false).value(); });
   // Locking enabled, disable IOCP immediate completions so it's a fair comparison with ASIO
   benchmark<benchmark_llfio<llfio::pipe_handle>>("llfio-pipe-handle-synchronised.csv", 64, "llfio::pipe_handle and IOCP synchronised", //
-    []() -> llfio::io_multiplexer_ptr { return llfio::test::multiplexer_win_iocp(2, true).value(); });
+    []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_win_iocp(2, true).value(); });
+  // The raw Win32 API with and without immediate completions, for parity with the two above
+  benchmark<benchmark_win32_pipe>("win32-pipe-handle-immediate.csv", 64, "Win32 pipe and IOCP with immediate completions", true);
+  benchmark<benchmark_win32_pipe>("win32-pipe-handle.csv", 64, "Win32 pipe and IOCP", false);
+#endif
+
+#ifdef __linux__
+  if(llfio::multiplexer_linux_io_uring(1))
+  {
+    std::cout << "\nWarming up ..." << std::endl;
+    do_benchmark<benchmark_llfio<llfio::pipe_handle>>(-1, //
+      []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_linux_io_uring(2).value(); });
+    benchmark<benchmark_llfio<llfio::pipe_handle>>("llfio-pipe-handle-io-uring-unsynchronised.csv", 64, "llfio::pipe_handle and io_uring unsynchronised", //
+      []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_linux_io_uring(1).value(); });
+    benchmark<benchmark_llfio<llfio::pipe_handle>>("llfio-pipe-handle-io-uring-synchronised.csv", 64, "llfio::pipe_handle and io_uring synchronised", //
+      []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_linux_io_uring(2).value(); });
+
+    file_benchmark("llfio-file-handle-io-uring.csv", 256, "uncached llfio::file_handle and io_uring", //
+      []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_linux_io_uring(1).value(); });
+    if(llfio::multiplexer_linux_io_uring(1, llfio::io_uring_multiplexer_flag::iopoll))
+    {
+      file_benchmark("llfio-file-handle-io-uring-iopoll.csv", 256, "uncached llfio::file_handle and io_uring with iopoll", //
+        []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_linux_io_uring(1, llfio::io_uring_multiplexer_flag::iopoll).value(); });
+    }
+  }
+  else
+  {
+    std::cout << "\nio_uring is not available on this kernel, skipping io_uring benchmarks." << std::endl;
+  }
+  benchmark<benchmark_llfio<llfio::pipe_handle>>("llfio-pipe-handle-epoll-unsynchronised.csv", 64, "llfio::pipe_handle and epoll unsynchronised", //
+    []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_linux_epoll(1).value(); });
+#endif
+#ifdef _WIN32
+  file_benchmark("llfio-file-handle-iocp.csv", 256, "uncached llfio::file_handle and IOCP", //
+    []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_win_iocp(1, false).value(); });
+  file_benchmark_with("win32-file-handle-iocp.csv", 256, "uncached Win32 file and IOCP", do_win32_file_benchmark);
+  if(llfio::multiplexer_win_ioring(1))
+  {
+    file_benchmark("llfio-file-handle-ioring.csv", 256, "uncached llfio::file_handle and IoRing", //
+      []() -> llfio::io_multiplexer_ptr { return llfio::multiplexer_win_ioring(1, false).value(); });
+  }
+  else
+  {
+    std::cout << "\nIoRing is not available on this system, skipping IoRing benchmarks." << std::endl;
+  }
 #endif
 
 #if ENABLE_ASIO
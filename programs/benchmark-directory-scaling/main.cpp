@@ -0,0 +1,229 @@
+/* Measures how create, lookup, enumerate and delete throughput scale with directory size
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+//! Lookups timed at each checkpoint
+#define LOOKUPS 1000
+
+//! Entries claimed by a worker thread at a time
+#define CLAIM 64
+
+#include "../../include/llfio/llfio.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace llfio = LLFIO_V2_NAMESPACE;
+
+using clock_type = std::chrono::steady_clock;
+
+static std::ofstream csv;
+static void report(const char *phase, size_t entries, size_t threads, size_t ops, clock_type::duration elapsed)
+{
+  const double rate = (double) ops / std::chrono::duration<double>(elapsed).count();
+  std::cout << std::left << std::setw(12) << phase << std::right << std::setw(12) << entries << std::setw(10) << threads << std::setw(16) << std::fixed << std::setprecision(0)
+            << rate << std::endl;
+  csv << phase << "," << entries << "," << threads << "," << rate << std::endl;
+}
+
+/* Calls f(idx) for every idx in [begin, end) using `threads` threads, returning the time
+taken. Any exception thrown by f is rethrown once all the threads have finished.
+*/
+template <class F> static clock_type::duration parallel_for(size_t threads, size_t begin, size_t end, F &&f)
+{
+  std::atomic<size_t> next{begin};
+  std::mutex lock;
+  std::exception_ptr failure;
+  std::vector<std::thread> workers;
+  const auto start = clock_type::now();
+  for(size_t t = 0; t < threads; t++)
+  {
+    workers.emplace_back([&] {
+      try
+      {
+        for(;;)
+        {
+          const size_t claimed = next.fetch_add(CLAIM, std::memory_order_relaxed);
+          if(claimed >= end)
+          {
+            return;
+          }
+          for(size_t idx = claimed; idx < (std::min)(claimed + CLAIM, end); idx++)
+          {
+            f(idx);
+          }
+        }
+      }
+      catch(...)
+      {
+        std::lock_guard<std::mutex> g(lock);
+        failure = std::current_exception();
+        next.store(end, std::memory_order_relaxed);
+      }
+    });
+  }
+  for(auto &worker : workers)
+  {
+    worker.join();
+  }
+  const auto elapsed = clock_type::now() - start;
+  if(failure)
+  {
+    std::rethrow_exception(failure);
+  }
+  return elapsed;
+}
+
+// Creation, lookup and deletion all go via the path, as a server handling requests would
+static void create_entry(const llfio::directory_handle &dh, size_t idx)
+{
+  llfio::file_handle::file(dh, std::to_string(idx), llfio::file_handle::mode::write, llfio::file_handle::creation::only_if_not_exist).value();
+}
+static void lookup_entry(const llfio::directory_handle &dh, size_t idx)
+{
+  llfio::file_handle::file(dh, std::to_string(idx), llfio::file_handle::mode::attr_read).value();
+}
+static void delete_entry(const llfio::directory_handle &dh, size_t idx)
+{
+  llfio::file_handle::file(dh, std::to_string(idx), llfio::file_handle::mode::write).value().unlink().value();
+}
+
+static size_t enumerate(const llfio::directory_handle &dh)
+{
+  static std::vector<llfio::directory_handle::buffer_type> entries_buffer(4096);
+  static llfio::directory_handle::buffers_type buffers;
+  size_t count = 0;
+  for(bool done = false; !done;)
+  {
+    buffers = dh.read({llfio::directory_handle::buffers_type(entries_buffer, std::move(buffers))}).value();
+    count += buffers.size();
+    done = buffers.done();
+  }
+  return count;
+}
+
+// Checkpoints of 1, 2 and 5 times each power of ten from 1000, up to and including max_entries
+static std::vector<size_t> checkpoints(size_t max_entries)
+{
+  std::vector<size_t> ret;
+  for(size_t decade = 1000; decade <= max_entries && ret.size() < 64; decade *= 10)
+  {
+    for(size_t m : {1, 2, 5})
+    {
+      if(decade * m < max_entries)
+      {
+        ret.push_back(decade * m);
+      }
+    }
+  }
+  ret.push_back(max_entries);
+  return ret;
+}
+
+int main(int argc, char *argv[])
+{
+  size_t max_entries = 1000000, threads = (std::max)(std::thread::hardware_concurrency(), 1U);
+  const char *path = ".";
+  for(int n = 1; n < argc; n++)
+  {
+    if(0 == strcmp(argv[n], "--threads") && n + 1 < argc)
+    {
+      threads = (size_t) strtoull(argv[++n], nullptr, 10);
+    }
+    else if(0 == strcmp(argv[n], "--path") && n + 1 < argc)
+    {
+      path = argv[++n];
+    }
+    else
+    {
+      max_entries = (size_t) strtoull(argv[n], nullptr, 10);
+    }
+    if(threads == 0 || max_entries == 0)
+    {
+      std::cerr << "Usage: " << argv[0] << " [--threads <concurrent creators and deleters>] [--path <directory on filesystem to test>] [<maximum directory entries>]\n"
+                << "Defaults to as many threads as CPUs, the current directory, and 1000000 entries. 10000000 finds where most filesystems degrade." << std::endl;
+      return 1;
+    }
+  }
+  try
+  {
+    auto base = llfio::path_handle::path(path).value();
+    auto dh = llfio::directory_handle::uniquely_named_directory(base).value();
+    csv.open("benchmark_directory_scaling.csv");
+    csv << "phase,entries,threads,ops_per_sec" << std::endl;
+    std::cout << "Testing directory " << dh.current_path().value() << " up to " << max_entries << " entries with " << threads << " threads.\n" << std::endl;
+    std::cout << std::left << std::setw(12) << "phase" << std::right << std::setw(12) << "entries" << std::setw(10) << "threads" << std::setw(16) << "ops/sec" << std::endl;
+
+    const auto sizes = checkpoints(max_entries);
+    std::mt19937_64 rng;
+    std::vector<size_t> sample(LOOKUPS);
+    size_t entries = 0;
+    for(auto size : sizes)
+    {
+      // Grow the directory to the checkpoint
+      report("create", size, threads, size - entries, parallel_for(threads, entries, size, [&](size_t idx) { create_entry(dh, idx); }));
+      entries = size;
+      // Look up a random sample of its entries
+      for(auto &i : sample)
+      {
+        i = rng() % entries;
+      }
+      report("lookup", entries, threads, LOOKUPS, parallel_for(threads, 0, LOOKUPS, [&](size_t idx) { lookup_entry(dh, sample[idx]); }));
+      // Enumerate all of its entries
+      const auto start = clock_type::now();
+      const size_t count = enumerate(dh);
+      report("enumerate", entries, 1, count, clock_type::now() - start);
+      if(count != entries)
+      {
+        std::cerr << "WARNING: Enumerated " << count << " entries, expected " << entries << std::endl;
+      }
+    }
+    // Shrink the directory back through the checkpoints
+    for(size_t n = sizes.size(); n > 0; n--)
+    {
+      const size_t to = (n > 1) ? sizes[n - 2] : 0;
+      report("delete", entries, threads, entries - to, parallel_for(threads, to, entries, [&](size_t idx) { delete_entry(dh, idx); }));
+      entries = to;
+    }
+    std::cout << "\nResults written to benchmark_directory_scaling.csv, plot ops_per_sec against entries per phase." << std::endl;
+    llfio::algorithm::reduce(std::move(dh)).value();
+  }
+  catch(const std::exception &e)
+  {
+    std::cerr << "FATAL: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -94,20 +94,47 @@ inline uint64_t nanoclock()
   return (uint64_t)((ticksclock() - offset) / ticks_per_sec);
 }
 
-template <class F> inline void run_test(const char *csv, off_t max_extent, F &&f)
+enum class access_pattern
 {
-  char buffer[MAXBLOCKSIZE];
-  std::vector<std::pair<unsigned, unsigned>> offsets(512 * 1024);
+  sequential,
+  random
+};
+static const char *const access_pattern_names[] = {"sequential", "random"};
+
+// File sizes tested, trimmed at runtime to the maximum requested on the command line
+static const uint64_t file_sizes[] = {4096ULL,
+                                      64ULL * 1024,
+                                      1024ULL * 1024,
+                                      16ULL * 1024 * 1024,
+                                      REGIONSIZE,
+                                      1024ULL * 1024 * 1024,
+                                      4ULL * 1024 * 1024 * 1024,
+                                      16ULL * 1024 * 1024 * 1024,
+                                      64ULL * 1024 * 1024 * 1024};
+
+template <class F> inline void run_test(const std::string &csv, uint64_t max_extent, access_pattern pattern, uint64_t alignment, F &&f)
+{
+  alignas(4096) char buffer[MAXBLOCKSIZE];
+  std::vector<std::pair<uint64_t, unsigned>> offsets(512 * 1024);
   std::vector<std::vector<unsigned>> results;
   for(size_t blocksize = MINBLOCKSIZE; blocksize <= MAXBLOCKSIZE; blocksize <<= 1)
   {
-    size_t scale = (512 * 1024) / (REGIONSIZE / blocksize) / 10;  // On average tap each block ten times
+    size_t scale = (size_t)((512 * 1024) / (max_extent / blocksize) / 10);  // On average tap each block ten times
     if(scale < 1)
       scale = 1;
     small_prng rand;
-    for(auto &i : offsets)
+    const uint64_t slots = (max_extent - blocksize) / alignment + 1;
+    for(size_t n = 0; n < offsets.size(); n++)
     {
-      i.first = (rand() % (max_extent - MAXBLOCKSIZE)) & ~15;
+      if(pattern == access_pattern::sequential)
+      {
+        offsets[n].first = (n * blocksize) % (max_extent / blocksize * blocksize);
+      }
+      else
+      {
+        const uint64_t r = ((uint64_t) rand() << 32) | rand();
+        offsets[n].first = (r % slots) * alignment;
+      }
     }
     memset(buffer, 0, sizeof(buffer));
     for(size_t n = 0; n < offsets.size() / scale; n++)
@@ -141,68 +168,141 @@ template <class F> inline void run_test(const char *csv, off_t max_extent, F &&f
   }
 }
 
-int main()
+static llfio::result<llfio::io_multiplexer_ptr> async_multiplexer()
 {
+#if defined(__linux__)
+  return llfio::multiplexer_linux_io_uring(1);
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+  return llfio::multiplexer_bsd_kqueue(1);
+#elif defined(_WIN32)
+  return llfio::multiplexer_win_iocp(1, false);
+#else
+  return llfio::errc::not_supported;
+#endif
+}
+
+static void make_testfile(uint64_t size)
+{
+  auto th = llfio::file({}, "testfile", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+  th.truncate(0).value();
+  std::vector<char> buffer((size_t) std::min<uint64_t>(size, 64 * 1024 * 1024), 'a');
+  for(uint64_t offset = 0; offset < size; offset += buffer.size())
   {
-    auto th = llfio::file({}, "testfile", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
-    std::vector<char> buffer(REGIONSIZE, 'a');
-    th.write(0, {{(llfio::byte *) buffer.data(), buffer.size()}}).value();
-    th.barrier({}, llfio::file_handle::barrier_kind::wait_all).value();
+    th.write(offset, {{(llfio::byte *) buffer.data(), buffer.size()}}).value();
+  }
+  th.barrier({}, llfio::file_handle::barrier_kind::wait_all).value();
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t max_file_size = REGIONSIZE;
+  if(argc > 1)
+  {
+    max_file_size = strtoull(argv[1], nullptr, 10);
+    if(max_file_size < MAXBLOCKSIZE)
+    {
+      std::cerr << "Usage: " << argv[0] << " [<maximum file size in bytes, default " << REGIONSIZE << ", at most " << file_sizes[sizeof(file_sizes) / sizeof(file_sizes[0]) - 1]
+                << ">]" << std::endl;
+      return 1;
+    }
   }
   {
     auto begin = nanoclock();
     while(nanoclock() - begin < 1000000000ULL)
       ;
   }
-#if 0
+  auto multiplexer = async_multiplexer();
+  if(!multiplexer)
   {
-    std::cout << "Testing latency of llfio::file_handle with random malloc/free ..." << std::endl;
-    auto th = llfio::file({}, "testfile").value();
-    std::vector<void *> allocations(1024 * 1024);
-    small_prng rand;
-    for(auto &i : allocations)
+    std::cout << "NOTE: No i/o multiplexer is available (" << multiplexer.error().message() << "), async reads will not be tested." << std::endl;
+  }
+  for(const uint64_t file_size : file_sizes)
+  {
+    if(file_size > max_file_size)
     {
-      i = malloc(rand() % 4096);
+      break;
     }
-    run_test("file_handle_malloc_free.csv", 1024 * 1024, [&](unsigned offset, char *buffer, size_t len) {
-      th.read(offset, {{(llfio::byte *) buffer, len}}).value();
-      for(size_t n = 0; n < rand() % 64; n++)
+    std::cout << "\nWriting " << file_size << " byte test file ..." << std::endl;
+    make_testfile(file_size);
+    for(const access_pattern pattern : {access_pattern::sequential, access_pattern::random})
+    {
+      const std::string suffix = std::string("_") + access_pattern_names[(int) pattern] + "_" + std::to_string(file_size) + ".csv";
+#if 0
       {
-        size_t i = rand() % (1024 * 1024);
-        if(allocations[i] == nullptr)
-          allocations[i] = malloc(rand() % 4096);
-        else
+        std::cout << "Testing latency of llfio::file_handle with random malloc/free ..." << std::endl;
+        auto th = llfio::file({}, "testfile").value();
+        std::vector<void *> allocations(1024 * 1024);
+        small_prng rand;
+        for(auto &i : allocations)
         {
-          free(allocations[i]);
-          allocations[i] = nullptr;
+          i = malloc(rand() % 4096);
         }
+        run_test("file_handle_malloc_free" + suffix, file_size, pattern, 16, [&](uint64_t offset, char *buffer, size_t len) {
+          th.read(offset, {{(llfio::byte *) buffer, len}}).value();
+          for(size_t n = 0; n < rand() % 64; n++)
+          {
+            size_t i = rand() % (1024 * 1024);
+            if(allocations[i] == nullptr)
+              allocations[i] = malloc(rand() % 4096);
+            else
+            {
+              free(allocations[i]);
+              allocations[i] = nullptr;
+            }
+          }
+        });
       }
-    });
-  }
 #endif
 #if 1
-  {
-    std::cout << "Testing latency of iostreams ..." << std::endl;
-    std::ifstream testfile("testfile");
-    testfile.exceptions(std::ios::failbit | std::ios::badbit);
-    run_test("iostreams.csv", REGIONSIZE, [&](unsigned offset, char *buffer, size_t len) {
-      testfile.seekg(offset, std::ios::beg);
-      testfile.read(buffer, len);
-    });
-  }
+      {
+        std::cout << "Testing " << access_pattern_names[(int) pattern] << " latency of iostreams ..." << std::endl;
+        std::ifstream testfile("testfile");
+        testfile.exceptions(std::ios::failbit | std::ios::badbit);
+        run_test("iostreams" + suffix, file_size, pattern, 16, [&](uint64_t offset, char *buffer, size_t len) {
+          testfile.seekg(offset, std::ios::beg);
+          testfile.read(buffer, len);
+        });
+      }
 #endif
-  {
-    std::cout << "Testing latency of llfio::file_handle ..." << std::endl;
-    auto th = llfio::file({}, "testfile").value();
-    run_test("file_handle.csv", REGIONSIZE, [&](unsigned offset, char *buffer, size_t len) { th.read(offset, {{(llfio::byte *) buffer, len}}).value(); });
-  }
+      {
+        std::cout << "Testing " << access_pattern_names[(int) pattern] << " latency of llfio::file_handle ..." << std::endl;
+        auto th = llfio::file({}, "testfile").value();
+        run_test("file_handle" + suffix, file_size, pattern, 16,
+                 [&](uint64_t offset, char *buffer, size_t len) { th.read(offset, {{(llfio::byte *) buffer, len}}).value(); });
+      }
 #if 1
-  {
-    std::cout << "Testing latency of llfio::mapped_file_handle ..." << std::endl;
-    auto th = llfio::mapped_file({}, "testfile").value();
-    run_test("mapped_file_handle.csv", REGIONSIZE, [&](unsigned offset, char *buffer, size_t len) { th.read(offset, {{(llfio::byte *) buffer, len}}).value(); });
-  }
+      {
+        std::cout << "Testing " << access_pattern_names[(int) pattern] << " latency of llfio::mapped_file_handle ..." << std::endl;
+        auto th = llfio::mapped_file({}, "testfile").value();
+        run_test("mapped_file_handle" + suffix, file_size, pattern, 16,
+                 [&](uint64_t offset, char *buffer, size_t len) { th.read(offset, {{(llfio::byte *) buffer, len}}).value(); });
+      }
+#endif
+#if 1
+      {
+        // Direct i/o needs offsets, lengths and buffers aligned to the device
+        std::cout << "Testing " << access_pattern_names[(int) pattern] << " latency of llfio::file_handle with caching::none ..." << std::endl;
+        auto th = llfio::file({}, "testfile", llfio::file_handle::mode::read, llfio::file_handle::creation::open_existing, llfio::file_handle::caching::none).value();
+        run_test("file_handle_uncached" + suffix, file_size, pattern, 4096,
+                 [&](uint64_t offset, char *buffer, size_t len) { th.read(offset, {{(llfio::byte *) buffer, len}}).value(); });
+      }
 #endif
+#if 1
+      if(multiplexer)
+      {
+        // Each read is initiated and reaped through the multiplexer, so this is async i/o at a queue depth of one
+        std::cout << "Testing " << access_pattern_names[(int) pattern] << " latency of llfio::file_handle with async reads ..." << std::endl;
+        auto th = llfio::file({}, "testfile", llfio::file_handle::mode::read, llfio::file_handle::creation::open_existing, llfio::file_handle::caching::all,
+                              llfio::file_handle::flag::multiplexable)
+                  .value();
+        th.set_multiplexer(multiplexer.value().get()).value();
+        run_test("file_handle_async" + suffix, file_size, pattern, 16,
+                 [&](uint64_t offset, char *buffer, size_t len) { th.read(offset, {{(llfio::byte *) buffer, len}}).value(); });
+        th.set_multiplexer(nullptr).value();
+      }
+#endif
+    }
+  }
 #if 1
   {
     std::cout << "Testing latency of memcpy ..." << std::endl;
@@ -217,71 +317,74 @@ int main()
       }
     }
 #endif
-    run_test("memcpy.csv", REGIONSIZE, [&](unsigned offset, char *buffer, size_t len) {
+    for(const access_pattern pattern : {access_pattern::sequential, access_pattern::random})
+    {
+      run_test(std::string("memcpy_") + access_pattern_names[(int) pattern] + "_" + std::to_string(REGIONSIZE) + ".csv", REGIONSIZE, pattern, 16, [&](uint64_t offset, char *buffer, size_t len) {
 #if 0
-      memcpy(buffer, th.address() + offset, len);
+        memcpy(buffer, th.address() + offset, len);
 #else
-      // Can't use memcpy, it gets elided
-      const llfio::byte *__restrict s = th.address() + offset;
+        // Can't use memcpy, it gets elided
+        const llfio::byte *__restrict s = th.address() + offset;
 #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
-      while(len >= 4 * sizeof(__m128i))
-      {
-        __m128i a = *(const __m128i *__restrict) s;
-        s += sizeof(__m128i);
-        __m128i b = *(const __m128i *__restrict) s;
-        s += sizeof(__m128i);
-        __m128i c = *(const __m128i *__restrict) s;
-        s += sizeof(__m128i);
-        __m128i d = *(const __m128i *__restrict) s;
-        s += sizeof(__m128i);
-        *(__m128i * __restrict) buffer = a;
-        buffer += sizeof(__m128i);
-        *(__m128i * __restrict) buffer = b;
-        buffer += sizeof(__m128i);
-        *(__m128i * __restrict) buffer = c;
-        buffer += sizeof(__m128i);
-        *(__m128i * __restrict) buffer = d;
-        buffer += sizeof(__m128i);
-        len -= 4 * sizeof(__m128i);
-      }
-      while(len >= sizeof(__m128i))
-      {
-        *(__m128i * __restrict) buffer = *(const __m128i *__restrict) s;
-        buffer += sizeof(__m128i);
-        s += sizeof(__m128i);
-        len -= sizeof(__m128i);
-      }
+        while(len >= 4 * sizeof(__m128i))
+        {
+          __m128i a = *(const __m128i *__restrict) s;
+          s += sizeof(__m128i);
+          __m128i b = *(const __m128i *__restrict) s;
+          s += sizeof(__m128i);
+          __m128i c = *(const __m128i *__restrict) s;
+          s += sizeof(__m128i);
+          __m128i d = *(const __m128i *__restrict) s;
+          s += sizeof(__m128i);
+          *(__m128i * __restrict) buffer = a;
+          buffer += sizeof(__m128i);
+          *(__m128i * __restrict) buffer = b;
+          buffer += sizeof(__m128i);
+          *(__m128i * __restrict) buffer = c;
+          buffer += sizeof(__m128i);
+          *(__m128i * __restrict) buffer = d;
+          buffer += sizeof(__m128i);
+          len -= 4 * sizeof(__m128i);
+        }
+        while(len >= sizeof(__m128i))
+        {
+          *(__m128i * __restrict) buffer = *(const __m128i *__restrict) s;
+          buffer += sizeof(__m128i);
+          s += sizeof(__m128i);
+          len -= sizeof(__m128i);
+        }
 #endif
-      while(len >= sizeof(uint64_t))
-      {
-        *(volatile uint64_t * __restrict) buffer = *(const uint64_t *__restrict) s;
-        buffer += sizeof(uint64_t);
-        s += sizeof(uint64_t);
-        len -= sizeof(uint64_t);
-      }
-      if(len >= sizeof(uint32_t))
-      {
-        *(volatile uint32_t * __restrict) buffer = *(const uint32_t *__restrict) s;
-        buffer += sizeof(uint32_t);
-        s += sizeof(uint32_t);
-        len -= sizeof(uint32_t);
-      }
-      if(len >= sizeof(uint16_t))
-      {
-        *(volatile uint16_t * __restrict) buffer = *(const uint16_t *__restrict) s;
-        buffer += sizeof(uint16_t);
-        s += sizeof(uint16_t);
-        len -= sizeof(uint16_t);
-      }
-      if(len >= sizeof(uint8_t))
-      {
-        *(volatile uint8_t * __restrict) buffer = *(const uint8_t *__restrict) s;
-        buffer += sizeof(uint8_t);
-        s += sizeof(uint8_t);
-        len -= sizeof(uint8_t);
-      }
+        while(len >= sizeof(uint64_t))
+        {
+          *(volatile uint64_t * __restrict) buffer = *(const uint64_t *__restrict) s;
+          buffer += sizeof(uint64_t);
+          s += sizeof(uint64_t);
+          len -= sizeof(uint64_t);
+        }
+        if(len >= sizeof(uint32_t))
+        {
+          *(volatile uint32_t * __restrict) buffer = *(const uint32_t *__restrict) s;
+          buffer += sizeof(uint32_t);
+          s += sizeof(uint32_t);
+          len -= sizeof(uint32_t);
+        }
+        if(len >= sizeof(uint16_t))
+        {
+          *(volatile uint16_t * __restrict) buffer = *(const uint16_t *__restrict) s;
+          buffer += sizeof(uint16_t);
+          s += sizeof(uint16_t);
+          len -= sizeof(uint16_t);
+        }
+        if(len >= sizeof(uint8_t))
+        {
+          *(volatile uint8_t * __restrict) buffer = *(const uint8_t *__restrict) s;
+          buffer += sizeof(uint8_t);
+          s += sizeof(uint8_t);
+          len -= sizeof(uint8_t);
+        }
 #endif
-    });
+      });
+    }
   }
 #endif
   llfio::filesystem::remove("testfile");
@@ -33,10 +33,16 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../include/llfio/llfio.hpp"
 #include "kerneltest/v1.0/child_process.hpp"
 
+#include <array>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #ifdef _WIN32
 #undef _CRT_NONSTDC_DEPRECATE
 #define _CRT_NONSTDC_DEPRECATE(a)
@@ -98,126 +104,370 @@ static void child_unlocks(size_t id)
   *shared_memory = (size_t) -1;
 }
 
-int main(int argc, char *argv[])
+//! Per-acquire latencies are binned by power of two nanoseconds, bucket N holding [2^N, 2^(N+1))
+static constexpr size_t latency_buckets = 40;
+using latency_histogram = std::array<unsigned long long, latency_buckets>;
+static inline size_t latency_bucket(unsigned long long ns) noexcept
 {
-  if(argc < 4)
+  size_t ret = 0;
+  while(ns > 1 && ret < latency_buckets - 1)
   {
-    std::cerr << "Usage: " << argv[0] << " [!]<atomic_append|byte_ranges|lock_files|memory_map> <entities> <no of waiters>" << std::endl;
-    return 1;
+    ns >>= 1;
+    ++ret;
   }
-  initialise_shared_memory();
-
-
-  // ******** MASTER PROCESS BEGINS HERE ********
-  if(strcmp(argv[1], "spawned") && strcmp(argv[1], "!spawned"))
+  return ret;
+}
+//! The upper bound in nanoseconds of the bucket containing the given fraction of all acquires
+static unsigned long long latency_percentile(const latency_histogram &h, double fraction)
+{
+  unsigned long long total = 0, sofar = 0;
+  for(auto i : h)
   {
-    size_t waiters = atoi(argv[3]);
-    if(!waiters || !atoi(argv[2]))
+    total += i;
+  }
+  for(size_t n = 0; n < latency_buckets; n++)
+  {
+    sofar += h[n];
+    if(total > 0 && sofar >= fraction * total)
     {
-      std::cerr << "Usage: " << argv[0] << " [!]<atomic_append|byte_ranges|lock_files|memory_map> <entities> <no of waiters>" << std::endl;
-      return 1;
+      return 2ULL << n;
     }
+  }
+  return 0;
+}
 
-    std::vector<child_process::child_process> children;
-    auto mypath = child_process::current_process_path();
-#ifdef UNICODE
-    std::vector<llfio::filesystem::path::string_type> args = {L"spawned", L"", L"", L"", L"00"};
-    args[1].resize(strlen(argv[1]));
-    for(size_t n = 0; n < args[1].size(); n++)
-      args[1][n] = argv[1][n];
-    args[2].resize(strlen(argv[2]));
-    for(size_t n = 0; n < args[2].size(); n++)
-      args[2][n] = argv[2][n];
-    args[3].resize(strlen(argv[3]));
-    for(size_t n = 0; n < args[3].size(); n++)
-      args[3][n] = argv[3][n];
-#else
-    std::vector<llfio::filesystem::path::string_type> args = {"spawned", argv[1], argv[2], argv[3], "00"};
-#endif
-    auto env = child_process::current_process_env();
-    std::cout << "Launching " << waiters << " copies of myself as a child process ..." << std::endl;
-    for(size_t n = 0; n < waiters; n++)
+enum class pin_mode
+{
+  none,
+  cores,
+  numa
+};
+static const char *const pin_mode_names[] = {"none", "cores", "numa"};
+static bool parse_pin_mode(const char *s, pin_mode &out)
+{
+  for(size_t n = 0; n < sizeof(pin_mode_names) / sizeof(pin_mode_names[0]); n++)
+  {
+    if(0 == strcmp(s, pin_mode_names[n]))
+    {
+      out = static_cast<pin_mode>(n);
+      return true;
+    }
+  }
+  return false;
+}
+#ifdef __linux__
+// Returns the CPUs of each NUMA node, parsed from /sys/devices/system/node/nodeN/cpulist
+static std::vector<std::vector<unsigned>> numa_nodes()
+{
+  std::vector<std::vector<unsigned>> ret;
+  for(unsigned node = 0;; node++)
+  {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if(!in || !std::getline(in, list))
     {
-      if(n >= 10)
+      break;
+    }
+    ret.emplace_back();
+    std::istringstream ranges(list);
+    std::string range;
+    while(std::getline(ranges, range, ','))
+    {
+      unsigned first = 0, last = 0;
+      const int items = sscanf(range.c_str(), "%u-%u", &first, &last);
+      if(items < 1)
       {
-        args[4][0] = (char) ('0' + (n / 10));
-        args[4][1] = (char) ('0' + (n % 10));
+        continue;
       }
-      else
+      if(items < 2)
       {
-        args[4][0] = (char) ('0' + n);
-        args[4][1] = 0;
+        last = first;
       }
-      auto child = child_process::child_process::launch(mypath, args, env, true);
-      if(child.has_error())
+      for(unsigned cpu = first; cpu <= last; cpu++)
       {
-        std::cerr << "FATAL: Child " << n << " could not be launched due to " << child.error().message() << std::endl;
-        return 1;
+        ret.back().push_back(cpu);
       }
-      children.push_back(std::move(child.value()));
     }
-    // Wait for all children to tell me they are ready
-    char buffer[1024];
-    std::cout << "Waiting for all children to become ready ..." << std::endl;
-    for(auto &child : children)
+  }
+  return ret;
+}
+#endif
+/* Pins this process to one core, or to all the cores of one NUMA node, chosen
+round robin by child index. Threads created afterwards inherit the pinning.
+*/
+static bool pin_process(pin_mode mode, size_t child)
+{
+  if(mode == pin_mode::none)
+  {
+    return true;
+  }
+  const unsigned cpus = std::max(1U, std::thread::hardware_concurrency());
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if(mode == pin_mode::cores)
+  {
+    CPU_SET(child % cpus, &set);
+  }
+  else
+  {
+    auto nodes = numa_nodes();
+    if(nodes.empty())
+    {
+      return false;
+    }
+    for(auto cpu : nodes[child % nodes.size()])
     {
-      auto &i = child.cout();
-      if(!i.getline(buffer, sizeof(buffer)))
-      {
-        std::cerr << "ERROR: Child seems to have vanished!" << std::endl;
-        return 1;
-      }
-      if(0 != strncmp(buffer, "READY", 5))
-      {
-        std::cerr << "ERROR: Child wrote unexpected output '" << buffer << "'" << std::endl;
-        return 1;
-      }
+      CPU_SET(cpu, &set);
+    }
+  }
+  return 0 == sched_setaffinity(0, sizeof(set), &set);
+#elif defined(_WIN32)
+  ULONGLONG mask = 0;
+  if(mode == pin_mode::cores)
+  {
+    mask = 1ULL << ((child % cpus) % 64);
+  }
+  else
+  {
+    ULONG highest = 0;
+    if(!GetNumaHighestNodeNumber(&highest) || !GetNumaNodeProcessorMask((UCHAR)(child % (highest + 1)), &mask))
+    {
+      return false;
+    }
+  }
+  return 0 != SetProcessAffinityMask(GetCurrentProcess(), (DWORD_PTR) mask);
+#else
+  (void) cpus;
+  (void) child;
+  return false;
+#endif
+}
+
+struct benchmark_result
+{
+  std::vector<unsigned long long> per_child;  // Locks acquired by each child
+  unsigned long long ops_per_sec{0};
+  latency_histogram latencies{};  // Summed over all children
+};
+
+/* Launches waiters copies of this program each repeatedly locking entities
+using the named algorithm for duration seconds.
+*/
+static bool run_benchmark(const char *algorithm, size_t entities, size_t waiters, pin_mode pinning, unsigned duration, benchmark_result &out)
+{
+  std::vector<child_process::child_process> children;
+  auto mypath = child_process::current_process_path();
+  auto to_arg = [](const std::string &v) { return llfio::filesystem::path::string_type(v.begin(), v.end()); };
+  std::vector<llfio::filesystem::path::string_type> args = {to_arg("spawned"), to_arg(algorithm), to_arg(std::to_string(entities)), to_arg(std::to_string(waiters)),
+                                                             to_arg("00"), to_arg(pin_mode_names[(int) pinning])};
+  auto env = child_process::current_process_env();
+  std::cout << "Launching " << waiters << " copies of myself as a child process ..." << std::endl;
+  for(size_t n = 0; n < waiters; n++)
+  {
+    if(n >= 10)
+    {
+      args[4][0] = (char) ('0' + (n / 10));
+      args[4][1] = (char) ('0' + (n % 10));
+    }
+    else
+    {
+      args[4][0] = (char) ('0' + n);
+      args[4][1] = 0;
+    }
+    auto child = child_process::child_process::launch(mypath, args, env, true);
+    if(child.has_error())
+    {
+      std::cerr << "FATAL: Child " << n << " could not be launched due to " << child.error().message() << std::endl;
+      return false;
     }
+    children.push_back(std::move(child.value()));
+  }
+  // Wait for all children to tell me they are ready
+  char buffer[1024];
+  std::cout << "Waiting for all children to become ready ..." << std::endl;
+  for(auto &child : children)
+  {
+    auto &i = child.cout();
+    if(!i.getline(buffer, sizeof(buffer)))
+    {
+      std::cerr << "ERROR: Child seems to have vanished!" << std::endl;
+      return false;
+    }
+    if(0 != strncmp(buffer, "READY", 5))
+    {
+      std::cerr << "ERROR: Child wrote unexpected output '" << buffer << "'" << std::endl;
+      return false;
+    }
+  }
 #if 0
-    std::cout << "Attach your debugger now and press Return" << std::endl;
-    getchar();
+  std::cout << "Attach your debugger now and press Return" << std::endl;
+  getchar();
 #endif
 #if 0
-    auto begin = std::chrono::steady_clock::now();
-    while(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin).count() < 2)
-      ;
+  auto begin = std::chrono::steady_clock::now();
+  while(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - begin).count() < 2)
+    ;
 #endif
-    std::cout << "Benchmarking for " << BENCHMARK_DURATION << " seconds ..." << std::endl;
-    // Issue go command to all children
-    for(auto &child : children)
-      child.cin() << "GO" << std::endl;
-    // Wait for benchmark to complete
-    std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_DURATION));
-    std::cout << "Stopping benchmark and telling children to report results ..." << std::endl;
-    // Tell children to quit
-    for(auto &child : children)
-      child.cin() << "STOP" << std::endl;
-    unsigned long long results = 0, result;
-    std::cout << std::endl;
-    std::ofstream oh("benchmark_locking.csv");
-    for(size_t n = 0; n < children.size(); n++)
+  std::cout << "Benchmarking for " << duration << " seconds ..." << std::endl;
+  // Issue go command to all children
+  for(auto &child : children)
+    child.cin() << "GO" << std::endl;
+  // Wait for benchmark to complete
+  std::this_thread::sleep_for(std::chrono::seconds(duration));
+  std::cout << "Stopping benchmark and telling children to report results ..." << std::endl;
+  // Tell children to quit
+  for(auto &child : children)
+    child.cin() << "STOP" << std::endl;
+  unsigned long long results = 0, result;
+  std::cout << std::endl;
+  out = benchmark_result();
+  for(size_t n = 0; n < children.size(); n++)
+  {
+    auto &child = children[n];
+    if(!child.cout().getline(buffer, sizeof(buffer)))
     {
-      auto &child = children[n];
-      if(!child.cout().getline(buffer, sizeof(buffer)))
-      {
-        std::cerr << "ERROR: Child seems to have vanished!" << std::endl;
-        return 1;
-      }
-      if(0 != strncmp(buffer, "RESULTS(", 8))
+      std::cerr << "ERROR: Child seems to have vanished!" << std::endl;
+      return false;
+    }
+    if(0 != strncmp(buffer, "RESULTS(", 8))
+    {
+      std::cerr << "ERROR: Child wrote unexpected output '" << buffer << "'." << std::endl;
+      return false;
+    }
+    result = atol(&buffer[8]);
+    std::cout << "Child " << n << " reports result " << result << std::endl;
+    results += result;
+    out.per_child.push_back(result);
+    if(!child.cout().getline(buffer, sizeof(buffer)) || 0 != strncmp(buffer, "HISTOGRAM(", 10))
+    {
+      std::cerr << "ERROR: Child did not report a latency histogram." << std::endl;
+      return false;
+    }
+    char *p = &buffer[10];
+    for(size_t b = 0; b < latency_buckets && *p != ')' && *p != 0; b++)
+    {
+      out.latencies[b] += strtoull(p, &p, 10);
+      if(*p == ',')
+        ++p;
+    }
+  }
+  out.ops_per_sec = results / duration;
+  std::cout << "Total result: " << out.ops_per_sec << " ops/sec, acquire latency 50% <" << latency_percentile(out.latencies, 0.5) << " ns, 99% <"
+            << latency_percentile(out.latencies, 0.99) << " ns, 99.99% <" << latency_percentile(out.latencies, 0.9999) << " ns" << std::endl;
+  return true;
+}
+
+// Parses a comma separated list of counts
+static std::vector<size_t> parse_counts(const char *s)
+{
+  std::vector<size_t> ret;
+  for(char *p = const_cast<char *>(s); *p != 0;)
+  {
+    auto v = (size_t) strtoull(p, &p, 10);
+    if(v > 0)
+      ret.push_back(v);
+    if(*p != ',')
+      break;
+    ++p;
+  }
+  return ret;
+}
+
+/* Runs every algorithm over every combination of entity and waiter counts,
+writing one CSV row per run with its throughput and acquire latency histogram.
+*/
+static int sweep(int argc, char *argv[])
+{
+  static const char *const algorithms[] = {"atomic_append", "byte_ranges", "lock_files", "memory_map", "safe_byte_ranges"};
+  std::vector<size_t> entity_counts = {1, 4, 16}, waiter_counts = {1, 2, 4, 8, 16};
+  pin_mode pinning = pin_mode::none;
+  unsigned duration = 3;
+  for(int n = 2; n < argc; n++)
+  {
+    if(0 == strncmp(argv[n], "--pin=", 6) && parse_pin_mode(argv[n] + 6, pinning))
+      continue;
+    if(0 == strncmp(argv[n], "--duration=", 11) && (duration = (unsigned) atoi(argv[n] + 11)) > 0)
+      continue;
+    if(0 == strncmp(argv[n], "--entities=", 11) && !(entity_counts = parse_counts(argv[n] + 11)).empty())
+      continue;
+    if(0 == strncmp(argv[n], "--waiters=", 10) && !(waiter_counts = parse_counts(argv[n] + 10)).empty())
+      continue;
+    std::cerr << "ERROR: Unknown or invalid sweep option '" << argv[n] << "'" << std::endl;
+    return 1;
+  }
+  std::ofstream oh("benchmark_locking_sweep.csv");
+  oh << "algorithm,entities,waiters,pinning,ops_per_sec,p50_ns,p99_ns,p99.99_ns";
+  for(size_t b = 0; b < latency_buckets; b++)
+    oh << ",lt_" << (2ULL << b) << "ns";
+  oh << std::endl;
+  for(const char *algorithm : algorithms)
+  {
+    for(size_t entities : entity_counts)
+    {
+      for(size_t waiters : waiter_counts)
       {
-        std::cerr << "ERROR: Child wrote unexpected output '" << buffer << "'." << std::endl;
-        return 1;
+        if(waiters > 99)
+        {
+          std::cerr << "WARNING: Skipping " << waiters << " waiters, at most 99 are supported." << std::endl;
+          continue;
+        }
+        std::cout << "\n" << algorithm << " with " << entities << " entities and " << waiters << " waiters:" << std::endl;
+        benchmark_result r;
+        if(!run_benchmark(algorithm, entities, waiters, pinning, duration, r))
+        {
+          return 1;
+        }
+        oh << algorithm << "," << entities << "," << waiters << "," << pin_mode_names[(int) pinning] << "," << r.ops_per_sec << "," << latency_percentile(r.latencies, 0.5) << ","
+           << latency_percentile(r.latencies, 0.99) << "," << latency_percentile(r.latencies, 0.9999);
+        for(auto i : r.latencies)
+          oh << "," << i;
+        oh << std::endl;
       }
-      result = atol(&buffer[8]);
-      std::cout << "Child " << n << " reports result " << result << std::endl;
-      results += result;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc > 1 && 0 == strcmp(argv[1], "--sweep"))
+  {
+    initialise_shared_memory();
+    return sweep(argc, argv);
+  }
+  if(argc < 4)
+  {
+    std::cerr << "Usage: " << argv[0] << " [!]<atomic_append|byte_ranges|lock_files|memory_map|safe_byte_ranges> <entities> <no of waiters> [<none|cores|numa>]\n       "
+              << argv[0] << " --sweep [--pin=<none|cores|numa>] [--duration=<secs>] [--entities=<n,...>] [--waiters=<n,...>]" << std::endl;
+    return 1;
+  }
+  initialise_shared_memory();
+
+
+  // ******** MASTER PROCESS BEGINS HERE ********
+  if(strcmp(argv[1], "spawned") && strcmp(argv[1], "!spawned"))
+  {
+    size_t waiters = atoi(argv[3]);
+    pin_mode pinning = pin_mode::none;
+    if(!waiters || !atoi(argv[2]) || (argc > 4 && !parse_pin_mode(argv[4], pinning)))
+    {
+      std::cerr << "Usage: " << argv[0] << " [!]<atomic_append|byte_ranges|lock_files|memory_map|safe_byte_ranges> <entities> <no of waiters> [<none|cores|numa>]" << std::endl;
+      return 1;
+    }
+    benchmark_result r;
+    if(!run_benchmark(argv[1], atoi(argv[2]), waiters, pinning, BENCHMARK_DURATION, r))
+    {
+      return 1;
+    }
+    std::ofstream oh("benchmark_locking.csv");
+    for(size_t n = 0; n < r.per_child.size(); n++)
+    {
       if(n)
         oh << ",";
-      oh << result;
+      oh << r.per_child[n];
     }
-    results /= BENCHMARK_DURATION;
-    std::cout << "Total result: " << results << " ops/sec" << std::endl;
-    oh << "\n" << results << std::endl;
+    oh << "\n" << r.ops_per_sec << std::endl;
     return 0;
   }
 
@@ -234,7 +484,8 @@ int main(int argc, char *argv[])
     atomic_append,
     byte_ranges,
     lock_files,
-    memory_map
+    memory_map,
+    safe_byte_ranges
   } test = lock_algorithm::unknown;
   bool contended = true;
   if(!strcmp(argv[2], "atomic_append"))
@@ -245,6 +496,8 @@ int main(int argc, char *argv[])
     test = lock_algorithm::lock_files;
   else if(!strcmp(argv[2], "memory_map"))
     test = lock_algorithm::memory_map;
+  else if(!strcmp(argv[2], "safe_byte_ranges"))
+    test = lock_algorithm::safe_byte_ranges;
   else if(!strcmp(argv[2], "!atomic_append"))
   {
     test = lock_algorithm::atomic_append;
@@ -265,6 +518,11 @@ int main(int argc, char *argv[])
     test = lock_algorithm::memory_map;
     contended = false;
   }
+  else if(!strcmp(argv[2], "!safe_byte_ranges"))
+  {
+    test = lock_algorithm::safe_byte_ranges;
+    contended = false;
+  }
   if(test == lock_algorithm::unknown)
   {
     std::cerr << "ERROR: unknown test requested" << std::endl;
@@ -277,11 +535,17 @@ int main(int argc, char *argv[])
     std::cerr << "ERROR: unknown total locks requested" << std::endl;
     return 1;
   }
+  pin_mode pinning = pin_mode::none;
+  if(argc > 6 && (!parse_pin_mode(argv[6], pinning) || !pin_process(pinning, this_child)))
+  {
+    std::cerr << "WARNING: Child " << this_child << " could not be pinned using '" << argv[6] << "'" << std::endl;
+  }
   // I am a spawned child. Tell parent I am ready.
   std::cout << "READY(" << this_child << ")" << std::endl;
   // Wait for parent to let me proceed
   std::atomic<int> done(-1);
-  std::thread worker([test, contended, total_locks, this_child, &done, &count] {
+  latency_histogram latencies{};
+  std::thread worker([test, contended, total_locks, this_child, &done, &count, &latencies] {
     std::unique_ptr<llfio::algorithm::shared_fs_mutex::shared_fs_mutex> algorithm;
     auto base = llfio::path_handle::path(".").value();
     switch(test)
@@ -330,6 +594,17 @@ int main(int argc, char *argv[])
       algorithm = std::make_unique<llfio::algorithm::shared_fs_mutex::memory_map<QUICKCPPLIB_NAMESPACE::algorithm::hash::passthru_hash>>(std::move(v.value()));
       break;
     }
+    case lock_algorithm::safe_byte_ranges:
+    {
+      auto v = llfio::algorithm::shared_fs_mutex::safe_byte_ranges::fs_mutex_safe_byte_ranges({}, "lockfile");
+      if(v.has_error())
+      {
+        std::cerr << "ERROR: Creation of lock algorithm returns " << v.error().message() << std::endl;
+        return;
+      }
+      algorithm = std::make_unique<llfio::algorithm::shared_fs_mutex::safe_byte_ranges>(std::move(v.value()));
+      break;
+    }
     case lock_algorithm::unknown:
       break;
     }
@@ -352,7 +627,9 @@ int main(int argc, char *argv[])
       std::this_thread::yield();
     while(!done)
     {
+      auto begin = std::chrono::steady_clock::now();
       auto result = algorithm->lock(entities, llfio::deadline(), false);
+      auto end = std::chrono::steady_clock::now();
       if(result.has_error())
       {
         std::cerr << "ERROR: Algorithm lock returns " << result.error().message() << std::endl;
@@ -361,6 +638,7 @@ int main(int argc, char *argv[])
       if(contended)
         child_locks(this_child);
       ++count;
+      ++latencies[latency_bucket((unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count())];
       auto guard = std::move(result.value());
       if(contended)
         child_unlocks(this_child);
@@ -411,6 +689,10 @@ int main(int argc, char *argv[])
         done = 1;
         worker.join();
         std::cout << "RESULTS(" << count << ")" << std::endl;
+        std::cout << "HISTOGRAM(";
+        for(size_t n = 0; n < latency_buckets; n++)
+          std::cout << (n ? "," : "") << latencies[n];
+        std::cout << ")" << std::endl;
 #if DEBUG_CSV
         std::ofstream s("benchmark_locking_llfio_log" + std::to_string(this_child) + ".csv");
         s << csv(llfio::log());
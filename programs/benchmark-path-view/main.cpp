@@ -0,0 +1,201 @@
+/* Test the performance of path_view and directory enumeration hot paths
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+//! Timed rounds per benchmark, the median of which is reported
+#define ROUNDS 11
+
+//! Minimum milliseconds per timed round
+#define ROUND_DURATION 50
+
+#include "../../include/llfio/llfio.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace llfio = LLFIO_V2_NAMESPACE;
+
+static volatile size_t sink;
+
+struct benchmark_result
+{
+  double median{0}, min{0}, max{0};  // nanoseconds per operation
+};
+
+/* Calibrates how many operations fill a round, then reports the median, min and
+max nanoseconds per operation over ROUNDS rounds. The median of many short
+rounds is far less sensitive to scheduler noise than one long round, so
+comparing runs can catch regressions.
+*/
+template <class F> inline benchmark_result run_benchmark(F &&f)
+{
+  using clock = std::chrono::high_resolution_clock;
+  size_t iterations = 1;
+  for(;;)
+  {
+    auto begin = clock::now();
+    for(size_t n = 0; n < iterations; n++)
+    {
+      f();
+    }
+    auto end = clock::now();
+    if(std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() >= ROUND_DURATION)
+    {
+      break;
+    }
+    iterations <<= 1;
+  }
+  std::vector<double> rounds;
+  for(size_t round = 0; round < ROUNDS; round++)
+  {
+    auto begin = clock::now();
+    for(size_t n = 0; n < iterations; n++)
+    {
+      f();
+    }
+    auto end = clock::now();
+    rounds.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / iterations);
+  }
+  std::sort(rounds.begin(), rounds.end());
+  benchmark_result ret;
+  ret.median = rounds[rounds.size() / 2];
+  ret.min = rounds.front();
+  ret.max = rounds.back();
+  return ret;
+}
+
+static std::ofstream csv;
+static void report(const std::string &name, benchmark_result r)
+{
+  std::cout << std::left << std::setw(56) << name << std::right << std::fixed << std::setprecision(2) << std::setw(12) << r.median << " ns (min " << r.min << ", max " << r.max
+            << ")" << std::endl;
+  csv << name << "," << r.median << "," << r.min << "," << r.max << std::endl;
+}
+
+static const char path_char[] = "/home/ned/Documents/boostish/llfio/programs/build_posix/testdir/0.txt";
+static const wchar_t path_wchar[] = L"/home/ned/Documents/boostish/llfio/programs/build_posix/testdir/0.txt";
+static const char16_t path_char16[] = u"/home/ned/Documents/boostish/llfio/programs/build_posix/testdir/0.txt";
+#if defined(__cpp_char8_t)
+static const char8_t path_char8[] = u8"/home/ned/Documents/boostish/llfio/programs/build_posix/testdir/0.txt";
+#endif
+
+template <class Char> static void benchmark_path_view(const char *type, const Char *path)
+{
+  const std::basic_string<Char> str(path);
+  const size_t len = str.size();
+  report(std::string("path_view(const ") + type + " *)", run_benchmark([&] {
+           llfio::path_view v(path);
+           sink = v.native_size();
+         }));
+  report(std::string("path_view(std::basic_string<") + type + ">)", run_benchmark([&] {
+           llfio::path_view v(str);
+           sink = v.native_size();
+         }));
+  // Zero terminated input in the native encoding is passed through without copying
+  report(std::string("path_view::c_str<>(") + type + ", zero terminated)", run_benchmark([&] {
+           llfio::path_view::c_str<> z(llfio::path_view(path, len, true));
+           sink = z.length;
+         }));
+  // Not zero terminated input must always be copied
+  report(std::string("path_view::c_str<>(") + type + ", not zero terminated)", run_benchmark([&] {
+           llfio::path_view::c_str<> z(llfio::path_view(path, len - 4, false));
+           sink = z.length;
+         }));
+  report(std::string("visit(path_view(") + type + "))", run_benchmark([&] {
+           sink = llfio::visit(llfio::path_view(path, len, true), [](auto sv) { return sv.size(); });
+         }));
+  report(std::string("path_view(") + type + ") component iteration", run_benchmark([&] {
+           size_t count = 0;
+           for(auto i : llfio::path_view(path, len, true))
+           {
+             count += i.native_size();
+           }
+           sink = count;
+         }));
+  report(std::string("path_view(") + type + ").filename()", run_benchmark([&] { sink = llfio::path_view(path, len, true).filename().native_size(); }));
+}
+
+static void benchmark_enumeration(size_t entries)
+{
+  const std::string dirname("benchmark_path_view_testdir" + std::to_string(entries));
+  auto dh = llfio::directory_handle::directory({}, dirname, llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed).value();
+  std::cout << "\nCreating " << entries << " files to enumerate, this may take a while ..." << std::endl;
+  for(size_t n = 0; n < entries; n++)
+  {
+    auto fh = llfio::file_handle::file(dh, std::to_string(n), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+  }
+  std::vector<llfio::directory_handle::buffer_type> entries_buffer(4096);
+  llfio::directory_handle::buffers_type buffers;
+  const auto r = run_benchmark([&] {
+    size_t count = 0;
+    for(bool done = false; !done;)
+    {
+      buffers = dh.read({llfio::directory_handle::buffers_type(entries_buffer, std::move(buffers))}).value();
+      count += buffers.size();
+      done = buffers.done();
+    }
+    sink = count;
+  });
+  // Report per entry so differently sized directories are comparable
+  report("directory_handle::read() of " + std::to_string(entries) + " entries, per entry", {r.median / entries, r.min / entries, r.max / entries});
+  llfio::algorithm::reduce(std::move(dh)).value();
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<size_t> entry_counts = {1000, 100000};
+  if(argc > 1)
+  {
+    entry_counts.clear();
+    for(int n = 1; n < argc; n++)
+    {
+      const auto v = (size_t) strtoull(argv[n], nullptr, 10);
+      if(v == 0)
+      {
+        std::cerr << "Usage: " << argv[0] << " [<directory entries to enumerate> ...], defaults to 1000 100000. 10000000 tests very large directories." << std::endl;
+        return 1;
+      }
+      entry_counts.push_back(v);
+    }
+  }
+  csv.open("benchmark_path_view.csv");
+  csv << "benchmark,median_ns,min_ns,max_ns" << std::endl;
+  std::cout << "Each benchmark is the median of " << ROUNDS << " rounds of at least " << ROUND_DURATION << " ms, in nanoseconds per operation.\n" << std::endl;
+  benchmark_path_view("char", path_char);
+  benchmark_path_view("wchar_t", path_wchar);
+  benchmark_path_view("char16_t", path_char16);
+#if defined(__cpp_char8_t)
+  benchmark_path_view("char8_t", path_char8);
+#endif
+  for(auto entries : entry_counts)
+  {
+    benchmark_enumeration(entries);
+  }
+  return 0;
+}
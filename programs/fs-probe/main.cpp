@@ -28,9 +28,11 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../include/llfio/llfio.hpp"
 #include "outcome/iostream_support.hpp"
 
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
 
 #ifdef __linux__
 #define file_handle LLFIO_V2_NAMESPACE::file_handle
@@ -51,32 +53,332 @@ static LLFIO_V2_NAMESPACE::storage_profile::storage_profile profile[permute_flag
     }                                                                                                                                                                                                                                                                                                                          \
   }
 
-int main(int argc, char *argv[])
+/* Flattens the last document in a results file written by this program into
+"direct=X sync=Y:section:...:name" => value. This is not a YAML parser, it
+only understands the indented subset which storage_profile::write() emits.
+*/
+static std::map<std::string, std::string> load_last_results(std::istream &in)
 {
-  using namespace LLFIO_V2_NAMESPACE;
-  using LLFIO_V2_NAMESPACE::byte;
-  std::regex torun(".*");
-  bool regexvalid = false;
-  unsigned torunflags = (1 << permute_flags_max) - 1;
-  if(argc > 1)
+  std::map<std::string, std::string> ret;
+  std::vector<std::pair<size_t, std::string>> sections;
+  std::string line;
+  while(std::getline(in, line))
   {
-    try
+    if(line.compare(0, 3, "---") == 0)
     {
-      torun.assign(argv[1]);
-      regexvalid = true;
+      ret.clear();
+      sections.clear();
+      continue;
     }
-    catch(...)
+    const size_t indent = line.find_first_not_of(' ');
+    if(indent == std::string::npos || line[indent] == '#')
     {
+      continue;
     }
-    if(argc > 2)
-      torunflags = atoi(argv[2]);
-    if(!regexvalid)
+    while(!sections.empty() && sections.back().first >= indent)
     {
-      std::cerr << "Usage: " << argv[0] << " <regex for tests to run> [<flags>]" << std::endl;
-      return 1;
+      sections.pop_back();
+    }
+    std::string key;
+    for(auto &i : sections)
+    {
+      key.append(i.second);
+      key.push_back(':');
+    }
+    const size_t colon = line.find(": ", indent);
+    if(colon == std::string::npos)
+    {
+      if(line.back() == ':')
+      {
+        sections.emplace_back(indent, line.substr(indent, line.size() - indent - 1));
+      }
+      continue;
+    }
+    key.append(line, indent, colon - indent);
+    ret[key] = line.substr(colon + 2);
+  }
+  return ret;
+}
+
+/* Turns the measurements from the last run into recommended LLFIO settings,
+printing the reasoning to stdout and writing the settings into a YAML file
+which programs can load at startup.
+*/
+static int recommend(const char *resultspath, const char *profilepath)
+{
+  std::ifstream in(resultspath);
+  if(!in)
+  {
+    std::cerr << "ERROR: Could not open results file '" << resultspath << "'" << std::endl;
+    return 1;
+  }
+  const auto results = load_last_results(in);
+  if(results.empty())
+  {
+    std::cerr << "ERROR: No results found in '" << resultspath << "'" << std::endl;
+    return 1;
+  }
+  static const char *const combinations[permute_flags_max][2] = {
+  {"direct=0 sync=0", "all"}, {"direct=1 sync=0", "only_metadata"}, {"direct=0 sync=1", "reads"}, {"direct=1 sync=1", "none"}};
+  auto find = [&](const std::string &key) -> const std::string * {
+    auto it = results.find(key);
+    return (it == results.end()) ? nullptr : &it->second;
+  };
+  auto number = [&](unsigned combination, const char *key) -> double {
+    const std::string *v = find(std::string(combinations[combination][0]) + ":" + key);
+    return (v == nullptr) ? -1 : atof(v->c_str());
+  };
+  // The cost of one 4Kb random read plus one 4Kb random write, or -1 if not measured
+  auto cost = [&](unsigned combination) -> double {
+    const double r = number(combination, "latency:read:qd1:mean"), w = number(combination, "latency:write:qd1:mean");
+    return (r < 0 || w < 0) ? -1 : (r + w);
+  };
+  auto best_of = [&](unsigned a, unsigned b) -> int {
+    const double ca = cost(a), cb = cost(b);
+    if(ca < 0 && cb < 0)
+    {
+      return -1;
+    }
+    if(cb < 0 || (ca >= 0 && ca <= cb))
+    {
+      return static_cast<int>(a);
+    }
+    return static_cast<int>(b);
+  };
+  std::map<std::string, std::string> profile;
+  if(auto *v = find("storage:fs:name"))
+  {
+    profile["storage_fs_name"] = *v;
+  }
+  if(auto *v = find("storage:device:name"))
+  {
+    profile["storage_device_name"] = *v;
+  }
+  if(auto *v = find("timestamp"))
+  {
+    profile["measured"] = *v;
+  }
+  std::cout << std::fixed << std::setprecision(0);
+  std::cout << "Recommendations from the measurements in '" << resultspath << "' taken " << (find("timestamp") ? *find("timestamp") : std::string("at an unknown time"))
+            << ":\n";
+
+  // 1. Caching mode for ordinary and for durable i/o
+  const int caching = best_of(0, 1), durable_caching = best_of(2, 3);
+  if(caching >= 0)
+  {
+    profile["caching"] = combinations[caching][1];
+    std::cout << "\n   caching = " << combinations[caching][1] << "\n      A 4Kb random read plus write costs " << cost(caching) << " ns with " << combinations[caching][0] << "\n";
+  }
+  if(durable_caching >= 0)
+  {
+    profile["durable_caching"] = combinations[durable_caching][1];
+    std::cout << "\n   durable_caching = " << combinations[durable_caching][1] << "\n      A 4Kb random read plus durable write costs " << cost(durable_caching) << " ns with "
+              << combinations[durable_caching][0] << "\n";
+  }
+
+  // 2. Write chunk size. Rewrites no smaller than the atomic quantum and no larger than
+  // the maximum aligned atomic rewrite are never seen torn by concurrent readers.
+  const unsigned chunk_combination = (caching >= 0) ? static_cast<unsigned>(caching) : 0;
+  {
+    const double quantum = number(chunk_combination, "concurrency:atomic_rewrite_quantum");
+    const double max_atomic = number(chunk_combination, "concurrency:max_aligned_atomic_rewrite");
+    const double min_io = atof(find("storage:device:min_io_size") ? find("storage:device:min_io_size")->c_str() : "512");
+    if(quantum > 0)
+    {
+      unsigned long long chunk = static_cast<unsigned long long>(quantum);
+      if(max_atomic >= quantum)
+      {
+        chunk = std::max(chunk, std::min(static_cast<unsigned long long>(max_atomic), 4096ULL));
+      }
+      if(min_io > 0)
+      {
+        const auto m = static_cast<unsigned long long>(min_io);
+        chunk = (chunk + m - 1) / m * m;
+      }
+      // Writes to RAID which do not cover whole stripes incur a read-modify-write
+      const double stripe = atof(find("storage:device:optimal_io_size") ? find("storage:device:optimal_io_size")->c_str() : "0");
+      if(stripe > 0 && stripe < 4294967295.0)
+      {
+        const auto m = static_cast<unsigned long long>(stripe);
+        chunk = (chunk + m - 1) / m * m;
+      }
+      profile["write_chunk_size"] = std::to_string(chunk);
+      std::cout << "\n   write_chunk_size = " << chunk << "\n      Atomic rewrite quantum is " << quantum << ", maximum aligned atomic rewrite is " << max_atomic
+                << ", device minimum i/o is " << min_io << ", device optimal i/o is " << stripe << "\n";
+    }
+  }
+  // Writes within the kernel advertised atomic write limits are not torn even by power loss, so
+  // write ahead logs need no double-write buffer for them
+  {
+    const double atomic_min = number(chunk_combination, "concurrency:kernel_atomic_write_unit_min");
+    const double atomic_max = number(chunk_combination, "concurrency:kernel_atomic_write_unit_max");
+    if(atomic_max > 0)
+    {
+      profile["atomic_write_unit_max"] = std::to_string(static_cast<unsigned long long>(atomic_max));
+      std::cout << "\n   atomic_write_unit_max = " << atomic_max << "\n      Writes with write_flag::atomic of a power of two between " << atomic_min << " and "
+                << atomic_max << " bytes, naturally aligned, are never torn\n";
+    }
+  }
+
+  // 3. Queue depth: the shallowest depth achieving 90% of the best measured throughput
+  {
+    static const unsigned depths[] = {1, 4, 16, 64, 256};
+    const char *source = nullptr;
+    unsigned depth = 0;
+    double iops = 0;
+    for(const char *op : {"read", "write"})
+    {
+      double measured[5], best = 0;
+      for(size_t n = 0; n < 5; n++)
+      {
+        measured[n] = number(chunk_combination, ("latency:" + std::string(op) + ":async:qd" + std::to_string(depths[n]) + ":iops").c_str());
+        best = std::max(best, measured[n]);
+      }
+      if(best > 0)
+      {
+        for(size_t n = 0; n < 5; n++)
+        {
+          if(measured[n] >= best * 0.9)
+          {
+            depth = depths[n];
+            iops = measured[n];
+            source = op;
+            break;
+          }
+        }
+        break;
+      }
+    }
+    if(source != nullptr)
+    {
+      profile["queue_depth"] = std::to_string(depth);
+      std::cout << "\n   queue_depth = " << depth << "\n      Achieves " << iops << " async 4Kb " << source << "s/sec, within 90% of the best measured\n";
+    }
+    else
+    {
+      // Fall back onto the thread emulated queue depths
+      const double qd1 = number(chunk_combination, "latency:read:qd1:mean"), qd16 = number(chunk_combination, "latency:read:qd16:mean");
+      if(qd1 > 0 && qd16 > 0)
+      {
+        depth = (16.0 / qd16 >= 1.5 / qd1) ? 16 : 1;
+        profile["queue_depth"] = std::to_string(depth);
+        std::cout << "\n   queue_depth = " << depth << "\n      Estimated from 16 threads reading at " << qd16 << " ns each versus one thread at " << qd1 << " ns\n";
+      }
+    }
+  }
+
+  // 4. Whether cached reads are cheaper through a memory map than through read()
+  {
+    const double map_read = number(0, "latency:read:mmap:qd1:mean"), syscall_read = number(0, "latency:read:qd1:mean");
+    if(map_read > 0 && syscall_read > 0)
+    {
+      profile["prefer_mmap_reads"] = (map_read < syscall_read) ? "true" : "false";
+      std::cout << "\n   prefer_mmap_reads = " << profile["prefer_mmap_reads"] << "\n      A 4Kb random read costs " << map_read << " ns through a map versus " << syscall_read
+                << " ns through read()\n";
+    }
+  }
+  // 5. The request size from which reads through a map, including its setup and teardown, are no slower
+  for(const char *pattern : {"random", "sequential"})
+  {
+    for(const char *cache : {"warm", "cold"})
+    {
+      const std::string key = std::string("latency:read:mmap_crossover:") + pattern + ":" + cache;
+      const double crossover = number(0, key.c_str());
+      if(crossover >= 0)
+      {
+        const std::string name = std::string("mmap_crossover_") + pattern + "_" + cache;
+        profile[name] = std::to_string(static_cast<unsigned long long>(crossover));
+        std::cout << "\n   " << name << " = " << profile[name] << "\n      " << ((crossover > 0) ? "Mapping is no slower from this request size upwards" : "read() is always faster")
+                  << " for " << pattern << " reads on a " << cache << " cache\n";
+      }
+    }
+  }
+
+  // 6. How many threads metadata operations scale to, as the shallowest depth achieving 90% of the best
+  {
+    static const char *const depths[] = {"1", "4", "16"};
+    for(const char *op : {"create", "stat", "rename", "unlink"})
+    {
+      double measured[3], best = 0;
+      for(size_t n = 0; n < 3; n++)
+      {
+        measured[n] = number(chunk_combination, ("response_time:metadata:" + std::string(op) + ":qd" + depths[n]).c_str());
+        best = std::max(best, measured[n]);
+      }
+      if(best > 0)
+      {
+        size_t n = 0;
+        while(measured[n] < best * 0.9)
+          n++;
+        const std::string name = std::string("metadata_") + op + "_threads";
+        profile[name] = depths[n];
+        std::cout << "\n   " << name << " = " << depths[n] << "\n      " << op << " achieves " << measured[n] << " ops/sec with " << depths[n] << " threads versus " << measured[0]
+                  << " ops/sec with one thread\n";
+      }
+    }
+  }
+
+  // 7. The caching mode which writes the fewest bytes to the device for the standard write mix,
+  // which minimises SSD wear, and the cache flushes each mode cost per megabyte written
+  {
+    static const char *const modes[] = {"all", "only_metadata", "reads", "reads_and_metadata", "none", "safety_barriers", "temporary"};
+    const char *least = nullptr;
+    double leastbytes = 0;
+    for(const char *mode : modes)
+    {
+      const std::string *v = find(std::string("storage:write_amplification:") + mode + ":bytes");
+      if(v != nullptr && (least == nullptr || atof(v->c_str()) < leastbytes))
+      {
+        least = mode;
+        leastbytes = atof(v->c_str());
+      }
+    }
+    if(least != nullptr)
+    {
+      profile["least_wear_caching"] = least;
+      std::cout << "\n   least_wear_caching = " << least << std::setprecision(2) << "\n      A byte written costs " << leastbytes << " bytes written to the device\n";
+      for(const char *mode : modes)
+      {
+        const std::string *bytes = find(std::string("storage:write_amplification:") + mode + ":bytes");
+        const std::string *flushes = find(std::string("storage:write_amplification:") + mode + ":flushes");
+        if(bytes != nullptr)
+        {
+          std::cout << "      caching::" << mode << " writes " << atof(bytes->c_str()) << " device bytes per byte";
+          if(flushes != nullptr)
+          {
+            // The standard write mix writes 12Mb
+            std::cout << " and issues " << atof(flushes->c_str()) / 12 << " flushes per Mb";
+          }
+          std::cout << "\n";
+        }
+      }
+      std::cout << std::setprecision(0);
     }
   }
 
+  std::ofstream out(profilepath);
+  if(!out)
+  {
+    std::cerr << "ERROR: Could not write profile file '" << profilepath << "'" << std::endl;
+    return 1;
+  }
+  out << "---\nllfio_profile:\n";
+  for(auto &i : profile)
+  {
+    out << "    " << i.first << ": " << i.second << "\n";
+  }
+  std::cout << "\nWrote " << profile.size() << " settings to '" << profilepath << "'" << std::endl;
+  return 0;
+}
+
+/* Profiles the filing system of the current directory, appending the results to
+fs_probe_results.yaml within it. If isolated, other devices are being profiled
+concurrently, so only the test files are evicted from the filesystem cache.
+*/
+static int probe(const std::regex &torun, unsigned torunflags, bool isolated)
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
   // Force extent allocation before test begins
   auto make_testfile = [](std::string name) {
     // Create file with O_SYNC
@@ -93,11 +395,12 @@ int main(int argc, char *argv[])
     file_handle::io_request<file_handle::const_buffers_type> reqs(_reqs, 0);
     RETCHECK(testfile.write(reqs));
   };
-  if(std::regex_match("latency:read:qd16", torun) || std::regex_match("latency:write:qd16", torun) || std::regex_match("latency:readwrite:qd4", torun))
+  const size_t testfiles = (std::regex_match("latency:read:qd16", torun) || std::regex_match("latency:write:qd16", torun) || std::regex_match("latency:readwrite:qd4", torun)) ? 16 : 0;
+  if(testfiles > 0)
   {
     std::cout << "Writing 17Gb of temporary test files, this will take a while ..." << std::endl;
     make_testfile("test");
-    for(size_t n = 0; n < 16; n++)
+    for(size_t n = 0; n < testfiles; n++)
       make_testfile(std::to_string(n));
   }
   else
@@ -107,6 +410,28 @@ int main(int argc, char *argv[])
   }
   // File closes, as it was opened with O_SYNC it forces extent allocation
   // Drop filesystem caches
+  if(isolated)
+  {
+    // Other devices are being probed concurrently, so evict only our own test files
+    std::cout << "Attempting to evict the test files from the filesystem cache ..." << std::endl;
+    auto evict = [](std::string name) -> result<void> {
+      OUTCOME_TRY(auto &&testfile, file_handle::file({}, name, handle::mode::read));
+      OUTCOME_TRY(testfile.evict_cache());
+      return success();
+    };
+    result<void> o = evict("test");
+    for(size_t n = 0; o && n < testfiles; n++)
+      o = evict(std::to_string(n));
+    if(o)
+    {
+      std::cout << "   Success!" << std::endl;
+    }
+    else
+    {
+      std::cout << "   WARNING: Failed due to " << o.error().message() << std::endl;
+    }
+  }
+  else
   {
     std::cout << "Attempting to flush all modified data in system and drop all filesystem caches ..." << std::endl;
     result<void> o = utils::drop_filesystem_cache();
@@ -122,6 +447,8 @@ int main(int argc, char *argv[])
   // Pause as Windows still takes a while
   std::cout << "Waiting for hard drive to quieten after temp files written ..." << std::endl;
   std::this_thread::sleep_for(std::chrono::seconds(10));
+  for(auto &p : profile)
+    p = storage_profile::storage_profile();
   std::ofstream results("fs_probe_results.yaml", std::ios::app);
   {
     auto put_time = [](const std::tm *tmb, const char *fmt) {
@@ -183,6 +510,16 @@ int main(int argc, char *argv[])
       results << "direct=" << !!(flags & 1) << " sync=" << !!(flags & 2) << ":\n";
       profile[flags].write(results, sp_preamble, 4, true);
       results.flush();
+      // Append a binary profile labelled with the device and caching, for aggregation by --csv
+      {
+        auto key = storage_profile::device_key(testfile);
+        std::ofstream binresults("fs_probe_results.bin", std::ios::app | std::ios::binary);
+        profile[flags].write_binary(binresults, key ? key.value() : std::string());
+      }
+      // Cache the profile for this device and caching, so programs can load it at startup
+      auto cached = storage_profile::save_cached(profile[flags], testfile);
+      if(!cached)
+        std::cerr << "WARNING: Failed to cache the profile for this device due to '" << cached.error().message() << "'" << std::endl;
     }
   }
   // Delete the test file
@@ -201,10 +538,210 @@ int main(int argc, char *argv[])
     }
   };
   delete_testfile("test");
-  if(std::regex_match("latency:read:qd16", torun) || std::regex_match("latency:write:qd16", torun) || std::regex_match("latency:readwrite:qd4", torun))
+  for(size_t n = 0; n < testfiles; n++)
+    delete_testfile(std::to_string(n));
+  return 0;
+}
+
+/* Profiles many mounts concurrently, with one child process per device. Mounts on the
+same device would skew each other's measurements, so each child profiles the mounts of
+its device serially. Each child chdirs into each of its mounts, so the results and the
+log of each probe are written into the mount profiled.
+*/
+static int probe_mounts(const char *self, const std::vector<std::string> &mounts, const std::vector<std::string> &testargs)
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  std::map<std::string, std::vector<std::string>> devices;
+  for(auto &mount : mounts)
+  {
+    auto dirh = directory_handle::directory({}, mount);
+    if(!dirh)
+    {
+      std::cerr << "ERROR: Could not open mount '" << mount << "' due to '" << dirh.error().message() << "'" << std::endl;
+      return 1;
+    }
+    statfs_t fsinfo;
+    auto filled = fsinfo.fill(dirh.value(), statfs_t::want::mntfromname);
+    if(!filled)
+    {
+      std::cerr << "ERROR: Could not determine the device of mount '" << mount << "' due to '" << filled.error().message() << "'" << std::endl;
+      return 1;
+    }
+    // The children change their working directory, so relative paths must be made absolute
+    devices[fsinfo.f_mntfromname].push_back(filesystem::absolute(mount).string());
+  }
+  auto mypath = process_handle::current().current_path();
+  const filesystem::path exepath = (mypath && !mypath.value().empty()) ? mypath.value() : filesystem::absolute(self);
+  std::vector<std::vector<std::string>> args;
+  for(auto &device : devices)
+  {
+    std::vector<std::string> a{"--in"};
+    a.insert(a.end(), device.second.begin(), device.second.end());
+    a.emplace_back("--");
+    a.insert(a.end(), testargs.begin(), testargs.end());
+    args.push_back(std::move(a));
+    std::cout << "Profiling device " << device.first << " at";
+    for(auto &mount : device.second)
+      std::cout << " " << mount;
+    std::cout << std::endl;
+  }
+  std::vector<std::vector<path_view_component>> argviews(args.size());
+  std::vector<process_handle::launch_request> reqs(args.size());
+  for(size_t n = 0; n < args.size(); n++)
+  {
+    for(auto &a : args[n])
+      argviews[n].emplace_back(a.c_str());
+    reqs[n] = {exepath, argviews[n], process_handle::flag::wait_on_close | process_handle::flag::no_redirect};
+  }
+  auto children = process_handle::launch_processes(reqs);
+  if(!children)
+  {
+    std::cerr << "ERROR: Could not launch child processes due to '" << children.error().message() << "'" << std::endl;
+    return 1;
+  }
+  std::vector<intptr_t> exitcodes(args.size());
+  auto waited = process_handle::wait_all(children.value(), exitcodes);
+  if(!waited)
+  {
+    std::cerr << "ERROR: Could not wait for child processes due to '" << waited.error().message() << "'" << std::endl;
+    return 1;
+  }
+  int ret = 0;
+  size_t n = 0;
+  for(auto &device : devices)
   {
-    for(size_t n = 0; n < 16; n++)
-      delete_testfile(std::to_string(n));
+    std::cout << "\nDevice " << device.first << " " << ((exitcodes[n] == 0) ? "succeeded" : "FAILED") << ", see fs_probe.log and fs_probe_results.yaml in";
+    for(auto &mount : device.second)
+      std::cout << " " << mount;
+    std::cout << std::endl;
+    if(exitcodes[n++] != 0)
+      ret = 1;
   }
+  return ret;
+}
+
+/* Exports the binary profiles in the files, each of which may hold many concatenated
+binary profiles as this program appends to fs_probe_results.bin, as comma separated
+values with a row per profile, for aggregating the results of many hosts.
+*/
+static int export_csv(const char *csvpath, const std::vector<std::string> &binpaths)
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  std::vector<mapped_file_handle> maps;
+  std::vector<storage_profile::binary_profile> profiles;
+  for(auto &binpath : binpaths)
+  {
+    auto mh = mapped_file_handle::mapped_file({}, binpath);
+    if(!mh)
+    {
+      std::cerr << "ERROR: Could not open binary results file '" << binpath << "' due to '" << mh.error().message() << "'" << std::endl;
+      return 1;
+    }
+    span<const byte> data(mh.value().address(), (size_t) mh.value().maximum_extent().value());
+    while(!data.empty())
+    {
+      auto profile = storage_profile::binary_profile::view(data);
+      if(!profile)
+      {
+        std::cerr << "ERROR: Binary results file '" << binpath << "' is corrupt due to '" << profile.error().message() << "'" << std::endl;
+        return 1;
+      }
+      data = data.subspan((size_t) reinterpret_cast<const storage_profile::binary_profile::header *>(data.data())->bytes);
+      profiles.push_back(std::move(profile).value());
+    }
+    maps.push_back(std::move(mh).value());
+  }
+  std::ofstream out(csvpath);
+  storage_profile::write_csv(out, profiles);
+  out.flush();
+  if(!out)
+  {
+    std::cerr << "ERROR: Could not write '" << csvpath << "'" << std::endl;
+    return 1;
+  }
+  std::cout << "Wrote " << profiles.size() << " profiles to '" << csvpath << "'" << std::endl;
   return 0;
 }
+
+int main(int argc, char *argv[])
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  std::regex torun(".*");
+  bool regexvalid = false;
+  unsigned torunflags = (1 << permute_flags_max) - 1;
+  if(argc > 1 && 0 == strcmp(argv[1], "--recommend"))
+  {
+    return recommend((argc > 2) ? argv[2] : "fs_probe_results.yaml", (argc > 3) ? argv[3] : "fs_probe_profile.yaml");
+  }
+  if(argc > 2 && 0 == strcmp(argv[1], "--csv"))
+  {
+    return export_csv(argv[2], (argc > 3) ? std::vector<std::string>(argv + 3, argv + argc) : std::vector<std::string>{"fs_probe_results.bin"});
+  }
+  // --mounts and --in take a list of directories, optionally followed by -- and the test arguments
+  std::vector<std::string> mounts;
+  const bool concurrent = (argc > 1 && 0 == strcmp(argv[1], "--mounts")), child = (argc > 1 && 0 == strcmp(argv[1], "--in"));
+  int argi = 1;
+  if(concurrent || child)
+  {
+    for(argi = 2; argi < argc && 0 != strcmp(argv[argi], "--"); argi++)
+      mounts.emplace_back(argv[argi]);
+    if(argi < argc)
+      argi++;
+    if(mounts.empty())
+    {
+      argi = argc + 1;
+    }
+  }
+  if(argi < argc)
+  {
+    try
+    {
+      torun.assign(argv[argi]);
+      regexvalid = true;
+    }
+    catch(...)
+    {
+    }
+    if(argi + 1 < argc)
+      torunflags = atoi(argv[argi + 1]);
+  }
+  else if(argi == argc)
+  {
+    regexvalid = true;
+  }
+  if(!regexvalid)
+  {
+    std::cerr << "Usage: " << argv[0] << " <regex for tests to run> [<flags>]\n       " << argv[0] << " --mounts <directory>... [-- <regex for tests to run> [<flags>]]\n       " << argv[0]
+              << " --recommend [<results.yaml> [<profile.yaml>]]\n       " << argv[0] << " --csv <output.csv> [<results.bin>...]" << std::endl;
+    return 1;
+  }
+  if(concurrent)
+  {
+    return probe_mounts(argv[0], mounts, std::vector<std::string>(argv + argi, argv + argc));
+  }
+  if(child)
+  {
+    int ret = 0;
+    for(auto &mount : mounts)
+    {
+      std::error_code ec;
+      filesystem::current_path(mount, ec);
+      if(ec)
+      {
+        std::cerr << "ERROR: Could not change directory to '" << mount << "' due to '" << ec.message() << "'" << std::endl;
+        ret = 1;
+        continue;
+      }
+      // Output from many children would interleave, so each probe logs into its mount
+      std::ofstream log("fs_probe.log", std::ios::app);
+      auto *oldout = std::cout.rdbuf(log.rdbuf());
+      auto *olderr = std::cerr.rdbuf(log.rdbuf());
+      if(probe(torun, torunflags, true) != 0)
+        ret = 1;
+      std::cout.rdbuf(oldout);
+      std::cerr.rdbuf(olderr);
+    }
+    return ret;
+  }
+  return probe(torun, torunflags, false);
+}
@@ -28,6 +28,17 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../../../include/llfio/llfio.hpp"
 #include "quickcpplib/algorithm/open_hash_index.hpp"
 
+#include "lz4_block.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <vector>
 
 namespace key_value_store
@@ -79,14 +90,6 @@ namespace key_value_store
     {
     }
   };
-  class index_full : std::runtime_error
-  {
-  public:
-    index_full()
-        : std::runtime_error("Failed to insert new key due to too many collisions, use a bigger index!")
-    {
-    }
-  };
   class transaction_aborted : std::runtime_error
   {
     key_type _key;
@@ -112,7 +115,7 @@ namespace key_value_store
         uint64_t transaction_counter;   // transaction counter when this was updated
         uint64_t value_offset : 58;     // Shifted left 6 as tail of blob record (value_tail) will always be on 64 byte boundary
         uint64_t value_identifier : 6;  // 0-47 is smallfile identifier, 48-63 is reserved for future usage
-        uint64_t length;                // Length in bytes
+        uint64_t length;                // Length in bytes, as in the value_tail of the record
       } history[4];
     };
     static_assert(sizeof(value_history) == 96, "value_history is wrong size");
@@ -128,7 +131,7 @@ namespace key_value_store
 
     struct index
     {
-      uint64_t magic;                              // versionmagic, currently "AFIOKV01" for valid, "DEADKV01" for requires repair
+      uint64_t magic;                              // versionmagic, currently "AFIOKV02" for valid, "DEADKV02" for requires repair
       std::atomic<uint64_t> transaction_counter;   // top 16 bits are number of keys changed this transaction, bottom 48 bits are monotonic counter
       uint128 hash;                                // Optional hash of index file written on last close to guard against systems which don't write mmaps properly
       std::atomic<unsigned> writes_occurring[48];  // Incremented just before an update, decremented after, per writer
@@ -136,6 +139,13 @@ namespace key_value_store
 
       uint64_t contents_hashed : 1;       // If records written are hashed and checked on fetch
       uint64_t key_is_hash_of_value : 1;  // On read, check hash of value equals key
+      uint64_t contents_compressed : 1;   // If values are compressed with lz4_block, using the preset dictionary in "dictionary" if it exists
+      uint64_t keys_filtered : 1;         // If every generation of hash table has a Bloom filter of every key ever inserted into it, in "bloom" or "bloom.<generation>"
+
+      std::atomic<uint32_t> generation;             // Generation of the newest hash table, which follows this header for generation zero, otherwise fills "index.<generation>"
+      std::atomic<uint32_t> oldest_generation;      // Generation of the oldest hash table in use, whose keys are moving into the newest if it is not the newest
+      std::atomic<uint64_t> keys[2];                // Number of keys in the hash tables of even and odd generations
+      std::atomic<uint64_t> smallfile_extents[48];  // Length of the complete records appended to each small file
     };
 
     struct value_tail
@@ -146,6 +156,49 @@ namespace key_value_store
       uint64_t length;               // (uint64_t)-1 means key was deleted
     };
     static_assert(sizeof(value_tail) == 48, "value_tail is wrong size");
+    /* Set in the length of a compressed value, which is then the length of the compressed bytes. These
+    are preceded by the uncompressed length as a uint64_t, so records remain walkable from their tails.
+    */
+    static constexpr uint64_t compressed_length_flag = 1ULL << 62;
+    //! The bytes a record stores before its tail, given the length in its `value_tail`
+    constexpr uint64_t stored_length(uint64_t length) { return (length == (uint64_t) -1) ? 0 : (length & ~compressed_length_flag); }
+    //! True if the length in a `value_tail` is that of a compressed value
+    constexpr bool is_compressed(uint64_t length) { return length != (uint64_t) -1 && (length & compressed_length_flag) != 0; }
+  }
+
+  namespace cache
+  {
+    // Entries are grouped into sets of this many, amongst which a key may be cached
+    static constexpr size_t ways = 8;
+    struct header
+    {
+      uint64_t magic;              // "AFIOKVC1"
+      uint32_t entries;            // Number of entries, a multiple of ways
+      uint32_t entry_size;         // Bytes per entry including any value, a multiple of 64
+      std::atomic<uint32_t> hand;  // CLOCK hand, shared by all sets
+    };
+    static_assert(sizeof(header) <= 64, "header is wrong size");
+    // Followed by the value
+    struct entry
+    {
+      std::atomic<uint32_t> sequence;    // Odd while the entry is being written
+      std::atomic<uint32_t> referenced;  // Set by readers, cleared by the CLOCK hand
+      key_type key;
+      uint64_t transaction_counter;  // transaction counter of the value held, zero if empty
+      uint64_t length;
+    };
+    static_assert(sizeof(entry) == 48, "entry is wrong size");
+  }
+
+  namespace bloom
+  {
+    // Followed by the blocks of the filter, each of one cache line
+    struct header
+    {
+      uint64_t magic;   // "AFIOKVB1"
+      uint64_t blocks;  // Number of 64 byte blocks, a power of two
+    };
+    static_assert(sizeof(header) <= 64, "header is wrong size");
   }
 
   class transaction;
@@ -164,20 +217,183 @@ namespace key_value_store
       std::vector<llfio::file_handle> blocking;
       std::vector<llfio::mapped_file_handle> mapped;
     } _smallfiles;
-    optional<index::open_hash_index> _index;
+    // A blocked Bloom filter of every key ever inserted into a generation of hash table, so lookups of
+    // keys never inserted cost one cache line rather than a probe of the table
+    struct _bloom_filter
+    {
+      llfio::file_handle file;
+      llfio::section_handle section;
+      optional<llfio::mapped<llfio::byte>> map;
+      std::atomic<uint64_t> *blocks{nullptr};  // null if the store has no filters
+      uint64_t mask{0};
+
+      static std::string name(uint32_t generation) { return (generation == 0) ? std::string("bloom") : ("bloom." + std::to_string(generation)); }
+      // Creates the filter of a generation of hash table, with 512 bits for every 32 of its entries. Racing
+      // growers all create the same file of the same size, unless the filter is to replace any existing one.
+      static void create(const llfio::path_handle &dir, uint32_t generation, size_t entries, llfio::file_handle::caching caching, bool replace)
+      {
+        bloom::header h;
+        memset(&h, 0, sizeof(h));
+        h.magic = _bloommagic;
+        h.blocks = 1;
+        while(h.blocks * 32 < entries)
+        {
+          h.blocks <<= 1;
+        }
+        auto fh = llfio::file_handle::file(dir, name(generation), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, caching).value();
+        if(replace)
+        {
+          fh.truncate(0).value();
+        }
+        if(fh.maximum_extent().value() < 64 + h.blocks * 64)
+        {
+          fh.truncate(64 + h.blocks * 64).value();
+          fh.write(0, {{(llfio::byte *) &h, sizeof(h)}}).value();
+        }
+      }
+      static _bloom_filter open(const llfio::path_handle &dir, uint32_t generation, llfio::file_handle::mode mode, llfio::section_handle::flag mapflags)
+      {
+        _bloom_filter ret;
+        auto fh = llfio::file_handle::file(dir, name(generation), mode, llfio::file_handle::creation::open_existing);
+        if(!fh)
+        {
+          throw corrupted_store();
+        }
+        ret.file = std::move(fh).value();
+        ret.section = llfio::section_handle::section(ret.file, 0, mapflags).value();
+        ret.map.emplace(ret.section, (size_t) -1, 0, mapflags);
+        auto *header = reinterpret_cast<bloom::header *>(ret.map->data());
+        if(header->magic != _bloommagic || header->blocks == 0 || (header->blocks & (header->blocks - 1)) != 0 || ret.map->size() < 64 + header->blocks * 64)
+        {
+          throw corrupted_store();
+        }
+        ret.blocks = reinterpret_cast<std::atomic<uint64_t> *>(ret.map->data() + 64);
+        ret.mask = header->blocks - 1;
+        return ret;
+      }
+      // Returns the eight words of the block for a key, and the hash choosing the bit in each
+      std::atomic<uint64_t> *block(key_type key, uint64_t &hash) const noexcept
+      {
+        uint64_t words[2];
+        memcpy(words, &key, sizeof(words));
+        hash = (words[0] * 0x9E3779B97F4A7C15ULL) ^ (words[1] * 0xC2B2AE3D27D4EB4FULL);
+        hash ^= hash >> 29;
+        return blocks + ((hash >> 32) & mask) * 8;
+      }
+      // The bit set in each word of the block is chosen from a different six bits of a remix of the hash
+      static uint64_t bit(uint64_t hash, unsigned word) noexcept { return 1ULL << (((hash * 0xFF51AFD7ED558CCDULL) >> (16U + word * 6U)) & 63U); }
+      // Adds a key, which must happen before the key is inserted into the hash table
+      void add(key_type key) noexcept
+      {
+        if(blocks == nullptr)
+          return;
+        uint64_t hash;
+        std::atomic<uint64_t> *b = block(key, hash);
+        for(unsigned n = 0; n < 8; n++)
+        {
+          const uint64_t m = bit(hash, n);
+          // Keys moving between generations are often added by several writers, which need not all dirty the line
+          if((b[n].load(std::memory_order_relaxed) & m) == 0)
+          {
+            b[n].fetch_or(m, std::memory_order_release);
+          }
+        }
+      }
+      // False if the key was never inserted into the hash table
+      bool may_contain(key_type key) const noexcept
+      {
+        if(blocks == nullptr)
+          return true;
+        uint64_t hash;
+        const std::atomic<uint64_t> *b = block(key, hash);
+        bool ret = true;
+        for(unsigned n = 0; n < 8; n++)
+        {
+          ret &= ((b[n].load(std::memory_order_acquire) & bit(hash, n)) != 0);
+        }
+        return ret;
+      }
+    };
+    // A generation of hash table
+    struct _hash_table
+    {
+      const uint32_t generation;
+      const size_t entries;
+      llfio::file_handle file;  // "index.<generation>", not used for generation zero
+      index::open_hash_index index;
+      _bloom_filter bloom;
+      _hash_table(uint32_t _generation, size_t _entries, llfio::file_handle &&_file, llfio::section_handle &sh, llfio::file_handle::extent_type offset, llfio::section_handle::flag mapflags, _bloom_filter &&_bloom)
+          : generation(_generation)
+          , entries(_entries)
+          , file(std::move(_file))
+          , index(sh, _entries, offset, mapflags)
+          , bloom(std::move(_bloom))
+      {
+      }
+    };
+    // The generations of hash table mapped and not yet superseded in every process. Those superseded are
+    // retired, and released by whichever operation on tables last finishes after they were retired.
+    std::vector<std::unique_ptr<_hash_table>> _tables, _retiredtables;
+    std::mutex _tableslock;
+    std::atomic<_hash_table *> _newtable{nullptr}, _oldtable{nullptr};
+    std::atomic<size_t> _tableusers{0};  // operations in flight which may hold pointers into hash tables
+    llfio::section_handle::flag _mapflags{llfio::section_handle::flag::none};
+    optional<llfio::mapped<llfio::byte>> _indexheadermap;
     index::index *_indexheader{nullptr};
+    std::vector<char> _dictionary;  // preset dictionary for compressed values
+    // Hot values shared by every process using the store, if use_cache() was called
+    llfio::file_handle _cachefile;
+    llfio::section_handle _cachesection;
+    optional<llfio::mapped<llfio::byte>> _cachemap;
+    cache::header *_cacheheader{nullptr};
+    // Keys in numeric order, if use_ordered_index() was called, caught up with each small file's records up to _orderedseen
+    struct _key_order
+    {
+      bool operator()(const key_type &a, const key_type &b) const noexcept { return (a.as_longlongs[1] != b.as_longlongs[1]) ? (a.as_longlongs[1] < b.as_longlongs[1]) : (a.as_longlongs[0] < b.as_longlongs[0]); }
+    };
+    std::mutex _orderedlock;
+    bool _ordered{false};
+    std::set<key_type, _key_order> _orderedkeys;
+    llfio::file_handle::extent_type _orderedseen[48]{};
+    // Commits are grouped: committers queue here, and whichever finds no group appending leads the next
     std::mutex _commitlock;
+    std::condition_variable _commitcond;
+    std::vector<transaction *> _commitqueue;
+    bool _commitleader{false};
     size_t _mmap_over_extension{0};
 
     static constexpr llfio::file_handle::extent_type _indexinuseoffset = INT64_MAX;
-    static constexpr uint64_t _goodmagic = 0x3130564b4f494641;  // "AFIOKV01"
-    static constexpr uint64_t _badmagic = 0x3130564b44414544;   // "DEADKV01"
+    static constexpr uint64_t _goodmagic = 0x3230564b4f494641;  // "AFIOKV02"
+    static constexpr uint64_t _badmagic = 0x3230564b44414544;   // "DEADKV02"
+    static constexpr uint64_t _cachemagic = 0x3143564b4f494641;  // "AFIOKVC1"
+    static constexpr uint64_t _bloommagic = 0x3142564b4f494641;  // "AFIOKVB1"
+#ifdef IOV_MAX
+    static constexpr size_t _max_gather = IOV_MAX;
+#else
+    static constexpr size_t _max_gather = 16;  // POSIX guarantees at least 16 gather buffers can be written in a single shot
+#endif
 
     static size_t _pad_length(size_t length)
     {
       // We append a value_tail record and round up to 64 byte multiple
       return (length + sizeof(index::value_tail) + 63) & ~63;
     }
+    llfio::file_handle &_smallfile(size_t n) { return _smallfiles.mapped.empty() ? _smallfiles.blocking[n] : _smallfiles.mapped[n]; }
+    // Waits for any commit group to finish appending to my small file, then keeps the next from starting
+    void _begin_appending()
+    {
+      std::unique_lock<decltype(_commitlock)> commitlockguard(_commitlock);
+      _commitcond.wait(commitlockguard, [this] { return !_commitleader; });
+      _commitleader = true;
+    }
+    void _end_appending() noexcept
+    {
+      {
+        std::lock_guard<decltype(_commitlock)> commitlockguard(_commitlock);
+        _commitleader = false;
+      }
+      _commitcond.notify_all();
+    }
     void _openfiles(const llfio::path_handle &dir, llfio::file_handle::mode mode, llfio::file_handle::caching caching)
     {
       const llfio::file_handle::mode smallfilemode =
@@ -244,20 +460,225 @@ namespace key_value_store
           throw maximum_writers_reached();
         }
         // Set up the index, either r/w or read only with copy on write
-        llfio::section_handle::flag mapflags = (mode == llfio::file_handle::mode::write) ? llfio::section_handle::flag::readwrite : (llfio::section_handle::flag::read | llfio::section_handle::flag::cow);
-        llfio::section_handle sh = llfio::section_handle::section(_indexfile, 0, mapflags).value();
-        llfio::file_handle::extent_type len = sh.length().value();
-        len -= sizeof(index::index);
-        len /= sizeof(index::open_hash_index::value_type);
-        size_t offset = sizeof(index::index);
-        _index.emplace(sh, len, offset, mapflags);
-        _indexheader = reinterpret_cast<index::index *>((char *) _index->container().data() - offset);
+        _mapflags = (mode == llfio::file_handle::mode::write) ? llfio::section_handle::flag::readwrite : (llfio::section_handle::flag::read | llfio::section_handle::flag::cow);
+        _indexheadermap.emplace(_indexfile, (size_t) -1, 0, 0, _mapflags);
+        _indexheader = reinterpret_cast<index::index *>(_indexheadermap->data());
         if(_indexheader->writes_occurring[_mysmallfileidx] != 0)
         {
           _indexheader->magic = _badmagic;
           throw corrupted_store();
         }
+        _sync_generation();
+      }
+    }
+
+    static std::string _table_name(uint32_t generation) { return "index." + std::to_string(generation); }
+    _hash_table &_map_table(uint32_t generation)
+    {
+      for(auto &table : _tables)
+      {
+        if(table->generation == generation)
+        {
+          return *table;
+        }
+      }
+      llfio::file_handle fh;
+      llfio::file_handle *backing = &_indexfile;
+      llfio::file_handle::extent_type offset = sizeof(index::index);
+      if(generation > 0)
+      {
+        fh = llfio::file_handle::file(_indexfile.parent_path_handle().value(), _table_name(generation), _indexfile.is_writable() ? llfio::file_handle::mode::write : llfio::file_handle::mode::read, llfio::file_handle::creation::open_existing, llfio::file_handle::caching::all, llfio::file_handle::flag::disable_prefetching).value();
+        backing = &fh;
+        offset = 0;
+      }
+      llfio::section_handle sh = llfio::section_handle::section(*backing, 0, _mapflags).value();
+      const size_t entries = (size_t)((sh.length().value() - offset) / sizeof(index::open_hash_index::value_type));
+      _bloom_filter bloom;
+      if(_indexheader->keys_filtered)
+      {
+        bloom = _bloom_filter::open(_indexfile.parent_path_handle().value(), generation, _indexfile.is_writable() ? llfio::file_handle::mode::write : llfio::file_handle::mode::read, _mapflags);
+      }
+      _tables.push_back(std::make_unique<_hash_table>(generation, entries, std::move(fh), sh, offset, _mapflags, std::move(bloom)));
+      return *_tables.back();
+    }
+    // Maps the generations of hash table the header says are in use, if these have changed
+    void _sync_generation()
+    {
+      const uint32_t generation = _indexheader->generation.load(std::memory_order_acquire), oldest = _indexheader->oldest_generation.load(std::memory_order_acquire);
+      _hash_table *newest = _newtable.load(std::memory_order_acquire), *old = _oldtable.load(std::memory_order_acquire);
+      if(newest != nullptr && newest->generation == generation && ((old == nullptr) ? generation : old->generation) == oldest)
+      {
+        return;
+      }
+      std::lock_guard<decltype(_tableslock)> tableslockguard(_tableslock);
+      _hash_table &newtable = _map_table(generation);
+      _hash_table *oldtable = (oldest != generation) ? &_map_table(oldest) : nullptr;
+      // Publish the previous generation first, so anyone seeing the newest also sees where keys may still be
+      _oldtable.store(oldtable, std::memory_order_release);
+      _newtable.store(&newtable, std::memory_order_release);
+      // Generations before the oldest are superseded in every process, and now unreachable by operations yet to begin
+      for(auto it = _tables.begin(); it != _tables.end();)
+      {
+        if((*it)->generation < oldest)
+        {
+          _retiredtables.push_back(std::move(*it));
+          it = _tables.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+    // Held by every operation using generations of hash table for as long as it holds pointers into them
+    class _tables_guard
+    {
+      basic_key_value_store *_parent;
+
+    public:
+      explicit _tables_guard(basic_key_value_store *parent) noexcept
+          : _parent(parent)
+      {
+        _parent->_tableusers.fetch_add(1, std::memory_order_acq_rel);
+      }
+      _tables_guard(const _tables_guard &) = delete;
+      _tables_guard &operator=(const _tables_guard &) = delete;
+      ~_tables_guard()
+      {
+        if(_parent->_tableusers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          _parent->_release_retired_tables();
+        }
+      }
+    };
+    // Releases the retired generations of hash table if no operation which may hold them is in flight
+    void _release_retired_tables() noexcept
+    {
+      std::unique_lock<decltype(_tableslock)> tableslockguard(_tableslock, std::try_to_lock);
+      if(!tableslockguard.owns_lock() || _retiredtables.empty())
+      {
+        return;
+      }
+      /* Tables are retired under the lock, so this exchange follows every retirement seen. Operations
+      beginning after it synchronise with it, so see the tables retired already unpublished. Operations
+      begun before it must have finished if no users are left.
+      */
+      size_t expected = 0;
+      if(_tableusers.compare_exchange_strong(expected, 0, std::memory_order_acq_rel))
+      {
+        _retiredtables.clear();
+      }
+    }
+    // The generations of hash table a key may be in, the one it is leaving first
+    std::pair<_hash_table *, _hash_table *> _tables_in_use() noexcept
+    {
+      _hash_table *newest = _newtable.load(std::memory_order_acquire), *old = _oldtable.load(std::memory_order_acquire);
+      return {(old == newest) ? nullptr : old, newest};
+    }
+    /* Keys move into the newest generation before they leave the previous one, so looking in the
+    previous generation first and in the newest second never misses a key being moved.
+    */
+    index::open_hash_index::const_iterator _find_shared(key_type key, bool &found)
+    {
+      _sync_generation();
+      auto tables = _tables_in_use();
+      for(_hash_table *table : {tables.first, tables.second})
+      {
+        if(table != nullptr)
+        {
+          auto it = table->index.find_shared(key);
+          if(it != table->index.end())
+          {
+            found = true;
+            return it;
+          }
+        }
+      }
+      found = false;
+      return {};
+    }
+    index::open_hash_index::iterator _find_exclusive(key_type key, bool &found)
+    {
+      _sync_generation();
+      auto tables = _tables_in_use();
+      for(_hash_table *table : {tables.first, tables.second})
+      {
+        if(table != nullptr)
+        {
+          auto it = table->index.find_exclusive(key);
+          if(it != table->index.end())
+          {
+            found = true;
+            return it;
+          }
+        }
+      }
+      found = false;
+      return {};
+    }
+    // Moves a key from the previous generation of hash table into the newest, if it is still in the previous one
+    void _migrate(_hash_table *from, _hash_table *to, key_type key)
+    {
+      auto fromit = from->index.find_exclusive(key);
+      if(fromit == from->index.end())
+      {
+        return;
+      }
+      _indexheader->writes_occurring[_mysmallfileidx].fetch_add(1);
+      auto toit = to->index.find_exclusive(key);
+      if(toit == to->index.end())
+      {
+        to->bloom.add(key);
+        toit = to->index.insert({key, fromit->second}).first;
+        if(toit == to->index.end())
+        {
+          // Commits keep room in the newest for every key still to move, so only racing writers get here
+          _indexheader->writes_occurring[_mysmallfileidx].fetch_sub(1);
+          return;
+        }
+        _indexheader->keys[to->generation % 2].fetch_add(1);
+      }
+      from->index.erase(std::move(fromit));
+      _indexheader->keys[from->generation % 2].fetch_sub(1);
+      _indexheader->writes_occurring[_mysmallfileidx].fetch_sub(1);
+    }
+    void _migrate(key_type key)
+    {
+      auto tables = _tables_in_use();
+      if(tables.first != nullptr)
+      {
+        _migrate(tables.first, tables.second, key);
+      }
+    }
+    // Grows the index into a new generation of hash table twice the size of the newest
+    void _grow(_hash_table *newest)
+    {
+      // Only two generations may be in use at once. migrate() finds every key with records below the
+      // small files' recorded extents, so this only repeats for keys inserted into the previous
+      // generation by writers yet to notice it was superseded.
+      while(!migrate())
+      {
+        std::this_thread::yield();
+      }
+      const uint32_t generation = newest->generation + 1;
+      if(_indexheader->generation.load(std::memory_order_acquire) == newest->generation)
+      {
+        // Racing growers all create the same file of the same size
+        auto fh = llfio::file_handle::file(_indexfile.parent_path_handle().value(), _table_name(generation), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::all, llfio::file_handle::flag::disable_prefetching).value();
+        llfio::file_handle::extent_type size = 2 * newest->entries * sizeof(index::open_hash_index::value_type);
+        size = llfio::utils::round_up_to_page_size(size, llfio::utils::page_size());
+        if(fh.maximum_extent().value() < size)
+        {
+          fh.truncate(size).value();
+        }
+        if(_indexheader->keys_filtered)
+        {
+          _bloom_filter::create(_indexfile.parent_path_handle().value(), generation, 2 * newest->entries, llfio::file_handle::caching::all, false);
+        }
+        uint32_t expected = newest->generation;
+        _indexheader->generation.compare_exchange_strong(expected, generation, std::memory_order_acq_rel);
       }
+      _sync_generation();
     }
 
   public:
@@ -266,7 +687,7 @@ namespace key_value_store
     basic_key_value_store &operator=(const basic_key_value_store &) = delete;
     basic_key_value_store &operator=(basic_key_value_store &&) = delete;
 
-    basic_key_value_store(const llfio::path_handle &dir, size_t hashtableentries, bool enable_integrity = false, llfio::file_handle::mode mode = llfio::file_handle::mode::write, llfio::file_handle::caching caching = llfio::file_handle::caching::all)
+    basic_key_value_store(const llfio::path_handle &dir, size_t hashtableentries, bool enable_integrity = false, llfio::file_handle::mode mode = llfio::file_handle::mode::write, llfio::file_handle::caching caching = llfio::file_handle::caching::all, bool enable_compression = false, span<const char> dictionary = {})
         : _indexfile(llfio::file_handle::file(dir, "index", mode, (mode == llfio::file_handle::mode::write) ? llfio::file_handle::creation::if_needed : llfio::file_handle::creation::open_existing, caching, llfio::file_handle::flag::disable_prefetching).value())
     {
       if(mode == llfio::file_handle::mode::write)
@@ -276,6 +697,14 @@ namespace key_value_store
         if(indexinuse.has_value())
         {
           // I am the first entrant into this data store
+          {
+            // Cached values are only valid while the store is in use
+            auto cachefile = llfio::file_handle::file(dir, "cache", llfio::file_handle::mode::write, llfio::file_handle::creation::open_existing);
+            if(cachefile)
+            {
+              cachefile.value().unlink().value();
+            }
+          }
           if(_indexfile.maximum_extent().value() == 0)
           {
             llfio::file_handle::extent_type size = sizeof(index::index) + (hashtableentries) * sizeof(index::open_hash_index::value_type);
@@ -286,6 +715,19 @@ namespace key_value_store
             i.magic = _goodmagic;
             i.all_writes_synced = _indexfile.are_writes_durable();
             i.contents_hashed = enable_integrity;
+            i.contents_compressed = enable_compression;
+            i.keys_filtered = true;
+            _bloom_filter::create(dir, 0, hashtableentries, caching, true);
+            if(enable_compression && !dictionary.empty())
+            {
+              // Matches only reach back 64Kb, so the end of the dictionary is all which is useful
+              if(dictionary.size() > lz4_block::max_distance)
+              {
+                dictionary = dictionary.subspan(dictionary.size() - lz4_block::max_distance);
+              }
+              auto dictfile = llfio::file_handle::file(dir, "dictionary", llfio::file_handle::mode::write, llfio::file_handle::creation::always_new, caching).value();
+              dictfile.write(0, {{(const llfio::byte *) dictionary.data(), dictionary.size()}}).value();
+            }
             _indexfile.write(0, {{(llfio::byte *) &i, sizeof(i)}}).value();
           }
           else
@@ -324,14 +766,23 @@ namespace key_value_store
       }
       // Open our smallfiles and map our index for shared usage
       _openfiles(dir, mode, caching);
+      if(_indexheader->contents_compressed)
+      {
+        auto dictfile = llfio::file_handle::file(dir, "dictionary", llfio::file_handle::mode::read, llfio::file_handle::creation::open_existing);
+        if(dictfile)
+        {
+          _dictionary.resize((size_t) dictfile.value().maximum_extent().value());
+          dictfile.value().read(0, {{(llfio::byte *) _dictionary.data(), _dictionary.size()}}).value();
+        }
+      }
       if(!_indexfile.are_writes_durable())
       {
         _indexheader->all_writes_synced = false;
       }
     }
     //! \overload
-    basic_key_value_store(const llfio::path_view &dir, size_t hashtableentries, bool enable_integrity = false, llfio::file_handle::mode mode = llfio::file_handle::mode::write, llfio::file_handle::caching caching = llfio::file_handle::caching::all)
-        : basic_key_value_store(llfio::directory_handle::directory({}, dir, llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed).value(), hashtableentries, enable_integrity, mode, caching)
+    basic_key_value_store(const llfio::path_view &dir, size_t hashtableentries, bool enable_integrity = false, llfio::file_handle::mode mode = llfio::file_handle::mode::write, llfio::file_handle::caching caching = llfio::file_handle::caching::all, bool enable_compression = false, span<const char> dictionary = {})
+        : basic_key_value_store(llfio::directory_handle::directory({}, dir, llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed).value(), hashtableentries, enable_integrity, mode, caching, enable_compression, dictionary)
     {
     }
     //! Opens the store for read only access
@@ -379,161 +830,1200 @@ namespace key_value_store
       _mmap_over_extension = overextension;
     }
 
-    //! Retrieve when keys were last updated by setting the second to the latest transaction counter.
-    //! Note that counter will be `(uint64_t)-1` for any unknown keys. Never throws exceptions.
-    void last_updated(span<std::pair<key_type, uint64_t>> keys) noexcept
+    /*! \brief Sets whether to keep hot values in a cache shared by every process using the store.
+
+    The cache is the "cache" file of the store, mapped into each process which calls this, and is
+    discarded whenever the store is opened with no other users. It holds `entries` values of up to
+    `valuebytes` each, unless a cache of other dimensions exists already, in which case that is used.
+    Values are cached once verified, and only where fetching would copy, verify or decompress them.
+    An entry is used only if its transaction counter is still the one in the index, so updates never
+    need to invalidate the cache.
+    */
+    void use_cache(size_t entries = 65536, size_t valuebytes = 1024)
     {
-      for(auto &key : keys)
+      if(_cacheheader != nullptr)
+        return;
+      _cachefile = llfio::file_handle::file(_indexfile.parent_path_handle().value(), "cache", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::temporary).value();
       {
-        auto it = _index->find_shared(key.first);
-        if(it == _index->end())
+        // Whoever first locks an empty cache sets it up
+        auto cacheguard = _cachefile.lock_file_range(_indexinuseoffset, 1, llfio::lock_kind::exclusive).value();
+        if(_cachefile.maximum_extent().value() == 0)
         {
-          key.second = (uint64_t) -1;
-        }
-        else
-        {
-          key.second = it->second.history[0].transaction_counter;
+          cache::header h;
+          memset(&h, 0, sizeof(h));
+          h.magic = _cachemagic;
+          h.entries = (uint32_t)((std::max(entries, cache::ways) + cache::ways - 1) / cache::ways * cache::ways);
+          h.entry_size = (uint32_t)((sizeof(cache::entry) + valuebytes + 63) & ~63);
+          _cachefile.truncate(64 + (llfio::file_handle::extent_type) h.entries * h.entry_size).value();
+          _cachefile.write(0, {{(llfio::byte *) &h, sizeof(h)}}).value();
         }
       }
+      _cachesection = llfio::section_handle::section(_cachefile, 0, llfio::section_handle::flag::readwrite).value();
+      _cachemap.emplace(_cachesection, (size_t) -1, 0, llfio::section_handle::flag::readwrite);
+      auto *header = reinterpret_cast<cache::header *>(_cachemap->data());
+      if(header->magic != _cachemagic)
+      {
+        throw unknown_store();
+      }
+      _cacheheader = header;
     }
-    //! Information about a key value
-    struct keyvalue_info
+
+    //! Statistics about a call to `compact()`
+    struct compaction_stats
     {
-      friend class basic_key_value_store;
-      friend class transaction;
-      //! The key
-      key_type key;
-      //! The value
-      span<const char> value;
-      //! When this value was last modified
-      uint64_t transaction_counter;
+      //! Records still in use which were copied
+      size_t records_copied{0};
+      //! Bytes of records still in use which were copied
+      llfio::file_handle::extent_type bytes_copied{0};
+      //! Bytes of small file deallocated
+      llfio::file_handle::extent_type bytes_deallocated{0};
+    };
 
-      keyvalue_info(keyvalue_info &&o) noexcept : key(std::move(o.key)), value(std::move(o.value)), transaction_counter(std::move(o.transaction_counter)), _value_buffer(std::move(o._value_buffer)) { o._value_buffer = nullptr; }
-      keyvalue_info &operator=(keyvalue_info &&o) noexcept
+  private:
+    struct _record
+    {
+      llfio::file_handle::extent_type end;
+      index::value_tail tail;
+      llfio::file_handle::extent_type length() const { return _pad_length((size_t) index::stored_length(tail.length)); }
+    };
+    // Calls f with each record of a small file, walking the tails backwards from the end until the zeroed front consolidated earlier
+    template <class F> static void _walk_records(llfio::file_handle &fh, llfio::file_handle::extent_type length, F &&f) { _walk_records(fh, 0, length, std::forward<F>(f)); }
+    // As above, but stopping at the record ending at `from`
+    template <class F> static void _walk_records(llfio::file_handle &fh, llfio::file_handle::extent_type from, llfio::file_handle::extent_type length, F &&f)
+    {
+      static constexpr llfio::file_handle::extent_type chunk = 1024 * 1024;
+      std::vector<llfio::byte> block(chunk);
+      llfio::file_handle::extent_type blockoffset = 0, blockend = 0;
+      llfio::file_handle::extent_type end = length & ~63;
+      while(end > from && end >= 64 + sizeof(index::value_tail))
       {
-        if(this == &o)
+        if(end > blockend || end - sizeof(index::value_tail) < blockoffset)
         {
-          return *this;
+          blockoffset = (end > chunk) ? end - chunk : 0;
+          blockend = end;
+          fh.read(blockoffset, {{block.data(), (size_t)(blockend - blockoffset)}}).value();
         }
-        this->~keyvalue_info();
-        new(this) keyvalue_info(std::move(o));
-        return *this;
-      }
-      ~keyvalue_info()
-      {
-        if(_value_buffer != nullptr)
+        _record record;
+        record.end = end;
+        memcpy(&record.tail, block.data() + (end - blockoffset) - sizeof(index::value_tail), sizeof(index::value_tail));
+        if(record.tail.transaction_counter == 0 || record.length() > end - 64)
         {
-          free(_value_buffer);
+          break;
         }
+        end -= record.length();
+        f(record);
       }
-
-      //! True if this info contains a valid value
-      explicit operator bool() const noexcept { return transaction_counter != (uint64_t) -1; }
-
-    private:
-      keyvalue_info()
-          : key(0)
-          , transaction_counter((uint64_t) -1)
-      {
-      }
-      keyvalue_info(key_type _key)
-          : key(_key)
-          , transaction_counter((uint64_t) -1)
+    }
+    void _compact(compaction_stats &stats, size_t n, llfio::file_handle::extent_type maxbytes)
+    {
+      static constexpr llfio::file_handle::extent_type chunk = 1024 * 1024;
+      llfio::file_handle fh = _smallfile(n).reopen(llfio::file_handle::mode::write).value();
+      llfio::file_handle::extent_guard unclaimed;
+      llfio::file_handle::extent_type length;
+      if(n == _mysmallfileidx)
       {
+        // My appends are only ever complete between commit groups
+        _begin_appending();
+        auto endappending = make_scope_exit([this]() noexcept { _end_appending(); });
+        length = fh.maximum_extent().value();
       }
-      keyvalue_info(key_type _key, span<char> buffer, bool free_on_destruct, uint64_t tc)
-          : key(_key)
-          , value(buffer)
-          , transaction_counter(tc)
-          , _value_buffer(free_on_destruct ? buffer.data() : nullptr)
+      else
       {
+        // Small files claimed by other writers are still growing, so leave them to their writers
+        auto smallfileunclaimed = fh.lock_file_range(_indexinuseoffset, 1, llfio::lock_kind::shared, std::chrono::seconds(0));
+        if(!smallfileunclaimed)
+        {
+          return;
+        }
+        unclaimed = std::move(smallfileunclaimed).value();
+        length = fh.maximum_extent().value();
       }
-      char *_value_buffer{nullptr};
-    };
-    //! Retrieve the latest value for a key. May throw `corrupted_store`
-    keyvalue_info find(key_type key, size_t revision = 0)
-    {
-      if(_indexheader->magic != _goodmagic)
-        throw corrupted_store();
-      if(revision >= 4)
-        throw std::invalid_argument("valid revision is 0-3");
-      auto it = _index->find_shared(key);
-      if(it == _index->end())
+
+      // Keep the oldest maxbytes of records not yet consolidated
+      std::deque<_record> window;
+      _walk_records(fh, length, [&](const _record &record) {
+        window.push_back(record);
+        while(window.size() > 1 && window.front().end - (record.end - record.length()) > maxbytes)
+        {
+          window.pop_front();
+        }
+      });
+      if(window.empty())
       {
-        // No value as no key
-        return keyvalue_info(key);
+        return;
       }
-      else
-      {
-        // TODO Depending on length, make a mapped_span instead
-        const auto &item = it->second.history[revision];
-        if(item.transaction_counter == 0)
+      const llfio::file_handle::extent_type windowbegin = window.back().end - window.back().length(), windowend = window.front().end;
+
+      // Copy the records still referenced by any revision in the index, oldest first to preserve read locality
+      auto references = [n](const index::value_history::item &h, const _record &record) {
+        return h.transaction_counter == record.tail.transaction_counter && h.value_identifier == n && h.value_offset == record.end / 64 && h.length == record.tail.length;
+      };
+      std::vector<llfio::byte> copies;
+      std::vector<_record> copied;
+      auto flush = [&] {
+        if(copied.empty())
         {
-          // No value on the key at this revision
-          return keyvalue_info(key);
+          return;
         }
-        size_t length = item.length, smallfilelength = _pad_length(length);
-        if(item.value_identifier >= _smallfiles.blocking.size() && item.value_identifier >= _smallfiles.mapped.size())
+        llfio::file_handle::extent_type copyend;
         {
-          // TODO: Open newly created smallfiles
-          abort();
+          _begin_appending();
+          auto endappending = make_scope_exit([this]() noexcept { _end_appending(); });
+          copyend = _mysmallfile.maximum_extent().value();
+          _mysmallfile.write(0, {{copies.data(), copies.size()}}).value();
+          _indexheader->smallfile_extents[_mysmallfileidx].store(copyend + copies.size(), std::memory_order_release);
         }
-        llfio::byte *buffer;
-        bool free_on_destruct = _smallfiles.mapped.empty();
-        if(!free_on_destruct)
+        // Atomically repoint the revisions still referencing the originals at their copies. A record
+        // whose key has since been updated is simply no longer referenced, and its copy is dead.
+        _indexheader->writes_occurring[_mysmallfileidx].fetch_add(1);
+        for(const auto &record : copied)
         {
-          auto mappedlength = _smallfiles.mapped[item.value_identifier].maximum_extent().value();
-          if(item.value_offset * 64 > mappedlength)
+          copyend += record.length();
+          bool found;
+          auto it = _find_exclusive(record.tail.key, found);
+          if(found)
           {
-            // Update mapping to match the underlying file
-            mappedlength = _smallfiles.mapped[item.value_identifier].update_map().value();
-            if(mappedlength > _smallfiles.mapped[item.value_identifier].capacity())
+            for(auto &h : it->second.history)
             {
-              // Need to remap into a new space
-              mappedlength = _smallfiles.mapped[item.value_identifier].reserve(mappedlength + _mmap_over_extension).value();
+              if(references(h, record))
+              {
+                index::value_history::item moved(h);
+                moved.value_offset = copyend / 64;
+                moved.value_identifier = _mysmallfileidx;
+                h = moved;
+              }
             }
           }
-          buffer = _smallfiles.mapped[item.value_identifier].address() + item.value_offset * 64 - smallfilelength;
         }
-        else
+        _indexheader->writes_occurring[_mysmallfileidx].fetch_sub(1);
+        copies.clear();
+        copied.clear();
+      };
+      for(auto recordit = window.rbegin(); recordit != window.rend(); ++recordit)
+      {
+        const auto &record = *recordit;
+        if(record.tail.length == (uint64_t) -1)
+        {
+          continue;
+        }
+        bool inuse = false;
+        {
+          bool found;
+          auto it = _find_shared(record.tail.key, found);
+          if(found)
+          {
+            for(const auto &h : it->second.history)
+            {
+              inuse = inuse || references(h, record);
+            }
+          }
+        }
+        if(!inuse)
+        {
+          continue;
+        }
+        // Records are copied verbatim, so their tails and hashes remain valid
+        const size_t offset = copies.size();
+        copies.resize(offset + (size_t) record.length());
+        fh.read(record.end - record.length(), {{copies.data() + offset, (size_t) record.length()}}).value();
+        copied.push_back(record);
+        stats.records_copied++;
+        stats.bytes_copied += record.length();
+        if(copies.size() >= chunk)
+        {
+          flush();
+        }
+      }
+      flush();
+
+      // Nothing in the window is referenced any more, so deallocate every whole chunk of it. Before the
+      // window lies either the small file's header, or a chunk deallocated by an earlier consolidation.
+      const llfio::file_handle::extent_type zerobegin = (windowbegin == 64) ? 0 : ((windowbegin + chunk - 1) & ~(chunk - 1)), zeroend = windowend & ~(chunk - 1);
+      if(zeroend > zerobegin)
+      {
+        stats.bytes_deallocated += fh.zero(zerobegin, zeroend - zerobegin).value();
+      }
+    }
+
+  public:
+    /*! \brief Consolidates the free space at the front of the small files.
+
+    For my small file, and each small file not claimed by another writer, the oldest `maxbytes`
+    of records not yet consolidated are examined. Records still referenced by any revision in
+    the index are appended to my small file in their original order, and those revisions are
+    atomically repointed at the copies. Every whole megabyte of the examined records is then
+    deallocated using `file_handle::zero()`, so the storage consumed by the small files tracks
+    the live data within them.
+
+    Can be called concurrently with fetches and commits, e.g. periodically from a background
+    thread. Values returned by `find()` as views of mapped small files read as zeros once the
+    region they lie in has been consolidated. Requires a store opened for writing.
+    */
+    compaction_stats compact(llfio::file_handle::extent_type maxbytes = 64 * 1024 * 1024)
+    {
+      if(_indexheader->magic != _goodmagic)
+        throw corrupted_store();
+      if(!_mysmallfile.is_valid())
+        throw std::invalid_argument("compaction requires a store opened for writing");
+      compaction_stats ret;
+      _tables_guard tablesguard(this);
+      const size_t smallfiles = _smallfiles.mapped.empty() ? _smallfiles.blocking.size() : _smallfiles.mapped.size();
+      for(size_t n = 0; n < smallfiles; n++)
+      {
+        _compact(ret, n, maxbytes);
+      }
+      return ret;
+    }
+
+    /*! \brief Moves keys from the previous generation of hash table into the newest, returning true
+    once none remain to be moved.
+
+    When the newest hash table becomes three quarters full, or an insert into it fails, a new
+    generation twice its size is created alongside it as "index.<generation>". Fetches and commits
+    move each key they access into the new generation, and lookups look in both until every key has
+    moved, so readers never stop.
+
+    This moves the remainder, finding them through the tails of the records below each small file's
+    recorded extent, then cuts over to the new generation once the previous one holds no keys. The
+    previous generation's storage is then released, and each process unmaps it once it notices the
+    cutover and none of its operations begun beforehand remain in flight. Call this periodically
+    from a background thread after the index has grown. Requires a store opened for writing.
+    */
+    bool migrate()
+    {
+      if(_indexheader->magic != _goodmagic)
+        throw corrupted_store();
+      if(!_mysmallfile.is_valid())
+        throw std::invalid_argument("migration requires a store opened for writing");
+      _tables_guard tablesguard(this);
+      _sync_generation();
+      auto tables = _tables_in_use();
+      if(tables.first == nullptr)
+      {
+        return true;
+      }
+      const size_t smallfiles = _smallfiles.mapped.empty() ? _smallfiles.blocking.size() : _smallfiles.mapped.size();
+      for(size_t n = 0; n < smallfiles && _indexheader->keys[tables.first->generation % 2].load(std::memory_order_acquire) > 0; n++)
+      {
+        llfio::file_handle fh = _smallfile(n).reopen().value();
+        const llfio::file_handle::extent_type length = std::min(fh.maximum_extent().value(), (llfio::file_handle::extent_type) _indexheader->smallfile_extents[n].load(std::memory_order_acquire));
+        _walk_records(fh, length, [&](const _record &record) { _migrate(tables.first, tables.second, record.tail.key); });
+      }
+      if(_indexheader->keys[tables.first->generation % 2].load(std::memory_order_acquire) == 0)
+      {
+        uint32_t expected = tables.first->generation;
+        if(_indexheader->oldest_generation.compare_exchange_strong(expected, tables.second->generation, std::memory_order_acq_rel))
+        {
+          // Every entry of the previous generation is now unused, so lookups racing this find nothing in it either way
+          if(tables.first->generation == 0)
+          {
+            const llfio::file_handle::extent_type offset = llfio::utils::round_up_to_page_size(sizeof(index::index), llfio::utils::page_size()), length = _indexfile.maximum_extent().value();
+            if(length > offset)
+            {
+              _indexfile.zero(offset, length - offset).value();
+            }
+          }
+          else
+          {
+            tables.first->file.unlink().value();
+          }
+          if(tables.first->bloom.file.is_valid())
+          {
+            tables.first->bloom.file.unlink().value();
+          }
+        }
+        _sync_generation();
+      }
+      return _tables_in_use().first == nullptr;
+    }
+
+    /*! \brief Loads many key-values into a store holding no keys, making every one visible at once.
+
+    The records are appended to my small file as one transaction, with gather writes of as many
+    buffers as the platform allows. A new generation of hash table, sized so the keys fill at most
+    three quarters of it, is then filled by `threads` threads in parallel whilst nothing else can
+    see it, and is published by advancing the store's generation to it. Lookups thus find either
+    none of the keys or all of them.
+
+    Keys must be unique. Requires a store opened for writing into which no key has been inserted,
+    removed keys still occupying the index, and that other processes do not commit until this
+    returns. Commits of this process wait for it. Throws `std::invalid_argument` if these are not met.
+    */
+    void bulk_load(span<const std::pair<key_type, span<const char>>> items, size_t threads = std::thread::hardware_concurrency())
+    {
+      if(_indexheader->magic != _goodmagic)
+        throw corrupted_store();
+      if(!_mysmallfile.is_valid())
+        throw std::invalid_argument("bulk loading requires a store opened for writing");
+      if(items.empty())
+        return;
+      _tables_guard tablesguard(this);
+      while(!migrate())
+      {
+        std::this_thread::yield();
+      }
+      _begin_appending();
+      auto endappending = make_scope_exit([this]() noexcept { _end_appending(); });
+      auto isempty = [this] { return _indexheader->keys[0].load(std::memory_order_acquire) == 0 && _indexheader->keys[1].load(std::memory_order_acquire) == 0; };
+      if(!isempty())
+        throw std::invalid_argument("bulk loading requires a store holding no keys");
+      _hash_table *newest = _tables_in_use().second;
+      const uint32_t generation = newest->generation + 1;
+
+      // The whole load is one transaction
+      uint64_t old_transaction_counter;
+      union {
+        struct
+        {
+          uint64_t values_updated : 16;
+          uint64_t counter : 48;
+        };
+        uint64_t this_transaction_counter;
+      } _;
+      do
+      {
+        _.this_transaction_counter = old_transaction_counter = _indexheader->transaction_counter.load(std::memory_order_acquire);
+        _.counter++;
+        _.values_updated = std::min(items.size(), (size_t) 0xffff);
+      } while(!_indexheader->transaction_counter.compare_exchange_weak(old_transaction_counter, _.this_transaction_counter, std::memory_order_release, std::memory_order_relaxed));
+      const uint64_t transaction_counter = _.this_transaction_counter;
+
+      // Append the records sequentially, remembering where each went
+      std::vector<index::value_history::item> histories(items.size());
+      {
+        llfio::file_handle::extent_type value_offset = _mysmallfile.maximum_extent().value();
+        assert((value_offset % 64) == 0);
+        std::vector<llfio::file_handle::const_buffer_type> reqs;
+        reqs.reserve(_max_gather);
+        // Each item in a write needs one tail buffer, and possibly its value compressed
+        std::vector<llfio::byte> tailbuffers(_max_gather * 128);
+        std::vector<std::vector<char>> compressed(_max_gather);
+        size_t tails = 0;
+        for(size_t n = 0; n < items.size(); n++)
+        {
+          if(reqs.size() + 2 > _max_gather)
+          {
+            _mysmallfile.write({reqs, 0}).value();
+            reqs.clear();
+            tails = 0;
+          }
+          span<const char> stored = items[n].second;
+          uint64_t length = stored.size();
+          if(_indexheader->contents_compressed)
+          {
+            std::vector<char> &c = compressed[tails];
+            const uint64_t rawlength = stored.size();
+            c.resize(sizeof(rawlength) + lz4_block::compress_bound(stored.size()));
+            memcpy(c.data(), &rawlength, sizeof(rawlength));
+            c.resize(sizeof(rawlength) + lz4_block::compress(c.data() + sizeof(rawlength), stored.data(), stored.size(), _dictionary.data(), _dictionary.size()));
+            if(_pad_length(c.size()) < _pad_length(stored.size()))
+            {
+              stored = span<const char>(c.data(), c.size());
+              length = c.size() | index::compressed_length_flag;
+            }
+          }
+          llfio::byte *tailbuffer = tailbuffers.data() + 128 * tails++;
+          memset(tailbuffer, 0, 128);
+          index::value_tail *vt = reinterpret_cast<index::value_tail *>(tailbuffer + 128 - sizeof(index::value_tail));
+          vt->key = items[n].first;
+          vt->transaction_counter = transaction_counter;
+          vt->length = length;
+          const size_t totalwrite = _pad_length(stored.size());
+          const size_t tailbytes = totalwrite - stored.size();
+          assert(tailbytes < 128);
+          reqs.push_back({(const llfio::byte *) stored.data(), stored.size()});
+          reqs.push_back({tailbuffer + 128 - tailbytes, tailbytes});
+          if(_indexheader->contents_hashed)
+          {
+            QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash hasher;
+            auto rit = reqs.end();
+            rit -= 2;
+            hasher.add((char *) rit->data(), rit->size());
+            ++rit;
+            hasher.add((char *) rit->data(), rit->size());
+            vt->hash = hasher.finalise();
+          }
+          value_offset += totalwrite;
+          histories[n].transaction_counter = transaction_counter;
+          histories[n].value_offset = value_offset / 64;
+          histories[n].value_identifier = _mysmallfileidx;
+          histories[n].length = length;
+        }
+        if(!reqs.empty())
+        {
+          _mysmallfile.write({reqs, 0}).value();
+        }
+        _indexheader->smallfile_extents[_mysmallfileidx].store(value_offset, std::memory_order_release);
+      }
+
+      // Fill the new generation of hash table before anything can see it
+      size_t entries = newest->entries;
+      while(entries / 4 * 3 < items.size())
+      {
+        entries *= 2;
+      }
+      llfio::file_handle::extent_type size = entries * sizeof(index::open_hash_index::value_type);
+      size = llfio::utils::round_up_to_page_size(size, llfio::utils::page_size());
+      entries = (size_t)(size / sizeof(index::open_hash_index::value_type));
+      auto fh = llfio::file_handle::file(_indexfile.parent_path_handle().value(), _table_name(generation), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::all, llfio::file_handle::flag::disable_prefetching).value();
+      _bloom_filter bloom;
+      bool published = false;
+      auto unlinkunpublished = make_scope_exit([&]() noexcept {
+        if(!published)
+        {
+          // Growing the index later would otherwise reuse these entries
+          (void) fh.unlink();
+          if(bloom.file.is_valid())
+          {
+            (void) bloom.file.unlink();
+          }
+        }
+      });
+      fh.truncate(0).value();
+      fh.truncate(size).value();
+      if(_indexheader->keys_filtered)
+      {
+        _bloom_filter::create(_indexfile.parent_path_handle().value(), generation, entries, llfio::file_handle::caching::all, true);
+        bloom = _bloom_filter::open(_indexfile.parent_path_handle().value(), generation, llfio::file_handle::mode::write, _mapflags);
+      }
+      {
+        llfio::section_handle sh = llfio::section_handle::section(fh, 0, _mapflags).value();
+        index::open_hash_index table(sh, entries, 0, _mapflags);
+        threads = std::max(threads, (size_t) 1);
+        std::atomic<bool> duplicates{false};
+        std::vector<std::exception_ptr> failures(threads);
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for(size_t t = 0; t < threads; t++)
+        {
+          workers.emplace_back([&, t] {
+            try
+            {
+              for(size_t n = t; n < items.size(); n += threads)
+              {
+                index::value_history vh;
+                memset(&vh, 0, sizeof(vh));
+                vh.history[0] = histories[n];
+                bloom.add(items[n].first);
+                if(!table.insert({items[n].first, vh}).second)
+                {
+                  duplicates = true;
+                }
+              }
+            }
+            catch(...)
+            {
+              failures[t] = std::current_exception();
+            }
+          });
+        }
+        for(auto &worker : workers)
+        {
+          worker.join();
+        }
+        for(auto &failure : failures)
+        {
+          if(failure)
+          {
+            std::rethrow_exception(failure);
+          }
+        }
+        if(duplicates)
+          throw std::invalid_argument("bulk loaded keys must be unique");
+      }
+
+      // Publish every key at once. The previous generation holds none, so it is released straight away.
+      if(!isempty())
+        throw std::invalid_argument("the store was modified during the bulk load");
+      _indexheader->keys[generation % 2].store(items.size(), std::memory_order_release);
+      uint32_t expected = newest->generation;
+      if(!_indexheader->generation.compare_exchange_strong(expected, generation, std::memory_order_acq_rel))
+      {
+        _indexheader->keys[generation % 2].store(0, std::memory_order_release);
+        throw std::invalid_argument("the store was modified during the bulk load");
+      }
+      published = true;
+      migrate();
+    }
+
+    //! Retrieve when keys were last updated by setting the second to the latest transaction counter.
+    //! Note that counter will be `(uint64_t)-1` for any unknown keys. Never throws exceptions.
+    void last_updated(span<std::pair<key_type, uint64_t>> keys) noexcept
+    {
+      _tables_guard tablesguard(this);
+      auto tables = _tables_in_use();
+      for(auto &key : keys)
+      {
+        key.second = (uint64_t) -1;
+        for(_hash_table *table : {tables.first, tables.second})
+        {
+          if(table != nullptr)
+          {
+            auto it = table->index.find_shared(key.first);
+            if(it != table->index.end())
+            {
+              key.second = it->second.history[0].transaction_counter;
+              break;
+            }
+          }
+        }
+      }
+    }
+    //! Information about a key value
+    struct keyvalue_info
+    {
+      friend class basic_key_value_store;
+      friend class transaction;
+      //! The key
+      key_type key;
+      //! The value
+      span<const char> value;
+      //! When this value was last modified
+      uint64_t transaction_counter;
+
+      keyvalue_info(keyvalue_info &&o) noexcept : key(std::move(o.key)), value(std::move(o.value)), transaction_counter(std::move(o.transaction_counter)), _value_buffer(std::move(o._value_buffer)) { o._value_buffer = nullptr; }
+      keyvalue_info &operator=(keyvalue_info &&o) noexcept
+      {
+        if(this == &o)
+        {
+          return *this;
+        }
+        this->~keyvalue_info();
+        new(this) keyvalue_info(std::move(o));
+        return *this;
+      }
+      ~keyvalue_info()
+      {
+        if(_value_buffer != nullptr)
+        {
+          free(_value_buffer);
+        }
+      }
+
+      //! True if this info contains a valid value
+      explicit operator bool() const noexcept { return transaction_counter != (uint64_t) -1; }
+
+    private:
+      keyvalue_info()
+          : key(0)
+          , transaction_counter((uint64_t) -1)
+      {
+      }
+      keyvalue_info(key_type _key)
+          : key(_key)
+          , transaction_counter((uint64_t) -1)
+      {
+      }
+      keyvalue_info(key_type _key, span<char> buffer, bool free_on_destruct, uint64_t tc)
+          : key(_key)
+          , value(buffer)
+          , transaction_counter(tc)
+          , _value_buffer(free_on_destruct ? buffer.data() : nullptr)
+      {
+      }
+      char *_value_buffer{nullptr};
+    };
+
+  private:
+    // False if the key was never inserted into any generation of hash table in use
+    bool _bloom_may_contain(key_type key) noexcept
+    {
+      auto tables = _tables_in_use();
+      for(_hash_table *table : {tables.first, tables.second})
+      {
+        if(table != nullptr && table->bloom.may_contain(key))
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+    llfio::byte *_cache_set(key_type key) const noexcept
+    {
+      uint64_t words[2];
+      memcpy(words, &key, sizeof(words));
+      const uint64_t sets = _cacheheader->entries / cache::ways;
+      const uint64_t set = (((words[0] ^ words[1]) * 0x9E3779B97F4A7C15ULL) >> 32) % sets;
+      return reinterpret_cast<llfio::byte *>(_cacheheader) + 64 + set * cache::ways * _cacheheader->entry_size;
+    }
+    cache::entry *_cache_entry(llfio::byte *set, size_t way) const noexcept { return reinterpret_cast<cache::entry *>(set + way * _cacheheader->entry_size); }
+    // Copies out the cached value of a key at a transaction counter, if there is one
+    keyvalue_info _cache_find(key_type key, uint64_t transaction_counter)
+    {
+      llfio::byte *set = _cache_set(key);
+      for(size_t way = 0; way < cache::ways; way++)
+      {
+        cache::entry *e = _cache_entry(set, way);
+        for(size_t attempt = 0; attempt < 4; attempt++)
+        {
+          const uint32_t sequence = e->sequence.load(std::memory_order_acquire);
+          if((sequence & 1) != 0)
+          {
+            // Being written, so try again
+            continue;
+          }
+          const size_t length = (size_t) e->length;
+          if(e->key != key || e->transaction_counter != transaction_counter || length > _cacheheader->entry_size - sizeof(cache::entry))
+          {
+            break;
+          }
+          char *value = (char *) malloc(length + 1);
+          if(!value)
+          {
+            throw std::bad_alloc();
+          }
+          memcpy(value, e + 1, length);
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if(e->sequence.load(std::memory_order_relaxed) != sequence)
+          {
+            // Was rewritten while being copied
+            free(value);
+            continue;
+          }
+          if(e->referenced.load(std::memory_order_relaxed) == 0)
+          {
+            e->referenced.store(1, std::memory_order_relaxed);
+          }
+          return keyvalue_info(key, span<char>(value, length), true, transaction_counter);
+        }
+      }
+      return keyvalue_info(key);
+    }
+    // Caches a verified value, evicting by CLOCK amongst the entries of its set
+    void _cache_insert(key_type key, uint64_t transaction_counter, span<const char> value) noexcept
+    {
+      if(value.size() > _cacheheader->entry_size - sizeof(cache::entry))
+      {
+        return;
+      }
+      llfio::byte *set = _cache_set(key);
+      cache::entry *victim = nullptr;
+      for(size_t way = 0; way < cache::ways && victim == nullptr; way++)
+      {
+        cache::entry *e = _cache_entry(set, way);
+        if(e->key == key)
+        {
+          if(e->transaction_counter == transaction_counter)
+          {
+            // Someone else cached it already
+            return;
+          }
+          // Replace an older revision of the same key
+          victim = e;
+        }
+        else if(e->transaction_counter == 0)
+        {
+          victim = e;
+        }
+      }
+      for(size_t n = 0; n < 2 * cache::ways && victim == nullptr; n++)
+      {
+        cache::entry *e = _cache_entry(set, _cacheheader->hand.fetch_add(1, std::memory_order_relaxed) % cache::ways);
+        if(e->referenced.load(std::memory_order_relaxed) != 0)
+        {
+          e->referenced.store(0, std::memory_order_relaxed);
+        }
+        else
+        {
+          victim = e;
+        }
+      }
+      if(victim == nullptr)
+      {
+        return;
+      }
+      uint32_t sequence = victim->sequence.load(std::memory_order_relaxed);
+      if((sequence & 1) != 0 || !victim->sequence.compare_exchange_strong(sequence, sequence + 1, std::memory_order_relaxed))
+      {
+        // Someone else is writing this entry
+        return;
+      }
+      // Readers must see the odd sequence before any of the new contents
+      std::atomic_thread_fence(std::memory_order_release);
+      victim->key = key;
+      victim->transaction_counter = transaction_counter;
+      victim->length = value.size();
+      memcpy(victim + 1, value.data(), value.size());
+      victim->referenced.store(1, std::memory_order_relaxed);
+      victim->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Whether fetching the value of a history item would copy, verify or decompress it, so it is worth caching
+    bool _cacheable(const index::value_history::item &item) const noexcept { return _cacheheader != nullptr && (_smallfiles.mapped.empty() || _indexheader->contents_hashed || index::is_compressed(item.length)); }
+    // The record of a history item in its mapped small file, updating the map if the record was appended since
+    llfio::byte *_mapped_record(const index::value_history::item &item)
+    {
+      auto &mfh = _smallfiles.mapped[item.value_identifier];
+      auto mappedlength = mfh.maximum_extent().value();
+      if(item.value_offset * 64 > mappedlength)
+      {
+        // Update mapping to match the underlying file
+        mappedlength = mfh.update_map().value();
+        if(mappedlength > mfh.capacity())
+        {
+          // Need to remap into a new space
+          mappedlength = mfh.reserve(mappedlength + _mmap_over_extension).value();
+        }
+      }
+      return mfh.address() + item.value_offset * 64 - _pad_length((size_t) index::stored_length(item.length));
+    }
+    // Checks the record of a history item and returns its value, taking ownership of the record if it was read into a malloc'd buffer
+    keyvalue_info _make_value(key_type key, const index::value_history::item &item, llfio::byte *buffer, bool free_on_destruct, bool cacheable)
+    {
+      const uint64_t length = item.length;
+      const size_t storedlength = (size_t) index::stored_length(length), smallfilelength = _pad_length(storedlength);
+      // Owns the record from here, so it is freed if the record proves bad
+      keyvalue_info ret(key, span<char>((char *) buffer, storedlength), free_on_destruct, item.transaction_counter);
+      index::value_tail *vt = reinterpret_cast<index::value_tail *>(buffer + smallfilelength - sizeof(index::value_tail));
+      if(_indexheader->contents_hashed || _indexheader->key_is_hash_of_value)
+      {
+        QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash hasher;
+        uint128 tocheck = vt->hash;
+        memset(&vt->hash, 0, sizeof(vt->hash));
+        uint128 thishash = QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash((char *) buffer, _indexheader->contents_hashed ? smallfilelength : storedlength);
+        if(tocheck != thishash)
+        {
+          _indexheader->magic = _badmagic;
+          throw corrupted_store();
+        }
+      }
+      if(vt->key != key)
+      {
+        _indexheader->magic = _badmagic;
+        throw corrupted_store();
+      }
+      if(vt->length != length)
+      {
+        _indexheader->magic = _badmagic;
+        throw corrupted_store();
+      }
+      if(vt->transaction_counter != item.transaction_counter)
+      {
+        _indexheader->magic = _badmagic;
+        throw corrupted_store();
+      }
+      if(index::is_compressed(length))
+      {
+        // Decompress straight from the small file's map, or what was read of it, into the value returned
+        uint64_t rawlength = 0;
+        if(storedlength >= sizeof(rawlength))
+        {
+          memcpy(&rawlength, buffer, sizeof(rawlength));
+        }
+        // Each compressed byte expands to at most 255 bytes
+        if(storedlength < sizeof(rawlength) + 1 || rawlength > (uint64_t)(storedlength - sizeof(rawlength)) * 255)
+        {
+          _indexheader->magic = _badmagic;
+          throw corrupted_store();
+        }
+        char *value = (char *) malloc((size_t) rawlength + 1);
+        if(!value)
+        {
+          throw std::bad_alloc();
+        }
+        if(!lz4_block::decompress(value, (size_t) rawlength, (const char *) buffer + sizeof(rawlength), storedlength - sizeof(rawlength), _dictionary.data(), _dictionary.size()))
+        {
+          free(value);
+          _indexheader->magic = _badmagic;
+          throw corrupted_store();
+        }
+        ret = keyvalue_info(key, span<char>(value, (size_t) rawlength), true, item.transaction_counter);
+      }
+      if(cacheable)
+      {
+        _cache_insert(key, item.transaction_counter, ret.value);
+      }
+      return ret;
+    }
+
+  public:
+    /*! \brief Retrieve the latest value for a key. May throw `corrupted_store`
+
+    Keys never inserted are usually rejected by the Bloom filters of the generations of hash table in use,
+    without looking in the index. Each generation has its own filter, sized with it when the index grows.
+    */
+    keyvalue_info find(key_type key, size_t revision = 0)
+    {
+      if(_indexheader->magic != _goodmagic)
+        throw corrupted_store();
+      if(revision >= 4)
+        throw std::invalid_argument("valid revision is 0-3");
+      _tables_guard tablesguard(this);
+      _sync_generation();
+      if(!_bloom_may_contain(key))
+      {
+        // No value as the key was never inserted
+        return keyvalue_info(key);
+      }
+      if(_mysmallfile.is_valid())
+      {
+        // Keys move into the newest generation of hash table when accessed
+        _migrate(key);
+      }
+      bool found;
+      auto it = _find_shared(key, found);
+      if(!found)
+      {
+        // No value as no key
+        return keyvalue_info(key);
+      }
+      else
+      {
+        // TODO Depending on length, make a mapped_span instead
+        const auto &item = it->second.history[revision];
+        if(item.transaction_counter == 0)
+        {
+          // No value on the key at this revision
+          return keyvalue_info(key);
+        }
+        if(item.value_identifier >= _smallfiles.blocking.size() && item.value_identifier >= _smallfiles.mapped.size())
+        {
+          // TODO: Open newly created smallfiles
+          abort();
+        }
+        const bool cacheable = _cacheable(item);
+        if(cacheable)
+        {
+          keyvalue_info cached = _cache_find(key, item.transaction_counter);
+          if(cached)
+          {
+            return cached;
+          }
+        }
+        if(!_smallfiles.mapped.empty())
+        {
+          return _make_value(key, item, _mapped_record(item), false, cacheable);
+        }
+        const size_t smallfilelength = _pad_length((size_t) index::stored_length(item.length));
+        llfio::byte *buffer = (llfio::byte *) malloc(smallfilelength);
+        if(!buffer)
+        {
+          throw std::bad_alloc();
+        }
+        auto read = _smallfiles.blocking[item.value_identifier].read(item.value_offset * 64 - smallfilelength, {{buffer, smallfilelength}});
+        if(!read)
+        {
+          free(buffer);
+          read.value();
+        }
+        return _make_value(key, item, buffer, true, cacheable);
+      }
+    }
+    /*! \brief Retrieve the values of many keys at once, in the order of the keys. May throw `corrupted_store`
+
+    Every key is looked up before any value is read, in key order as commits lock keys. The records
+    of the values not cached are then read with one scatter read per run of adjacent records in each
+    small file, rather than one read per key. Records written by the same commits are adjacent, so
+    values updated together are usually fetched together with a few reads.
+    */
+    std::vector<keyvalue_info> find_many(span<const key_type> keys, size_t revision = 0)
+    {
+      if(_indexheader->magic != _goodmagic)
+        throw corrupted_store();
+      if(revision >= 4)
+        throw std::invalid_argument("valid revision is 0-3");
+      _tables_guard tablesguard(this);
+      _sync_generation();
+      std::vector<size_t> order;
+      order.reserve(keys.size());
+      for(size_t n = 0; n < keys.size(); n++)
+      {
+        // Keys never inserted need no lookup
+        if(_bloom_may_contain(keys[n]))
+        {
+          order.push_back(n);
+        }
+      }
+      std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+      if(_mysmallfile.is_valid())
+      {
+        // Keys move into the newest generation of hash table when accessed
+        for(size_t n : order)
+        {
+          _migrate(keys[n]);
+        }
+      }
+      struct lookup
+      {
+        index::open_hash_index::const_iterator it;  // holds the key's shared lock until its value is read
+        const index::value_history::item *item{nullptr};
+        llfio::byte *buffer{nullptr};
+        bool cacheable{false};
+        size_t duplicate_of{(size_t) -1};
+      };
+      std::vector<lookup> lookups(keys.size());
+      auto freebuffers = make_scope_exit([&]() noexcept {
+        if(_smallfiles.mapped.empty())
+        {
+          for(auto &l : lookups)
+          {
+            free(l.buffer);
+          }
+        }
+      });
+      std::vector<keyvalue_info> ret;
+      ret.reserve(keys.size());
+      for(size_t n = 0; n < keys.size(); n++)
+      {
+        ret.push_back(keyvalue_info(keys[n]));
+      }
+      for(size_t i = 0, runstart = 0; i < order.size(); i++)
+      {
+        const size_t n = order[i];
+        if(i > 0 && !(keys[order[i - 1]] < keys[n]))
+        {
+          // The same key again, whose lock is already held. Equal keys sort in no particular
+          // order, so each copies the first of its run, which is the one looked up.
+          lookups[n].duplicate_of = order[runstart];
+          continue;
+        }
+        runstart = i;
+        bool found;
+        auto it = _find_shared(keys[n], found);
+        if(!found)
+        {
+          continue;
+        }
+        const auto &item = it->second.history[revision];
+        if(item.transaction_counter == 0)
+        {
+          continue;
+        }
+        if(item.value_identifier >= _smallfiles.blocking.size() && item.value_identifier >= _smallfiles.mapped.size())
+        {
+          // TODO: Open newly created smallfiles
+          abort();
+        }
+        lookups[n].cacheable = _cacheable(item);
+        if(lookups[n].cacheable)
         {
-          buffer = (llfio::byte *) malloc(smallfilelength);
-          if(!buffer)
+          keyvalue_info cached = _cache_find(keys[n], item.transaction_counter);
+          if(cached)
           {
-            throw std::bad_alloc();
+            ret[n] = std::move(cached);
+            continue;
           }
-          _smallfiles.blocking[item.value_identifier].read(item.value_offset * 64 - smallfilelength, {{buffer, smallfilelength}}).value();
         }
-        index::value_tail *vt = reinterpret_cast<index::value_tail *>(buffer + smallfilelength - sizeof(index::value_tail));
-        if(_indexheader->contents_hashed || _indexheader->key_is_hash_of_value)
+        lookups[n].item = &item;
+        lookups[n].it = std::move(it);
+      }
+      if(!_smallfiles.mapped.empty())
+      {
+        // Update every map first, so no record located afterwards is moved by a later remap
+        for(auto &l : lookups)
         {
-          QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash hasher;
-          uint128 tocheck = vt->hash;
-          memset(&vt->hash, 0, sizeof(vt->hash));
-          uint128 thishash = QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash((char *) buffer, _indexheader->contents_hashed ? smallfilelength : length);
-          if(tocheck != thishash)
+          if(l.item != nullptr)
           {
-            _indexheader->magic = _badmagic;
-            throw corrupted_store();
+            _mapped_record(*l.item);
           }
         }
-        if(vt->key != key)
+        for(auto &l : lookups)
         {
-          _indexheader->magic = _badmagic;
-          throw corrupted_store();
+          if(l.item != nullptr)
+          {
+            l.buffer = _mapped_record(*l.item);
+          }
         }
-        if(vt->length != length)
+      }
+      else
+      {
+        // Read the records of each small file in order of offset, one scatter read per adjacent run
+        std::vector<size_t> reads;
+        for(size_t n = 0; n < keys.size(); n++)
         {
-          _indexheader->magic = _badmagic;
-          throw corrupted_store();
+          if(lookups[n].item != nullptr)
+          {
+            reads.push_back(n);
+          }
         }
-        if(vt->transaction_counter != item.transaction_counter)
+        std::sort(reads.begin(), reads.end(), [&lookups](size_t a, size_t b) {
+          const auto &x = *lookups[a].item, &y = *lookups[b].item;
+          return (x.value_identifier != y.value_identifier) ? (x.value_identifier < y.value_identifier) : (x.value_offset < y.value_offset);
+        });
+        std::vector<llfio::file_handle::buffer_type> reqs;
+        reqs.reserve(_max_gather);
+        llfio::file_handle::extent_type runbegin = 0, runend = 0;
+        size_t runfile = (size_t) -1;
+        auto flush = [&] {
+          if(!reqs.empty())
+          {
+            _smallfiles.blocking[runfile].read({reqs, runbegin}).value();
+            reqs.clear();
+          }
+        };
+        for(size_t n : reads)
         {
-          _indexheader->magic = _badmagic;
-          throw corrupted_store();
+          const auto &item = *lookups[n].item;
+          const size_t smallfilelength = _pad_length((size_t) index::stored_length(item.length));
+          const llfio::file_handle::extent_type begin = item.value_offset * 64 - smallfilelength;
+          if(item.value_identifier != runfile || begin != runend || reqs.size() == _max_gather)
+          {
+            flush();
+            runfile = item.value_identifier;
+            runbegin = begin;
+          }
+          lookups[n].buffer = (llfio::byte *) malloc(smallfilelength);
+          if(!lookups[n].buffer)
+          {
+            throw std::bad_alloc();
+          }
+          reqs.push_back({lookups[n].buffer, smallfilelength});
+          runend = item.value_offset * 64;
+        }
+        flush();
+      }
+      for(size_t n = 0; n < keys.size(); n++)
+      {
+        if(lookups[n].item != nullptr)
+        {
+          llfio::byte *buffer = lookups[n].buffer;
+          lookups[n].buffer = nullptr;
+          ret[n] = _make_value(keys[n], *lookups[n].item, buffer, _smallfiles.mapped.empty(), lookups[n].cacheable);
+        }
+      }
+      for(size_t n = 0; n < keys.size(); n++)
+      {
+        const size_t original = lookups[n].duplicate_of;
+        if(original != (size_t) -1 && ret[original])
+        {
+          char *value = (char *) malloc(ret[original].value.size() + 1);
+          if(!value)
+          {
+            throw std::bad_alloc();
+          }
+          memcpy(value, ret[original].value.data(), ret[original].value.size());
+          ret[n] = keyvalue_info(keys[n], span<char>(value, ret[original].value.size()), true, ret[original].transaction_counter);
+        }
+      }
+      return ret;
+    }
+  private:
+    void _ordered_reset() noexcept
+    {
+      _orderedkeys.clear();
+      for(auto &seen : _orderedseen)
+      {
+        seen = 0;
+      }
+    }
+    // Applies the records appended to every small file since last seen, checking each key against the hash index
+    void _ordered_catch_up()
+    {
+      _tables_guard tablesguard(this);
+      const size_t smallfiles = _smallfiles.mapped.empty() ? _smallfiles.blocking.size() : _smallfiles.mapped.size();
+      for(size_t n = 0; n < smallfiles; n++)
+      {
+        const llfio::file_handle::extent_type extent = _indexheader->smallfile_extents[n].load(std::memory_order_acquire);
+        if(extent <= _orderedseen[n])
+        {
+          continue;
+        }
+        llfio::file_handle fh = _smallfile(n).reopen().value();
+        _walk_records(fh, _orderedseen[n], extent, [&](const _record &record) {
+          bool found;
+          auto it = _find_shared(record.tail.key, found);
+          // Removed keys stay in the hash index until all their history is removed
+          if(found && it->second.history[0].transaction_counter != 0)
+          {
+            _orderedkeys.insert(record.tail.key);
+          }
+          else
+          {
+            _orderedkeys.erase(record.tail.key);
+          }
+        });
+        _orderedseen[n] = extent;
+      }
+    }
+    // Calls f with each key not less than first and not greater than last in the ordered index, until f returns false
+    template <class F> void _ordered_scan(key_type first, key_type last, F &&f)
+    {
+      use_ordered_index();
+      std::lock_guard<decltype(_orderedlock)> orderedlockguard(_orderedlock);
+      try
+      {
+        _ordered_catch_up();
+      }
+      catch(...)
+      {
+        // Rebuild it upon the next scan
+        _ordered_reset();
+        throw;
+      }
+      for(auto it = _orderedkeys.lower_bound(first); it != _orderedkeys.end() && !_key_order()(last, *it) && f(*it); ++it)
+      {
+      }
+    }
+
+  public:
+    /*! \brief Sets whether to keep an ordered index of the keys, for `keys_in_range()` and `keys_with_prefix()`.
+
+    The index is kept in memory, built by walking the records of every small file, and updated by
+    this process's commits. The first call is therefore a full scan of every small file, costing
+    time proportional to the whole store, as is the first scan if this was not called beforehand.
+    Before each scan it catches up with the records other processes have appended since, checking
+    each key they wrote against the hash index, so a scan sees every commit completed before it
+    began. Scans then cost O(log n + k) for k keys, plus the walk of those records.
+    */
+    void use_ordered_index()
+    {
+      std::lock_guard<decltype(_orderedlock)> orderedlockguard(_orderedlock);
+      if(_ordered)
+        return;
+      _ordered_reset();
+      try
+      {
+        _ordered_catch_up();
+      }
+      catch(...)
+      {
+        _ordered_reset();
+        throw;
+      }
+      _ordered = true;
+    }
+    //! Returns up to `max` keys not less than `begin` and less than `end`, in numeric order. Calls `use_ordered_index()` if needed.
+    std::vector<key_type> keys_in_range(key_type begin, key_type end, size_t max = (size_t) -1)
+    {
+      std::vector<key_type> ret;
+      if(max == 0 || !_key_order()(begin, end))
+      {
+        return ret;
+      }
+      _ordered_scan(begin, end, [&](const key_type &key) {
+        if(!_key_order()(key, end))
+        {
+          return false;
         }
-        return keyvalue_info(key, span<char>((char *) buffer, length), free_on_destruct, item.transaction_counter);
+        ret.push_back(key);
+        return ret.size() < max;
+      });
+      return ret;
+    }
+    //! Returns up to `max` keys whose top `bits` bits are those of `prefix`, in numeric order. Calls `use_ordered_index()` if needed.
+    std::vector<key_type> keys_with_prefix(key_type prefix, unsigned bits, size_t max = (size_t) -1)
+    {
+      if(bits > 128)
+        throw std::invalid_argument("a prefix has at most 128 bits");
+      key_type first = prefix, last = prefix;
+      for(unsigned word = 0; word < 2; word++)
+      {
+        // The second word holds the top 64 bits
+        const unsigned keep = (word == 1) ? std::min(bits, 64U) : ((bits > 64) ? bits - 64 : 0);
+        const uint64_t mask = (keep == 0) ? 0 : (~(uint64_t) 0 << (64 - keep));
+        first.as_longlongs[word] &= mask;
+        last.as_longlongs[word] = first.as_longlongs[word] | ~mask;
+      }
+      std::vector<key_type> ret;
+      if(max == 0)
+      {
+        return ret;
       }
+      _ordered_scan(first, last, [&](const key_type &key) {
+        ret.push_back(key);
+        return ret.size() < max;
+      });
+      return ret;
     }
   };
 
@@ -548,11 +2038,16 @@ namespace key_value_store
       basic_key_value_store::keyvalue_info kvi;   // the item's value when fetched
       llfio::optional<span<const char>> towrite;  // the value to be written on commit
       bool remove;                                // true if to remove
+      std::vector<char> compressed;               // the value compressed, if that makes its record smaller
       _item(basic_key_value_store::keyvalue_info &&_kvi)
           : kvi(std::move(_kvi))
           , remove(false)
       {
       }
+      // The bytes the record stores before its tail
+      span<const char> stored() const { return compressed.empty() ? *towrite : span<const char>(compressed.data(), compressed.size()); }
+      // The length to place into the record's tail
+      uint64_t stored_length() const { return compressed.empty() ? towrite->size() : (compressed.size() | index::compressed_length_flag); }
     };
     std::vector<_item> _items;
 
@@ -663,46 +2158,209 @@ namespace key_value_store
       // in the same order, thus preventing deadlock.
       _items.erase(std::remove_if(_items.begin(), _items.end(), [](const auto &item) { return !item.towrite.has_value() && !item.remove; }), _items.end());
       std::sort(_items.begin(), _items.end(), [](const _item &a, const _item &b) { return a.kvi.key < b.kvi.key; });
+      if(_parent->_indexheader->contents_compressed)
+      {
+        // Compress before queueing, so concurrent committers compress in parallel
+        for(auto &item : _items)
+        {
+          _compress(item);
+        }
+      }
+
+      // Queue for the next commit group. Whoever finds no group being appended leads the next one,
+      // committing every queued transaction which fits into a single gather append.
+      {
+        std::unique_lock<decltype(_parent->_commitlock)> commitlockguard(_parent->_commitlock);
+        _parent->_commitqueue.push_back(this);
+        for(;;)
+        {
+          _parent->_commitcond.wait(commitlockguard, [this] { return _committed || !_parent->_commitleader; });
+          if(_committed)
+          {
+            break;
+          }
+          _parent->_commitleader = true;
+          std::vector<transaction *> group = _take_group(_parent->_commitqueue);
+          commitlockguard.unlock();
+          _commit_group(_parent, group);
+          commitlockguard.lock();
+          // Participants may destroy themselves as soon as they see this
+          for(auto *t : group)
+          {
+            t->_committed = true;
+          }
+          _parent->_commitleader = false;
+          _parent->_commitcond.notify_all();
+        }
+        _committed = false;
+      }
+      if(_failure)
+      {
+        auto failure = std::move(_failure);
+        _failure = nullptr;
+        std::rethrow_exception(failure);
+      }
+    }
+
+  private:
+    // The update list, filled in as the commit group progresses
+    struct _toupdate_type
+    {
+      const key_type key;
+      const uint64_t old_transaction_counter;
+      const bool insertion, update, removal;
+      index::value_history::item history_item{};
+      index::open_hash_index::iterator it{};
+      _toupdate_type(key_type _key, uint64_t _old_transaction_counter, bool _insertion, bool _update, bool _removal)
+          : key(_key)
+          , old_transaction_counter(_old_transaction_counter)
+          , insertion(_insertion)
+          , update(_update)
+          , removal(_removal)
+      {
+      }
+    };
+    std::vector<_toupdate_type> _toupdate;
+    uint64_t _this_transaction_counter{0};
+    std::exception_ptr _failure;  // set by the leader of the commit group if this transaction failed
+    bool _committed{false};       // set by the leader of the commit group once it is done with this transaction
+
+    // Takes queued transactions in order, as many as fit into one gather append but at least one
+    static std::vector<transaction *> _take_group(std::vector<transaction *> &queue)
+    {
+      size_t n = 0, buffers = 0;
+      for(; n < queue.size(); n++)
+      {
+        const size_t needed = 2 * queue[n]->_items.size();
+        if(n > 0 && buffers + needed > basic_key_value_store::_max_gather)
+        {
+          break;
+        }
+        buffers += needed;
+      }
+      std::vector<transaction *> group(queue.begin(), queue.begin() + n);
+      queue.erase(queue.begin(), queue.begin() + n);
+      return group;
+    }
 
-      // The update list, filled in as we progress
-      struct toupdate_type
+    // Commits a group of transactions with one append to my small file and one pass over the index,
+    // recording the failure of each transaction in it
+    static void _commit_group(basic_key_value_store *parent, const std::vector<transaction *> &group) noexcept
+    {
+      // Transactions hold iterators into the index from being prepared until their update
+      basic_key_value_store::_tables_guard tablesguard(parent);
+      std::vector<transaction *> appended;
+      llfio::file_handle::extent_type groupbegin = 0;
+      try
       {
-        const key_type key;
-        const uint64_t old_transaction_counter;
-        const bool insertion, update, removal;
-        index::value_history::item history_item{};
-        index::open_hash_index::iterator it{};
-        toupdate_type(key_type _key, uint64_t _old_transaction_counter, bool _insertion, bool _update, bool _removal)
-            : key(_key)
-            , old_transaction_counter(_old_transaction_counter)
-            , insertion(_insertion)
-            , update(_update)
-            , removal(_removal)
+        appended.reserve(group.size());
+        for(auto *t : group)
         {
+          try
+          {
+            t->_prepare();
+            appended.push_back(t);
+          }
+          catch(...)
+          {
+            t->_failure = std::current_exception();
+          }
         }
-      };
-      std::vector<toupdate_type> toupdate;
-      toupdate.reserve(_items.size());
-      // Serialise multiple threads issuing commit using the same store
-      std::lock_guard<decltype(_parent->_commitlock)> commitlockguard(_parent->_commitlock);
-
-      // Take out shared locks on all the items in my commit with existing values, early checking if we will abort
-      std::vector<index::open_hash_index::const_iterator> shared_locks;
-      shared_locks.reserve(_items.size());
+        for(auto *t : appended)
+        {
+          t->_this_transaction_counter = t->_next_transaction_counter();
+        }
+        groupbegin = parent->_indexheader->smallfile_extents[parent->_mysmallfileidx].load(std::memory_order_acquire);
+        _append(parent, appended);
+      }
+      catch(...)
+      {
+        for(auto *t : group)
+        {
+          if(!t->_failure)
+          {
+            t->_failure = std::current_exception();
+          }
+        }
+        return;
+      }
+      // Updating the index in queue order lets later transactions in the group see the updates of
+      // earlier ones, so collisions within a group abort exactly as collisions between groups do
+      for(auto *t : appended)
+      {
+        try
+        {
+          t->_update_index();
+        }
+        catch(...)
+        {
+          t->_failure = std::current_exception();
+        }
+      }
+      _update_ordered(parent, appended, groupbegin);
+    }
+    // Applies the group's updates to this process's ordered index of keys, if it keeps one
+    static void _update_ordered(basic_key_value_store *parent, const std::vector<transaction *> &appended, llfio::file_handle::extent_type groupbegin) noexcept
+    {
+      std::lock_guard<decltype(parent->_orderedlock)> orderedlockguard(parent->_orderedlock);
+      if(!parent->_ordered)
+      {
+        return;
+      }
+      try
+      {
+        for(auto *t : appended)
+        {
+          if(!t->_failure)
+          {
+            for(const auto &item : t->_items)
+            {
+              if(item.remove)
+              {
+                parent->_orderedkeys.erase(item.kvi.key);
+              }
+              else
+              {
+                parent->_orderedkeys.insert(item.kvi.key);
+              }
+            }
+          }
+        }
+        // Nothing need be walked again if nothing unseen was appended to my small file before the group
+        llfio::file_handle::extent_type &seen = parent->_orderedseen[parent->_mysmallfileidx];
+        if(seen == groupbegin)
+        {
+          seen = parent->_indexheader->smallfile_extents[parent->_mysmallfileidx].load(std::memory_order_acquire);
+        }
+      }
+      catch(...)
+      {
+        // Rebuild it upon the next scan
+        parent->_ordered_reset();
+      }
+    }
+
+    // Early checks if we will abort, and classifies each item
+    void _prepare()
+    {
+      if(_parent->_indexheader->magic != _parent->_goodmagic)
+        throw corrupted_store();
+      _toupdate.clear();
+      _toupdate.reserve(_items.size());
       for(const auto &item : _items)
       {
         bool insertion = false, update = false, removal = false;
         if(item.towrite.has_value() || item.remove)
         {
-          auto it = _parent->_index->find_shared(item.kvi.key);
-          if(it != _parent->_index->end())
+          bool found;
+          auto it = _parent->_find_shared(item.kvi.key, found);
+          if(found)
           {
             // If item was fetched before update and it has since changed, abort
             if(item.kvi.transaction_counter != (uint64_t) -1 && it->second.history[0].transaction_counter != item.kvi.transaction_counter)
             {
               throw transaction_aborted(item.kvi.key);
             }
-            shared_locks.push_back(std::move(it));
             removal = item.remove;
             update = !item.remove;
           }
@@ -712,186 +2370,271 @@ namespace key_value_store
           }
         }
         assert(insertion + update + removal == 1);
-        toupdate.emplace_back(item.kvi.key, item.kvi.transaction_counter, insertion, update, removal);
+        _toupdate.emplace_back(item.kvi.key, item.kvi.transaction_counter, insertion, update, removal);
+      }
+    }
+
+    // Compresses an item's value, keeping it only if that saves at least a 64 byte block of record
+    void _compress(_item &item) const
+    {
+      item.compressed.clear();
+      if(!item.towrite.has_value())
+      {
+        return;
       }
-      // Atomically increment the transaction counter to set this latest transaction
-      uint64_t this_transaction_counter = 0;
+      const uint64_t rawlength = item.towrite->size();
+      item.compressed.resize(sizeof(rawlength) + lz4_block::compress_bound(item.towrite->size()));
+      memcpy(item.compressed.data(), &rawlength, sizeof(rawlength));
+      item.compressed.resize(sizeof(rawlength) + lz4_block::compress(item.compressed.data() + sizeof(rawlength), item.towrite->data(), item.towrite->size(), _parent->_dictionary.data(), _parent->_dictionary.size()));
+      if(basic_key_value_store::_pad_length(item.compressed.size()) >= basic_key_value_store::_pad_length(item.towrite->size()))
       {
-        uint64_t old_transaction_counter;
-        union {
-          struct
-          {
-            uint64_t values_updated : 16;
-            uint64_t counter : 48;
-          };
-          uint64_t this_transaction_counter;
-        } _;
-        do
-        {
-          _.this_transaction_counter = old_transaction_counter = _parent->_indexheader->transaction_counter.load(std::memory_order_acquire);
-          // Increment bottom 48 bits, letting it wrap if necessary
-          _.counter++;
-          _.values_updated = _items.size();
-        } while(!_parent->_indexheader->transaction_counter.compare_exchange_weak(old_transaction_counter, _.this_transaction_counter, std::memory_order_release, std::memory_order_relaxed));
-        this_transaction_counter = _.this_transaction_counter;
+        item.compressed.clear();
       }
+    }
 
+    // Atomically increment the transaction counter to set this latest transaction
+    uint64_t _next_transaction_counter() noexcept
+    {
+      uint64_t old_transaction_counter;
+      union {
+        struct
+        {
+          uint64_t values_updated : 16;
+          uint64_t counter : 48;
+        };
+        uint64_t this_transaction_counter;
+      } _;
+      do
+      {
+        _.this_transaction_counter = old_transaction_counter = _parent->_indexheader->transaction_counter.load(std::memory_order_acquire);
+        // Increment bottom 48 bits, letting it wrap if necessary
+        _.counter++;
+        _.values_updated = _items.size();
+      } while(!_parent->_indexheader->transaction_counter.compare_exchange_weak(old_transaction_counter, _.this_transaction_counter, std::memory_order_release, std::memory_order_relaxed));
+      return _.this_transaction_counter;
+    }
+
+    // Appends the items of every transaction in the group to my small file
+    static void _append(basic_key_value_store *parent, const std::vector<transaction *> &group)
+    {
       bool items_written = false;
-      if(!_parent->_smallfiles.mapped.empty())
+      if(!parent->_smallfiles.mapped.empty())
       {
-        llfio::file_handle::extent_type original_length = _parent->_mysmallfile.maximum_extent().value();
+        llfio::file_handle::extent_type original_length = parent->_mysmallfile.maximum_extent().value();
         // How big does this map need to be?
         size_t totalcommitsize = 0;
-        for(size_t n = 0; n < _items.size(); n++)
+        for(auto *t : group)
         {
-          toupdate_type &thisupdate = toupdate[n];
-          const transaction::_item &item = _items[n];
-          totalcommitsize += thisupdate.removal ? 64 : _parent->_pad_length(item.towrite->size());
+          for(size_t n = 0; n < t->_items.size(); n++)
+          {
+            totalcommitsize += t->_toupdate[n].removal ? 64 : parent->_pad_length(t->_items[n].stored().size());
+          }
         }
         if(totalcommitsize >= 4096)
         {
-          auto &mfh = _parent->_smallfiles.mapped[_parent->_mysmallfileidx];
+          auto &mfh = parent->_smallfiles.mapped[parent->_mysmallfileidx];
           llfio::file_handle::extent_type new_length = original_length + totalcommitsize;
           if(new_length > mfh.capacity())
           {
-            mfh.reserve(new_length + _parent->_mmap_over_extension).value();
+            mfh.reserve(new_length + parent->_mmap_over_extension).value();
           }
           mfh.truncate(new_length).value();
           llfio::byte *value = mfh.address() + original_length;
           llfio::file_handle::extent_type value_offset = original_length;
-          for(size_t n = 0; n < _items.size(); n++)
+          for(auto *t : group)
           {
-            toupdate_type &thisupdate = toupdate[n];
-            const transaction::_item &item = _items[n];
-            size_t totalwrite = 0;
-            if(thisupdate.removal)
+            for(size_t n = 0; n < t->_items.size(); n++)
             {
-              totalwrite = 64;
+              _toupdate_type &thisupdate = t->_toupdate[n];
+              const transaction::_item &item = t->_items[n];
+              size_t totalwrite = 0;
+              if(thisupdate.removal)
+              {
+                totalwrite = 64;
+              }
+              else
+              {
+                memcpy(value, item.stored().data(), item.stored().size());
+                totalwrite = parent->_pad_length(item.stored().size());
+              }
+              index::value_tail *vt = reinterpret_cast<index::value_tail *>(value + totalwrite - sizeof(index::value_tail));
+              vt->key = thisupdate.key;
+              vt->transaction_counter = t->_this_transaction_counter;
+              if(thisupdate.removal)
+              {
+                vt->length = (uint64_t) -1;  // this key is being deleted
+                memset(&thisupdate.history_item, 0, sizeof(thisupdate.history_item));
+              }
+              else
+              {
+                vt->length = item.stored_length();
+                index::value_history::item &history_item = thisupdate.history_item;
+                history_item.transaction_counter = t->_this_transaction_counter;
+                history_item.value_offset = (value_offset + totalwrite) / 64;
+                history_item.value_identifier = parent->_mysmallfileidx;
+                history_item.length = vt->length;
+              }
+              if(parent->_indexheader->contents_hashed)
+              {
+                vt->hash = QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash((char *) value, totalwrite);
+              }
+              value += totalwrite;
+              value_offset += totalwrite;
             }
-            else
+          }
+          parent->_indexheader->smallfile_extents[parent->_mysmallfileidx].store(new_length, std::memory_order_release);
+          items_written = true;
+        }
+      }
+      if(!items_written)
+      {
+        // Gather append write all the group's items to my smallfile
+        llfio::file_handle::extent_type value_offset = parent->_mysmallfile.maximum_extent().value();
+        assert((value_offset % 64) == 0);
+        std::vector<llfio::file_handle::const_buffer_type> reqs;
+        reqs.reserve(basic_key_value_store::_max_gather);
+        // Each item in a write needs at most one tail buffer
+        std::vector<llfio::byte> tailbuffers(basic_key_value_store::_max_gather * 128);
+        size_t tails = 0;
+        for(auto *t : group)
+        {
+          for(size_t n = 0; n < t->_items.size(); n++)
+          {
+            _toupdate_type &thisupdate = t->_toupdate[n];
+            const transaction::_item &item = t->_items[n];
+            if(reqs.size() + (thisupdate.removal ? 1 : 2) > basic_key_value_store::_max_gather)
             {
-              memcpy(value, item.towrite->data(), item.towrite->size());
-              totalwrite = _parent->_pad_length(item.towrite->size());
+              parent->_mysmallfile.write({reqs, 0}).value();
+              reqs.clear();
+              tails = 0;
             }
-            index::value_tail *vt = reinterpret_cast<index::value_tail *>(value + totalwrite - sizeof(index::value_tail));
+            llfio::byte *tailbuffer = tailbuffers.data() + 128 * tails++;
+            index::value_tail *vt = reinterpret_cast<index::value_tail *>(tailbuffer + 128 - sizeof(index::value_tail));
             vt->key = thisupdate.key;
-            vt->transaction_counter = this_transaction_counter;
+            vt->transaction_counter = t->_this_transaction_counter;
+            size_t totalwrite = 0;
             if(thisupdate.removal)
             {
               vt->length = (uint64_t) -1;  // this key is being deleted
+              totalwrite = 64;
+              reqs.push_back({tailbuffer + 64, 64});
+              if(parent->_indexheader->contents_hashed)
+              {
+                QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash hasher;
+                memset(&vt->hash, 0, sizeof(vt->hash));
+                hasher.add((const char *) reqs.back().data(), reqs.back().size());
+                vt->hash = hasher.finalise();
+              }
               memset(&thisupdate.history_item, 0, sizeof(thisupdate.history_item));
             }
             else
             {
-              vt->length = item.towrite->size();
+              const span<const char> stored = item.stored();
+              vt->length = item.stored_length();
+              totalwrite = parent->_pad_length(stored.size());
+              size_t tailbytes = totalwrite - stored.size();
+              assert(tailbytes < 128);
+              reqs.push_back({(llfio::byte *) stored.data(), stored.size()});
+              reqs.push_back({tailbuffer + 128 - tailbytes, tailbytes});
+              if(parent->_indexheader->contents_hashed)
+              {
+                QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash hasher;
+                memset(&vt->hash, 0, sizeof(vt->hash));
+                auto rit = reqs.end();
+                rit -= 2;
+                hasher.add((char *) rit->data(), rit->size());
+                ++rit;
+                hasher.add((char *) rit->data(), rit->size());
+                vt->hash = hasher.finalise();
+              }
               index::value_history::item &history_item = thisupdate.history_item;
-              history_item.transaction_counter = this_transaction_counter;
+              history_item.transaction_counter = t->_this_transaction_counter;
               history_item.value_offset = (value_offset + totalwrite) / 64;
-              history_item.value_identifier = _parent->_mysmallfileidx;
+              history_item.value_identifier = parent->_mysmallfileidx;
               history_item.length = vt->length;
             }
-            if(_parent->_indexheader->contents_hashed)
-            {
-              vt->hash = QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash::hash((char *) value, totalwrite);
-            }
-            value += totalwrite;
             value_offset += totalwrite;
           }
-          items_written = true;
         }
+        if(!reqs.empty())
+        {
+          parent->_mysmallfile.write({reqs, 0}).value();
+        }
+        parent->_indexheader->smallfile_extents[parent->_mysmallfileidx].store(value_offset, std::memory_order_release);
       }
-      if(!items_written)
+    }
+
+    // Takes exclusive locks on all items in this transaction, inserting new keys if necessary, then updates them
+    // Retries in the newest generation of hash table whenever the index grows meanwhile
+    void _update_index()
+    {
+      auto cleanup = make_scope_exit([this]() noexcept { _toupdate.clear(); });
+      for(;;)
       {
-        // Gather append write all my items to my smallfile
-        llfio::file_handle::extent_type value_offset = _parent->_mysmallfile.maximum_extent().value();
-        assert((value_offset % 64) == 0);
-        // POSIX guarantees that at least 16 gather buffers can be written in a single shot
-        std::vector<llfio::file_handle::const_buffer_type> reqs;
-        reqs.reserve(16);
-        // With tails, that's eight items per syscall
-        llfio::byte tailbuffers[8][128];
-        memset(tailbuffers, 0, sizeof(tailbuffers));
-        for(size_t n = 0; n < _items.size(); n++)
+        basic_key_value_store::_hash_table *full = nullptr;
+        if(_try_update_index(full))
         {
-          llfio::byte *tailbuffer = tailbuffers[n % 8];
-          index::value_tail *vt = reinterpret_cast<index::value_tail *>(tailbuffer + 128 - sizeof(index::value_tail));
-          toupdate_type &thisupdate = toupdate[n];
-          const transaction::_item &item = _items[n];
-          vt->key = thisupdate.key;
-          vt->transaction_counter = this_transaction_counter;
-          size_t totalwrite = 0;
-          if(thisupdate.removal)
-          {
-            vt->length = (uint64_t) -1;  // this key is being deleted
-            totalwrite = 64;
-            reqs.push_back({tailbuffer + 64, 64});
-            if(_parent->_indexheader->contents_hashed)
-            {
-              QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash hasher;
-              memset(&vt->hash, 0, sizeof(vt->hash));
-              hasher.add((const char *) reqs.back().data(), reqs.back().size());
-              vt->hash = hasher.finalise();
-            }
-            memset(&thisupdate.history_item, 0, sizeof(thisupdate.history_item));
-          }
-          else
-          {
-            vt->length = item.towrite->size();
-            totalwrite = _parent->_pad_length(item.towrite->size());
-            size_t tailbytes = totalwrite - item.towrite->size();
-            assert(tailbytes < 128);
-            reqs.push_back({(llfio::byte *) item.towrite->data(), item.towrite->size()});
-            reqs.push_back({tailbuffer + 128 - tailbytes, tailbytes});
-            if(_parent->_indexheader->contents_hashed)
-            {
-              QUICKCPPLIB_NAMESPACE::algorithm::hash::fast_hash hasher;
-              memset(&vt->hash, 0, sizeof(vt->hash));
-              auto rit = reqs.end();
-              rit -= 2;
-              hasher.add((char *) rit->data(), rit->size());
-              ++rit;
-              hasher.add((char *) rit->data(), rit->size());
-              vt->hash = hasher.finalise();
-            }
-            index::value_history::item &history_item = thisupdate.history_item;
-            history_item.transaction_counter = this_transaction_counter;
-            history_item.value_offset = (value_offset + totalwrite) / 64;
-            history_item.value_identifier = _parent->_mysmallfileidx;
-            history_item.length = vt->length;
-          }
-          value_offset += totalwrite;
-          if((n % 8) == 7)
-          {
-            _parent->_mysmallfile.write({reqs, 0}).value();
-            reqs.clear();
-          }
+          return;
         }
-        if(!reqs.empty())
+        if(full != nullptr)
         {
-          _parent->_mysmallfile.write({reqs, 0}).value();
+          _parent->_grow(full);
         }
       }
+    }
 
-      // Release all the shared locks on the existing items we are about to update
-      shared_locks.clear();
+    // Takes exclusive locks on all items in this transaction, inserting new keys if necessary, then updates
+    // them. Returns false having undone everything if the index grew, or must grow, before the update.
+    bool _try_update_index(basic_key_value_store::_hash_table *&full)
+    {
+      // Release the exclusive locks before retrying, or before the next transaction in the group takes its own
+      auto unlock = make_scope_exit([this]() noexcept {
+        for(auto &item : _toupdate)
+        {
+          item.it = index::open_hash_index::iterator();
+        }
+      });
       // Bail out if store has become corrupted
       if(_parent->_indexheader->magic != _parent->_goodmagic)
         throw corrupted_store();
+      _parent->_sync_generation();
+      auto tables = _parent->_tables_in_use();
+      basic_key_value_store::_hash_table *table = tables.second;
+      // Grow before probe chains lengthen, keeping room in the newest generation for every key still to move into it
+      const size_t insertions = std::count_if(_toupdate.begin(), _toupdate.end(), [](const _toupdate_type &item) { return item.insertion; });
+      if(insertions > 0)
+      {
+        uint64_t keys = _parent->_indexheader->keys[table->generation % 2].load(std::memory_order_relaxed);
+        if(tables.first != nullptr)
+        {
+          keys += _parent->_indexheader->keys[tables.first->generation % 2].load(std::memory_order_relaxed);
+        }
+        if(keys + insertions > table->entries / 4 * 3)
+        {
+          full = table;
+          return false;
+        }
+      }
       // Remove any newly inserted keys if we abort
-      auto removeinserted = make_scope_exit([this, &toupdate]() noexcept {
-        for(auto updit = toupdate.rend(); updit != toupdate.rbegin(); ++updit)
+      auto removeinserted = make_scope_exit([this, table]() noexcept {
+        for(auto updit = _toupdate.rbegin(); updit != _toupdate.rend(); ++updit)
         {
-          if(updit->insertion && updit->it != _parent->_index->end())
+          if(updit->insertion && updit->it != table->index.end())
           {
-            _parent->_index->erase(std::move(updit->it));
+            table->index.erase(std::move(updit->it));
+            _parent->_indexheader->keys[table->generation % 2].fetch_sub(1);
           }
         }
       });
-      // Take exclusive locks on all items in this transaction, inserting new keys if necessary
-      for(toupdate_type &item : toupdate)
+      for(_toupdate_type &item : _toupdate)
       {
-        auto it = _parent->_index->find_exclusive(item.key);
-        if(it != _parent->_index->end())
+        if(tables.first != nullptr)
+        {
+          // Keys move into the newest generation of hash table when accessed
+          _parent->_migrate(tables.first, table, item.key);
+        }
+        auto it = table->index.find_exclusive(item.key);
+        if(it != table->index.end())
         {
           if(item.insertion || (item.update && it->second.history[0].transaction_counter != item.old_transaction_counter))
           {
@@ -909,11 +2652,14 @@ namespace key_value_store
           // Insert a new key with empty history
           index::value_history vh;
           memset(&vh, 0, sizeof(vh));
-          it = _parent->_index->insert({item.key, std::move(vh)}).first;
-          if(it == _parent->_index->end())
+          table->bloom.add(item.key);
+          it = table->index.insert({item.key, std::move(vh)}).first;
+          if(it == table->index.end())
           {
-            throw index_full();
+            full = table;
+            return false;
           }
+          _parent->_indexheader->keys[table->generation % 2].fetch_add(1);
         }
         // Store the exclusive lock away for later
         item.it = std::move(it);
@@ -921,12 +2667,17 @@ namespace key_value_store
 
       if(_parent->_indexheader->magic != _parent->_goodmagic)
         throw corrupted_store();
+      // A writer which grew the index since we synced may already have moved keys out of this generation
+      if(_parent->_indexheader->generation.load(std::memory_order_acquire) != table->generation)
+      {
+        return false;
+      }
       // Finally actually perform the update as quickly as possible to reduce the
       // possibility of a partially issued update which is expensive to repair.
       // This can no longer abort, so dismiss the removeinserter
       removeinserted.release();
       _parent->_indexheader->writes_occurring[_parent->_mysmallfileidx].fetch_add(1);
-      for(auto &item : toupdate)
+      for(auto &item : _toupdate)
       {
         // Update existing value's latest revision
         index::value_history &value = item.it->second;
@@ -945,11 +2696,13 @@ namespace key_value_store
           }
           if(alldeleted)
           {
-            _parent->_index->erase(std::move(item.it));
+            table->index.erase(std::move(item.it));
+            _parent->_indexheader->keys[table->generation % 2].fetch_sub(1);
           }
         }
       }
       _parent->_indexheader->writes_occurring[_parent->_mysmallfileidx].fetch_sub(1);
+      return true;
     }
   };
 }
@@ -0,0 +1,225 @@
+/* LZ4 block format codec for the prototype key-value store
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef KEY_VALUE_STORE_LZ4_BLOCK_HPP
+#define KEY_VALUE_STORE_LZ4_BLOCK_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace key_value_store
+{
+  /*! A compressor and decompressor of the LZ4 block format, whose matches may reach back
+  into a preset dictionary of sample values preceding the block. Short values have little
+  history of their own to match against, so a dictionary is what makes them compress.
+  */
+  namespace lz4_block
+  {
+    //! The furthest back a match may reach
+    static constexpr size_t max_distance = 65535;
+
+    //! The most bytes compressing `bytes` can produce
+    constexpr size_t compress_bound(size_t bytes) { return bytes + bytes / 255 + 16; }
+
+    //! Compresses `src` into `dst`, which must have room for `compress_bound(srclength)` bytes, returning the bytes written
+    inline size_t compress(char *dst, const char *src, size_t srclength, const char *dict = nullptr, size_t dictlength = 0)
+    {
+      static constexpr int hashlog = 12;
+      static constexpr size_t minmatch = 4, lastliterals = 5, mflimit = 12;
+      if(dictlength > max_distance)
+      {
+        dict += dictlength - max_distance;
+        dictlength = max_distance;
+      }
+      // Matches are found in the dictionary followed by the source
+      std::vector<char> window(dictlength + srclength);
+      if(dictlength > 0)
+      {
+        memcpy(window.data(), dict, dictlength);
+      }
+      if(srclength > 0)
+      {
+        memcpy(window.data() + dictlength, src, srclength);
+      }
+      const char *const base = window.data(), *const begin = base + dictlength, *const end = begin + srclength;
+      // Positions plus one, so zero means empty
+      std::vector<uint32_t> table(1 << hashlog, 0);
+      auto hash = [](const char *p) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return (v * 2654435761U) >> (32 - hashlog);
+      };
+      auto write_length = [](char *op, size_t length) {
+        for(length -= 15; length >= 255; length -= 255)
+        {
+          *op++ = (char) 255;
+        }
+        *op++ = (char) length;
+        return op;
+      };
+      for(const char *p = base; p < begin && p + minmatch <= end; p++)
+      {
+        table[hash(p)] = (uint32_t)(p - base) + 1;
+      }
+      char *op = dst;
+      const char *anchor = begin, *ip = begin;
+      if(srclength >= mflimit + 1)
+      {
+        const char *const matchlimit = end - lastliterals;
+        while(ip <= end - mflimit)
+        {
+          const uint32_t h = hash(ip);
+          const char *ref = (table[h] != 0) ? base + table[h] - 1 : nullptr;
+          table[h] = (uint32_t)(ip - base) + 1;
+          if(ref == nullptr || (size_t)(ip - ref) > max_distance || memcmp(ref, ip, minmatch) != 0)
+          {
+            ip++;
+            continue;
+          }
+          const char *mp = ip + minmatch, *rp = ref + minmatch;
+          while(mp < matchlimit && *mp == *rp)
+          {
+            mp++;
+            rp++;
+          }
+          const size_t literals = ip - anchor, matchlength = mp - ip - minmatch, offset = ip - ref;
+          char *token = op++;
+          *token = (char) ((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchlength, 15));
+          if(literals >= 15)
+          {
+            op = write_length(op, literals);
+          }
+          memcpy(op, anchor, literals);
+          op += literals;
+          *op++ = (char) (offset & 255);
+          *op++ = (char) (offset >> 8);
+          if(matchlength >= 15)
+          {
+            op = write_length(op, matchlength);
+          }
+          ip = anchor = mp;
+        }
+      }
+      // The block always ends with literals
+      const size_t literals = end - anchor;
+      *op++ = (char) (std::min<size_t>(literals, 15) << 4);
+      if(literals >= 15)
+      {
+        op = write_length(op, literals);
+      }
+      if(literals > 0)
+      {
+        memcpy(op, anchor, literals);
+      }
+      return op + literals - dst;
+    }
+
+    //! Decompresses `src` into exactly `dstlength` bytes at `dst`, returning false if `src` is not a valid block of that length
+    inline bool decompress(char *dst, size_t dstlength, const char *src, size_t srclength, const char *dict = nullptr, size_t dictlength = 0) noexcept
+    {
+      const unsigned char *ip = reinterpret_cast<const unsigned char *>(src), *const iend = ip + srclength;
+      char *op = dst, *const oend = dst + dstlength;
+      auto read_length = [&](size_t &length) {
+        if(length == 15)
+        {
+          unsigned char c;
+          do
+          {
+            if(ip == iend)
+            {
+              return false;
+            }
+            c = *ip++;
+            length += c;
+          } while(c == 255);
+        }
+        return true;
+      };
+      while(ip < iend)
+      {
+        const unsigned token = *ip++;
+        size_t literals = token >> 4;
+        if(!read_length(literals) || literals > (size_t)(iend - ip) || literals > (size_t)(oend - op))
+        {
+          return false;
+        }
+        if(literals > 0)
+        {
+          memcpy(op, ip, literals);
+          op += literals;
+          ip += literals;
+        }
+        if(ip == iend)
+        {
+          // The last sequence has no match
+          break;
+        }
+        if(iend - ip < 2)
+        {
+          return false;
+        }
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchlength = token & 15;
+        if(!read_length(matchlength))
+        {
+          return false;
+        }
+        matchlength += 4;
+        if(offset == 0 || matchlength > (size_t)(oend - op))
+        {
+          return false;
+        }
+        const size_t produced = op - dst;
+        if(offset > produced)
+        {
+          // The match begins in the dictionary
+          const size_t back = offset - produced;
+          if(back > dictlength)
+          {
+            return false;
+          }
+          const size_t fromdict = std::min(matchlength, back);
+          memcpy(op, dict + dictlength - back, fromdict);
+          op += fromdict;
+          matchlength -= fromdict;
+        }
+        if(matchlength > 0)
+        {
+          // Byte by byte, as matches may overlap what they produce
+          const char *mp = op - offset;
+          while(matchlength-- > 0)
+          {
+            *op++ = *mp++;
+          }
+        }
+      }
+      return op == oend;
+    }
+  }  // namespace lz4_block
+}  // namespace key_value_store
+
+#endif
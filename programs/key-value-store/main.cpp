@@ -24,7 +24,14 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "include/key_value_store.hpp"
 
+#include <fstream>
 #include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 namespace stackoverflow
 {
@@ -228,6 +235,472 @@ int main()
       std::error_code ec;
       LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
     }
+    // test free space consolidation
+    {
+      key_value_store::basic_key_value_store store("teststore", 2000, true);
+      std::vector<std::string> values(1000);
+      for(size_t round = 0; round < 8; round++)
+      {
+        key_value_store::transaction tr(store);
+        for(size_t n = 0; n < values.size(); n++)
+        {
+          values[n] = std::to_string(round) + ":" + std::string(1024, (char) ('a' + n % 26));
+          tr.update_unsafe(n, values[n]);
+        }
+        tr.commit();
+      }
+      auto stats = store.compact();
+      std::cout << "Compaction copied " << stats.records_copied << " records of " << stats.bytes_copied << " bytes and deallocated " << stats.bytes_deallocated << " bytes" << std::endl;
+      if(stats.bytes_deallocated == 0)
+      {
+        std::cerr << "FAILURE: Compaction deallocated nothing!" << std::endl;
+      }
+      for(size_t n = 0; n < values.size(); n++)
+      {
+        auto kvi = store.find(n, 3);
+        if(!kvi || std::string(kvi.value.data(), kvi.value.size()).compare(0, 2, "4:") != 0)
+        {
+          std::cerr << "FAILURE: Revision 3 of key " << n << " was lost by compaction!" << std::endl;
+          break;
+        }
+        kvi = store.find(n);
+        if(!kvi || std::string(kvi.value.data(), kvi.value.size()) != values[n])
+        {
+          std::cerr << "FAILURE: Key " << n << " was lost by compaction!" << std::endl;
+          break;
+        }
+      }
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test online growth of the index from far too small
+    {
+      key_value_store::basic_key_value_store store("teststore", 16);
+      for(size_t n = 0; n < 1000; n += 10)
+      {
+        key_value_store::transaction tr(store);
+        for(size_t m = n; m < n + 10; m++)
+        {
+          tr.update_unsafe(m, "grown");
+        }
+        tr.commit();
+      }
+      while(!store.migrate())
+      {
+      }
+      for(size_t n = 0; n < 1000; n++)
+      {
+        if(!store.find(n))
+        {
+          std::cerr << "FAILURE: Key " << n << " was lost by growing the index!" << std::endl;
+          break;
+        }
+      }
+#ifdef __linux__
+      // Superseded generations, whose files were unlinked at cutover, are no longer mapped
+      std::ifstream maps("/proc/self/maps");
+      for(std::string line; std::getline(maps, line);)
+      {
+        if(line.find("teststore/") != std::string::npos && line.find("(deleted)") != std::string::npos)
+        {
+          std::cerr << "FAILURE: Superseded generations of the index are still mapped!" << std::endl;
+          break;
+        }
+      }
+#endif
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test concurrent commits, which are grouped into shared appends
+    {
+      key_value_store::basic_key_value_store store("teststore", 20000, true);
+      std::vector<std::thread> threads;
+      std::atomic<size_t> aborted{0};
+      for(size_t thread = 0; thread < 4; thread++)
+      {
+        threads.emplace_back([&store, &aborted, thread] {
+          const std::string value = "thread " + std::to_string(thread);
+          for(size_t n = 0; n < 1000; n++)
+          {
+            try
+            {
+              key_value_store::transaction tr(store);
+              // Every thread also updates key 0 based on what it fetched, so some of these may abort
+              tr.fetch(0);
+              tr.update(0, value);
+              tr.update_unsafe(1 + thread * 1000 + n, value);
+              tr.commit();
+            }
+            catch(const key_value_store::transaction_aborted &)
+            {
+              ++aborted;
+            }
+          }
+        });
+      }
+      for(auto &thread : threads)
+      {
+        thread.join();
+      }
+      std::cout << aborted << " of 4000 concurrent transactions aborted" << std::endl;
+      size_t found = 0;
+      for(size_t n = 1; n <= 4000; n++)
+      {
+        if(store.find(n))
+        {
+          found++;
+        }
+      }
+      if(found + aborted != 4000)
+      {
+        std::cerr << "FAILURE: " << found << " keys were committed by " << (4000 - aborted) << " transactions!" << std::endl;
+      }
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test per-record compression with a preset dictionary
+    {
+      const std::string dictionary = "{\"name\":\"\",\"email\":\"@example.com\",\"tags\":[\"compressible\",\"json\"],\"active\":true}";
+      key_value_store::basic_key_value_store store("teststore", 2000, true, LLFIO_V2_NAMESPACE::file_handle::mode::write, LLFIO_V2_NAMESPACE::file_handle::caching::all, true, dictionary);
+      std::vector<std::string> values(1000);
+      size_t rawbytes = 0;
+      {
+        key_value_store::transaction tr(store);
+        for(size_t n = 0; n < values.size(); n++)
+        {
+          for(size_t m = 0; m < 12; m++)
+          {
+            values[n] += "{\"name\":\"user" + std::to_string(n * 12 + m) + "\",\"email\":\"user" + std::to_string(n) + "@example.com\",\"tags\":[\"compressible\",\"json\"],\"active\":true}";
+          }
+          if(n % 100 == 0)
+          {
+            // Values which don't compress are stored raw
+            values[n].clear();
+            for(size_t m = 0; m < 256; m++)
+            {
+              values[n].push_back((char) ((n * 7919 + m * 104729) >> 3));
+            }
+          }
+          rawbytes += values[n].size();
+          tr.update_unsafe(n, values[n]);
+        }
+        tr.commit();
+      }
+      auto storedbytes = LLFIO_V2_NAMESPACE::filesystem::file_size("teststore/0");
+      std::cout << "Compression stored " << rawbytes << " bytes of values in " << storedbytes << " bytes" << std::endl;
+      if(storedbytes >= rawbytes)
+      {
+        std::cerr << "FAILURE: Compression did not shrink the values!" << std::endl;
+      }
+      for(size_t n = 0; n < values.size(); n++)
+      {
+        auto kvi = store.find(n);
+        if(!kvi || std::string(kvi.value.data(), kvi.value.size()) != values[n])
+        {
+          std::cerr << "FAILURE: Key " << n << " did not decompress to its value!" << std::endl;
+          break;
+        }
+      }
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test the shared hot value cache never returns a value since updated
+    {
+      key_value_store::basic_key_value_store store("teststore", 2000, true);
+      store.use_cache(64, 64);
+      std::vector<std::string> values(200);
+      for(size_t round = 0; round < 3; round++)
+      {
+        {
+          key_value_store::transaction tr(store);
+          for(size_t n = 0; n < values.size(); n++)
+          {
+            values[n] = std::to_string(round) + ":" + std::to_string(n);
+            tr.update_unsafe(n, values[n]);
+          }
+          tr.commit();
+        }
+        // The second pass through should mostly come from the cache
+        for(size_t pass = 0; pass < 2; pass++)
+        {
+          for(size_t n = 0; n < values.size(); n++)
+          {
+            auto kvi = store.find(n);
+            if(!kvi || std::string(kvi.value.data(), kvi.value.size()) != values[n])
+            {
+              std::cerr << "FAILURE: Key " << n << " had a stale cached value!" << std::endl;
+              break;
+            }
+            if(round > 0)
+            {
+              kvi = store.find(n, 1);
+              if(!kvi || std::string(kvi.value.data(), kvi.value.size()) != std::to_string(round - 1) + ":" + std::to_string(n))
+              {
+                std::cerr << "FAILURE: Revision 1 of key " << n << " had the wrong cached value!" << std::endl;
+                break;
+              }
+            }
+          }
+        }
+      }
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test looking up many keys at once, by reads and by maps
+    {
+      key_value_store::basic_key_value_store store("teststore", 2000, true);
+      std::vector<std::string> values(500);
+      {
+        key_value_store::transaction tr(store);
+        for(size_t n = 0; n < values.size(); n++)
+        {
+          values[n] = "many " + std::to_string(n);
+          tr.update_unsafe(n, values[n]);
+        }
+        tr.commit();
+      }
+      // Every other key, backwards, with some which don't exist, and copies of key 7 at the
+      // front, in the middle and at the end, so runs of one key sort in assorted orders
+      std::vector<key_value_store::key_type> keys;
+      std::vector<size_t> expected;
+      keys.push_back(7);
+      expected.push_back(7);
+      for(size_t n = values.size() + 10; n > 0; n -= 2)
+      {
+        keys.push_back(n - 1);
+        expected.push_back(n - 1);
+        if(n == values.size() / 2)
+        {
+          keys.push_back(7);
+          expected.push_back(7);
+        }
+      }
+      for(size_t n = 0; n < 2; n++)
+      {
+        keys.push_back(7);
+        expected.push_back(7);
+      }
+      for(size_t mmaps = 0; mmaps < 2; mmaps++)
+      {
+        if(mmaps)
+        {
+          store.use_mmaps();
+        }
+        auto kvis = store.find_many(keys);
+        for(size_t n = 0; n < keys.size(); n++)
+        {
+          const bool correct = (expected[n] < values.size()) ? (kvis[n] && std::string(kvis[n].value.data(), kvis[n].value.size()) == values[expected[n]]) : !kvis[n];
+          if(!correct)
+          {
+            std::cerr << "FAILURE: find_many() of key " << expected[n] << " returned the wrong value!" << std::endl;
+            break;
+          }
+        }
+      }
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test range and prefix scans of the ordered index, both built and maintained
+    {
+      key_value_store::basic_key_value_store store("teststore", 2000);
+      {
+        key_value_store::transaction tr(store);
+        for(size_t n = 0; n < 1000; n++)
+        {
+          tr.update_unsafe(n, "ordered");
+        }
+        tr.commit();
+      }
+      store.use_ordered_index();
+      {
+        key_value_store::transaction tr(store);
+        for(size_t n = 0; n < 1000; n += 10)
+        {
+          tr.remove_unsafe(n);
+        }
+        tr.commit();
+      }
+      // Every key from first to last which was not removed
+      auto check = [](const std::vector<key_value_store::key_type> &keys, size_t first, size_t last, const char *what) {
+        std::vector<key_value_store::key_type> expected;
+        for(size_t n = first; n <= last; n++)
+        {
+          if(n % 10 != 0)
+          {
+            expected.push_back(n);
+          }
+        }
+        if(keys != expected)
+        {
+          std::cerr << "FAILURE: " << what << " returned " << keys.size() << " keys instead of " << expected.size() << " in order!" << std::endl;
+        }
+      };
+      check(store.keys_in_range(100, 200), 100, 199, "keys_in_range()");
+      check(store.keys_with_prefix(256, 120), 256, 511, "keys_with_prefix()");
+#ifndef _WIN32
+      // Commits by another process are picked up by the next scan
+      const pid_t child = fork();
+      if(child == 0)
+      {
+        try
+        {
+          key_value_store::basic_key_value_store other("teststore", 2000);
+          key_value_store::transaction tr(other);
+          for(size_t n = 1000; n < 1100; n++)
+          {
+            if(n % 10 != 0)
+            {
+              tr.update_unsafe(n, "other process");
+            }
+          }
+          tr.remove_unsafe(999);
+          tr.commit();
+        }
+        catch(...)
+        {
+          _exit(1);
+        }
+        _exit(0);
+      }
+      int status = 0;
+      if(child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      {
+        std::cerr << "FAILURE: Another process could not commit to the store!" << std::endl;
+      }
+      else
+      {
+        check(store.keys_in_range(990, 1000), 990, 998, "keys_in_range() after another process removed");
+        check(store.keys_in_range(1000, 1100), 1000, 1099, "keys_in_range() after another process inserted");
+      }
+#endif
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test the Bloom filters never reject a key inserted, and grow along with the index
+    {
+      key_value_store::basic_key_value_store store("teststore", 64);
+      if(!LLFIO_V2_NAMESPACE::filesystem::exists("teststore/bloom"))
+      {
+        std::cerr << "FAILURE: The store was created without a Bloom filter!" << std::endl;
+      }
+      for(size_t n = 0; n < 2000; n += 20)
+      {
+        key_value_store::transaction tr(store);
+        for(size_t m = n; m < n + 20; m += 2)
+        {
+          tr.update_unsafe(m, "filtered");
+        }
+        tr.commit();
+      }
+      while(!store.migrate())
+      {
+      }
+      // The first generation's filter is released, and the newest holds at least 512 bits per 32 keys
+      uintmax_t filterbytes = 0;
+      for(const auto &entry : LLFIO_V2_NAMESPACE::filesystem::directory_iterator("teststore"))
+      {
+        if(entry.path().filename().string().compare(0, 6, "bloom.") == 0 && LLFIO_V2_NAMESPACE::filesystem::file_size(entry.path()) > filterbytes)
+        {
+          filterbytes = LLFIO_V2_NAMESPACE::filesystem::file_size(entry.path());
+        }
+      }
+      if(LLFIO_V2_NAMESPACE::filesystem::exists("teststore/bloom") || filterbytes < 64 + 1000 / 32 * 64)
+      {
+        std::cerr << "FAILURE: The Bloom filter did not grow with the index!" << std::endl;
+      }
+      for(size_t n = 0; n < 2000; n++)
+      {
+        const bool inserted = (n % 2 == 0);
+        if(static_cast<bool>(store.find(n)) != inserted)
+        {
+          std::cerr << "FAILURE: Key " << n << " was " << (inserted ? "not found" : "found") << " despite the Bloom filter!" << std::endl;
+          break;
+        }
+      }
+      std::vector<key_value_store::key_type> keys = {1, 2, 3, 4, 5};
+      auto found = store.find_many(keys);
+      if(found[0] || !found[1] || found[2] || !found[3] || found[4])
+      {
+        std::cerr << "FAILURE: find_many() disagreed with the Bloom filter!" << std::endl;
+      }
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
+    // test bulk loading far more keys than the index holds, which appear all at once or not at all
+    {
+      key_value_store::basic_key_value_store store("teststore", 16, true);
+      std::vector<std::string> values(10000);
+      std::vector<std::pair<key_value_store::key_type, key_value_store::span<const char>>> items;
+      for(size_t n = 0; n < values.size(); n++)
+      {
+        values[n] = "bulk " + std::to_string(n * n);
+        items.emplace_back(n, values[n]);
+      }
+      {
+        auto duplicated = items;
+        duplicated.push_back(items[5]);
+        bool refused = false;
+        try
+        {
+          store.bulk_load(duplicated);
+        }
+        catch(const std::invalid_argument &)
+        {
+          refused = true;
+        }
+        if(!refused || store.find(5))
+        {
+          std::cerr << "FAILURE: A bulk load of duplicated keys was not refused!" << std::endl;
+        }
+      }
+      store.bulk_load(items);
+      for(size_t n = 0; n < values.size(); n++)
+      {
+        auto kvi = store.find(n);
+        if(!kvi || std::string(kvi.value.data(), kvi.value.size()) != values[n])
+        {
+          std::cerr << "FAILURE: Key " << n << " was not bulk loaded!" << std::endl;
+          break;
+        }
+      }
+      if(!store.migrate())
+      {
+        std::cerr << "FAILURE: The bulk load's index was not fully published!" << std::endl;
+      }
+      bool refused = false;
+      try
+      {
+        store.bulk_load(items);
+      }
+      catch(const std::invalid_argument &)
+      {
+        refused = true;
+      }
+      if(!refused)
+      {
+        std::cerr << "FAILURE: A bulk load into a store holding keys was not refused!" << std::endl;
+      }
+    }
+    {
+      std::error_code ec;
+      LLFIO_V2_NAMESPACE::filesystem::remove_all("teststore", ec);
+    }
     {
       key_value_store::basic_key_value_store store("teststore", 2000000);
       benchmark(store, "no integrity, no durability, read + append");
@@ -0,0 +1,399 @@
+/* Runs named LLFIO benchmark suites, emitting uniform JSON for regression tracking
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+//! Size of the test file used by the i/o suites
+#define TESTFILE_SIZE (64 * 1024 * 1024)
+
+#include "../../include/llfio/llfio.hpp"
+#include "../../include/llfio/revision.hpp"
+#include "quickcpplib/algorithm/small_prng.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace llfio = LLFIO_V2_NAMESPACE;
+using QUICKCPPLIB_NAMESPACE::algorithm::small_prng::small_prng;
+
+#define LLFIO_BENCH_STRINGIZE2(x) #x
+#define LLFIO_BENCH_STRINGIZE(x) LLFIO_BENCH_STRINGIZE2(x)
+
+/* A suite's setup returns the operation to be timed, which captures any state
+it needs. Setup reports failure by throwing, and the suite is then skipped.
+*/
+struct suite
+{
+  const char *name;
+  const char *description;
+  std::function<std::function<void()>()> setup;
+};
+
+struct options
+{
+  std::regex which{".*"};
+  unsigned warmup_ms{200};
+  unsigned repetitions{15};
+  unsigned repetition_ms{100};
+};
+
+struct measurement
+{
+  std::string suite;
+  size_t iterations{0};  // operations per repetition
+  std::vector<double> samples;  // nanoseconds per operation, one per repetition
+  double mean{0}, median{0}, stddev{0}, min{0}, max{0}, ci95_low{0}, ci95_high{0};
+};
+
+// Two sided 95% critical values of Student's t distribution for 1 to 30 degrees of freedom
+static double student_t95(size_t df)
+{
+  static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+                                 2.120,  2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if(df == 0)
+  {
+    return 0;
+  }
+  return (df <= sizeof(table) / sizeof(table[0])) ? table[df - 1] : 1.960;
+}
+
+/* Warms up for warmup_ms, calibrates the operations which fill repetition_ms,
+then times that many operations repetitions times.
+*/
+static measurement run_suite(const suite &s, const options &opts, const std::function<void()> &op)
+{
+  using clock = std::chrono::steady_clock;
+  measurement ret;
+  ret.suite = s.name;
+  size_t iterations = 1;
+  auto begin = clock::now();
+  for(;;)
+  {
+    auto rbegin = clock::now();
+    for(size_t n = 0; n < iterations; n++)
+    {
+      op();
+    }
+    auto rend = clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(rend - rbegin).count();
+    if(std::chrono::duration_cast<std::chrono::milliseconds>(rend - begin).count() >= opts.warmup_ms && elapsed > 0)
+    {
+      iterations = std::max<size_t>(1, (size_t)((double) opts.repetition_ms * 1000000.0 * iterations / elapsed));
+      break;
+    }
+    if(elapsed < (long long) opts.repetition_ms * 1000000)
+    {
+      iterations <<= 1;
+    }
+  }
+  ret.iterations = iterations;
+  for(unsigned r = 0; r < opts.repetitions; r++)
+  {
+    auto rbegin = clock::now();
+    for(size_t n = 0; n < iterations; n++)
+    {
+      op();
+    }
+    auto rend = clock::now();
+    ret.samples.push_back((double) std::chrono::duration_cast<std::chrono::nanoseconds>(rend - rbegin).count() / iterations);
+  }
+  std::vector<double> sorted(ret.samples);
+  std::sort(sorted.begin(), sorted.end());
+  ret.min = sorted.front();
+  ret.max = sorted.back();
+  ret.median = (sorted.size() & 1) ? sorted[sorted.size() / 2] : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) / 2;
+  for(auto i : sorted)
+  {
+    ret.mean += i;
+  }
+  ret.mean /= sorted.size();
+  if(sorted.size() > 1)
+  {
+    double var = 0;
+    for(auto i : sorted)
+    {
+      var += (i - ret.mean) * (i - ret.mean);
+    }
+    ret.stddev = std::sqrt(var / (sorted.size() - 1));
+  }
+  const double halfwidth = student_t95(sorted.size() - 1) * ret.stddev / std::sqrt((double) sorted.size());
+  ret.ci95_low = ret.mean - halfwidth;
+  ret.ci95_high = ret.mean + halfwidth;
+  return ret;
+}
+
+static std::string json_escape(const std::string &v)
+{
+  std::string ret;
+  for(char c : v)
+  {
+    switch(c)
+    {
+    case '"':
+      ret.append("\\\"");
+      break;
+    case '\\':
+      ret.append("\\\\");
+      break;
+    case '\n':
+      ret.append("\\n");
+      break;
+    default:
+      if((unsigned char) c < 0x20)
+      {
+        char buffer[8];
+        snprintf(buffer, sizeof(buffer), "\\u%04x", (unsigned) c);
+        ret.append(buffer);
+      }
+      else
+      {
+        ret.push_back(c);
+      }
+    }
+  }
+  return ret;
+}
+
+static void write_json(std::ostream &out, const options &opts, const std::vector<measurement> &results)
+{
+  std::string timestamp(64, 0);
+  std::time_t t = std::time(nullptr);
+  timestamp.resize(std::strftime(&timestamp[0], timestamp.size(), "%FT%TZ", std::gmtime(&t)));
+  out << "{\n  \"llfio_bench\": 1,\n  \"timestamp\": \"" << timestamp << "\",\n  \"llfio_commit\": \"" << LLFIO_BENCH_STRINGIZE(LLFIO_PREVIOUS_COMMIT_REF)
+      << "\",\n  \"system\": {\n    \"page_size\": " << llfio::utils::page_size() << ",\n    \"hardware_concurrency\": " << std::thread::hardware_concurrency()
+      << "\n  },\n  \"options\": {\n    \"warmup_ms\": " << opts.warmup_ms << ",\n    \"repetitions\": " << opts.repetitions << ",\n    \"repetition_ms\": " << opts.repetition_ms
+      << "\n  },\n  \"results\": [";
+  out.precision(17);
+  for(size_t n = 0; n < results.size(); n++)
+  {
+    auto &r = results[n];
+    out << (n ? "," : "") << "\n    {\n      \"suite\": \"" << json_escape(r.suite) << "\",\n      \"unit\": \"ns/op\",\n      \"iterations\": " << r.iterations
+        << ",\n      \"mean\": " << r.mean << ",\n      \"median\": " << r.median << ",\n      \"stddev\": " << r.stddev << ",\n      \"min\": " << r.min << ",\n      \"max\": " << r.max
+        << ",\n      \"ci95\": [" << r.ci95_low << ", " << r.ci95_high << "],\n      \"samples\": [";
+    for(size_t i = 0; i < r.samples.size(); i++)
+    {
+      out << (i ? ", " : "") << r.samples[i];
+    }
+    out << "]\n    }";
+  }
+  out << "\n  ]\n}" << std::endl;
+}
+
+// A temporary file of TESTFILE_SIZE bytes, shared by the operations of a suite and deleted after it
+static const llfio::path_view testfile_name("llfio_bench_testfile");
+static std::shared_ptr<llfio::file_handle> testfile()
+{
+  static std::weak_ptr<llfio::file_handle> cache;
+  auto ret = cache.lock();
+  if(!ret)
+  {
+    ret = std::make_shared<llfio::file_handle>(llfio::file_handle::temp_file(testfile_name, llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed,
+                                                                             llfio::file_handle::caching::all, llfio::file_handle::flag::unlink_on_first_close)
+                                               .value());
+    std::vector<llfio::byte> buffer(1024 * 1024, (llfio::byte) 'a');
+    for(size_t offset = 0; offset < TESTFILE_SIZE; offset += buffer.size())
+    {
+      ret->write(offset, {{buffer.data(), buffer.size()}}).value();
+    }
+    cache = ret;
+  }
+  return ret;
+}
+
+// Returns an operation doing a random 4Kb aligned read from h
+template <class H> static std::function<void()> random_reads(std::shared_ptr<H> h, std::shared_ptr<llfio::file_handle> keepalive)
+{
+  struct state_t
+  {
+    std::shared_ptr<H> h;
+    std::shared_ptr<llfio::file_handle> keepalive;
+    small_prng rand;
+    alignas(4096) llfio::byte buffer[4096];
+  };
+  auto state = std::make_shared<state_t>();
+  state->h = std::move(h);
+  state->keepalive = std::move(keepalive);
+  return [state] {
+    const auto offset = (state->rand() % (TESTFILE_SIZE / 4096)) * 4096ULL;
+    state->h->read(offset, {{state->buffer, 4096}}).value();
+  };
+}
+
+static std::vector<suite> suites()
+{
+  return {
+  {"file_handle:read:4Kb:random", "A random 4Kb read through the kernel page cache", [] { return random_reads(testfile(), {}); }},
+  {"file_handle:read:4Kb:random:uncached", "A random 4Kb read bypassing the kernel page cache (caching::none)",
+   [] {
+     auto fh = testfile();
+     auto uncached = std::make_shared<llfio::file_handle>(fh->reopen(llfio::file_handle::mode::read, llfio::file_handle::caching::none).value());
+     return random_reads(std::move(uncached), std::move(fh));
+   }},
+  {"file_handle:write:4Kb:random", "A random 4Kb write through the kernel page cache",
+   [] {
+     auto fh = testfile();
+     auto rand = std::make_shared<small_prng>();
+     auto buffer = std::make_shared<std::vector<llfio::byte>>(4096, (llfio::byte) 'b');
+     return std::function<void()>([fh, rand, buffer] {
+       const auto offset = ((*rand)() % (TESTFILE_SIZE / 4096)) * 4096ULL;
+       fh->write(offset, {{buffer->data(), buffer->size()}}).value();
+     });
+   }},
+  {"mapped_file_handle:read:4Kb:random", "A random 4Kb read from a memory mapped file",
+   [] {
+     auto fh = testfile();
+     auto mfh = std::make_shared<llfio::mapped_file_handle>(
+     llfio::mapped_file_handle::mapped_file(llfio::path_discovery::storage_backed_temporary_files_directory(), testfile_name).value());
+     return random_reads(std::move(mfh), std::move(fh));
+   }},
+  {"file_handle:open_close", "Opening and closing an existing file",
+   [] {
+     auto fh = testfile();
+     return std::function<void()>([fh] {
+       llfio::file_handle::file(llfio::path_discovery::storage_backed_temporary_files_directory(), testfile_name).value().close().value();
+     });
+   }},
+  {"map_handle:map_close:64Kb", "Allocating and freeing 64Kb of anonymous memory", [] { return std::function<void()>([] { llfio::map_handle::map(65536).value().close().value(); }); }},
+  {"path_view:c_str:char", "Converting a 70 character char path which is not zero terminated to a native zero terminated path",
+   [] {
+     static const char path[] = "/home/ned/Documents/boostish/llfio/programs/build_posix/testdir/0.txt";
+     return std::function<void()>([] {
+       llfio::path_view::c_str<> z(llfio::path_view(path, sizeof(path) - 5, false));
+       if(z.buffer == nullptr)
+         abort();
+     });
+   }},
+  {"directory_handle:read:1000", "Enumerating a directory of 1000 entries",
+   [] {
+     struct state_t
+     {
+       llfio::directory_handle dh;
+       std::vector<llfio::directory_handle::buffer_type> entries{4096};
+       llfio::directory_handle::buffers_type buffers;
+       ~state_t() { (void) llfio::algorithm::reduce(std::move(dh)); }
+     };
+     auto state = std::make_shared<state_t>();
+     state->dh = llfio::directory_handle::directory(llfio::path_discovery::storage_backed_temporary_files_directory(), "llfio_bench_testdir",
+                                                    llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed)
+                 .value();
+     for(size_t n = 0; n < 1000; n++)
+     {
+       llfio::file_handle::file(state->dh, std::to_string(n), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+     }
+     return std::function<void()>([state] {
+       for(bool done = false; !done;)
+       {
+         state->buffers = state->dh.read({llfio::directory_handle::buffers_type(state->entries, std::move(state->buffers))}).value();
+         done = state->buffers.done();
+       }
+     });
+   }},
+  };
+}
+
+int main(int argc, char *argv[])
+{
+  options opts;
+  const char *output = "llfio_bench.json";
+  bool list = false;
+  for(int n = 1; n < argc; n++)
+  {
+    try
+    {
+      if(0 == strcmp(argv[n], "--list"))
+        list = true;
+      else if(0 == strncmp(argv[n], "--suite=", 8))
+        opts.which.assign(argv[n] + 8);
+      else if(0 == strncmp(argv[n], "--warmup=", 9))
+        opts.warmup_ms = (unsigned) atoi(argv[n] + 9);
+      else if(0 == strncmp(argv[n], "--repetitions=", 14) && atoi(argv[n] + 14) > 0)
+        opts.repetitions = (unsigned) atoi(argv[n] + 14);
+      else if(0 == strncmp(argv[n], "--repetition-ms=", 16) && atoi(argv[n] + 16) > 0)
+        opts.repetition_ms = (unsigned) atoi(argv[n] + 16);
+      else if(0 == strncmp(argv[n], "--output=", 9))
+        output = argv[n] + 9;
+      else
+        throw std::invalid_argument(argv[n]);
+    }
+    catch(...)
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--list] [--suite=<regex>] [--warmup=<ms>] [--repetitions=<n>] [--repetition-ms=<ms>] [--output=<file.json, - for stdout>]" << std::endl;
+      return 1;
+    }
+  }
+  const auto all = suites();
+  if(list)
+  {
+    for(auto &s : all)
+    {
+      std::cout << s.name << "\n   " << s.description << "\n";
+    }
+    return 0;
+  }
+  std::vector<measurement> results;
+  for(auto &s : all)
+  {
+    if(!std::regex_match(s.name, opts.which))
+    {
+      continue;
+    }
+    std::cerr << "Running " << s.name << " ..." << std::endl;
+    try
+    {
+      auto op = s.setup();
+      results.push_back(run_suite(s, opts, op));
+      auto &r = results.back();
+      std::cerr << "   " << r.mean << " ns/op (95% CI " << r.ci95_low << " - " << r.ci95_high << ", median " << r.median << ")" << std::endl;
+    }
+    catch(const std::exception &e)
+    {
+      std::cerr << "   WARNING: Skipped due to " << e.what() << std::endl;
+    }
+    catch(...)
+    {
+      std::cerr << "   WARNING: Skipped due to unknown exception" << std::endl;
+    }
+  }
+  if(0 == strcmp(output, "-"))
+  {
+    write_json(std::cout, opts, results);
+  }
+  else
+  {
+    std::ofstream out(output);
+    write_json(out, opts, results);
+    std::cerr << "Wrote " << results.size() << " results to " << output << std::endl;
+  }
+  return 0;
+}
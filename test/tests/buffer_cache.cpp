@@ -0,0 +1,141 @@
+/* Integration test kernel for buffer_cache
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <vector>
+
+static inline void TestBufferCache()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto test_cache = [](llfio::io_multiplexer *multiplexer) {
+    auto fh = llfio::file_handle::temp_inode({}, llfio::file_handle::mode::write,
+                                             (multiplexer != nullptr) ? llfio::file_handle::flag::multiplexable : llfio::file_handle::flag::none)
+              .value();
+    if(multiplexer != nullptr)
+    {
+      fh.set_multiplexer(multiplexer).value();
+    }
+    const size_t page_size = llfio::utils::page_size();
+    std::vector<llfio::byte> content(16 * page_size + 100);
+    for(size_t n = 0; n < content.size(); n++)
+    {
+      content[n] = (llfio::byte)((n / page_size + n) & 0xff);
+    }
+    fh.write(0, {{content.data(), content.size()}}).value();
+    auto cache = llfio::buffer_cache::create(fh, 1000, 4).value();
+    BOOST_REQUIRE(cache->page_size() == page_size);
+    BOOST_REQUIRE(cache->size() == 4);
+
+    // Misses read the page, hits do not, and the last page is partial
+    {
+      auto page = cache->pin(fh, page_size + 5).value();
+      BOOST_CHECK(page.offset() == page_size);
+      BOOST_CHECK(page.length() == page_size);
+      BOOST_CHECK(0 == memcmp(page.data().data(), content.data() + page_size, page_size));
+      auto again = cache->pin(fh, page_size).value();
+      BOOST_CHECK(again.data().data() == page.data().data());
+      BOOST_CHECK(cache->stats().misses == 1);
+      BOOST_CHECK(cache->stats().hits == 1);
+      auto last = cache->pin(fh, 16 * page_size).value();
+      BOOST_CHECK(last.length() == 100);
+      BOOST_CHECK(last.data()[100] == llfio::byte(0));
+    }
+
+    // Dirty pages are written back by flush()
+    {
+      auto page = cache->pin(fh, page_size).value();
+      page.data()[7] = llfio::byte(0xee);
+      page.mark_dirty();
+      BOOST_CHECK(page.dirty());
+      cache->flush().value();
+      BOOST_CHECK(!page.dirty());
+      BOOST_CHECK(cache->stats().write_backs == 1);
+      llfio::byte b;
+      fh.read(page_size + 7, {{&b, 1}}).value();
+      BOOST_CHECK(b == llfio::byte(0xee));
+      content[page_size + 7] = b;
+    }
+
+    // Pages referenced again survive a scan of pages referenced once
+    cache->pin(fh, 0).value();
+    cache->pin(fh, 0).value();
+    for(size_t n = 2; n < 12; n++)
+    {
+      auto page = cache->pin(fh, n * page_size).value();
+      BOOST_CHECK(0 == memcmp(page.data().data(), content.data() + n * page_size, page_size));
+    }
+    BOOST_CHECK(cache->stats().evictions > 0);
+    const auto misses = cache->stats().misses;
+    cache->pin(fh, 0).value();
+    BOOST_CHECK(cache->stats().misses == misses);
+    // A page recently evicted from the scan is remembered
+    cache->pin(fh, 9 * page_size).value();
+    BOOST_CHECK(cache->stats().ghost_hits == 1);
+
+    // Pinned pages are never evicted
+    {
+      std::vector<llfio::buffer_cache::pinned_page> pinned;
+      for(size_t n = 0; n < 4; n++)
+      {
+        pinned.push_back(cache->pin(fh, n * page_size).value());
+      }
+      BOOST_CHECK(cache->pin(fh, 12 * page_size).error() == llfio::errc::no_buffer_space);
+      BOOST_CHECK(cache->detach(fh).error() == llfio::errc::device_or_resource_busy);
+    }
+
+    // Asynchronous misses complete from poll()
+    bool completed = false;
+    llfio::buffer_cache::pinned_page async_page;
+    auto completion = [&](llfio::result<llfio::buffer_cache::pinned_page> &&r) {
+      completed = true;
+      async_page = std::move(r).value();
+    };
+    cache->pin_async(fh, 13 * page_size, llfio::make_function_ptr<void(llfio::result<llfio::buffer_cache::pinned_page> &&)>(completion)).value();
+    BOOST_CHECK(completed == (multiplexer == nullptr));
+    while(!completed)
+    {
+      cache->poll(std::chrono::seconds(1)).value();
+    }
+    BOOST_CHECK(async_page.offset() == 13 * page_size);
+    BOOST_CHECK(0 == memcmp(async_page.data().data(), content.data() + 13 * page_size, page_size));
+    async_page.unpin();
+    cache->detach(fh).value();
+  };
+  std::cout << "\nWithout a multiplexer:\n";
+  test_cache(nullptr);
+#ifdef __linux__
+  auto r = llfio::multiplexer_linux_io_uring(1);
+  if(!r)
+  {
+    std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+    return;
+  }
+  std::cout << "\nWith io_uring:\n";
+  test_cache(r.value().get());
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, buffer_cache, works, "Tests that llfio::buffer_cache works as expected", TestBufferCache())
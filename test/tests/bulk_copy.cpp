@@ -0,0 +1,138 @@
+/* Integration test kernel for algorithm::bulk_copy()
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <vector>
+
+static inline void TestBulkCopy()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  static constexpr size_t files = 16;
+  auto srcdirh = llfio::directory_handle::temp_directory().value();
+  auto destdirh = llfio::directory_handle::temp_directory().value();
+  // Files of many sizes, including empty ones, ones spanning many chunks, and sparse ones
+  std::vector<std::string> leafs;
+  std::vector<std::vector<llfio::byte>> contents;
+  for(size_t n = 0; n < files; n++)
+  {
+    leafs.push_back("file" + std::to_string(n));
+    auto fh = llfio::file_handle::file(srcdirh, leafs.back(), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+    std::vector<llfio::byte> content((n * n * 65537) % (7 * 1024 * 1024));
+    for(size_t i = 0; i < content.size(); i++)
+    {
+      content[i] = (llfio::byte)((i * (n + 1)) & 0xff);
+    }
+    if(n % 4 == 3 && !content.empty())
+    {
+      // Leave a hole in the middle
+      std::fill(content.begin() + content.size() / 4, content.begin() + content.size() * 3 / 4, (llfio::byte) 0);
+      fh.truncate(content.size()).value();
+      fh.write(0, {{content.data(), content.size() / 4}}).value();
+      fh.write(content.size() * 3 / 4, {{content.data() + content.size() * 3 / 4, content.size() - content.size() * 3 / 4}}).value();
+    }
+    else
+    {
+      fh.write(0, {{content.data(), content.size()}}).value();
+    }
+    contents.push_back(std::move(content));
+  }
+  struct visitor_type : llfio::algorithm::bulk_copy_visitor
+  {
+    size_t progresses{0}, completed{0}, failed{0};
+    virtual llfio::result<void> progress(const llfio::algorithm::bulk_copy_progress &p) noexcept override
+    {
+      ++progresses;
+      BOOST_CHECK(p.items_in_flight <= 2);
+      return llfio::success();
+    }
+    virtual llfio::result<void> item_completed(size_t /*unused*/, const llfio::algorithm::bulk_copy_item & /*unused*/, llfio::file_handle::extent_type /*unused*/) noexcept override
+    {
+      ++completed;
+      return llfio::success();
+    }
+    virtual llfio::result<void> item_failed(size_t /*unused*/, const llfio::algorithm::bulk_copy_item & /*unused*/, llfio::result<void>::error_type && /*unused*/) noexcept override
+    {
+      ++failed;
+      return llfio::success();
+    }
+  };
+  auto test = [&](const char *desc, llfio::io_multiplexer *multiplexer, bool force_copy_now) {
+    std::cout << "\n" << desc << std::endl;
+    std::vector<std::string> destleafs;
+    std::vector<llfio::algorithm::bulk_copy_item> items;
+    for(size_t n = 0; n < files; n++)
+    {
+      destleafs.push_back(leafs[n] + "_" + std::to_string(reinterpret_cast<uintptr_t>(multiplexer)) + (force_copy_now ? "_copied" : "_cloned"));
+    }
+    for(size_t n = 0; n < files; n++)
+    {
+      items.push_back({&srcdirh, leafs[n], &destdirh, destleafs[n]});
+    }
+    // An item which cannot be opened is skipped
+    items.push_back({&srcdirh, "nonexistent", &destdirh, "nonexistent"});
+    visitor_type visitor;
+    auto p = llfio::algorithm::bulk_copy(items, &visitor, multiplexer, 2, true, force_copy_now).value();
+    BOOST_CHECK(p.items_total == files + 1);
+    BOOST_CHECK(p.items_completed == files);
+    BOOST_CHECK(p.items_failed == 1);
+    BOOST_CHECK(p.items_in_flight == 0);
+    BOOST_CHECK(visitor.completed == files);
+    BOOST_CHECK(visitor.failed == 1);
+    BOOST_CHECK(visitor.progresses > 0);
+    if(force_copy_now)
+    {
+      BOOST_CHECK(p.bytes_cloned == 0);
+    }
+    std::cout << "   " << p.bytes_cloned << " bytes cloned and " << p.bytes_copied << " bytes copied of " << p.bytes_total << std::endl;
+    for(size_t n = 0; n < files; n++)
+    {
+      auto fh = llfio::file_handle::file(destdirh, destleafs[n]).value();
+      BOOST_REQUIRE(fh.maximum_extent().value() == contents[n].size());
+      std::vector<llfio::byte> content(contents[n].size());
+      if(!content.empty())
+      {
+        BOOST_CHECK(fh.read(0, {{content.data(), content.size()}}).value() == content.size());
+      }
+      BOOST_CHECK(content == contents[n]);
+    }
+    // Without skipping its failure, the missing item fails the whole copy
+    auto r = llfio::algorithm::bulk_copy({items.data() + files, 1}, nullptr, multiplexer);
+    BOOST_CHECK(!r && r.error() == llfio::errc::no_such_file_or_directory);
+  };
+  test("Cloning where possible without a multiplexer:", nullptr, false);
+  test("Copying through buffers without a multiplexer:", nullptr, true);
+#ifdef __linux__
+  auto r = llfio::multiplexer_linux_io_uring(1);
+  if(!r)
+  {
+    std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+    return;
+  }
+  test("Copying through buffers with io_uring:", r.value().get(), true);
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, bulk_copy, "Tests that llfio::algorithm::bulk_copy() works as expected", TestBulkCopy())
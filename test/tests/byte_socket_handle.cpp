@@ -0,0 +1,205 @@
+/* Integration test kernel for whether byte socket handles work
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <future>
+#include <sstream>
+#include <vector>
+
+static inline void TestSocketAddress()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  {
+    auto a = llfio::ip::make_address("127.0.0.1:5000").value();
+    BOOST_CHECK(a.is_v4());
+    BOOST_CHECK(a.is_loopback());
+    BOOST_CHECK(!a.is_any());
+    BOOST_CHECK(a.port() == 5000);
+    std::stringstream ss;
+    ss << a;
+    BOOST_CHECK(ss.str() == "127.0.0.1:5000");
+    BOOST_CHECK(a == llfio::ip::make_address_loopback(llfio::ip::family::v4, 5000));
+  }
+  {
+    auto a = llfio::ip::make_address("[::1]:80").value();
+    BOOST_CHECK(a.is_v6());
+    BOOST_CHECK(a.is_loopback());
+    BOOST_CHECK(a.port() == 80);
+    a.set_port(81);
+    std::stringstream ss;
+    ss << a;
+    BOOST_CHECK(ss.str() == "[::1]:81");
+  }
+  BOOST_CHECK(llfio::ip::make_address_any(llfio::ip::family::v6).is_any());
+  BOOST_CHECK(!llfio::ip::make_address("not an address"));
+  BOOST_CHECK(!llfio::ip::make_address("127.0.0.1:99999"));
+}
+
+static inline void TestBlockingSocketHandles()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto listener = llfio::listening_byte_socket_handle::listening_byte_socket(llfio::ip::family::v4).value();
+  listener.bind(llfio::ip::make_address_loopback(llfio::ip::family::v4)).value();
+  auto endpoint = listener.local_endpoint().value();
+  BOOST_REQUIRE(endpoint.is_loopback());
+  BOOST_REQUIRE(endpoint.port() != 0);
+  std::cout << "Listening on " << endpoint << std::endl;
+  auto serverthread = std::async([&listener] {
+    auto accepted = listener.accept().value();
+    auto &server = accepted.first;
+    BOOST_CHECK(accepted.second.is_loopback());
+    llfio::byte buffer[64];
+    auto read = server.read(0, {{buffer, 64}}).value();
+    BOOST_REQUIRE(read == 5);
+    BOOST_CHECK(0 == memcmp(buffer, "hello", 5));
+    server.write(0, {{(const llfio::byte *) "world", 5}}).value();
+    // The client shut down its writes, so the next read sees end of stream
+    read = server.read(0, {{buffer, 64}}).value();
+    BOOST_CHECK(read == 0);
+    server.shutdown_and_close().value();
+  });
+  auto client = llfio::byte_socket_handle::connected(endpoint).value();
+  BOOST_CHECK(client.is_socket());
+  BOOST_CHECK(!client.is_seekable());
+  BOOST_CHECK(client.remote_endpoint().value() == endpoint);
+  client.write(0, {{(const llfio::byte *) "hello", 5}}).value();
+  llfio::byte buffer[64];
+  auto read = client.read(0, {{buffer, 64}}).value();
+  BOOST_REQUIRE(read == 5);
+  BOOST_CHECK(0 == memcmp(buffer, "world", 5));
+  client.shutdown().value();
+  read = client.read(0, {{buffer, 64}}).value();
+  BOOST_CHECK(read == 0);
+  client.close().value();
+  serverthread.get();
+  listener.close().value();
+}
+
+static inline void TestSpliceSocketHandle()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  static constexpr size_t BYTES = 16384;
+  auto fh = llfio::file_handle::temp_inode().value();
+  std::vector<llfio::byte> contents(BYTES + 4);
+  for(size_t n = 0; n < contents.size(); n++)
+  {
+    contents[n] = static_cast<llfio::byte>(n * 7);
+  }
+  fh.write(0, {{contents.data(), contents.size()}}).value();
+  auto listener = llfio::listening_byte_socket_handle::listening_byte_socket(llfio::ip::family::v4).value();
+  listener.bind(llfio::ip::make_address_loopback(llfio::ip::family::v4)).value();
+  auto client = llfio::byte_socket_handle::connected(listener.local_endpoint().value()).value();
+  auto server = listener.accept().value().first;
+  // Send everything after the first four bytes, which fits into the socket buffers
+  size_t sent = 0;
+  while(sent < BYTES)
+  {
+    auto thissend = client.splice_from(fh, 4 + sent, BYTES - sent).value();
+    BOOST_REQUIRE(thissend > 0);
+    sent += thissend;
+  }
+  BOOST_CHECK(client.splice_from(fh, contents.size(), 64).value() == 0);
+  client.shutdown().value();
+  std::vector<llfio::byte> received(BYTES);
+  size_t read = 0;
+  for(;;)
+  {
+    auto thisread = server.read(0, {{received.data() + read, received.size() - read}}).value();
+    if(thisread == 0)
+    {
+      break;
+    }
+    read += thisread;
+  }
+  BOOST_REQUIRE(read == BYTES);
+  BOOST_CHECK(0 == memcmp(received.data(), contents.data() + 4, BYTES));
+  server.close().value();
+  client.close().value();
+}
+
+static inline void TestMultiplexedSocketHandles()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto test_multiplexer = [](llfio::io_multiplexer_ptr multiplexer) {
+    auto listener = llfio::listening_byte_socket_handle::listening_byte_socket(llfio::ip::family::v4, llfio::byte_socket_handle::mode::write,
+                                                                              llfio::byte_socket_handle::caching::all, llfio::byte_socket_handle::flag::multiplexable)
+                    .value();
+    listener.bind(llfio::ip::make_address_loopback(llfio::ip::family::v4)).value();
+    auto endpoint = listener.local_endpoint().value();
+    {  // nobody is connecting, so accept should time out
+      auto r = listener.accept(multiplexer.get(), std::chrono::milliseconds(10));
+      BOOST_REQUIRE(r.has_error());
+      BOOST_CHECK(r.error() == llfio::errc::timed_out);
+    }
+    auto client = llfio::byte_socket_handle::byte_socket(llfio::ip::family::v4, llfio::byte_socket_handle::mode::write, llfio::byte_socket_handle::caching::all,
+                                                         llfio::byte_socket_handle::flag::multiplexable)
+                  .value();
+    client.connect(endpoint, std::chrono::seconds(5)).value();
+    client.set_multiplexer(multiplexer.get()).value();
+    auto accepted = listener.accept(multiplexer.get(), std::chrono::seconds(5)).value();
+    auto &server = accepted.first;
+    BOOST_REQUIRE(server.multiplexer() == multiplexer.get());
+    llfio::byte buffer[64];
+    {  // nothing has been written, so the read should time out
+      auto read = server.read(0, {{buffer, 64}}, std::chrono::milliseconds(10));
+      BOOST_REQUIRE(read.has_error());
+      BOOST_CHECK(read.error() == llfio::errc::timed_out);
+    }
+    client.write(0, {{(const llfio::byte *) "hello", 5}}, std::chrono::seconds(5)).value();
+    auto read = server.read(0, {{buffer, 64}}, std::chrono::seconds(5)).value();
+    BOOST_REQUIRE(read == 5);
+    BOOST_CHECK(0 == memcmp(buffer, "hello", 5));
+    client.shutdown_and_close(std::chrono::milliseconds(10)).value();
+    read = server.read(0, {{buffer, 64}}, std::chrono::seconds(5)).value();
+    BOOST_CHECK(read == 0);
+    server.close().value();
+    listener.close().value();
+  };
+#ifdef _WIN32
+  std::cout << "\nSingle threaded IOCP, immediate completions:\n";
+  test_multiplexer(llfio::multiplexer_win_iocp(1, false).value());
+#elif defined(__linux__)
+  std::cout << "\nSingle threaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(1).value());
+  auto r = llfio::multiplexer_linux_io_uring(1);
+  if(r)
+  {
+    std::cout << "\nSingle threaded io_uring:\n";
+    test_multiplexer(std::move(r).value());
+  }
+  else
+  {
+    std::cout << "\nio_uring is not available on this kernel: " << r.error().message() << std::endl;
+  }
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, byte_socket_handle, address, "Tests that llfio::ip::address works as expected", TestSocketAddress())
+KERNELTEST_TEST_KERNEL(integration, llfio, byte_socket_handle, blocking, "Tests that blocking llfio::byte_socket_handle works as expected", TestBlockingSocketHandles())
+KERNELTEST_TEST_KERNEL(integration, llfio, byte_socket_handle, splice, "Tests that llfio::byte_socket_handle splicing from a file works as expected", TestSpliceSocketHandle())
+#if defined(_WIN32) || defined(__linux__)
+KERNELTEST_TEST_KERNEL(integration, llfio, byte_socket_handle, multiplexed, "Tests that multiplexed llfio::byte_socket_handle works as expected", TestMultiplexedSocketHandles())
+#endif
@@ -0,0 +1,66 @@
+/* Integration test kernel for cached_parent_handle_adapter's bounded pool of parent handles
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <string>
+#include <vector>
+
+static inline void TestCachedParentHandleLimit()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using adapted = llfio::algorithm::cached_parent_handle_adapter<llfio::file_handle>;
+  static constexpr size_t count = 64;  // several per shard
+  auto tempdirh = llfio::directory_handle::temp_directory().value();
+  const auto temppath = tempdirh.current_path().value();
+  BOOST_CHECK(llfio::algorithm::set_cached_parent_handle_limit(1) == 0);
+  {
+    std::vector<adapted> files;
+    for(size_t n = 0; n < count; n++)
+    {
+      const auto leaf = std::to_string(n);
+      (void) llfio::directory_handle::directory(tempdirh, leaf, llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed).value();
+      files.push_back(llfio::algorithm::cache_parent<llfio::file_handle>(tempdirh, leaf + "/file", llfio::file_handle::mode::write,
+                                                                          llfio::file_handle::creation::if_needed)
+                      .value());
+    }
+    // Evicted parents are reopened on demand
+    for(size_t n = 0; n < count; n++)
+    {
+      auto parent = files[n].parent_path_handle().value();
+      BOOST_CHECK(parent.current_path().value() == temppath / std::to_string(n));
+      BOOST_CHECK(files[n].current_path().value() == temppath / std::to_string(n) / "file");
+    }
+    for(auto &i : files)
+    {
+      (void) i.unlink();
+    }
+    files.clear();
+  }
+  BOOST_CHECK(llfio::algorithm::set_cached_parent_handle_limit(0) == 1);
+  llfio::algorithm::reduce(std::move(tempdirh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, cached_parent_handle_adapter, limit, "Tests that cached_parent_handle_adapter's limit on open parent handles works as expected",
+                       TestCachedParentHandleLimit())
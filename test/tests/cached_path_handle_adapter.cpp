@@ -0,0 +1,85 @@
+/* Integration test kernel for cached_path_handle_adapter
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestCachedPathHandleAdapter()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using adapted = llfio::algorithm::cached_path_handle_adapter<llfio::file_handle>;
+  auto tempdirh = llfio::directory_handle::temp_directory().value();
+  const auto temppath = tempdirh.current_path().value();
+
+  // Opened by absolute path, so the path is known from the start
+  adapted fh = llfio::algorithm::cache_path<llfio::file_handle>(llfio::path_handle(), temppath / "a", llfio::file_handle::mode::write,
+                                                                 llfio::file_handle::creation::if_needed)
+               .value();
+  BOOST_CHECK(fh.cached_path() == temppath / "a");
+  BOOST_CHECK(fh.current_path().value() == temppath / "a");
+
+  // Renaming through the handle keeps the path known
+  fh.relink(llfio::path_handle(), temppath / "b").value();
+  BOOST_CHECK(fh.cached_path() == temppath / "b");
+  BOOST_CHECK(fh.current_path().value() == temppath / "b");
+
+  // Renaming behind the handle's back is detected on revalidation
+  {
+    auto other = llfio::file_handle::file(tempdirh, "b", llfio::file_handle::mode::write).value();
+    other.relink(tempdirh, "c").value();
+  }
+  BOOST_CHECK(fh.cached_path() == temppath / "b");
+  BOOST_CHECK(fh.current_path().value() == temppath / "c");
+  BOOST_CHECK(fh.cached_path() == temppath / "c");
+
+  // Replacing the file at the cached path with another inode is detected too
+  {
+    auto other = llfio::file_handle::file(tempdirh, "c", llfio::file_handle::mode::write).value();
+    other.relink(tempdirh, "d").value();
+  }
+  (void) llfio::file_handle::file(tempdirh, "c", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+  BOOST_CHECK(fh.current_path().value() == temppath / "d");
+
+  // Renaming relative to a base forgets the path until next use
+  fh.relink(tempdirh, "f").value();
+  BOOST_CHECK(fh.cached_path().empty());
+  BOOST_CHECK(fh.current_path().value() == temppath / "f");
+  BOOST_CHECK(fh.cached_path() == temppath / "f");
+
+  // Opened relative to a base, so learned on first use
+  adapted fh2 =
+  llfio::algorithm::cache_path<llfio::file_handle>(tempdirh, "e", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+  BOOST_CHECK(fh2.cached_path().empty());
+  BOOST_CHECK(fh2.current_path().value() == temppath / "e");
+  BOOST_CHECK(fh2.cached_path() == temppath / "e");
+
+  fh.unlink().value();
+  BOOST_CHECK(fh.cached_path().empty());
+  fh.close().value();
+  fh2.close().value();
+  llfio::algorithm::reduce(std::move(tempdirh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, cached_path_handle_adapter, cached_path, "Tests that cached_path_handle_adapter works as expected",
+                       TestCachedPathHandleAdapter())
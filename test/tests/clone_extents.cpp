@@ -182,7 +182,8 @@ static inline void TestCloneOrCopyFileWhole()
 
     auto randomname = llfio::utils::random_string(32);
     randomname.append(".random");
-    llfio::algorithm::clone_or_copy(srcfh, tempdirh, randomname).value();
+    // Alternate rounds force a copy, which uses more than one kernel thread for large files
+    llfio::algorithm::clone_or_copy(srcfh, tempdirh, randomname, true, (round & 1) != 0, llfio::file_handle::creation::always_new, {}, 4).value();
 
     auto destfh =
     llfio::mapped_file_handle::mapped_file(tempdirh, randomname, llfio::mapped_file_handle::mode::write, llfio::mapped_file_handle::creation::open_existing,
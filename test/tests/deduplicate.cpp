@@ -0,0 +1,118 @@
+/* Integration test kernel for algorithm::dedup_index
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+static inline void TestContentDefinedChunking()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  std::vector<llfio::byte> content(4 * 1024 * 1024);
+  std::mt19937 rand(78);
+  for(auto &i : content)
+  {
+    i = (llfio::byte) rand();
+  }
+  auto fh = llfio::file_handle::temp_inode().value();
+  fh.write(0, {{content.data(), content.size()}}).value();
+  const llfio::algorithm::content_defined_chunking_options opts;
+  auto chunks = llfio::algorithm::content_defined_chunks(fh, opts).value();
+  BOOST_REQUIRE(!chunks.empty());
+  llfio::file_handle::extent_type offset = 0;
+  bool contiguous = true, bounded = true, aligned = true;
+  for(size_t n = 0; n < chunks.size(); n++)
+  {
+    contiguous = contiguous && chunks[n].offset == offset;
+    aligned = aligned && (chunks[n].offset % opts.alignment) == 0;
+    bounded = bounded && chunks[n].length <= opts.max_size && (n + 1 == chunks.size() || chunks[n].length >= opts.min_size);
+    offset += chunks[n].length;
+  }
+  BOOST_CHECK(contiguous);
+  BOOST_CHECK(aligned);
+  BOOST_CHECK(bounded);
+  BOOST_CHECK(offset == content.size());
+  // The mean chunk size ought to be near the average size
+  const auto mean = content.size() / chunks.size();
+  BOOST_CHECK(mean >= opts.min_size && mean <= opts.max_size);
+  std::cout << "Content defined chunking made " << chunks.size() << " chunks of mean size " << mean << std::endl;
+
+  // Inconsistent options are refused
+  llfio::algorithm::content_defined_chunking_options bad;
+  bad.min_size = bad.max_size * 2;
+  BOOST_CHECK(llfio::algorithm::content_defined_chunks(fh, bad).has_error());
+}
+
+static inline void TestDeduplicate()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  std::vector<llfio::byte> original(4 * 1024 * 1024), insertion(12288);
+  std::mt19937 rand(79);
+  for(auto &i : original)
+  {
+    i = (llfio::byte) rand();
+  }
+  for(auto &i : insertion)
+  {
+    i = (llfio::byte) rand();
+  }
+  auto a = llfio::file_handle::temp_inode().value();
+  a.write(0, {{original.data(), original.size()}}).value();
+  // b is a with a block aligned insertion near its start, so most chunks of b ought to be found in a
+  auto b = llfio::file_handle::temp_inode().value();
+  b.write(0, {{original.data(), 65536}}).value();
+  b.write(65536, {{insertion.data(), insertion.size()}}).value();
+  b.write(65536 + insertion.size(), {{original.data() + 65536, original.size() - 65536}}).value();
+
+  llfio::algorithm::dedup_index index;
+  BOOST_CHECK(index.add(a).value() > 0);
+  BOOST_CHECK(index.add(a).value() == 0);
+  auto stats = index.deduplicate(b).value();
+  std::cout << "Deduplication found " << stats.duplicate_chunks << " of " << stats.chunks << " chunks duplicate, " << stats.duplicate_bytes
+            << " bytes, and cloned " << stats.cloned_bytes << " bytes in " << stats.clones << " clones. Cloning supported = " << stats.clone_supported
+            << std::endl;
+  BOOST_CHECK(stats.duplicate_bytes >= original.size() * 3 / 4);
+  if(stats.clone_supported)
+  {
+    BOOST_CHECK(stats.cloned_bytes > 0);
+    BOOST_CHECK(stats.clones < stats.duplicate_chunks);
+  }
+  // Whether or not cloning happened, the content of b is unchanged
+  std::vector<llfio::byte> buffer(original.size() + insertion.size());
+  BOOST_REQUIRE(b.read(0, {{buffer.data(), buffer.size()}}).value() == buffer.size());
+  BOOST_CHECK(0 == memcmp(buffer.data(), original.data(), 65536));
+  BOOST_CHECK(0 == memcmp(buffer.data() + 65536, insertion.data(), insertion.size()));
+  BOOST_CHECK(0 == memcmp(buffer.data() + 65536 + insertion.size(), original.data() + 65536, original.size() - 65536));
+  index.remove(a);
+  index.remove(b);
+  BOOST_CHECK(index.size() == 0);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, content_defined_chunks, "Tests that llfio::algorithm::content_defined_chunks() works as expected",
+                       TestContentDefinedChunking())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, deduplicate, "Tests that llfio::algorithm::dedup_index works as expected", TestDeduplicate())
@@ -0,0 +1,65 @@
+/* Integration test kernel for directory enumeration with metadata
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <string>
+#include <vector>
+
+static inline void TestDirectoryHandleEnumerateMetadata()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using want = llfio::stat_t::want;
+  static constexpr size_t count = 300;  // enough to fill metadata in parallel
+  auto dh = llfio::directory_handle::temp_directory().value();
+  for(size_t n = 0; n < count; n++)
+  {
+    auto fh = llfio::file_handle::file(dh, std::to_string(n), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+    fh.truncate(n).value();
+  }
+  const auto path = dh.current_path().value();
+  for(auto flags : {llfio::directory_handle::flag::none, llfio::directory_handle::flag::disable_parallelism})
+  {
+    auto dh2 = llfio::directory_handle::directory({}, path, llfio::directory_handle::mode::read, llfio::directory_handle::creation::open_existing,
+                                                 llfio::directory_handle::caching::all, flags)
+               .value();
+    std::vector<llfio::directory_entry> entries(count + 10);
+    auto contents = dh2.read({entries, {}, llfio::directory_handle::filter::fastdeleted, {}, want::size | want::mtim}).value();
+    BOOST_REQUIRE(contents.done());
+    BOOST_CHECK(contents.size() == count);
+    BOOST_CHECK(contents.metadata() & want::size);
+    BOOST_CHECK(contents.metadata() & want::mtim);
+    for(auto &i : contents)
+    {
+      BOOST_CHECK(i.stat.st_size == (llfio::file_handle::extent_type) std::stoul(i.leafname.path().native()));
+      BOOST_CHECK(i.stat.st_mtim != std::chrono::system_clock::time_point());
+    }
+    // Reusing the buffers reuses their kernel buffer
+    contents = dh2.read({llfio::directory_handle::buffers_type(entries, std::move(contents)), {}, llfio::directory_handle::filter::fastdeleted, {}, want::size}).value();
+    BOOST_CHECK(contents.size() == count);
+  }
+  llfio::algorithm::reduce(std::move(dh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, directory_handle, enumerate_metadata, "Tests that directory enumeration with metadata works as expected", TestDirectoryHandleEnumerateMetadata())
@@ -0,0 +1,93 @@
+/* Integration test kernel for the directory enumeration cache
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+static inline void TestDirectoryHandleEnumerationCache()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+#ifdef _WIN32
+  BOOST_CHECK(!llfio::directory_handle::set_enumeration_cache_enabled(true));
+#else
+  static constexpr size_t count = 100;
+  auto dh = llfio::directory_handle::temp_directory().value();
+  for(size_t n = 0; n < count; n++)
+  {
+    llfio::file_handle::file(dh, std::to_string(n) + (n & 1 ? ".odd" : ".even"), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed)
+    .value();
+  }
+  // Directories modified within the last second are never retained
+  std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+  BOOST_CHECK(!llfio::directory_handle::set_enumeration_cache_enabled(true));
+  const auto before = llfio::directory_handle::trim_enumeration_cache();
+  std::vector<llfio::directory_entry> entries(count + 10);
+  auto contents = dh.read({entries}).value();
+  BOOST_REQUIRE(contents.done());
+  BOOST_CHECK(contents.size() == count);
+  auto stats = llfio::directory_handle::trim_enumeration_cache();
+  BOOST_CHECK(stats.misses == before.misses + 1);
+  BOOST_CHECK(stats.items_in_cache == before.items_in_cache + 1);
+  {
+    // An unchanged directory is served from the cache, with the same entries
+    std::vector<llfio::directory_entry> entries2(count + 10);
+    auto contents2 = dh.read({entries2}).value();
+    BOOST_CHECK(llfio::directory_handle::trim_enumeration_cache().hits == stats.hits + 1);
+    BOOST_REQUIRE(contents2.size() == contents.size());
+    for(size_t n = 0; n < contents.size(); n++)
+    {
+      BOOST_CHECK(contents2[n].leafname == contents[n].leafname);
+      BOOST_CHECK(contents2[n].stat.st_ino == contents[n].stat.st_ino);
+      BOOST_CHECK(contents2[n].stat.st_type == contents[n].stat.st_type);
+    }
+    // Globs are applied to the cached enumeration
+    contents2 = dh.read({llfio::directory_handle::buffers_type(entries2, std::move(contents2)), "*.odd"}).value();
+    BOOST_CHECK(contents2.size() == count / 2);
+    // Too few buffers returns the first entries, not done
+    contents2 = dh.read({llfio::directory_handle::buffers_type(llfio::span<llfio::directory_entry>(entries2.data(), 10), std::move(contents2))}).value();
+    BOOST_CHECK(contents2.size() == 10);
+    BOOST_CHECK(!contents2.done());
+    BOOST_CHECK(llfio::directory_handle::trim_enumeration_cache().hits == stats.hits + 3);
+  }
+  // A changed directory is enumerated afresh
+  llfio::file_handle::file(dh, "new", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+  stats = llfio::directory_handle::trim_enumeration_cache();
+  contents = dh.read({llfio::directory_handle::buffers_type(entries, std::move(contents))}).value();
+  BOOST_CHECK(contents.size() == count + 1);
+  BOOST_CHECK(llfio::directory_handle::trim_enumeration_cache().misses == stats.misses + 1);
+  // Trimming releases everything last used before the time point
+  stats = llfio::directory_handle::trim_enumeration_cache(std::chrono::steady_clock::now());
+  BOOST_CHECK(stats.items_in_cache == 0);
+  BOOST_CHECK(stats.bytes_in_cache == 0);
+  BOOST_CHECK(llfio::directory_handle::set_enumeration_cache_enabled(false));
+  llfio::algorithm::reduce(std::move(dh)).value();
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, directory_handle, enumeration_cache, "Tests that the directory enumeration cache works as expected",
+                       TestDirectoryHandleEnumerationCache())
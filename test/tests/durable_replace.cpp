@@ -0,0 +1,147 @@
+/* Integration test kernel for algorithm::durable_replace
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <string>
+#include <vector>
+
+static inline void TestDurableReplace()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto tempdirh = llfio::directory_handle::temp_directory().value();
+  llfio::directory_handle dirs[2] = {
+  llfio::directory_handle::directory(tempdirh, "a", llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed).value(),
+  llfio::directory_handle::directory(tempdirh, "b", llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed).value()};
+  auto write_file = [](const llfio::directory_handle &dirh, const char *leaf, const std::string &contents) {
+    auto fh = llfio::file_handle::file(dirh, leaf, llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+    fh.write(0, {{reinterpret_cast<const llfio::byte *>(contents.data()), contents.size()}}).value();
+    fh.truncate(contents.size()).value();
+  };
+  auto read_file = [](const llfio::directory_handle &dirh, const char *leaf) {
+    auto fh = llfio::file_handle::file(dirh, leaf).value();
+    std::string ret((size_t) fh.maximum_extent().value(), 0);
+    fh.read(0, {{reinterpret_cast<llfio::byte *>(&ret[0]), ret.size()}}).value();
+    return ret;
+  };
+  auto entries_in = [](const llfio::directory_handle &dirh) {
+    std::vector<llfio::directory_entry> entries(16);
+    auto contents = dirh.read({entries}).value();
+    return contents.size();
+  };
+  static const char *leafs[] = {"one", "two"};
+  for(auto &dirh : dirs)
+  {
+    for(auto *leaf : leafs)
+    {
+      write_file(dirh, leaf, "old contents of " + std::string(leaf));
+    }
+  }
+
+  // Replace two files in each of two directories
+  llfio::algorithm::durable_replace replacer;
+  for(auto &dirh : dirs)
+  {
+    for(auto *leaf : leafs)
+    {
+      const std::string contents = "new contents of " + std::string(leaf);
+      llfio::file_handle::const_buffer_type buffer{reinterpret_cast<const llfio::byte *>(contents.data()), contents.size()};
+      BOOST_REQUIRE(replacer.stage(dirh, leaf, {&buffer, 1}));
+    }
+  }
+  BOOST_CHECK(replacer.size() == 4);
+  // Nothing is visible until committed
+  for(auto &dirh : dirs)
+  {
+    BOOST_CHECK(read_file(dirh, "one") == "old contents of one");
+  }
+  auto stats = replacer.commit().value();
+  std::cout << stats.files << " files were replaced issuing " << stats.flushes << " flushes." << std::endl;
+  BOOST_CHECK(replacer.size() == 0);
+  BOOST_CHECK(stats.files == 4);
+#ifndef _WIN32
+  // One flush per file, and one per directory
+  BOOST_CHECK(stats.flushes == 6);
+#endif
+  for(auto &dirh : dirs)
+  {
+    for(auto *leaf : leafs)
+    {
+      BOOST_CHECK(read_file(dirh, leaf) == "new contents of " + std::string(leaf));
+    }
+    // No temporary files are left behind
+    BOOST_CHECK(entries_in(dirh) == 2);
+  }
+
+  // Replacements can also be written through the staged handle, and may create new files
+  auto *fh = replacer.stage(dirs[0], "three").value();
+  fh->write(0, {{reinterpret_cast<const llfio::byte *>("three"), 5}}).value();
+  BOOST_CHECK(replacer.commit().value().files == 1);
+  BOOST_CHECK(read_file(dirs[0], "three") == "three");
+  BOOST_CHECK(entries_in(dirs[0]) == 3);
+
+  // Discarded replacements leave nothing behind
+  llfio::file_handle::const_buffer_type discarded{reinterpret_cast<const llfio::byte *>("discarded"), 9};
+  BOOST_REQUIRE(replacer.stage(dirs[1], "one", {&discarded, 1}));
+  replacer.clear();
+  BOOST_CHECK(read_file(dirs[1], "one") == "new contents of one");
+  BOOST_CHECK(entries_in(dirs[1]) == 2);
+  BOOST_CHECK(replacer.commit().value().files == 0);
+
+  // syncfs() replaces the per-file and per-directory flushes for large batches on Linux
+  llfio::algorithm::durable_replace syncfs_replacer(llfio::file_handle::flag::none, 1);
+  llfio::file_handle::const_buffer_type synced{reinterpret_cast<const llfio::byte *>("synced"), 6};
+  for(auto &dirh : dirs)
+  {
+    BOOST_REQUIRE(syncfs_replacer.stage(dirh, "two", {&synced, 1}));
+  }
+  stats = syncfs_replacer.commit().value();
+  BOOST_CHECK(stats.files == 2);
+#ifdef __linux__
+  BOOST_CHECK(stats.flushes == 2);
+#endif
+  for(auto &dirh : dirs)
+  {
+    BOOST_CHECK(read_file(dirh, "two") == "synced");
+    BOOST_CHECK(entries_in(dirh) == ((&dirh == &dirs[0]) ? 3 : 2));
+  }
+
+  // Files left behind by a process which died during a commit are removed on request
+  write_file(dirs[1], (std::string("crashed") + llfio::algorithm::durable_replace::leftover_suffix()).c_str(), "stale");
+  write_file(dirs[1], "unrelated.tmp", "kept");
+  BOOST_CHECK(entries_in(dirs[1]) == 4);
+  BOOST_CHECK(llfio::algorithm::durable_replace::remove_leftovers(dirs[1]).value() == 1);
+  BOOST_CHECK(entries_in(dirs[1]) == 3);
+  BOOST_CHECK(read_file(dirs[1], "unrelated.tmp") == "kept");
+  BOOST_CHECK(llfio::algorithm::durable_replace::remove_leftovers(dirs[1]).value() == 0);
+
+  for(auto &dirh : dirs)
+  {
+    dirh.close().value();
+  }
+  llfio::algorithm::reduce(std::move(tempdirh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, durable_replace, "Tests that algorithm::durable_replace works as expected", TestDurableReplace())
@@ -0,0 +1,106 @@
+/* Integration test kernel for algorithm::external_sort
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+static inline void TestExternalSort()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  // Records of 24 bytes: a big endian key of four bytes at offset 4, then the original position
+  static constexpr size_t record_size = 24, records = 200000;
+  auto src = llfio::file_handle::temp_inode().value();
+  auto dest = llfio::file_handle::temp_inode().value();
+  {
+    std::vector<llfio::byte> buffer(records * record_size);
+    std::mt19937 rand(78);
+    for(uint32_t n = 0; n < records; n++)
+    {
+      auto *r = buffer.data() + n * record_size;
+      // Few distinct keys, so stability is tested
+      const uint32_t key = rand() % 1000;
+      const unsigned char be[4] = {(unsigned char) (key >> 24), (unsigned char) (key >> 16), (unsigned char) (key >> 8), (unsigned char) key};
+      memcpy(r + 4, be, 4);
+      memcpy(r + 8, &n, sizeof(n));
+    }
+    src.write(0, {{buffer.data(), buffer.size()}}).value();
+  }
+  llfio::algorithm::external_sort_options opts;
+  // Small enough for many runs
+  opts.memory = 1024 * 1024;
+  opts.threads = 4;
+  opts.readahead = 65536;
+  opts.output_buffer = 65536;
+  auto stats = llfio::algorithm::external_sort<record_size, llfio::algorithm::fixed_width_key<4, 4>>(dest, src, opts).value();
+  BOOST_CHECK(stats.records == records);
+  BOOST_CHECK(stats.runs > 4);
+  BOOST_REQUIRE(dest.maximum_extent().value() == records * record_size);
+  std::vector<llfio::byte> buffer(records * record_size);
+  BOOST_REQUIRE(dest.read(0, {{buffer.data(), buffer.size()}}).value() == buffer.size());
+  bool sorted = true, stable = true;
+  std::vector<bool> seen(records);
+  for(size_t n = 0; n < records; n++)
+  {
+    uint32_t idx;
+    memcpy(&idx, buffer.data() + n * record_size + 8, sizeof(idx));
+    BOOST_REQUIRE(idx < records);
+    seen[idx] = true;
+    if(n > 0)
+    {
+      const int c = memcmp(buffer.data() + (n - 1) * record_size + 4, buffer.data() + n * record_size + 4, 4);
+      uint32_t previdx;
+      memcpy(&previdx, buffer.data() + (n - 1) * record_size + 8, sizeof(previdx));
+      sorted = sorted && c <= 0;
+      stable = stable && (c != 0 || previdx < idx);
+    }
+  }
+  BOOST_CHECK(sorted);
+  BOOST_CHECK(stable);
+  BOOST_CHECK(std::find(seen.begin(), seen.end(), false) == seen.end());
+
+  // A native integer key, in descending order
+  auto dest2 = llfio::file_handle::temp_inode().value();
+  stats = llfio::algorithm::external_sort<record_size, llfio::algorithm::integer_key<uint32_t, 8>, std::greater<uint32_t>>(dest2, src, opts).value();
+  BOOST_REQUIRE(dest2.read(0, {{buffer.data(), buffer.size()}}).value() == buffer.size());
+  bool descending = true;
+  for(uint32_t n = 0; n < records; n++)
+  {
+    uint32_t idx;
+    memcpy(&idx, buffer.data() + n * record_size + 8, sizeof(idx));
+    descending = descending && idx == records - 1 - n;
+  }
+  BOOST_CHECK(descending);
+
+  // A length which is not a multiple of the record size is refused
+  src.truncate(records * record_size - 1).value();
+  BOOST_CHECK(llfio::algorithm::external_sort<record_size, llfio::algorithm::fixed_width_key<4, 4>>(dest, src, opts).error() == llfio::errc::invalid_argument);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, external_sort, "Tests that llfio::algorithm::external_sort works as expected", TestExternalSort())
@@ -54,6 +54,51 @@ static inline void TestFastRandomFileHandleWorks()
     }
     BOOST_CHECK(!memcmp(buffer, store.data() + offset, bytesread));
   }
+
+  // Reads of whole words generate many at once, whilst reads of single bytes perform a
+  // prng round for each, so they must match, including across a change in the high 32
+  // bits of the counter
+  fast_random_file_handle h2 = fast_random_file_handle::fast_random_file().value();
+  for(extent_type base : {(extent_type) 0, ((extent_type) 1 << 34) - 64})
+  {
+    byte bulk[128], single[128];
+    BOOST_REQUIRE(h2.read(base, {{bulk, sizeof(bulk)}}).value() == sizeof(bulk));
+    for(size_t n = 0; n < sizeof(single); n++)
+    {
+      BOOST_REQUIRE(h2.read(base + n, {{single + n, 1}}).value() == 1);
+    }
+    BOOST_CHECK(!memcmp(bulk, single, sizeof(bulk)));
+  }
+}
+
+static inline void TestFastRandomFileHandleMap()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  static constexpr fast_random_file_handle::extent_type length = static_cast<fast_random_file_handle::extent_type>(1) << 40;
+  static constexpr size_t mapbytes = 256 * 1024 * 1024;
+  fast_random_file_handle h = fast_random_file_handle::fast_random_file(length).value();
+  const size_t pagesize = utils::page_size();
+  // The last 256Mb of a terabyte of content, and some beyond, of which only a few pages may be resident at once
+  const fast_random_file_handle::extent_type offset = length - mapbytes + 100;
+  map_handle mh = h.map(mapbytes, offset, 4 * pagesize).value();
+  BOOST_REQUIRE(mh.length() == mapbytes);
+  const byte *p = mh.address();
+  byte expected[256];
+  for(size_t n = 0; n < mapbytes - 100 - sizeof(expected); n += mapbytes / 64 + 5 * pagesize / 3)
+  {
+    BOOST_REQUIRE(h.read(offset + n, {{expected, sizeof(expected)}}).value() == sizeof(expected));
+    BOOST_CHECK(!memcmp(p + n, expected, sizeof(expected)));
+  }
+  // Pages discarded since are generated again the same
+  BOOST_REQUIRE(h.read(offset, {{expected, sizeof(expected)}}).value() == sizeof(expected));
+  BOOST_CHECK(!memcmp(p, expected, sizeof(expected)));
+  // Content beyond the maximum extent maps as zeros
+  for(size_t n = mapbytes - 100; n < mapbytes; n++)
+  {
+    BOOST_CHECK(p[n] == to_byte(0));
+  }
+  mh.close().value();
 }
 
 static inline void TestFastRandomFileHandlePerformance()
@@ -105,4 +150,5 @@ static inline void TestFastRandomFileHandlePerformance()
 }
 
 KERNELTEST_TEST_KERNEL(integration, llfio, fast_random_file_handle, works, "Tests that fast random file handle works as expected", TestFastRandomFileHandleWorks())
+KERNELTEST_TEST_KERNEL(integration, llfio, fast_random_file_handle, map, "Tests that maps of fast random file handle content work as expected", TestFastRandomFileHandleMap())
 KERNELTEST_TEST_KERNEL(integration, llfio, fast_random_file_handle, performance, "Tests the performance of the fast random file handle", TestFastRandomFileHandlePerformance())
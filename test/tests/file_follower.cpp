@@ -0,0 +1,80 @@
+/* Integration test kernel for following a file being appended to
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <future>
+#include <thread>
+
+static inline void TestFileFollower()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto dh = llfio::directory_handle::temp_directory().value();
+  auto writer = llfio::file_handle::file(dh, "followed", llfio::file_handle::mode::write, llfio::file_handle::creation::truncate_existing).value();
+  auto mfh = llfio::mapped_file_handle::mapped_file(1024 * 1024, dh, "followed").value();
+  auto follower = llfio::file_follower::follow(mfh).value();
+
+  // Nothing has been appended, so this times out
+  auto r = follower.next(0, std::chrono::milliseconds(10));
+  BOOST_REQUIRE(!r);
+  BOOST_CHECK(r.error() == llfio::errc::timed_out);
+
+  // Data appended by another thread wakes the follower
+  auto appended = std::async(std::launch::async, [&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    writer.write(0, {{reinterpret_cast<const llfio::byte *>("hello"), 5}}).value();
+  });
+  auto begin = std::chrono::steady_clock::now();
+  auto data = follower.next(0, std::chrono::seconds(5)).value();
+  auto end = std::chrono::steady_clock::now();
+  appended.get();
+  std::cout << "Follower woke " << std::chrono::duration_cast<std::chrono::milliseconds>(end - begin).count() << "ms after waiting began" << std::endl;
+  BOOST_REQUIRE(data.size() == 5);
+  BOOST_CHECK(0 == memcmp(data.data(), "hello", 5));
+  BOOST_CHECK(follower.offset() == 5);
+
+  // Appends are returned in pieces of at most max_bytes
+  writer.write(5, {{reinterpret_cast<const llfio::byte *>(" world"), 6}}).value();
+  data = follower.next(4, std::chrono::seconds(5)).value();
+  BOOST_REQUIRE(data.size() == 4);
+  BOOST_CHECK(0 == memcmp(data.data(), " wor", 4));
+  data = follower.next(0, std::chrono::seconds(5)).value();
+  BOOST_REQUIRE(data.size() == 2);
+  BOOST_CHECK(0 == memcmp(data.data(), "ld", 2));
+
+  // Truncation restarts following from the beginning
+  writer.truncate(0).value();
+  writer.write(0, {{reinterpret_cast<const llfio::byte *>("again"), 5}}).value();
+  data = follower.next(0, std::chrono::seconds(5)).value();
+  BOOST_REQUIRE(data.size() == 5);
+  BOOST_CHECK(0 == memcmp(data.data(), "again", 5));
+
+  follower.close().value();
+  mfh.close().value();
+  writer.unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_follower, follow, "Tests that llfio::file_follower works as expected", TestFileFollower())
@@ -0,0 +1,77 @@
+/* Integration test kernel for per-range access pattern hints
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandleAdvise()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using access_pattern = llfio::file_handle::access_pattern;
+  auto fh = llfio::file_handle::temp_file().value();
+  std::vector<llfio::byte> buffer(1024 * 1024, llfio::byte(78));
+  fh.write(0, {{buffer.data(), buffer.size()}}).value();
+  for(auto pattern : {access_pattern::sequential, access_pattern::random, access_pattern::will_need, access_pattern::normal})
+  {
+    auto ret = fh.advise({65536, 65536}, pattern).value();
+    BOOST_CHECK(ret.offset == 65536);
+    BOOST_CHECK(ret.length == 65536);
+  }
+  // Evicting consumed regions after writing them back, and a length meaning to the end of the file
+  fh.barrier().value();
+  fh.advise({0, (llfio::file_handle::extent_type) -1}, access_pattern::dont_need).value();
+  // Contents are unaffected
+  std::vector<llfio::byte> check(buffer.size());
+  BOOST_CHECK(fh.read(0, {{check.data(), check.size()}}).value() == buffer.size());
+  BOOST_CHECK(check == buffer);
+
+  // Mapped file handles additionally prefetch the map
+  auto mfh = llfio::mapped_file_handle::mapped_temp_file(0).value();
+  mfh.truncate(buffer.size()).value();
+  mfh.advise({0, (llfio::file_handle::extent_type) -1}, access_pattern::will_need).value();
+  BOOST_CHECK(mfh.address()[0] == llfio::byte(0));
+}
+
+static inline void TestFileHandleEvictCache()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_file().value();
+  std::vector<llfio::byte> buffer(1024 * 1024, llfio::byte(78));
+  fh.write(0, {{buffer.data(), buffer.size()}}).value();
+  // Dirty pages are written back first, so no barrier is needed
+  auto r = fh.evict_cache({65536, 65536});
+  if(!r && r.error() == llfio::errc::operation_not_supported)
+  {
+    std::cout << "Per-file cache eviction is not supported on this platform, skipping." << std::endl;
+    return;
+  }
+  BOOST_CHECK(r.value().length != 0);
+  fh.evict_cache().value();
+  // Contents are unaffected
+  std::vector<llfio::byte> check(buffer.size());
+  BOOST_CHECK(fh.read(0, {{check.data(), check.size()}}).value() == buffer.size());
+  BOOST_CHECK(check == buffer);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, advise, "Tests that per-range access pattern hints work as expected", TestFileHandleAdvise())
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, evict_cache, "Tests that per-file page cache eviction works as expected", TestFileHandleEvictCache())
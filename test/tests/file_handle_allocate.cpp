@@ -0,0 +1,85 @@
+/* Integration test kernel for storage preallocation
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandleAllocate()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_file().value();
+  auto r = fh.allocate({0, 1024 * 1024});
+  if(!r && r.error() == llfio::errc::operation_not_supported)
+  {
+    std::cout << "NOTE: This filing system cannot preallocate storage, skipping test." << std::endl;
+    return;
+  }
+  r.value();
+  BOOST_CHECK(fh.maximum_extent().value() == 1024 * 1024);
+  // Preallocated storage reads as zero
+  llfio::byte buffer[4096];
+  memset(buffer, 78, sizeof(buffer));
+  BOOST_CHECK(fh.read(65536, {{buffer, sizeof(buffer)}}).value() == sizeof(buffer));
+  for(auto &i : buffer)
+  {
+    BOOST_CHECK(i == llfio::byte(0));
+  }
+  // Keeping the size does not extend the file
+  auto kr = fh.allocate({1024 * 1024, 1024 * 1024}, true);
+  if(kr || kr.error() != llfio::errc::operation_not_supported)
+  {
+    kr.value();
+    BOOST_CHECK(fh.maximum_extent().value() == 1024 * 1024);
+  }
+  // Allocating within the file does not shrink it
+  fh.allocate({0, 4096}).value();
+  BOOST_CHECK(fh.maximum_extent().value() == 1024 * 1024);
+
+  // Mapped file handles update their map when extended
+  auto mfh = llfio::mapped_file_handle::mapped_temp_file(2 * 1024 * 1024).value();
+  mfh.allocate({0, 65536}).value();
+  BOOST_CHECK(mfh.maximum_extent().value() == 65536);
+  mfh.address()[65535] = llfio::byte(78);
+
+  // Valid data extension needs a privilege on Windows not usually held
+  auto vfh = llfio::file_handle::temp_file().value();
+  auto vr = vfh.extend_valid_data(1024 * 1024);
+  if(!vr && (vr.error() == llfio::errc::operation_not_permitted || vr.error() == llfio::errc::operation_not_supported))
+  {
+    std::cout << "NOTE: Valid data extension is not available (" << vr.error().message() << "), skipping its test." << std::endl;
+    BOOST_CHECK(vfh.maximum_extent().value() == 0);
+    return;
+  }
+  BOOST_CHECK(vr.value() == 1024 * 1024);
+  BOOST_CHECK(vfh.maximum_extent().value() == 1024 * 1024);
+  memset(buffer, 78, sizeof(buffer));
+  BOOST_CHECK(vfh.write(65536, {{buffer, sizeof(buffer)}}).value() == sizeof(buffer));
+  memset(buffer, 0, sizeof(buffer));
+  BOOST_CHECK(vfh.read(65536, {{buffer, sizeof(buffer)}}).value() == sizeof(buffer));
+  BOOST_CHECK(buffer[4095] == llfio::byte(78));
+  // Not extending is truncation
+  BOOST_CHECK(vfh.extend_valid_data(4096).value() == 4096);
+  BOOST_CHECK(vfh.maximum_extent().value() == 4096);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, allocate, "Tests that storage preallocation works as expected", TestFileHandleAllocate())
@@ -0,0 +1,81 @@
+/* Integration test kernel for bounce buffered unaligned i/o
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <vector>
+
+static inline void TestFileHandleBounceIo()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fhr = llfio::file_handle::temp_inode(llfio::path_discovery::storage_backed_temporary_files_directory(), llfio::file_handle::mode::write,
+                                            llfio::file_handle::flag::bounce_unaligned_io);
+  BOOST_REQUIRE(fhr);
+  // Reopen uncached, which not every filing system supports
+  auto fhr2 = fhr.value().reopen(llfio::file_handle::mode::write, llfio::file_handle::caching::none, llfio::file_handle::flag::bounce_unaligned_io);
+  if(!fhr2)
+  {
+    std::cout << "NOTE: The storage backed temporary files directory does not support uncached i/o, skipping." << std::endl;
+    return;
+  }
+  auto &fh = fhr2.value();
+  BOOST_REQUIRE(fh.requires_aligned_io());
+  std::vector<llfio::byte> shadow(300000), buffer(300000 + 1);
+  for(size_t n = 0; n < shadow.size(); n++)
+  {
+    shadow[n] = llfio::byte(n % 251);
+  }
+  // An unaligned write extending the file must leave it exactly as long as written
+  fh.write(3, {{shadow.data() + 3, 100000}}).value();
+  BOOST_CHECK(fh.maximum_extent().value() == 100003);
+  fh.write(0, {{shadow.data(), 3}}).value();
+  llfio::file_handle::extent_type expected_length = 100003;
+  // Unaligned offsets, lengths and addresses, with and without an aligned core
+  struct test_t
+  {
+    size_t offset, length, misalign;
+  } tests[] = {{0, 5, 1}, {4095, 2, 0}, {4000, 70000, 0}, {4000, 70000, 96}, {8192, 4096, 1}, {12345, 200000, 7}, {100003, 55, 3}};
+  for(auto &test : tests)
+  {
+    fh.write(test.offset, {{shadow.data() + test.offset, test.length}}).value();
+    expected_length = (std::max)(expected_length, (llfio::file_handle::extent_type)(test.offset + test.length));
+    BOOST_CHECK(fh.maximum_extent().value() == expected_length);
+    auto *p = buffer.data() + test.misalign;
+    auto read = fh.read(test.offset, {{p, test.length}}).value();
+    BOOST_CHECK(read == test.length);
+    BOOST_CHECK(0 == memcmp(p, shadow.data() + test.offset, test.length));
+  }
+  // Reads past the end of the file are short
+  const auto length = (size_t) fh.maximum_extent().value();
+  auto read = fh.read(length - 10, {{buffer.data() + 1, 100}}).value();
+  BOOST_CHECK(read == 10);
+  BOOST_CHECK(0 == memcmp(buffer.data() + 1, shadow.data() + length - 10, 10));
+  // Everything agrees with the shadow copy
+  read = fh.read(0, {{buffer.data() + 1, length}}).value();
+  BOOST_CHECK(read == length);
+  BOOST_CHECK(0 == memcmp(buffer.data() + 1, shadow.data(), length));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, bounce_io, "Tests that unaligned i/o is bounced on uncached file handles", TestFileHandleBounceIo())
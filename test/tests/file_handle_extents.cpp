@@ -0,0 +1,90 @@
+/* Integration test kernel for streaming extent enumeration
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandleStreamingExtents()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_file().value();
+  // Write a 4Kb block every 1Mb to make a sparse file
+  llfio::byte buffer[4096];
+  memset(buffer, 78, sizeof(buffer));
+  for(llfio::file_handle::extent_type offset = 0; offset < 16 * 1024 * 1024; offset += 1024 * 1024)
+  {
+    fh.write(offset, {{buffer, sizeof(buffer)}}).value();
+  }
+  auto all = fh.extents().value();
+  std::cout << "extents() reports " << all.size() << " extents" << std::endl;
+
+  // Enumerate in pieces using a tiny buffer, and it should match extents()
+  std::vector<llfio::file_handle::extent_pair> pieces;
+  llfio::file_handle::extent_pair out[2];
+  llfio::file_handle::extent_type cursor = 0;
+  for(;;)
+  {
+    auto filled = fh.extents(out, {cursor, (llfio::file_handle::extent_type) -1}).value();
+    if(filled.empty())
+    {
+      break;
+    }
+    BOOST_REQUIRE(filled.size() <= 2);
+    for(auto &i : filled)
+    {
+      BOOST_CHECK(i.offset >= cursor);
+      // Coalesce extents split at buffer boundaries
+      if(!pieces.empty() && pieces.back().offset + pieces.back().length == i.offset)
+      {
+        pieces.back().length += i.length;
+      }
+      else
+      {
+        pieces.push_back(i);
+      }
+    }
+    cursor = filled.back().offset + filled.back().length;
+  }
+  std::cout << "Streaming enumeration reports " << pieces.size() << " extents" << std::endl;
+  llfio::file_handle::extent_type allbytes = 0, piecesbytes = 0;
+  for(auto &i : all)
+  {
+    allbytes += i.length;
+  }
+  for(auto &i : pieces)
+  {
+    piecesbytes += i.length;
+  }
+  BOOST_CHECK(allbytes == piecesbytes);
+  BOOST_CHECK(pieces.size() <= all.size());
+
+  // A sub-range is clamped to the range
+  auto filled = fh.extents(out, {1024 * 1024 + 1024, 1024}).value();
+  BOOST_REQUIRE(filled.size() == 1);
+  BOOST_CHECK(filled[0].offset == 1024 * 1024 + 1024);
+  BOOST_CHECK(filled[0].length == 1024);
+  // Beyond the end of the file there is nothing
+  BOOST_CHECK(fh.extents(out, {32 * 1024 * 1024, 1024}).value().empty());
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, streaming_extents, "Tests that streaming extent enumeration works as expected", TestFileHandleStreamingExtents())
@@ -57,6 +57,57 @@ static inline void TestFileHandleLockUnlock()
     BOOST_REQUIRE(_2.has_error());
     BOOST_CHECK(_2.error() == llfio::errc::timed_out);
   }
+  // Upgrade and downgrade
+  {
+    auto _1 = h1.lock_file_range(0, 0, llfio::lock_kind::shared, std::chrono::seconds(0));
+    BOOST_REQUIRE(!_1.has_error());
+    BOOST_REQUIRE(!_1.value().relock(llfio::lock_kind::exclusive, std::chrono::seconds(0)).has_error());
+    auto _2 = h2.lock_file_range(0, 0, llfio::lock_kind::shared, std::chrono::seconds(0));
+    BOOST_REQUIRE(_2.has_error());
+    BOOST_CHECK(_2.error() == llfio::errc::timed_out);
+    BOOST_REQUIRE(!_1.value().relock(llfio::lock_kind::shared).has_error());
+    auto _3 = h2.lock_file_range(0, 0, llfio::lock_kind::shared, std::chrono::seconds(0));
+    BOOST_REQUIRE(!_3.has_error());
+    // Cannot upgrade whilst another holds a shared lock, and the shared lock is kept
+    auto _4 = _1.value().relock(llfio::lock_kind::exclusive, std::chrono::seconds(0));
+    BOOST_REQUIRE(_4.has_error());
+    BOOST_CHECK(_4.error() == llfio::errc::timed_out);
+    auto _5 = h2.lock_file_range(0, 0, llfio::lock_kind::exclusive, std::chrono::seconds(0));
+    BOOST_REQUIRE(_5.has_error());
+  }
+  // Batched locking
+  {
+    llfio::file_handle::lock_file_range_request reqs[] = {{20, 10, llfio::lock_kind::exclusive}, {0, 10, llfio::lock_kind::shared}, {10, 10, llfio::lock_kind::exclusive}};
+    llfio::file_handle::extent_guard guards[3];
+    BOOST_REQUIRE(!h1.lock_file_ranges(reqs, guards, std::chrono::seconds(0)).has_error());
+    BOOST_CHECK(reqs[0].offset == 0);
+    BOOST_CHECK(reqs[1].offset == 10);
+    BOOST_CHECK(reqs[2].offset == 20);
+    BOOST_CHECK(std::get<0>(guards[2].extent()) == 20);
+    BOOST_CHECK(!h2.lock_file_range(0, 10, llfio::lock_kind::shared, std::chrono::seconds(0)).has_error());
+    BOOST_CHECK(h2.lock_file_range(10, 10, llfio::lock_kind::shared, std::chrono::seconds(0)).has_error());
+    guards[1].unlock();
+    BOOST_CHECK(!h2.lock_file_range(10, 10, llfio::lock_kind::shared, std::chrono::seconds(0)).has_error());
+    BOOST_CHECK(h2.lock_file_range(20, 10, llfio::lock_kind::shared, std::chrono::seconds(0)).has_error());
+    // Overlapping requests are rejected
+    llfio::file_handle::lock_file_range_request bad[] = {{0, 10, llfio::lock_kind::exclusive}, {5, 10, llfio::lock_kind::exclusive}};
+    BOOST_CHECK(h1.lock_file_ranges(bad, guards).error() == llfio::errc::invalid_argument);
+  }
+  // Awaitable acquisition waits for the range to become free
+  {
+    auto _1 = h1.lock_file_range(0, 0, llfio::lock_kind::exclusive, std::chrono::seconds(0));
+    BOOST_REQUIRE(!_1.has_error());
+    auto _2 = h2.co_lock_file_range(0, 0, llfio::lock_kind::exclusive, std::chrono::milliseconds(50)).get();
+    BOOST_REQUIRE(_2.has_error());
+    BOOST_CHECK(_2.error() == llfio::errc::timed_out);
+    auto a = h2.co_lock_file_range(0, 0, llfio::lock_kind::exclusive);
+    BOOST_CHECK(!a.await_ready());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    _1.value().unlock();
+    auto _3 = a.await_resume();
+    BOOST_REQUIRE(!_3.has_error());
+    BOOST_CHECK(!!_3.value());
+  }
 }
 
 KERNELTEST_TEST_KERNEL(integration, llfio, file_handle_lock_unlock, file_handle, "Tests that llfio::file_handle's lock and unlock work as expected", TestFileHandleLockUnlock())
@@ -0,0 +1,109 @@
+/* Integration test kernel for scatter gather i/o of very many buffers
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <vector>
+
+static inline void TestFileHandleManyBuffers()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_inode().value();
+  // Far more buffers than any OS accepts in a single syscall
+  static constexpr size_t count = 5000, size = 3;
+  std::vector<llfio::byte> source(count * size), dest(count * size);
+  for(size_t n = 0; n < source.size(); n++)
+  {
+    source[n] = llfio::byte(n % 251);
+  }
+  std::vector<llfio::file_handle::const_buffer_type> wbuffers;
+  std::vector<llfio::file_handle::buffer_type> rbuffers;
+  for(size_t n = 0; n < count; n++)
+  {
+    wbuffers.emplace_back(source.data() + n * size, size);
+    rbuffers.emplace_back(dest.data() + n * size, size);
+  }
+  auto written = fh.write({wbuffers, 0}).value();
+  BOOST_CHECK(written.size() == count);
+  BOOST_CHECK(fh.maximum_extent().value() == source.size());
+  auto read = fh.read({rbuffers, 0}).value();
+  BOOST_CHECK(read.size() == count);
+  BOOST_CHECK(0 == memcmp(source.data(), dest.data(), dest.size()));
+  // A short read stops at the end of the file, even partway through a batch
+  fh.truncate(source.size() - 1000).value();
+  for(auto &b : rbuffers)
+  {
+    b = {b.data(), size};
+  }
+  read = fh.read({rbuffers, 0}).value();
+  size_t bytes = 0;
+  for(auto &b : read)
+  {
+    bytes += b.size();
+  }
+  BOOST_CHECK(bytes == source.size() - 1000);
+  BOOST_CHECK(read.size() == (source.size() - 1000 + size - 1) / size);
+}
+
+static inline void TestFileHandleBufferLists()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_inode().value();
+  std::vector<llfio::byte> source(4096), dest(4096);
+  for(size_t n = 0; n < source.size(); n++)
+  {
+    source[n] = llfio::byte(n % 251);
+  }
+  // Within the inline capacity, and then spilling out of it
+  for(size_t count : {size_t(8), size_t(64)})
+  {
+    const size_t size = source.size() / count;
+    llfio::file_handle::const_buffers_list_type wbuffers;
+    llfio::file_handle::buffers_list_type rbuffers;
+    for(size_t n = 0; n < count; n++)
+    {
+      wbuffers.emplace_back(source.data() + n * size, size);
+      rbuffers.emplace_back(dest.data() + n * size, size);
+    }
+    BOOST_CHECK(wbuffers.is_inline() == (count <= 16));
+    memset(dest.data(), 0, dest.size());
+    BOOST_CHECK(fh.write({wbuffers, 0}).value().size() == count);
+    BOOST_CHECK(fh.read({rbuffers, 0}).value().size() == count);
+    BOOST_CHECK(0 == memcmp(source.data(), dest.data(), dest.size()));
+  }
+  // Storage spilled from the inline capacity is reused by the next list on the same thread
+  const void *first;
+  {
+    llfio::file_handle::const_buffers_list_type l;
+    l.reserve(64);
+    first = l.data();
+  }
+  llfio::file_handle::const_buffers_list_type l;
+  l.reserve(64);
+  BOOST_CHECK(l.data() == first);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, many_buffers, "Tests that i/o with more buffers than the OS syscall limit works", TestFileHandleManyBuffers())
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, buffer_lists, "Tests that i/o with buffer_list works", TestFileHandleBufferLists())
@@ -0,0 +1,80 @@
+/* Integration test kernel for the pool of read only file handles
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandlePooled()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto dh = llfio::directory_handle::temp_directory().value();
+  {
+    auto fh = llfio::file_handle::file(dh, "pooled", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+    fh.write(0, {{reinterpret_cast<const llfio::byte *>("hello"), 5}}).value();
+  }
+  const size_t oldlimit = llfio::set_file_handle_pool_idle_limit(64);
+
+  // Opening the same inode twice shares the handle
+  auto a = llfio::file_handle::pooled(dh, "pooled").value();
+  auto b = llfio::file_handle::pooled(dh, "pooled").value();
+  BOOST_CHECK(a.get() == b.get());
+  BOOST_CHECK(a->is_readable());
+  BOOST_CHECK(!a->is_writable());
+  llfio::byte buffer[5];
+  BOOST_REQUIRE(a->read(0, {{buffer, 5}}).value() == 5);
+  BOOST_CHECK(0 == memcmp(buffer, "hello", 5));
+
+  // Reopening an existing handle finds the same pooled handle
+  {
+    auto fh = llfio::file_handle::file(dh, "pooled").value();
+    auto c = fh.reopen_pooled().value();
+    BOOST_CHECK(c.get() == a.get());
+  }
+  // Different caching is a different pooled handle
+  auto d = llfio::file_handle::pooled(dh, "pooled", llfio::file_handle::caching::reads).value();
+  BOOST_CHECK(d.get() != a.get());
+
+  // Once all users are released, the handle stays open idle and is handed out again
+  const auto *original = a.get();
+  const auto native = a->native_handle()._init;
+  a.reset();
+  b.reset();
+  a = llfio::file_handle::pooled(dh, "pooled").value();
+  BOOST_CHECK(a.get() == original);
+  BOOST_CHECK(a->native_handle()._init == native);
+
+  // With no idle limit, the handle is closed as soon as its users are released
+  a.reset();
+  d.reset();
+  BOOST_CHECK(llfio::set_file_handle_pool_idle_limit(0) == 64);
+  a = llfio::file_handle::pooled(dh, "pooled").value();
+  BOOST_CHECK(a->is_valid());
+  a.reset();
+
+  BOOST_CHECK(!llfio::file_handle::pooled(dh, "doesnotexist"));
+  llfio::set_file_handle_pool_idle_limit(oldlimit);
+  llfio::algorithm::reduce(std::move(dh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, pooled, "Tests that file_handle::pooled() and reopen_pooled() work as expected", TestFileHandlePooled())
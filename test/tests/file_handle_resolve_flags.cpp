@@ -0,0 +1,80 @@
+/* Integration test kernel for the resolve_* handle flags
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandleResolveFlags()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using flag = llfio::file_handle::flag;
+  auto dh = llfio::directory_handle::temp_directory().value();
+  auto subdh = llfio::directory_handle::directory(dh, "sub", llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed).value();
+  llfio::file_handle::file(subdh, "file", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+
+  auto r = llfio::file_handle::file(dh, "sub/file", llfio::file_handle::mode::read, llfio::file_handle::creation::open_existing,
+                                    llfio::file_handle::caching::all, flag::resolve_beneath);
+  if(!r && r.error() == llfio::errc::operation_not_supported)
+  {
+    std::cout << "NOTE: This platform does not support the resolve flags, skipping test." << std::endl;
+    subdh.close().value();
+    llfio::algorithm::reduce(std::move(dh)).value();
+    return;
+  }
+  BOOST_CHECK(r);
+
+  // Escaping the base is refused
+  r = llfio::file_handle::file(subdh, "../sub/file", llfio::file_handle::mode::read, llfio::file_handle::creation::open_existing,
+                               llfio::file_handle::caching::all, flag::resolve_beneath);
+  BOOST_REQUIRE(!r);
+  BOOST_CHECK(r.error() == llfio::errc::cross_device_link);
+  auto r2 = llfio::directory_handle::directory(subdh, "..", llfio::directory_handle::mode::read, llfio::directory_handle::creation::open_existing,
+                                               llfio::directory_handle::caching::all, flag::resolve_beneath);
+  BOOST_REQUIRE(!r2);
+  BOOST_CHECK(r2.error() == llfio::errc::cross_device_link);
+
+  // Creating within a subdirectory beneath the base works
+  r2 = llfio::directory_handle::directory(dh, "sub/newdir", llfio::directory_handle::mode::write, llfio::directory_handle::creation::if_needed,
+                                          llfio::directory_handle::caching::all, flag::resolve_beneath | flag::resolve_no_symlinks);
+  BOOST_CHECK(r2);
+  r = llfio::file_handle::file(dh, "sub/newdir/newfile", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed,
+                               llfio::file_handle::caching::all, flag::resolve_beneath | flag::resolve_no_symlinks);
+  BOOST_CHECK(r);
+
+  // A cached only open either succeeds, or asks to be retried without the flag
+  r = llfio::file_handle::file(dh, "sub/file", llfio::file_handle::mode::read, llfio::file_handle::creation::open_existing,
+                               llfio::file_handle::caching::all, flag::resolve_cached_only);
+  BOOST_CHECK(r || r.error() == llfio::errc::resource_unavailable_try_again);
+  // Creating never completes from cache
+  r = llfio::file_handle::file(dh, "sub/another", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed,
+                               llfio::file_handle::caching::all, flag::resolve_cached_only);
+  BOOST_REQUIRE(!r);
+  BOOST_CHECK(r.error() == llfio::errc::resource_unavailable_try_again);
+  r = llfio::file_handle::file(dh, "sub/another", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed);
+  BOOST_CHECK(r);
+  subdh.close().value();
+  llfio::algorithm::reduce(std::move(dh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, resolve_flags, "Tests that the resolve_* flags work as expected", TestFileHandleResolveFlags())
@@ -0,0 +1,109 @@
+/* Integration test kernel for per-request write flags
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestFileHandleWriteFlags()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using write_flag = llfio::file_handle::write_flag;
+  auto fh = llfio::file_handle::temp_inode().value();
+  const char a[] = "0123456789", b[] = "abcdefghij";
+  auto write = [&](const char *data, llfio::file_handle::extent_type offset, write_flag flags) {
+    llfio::file_handle::const_buffer_type buffers[] = {{(const llfio::byte *) data, 10}};
+    return fh.write({buffers, offset, flags});
+  };
+  // Durable writes and uncached writes behave as ordinary writes otherwise
+  BOOST_CHECK(write(a, 0, write_flag::data_sync).value().size() == 1);
+  BOOST_CHECK(write(b, 10, write_flag::sync).value().size() == 1);
+  BOOST_CHECK(write(a, 20, write_flag::uncached).value().size() == 1);
+  BOOST_CHECK(fh.maximum_extent().value() == 30);
+  // Appends ignore the offset
+  auto appended = write(b, 0, write_flag::append | write_flag::data_sync);
+  if(!appended && appended.error() == llfio::errc::not_supported)
+  {
+    std::cout << "NOTE: This platform cannot append per write, skipping." << std::endl;
+  }
+  else
+  {
+    BOOST_CHECK(appended.value().size() == 1);
+    BOOST_CHECK(fh.maximum_extent().value() == 40);
+  }
+  char buffer[41] = {0};
+  const auto length = (size_t) fh.maximum_extent().value();
+  BOOST_CHECK(fh.read(0, {{(llfio::byte *) buffer, length}}).value() == length);
+  BOOST_CHECK(0 == memcmp(buffer, "0123456789abcdefghij0123456789abcdefghij", length));
+}
+
+static inline void TestFileHandleAtomicWrites()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using write_flag = llfio::file_handle::write_flag;
+  auto fh = llfio::file_handle::temp_file({}, llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::none).value();
+  auto limits = fh.atomic_write_limits().value();
+  std::cout << "Atomic write limits are unit_min = " << limits.unit_min << " unit_max = " << limits.unit_max << " segments_max = " << limits.segments_max << std::endl;
+  BOOST_CHECK(limits.unit_min <= limits.unit_max);
+  const size_t length = (limits.unit_max > 0) ? limits.unit_min : 4096;
+  std::vector<llfio::byte, llfio::utils::page_allocator<llfio::byte>> buffer(length, llfio::to_byte(78));
+  llfio::file_handle::const_buffer_type buffers[] = {{buffer.data(), buffer.size()}};
+  auto written = fh.write({buffers, length, write_flag::atomic});
+  if(limits.unit_max == 0)
+  {
+    // Unsupported atomic writes must fail, never silently tear
+    BOOST_CHECK(!written);
+    std::cout << "NOTE: This platform, filing system or device does not support atomic writes, skipping." << std::endl;
+    return;
+  }
+  BOOST_CHECK(written.value().size() == 1);
+  BOOST_CHECK(fh.maximum_extent().value() == 2 * length);
+}
+
+static inline void TestFileHandleZoneAppend()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_inode().value();
+  auto append = [&](const char *data) {
+    llfio::file_handle::const_buffer_type buffers[] = {{(const llfio::byte *) data, strlen(data)}};
+    return fh.zone_append(buffers);
+  };
+  auto first = append("hello");
+  if(!first && first.error() == llfio::errc::operation_not_supported)
+  {
+    std::cout << "NOTE: This platform cannot report where appends are placed, skipping." << std::endl;
+    return;
+  }
+  BOOST_CHECK(first.value() == 0);
+  // Ordinary writes elsewhere do not move where appends are placed
+  BOOST_CHECK(fh.write(5, {{(const llfio::byte *) "12345", 5}}).value() == 5);
+  BOOST_CHECK(append("world").value() == 10);
+  BOOST_CHECK(fh.maximum_extent().value() == 15);
+  char buffer[16] = {0};
+  BOOST_CHECK(fh.read(0, {{(llfio::byte *) buffer, 15}}).value() == 15);
+  BOOST_CHECK(0 == memcmp(buffer, "hello12345world", 15));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, write_flags, "Tests that per-request write flags work as expected", TestFileHandleWriteFlags())
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, atomic_writes, "Tests that write_flag::atomic works as expected", TestFileHandleAtomicWrites())
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, zone_append, "Tests that file_handle::zone_append() reports where appends were placed", TestFileHandleZoneAppend())
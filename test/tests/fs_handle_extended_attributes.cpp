@@ -0,0 +1,115 @@
+/* Integration test kernel for fs_handle extended attributes
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+// Windows forces the names of extended attributes to upper case
+#ifdef _WIN32
+#define LLFIO_XATTR_NAME(x) "USER.LLFIO." x
+#else
+#define LLFIO_XATTR_NAME(x) "user.llfio." x
+#endif
+
+static inline LLFIO_V2_NAMESPACE::span<const LLFIO_V2_NAMESPACE::byte> as_bytes_of(const char *s)
+{
+  return {reinterpret_cast<const LLFIO_V2_NAMESPACE::byte *>(s), strlen(s)};
+}
+
+static inline bool equals(LLFIO_V2_NAMESPACE::span<const LLFIO_V2_NAMESPACE::byte> value, const char *s)
+{
+  return value.size() == strlen(s) && 0 == memcmp(value.data(), s, value.size());
+}
+
+static inline void TestFsHandleExtendedAttributes()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto dh = llfio::directory_handle::temp_directory().value();
+  auto fh = llfio::file_handle::file(dh, "xattrs", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+  auto r = fh.write_extended_attribute(LLFIO_XATTR_NAME("one"), as_bytes_of("hello"));
+  if(!r && r.error() == llfio::errc::operation_not_supported)
+  {
+    std::cout << "NOTE: Extended attributes are not supported here, skipping test." << std::endl;
+    fh.close().value();
+    llfio::algorithm::reduce(std::move(dh)).value();
+    return;
+  }
+  r.value();
+  // Bigger than the initial storage for a value, to exercise growing it
+  std::string big(10000, 'x');
+  fh.write_extended_attribute(LLFIO_XATTR_NAME("two"), as_bytes_of(big.c_str())).value();
+
+  llfio::fs_handle::extended_attributes attrs;
+  fh.read_extended_attributes(attrs).value();
+  auto *one = attrs.find(LLFIO_XATTR_NAME("one"));
+  auto *two = attrs.find(LLFIO_XATTR_NAME("two"));
+  BOOST_REQUIRE(one != nullptr);
+  BOOST_REQUIRE(two != nullptr);
+  BOOST_CHECK(equals(one->value, "hello"));
+  BOOST_CHECK(equals(two->value, big.c_str()));
+
+  // Reading named attributes omits those not present
+  const llfio::string_view names[] = {LLFIO_XATTR_NAME("two"), LLFIO_XATTR_NAME("absent")};
+  fh.read_extended_attributes(attrs, names).value();
+  BOOST_REQUIRE(attrs.size() == 1);
+  BOOST_CHECK(attrs[0].name == LLFIO_XATTR_NAME("two"));
+  BOOST_CHECK(equals(attrs[0].value, big.c_str()));
+
+  // Reading relative to a directory must see the same
+  fh.remove_extended_attribute(LLFIO_XATTR_NAME("two")).value();
+  llfio::fs_handle::read_extended_attributes(dh, "xattrs", attrs).value();
+  BOOST_CHECK(attrs.find(LLFIO_XATTR_NAME("two")) == nullptr);
+  one = attrs.find(LLFIO_XATTR_NAME("one"));
+  BOOST_REQUIRE(one != nullptr);
+  BOOST_CHECK(equals(one->value, "hello"));
+
+  // The traversal must report the attributes of each entry
+  struct visitor_t final : llfio::algorithm::traverse_visitor
+  {
+    std::atomic<size_t> found{0};
+
+    virtual bool want_extended_attributes(void * /*unused*/) noexcept override { return true; }
+    virtual llfio::result<void> extended_attributes_read(void * /*unused*/, const llfio::directory_handle & /*unused*/, const llfio::directory_entry &entry, llfio::result<void> read,
+                                                         const llfio::fs_handle::extended_attributes &attrs, size_t /*unused*/) noexcept override
+    {
+      OUTCOME_TRYV(read);
+      if(entry.leafname.path() == "xattrs" && attrs.find(LLFIO_XATTR_NAME("one")) != nullptr)
+      {
+        ++found;
+      }
+      return llfio::success();
+    }
+  } visitor;
+  llfio::algorithm::traverse(dh, &visitor).value();
+  BOOST_CHECK(visitor.found == 1);
+
+  fh.close().value();
+  llfio::algorithm::reduce(std::move(dh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, fs_handle, extended_attributes, "Tests that fs_handle extended attribute access works as expected", TestFsHandleExtendedAttributes())
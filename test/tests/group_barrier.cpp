@@ -0,0 +1,77 @@
+/* Integration test kernel for group commit barriers
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static inline void TestGroupBarrier()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  static constexpr size_t threads = 8, commits = 16;
+  llfio::algorithm::group_barrier coordinator(std::chrono::milliseconds(2));
+  // Half the threads share a single file
+  auto shared = llfio::file_handle::temp_file().value();
+  std::vector<llfio::file_handle> files;
+  for(size_t n = 0; n < threads / 2; n++)
+  {
+    files.push_back(llfio::file_handle::temp_file().value());
+  }
+  std::atomic<size_t> failures{0};
+  std::vector<std::thread> workers;
+  for(size_t n = 0; n < threads; n++)
+  {
+    workers.emplace_back([&, n] {
+      llfio::file_handle &fh = (n < threads / 2) ? files[n] : shared;
+      llfio::byte buffer[64];
+      memset(buffer, (int) n, sizeof(buffer));
+      for(size_t i = 0; i < commits; i++)
+      {
+        if(!fh.write((n * commits + i) * sizeof(buffer), {{buffer, sizeof(buffer)}}) || !coordinator.barrier(fh))
+        {
+          failures++;
+        }
+      }
+    });
+  }
+  for(auto &i : workers)
+  {
+    i.join();
+  }
+  BOOST_CHECK(failures == 0);
+  auto stats = coordinator.stats();
+  std::cout << stats.barriers << " barriers were coalesced into " << stats.batches << " batches issuing " << stats.flushes << " flushes." << std::endl;
+  BOOST_CHECK(stats.barriers == threads * commits);
+  BOOST_CHECK(stats.batches <= stats.barriers);
+  BOOST_CHECK(stats.flushes < stats.barriers);
+
+  // syncfs() replaces the per-handle flushes for large batches on Linux
+  llfio::algorithm::group_barrier syncfs_coordinator(std::chrono::microseconds(0), 1);
+  BOOST_CHECK(syncfs_coordinator.barrier(shared, llfio::file_handle::barrier_kind::wait_all));
+  BOOST_CHECK(syncfs_coordinator.stats().flushes == 1);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, group_barrier, "Tests that group commit barriers work as expected", TestGroupBarrier())
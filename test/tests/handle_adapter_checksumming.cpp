@@ -0,0 +1,90 @@
+/* Integration test kernel for the checksumming handle adapter
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <vector>
+
+static inline void TestChecksummingHandleAdapter()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::byte;
+  BOOST_CHECK(llfio::algorithm::detail::crc32c(reinterpret_cast<const byte *>("123456789"), 9) == 0xe3069283);
+  auto fh = llfio::file_handle::temp_file().value();
+  auto ch = llfio::file_handle::temp_file().value();
+  llfio::algorithm::checksumming_handle_adapter<llfio::file_handle> h(&fh, nullptr, llfio::file_handle::mode::write, llfio::file_handle::flag::none, nullptr, &ch, 4096);
+  BOOST_CHECK(h.block_size() == 4096);
+  std::vector<byte> data(100000), check(100000);
+  for(size_t n = 0; n < data.size(); n++)
+  {
+    data[n] = (byte)((n * 2654435761u) >> 9);
+  }
+  // Gather writes of odd sizes at odd offsets
+  for(size_t offset = 0; offset < data.size();)
+  {
+    const size_t n = (std::min)(data.size() - offset, (size_t) 3333);
+    const size_t half = n / 2;
+    BOOST_CHECK(h.write(offset, {{data.data() + offset, half}, {data.data() + offset + half, n - half}}).value() == n);
+    offset += n;
+  }
+  BOOST_CHECK(fh.maximum_extent().value() == data.size());
+  BOOST_CHECK(ch.maximum_extent().value() == (data.size() + 4095) / 4096 * 4);
+  // Scatter reads of odd sizes at odd offsets
+  BOOST_CHECK(h.read(0, {{check.data(), 777}, {check.data() + 777, data.size() - 777}}).value() == data.size());
+  BOOST_CHECK(check == data);
+  memset(check.data(), 0, check.size());
+  BOOST_CHECK(h.read(5000, {{check.data(), 10000}}).value() == 10000);
+  BOOST_CHECK(0 == memcmp(check.data(), data.data() + 5000, 10000));
+  // Reads past the end are short
+  BOOST_CHECK(h.read(99000, {{check.data(), 5000}}).value() == 1000);
+  // Writes beyond the end checksum the zeros between
+  h.write(150000, {{data.data(), 100}}).value();
+  BOOST_CHECK(h.read(99000, {{check.data(), 51100}}).value() == 51100);
+  BOOST_CHECK(check[1000] == byte(0));
+  BOOST_CHECK(check[50999] == byte(0));
+  BOOST_CHECK(0 == memcmp(check.data() + 51000, data.data(), 100));
+  // Truncation recomputes the last block
+  h.truncate(50001).value();
+  BOOST_CHECK(h.read(45000, {{check.data(), 10000}}).value() == 5001);
+  BOOST_CHECK(0 == memcmp(check.data(), data.data() + 45000, 5001));
+  h.zero({1000, 2000}).value();
+  BOOST_CHECK(h.read(0, {{check.data(), 4096}}).value() == 4096);
+  BOOST_CHECK(check[999] == data[999]);
+  BOOST_CHECK(check[1000] == byte(0));
+  BOOST_CHECK(check[2999] == byte(0));
+  BOOST_CHECK(check[3000] == data[3000]);
+  // Corruption written behind the adapter's back is detected
+  byte corrupt = byte(~(unsigned) data[20000]);
+  fh.write(20000, {{&corrupt, 1}}).value();
+  BOOST_CHECK(h.read(16384, {{check.data(), 100}}).error() == llfio::errc::illegal_byte_sequence);
+  BOOST_CHECK(h.read(0, {{check.data(), 16384}}).has_value());
+  BOOST_CHECK(h.read(20480, {{check.data(), 100}}).has_value());
+  // Until the checksums are recomputed
+  h.rechecksum().value();
+  BOOST_CHECK(h.read(16384, {{check.data(), 4096}}).value() == 4096);
+  BOOST_CHECK(check[20000 - 16384] == corrupt);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, handle_adapter, checksumming, "Tests that the checksumming handle adapter works as expected", TestChecksummingHandleAdapter())
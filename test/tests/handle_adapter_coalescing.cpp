@@ -0,0 +1,84 @@
+/* Integration test kernel for the write coalescing handle adapter
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestCoalescingHandleAdapter()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::byte;
+  auto fh = llfio::file_handle::temp_file().value();
+  {
+    llfio::algorithm::coalescing_handle_adapter<llfio::file_handle> h(&fh, nullptr, llfio::file_handle::mode::write, llfio::file_handle::flag::none, nullptr, 65536,
+                                                                       std::chrono::hours(1));
+    BOOST_CHECK(h.capacity() == 65536);
+    // Small sequential writes are buffered, not written through
+    byte buffer[100];
+    for(size_t n = 0; n < 100; n++)
+    {
+      memset(buffer, (int) n, sizeof(buffer));
+      BOOST_CHECK(h.write(n * sizeof(buffer), {{buffer, sizeof(buffer)}}).value() == sizeof(buffer));
+    }
+    BOOST_CHECK(h.buffered() == 10000);
+    BOOST_CHECK(fh.maximum_extent().value() == 0);
+    BOOST_CHECK(h.maximum_extent().value() == 10000);
+    // Reads of just written data are served from the buffer
+    BOOST_CHECK(h.read(150, {{buffer, sizeof(buffer)}}).value() == sizeof(buffer));
+    BOOST_CHECK(buffer[0] == byte(1));
+    BOOST_CHECK(buffer[49] == byte(1));
+    BOOST_CHECK(buffer[50] == byte(2));
+    BOOST_CHECK(fh.maximum_extent().value() == 0);
+    // Overwriting within the buffer
+    memset(buffer, 78, sizeof(buffer));
+    h.write(5000, {{buffer, sizeof(buffer)}}).value();
+    BOOST_CHECK(h.buffered() == 10000);
+    // Filling the buffer writes it out up to the last page boundary
+    for(size_t n = 100; n < 700; n++)
+    {
+      memset(buffer, (int) n, sizeof(buffer));
+      h.write(n * sizeof(buffer), {{buffer, sizeof(buffer)}}).value();
+    }
+    BOOST_CHECK(fh.maximum_extent().value() > 0);
+    BOOST_CHECK(fh.maximum_extent().value() % 4096 == 0);
+    BOOST_CHECK(h.maximum_extent().value() == 70000);
+    // Barriers write out everything
+    h.barrier().value();
+    BOOST_CHECK(h.buffered() == 0);
+    BOOST_CHECK(fh.maximum_extent().value() == 70000);
+    // Non-adjacent writes begin a new buffer
+    h.write(100000, {{buffer, sizeof(buffer)}}).value();
+    h.write(200000, {{buffer, sizeof(buffer)}}).value();
+    BOOST_CHECK(fh.maximum_extent().value() == 100100);
+    // Destruction writes out what remains
+  }
+  BOOST_CHECK(fh.maximum_extent().value() == 200100);
+  byte check[100];
+  fh.read(5000, {{check, sizeof(check)}}).value();
+  BOOST_CHECK(check[0] == byte(78));
+  BOOST_CHECK(check[99] == byte(78));
+  fh.read(69900, {{check, sizeof(check)}}).value();
+  BOOST_CHECK(check[0] == byte(699 & 0xff));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, handle_adapter, coalescing, "Tests that the write coalescing handle adapter works as expected", TestCoalescingHandleAdapter())
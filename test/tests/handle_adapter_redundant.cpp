@@ -0,0 +1,136 @@
+/* Integration test kernel for the redundant handle adapter
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <vector>
+
+static inline void TestMirroredHandleAdapter()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::byte;
+  std::vector<llfio::file_handle> fhs;
+  std::vector<llfio::file_handle *> ptrs;
+  for(size_t n = 0; n < 3; n++)
+  {
+    fhs.push_back(llfio::file_handle::temp_file().value());
+  }
+  for(auto &fh : fhs)
+  {
+    ptrs.push_back(&fh);
+  }
+  auto h = llfio::algorithm::redundant_handle_adapter::mirrored(ptrs).value();
+  BOOST_CHECK(h.is_mirrored());
+  std::vector<byte> data(100000), check(100000);
+  for(size_t n = 0; n < data.size(); n++)
+  {
+    data[n] = (byte)(n * 7 + 3);
+  }
+  BOOST_CHECK(h.write(0, {{data.data(), data.size()}}).value() == data.size());
+  for(auto &fh : fhs)
+  {
+    BOOST_CHECK(fh.maximum_extent().value() == data.size());
+  }
+  BOOST_CHECK(h.read(0, {{check.data(), check.size()}}).value() == check.size());
+  BOOST_CHECK(check == data);
+  // Any one surviving mirror suffices
+  h.set_failed(0);
+  h.set_failed(2);
+  memset(check.data(), 0, check.size());
+  BOOST_CHECK(h.read(0, {{check.data(), check.size()}}).value() == check.size());
+  BOOST_CHECK(check == data);
+  // Writes while failed do not reach the failed mirrors, rebuild() brings them up to date
+  memset(data.data() + 5000, 0x78, 1000);
+  h.write(5000, {{data.data() + 5000, 1000}}).value();
+  fhs[0].truncate(10).value();
+  h.rebuild(0).value();
+  h.rebuild(2).value();
+  BOOST_CHECK(!h.is_failed(0));
+  BOOST_CHECK(!h.is_failed(2));
+  for(auto &fh : fhs)
+  {
+    memset(check.data(), 0, check.size());
+    BOOST_CHECK(fh.read(0, {{check.data(), check.size()}}).value() == check.size());
+    BOOST_CHECK(check == data);
+  }
+}
+
+static inline void TestErasureCodedHandleAdapter()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::byte;
+  std::vector<llfio::file_handle> fhs;
+  std::vector<llfio::file_handle *> ptrs;
+  for(size_t n = 0; n < 6; n++)
+  {
+    fhs.push_back(llfio::file_handle::temp_file().value());
+  }
+  for(auto &fh : fhs)
+  {
+    ptrs.push_back(&fh);
+  }
+  BOOST_CHECK(llfio::algorithm::redundant_handle_adapter::erasure_coded(ptrs, 6).has_error());
+  auto h = llfio::algorithm::redundant_handle_adapter::erasure_coded(ptrs, 2, 4096).value();
+  BOOST_CHECK(h.data_shards() == 4);
+  BOOST_CHECK(h.parity_shards() == 2);
+  const size_t bytes = 1000003;
+  std::vector<byte> data(bytes), check(bytes);
+  for(size_t n = 0; n < data.size(); n++)
+  {
+    data[n] = (byte)((n * 2654435761u) >> 13);
+  }
+  // Write in odd sized pieces at odd offsets, the content beyond being zero
+  for(size_t offset = 0; offset < bytes;)
+  {
+    const size_t n = (std::min)(bytes - offset, (size_t) 12345);
+    BOOST_CHECK(h.write(offset, {{data.data() + offset, n}}).value() == n);
+    offset += n;
+  }
+  BOOST_CHECK(h.maximum_extent().value() % (4 * 4096) == 0);
+  BOOST_CHECK(h.maximum_extent().value() >= bytes);
+  auto checkall = [&] {
+    memset(check.data(), 0, check.size());
+    // Scatter across unaligned buffers
+    BOOST_CHECK(h.read(0, {{check.data(), 777}, {check.data() + 777, 300000}, {check.data() + 300777, bytes - 300777}}).value() == bytes);
+    BOOST_CHECK(check == data);
+  };
+  checkall();
+  // Any two shards may be lost
+  h.set_failed(1);
+  h.set_failed(4);
+  checkall();
+  memset(data.data() + 77777, 0x78, 55555);
+  h.write(77777, {{data.data() + 77777, 55555}}).value();
+  checkall();
+  // A replaced shard is regenerated from the others
+  fhs[1].truncate(0).value();
+  h.rebuild(1).value();
+  h.rebuild(4).value();
+  h.set_failed(0);
+  h.set_failed(2);
+  checkall();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, handle_adapter, mirrored, "Tests that the mirrored redundant handle adapter works as expected", TestMirroredHandleAdapter())
+KERNELTEST_TEST_KERNEL(integration, llfio, handle_adapter, erasure_coded, "Tests that the erasure coded redundant handle adapter works as expected", TestErasureCodedHandleAdapter())
@@ -71,11 +71,12 @@ static inline void TestXorHandleAdapterWorks()
       BOOST_CHECK(bytesread == length);
     }
     size_t n = 0;
-    uint8_t *p = (uint8_t *) tempbuffer.data();
-    for(; n < bytesread; n += 8)
+    uint8_t *p = (uint8_t *) buffer;
+    for(; n + 8 <= bytesread; n += 8)
     {
-      uint64_t *_p = (uint64_t *) (&p[n]);
-      BOOST_CHECK(_p[0] == 0);
+      uint64_t _p;
+      memcpy(&_p, &p[n], 8);
+      BOOST_CHECK(_p == 0);
     }
     for(; n < bytesread; n++)
     {
@@ -83,9 +84,89 @@ static inline void TestXorHandleAdapterWorks()
     }
   }
 
-  // TODO Test writing works
+  // Writing XORs the source into the target, so writing zeros makes the target the source again
+  {
+    byte ones[8192], zeros[8192], check[8192];
+    memset(ones, 0xff, sizeof(ones));
+    memset(zeros, 0, sizeof(zeros));
+    BOOST_CHECK(h.write(1000, {{ones, 3000}, {ones + 3000, 5000}}).value() == 8000);
+    BOOST_REQUIRE(h1.read(1000, {{check, 8000}}).value() == 8000);
+    for(size_t n = 0; n < 8000; n++)
+    {
+      BOOST_CHECK(h2.address()[1000 + n] == ~check[n]);
+    }
+    BOOST_CHECK(h.read(1000, {{check, 8000}}).value() == 8000);
+    BOOST_CHECK(!memcmp(check, ones, 8000));
+    BOOST_CHECK(h.write(1000, {{zeros, 8000}}).value() == 8000);
+    BOOST_CHECK(h.read(1000, {{check, 8000}}).value() == 8000);
+    BOOST_CHECK(!memcmp(check, zeros, 8000));
+  }
+}
+
+static inline void TestXorHandleAdapterLarge()
+{
+  static constexpr size_t testbytes = 5 * 1024 * 1024UL + 12345;
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  fast_random_file_handle h1 = fast_random_file_handle::fast_random_file(testbytes).value();
+  mapped_file_handle h2 = mapped_file_handle::mapped_temp_inode().value();
+  h2.truncate(testbytes - 1000).value();
+  algorithm::xor_handle_adapter<mapped_file_handle, fast_random_file_handle> h(&h2, &h1);
+
+  // Requests bigger than the temporary buffer, scattered into misaligned buffers, return the source
+  // XORed with the target, up to the end of the shorter
+  std::vector<byte> buffer(testbytes + 64), expected(testbytes);
+  BOOST_REQUIRE(h1.read(0, {{expected.data(), testbytes}}).value() == testbytes);
+  auto bytesread = h.read(0, {{buffer.data() + 3, 1000001}, {buffer.data() + 1000004 + 5, testbytes - 1000001}}).value();
+  BOOST_CHECK(bytesread == testbytes - 1000);
+  BOOST_CHECK(!memcmp(buffer.data() + 3, expected.data(), 1000001));
+  BOOST_CHECK(!memcmp(buffer.data() + 1000009, expected.data() + 1000001, testbytes - 1000 - 1000001));
+
+  // Likewise for writes
+  std::vector<byte> zeros(testbytes, to_byte(0));
+  h2.truncate(testbytes).value();
+  BOOST_CHECK(h.write(7, {{zeros.data(), 2000000}, {zeros.data() + 2000000, testbytes - 2000007}}).value() == testbytes - 7);
+  BOOST_CHECK(!memcmp(h2.address() + 7, expected.data() + 7, testbytes - 7));
 }
 
+#ifdef __linux__
+static inline void TestXorHandleAdapterMultiplexed()
+{
+  static constexpr size_t testbytes = 65536;
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  auto r = multiplexer_linux_io_uring(1);
+  if(!r)
+  {
+    std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+    return;
+  }
+  io_multiplexer_ptr multiplexer = std::move(r).value();
+  std::vector<byte> a(testbytes), b(testbytes), buffer(testbytes);
+  for(size_t n = 0; n < testbytes; n++)
+  {
+    a[n] = (byte) (n & 0xff);
+    b[n] = (byte) ((n >> 8) & 0xff);
+  }
+  file_handle h1 = file_handle::temp_inode({}, file_handle::mode::write, file_handle::flag::multiplexable).value();
+  file_handle h2 = file_handle::temp_inode({}, file_handle::mode::write, file_handle::flag::multiplexable).value();
+  h1.write(0, {{a.data(), testbytes}}).value();
+  h2.write(0, {{b.data(), testbytes}}).value();
+  h1.set_multiplexer(multiplexer.get()).value();
+  h2.set_multiplexer(multiplexer.get()).value();
+
+  // Both reads are issued through the shared multiplexer together
+  algorithm::xor_handle_adapter<file_handle, file_handle> h(&h1, &h2);
+  BOOST_CHECK(h.read(100, {{buffer.data(), testbytes - 200}}).value() == testbytes - 200);
+  for(size_t n = 0; n < testbytes - 200; n++)
+  {
+    BOOST_CHECK(buffer[n] == (a[100 + n] ^ b[100 + n]));
+  }
+  h1.set_multiplexer(nullptr).value();
+  h2.set_multiplexer(nullptr).value();
+}
+#endif
+
 #if 0
 static inline void TestFastRandomFileHandlePerformance()
 {
@@ -137,4 +218,8 @@ static inline void TestFastRandomFileHandlePerformance()
 #endif
 
 KERNELTEST_TEST_KERNEL(integration, llfio, xor_handle_adapter, works, "Tests that the xor handle adapter works as expected", TestXorHandleAdapterWorks())
+KERNELTEST_TEST_KERNEL(integration, llfio, xor_handle_adapter, large, "Tests that the xor handle adapter works with requests bigger than its temporary buffer", TestXorHandleAdapterLarge())
+#ifdef __linux__
+KERNELTEST_TEST_KERNEL(integration, llfio, xor_handle_adapter, multiplexed, "Tests that the xor handle adapter reads both handles through a shared multiplexer", TestXorHandleAdapterMultiplexed())
+#endif
 // KERNELTEST_TEST_KERNEL(integration, llfio, fast_random_file_handle, performance, "Tests the performance of the fast random file handle", TestFastRandomFileHandlePerformance())
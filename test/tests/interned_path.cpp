@@ -0,0 +1,93 @@
+/* Integration test kernel for interned_path
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <unordered_map>
+
+static inline void TestInternedPath()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  llfio::interned_path_arena arena;
+  BOOST_CHECK(arena.size() == 0);
+  BOOST_CHECK(!arena.find("a/b/c").value());
+
+  // The same path from any source encoding interns to the same instance
+  auto a = arena.intern("a/b/c").value();
+  auto b = arena.intern(L"a/b/c").value();
+  auto c = arena.intern(u"a/b/c").value();
+  BOOST_CHECK(a);
+  BOOST_CHECK(a == b);
+  BOOST_CHECK(a == c);
+  BOOST_CHECK(a.hash() == c.hash());
+  BOOST_CHECK(arena.size() == 1);
+  BOOST_CHECK(a.size() == 5);
+  BOOST_CHECK(0 == a.path().compare<>("a/b/c"));
+  BOOST_CHECK(arena.find(u8"a/b/c").value() == a);
+
+  // The empty path is distinct from no path
+  auto e = arena.intern("").value();
+  BOOST_CHECK(e);
+  BOOST_CHECK(e.empty());
+  BOOST_CHECK(e != llfio::interned_path());
+  BOOST_CHECK(arena.size() == 2);
+
+  // Intern enough paths to grow the table, and check all are still found
+  std::vector<llfio::interned_path> paths;
+  for(int n = 0; n < 10000; n++)
+  {
+    paths.push_back(arena.intern(std::to_string(n) + "/file").value());
+  }
+  BOOST_CHECK(arena.size() == 10002);
+  for(int n = 0; n < 10000; n++)
+  {
+    auto f = arena.find(std::to_string(n) + "/file").value();
+    BOOST_CHECK(f == paths[n]);
+    BOOST_CHECK(0 == f.path().compare<>(llfio::path_view(std::to_string(n) + "/file")));
+  }
+  // A path longer than a chunk
+  std::string longpath(100000, 'x');
+  auto l = arena.intern(longpath).value();
+  BOOST_CHECK(l.size() == longpath.size());
+  BOOST_CHECK(arena.find(longpath).value() == l);
+
+  // Use as a hash map key
+  std::unordered_map<llfio::interned_path, int, llfio::interned_path::hasher> map;
+  map[a] = 1;
+  map[e] = 2;
+  BOOST_CHECK(map[arena.find(L"a/b/c").value()] == 1);
+  BOOST_CHECK(map.size() == 2);
+
+  // Instances from different arenas compare by content
+  llfio::interned_path_arena arena2;
+  BOOST_CHECK(arena2.intern("a/b/c").value() == a);
+  BOOST_CHECK(arena2.intern("a/b/d").value() != a);
+
+  arena.clear();
+  BOOST_CHECK(arena.size() == 0);
+  BOOST_CHECK(!arena.find("a/b/c").value());
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, interned_path, interned_path, "Tests that llfio::interned_path works as expected", TestInternedPath())
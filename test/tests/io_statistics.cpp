@@ -0,0 +1,105 @@
+/* Integration test kernel for per-handle i/o statistics
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <thread>
+
+static inline void TestIoHandleStatistics()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using counters = llfio::io_handle::io_statistics::counters;
+  auto histogram_total = [](const counters &c) {
+    uint64_t ret = 0;
+    for(auto v : c.latency_histogram)
+    {
+      ret += v;
+    }
+    return ret;
+  };
+  auto fh = llfio::file_handle::temp_file().value();
+  llfio::byte buffer[4096];
+  memset(buffer, 'a', sizeof(buffer));
+  fh.write(0, {{buffer, sizeof(buffer)}}).value();
+  fh.write(sizeof(buffer), {{buffer, sizeof(buffer)}}).value();
+  // A complete read, and a read which goes past the end of the file
+  fh.read(0, {{buffer, sizeof(buffer)}}).value();
+  fh.read(sizeof(buffer) + sizeof(buffer) / 2, {{buffer, sizeof(buffer)}}).value();
+  fh.barrier().value();
+  // Another thread's i/o goes into a different shard, but is summed all the same
+  std::thread([&] { fh.read(0, {{buffer, 16}}).value(); }).join();
+  auto stats = fh.statistics();
+#if LLFIO_ENABLE_IO_STATISTICS
+  std::cout << "Reads: " << stats.reads.ops << " bytes: " << stats.reads.bytes << " short: " << stats.reads.short_transfers << std::endl;
+  std::cout << "Writes: " << stats.writes.ops << " bytes: " << stats.writes.bytes << std::endl;
+  std::cout << "Barriers: " << stats.barriers.ops << std::endl;
+  BOOST_CHECK(stats.writes.ops == 2);
+  BOOST_CHECK(stats.writes.failures == 0);
+  BOOST_CHECK(stats.writes.bytes == 2 * sizeof(buffer));
+  BOOST_CHECK(stats.writes.short_transfers == 0);
+  BOOST_CHECK(histogram_total(stats.writes) == 2);
+  BOOST_CHECK(stats.reads.ops == 3);
+  BOOST_CHECK(stats.reads.failures == 0);
+  BOOST_CHECK(stats.reads.bytes == sizeof(buffer) + sizeof(buffer) / 2 + 16);
+  BOOST_CHECK(stats.reads.short_transfers == 1);
+  BOOST_CHECK(histogram_total(stats.reads) == 3);
+  BOOST_CHECK(stats.barriers.ops == 1);
+  BOOST_CHECK(stats.barriers.bytes == 0);
+  BOOST_CHECK(histogram_total(stats.barriers) == 1);
+
+  // Failed i/o is counted, but transfers nothing
+  auto rfh = llfio::file_handle::file({}, fh.current_path().value(), llfio::file_handle::mode::read).value();
+  BOOST_CHECK(!rfh.write(0, {{buffer, sizeof(buffer)}}));
+  stats = rfh.statistics();
+  BOOST_CHECK(stats.writes.ops == 1);
+  BOOST_CHECK(stats.writes.failures == 1);
+  BOOST_CHECK(stats.writes.bytes == 0);
+  BOOST_CHECK(stats.reads.ops == 0);
+  // Statistics are per handle
+  BOOST_CHECK(fh.statistics().writes.failures == 0);
+
+  fh.reset_statistics();
+  stats = fh.statistics();
+  BOOST_CHECK(stats.reads.ops == 0);
+  BOOST_CHECK(stats.writes.ops == 0);
+  BOOST_CHECK(stats.barriers.ops == 0);
+  BOOST_CHECK(histogram_total(stats.reads) == 0);
+  fh.read(0, {{buffer, sizeof(buffer)}}).value();
+  BOOST_CHECK(fh.statistics().reads.ops == 1);
+  // Closing discards statistics
+  rfh.close().value();
+  fh.close().value();
+  BOOST_CHECK(fh.statistics().reads.ops == 0);
+#else
+  std::cout << "LLFIO_ENABLE_IO_STATISTICS is not enabled, so no statistics are recorded." << std::endl;
+  BOOST_CHECK(stats.reads.ops == 0);
+  BOOST_CHECK(stats.writes.ops == 0);
+  BOOST_CHECK(stats.barriers.ops == 0);
+  BOOST_CHECK(histogram_total(stats.reads) == 0);
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, io_handle, statistics, "Tests that per-handle i/o statistics are recorded as expected", TestIoHandleStatistics())
@@ -0,0 +1,101 @@
+/* Integration test kernel for the adaptive i/o tuner
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestIoTuner()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::algorithm::io_tuner;
+  using std::chrono::microseconds;
+  llfio::storage_profile::storage_profile sp;
+  sp.device_min_io_size.value = 4096;
+  sp.atomic_rewrite_quantum.value = 16384;
+  sp.read_async_qd1_iops.value = 10000;
+  sp.read_async_qd4_iops.value = 35000;
+  sp.read_async_qd16_iops.value = 95000;
+  sp.read_async_qd64_iops.value = 100000;
+  sp.read_async_qd256_iops.value = 101000;
+
+  // Initial recommendations come from the profile
+  io_tuner tuner(sp, microseconds(1000));
+  auto rr = tuner.recommend(io_tuner::operation::read), wr = tuner.recommend(io_tuner::operation::write);
+  BOOST_CHECK(rr.queue_depth == 16);  // the shallowest depth achieving 90% of the best
+  BOOST_CHECK(wr.queue_depth == 4);   // nothing measured
+  BOOST_CHECK(rr.chunk_size >= llfio::utils::file_buffer_default_size());
+  BOOST_CHECK(rr.chunk_size % 4096 == 0);
+  BOOST_CHECK(wr.chunk_size % 16384 == 0);
+
+  // Latencies over target halve the queue depth once per window, then the chunk size
+  for(size_t n = 0; n < 16; n++)
+  {
+    tuner.record(io_tuner::operation::read, microseconds(5000));
+  }
+  BOOST_CHECK(tuner.recommend(io_tuner::operation::read).queue_depth == 8);
+  for(size_t n = 0; n < 8 + 4 + 2; n++)
+  {
+    tuner.record(io_tuner::operation::read, microseconds(5000));
+  }
+  BOOST_CHECK(tuner.recommend(io_tuner::operation::read).queue_depth == 1);
+  tuner.record(io_tuner::operation::read, microseconds(5000));
+  BOOST_CHECK(tuner.recommend(io_tuner::operation::read).chunk_size == rr.chunk_size / 2);
+  // Writes are unaffected
+  BOOST_CHECK(tuner.recommend(io_tuner::operation::write).queue_depth == wr.queue_depth);
+
+  // Latencies within target restore the chunk size, then grow the queue depth
+  for(size_t n = 0; n < 1000; n++)
+  {
+    tuner.record(io_tuner::operation::read, microseconds(100));
+  }
+  auto after = tuner.recommend(io_tuner::operation::read);
+  BOOST_CHECK(after.chunk_size == rr.chunk_size);
+  BOOST_CHECK(after.queue_depth == tuner.maximum(io_tuner::operation::read).queue_depth);
+
+  // Without a target, latency is held near the lowest observed
+  io_tuner selftuning(sp);
+  for(size_t n = 0; n < 64; n++)
+  {
+    selftuning.record(io_tuner::operation::read, microseconds(100));
+  }
+  BOOST_CHECK(selftuning.recommend(io_tuner::operation::read).queue_depth == 16);
+  selftuning.record(io_tuner::operation::read, microseconds(300));
+  BOOST_CHECK(selftuning.recommend(io_tuner::operation::read).queue_depth == 8);
+}
+
+static inline void TestIoTunerStripeAlignment()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::algorithm::io_tuner;
+  // A RAID5 of four devices with a 64Kb chunk has a stripe width of 192Kb
+  llfio::storage_profile::storage_profile sp;
+  sp.device_min_io_size.value = 4096;
+  sp.device_minimum_io_size.value = 65536;
+  sp.device_optimal_io_size.value = 3 * 65536;
+  io_tuner tuner(sp);
+  BOOST_CHECK(tuner.recommend(io_tuner::operation::read).chunk_size % 65536 == 0);
+  BOOST_CHECK(tuner.recommend(io_tuner::operation::write).chunk_size % (3 * 65536) == 0);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, io_tuner, "Tests that llfio::algorithm::io_tuner works as expected", TestIoTuner())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, io_tuner_stripe_alignment, "Tests that llfio::algorithm::io_tuner aligns writes to RAID stripes", TestIoTunerStripeAlignment())
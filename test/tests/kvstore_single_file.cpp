@@ -0,0 +1,81 @@
+/* Integration test kernel for the single_file key value store
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include "../../include/kvstore/kvstore.hpp"
+
+static inline void TestKVStoreSingleFile()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  namespace kvstore = KVSTORE_V1_NAMESPACE;
+  using store = kvstore::basic_key_value_store;
+  {
+    kvstore::basic_key_value_store_info infos[4];
+    auto available = kvstore::enumerate_kvstores(infos).value();
+    BOOST_REQUIRE(available.size() == 1);
+    BOOST_CHECK(0 == strcmp(available[0].name, "single_file"));
+  }
+  const llfio::byte key1[8] = {llfio::to_byte(1)}, key2[8] = {llfio::to_byte(2)};
+  const char value1[] = "hello", value2[] = "a much longer value than hello";
+  {
+    auto s = kvstore::create_kvstore("file://kvstore_testfile", 8, store::features::none, store::mode::write, store::creation::always_new).value();
+    BOOST_CHECK(s->key_size() == 8);
+    BOOST_CHECK(s->empty());
+    store::const_buffer_type b1{reinterpret_cast<const llfio::byte *>(value1), 5}, b2{reinterpret_cast<const llfio::byte *>(value2), sizeof(value2) - 1};
+    BOOST_CHECK(s->write(key1, {{&b1, 1}, 0}));
+    BOOST_CHECK(s->write(key2, {{&b1, 1}, 0}));
+    // Grows past its capacity, so is relocated
+    BOOST_CHECK(s->write(key2, {{&b2, 1}, 0}));
+    BOOST_CHECK(s->size().value().as_longlongs[0] == 2);
+    BOOST_CHECK(s->bytes_stored().value().as_longlongs[0] == 5 + sizeof(value2) - 1);
+    BOOST_CHECK(!s->snapshot());
+  }
+  {
+    auto s = kvstore::open_kvstore("file://kvstore_testfile").value();
+    BOOST_CHECK(s->key_size() == 8);
+    llfio::byte buffer[64];
+    store::buffer_type b{buffer, sizeof(buffer)};
+    auto read = s->read({{&b, 1}, 0}, key2).value();
+    BOOST_REQUIRE(read.size() == 1);
+    BOOST_CHECK(read[0].size() == sizeof(value2) - 1);
+    BOOST_CHECK(0 == memcmp(read[0].data(), value2, sizeof(value2) - 1));
+    // Reads are of the mapped file, not into the buffer supplied
+    BOOST_CHECK(read[0].data() != buffer);
+    const llfio::byte key3[8] = {llfio::to_byte(3)};
+    BOOST_CHECK(s->read({{&b, 1}, 0}, key3).error() == llfio::errc::no_such_file_or_directory);
+    // Match all the keys with a low byte of 2
+    const llfio::byte mask[1] = {llfio::to_byte(0xff)}, bits[1] = {llfio::to_byte(2)};
+    store::filter_state_type state{};
+    BOOST_REQUIRE(s->match(state, mask, bits));
+    BOOST_CHECK(0 == memcmp(static_cast<kvstore::single_file_key_value_store *>(s.get())->key(state).data(), key2, 8));
+    BOOST_CHECK(!s->match(state, mask, bits));
+    BOOST_CHECK(s->clear());
+    BOOST_CHECK(s->empty());
+  }
+  llfio::file_handle::file({}, "kvstore_testfile", llfio::file_handle::mode::write).value().unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, kvstore, single_file, single_file, "Tests that the kvstore single_file reference store works as expected", TestKVStoreSingleFile())
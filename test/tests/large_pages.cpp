@@ -79,6 +79,31 @@ static inline void TestLargeKernelMappedPages()
 #endif
 }
 
+static inline void TestLargeAnonymousSectionPages()
+{
+#ifdef _WIN32  // Only Windows backs large page anonymous sections by the paging file
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  auto pagesizes = utils::page_sizes(true);
+  if(pagesizes.size() == 1)
+  {
+    BOOST_TEST_MESSAGE("Large page support not available on this hardware, or to this privilege of user. So skipping this test.");
+    return;
+  }
+  auto _sh(section_handle::section(1024 * 1024, path_discovery::memory_backed_temporary_files_directory(),
+                                   section_handle::flag::readwrite | section_handle::flag::page_sizes_1));
+  section_handle sh(std::move(_sh).value());
+  BOOST_CHECK(sh.length().value() % pagesizes[1] == 0);
+  map_handle mh(map_handle::map(sh, 0, 0, section_handle::flag::readwrite).value());
+  BOOST_CHECK(mh.address() != nullptr);
+  BOOST_CHECK(mh.page_size() == pagesizes[1]);
+  mh.write(0, {{(const byte *) "hello world", 11}}).value();
+  // A second map of the same section sees the same memory
+  map_handle mh2(map_handle::map(sh, 0, 0, section_handle::flag::readwrite).value());
+  BOOST_CHECK(0 == memcmp(mh2.address(), "hello world", 11));
+#endif
+}
+
 static inline void TestLargeFileMappedPages()
 {
 #ifndef __APPLE__  // Mac OS only implements super pages for anonymous memory
@@ -112,6 +137,60 @@ static inline void TestLargeFileMappedPages()
 #endif
 }
 
+static inline void TestPreferLargeFileMappedPages()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  // Large pages are only a hint, so this must always work whether or not the system can provide them
+  static constexpr size_t bytes = 8 * 1024 * 1024;
+  mapped_file_handle mfh = mapped_file_handle::mapped_temp_inode(bytes * 2, path_discovery::storage_backed_temporary_files_directory(),
+                                                                  mapped_file_handle::mode::write, mapped_file_handle::flag::none,
+                                                                  section_handle::flag::prefer_large_pages)
+                           .value();
+  mfh.truncate(bytes).value();
+  BOOST_CHECK(!!(mfh.section().section_flags() & section_handle::flag::prefer_large_pages));
+  for(size_t n = 0; n < bytes; n += 4096)
+  {
+    mfh.address()[n] = (byte)(n >> 12);
+  }
+  // Growing the map must preserve the contents
+  mfh.truncate(bytes * 2).value();
+  for(size_t n = 0; n < bytes; n += 4096)
+  {
+    BOOST_CHECK(mfh.address()[n] == (byte)(n >> 12));
+  }
+}
+
+static inline void TestLargePageAllocationPolicy()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  // A page size the system does not support must be refused
+  BOOST_CHECK(utils::set_large_page_allocation_policy(3 * utils::page_size()).error() == errc::invalid_argument);
+  auto before = utils::large_page_allocation_statistics();
+  // Whatever the largest page size is, permitting fallback must always succeed
+  utils::set_large_page_allocation_policy(utils::page_sizes(false).back(), true).value();
+  utils::trim_page_allocator_cache();
+  {
+    std::vector<int, utils::page_allocator<int>> v(1024 * 1024);
+    v[0] = 78;
+    v.back() = 78;
+  }
+  auto after = utils::large_page_allocation_statistics();
+  BOOST_CHECK(after.failures == before.failures);
+  if(utils::page_sizes(false).size() > 1)
+  {
+    BOOST_CHECK(after.allocations > before.allocations);
+  }
+  std::cout << "Large page allocations " << after.allocations << " of which fell back " << after.fallbacks << " (" << after.fallback_bytes
+            << " bytes), failed " << after.failures << std::endl;
+  utils::set_large_page_allocation_policy(0).value();
+  utils::trim_page_allocator_cache();
+}
+
 KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, large_mem_mapped_pages, "Tests that large page support for allocating memory works as expected", TestLargeMemMappedPages())
 KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, large_kernel_mapped_pages, "Tests that large page support for mapping kernel memory works as expected", TestLargeKernelMappedPages())
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, large_anonymous_section_pages, "Tests that large page support for anonymous sections works as expected",
+                       TestLargeAnonymousSectionPages())
 KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, large_file_mapped_pages, "Tests that large page support for mapping files works as expected", TestLargeFileMappedPages())
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, prefer_large_file_mapped_pages, "Tests that preferring large pages for mapping files works as expected", TestPreferLargeFileMappedPages())
+KERNELTEST_TEST_KERNEL(integration, llfio, utils, large_page_allocation_policy, "Tests that the large page allocation policy and statistics work as expected", TestLargePageAllocationPolicy())
@@ -0,0 +1,72 @@
+/* Integration test kernel for map handle cache
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMapHandleCache()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  BOOST_CHECK(!llfio::map_handle::set_cache_enabled(true));
+  llfio::map_handle::set_cache_limits(16 * 1024 * 1024, std::chrono::minutes(1));
+  const auto before = llfio::map_handle::trim_cache();
+  llfio::byte *addr;
+  {
+    auto mh = llfio::map_handle::map(65536).value();
+    addr = mh.address();
+    mh.address()[0] = llfio::byte(78);
+  }
+  auto stats = llfio::map_handle::trim_cache();
+  BOOST_CHECK(stats.items_in_cache == before.items_in_cache + 1);
+  BOOST_CHECK(stats.bytes_in_cache == before.bytes_in_cache + 65536);
+  {
+    // Same size and flags reuses the retained map, contents intact
+    auto mh = llfio::map_handle::map(65536).value();
+    BOOST_CHECK(mh.address() == addr);
+    BOOST_CHECK(mh.address()[0] == llfio::byte(78));
+    BOOST_CHECK(llfio::map_handle::trim_cache().hits == stats.hits + 1);
+    // Zeroed memory is never recycled
+    auto zeroed = llfio::map_handle::map(65536, true).value();
+    BOOST_CHECK(zeroed.address() != addr);
+    BOOST_CHECK(zeroed.address()[0] == llfio::byte(0));
+    // Maps with changed page protections are never retained
+    auto decommitted = llfio::map_handle::map(65536).value();
+    decommitted.decommit({decommitted.address(), 4096}).value();
+    stats = llfio::map_handle::trim_cache();
+    decommitted.close().value();
+    BOOST_CHECK(llfio::map_handle::trim_cache().items_in_cache == stats.items_in_cache);
+  }
+  // Trimming releases everything retained before the time point
+  stats = llfio::map_handle::trim_cache(std::chrono::steady_clock::now());
+  BOOST_CHECK(stats.items_in_cache == 0);
+  BOOST_CHECK(stats.bytes_in_cache == 0);
+  BOOST_CHECK(stats.items_just_trimmed >= 2);
+  // Maps exceeding the byte limit are not retained
+  llfio::map_handle::set_cache_limits(65536, std::chrono::minutes(1));
+  llfio::map_handle::map(131072).value().close().value();
+  BOOST_CHECK(llfio::map_handle::trim_cache().items_in_cache == 0);
+  BOOST_CHECK(llfio::map_handle::set_cache_enabled(false));
+  llfio::map_handle::set_cache_limits(64 * 1024 * 1024, std::chrono::seconds(1));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, cache, "Tests that the map handle cache works as expected", TestMapHandleCache())
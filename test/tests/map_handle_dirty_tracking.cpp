@@ -0,0 +1,59 @@
+/* Integration test kernel for map handle dirty range tracking
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMapHandleDirtyTracking()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_inode().value();
+  fh.truncate(1024 * 1024).value();
+  auto sh = llfio::section_handle::section(fh, 0, llfio::section_handle::flag::readwrite | llfio::section_handle::flag::track_dirty).value();
+  auto mh = llfio::map_handle::map(sh).value();
+  // Modify a few sparse pages, some by write() and some by direct stores
+  const char hello[] = "hello", world[] = "world";
+  llfio::map_handle::const_buffer_type b[] = {{reinterpret_cast<const llfio::byte *>(hello), 5}};
+  BOOST_CHECK(mh.write({b, 65536}).value().size() == 1);
+  memcpy(mh.address() + 512 * 1024 + 100, world, 5);
+  mh.mark_dirty({mh.address() + 512 * 1024 + 100, 5});
+  memcpy(mh.address() + 1024 * 1024 - 5, world, 5);
+  mh.mark_dirty({mh.address() + 1024 * 1024 - 5, 5});
+  mh.barrier().value();
+  // Nothing further to flush, which must also succeed
+  mh.barrier().value();
+  mh.close().value();
+  sh.close().value();
+  char buffer[5];
+  auto read_at = [&](llfio::file_handle::extent_type offset) {
+    llfio::file_handle::buffer_type rb[] = {{reinterpret_cast<llfio::byte *>(buffer), 5}};
+    BOOST_REQUIRE(fh.read({rb, offset}).value()[0].size() == 5);
+    return std::string(buffer, 5);
+  };
+  BOOST_CHECK(read_at(65536) == "hello");
+  BOOST_CHECK(read_at(512 * 1024 + 100) == "world");
+  BOOST_CHECK(read_at(1024 * 1024 - 5) == "world");
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, dirty_tracking, "Tests that map handle dirty range tracking flushes modified pages", TestMapHandleDirtyTracking())
@@ -0,0 +1,142 @@
+/* Integration test kernel for batched map handle prefetch
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMapHandlePrefetchAsync()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  const size_t pagesize = llfio::utils::page_size();
+  auto fh = llfio::file_handle::temp_inode().value();
+  fh.truncate(256 * pagesize).value();
+  {
+    std::vector<llfio::byte> buffer(256 * pagesize, llfio::byte(78));
+    fh.write(0, {{buffer.data(), buffer.size()}}).value();
+  }
+  auto sh = llfio::section_handle::section(fh).value();
+  auto mh = llfio::map_handle::map(sh, 0, 0, llfio::section_handle::flag::read).value();
+  llfio::byte *addr = mh.address();
+  // Out of order, overlapping, adjacent and unaligned regions
+  llfio::map_handle::buffer_type regions[] = {{addr + 100 * pagesize, pagesize},      {addr + 10, 20},
+                                              {addr + 101 * pagesize, 2 * pagesize},  {addr + pagesize / 2, pagesize},
+                                              {addr + 200 * pagesize, 10 * pagesize}, {addr + 205 * pagesize, pagesize + 1},
+                                              {nullptr, 0}};
+  auto state = llfio::map_handle::prefetch_async(regions).value();
+  BOOST_REQUIRE(state.regions().size() == 3);
+  BOOST_CHECK(state.regions()[0].data() == addr);
+  BOOST_CHECK(state.regions()[0].size() == 2 * pagesize);
+  BOOST_CHECK(state.regions()[1].data() == addr + 100 * pagesize);
+  BOOST_CHECK(state.regions()[1].size() == 3 * pagesize);
+  BOOST_CHECK(state.regions()[2].data() == addr + 200 * pagesize);
+  BOOST_CHECK(state.regions()[2].size() == 10 * pagesize);
+  BOOST_CHECK(state.bytes() == 15 * pagesize);
+  auto resident = state.bytes_resident();
+  if(!resident && resident.error() == llfio::errc::operation_not_supported)
+  {
+    std::cout << "NOTE: Querying memory residency is not supported on this platform." << std::endl;
+    return;
+  }
+  BOOST_CHECK(resident.value() <= state.bytes());
+  // Touching the pages makes them resident, whether or not the prefetch has finished
+  for(auto &region : state.regions())
+  {
+    for(size_t n = 0; n < region.size(); n += pagesize)
+    {
+      BOOST_CHECK(region.data()[n] == llfio::byte(78));
+    }
+  }
+  BOOST_CHECK(state.completed().value());
+}
+
+static inline void TestMapHandlePopulate()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  static constexpr size_t bytes = 64 * 1024 * 1024;
+  auto fh = llfio::file_handle::temp_inode().value();
+  fh.truncate(bytes).value();
+  auto sh = llfio::section_handle::section(fh).value();
+  // Views four threads' worth, but only the valid extent may be touched
+  auto mh = llfio::map_handle::map(sh, bytes * 2, 0, llfio::section_handle::flag::readwrite | llfio::section_handle::flag::nocommit).value();
+  mh.populate({}, 4).value();
+  llfio::map_handle::buffer_type region{mh.address(), bytes};
+  auto state = llfio::map_handle::prefetch_async({&region, 1}).value();
+  auto resident = state.bytes_resident();
+  if(resident)
+  {
+    // The system may have already evicted some of it again
+    std::cout << "After populate(), " << (100 * resident.value() / bytes) << "% of the map is resident." << std::endl;
+  }
+  // Anonymous memory, with the default number of threads
+  auto mh2 = llfio::map_handle::map(bytes).value();
+  mh2.populate().value();
+  BOOST_CHECK(mh2.address()[bytes - 1] == llfio::byte(0));
+  llfio::mapped<int> m(sh);
+  m.populate(2).value();
+  BOOST_CHECK(m[m.size() - 1] == 0);
+}
+
+static inline void TestMapHandlePageInAhead()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  const size_t pagesize = llfio::utils::page_size();
+  auto fh = llfio::mapped_file_handle::mapped_temp_inode().value();
+  fh.truncate(64 * pagesize).value();
+  {
+    std::vector<llfio::byte> buffer(64 * pagesize, llfio::byte(78));
+    fh.write(0, {{buffer.data(), buffer.size()}}).value();
+  }
+  llfio::byte *addr = fh.address();
+  // Eight regions of eight pages, read last region first
+  std::vector<llfio::map_handle::buffer_type> plan;
+  for(size_t n = 8; n > 0; n--)
+  {
+    plan.push_back({addr + (n - 1) * 8 * pagesize, 8 * pagesize});
+  }
+  llfio::algorithm::page_in_ahead pia;
+  pia.start(fh, plan, 16 * pagesize).value();
+  BOOST_CHECK(pia.bytes() == 64 * pagesize);
+  BOOST_CHECK(!pia.start(fh, plan));
+  size_t accesses = 0;
+  for(auto &region : plan)
+  {
+    for(size_t n = 0; n < region.size(); n += pagesize, accesses++)
+    {
+      (void) pia.access(region.data() + n);
+      BOOST_CHECK(region.data()[n] == llfio::byte(78));
+    }
+  }
+  BOOST_CHECK(!pia.access(addr + 64 * pagesize));
+  pia.stop().value();
+  BOOST_CHECK(pia.misses() <= accesses);
+  BOOST_CHECK(pia.bytes_populated() <= pia.bytes());
+  std::cout << "page_in_ahead populated " << (100 * pia.bytes_populated() / pia.bytes()) << "% of the plan, with " << pia.misses() << " of " << accesses
+            << " accesses missing." << std::endl;
+  // A plan may be restarted once stopped
+  pia.start(fh, {plan.data(), 1}).value();
+  pia.stop().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, prefetch_async, "Tests that batched map handle prefetch works as expected", TestMapHandlePrefetchAsync())
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, populate, "Tests that multithreaded map handle populate works as expected", TestMapHandlePopulate())
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, page_in_ahead, "Tests that populating a prefetch plan ahead of use works as expected", TestMapHandlePageInAhead())
@@ -0,0 +1,94 @@
+/* Integration test kernel for mapped_file_handle record i/o
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestMappedFileHandleRecords()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  struct record32
+  {
+    uint64_t a, b, c, d;
+  };
+  mapped_file_handle mfh = mapped_file_handle::mapped_temp_inode().value();
+  mfh.truncate(65536).value();
+  BOOST_CHECK(mfh.write_record<uint64_t>(8, 0xdeadbeefcafebabeULL));
+  BOOST_CHECK(mfh.write_record(64, record32{1, 2, 3, 4}));
+  BOOST_CHECK(mfh.read_record<uint64_t>(8).value() == 0xdeadbeefcafebabeULL);
+  auto r = mfh.read_record<record32>(64).value();
+  BOOST_CHECK(r.a == 1 && r.b == 2 && r.c == 3 && r.d == 4);
+  // Records straddling the end of the map must fail
+  BOOST_CHECK(mfh.read_record<uint64_t>(65532).error() == errc::argument_out_of_domain);
+  BOOST_CHECK(mfh.write_record<uint64_t>(65536, 1).error() == errc::argument_out_of_domain);
+  BOOST_CHECK(mfh.read_record<uint64_t>(65528).value() == 0);
+
+  // Single buffer reads point into the map, and are truncated to the end of the map
+  byte buffer[16];
+  auto bytesread = mfh.read(8, {{buffer, 8}}).value();
+  BOOST_CHECK(bytesread == 8);
+  mapped_file_handle::buffer_type req{buffer, 16};
+  auto buffers = mfh.read({{&req, 1}, 65528}).value();
+  BOOST_CHECK(buffers.size() == 1);
+  BOOST_CHECK(buffers[0].data() == mfh.address() + 65528);
+  BOOST_CHECK(buffers[0].size() == 8);
+  req = {buffer, 16};
+  buffers = mfh.read({{&req, 1}, 70000}).value();
+  BOOST_CHECK(buffers[0].size() == 0);
+}
+
+static inline void TestMappedFileHandleNontemporalWrites()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  static constexpr size_t testbytes = 1024 * 1024;
+  mapped_file_handle mfh = mapped_file_handle::mapped_temp_inode(0, path_discovery::storage_backed_temporary_files_directory(), mapped_file_handle::mode::write,
+                                                                 mapped_file_handle::flag::none, section_handle::flag::readwrite | section_handle::flag::nontemporal_writes)
+                           .value();
+  mfh.truncate(testbytes + 4096).value();
+  std::vector<byte> out(testbytes);
+  utils::random_fill(reinterpret_cast<char *>(out.data()), out.size());
+  // Misaligned, and with a tail which is not a multiple of the store size
+  BOOST_CHECK(mfh.write(3, {{out.data(), out.size() - 5}}).value() == out.size() - 5);
+  BOOST_CHECK(0 == memcmp(mfh.address() + 3, out.data(), out.size() - 5));
+  BOOST_CHECK(mfh.address()[0] == to_byte(0));
+  BOOST_CHECK(mfh.address()[testbytes - 2] == to_byte(0));
+
+  // And the utility directly
+  std::vector<byte> in(testbytes);
+  for(size_t offset : {0, 1, 15, 17})
+  {
+    for(size_t bytes : {0, 1, 63, 64, 65, 4096 + 7})
+    {
+      memset(in.data(), 0, in.size());
+      utils::memcpy_nontemporal(in.data() + offset, out.data(), bytes);
+      BOOST_CHECK(0 == memcmp(in.data() + offset, out.data(), bytes));
+      BOOST_CHECK(in[offset + bytes] == to_byte(0));
+    }
+  }
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, mapped_file_handle, records, "Tests that mapped_file_handle reads and writes records", TestMappedFileHandleRecords())
+KERNELTEST_TEST_KERNEL(integration, llfio, mapped_file_handle, nontemporal_writes, "Tests that mapped_file_handle writes with non-temporal stores", TestMappedFileHandleNontemporalWrites())
@@ -0,0 +1,137 @@
+/* Integration test kernel for mapped file handle reservation growth
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static inline void TestMappedFileHandleReservationGrowth()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto mfh = llfio::mapped_temp_inode(65536).value();
+  mfh.truncate(4096).value();
+  BOOST_CHECK_EQUAL(mfh.capacity(), 65536);
+  mfh.address()[0] = llfio::byte(78);
+  // Appending past the reservation grows it geometrically, not to exactly the new length
+  size_t remaps = 0;
+  auto *addr = mfh.address();
+  for(llfio::mapped_file_handle::extent_type length = 8192; length <= 1024 * 1024; length += 4096)
+  {
+    const auto capacity = mfh.capacity();
+    BOOST_CHECK_EQUAL(mfh.truncate(length).value(), length);
+    BOOST_CHECK(mfh.capacity() >= length);
+    if(mfh.capacity() != capacity)
+    {
+      BOOST_CHECK(mfh.capacity() >= 2 * capacity);
+      ++remaps;
+    }
+    if(mfh.address() != addr)
+    {
+      addr = mfh.address();
+      std::cout << "NOTE: Reservation growth to " << mfh.capacity() << " relocated the map." << std::endl;
+    }
+    BOOST_REQUIRE(mfh.map().length() == length);
+    mfh.address()[length - 1] = llfio::byte(79);
+  }
+  BOOST_CHECK(remaps <= 4);
+  BOOST_CHECK(mfh.address()[0] == llfio::byte(78));
+  BOOST_CHECK(mfh.address()[1024 * 1024 - 1] == llfio::byte(79));
+  // Within the reservation, update_map() only adjusts the map's length
+  addr = mfh.address();
+  const auto capacity = mfh.capacity();
+  BOOST_CHECK_EQUAL(mfh.update_map().value(), 1024 * 1024);
+  BOOST_CHECK(mfh.address() == addr);
+  BOOST_CHECK_EQUAL(mfh.capacity(), capacity);
+  // Explicitly reserving more tries to extend the map in place
+  mfh.reserve(capacity * 2).value();
+  BOOST_CHECK_EQUAL(mfh.capacity(), capacity * 2);
+  BOOST_CHECK(mfh.address()[0] == llfio::byte(78));
+}
+
+static inline void TestMappedFileHandlePinnedReaders()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto mfh = llfio::mapped_temp_inode().value();
+  BOOST_CHECK(mfh.pin_map().address() == nullptr);
+  mfh.truncate(4096).value();
+  for(size_t n = 0; n < 4096; n++)
+  {
+    mfh.address()[n] = llfio::byte(n & 0xff);
+  }
+  // Readers pin the map whilst the writer grows the file, relocating the map many times
+  std::atomic<bool> done(false);
+  std::atomic<size_t> failures(0), pins(0);
+  std::vector<std::thread> readers;
+  for(size_t n = 0; n < 4; n++)
+  {
+    readers.emplace_back([&] {
+      while(!done.load(std::memory_order_relaxed))
+      {
+        auto pin = mfh.pin_map();
+        if(pin.address() == nullptr || pin.length() < 4096)
+        {
+          failures.fetch_add(1);
+          continue;
+        }
+        for(size_t i = 0; i < 4096; i += 97)
+        {
+          if(pin.address()[i] != llfio::byte(i & 0xff))
+          {
+            failures.fetch_add(1);
+          }
+        }
+        // The whole pinned length must remain accessible
+        (void) *(volatile llfio::byte *) (pin.address() + pin.length() - 1);
+        pins.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  auto *addr = mfh.address();
+  size_t relocations = 0;
+  for(llfio::mapped_file_handle::extent_type length = 8192; length <= 64 * 1024 * 1024; length += 65536)
+  {
+    mfh.truncate(length).value();
+    if(mfh.address() != addr)
+    {
+      addr = mfh.address();
+      ++relocations;
+    }
+    mfh.update_map().value();
+  }
+  done = true;
+  for(auto &reader : readers)
+  {
+    reader.join();
+  }
+  std::cout << pins << " pins were taken during " << relocations << " relocations of the map." << std::endl;
+  BOOST_CHECK(failures == 0);
+  auto pin = mfh.pin_map();
+  BOOST_CHECK(pin.address() == mfh.address());
+  BOOST_CHECK(pin.length() == mfh.map().length());
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, mapped_file_handle, reservation_growth, "Tests that mapped file handle reservations grow geometrically", TestMappedFileHandleReservationGrowth())
+KERNELTEST_TEST_KERNEL(integration, llfio, mapped_file_handle, pinned_readers, "Tests that pinned maps of a mapped file handle survive relocation", TestMappedFileHandlePinnedReaders())
@@ -0,0 +1,170 @@
+/* Integration test kernel for mirrored ring buffers
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <thread>
+
+static inline void TestMirroredMap()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  const auto granularity = llfio::utils::allocation_granularity();
+  auto sh = llfio::section_handle::section(granularity).value();
+  BOOST_CHECK(llfio::map_handle::map_mirrored(sh, granularity / 2).has_error());
+  auto mh = llfio::map_handle::map_mirrored(sh, granularity).value();
+  BOOST_REQUIRE(mh.length() == granularity * 2);
+  // Both halves are the same storage
+  mh.address()[5] = llfio::byte(78);
+  BOOST_CHECK(mh.address()[granularity + 5] == llfio::byte(78));
+  mh.address()[granularity * 2 - 1] = llfio::byte(79);
+  BOOST_CHECK(mh.address()[granularity - 1] == llfio::byte(79));
+}
+
+static inline void TestMirroredRingBuffer()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto rb = llfio::algorithm::mirrored_ring_buffer::create(1).value();
+  const auto capacity = rb.capacity();
+  BOOST_REQUIRE(capacity >= llfio::utils::allocation_granularity());
+  BOOST_CHECK(rb.empty());
+  BOOST_CHECK(rb.writable().size() == capacity);
+  // Writes and reads spanning the wrap point are contiguous
+  std::vector<llfio::byte> out(capacity * 3 / 4), in(capacity);
+  for(size_t n = 0; n < out.size(); n++)
+  {
+    out[n] = (llfio::byte)(n & 0xff);
+  }
+  for(size_t round = 0; round < 4; round++)
+  {
+    BOOST_REQUIRE(rb.write({out.data(), out.size()}) == out.size());
+    BOOST_CHECK(rb.size() == out.size());
+    auto readable = rb.readable();
+    BOOST_REQUIRE(readable.size() == out.size());
+    BOOST_CHECK(0 == memcmp(readable.data(), out.data(), out.size()));
+    rb.commit_read(readable.size());
+    BOOST_CHECK(rb.empty());
+  }
+  // A producer and consumer on different threads
+  const size_t total = capacity * 16;
+  std::thread producer([&] {
+    uint32_t v = 0;
+    for(size_t written = 0; written < total;)
+    {
+      auto span = rb.writable();
+      const size_t words = (std::min)(span.size(), total - written) / sizeof(uint32_t);
+      for(size_t n = 0; n < words; n++)
+      {
+        memcpy(span.data() + n * sizeof(uint32_t), &v, sizeof(v));
+        ++v;
+      }
+      rb.commit_write(words * sizeof(uint32_t));
+      written += words * sizeof(uint32_t);
+    }
+  });
+  uint32_t expected = 0;
+  bool ok = true;
+  for(size_t read = 0; read < total;)
+  {
+    auto span = rb.readable();
+    const size_t words = span.size() / sizeof(uint32_t);
+    for(size_t n = 0; n < words; n++)
+    {
+      uint32_t v;
+      memcpy(&v, span.data() + n * sizeof(uint32_t), sizeof(v));
+      ok = ok && (v == expected);
+      ++expected;
+    }
+    rb.commit_read(words * sizeof(uint32_t));
+    read += words * sizeof(uint32_t);
+  }
+  producer.join();
+  BOOST_CHECK(ok);
+  // Moving keeps the ring buffer working
+  auto rb2 = std::move(rb);
+  BOOST_CHECK(!rb.is_valid());
+  BOOST_CHECK(rb2.write({out.data(), 16}) == 16);
+  BOOST_CHECK(rb2.read({in.data(), in.size()}) == 16);
+}
+
+static inline void TestMirroredRingBufferMessages()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto rb = llfio::algorithm::mirrored_ring_buffer::create(1).value();
+  BOOST_CHECK(!rb.read_message());
+  // Waiting upon an empty ring buffer times out
+  BOOST_CHECK(rb.read_message(std::chrono::milliseconds(10)).error() == llfio::errc::timed_out);
+  // A producer blocking whilst full, and a consumer blocking whilst empty
+  const size_t total = 100000;
+  std::thread producer([&] {
+    std::vector<llfio::byte> msg(1024);
+    for(size_t n = 0; n < total; n++)
+    {
+      const size_t len = 1 + n % msg.size();
+      memset(msg.data(), (int) (n & 0xff), len);
+      rb.write_message({msg.data(), len}, {}).value();
+    }
+  });
+  bool ok = true;
+  for(size_t n = 0; n < total; n++)
+  {
+    auto msg = rb.read_message(std::chrono::seconds(30)).value();
+    const size_t len = 1 + n % 1024;
+    ok = ok && msg.size() == len && msg.data()[0] == (llfio::byte)(n & 0xff) && msg.data()[len - 1] == (llfio::byte)(n & 0xff);
+    rb.commit_read(llfio::algorithm::mirrored_ring_buffer::message_size(msg));
+  }
+  producer.join();
+  BOOST_CHECK(ok);
+  BOOST_CHECK(rb.empty());
+  // A message too large for the ring buffer is never written
+  std::vector<llfio::byte> huge(rb.capacity());
+  BOOST_CHECK(!rb.write_message({huge.data(), huge.size()}));
+}
+
+static inline void TestSharedMirroredRingBuffer()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_file({}, llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::temporary,
+                                          llfio::file_handle::flag::unlink_on_first_close)
+            .value();
+  auto fh2 = fh.reopen().value();
+  // Attaching before creation fails
+  BOOST_CHECK(llfio::algorithm::mirrored_ring_buffer::open(fh.reopen().value()).has_error());
+  auto producer = llfio::algorithm::mirrored_ring_buffer::open(std::move(fh), 100000).value();
+  auto consumer = llfio::algorithm::mirrored_ring_buffer::open(std::move(fh2)).value();
+  BOOST_CHECK(consumer.capacity() == producer.capacity());
+  const char hello[] = "hello world";
+  BOOST_CHECK(producer.write({reinterpret_cast<const llfio::byte *>(hello), sizeof(hello)}) == sizeof(hello));
+  auto readable = consumer.readable();
+  BOOST_REQUIRE(readable.size() == sizeof(hello));
+  BOOST_CHECK(0 == memcmp(readable.data(), hello, sizeof(hello)));
+  consumer.commit_read(readable.size());
+  BOOST_CHECK(producer.empty());
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, mirrored, "Tests that mirrored maps alias their two halves", TestMirroredMap())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, mirrored_ring_buffer, "Tests that llfio::algorithm::mirrored_ring_buffer works as expected", TestMirroredRingBuffer())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, mirrored_ring_buffer_messages, "Tests that llfio::algorithm::mirrored_ring_buffer messages and waits work as expected",
+                       TestMirroredRingBufferMessages())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, shared_mirrored_ring_buffer, "Tests that llfio::algorithm::mirrored_ring_buffer can be shared", TestSharedMirroredRingBuffer())
@@ -0,0 +1,247 @@
+/* Integration test kernel for whether multiplexed file handles work
+(C) 2020 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2020
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) || defined(_WIN32) || defined(__FreeBSD__) || defined(__APPLE__)
+static inline void TestMultiplexedFileHandle()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto test_multiplexer = [](llfio::io_multiplexer_ptr multiplexer) {
+    auto fh = llfio::file_handle::temp_inode({}, llfio::file_handle::mode::write, llfio::file_handle::flag::multiplexable).value();
+    fh.set_multiplexer(multiplexer.get()).value();
+    size_t bytes = 4096;
+    auto wbuf = fh.allocate_registered_buffer(bytes).value();
+    BOOST_REQUIRE(bytes >= 4096);
+    BOOST_REQUIRE(wbuf->size() >= 4096);
+    for(size_t n = 0; n < 4096; n++)
+    {
+      (*wbuf)[n] = (llfio::byte)(n & 0xff);
+    }
+    auto rbuf = fh.allocate_registered_buffer(bytes).value();
+    // Registered buffers, single buffer i/o
+    {
+      llfio::file_handle::const_buffer_type wb[] = {{wbuf->data(), 4096}};
+      auto written = fh.write(wbuf, {wb, 0}).value();
+      BOOST_REQUIRE(written.size() == 1);
+      BOOST_CHECK(written[0].size() == 4096);
+      fh.barrier().value();
+      llfio::file_handle::buffer_type rb[] = {{rbuf->data(), 4096}};
+      auto read = fh.read(rbuf, {rb, 0}).value();
+      BOOST_REQUIRE(read.size() == 1);
+      BOOST_CHECK(read[0].size() == 4096);
+      BOOST_CHECK(0 == memcmp(rbuf->data(), wbuf->data(), 4096));
+    }
+    // Registered buffers, i/o within part of the buffer
+    {
+      memset(rbuf->data(), 0, rbuf->size());
+      llfio::file_handle::buffer_type rb[] = {{rbuf->data() + 100, 1000}};
+      auto read = fh.read(rbuf, {rb, 100}).value();
+      BOOST_REQUIRE(read.size() == 1);
+      BOOST_CHECK(read[0].size() == 1000);
+      BOOST_CHECK(0 == memcmp(rbuf->data() + 100, wbuf->data() + 100, 1000));
+    }
+    // Unregistered scatter i/o
+    {
+      llfio::byte b1[100], b2[200];
+      llfio::file_handle::buffer_type rb[] = {{b1, 100}, {b2, 200}};
+      auto read = fh.read({rb, 0}).value();
+      BOOST_REQUIRE(read.size() == 2);
+      BOOST_CHECK(0 == memcmp(b1, wbuf->data(), 100));
+      BOOST_CHECK(0 == memcmp(b2, wbuf->data() + 100, 200));
+    }
+    // Reads of data already in the page cache may complete without being submitted to the kernel
+    {
+      multiplexer->check_for_any_completed_io().value();
+      llfio::byte b1[512];
+      llfio::file_handle::buffer_type rb[] = {{b1, 512}};
+      auto read = fh.read({rb, 512}).value();
+      BOOST_REQUIRE(read.size() == 1);
+      BOOST_CHECK(read[0].size() == 512);
+      BOOST_CHECK(0 == memcmp(b1, wbuf->data() + 512, 512));
+      auto stats = multiplexer->check_for_any_completed_io().value();
+      std::cout << "   " << stats.immediate_completions << " of 1 cached reads completed immediately." << std::endl;
+    }
+    // Batched i/o
+    {
+      static constexpr size_t BATCH = 16;
+      memset(rbuf->data(), 0, rbuf->size());
+      llfio::file_handle::buffer_type rb[BATCH];
+      llfio::io_multiplexer::io_request<llfio::file_handle::buffers_type> reqs[BATCH];
+      for(size_t n = 0; n < BATCH; n++)
+      {
+        rb[n] = {rbuf->data() + n * 256, 256};
+        reqs[n] = {{&rb[n], 1}, n * 256};
+      }
+      const auto state_reqs = multiplexer->io_state_requirements();
+      const size_t stride = (state_reqs.first + state_reqs.second - 1) & ~(state_reqs.second - 1);
+      std::vector<llfio::byte> storage(stride * BATCH + state_reqs.second);
+      auto *aligned = storage.data() + ((state_reqs.second - ((uintptr_t) storage.data() & (state_reqs.second - 1))) & (state_reqs.second - 1));
+      llfio::io_multiplexer::io_operation_state *states[BATCH];
+      auto batch = multiplexer
+                   ->construct_and_init_io_operations<llfio::file_handle::buffers_type>({aligned, stride * BATCH}, states, &fh, nullptr, rbuf, {},
+                                                                                        {reqs, BATCH})
+                   .value();
+      BOOST_REQUIRE(batch.size() == BATCH);
+      for(auto *state : batch)
+      {
+        while(!is_finished(multiplexer->check_io_operation(state)))
+        {
+          multiplexer->check_for_any_completed_io(std::chrono::milliseconds(100)).value();
+        }
+        auto read = std::move(*state).get_completed_read().value();
+        BOOST_REQUIRE(read.size() == 1);
+        BOOST_CHECK(read[0].size() == 256);
+        state->~io_operation_state();
+      }
+      BOOST_CHECK(0 == memcmp(rbuf->data(), wbuf->data(), BATCH * 256));
+      // Nothing remains in flight once all the i/o has been reaped
+      auto stats = multiplexer->check_for_any_completed_io().value();
+      BOOST_CHECK(stats.initiated_ios_in_flight == 0);
+    }
+    // Pooled i/o operation state storage
+    {
+      const auto state_reqs = multiplexer->io_state_requirements();
+      auto a = multiplexer->allocate_io_operation_state_storage().value();
+      auto b = multiplexer->allocate_io_operation_state_storage().value();
+      BOOST_CHECK(a.size() >= state_reqs.first);
+      BOOST_CHECK(((uintptr_t) a.data() & 63) == 0);
+      BOOST_CHECK(((uintptr_t) b.data() & 63) == 0);
+      BOOST_CHECK(a.data() != b.data());
+      multiplexer->deallocate_io_operation_state_storage(a);
+      auto c = multiplexer->allocate_io_operation_state_storage().value();
+      BOOST_CHECK(c.data() == a.data());  // recycled
+      // Storage may be returned by another thread
+      std::thread([&] { multiplexer->deallocate_io_operation_state_storage(b); }).join();
+      multiplexer->deallocate_io_operation_state_storage(c);
+    }
+    fh.set_multiplexer(nullptr).value();
+    fh.close().value();
+    // Registered buffers must be able to outlive their multiplexer
+    multiplexer.reset();
+    rbuf.reset();
+    wbuf.reset();
+  };
+#ifdef _WIN32
+  std::cout << "\nSingle threaded IOCP:\n";
+  test_multiplexer(llfio::multiplexer_win_iocp(1, false).value());
+  std::cout << "\nMultithreaded IOCP:\n";
+  test_multiplexer(llfio::multiplexer_win_iocp(2, false).value());
+  auto r = llfio::multiplexer_win_ioring(1);
+  if(!r)
+  {
+    std::cout << "\nIoRing is not available on this system (" << r.error().message() << "), skipping." << std::endl;
+    return;
+  }
+  std::cout << "\nSingle threaded IoRing:\n";
+  test_multiplexer(std::move(r).value());
+  std::cout << "\nMultithreaded IoRing:\n";
+  test_multiplexer(llfio::multiplexer_win_ioring(2).value());
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+  std::cout << "\nSingle threaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1).value());
+  std::cout << "\nMultithreaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(2).value());
+  std::cout << "\nSingle threaded kqueue without worker threads:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1, 0).value());
+#else
+  auto r = llfio::multiplexer_linux_io_uring(1);
+  if(!r)
+  {
+    std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+    return;
+  }
+  std::cout << "\nSingle threaded io_uring:\n";
+  test_multiplexer(std::move(r).value());
+  std::cout << "\nMultithreaded io_uring:\n";
+  test_multiplexer(llfio::multiplexer_linux_io_uring(2).value());
+  std::cout << "\nMultithreaded io_uring with per-thread rings:\n";
+  test_multiplexer(llfio::multiplexer_linux_io_uring(2, llfio::io_uring_multiplexer_flag::per_thread_rings).value());
+  // Kernel polling modes need newer kernels, and may be disallowed by policy
+  r = llfio::multiplexer_linux_io_uring(1, llfio::io_uring_multiplexer_flag::sqpoll | llfio::io_uring_multiplexer_flag::iopoll);
+  if(!r)
+  {
+    std::cout << "\nio_uring kernel polling is not available (" << r.error().message() << "), skipping." << std::endl;
+    return;
+  }
+  std::cout << "\nSingle threaded io_uring with kernel polling:\n";
+  test_multiplexer(std::move(r).value());
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, file_handle, multiplexed, "Tests that multiplexed llfio::file_handle works as expected", TestMultiplexedFileHandle())
+
+static inline void TestAutomaticMultiplexer()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  // Disabled by default
+  BOOST_CHECK(llfio::this_thread::multiplexer() == nullptr);
+  llfio::this_thread::automatic_multiplexer_config config;
+  config.enabled = true;
+  auto old = llfio::this_thread::set_automatic_multiplexer(config);
+  BOOST_CHECK(!old.enabled);
+  llfio::io_multiplexer *multiplexers[2] = {nullptr, nullptr};
+  std::atomic<size_t> created{0};
+  std::vector<std::thread> threads;
+  for(size_t n = 0; n < 2; n++)
+  {
+    threads.emplace_back([&, n] {
+      multiplexers[n] = llfio::this_thread::multiplexer();
+      // Created once per thread
+      BOOST_CHECK(llfio::this_thread::multiplexer() == multiplexers[n]);
+      if(multiplexers[n] != nullptr)
+      {
+        auto fh = llfio::file_handle::temp_inode({}, llfio::file_handle::mode::write, llfio::file_handle::flag::multiplexable).value();
+        auto r = fh.set_multiplexer();
+        if(r)
+        {
+          BOOST_CHECK(fh.multiplexer() == multiplexers[n]);
+          llfio::byte b[] = {llfio::to_byte(78)};
+          BOOST_CHECK(fh.write(0, {{b, 1}}).value() == 1);
+          fh.set_multiplexer(nullptr).value();
+        }
+      }
+      // Keep both multiplexers alive until both have been created, so their addresses differ
+      ++created;
+      while(created < 2)
+      {
+        std::this_thread::yield();
+      }
+    });
+  }
+  for(auto &t : threads)
+  {
+    t.join();
+  }
+  BOOST_CHECK(multiplexers[0] != nullptr);
+  BOOST_CHECK(multiplexers[0] != multiplexers[1]);
+  llfio::this_thread::set_automatic_multiplexer(old);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, this_thread, automatic_multiplexer, "Tests that this_thread::multiplexer() automatically creates a multiplexer per thread", TestAutomaticMultiplexer())
+#endif
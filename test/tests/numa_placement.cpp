@@ -0,0 +1,61 @@
+/* Integration test kernel for NUMA placement of maps
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestNumaPlacement()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using policy_type = llfio::numa_placement::policy_type;
+  BOOST_CHECK(llfio::this_thread::current_numa_placement() == llfio::numa_placement());
+  // Preferring the local node is only a hint, so must always work
+  BOOST_CHECK(llfio::this_thread::set_numa_placement(policy_type::local) == llfio::numa_placement());
+  {
+    auto mh = llfio::map_handle::map(1024 * 1024).value();
+    mh.address()[0] = llfio::byte(78);
+    llfio::algorithm::trivial_vector<int> v(65536, 5);
+    BOOST_CHECK(v[65535] == 5);
+  }
+  // Binding requires NUMA support, and node zero always exists where it is supported
+  llfio::this_thread::set_numa_placement(llfio::numa_placement::bind_to(0));
+  auto r = llfio::map_handle::map(1024 * 1024);
+  if(r)
+  {
+    r.value().address()[0] = llfio::byte(78);
+    // Some platforms cannot change the placement of existing memory
+    auto r2 = llfio::map_handle::set_numa_placement({r.value().address(), r.value().length()}, policy_type::prefer);
+    if(r2 || r2.error() != llfio::errc::operation_not_supported)
+    {
+      BOOST_CHECK(r2.has_value());
+      BOOST_CHECK(llfio::map_handle::set_numa_placement({r.value().address(), r.value().length()}, {policy_type::bind, 0}).error() == llfio::errc::invalid_argument);
+    }
+  }
+  else
+  {
+    std::cout << "NOTE: Binding memory to NUMA nodes is not supported on this platform (" << r.error().message() << ")." << std::endl;
+  }
+  BOOST_CHECK(llfio::this_thread::set_numa_placement({}) == llfio::numa_placement::bind_to(0));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, numa_placement, "Tests that NUMA placement of maps works as expected", TestNumaPlacement())
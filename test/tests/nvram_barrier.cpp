@@ -0,0 +1,60 @@
+/* Integration test kernel for nvram_barrier()
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestNvramBarrier()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto mh = llfio::map_handle::map(65536).value();
+  llfio::io_handle::const_buffer_type reqs[] = {{mh.address() + 5, 100}, {mh.address() + 4096, 1}, {mh.address() + 60000, 4000}};
+  for(auto &req : reqs)
+  {
+    memset(const_cast<llfio::byte *>(req.data()), 78, req.size());
+  }
+  llfio::io_handle::const_buffer_type original[3] = {reqs[0], reqs[1], reqs[2]};
+  auto done = llfio::nvram_barrier(llfio::span<llfio::io_handle::const_buffer_type>(reqs));
+  BOOST_REQUIRE(done.size() == 3);
+  if(done[0].empty())
+  {
+    std::cout << "NOTE: This CPU has no cache line flush instructions which LLFIO knows how to use." << std::endl;
+    return;
+  }
+  // Each request is rounded out to whole cache lines
+  for(size_t n = 0; n < 3; n++)
+  {
+    BOOST_CHECK(done[n].data() <= original[n].data());
+    BOOST_CHECK(done[n].data() + done[n].size() >= original[n].data() + original[n].size());
+    BOOST_CHECK(done[n].size() < original[n].size() + 2 * 256);
+  }
+  // The single buffer overload agrees
+  auto single = llfio::nvram_barrier(original[0], true);
+  BOOST_CHECK(single.data() == done[0].data());
+  BOOST_CHECK(single.size() == done[0].size());
+  // Memory is still accessible
+  BOOST_CHECK(mh.address()[5] == llfio::byte(78));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, map_handle, nvram_barrier, "Tests that nvram_barrier() works as expected", TestNvramBarrier())
@@ -63,4 +63,39 @@ static inline void TestPathDiscovery()
   }
 }
 
+static inline void TestPathDiscoveryCache()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  const auto expected = llfio::path_discovery::storage_backed_temporary_files_directory().current_path().value();
+  const auto cachepath = expected / "llfio_path_discovery_cache_test";
+  std::error_code ec;
+  llfio::filesystem::remove(cachepath, ec);
+  llfio::path_discovery::set_verified_temporary_directories_cache(cachepath);
+  // The first probe writes the cache, the second uses it
+  for(int round = 0; round < 2; round++)
+  {
+    (void) llfio::path_discovery::all_temporary_directories(true);
+    auto verified_list = llfio::path_discovery::verified_temporary_directories();
+    BOOST_CHECK(!verified_list.empty());
+    for(auto &i : verified_list)
+    {
+      BOOST_CHECK(i.stat);
+    }
+    BOOST_REQUIRE(llfio::filesystem::exists(cachepath));
+    BOOST_CHECK(llfio::path_discovery::storage_backed_temporary_files_directory().current_path().value() == expected);
+  }
+  // A corrupt cache is ignored and rewritten
+  {
+    auto fh = llfio::file_handle::file({}, cachepath, llfio::file_handle::mode::write, llfio::file_handle::creation::truncate_existing).value();
+    fh.write(0, {{reinterpret_cast<const llfio::byte *>("garbage"), 7}}).value();
+  }
+  (void) llfio::path_discovery::all_temporary_directories(true);
+  BOOST_CHECK(!llfio::path_discovery::verified_temporary_directories().empty());
+  BOOST_CHECK(llfio::filesystem::file_size(cachepath) > 7);
+  llfio::path_discovery::set_verified_temporary_directories_cache({});
+  llfio::filesystem::remove(cachepath, ec);
+}
+
 KERNELTEST_TEST_KERNEL(integration, llfio, path_discovery, temp_directories, "Tests that llfio::path_discovery works as expected", TestPathDiscovery())
+KERNELTEST_TEST_KERNEL(integration, llfio, path_discovery, verification_cache, "Tests that the llfio::path_discovery verification cache works as expected",
+                       TestPathDiscoveryCache())
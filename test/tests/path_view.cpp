@@ -116,6 +116,22 @@ static inline void TestPathView()
   e = e.remove_filename();
   BOOST_CHECK(0 == e.compare<>("/mnt/c/Users/ned/Documents/boostish/afio/programs/build_posix/testdir"));
   BOOST_CHECK(0 == f.compare<>("0"));
+  {
+    // Separator searches in every code unit width, across and within eight byte words
+    const llfio::path_view g16(u"/mnt/c/Users/ned/Documents/0.txt"), g32(L"/mnt/c/Users/ned/Documents/0.txt");
+    for(const auto &g : {g16, g32})
+    {
+      BOOST_CHECK(g.filename().native_size() == 5);
+      BOOST_CHECK(g.remove_filename().native_size() == 26);
+      BOOST_CHECK(g.parent_path().filename().native_size() == 9);
+      size_t components = 0;
+      for(auto it = g.begin(); it != g.end(); ++it)
+      {
+        components++;
+      }
+      BOOST_CHECK(components == 7);
+    }
+  }
 #ifndef _WIN32
   // cstr
   llfio::path_view::c_str<> g(e);
@@ -123,6 +139,30 @@ static inline void TestPathView()
   llfio::path_view::c_str<> h(f);
   BOOST_CHECK(h.buffer == p + 70);  // NOLINT
 #endif
+  {
+    // Paths too long for the internal buffer recycle their buffers per thread
+    const std::string longpath(3000, 'a');
+    const llfio::path_view longview(longpath.data(), longpath.size(), false);
+    const void *first;
+    {
+      llfio::path_view::recycling_c_str<> z(longview);
+      BOOST_REQUIRE(z.buffer != nullptr);
+      BOOST_CHECK(z.length == longpath.size());
+      first = z.buffer;
+    }
+    llfio::path_view::recycling_c_str<> z(longview);
+    BOOST_CHECK(z.buffer == first);
+  }
+  {
+    // ASCII paths are reencoded by widening or narrowing each code unit
+    llfio::path_view::c_str<wchar_t> wz(llfio::path_view("boostish/afio/0.txt"));
+    BOOST_REQUIRE(wz.buffer != nullptr);
+    BOOST_CHECK(wz.length == 19);
+    BOOST_CHECK(0 == wcscmp(wz.buffer, L"boostish/afio/0.txt"));
+    llfio::path_view::c_str<char> nz(llfio::path_view(L"boostish/afio/0.txt"));
+    BOOST_REQUIRE(nz.buffer != nullptr);
+    BOOST_CHECK(0 == strcmp(nz.buffer, "boostish/afio/0.txt"));
+  }
   CheckPathView("/mnt/c/Users/ned/Documents/boostish/afio/programs/build_posix/testdir");
   CheckPathView("/mnt/c/Users/ned/Documents/boostish/afio/programs/build_posix/testdir/");
   CheckPathView("/mnt/c/Users/ned/Documents/boostish/afio/programs/build_posix/testdir/0");
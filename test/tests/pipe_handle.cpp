@@ -94,7 +94,70 @@ static inline void TestNonBlockingPipeHandle()
   reader.close().value();
 }
 
-#if LLFIO_ENABLE_TEST_IO_MULTIPLEXERS
+static inline void TestSplicePipeHandle()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto pipes = llfio::pipe_handle::anonymous_pipe().value();
+  auto &reader = pipes.first, &writer = pipes.second;
+  auto fh = llfio::file_handle::temp_inode().value();
+  llfio::byte buffer[64];
+  llfio::pipe_handle::const_buffer_type b((const llfio::byte *) "hello world", 11);
+  BOOST_REQUIRE(writer.splice_from({&b, 1}).value() == 11);
+#ifdef __linux__
+  {  // duplicate the contents without consuming them
+    auto copies = llfio::pipe_handle::anonymous_pipe().value();
+    BOOST_REQUIRE(reader.tee_to(copies.second, 64).value() == 11);
+    auto read = copies.first.read(0, {{buffer, 64}}).value();
+    BOOST_REQUIRE(read == 11);
+    BOOST_CHECK(0 == memcmp(buffer, "hello world", 11));
+  }
+#endif
+  // Pipe into the file at an offset, and back out of the file into the pipe
+  BOOST_REQUIRE(reader.splice_to(fh, 4, 64).value() == 11);
+  auto read = fh.read(4, {{buffer, 64}}).value();
+  BOOST_REQUIRE(read == 11);
+  BOOST_CHECK(0 == memcmp(buffer, "hello world", 11));
+  BOOST_REQUIRE(writer.splice_from(fh, 10, 5).value() == 5);
+  read = reader.read(0, {{buffer, 64}}).value();
+  BOOST_REQUIRE(read == 5);
+  BOOST_CHECK(0 == memcmp(buffer, "world", 5));
+  {  // non-blocking pipes time out when empty
+    auto nbpipes = llfio::pipe_handle::anonymous_pipe(llfio::pipe_handle::caching::all, llfio::pipe_handle::flag::multiplexable).value();
+    auto spliced = nbpipes.first.splice_to(fh, 0, 64, std::chrono::milliseconds(0));
+    BOOST_REQUIRE(spliced.has_error());
+    BOOST_CHECK(spliced.error() == llfio::errc::timed_out);
+  }
+}
+
+static inline void TestDrainPipeHandle()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto pipes = llfio::pipe_handle::anonymous_pipe(llfio::pipe_handle::caching::all, llfio::pipe_handle::flag::none, 1024 * 1024).value();
+  auto &reader = pipes.first, &writer = pipes.second;
+#if defined(__linux__) || defined(_WIN32)
+  BOOST_CHECK(reader.buffer_size().value() >= 1024 * 1024);
+#endif
+#ifdef __linux__
+  BOOST_CHECK(writer.set_buffer_size(128 * 1024).value() >= 128 * 1024);
+  BOOST_CHECK(reader.buffer_size().value() >= 128 * 1024);
+#endif
+  llfio::byte buffer1[4], buffer2[64], buffer3[64];
+  llfio::pipe_handle::buffer_type bs[3] = {{buffer1, sizeof(buffer1)}, {buffer2, sizeof(buffer2)}, {buffer3, sizeof(buffer3)}};
+  // Empty pipes drain nothing without blocking
+  BOOST_CHECK(reader.bytes_available().value() == 0);
+  BOOST_CHECK(reader.drain(bs).value().empty());
+  BOOST_REQUIRE(writer.write(0, {{(const llfio::byte *) "hello world", 11}}).value() == 11);
+  BOOST_CHECK(reader.bytes_available().value() == 11);
+  auto drained = reader.drain(bs).value();
+  BOOST_REQUIRE(drained.size() == 2);
+  BOOST_CHECK(drained[0].size() == 4);
+  BOOST_CHECK(drained[1].size() == 7);
+  BOOST_CHECK(0 == memcmp(buffer1, "hell", 4));
+  BOOST_CHECK(0 == memcmp(buffer2, "o world", 7));
+  BOOST_CHECK(reader.bytes_available().value() == 0);
+}
+
+#if defined(_WIN32) || defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
 static inline void TestMultiplexedPipeHandle()
 {
   static constexpr size_t MAX_PIPES = 64;
@@ -242,24 +305,210 @@ static inline void TestMultiplexedPipeHandle()
   };
 #ifdef _WIN32
   std::cout << "\nSingle threaded IOCP, immediate completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(1, false).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(1, false).value());
   std::cout << "\nSingle threaded IOCP, reactor completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(1, true).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(1, true).value());
   std::cout << "\nMultithreaded IOCP, immediate completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(2, false).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(2, false).value());
   std::cout << "\nMultithreaded IOCP, reactor completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(2, true).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(2, true).value());
+#elif defined(__linux__)
+  std::cout << "\nSingle threaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(1).value());
+  std::cout << "\nMultithreaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(2).value());
+  {
+    auto r = llfio::multiplexer_linux_io_uring(1);
+    if(!r)
+    {
+      std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+      return;
+    }
+    std::cout << "\nSingle threaded io_uring:\n";
+    test_multiplexer(std::move(r).value());
+  }
+  std::cout << "\nMultithreaded io_uring:\n";
+  test_multiplexer(llfio::multiplexer_linux_io_uring(2).value());
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+  std::cout << "\nSingle threaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1).value());
+  std::cout << "\nMultithreaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(2).value());
+#else
+#error Not implemented yet
+#endif
+}
+
+#if defined(_WIN32) || defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+static inline void TestDeadlinedMultiplexedPipeHandle()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto test_multiplexer = [](llfio::io_multiplexer_ptr multiplexer) {
+    auto pipes = llfio::pipe_handle::anonymous_pipe(llfio::pipe_handle::caching::reads, llfio::pipe_handle::flag::multiplexable).value();
+    pipes.first.set_multiplexer(multiplexer.get()).value();
+    auto storage = std::make_unique<llfio::byte[]>(multiplexer->io_state_requirements().first);
+    llfio::byte buffer_[8];
+    llfio::pipe_handle::buffer_type buffer(buffer_, sizeof(buffer_));
+    // Nothing is ever written, so the read can only complete by its deadline being reached
+    auto begin = std::chrono::steady_clock::now();
+    auto *io_state = multiplexer->construct_and_init_io_operation({storage.get(), multiplexer->io_state_requirements().first}, &pipes.first, nullptr, {},
+                                                                  std::chrono::milliseconds(100),
+                                                                  llfio::pipe_handle::io_request<llfio::pipe_handle::buffers_type>({&buffer, 1}, 0));
+    BOOST_REQUIRE(io_state != nullptr);
+    while(!is_finished(io_state->current_state()))
+    {
+      multiplexer->check_for_any_completed_io(std::chrono::seconds(5)).value();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    std::cout << "   Deadlined read finished after " << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms" << std::endl;
+    BOOST_CHECK(elapsed >= std::chrono::milliseconds(100));
+    BOOST_CHECK(elapsed < std::chrono::seconds(5));
+    auto res = std::move(*io_state).get_completed_read();
+    BOOST_REQUIRE(!res);
+    BOOST_CHECK(res.error() == llfio::errc::timed_out);
+    io_state->~io_operation_state();
+  };
+#ifdef _WIN32
+  std::cout << "\nSingle threaded IOCP:\n";
+  test_multiplexer(llfio::multiplexer_win_iocp(1).value());
+  std::cout << "\nMultithreaded IOCP:\n";
+  test_multiplexer(llfio::multiplexer_win_iocp(2).value());
+#elif defined(__linux__)
+  std::cout << "\nSingle threaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(1).value());
+  std::cout << "\nMultithreaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(2).value());
+  {
+    auto r = llfio::multiplexer_linux_io_uring(1);
+    if(!r)
+    {
+      std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+      return;
+    }
+    std::cout << "\nSingle threaded io_uring:\n";
+    test_multiplexer(std::move(r).value());
+  }
+  std::cout << "\nMultithreaded io_uring:\n";
+  test_multiplexer(llfio::multiplexer_linux_io_uring(2).value());
+  std::cout << "\nPer thread rings io_uring:\n";
+  test_multiplexer(llfio::multiplexer_linux_io_uring(2, llfio::io_uring_multiplexer_flag::per_thread_rings).value());
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+  std::cout << "\nSingle threaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1).value());
+  std::cout << "\nMultithreaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(2).value());
 #else
 #error Not implemented yet
 #endif
 }
+#endif
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+static inline void TestBudgetedMultiplexedPipeHandle()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto test_multiplexer = [](llfio::io_multiplexer_ptr multiplexer) {
+    static constexpr size_t PIPES = 2, READS_PER_PIPE = 2;
+    struct pipe_t
+    {
+      llfio::pipe_handle reader, writer;
+    };
+    std::vector<pipe_t> pipes;
+    for(size_t n = 0; n < PIPES; n++)
+    {
+      auto ret = llfio::pipe_handle::anonymous_pipe(llfio::pipe_handle::caching::reads, llfio::pipe_handle::flag::multiplexable).value();
+      ret.first.set_multiplexer(multiplexer.get()).value();
+      pipes.push_back({std::move(ret.first), std::move(ret.second)});
+    }
+    const size_t storage_size = multiplexer->io_state_requirements().first;
+    std::vector<std::unique_ptr<llfio::byte[]>> storage;
+    std::vector<llfio::byte> buffers_(PIPES * READS_PER_PIPE * sizeof(size_t));
+    std::vector<llfio::pipe_handle::buffer_type> buffers;
+    std::vector<llfio::io_multiplexer::io_operation_state *> io_states;
+    buffers.reserve(PIPES * READS_PER_PIPE);
+    // Nothing has been written yet, so every read is queued
+    for(size_t n = 0; n < PIPES * READS_PER_PIPE; n++)
+    {
+      storage.push_back(std::make_unique<llfio::byte[]>(storage_size));
+      buffers.emplace_back(buffers_.data() + n * sizeof(size_t), sizeof(size_t));
+      io_states.push_back(multiplexer->construct_and_init_io_operation({storage.back().get(), storage_size}, &pipes[n / READS_PER_PIPE].reader, nullptr, {}, {},
+                                                                       llfio::pipe_handle::io_request<llfio::pipe_handle::buffers_type>({&buffers.back(), 1}, 0)));
+      BOOST_REQUIRE(io_states.back() != nullptr);
+      BOOST_REQUIRE(!is_finished(io_states.back()->current_state()));
+    }
+    // Make each pipe ready with enough for all of its reads at once, so each is reported as
+    // ready once with more queued i/o ready than the budget of each check
+    for(size_t n = 0; n < PIPES; n++)
+    {
+      const size_t v[READS_PER_PIPE] = {n, n};
+      pipes[n].writer.write(0, {{(const llfio::byte *) v, sizeof(v)}}).value();
+    }
+    auto finished = [&] {
+      size_t ret = 0;
+      for(auto *s : io_states)
+      {
+        auto state = s->current_state();
+        ret += is_completed(state) || is_finished(state);
+      }
+      return ret;
+    };
+    // Each check may complete at most one i/o, and must not lose the readiness of the rest
+    for(size_t n = 1; n <= PIPES * READS_PER_PIPE; n++)
+    {
+      auto begin = std::chrono::steady_clock::now();
+      while(finished() < n && std::chrono::steady_clock::now() - begin < std::chrono::seconds(5))
+      {
+        multiplexer->check_for_any_completed_io(std::chrono::seconds(1), 1).value();
+        BOOST_REQUIRE(finished() <= n);
+      }
+      BOOST_REQUIRE(finished() == n);
+    }
+    std::cout << "   All " << finished() << " reads completed one per check." << std::endl;
+    for(size_t n = 0; n < io_states.size(); n++)
+    {
+      auto res = std::move(*io_states[n]).get_completed_read();
+      BOOST_REQUIRE(res);
+      BOOST_CHECK(*(const size_t *) buffers[n].data() == n / READS_PER_PIPE);
+      io_states[n]->~io_operation_state();
+    }
+  };
+#if defined(__linux__)
+  std::cout << "\nSingle threaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(1).value());
+  std::cout << "\nMultithreaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(2).value());
+  {
+    auto r = llfio::multiplexer_linux_io_uring(1);
+    if(!r)
+    {
+      std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+      return;
+    }
+    std::cout << "\nSingle threaded io_uring:\n";
+    test_multiplexer(std::move(r).value());
+  }
+#else
+  std::cout << "\nSingle threaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1).value());
+  std::cout << "\nMultithreaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(2).value());
+#endif
+}
+#endif
 
 #if LLFIO_ENABLE_COROUTINES
 static inline void TestCoroutinedPipeHandle()
 {
   static constexpr size_t MAX_PIPES = 70;
   namespace llfio = LLFIO_V2_NAMESPACE;
-  auto test_multiplexer = [](llfio::io_multiplexer_ptr multiplexer) {
+  auto test_multiplexer = [](llfio::io_multiplexer_ptr multiplexer, bool queue_resumptions = false) {
+    // If queuing resumptions, completions hand coroutines to this queue, and we resume them ourselves
+    std::vector<void *> resumable;
+    if(queue_resumptions)
+    {
+      multiplexer->set_coroutine_resume_hook([](void *context, void *coroutine_address) { static_cast<std::vector<void *> *>(context)->push_back(coroutine_address); },
+                                             &resumable);
+    }
     struct coroutine
     {
       llfio::pipe_handle read_pipe, write_pipe;
@@ -314,17 +563,32 @@ static inline void TestCoroutinedPipeHandle()
       {
         coroutines[n].write_pipe.write(0, {{(llfio::byte *) &i, sizeof(i)}}).value();
       }
-      // Take a copy of all pending i/o
-      for(;;)
+      count += i;
+      // Pump completions until every coroutine has seen this write, or five seconds pass
+      for(auto begin = std::chrono::steady_clock::now(); std::chrono::steady_clock::now() - begin < std::chrono::seconds(5);)
       {
-        // Have the kernel tell me when an i/o completion is ready
-        auto r = multiplexer->check_for_any_completed_io();
-        if(r.value().initiated_ios_completed == 0)
+        bool all_received = true;
+        for(size_t n = 0; n < MAX_PIPES; n++)
+        {
+          if(coroutines[n].received_for != count)
+          {
+            all_received = false;
+            break;
+          }
+        }
+        if(all_received)
         {
           break;
         }
+        // Have the kernel tell me when an i/o completion is ready
+        multiplexer->check_for_any_completed_io(std::chrono::milliseconds(100)).value();
+        while(!resumable.empty())
+        {
+          auto *coroutine_address = resumable.back();
+          resumable.pop_back();
+          llfio::coroutine_handle<>::from_address(coroutine_address).resume();
+        }
       }
-      count += i;
       for(size_t n = 0; n < MAX_PIPES; n++)
       {
         if(coroutines[n].received_for != count)
@@ -353,25 +617,155 @@ static inline void TestCoroutinedPipeHandle()
   };
 #ifdef _WIN32
   std::cout << "\nSingle threaded IOCP, immediate completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(1, false).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(1, false).value());
   std::cout << "\nSingle threaded IOCP, reactor completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(1, true).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(1, true).value());
   std::cout << "\nMultithreaded IOCP, immediate completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(2, false).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(2, false).value());
   std::cout << "\nMultithreaded IOCP, reactor completions:\n";
-  test_multiplexer(llfio::test::multiplexer_win_iocp(2, true).value());
+  test_multiplexer(llfio::multiplexer_win_iocp(2, true).value());
+#elif defined(__linux__)
+  std::cout << "\nSingle threaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(1).value());
+  std::cout << "\nMultithreaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(2).value());
+  std::cout << "\nSingle threaded epoll, resumptions queued by hook:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(1).value(), true);
+  {
+    auto r = llfio::multiplexer_linux_io_uring(1);
+    if(!r)
+    {
+      std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+      return;
+    }
+    std::cout << "\nSingle threaded io_uring:\n";
+    test_multiplexer(std::move(r).value());
+  }
+  std::cout << "\nMultithreaded io_uring:\n";
+  test_multiplexer(llfio::multiplexer_linux_io_uring(2).value());
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+  std::cout << "\nSingle threaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1).value());
+  std::cout << "\nMultithreaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(2).value());
+  std::cout << "\nSingle threaded kqueue, resumptions queued by hook:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1).value(), true);
 #else
 #error Not implemented yet
 #endif
 }
 #endif
+
+#if LLFIO_ENABLE_SENDERS
+static inline void TestSenderedPipeHandle()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  namespace ex = LLFIO_SENDERS_NAMESPACE;
+  namespace exstop = LLFIO_SENDERS_STOP_TOKEN_NAMESPACE;
+  struct outcome_t
+  {
+    bool done{false}, stopped{false};
+    llfio::pipe_handle::io_result<llfio::pipe_handle::buffers_type> result{llfio::errc::invalid_argument};
+  };
+  struct env_t
+  {
+    exstop::inplace_stop_token token;
+    exstop::inplace_stop_token query(exstop::get_stop_token_t /*unused*/) const noexcept { return token; }
+  };
+  struct receiver_t
+  {
+    using receiver_concept = ex::receiver_t;
+    outcome_t *outcome;
+    env_t env;
+    void set_value(llfio::pipe_handle::buffers_type buffers) && noexcept
+    {
+      outcome->result = std::move(buffers);
+      outcome->done = true;
+    }
+    void set_error(llfio::pipe_handle::io_result<llfio::pipe_handle::buffers_type>::error_type error) && noexcept
+    {
+      outcome->result = std::move(error);
+      outcome->done = true;
+    }
+    void set_stopped() && noexcept
+    {
+      outcome->stopped = true;
+      outcome->done = true;
+    }
+    env_t get_env() const noexcept { return env; }
+  };
+  auto test_multiplexer = [](llfio::io_multiplexer_ptr multiplexer) {
+    auto pipes = llfio::pipe_handle::anonymous_pipe(llfio::pipe_handle::caching::reads, llfio::pipe_handle::flag::multiplexable).value();
+    pipes.first.set_multiplexer(multiplexer.get()).value();
+    llfio::byte buffer_[8];
+    llfio::pipe_handle::buffer_type buffer(buffer_, sizeof(buffer_));
+    {
+      // Nothing has been written, so the read completes only after the write
+      outcome_t outcome;
+      exstop::inplace_stop_source stop;
+      auto op = ex::connect(llfio::async_read(pipes.first, llfio::pipe_handle::io_request<llfio::pipe_handle::buffers_type>({&buffer, 1}, 0)), receiver_t{&outcome, {stop.get_token()}});
+      ex::start(op);
+      BOOST_CHECK(!outcome.done);
+      pipes.second.write(0, {{(const llfio::byte *) "hello", 5}}).value();
+      while(!outcome.done)
+      {
+        multiplexer->check_for_any_completed_io(std::chrono::seconds(5)).value();
+      }
+      BOOST_CHECK(!outcome.stopped);
+      BOOST_REQUIRE(outcome.result);
+      BOOST_REQUIRE(outcome.result.value().size() == 1);
+      BOOST_CHECK(outcome.result.value()[0].size() == 5);
+      BOOST_CHECK(0 == memcmp(outcome.result.value()[0].data(), "hello", 5));
+    }
+    {
+      // Requesting stop cancels the read in flight
+      outcome_t outcome;
+      exstop::inplace_stop_source stop;
+      auto op = ex::connect(llfio::async_read(pipes.first, llfio::pipe_handle::io_request<llfio::pipe_handle::buffers_type>({&buffer, 1}, 0)), receiver_t{&outcome, {stop.get_token()}});
+      ex::start(op);
+      BOOST_CHECK(!outcome.done);
+      stop.request_stop();
+      while(!outcome.done)
+      {
+        multiplexer->check_for_any_completed_io(std::chrono::seconds(5)).value();
+      }
+      BOOST_CHECK(outcome.stopped);
+    }
+  };
+#ifdef _WIN32
+  std::cout << "\nSingle threaded IOCP:\n";
+  test_multiplexer(llfio::multiplexer_win_iocp(1).value());
+  std::cout << "\nMultithreaded IOCP:\n";
+  test_multiplexer(llfio::multiplexer_win_iocp(2).value());
+#elif defined(__linux__)
+  std::cout << "\nSingle threaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(1).value());
+  std::cout << "\nMultithreaded epoll:\n";
+  test_multiplexer(llfio::multiplexer_linux_epoll(2).value());
+#elif defined(__FreeBSD__) || defined(__APPLE__)
+  std::cout << "\nSingle threaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(1).value());
+  std::cout << "\nMultithreaded kqueue:\n";
+  test_multiplexer(llfio::multiplexer_bsd_kqueue(2).value());
+#endif
+}
+#endif
 #endif
 
 KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, blocking, "Tests that blocking llfio::pipe_handle works as expected", TestBlockingPipeHandle())
 KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, nonblocking, "Tests that nonblocking llfio::pipe_handle works as expected", TestNonBlockingPipeHandle())
-#if LLFIO_ENABLE_TEST_IO_MULTIPLEXERS
+KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, splice, "Tests that llfio::pipe_handle splicing works as expected", TestSplicePipeHandle())
+KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, drain, "Tests that llfio::pipe_handle buffer sizing and draining works as expected", TestDrainPipeHandle())
+#if defined(_WIN32) || defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
 KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, multiplexed, "Tests that multiplexed llfio::pipe_handle works as expected", TestMultiplexedPipeHandle())
+KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, multiplexed_deadline, "Tests that multiplexed llfio::pipe_handle i/o is cancelled when its deadline passes", TestDeadlinedMultiplexedPipeHandle())
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, multiplexed_budgeted, "Tests that multiplexed llfio::pipe_handle readiness is not lost when max_completions runs out", TestBudgetedMultiplexedPipeHandle())
+#endif
 #if LLFIO_ENABLE_COROUTINES
 KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, coroutined, "Tests that coroutined llfio::pipe_handle works as expected", TestCoroutinedPipeHandle())
 #endif
+#if LLFIO_ENABLE_SENDERS
+KERNELTEST_TEST_KERNEL(integration, llfio, pipe_handle, sendered, "Tests that llfio::pipe_handle i/o senders work as expected", TestSenderedPipeHandle())
+#endif
 #endif
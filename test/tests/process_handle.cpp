@@ -72,8 +72,34 @@ static inline void TestProcessHandle(bool with_redirection) {
   }
 }
 
+static inline void TestProcessHandleBatch()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto myexepath = llfio::process_handle::current().current_path().value();
+  char buffers[4][64];
+  llfio::path_view_component args[4];
+  llfio::process_handle::launch_request reqs[4];
+  for(size_t n = 0; n < 4; n++)
+  {
+    sprintf(buffers[n], "--testchild,%u", (unsigned) n);
+    args[n] = llfio::path_view_component(buffers[n]);
+    reqs[n] = {myexepath, {&args[n], 1}, llfio::process_handle::flag::wait_on_close | llfio::process_handle::flag::no_redirect};
+  }
+  auto children = llfio::process_handle::launch_processes(reqs).value();
+  BOOST_REQUIRE(children.size() == 4);
+  intptr_t exitcodes[4];
+  // The children sleep for three seconds
+  BOOST_CHECK(llfio::process_handle::wait_all(children, exitcodes, std::chrono::milliseconds(0)).error() == llfio::errc::timed_out);
+  llfio::process_handle::wait_all(children, exitcodes).value();
+  for(size_t n = 0; n < 4; n++)
+  {
+    BOOST_CHECK(exitcodes[n] == (intptr_t) n + 1);
+  }
+}
+
 KERNELTEST_TEST_KERNEL(integration, llfio, process_handle, no_redirect, "Tests that llfio::process_handle without redirection works as expected", TestProcessHandle(false))
 KERNELTEST_TEST_KERNEL(integration, llfio, process_handle, redirect, "Tests that llfio::process_handle with redirection works as expected", TestProcessHandle(true))
+KERNELTEST_TEST_KERNEL(integration, llfio, process_handle, batch, "Tests that llfio::process_handle batch launching and waiting works as expected", TestProcessHandleBatch())
 
 int main(int argc, char *argv[])
 {
@@ -100,10 +100,29 @@ static inline void TestReduce()
     std::cout << "Summary: " << summary.types[filesystem::file_type::regular] << " files and " << summary.types[filesystem::file_type::directory] << " directories created of " << summary.size << " bytes, " << summary.allocated << " bytes allocated in " << (summary.directory_blocks+summary.file_blocks) << " blocks with depth of " << summary.max_depth << "." << std::endl;
     BOOST_CHECK(summary.types[filesystem::file_type::regular] + summary.types[filesystem::file_type::directory] == entries_created);
 
-    std::cout << "\nCalling llfio::algorithm::reduce() on that randomised directory tree ..." << std::endl;
-    begin = std::chrono::high_resolution_clock::now();
-    auto entries_removed = algorithm::reduce(std::move(dirhs.front())).value();
-    end = std::chrono::high_resolution_clock::now();
+    size_t entries_removed = 0;
+    if(round % 3 == 2)
+    {
+      std::cout << "\nCalling llfio::algorithm::reduce_detached() on that randomised directory tree ..." << std::endl;
+      begin = std::chrono::high_resolution_clock::now();
+      auto reduced = algorithm::reduce_detached(std::move(dirhs.front()), {}, nullptr, 0, false, 64).value();
+      // The tree must be gone from its former location immediately
+      {
+        log_level_guard g(log_level::fatal);
+        auto r = directory_handle::directory({}, dirhpath);
+        BOOST_CHECK(!r && r.error() == errc::no_such_file_or_directory);
+      }
+      entries_removed = reduced.get().value();
+      end = std::chrono::high_resolution_clock::now();
+    }
+    else
+    {
+      const size_t ops_in_flight = (round % 3 == 1) ? 64 : 1;
+      std::cout << "\nCalling llfio::algorithm::reduce() with " << ops_in_flight << " ops in flight on that randomised directory tree ..." << std::endl;
+      begin = std::chrono::high_resolution_clock::now();
+      entries_removed = algorithm::reduce(std::move(dirhs.front()), nullptr, 0, false, ops_in_flight).value();
+      end = std::chrono::high_resolution_clock::now();
+    }
     // std::cout << entries_removed << " " << entries_created << std::endl;
     BOOST_CHECK(entries_removed == entries_created);
     if(entries_removed != entries_created)
@@ -0,0 +1,90 @@
+/* Integration test kernel for registered buffer pools
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <thread>
+#include <vector>
+
+static inline void TestRegisteredBufferPool()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto test_pool = [](llfio::io_multiplexer *multiplexer) {
+    auto fh = llfio::file_handle::temp_inode({}, llfio::file_handle::mode::write,
+                                             (multiplexer != nullptr) ? llfio::file_handle::flag::multiplexable : llfio::file_handle::flag::none)
+              .value();
+    if(multiplexer != nullptr)
+    {
+      fh.set_multiplexer(multiplexer).value();
+    }
+    auto pool = llfio::registered_buffer_pool::create(fh, 1000, 4).value();
+    BOOST_CHECK(pool->buffer_size() == llfio::utils::page_size());
+    BOOST_CHECK(pool->size() == 4);
+    BOOST_CHECK(pool->available() == 4);
+    // Every buffer is a distinct part of the pool's single registered buffer
+    std::vector<llfio::file_handle::registered_buffer_type> bufs;
+    for(size_t n = 0; n < 4; n++)
+    {
+      bufs.push_back(pool->acquire().value());
+      BOOST_CHECK(bufs.back()->parent == pool->region());
+      BOOST_CHECK(bufs.back()->data() == pool->region()->data() + n * pool->buffer_size());
+    }
+    BOOST_CHECK(pool->acquire().error() == llfio::errc::no_buffer_space);
+    // I/O with buffers from the pool
+    for(size_t n = 0; n < pool->buffer_size(); n++)
+    {
+      (*bufs[0])[n] = (llfio::byte)(n & 0xff);
+    }
+    llfio::file_handle::const_buffer_type wb[] = {{bufs[0]->data(), bufs[0]->size()}};
+    BOOST_CHECK(fh.write(bufs[0], {wb, 0}).value()[0].size() == pool->buffer_size());
+    llfio::file_handle::buffer_type rb[] = {{bufs[1]->data(), bufs[1]->size()}};
+    BOOST_CHECK(fh.read(bufs[1], {rb, 0}).value()[0].size() == pool->buffer_size());
+    BOOST_CHECK(0 == memcmp(bufs[0]->data(), bufs[1]->data(), pool->buffer_size()));
+    // Releasing a buffer, on any thread, returns it to the pool
+    std::thread([&] { bufs.pop_back(); }).join();
+    BOOST_CHECK(pool->available() == 1);
+    bufs.push_back(pool->acquire().value());
+    BOOST_CHECK(bufs.back()->data() == pool->region()->data() + 3 * pool->buffer_size());
+    // Buffers keep the pool alive
+    std::weak_ptr<llfio::registered_buffer_pool> wpool = pool;
+    pool.reset();
+    BOOST_CHECK(!wpool.expired());
+    bufs.clear();
+    BOOST_CHECK(wpool.expired());
+  };
+  std::cout << "\nWithout a multiplexer:\n";
+  test_pool(nullptr);
+#ifdef __linux__
+  auto r = llfio::multiplexer_linux_io_uring(1);
+  if(!r)
+  {
+    std::cout << "\nio_uring is not available on this kernel (" << r.error().message() << "), skipping." << std::endl;
+    return;
+  }
+  std::cout << "\nWith io_uring:\n";
+  test_pool(r.value().get());
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, registered_buffer_pool, works, "Tests that llfio::registered_buffer_pool works as expected", TestRegisteredBufferPool())
@@ -0,0 +1,116 @@
+/* Integration test kernel for algorithm::shared_append_log
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static inline void TestSharedAppendLog()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using shared_append_log = llfio::algorithm::shared_append_log;
+  static constexpr size_t producers = 4, records = 2000;
+  static constexpr llfio::mapped_file_handle::size_type reservation = 64 * 1024 * 1024;
+  auto mh = llfio::mapped_file_handle::mapped_temp_inode(reservation).value();
+  // Grow in small steps so the producers grow the file many times
+  auto log = shared_append_log::open(mh.reopen(reservation).value(), true, 65536).value();
+  BOOST_CHECK(log.begin() == log.end());
+  BOOST_CHECK(shared_append_log::open(mh.reopen(reservation).value()).has_value());
+
+  // Each producer and reader uses its own instance of the log, as if in its own process
+  std::vector<std::thread> threads;
+  for(size_t p = 0; p < producers; p++)
+  {
+    threads.emplace_back([&, p] {
+      auto mylog = shared_append_log::open(mh.reopen(reservation).value()).value();
+      for(size_t n = 0; n < records; n++)
+      {
+        const size_t bytes = 9 + (n * 13) % 500;
+        auto r = mylog.reserve(bytes).value();
+        BOOST_CHECK(r.record.size() == bytes);
+        memset(r.record.data(), (int) p, bytes);
+        memcpy(r.record.data(), &n, sizeof(n));
+        mylog.commit(r);
+      }
+    });
+  }
+  std::vector<size_t> seen(producers);
+  bool ok = true;
+  std::thread reader([&] {
+    auto mylog = shared_append_log::open(mh.reopen(reservation).value()).value();
+    auto cursor = mylog.begin();
+    for(size_t n = 0; n < producers * records; n++)
+    {
+      auto r = mylog.read(cursor, std::chrono::seconds(30));
+      if(!r)
+      {
+        ok = false;
+        return;
+      }
+      const auto record = r.value();
+      const auto p = (size_t) record[record.size() - 1];
+      size_t idx;
+      memcpy(&idx, record.data(), sizeof(idx));
+      // The records of each producer are read in the order it appended them
+      if(p >= producers || idx != seen[p]++ || record.size() != 9 + (idx * 13) % 500)
+      {
+        ok = false;
+        return;
+      }
+    }
+  });
+  for(auto &t : threads)
+  {
+    t.join();
+  }
+  reader.join();
+  BOOST_CHECK(ok);
+  for(auto i : seen)
+  {
+    BOOST_CHECK(i == records);
+  }
+
+  // Reading beyond the last record times out, and an append wakes a reader
+  auto cursor = log.begin();
+  for(size_t n = 0; n < producers * records; n++)
+  {
+    log.read(cursor).value();
+  }
+  BOOST_CHECK(cursor == log.end());
+  BOOST_CHECK(log.read(cursor, std::chrono::milliseconds(10)).error() == llfio::errc::timed_out);
+  std::thread appender([&] {
+    auto mylog = shared_append_log::open(mh.reopen(reservation).value()).value();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const char hello[] = "hello";
+    mylog.append({(const llfio::byte *) hello, 5}).value();
+  });
+  auto last = log.read(cursor, std::chrono::seconds(30)).value();
+  appender.join();
+  BOOST_CHECK(last.size() == 5 && 0 == memcmp(last.data(), "hello", 5));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, shared_append_log, "Tests that llfio::algorithm::shared_append_log works as expected", TestSharedAppendLog())
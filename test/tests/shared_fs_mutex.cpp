@@ -287,7 +287,9 @@ struct shared_memory
     byte_ranges,
     safe_byte_ranges,
     lock_files,
-    memory_map
+    memory_map,
+    reader_biased,
+    leases
   } mutex_kind;
   enum test_type
   {
@@ -350,6 +352,12 @@ static std::string _TestSharedFSMutexCorrectnessChildWorker(KERNELTEST_V1_NAMESP
   case shared_memory::mutex_kind_type::memory_map:
     lock = std::make_unique<llfio::algorithm::shared_fs_mutex::memory_map<>>(llfio::algorithm::shared_fs_mutex::memory_map<>::fs_mutex_map({}, "lockfile").value());
     break;
+  case shared_memory::mutex_kind_type::reader_biased:
+    lock = std::make_unique<llfio::algorithm::shared_fs_mutex::reader_biased<>>(llfio::algorithm::shared_fs_mutex::reader_biased<>::fs_mutex_reader_biased({}, "lockfile").value());
+    break;
+  case shared_memory::mutex_kind_type::leases:
+    lock = std::make_unique<llfio::algorithm::shared_fs_mutex::leases<>>(llfio::algorithm::shared_fs_mutex::leases<>::fs_mutex_leases({}, "leasefile", std::chrono::seconds(1)).value());
+    break;
   }
   ++shmem->current_shared;
   while(0 != shmem->current_shared)
@@ -475,6 +483,13 @@ KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_memory_map, exclusive
 KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_memory_map, shared, "Tests that llfio::algorithm::shared_fs_mutex::memory_map implementation implements shared locking", [] { TestSharedFSMutexCorrectness(shared_memory::memory_map, shared_memory::shared, false); }())
 KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_memory_map, both, "Tests that llfio::algorithm::shared_fs_mutex::memory_map implementation implements a mixture of exclusive and shared locking", [] { TestSharedFSMutexCorrectness(shared_memory::memory_map, shared_memory::both, false); }())
 
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_reader_biased, exclusives, "Tests that llfio::algorithm::shared_fs_mutex::reader_biased implementation implements exclusive locking", [] { TestSharedFSMutexCorrectness(shared_memory::reader_biased, shared_memory::exclusive, false); }())
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_reader_biased, shared, "Tests that llfio::algorithm::shared_fs_mutex::reader_biased implementation implements shared locking", [] { TestSharedFSMutexCorrectness(shared_memory::reader_biased, shared_memory::shared, false); }())
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_reader_biased, both, "Tests that llfio::algorithm::shared_fs_mutex::reader_biased implementation implements a mixture of exclusive and shared locking", [] { TestSharedFSMutexCorrectness(shared_memory::reader_biased, shared_memory::both, false); }())
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_leases, exclusives, "Tests that llfio::algorithm::shared_fs_mutex::leases implementation implements exclusive locking", [] { TestSharedFSMutexCorrectness(shared_memory::leases, shared_memory::exclusive, false); }())
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_leases, shared, "Tests that llfio::algorithm::shared_fs_mutex::leases implementation implements shared locking", [] { TestSharedFSMutexCorrectness(shared_memory::leases, shared_memory::shared, false); }())
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_leases, both, "Tests that llfio::algorithm::shared_fs_mutex::leases implementation implements a mixture of exclusive and shared locking", [] { TestSharedFSMutexCorrectness(shared_memory::leases, shared_memory::both, false); }())
+
 KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_safe_byte_ranges_process, exclusives, "Tests that llfio::algorithm::shared_fs_mutex::safe_byte_ranges implementation implements exclusive locking with processes", [] { TestSharedFSMutexCorrectness(shared_memory::memory_map, shared_memory::exclusive, false); }())
 KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_safe_byte_ranges_process, shared, "Tests that llfio::algorithm::shared_fs_mutex::safe_byte_ranges implementation implements shared locking with processes", [] { TestSharedFSMutexCorrectness(shared_memory::memory_map, shared_memory::shared, false); }())
 KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_safe_byte_ranges_process, both, "Tests that llfio::algorithm::shared_fs_mutex::safe_byte_ranges implementation implements a mixture of exclusive and shared locking with processes",
@@ -562,6 +577,12 @@ static auto TestSharedFSMutexConstructDestructChildWorker = KERNELTEST_V1_NAMESP
   case shared_memory::mutex_kind_type::memory_map:
     lock = std::make_unique<llfio::algorithm::shared_fs_mutex::memory_map<>>(llfio::algorithm::shared_fs_mutex::memory_map<>::fs_mutex_map({}, "lockfile").value());
     break;
+  case shared_memory::mutex_kind_type::reader_biased:
+    lock = std::make_unique<llfio::algorithm::shared_fs_mutex::reader_biased<>>(llfio::algorithm::shared_fs_mutex::reader_biased<>::fs_mutex_reader_biased({}, "lockfile").value());
+    break;
+  case shared_memory::mutex_kind_type::leases:
+    lock = std::make_unique<llfio::algorithm::shared_fs_mutex::leases<>>(llfio::algorithm::shared_fs_mutex::leases<>::fs_mutex_leases({}, "leasefile", std::chrono::seconds(1)).value());
+    break;
   }
   // Take a shared lock of a different entity
   auto h = lock->lock(llfio::algorithm::shared_fs_mutex::shared_fs_mutex::entity_type(1, false)).value();
@@ -569,6 +590,66 @@ static auto TestSharedFSMutexConstructDestructChildWorker = KERNELTEST_V1_NAMESP
 });
 
 KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_memory_map, construct_destruct, "Tests that llfio::algorithm::shared_fs_mutex::memory_map constructor and destructor are race free", [] { TestSharedFSMutexConstructDestruct(shared_memory::memory_map); }())
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_reader_biased, construct_destruct, "Tests that llfio::algorithm::shared_fs_mutex::reader_biased constructor and destructor are race free", [] { TestSharedFSMutexConstructDestruct(shared_memory::reader_biased); }())
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_leases, construct_destruct, "Tests that llfio::algorithm::shared_fs_mutex::leases constructor and destructor are race free", [] { TestSharedFSMutexConstructDestruct(shared_memory::leases); }())
+
+static void TestSharedFSMutexContentionStatistics()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using entity_type = llfio::algorithm::shared_fs_mutex::shared_fs_mutex::entity_type;
+  llfio::algorithm::shared_fs_mutex::shared_fs_mutex::contention_statistics stats;
+  auto a = llfio::algorithm::shared_fs_mutex::memory_map<>::fs_mutex_map({}, "lockfile").value();
+  BOOST_CHECK(a.contention_statistics_block() == nullptr);
+  a.set_contention_statistics(&stats);
+  {
+    // memory_map locks are not recursive, so this instance contends with itself
+    auto h = a.lock(entity_type(78, true)).value();
+    BOOST_CHECK(!a.try_lock(entity_type(78, true)));
+    BOOST_CHECK(!a.try_lock(entity_type(78, false)));
+  }
+  BOOST_CHECK(stats.acquisitions.load() == 1);
+  BOOST_CHECK(stats.failed_acquisitions.load() == 2);
+  BOOST_CHECK(stats.failed_attempts.load() == 2);
+  uint64_t waits = 0;
+  for(auto &i : stats.wait_histogram)
+  {
+    waits += i.load();
+  }
+  BOOST_CHECK(waits == 1);
+  // The first failed attempt is always sampled
+  BOOST_CHECK(stats.hot_entities[0].count.load() == 1);
+  stats.reset();
+  BOOST_CHECK(stats.failed_attempts.load() == 0);
+  BOOST_CHECK(stats.hot_entities[0].count.load() == 0);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex, contention_statistics, "Tests that llfio::algorithm::shared_fs_mutex::contention_statistics counts contention", TestSharedFSMutexContentionStatistics())
+
+static void TestSharedFSMutexLeases()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using entity_type = llfio::algorithm::shared_fs_mutex::shared_fs_mutex::entity_type;
+  using leases = llfio::algorithm::shared_fs_mutex::leases<>;
+  auto a = leases::fs_mutex_leases({}, "leasefile2", std::chrono::milliseconds(200)).value();
+  auto b = leases::fs_mutex_leases({}, "leasefile2", std::chrono::milliseconds(200)).value();
+  {
+    auto h = a.lock(entity_type(78, true)).value();
+    BOOST_CHECK(!b.try_lock(entity_type(78, false)));
+    // Other entities are unaffected
+    BOOST_CHECK(b.try_lock(entity_type(79, true)));
+  }
+  // a still holds the lease after unlocking
+  BOOST_CHECK(!b.try_lock(entity_type(78, true)));
+  BOOST_CHECK(a.try_lock(entity_type(78, false)));
+  a.release_leases().value();
+  BOOST_CHECK(b.try_lock(entity_type(78, true)));
+  // Once b's lease expires, a reclaims it
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  BOOST_CHECK(a.try_lock(entity_type(78, true)));
+  BOOST_CHECK(!b.try_lock(entity_type(78, false)));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, shared_fs_mutex_leases, leases, "Tests that llfio::algorithm::shared_fs_mutex::leases caches, releases and reclaims leases", TestSharedFSMutexLeases())
 
 
 /*
@@ -0,0 +1,139 @@
+/* Integration test kernel for algorithm::shared_mpmc_queue
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static inline void TestSharedMPMCQueue()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  struct item
+  {
+    uint32_t producer, sequence;
+  };
+  using queue_type = llfio::algorithm::shared_mpmc_queue<item>;
+  BOOST_CHECK(queue_type::create(0).has_error());
+  auto q = queue_type::create(100).value();
+  BOOST_REQUIRE(q.capacity() == 128);
+  BOOST_CHECK(q.empty());
+  item v{0, 0};
+  BOOST_CHECK(!q.try_pop(v));
+  BOOST_CHECK(q.pop(v, std::chrono::milliseconds(10)).error() == llfio::errc::timed_out);
+  for(uint32_t n = 0; n < q.capacity(); n++)
+  {
+    BOOST_REQUIRE(q.try_push({0, n}));
+  }
+  BOOST_CHECK(q.size() == q.capacity());
+  BOOST_CHECK(!q.try_push({0, 0}));
+  BOOST_CHECK(q.push({0, 0}, std::chrono::milliseconds(10)).error() == llfio::errc::timed_out);
+  for(uint32_t n = 0; n < q.capacity(); n++)
+  {
+    BOOST_REQUIRE(q.try_pop(v));
+    BOOST_CHECK(v.sequence == n);
+  }
+  BOOST_CHECK(q.empty());
+
+  // Many producers and consumers blocking upon a small queue. Every item must be popped exactly
+  // once, and each consumer must see each producer's items in the order they were pushed.
+  static constexpr uint32_t producers = 4, consumers = 4, items = 50000;
+  auto q2 = queue_type::create(16).value();
+  std::vector<std::atomic<uint32_t>> seen(producers * items);
+  std::atomic<bool> in_order{true};
+  std::vector<std::thread> threads;
+  for(uint32_t p = 0; p < producers; p++)
+  {
+    threads.emplace_back([&, p] {
+      for(uint32_t n = 0; n < items; n++)
+      {
+        q2.push({p, n}, {}).value();
+      }
+    });
+  }
+  for(uint32_t c = 0; c < consumers; c++)
+  {
+    threads.emplace_back([&] {
+      std::vector<int64_t> last(producers, -1);
+      for(uint32_t n = 0; n < producers * items / consumers; n++)
+      {
+        item i{0, 0};
+        q2.pop(i, std::chrono::seconds(30)).value();
+        if((int64_t) i.sequence <= last[i.producer])
+        {
+          in_order = false;
+        }
+        last[i.producer] = i.sequence;
+        seen[i.producer * items + i.sequence].fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+  }
+  for(auto &t : threads)
+  {
+    t.join();
+  }
+  BOOST_CHECK(in_order);
+  bool exactly_once = true;
+  for(auto &i : seen)
+  {
+    exactly_once = exactly_once && i.load() == 1;
+  }
+  BOOST_CHECK(exactly_once);
+  BOOST_CHECK(q2.empty());
+}
+
+static inline void TestSharedMPMCQueueFile()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using queue_type = llfio::algorithm::shared_mpmc_queue<uint64_t>;
+  auto fh = llfio::file_handle::temp_file({}, llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed, llfio::file_handle::caching::temporary,
+                                          llfio::file_handle::flag::unlink_on_first_close)
+            .value();
+  // Attaching before creation fails
+  BOOST_CHECK(queue_type::open(fh.reopen().value()).has_error());
+  auto fh2 = fh.reopen().value();
+  auto fh3 = fh.reopen().value();
+  auto producer = queue_type::open(std::move(fh), 8).value();
+  auto consumer = queue_type::open(std::move(fh2)).value();
+  BOOST_CHECK(consumer.capacity() == producer.capacity());
+  // A queue of a different type is refused
+  BOOST_CHECK(llfio::algorithm::shared_mpmc_queue<uint32_t>::open(std::move(fh3)).error() == llfio::errc::invalid_argument);
+  BOOST_CHECK(producer.try_push(78));
+  uint64_t v = 0;
+  BOOST_REQUIRE(consumer.try_pop(v));
+  BOOST_CHECK(v == 78);
+  // Moving keeps the queue working
+  auto consumer2 = std::move(consumer);
+  BOOST_CHECK(!consumer.is_valid());
+  BOOST_CHECK(producer.try_push(79));
+  BOOST_REQUIRE(consumer2.try_pop(v));
+  BOOST_CHECK(v == 79);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, shared_mpmc_queue, "Tests that llfio::algorithm::shared_mpmc_queue works as expected", TestSharedMPMCQueue())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, shared_mpmc_queue_file, "Tests that llfio::algorithm::shared_mpmc_queue can be shared through a file",
+                       TestSharedMPMCQueueFile())
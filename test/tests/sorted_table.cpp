@@ -0,0 +1,94 @@
+/* Integration test kernel for algorithm::sorted_table
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+template <class Key> static inline void TestSortedTableWith(size_t count)
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_inode().value();
+  {
+    llfio::algorithm::sorted_table_builder<Key> builder(fh, 4096);
+    for(size_t n = 0; n < count; n++)
+    {
+      // Every third key is absent, and the values vary in length
+      const auto value = std::to_string(n * 3);
+      builder.add((Key)(n * 3 + 1), {(const llfio::byte *) value.data(), value.size()}).value();
+    }
+    // Keys must ascend
+    if(count > 0)
+    {
+      BOOST_CHECK(builder.add((Key) 1, {}).has_error());
+    }
+    builder.finish().value();
+    BOOST_CHECK(builder.add((Key) -1, {}).has_error());
+  }
+  auto table = llfio::algorithm::sorted_table<Key>::open(fh).value();
+  BOOST_REQUIRE(table.size() == count);
+  bool ok = true;
+  for(size_t n = 0; n < count; n++)
+  {
+    const auto value = std::to_string(n * 3);
+    auto found = table.lookup((Key)(n * 3 + 1));
+    ok = ok && found && found->size() == value.size() && 0 == memcmp(found->data(), value.data(), value.size());
+    ok = ok && !table.find((Key)(n * 3)) && !table.find((Key)(n * 3 + 2));
+    ok = ok && table.lower_bound((Key)(n * 3)) == n && table.lower_bound((Key)(n * 3 + 2)) == n + 1;
+    ok = ok && table.key(n) == (Key)(n * 3 + 1);
+  }
+  BOOST_CHECK(ok);
+  BOOST_CHECK(!table.find((Key) -1));
+  BOOST_CHECK(table.lower_bound((Key) -1) == count);
+  // Moving keeps the table working
+  auto table2 = std::move(table);
+  BOOST_CHECK(!table.is_valid());
+  BOOST_CHECK(count == 0 || table2.find((Key) 1));
+}
+
+static inline void TestSortedTable()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  TestSortedTableWith<uint64_t>(0);
+  TestSortedTableWith<uint64_t>(1);
+  TestSortedTableWith<uint64_t>(100000);
+  TestSortedTableWith<uint32_t>(12345);
+  TestSortedTableWith<uint16_t>(20000);
+  // Anything else is refused
+  auto fh = llfio::file_handle::temp_inode().value();
+  BOOST_CHECK(llfio::algorithm::sorted_table<uint64_t>::open(fh).error() == llfio::errc::illegal_byte_sequence);
+  {
+    llfio::algorithm::sorted_table_builder<uint32_t> builder(fh);
+    builder.add(5, {}).value();
+    builder.finish().value();
+  }
+  BOOST_CHECK(llfio::algorithm::sorted_table<uint64_t>::open(fh).error() == llfio::errc::illegal_byte_sequence);
+  BOOST_CHECK(llfio::algorithm::sorted_table<uint32_t>::open(fh).value().find(5));
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, sorted_table, "Tests that llfio::algorithm::sorted_table works as expected", TestSortedTable())
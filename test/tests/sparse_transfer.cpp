@@ -0,0 +1,83 @@
+/* Integration test kernel for algorithm::send_sparse() and receive_sparse()
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <cstring>
+#include <future>
+#include <vector>
+
+static inline void TestSparseTransfer()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  static constexpr llfio::file_handle::extent_type length = 64 * 1024 * 1024, chunk = 1024 * 1024;
+  auto src = llfio::file_handle::temp_inode().value();
+  src.truncate(length).value();
+  std::vector<llfio::byte> data(chunk), zeros(chunk);
+  for(size_t n = 0; n < data.size(); n++)
+  {
+    data[n] = (llfio::byte)((n % 251) + 1);
+  }
+  // Three regions of data with holes between, and an allocated region of zeros
+  src.write(0, {{data.data(), data.size()}}).value();
+  src.write(20 * chunk + 4096, {{data.data(), data.size()}}).value();
+  src.write(30 * chunk, {{zeros.data(), zeros.size()}}).value();
+  src.write(length - 8192, {{data.data(), 8192}}).value();
+
+  auto pipes = llfio::pipe_handle::anonymous_pipe().value();
+  auto sender = std::async(std::launch::async, [&] { return llfio::algorithm::send_sparse(src, pipes.second); });
+  auto dest = llfio::file_handle::temp_inode().value();
+  // Existing content of the destination is replaced
+  dest.write(0, {{zeros.data(), 4096}}).value();
+  auto received = llfio::algorithm::receive_sparse(pipes.first, dest).value();
+  auto sent = sender.get().value();
+  BOOST_CHECK(sent.length == length);
+  BOOST_CHECK(received.length == length);
+  BOOST_CHECK(sent.frames == received.frames);
+  BOOST_CHECK(sent.data_bytes == received.data_bytes);
+  // Only the data was transferred, whether or not the filing system supports holes
+  BOOST_CHECK(sent.data_bytes == 2 * chunk + 8192);
+  BOOST_CHECK(received.hole_bytes == length - received.data_bytes);
+
+  BOOST_REQUIRE(dest.maximum_extent().value() == length);
+  std::vector<llfio::byte> a(chunk), b(chunk);
+  bool equal = true;
+  for(llfio::file_handle::extent_type offset = 0; offset < length; offset += chunk)
+  {
+    BOOST_REQUIRE(src.read(offset, {{a.data(), a.size()}}).value() == chunk);
+    BOOST_REQUIRE(dest.read(offset, {{b.data(), b.size()}}).value() == chunk);
+    equal = equal && 0 == memcmp(a.data(), b.data(), chunk);
+  }
+  BOOST_CHECK(equal);
+
+  // A malformed stream is rejected
+  auto pipes2 = llfio::pipe_handle::anonymous_pipe().value();
+  pipes2.second.write(0, {{(const llfio::byte *) "NOTSPARSE0000000", 16}}).value();
+  BOOST_CHECK(llfio::algorithm::receive_sparse(pipes2.first, dest).error() == llfio::errc::illegal_byte_sequence);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, sparse_transfer, "Tests that llfio::algorithm::send_sparse() and receive_sparse() work as expected",
+                       TestSparseTransfer())
@@ -0,0 +1,72 @@
+/* Integration test kernel for stat_t::fill_many()
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <string>
+#include <vector>
+
+static inline void TestStatFillMany()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using want = llfio::stat_t::want;
+  static constexpr size_t count = 300;  // more than one io_uring batch
+  auto dh = llfio::directory_handle::temp_directory().value();
+  std::vector<std::string> leafnames;
+  for(size_t n = 0; n < count; n++)
+  {
+    leafnames.push_back(std::to_string(n));
+    auto fh = llfio::file_handle::file(dh, leafnames.back(), llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+    fh.truncate(n).value();
+  }
+  std::vector<llfio::stat_t::fill_many_item> items;
+  for(size_t n = 0; n < count; n++)
+  {
+    items.emplace_back(leafnames[n], (n & 1) ? (want::size | want::type) : want::mtim);
+  }
+  items.emplace_back("doesnotexist", want::size);
+  llfio::stat_t::fill_many(dh, items).value();
+  for(size_t n = 0; n < count; n++)
+  {
+    auto &item = items[n];
+    BOOST_REQUIRE(item.filled);
+    if(n & 1)
+    {
+      BOOST_CHECK(item.filled.value() >= 2);
+      BOOST_CHECK(item.stat.st_type == llfio::filesystem::file_type::regular);
+      BOOST_CHECK(item.stat.st_size == (llfio::file_handle::extent_type) n);
+    }
+    else
+    {
+      BOOST_CHECK(item.filled.value() >= 1);
+      BOOST_CHECK(item.stat.st_mtim != std::chrono::system_clock::time_point());
+      BOOST_CHECK(item.stat.st_size == 0);  // not wanted, so left zeroed
+    }
+  }
+  BOOST_CHECK(!items.back().filled);
+  BOOST_CHECK(items.back().filled.error() == llfio::errc::no_such_file_or_directory);
+  llfio::algorithm::reduce(std::move(dh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, stat, fill_many, "Tests that stat_t::fill_many() works as expected", TestStatFillMany())
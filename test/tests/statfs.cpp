@@ -0,0 +1,56 @@
+/* Integration test kernel for statfs_t
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestStatfsBytesAvailable()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using want = llfio::statfs_t::want;
+  auto fh = llfio::file_handle::temp_file().value();
+  llfio::statfs_t full;
+  full.fill(fh).value();
+  // A second fill finds the mount table entry cached
+  llfio::statfs_t again;
+  again.fill(fh, want::fstypename | want::mntfromname | want::mntonname).value();
+  BOOST_CHECK(again.f_fstypename == full.f_fstypename);
+  BOOST_CHECK(again.f_mntfromname == full.f_mntfromname);
+  BOOST_CHECK(again.f_mntonname == full.f_mntonname);
+
+  llfio::statfs_t space;
+  const auto bytes = space.bytes_available(fh).value();
+  BOOST_CHECK(bytes == space.f_bavail * space.f_bsize);
+  BOOST_CHECK(space.f_space_filled != std::chrono::steady_clock::time_point());
+  // Within the staleness bound, no refresh happens
+  const auto filled = space.f_space_filled;
+  space.f_bavail = 1;
+  BOOST_CHECK(space.bytes_available(fh, std::chrono::hours(1)).value() == space.f_bsize);
+  BOOST_CHECK(space.f_space_filled == filled);
+  // Without one, a refresh always happens
+  BOOST_CHECK(space.bytes_available(fh).value() == space.f_bavail * space.f_bsize);
+  BOOST_CHECK(space.f_space_filled >= filled);
+  BOOST_CHECK(space.f_mntonname.empty());  // only the space items are filled
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, statfs, bytes_available, "Tests that statfs_t::bytes_available() works as expected", TestStatfsBytesAvailable())
@@ -0,0 +1,87 @@
+/* Integration test kernel for statically dispatched i/o handles
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestStaticIoHandleWorks()
+{
+  static constexpr size_t testbytes = 65536;
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  static_io_handle<mapped_file_handle> h(mapped_file_handle::mapped_temp_inode().value());
+  h.truncate(testbytes).value();
+  std::vector<byte> out(testbytes), in(testbytes);
+  for(size_t n = 0; n < testbytes; n++)
+  {
+    out[n] = (byte) (n * 7);
+  }
+  BOOST_CHECK(h.write(0, {{out.data(), out.size()}}).value() == testbytes);
+  BOOST_CHECK(h.barrier().has_value());
+  BOOST_CHECK(h.read(0, {{in.data(), in.size()}}).value() == testbytes);
+  BOOST_CHECK(in == out);
+
+  // Virtual dispatch through the base must see the same contents
+  io_handle &base = h;
+  memset(in.data(), 0, in.size());
+  BOOST_CHECK(base.read(0, {{in.data(), in.size()}}).value() == testbytes);
+  BOOST_CHECK(in == out);
+
+  // Moves must preserve the handle
+  static_io_handle<mapped_file_handle> h2(std::move(h));
+  BOOST_CHECK(!h.is_valid());
+  BOOST_CHECK(h2.is_valid());
+  memset(in.data(), 0, in.size());
+  BOOST_CHECK(h2.read(0, {{in.data(), in.size()}}).value() == testbytes);
+  BOOST_CHECK(in == out);
+}
+
+static inline void TestStaticIoHandleAdapterStack()
+{
+  static constexpr size_t testbytes = 1024 * 1024UL;
+  using namespace LLFIO_V2_NAMESPACE;
+  using LLFIO_V2_NAMESPACE::byte;
+  using target_type = static_io_handle<mapped_file_handle>;
+  using source_type = static_io_handle<fast_random_file_handle>;
+  source_type h1(fast_random_file_handle::fast_random_file(testbytes).value());
+  target_type h2(mapped_file_handle::mapped_temp_inode().value());
+  // Make temp inode have same contents as random file
+  h2.truncate(testbytes).value();
+  h1.read(0, {{h2.address(), testbytes}}).value();
+
+  static_io_handle<algorithm::xor_handle_adapter<target_type, source_type>> h(&h2, &h1);
+  BOOST_CHECK(h.maximum_extent().value() == testbytes);
+
+  // Read the whole of the XOR handle adapter, it should return all bits zero
+  mapped<byte> tempbuffer(testbytes);
+  BOOST_CHECK(h.read(0, {{tempbuffer.data(), tempbuffer.size()}}).value() == testbytes);
+  for(size_t n = 0; n < testbytes / 8; n++)
+  {
+    uint64_t *p = (uint64_t *) tempbuffer.data();
+    BOOST_CHECK(p[n] == 0);
+  }
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, static_io_handle, works, "Tests that static_io_handle reads, writes and barriers", TestStaticIoHandleWorks())
+KERNELTEST_TEST_KERNEL(integration, llfio, static_io_handle, adapters, "Tests that a stack of statically dispatched handle adapters works", TestStaticIoHandleAdapterStack())
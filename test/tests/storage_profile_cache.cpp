@@ -0,0 +1,157 @@
+/* Integration test kernel for persisted storage profiles
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#include "../test_kernel_decl.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+static inline void TestStorageProfileCache()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  namespace sp = llfio::storage_profile;
+  sp::storage_profile profile;
+  profile.os_name.value = "Some OS";
+  profile.cpu_physical_cores.value = 8;
+  profile.mem_in_use.value = 0.5f;
+  profile.atomic_rewrite_quantum.value = 4096;
+  profile.read_qd1_99999.value = 123456;
+
+  // What is written can be read back
+  {
+    std::stringstream ss;
+    profile.write(ss);
+    sp::storage_profile check;
+    check.read(ss);
+    BOOST_CHECK(check.os_name.value == "Some OS");
+    BOOST_CHECK(check.cpu_physical_cores.value == 8);
+    BOOST_CHECK(check.mem_in_use.value == 0.5f);
+    BOOST_CHECK(check.atomic_rewrite_quantum.value == 4096);
+    BOOST_CHECK(check.read_qd1_99999.value == 123456);
+    BOOST_CHECK(check.read_qd1_mean.value == sp::default_value<unsigned long long>());
+  }
+
+  // What is written in binary can be used without parsing, and read back
+  {
+    std::stringstream ss;
+    profile.write_binary(ss, "host1");
+    const std::string bytes(ss.str());
+    BOOST_CHECK(bytes.size() % 8 == 0);
+    std::vector<uint64_t> aligned(bytes.size() / 8 + 1);
+    memcpy(aligned.data(), bytes.data(), bytes.size());
+    const llfio::span<const llfio::byte> data(reinterpret_cast<const llfio::byte *>(aligned.data()), bytes.size());
+    BOOST_CHECK(sp::binary_profile::view(data.subspan(1)).error() == llfio::errc::invalid_argument);
+    BOOST_CHECK(sp::binary_profile::view(data.first(data.size() - 8)).error() == llfio::errc::illegal_byte_sequence);
+    auto bp = sp::binary_profile::view(data).value();
+    BOOST_CHECK(bp.label() == "host1");
+    BOOST_CHECK(bp.items().size() == 5);
+    BOOST_CHECK(bp.string_value("system:os:name") == "Some OS");
+    BOOST_CHECK(bp.value<unsigned>("system:cpu:physical_cores") == 8);
+    BOOST_CHECK(bp.value<float>("system:mem:in_use") == 0.5f);
+    BOOST_CHECK(bp.value<llfio::handle::extent_type>("concurrency:atomic_rewrite_quantum") == 4096);
+    BOOST_CHECK(bp.value<float>("system:cpu:physical_cores") == sp::default_value<float>());
+    BOOST_CHECK(bp.value<unsigned long long>("no:such:item") == sp::default_value<unsigned long long>());
+    sp::storage_profile check;
+    check.read(bp);
+    BOOST_CHECK(check.os_name.value == "Some OS");
+    BOOST_CHECK(check.cpu_physical_cores.value == 8);
+    BOOST_CHECK(check.mem_in_use.value == 0.5f);
+    BOOST_CHECK(check.atomic_rewrite_quantum.value == 4096);
+    BOOST_CHECK(check.read_qd1_99999.value == 123456);
+    BOOST_CHECK(check.read_qd1_mean.value == sp::default_value<unsigned long long>());
+    sp::storage_profile check2;
+    check2.read(bp, std::regex("system:.*"));
+    BOOST_CHECK(check2.os_name.value == "Some OS");
+    BOOST_CHECK(check2.atomic_rewrite_quantum.value == sp::default_value<llfio::handle::extent_type>());
+
+    // Profiles of many hosts export as a table with a column per item
+    sp::storage_profile other;
+    other.cpu_physical_cores.value = 16;
+    other.device_name.value = "A \"quoted\" name";
+    std::stringstream ss2;
+    other.write_binary(ss2, "host2");
+    const std::string bytes2(ss2.str());
+    std::vector<uint64_t> aligned2(bytes2.size() / 8 + 1);
+    memcpy(aligned2.data(), bytes2.data(), bytes2.size());
+    std::vector<sp::binary_profile> profiles;
+    profiles.push_back(std::move(bp));
+    profiles.push_back(sp::binary_profile::view({reinterpret_cast<const llfio::byte *>(aligned2.data()), bytes2.size()}).value());
+    std::stringstream csv;
+    sp::write_csv(csv, profiles);
+    std::cout << csv.str();
+    std::string line;
+    std::getline(csv, line);
+    BOOST_CHECK(line == "label,\"concurrency:atomic_rewrite_quantum\",\"latency:read:qd1:99.999%\",\"storage:device:name\",\"system:cpu:physical_cores\",\"system:mem:in_use\",\"system:os:name\"");
+    std::getline(csv, line);
+    BOOST_CHECK(line == "\"host1\",4096,123456,,8,0.5,\"Some OS\"");
+    std::getline(csv, line);
+    BOOST_CHECK(line == "\"host2\",,,\"A \"\"quoted\"\" name\",16,,");
+  }
+
+  // Keep the user's cache untouched
+  auto cachedir = llfio::filesystem::temp_directory_path() / ("llfio_storage_profile_cache_" + llfio::utils::random_string(8));
+#ifdef _WIN32
+  _putenv_s("LLFIO_STORAGE_PROFILE_CACHE", cachedir.string().c_str());
+#else
+  setenv("LLFIO_STORAGE_PROFILE_CACHE", cachedir.c_str(), 1);
+#endif
+  BOOST_CHECK(sp::cache_directory().value() == cachedir);
+  auto fh = llfio::file_handle::temp_file().value();
+  auto key = sp::device_key(fh).value();
+  std::cout << "Device key is '" << key << "'" << std::endl;
+  BOOST_CHECK(!key.empty());
+  {
+    sp::storage_profile loaded;
+    BOOST_CHECK(sp::load_cached(loaded, fh).error() == llfio::errc::no_such_file_or_directory);
+    BOOST_CHECK(sp::map_cached(fh).error() == llfio::errc::no_such_file_or_directory);
+  }
+  sp::save_cached(profile, fh).value();
+  {
+    // A binary profile is cached alongside
+    auto bp = sp::map_cached(fh).value();
+    BOOST_CHECK(bp.label() == key);
+    BOOST_CHECK(bp.value<unsigned>("system:cpu:physical_cores") == 8);
+  }
+  {
+    // Only the matching items are loaded
+    sp::storage_profile loaded;
+    sp::load_cached(loaded, fh, std::regex("system:.*")).value();
+    BOOST_CHECK(loaded.os_name.value == "Some OS");
+    BOOST_CHECK(loaded.cpu_physical_cores.value == 8);
+    BOOST_CHECK(loaded.atomic_rewrite_quantum.value == sp::default_value<llfio::handle::extent_type>());
+  }
+  // Saving again replaces the cached profile
+  profile.read_qd1_99999.value = 654321;
+  sp::save_cached(profile, fh).value();
+  {
+    sp::storage_profile loaded;
+    sp::load_cached(loaded, fh).value();
+    BOOST_CHECK(loaded.read_qd1_99999.value == 654321);
+    BOOST_CHECK(sp::map_cached(fh).value().value<unsigned long long>("latency:read:qd1:99.999%") == 654321);
+  }
+  llfio::filesystem::remove_all(cachedir);
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, storage_profile, cache, "Tests that storage profiles are cached per device as expected", TestStorageProfileCache())
@@ -0,0 +1,57 @@
+/* Integration test kernel for choosing between mapped and plain reads from a storage profile
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+static inline void TestStorageProfileMappedReads()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  namespace sp = llfio::storage_profile;
+  {
+    auto fh = llfio::file_handle::file({}, "storage_profile_mapped_reads.bin", llfio::file_handle::mode::write, llfio::file_handle::creation::if_needed).value();
+    fh.truncate(1024 * 1024).value();
+  }
+  sp::storage_profile profile;
+  // Unmeasured never prefers maps
+  BOOST_CHECK(!sp::prefer_mapped_reads(profile, 1024 * 1024, true, true));
+  profile.mmap_crossover_sequential_warm.value = 65536;
+  profile.mmap_crossover_random_cold.value = 0;
+  BOOST_CHECK(sp::prefer_mapped_reads(profile, 65536, true, true));
+  BOOST_CHECK(!sp::prefer_mapped_reads(profile, 16384, true, true));
+  BOOST_CHECK(!sp::prefer_mapped_reads(profile, 1024 * 1024, false, false));
+
+  auto mapped = sp::file_for_reads(profile, {}, "storage_profile_mapped_reads.bin", 262144, true, true).value();
+  BOOST_CHECK(dynamic_cast<llfio::mapped_file_handle *>(mapped.get()) != nullptr);
+  auto plain = sp::file_for_reads(profile, {}, "storage_profile_mapped_reads.bin", 4096, true, true).value();
+  BOOST_CHECK(dynamic_cast<llfio::mapped_file_handle *>(plain.get()) == nullptr);
+  // Either reads the same way through the file_handle interface
+  llfio::byte buffer[4096];
+  BOOST_CHECK(mapped->read(0, {{buffer, sizeof(buffer)}}).value() == sizeof(buffer));
+  BOOST_CHECK(plain->read(0, {{buffer, sizeof(buffer)}}).value() == sizeof(buffer));
+  mapped.reset();
+  plain->unlink().value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, storage_profile, mapped_reads, "Tests that storage_profile chooses between mapped and plain reads as expected", TestStorageProfileMappedReads())
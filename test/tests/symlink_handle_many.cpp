@@ -0,0 +1,97 @@
+/* Integration test kernel for batched symlink_handle reads and creation
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <string>
+#include <vector>
+
+static inline void TestSymlinkHandleMany()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  static constexpr size_t count = 300;  // more than one io_uring batch
+  auto dh = llfio::directory_handle::temp_directory().value();
+  std::vector<std::string> leafnames, targets;
+  for(size_t n = 0; n < count; n++)
+  {
+    leafnames.push_back("link" + std::to_string(n));
+    targets.push_back("target" + std::to_string(n * 7));
+  }
+  std::vector<llfio::symlink_handle::create_many_item> creates;
+  for(size_t n = 0; n < count; n++)
+  {
+    // Every seventh link replaces atomically, which is done synchronously
+    creates.emplace_back(leafnames[n], targets[n], (n % 7) == 0);
+  }
+  llfio::symlink_handle::create_many(dh, creates).value();
+  for(auto &item : creates)
+  {
+    BOOST_CHECK(item.created);
+  }
+  // Creating again must fail, unless replacing
+  std::string replaced("replaced");
+  creates.clear();
+  creates.emplace_back(leafnames[1], replaced);
+  creates.emplace_back(leafnames[2], replaced, true);
+  llfio::symlink_handle::create_many(dh, creates).value();
+  BOOST_CHECK(!creates[0].created);
+  BOOST_CHECK(creates[0].created.error() == llfio::errc::file_exists);
+  BOOST_CHECK(creates[1].created);
+  targets[2] = replaced;
+
+  std::vector<llfio::symlink_handle::read_many_item> reads;
+  for(size_t n = 0; n < count; n++)
+  {
+    reads.emplace_back(leafnames[n]);
+  }
+  reads.emplace_back("doesnotexist");
+  llfio::symlink_handle::read_many(dh, reads).value();
+  for(size_t n = 0; n < count; n++)
+  {
+    BOOST_REQUIRE(reads[n].read);
+    BOOST_CHECK(reads[n].buffers.path().path() == llfio::filesystem::path(targets[n]));
+  }
+  BOOST_CHECK(!reads.back().read);
+  BOOST_CHECK(reads.back().read.error() == llfio::errc::no_such_file_or_directory);
+
+  // Enumerating the directory must find all the links
+  std::vector<bool> seen(count);
+  llfio::symlink_handle::read_directory(dh, [&](const llfio::symlink_handle::read_many_item &item) {
+                           BOOST_REQUIRE(item.read);
+                           auto leafname = item.leafname.path().string();
+                           size_t n = std::stoul(leafname.substr(4));
+                           BOOST_REQUIRE(n < count);
+                           BOOST_CHECK(item.buffers.path().path() == llfio::filesystem::path(targets[n]));
+                           seen[n] = true;
+                         })
+  .value();
+  for(size_t n = 0; n < count; n++)
+  {
+    BOOST_CHECK(seen[n]);
+  }
+  llfio::algorithm::reduce(std::move(dh)).value();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, symlink_handle, many, "Tests that symlink_handle::read_many() and create_many() work as expected", TestSymlinkHandleMany())
@@ -0,0 +1,120 @@
+/* Integration test kernel for the syscall timing trace
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+static inline void TestTraceLog()
+{
+#if LLFIO_TRACE_EVENTS
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  // The ring buffer retains the most recent N events, oldest first
+  {
+    auto rb = std::make_unique<llfio::trace_ringbuffer<4>>();
+    for(uint64_t n = 0; n < 6; n++)
+    {
+      rb->push_back("test", nullptr, 1, n * 10, n * 10 + 5);
+    }
+    auto events = rb->events();
+    BOOST_REQUIRE(events.size() == 4);
+    for(size_t n = 0; n < 4; n++)
+    {
+      BOOST_CHECK(events[n].begin_ns == (n + 2) * 10);
+      BOOST_CHECK(events[n].end_ns == (n + 2) * 10 + 5);
+    }
+    rb->clear();
+    BOOST_CHECK(rb->events().empty());
+  }
+
+  auto &log = llfio::trace_log();
+  auto fh = llfio::file_handle::temp_file().value();
+  const llfio::io_handle *inst = &fh;
+  auto events_of = [&](const void *i) {
+    auto events = log.events();
+    events.erase(std::remove_if(events.begin(), events.end(), [&](const llfio::trace_event &e) { return e.inst != i; }), events.end());
+    return events;
+  };
+  log.clear();
+  llfio::byte buffer[4096];
+  memset(buffer, 'a', sizeof(buffer));
+  fh.write(0, {{buffer, sizeof(buffer)}}).value();
+  fh.read(0, {{buffer, sizeof(buffer)}}).value();
+  fh.barrier().value();
+  auto events = events_of(inst);
+  for(auto &e : events)
+  {
+    std::cout << "   " << e.name << " took " << (e.end_ns - e.begin_ns) << " ns" << std::endl;
+    BOOST_CHECK(e.name != nullptr);
+    BOOST_CHECK(e.begin_ns <= e.end_ns);
+    BOOST_CHECK(e.thread_id == QUICKCPPLIB_NAMESPACE::utils::thread::this_thread_id());
+  }
+  // At least one syscall each for the write, the read and the barrier
+  BOOST_CHECK(events.size() >= 3);
+  for(size_t n = 1; n < events.size(); n++)
+  {
+    BOOST_CHECK(events[n - 1].begin_ns <= events[n].begin_ns);
+  }
+
+  // User code can time its own syscalls too
+  {
+    LLFIO_TRACE_SYSCALL(&log, "user");
+  }
+  events = events_of(&log);
+  BOOST_REQUIRE(events.size() == 1);
+  BOOST_CHECK(0 == strcmp(events[0].name, "user"));
+
+  // Nothing is recorded whilst disabled
+  log.clear();
+  log.enabled(false);
+  fh.read(0, {{buffer, sizeof(buffer)}}).value();
+  {
+    LLFIO_TRACE_SYSCALL(&log, "user");
+  }
+  log.enabled(true);
+  BOOST_CHECK(events_of(inst).empty());
+  BOOST_CHECK(events_of(&log).empty());
+
+  // Chrome trace export emits one complete event per retained event
+  {
+    LLFIO_TRACE_SYSCALL(&log, "exported");
+  }
+  std::stringstream ss;
+  llfio::write_chrome_trace(ss);
+  const auto json = ss.str();
+  std::cout << json << std::endl;
+  BOOST_CHECK(json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+  BOOST_CHECK(json.find("\"name\":\"exported\",\"cat\":\"llfio\",\"ph\":\"X\"") != std::string::npos);
+  BOOST_CHECK(json.find("\"dur\":") != std::string::npos);
+  BOOST_CHECK(json.find("\n]}\n") == json.size() - 4);
+  log.clear();
+#else
+  std::cout << "LLFIO_TRACE_EVENTS is zero, so syscall tracing is compiled out." << std::endl;
+#endif
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, logging, trace_log, "Tests that the syscall timing trace and its Chrome trace export work as expected", TestTraceLog())
@@ -25,6 +25,7 @@ Distributed under the Boost Software License, Version 1.0.
 #include "../test_kernel_decl.hpp"
 
 #include <chrono>
+#include <thread>
 
 #include "quickcpplib/algorithm/small_prng.hpp"
 #include "quickcpplib/algorithm/string.hpp"
@@ -188,6 +189,215 @@ static inline void TestTraverse()
   BOOST_CHECK(visitor_st.failed_to_open == visitor_mt.failed_to_open);
   BOOST_CHECK(abs((int) visitor_st.items_enumerated - (int) visitor_mt.items_enumerated) < 5);
   BOOST_CHECK(visitor_st.max_depth == visitor_mt.max_depth);
+
+  std::cout << "Traversing " << to_traverse_path << " using many threads with 64 directories in flight each ..." << std::endl;
+  my_traverse_visitor visitor_if;
+  begin = std::chrono::high_resolution_clock::now();
+  auto items_if = algorithm::traverse(to_traverse, &visitor_if, 0, nullptr, false, 64).value();
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "  Traversed " << items_if << " directories on " << to_traverse_path << " in " << (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000000.0) << " seconds (which is " << (items_if / (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000000.0))
+            << " directories/sec).\n";
+  std::cout << "     Enumerated a total of " << visitor_if.items_enumerated << " items. " << visitor_if.failed_to_open << " directories could not be opened. Maximum hierarchy depth was " << visitor_if.max_depth << std::endl;
+  BOOST_CHECK(abs((int) items_st - (int) items_if) < 5);
+  BOOST_CHECK(visitor_st.failed_to_open == visitor_if.failed_to_open);
+  BOOST_CHECK(abs((int) visitor_st.items_enumerated - (int) visitor_if.items_enumerated) < 5);
+  BOOST_CHECK(visitor_st.max_depth == visitor_if.max_depth);
+
+  std::cout << "Traversing " << to_traverse_path << " using many threads with no more than 1024 directories queued ..." << std::endl;
+  my_traverse_visitor visitor_bq;
+  begin = std::chrono::high_resolution_clock::now();
+  auto items_bq = algorithm::traverse(to_traverse, &visitor_bq, 0, nullptr, false, 1, 1024).value();
+  end = std::chrono::high_resolution_clock::now();
+  std::cout << "  Traversed " << items_bq << " directories on " << to_traverse_path << " in " << (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000000.0) << " seconds (which is " << (items_bq / (std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000000.0))
+            << " directories/sec).\n";
+  BOOST_CHECK(abs((int) items_st - (int) items_bq) < 5);
+  BOOST_CHECK(visitor_st.failed_to_open == visitor_bq.failed_to_open);
+  BOOST_CHECK(abs((int) visitor_st.items_enumerated - (int) visitor_bq.items_enumerated) < 5);
+}
+
+static inline void TestIncrementalTraverse()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  auto tempdirh = directory_handle::temp_directory().value();
+  auto treeh = directory_handle::uniquely_named_directory(tempdirh).value();
+  auto ah = directory_handle::directory(treeh, "a", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  auto bh = directory_handle::directory(treeh, "b", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  auto ch = directory_handle::directory(ah, "c", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  file_handle::file(ch, "f", file_handle::mode::write, file_handle::creation::if_needed).value();
+  struct my_visitor final : algorithm::incremental_traverse_visitor
+  {
+    std::atomic<size_t> files_seen{0};
+    virtual result<void> changed_enumeration(void *data, const directory_handle &dirh, directory_handle::buffers_type &contents, size_t depth) noexcept override
+    {
+      (void) data;
+      (void) dirh;
+      (void) depth;
+      for(auto &entry : contents)
+      {
+        if(entry.stat.st_type == filesystem::file_type::regular)
+        {
+          files_seen.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+      return success();
+    }
+  };
+  // Directories modified within a second of a checkpoint are always rescanned
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  my_visitor visitor1;
+  auto checkpoint1 = algorithm::incremental_traverse(treeh, algorithm::traverse_checkpoint(), &visitor1).value();
+  std::cout << "First incremental traversal found " << checkpoint1.directories_changed << " changed and " << checkpoint1.directories_unchanged
+            << " unchanged directories." << std::endl;
+  BOOST_CHECK(checkpoint1.directories.size() == 4);
+  BOOST_CHECK(checkpoint1.directories_changed == 4);
+  BOOST_CHECK(visitor1.files_seen == 1);
+
+  // The checkpoint survives a round trip through a file
+  auto cpfh = file_handle::temp_inode().value();
+  checkpoint1.save(cpfh).value();
+  auto loaded = algorithm::traverse_checkpoint::load(cpfh).value();
+  BOOST_CHECK(loaded.directories.size() == checkpoint1.directories.size());
+  BOOST_CHECK(loaded.taken == checkpoint1.taken);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+  my_visitor visitor2;
+  auto checkpoint2 = algorithm::incremental_traverse(treeh, loaded, &visitor2).value();
+  BOOST_CHECK(checkpoint2.directories_changed == 0);
+  BOOST_CHECK(checkpoint2.directories_unchanged == 4);
+  BOOST_CHECK(visitor2.files_seen == 0);
+
+  // Only the directory with a new entry is reported changed
+  file_handle::file(bh, "g", file_handle::mode::write, file_handle::creation::if_needed).value();
+  my_visitor visitor3;
+  auto checkpoint3 = algorithm::incremental_traverse(treeh, checkpoint2, &visitor3).value();
+  std::cout << "Third incremental traversal found " << checkpoint3.directories_changed << " changed and " << checkpoint3.directories_unchanged
+            << " unchanged directories." << std::endl;
+  BOOST_CHECK(checkpoint3.directories_changed == 1);
+  BOOST_CHECK(checkpoint3.directories_unchanged == 3);
+  BOOST_CHECK(visitor3.files_seen == 1);
+
+  algorithm::reduce(std::move(treeh)).value();
+}
+
+static inline void TestTreeSnapshot()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  auto tempdirh = directory_handle::temp_directory().value();
+  auto treeh = directory_handle::uniquely_named_directory(tempdirh).value();
+  auto snapdirh = directory_handle::uniquely_named_directory(tempdirh).value();
+  auto ah = directory_handle::directory(treeh, "a", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  auto bh = directory_handle::directory(treeh, "b", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  auto ch = directory_handle::directory(ah, "c", directory_handle::mode::write, directory_handle::creation::if_needed).value();
+  auto fh = file_handle::file(ch, "f", file_handle::mode::write, file_handle::creation::if_needed).value();
+  file_handle::file(bh, "e", file_handle::mode::write, file_handle::creation::if_needed).value();
+
+  auto snapshot1 = algorithm::snapshot_tree(treeh).value();
+  BOOST_CHECK(snapshot1.size() == 5);
+  const auto *f = snapshot1.find(algorithm::tree_snapshot::hash_leafname(
+  algorithm::tree_snapshot::hash_leafname(algorithm::tree_snapshot::hash_leafname(algorithm::tree_snapshot::root_hash, "a"), "c"), "f"));
+  BOOST_REQUIRE(f != nullptr);
+  BOOST_CHECK(f->file_type() == filesystem::file_type::regular);
+  BOOST_CHECK(snapshot1.path(*f) == filesystem::path("a") / "c" / "f");
+
+  // The snapshot survives a round trip through a mapped file
+  {
+    auto snapfh = file_handle::file(snapdirh, "snapshot", file_handle::mode::write, file_handle::creation::if_needed).value();
+    snapshot1.save(snapfh).value();
+  }
+  auto mapped = algorithm::tree_snapshot::map(snapdirh, "snapshot").value();
+  BOOST_CHECK(mapped.size() == snapshot1.size());
+  BOOST_CHECK(mapped.taken == snapshot1.taken);
+  BOOST_CHECK(algorithm::tree_snapshot_diff(snapshot1, mapped).value().empty());
+
+  // Add b/g, remove b/e and modify a/c/f
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  file_handle::file(bh, "g", file_handle::mode::write, file_handle::creation::if_needed).value();
+  file_handle::file(bh, "e", file_handle::mode::write).value().unlink().value();
+  const char text[] = "hello";
+  fh.write(0, {{reinterpret_cast<const byte *>(text), 5}}).value();
+  auto snapshot2 = algorithm::snapshot_tree(treeh).value();
+  for(size_t threads : {(size_t) 1, (size_t) 4})
+  {
+    auto diff = algorithm::tree_snapshot_diff(mapped, snapshot2, threads).value();
+    size_t added = 0, removed = 0, modified = 0;
+    for(auto &d : diff)
+    {
+      switch(d.what)
+      {
+      case algorithm::tree_snapshot_difference::kind::added:
+        added++;
+        BOOST_CHECK(snapshot2.path(*d.after) == filesystem::path("b") / "g");
+        break;
+      case algorithm::tree_snapshot_difference::kind::removed:
+        removed++;
+        BOOST_CHECK(mapped.path(*d.before) == filesystem::path("b") / "e");
+        break;
+      case algorithm::tree_snapshot_difference::kind::modified:
+        modified++;
+        BOOST_CHECK((snapshot2.path(*d.after) == filesystem::path("b") || snapshot2.path(*d.after) == filesystem::path("a") / "c" / "f"));
+        break;
+      }
+    }
+    BOOST_CHECK(added == 1);
+    BOOST_CHECK(removed == 1);
+    BOOST_CHECK(modified == 2);
+  }
+
+  algorithm::reduce(std::move(treeh)).value();
+  algorithm::reduce(std::move(snapdirh)).value();
+}
+
+static inline void TestSummarize()
+{
+  using namespace LLFIO_V2_NAMESPACE;
+  auto tempdirh = directory_handle::temp_directory().value();
+  auto treeh = directory_handle::uniquely_named_directory(tempdirh).value();
+  // Two hundred subdirectories each containing a 4Kb file, plus an empty file and a 1Mb file
+  for(size_t n = 0; n < 200; n++)
+  {
+    auto dh = directory_handle::directory(treeh, std::to_string(n), directory_handle::mode::write, directory_handle::creation::if_needed).value();
+    file_handle::file(dh, "f", file_handle::mode::write, file_handle::creation::if_needed).value().truncate(4096).value();
+  }
+  file_handle::file(treeh, "zero", file_handle::mode::write, file_handle::creation::if_needed).value();
+  file_handle::file(treeh, "big", file_handle::mode::write, file_handle::creation::if_needed).value().truncate(1024 * 1024).value();
+
+  const auto want = algorithm::traversal_summary::default_metadata() | stat_t::want::mtim | stat_t::want::nlink;
+  auto summary = algorithm::summarize(treeh, want).value();
+  BOOST_CHECK(summary.types[filesystem::file_type::regular] == 202);
+  BOOST_CHECK(summary.types[filesystem::file_type::directory] == 201);
+  BOOST_CHECK(summary.directories_not_sampled == 0);
+  BOOST_CHECK(summary.size_histogram.total() == 202);
+  BOOST_CHECK(summary.size_histogram.counts[0] == 1);
+  BOOST_CHECK(summary.size_histogram.counts[algorithm::log2_histogram::bucket(4096)] == 200);
+  BOOST_CHECK(summary.size_histogram.counts[algorithm::log2_histogram::bucket(1024 * 1024)] == 1);
+  BOOST_CHECK(summary.size_histogram.quantile(0.5) == 4096);
+  BOOST_CHECK(summary.nlink_histogram.counts[1] == 202);
+  BOOST_CHECK(summary.age_histogram.total() == 202);
+  BOOST_CHECK(summary.age_histogram.quantile(1.0) < 3600);
+
+  // Sampling half the subdirectories weights what is found within them by two
+  algorithm::traversal_sampling sampling;
+  sampling.fraction = 0.5;
+  sampling.seed = 78;
+  auto sampled = algorithm::summarize(treeh, want, sampling).value();
+  std::cout << "Sampling did not descend into " << sampled.directories_not_sampled << " of 200 directories" << std::endl;
+  BOOST_CHECK(sampled.directories_not_sampled > 40 && sampled.directories_not_sampled < 160);
+  BOOST_CHECK(sampled.types[filesystem::file_type::directory] == 201);
+  BOOST_CHECK(sampled.types[filesystem::file_type::regular] == 2 + 2 * (200 - sampled.directories_not_sampled));
+  BOOST_CHECK(sampled.size_histogram.counts[algorithm::log2_histogram::bucket(4096)] == 2 * (200 - sampled.directories_not_sampled));
+  BOOST_CHECK(sampled.size_histogram.counts[0] == 1);
+  sampling.fraction = 0;
+  BOOST_CHECK(algorithm::summarize(treeh, want, sampling).error() == errc::invalid_argument);
+
+  BOOST_CHECK(algorithm::traversal_sampling::fraction_for(0) == 1.0);
+  BOOST_CHECK(algorithm::traversal_sampling::fraction_for(1000) > 0.9);
+  BOOST_CHECK(algorithm::traversal_sampling::fraction_for(1000000000) < 0.0001);
+  algorithm::reduce(std::move(treeh)).value();
 }
 
 KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, traverse, "Tests that llfio::algorithm::traverse() works as expected", TestTraverse())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, incremental_traverse, "Tests that llfio::algorithm::incremental_traverse() works as expected",
+                       TestIncrementalTraverse())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, tree_snapshot, "Tests that llfio::algorithm::snapshot_tree() and tree_snapshot_diff() work as expected",
+                       TestTreeSnapshot())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, summarize, "Tests that llfio::algorithm::summarize() histograms and sampling work as expected", TestSummarize())
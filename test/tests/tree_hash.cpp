@@ -0,0 +1,85 @@
+/* Integration test kernel for algorithm::tree_hash
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <vector>
+
+template <class Hasher> static inline void TestTreeHashWith()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  static constexpr size_t chunk_size = 65536;
+  auto fh = llfio::file_handle::temp_inode().value();
+  std::vector<llfio::byte> buffer(chunk_size * 37 + 1000);
+  for(size_t n = 0; n < buffer.size(); n++)
+  {
+    buffer[n] = (llfio::byte)((n * 7) & 0xff);
+  }
+  fh.write(0, {{buffer.data(), buffer.size()}}).value();
+  llfio::algorithm::tree_hash_options opts;
+  opts.chunk_size = chunk_size;
+  opts.threads = 4;
+  auto hash = llfio::algorithm::tree_hash<Hasher>(fh, opts).value();
+  BOOST_CHECK(hash.length == buffer.size());
+  BOOST_REQUIRE(hash.chunks.size() == 38);
+  // The root does not depend upon the number of threads
+  opts.threads = 1;
+  auto hash1 = llfio::algorithm::tree_hash<Hasher>(fh, opts).value();
+  BOOST_CHECK(hash1.root_equals(hash));
+  BOOST_CHECK(hash1.differing_chunks(hash).empty());
+  // The leaves are the hashes of each chunk
+  BOOST_CHECK(0 == memcmp(&hash.chunks[1], &hash1.chunks[1], sizeof(hash.chunks[1])));
+  const auto leaf = Hasher::hash(buffer.data() + chunk_size, chunk_size);
+  BOOST_CHECK(0 == memcmp(&hash.chunks[1], &leaf, sizeof(leaf)));
+
+  // Modifying one byte changes one chunk and the root, which an update finds
+  const llfio::byte one(78);
+  fh.write(chunk_size * 5 + 3, {{&one, 1}}).value();
+  auto modified = llfio::algorithm::tree_hash<Hasher>(fh, opts).value();
+  BOOST_CHECK(!modified.root_equals(hash));
+  auto differ = modified.differing_chunks(hash);
+  BOOST_REQUIRE(differ.size() == 1);
+  BOOST_CHECK(differ[0] == 5);
+  llfio::algorithm::tree_hash_update(fh, hash, chunk_size * 5 + 3, 1, opts).value();
+  BOOST_CHECK(hash.root_equals(modified));
+
+  // Extending and truncating are also found by an update
+  fh.write(buffer.size() + chunk_size, {{buffer.data(), 100}}).value();
+  llfio::algorithm::tree_hash_update(fh, hash, buffer.size() + chunk_size, 100, opts).value();
+  BOOST_CHECK(hash.root_equals(llfio::algorithm::tree_hash<Hasher>(fh, opts).value()));
+  fh.truncate(chunk_size * 3 + 5).value();
+  llfio::algorithm::tree_hash_update(fh, hash, 0, 0, opts).value();
+  BOOST_CHECK(hash.chunks.size() == 4);
+  BOOST_CHECK(hash.root_equals(llfio::algorithm::tree_hash<Hasher>(fh, opts).value()));
+}
+
+static inline void TestTreeHash()
+{
+  TestTreeHashWith<LLFIO_V2_NAMESPACE::algorithm::fast_hash_hasher>();
+  TestTreeHashWith<LLFIO_V2_NAMESPACE::algorithm::crc32c_hasher>();
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, tree_hash, "Tests that llfio::algorithm::tree_hash works as expected", TestTreeHash())
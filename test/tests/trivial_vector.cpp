@@ -112,6 +112,45 @@ static inline void TestTrivialVector()
   BOOST_CHECK(it == v.end());
 }
 
+static inline void TestTrivialVectorAddressSpaceReserved()
+{
+  using int_vector = LLFIO_V2_NAMESPACE::algorithm::trivial_vector<uint64_t>;
+  const size_t pageitems = LLFIO_V2_NAMESPACE::utils::page_size() / sizeof(uint64_t);
+  int_vector v;
+  v.push_back(5);
+  v.reserve_address_space(1024 * 1024);
+  BOOST_CHECK(v.address_space_reserved() == 1024 * 1024);
+  BOOST_CHECK(v.size() == 1);
+  BOOST_CHECK(v[0] == 5);
+  // Growth within the reservation never moves the items
+  const uint64_t *addr = v.data();
+  for(uint64_t n = 1; n < 100000; n++)
+  {
+    v.push_back(n);
+  }
+  BOOST_CHECK(v.data() == addr);
+  BOOST_CHECK(v.capacity() >= 100000);
+  BOOST_CHECK(v[0] == 5);
+  BOOST_CHECK(v[99999] == 99999);
+  // Shrinking decommits without moving
+  v.resize(pageitems + 1);
+  v.shrink_to_fit();
+  BOOST_CHECK(v.data() == addr);
+  BOOST_CHECK(v.capacity() == 2 * pageitems);
+  BOOST_CHECK(v[pageitems] == pageitems);
+  v.resize(3 * pageitems, 78);
+  BOOST_CHECK(v.data() == addr);
+  BOOST_CHECK(v[3 * pageitems - 1] == 78);
+  // Growth beyond the reservation moves into a larger one
+  v.resize(1024 * 1024 + 1, 79);
+  BOOST_CHECK(v.address_space_reserved() >= 2 * 1024 * 1024);
+  BOOST_CHECK(v[pageitems] == pageitems);
+  BOOST_CHECK(v[1024 * 1024] == 79);
+  int_vector v2(std::move(v));
+  BOOST_CHECK(v2.address_space_reserved() >= 2 * 1024 * 1024);
+  BOOST_CHECK(v2[1024 * 1024] == 79);
+}
+
 inline std::string printKb(size_t bytes)
 {
   if(bytes >= 1024 * 1024 * 1024)
@@ -245,5 +284,6 @@ static inline void BenchmarkTrivialVector2()
 }
 
 KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, trivial_vector, "Tests that llfio::algorithm::trivial_vector works as expected", TestTrivialVector())
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, trivial_vector_reserved, "Tests that llfio::algorithm::trivial_vector grows in place within reserved address space", TestTrivialVectorAddressSpaceReserved())
 KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, trivial_vector2, "Benchmarks llfio::algorithm::trivial_vector against std::vector with push_back()", BenchmarkTrivialVector1())
 KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, trivial_vector3, "Benchmarks llfio::algorithm::trivial_vector against std::vector with resize()", BenchmarkTrivialVector2())
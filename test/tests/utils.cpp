@@ -24,6 +24,8 @@ Distributed under the Boost Software License, Version 1.0.
 
 #include "../test_kernel_decl.hpp"
 
+#include <thread>
+
 static inline void TestCurrentProcessMemoryUsage()
 {
 #if defined(__has_feature)
@@ -215,4 +217,153 @@ static inline void TestCurrentProcessMemoryUsage()
   }
 }
 
+static inline void TestCurrentProcessMemoryUsageSample()
+{
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+  return;  // Memory usage stats are confounded by the address sanitiser
+#endif
+#endif
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using want = llfio::utils::process_memory_usage::want;
+  static constexpr size_t bytes = 64 * 1024 * 1024;
+  auto before = llfio::utils::current_process_memory_usage(want::sample).value();
+  auto detailed = llfio::utils::current_process_memory_usage().value();
+  // The cheap and detailed modes should broadly agree
+  BOOST_CHECK(before.total_address_space_in_use > detailed.total_address_space_in_use / 2);
+  BOOST_CHECK(before.total_address_space_in_use < detailed.total_address_space_in_use * 2);
+  {
+    auto maph = llfio::map_handle::map(bytes).value();
+    for(size_t n = 0; n < bytes; n += 4096)
+    {
+      maph.address()[n] = llfio::byte(1);
+    }
+    auto after = llfio::utils::current_process_memory_usage(want::sample).value();
+    std::cout << "Sampled before " << (before.private_paged_in / 1024.0 / 1024.0) << " Mb, after faulting in 64Mb "
+              << (after.private_paged_in / 1024.0 / 1024.0) << " Mb" << std::endl;
+    BOOST_CHECK(after.total_address_space_in_use >= before.total_address_space_in_use + bytes);
+    BOOST_CHECK(after.private_paged_in >= before.private_paged_in + bytes / 2);
+    BOOST_CHECK(after.private_committed >= after.private_paged_in / 2);
+  }
+}
+
+static inline void TestPageAllocatorCache()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::byte;
+  llfio::utils::page_allocator<byte> alloc;
+  llfio::utils::trim_page_allocator_cache();
+  // Deallocated memory is reused by allocations of the same size
+  byte *a = alloc.allocate(65536);
+  memset(a, 78, 65536);
+  alloc.deallocate(a, 65536);
+  byte *b = alloc.allocate(65536);
+  BOOST_CHECK(b == a);
+  BOOST_CHECK(b[65535] == byte(78));
+  // But not by allocations of other sizes
+  byte *c = alloc.allocate(131072);
+  BOOST_CHECK(c != a);
+  alloc.deallocate(c, 131072);
+  // Memory kept by exiting threads is reused by other threads
+  std::thread([&] { alloc.deallocate(b, 65536); }).join();
+  byte *d = alloc.allocate(65536);
+  BOOST_CHECK(d == b);
+  alloc.deallocate(d, 65536);
+  BOOST_CHECK(llfio::utils::trim_page_allocator_cache() == 65536 + 131072);
+  BOOST_CHECK(llfio::utils::trim_page_allocator_cache() == 0);
+  // Disabling reuse releases everything deallocated
+  llfio::utils::set_page_allocator_cache_limits(0, 0);
+  alloc.deallocate(alloc.allocate(65536), 65536);
+  BOOST_CHECK(llfio::utils::trim_page_allocator_cache() == 0);
+  llfio::utils::set_page_allocator_cache_limits(4 * 1024 * 1024, 64 * 1024 * 1024);
+}
+
+static inline void TestRandomFill()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  // Short fills come from the kernel, long fills from ChaCha20 keyed by the kernel and include a partial final block
+  for(size_t bytes : {size_t(16), size_t(256), size_t(257), size_t(1024 * 1024 + 37)})
+  {
+    std::vector<char> a(bytes + 1, 0), b(bytes + 1, 0);
+    llfio::utils::random_fill(a.data(), bytes);
+    llfio::utils::random_fill(b.data(), bytes);
+    BOOST_CHECK(a != b);
+    BOOST_CHECK(a[bytes] == 0);
+    if(bytes >= 65536)
+    {
+      size_t counts[256] = {0};
+      for(size_t n = 0; n < bytes; n++)
+      {
+        counts[(unsigned char) a[n]]++;
+      }
+      // Every byte value should be within 10% of its expected frequency
+      for(size_t n = 0; n < 256; n++)
+      {
+        BOOST_CHECK(counts[n] > bytes / 256 * 9 / 10);
+        BOOST_CHECK(counts[n] < bytes / 256 * 11 / 10);
+      }
+    }
+  }
+}
+
+static inline void TestMemoryPressureCallbacks()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using llfio::byte;
+  static int lows, criticals;
+  auto id = llfio::utils::register_memory_pressure_callback(
+            [](void *data, llfio::utils::memory_pressure level) noexcept {
+              BOOST_CHECK(data == &lows);
+              (level == llfio::utils::memory_pressure::critical) ? ++criticals : ++lows;
+            },
+            &lows)
+            .value();
+  // Critical pressure empties the page_allocator cache
+  llfio::utils::page_allocator<byte> alloc;
+  alloc.deallocate(alloc.allocate(8 * 1024 * 1024), 8 * 1024 * 1024);
+  llfio::utils::notify_memory_pressure(llfio::utils::memory_pressure::low);
+  llfio::utils::notify_memory_pressure(llfio::utils::memory_pressure::critical);
+  BOOST_CHECK(lows == 1);
+  BOOST_CHECK(criticals == 1);
+  BOOST_CHECK(llfio::utils::trim_page_allocator_cache() == 0);
+  llfio::utils::unregister_memory_pressure_callback(id);
+  llfio::utils::notify_memory_pressure(llfio::utils::memory_pressure::critical);
+  BOOST_CHECK(criticals == 1);
+  // The monitor may not be supported here, but must start and stop cleanly if it is
+  auto r = llfio::utils::start_memory_pressure_monitor();
+  if(!r)
+  {
+    BOOST_CHECK(r.error() == llfio::errc::not_supported);
+  }
+  else
+  {
+    llfio::utils::start_memory_pressure_monitor().value();
+  }
+  llfio::utils::stop_memory_pressure_monitor();
+  llfio::utils::stop_memory_pressure_monitor();
+}
+
+static inline void TestFlushModifiedDataOfFilesystem()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  auto fh = llfio::file_handle::temp_file().value();
+  std::vector<llfio::byte> buffer(1024 * 1024, llfio::byte(78));
+  fh.write(0, {{buffer.data(), buffer.size()}}).value();
+  auto r = llfio::utils::flush_modified_data(fh);
+#ifdef _WIN32
+  // Opening the volume requires elevation
+  if(!r && r.error() == llfio::errc::permission_denied)
+  {
+    std::cout << "Flushing a volume requires elevation, skipping." << std::endl;
+    return;
+  }
+#endif
+  r.value();
+}
+
 KERNELTEST_TEST_KERNEL(integration, llfio, utils, current_process_memory_usage, "Tests that llfio::utils::current_process_memory_usage() works as expected", TestCurrentProcessMemoryUsage())
+KERNELTEST_TEST_KERNEL(integration, llfio, utils, current_process_memory_usage_sample, "Tests that llfio::utils::current_process_memory_usage(want::sample) works as expected", TestCurrentProcessMemoryUsageSample())
+KERNELTEST_TEST_KERNEL(integration, llfio, utils, page_allocator_cache, "Tests that llfio::utils::page_allocator reuses deallocated memory", TestPageAllocatorCache())
+KERNELTEST_TEST_KERNEL(integration, llfio, utils, random_fill, "Tests that llfio::utils::random_fill() works as expected", TestRandomFill())
+KERNELTEST_TEST_KERNEL(integration, llfio, utils, memory_pressure_callbacks, "Tests that llfio::utils memory pressure callbacks work as expected", TestMemoryPressureCallbacks())
+KERNELTEST_TEST_KERNEL(integration, llfio, utils, flush_modified_data_of_filesystem, "Tests that llfio::utils::flush_modified_data(h) works as expected", TestFlushModifiedDataOfFilesystem())
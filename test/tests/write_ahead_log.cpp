@@ -0,0 +1,183 @@
+/* Integration test kernel for algorithm::write_ahead_log
+(C) 2026 Niall Douglas <http://www.nedproductions.biz/> (1 commit)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+    (See accompanying file Licence.txt or copy at
+          http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+
+#include "../test_kernel_decl.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static inline void TestWriteAheadLog()
+{
+  namespace llfio = LLFIO_V2_NAMESPACE;
+  using write_ahead_log = llfio::algorithm::write_ahead_log;
+  using lsn_type = write_ahead_log::lsn_type;
+  auto dirh = llfio::directory_handle::temp_directory().value();
+  // Small segments so the records span many of them
+  static constexpr write_ahead_log::extent_type segment_size = 64 * 1024;
+  auto make_record = [](size_t n) {
+    std::string ret((n * 37) % 700, (char) ('a' + n % 26));
+    return ret + std::to_string(n);
+  };
+  auto as_span = [](const std::string &s) { return llfio::span<const llfio::byte>((const llfio::byte *) s.data(), s.size()); };
+  auto count_segments = [&](const char *suffix) {
+    auto logdirh = llfio::directory_handle::directory(dirh, "log").value();
+    std::vector<llfio::directory_handle::buffer_type> entries(256);
+    auto buffers = logdirh.read({entries}).value();
+    BOOST_REQUIRE(buffers.done());
+    std::vector<std::string> ret;
+    for(const auto &entry : buffers)
+    {
+      auto leafname = entry.leafname.path().string();
+      if(leafname.size() > strlen(suffix) && 0 == leafname.compare(leafname.size() - strlen(suffix), std::string::npos, suffix))
+      {
+        ret.push_back(std::move(leafname));
+      }
+    }
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  };
+  auto recover = [&](size_t max_free_segments = 4) {
+    auto recovered = std::make_shared<std::vector<std::pair<lsn_type, std::string>>>();
+    auto log = write_ahead_log::open(dirh, "log",
+                                     llfio::make_function_ptr<llfio::result<void>(lsn_type, llfio::span<const llfio::byte>)>(
+                                     [recovered](lsn_type lsn, llfio::span<const llfio::byte> record) -> llfio::result<void> {
+                                       recovered->emplace_back(lsn, std::string((const char *) record.data(), record.size()));
+                                       return llfio::success();
+                                     }),
+                                     segment_size, max_free_segments)
+               .value();
+    return std::make_pair(std::move(log), std::move(*recovered));
+  };
+
+  // Concurrent appenders are each durable in log sequence number order
+  std::map<lsn_type, std::string> appended;
+  {
+    auto log = write_ahead_log::open(dirh, "log", {}, segment_size).value();
+    BOOST_CHECK(log->segment_size() == segment_size);
+    std::string oversized(log->max_record_size() + 1, 'x');
+    BOOST_CHECK(log->append(as_span(oversized)).error() == llfio::errc::value_too_large);
+    std::mutex lock;
+    std::vector<std::thread> appenders;
+    for(size_t t = 0; t < 4; t++)
+    {
+      appenders.emplace_back([&, t] {
+        for(size_t n = 0; n < 250; n++)
+        {
+          const auto record = make_record(t * 1000 + n);
+          const auto lsn = log->append(as_span(record)).value();
+          BOOST_CHECK(log->durable_lsn() >= lsn);
+          std::lock_guard<std::mutex> g(lock);
+          BOOST_CHECK(appended.emplace(lsn, record).second);
+        }
+      });
+    }
+    for(auto &appender : appenders)
+    {
+      appender.join();
+    }
+  }
+  BOOST_CHECK(count_segments(".wal").size() > 2);
+
+  // Recovery returns every record in order
+  {
+    auto recovered = recover();
+    BOOST_REQUIRE(recovered.second.size() == appended.size());
+    auto it = appended.begin();
+    for(auto &i : recovered.second)
+    {
+      BOOST_CHECK(i.first == it->first);
+      BOOST_CHECK(i.second == it->second);
+      ++it;
+    }
+    // Log sequence numbers after a reopen exceed those recovered
+    const auto record = make_record(5000);
+    const auto lsn = recovered.first->append(as_span(record)).value();
+    BOOST_CHECK(lsn > appended.rbegin()->first);
+    appended.emplace(lsn, record);
+
+    // Checkpointing retires all but the current segment, keeping up to four for reuse
+    const auto segments = count_segments(".wal").size();
+    recovered.first->checkpoint(lsn).value();
+    BOOST_CHECK(count_segments(".wal").size() == 1);
+    BOOST_CHECK(count_segments(".free").size() == std::min(segments - 1, (size_t) 4));
+    appended.clear();
+    appended.emplace(lsn, record);
+    // New segments reuse the retired ones
+    for(size_t n = 0; n < 100; n++)
+    {
+      const auto record2 = make_record(6000 + n);
+      appended.emplace(recovered.first->append(as_span(record2)).value(), record2);
+    }
+    BOOST_CHECK(count_segments(".free").size() < std::min(segments - 1, (size_t) 4));
+  }
+  {
+    auto recovered = recover();
+    BOOST_REQUIRE(recovered.second.size() == appended.size());
+    BOOST_CHECK(recovered.second.front().first == appended.begin()->first);
+    BOOST_CHECK(recovered.second.back().second == appended.rbegin()->second);
+  }
+
+  // A torn record ends recovery, and the records after it are never recovered
+  {
+    auto recovered = recover();
+    recovered.first->checkpoint(recovered.first->durable_lsn() + 1).value();
+    for(size_t n = 0; n < 3; n++)
+    {
+      recovered.first->append(as_span(make_record(7000 + n))).value();
+    }
+  }
+  {
+    auto segments = count_segments(".wal");
+    BOOST_REQUIRE(segments.size() == 1);
+    auto logdirh = llfio::directory_handle::directory(dirh, "log").value();
+    auto fh = llfio::file_handle::file(logdirh, segments.back(), llfio::file_handle::mode::write).value();
+    std::vector<llfio::byte> content((size_t) segment_size);
+    fh.read(0, {{content.data(), content.size()}}).value();
+    const auto record = make_record(7001);
+    auto it = std::search(content.begin(), content.end(), (const llfio::byte *) record.data(), (const llfio::byte *) record.data() + record.size());
+    BOOST_REQUIRE(it != content.end());
+    *it = (llfio::byte) ~(unsigned char) *it;
+    fh.write((llfio::file_handle::extent_type)(it - content.begin()), {{&*it, 1}}).value();
+  }
+  {
+    auto recovered = recover();
+    BOOST_REQUIRE(recovered.second.size() == 1);
+    BOOST_CHECK(recovered.second.front().second == make_record(7000));
+    recovered.first->append(as_span(make_record(8000))).value();
+  }
+  {
+    auto recovered = recover();
+    BOOST_REQUIRE(recovered.second.size() == 2);
+    BOOST_CHECK(recovered.second.front().second == make_record(7000));
+    BOOST_CHECK(recovered.second.back().second == make_record(8000));
+  }
+}
+
+KERNELTEST_TEST_KERNEL(integration, llfio, algorithm, write_ahead_log, "Tests that llfio::algorithm::write_ahead_log works as expected", TestWriteAheadLog())